@@ -14,9 +14,33 @@ TMR_INCLUDE = -I${TMR_DIR}/src -I${TMR_DIR}/src/interfaces -I${TMR_DIR}/src/topo
 TMR_CC_FLAGS = ${TMR_FLAGS} ${TMR_INCLUDE} ${BLOSSOM_INCLUDE} ${TACS_OPT_CC_FLAGS} ${EGADS_CC_FLAGS}
 TMR_DEBUG_CC_FLAGS = ${TMR_DEBUG_FLAGS} ${TMR_INCLUDE} ${BLOSSOM_INCLUDE} ${TACS_DEBUG_CC_FLAGS} ${EGADS_DEBUG_CC_FLAGS}
 
+# Use OpenMP threads within each MPI process when TMR_USE_OPENMP = 1
+ifeq (${TMR_USE_OPENMP},1)
+TMR_CC_FLAGS += -fopenmp -DTMR_HAS_OPENMP
+TMR_DEBUG_CC_FLAGS += -fopenmp -DTMR_HAS_OPENMP
+SO_LINK_FLAGS += -fopenmp
+endif
+
+# Apply the filters on a GPU when TMR_USE_CUDA = 1 or TMR_USE_HIP = 1
+ifeq (${TMR_USE_CUDA},1)
+TMR_CC_FLAGS += -DTMR_HAS_CUDA ${CUDA_INCLUDE}
+TMR_DEBUG_CC_FLAGS += -DTMR_HAS_CUDA ${CUDA_INCLUDE}
+TMR_DEVICE_CC = ${NVCC} -Xcompiler -fPIC ${NVCC_FLAGS} -DTMR_HAS_CUDA
+TMR_DEVICE_LD_FLAGS = ${CUDA_LD_FLAGS} -lcudart
+endif
+ifeq (${TMR_USE_HIP},1)
+TMR_CC_FLAGS += -DTMR_HAS_HIP ${HIP_INCLUDE}
+TMR_DEBUG_CC_FLAGS += -DTMR_HAS_HIP ${HIP_INCLUDE}
+TMR_DEVICE_CC = ${HIPCC} -x hip -fPIC ${HIPCC_FLAGS} -DTMR_HAS_HIP
+TMR_DEVICE_LD_FLAGS = ${HIP_LD_FLAGS} -lamdhip64
+endif
+
 # Set the compiler flags
-TMR_EXTERN_LIBS = ${BLOSSOM_LIB} ${TACS_LD_FLAGS} ${PAROPT_LD_FLAGS} ${EGADS_LD_FLAGS} ${OPENCASCADE_LIB_PATH} ${OPENCASCADE_LIBS} ${NETGEN_LD_FLAGS}
+TMR_EXTERN_LIBS = ${BLOSSOM_LIB} ${TACS_LD_FLAGS} ${PAROPT_LD_FLAGS} ${EGADS_LD_FLAGS} ${OPENCASCADE_LIB_PATH} ${OPENCASCADE_LIBS} ${NETGEN_LD_FLAGS} ${TMR_DEVICE_LD_FLAGS}
 TMR_LD_FLAGS = ${TMR_LD_CMD} ${TMR_EXTERN_LIBS}
+ifeq (${TMR_USE_OPENMP},1)
+TMR_LD_FLAGS += -fopenmp
+endif
 
 # This is the one rule that is used to compile all the source
 %.o: %.cpp
@@ -24,3 +48,11 @@ TMR_LD_FLAGS = ${TMR_LD_CMD} ${TMR_EXTERN_LIBS}
 	@echo
 	@echo "        --- Compiled $*.cpp successfully ---"
 	@echo
+
+# The GPU kernels are compiled with nvcc or hipcc. They do not depend
+# on the other libraries, so only the TMR include paths are required.
+%.o: %.cu
+	${TMR_DEVICE_CC} -I${TMR_DIR}/src/topology -c $< -o $*.o
+	@echo
+	@echo "        --- Compiled $*.cu successfully ---"
+	@echo
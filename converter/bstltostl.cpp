@@ -5,6 +5,11 @@
   This is a conversion tool that converts the output .bstl file (which
   is the results of a parallel I/O and is in bindary) to a regular
   .stl file.
+
+  The following options may precede the input files:
+
+  --binary: write a binary .stl file instead of an ASCII .stl file
+  --weld:   weld the vertices and write an indexed .ply file
 */
 int main(int argc, char *argv[]) {
   MPI_Init(&argc, &argv);
@@ -17,8 +22,23 @@ int main(int argc, char *argv[]) {
     return (1);
   }
 
+  // Check for the output options
+  int binary_stl = 0, weld = 0;
+  for (int k = 1; k < argc; k++) {
+    if (strcmp(argv[k], "--binary") == 0) {
+      binary_stl = 1;
+    } else if (strcmp(argv[k], "--weld") == 0) {
+      weld = 1;
+    }
+  }
+  const char *ext = (weld ? ".ply" : ".stl");
+
   // Loop over all of the input files
   for (int k = 1; k < argc; k++) {
+    if (strcmp(argv[k], "--binary") == 0 || strcmp(argv[k], "--weld") == 0) {
+      continue;
+    }
+
     char *infile = new char[strlen(argv[k]) + 1];
     strcpy(infile, argv[k]);
 
@@ -35,10 +55,14 @@ int main(int argc, char *argv[]) {
       i = len - 1;
     }
     strcpy(outfile, infile);
-    strcpy(&outfile[i], ".stl");
+    strcpy(&outfile[i], ext);
 
     if (strcmp(infile, outfile) != 0) {
-      TMR_ConvertBinToSTL(infile, outfile);
+      if (weld) {
+        TMR_ConvertBinToPLY(infile, outfile);
+      } else {
+        TMR_ConvertBinToSTL(infile, outfile, binary_stl);
+      }
     }
 
     delete[] infile;
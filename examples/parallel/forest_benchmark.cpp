@@ -0,0 +1,393 @@
+#include "TMROctForest.h"
+#include "TMRQuadForest.h"
+
+/*
+  Time the main parallel operations on a forest of quadtrees or
+  octrees built on a multi-block lattice connectivity.
+
+  The lattice consists of nx blocks (or faces) along the first
+  direction and n blocks along the remaining directions. For strong
+  scaling nx = n, while for weak scaling nx = n*nprocs so that the
+  work per processor is fixed. The input forest is one of:
+
+  uniform: all elements at the given level
+  random:  random elements up to two levels finer than the given level
+  graded:  uniform elements, refined in several passes towards the
+           corner of the lattice
+
+  The times for each phase are written to stdout from the root
+  processor as comma-separated values. The header is written with the
+  header argument.
+
+  Usage: ./forest_benchmark [header] [dim=3] [type=uniform]
+         [scaling=strong] [blocks=2] [level=3] [order=2] [seed=0]
+*/
+
+// The phases that are timed
+enum BenchmarkPhase {
+  CREATE_TREES,
+  REFINE,
+  BALANCE,
+  REPARTITION,
+  CREATE_NODES,
+  COARSEN,
+  CREATE_INTERPOLATION,
+  NUM_PHASES
+};
+
+static const char *phase_names[] = {"createTrees", "refine",
+                                    "balance",     "repartition",
+                                    "createNodes", "coarsen",
+                                    "createInterpolation"};
+
+// The number of passes used to create the graded forest
+static const int NUM_GRADED_PASSES = 3;
+
+/*
+  The options for the benchmark
+*/
+class BenchmarkOptions {
+ public:
+  BenchmarkOptions() {
+    dim = 3;
+    type = "uniform";
+    scaling = "strong";
+    blocks = 2;
+    level = 3;
+    order = 2;
+    seed = 0;
+  }
+
+  int dim;
+  const char *type;
+  const char *scaling;
+  int blocks, level, order, seed;
+};
+
+/*
+  Collect the times for each phase and write them out
+*/
+static void write_results(MPI_Comm comm, const BenchmarkOptions &opts,
+                          int nx, int nblocks, int nelems,
+                          const double times[]) {
+  int mpi_rank, mpi_size;
+  MPI_Comm_rank(comm, &mpi_rank);
+  MPI_Comm_size(comm, &mpi_size);
+
+  double tmin[NUM_PHASES], tmax[NUM_PHASES], tsum[NUM_PHASES];
+  MPI_Reduce(times, tmin, NUM_PHASES, MPI_DOUBLE, MPI_MIN, 0, comm);
+  MPI_Reduce(times, tmax, NUM_PHASES, MPI_DOUBLE, MPI_MAX, 0, comm);
+  MPI_Reduce(times, tsum, NUM_PHASES, MPI_DOUBLE, MPI_SUM, 0, comm);
+
+  int total = 0;
+  MPI_Reduce(&nelems, &total, 1, MPI_INT, MPI_SUM, 0, comm);
+
+  if (mpi_rank == 0) {
+    for (int k = 0; k < NUM_PHASES; k++) {
+      printf("%d,%s,%s,%d,%d,%d,%d,%d,%d,%s,%.6e,%.6e,%.6e\n", opts.dim,
+             opts.type, opts.scaling, mpi_size, nx, nblocks, opts.level,
+             opts.order, total, phase_names[k], tmin[k], tsum[k] / mpi_size,
+             tmax[k]);
+    }
+  }
+}
+
+/*
+  Compute the refinement towards the corner of the lattice. The
+  elements within the given distance of the corner, in units of the
+  block edge length, are refined by one level.
+*/
+static int refine_quadrant(const TMRQuadrant *quad, int nx, double dist) {
+  const double dh = 1.0 / (1 << TMR_MAX_LEVEL);
+  const int32_t h = 1 << (TMR_MAX_LEVEL - quad->level);
+  double u = quad->face % nx + dh * (quad->x + 0.5 * h);
+  double v = quad->face / nx + dh * (quad->y + 0.5 * h);
+  return (u * u + v * v < dist * dist ? 1 : 0);
+}
+
+static int refine_octant(const TMROctant *oct, int nx, int n, double dist) {
+  const double dh = 1.0 / (1 << TMR_MAX_LEVEL);
+  const int32_t h = 1 << (TMR_MAX_LEVEL - oct->level);
+  double u = oct->block % nx + dh * (oct->x + 0.5 * h);
+  double v = (oct->block / nx) % n + dh * (oct->y + 0.5 * h);
+  double w = oct->block / (nx * n) + dh * (oct->z + 0.5 * h);
+  return (u * u + v * v + w * w < dist * dist ? 1 : 0);
+}
+
+/*
+  Create the TACS interpolation between the fine and coarse forests
+*/
+template <class ForestType>
+static double time_interpolation(MPI_Comm comm, ForestType *fine,
+                                 ForestType *coarse) {
+  int fine_owned, coarse_owned;
+  fine->getNodeConn(NULL, NULL, &fine_owned);
+  coarse->getNodeConn(NULL, NULL, &coarse_owned);
+  TACSNodeMap *fine_map = new TACSNodeMap(comm, fine_owned);
+  TACSNodeMap *coarse_map = new TACSNodeMap(comm, coarse_owned);
+  TACSBVecInterp *interp = new TACSBVecInterp(coarse_map, fine_map, 1);
+  interp->incref();
+
+  MPI_Barrier(comm);
+  double t0 = MPI_Wtime();
+  fine->createInterpolation(coarse, interp);
+  double t = MPI_Wtime() - t0;
+
+  interp->decref();
+  return t;
+}
+
+/*
+  Run the benchmark on a forest of quadtrees
+*/
+static void run_quad_benchmark(MPI_Comm comm, const BenchmarkOptions &opts) {
+  int mpi_size;
+  MPI_Comm_size(comm, &mpi_size);
+
+  // Create the lattice of faces
+  const int n = opts.blocks;
+  const int nx = (strcmp(opts.scaling, "weak") == 0 ? n * mpi_size : n);
+  const int num_nodes = (nx + 1) * (n + 1);
+  const int num_faces = nx * n;
+  int *conn = new int[4 * num_faces];
+  for (int j = 0; j < n; j++) {
+    for (int i = 0; i < nx; i++) {
+      int *c = &conn[4 * (i + nx * j)];
+      c[0] = i + (nx + 1) * j;
+      c[1] = i + 1 + (nx + 1) * j;
+      c[2] = i + (nx + 1) * (j + 1);
+      c[3] = i + 1 + (nx + 1) * (j + 1);
+    }
+  }
+
+  double times[NUM_PHASES];
+  memset(times, 0, sizeof(times));
+
+  TMRQuadForest *forest = new TMRQuadForest(comm, opts.order);
+  forest->incref();
+  forest->setConnectivity(num_nodes, conn, num_faces);
+  delete[] conn;
+
+  MPI_Barrier(comm);
+  double t0 = MPI_Wtime();
+  if (strcmp(opts.type, "random") == 0) {
+    forest->createRandomTrees(10, 0, opts.level + 2);
+  } else {
+    forest->createTrees(opts.level);
+  }
+  times[CREATE_TREES] = MPI_Wtime() - t0;
+
+  MPI_Barrier(comm);
+  t0 = MPI_Wtime();
+  forest->repartition();
+  times[REPARTITION] += MPI_Wtime() - t0;
+
+  // Refine the forest towards the corner of the lattice
+  int npasses = (strcmp(opts.type, "graded") == 0 ? NUM_GRADED_PASSES : 1);
+  for (int pass = 0; pass < npasses; pass++) {
+    TMRQuadrantArray *quadrants;
+    TMRQuadrant *quads;
+    int size;
+    forest->getQuadrants(&quadrants);
+    quadrants->getArray(&quads, &size);
+    int *refine = new int[size];
+    double dist = 0.5 * n / (1 << pass);
+    for (int i = 0; i < size; i++) {
+      refine[i] = refine_quadrant(&quads[i], nx, dist);
+    }
+
+    MPI_Barrier(comm);
+    t0 = MPI_Wtime();
+    forest->refine(refine);
+    times[REFINE] += MPI_Wtime() - t0;
+    delete[] refine;
+  }
+
+  MPI_Barrier(comm);
+  t0 = MPI_Wtime();
+  forest->balance(1);
+  times[BALANCE] = MPI_Wtime() - t0;
+
+  MPI_Barrier(comm);
+  t0 = MPI_Wtime();
+  forest->repartition();
+  times[REPARTITION] += MPI_Wtime() - t0;
+
+  MPI_Barrier(comm);
+  t0 = MPI_Wtime();
+  forest->createNodes();
+  times[CREATE_NODES] = MPI_Wtime() - t0;
+
+  MPI_Barrier(comm);
+  t0 = MPI_Wtime();
+  TMRQuadForest *coarse = forest->coarsen();
+  times[COARSEN] = MPI_Wtime() - t0;
+  coarse->incref();
+  coarse->balance(1);
+  coarse->createNodes();
+
+  times[CREATE_INTERPOLATION] = time_interpolation(comm, forest, coarse);
+
+  int nelems;
+  forest->getNodeConn(NULL, &nelems);
+  write_results(comm, opts, nx, num_faces, nelems, times);
+
+  coarse->decref();
+  forest->decref();
+}
+
+/*
+  Run the benchmark on a forest of octrees
+*/
+static void run_oct_benchmark(MPI_Comm comm, const BenchmarkOptions &opts) {
+  int mpi_size;
+  MPI_Comm_size(comm, &mpi_size);
+
+  // Create the lattice of blocks
+  const int n = opts.blocks;
+  const int nx = (strcmp(opts.scaling, "weak") == 0 ? n * mpi_size : n);
+  const int num_nodes = (nx + 1) * (n + 1) * (n + 1);
+  const int num_blocks = nx * n * n;
+  int *conn = new int[8 * num_blocks];
+  for (int k = 0; k < n; k++) {
+    for (int j = 0; j < n; j++) {
+      for (int i = 0; i < nx; i++) {
+        int *c = &conn[8 * (i + nx * (j + n * k))];
+        for (int kk = 0; kk < 2; kk++) {
+          for (int jj = 0; jj < 2; jj++) {
+            for (int ii = 0; ii < 2; ii++) {
+              c[ii + 2 * jj + 4 * kk] =
+                  (i + ii) + (nx + 1) * ((j + jj) + (n + 1) * (k + kk));
+            }
+          }
+        }
+      }
+    }
+  }
+
+  double times[NUM_PHASES];
+  memset(times, 0, sizeof(times));
+
+  TMROctForest *forest = new TMROctForest(comm, opts.order);
+  forest->incref();
+  forest->setConnectivity(num_nodes, conn, num_blocks);
+  delete[] conn;
+
+  MPI_Barrier(comm);
+  double t0 = MPI_Wtime();
+  if (strcmp(opts.type, "random") == 0) {
+    forest->createRandomTrees(10, 0, opts.level + 2);
+  } else {
+    forest->createTrees(opts.level);
+  }
+  times[CREATE_TREES] = MPI_Wtime() - t0;
+
+  MPI_Barrier(comm);
+  t0 = MPI_Wtime();
+  forest->repartition();
+  times[REPARTITION] += MPI_Wtime() - t0;
+
+  // Refine the forest towards the corner of the lattice
+  int npasses = (strcmp(opts.type, "graded") == 0 ? NUM_GRADED_PASSES : 1);
+  for (int pass = 0; pass < npasses; pass++) {
+    TMROctantArray *octants;
+    TMROctant *octs;
+    int size;
+    forest->getOctants(&octants);
+    octants->getArray(&octs, &size);
+    int *refine = new int[size];
+    double dist = 0.5 * n / (1 << pass);
+    for (int i = 0; i < size; i++) {
+      refine[i] = refine_octant(&octs[i], nx, n, dist);
+    }
+
+    MPI_Barrier(comm);
+    t0 = MPI_Wtime();
+    forest->refine(refine);
+    times[REFINE] += MPI_Wtime() - t0;
+    delete[] refine;
+  }
+
+  MPI_Barrier(comm);
+  t0 = MPI_Wtime();
+  forest->balance(1);
+  times[BALANCE] = MPI_Wtime() - t0;
+
+  MPI_Barrier(comm);
+  t0 = MPI_Wtime();
+  forest->repartition();
+  times[REPARTITION] += MPI_Wtime() - t0;
+
+  MPI_Barrier(comm);
+  t0 = MPI_Wtime();
+  forest->createNodes();
+  times[CREATE_NODES] = MPI_Wtime() - t0;
+
+  MPI_Barrier(comm);
+  t0 = MPI_Wtime();
+  TMROctForest *coarse = forest->coarsen();
+  times[COARSEN] = MPI_Wtime() - t0;
+  coarse->incref();
+  coarse->balance(1);
+  coarse->createNodes();
+
+  times[CREATE_INTERPOLATION] = time_interpolation(comm, forest, coarse);
+
+  int nelems;
+  forest->getNodeConn(NULL, &nelems);
+  write_results(comm, opts, nx, num_blocks, nelems, times);
+
+  coarse->decref();
+  forest->decref();
+}
+
+int main(int argc, char *argv[]) {
+  MPI_Init(&argc, &argv);
+  TMRInitialize();
+
+  MPI_Comm comm = MPI_COMM_WORLD;
+  int mpi_rank;
+  MPI_Comm_rank(comm, &mpi_rank);
+
+  BenchmarkOptions opts;
+  int header = 0;
+  for (int k = 1; k < argc; k++) {
+    if (strcmp(argv[k], "header") == 0) {
+      header = 1;
+    } else if (strcmp(argv[k], "type=uniform") == 0 ||
+               strcmp(argv[k], "type=random") == 0 ||
+               strcmp(argv[k], "type=graded") == 0) {
+      opts.type = &argv[k][5];
+    } else if (strcmp(argv[k], "scaling=strong") == 0 ||
+               strcmp(argv[k], "scaling=weak") == 0) {
+      opts.scaling = &argv[k][8];
+    } else if (sscanf(argv[k], "dim=%d", &opts.dim) == 1) {
+    } else if (sscanf(argv[k], "blocks=%d", &opts.blocks) == 1) {
+    } else if (sscanf(argv[k], "level=%d", &opts.level) == 1) {
+    } else if (sscanf(argv[k], "order=%d", &opts.order) == 1) {
+    } else if (sscanf(argv[k], "seed=%d", &opts.seed) == 1) {
+    } else if (mpi_rank == 0) {
+      fprintf(stderr, "forest_benchmark: Unknown argument %s\n", argv[k]);
+    }
+  }
+
+  if (header) {
+    if (mpi_rank == 0) {
+      printf("dim,type,scaling,nprocs,nx,nblocks,level,order,nelems,");
+      printf("phase,tmin,tavg,tmax\n");
+    }
+  } else {
+    // Seed the random forests so that they are reproducible
+    srand(opts.seed + mpi_rank);
+
+    if (opts.dim == 2) {
+      run_quad_benchmark(comm, opts);
+    } else {
+      run_oct_benchmark(comm, opts);
+    }
+  }
+
+  TMRFinalize();
+  MPI_Finalize();
+  return 0;
+}
@@ -0,0 +1,97 @@
+#include "TMROctant.h"
+#include "TMRQuadrant.h"
+
+/*
+  Compare the radix sort used by TMROctantArray::sort() and
+  TMRQuadrantArray::sort() with the previous qsort-based ordering.
+
+  Usage: ./sort_benchmark [size]
+*/
+static int compare_octants(const void *a, const void *b) {
+  const TMROctant *ao = static_cast<const TMROctant *>(a);
+  const TMROctant *bo = static_cast<const TMROctant *>(b);
+  return ao->compare(bo);
+}
+
+static int compare_quadrants(const void *a, const void *b) {
+  const TMRQuadrant *ao = static_cast<const TMRQuadrant *>(a);
+  const TMRQuadrant *bo = static_cast<const TMRQuadrant *>(b);
+  return ao->compare(bo);
+}
+
+int main(int argc, char *argv[]) {
+  MPI_Init(&argc, &argv);
+  TMRInitialize();
+
+  int size = 1000000;
+  if (argc > 1) {
+    size = atoi(argv[1]);
+  }
+
+  // Create a random set of octants on several blocks
+  const int max_level = 12;
+  TMROctant *octs = new TMROctant[size];
+  TMROctant *octs_qsort = new TMROctant[size];
+  for (int i = 0; i < size; i++) {
+    octs[i].block = rand() % 8;
+    octs[i].level = 1 + rand() % max_level;
+    const int32_t h = 1 << (TMR_MAX_LEVEL - octs[i].level);
+    const int32_t n = 1 << octs[i].level;
+    octs[i].x = h * (rand() % n);
+    octs[i].y = h * (rand() % n);
+    octs[i].z = h * (rand() % n);
+    octs[i].tag = i;
+    octs[i].info = 0;
+    octs_qsort[i] = octs[i];
+  }
+
+  double t0 = MPI_Wtime();
+  qsort(octs_qsort, size, sizeof(TMROctant), compare_octants);
+  double t_qsort = MPI_Wtime() - t0;
+
+  TMROctantArray *oct_array = new TMROctantArray(octs, size);
+  t0 = MPI_Wtime();
+  oct_array->sort();
+  double t_radix = MPI_Wtime() - t0;
+
+  int sorted_size;
+  oct_array->getArray(&octs, &sorted_size);
+  printf("Octants:   %d entries qsort %12.6f s radix %12.6f s speedup %6.2f\n",
+         size, t_qsort, t_radix, t_qsort / t_radix);
+  delete oct_array;
+  delete[] octs_qsort;
+
+  // Create a random set of quadrants on several faces
+  TMRQuadrant *quads = new TMRQuadrant[size];
+  TMRQuadrant *quads_qsort = new TMRQuadrant[size];
+  for (int i = 0; i < size; i++) {
+    quads[i].face = rand() % 8;
+    quads[i].level = 1 + rand() % (2 * max_level);
+    const int32_t h = 1 << (TMR_MAX_LEVEL - quads[i].level);
+    const int32_t n = 1 << quads[i].level;
+    quads[i].x = h * (rand() % n);
+    quads[i].y = h * (rand() % n);
+    quads[i].tag = i;
+    quads[i].info = 0;
+    quads_qsort[i] = quads[i];
+  }
+
+  t0 = MPI_Wtime();
+  qsort(quads_qsort, size, sizeof(TMRQuadrant), compare_quadrants);
+  t_qsort = MPI_Wtime() - t0;
+
+  TMRQuadrantArray *quad_array = new TMRQuadrantArray(quads, size);
+  t0 = MPI_Wtime();
+  quad_array->sort();
+  t_radix = MPI_Wtime() - t0;
+
+  quad_array->getArray(&quads, &sorted_size);
+  printf("Quadrants: %d entries qsort %12.6f s radix %12.6f s speedup %6.2f\n",
+         size, t_qsort, t_radix, t_qsort / t_radix);
+  delete quad_array;
+  delete[] quads_qsort;
+
+  TMRFinalize();
+  MPI_Finalize();
+  return 0;
+}
@@ -0,0 +1,139 @@
+#include "TMRMesh.h"
+
+/*
+  Time the mesh topology functions used for the quad recombination,
+  the smoothing, the model creation and the BDF output on structured
+  meshes with a random node numbering.
+
+  Usage: ./topology_benchmark [size]
+
+  The quadrilateral and triangular meshes have size elements and the
+  hexahedral mesh has approximately size elements.
+*/
+static void shuffle(int n, int *perm) {
+  for (int i = 0; i < n; i++) {
+    perm[i] = i;
+  }
+  for (int i = n - 1; i > 0; i--) {
+    int j = rand() % (i + 1);
+    int tmp = perm[i];
+    perm[i] = perm[j];
+    perm[j] = tmp;
+  }
+}
+
+int main(int argc, char *argv[]) {
+  MPI_Init(&argc, &argv);
+  TMRInitialize();
+
+  int size = 1000000;
+  if (argc > 1) {
+    size = atoi(argv[1]);
+  }
+
+  // Create a structured quadrilateral mesh with about size elements
+  // and split each quadrilateral into two triangles
+  int n = (int)sqrt((double)size);
+  int nnodes = (n + 1) * (n + 1);
+  int nquads = n * n;
+  int *perm = new int[nnodes];
+  shuffle(nnodes, perm);
+  int *quads = new int[4 * nquads];
+  int *tris = new int[6 * nquads];
+  for (int j = 0; j < n; j++) {
+    for (int i = 0; i < n; i++) {
+      int q = i + n * j;
+      quads[4 * q] = perm[i + (n + 1) * j];
+      quads[4 * q + 1] = perm[i + 1 + (n + 1) * j];
+      quads[4 * q + 2] = perm[i + 1 + (n + 1) * (j + 1)];
+      quads[4 * q + 3] = perm[i + (n + 1) * (j + 1)];
+      tris[6 * q] = quads[4 * q];
+      tris[6 * q + 1] = quads[4 * q + 1];
+      tris[6 * q + 2] = quads[4 * q + 2];
+      tris[6 * q + 3] = quads[4 * q];
+      tris[6 * q + 4] = quads[4 * q + 2];
+      tris[6 * q + 5] = quads[4 * q + 3];
+    }
+  }
+  delete[] perm;
+
+  // The expected number of edges in the quadrilateral mesh
+  int expected = 2 * n * (n + 1);
+
+  double t0 = MPI_Wtime();
+  int *ptr, *node_to_elems;
+  TMR_ComputeNodeToElems(nnodes, nquads, 4, quads, &ptr, &node_to_elems);
+  printf("ComputeNodeToElems:          %8d quads %12.6f s\n", nquads,
+         MPI_Wtime() - t0);
+  delete[] ptr;
+  delete[] node_to_elems;
+
+  t0 = MPI_Wtime();
+  int num_edges, *edges, *neighbors, *dual_edges;
+  TMR_ComputePlanarTriEdges(nnodes, 2 * nquads, tris, &num_edges, &edges,
+                            &neighbors, &dual_edges);
+  printf("ComputePlanarTriEdges:       %8d tris  %12.6f s edges %d (%d)\n",
+         2 * nquads, MPI_Wtime() - t0, num_edges, expected + nquads);
+  delete[] edges;
+  delete[] neighbors;
+  delete[] dual_edges;
+
+  t0 = MPI_Wtime();
+  TMR_ComputePlanarQuadEdges(nnodes, nquads, quads, &num_edges, &edges,
+                             &neighbors, &dual_edges);
+  printf("ComputePlanarQuadEdges:      %8d quads %12.6f s edges %d (%d)\n",
+         nquads, MPI_Wtime() - t0, num_edges, expected);
+  delete[] edges;
+  delete[] neighbors;
+  delete[] dual_edges;
+
+  t0 = MPI_Wtime();
+  TMR_ComputeQuadEdges(nnodes, nquads, quads, &num_edges, &edges);
+  printf("ComputeQuadEdges:            %8d quads %12.6f s edges %d (%d)\n",
+         nquads, MPI_Wtime() - t0, num_edges, expected);
+  delete[] edges;
+  delete[] quads;
+  delete[] tris;
+
+  // Create a structured hexahedral mesh with about size elements
+  int m = (int)cbrt((double)size);
+  nnodes = (m + 1) * (m + 1) * (m + 1);
+  int nhex = m * m * m;
+  perm = new int[nnodes];
+  shuffle(nnodes, perm);
+  int *hex = new int[8 * nhex];
+  for (int k = 0; k < m; k++) {
+    for (int j = 0; j < m; j++) {
+      for (int i = 0; i < m; i++) {
+        int h = i + m * (j + m * k);
+        for (int c = 0; c < 8; c++) {
+          int ii = i + (((c + 1) / 2) % 2);
+          int jj = j + ((c / 2) % 2);
+          int kk = k + c / 4;
+          hex[8 * h + c] = perm[ii + (m + 1) * (jj + (m + 1) * kk)];
+        }
+      }
+    }
+  }
+  delete[] perm;
+
+  t0 = MPI_Wtime();
+  int num_hex_edges, num_hex_faces;
+  int *hex_edges, *hex_edge_nums, *hex_faces, *hex_face_nums;
+  TMR_ComputeHexEdgesAndFaces(nnodes, nhex, hex, &num_hex_edges, &hex_edges,
+                              &hex_edge_nums, &num_hex_faces, &hex_faces,
+                              &hex_face_nums);
+  printf("ComputeHexEdgesAndFaces:     %8d hex   %12.6f s edges %d (%d) "
+         "faces %d (%d)\n",
+         nhex, MPI_Wtime() - t0, num_hex_edges, 3 * m * (m + 1) * (m + 1),
+         num_hex_faces, 3 * m * m * (m + 1));
+  delete[] hex;
+  delete[] hex_edges;
+  delete[] hex_edge_nums;
+  delete[] hex_faces;
+  delete[] hex_face_nums;
+
+  TMRFinalize();
+  MPI_Finalize();
+  return 0;
+}
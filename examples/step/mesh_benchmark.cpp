@@ -0,0 +1,355 @@
+#include <math.h>
+
+#include "TMRBspline.h"
+#include "TMRFaceMesh.h"
+#include "TMRMesh.h"
+#include "TMRNativeTopology.h"
+
+#ifdef TMR_HAS_OPENCASCADE
+#include "TMROpenCascade.h"
+#endif  // TMR_HAS_OPENCASCADE
+
+/*
+  Measure the throughput and quality of the surface and volume mesher
+
+  Each model is meshed with the same fixed options and a target mesh
+  size that is a fraction of the diagonal of the model's bounding
+  box. The built-in model "sweep" consists of a row of twisted
+  hexagonal prisms that are meshed by sweeping, while any other model name is
+  loaded as a STEP file and only its surfaces are meshed.
+
+  The times for each phase and the element quality histogram are
+  written to stdout from the root processor as comma-separated
+  values.
+
+  Usage: ./mesh_benchmark [header] [h=0.02] [nblocks=4] [greedy]
+         [unstructured] [model=file.stp ...]
+*/
+
+// The number of bins used for the quality histogram
+static const int NUM_QUALITY_BINS = 10;
+
+/*
+  Create a linear edge between two vertices
+*/
+static TMREdge *create_line(TMRVertex *v1, TMRVertex *v2) {
+  TMRPoint pts[2];
+  v1->evalPoint(&pts[0]);
+  v2->evalPoint(&pts[1]);
+  TMREdge *edge = new TMREdgeFromCurve(new TMRBsplineCurve(2, 2, pts));
+  edge->setVertices(v1, v2);
+  return edge;
+}
+
+/*
+  Create a bilinear face bounded by a single loop of edges, where the
+  points are ordered (0, 0), (1, 0), (0, 1), (1, 1) in the parameter
+  space
+*/
+static TMRFace *create_face(const TMRPoint pts[], int nedges, TMREdge **edges,
+                            const int dir[]) {
+  TMRFace *face =
+      new TMRFaceFromSurface(new TMRBsplineSurface(2, 2, 2, 2, pts));
+  face->addEdgeLoop(1, new TMREdgeLoop(nedges, edges, dir));
+  return face;
+}
+
+/*
+  Create a row of twisted prisms with a polygonal cross-section. The
+  top face of each prism is the target of the bottom face so that the
+  polygonal faces are meshed with the unstructured mesher and each
+  volume is meshed by sweeping.
+*/
+static TMRModel *create_swept_model(int nblocks) {
+  const int ns = 6;
+  TMRVertex **verts = new TMRVertex *[2 * ns * nblocks];
+  TMREdge **edges = new TMREdge *[3 * ns * nblocks];
+  TMRFace **faces = new TMRFace *[(ns + 2) * nblocks];
+  TMRVolume **volumes = new TMRVolume *[nblocks];
+
+  for (int b = 0; b < nblocks; b++) {
+    // Set the locations of the bottom and the twisted top corners
+    const double xc = 3.0 * b;
+    const double height = 1.0 + 0.1 * b;
+    const double theta = 0.2 + 0.05 * b;
+    const double rtop = 1.2;
+    TMRPoint p[2 * ns];
+    for (int k = 0; k < ns; k++) {
+      double t = 2.0 * M_PI * k / ns;
+      p[k].x = xc + cos(t);
+      p[k].y = sin(t);
+      p[k].z = 0.0;
+      p[ns + k].x = xc + rtop * cos(t + theta);
+      p[ns + k].y = rtop * sin(t + theta);
+      p[ns + k].z = height;
+    }
+
+    TMRVertex **v = &verts[2 * ns * b];
+    for (int k = 0; k < 2 * ns; k++) {
+      v[k] = new TMRVertexFromPoint(p[k]);
+    }
+
+    // Create the bottom, top and vertical edges
+    TMREdge **e = &edges[3 * ns * b];
+    for (int k = 0; k < ns; k++) {
+      e[k] = create_line(v[k], v[(k + 1) % ns]);
+      e[ns + k] = create_line(v[ns + k], v[ns + (k + 1) % ns]);
+      e[2 * ns + k] = create_line(v[k], v[ns + k]);
+    }
+    for (int k = 0; k < ns; k++) {
+      e[ns + k]->setSource(e[k]);
+    }
+    for (int k = 1; k < ns; k++) {
+      e[2 * ns + k]->setSource(e[2 * ns]);
+    }
+
+    // Create the planar bottom and top faces
+    int dir[ns];
+    for (int k = 0; k < ns; k++) {
+      dir[k] = 1;
+    }
+    TMRFace **f = &faces[(ns + 2) * b];
+    TMRPoint q[4];
+    for (int k = 0; k < 4; k++) {
+      q[k].x = xc + rtop * (k % 2 == 0 ? -1.0 : 1.0);
+      q[k].y = rtop * (k < 2 ? -1.0 : 1.0);
+      q[k].z = 0.0;
+    }
+    f[0] = create_face(q, ns, &e[0], dir);
+    for (int k = 0; k < 4; k++) {
+      q[k].z = height;
+    }
+    f[1] = create_face(q, ns, &e[ns], dir);
+
+    // Create the ruled side faces
+    const int side_dir[] = {1, 1, -1, -1};
+    for (int k = 0; k < ns; k++) {
+      int k1 = (k + 1) % ns;
+      q[0] = p[k], q[1] = p[k1], q[2] = p[ns + k], q[3] = p[ns + k1];
+      TMREdge *side[4] = {e[k], e[2 * ns + k1], e[ns + k], e[2 * ns + k]};
+      f[2 + k] = create_face(q, 4, side, side_dir);
+    }
+
+    volumes[b] = new TMRVolume(ns + 2, f);
+    f[1]->setSource(volumes[b], f[0]);
+  }
+
+  TMRModel *model =
+      new TMRModel(2 * ns * nblocks, verts, 3 * ns * nblocks, edges,
+                   (ns + 2) * nblocks, faces, nblocks, volumes);
+
+  delete[] verts;
+  delete[] edges;
+  delete[] faces;
+  delete[] volumes;
+
+  return model;
+}
+
+/*
+  Load the surfaces of a model from a STEP file
+*/
+static TMRModel *load_surface_model(MPI_Comm comm, const char *filename) {
+#ifdef TMR_HAS_OPENCASCADE
+  TMRModel *geo = TMR_LoadModelFromSTEPFile(comm, filename, "MM");
+  if (!geo) {
+    return NULL;
+  }
+  geo->incref();
+
+  int num_verts, num_edges, num_faces;
+  TMRVertex **verts;
+  TMREdge **edges;
+  TMRFace **faces;
+  geo->getVertices(&num_verts, &verts);
+  geo->getEdges(&num_edges, &edges);
+  geo->getFaces(&num_faces, &faces);
+  TMRModel *model =
+      new TMRModel(num_verts, verts, num_edges, edges, num_faces, faces);
+  geo->decref();
+
+  return model;
+#else
+  fprintf(stderr,
+          "mesh_benchmark: Cannot load %s, TMR was compiled without "
+          "OpenCascade\n",
+          filename);
+  return NULL;
+#endif  // TMR_HAS_OPENCASCADE
+}
+
+/*
+  Compute the length of the diagonal of the bounding box of the model
+  vertices
+*/
+static double get_model_size(TMRModel *model) {
+  int num_verts;
+  TMRVertex **verts;
+  model->getVertices(&num_verts, &verts);
+
+  TMRPoint pmin, pmax;
+  for (int i = 0; i < num_verts; i++) {
+    TMRPoint pt;
+    verts[i]->evalPoint(&pt);
+    if (i == 0) {
+      pmin = pmax = pt;
+    } else {
+      pmin.x = (pt.x < pmin.x ? pt.x : pmin.x);
+      pmin.y = (pt.y < pmin.y ? pt.y : pmin.y);
+      pmin.z = (pt.z < pmin.z ? pt.z : pmin.z);
+      pmax.x = (pt.x > pmax.x ? pt.x : pmax.x);
+      pmax.y = (pt.y > pmax.y ? pt.y : pmax.y);
+      pmax.z = (pt.z > pmax.z ? pt.z : pmax.z);
+    }
+  }
+
+  double dx = pmax.x - pmin.x, dy = pmax.y - pmin.y, dz = pmax.z - pmin.z;
+  return sqrt(dx * dx + dy * dy + dz * dz);
+}
+
+/*
+  Mesh the model and write out the timing and quality results
+*/
+static void run_benchmark(MPI_Comm comm, const char *name, TMRModel *model,
+                          TMRMeshOptions options, double hfrac) {
+  int mpi_rank, mpi_size;
+  MPI_Comm_rank(comm, &mpi_rank);
+  MPI_Comm_size(comm, &mpi_size);
+
+  TMRMesh *mesh = new TMRMesh(comm, model);
+  mesh->incref();
+
+  double htarget = hfrac * get_model_size(model);
+  MPI_Barrier(comm);
+  mesh->mesh(options, htarget);
+
+  // The total time for each phase is the maximum over all
+  // processors, while the triangulation, recombination and smoothing
+  // are summed over the processors that meshed the faces
+  TMRMeshTimes times;
+  mesh->getMeshTimes(&times);
+  double t[7] = {times.edges,         times.faces,
+                 times.volumes,       times.total,
+                 times.triangulation, times.recombination,
+                 times.smoothing};
+  double tmax[7], tsum[7];
+  MPI_Reduce(t, tmax, 7, MPI_DOUBLE, MPI_MAX, 0, comm);
+  MPI_Reduce(t, tsum, 7, MPI_DOUBLE, MPI_SUM, 0, comm);
+
+  // Collect the quality of the face meshes that are not copies
+  int bins[NUM_QUALITY_BINS];
+  memset(bins, 0, NUM_QUALITY_BINS * sizeof(int));
+  int num_faces;
+  TMRFace **faces;
+  model->getFaces(&num_faces, &faces);
+  for (int i = 0; i < num_faces; i++) {
+    TMRFaceMesh *face_mesh = NULL;
+    faces[i]->getMesh(&face_mesh);
+    TMRFace *copy_face = NULL;
+    faces[i]->getCopySource(NULL, &copy_face);
+    if (face_mesh && !copy_face) {
+      face_mesh->addMeshQuality(NUM_QUALITY_BINS, bins);
+    }
+  }
+
+  // Retrieve the connectivity first so that the global mesh exists
+  int nquads, ntris, nhex;
+  mesh->getQuadConnectivity(&nquads, NULL);
+  mesh->getTriConnectivity(&ntris, NULL);
+  mesh->getHexConnectivity(&nhex, NULL);
+  int nnodes = mesh->getMeshPoints(NULL);
+
+  if (mpi_rank == 0) {
+    printf("%s,%d,%.4e,%d,%d,%d,%d", name, mpi_size, htarget, nnodes, nquads,
+           ntris, nhex);
+    printf(",%.6e,%.6e,%.6e,%.6e,%.6e,%.6e,%.6e", tmax[0], tmax[1], tsum[4],
+           tsum[5], tsum[6], tmax[2], tmax[3]);
+    for (int k = 0; k < NUM_QUALITY_BINS; k++) {
+      printf(",%d", bins[k]);
+    }
+    printf("\n");
+  }
+
+  mesh->decref();
+}
+
+int main(int argc, char *argv[]) {
+  MPI_Init(&argc, &argv);
+  TMRInitialize();
+
+  MPI_Comm comm = MPI_COMM_WORLD;
+  int mpi_rank;
+  MPI_Comm_rank(comm, &mpi_rank);
+
+  // The fixed meshing options
+  TMRMeshOptions options;
+  options.num_smoothing_steps = 10;
+  options.frontal_quality_factor = 1.25;
+
+  // The default set of models
+  const char *default_models[] = {
+      "sweep", "../crank/crank.stp", "../poisson/2d-disk.stp",
+      "../topology_optimization/lbracket/2d-bracket-fillet.stp"};
+  const int num_default_models = 4;
+
+  int header = 0;
+  double hfrac = 0.02;
+  int nblocks = 4;
+  int num_models = 0;
+  const char **models = new const char *[argc];
+  for (int k = 1; k < argc; k++) {
+    if (strcmp(argv[k], "header") == 0) {
+      header = 1;
+    } else if (strcmp(argv[k], "greedy") == 0) {
+      options.recombination_type = TMR_GREEDY_MATCHING;
+    } else if (strcmp(argv[k], "unstructured") == 0) {
+      options.mesh_type_default = TMR_UNSTRUCTURED;
+    } else if (strncmp(argv[k], "model=", 6) == 0) {
+      models[num_models] = &argv[k][6];
+      num_models++;
+    } else if (sscanf(argv[k], "h=%lf", &hfrac) == 1) {
+    } else if (sscanf(argv[k], "nblocks=%d", &nblocks) == 1) {
+    } else if (mpi_rank == 0) {
+      fprintf(stderr, "mesh_benchmark: Unknown argument %s\n", argv[k]);
+    }
+  }
+
+  if (header) {
+    if (mpi_rank == 0) {
+      printf("model,nprocs,h,nnodes,nquads,ntris,nhex,");
+      printf("edges,faces,triangulation,recombination,smoothing,volumes,");
+      printf("total");
+      for (int k = 0; k < NUM_QUALITY_BINS; k++) {
+        printf(",q<%.2f", 1.0 * (k + 1) / NUM_QUALITY_BINS);
+      }
+      printf("\n");
+    }
+  } else {
+    if (num_models == 0) {
+      for (; num_models < num_default_models; num_models++) {
+        models[num_models] = default_models[num_models];
+      }
+    }
+
+    for (int i = 0; i < num_models; i++) {
+      TMRModel *model = NULL;
+      if (strcmp(models[i], "sweep") == 0) {
+        model = create_swept_model(nblocks);
+      } else {
+        model = load_surface_model(comm, models[i]);
+      }
+
+      if (model) {
+        model->incref();
+        run_benchmark(comm, models[i], model, options, hfrac);
+        model->decref();
+      }
+    }
+  }
+
+  delete[] models;
+
+  TMRFinalize();
+  MPI_Finalize();
+  return 0;
+}
@@ -1202,8 +1202,7 @@ for step in range(2 * steps):
         # Evaluate the exiting element sizes
         h = np.zeros(Xpt.shape[0])
         if feature_size is not None:
-            for i in range(len(h)):
-                h[i] = feature_size.getFeatureSize(Xpt[i, :])
+            h[:] = feature_size.getFeatureSizes(np.ascontiguousarray(Xpt))
         else:
             h[:] = htarget
 
@@ -0,0 +1,223 @@
+"""
+Benchmark the cost of the topology optimization filters on the cantilever.
+
+This example builds the same multilevel cantilever problem as cantilever.py
+with each of the filter types and times:
+
+1) The construction of the filter and the topology optimization problem
+2) The filter operations setDesignVars, addValues, applyFilter and
+   applyTranspose
+3) A full evaluation of evalObjCon and evalObjConGradient
+
+Recommended arguments:
+
+mpirun -np n python filter_benchmark.py --filter all
+
+The times are the maximum over all processors and are written from the root
+processor as comma-separated values. The memory is the peak resident set size
+summed over all processors, together with the memory held by the finest
+filter forest. Since the peak resident set size only grows, each filter should
+be run in a separate process when the memory is of interest.
+
+Only the matrix and Helmholtz partition of unity (mfilter) filters implement
+applyFilter and applyTranspose; these times are left empty for the others.
+"""
+
+from mpi4py import MPI
+from tmr import TMR, TopOptUtils
+from tacs import constitutive, functions
+import argparse
+import resource
+
+from cantilever import CreatorCallback, create_forest
+
+# The filter types and whether they implement applyFilter/applyTranspose
+filter_types = {
+    "lagrange": False,
+    "conform": False,
+    "helmholtz": False,
+    "matrix": True,
+    "mfilter": True,
+}
+
+
+class MFilterCreator:
+    def __init__(self, r0, N):
+        self.r0 = r0
+        self.N = N
+
+    def filter_callback(self, assemblers, filters):
+        """
+        Create and initialize the Helmholtz partition of unity filter
+        """
+        mfilter = TopOptUtils.Mfilter(self.N, assemblers, filters, dim=3, r=self.r0)
+        mfilter.initialize()
+        return mfilter
+
+
+def timed(comm, func, nrepeat=1):
+    """
+    Return the maximum time over all processors for nrepeat calls to func
+    """
+    comm.Barrier()
+    t0 = MPI.Wtime()
+    for i in range(nrepeat):
+        func()
+    t = (MPI.Wtime() - t0) / nrepeat
+    return comm.allreduce(t, op=MPI.MAX)
+
+
+def create_problem(forest, bcs, props, nlevels, filter_type, r0, N):
+    """
+    Create the mass-constrained compliance problem from cantilever.py with the
+    given filter type
+    """
+    if filter_type == "mfilter":
+        filter_type = MFilterCreator(r0, N).filter_callback
+
+    obj = CreatorCallback(bcs, props)
+    problem = TopOptUtils.createTopoProblem(
+        forest,
+        obj.creator_callback,
+        filter_type,
+        use_galerkin=True,
+        nlevels=nlevels,
+        r0=r0,
+        N=N,
+    )
+    assembler = problem.getAssembler()
+
+    # Set the loads
+    P = 1.0e3
+    force = TopOptUtils.computeVertexLoad("pt1", forest, assembler, [0, P, 0])
+    temp = TopOptUtils.computeVertexLoad("pt2", forest, assembler, [0, 0, P])
+    force.axpy(1.0, temp)
+    problem.setLoadCases([force])
+
+    # Set the mass constraint and the compliance objective
+    density = 2600.0
+    m_fixed = 0.25 * (50.0 * 10.0 * 10.0 * density)
+    funcs = [functions.StructuralMass(assembler)]
+    problem.addConstraints(0, funcs, [-m_fixed], [-1.0 / m_fixed])
+    problem.setObjective([1.0e3])
+
+    problem.initialize()
+
+    return problem
+
+
+def run_benchmark(comm, filter_type, args, bcs, props):
+    """
+    Build the problem with the given filter and return the list of results
+    """
+    forest = create_forest(comm, args.nlevels - 1, htarget=args.htarget)
+
+    # Time the construction of the problem, including the filter
+    comm.Barrier()
+    t0 = MPI.Wtime()
+    problem = create_problem(
+        forest, bcs, props, args.nlevels, filter_type, args.r0, args.N
+    )
+    t_create = comm.allreduce(MPI.Wtime() - t0, op=MPI.MAX)
+
+    filtr = problem.getTopoFilter()
+    assembler = problem.getAssembler()
+
+    # Create the design vectors for the filter operations
+    x = assembler.createDesignVec()
+    y = assembler.createDesignVec()
+    x.setRand(0.1, 1.0)
+    ndv = comm.allreduce(x.getArray().shape[0], op=MPI.SUM)
+
+    t_set = timed(comm, lambda: filtr.setDesignVars(x), args.nrepeat)
+    t_add = timed(comm, lambda: filtr.addValues(y), args.nrepeat)
+    t_apply = ""
+    t_trans = ""
+    if filter_types[filter_type]:
+        t_apply = timed(comm, lambda: filtr.applyFilter(x, y), args.nrepeat)
+        t_trans = timed(comm, lambda: filtr.applyTranspose(x, y), args.nrepeat)
+
+    # Time the full function and gradient evaluation
+    xp = problem.createDesignVec()
+    xp.getArray()[:] = 0.25
+    g = problem.createDesignVec()
+    A = [problem.createDesignVec()]
+    t_obj = timed(comm, lambda: problem.evalObjCon(1, xp))
+    t_grad = timed(comm, lambda: problem.evalObjConGradient(xp, g, A))
+
+    # Find the memory held by the arrays of the finest forest, without the
+    # peak transients, and the peak memory
+    usage = filtr.getFilter().getMemoryUsage()
+    forest_bytes = sum(entry[3] for entry in usage.values() if not entry[4])
+    rss = 1024.0 * resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+    rss = comm.allreduce(rss, op=MPI.SUM)
+
+    return [
+        filter_type,
+        comm.size,
+        args.nlevels,
+        ndv,
+        t_create,
+        t_set,
+        t_add,
+        t_apply,
+        t_trans,
+        t_obj,
+        t_grad,
+        forest_bytes,
+        rss,
+    ]
+
+
+if __name__ == "__main__":
+    p = argparse.ArgumentParser()
+    p.add_argument(
+        "--filter", type=str, default="all", choices=["all"] + list(filter_types)
+    )
+    p.add_argument("--nlevels", type=int, default=4)
+    p.add_argument("--htarget", type=float, default=5.0)
+    p.add_argument("--r0", type=float, default=0.5)
+    p.add_argument("--N", type=int, default=20)
+    p.add_argument("--nrepeat", type=int, default=10)
+    p.add_argument("--header", action="store_true", default=False)
+    args = p.parse_args()
+
+    comm = MPI.COMM_WORLD
+
+    header = [
+        "filter",
+        "nprocs",
+        "nlevels",
+        "ndv",
+        "create",
+        "setDesignVars",
+        "addValues",
+        "applyFilter",
+        "applyTranspose",
+        "evalObjCon",
+        "evalObjConGradient",
+        "forest_bytes",
+        "peak_rss_bytes",
+    ]
+    if args.header and comm.rank == 0:
+        print(",".join(header))
+
+    # Set the boundary conditions and material properties
+    bcs = TMR.BoundaryConditions()
+    bcs.addBoundaryCondition("fixed")
+    material_properties = constitutive.MaterialProperties(
+        rho=2600.0, E=70e9, nu=0.3, ys=350e6
+    )
+    props = TMR.StiffnessProperties(material_properties, q=8.0)
+
+    filters = list(filter_types) if args.filter == "all" else [args.filter]
+    for filter_type in filters:
+        result = run_benchmark(comm, filter_type, args, bcs, props)
+        if comm.rank == 0:
+            line = []
+            for value in result:
+                if isinstance(value, float):
+                    line.append("%.6e" % (value))
+                else:
+                    line.append(str(value))
+            print(",".join(line))
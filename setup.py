@@ -104,6 +104,41 @@ if "egads4py" in sys.modules:
     libs.extend(egads4py_libs)
     runtime_lib_dirs.extend(egads4py_lib_dirs)
 
+# Add the CUDA or HIP runtime when TMR is built with TMR_USE_CUDA = 1
+# or TMR_USE_HIP = 1. The library flags are taken from CUDA_LD_FLAGS or
+# HIP_LD_FLAGS, as set in Makefile.in.
+define_macros = [
+    ("math_Memory_HeaderFile", "1"),
+    ("TMR_HAS_OPENCASCADE", "1"),
+    ("TMR_HAS_EGADS", "1"),
+    ("TMR_HAS_PAROPT", "1"),
+]
+
+
+def add_device_flags(ld_flags, default_dir, lib, macro):
+    for flag in ld_flags.split():
+        if flag[:2] == "-L":
+            lib_dirs.append(flag[2:])
+            runtime_lib_dirs.append(flag[2:])
+    if not ld_flags:
+        lib_dirs.append(default_dir)
+        runtime_lib_dirs.append(default_dir)
+    libs.append(lib)
+    define_macros.append((macro, "1"))
+
+
+if os.environ.get("TMR_USE_CUDA") == "1":
+    add_device_flags(
+        os.environ.get("CUDA_LD_FLAGS", ""),
+        "/usr/local/cuda/lib64",
+        "cudart",
+        "TMR_HAS_CUDA",
+    )
+elif os.environ.get("TMR_USE_HIP") == "1":
+    add_device_flags(
+        os.environ.get("HIP_LD_FLAGS", ""), "/opt/rocm/lib", "amdhip64", "TMR_HAS_HIP"
+    )
+
 exts = []
 mod = "TMR"
 exts.append(
@@ -116,12 +151,7 @@ exts.append(
         runtime_library_dirs=runtime_lib_dirs,
         extra_compile_args=["-std=c++11"],
         extra_link_args=["-std=c++11"],
-        define_macros=[
-            ("math_Memory_HeaderFile", "1"),
-            ("TMR_HAS_OPENCASCADE", "1"),
-            ("TMR_HAS_EGADS", "1"),
-            ("TMR_HAS_PAROPT", "1"),
-        ],
+        define_macros=define_macros,
     )
 )
 
@@ -0,0 +1,409 @@
+/*
+  This file is part of the package TMR for adaptive mesh refinement.
+
+  Copyright (C) 2015 Georgia Tech Research Corporation.
+  Additional copyright (C) 2015 Graeme Kennedy.
+  All rights reserved.
+
+  TMR is licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this software except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include "TMRAgglomeratedPc.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "tmrlapack.h"
+
+/*
+  Check whether the problem is small enough to be stored as a dense
+  matrix on each solve processor
+
+  input:
+  assembler:  the assembler object for the matrix
+
+  returns:    1 if the number of unknowns is at most MAX_DENSE_SIZE
+*/
+int TMRAgglomeratedPc::isSizeSupported(TACSAssembler *assembler) {
+  int mpi_size;
+  MPI_Comm_size(assembler->getMPIComm(), &mpi_size);
+
+  const int *range;
+  assembler->getNodeMap()->getOwnerRange(&range);
+  long int num_vars = (long int)assembler->getVarsPerNode() * range[mpi_size];
+
+  return (num_vars <= MAX_DENSE_SIZE);
+}
+
+/*
+  Create the agglomerated direct solver
+
+  input:
+  assembler:        the assembler object for the matrix
+  mat:              the matrix
+  num_solve_procs:  the number of solve processors (one per shared
+                    memory node when num_solve_procs <= 0)
+
+  The dense matrix requires 8*size*size bytes on each solve processor,
+  so the problem should pass isSizeSupported(). The factorization is
+  real-valued, so the solver should not be used in a complex build.
+*/
+TMRAgglomeratedPc::TMRAgglomeratedPc(TACSAssembler *assembler,
+                                     TACSParallelMat *_mat,
+                                     int num_solve_procs) {
+  mat = _mat;
+  mat->incref();
+
+  comm = assembler->getMPIComm();
+  MPI_Comm_rank(comm, &mpi_rank);
+  MPI_Comm_size(comm, &mpi_size);
+
+#ifdef TACS_USE_COMPLEX
+  // The matrix and right-hand-side are copied to real values for the
+  // LAPACK factorization, so the imaginary parts would be lost
+  if (mpi_rank == 0) {
+    fprintf(stderr,
+            "TMRAgglomeratedPc Warning: The dense factorization is "
+            "real-valued and discards the imaginary parts in complex "
+            "builds\n");
+  }
+#endif  // TACS_USE_COMPLEX
+
+  mat->getRowMap(&bsize, &nrows, &ncoupling);
+
+  // Copy the ownership range of the block rows
+  const int *range;
+  assembler->getNodeMap()->getOwnerRange(&range);
+  owner_range = new int[mpi_size + 1];
+  memcpy(owner_range, range, (mpi_size + 1) * sizeof(int));
+  num_global_rows = owner_range[mpi_size];
+
+  // Split the processors into groups, each with one solve processor
+  if (num_solve_procs > 0) {
+    int color = (int)(((long int)mpi_rank * num_solve_procs) / mpi_size);
+    MPI_Comm_split(comm, color, mpi_rank, &group_comm);
+  } else {
+    MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, mpi_rank, MPI_INFO_NULL,
+                        &group_comm);
+  }
+
+  int group_rank;
+  MPI_Comm_rank(group_comm, &group_rank);
+  is_solver = (group_rank == 0);
+  MPI_Comm_split(comm, (is_solver ? 0 : MPI_UNDEFINED), mpi_rank,
+                 &solve_comm);
+
+  group_size = 0;
+  group_counts = group_ptr = group_offset = NULL;
+  num_solvers = 0;
+  solve_counts = solve_ptr = solve_order = NULL;
+  size = bsize * num_global_rows;
+  A = rhs = group_rhs = solve_rhs = NULL;
+  ipiv = NULL;
+  xlocal = new double[bsize * nrows > 0 ? bsize * nrows : 1];
+
+  // Gather the ranks in each group onto the solve processor
+  int *group_ranks = NULL;
+  if (is_solver) {
+    MPI_Comm_size(group_comm, &group_size);
+    group_ranks = new int[group_size];
+  }
+  MPI_Gather(&mpi_rank, 1, MPI_INT, group_ranks, 1, MPI_INT, 0, group_comm);
+
+  if (is_solver) {
+    // Set the number and location of the vector entries from each
+    // processor in the group
+    group_counts = new int[group_size];
+    group_ptr = new int[group_size + 1];
+    group_offset = new int[group_size];
+    group_ptr[0] = 0;
+    for (int i = 0; i < group_size; i++) {
+      int rank = group_ranks[i];
+      group_counts[i] = bsize * (owner_range[rank + 1] - owner_range[rank]);
+      group_ptr[i + 1] = group_ptr[i] + group_counts[i];
+      group_offset[i] = bsize * owner_range[rank];
+    }
+
+    // Find the order of the ranks gathered from all the groups
+    MPI_Comm_size(solve_comm, &num_solvers);
+    int *sizes = new int[num_solvers];
+    int *sizes_ptr = new int[num_solvers + 1];
+    MPI_Allgather(&group_size, 1, MPI_INT, sizes, 1, MPI_INT, solve_comm);
+    sizes_ptr[0] = 0;
+    for (int i = 0; i < num_solvers; i++) {
+      sizes_ptr[i + 1] = sizes_ptr[i] + sizes[i];
+    }
+    solve_order = new int[mpi_size];
+    MPI_Allgatherv(group_ranks, group_size, MPI_INT, solve_order, sizes,
+                   sizes_ptr, MPI_INT, solve_comm);
+
+    solve_counts = new int[num_solvers];
+    solve_ptr = new int[num_solvers + 1];
+    solve_ptr[0] = 0;
+    for (int i = 0; i < num_solvers; i++) {
+      solve_counts[i] = 0;
+      for (int j = sizes_ptr[i]; j < sizes_ptr[i + 1]; j++) {
+        int rank = solve_order[j];
+        solve_counts[i] += bsize * (owner_range[rank + 1] - owner_range[rank]);
+      }
+      solve_ptr[i + 1] = solve_ptr[i] + solve_counts[i];
+    }
+    delete[] sizes;
+    delete[] sizes_ptr;
+
+    // Allocate the dense matrix and the vectors
+    A = new double[(size_t)size * size];
+    ipiv = new int[size > 0 ? size : 1];
+    rhs = new double[size > 0 ? size : 1];
+    group_rhs = new double[group_ptr[group_size] > 0 ? group_ptr[group_size]
+                                                     : 1];
+    solve_rhs = new double[size > 0 ? size : 1];
+  }
+
+  if (group_ranks) {
+    delete[] group_ranks;
+  }
+}
+
+/*
+  Free the solver
+*/
+TMRAgglomeratedPc::~TMRAgglomeratedPc() {
+  mat->decref();
+  delete[] owner_range;
+  delete[] xlocal;
+  if (is_solver) {
+    delete[] group_counts;
+    delete[] group_ptr;
+    delete[] group_offset;
+    delete[] solve_counts;
+    delete[] solve_ptr;
+    delete[] solve_order;
+    delete[] A;
+    delete[] ipiv;
+    delete[] rhs;
+    delete[] group_rhs;
+    delete[] solve_rhs;
+    MPI_Comm_free(&solve_comm);
+  }
+  MPI_Comm_free(&group_comm);
+}
+
+/*
+  Gather entries from all processors onto all of the solve processors
+
+  The entries from each group are gathered onto the solve processor,
+  and then the entries from all groups are gathered onto all the solve
+  processors. The entries are in the order given by solve_order.
+
+  input:
+  count:   the number of local entries
+  type:    the MPI data type of the entries
+  local:   the local entries
+
+  output:
+  global:  the gathered entries (allocated on the solve processors)
+
+  returns: the number of gathered entries on the solve processors
+*/
+int TMRAgglomeratedPc::gatherToSolvers(int count, MPI_Datatype type,
+                                       const void *local, char **global) {
+  int type_size;
+  MPI_Type_size(type, &type_size);
+
+  // Gather the entries onto the solve processor in each group
+  int *counts = NULL, *ptr = NULL;
+  if (is_solver) {
+    counts = new int[group_size];
+    ptr = new int[group_size + 1];
+  }
+  MPI_Gather(&count, 1, MPI_INT, counts, 1, MPI_INT, 0, group_comm);
+
+  char *group = NULL;
+  if (is_solver) {
+    ptr[0] = 0;
+    for (int i = 0; i < group_size; i++) {
+      ptr[i + 1] = ptr[i] + counts[i];
+    }
+    group = new char[(size_t)type_size * ptr[group_size] + 1];
+  }
+  MPI_Gatherv(local, count, type, group, counts, ptr, type, 0, group_comm);
+
+  // Gather the entries from all groups onto the solve processors
+  int total = 0;
+  if (is_solver) {
+    int group_total = ptr[group_size];
+    int *scounts = new int[num_solvers];
+    int *sptr = new int[num_solvers + 1];
+    MPI_Allgather(&group_total, 1, MPI_INT, scounts, 1, MPI_INT, solve_comm);
+    sptr[0] = 0;
+    for (int i = 0; i < num_solvers; i++) {
+      sptr[i + 1] = sptr[i] + scounts[i];
+    }
+    total = sptr[num_solvers];
+
+    *global = new char[(size_t)type_size * total + 1];
+    MPI_Allgatherv(group, group_total, type, *global, scounts, sptr, type,
+                   solve_comm);
+
+    delete[] scounts;
+    delete[] sptr;
+    delete[] counts;
+    delete[] ptr;
+    delete[] group;
+  }
+
+  return total;
+}
+
+/*
+  Gather the matrix onto the solve processors and factor it
+*/
+void TMRAgglomeratedPc::factor() {
+  const int b2 = bsize * bsize;
+
+  // Get the local and external parts of the matrix
+  BCSRMat *Aloc, *Bext;
+  mat->getBCSRMat(&Aloc, &Bext);
+
+  const int *rowp, *cols;
+  TacsScalar *Avals;
+  Aloc->getArrays(NULL, NULL, NULL, &rowp, &cols, &Avals);
+
+  const int *browp, *bcols;
+  TacsScalar *Bvals;
+  Bext->getArrays(NULL, NULL, NULL, &browp, &bcols, &Bvals);
+
+  // Get the global indices of the external columns
+  TACSBVecDistribute *ext_dist;
+  mat->getExtColMap(&ext_dist);
+  const int *col_vars;
+  ext_dist->getIndices()->getIndices(&col_vars);
+
+  // Pack the global block indices and values of the local blocks
+  int nblocks = rowp[nrows] + browp[ncoupling];
+  int *index = new int[2 * nblocks + 1];
+  double *values = new double[b2 * nblocks + 1];
+
+  int k = 0;
+  for (int i = 0; i < nrows; i++) {
+    for (int jp = rowp[i]; jp < rowp[i + 1]; jp++, k++) {
+      index[2 * k] = i + owner_range[mpi_rank];
+      index[2 * k + 1] = cols[jp] + owner_range[mpi_rank];
+      for (int j = 0; j < b2; j++) {
+        values[b2 * k + j] = TacsRealPart(Avals[b2 * jp + j]);
+      }
+    }
+  }
+  for (int ib = 0; ib < ncoupling; ib++) {
+    int i = nrows - ncoupling + ib;
+    for (int jp = browp[ib]; jp < browp[ib + 1]; jp++, k++) {
+      index[2 * k] = i + owner_range[mpi_rank];
+      index[2 * k + 1] = col_vars[bcols[jp]];
+      for (int j = 0; j < b2; j++) {
+        values[b2 * k + j] = TacsRealPart(Bvals[b2 * jp + j]);
+      }
+    }
+  }
+
+  // Gather all the blocks onto the solve processors
+  char *all_index = NULL, *all_values = NULL;
+  int nindex = gatherToSolvers(2 * nblocks, MPI_INT, index, &all_index);
+  gatherToSolvers(b2 * nblocks, MPI_DOUBLE, values, &all_values);
+  delete[] index;
+  delete[] values;
+
+  if (is_solver) {
+    // Add the blocks to the dense matrix stored in column-major order
+    const int *gindex = (const int *)all_index;
+    const double *gvalues = (const double *)all_values;
+    memset(A, 0, (size_t)size * size * sizeof(double));
+    for (int n = 0; n < nindex / 2; n++) {
+      int row = bsize * gindex[2 * n];
+      int col = bsize * gindex[2 * n + 1];
+      const double *v = &gvalues[b2 * n];
+      for (int ii = 0; ii < bsize; ii++) {
+        for (int jj = 0; jj < bsize; jj++) {
+          A[(size_t)size * (col + jj) + row + ii] += v[bsize * ii + jj];
+        }
+      }
+    }
+    delete[] all_index;
+    delete[] all_values;
+
+    // Factor the matrix
+    int info = 0;
+    if (size > 0) {
+      TmrLAPACKdgetrf(&size, &size, A, &size, ipiv, &info);
+    }
+    if (info != 0) {
+      fprintf(stderr,
+              "TMRAgglomeratedPc Error: LAPACK dgetrf failed with info = %d\n",
+              info);
+    }
+  }
+}
+
+/*
+  Apply the factorization to compute y = A^{-1}*x
+*/
+void TMRAgglomeratedPc::applyFactor(TACSVec *xvec, TACSVec *yvec) {
+  TACSBVec *x = dynamic_cast<TACSBVec *>(xvec);
+  TACSBVec *y = dynamic_cast<TACSBVec *>(yvec);
+  if (!x || !y) {
+    fprintf(stderr, "TMRAgglomeratedPc Error: Vector type must be TACSBVec\n");
+    return;
+  }
+
+  TacsScalar *xvals, *yvals;
+  int local_size = x->getArray(&xvals);
+  y->getArray(&yvals);
+  for (int i = 0; i < local_size; i++) {
+    xlocal[i] = TacsRealPart(xvals[i]);
+  }
+
+  // Gather the right-hand-side onto the solve processors
+  MPI_Gatherv(xlocal, local_size, MPI_DOUBLE, group_rhs, group_counts,
+              group_ptr, MPI_DOUBLE, 0, group_comm);
+
+  if (is_solver) {
+    MPI_Allgatherv(group_rhs, group_ptr[group_size], MPI_DOUBLE, solve_rhs,
+                   solve_counts, solve_ptr, MPI_DOUBLE, solve_comm);
+
+    // Place the entries in the global order and solve
+    for (int i = 0, offset = 0; i < mpi_size; i++) {
+      int rank = solve_order[i];
+      int count = bsize * (owner_range[rank + 1] - owner_range[rank]);
+      memcpy(&rhs[bsize * owner_range[rank]], &solve_rhs[offset],
+             count * sizeof(double));
+      offset += count;
+    }
+
+    int nrhs = 1, info = 0;
+    if (size > 0) {
+      TmrLAPACKdgetrs("N", &size, &nrhs, A, &size, ipiv, rhs, &size, &info);
+    }
+  }
+
+  // Scatter the solution back to the processors in each group
+  MPI_Scatterv(rhs, group_counts, group_offset, MPI_DOUBLE, xlocal,
+               local_size, MPI_DOUBLE, 0, group_comm);
+  for (int i = 0; i < local_size; i++) {
+    yvals[i] = xlocal[i];
+  }
+}
+
+/*
+  Get the matrix associated with the solver
+*/
+void TMRAgglomeratedPc::getMat(TACSMat **_mat) { *_mat = mat; }
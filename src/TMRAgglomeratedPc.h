@@ -0,0 +1,113 @@
+/*
+  This file is part of the package TMR for adaptive mesh refinement.
+
+  Copyright (C) 2015 Georgia Tech Research Corporation.
+  Additional copyright (C) 2015 Graeme Kennedy.
+  All rights reserved.
+
+  TMR is licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this software except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef TMR_AGGLOMERATED_PC_H
+#define TMR_AGGLOMERATED_PC_H
+
+#include "KSM.h"
+#include "TACSAssembler.h"
+#include "TACSParallelMat.h"
+
+/*
+  A direct solver for a small, distributed coarse-grid matrix
+
+  The processors are split into groups and the first processor in
+  each group is a solve processor. The matrix is gathered onto all the
+  solve processors, where it is stored as a dense matrix and factored
+  with LAPACK. To apply the factorization, the right-hand-side is
+  gathered onto the solve processors, each solve processor computes
+  the solution redundantly and then scatters it back to the
+  processors in its group. This replaces the latency-bound parallel
+  factorization and triangular solves with two collective operations
+  on small messages.
+
+  The groups are either the processors that share a node (one solve
+  processor per node) or num_solve_procs contiguous blocks of ranks.
+  Since the matrix is stored as a dense matrix on each solve
+  processor, this is only intended for the coarsest level of a
+  multigrid hierarchy with at most a few thousand unknowns. Use
+  isSizeSupported() to check that the problem has no more than
+  MAX_DENSE_SIZE unknowns before creating the solver.
+
+  The matrix and right-hand-side are copied to double precision for
+  the LAPACK factorization, so the solver is not intended for complex
+  builds (TACS_USE_COMPLEX), where it would discard the imaginary
+  parts. TMR_CreateTACSMg uses the parallel direct solve instead in
+  complex builds.
+*/
+class TMRAgglomeratedPc : public TACSPc {
+ public:
+  TMRAgglomeratedPc(TACSAssembler *assembler, TACSParallelMat *_mat,
+                    int num_solve_procs = -1);
+  ~TMRAgglomeratedPc();
+
+  // Gather and factor the matrix
+  void factor();
+
+  // Apply the factorization y = A^{-1}*x
+  void applyFactor(TACSVec *xvec, TACSVec *yvec);
+
+  // Get the matrix
+  void getMat(TACSMat **_mat);
+
+  // Check whether the problem is small enough for the dense solve
+  static int isSizeSupported(TACSAssembler *assembler);
+
+  // The maximum number of unknowns in the dense matrix
+  static const int MAX_DENSE_SIZE = 4096;
+
+ private:
+  // Gather the local entries from each processor onto all the solve
+  // processors in the solve order
+  int gatherToSolvers(int count, MPI_Datatype type, const void *local,
+                      char **global);
+
+  // The matrix and the communicators
+  TACSParallelMat *mat;
+  MPI_Comm comm, group_comm, solve_comm;
+  int mpi_rank, mpi_size, is_solver;
+
+  // The block size and the number of local and global block rows
+  int bsize, nrows, ncoupling, num_global_rows;
+
+  // The range of block rows owned by each processor
+  int *owner_range;
+
+  // The following data is only stored on the solve processors:
+  // The number of vector entries on each processor in the group, and
+  // their offsets in the gathered and in the global vector
+  int group_size;
+  int *group_counts, *group_ptr, *group_offset;
+
+  // The number of vector entries gathered from each group and the
+  // ranks in the order that their entries are gathered
+  int num_solvers;
+  int *solve_counts, *solve_ptr, *solve_order;
+
+  // The factored dense matrix and the vectors
+  int size;
+  double *A, *rhs, *group_rhs, *solve_rhs;
+  int *ipiv;
+
+  // The local vector entries
+  double *xlocal;
+};
+
+#endif  // TMR_AGGLOMERATED_PC_H
@@ -21,10 +21,17 @@
 #include "TMRBase.h"
 
 #include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "TMROctant.h"
 #include "TMRQuadrant.h"
+#include "TMRTrace.h"
+
+#ifdef TMR_HAS_OPENMP
+#include <omp.h>
+#endif  // TMR_HAS_OPENMP
 
 // Static flag to test if TMR is initialized or not
 static int TMR_is_initialized = 0;
@@ -36,10 +43,29 @@ MPI_Datatype TMRPoint_MPI_type;
 MPI_Datatype TMRIndexWeight_MPI_type;
 MPI_Datatype TMR_STLTriangle_MPI_type;
 
+// The attribute key for the number of count exchanges on a communicator
+static int TMR_exchange_keyval = MPI_KEYVAL_INVALID;
+
+/*
+  Free the exchange counter attached to a communicator
+*/
+static int TMRFreeExchangeCounter(MPI_Comm comm, int keyval, void *attr,
+                                  void *extra_state) {
+  delete[] (int *)attr;
+  return MPI_SUCCESS;
+}
+
 /*
-  Initialize TMR data type
+  Initialize TMR data type and start the trace, if requested
 */
-void TMRInitialize() {
+void TMRInitialize(const char *trace_file) {
+  if (!trace_file) {
+    trace_file = getenv("TMR_TRACE");
+  }
+  if (trace_file) {
+    TMRTraceInitialize(trace_file);
+  }
+
   if (!TMR_is_initialized) {
     int counts[2];
     MPI_Aint offset[2];
@@ -86,6 +112,10 @@ void TMRInitialize() {
                            &TMR_STLTriangle_MPI_type);
     MPI_Type_commit(&TMR_STLTriangle_MPI_type);
 
+    // Create the key for the exchange counter attached to communicators
+    MPI_Comm_create_keyval(MPI_COMM_NULL_COPY_FN, TMRFreeExchangeCounter,
+                           &TMR_exchange_keyval, NULL);
+
     // Set the TMR initialization flag
     TMR_is_initialized = 1;
   }
@@ -97,18 +127,185 @@ void TMRInitialize() {
 int TMRIsInitialized() { return TMR_is_initialized; }
 
 /*
-  Finalize the TMR data type
+  Finalize the TMR data type and write the trace, if it is active
 */
 void TMRFinalize() {
+  TMRTraceFinalize();
   MPI_Type_free(&TMROctant_MPI_type);
   MPI_Type_free(&TMRQuadrant_MPI_type);
   MPI_Type_free(&TMRPoint_MPI_type);
   MPI_Type_free(&TMRIndexWeight_MPI_type);
   MPI_Type_free(&TMR_STLTriangle_MPI_type);
+  MPI_Comm_free_keyval(&TMR_exchange_keyval);
 }
 
-TMREntity::TMREntity() : entity_id(entity_id_count) {
-  entity_id_count++;
+/*
+  Exchange the number of entries that each processor will send to
+  every other processor
+
+  This produces the same result as an MPI_Alltoall of the counts, but
+  only the processors that exchange data communicate. Each processor
+  posts a synchronous send of its count to each processor that it will
+  send data to, and receives the counts from the other processors as
+  they arrive. Once all of its sends have been matched, the processor
+  enters a non-blocking barrier. When the barrier completes, all of
+  the counts have been received. This is the non-blocking consensus
+  algorithm of Hoefler et al.
+
+  A processor may leave the barrier and start the next exchange while
+  another is still receiving. The tag therefore alternates between
+  consecutive exchanges on the same communicator, using a counter
+  attached to the communicator.
+
+  input:
+  comm:         the communicator
+  send_counts:  the number of entries sent to each processor
+
+  output:
+  recv_counts:  the number of entries received from each processor
+*/
+void TMRExchangeCounts(MPI_Comm comm, const int *send_counts,
+                       int *recv_counts) {
+  int mpi_rank, mpi_size;
+  MPI_Comm_rank(comm, &mpi_rank);
+  MPI_Comm_size(comm, &mpi_size);
+
+  // Retrieve or create the exchange counter for this communicator
+  int *counter, flag;
+  MPI_Comm_get_attr(comm, TMR_exchange_keyval, &counter, &flag);
+  if (!flag) {
+    counter = new int[1];
+    counter[0] = 0;
+    MPI_Comm_set_attr(comm, TMR_exchange_keyval, counter);
+  }
+  const int tag = 23 + (counter[0] % 2);
+  counter[0]++;
+
+  memset(recv_counts, 0, mpi_size * sizeof(int));
+  recv_counts[mpi_rank] = send_counts[mpi_rank];
+
+  // Post the synchronous sends to the processors with data
+  int nsends = 0;
+  for (int i = 0; i < mpi_size; i++) {
+    if (i != mpi_rank && send_counts[i] > 0) {
+      nsends++;
+    }
+  }
+  MPI_Request *send_requests = new MPI_Request[nsends > 0 ? nsends : 1];
+  for (int i = 0, j = 0; i < mpi_size; i++) {
+    if (i != mpi_rank && send_counts[i] > 0) {
+      MPI_Issend(&send_counts[i], 1, MPI_INT, i, tag, comm, &send_requests[j]);
+      j++;
+    }
+  }
+
+  // Receive the counts until the barrier completes
+  int barrier_active = 0;
+  MPI_Request barrier_request;
+  while (1) {
+    int found;
+    MPI_Status status;
+    MPI_Iprobe(MPI_ANY_SOURCE, tag, comm, &found, &status);
+    if (found) {
+      MPI_Recv(&recv_counts[status.MPI_SOURCE], 1, MPI_INT, status.MPI_SOURCE,
+               tag, comm, MPI_STATUS_IGNORE);
+    }
+
+    if (barrier_active) {
+      int done;
+      MPI_Test(&barrier_request, &done, MPI_STATUS_IGNORE);
+      if (done) {
+        break;
+      }
+    } else {
+      int sent;
+      MPI_Testall(nsends, send_requests, &sent, MPI_STATUSES_IGNORE);
+      if (sent) {
+        MPI_Ibarrier(comm, &barrier_request);
+        barrier_active = 1;
+      }
+    }
+  }
+
+  delete[] send_requests;
+}
+
+/*
+  Get the maximum number of threads used within this processor
+
+  When TMR is built without TMR_HAS_OPENMP, each processor uses a
+  single thread and the thread number is always zero.
+*/
+int TMRGetMaxThreads() {
+#ifdef TMR_HAS_OPENMP
+  return omp_get_max_threads();
+#else
+  return 1;
+#endif  // TMR_HAS_OPENMP
+}
+
+/*
+  Get the number of the calling thread
+*/
+int TMRGetThreadNum() {
+#ifdef TMR_HAS_OPENMP
+  return omp_get_thread_num();
+#else
+  return 0;
+#endif  // TMR_HAS_OPENMP
+}
+
+/*
+  Set the number of threads used in the subsequent parallel regions
+
+  This overrides the value of OMP_NUM_THREADS, so that the number of
+  threads can be matched to the number of processors on each node.
+*/
+void TMRSetNumThreads(int num_threads) {
+#ifdef TMR_HAS_OPENMP
+  if (num_threads >= 1) {
+    omp_set_num_threads(num_threads);
+  }
+#endif  // TMR_HAS_OPENMP
+}
+
+/*
+  Flag indicating whether the element evaluations may be threaded
+*/
+static int TMR_thread_safe_elements = 0;
+
+/*
+  Get whether the elements may be evaluated concurrently
+*/
+int TMRGetThreadSafeElements() { return TMR_thread_safe_elements; }
+
+/*
+  Set whether the elements may be evaluated concurrently
+
+  The element loops in the error estimates call the residual and
+  energy functions of the TACS elements. The elements and their
+  constitutive objects, including TMROctConstitutive and
+  TMRQuadConstitutive, keep scratch space as members, so these loops
+  are only threaded when the caller sets this flag to assert that the
+  elements used in the analysis can be evaluated by several threads
+  at once.
+*/
+void TMRSetThreadSafeElements(int flag) { TMR_thread_safe_elements = flag; }
+
+/*
+  Get the next entity identification number
+*/
+static int TMR_get_next_entity_id(int *count) {
+  int id;
+#ifdef TMR_HAS_OPENMP
+#pragma omp atomic capture
+#endif  // TMR_HAS_OPENMP
+  id = (*count)++;
+  return id;
+}
+
+TMREntity::TMREntity()
+    : entity_id(TMR_get_next_entity_id(&entity_id_count)) {
   name = NULL;
   ref_count = 0;
 }
@@ -120,18 +317,27 @@ TMREntity::~TMREntity() {
 }
 
 int TMREntity::entity_id_count = 0;
+int TMREntity::name_stamp_count = 0;
 
 /*
   Set the name associate with this object
+
+  Each call changes the name stamp, so that the indices created from
+  the names of the entities can tell that they are out of date.
 */
 void TMREntity::setName(const char *_name) {
   if (name) {
     delete[] name;
   }
+  name = NULL;
   if (_name) {
     name = new char[strlen(_name) + 1];
     strcpy(name, _name);
   }
+#ifdef TMR_HAS_OPENMP
+#pragma omp atomic update
+#endif  // TMR_HAS_OPENMP
+  name_stamp_count++;
 }
 
 /*
@@ -142,14 +348,26 @@ const char *TMREntity::getName() const { return name; }
 /*
   Increment the reference count
 */
-void TMREntity::incref() { ref_count++; }
+void TMREntity::incref() {
+#ifdef TMR_HAS_OPENMP
+#pragma omp atomic update
+#endif  // TMR_HAS_OPENMP
+  ref_count++;
+}
 
 /*
   Decrease the reference count
+
+  The decremented count is captured atomically so that exactly one
+  thread observes the count reaching zero and deletes the object.
 */
 void TMREntity::decref() {
-  ref_count--;
-  if (ref_count == 0) {
+  int count;
+#ifdef TMR_HAS_OPENMP
+#pragma omp atomic capture
+#endif  // TMR_HAS_OPENMP
+  count = --ref_count;
+  if (count == 0) {
     delete this;
   }
 }
@@ -173,3 +391,186 @@ void TMREntity::getTolerances(double *_eps_dist, double *_eps_cosine) {
   *_eps_dist = eps_dist;
   *_eps_cosine = eps_cosine;
 }
+
+/*
+  Create an empty memory report
+*/
+TMRMemoryUsage::TMRMemoryUsage() {
+  num_entries = 0;
+  max_entries = 16;
+  names = new char *[max_entries];
+  peak_flags = new int[max_entries];
+
+  // The byte counts are stored in a single allocation
+  local_bytes = new double[4 * max_entries];
+  min_bytes = &local_bytes[max_entries];
+  max_bytes = &local_bytes[2 * max_entries];
+  total_bytes = &local_bytes[3 * max_entries];
+}
+
+/*
+  Free the memory report
+*/
+TMRMemoryUsage::~TMRMemoryUsage() {
+  for (int i = 0; i < num_entries; i++) {
+    delete[] names[i];
+  }
+  delete[] names;
+  delete[] peak_flags;
+  delete[] local_bytes;
+}
+
+/*
+  Add an entry to the report
+
+  Until reduce() is called, the minimum, maximum and total are the
+  values on this processor.
+*/
+void TMRMemoryUsage::addEntry(const char *name, int is_peak, size_t bytes) {
+  if (num_entries >= max_entries) {
+    int new_max = 2 * max_entries;
+    char **new_names = new char *[new_max];
+    int *new_flags = new int[new_max];
+    memcpy(new_names, names, num_entries * sizeof(char *));
+    memcpy(new_flags, peak_flags, num_entries * sizeof(int));
+    delete[] names;
+    delete[] peak_flags;
+    names = new_names;
+    peak_flags = new_flags;
+
+    double *new_bytes = new double[4 * new_max];
+    memcpy(&new_bytes[0], local_bytes, num_entries * sizeof(double));
+    memcpy(&new_bytes[new_max], min_bytes, num_entries * sizeof(double));
+    memcpy(&new_bytes[2 * new_max], max_bytes, num_entries * sizeof(double));
+    memcpy(&new_bytes[3 * new_max], total_bytes, num_entries * sizeof(double));
+    delete[] local_bytes;
+    local_bytes = &new_bytes[0];
+    min_bytes = &new_bytes[new_max];
+    max_bytes = &new_bytes[2 * new_max];
+    total_bytes = &new_bytes[3 * new_max];
+    max_entries = new_max;
+  }
+
+  names[num_entries] = new char[strlen(name) + 1];
+  strcpy(names[num_entries], name);
+  peak_flags[num_entries] = is_peak;
+  local_bytes[num_entries] = bytes;
+  min_bytes[num_entries] = bytes;
+  max_bytes[num_entries] = bytes;
+  total_bytes[num_entries] = bytes;
+  num_entries++;
+}
+
+/*
+  Add the bytes held by an array
+*/
+void TMRMemoryUsage::addArray(const char *name, size_t bytes) {
+  addEntry(name, 0, bytes);
+}
+
+/*
+  Add the peak transient bytes allocated during a phase
+*/
+void TMRMemoryUsage::addPeak(const char *name, size_t bytes) {
+  addEntry(name, 1, bytes);
+}
+
+/*
+  Compute the minimum, maximum and total of each entry across all the
+  processors in the communicator
+*/
+void TMRMemoryUsage::reduce(MPI_Comm comm) {
+  if (num_entries > 0) {
+    MPI_Allreduce(local_bytes, min_bytes, num_entries, MPI_DOUBLE, MPI_MIN,
+                  comm);
+    MPI_Allreduce(local_bytes, max_bytes, num_entries, MPI_DOUBLE, MPI_MAX,
+                  comm);
+    MPI_Allreduce(local_bytes, total_bytes, num_entries, MPI_DOUBLE, MPI_SUM,
+                  comm);
+  }
+}
+
+/*
+  Get the name of an entry
+*/
+const char *TMRMemoryUsage::getEntryName(int entry) {
+  if (entry >= 0 && entry < num_entries) {
+    return names[entry];
+  }
+  return NULL;
+}
+
+/*
+  Check whether the entry is a peak transient value
+*/
+int TMRMemoryUsage::isPeakEntry(int entry) {
+  if (entry >= 0 && entry < num_entries) {
+    return peak_flags[entry];
+  }
+  return 0;
+}
+
+/*
+  Get the bytes for an entry on this processor and, after reduce(),
+  the minimum, maximum and total across the processors
+*/
+void TMRMemoryUsage::getEntryBytes(int entry, double *local, double *_min,
+                                   double *_max, double *_total) {
+  double vals[4] = {0.0, 0.0, 0.0, 0.0};
+  if (entry >= 0 && entry < num_entries) {
+    vals[0] = local_bytes[entry];
+    vals[1] = min_bytes[entry];
+    vals[2] = max_bytes[entry];
+    vals[3] = total_bytes[entry];
+  }
+  if (local) {
+    *local = vals[0];
+  }
+  if (_min) {
+    *_min = vals[1];
+  }
+  if (_max) {
+    *_max = vals[2];
+  }
+  if (_total) {
+    *_total = vals[3];
+  }
+}
+
+/*
+  Get the total bytes held by the arrays on this processor
+*/
+double TMRMemoryUsage::getTotalArrayBytes() {
+  double total = 0.0;
+  for (int i = 0; i < num_entries; i++) {
+    if (!peak_flags[i]) {
+      total += local_bytes[i];
+    }
+  }
+  return total;
+}
+
+/*
+  Print the minimum, maximum and total of each entry in MB from the
+  root processor. This should be called after reduce().
+*/
+void TMRMemoryUsage::printSummary(MPI_Comm comm) {
+  int mpi_rank;
+  MPI_Comm_rank(comm, &mpi_rank);
+  if (mpi_rank == 0) {
+    const double mb = 1.0 / (1024.0 * 1024.0);
+    printf("%-24s %12s %12s %12s\n", "Array [MB]", "min", "max", "total");
+    for (int i = 0; i < num_entries; i++) {
+      if (!peak_flags[i]) {
+        printf("%-24s %12.3f %12.3f %12.3f\n", names[i], mb * min_bytes[i],
+               mb * max_bytes[i], mb * total_bytes[i]);
+      }
+    }
+    for (int i = 0; i < num_entries; i++) {
+      if (peak_flags[i]) {
+        printf("%-24s %12.3f %12.3f %12.3f\n", names[i], mb * min_bytes[i],
+               mb * max_bytes[i], mb * total_bytes[i]);
+      }
+    }
+  }
+}
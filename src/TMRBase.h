@@ -21,6 +21,7 @@
 #ifndef TMR_BASE_H
 #define TMR_BASE_H
 
+#include <math.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
@@ -46,6 +47,18 @@ enum TMRInterpolationType {
   TMR_BERNSTEIN_POINTS
 };
 
+/*
+  Set the order of the locally owned nodes within each processor:
+  the order in which the nodes are created, the order in which the
+  nodes are first referenced by the elements or the reverse
+  Cuthill-McKee order of the element-node graph
+*/
+enum TMRNodeOrderingType {
+  TMR_NATURAL_NODE_ORDER,
+  TMR_ELEMENT_NODE_ORDER,
+  TMR_RCM_NODE_ORDER
+};
+
 /**
   Base class for all point-evaluation algorithms
 */
@@ -90,11 +103,27 @@ extern MPI_Datatype TMRPoint_MPI_type;
 extern MPI_Datatype TMRIndexWeight_MPI_type;
 extern MPI_Datatype TMR_STLTriangle_MPI_type;
 
-// Initialize and finalize the data type
-void TMRInitialize();
+// Initialize and finalize the data type. If a trace file name is
+// given, or the TMR_TRACE environment variable is set, the trace of
+// the major operations is recorded and written in TMRFinalize().
+void TMRInitialize(const char *trace_file = NULL);
 int TMRIsInitialized();
 void TMRFinalize();
 
+// Exchange the number of entries to be sent to each processor
+void TMRExchangeCounts(MPI_Comm comm, const int *send_counts,
+                       int *recv_counts);
+
+// Get or set the number of threads used within each processor
+int TMRGetMaxThreads();
+int TMRGetThreadNum();
+void TMRSetNumThreads(int num_threads);
+
+// Get or set whether the TACS elements and constitutive objects may be
+// evaluated by several threads at once. This is off by default.
+int TMRGetThreadSafeElements();
+void TMRSetThreadSafeElements(int flag);
+
 /*
   The following class is used to help create the interpolation and
   restriction operators. It stores both the node index and
@@ -134,6 +163,22 @@ class TMRIndexWeight {
     return j;
   }
 
+  // Remove the entries with a weight magnitude below the tolerance
+  static int removeSmallWeights(TMRIndexWeight *array, int size,
+                                double tol) {
+    int j = 0;
+    for (int i = 0; i < size; i++) {
+      if (fabs(array[i].weight) > tol) {
+        if (i != j) {
+          array[j] = array[i];
+        }
+        j++;
+      }
+    }
+
+    return j;
+  }
+
  private:
   // Compare two TMRIndexWeight objects - compare them based on
   // their index value only.
@@ -147,6 +192,15 @@ class TMRIndexWeight {
 
 /*
   Reference counted TMR entity
+
+  The reference count and the entity identification number are
+  updated atomically when TMR is compiled with OpenMP, so that entities
+  can be created, incref'd and decref'd concurrently from different
+  threads. This does not make the rest of the entity thread-safe:
+  setName() and any method of a subclass that modifies the entity must
+  not be called concurrently with other accesses to the same entity.
+  Subclasses whose evaluation methods modify internal state, such as a
+  cache, must document whether concurrent evaluation is permitted.
 */
 class TMREntity {
  public:
@@ -157,6 +211,10 @@ class TMREntity {
   void setName(const char *name);
   const char *getName() const;
 
+  // Retrieve a stamp that changes whenever any entity is renamed
+  // ------------------------------------------------------------
+  static int getNameStamp() { return name_stamp_count; }
+
   // Reference count the geometric entity objects
   // --------------------------------------------
   void incref();
@@ -184,7 +242,52 @@ class TMREntity {
 
   // The entity identification value
   const int entity_id;
+
+  // The number of calls to setName() on any entity
+  static int name_stamp_count;
   static int entity_id_count;
 };
 
+/*
+  A report of the memory held by the arrays of an object
+
+  Each entry gives the number of bytes held by a named array on this
+  processor. Peak entries give the largest amount of transient memory
+  allocated during a phase, such as the creation of the nodes, on top
+  of the arrays that are held by the object. Once reduce() is called,
+  the minimum, maximum and total over all processors are available as
+  well. All processors must add the same entries in the same order.
+*/
+class TMRMemoryUsage : public TMREntity {
+ public:
+  TMRMemoryUsage();
+  ~TMRMemoryUsage();
+
+  // Add the entries to the report
+  void addArray(const char *name, size_t bytes);
+  void addPeak(const char *name, size_t bytes);
+
+  // Reduce the entries across all processors
+  void reduce(MPI_Comm comm);
+
+  // Get the entries in the report
+  int getNumEntries() { return num_entries; }
+  const char *getEntryName(int entry);
+  int isPeakEntry(int entry);
+  void getEntryBytes(int entry, double *local, double *min_bytes = NULL,
+                     double *max_bytes = NULL, double *total = NULL);
+  double getTotalArrayBytes();
+
+  // Print the report from the root processor
+  void printSummary(MPI_Comm comm);
+
+ private:
+  void addEntry(const char *name, int is_peak, size_t bytes);
+
+  int num_entries, max_entries;
+  char **names;
+  int *peak_flags;
+  double *local_bytes, *min_bytes, *max_bytes, *total_bytes;
+};
+
 #endif  // TMR_BASE_H
@@ -23,6 +23,7 @@
 #include <math.h>
 #include <stdio.h>
 
+#include "TMRFeatureSize.h"
 #include "tmrlapack.h"
 
 // The maximum order for the spline
@@ -105,6 +106,19 @@ int bspline_interval(double u, const double *T, int n, int k) {
   }
 }
 
+/*
+  Find the knot interval, first checking whether u lies within the
+  interval guess. This gives the same result as bspline_interval but
+  avoids the search when consecutive points lie in the same interval.
+*/
+static inline int bspline_interval_guess(double u, const double *T, int n,
+                                         int k, int guess) {
+  if (guess >= k - 1 && guess < n && u >= T[guess] && u < T[guess + 1]) {
+    return guess;
+  }
+  return bspline_interval(u, T, n, k);
+}
+
 /*
   Evaluate the B-spline basis functions
 
@@ -297,6 +311,9 @@ TMRBsplineCurve::TMRBsplineCurve(int _n, int _k, const TMRPoint *_pts) {
 
   // Uniform weights
   wts = NULL;
+
+  // The locator for the inverse evaluation is created when needed
+  seed_locator = NULL;
 }
 
 /*
@@ -333,6 +350,9 @@ TMRBsplineCurve::TMRBsplineCurve(int _n, int _k, const double *_Tu,
 
   // Uniform weights
   wts = NULL;
+
+  // The locator for the inverse evaluation is created when needed
+  seed_locator = NULL;
 }
 
 /*
@@ -371,6 +391,9 @@ TMRBsplineCurve::TMRBsplineCurve(int _n, int _k, const double *_Tu,
   // Copy over the points
   pts = new TMRPoint[nctl];
   memcpy(pts, _pts, nctl * sizeof(TMRPoint));
+
+  // The locator for the inverse evaluation is created when needed
+  seed_locator = NULL;
 }
 
 /*
@@ -382,6 +405,9 @@ TMRBsplineCurve::~TMRBsplineCurve() {
   if (wts) {
     delete[] wts;
   }
+  if (seed_locator) {
+    seed_locator->decref();
+  }
 }
 
 // Set the maximum number of newton iterations
@@ -446,89 +472,155 @@ int TMRBsplineCurve::evalPoint(double t, TMRPoint *X) {
 }
 
 /*
-  Perform the inverse point evaluation
-*/
-int TMRBsplineCurve::invEvalPoint(TMRPoint point, double *tf) {
-  // Did this evaluation fail or not?
-  int fail = 1;
-
-  // Set a default value for the output parameter value
-  *tf = 0.0;
+  Evaluate a batch of points on the curve
 
-  // Temporary internal data
-  double Nu[3 * MAX_BSPLINE_ORDER];
-  double work[2 * MAX_BSPLINE_ORDER + MAX_BSPLINE_ORDER * MAX_BSPLINE_ORDER];
-  double t = 0.5 * (Tu[0] + Tu[nctl + ku - 1]);
-
-  // Get the bounds
-  double tmin, tmax;
-  getRange(&tmin, &tmax);
-  double tbest = 0.0;
-
-  // Set the number of trial points to use in the brute force method
-  // along each direction.
-  int nupts = 2 * nctl + 1;
-
-  // Using brute force, find the point that is closest to the input
-  // point by evaluating the surface at a series of locations.
-  double dist = 1e40;
-  for (int ii = 0; ii < nupts; ii++) {
-    t = tmin + (1.0 * ii / (nupts - 1)) * (tmax - tmin);
-    int intu = bspline_interval(t, Tu, nctl, ku);
-
-    // Evaluate the basis functions
-    bspline_basis(Nu, intu, t, Tu, ku, work);
-
-    // Set the interval to the initial control point
-    intu = intu - ku + 1;
+  The knot interval of each point is found by first checking the
+  interval of the previous point, and the basis functions are only
+  re-computed when the parameter changes. This is most effective when
+  consecutive points are close to one another, as they are in a mesh.
+  The results are identical to calling evalPoint for each point.
+*/
+int TMRBsplineCurve::evalPoints(int n, const double t[], TMRPoint X[]) {
+  double Nu[MAX_BSPLINE_ORDER];
+  double work[2 * MAX_BSPLINE_ORDER];
 
-    // Evaluate the point
-    TMRPoint X;
-    X.zero();
+  int intu = -1;
+  for (int k = 0; k < n; k++) {
+    // Compute the knot span and the basis functions if the parameter
+    // has changed
+    if (k == 0 || t[k] != t[k - 1]) {
+      intu = bspline_interval_guess(t[k], Tu, nctl, ku, intu);
+      bspline_basis(Nu, intu, t[k], Tu, ku, work);
+    }
 
-    // If this is a NURBS surface add the effect of the weights
+    // Set the pointers to the first control point
+    const TMRPoint *P = &pts[intu - ku + 1];
+    double x = 0.0, y = 0.0, z = 0.0;
     if (wts) {
-      // Evaluate the b-spline
+      const double *W = &wts[intu - ku + 1];
       double w = 0.0;
       for (int i = 0; i < ku; i++) {
-        int index = intu + i;
-        X.x += wts[index] * Nu[i] * pts[index].x;
-        X.y += wts[index] * Nu[i] * pts[index].y;
-        X.z += wts[index] * Nu[i] * pts[index].z;
-        w += wts[index] * Nu[i];
+        x += W[i] * Nu[i] * P[i].x;
+        y += W[i] * Nu[i] * P[i].y;
+        z += W[i] * Nu[i] * P[i].z;
+        w += Nu[i] * W[i];
       }
 
-      // Divide through by the weights
       if (w != 0.0) {
         w = 1.0 / w;
-        X.x *= w;
-        X.y *= w;
-        X.z *= w;
+        x *= w;
+        y *= w;
+        z *= w;
       }
     } else {
       for (int i = 0; i < ku; i++) {
-        int index = intu + i;
-        X.x += Nu[i] * pts[index].x;
-        X.y += Nu[i] * pts[index].y;
-        X.z += Nu[i] * pts[index].z;
+        x += Nu[i] * P[i].x;
+        y += Nu[i] * P[i].y;
+        z += Nu[i] * P[i].z;
       }
     }
+    X[k].x = x;
+    X[k].y = y;
+    X[k].z = z;
+  }
+
+  return 0;
+}
+
+/*
+  Create the locator for the sample points that are used to seed the
+  inverse evaluation. The sample points are evenly spaced in the
+  parameter space. This is only performed once for each curve.
+*/
+void TMRBsplineCurve::initSeedLocator() {
+#ifdef TMR_HAS_OPENMP
+#pragma omp critical(TMRBsplineCurveSeed)
+#endif  // TMR_HAS_OPENMP
+  if (!seed_locator) {
+    double tmin, tmax;
+    getRange(&tmin, &tmax);
+
+    // Set the number of sample points
+    int npts = 2 * nctl + 1;
+    double *t = new double[npts];
+    TMRPoint *X = new TMRPoint[npts];
+    for (int i = 0; i < npts; i++) {
+      t[i] = tmin + (1.0 * i / (npts - 1)) * (tmax - tmin);
+    }
+    evalPoints(npts, t, X);
 
-    // Find the distance vector
-    X.x = point.x - X.x;
-    X.y = point.y - X.y;
-    X.z = point.z - X.z;
+    seed_locator = new TMRPointLocator(npts, X);
+    seed_locator->incref();
 
-    // Check whether the distance is closer
-    double d = X.dot(X);
-    if (d < dist) {
-      dist = d;
-      tbest = t;
+    delete[] t;
+    delete[] X;
+  }
+}
+
+/*
+  Find the parameter value of the sample point that is closest to the
+  given point. Note that initSeedLocator() must be called first.
+*/
+void TMRBsplineCurve::getInitialGuess(TMRPoint point, double *t) {
+  double tmin, tmax;
+  getRange(&tmin, &tmax);
+  int npts = 2 * nctl + 1;
+
+  int nk = 0, index = 0;
+  double dist;
+  seed_locator->locateClosest(1, point, &nk, &index, &dist);
+  *t = tmin + (1.0 * index / (npts - 1)) * (tmax - tmin);
+}
+
+/*
+  Perform the inverse point evaluation
+*/
+int TMRBsplineCurve::invEvalPoint(TMRPoint point, double *tf) {
+  double t;
+  initSeedLocator();
+  getInitialGuess(point, &t);
+  return newtonInvEvalPoint(point, t, tf);
+}
+
+/*
+  Perform the inverse point evaluation for a batch of points. The
+  points are independent of one another and are inverted in parallel
+  when compiled with OpenMP.
+*/
+int TMRBsplineCurve::invEvalPoints(int n, const TMRPoint X[], double tf[]) {
+  initSeedLocator();
+
+  int nfail = 0;
+#ifdef TMR_HAS_OPENMP
+#pragma omp parallel for reduction(+ : nfail)
+#endif  // TMR_HAS_OPENMP
+  for (int i = 0; i < n; i++) {
+    double t;
+    getInitialGuess(X[i], &t);
+    if (newtonInvEvalPoint(X[i], t, &tf[i])) {
+      nfail++;
     }
   }
 
-  // Set the new closest point
-  t = tbest;
+  return (nfail > 0);
+}
+
+/*
+  Perform the newton iteration for the inverse point evaluation
+  starting from the parameter value t. If the iteration fails, the
+  last iterate is returned.
+*/
+int TMRBsplineCurve::newtonInvEvalPoint(TMRPoint point, double t,
+                                        double *tf) {
+  // Did this evaluation fail or not?
+  int fail = 1;
+
+  // Set a default value for the output parameter value
+  *tf = t;
+
+  // Temporary internal data
+  double Nu[3 * MAX_BSPLINE_ORDER];
+  double work[2 * MAX_BSPLINE_ORDER + MAX_BSPLINE_ORDER * MAX_BSPLINE_ORDER];
 
   // Perform a newton iteration until convergence
   for (int j = 0; j < max_newton_iters; j++) {
@@ -671,7 +763,8 @@ int TMRBsplineCurve::invEvalPoint(TMRPoint point, double *tf) {
     t = tnew;
   }
 
-  // The newton method has failed!!
+  // The newton method has failed!! Return the last iterate
+  *tf = t;
   fail = 1;
   return fail;
 }
@@ -1500,6 +1593,9 @@ TMRBsplineSurface::TMRBsplineSurface(int _nu, int _nv, int _ku, int _kv,
   // Allocate the points array
   pts = new TMRPoint[nu * nv];
   memcpy(pts, _pts, nu * nv * sizeof(TMRPoint));
+
+  // The locator for the inverse evaluation is created when needed
+  seed_locator = NULL;
 }
 
 /*
@@ -1548,6 +1644,9 @@ TMRBsplineSurface::TMRBsplineSurface(int _nu, int _nv, int _ku, int _kv,
   // Allocate the points array
   pts = new TMRPoint[nu * nv];
   memcpy(pts, _pts, nu * nv * sizeof(TMRPoint));
+
+  // The locator for the inverse evaluation is created when needed
+  seed_locator = NULL;
 }
 
 TMRBsplineSurface::TMRBsplineSurface(int _nu, int _nv, int _ku, int _kv,
@@ -1594,6 +1693,9 @@ TMRBsplineSurface::TMRBsplineSurface(int _nu, int _nv, int _ku, int _kv,
   // Allocate the points array
   pts = new TMRPoint[nu * nv];
   memcpy(pts, _pts, nu * nv * sizeof(TMRPoint));
+
+  // The locator for the inverse evaluation is created when needed
+  seed_locator = NULL;
 }
 
 /*
@@ -1606,6 +1708,9 @@ TMRBsplineSurface::~TMRBsplineSurface() {
     delete[] wts;
   }
   delete[] pts;
+  if (seed_locator) {
+    seed_locator->decref();
+  }
 }
 
 /*
@@ -1685,103 +1790,185 @@ int TMRBsplineSurface::evalPoint(double u, double v, TMRPoint *X) {
 }
 
 /*
-  Perform the inverse evaluation
+  Evaluate a batch of points on the surface
+
+  The knot intervals of each point are found by first checking the
+  intervals of the previous point, and the basis functions in each
+  direction are only re-computed when the corresponding parameter
+  changes. This is most effective when consecutive points are close
+  to one another, for instance along the rows of a structured mesh.
+  The results are identical to calling evalPoint for each point.
 */
-int TMRBsplineSurface::invEvalPoint(TMRPoint point, double *uf, double *vf) {
-  // Did this evaluation fail or not?
-  int fail = 1;
+int TMRBsplineSurface::evalPoints(int n, const double u[], const double v[],
+                                  TMRPoint X[]) {
+  double Nu[MAX_BSPLINE_ORDER], Nv[MAX_BSPLINE_ORDER];
+  double work[2 * MAX_BSPLINE_ORDER];
 
-  // Set the default parameter values
-  *uf = *vf = 0.0;
+  int intu = -1, intv = -1;
+  for (int k = 0; k < n; k++) {
+    // Compute the knot spans and the basis functions in each direction
+    // if the corresponding parameter has changed
+    if (k == 0 || u[k] != u[k - 1]) {
+      intu = bspline_interval_guess(u[k], Tu, nu, ku, intu);
+      bspline_basis(Nu, intu, u[k], Tu, ku, work);
+    }
+    if (k == 0 || v[k] != v[k - 1]) {
+      intv = bspline_interval_guess(v[k], Tv, nv, kv, intv);
+      bspline_basis(Nv, intv, v[k], Tv, kv, work);
+    }
 
-  // The basis functions/work arrays
-  double Nu[3 * MAX_BSPLINE_ORDER], Nv[3 * MAX_BSPLINE_ORDER];
-  double work[2 * MAX_BSPLINE_ORDER + MAX_BSPLINE_ORDER * MAX_BSPLINE_ORDER];
+    // Set the offset to the first control point
+    const int offset = intu - ku + 1 + (intv - kv + 1) * nu;
+    double x = 0.0, y = 0.0, z = 0.0;
+    if (wts) {
+      double w = 0.0;
+      for (int j = 0; j < kv; j++) {
+        const TMRPoint *P = &pts[offset + j * nu];
+        const double *W = &wts[offset + j * nu];
+        for (int i = 0; i < ku; i++) {
+          x += W[i] * Nu[i] * Nv[j] * P[i].x;
+          y += W[i] * Nu[i] * Nv[j] * P[i].y;
+          z += W[i] * Nu[i] * Nv[j] * P[i].z;
+          w += W[i] * Nu[i] * Nv[j];
+        }
+      }
 
-  // Get the bounds
+      if (w != 0.0) {
+        w = 1.0 / w;
+        x *= w;
+        y *= w;
+        z *= w;
+      }
+    } else {
+      for (int j = 0; j < kv; j++) {
+        const TMRPoint *P = &pts[offset + j * nu];
+        for (int i = 0; i < ku; i++) {
+          x += Nu[i] * Nv[j] * P[i].x;
+          y += Nu[i] * Nv[j] * P[i].y;
+          z += Nu[i] * Nv[j] * P[i].z;
+        }
+      }
+    }
+    X[k].x = x;
+    X[k].y = y;
+    X[k].z = z;
+  }
+
+  return 0;
+}
+
+/*
+  Create the locator for the sample points that are used to seed the
+  inverse evaluation. The sample points are on a uniform grid in the
+  parameter space. This is only performed once for each surface.
+*/
+void TMRBsplineSurface::initSeedLocator() {
+#ifdef TMR_HAS_OPENMP
+#pragma omp critical(TMRBsplineSurfaceSeed)
+#endif  // TMR_HAS_OPENMP
+  if (!seed_locator) {
+    double umin, vmin, umax, vmax;
+    getRange(&umin, &vmin, &umax, &vmax);
+
+    // Set the number of sample points along each direction
+    int nupts = 2 * nu + 1;
+    int nvpts = 2 * nv + 1;
+    int npts = nupts * nvpts;
+    double *u = new double[npts];
+    double *v = new double[npts];
+    TMRPoint *X = new TMRPoint[npts];
+    for (int jj = 0; jj < nvpts; jj++) {
+      for (int ii = 0; ii < nupts; ii++) {
+        u[ii + jj * nupts] = umin + (1.0 * ii / (nupts - 1)) * (umax - umin);
+        v[ii + jj * nupts] = vmin + (1.0 * jj / (nvpts - 1)) * (vmax - vmin);
+      }
+    }
+    evalPoints(npts, u, v, X);
+
+    seed_locator = new TMRPointLocator(npts, X);
+    seed_locator->incref();
+
+    delete[] u;
+    delete[] v;
+    delete[] X;
+  }
+}
+
+/*
+  Find the parameter values of the sample point that is closest to
+  the given point. Note that initSeedLocator() must be called first.
+*/
+void TMRBsplineSurface::getInitialGuess(TMRPoint point, double *u,
+                                        double *v) {
   double umin, vmin, umax, vmax;
   getRange(&umin, &vmin, &umax, &vmax);
-  double u = 0.0, v = 0.0;
-  double ubest = 0.0, vbest = 0.0;
-
-  // Set the number of trial points to use in the brute force method
-  // along each direction.
   int nupts = 2 * nu + 1;
   int nvpts = 2 * nv + 1;
 
-  // Using brute force, find the point that is closest to the input
-  // point by evaluating the surface at a series of locations.
-  double dist = 1e40;
-  for (int jj = 0; jj < nvpts; jj++) {
-    for (int ii = 0; ii < nupts; ii++) {
-      u = umin + (1.0 * ii / (nupts - 1)) * (umax - umin);
-      v = vmin + (1.0 * jj / (nvpts - 1)) * (vmax - vmin);
-      int intu = bspline_interval(u, Tu, nu, ku);
-      int intv = bspline_interval(v, Tv, nv, kv);
-
-      // Evaluate the basis functions
-      bspline_basis(Nu, intu, u, Tu, ku, work);
-      bspline_basis(Nv, intv, v, Tv, kv, work);
-
-      // Set the interval to the initial control point
-      intu = intu - ku + 1;
-      intv = intv - kv + 1;
-
-      // Evaluate the point
-      TMRPoint X;
-      X.zero();
+  int nk = 0, index = 0;
+  double dist;
+  seed_locator->locateClosest(1, point, &nk, &index, &dist);
+  int ii = index % nupts;
+  int jj = index / nupts;
+  *u = umin + (1.0 * ii / (nupts - 1)) * (umax - umin);
+  *v = vmin + (1.0 * jj / (nvpts - 1)) * (vmax - vmin);
+}
 
-      // If this is a NURBS surface add the effect of the weights
-      if (wts) {
-        // Evaluate the b-spline
-        double w = 0.0;
-        for (int j = 0; j < kv; j++) {
-          for (int i = 0; i < ku; i++) {
-            int index = intu + i + (intv + j) * nu;
-            X.x += wts[index] * Nu[i] * Nv[j] * pts[index].x;
-            X.y += wts[index] * Nu[i] * Nv[j] * pts[index].y;
-            X.z += wts[index] * Nu[i] * Nv[j] * pts[index].z;
-            w += wts[index] * Nu[i] * Nv[j];
-          }
-        }
+/*
+  Perform the inverse evaluation
+*/
+int TMRBsplineSurface::invEvalPoint(TMRPoint point, double *uf, double *vf) {
+  double u, v;
+  initSeedLocator();
+  getInitialGuess(point, &u, &v);
+  return newtonInvEvalPoint(point, u, v, uf, vf);
+}
 
-        // Divide through by the weights
-        if (w != 0.0) {
-          w = 1.0 / w;
-          X.x *= w;
-          X.y *= w;
-          X.z *= w;
-        }
-      } else {
-        // Evaluate the b-spline
-        for (int j = 0; j < kv; j++) {
-          for (int i = 0; i < ku; i++) {
-            int index = intu + i + (intv + j) * nu;
-            X.x += Nu[i] * Nv[j] * pts[index].x;
-            X.y += Nu[i] * Nv[j] * pts[index].y;
-            X.z += Nu[i] * Nv[j] * pts[index].z;
-          }
-        }
-      }
+/*
+  Perform the inverse evaluation for a batch of points. The points
+  are independent of one another and are inverted in parallel when
+  compiled with OpenMP.
+*/
+int TMRBsplineSurface::invEvalPoints(int n, const TMRPoint X[], double uf[],
+                                     double vf[]) {
+  initSeedLocator();
 
-      // Find the distance vector
-      X.x = point.x - X.x;
-      X.y = point.y - X.y;
-      X.z = point.z - X.z;
-
-      // Check whether the distance is closer
-      double d = X.dot(X);
-      if (d < dist) {
-        dist = d;
-        ubest = u;
-        vbest = v;
-      }
+  int nfail = 0;
+#ifdef TMR_HAS_OPENMP
+#pragma omp parallel for reduction(+ : nfail)
+#endif  // TMR_HAS_OPENMP
+  for (int i = 0; i < n; i++) {
+    double u, v;
+    getInitialGuess(X[i], &u, &v);
+    if (newtonInvEvalPoint(X[i], u, v, &uf[i], &vf[i])) {
+      nfail++;
     }
   }
 
-  // Set the new closest point
-  u = ubest;
-  v = vbest;
+  return (nfail > 0);
+}
+
+/*
+  Perform the newton iteration for the inverse evaluation starting
+  from the parameter values (u, v). If the iteration fails, the last
+  iterate is returned.
+*/
+int TMRBsplineSurface::newtonInvEvalPoint(TMRPoint point, double u, double v,
+                                          double *uf, double *vf) {
+  // Did this evaluation fail or not?
+  int fail = 1;
+
+  // Set the default parameter values
+  *uf = u;
+  *vf = v;
+
+  // The basis functions/work arrays
+  double Nu[3 * MAX_BSPLINE_ORDER], Nv[3 * MAX_BSPLINE_ORDER];
+  double work[2 * MAX_BSPLINE_ORDER + MAX_BSPLINE_ORDER * MAX_BSPLINE_ORDER];
+
+  // Get the bounds
+  double umin, vmin, umax, vmax;
+  getRange(&umin, &vmin, &umax, &vmax);
 
   // Perform a newton iteration until convergence
   for (int k = 0; k < max_newton_iters; k++) {
@@ -2009,7 +2196,9 @@ int TMRBsplineSurface::invEvalPoint(TMRPoint point, double *uf, double *vf) {
     v = vnew;
   }
 
-  // The newton method failed
+  // The newton method failed. Return the last iterate
+  *uf = u;
+  *vf = v;
   return fail;
 }
 
@@ -23,6 +23,8 @@
 
 #include "TMRGeometry.h"
 
+class TMRPointLocator;
+
 /*
   This file contains the TMRBsplineCurve and TMRBsplineSurface
   classes that define B-spline and NURBS curves/surfaces for
@@ -45,9 +47,15 @@ class TMRBsplineCurve : public TMRCurve {
   // Given the parametric point, evaluate the x,y,z location
   int evalPoint(double t, TMRPoint *X);
 
+  // Evaluate the x,y,z locations of a batch of parametric points
+  int evalPoints(int n, const double t[], TMRPoint X[]);
+
   // Given the x,y,z location, find the parametric coordinates
   int invEvalPoint(TMRPoint X, double *t);
 
+  // Find the parametric coordinates of a batch of points
+  int invEvalPoints(int n, const TMRPoint X[], double t[]);
+
   // Given the parametric point, evaluate the derivative
   int evalDeriv(double t, TMRPoint *X, TMRPoint *Xt);
 
@@ -81,6 +89,15 @@ class TMRBsplineCurve : public TMRCurve {
   }
 
  private:
+  // Create the locator used to seed the inverse evaluation
+  void initSeedLocator();
+
+  // Find the closest sample point to seed the inverse evaluation
+  void getInitialGuess(TMRPoint X, double *t);
+
+  // Perform the newton iteration from the given starting point
+  int newtonInvEvalPoint(TMRPoint X, double t0, double *t);
+
   // The number of control points and b-spline order
   int nctl, ku;
 
@@ -93,6 +110,10 @@ class TMRBsplineCurve : public TMRCurve {
   // The weighs (when it is a NURBS curve)
   double *wts;
 
+  // Locator for the sample points used to seed the inverse
+  // evaluation. This is created the first time it is needed.
+  TMRPointLocator *seed_locator;
+
   // Maximum number of newton iterations for the B-spline inverse
   // point code
   static int max_newton_iters;
@@ -116,9 +137,15 @@ class TMRBsplineSurface : public TMRSurface {
   // Given the parametric point, compute the x,y,z location
   int evalPoint(double u, double v, TMRPoint *X);
 
+  // Evaluate the x,y,z locations of a batch of parametric points
+  int evalPoints(int n, const double u[], const double v[], TMRPoint X[]);
+
   // Perform the inverse evaluation
   int invEvalPoint(TMRPoint p, double *u, double *v);
 
+  // Perform the inverse evaluation for a batch of points
+  int invEvalPoints(int n, const TMRPoint p[], double u[], double v[]);
+
   // Given the parametric point, evaluate the first derivative
   int evalDeriv(double u, double v, TMRPoint *X, TMRPoint *Xu, TMRPoint *Xv);
 
@@ -155,6 +182,16 @@ class TMRBsplineSurface : public TMRSurface {
   }
 
  private:
+  // Create the locator used to seed the inverse evaluation
+  void initSeedLocator();
+
+  // Find the closest sample point to seed the inverse evaluation
+  void getInitialGuess(TMRPoint p, double *u, double *v);
+
+  // Perform the newton iteration from the given starting point
+  int newtonInvEvalPoint(TMRPoint p, double u0, double v0, double *u,
+                         double *v);
+
   // The number of control points and b-spline order
   int ku, kv;
   int nu, nv;
@@ -168,6 +205,10 @@ class TMRBsplineSurface : public TMRSurface {
   // The weighs (when it is a NURBS curve)
   double *wts;
 
+  // Locator for the sample points used to seed the inverse
+  // evaluation. This is created the first time it is needed.
+  TMRPointLocator *seed_locator;
+
   // Maximum number of newton iterations for the B-spline inverse
   // point code
   static int max_newton_iters;
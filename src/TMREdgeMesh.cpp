@@ -22,17 +22,51 @@
 
 #include <math.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 /*
-  An integral entry for the linked list
+  An interval within the adaptive integration along the edge. The
+  index gives the position of the interval within its level of the
+  bisection.
 */
-class IntegralPt {
+class IntegralInterval {
  public:
-  double t;
-  double dist;
-  IntegralPt *next;
+  double t1, h1, t2, h2;
+  TMRPoint p1, p2;
+  int index;
+};
+
+/*
+  An interval that has been integrated to the required accuracy. The
+  position of the interval along the edge is recorded so that the
+  intervals can be sorted.
+*/
+class IntegralSegment {
+ public:
+  int pos;
+  double tmid, t2;
+  double int1, int2;
+
+  static int compare(const void *a, const void *b) {
+    const IntegralSegment *A = static_cast<const IntegralSegment *>(a);
+    const IntegralSegment *B = static_cast<const IntegralSegment *>(b);
+    return A->pos - B->pos;
+  }
 };
 
+/*
+  The minimum number of times that the edge is bisected during the
+  adaptive integration
+*/
+static const int TMR_MIN_EDGE_INTEGRATION_LEVEL = 7;
+
+/*
+  The maximum number of times that the edge is bisected during the
+  adaptive integration
+*/
+static const int TMR_MAX_EDGE_INTEGRATION_LEVEL = 21;
+
 /*
   Evaluate the distance between two points
 */
@@ -42,127 +76,170 @@ double pointDist(TMRPoint *a, TMRPoint *b) {
 }
 
 /*
-  Recursive integration on an edge with an adaptive error control to
-  ensure that the integral is computed with sufficient accuracy.
+  Integrate along the edge adaptively, creating a list of the
+  parametric locations and the integral of 1/h up to each location
+
+  The edge is bisected adaptively with an error control that ensures
+  that the integral is computed with sufficient accuracy. The edge is
+  always bisected down to a minimum level. After that, the intervals
+  whose error exceeds the tolerance are bisected again. The bisection
+  proceeds one level at a time, so that the mid-points and the
+  feature sizes for all of the intervals on a level are evaluated in
+  a single batch.
 
   input:
-  t1, t2:  the limits of integration for this interval
+  t1, t2:  the limits of integration
   tol:     the absolute error measure
-  ncalls:  the recursion depth
-  pt:      pointer into the linked list
-*/
-void integrateEdge(TMREdge *edge, TMRElementFeatureSize *fs, double t1,
-                   double h1, TMRPoint p1, double t2, double tol, int ncalls,
-                   IntegralPt **_pt) {
-  // Dereference the pointer to the integral point
-  IntegralPt *pt = *_pt;
-
-  // Find the mid point of the interval
-  TMRPoint pmid;
-  double tmid = 0.5 * (t1 + t2);
-  edge->evalPoint(tmid, &pmid);
-  double hmid = fs->getFeatureSize(pmid);
-
-  // Evaluate the point at the end of the interval
-  TMRPoint p2;
-  edge->evalPoint(t2, &p2);
-  double h2 = fs->getFeatureSize(p2);
-
-  // Evaluate the approximate integral contributions
-  double int1 = 2.0 * pointDist(&p1, &pmid) / (h1 + hmid);
-  double int2 = 4.0 * pointDist(&pmid, &p2) / (h1 + 2.0 * hmid + h2);
-  double int3 = 2.0 * pointDist(&p1, &p2) / (hmid + h2);
-
-  // Compute the integration error
-  double error = fabs(int3 - int1 - int2);
-
-  if (((ncalls > 6) && (error < tol)) || (ncalls > 20)) {
-    // Add the mid point
-    pt->next = new IntegralPt;
-    pt->next->dist = pt->dist + int1;
-    pt->next->t = tmid;
-    pt->next->next = NULL;
-    pt = pt->next;
-
-    // Add the final point p2
-    pt->next = new IntegralPt;
-    pt->next->dist = pt->dist + int2;
-    pt->next->t = t2;
-    pt->next->next = NULL;
-    pt = pt->next;
-
-    // Set the pointer to the end of the linked list
-    *_pt = pt;
-  } else {
-    // Continue the recursive integration
-    integrateEdge(edge, fs, t1, h1, p1, tmid, tol, ncalls + 1, _pt);
-    integrateEdge(edge, fs, tmid, hmid, pmid, t2, tol, ncalls + 1, _pt);
-  }
-}
 
-/*
-  Integrate along the edge adaptively, creating a list
+  output:
+  tvals:   the parametric locations
+  dist:    the integral of 1/h at each location
+  nvals:   the number of locations
+
+  returns:
+  the integral of 1/h along the edge
 */
 double integrateEdge(TMREdge *edge, TMRElementFeatureSize *fs, double t1,
                      double t2, double tol, double **_tvals, double **_dist,
                      int *_nvals) {
-  *_tvals = NULL;
-  *_dist = NULL;
-  *_nvals = 0;
-
-  // Allocate the entry in the linked list
-  IntegralPt *root = new IntegralPt;
-  root->next = NULL;
-  root->dist = 0.0;
-  root->t = t1;
-
-  // Evaluate the first point
-  TMRPoint p1;
-  edge->evalPoint(t1, &p1);
-  double h1 = fs->getFeatureSize(p1);
-
-  // Integrate over the edge
-  IntegralPt *pt = root;
-  integrateEdge(edge, fs, t1, h1, p1, t2, tol, 0, &pt);
-
-  // Count up and allocate the num
-  int count = 1;
-  IntegralPt *curr = root;
-  while (curr->next) {
-    curr = curr->next;
-    count++;
-  }
-
-  // Allocate arrays to store the parametric location/distance data
-  double *tvals = new double[count];
-  double *dist = new double[count];
-
-  // Scan through the linked list, read out the values of the
-  // parameter and its integral and delete the entries as we go...
-  count = 0;
-  curr = root;
-  tvals[count] = curr->t;
-  dist[count] = curr->dist;
-  count++;
+  // The interval is always bisected down to the minimum level, so
+  // evaluate the points and feature sizes on this level in a single
+  // batch
+  int level = TMR_MIN_EDGE_INTEGRATION_LEVEL;
+  const int nint = 1 << level;
+  double *t = new double[nint + 1];
+  double *h = new double[nint + 1];
+  TMRPoint *X = new TMRPoint[nint + 1];
+  t[0] = t1;
+  t[nint] = t2;
+  for (int step = nint; step > 1; step /= 2) {
+    for (int i = 0; i < nint; i += step) {
+      t[i + step / 2] = 0.5 * (t[i] + t[i + step]);
+    }
+  }
+  edge->evalPoints(nint + 1, t, X);
+  fs->getFeatureSizes(nint + 1, X, h);
+
+  // Set the intervals on the minimum level
+  int num_active = nint;
+  int max_active = 2 * nint;
+  IntegralInterval *active = new IntegralInterval[max_active];
+  for (int i = 0; i < nint; i++) {
+    active[i].t1 = t[i];
+    active[i].h1 = h[i];
+    active[i].p1 = X[i];
+    active[i].t2 = t[i + 1];
+    active[i].h2 = h[i + 1];
+    active[i].p2 = X[i + 1];
+    active[i].index = i;
+  }
+  delete[] t;
+  delete[] h;
+  delete[] X;
+
+  int num_segments = 0;
+  int max_segments = nint;
+  IntegralSegment *segments = new IntegralSegment[max_segments];
+
+  while (num_active > 0) {
+    // Evaluate the mid-points of all the intervals on this level
+    double *tmid = new double[num_active];
+    double *hmid = new double[num_active];
+    TMRPoint *pmid = new TMRPoint[num_active];
+    for (int i = 0; i < num_active; i++) {
+      tmid[i] = 0.5 * (active[i].t1 + active[i].t2);
+    }
+    edge->evalPoints(num_active, tmid, pmid);
+    fs->getFeatureSizes(num_active, pmid, hmid);
+
+    // Make sure that there is enough space for the next level
+    if (num_segments + num_active > max_segments) {
+      max_segments = 2 * (num_segments + num_active);
+      IntegralSegment *temp = new IntegralSegment[max_segments];
+      memcpy(temp, segments, num_segments * sizeof(IntegralSegment));
+      delete[] segments;
+      segments = temp;
+    }
+    IntegralInterval *next = new IntegralInterval[2 * num_active];
+    int num_next = 0;
+
+    for (int i = 0; i < num_active; i++) {
+      IntegralInterval *a = &active[i];
+
+      // Evaluate the approximate integral contributions
+      double int1 = 2.0 * pointDist(&a->p1, &pmid[i]) / (a->h1 + hmid[i]);
+      double int2 = 4.0 * pointDist(&pmid[i], &a->p2) /
+                    (a->h1 + 2.0 * hmid[i] + a->h2);
+      double int3 = 2.0 * pointDist(&a->p1, &a->p2) / (hmid[i] + a->h2);
+
+      // Compute the integration error
+      double error = fabs(int3 - int1 - int2);
+
+      if (error < tol || level >= TMR_MAX_EDGE_INTEGRATION_LEVEL) {
+        // Add the mid point and the final point of the interval
+        IntegralSegment *seg = &segments[num_segments];
+        seg->pos = a->index << (TMR_MAX_EDGE_INTEGRATION_LEVEL - level);
+        seg->tmid = tmid[i];
+        seg->t2 = a->t2;
+        seg->int1 = int1;
+        seg->int2 = int2;
+        num_segments++;
+      } else {
+        // Bisect the interval
+        next[num_next].t1 = a->t1;
+        next[num_next].h1 = a->h1;
+        next[num_next].p1 = a->p1;
+        next[num_next].t2 = tmid[i];
+        next[num_next].h2 = hmid[i];
+        next[num_next].p2 = pmid[i];
+        next[num_next].index = 2 * a->index;
+        num_next++;
+
+        next[num_next].t1 = tmid[i];
+        next[num_next].h1 = hmid[i];
+        next[num_next].p1 = pmid[i];
+        next[num_next].t2 = a->t2;
+        next[num_next].h2 = a->h2;
+        next[num_next].p2 = a->p2;
+        next[num_next].index = 2 * a->index + 1;
+        num_next++;
+      }
+    }
 
-  while (curr->next) {
-    IntegralPt *tmp = curr;
-    curr = curr->next;
-    tvals[count] = curr->t;
-    dist[count] = curr->dist;
-    count++;
-    delete tmp;
+    delete[] tmid;
+    delete[] hmid;
+    delete[] pmid;
+    delete[] active;
+    active = next;
+    num_active = num_next;
+    level++;
   }
+  delete[] active;
 
-  double len = curr->dist;
-  delete curr;
+  // Sort the segments along the edge
+  qsort(segments, num_segments, sizeof(IntegralSegment),
+        IntegralSegment::compare);
+
+  // Read out the values of the parameter and its integral
+  int count = 2 * num_segments + 1;
+  double *tvals = new double[count];
+  double *dist = new double[count];
+  tvals[0] = t1;
+  dist[0] = 0.0;
+  for (int i = 0; i < num_segments; i++) {
+    tvals[2 * i + 1] = segments[i].tmid;
+    dist[2 * i + 1] = dist[2 * i] + segments[i].int1;
+    tvals[2 * i + 2] = segments[i].t2;
+    dist[2 * i + 2] = dist[2 * i + 1] + segments[i].int2;
+  }
+  delete[] segments;
 
   // Set the pointers for the output
   *_nvals = count;
   *_tvals = tvals;
   *_dist = dist;
 
-  return len;
+  return dist[count - 1];
 }
 
 class EdgePt {
@@ -269,12 +346,13 @@ TMREdgeMesh::TMREdgeMesh(MPI_Comm _comm, TMREdge *_edge, TMRPoint *_X,
 
     // Allocate an array of the edge points
     EdgePt *epts = new EdgePt[npts];
+    double *t = new double[npts];
+    edge->invEvalPoints(npts, _X, t);
     for (int i = 0; i < npts; i++) {
-      double t;
-      edge->invEvalPoint(_X[i], &t);
       epts[i].p = _X[i];
-      epts[i].t = t;
+      epts[i].t = t[i];
     }
+    delete[] t;
 
     // Sort the edges
     qsort(epts, npts, sizeof(EdgePt), EdgePt::compare);
@@ -328,9 +406,8 @@ void TMREdgeMesh::mesh(TMRMeshOptions options, TMRElementFeatureSize *fs) {
   edge->getSource(&source);
   edge->getCopySource(&copy);
 
-  // Figure out if there is a source edge and whether or not it has
-  // been meshed.
-  npts = -1;
+  // If the edge mesh for the source or copy source does not yet
+  // exist, create it...
   if (source && source != edge) {
     TMREdgeMesh *mesh;
     source->getMesh(&mesh);
@@ -339,11 +416,7 @@ void TMREdgeMesh::mesh(TMRMeshOptions options, TMRElementFeatureSize *fs) {
       mesh->mesh(options, fs);
       source->setMesh(mesh);
     }
-
-    // Retrieve the number of points along the source edge
-    mesh->getMeshPoints(&npts, NULL, NULL);
   } else if (copy && copy != edge) {
-    // Set the edge mesh
     TMREdgeMesh *mesh;
     copy->getMesh(&mesh);
     if (!mesh) {
@@ -351,7 +424,55 @@ void TMREdgeMesh::mesh(TMRMeshOptions options, TMRElementFeatureSize *fs) {
       mesh->mesh(options, fs);
       copy->setMesh(mesh);
     }
+  }
 
+  // Create the mesh on the root processor and broadcast it
+  if (mpi_rank == 0) {
+    meshLocal(options, fs);
+  }
+  if (mpi_size > 1) {
+    broadcastMesh(0);
+  }
+}
+
+/*
+  Create the mesh on this processor only
+
+  If this edge has a source or copy edge, the mesh for the source or
+  copy edge must exist on this processor. The mesh must be
+  distributed to the remaining processors with broadcastMesh().
+*/
+void TMREdgeMesh::meshLocal(TMRMeshOptions options,
+                            TMRElementFeatureSize *fs) {
+  // Check if the mesh has already been allocated
+  if (prescribed_mesh) {
+    return;
+  }
+
+  // Get the source edge
+  TMREdge *source, *copy;
+  edge->getSource(&source);
+  edge->getCopySource(&copy);
+
+  // Figure out if there is a source edge and retrieve the number of
+  // points from its mesh
+  npts = -1;
+  TMREdgeMesh *mesh = NULL;
+  if (source && source != edge) {
+    source->getMesh(&mesh);
+  } else if (copy && copy != edge) {
+    copy->getMesh(&mesh);
+  }
+  if (((source && source != edge) || (copy && copy != edge)) && !mesh) {
+    fprintf(stderr,
+            "TMREdgeMesh Error: Source or copy edge mesh does not exist\n");
+    source = copy = NULL;
+  }
+
+  if (source && source != edge) {
+    // Retrieve the number of points along the source edge
+    mesh->getMeshPoints(&npts, NULL, NULL);
+  } else if (copy && copy != edge) {
     // Retrieve the vertices
     TMRVertex *v1, *v2, *t;
     edge->getVertices(&v1, &v2);
@@ -388,139 +509,187 @@ void TMREdgeMesh::mesh(TMRMeshOptions options, TMRElementFeatureSize *fs) {
     }
   }
 
-  if (mpi_rank == 0) {
-    if (copy && copy != edge) {
-      // Set the edge mesh
-      TMREdgeMesh *mesh;
-      copy->getMesh(&mesh);
+  if (copy && copy != edge) {
+    // Set the edge mesh
+    copy->getMesh(&mesh);
 
-      // Allocate space for the points/x locations
-      pts = new double[npts];
-      X = new TMRPoint[npts];
+    // Allocate space for the points/x locations
+    pts = new double[npts];
+    X = new TMRPoint[npts];
 
-      // Get the orientation of the copy
-      int orient = getEdgeCopyOrient(edge);
-      if (orient == 0) {
-        fprintf(stderr, "TMREdgeMesh Error: Copy edge is not set correctly\n");
-      }
+    // Get the orientation of the copy
+    int orient = getEdgeCopyOrient(edge);
+    if (orient == 0) {
+      fprintf(stderr, "TMREdgeMesh Error: Copy edge is not set correctly\n");
+    }
 
-      int edge_index = mesh->npts - 2;
-      if (orient > 0) {
-        edge_index = 1;
-      }
-      for (int i = 1; i < npts - 1; i++, edge_index += orient) {
-        int icode = edge->invEvalPoint(mesh->X[edge_index], &pts[i]);
-        if (icode) {
-          fprintf(stderr,
-                  "TMREdgeMesh Error: Inverse evaluation failed with code %d\n",
-                  icode);
-        }
-        edge->evalPoint(pts[i], &X[i]);
+    int edge_index = mesh->npts - 2;
+    if (orient > 0) {
+      edge_index = 1;
+    }
+    for (int i = 1; i < npts - 1; i++, edge_index += orient) {
+      int icode = edge->invEvalPoint(mesh->X[edge_index], &pts[i]);
+      if (icode) {
+        fprintf(stderr,
+                "TMREdgeMesh Error: Inverse evaluation failed with code %d\n",
+                icode);
       }
+      edge->evalPoint(pts[i], &X[i]);
+    }
 
-      // Set the end points of the edge
-      double tmin, tmax;
-      edge->getRange(&tmin, &tmax);
-      pts[0] = tmin;
-      pts[npts - 1] = tmax;
-    } else {
-      // Get the limits of integration that will be used
-      double tmin, tmax;
-      edge->getRange(&tmin, &tmax);
-
-      // Get the associated vertices
-      TMRVertex *v1, *v2;
-      edge->getVertices(&v1, &v2);
-
-      if (!edge->isDegenerate()) {
-        // Set the integration error tolerance
-        double integration_eps = 1e-8;
-
-        // Integrate along the curve to obtain the distance function such
-        // that dist(tvals[i]) = int_{tmin}^{tvals[i]} ||d{C(t)}dt||_{2} dt
-        int nvals;
-        double *dist, *tvals;
-        integrateEdge(edge, fs, tmin, tmax, integration_eps, &tvals, &dist,
-                      &nvals);
-
-        // Only compute the number of points if there is no source edge
-        if (npts < 0) {
-          // Compute the number of points along this curve
-          npts = (int)(ceil(dist[nvals - 1]));
-          if (npts < 2) {
-            npts = 2;
-          }
+    // Set the end points of the edge
+    double tmin, tmax;
+    edge->getRange(&tmin, &tmax);
+    pts[0] = tmin;
+    pts[npts - 1] = tmax;
+  } else {
+    // Get the limits of integration that will be used
+    double tmin, tmax;
+    edge->getRange(&tmin, &tmax);
 
-          // If we have an even number of points, increment by one to ensure
-          // that we have an even number of segments along the boundary
-          if (npts % 2 != 1) {
-            npts++;
-          }
+    // Get the associated vertices
+    TMRVertex *v1, *v2;
+    edge->getVertices(&v1, &v2);
 
-          // If the start/end vertex are the same, then the minimum number
-          // of points is 5
-          if ((v1 == v2) && npts < 5) {
-            npts = 5;
-          }
+    if (!edge->isDegenerate()) {
+      // Set the integration error tolerance
+      double integration_eps = 1e-8;
+
+      // Integrate along the curve to obtain the distance function such
+      // that dist(tvals[i]) = int_{tmin}^{tvals[i]} ||d{C(t)}dt||_{2} dt
+      int nvals;
+      double *dist, *tvals;
+      integrateEdge(edge, fs, tmin, tmax, integration_eps, &tvals, &dist,
+                    &nvals);
+
+      // Only compute the number of points if there is no source edge
+      if (npts < 0) {
+        // Compute the number of points along this curve
+        npts = (int)(ceil(dist[nvals - 1]));
+        if (npts < 2) {
+          npts = 2;
+        }
+
+        // If we have an even number of points, increment by one to ensure
+        // that we have an even number of segments along the boundary
+        if (npts % 2 != 1) {
+          npts++;
+        }
+
+        // If the start/end vertex are the same, then the minimum number
+        // of points is 5
+        if ((v1 == v2) && npts < 5) {
+          npts = 5;
         }
+      }
 
-        // The average non-dimensional distance between points
-        double d = dist[nvals - 1] / (npts - 1);
+      // The average non-dimensional distance between points
+      double d = dist[nvals - 1] / (npts - 1);
 
-        // Allocate the parametric points that will be used
-        pts = new double[npts];
+      // Allocate the parametric points that will be used
+      pts = new double[npts];
 
-        // Set the starting/end location of the points
-        pts[0] = tmin;
-        pts[npts - 1] = tmax;
+      // Set the starting/end location of the points
+      pts[0] = tmin;
+      pts[npts - 1] = tmax;
 
-        // Perform the integration so that the points are evenly spaced
-        // along the curve
-        for (int j = 1, k = 1; (j < nvals && k < npts - 1); j++) {
-          while ((k < npts - 1) && (dist[j - 1] <= d * k && d * k < dist[j])) {
-            double u = 0.0;
-            if (dist[j] > dist[j - 1]) {
-              u = (d * k - dist[j - 1]) / (dist[j] - dist[j - 1]);
-            }
-            pts[k] = tvals[j - 1] + (tvals[j] - tvals[j - 1]) * u;
-            k++;
+      // Perform the integration so that the points are evenly spaced
+      // along the curve
+      for (int j = 1, k = 1; (j < nvals && k < npts - 1); j++) {
+        while ((k < npts - 1) && (dist[j - 1] <= d * k && d * k < dist[j])) {
+          double u = 0.0;
+          if (dist[j] > dist[j - 1]) {
+            u = (d * k - dist[j - 1]) / (dist[j] - dist[j - 1]);
           }
+          pts[k] = tvals[j - 1] + (tvals[j] - tvals[j - 1]) * u;
+          k++;
         }
-
-        // Free the integration result
-        delete[] tvals;
-        delete[] dist;
-      } else {
-        // This is a degenerate edge
-        npts = 2;
-        pts = new double[npts];
-        pts[0] = tmin;
-        pts[1] = tmax;
       }
 
-      // Allocate the points
-      X = new TMRPoint[npts];
-      for (int i = 0; i < npts; i++) {
-        edge->evalPoint(pts[i], &X[i]);
-      }
+      // Free the integration result
+      delete[] tvals;
+      delete[] dist;
+    } else {
+      // This is a degenerate edge
+      npts = 2;
+      pts = new double[npts];
+      pts[0] = tmin;
+      pts[1] = tmax;
     }
+
+    // Allocate the points
+    X = new TMRPoint[npts];
+    edge->evalPoints(npts, pts, X);
   }
+}
+
+/*
+  Broadcast the mesh from the root processor to all processors
+*/
+void TMREdgeMesh::broadcastMesh(int root) {
+  // Check if the mesh has already been allocated
+  if (prescribed_mesh) {
+    return;
+  }
+
+  int mpi_rank, mpi_size;
+  MPI_Comm_size(comm, &mpi_size);
+  MPI_Comm_rank(comm, &mpi_rank);
 
   if (mpi_size > 1) {
     // Broadcast the number of points to all the processors
-    MPI_Bcast(&npts, 1, MPI_INT, 0, comm);
+    MPI_Bcast(&npts, 1, MPI_INT, root, comm);
 
-    if (mpi_rank != 0) {
+    if (mpi_rank != root) {
       pts = new double[npts];
       X = new TMRPoint[npts];
     }
 
     // Broadcast the parametric locations and points
-    MPI_Bcast(pts, npts, MPI_DOUBLE, 0, comm);
-    MPI_Bcast(X, npts, TMRPoint_MPI_type, 0, comm);
+    MPI_Bcast(pts, npts, MPI_DOUBLE, root, comm);
+    MPI_Bcast(X, npts, TMRPoint_MPI_type, root, comm);
   }
 }
 
+/*
+  Write the parametric and physical locations of the mesh points to
+  the binary file
+*/
+int TMREdgeMesh::writeMeshData(FILE *fp) {
+  fwrite(&npts, sizeof(int), 1, fp);
+  if (npts > 0) {
+    fwrite(pts, sizeof(double), npts, fp);
+    fwrite(X, sizeof(TMRPoint), npts, fp);
+  }
+  return ferror(fp);
+}
+
+/*
+  Read the mesh points written by writeMeshData(). The mesh can then
+  be distributed to the remaining processors with broadcastMesh().
+*/
+int TMREdgeMesh::readMeshData(FILE *fp) {
+  int n = 0;
+  if (fread(&n, sizeof(int), 1, fp) != 1 || n < 0) {
+    return 1;
+  }
+
+  if (pts) {
+    delete[] pts;
+  }
+  if (X) {
+    delete[] X;
+  }
+  npts = n;
+  pts = new double[npts];
+  X = new TMRPoint[npts];
+  if (fread(pts, sizeof(double), npts, fp) != (size_t)npts ||
+      fread(X, sizeof(TMRPoint), npts, fp) != (size_t)npts) {
+    return 1;
+  }
+  return 0;
+}
+
 /*
   Order the internal mesh points and return the number of owned points
   that were ordered.
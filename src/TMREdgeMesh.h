@@ -21,6 +21,8 @@
 #ifndef TMR_EDGE_MESH_H
 #define TMR_EDGE_MESH_H
 
+#include <stdio.h>
+
 #include "TMRBase.h"
 #include "TMRMesh.h"
 #include "TMRTopology.h"
@@ -43,6 +45,14 @@ class TMREdgeMesh : public TMREntity {
   // Mesh the geometric object
   void mesh(TMRMeshOptions options, TMRElementFeatureSize *fs);
 
+  // Mesh on this processor only, then distribute the mesh from the root
+  void meshLocal(TMRMeshOptions options, TMRElementFeatureSize *fs);
+  void broadcastMesh(int root);
+
+  // Write and read the mesh data so that the mesh can be re-used
+  int writeMeshData(FILE *fp);
+  int readMeshData(FILE *fp);
+
   // Order the mesh points uniquely
   int setNodeNums(int *num);
   int getNodeNums(const int **_vars);
@@ -23,6 +23,8 @@
 #include <math.h>
 #include <stdio.h>
 
+#include <queue>
+
 #include "TMRMesh.h"
 #include "TMRMeshSmoothing.h"
 #include "TMRNativeTopology.h"
@@ -51,6 +53,124 @@ const int tri_edge_nodes[][2] = {{1, 2}, {2, 0}, {0, 1}};
 */
 const int tri_node_edges[][2] = {{1, 2}, {0, 2}, {0, 1}};
 
+/*
+  Evaluate the physical locations of a set of points on the face from
+  the interleaved (u, v) parameter values in a single batch
+*/
+static int TMR_EvalFacePoints(TMRFace *face, int npts, const double *prm,
+                              TMRPoint *X) {
+  double *u = new double[2 * npts];
+  double *v = &u[npts];
+  for (int i = 0; i < npts; i++) {
+    u[i] = prm[2 * i];
+    v[i] = prm[2 * i + 1];
+  }
+  int fail = face->evalPoints(npts, u, v, X);
+  delete[] u;
+  return fail;
+}
+
+/*
+  Find the interleaved parameter locations of a batch of points on
+  the face
+*/
+static int TMR_InvEvalFacePoints(TMRFace *face, int npts, const TMRPoint *X,
+                                 double *prm) {
+  double *u = new double[2 * npts];
+  double *v = &u[npts];
+  int fail = face->invEvalPoints(npts, X, u, v);
+  for (int i = 0; i < npts; i++) {
+    prm[2 * i] = u[i];
+    prm[2 * i + 1] = v[i];
+  }
+  delete[] u;
+  return fail;
+}
+
+/*
+  Compute the centroid and factor the normal equations for the
+  least-squares fit of the points x, stored with the given dimension.
+  The fit array stores the centroid in the first dim entries, followed
+  by the factored dim x dim normal matrix. A small multiple of the
+  trace is added to the diagonal so that the normal matrix remains
+  non-singular for points that lie in a plane or along a line.
+*/
+static void TMR_FactorBoundaryFit(int dim, int npts, const double *x,
+                                  double *fit, int *ipiv) {
+  double *c = fit;
+  double *N = &fit[dim];
+  memset(fit, 0, dim * (dim + 1) * sizeof(double));
+
+  for (int k = 0; k < npts; k++) {
+    for (int i = 0; i < dim; i++) {
+      c[i] += x[dim * k + i];
+    }
+  }
+  for (int i = 0; i < dim; i++) {
+    c[i] = c[i] / npts;
+  }
+
+  for (int k = 0; k < npts; k++) {
+    for (int j = 0; j < dim; j++) {
+      for (int i = 0; i < dim; i++) {
+        N[i + dim * j] += (x[dim * k + i] - c[i]) * (x[dim * k + j] - c[j]);
+      }
+    }
+  }
+
+  double trace = 0.0;
+  for (int i = 0; i < dim; i++) {
+    trace += N[i * (dim + 1)];
+  }
+  if (trace == 0.0) {
+    trace = 1.0;
+  }
+  for (int i = 0; i < dim; i++) {
+    N[i * (dim + 1)] += 1e-10 * trace;
+  }
+
+  int info;
+  TmrLAPACKdgetrf(&dim, &dim, N, &dim, ipiv, &info);
+}
+
+/*
+  Compute the affine map from the source points xs to the target
+  points xt, given the factored fit of the source points. The target
+  point k corresponds to the source point source_to_target[k]. On
+  exit, the map is xt = ct + M^{T}*(xs - cs).
+*/
+static void TMR_ComputeBoundaryMap(int dim, int npts, const double *xs,
+                                   const double *xt,
+                                   const int *source_to_target, double *fit,
+                                   int *ipiv, double *ct, double *M) {
+  const double *cs = fit;
+  memset(ct, 0, dim * sizeof(double));
+  memset(M, 0, dim * dim * sizeof(double));
+
+  for (int k = 0; k < npts; k++) {
+    for (int i = 0; i < dim; i++) {
+      ct[i] += xt[dim * k + i];
+    }
+  }
+  for (int i = 0; i < dim; i++) {
+    ct[i] = ct[i] / npts;
+  }
+
+  for (int k = 0; k < npts; k++) {
+    int kt = source_to_target[k];
+    for (int j = 0; j < dim; j++) {
+      for (int i = 0; i < dim; i++) {
+        M[i + dim * j] +=
+            (xs[dim * k + i] - cs[i]) * (xt[dim * kt + j] - ct[j]);
+      }
+    }
+  }
+
+  // Solve the normal equations for each component of the target
+  int n = dim, info;
+  TmrLAPACKdgetrs("N", &n, &n, &fit[dim], &n, ipiv, M, &n, &info);
+}
+
 /*
   Returns the index number for the (i, j) node location along
   the structured edge.
@@ -114,6 +234,15 @@ TMRFaceMesh::TMRFaceMesh(MPI_Comm _comm, TMRFace *_face, TMRPoint *_X,
   source_to_target = NULL;
   copy_to_target = NULL;
 
+  // The boundary fits are computed when they are first needed
+  param_fit_computed = 0;
+  phys_fit_computed = 0;
+
+  // Zero the times for each phase of meshing
+  tri_time = 0.0;
+  recombine_time = 0.0;
+  smooth_time = 0.0;
+
   // This is not a prescribed mesh
   prescribed_mesh = 0;
 
@@ -305,9 +434,7 @@ void TMRFaceMesh::setPrescribedMesh(const TMRPoint *_X, int _npts,
 
   // Set the point locations
   pts = new double[2 * num_points];
-  for (int i = 0; i < num_points; i++) {
-    face->invEvalPoint(X[i], &pts[2 * i], &pts[2 * i + 1]);
-  }
+  TMR_InvEvalFacePoints(face, num_points, X, pts);
 }
 
 /*
@@ -323,12 +450,6 @@ void TMRFaceMesh::mesh(TMRMeshOptions options, TMRElementFeatureSize *fs) {
   MPI_Comm_size(comm, &mpi_size);
   MPI_Comm_rank(comm, &mpi_rank);
 
-  // Set the default mesh type
-  TMRFaceMeshType _mesh_type = options.mesh_type_default;
-  if (_mesh_type == TMR_NO_MESH) {
-    _mesh_type = TMR_STRUCTURED;
-  }
-
   // Get the source face and its orientation relative to this
   // face. Note that the source face may be NULL in which case the
   // source orientation is meaningless.
@@ -356,6 +477,41 @@ void TMRFaceMesh::mesh(TMRMeshOptions options, TMRElementFeatureSize *fs) {
     }
   }
 
+  // Create the mesh on the root processor and broadcast it
+  if (mpi_rank == 0) {
+    meshLocal(options, fs);
+  }
+  if (mpi_size > 1) {
+    broadcastMesh(0);
+  }
+}
+
+/*
+  Create the mesh on this processor only
+
+  The edge meshes must exist and, if this face has a source or copy
+  face, the mesh for the source or copy face must exist on this
+  processor. The mesh must be distributed to the remaining processors
+  with broadcastMesh().
+*/
+void TMRFaceMesh::meshLocal(TMRMeshOptions options,
+                            TMRElementFeatureSize *fs) {
+  // Check if the mesh has already been allocated
+  if (prescribed_mesh) {
+    return;
+  }
+
+  // Set the default mesh type
+  TMRFaceMeshType _mesh_type = options.mesh_type_default;
+  if (_mesh_type == TMR_NO_MESH) {
+    _mesh_type = TMR_STRUCTURED;
+  }
+
+  // Get the source and copy faces (if any)
+  TMRFace *source, *copy;
+  face->getSource(NULL, &source);
+  face->getCopySource(NULL, &copy);
+
   // First check if the conditions for a structured mesh are satisfied
   if (_mesh_type == TMR_STRUCTURED) {
     int nloops = face->getNumEdgeLoops();
@@ -410,362 +566,485 @@ void TMRFaceMesh::mesh(TMRMeshOptions options, TMRElementFeatureSize *fs) {
   // Record the mesh type
   mesh_type = _mesh_type;
 
-  if (mpi_rank == 0) {
-    // Count up the number of points and segments from the curves that
-    // bound the surface. Keep track of the number of points = the
-    // number of segments.
-    int total_num_pts = 0;
+  // Count up the number of points and segments from the curves that
+  // bound the surface. Keep track of the number of points = the
+  // number of segments.
+  int total_num_pts = 0;
 
-    // Get the face orientation
-    int face_orient = face->getOrientation();
+  // Get the face orientation
+  int face_orient = face->getOrientation();
 
-    // Keep track of the number of closed loop cycles in the domain
-    int nloops = face->getNumEdgeLoops();
+  // Keep track of the number of closed loop cycles in the domain
+  int nloops = face->getNumEdgeLoops();
 
-    // The number of degenerate edges
-    int num_degen = 0;
+  // The number of degenerate edges
+  int num_degen = 0;
 
-    // Get all of the edges and count up the mesh points
-    for (int k = 0; k < nloops; k++) {
-      TMREdgeLoop *loop;
-      face->getEdgeLoop(k, &loop);
-      int nedges;
-      TMREdge **edges;
-      loop->getEdgeLoop(&nedges, &edges, NULL);
+  // Get all of the edges and count up the mesh points
+  for (int k = 0; k < nloops; k++) {
+    TMREdgeLoop *loop;
+    face->getEdgeLoop(k, &loop);
+    int nedges;
+    TMREdge **edges;
+    loop->getEdgeLoop(&nedges, &edges, NULL);
 
-      for (int i = 0; i < nedges; i++) {
-        // Count whether this edge is degenerate
-        if (edges[i]->isDegenerate()) {
-          num_degen++;
-        }
+    for (int i = 0; i < nedges; i++) {
+      // Count whether this edge is degenerate
+      if (edges[i]->isDegenerate()) {
+        num_degen++;
+      }
 
-        // Check whether the edge mesh exists - it has to!
-        TMREdgeMesh *mesh = NULL;
-        edges[i]->getMesh(&mesh);
-        if (!mesh) {
-          fprintf(stderr, "TMRFaceMesh Error: Edge mesh does not exist\n");
-        }
+      // Check whether the edge mesh exists - it has to!
+      TMREdgeMesh *mesh = NULL;
+      edges[i]->getMesh(&mesh);
+      if (!mesh) {
+        fprintf(stderr, "TMRFaceMesh Error: Edge mesh does not exist\n");
+      }
 
-        // Get the number of points associated with the curve
-        int npts;
-        mesh->getMeshPoints(&npts, NULL, NULL);
+      // Get the number of points associated with the curve
+      int npts;
+      mesh->getMeshPoints(&npts, NULL, NULL);
 
-        // Update the total number of points
-        total_num_pts += npts - 1;
-      }
+      // Update the total number of points
+      total_num_pts += npts - 1;
     }
+  }
 
-    // The number of holes is equal to the number of loops-1. One loop
-    // bounds the domain, the other loops cut out holes in the domain.
-    // Note that the domain must be contiguous.
-    int nholes = nloops - 1;
+  // The number of holes is equal to the number of loops-1. One loop
+  // bounds the domain, the other loops cut out holes in the domain.
+  // Note that the domain must be contiguous.
+  int nholes = nloops - 1;
 
-    // All the boundary loops are closed, therefore, the total number
-    // of segments is equal to the total number of points
-    int nsegs = total_num_pts;
+  // All the boundary loops are closed, therefore, the total number
+  // of segments is equal to the total number of points
+  int nsegs = total_num_pts;
 
-    // Set the maximum number of extra segments that will be added to
-    // handle problematic corners
-    const int max_extra_segs = 128;
-    const int max_extra_pts = 128;
+  // Set the maximum number of extra segments that will be added to
+  // handle problematic corners
+  const int max_extra_segs = 128;
+  const int max_extra_pts = 128;
 
-    // Keep track of the beginning/end of each llop
-    int *loop_pt_offset = new int[nloops + 1];
+  // Keep track of the beginning/end of each llop
+  int *loop_pt_offset = new int[nloops + 1];
 
-    // Allocate the points and the number of segments based on the
-    // number of holes
-    double *params = new double[2 * (total_num_pts + nholes + max_extra_pts)];
-    int *segments = new int[2 * (nsegs + max_extra_segs)];
+  // Allocate the points and the number of segments based on the
+  // number of holes
+  double *params = new double[2 * (total_num_pts + nholes + max_extra_pts)];
+  int *segments = new int[2 * (nsegs + max_extra_segs)];
 
-    // Start entering the points from the end of the last hole entry in
-    // the parameter points array.
-    int pt = 0;
+  // Start entering the points from the end of the last hole entry in
+  // the parameter points array.
+  int pt = 0;
 
-    // Set up the degenerate edges
-    int *degen = NULL;
-    if (num_degen > 0) {
-      degen = new int[2 * num_degen];
-    }
-    num_degen = 0;
+  // Set up the degenerate edges
+  int *degen = NULL;
+  if (num_degen > 0) {
+    degen = new int[2 * num_degen];
+  }
+  num_degen = 0;
 
-    for (int k = 0; k < nloops; k++) {
-      // Set the offset to the initial point/segment on this loop
-      loop_pt_offset[k] = pt;
+  for (int k = 0; k < nloops; k++) {
+    // Set the offset to the initial point/segment on this loop
+    loop_pt_offset[k] = pt;
 
-      // Get the curve information for this loop segment
-      TMREdgeLoop *loop;
-      face->getEdgeLoop(k, &loop);
-      int nedges;
-      TMREdge **edges;
-      const int *edge_orient;
-      loop->getEdgeLoop(&nedges, &edges, &edge_orient);
+    // Get the curve information for this loop segment
+    TMREdgeLoop *loop;
+    face->getEdgeLoop(k, &loop);
+    int nedges;
+    TMREdge **edges;
+    const int *edge_orient;
+    loop->getEdgeLoop(&nedges, &edges, &edge_orient);
 
-      int edge_index = nedges - 1;
-      if (face_orient > 0) {
-        edge_index = 0;
-      }
+    int edge_index = nedges - 1;
+    if (face_orient > 0) {
+      edge_index = 0;
+    }
 
-      for (int i = 0; i < nedges; i++, edge_index += face_orient) {
-        // Retrieve the underlying curve mesh
-        TMREdge *edge = edges[edge_index];
-        TMREdgeMesh *mesh = NULL;
-        edge->getMesh(&mesh);
+    for (int i = 0; i < nedges; i++, edge_index += face_orient) {
+      // Retrieve the underlying curve mesh
+      TMREdge *edge = edges[edge_index];
+      TMREdgeMesh *mesh = NULL;
+      edge->getMesh(&mesh);
 
-        // Get the mesh points corresponding to this curve
-        int npts;
-        const double *tpts;
-        mesh->getMeshPoints(&npts, &tpts, NULL);
+      // Get the mesh points corresponding to this curve
+      int npts;
+      const double *tpts;
+      mesh->getMeshPoints(&npts, &tpts, NULL);
 
-        // Get the orientation of the edge
-        int orientation = face_orient * edge_orient[edge_index];
+      // Get the orientation of the edge
+      int orientation = face_orient * edge_orient[edge_index];
 
-        int index = npts - 1;
-        if (orientation > 0) {
-          index = 0;
-        }
+      int index = npts - 1;
+      if (orientation > 0) {
+        index = 0;
+      }
 
-        for (int j = 0; j < npts - 1; j++, index += orientation) {
-          int info =
-              edge->getParamsOnFace(face, tpts[index], edge_orient[edge_index],
-                                    &params[2 * pt], &params[2 * pt + 1]);
-          if (info != 0) {
-            fprintf(stderr,
-                    "TMRFaceMesh Error: getParamsOnFace "
-                    "failed with error code %d\n",
-                    info);
-          } else {
-            segments[2 * pt] = pt;
-            segments[2 * pt + 1] = pt + 1;
-            if (edge->isDegenerate()) {
-              degen[2 * num_degen] = pt;
-              degen[2 * num_degen + 1] = pt + 1;
-              num_degen++;
-            }
-            pt++;
+      for (int j = 0; j < npts - 1; j++, index += orientation) {
+        int info =
+            edge->getParamsOnFace(face, tpts[index], edge_orient[edge_index],
+                                  &params[2 * pt], &params[2 * pt + 1]);
+        if (info != 0) {
+          fprintf(stderr,
+                  "TMRFaceMesh Error: getParamsOnFace "
+                  "failed with error code %d\n",
+                  info);
+        } else {
+          segments[2 * pt] = pt;
+          segments[2 * pt + 1] = pt + 1;
+          if (edge->isDegenerate()) {
+            degen[2 * num_degen] = pt;
+            degen[2 * num_degen + 1] = pt + 1;
+            num_degen++;
           }
+          pt++;
         }
       }
-
-      // Close off the loop by connecting the segment back to the
-      // initial loop point
-      segments[2 * (pt - 1) + 1] = loop_pt_offset[k];
     }
 
-    // Set the last loop
-    loop_pt_offset[nloops] = pt;
+    // Close off the loop by connecting the segment back to the
+    // initial loop point
+    segments[2 * (pt - 1) + 1] = loop_pt_offset[k];
+  }
 
-    // Set the total number of fixed points. These are the points that
-    // will not be smoothed and constitute the boundary nodes. Note
-    // that the Triangularize class removes the holes from the domain
-    // automatically.  The boundary points are guaranteed to be
-    // ordered first.
-    num_fixed_pts = total_num_pts - num_degen;
+  // Set the last loop
+  loop_pt_offset[nloops] = pt;
 
-    if (source) {
-      mapSourceToTarget(options, params);
-    } else if (copy) {
-      mapCopyToTarget(options, params);
-    } else if (mesh_type == TMR_STRUCTURED) {
-      createStructuredMesh(options, params);
-    } else if (mesh_type == TMR_TRIANGLE) {
-      // Compute hole points (inside the holes)
-      computeHolePts(nloops, total_num_pts, loop_pt_offset, segments, params);
-
-      // Create an unstructured triangular mesh
-      createUnstructuredMesh(options, fs, mesh_type, total_num_pts, nholes,
-                             params, nsegs, segments, num_degen, degen,
-                             &num_points, &pts, &X, &num_quads, &quads,
-                             &num_tris, &tris);
-    } else if (mesh_type == TMR_UNSTRUCTURED) {
-      // Loop over the segments in the mesh to find corners
-      // with angles less than 60 degrees. These corners will be
-      // cut and replaced with a specified quadrilateral corner pattern
-
-      // Evaluate all of the points around the edge
-      TMRPoint *Xparam = new TMRPoint[total_num_pts];
-      for (int i = 0; i < total_num_pts; i++) {
-        face->evalPoint(params[2 * i], params[2 * i + 1], &Xparam[i]);
-      }
-
-      // Go through the edge loops and find corners that will be problematic
-      // for the quadrilateral mesh generator. Add extra segments
-      // to alleviate the meshing issues in these corners.
-      for (int loop = 0; loop < nloops; loop++) {
-        for (int p = loop_pt_offset[loop]; p < loop_pt_offset[loop + 1];) {
-          int incr = 1;
-          int next = p + 1;
-          int prev = p - 1;
-          if (next >= loop_pt_offset[loop + 1]) {
-            next = loop_pt_offset[loop];
-          }
-          if (prev < loop_pt_offset[loop]) {
-            prev = loop_pt_offset[loop + 1] - 1;
-          }
+  // Set the total number of fixed points. These are the points that
+  // will not be smoothed and constitute the boundary nodes. Note
+  // that the Triangularize class removes the holes from the domain
+  // automatically.  The boundary points are guaranteed to be
+  // ordered first.
+  num_fixed_pts = total_num_pts - num_degen;
 
-          // Compute the difference
-          TMRPoint d1, d2;
-          d1.x = Xparam[p].x - Xparam[prev].x;
-          d1.y = Xparam[p].y - Xparam[prev].y;
-          d1.z = Xparam[p].z - Xparam[prev].z;
-          d2.x = Xparam[next].x - Xparam[p].x;
-          d2.y = Xparam[next].y - Xparam[p].y;
-          d2.z = Xparam[next].z - Xparam[p].z;
-
-          // Compute the dot product of the two vectors
-          double d1dist = sqrt(d1.dot(d1));
-          double d2dist = sqrt(d2.dot(d2));
-          double dot = -d1.dot(d2) / (d1dist * d2dist);
-
-          // If the dot product is such that the angle is
-          // less than about 75 degrees, add segments to ensure
-          // that elements are created on either side of the segment
-          if (dot > 0.25) {
-            // Set the first point in the new segment list
-            segments[2 * nsegs] = pt;
-            segments[2 * nsegs + 1] = pt + 1;
-            nsegs++;
-
-            // Insert the new point
-            TMRPoint Xmid;
+  if (source) {
+    mapSourceToTarget(options, params);
+  } else if (copy) {
+    mapCopyToTarget(options, params);
+  } else if (mesh_type == TMR_STRUCTURED) {
+    createStructuredMesh(options, params);
+  } else if (mesh_type == TMR_TRIANGLE) {
+    // Compute hole points (inside the holes)
+    computeHolePts(nloops, total_num_pts, loop_pt_offset, segments, params);
+
+    // Create an unstructured triangular mesh
+    createUnstructuredMesh(options, fs, mesh_type, total_num_pts, nholes,
+                           params, nsegs, segments, num_degen, degen,
+                           &num_points, &pts, &X, &num_quads, &quads,
+                           &num_tris, &tris);
+  } else if (mesh_type == TMR_UNSTRUCTURED) {
+    // Loop over the segments in the mesh to find corners
+    // with angles less than 60 degrees. These corners will be
+    // cut and replaced with a specified quadrilateral corner pattern
+
+    // Evaluate all of the points around the edge
+    TMRPoint *Xparam = new TMRPoint[total_num_pts];
+    TMR_EvalFacePoints(face, total_num_pts, params, Xparam);
+
+    // Go through the edge loops and find corners that will be problematic
+    // for the quadrilateral mesh generator. Add extra segments
+    // to alleviate the meshing issues in these corners.
+    for (int loop = 0; loop < nloops; loop++) {
+      for (int p = loop_pt_offset[loop]; p < loop_pt_offset[loop + 1];) {
+        int incr = 1;
+        int next = p + 1;
+        int prev = p - 1;
+        if (next >= loop_pt_offset[loop + 1]) {
+          next = loop_pt_offset[loop];
+        }
+        if (prev < loop_pt_offset[loop]) {
+          prev = loop_pt_offset[loop + 1] - 1;
+        }
+
+        // Compute the difference
+        TMRPoint d1, d2;
+        d1.x = Xparam[p].x - Xparam[prev].x;
+        d1.y = Xparam[p].y - Xparam[prev].y;
+        d1.z = Xparam[p].z - Xparam[prev].z;
+        d2.x = Xparam[next].x - Xparam[p].x;
+        d2.y = Xparam[next].y - Xparam[p].y;
+        d2.z = Xparam[next].z - Xparam[p].z;
+
+        // Compute the dot product of the two vectors
+        double d1dist = sqrt(d1.dot(d1));
+        double d2dist = sqrt(d2.dot(d2));
+        double dot = -d1.dot(d2) / (d1dist * d2dist);
+
+        // If the dot product is such that the angle is
+        // less than about 75 degrees, add segments to ensure
+        // that elements are created on either side of the segment
+        if (dot > 0.25) {
+          // Set the first point in the new segment list
+          segments[2 * nsegs] = pt;
+          segments[2 * nsegs + 1] = pt + 1;
+          nsegs++;
+
+          // Insert the new point
+          TMRPoint Xmid;
+          Xmid.x = 0.5 * (Xparam[next].x + Xparam[prev].x);
+          Xmid.y = 0.5 * (Xparam[next].y + Xparam[prev].y);
+          Xmid.z = 0.5 * (Xparam[next].z + Xparam[prev].z);
+
+          face->invEvalPoint(Xmid, &params[2 * pt], &params[2 * pt + 1]);
+          pt++;
+
+          const int max_new_corner_segments = 4;
+          for (int i = 0; i < max_new_corner_segments; i++) {
+            // Increment the pointers to the next/previous index
+            next++;
+            prev--;
+            if (next >= loop_pt_offset[loop + 1]) {
+              next = loop_pt_offset[loop];
+            }
+            if (prev < loop_pt_offset[loop]) {
+              prev = loop_pt_offset[loop + 1] - 1;
+            }
+
+            // Compute the mid-point
             Xmid.x = 0.5 * (Xparam[next].x + Xparam[prev].x);
             Xmid.y = 0.5 * (Xparam[next].y + Xparam[prev].y);
             Xmid.z = 0.5 * (Xparam[next].z + Xparam[prev].z);
 
+            // Find the mid-point in the parametric space
             face->invEvalPoint(Xmid, &params[2 * pt], &params[2 * pt + 1]);
             pt++;
 
-            const int max_new_corner_segments = 4;
-            for (int i = 0; i < max_new_corner_segments; i++) {
-              // Increment the pointers to the next/previous index
-              next++;
-              prev--;
-              if (next >= loop_pt_offset[loop + 1]) {
-                next = loop_pt_offset[loop];
-              }
-              if (prev < loop_pt_offset[loop]) {
-                prev = loop_pt_offset[loop + 1] - 1;
-              }
-
-              // Compute the mid-point
-              Xmid.x = 0.5 * (Xparam[next].x + Xparam[prev].x);
-              Xmid.y = 0.5 * (Xparam[next].y + Xparam[prev].y);
-              Xmid.z = 0.5 * (Xparam[next].z + Xparam[prev].z);
-
-              // Find the mid-point in the parametric space
-              face->invEvalPoint(Xmid, &params[2 * pt], &params[2 * pt + 1]);
-              pt++;
-
-              // Find the vector between the two points on the boundary
-              TMRPoint d3;
-              d3.x = Xparam[next].x - Xparam[prev].x;
-              d3.y = Xparam[next].y - Xparam[prev].y;
-              d3.z = Xparam[next].z - Xparam[prev].z;
-
-              // If the distance between the next/prev values
-              // is less than
-              double d3dist = sqrt(d3.dot(d3));
-              if (d3dist > 0.75 * (d1dist + d2dist)) {
-                break;
-              } else if (i + 1 < max_new_corner_segments) {
-                // Add the next segment
-                segments[2 * nsegs] = pt - 1;
-                segments[2 * nsegs + 1] = pt;
-                nsegs++;
-              }
+            // Find the vector between the two points on the boundary
+            TMRPoint d3;
+            d3.x = Xparam[next].x - Xparam[prev].x;
+            d3.y = Xparam[next].y - Xparam[prev].y;
+            d3.z = Xparam[next].z - Xparam[prev].z;
+
+            // If the distance between the next/prev values
+            // is less than
+            double d3dist = sqrt(d3.dot(d3));
+            if (d3dist > 0.75 * (d1dist + d2dist)) {
+              break;
+            } else if (i + 1 < max_new_corner_segments) {
+              // Add the next segment
+              segments[2 * nsegs] = pt - 1;
+              segments[2 * nsegs + 1] = pt;
+              nsegs++;
             }
           }
-
-          p += incr;
         }
+
+        p += incr;
       }
+    }
 
-      // Reset the total number of points
-      total_num_pts = pt;
+    // Reset the total number of points
+    total_num_pts = pt;
 
-      // Compute hole points (inside the holes)
-      computeHolePts(nloops, total_num_pts, loop_pt_offset, segments, params);
+    // Compute hole points (inside the holes)
+    computeHolePts(nloops, total_num_pts, loop_pt_offset, segments, params);
 
-      // Create the unstructured mesh
-      createUnstructuredMesh(options, fs, mesh_type, total_num_pts, nholes,
-                             params, nsegs, segments, num_degen, degen,
-                             &num_points, &pts, &X, &num_quads, &quads,
-                             &num_tris, &tris);
+    // Create the unstructured mesh
+    createUnstructuredMesh(options, fs, mesh_type, total_num_pts, nholes,
+                           params, nsegs, segments, num_degen, degen,
+                           &num_points, &pts, &X, &num_quads, &quads,
+                           &num_tris, &tris);
 
-      // Free the triangles - these are not needed for this type of mesh
-      delete[] tris;
-      num_tris = 0;
-      tris = NULL;
+    // Free the triangles - these are not needed for this type of mesh
+    delete[] tris;
+    num_tris = 0;
+    tris = NULL;
 
-      // Build connectivity to smooth the quad mesh
-      int *pts_to_quad_ptr;
-      int *pts_to_quads;
-      TMR_ComputeNodeToElems(num_points, num_quads, 4, quads, &pts_to_quad_ptr,
-                             &pts_to_quads);
+    // Build connectivity to smooth the quad mesh
+    double t0 = MPI_Wtime();
+    int *pts_to_quad_ptr;
+    int *pts_to_quads;
+    TMR_ComputeNodeToElems(num_points, num_quads, 4, quads, &pts_to_quad_ptr,
+                           &pts_to_quads);
 
-      // Smooth the mesh using a local optimization of node locations
-      TMR_QuadSmoothing(options.num_smoothing_steps, num_fixed_pts, num_points,
-                        pts_to_quad_ptr, pts_to_quads, num_quads, quads, pts, X,
-                        face);
+    // Smooth the mesh using a local optimization of node locations
+    TMR_QuadSmoothing(options.num_smoothing_steps, num_fixed_pts, num_points,
+                      pts_to_quad_ptr, pts_to_quads, num_quads, quads, pts, X,
+                      face);
 
-      // Free the connectivity information
-      delete[] pts_to_quad_ptr;
-      delete[] pts_to_quads;
+    // Free the connectivity information
+    delete[] pts_to_quad_ptr;
+    delete[] pts_to_quads;
+    smooth_time += MPI_Wtime() - t0;
 
-      if (options.write_post_smooth_quad) {
-        char filename[256];
-        snprintf(filename, sizeof(filename), "post_smooth_quad%d.vtk",
-                 face->getEntityId());
-        writeToVTK(filename);
-      }
+    if (options.write_post_smooth_quad) {
+      char filename[256];
+      snprintf(filename, sizeof(filename), "post_smooth_quad%d.vtk",
+               face->getEntityId());
+      writeToVTK(filename);
     }
+  }
 
-    if (num_degen > 0) {
-      delete[] degen;
-    }
+  if (num_degen > 0) {
+    delete[] degen;
+  }
+
+  // Free the parameter/segment information
+  delete[] loop_pt_offset;
+  delete[] params;
+  delete[] segments;
+}
+
+/*
+  Broadcast the mesh from the root processor to all processors
 
-    // Free the parameter/segment information
-    delete[] loop_pt_offset;
-    delete[] params;
-    delete[] segments;
+  input:
+  root:   the rank of the processor that created the mesh
+*/
+void TMRFaceMesh::broadcastMesh(int root) {
+  // Check if the mesh has already been allocated
+  if (prescribed_mesh) {
+    return;
   }
 
+  int mpi_rank, mpi_size;
+  MPI_Comm_size(comm, &mpi_size);
+  MPI_Comm_rank(comm, &mpi_rank);
+
+  TMRFace *source, *copy;
+  face->getSource(NULL, &source);
+  face->getCopySource(NULL, &copy);
+
   if (mpi_size > 1) {
-    // Broadcast the number of points to all the processors
-    int temp[3];
-    temp[0] = num_points;
-    temp[1] = num_quads;
-    temp[2] = num_fixed_pts;
-    MPI_Bcast(temp, 3, MPI_INT, 0, comm);
-    num_points = temp[0];
-    num_quads = temp[1];
-    num_fixed_pts = temp[2];
-
-    if (mpi_rank != 0) {
+    // Broadcast the mesh type and the number of points to all the
+    // processors
+    int temp[5];
+    temp[0] = mesh_type;
+    temp[1] = num_points;
+    temp[2] = num_quads;
+    temp[3] = num_tris;
+    temp[4] = num_fixed_pts;
+    MPI_Bcast(temp, 5, MPI_INT, root, comm);
+    mesh_type = (TMRFaceMeshType)temp[0];
+    num_points = temp[1];
+    num_quads = temp[2];
+    num_tris = temp[3];
+    num_fixed_pts = temp[4];
+
+    if (mpi_rank != root) {
       pts = new double[2 * num_points];
       X = new TMRPoint[num_points];
-      quads = new int[4 * num_quads];
+      if (num_quads > 0) {
+        quads = new int[4 * num_quads];
+      }
+      if (num_tris > 0) {
+        tris = new int[3 * num_tris];
+      }
     }
 
     // Broadcast the parametric locations and points
-    MPI_Bcast(pts, 2 * num_points, MPI_DOUBLE, 0, comm);
-    MPI_Bcast(X, num_points, TMRPoint_MPI_type, 0, comm);
-    MPI_Bcast(quads, 4 * num_quads, MPI_INT, 0, comm);
+    MPI_Bcast(pts, 2 * num_points, MPI_DOUBLE, root, comm);
+    MPI_Bcast(X, num_points, TMRPoint_MPI_type, root, comm);
+    if (num_quads > 0) {
+      MPI_Bcast(quads, 4 * num_quads, MPI_INT, root, comm);
+    }
+    if (num_tris > 0) {
+      MPI_Bcast(tris, 3 * num_tris, MPI_INT, root, comm);
+    }
 
     // Broadcast the source to target information
     if (source) {
-      if (mpi_rank != 0) {
+      if (mpi_rank != root) {
         source_to_target = new int[num_points];
       }
-      MPI_Bcast(source_to_target, num_points, MPI_INT, 0, comm);
+      MPI_Bcast(source_to_target, num_points, MPI_INT, root, comm);
     } else if (copy) {
-      if (mpi_rank != 0) {
+      if (mpi_rank != root) {
         copy_to_target = new int[num_points];
       }
-      MPI_Bcast(copy_to_target, num_points, MPI_INT, 0, comm);
+      MPI_Bcast(copy_to_target, num_points, MPI_INT, root, comm);
     }
   }
 }
 
+/*
+  Write the mesh type, the points and the connectivity of the surface
+  mesh to the binary file
+*/
+int TMRFaceMesh::writeMeshData(FILE *fp) {
+  int temp[7];
+  temp[0] = mesh_type;
+  temp[1] = num_points;
+  temp[2] = num_quads;
+  temp[3] = num_tris;
+  temp[4] = num_fixed_pts;
+  temp[5] = (source_to_target != NULL);
+  temp[6] = (copy_to_target != NULL);
+  fwrite(temp, sizeof(int), 7, fp);
+
+  fwrite(pts, sizeof(double), 2 * num_points, fp);
+  fwrite(X, sizeof(TMRPoint), num_points, fp);
+  if (num_quads > 0) {
+    fwrite(quads, sizeof(int), 4 * num_quads, fp);
+  }
+  if (num_tris > 0) {
+    fwrite(tris, sizeof(int), 3 * num_tris, fp);
+  }
+  if (source_to_target) {
+    fwrite(source_to_target, sizeof(int), num_points, fp);
+  }
+  if (copy_to_target) {
+    fwrite(copy_to_target, sizeof(int), num_points, fp);
+  }
+
+  return ferror(fp);
+}
+
+/*
+  Read the surface mesh written by writeMeshData(). The mesh can then
+  be distributed to the remaining processors with broadcastMesh().
+*/
+int TMRFaceMesh::readMeshData(FILE *fp) {
+  int temp[7];
+  if (fread(temp, sizeof(int), 7, fp) != 7 || temp[1] < 0 || temp[2] < 0 ||
+      temp[3] < 0 || temp[4] < 0 || temp[4] > temp[1]) {
+    return 1;
+  }
+
+  // The source and copy mappings must match the face
+  TMRFace *source, *copy;
+  face->getSource(NULL, &source);
+  face->getCopySource(NULL, &copy);
+  if ((source != NULL) != (temp[5] != 0) ||
+      (!source && (copy != NULL) != (temp[6] != 0))) {
+    return 1;
+  }
+
+  mesh_type = (TMRFaceMeshType)temp[0];
+  num_points = temp[1];
+  num_quads = temp[2];
+  num_tris = temp[3];
+  num_fixed_pts = temp[4];
+
+  pts = new double[2 * num_points];
+  X = new TMRPoint[num_points];
+  int fail =
+      (fread(pts, sizeof(double), 2 * num_points, fp) !=
+           (size_t)(2 * num_points) ||
+       fread(X, sizeof(TMRPoint), num_points, fp) != (size_t)num_points);
+  if (num_quads > 0) {
+    quads = new int[4 * num_quads];
+    fail = fail || (fread(quads, sizeof(int), 4 * num_quads, fp) !=
+                    (size_t)(4 * num_quads));
+  }
+  if (num_tris > 0) {
+    tris = new int[3 * num_tris];
+    fail = fail || (fread(tris, sizeof(int), 3 * num_tris, fp) !=
+                    (size_t)(3 * num_tris));
+  }
+  if (temp[5]) {
+    source_to_target = new int[num_points];
+    fail = fail || (fread(source_to_target, sizeof(int), num_points, fp) !=
+                    (size_t)num_points);
+  }
+  if (temp[6]) {
+    copy_to_target = new int[num_points];
+    fail = fail || (fread(copy_to_target, sizeof(int), num_points, fp) !=
+                    (size_t)num_points);
+  }
+
+  return fail;
+}
+
 /*
   Compute the areas and set the hole point locations
 */
@@ -816,6 +1095,39 @@ void TMRFaceMesh::computeHolePts(const int nloops, int hole_pt,
   }
 }
 
+/*
+  Get the least-squares fit of the boundary points of this mesh in the
+  parameter space (dim = 2) or in physical space (dim = 3).
+
+  The fit only depends on the boundary of this mesh, so it is computed
+  the first time it is requested and then shared by all of the target
+  faces that use this mesh as a source or copy source.
+*/
+void TMRFaceMesh::getBoundaryFit(int dim, double **fit, int **ipiv) {
+  if (dim == 2) {
+    if (!param_fit_computed) {
+      TMR_FactorBoundaryFit(2, num_fixed_pts, pts, param_fit, param_fit_ipiv);
+      param_fit_computed = 1;
+    }
+    *fit = param_fit;
+    *ipiv = param_fit_ipiv;
+  } else {
+    if (!phys_fit_computed) {
+      double *x = new double[3 * num_fixed_pts];
+      for (int i = 0; i < num_fixed_pts; i++) {
+        x[3 * i] = X[i].x;
+        x[3 * i + 1] = X[i].y;
+        x[3 * i + 2] = X[i].z;
+      }
+      TMR_FactorBoundaryFit(3, num_fixed_pts, x, phys_fit, phys_fit_ipiv);
+      phys_fit_computed = 1;
+      delete[] x;
+    }
+    *fit = phys_fit;
+    *ipiv = phys_fit_ipiv;
+  }
+}
+
 /*
   Map the source mesh to the target mesh (this is the target mesh)
 
@@ -1009,52 +1321,18 @@ void TMRFaceMesh::mapSourceToTarget(TMRMeshOptions options,
   }
 
   // Compute a least squares transformation between the two
-  // surfaces
-  double N[16], A[4];
-  double sc[2], tc[3];
-  memset(N, 0, 16 * sizeof(double));
-  memset(A, 0, 4 * sizeof(double));
-  sc[0] = sc[1] = 0.0;
-  tc[0] = tc[1] = 0.0;
-
-  for (int k = 0; k < num_fixed_pts; k++) {
-    sc[0] += source_face_mesh->pts[2 * k];
-    sc[1] += source_face_mesh->pts[2 * k + 1];
-    tc[0] += pts[2 * k];
-    tc[1] += pts[2 * k + 1];
-  }
-  sc[0] = sc[0] / num_fixed_pts;
-  sc[1] = sc[1] / num_fixed_pts;
-  tc[0] = tc[0] / num_fixed_pts;
-  tc[1] = tc[1] / num_fixed_pts;
-
-  for (int k = 0; k < num_fixed_pts; k++) {
-    double uS[2], uT[2];
-    uS[0] = source_face_mesh->pts[2 * k] - sc[0];
-    uS[1] = source_face_mesh->pts[2 * k + 1] - sc[1];
-
-    // Compute the source->target index number
-    int kt = source_to_target[k];
-    uT[0] = pts[2 * kt] - tc[0];
-    uT[1] = pts[2 * kt + 1] - tc[1];
-
-    // Add the terms to the matrix/right-hand-side
-    for (int i = 0; i < 4; i++) {
-      int start = i / 2, end = i / 2 + 1;
-      for (int j = 2 * start; j < 2 * end; j++) {
-        N[i + 4 * j] += uS[i % 2] * uS[j % 2];
-      }
-      A[i] += uS[i % 2] * uT[i / 2];
-    }
-  }
+  // surfaces. The factored fit of the source boundary is shared by
+  // all of the targets of the source face.
+  double *fit;
+  int *ipiv;
+  source_face_mesh->getBoundaryFit(2, &fit, &ipiv);
 
-  // Factor the least-squares matrix and perform the transformation
-  int ipiv[4];
-  int n = 4, one = 1, info;
-  TmrLAPACKdgetrf(&n, &n, N, &n, ipiv, &info);
-  TmrLAPACKdgetrs("N", &n, &one, N, &n, ipiv, A, &n, &info);
+  double tc[2], A[4];
+  TMR_ComputeBoundaryMap(2, num_fixed_pts, source_face_mesh->pts, pts,
+                         source_to_target, fit, ipiv, tc, A);
 
   // Set the interior points based on the linear transformation
+  const double *sc = fit;
   for (int k = num_fixed_pts; k < num_points; k++) {
     double uS = source_face_mesh->pts[2 * k] - sc[0];
     double vS = source_face_mesh->pts[2 * k + 1] - sc[1];
@@ -1111,10 +1389,9 @@ void TMRFaceMesh::mapSourceToTarget(TMRMeshOptions options,
 
   // Evaluate the points
   X = new TMRPoint[num_points];
-  for (int i = 0; i < num_points; i++) {
-    face->evalPoint(pts[2 * i], pts[2 * i + 1], &X[i]);
-  }
+  TMR_EvalFacePoints(face, num_points, pts, X);
 
+  double t0 = MPI_Wtime();
   if (num_quads > 0) {
     // Smooth the copied mesh on the new surface
     int *pts_to_quad_ptr;
@@ -1152,12 +1429,14 @@ void TMRFaceMesh::mapSourceToTarget(TMRMeshOptions options,
     delete[] tri_neighbors;
     delete[] dual_edges;
   }
+  smooth_time += MPI_Wtime() - t0;
 }
 
 /*
-  Copy the mesh from the source copy mesh to this mesh. Use inverse
-  evaluations to determine the parametric locations of the new mesh
-  points.
+  Copy the mesh from the source copy mesh to this mesh. The interior
+  points are first placed with the affine map between the boundaries
+  of the two faces, and then a batch of inverse evaluations projects
+  them onto this face to determine their parametric locations.
 */
 int TMRFaceMesh::mapCopyToTarget(TMRMeshOptions options, const double *params) {
   // Get the face orientation
@@ -1289,10 +1568,8 @@ int TMRFaceMesh::mapCopyToTarget(TMRMeshOptions options, const double *params) {
     pts[2 * i + 1] = params[2 * i + 1];
   }
 
-  // Set the edge locations using the locations on the other surface
-  for (int i = 0; i < num_fixed_pts; i++) {
-    X[copy_to_target[i]] = copy_mesh->X[i];
-  }
+  // Evaluate the boundary points on the target face
+  TMR_EvalFacePoints(face, num_fixed_pts, pts, X);
 
   // Compute the relative orientations of the faces
   int orient = rel_orient * face->getOrientation() * copy->getOrientation();
@@ -1399,9 +1676,7 @@ int TMRFaceMesh::mapCopyToTarget(TMRMeshOptions options, const double *params) {
     }
 
     // Allocate and evaluate the new physical point locations
-    for (int i = 0; i < num_points; i++) {
-      face->evalPoint(pts[2 * i], pts[2 * i + 1], &X[i]);
-    }
+    TMR_EvalFacePoints(face, num_points, pts, X);
 
     double atol = 1e-6;
     for (int i = 0; i < num_points; i++) {
@@ -1461,24 +1736,58 @@ int TMRFaceMesh::mapCopyToTarget(TMRMeshOptions options, const double *params) {
   } else {
     for (int i = num_fixed_pts; i < num_points; i++) {
       copy_to_target[i] = i;
-      X[i] = copy_mesh->X[i];
-      double u, v;
-      int icode = face->invEvalPoint(X[i], &u, &v);
-      if (icode) {
-        fprintf(stderr,
-                "TMRFaceMesh Error: Inverse point evaluation "
-                "failed with code %d\n",
-                icode);
-      }
+    }
 
-      // Set the target index
-      pts[2 * i] = u;
-      pts[2 * i + 1] = v;
-      face->evalPoint(u, v, &X[i]);
+    // Compute the affine map from the boundary of the copy source to
+    // the boundary of the target. The factored fit of the copy source
+    // boundary is shared by all of the targets of the copy source.
+    double *fit;
+    int *ipiv;
+    copy_mesh->getBoundaryFit(3, &fit, &ipiv);
+
+    double *xc = new double[6 * num_fixed_pts];
+    double *xt = &xc[3 * num_fixed_pts];
+    for (int i = 0; i < num_fixed_pts; i++) {
+      xc[3 * i] = copy_mesh->X[i].x;
+      xc[3 * i + 1] = copy_mesh->X[i].y;
+      xc[3 * i + 2] = copy_mesh->X[i].z;
+      xt[3 * i] = X[i].x;
+      xt[3 * i + 1] = X[i].y;
+      xt[3 * i + 2] = X[i].z;
     }
 
+    double tc[3], A[9];
+    TMR_ComputeBoundaryMap(3, num_fixed_pts, xc, xt, copy_to_target, fit,
+                           ipiv, tc, A);
+    delete[] xc;
+
+    // Map the interior points of the copy source to the target
+    const double *sc = fit;
+    for (int i = num_fixed_pts; i < num_points; i++) {
+      double d[3];
+      d[0] = copy_mesh->X[i].x - sc[0];
+      d[1] = copy_mesh->X[i].y - sc[1];
+      d[2] = copy_mesh->X[i].z - sc[2];
+      X[i].x = tc[0] + A[0] * d[0] + A[1] * d[1] + A[2] * d[2];
+      X[i].y = tc[1] + A[3] * d[0] + A[4] * d[1] + A[5] * d[2];
+      X[i].z = tc[2] + A[6] * d[0] + A[7] * d[1] + A[8] * d[2];
+    }
+
+    // Project the mapped points onto the target face to correct for
+    // the difference between the affine map and the target surface
+    int num_copy_pts = num_points - num_fixed_pts;
+    int icode = TMR_InvEvalFacePoints(face, num_copy_pts, &X[num_fixed_pts],
+                                      &pts[2 * num_fixed_pts]);
+    if (icode) {
+      fprintf(stderr,
+              "TMRFaceMesh Error: Inverse point evaluation "
+              "failed with code %d\n",
+              icode);
+    }
+    TMR_EvalFacePoints(face, num_copy_pts, &pts[2 * num_fixed_pts],
+                       &X[num_fixed_pts]);
+
     // Copy over the quadrilaterals
-    quads = new int[4 * num_quads];
     for (int i = 0; i < 4 * num_quads; i++) {
       quads[i] = copy_to_target[copy_mesh->quads[i]];
     }
@@ -1611,12 +1920,11 @@ void TMRFaceMesh::createStructuredMesh(TMRMeshOptions options,
 
   // Allocate and evaluate the new physical point locations
   X = new TMRPoint[num_points];
-  for (int i = 0; i < num_points; i++) {
-    face->evalPoint(pts[2 * i], pts[2 * i + 1], &X[i]);
-  }
+  TMR_EvalFacePoints(face, num_points, pts, X);
 
   if (num_quads > 0) {
     // Smooth the copied mesh on the new surface
+    double t0 = MPI_Wtime();
     int *pts_to_quad_ptr;
     int *pts_to_quads;
     TMR_ComputeNodeToElems(num_points, num_quads, 4, quads, &pts_to_quad_ptr,
@@ -1630,6 +1938,7 @@ void TMRFaceMesh::createStructuredMesh(TMRMeshOptions options,
     // Free the connectivity information
     delete[] pts_to_quad_ptr;
     delete[] pts_to_quads;
+    smooth_time += MPI_Wtime() - t0;
   }
 }
 
@@ -1665,7 +1974,9 @@ void TMRFaceMesh::createUnstructuredMesh(
   }
 
   // Create the mesh using the frontal algorithm
+  double t0 = MPI_Wtime();
   tri->frontal(options, fs);
+  tri_time += MPI_Wtime() - t0;
 
   // Free the degenerate triangles and reorder the mesh
   if (num_degen > 0) {
@@ -1696,6 +2007,7 @@ void TMRFaceMesh::createUnstructuredMesh(
                               &node_to_tri_ptr, &node_to_tris);
 
     // Smooth the resulting triangular mesh
+    t0 = MPI_Wtime();
     if (options.tri_smoothing_type == TMRMeshOptions::TMR_LAPLACIAN) {
       TMR_LaplacianSmoothing(options.num_smoothing_steps, num_fixed_pts,
                              num_tri_edges, tri_edges, *npts, *param_pts, *Xpts,
@@ -1706,6 +2018,7 @@ void TMRFaceMesh::createUnstructuredMesh(
                           num_tri_edges, tri_edges, *npts, *param_pts, *Xpts,
                           face);
     }
+    smooth_time += MPI_Wtime() - t0;
 
     if (options.write_post_smooth_triangle) {
       char filename[256];
@@ -1716,6 +2029,7 @@ void TMRFaceMesh::createUnstructuredMesh(
 
     if (mesh_type == TMR_UNSTRUCTURED) {
       // Recombine the mesh into a quadrilateral mesh
+      t0 = MPI_Wtime();
       if (*ntris % 2 == 0) {
         recombine(*ntris, *mesh_tris, tri_neighbors, node_to_tri_ptr,
                   node_to_tris, num_tri_edges, dual_edges, nquads, mesh_quads,
@@ -1728,9 +2042,8 @@ void TMRFaceMesh::createUnstructuredMesh(
 
       // Simplify the new quadrilateral mesh by removing
       // points/quads with poor quality/connectivity
-      for (int k = 0; k < 5; k++) {
-        simplifyQuads(0);
-      }
+      simplifyQuads(0);
+      recombine_time += MPI_Wtime() - t0;
 
       // Free the triangular mesh data
       delete[] tri_edges;
@@ -2467,8 +2780,32 @@ void TMRFaceMesh::recombine(int ntris, const int triangles[],
 
   // Perform the perfect matching
   int *match = new int[ntris / 2];
-  int num_match =
-      TMR_PerfectMatchGraph(ntris, num_dual_edges, graph_edges, weights, match);
+  int num_match = 0;
+  if (options.recombination_type == TMR_GREEDY_MATCHING) {
+    // Only accept edges in the greedy matching that produce quads
+    // with at least the specified quality
+    double quality = options.greedy_recombination_quality;
+    double max_weight = (1.0 - quality) * (1.0 + 1.0 / (quality + eps));
+    num_match = TMR_GreedyMatchGraph(ntris, num_dual_edges, graph_edges,
+                                     weights, max_weight, match);
+  } else if (options.recombination_type == TMR_PATCH_MATCHING &&
+             ntris > options.recombination_patch_size) {
+    // Use the triangle centroids to partition the dual graph
+    double *xpts = new double[3 * ntris];
+    for (int i = 0; i < ntris; i++) {
+      const int *t = &triangles[3 * i];
+      xpts[3 * i] = (X[t[0]].x + X[t[1]].x + X[t[2]].x) / 3.0;
+      xpts[3 * i + 1] = (X[t[0]].y + X[t[1]].y + X[t[2]].y) / 3.0;
+      xpts[3 * i + 2] = (X[t[0]].z + X[t[1]].z + X[t[2]].z) / 3.0;
+    }
+    num_match = TMR_PatchMatchGraph(ntris, num_dual_edges, graph_edges,
+                                    weights, xpts,
+                                    options.recombination_patch_size, match);
+    delete[] xpts;
+  } else {
+    num_match = TMR_PerfectMatchGraph(ntris, num_dual_edges, graph_edges,
+                                      weights, match);
+  }
   delete[] weights;
 
   // The quads formed from the original triangles
@@ -2693,148 +3030,289 @@ void TMRFaceMesh::recombine(int ntris, const int triangles[],
   |    \   /    |         |      |      |
   |     \ /     |         |      |      |
   x ---- x ---- x         x ---- x ---- x
+
+  The candidate configurations are processed from a priority queue:
+  the interior points referred to by only two quads are removed
+  first, followed by the collapsible quads in order of increasing
+  quality. Each operation updates the point to quad lists locally and
+  adds the configurations around the modified points back to the
+  queue, so the simplification continues until no candidates remain.
+  Candidates are checked again when they are removed from the queue,
+  since the mesh may have changed after they were added. The points
+  and quads are only renumbered once at the end.
+*/
+namespace {
+
+// A candidate for the quad simplification: the doublets are
+// processed first, then the quads in order of increasing quality
+class TMRQuadCandidate {
+ public:
+  TMRQuadCandidate(int _type, double _quality, int _index) {
+    type = _type;
+    quality = _quality;
+    index = _index;
+  }
+
+  // The priority queue returns the largest entry first, so the
+  // ordering is reversed
+  bool operator<(const TMRQuadCandidate &c) const {
+    if (type != c.type) {
+      return type > c.type;
+    }
+    if (quality != c.quality) {
+      return quality > c.quality;
+    }
+    return index > c.index;
+  }
+
+  static const int DOUBLET = 0;
+  static const int COLLAPSE = 1;
+
+  int type;
+  double quality;
+  int index;
+};
+
+/*
+  The quads that touch each point, stored as linked lists through the
+  quad connectivity: the entry 4*q + k refers to the point
+  quads[4*q + k] in quad q, and next[4*q + k] is the next entry for
+  the same point. This allows the lists to be modified locally as the
+  quads are removed or changed.
+*/
+class TMRPointToQuadLists {
+ public:
+  TMRPointToQuadLists(int num_points, int num_quads, int *_quads) {
+    quads = _quads;
+    head = new int[num_points];
+    degree = new int[num_points];
+    next = new int[4 * num_quads];
+    for (int i = 0; i < num_points; i++) {
+      head[i] = -1;
+      degree[i] = 0;
+    }
+    for (int e = 4 * num_quads - 1; e >= 0; e--) {
+      next[e] = -1;
+      if (quads[e] >= 0) {
+        insert(e, quads[e]);
+      }
+    }
+  }
+  ~TMRPointToQuadLists() {
+    delete[] head;
+    delete[] degree;
+    delete[] next;
+  }
+
+  // Remove the entry from the list of its point
+  void remove(int e) {
+    int p = quads[e];
+    if (head[p] == e) {
+      head[p] = next[e];
+    } else {
+      int prev = head[p];
+      while (next[prev] != e) {
+        prev = next[prev];
+      }
+      next[prev] = next[e];
+    }
+    next[e] = -1;
+    degree[p]--;
+  }
+
+  // Set the point of the entry and add it to the list of the point
+  void insert(int e, int p) {
+    quads[e] = p;
+    next[e] = head[p];
+    head[p] = e;
+    degree[p]++;
+  }
+
+  int *quads;
+  int *head, *degree, *next;
+};
+
+/*
+  Check whether the quad can be collapsed across the diagonal starting
+  at the local point j1, eliminating the point p1 and keeping p2
 */
+static int is_collapsible_quad(const int *quad, const int *degree,
+                               int num_fixed_pts, int j1, int *p1, int *p2) {
+  int j2 = j1 + 2;
+  *p1 = quad[j1];
+  *p2 = quad[j2];
+  if (*p1 < num_fixed_pts || *p2 < num_fixed_pts) {
+    return 0;
+  }
+
+  // If the quad is in the interior, collapse it if both points are
+  // referred to by three quads
+  int d1 = degree[*p1], d2 = degree[*p2];
+  if (d1 == 3 && d2 == 3) {
+    return 1;
+  }
+
+  // If the quad is on the boundary, collapse it if the degree of the
+  // nodes are one larger
+  if ((quad[(j1 + 1) % 4] < num_fixed_pts ||
+       quad[(j2 + 1) % 4] < num_fixed_pts) &&
+      ((d1 == 3 && d2 <= 4) || (d2 == 3 && d1 <= 4))) {
+    return 1;
+  }
+  return 0;
+}
+
+}  // namespace
+
 void TMRFaceMesh::simplifyQuads(int dummy_flag) {
-  // Compute the node -> quad information
-  int *ptr, *pts_to_quads;
-  TMR_ComputeNodeToElems(num_points, num_quads, 4, quads, &ptr, &pts_to_quads);
+  TMRPointToQuadLists lists(num_points, num_quads, quads);
+  const int *head = lists.head;
+  const int *degree = lists.degree;
+  const int *next = lists.next;
 
-  // First, remove the nodes that are only referred to twice, not on
-  // the boundary
+  // The new point numbers. Eliminated points are set to -1.
   int *new_pt_nums = new int[num_points];
   memset(new_pt_nums, 0, num_points * sizeof(int));
 
+  // Flag the quads that are already in the queue so that each quad
+  // is only added once, avoiding repeated quality evaluations
+  int *queued = new int[num_quads];
+  memset(queued, 0, num_quads * sizeof(int));
+
+  // Add all of the initial candidates to the queue
+  std::priority_queue<TMRQuadCandidate> queue;
   for (int i = num_fixed_pts; i < num_points; i++) {
-    if (ptr[i + 1] - ptr[i] == 2) {
-      // Retrieve the pointers to the latest quadrilatral
-      int q1 = pts_to_quads[ptr[i]];
-      int q2 = pts_to_quads[ptr[i] + 1];
-      int *quad1 = &quads[4 * q1];
-      int *quad2 = &quads[4 * q2];
-
-      // If any of the other points have been deleted, then
-      // skip combining this quadrilateral. This call could
-      // probably be repeated to remove this element, but this
-      // algorithm cannot handle it.
-      int skip_me = 0;
-      for (int k = 0; k < 4; k++) {
-        if (quad1[k] < 0 || quad2[k] < 0 || new_pt_nums[quad1[k]] < 0 ||
-            new_pt_nums[quad2[k]] < 0) {
-          skip_me = 1;
-          break;
-        }
-      }
+    if (degree[i] == 2) {
+      queue.push(TMRQuadCandidate(TMRQuadCandidate::DOUBLET, 0.0, i));
+    }
+  }
+  for (int q = 0; q < num_quads; q++) {
+    const int *quad = &quads[4 * q];
+    int p1, p2;
+    if (quad[0] >= 0 &&
+        (is_collapsible_quad(quad, degree, num_fixed_pts, 0, &p1, &p2) ||
+         is_collapsible_quad(quad, degree, num_fixed_pts, 1, &p1, &p2))) {
+      double quality = computeQuadQuality(quad, X);
+      queue.push(TMRQuadCandidate(TMRQuadCandidate::COLLAPSE, quality, q));
+      queued[q] = 1;
+    }
+  }
 
-      if (!skip_me) {
-        // Find the common node between quads
-        int k1 = 0, k2 = 0;
-        while (quad1[k1] != i) k1++;
-        while (quad2[k2] != i) k2++;
+  while (!queue.empty()) {
+    TMRQuadCandidate c = queue.top();
+    queue.pop();
 
-        // Adjust k2 so that it points to the node that
-        // will be inserted into the connectivity for the
-        // first quadrilateral
-        k2 += 2;
-        if (k2 >= 4) {
-          k2 -= 4;
-        }
-        quad1[k1] = quad2[k2];
+    // The points whose configurations are modified
+    int num_modified = 0;
+    int modified[4];
+
+    if (c.type == TMRQuadCandidate::DOUBLET) {
+      // Remove the point that is only referred to by two quads
+      int i = c.index;
+      if (new_pt_nums[i] < 0 || degree[i] != 2) {
+        continue;
+      }
 
-        // Set the point
-        quad2[0] = quad2[1] = quad2[2] = quad2[3] = -1;
+      // Find the two quads and the local index of the point in each
+      int e1 = head[i];
+      int e2 = next[e1];
+      int *quad1 = &quads[4 * (e1 / 4)];
+      int *quad2 = &quads[4 * (e2 / 4)];
+      int k1 = e1 % 4, k2 = e2 % 4;
 
-        // Set the points that we're going to eliminate
-        new_pt_nums[i] = -1;
+      // The two quads must share both edges that meet at the point
+      // but not the point opposite to it
+      int a = quad1[(k1 + 1) % 4], b = quad1[(k1 + 3) % 4];
+      int a2 = quad2[(k2 + 1) % 4], b2 = quad2[(k2 + 3) % 4];
+      int opp = quad2[(k2 + 2) % 4];
+      if (e1 / 4 == e2 / 4 ||
+          !((a == a2 && b == b2) || (a == b2 && b == a2)) ||
+          opp == quad1[(k1 + 2) % 4]) {
+        continue;
       }
-    }
-  }
 
-  for (int i = 0; i < num_quads; i++) {
-    for (int j1 = 0; j1 < 2; j1++) {
-      // Find the local node numbers that are on opposite
-      // sides of the quadrilateral
-      int j2 = j1 + 2;
-
-      // Compute the points that are on opposite sides of the
-      // quadrilateral
-      int p1 = quads[4 * i + j1];
-      int p2 = quads[4 * i + j2];
-
-      int collapse = 0;
-      if (p1 >= 0 && p2 >= 0 && p1 >= num_fixed_pts && p2 >= num_fixed_pts) {
-        // If the quad is in the interior
-        if ((ptr[p1 + 1] - ptr[p1] == 3 && ptr[p2 + 1] - ptr[p2] == 3)) {
-          collapse = 1;
-        }
-        // If the quad is on the boundary, collapse it if the degree of the
-        // nodes are one larger
-        if ((quads[4 * i + ((j1 + 1) % 4)] < num_fixed_pts ||
-             quads[4 * i + ((j2 + 1) % 4)] < num_fixed_pts) &&
-            ((ptr[p1 + 1] - ptr[p1] == 3 && ptr[p2 + 1] - ptr[p2] <= 4) ||
-             (ptr[p2 + 1] - ptr[p2] == 3 && ptr[p1 + 1] - ptr[p1] <= 4))) {
-          collapse = 1;
-        }
+      // Remove the second quad and replace the point in the first
+      // quad with the point opposite to it in the second quad
+      for (int k = 0; k < 4; k++) {
+        lists.remove(4 * (e2 / 4) + k);
       }
+      quad2[0] = quad2[1] = quad2[2] = quad2[3] = -1;
+      lists.remove(e1);
+      lists.insert(e1, opp);
+      new_pt_nums[i] = -1;
 
-      if (collapse) {
-        // Check whether any of the quadrilaterals which touch either
-        // p1 or p2 have negative indices or are on a boundary.
-        int flag = 0;
-        for (int kp = ptr[p1]; kp < ptr[p1 + 1]; kp++) {
-          int q = pts_to_quads[kp];
-          if (quads[4 * q] < 0 || new_pt_nums[quads[4 * q]] < 0 ||
-              new_pt_nums[quads[4 * q + 1]] < 0 ||
-              new_pt_nums[quads[4 * q + 2]] < 0 ||
-              new_pt_nums[quads[4 * q + 3]] < 0) {
-            flag = 1;
-            break;
-          }
-        }
-        if (flag) {
-          break;
-        }
-        for (int kp = ptr[p2]; kp < ptr[p2 + 1]; kp++) {
-          int q = pts_to_quads[kp];
-          if (quads[4 * q] < 0 || new_pt_nums[quads[4 * q]] < 0 ||
-              new_pt_nums[quads[4 * q + 1]] < 0 ||
-              new_pt_nums[quads[4 * q + 2]] < 0 ||
-              new_pt_nums[quads[4 * q + 3]] < 0) {
-            flag = 1;
-            break;
-          }
-        }
-        if (flag) {
-          break;
+      modified[0] = a;
+      modified[1] = b;
+      modified[2] = opp;
+      num_modified = 3;
+    } else {
+      // Collapse the quad across one of its diagonals
+      int q = c.index;
+      int *quad = &quads[4 * q];
+      int p1 = -1, p2 = -1;
+      queued[q] = 0;
+      if (quad[0] < 0 ||
+          !(is_collapsible_quad(quad, degree, num_fixed_pts, 0, &p1, &p2) ||
+            is_collapsible_quad(quad, degree, num_fixed_pts, 1, &p1, &p2))) {
+        continue;
+      }
+
+      // The eliminated point cannot share any other quad with the
+      // remaining point, otherwise the collapse would create a
+      // degenerate quad
+      int shared = 0;
+      for (int e = head[p1]; e >= 0 && !shared; e = next[e]) {
+        const int *adj = &quads[4 * (e / 4)];
+        if (e / 4 != q &&
+            (adj[0] == p2 || adj[1] == p2 || adj[2] == p2 || adj[3] == p2)) {
+          shared = 1;
         }
+      }
+      if (shared) {
+        continue;
+      }
 
-        // Figure out which node to eliminate
-        new_pt_nums[p1] = -1;
-
-        // Set the quadrilaterals that refer to the node p1
-        // now instead to refer to the node p2
-        for (int kp = ptr[p1]; kp < ptr[p1 + 1]; kp++) {
-          int q = pts_to_quads[kp];
-          for (int k = 0; k < 4; k++) {
-            if (quads[4 * q + k] == p1) {
-              quads[4 * q + k] = p2;
-            }
-          }
+      // Remove the quad
+      for (int k = 0; k < 4; k++) {
+        if (quad[k] != p1) {
+          modified[num_modified] = quad[k];
+          num_modified++;
+        }
+        lists.remove(4 * q + k);
+      }
+      quad[0] = quad[1] = quad[2] = quad[3] = -1;
+
+      // Set the quads that refer to the point p1 to refer to the
+      // point p2 instead
+      while (head[p1] >= 0) {
+        int e = head[p1];
+        lists.remove(e);
+        lists.insert(e, p2);
+      }
+      new_pt_nums[p1] = -1;
+    }
+
+    // Add the configurations around the modified points
+    for (int j = 0; j < num_modified; j++) {
+      int p = modified[j];
+      if (p >= num_fixed_pts && degree[p] == 2) {
+        queue.push(TMRQuadCandidate(TMRQuadCandidate::DOUBLET, 0.0, p));
+      }
+      for (int e = head[p]; e >= 0; e = next[e]) {
+        int q = e / 4;
+        const int *quad = &quads[4 * q];
+        int p1, p2;
+        if (!queued[q] &&
+            (is_collapsible_quad(quad, degree, num_fixed_pts, 0, &p1, &p2) ||
+             is_collapsible_quad(quad, degree, num_fixed_pts, 1, &p1, &p2))) {
+          double quality = computeQuadQuality(quad, X);
+          queue.push(TMRQuadCandidate(TMRQuadCandidate::COLLAPSE, quality, q));
+          queued[q] = 1;
         }
-
-        // Now eliminate the quad
-        quads[4 * i] = quads[4 * i + 1] = quads[4 * i + 2] = quads[4 * i + 3] =
-            -1;
-
-        // Quit this quadrilateral
-        break;
       }
     }
   }
 
-  // Free the pointer/quad pointer data
-  delete[] ptr;
-  delete[] pts_to_quads;
-
   // Remove the points/parameters that have been eliminated
   int pt_num = 0;
   for (; pt_num < num_fixed_pts; pt_num++) {
@@ -2871,8 +3349,9 @@ void TMRFaceMesh::simplifyQuads(int dummy_flag) {
   // Set the new number of quadrilaterals
   num_quads = quad_num;
 
-  // Free the new point numbers
+  // Free the new point numbers and the queue flags
   delete[] new_pt_nums;
+  delete[] queued;
 }
 
 /*
@@ -2910,6 +3389,16 @@ void TMRFaceMesh::addMeshQuality(int nbins, int bins[]) {
   }
 }
 
+/*
+  Add the times spent triangulating, recombining and smoothing this
+  face mesh
+*/
+void TMRFaceMesh::addMeshTimes(TMRMeshTimes *times) {
+  times->triangulation += tri_time;
+  times->recombination += recombine_time;
+  times->smoothing += smooth_time;
+}
+
 /*
   Print the quadrilateral quality
 */
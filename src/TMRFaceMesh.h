@@ -21,6 +21,8 @@
 #ifndef TMR_FACE_MESH_H
 #define TMR_FACE_MESH_H
 
+#include <stdio.h>
+
 #include <map>
 
 #include "TMREdgeMesh.h"
@@ -42,6 +44,14 @@ class TMRFaceMesh : public TMREntity {
   // Mesh the underlying geometric object
   void mesh(TMRMeshOptions options, TMRElementFeatureSize *fs);
 
+  // Mesh on this processor only, then distribute the mesh from the root
+  void meshLocal(TMRMeshOptions options, TMRElementFeatureSize *fs);
+  void broadcastMesh(int root);
+
+  // Write and read the mesh data so that the mesh can be re-used
+  int writeMeshData(FILE *fp);
+  int readMeshData(FILE *fp);
+
   // Return the type of the underlying mesh
   TMRFaceMeshType getMeshType() { return mesh_type; }
 
@@ -69,6 +79,9 @@ class TMRFaceMesh : public TMREntity {
   void addMeshQuality(int nbins, int count[]);
   void printMeshQuality();
 
+  // Add the times spent creating this mesh
+  void addMeshTimes(TMRMeshTimes *times);
+
  private:
   // Set the prescribed mesh
   void setPrescribedMesh(const TMRPoint *_X, int _npts, const int *_quads,
@@ -118,6 +131,10 @@ class TMRFaceMesh : public TMREntity {
   // Map the copy source face to the target face
   int mapCopyToTarget(TMRMeshOptions options, const double *params);
 
+  // Get the least-squares fit of the boundary points of this mesh in
+  // the parameter space (dim = 2) or in physical space (dim = 3)
+  void getBoundaryFit(int dim, double **fit, int **ipiv);
+
   // Create a structured mesh
   void createStructuredMesh(TMRMeshOptions options, const double *params);
 
@@ -153,6 +170,13 @@ class TMRFaceMesh : public TMREntity {
   // are set in the TMRFace class
   int *copy_to_target;
 
+  // The centroid and factored normal equations of the boundary
+  // points in the parameter space and in physical space. These are
+  // computed once and reused for each target mapped from this mesh.
+  int param_fit_computed, phys_fit_computed;
+  double param_fit[6], phys_fit[12];
+  int param_fit_ipiv[2], phys_fit_ipiv[3];
+
   // Record whether this mesh is prescribed
   int prescribed_mesh;
 
@@ -163,6 +187,9 @@ class TMRFaceMesh : public TMREntity {
   // Triangle mesh surface information
   int num_tris;
   int *tris;
+
+  // The times spent in the phases of creating the mesh
+  double tri_time, recombine_time, smooth_time;
 };
 
 #endif  // TMR_FACE_MESH_H
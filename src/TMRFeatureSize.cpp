@@ -20,13 +20,19 @@
 
 #include "TMRFeatureSize.h"
 
+#include <float.h>
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "TMRHashFunction.h"
 #include "tmrlapack.h"
 
+#ifdef TMR_HAS_OPENMP
+#include <omp.h>
+#endif  // TMR_HAS_OPENMP
+
 /*
   Create the element feature size.
 
@@ -43,6 +49,18 @@ TMRElementFeatureSize::~TMRElementFeatureSize() {}
 */
 double TMRElementFeatureSize::getFeatureSize(TMRPoint pt) { return hmin; }
 
+/*
+  Evaluate the feature size at a batch of points. By default, this
+  evaluates each point in turn. Derived classes can implement a more
+  efficient version.
+*/
+void TMRElementFeatureSize::getFeatureSizes(int n, const TMRPoint pts[],
+                                            double h[]) {
+  for (int i = 0; i < n; i++) {
+    h[i] = getFeatureSize(pts[i]);
+  }
+}
+
 /*
   Create a feature size dependency that is linear but does not
   exceed hmin or hmax anywhere in the domain
@@ -105,12 +123,18 @@ TMRBoxFeatureSize::TMRBoxFeatureSize(TMRPoint p1, TMRPoint p2, double _hmin,
   // Add a box to the data structure
   root = new BoxNode(&(list_current->boxes[num_boxes]), m1, d1);
   num_boxes++;
+
+  // The flattened octree is created when it is first needed
+  num_flat_nodes = num_flat_boxes = 0;
+  flat_nodes = NULL;
+  flat_boxes = NULL;
 }
 
 /*
   Free the data allocated by the feature-size object
 */
 TMRBoxFeatureSize::~TMRBoxFeatureSize() {
+  freeFlatTree();
   delete root;
   while (list_root) {
     BoxList *tmp = list_root;
@@ -131,6 +155,9 @@ void TMRBoxFeatureSize::addBox(TMRPoint p1, TMRPoint p2, double hval) {
   d1.y = 0.5 * fabs(p1.y - p2.y);
   d1.z = 0.5 * fabs(p1.z - p2.z);
 
+  // The flattened octree is no longer valid
+  freeFlatTree();
+
   // Check if we need to expand the array of boxes
   if (num_boxes >= MAX_LIST_BOXES) {
     list_current->next = new BoxList();
@@ -152,35 +179,164 @@ void TMRBoxFeatureSize::addBox(TMRPoint p1, TMRPoint p2, double hval) {
   Retrieve the feature size
 */
 double TMRBoxFeatureSize::getFeatureSize(TMRPoint pt) {
-  double h = hmax;
-  root->getSize(pt, &h);
-  if (h < hmin) {
-    h = hmin;
+  initFlatTree();
+  return getFlatTreeSize(pt);
+}
+
+/*
+  Retrieve the feature size at a batch of points. The flattened
+  octree is created once and the points are evaluated in parallel
+  when compiled with OpenMP.
+*/
+void TMRBoxFeatureSize::getFeatureSizes(int n, const TMRPoint pts[],
+                                        double h[]) {
+  initFlatTree();
+
+#ifdef TMR_HAS_OPENMP
+#pragma omp parallel for
+#endif  // TMR_HAS_OPENMP
+  for (int i = 0; i < n; i++) {
+    h[i] = getFlatTreeSize(pts[i]);
   }
-  if (h > hmax) {
-    h = hmax;
+}
+
+/*
+  Create the flattened octree from the BoxNode octree. The nodes are
+  stored in breadth-first order so that the eight children of each
+  node are contiguous and only the index of the first child is
+  stored.
+*/
+void TMRBoxFeatureSize::initFlatTree() {
+#ifdef TMR_HAS_OPENMP
+#pragma omp critical(TMRBoxFeatureSizeFlatTree)
+#endif  // TMR_HAS_OPENMP
+  if (!flat_nodes) {
+    // Order the nodes in breadth-first order and count up the number
+    // of boxes stored in the leaves
+    int max_size = 1024, size = 1;
+    BoxNode **queue = new BoxNode *[max_size];
+    queue[0] = root;
+    num_flat_boxes = 0;
+    for (int i = 0; i < size; i++) {
+      if (queue[i]->boxes) {
+        num_flat_boxes += queue[i]->num_boxes;
+      } else {
+        // Extend the queue if needed
+        if (size + 8 > max_size) {
+          max_size *= 2;
+          BoxNode **temp = new BoxNode *[max_size];
+          memcpy(temp, queue, size * sizeof(BoxNode *));
+          delete[] queue;
+          queue = temp;
+        }
+        for (int k = 0; k < 8; k++) {
+          queue[size] = queue[i]->c[k];
+          size++;
+        }
+      }
+    }
+
+    // Copy the node bounds and the leaf boxes to the flattened arrays
+    num_flat_nodes = size;
+    flat_nodes = new FlatNode[num_flat_nodes];
+    flat_boxes = new FlatBox[num_flat_boxes];
+    int child = 1, offset = 0;
+    for (int i = 0; i < num_flat_nodes; i++) {
+      BoxNode *node = queue[i];
+      FlatNode *flat = &flat_nodes[i];
+      flat->lo[0] = node->m.x - node->d.x;
+      flat->lo[1] = node->m.y - node->d.y;
+      flat->lo[2] = node->m.z - node->d.z;
+      flat->mid[0] = node->m.x;
+      flat->mid[1] = node->m.y;
+      flat->mid[2] = node->m.z;
+      flat->hi[0] = node->m.x + node->d.x;
+      flat->hi[1] = node->m.y + node->d.y;
+      flat->hi[2] = node->m.z + node->d.z;
+
+      if (node->boxes) {
+        flat->child = -1;
+        flat->offset = offset;
+        flat->count = node->num_boxes;
+        for (int j = 0; j < node->num_boxes; j++, offset++) {
+          BoxSize *box = node->boxes[j];
+          flat_boxes[offset].lo[0] = box->m.x - box->d.x;
+          flat_boxes[offset].lo[1] = box->m.y - box->d.y;
+          flat_boxes[offset].lo[2] = box->m.z - box->d.z;
+          flat_boxes[offset].hi[0] = box->m.x + box->d.x;
+          flat_boxes[offset].hi[1] = box->m.y + box->d.y;
+          flat_boxes[offset].hi[2] = box->m.z + box->d.z;
+          flat_boxes[offset].h = box->h;
+        }
+      } else {
+        flat->child = child;
+        flat->offset = 0;
+        flat->count = 0;
+        child += 8;
+      }
+    }
+
+    delete[] queue;
   }
-  return h;
 }
 
 /*
-  Check if the box contains the point
+  Free the flattened octree
 */
-int TMRBoxFeatureSize::BoxSize::contains(TMRPoint p) {
-  // Compute the lower/upper bounds
-  double xl = m.x - d.x;
-  double xu = m.x + d.x;
-  double yl = m.y - d.y;
-  double yu = m.y + d.y;
-  double zl = m.z - d.z;
-  double zu = m.z + d.z;
+void TMRBoxFeatureSize::freeFlatTree() {
+  if (flat_nodes) {
+    delete[] flat_nodes;
+    delete[] flat_boxes;
+  }
+  num_flat_nodes = num_flat_boxes = 0;
+  flat_nodes = NULL;
+  flat_boxes = NULL;
+}
 
-  // Return true if the box contains the point
-  if ((p.x >= xl && p.x <= xu) && (p.y >= yl && p.y <= yu) &&
-      (p.z >= zl && p.z <= zu)) {
-    return 1;
+/*
+  Find the feature size from the flattened octree. This descends to
+  the leaf containing the point and finds the most-constraining box
+  size. Points on the boundary between children are assigned to the
+  lower child. Note that initFlatTree() must be called first.
+*/
+double TMRBoxFeatureSize::getFlatTreeSize(TMRPoint p) {
+  double h = hmax;
+
+  int index = 0;
+  while (flat_nodes[index].child >= 0) {
+    const FlatNode *node = &flat_nodes[index];
+
+    // Check if the point lies outside this node
+    if (!((p.x >= node->lo[0] && p.x <= node->hi[0]) &&
+          (p.y >= node->lo[1] && p.y <= node->hi[1]) &&
+          (p.z >= node->lo[2] && p.z <= node->hi[2]))) {
+      index = -1;
+      break;
+    }
+
+    index = node->child + (p.x > node->mid[0]) + 2 * (p.y > node->mid[1]) +
+            4 * (p.z > node->mid[2]);
   }
-  return 0;
+
+  if (index >= 0) {
+    const FlatBox *box = &flat_boxes[flat_nodes[index].offset];
+    const FlatBox *end = &box[flat_nodes[index].count];
+    for (; box < end; box++) {
+      if ((p.x >= box->lo[0] && p.x <= box->hi[0]) &&
+          (p.y >= box->lo[1] && p.y <= box->hi[1]) &&
+          (p.z >= box->lo[2] && p.z <= box->hi[2]) && h > box->h) {
+        h = box->h;
+      }
+    }
+  }
+
+  if (h < hmin) {
+    h = hmin;
+  }
+  if (h > hmax) {
+    h = hmax;
+  }
+  return h;
 }
 
 /*
@@ -313,52 +469,116 @@ void TMRBoxFeatureSize::BoxNode::addBox(BoxSize *ptr) {
 }
 
 /*
-  Get the element size based on the extent of the box
+  The nodes of the tree used within the point locator. The nodes are
+  only stored in this object while the tree is being created so that
+  separate subtrees can be created concurrently.
 */
-void TMRBoxFeatureSize::BoxNode::getSize(TMRPoint p, double *hval) {
-  // Scan through the tree and find the most-constraining box size
-  for (int k = 0; k < 2; k++) {
-    double zl = m.z + (k - 1) * d.z;
-    double zu = m.z + k * d.z;
+class TMRPointLocator::TreeNodes {
+ public:
+  TreeNodes(int size) {
+    num_nodes = 0;
+    max_num_nodes = (size > 1 ? size : 1);
+    nodes = new int[2 * max_num_nodes];
+    index_offset = new int[max_num_nodes];
+    index_count = new int[max_num_nodes];
+    node_loc = new TMRPoint[max_num_nodes];
+    node_normal = new TMRPoint[max_num_nodes];
+    for (int i = 0; i < max_num_nodes; i++) {
+      node_loc[i].zero();
+      node_normal[i].zero();
+    }
+  }
+  ~TreeNodes() {
+    delete[] nodes;
+    delete[] index_offset;
+    delete[] index_count;
+    delete[] node_loc;
+    delete[] node_normal;
+  }
 
-    for (int j = 0; j < 2; j++) {
-      double yl = m.y + (j - 1) * d.y;
-      double yu = m.y + j * d.y;
+  // Extend the arrays so that they can store at least size nodes
+  void extend(int size) {
+    if (size <= max_num_nodes) {
+      return;
+    }
+    max_num_nodes = 2 * size;
 
-      for (int i = 0; i < 2; i++) {
-        double xl = m.x + (i - 1) * d.x;
-        double xu = m.x + i * d.x;
-
-        // Check if the point lies in the box and the box exists
-        if ((p.x >= xl && p.x <= xu) && (p.y >= yl && p.y <= yu) &&
-            (p.z >= zl && p.z <= zu)) {
-          if (c[i + 2 * j + 4 * k]) {
-            return c[i + 2 * j + 4 * k]->getSize(p, hval);
-          }
-        }
-      }
+    int *temp_nodes = new int[2 * max_num_nodes];
+    memcpy(temp_nodes, nodes, 2 * num_nodes * sizeof(int));
+    delete[] nodes;
+    nodes = temp_nodes;
+
+    int *temp_index_offset = new int[max_num_nodes];
+    memcpy(temp_index_offset, index_offset, num_nodes * sizeof(int));
+    delete[] index_offset;
+    index_offset = temp_index_offset;
+
+    int *temp_index_count = new int[max_num_nodes];
+    memcpy(temp_index_count, index_count, num_nodes * sizeof(int));
+    delete[] index_count;
+    index_count = temp_index_count;
+
+    TMRPoint *temp_node_loc = new TMRPoint[max_num_nodes];
+    TMRPoint *temp_node_normal = new TMRPoint[max_num_nodes];
+    for (int i = 0; i < num_nodes; i++) {
+      temp_node_loc[i] = node_loc[i];
+      temp_node_normal[i] = node_normal[i];
+    }
+    for (int i = num_nodes; i < max_num_nodes; i++) {
+      temp_node_loc[i].zero();
+      temp_node_normal[i].zero();
     }
+    delete[] node_loc;
+    delete[] node_normal;
+    node_loc = temp_node_loc;
+    node_normal = temp_node_normal;
+  }
+
+  // Add a new node and return its index
+  int addNode() {
+    extend(num_nodes + 1);
+    num_nodes++;
+    return num_nodes - 1;
   }
 
-  for (int i = 0; i < num_boxes; i++) {
-    if (boxes[i]->contains(p) && *hval > boxes[i]->h) {
-      *hval = boxes[i]->h;
+  // Append a subtree. The root of the subtree replaces the given node
+  // and the remaining nodes are added to the end of the arrays.
+  void append(TreeNodes *tree, int root) {
+    int offset = num_nodes - 1;
+    extend(num_nodes + tree->num_nodes - 1);
+    for (int i = 0; i < tree->num_nodes; i++) {
+      int node = (i == 0 ? root : offset + i);
+      int left = tree->nodes[2 * i];
+      int right = tree->nodes[2 * i + 1];
+      nodes[2 * node] = (left >= 0 ? offset + left : -1);
+      nodes[2 * node + 1] = (right >= 0 ? offset + right : -1);
+      index_offset[node] = tree->index_offset[i];
+      index_count[node] = tree->index_count[i];
+      node_loc[node] = tree->node_loc[i];
+      node_normal[node] = tree->node_normal[i];
     }
+    num_nodes += tree->num_nodes - 1;
   }
-}
+
+  int num_nodes, max_num_nodes;
+  int *nodes;
+  int *index_offset, *index_count;
+  TMRPoint *node_loc, *node_normal;
+};
 
 /*
   Create the point locator: This is used to find the points from the
   initial point set that are closest to the provided point.
+
+  When compiled with OpenMP, the top levels of the tree are created
+  first and the subtrees below them are then created in parallel.
 */
 TMRPointLocator::TMRPointLocator(int _npts, TMRPoint *_pts) {
   npts = _npts;
   pts = new TMRPoint[npts];
-  memcpy(pts, _pts, npts * sizeof(TMRPoint));
-
-  // Calculate approximately how many nodes there should be
-  max_num_nodes = int(2.0 * npts / MAX_BIN_SIZE) + 1;
-  num_nodes = 0;
+  for (int i = 0; i < npts; i++) {
+    pts[i] = _pts[i];
+  }
 
   // The point indicies
   indices = new int[npts];
@@ -366,19 +586,64 @@ TMRPointLocator::TMRPointLocator(int _npts, TMRPoint *_pts) {
     indices[i] = i;
   }
 
-  // Set up the data structure that represents the splitting planes
-  nodes = new int[2 * max_num_nodes];
-  index_offset = new int[max_num_nodes];
-  index_count = new int[max_num_nodes];
+  // Calculate approximately how many nodes there should be
+  TreeNodes *tree = new TreeNodes(int(2.0 * npts / MAX_BIN_SIZE) + 1);
+
+  // Set the number of levels that are created before the subtrees
+  // are split in parallel
+  int num_levels = 0;
+#ifdef TMR_HAS_OPENMP
+  int num_threads = omp_get_max_threads();
+  if (num_threads > 1 && npts >= MIN_PARALLEL_BUILD_SIZE) {
+    while ((1 << num_levels) < 4 * num_threads) {
+      num_levels++;
+    }
+  }
+#endif  // TMR_HAS_OPENMP
+
+  if (num_levels > 0) {
+    // Split the top levels of the tree and record the subtrees
+    int nsub = 0;
+    int *sub = new int[3 * (1 << num_levels)];
+    split(tree, 0, npts, num_levels, &nsub, sub);
+
+    // Create each of the subtrees. Each subtree only modifies its
+    // own range of the indices.
+    TreeNodes **subtrees = new TreeNodes *[nsub];
+#ifdef TMR_HAS_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif  // TMR_HAS_OPENMP
+    for (int i = 0; i < nsub; i++) {
+      int size = sub[3 * i + 2] - sub[3 * i + 1];
+      subtrees[i] = new TreeNodes(int(2.0 * size / MAX_BIN_SIZE) + 1);
+      split(subtrees[i], sub[3 * i + 1], sub[3 * i + 2], -1, NULL, NULL);
+    }
 
-  // The base point and normal direction for the splitting planes
-  node_loc = new TMRPoint[max_num_nodes];
-  node_normal = new TMRPoint[max_num_nodes];
-  memset(node_loc, 0, max_num_nodes * sizeof(TMRPoint));
-  memset(node_normal, 0, max_num_nodes * sizeof(TMRPoint));
+    // Add the subtrees to the full tree
+    for (int i = 0; i < nsub; i++) {
+      tree->append(subtrees[i], sub[3 * i]);
+      delete subtrees[i];
+    }
+    delete[] subtrees;
+    delete[] sub;
+  } else {
+    // Recursively split the points
+    split(tree, 0, npts, -1, NULL, NULL);
+  }
 
-  // Recursively split the points
-  split(0, npts);
+  // Take the arrays from the tree
+  num_nodes = tree->num_nodes;
+  nodes = tree->nodes;
+  index_offset = tree->index_offset;
+  index_count = tree->index_count;
+  node_loc = tree->node_loc;
+  node_normal = tree->node_normal;
+  tree->nodes = NULL;
+  tree->index_offset = NULL;
+  tree->index_count = NULL;
+  tree->node_loc = NULL;
+  tree->node_normal = NULL;
+  delete tree;
 }
 
 TMRPointLocator::~TMRPointLocator() {
@@ -394,57 +659,34 @@ TMRPointLocator::~TMRPointLocator() {
 /*
   Split the list of indices into approximately two. Those on one half
   of a plane and those on the other.
-*/
-int TMRPointLocator::split(int start, int end) {
-  int root = num_nodes;
-
-  num_nodes++;
-
-  // Need to extend the arrays to make them fit
-  if (num_nodes >= max_num_nodes) {
-    int max_num_nodes = 2 * (num_nodes + 1);
 
-    // Allocate and set a new nodes pointer
-    int *temp_nodes = new int[2 * max_num_nodes];
-    memcpy(temp_nodes, nodes, 2 * num_nodes * sizeof(int));
-    delete[] nodes;
-    nodes = temp_nodes;
-
-    // Allocate and set a new offset array
-    int *temp_index_offset = new int[max_num_nodes];
-    memcpy(temp_index_offset, index_offset, num_nodes * sizeof(int));
-    delete[] index_offset;
-    index_offset = temp_index_offset;
-
-    // Allocate more space for the index counts
-    int *temp_index_count = new int[max_num_nodes];
-    memcpy(temp_index_count, index_count, num_nodes * sizeof(int));
-    delete[] index_count;
-    index_count = temp_index_count;
-
-    // Allocate more space for the average plane locations
-    TMRPoint *temp_node_loc = new TMRPoint[max_num_nodes];
-    memcpy(temp_node_loc, node_loc, num_nodes * sizeof(TMRPoint));
-    delete[] node_loc;
-    node_loc = temp_node_loc;
-
-    // Allocate more space for the plane normals
-    TMRPoint *temp_node_normal = new TMRPoint[max_num_nodes];
-    memcpy(temp_node_normal, node_normal, num_nodes * sizeof(TMRPoint));
-    delete[] node_normal;
-    node_normal = temp_node_normal;
-  }
+  When level reaches zero, the split stops and the node index and
+  the range of the indices are recorded in the sub array so that the
+  subtree can be created separately. A negative level never stops.
+*/
+int TMRPointLocator::split(TreeNodes *tree, int start, int end, int level,
+                           int *nsub, int *sub) {
+  int root = tree->addNode();
 
   // If there are fewer than the max number of points in a bin, end
   // the recursion here and store the result of the last split
   if (end - start <= MAX_BIN_SIZE) {
-    nodes[2 * root] = -1;
-    nodes[2 * root + 1] = -1;
+    tree->nodes[2 * root] = -1;
+    tree->nodes[2 * root + 1] = -1;
 
     // Set the offset into the node
-    index_offset[root] = start;
-    index_count[root] = end - start;
+    tree->index_offset[root] = start;
+    tree->index_count[root] = end - start;
+
+    return root;
+  }
 
+  // Record the subtree so that it can be created later
+  if (level == 0) {
+    sub[3 * (*nsub)] = root;
+    sub[3 * (*nsub) + 1] = start;
+    sub[3 * (*nsub) + 2] = end;
+    (*nsub)++;
     return root;
   }
 
@@ -452,23 +694,29 @@ int TMRPointLocator::split(int start, int end) {
   // index pointer to a negative value to indicate that this is not a
   // leaf. Sort the indices so that the points on one side of the
   // plane are below the mid point and the others are above.
-  index_offset[root] = -1;
-  index_count[root] = 0;
+  tree->index_offset[root] = -1;
+  tree->index_count[root] = 0;
 
   // Split the list
-  int mid = partitionPoints(&node_loc[root], &node_normal[root],
+  int mid = partitionPoints(&tree->node_loc[root], &tree->node_normal[root],
                             &indices[start], end - start);
 
+  // If the points could not be split (for instance, because they
+  // are coincident) store them all in this leaf
   if (mid == 0 || mid == end - start) {
+    tree->nodes[2 * root] = -1;
+    tree->nodes[2 * root + 1] = -1;
+    tree->index_offset[root] = start;
+    tree->index_count[root] = end - start;
     return root;
   }
 
   // Now, split the right and left hand sides of the list to continue
   // the recursion.
-  int left_node = split(start, start + mid);
-  int right_node = split(start + mid, end);
-  nodes[2 * root] = left_node;
-  nodes[2 * root + 1] = right_node;
+  int left_node = split(tree, start, start + mid, level - 1, nsub, sub);
+  int right_node = split(tree, start + mid, end, level - 1, nsub, sub);
+  tree->nodes[2 * root] = left_node;
+  tree->nodes[2 * root + 1] = right_node;
 
   return root;
 }
@@ -576,12 +824,6 @@ int TMRPointLocator::partitionPoints(TMRPoint *loc, TMRPoint *normal, int *indx,
   normal->y = ny;
   normal->z = nz;
 
-  // If this didn't work, issue an error message
-  if (low == 0 || low == np) {
-    fprintf(stderr, "n = (%25.16e, %25.16e, %25.16e\n", nx, ny, nz);
-    fprintf(stderr, "TMRPointLocator: Error splitting points\n");
-  }
-
   return low;
 }
 
@@ -594,6 +836,150 @@ void TMRPointLocator::locateClosest(const int K, const TMRPoint pt, int *nk,
   locateClosest(K, 0, pt, nk, indx, dist);
 }
 
+/*
+  Sort key used to order the query points along the Morton curve
+*/
+struct TMRLocatorSortKey {
+  uint64_t key;
+  int index;
+};
+
+static int TMR_CompareLocatorKey(const void *a, const void *b) {
+  const TMRLocatorSortKey *A = static_cast<const TMRLocatorSortKey *>(a);
+  const TMRLocatorSortKey *B = static_cast<const TMRLocatorSortKey *>(b);
+  if (A->key < B->key) {
+    return -1;
+  } else if (A->key > B->key) {
+    return 1;
+  }
+  return A->index - B->index;
+}
+
+/*
+  Compute the Morton key from the quantized (x, y, z) coordinates
+*/
+static uint64_t TMR_LocatorMortonKey(uint32_t x, uint32_t y, uint32_t z) {
+  uint64_t key = 0;
+  for (int k = 0; k < 21; k++) {
+    key |= ((uint64_t)((x >> k) & 1) << (3 * k));
+    key |= ((uint64_t)((y >> k) & 1) << (3 * k + 1));
+    key |= ((uint64_t)((z >> k) & 1) << (3 * k + 2));
+  }
+  return key;
+}
+
+/*
+  Quantize the coordinate to an integer between 0 and 2^21 - 1 based
+  on the bounds. Coordinates outside the bounds are clamped.
+*/
+static uint32_t TMR_QuantizeCoordinate(double x, double xmin, double xmax) {
+  const double max_int = (1 << 21) - 1;
+  double dx = xmax - xmin;
+  if (dx > 0.0) {
+    double t = max_int * (x - xmin) / dx;
+    if (t <= 0.0) {
+      return 0;
+    } else if (t >= max_int) {
+      return (uint32_t)max_int;
+    }
+    return (uint32_t)t;
+  }
+  return 0;
+}
+
+/*
+  Compute the Morton key of the point within the bounding box
+*/
+static uint64_t TMR_LocatorPointKey(const TMRPoint &p, const TMRPoint &xmin,
+                                    const TMRPoint &xmax) {
+  uint32_t u = TMR_QuantizeCoordinate(p.x, xmin.x, xmax.x);
+  uint32_t v = TMR_QuantizeCoordinate(p.y, xmin.y, xmax.y);
+  uint32_t w = TMR_QuantizeCoordinate(p.z, xmin.z, xmax.z);
+  return TMR_LocatorMortonKey(u, v, w);
+}
+
+/*
+  Order the points along the Morton curve through their bounding box
+*/
+static void TMR_MortonOrder(int n, const TMRPoint X[], int order[]) {
+  // Compute the bounding box of the points
+  TMRPoint xmin = X[0], xmax = X[0];
+  for (int i = 1; i < n; i++) {
+    if (X[i].x < xmin.x) {
+      xmin.x = X[i].x;
+    }
+    if (X[i].y < xmin.y) {
+      xmin.y = X[i].y;
+    }
+    if (X[i].z < xmin.z) {
+      xmin.z = X[i].z;
+    }
+    if (X[i].x > xmax.x) {
+      xmax.x = X[i].x;
+    }
+    if (X[i].y > xmax.y) {
+      xmax.y = X[i].y;
+    }
+    if (X[i].z > xmax.z) {
+      xmax.z = X[i].z;
+    }
+  }
+
+  // Compute the Morton keys
+  TMRLocatorSortKey *keys = new TMRLocatorSortKey[n];
+  for (int i = 0; i < n; i++) {
+    keys[i].key = TMR_LocatorPointKey(X[i], xmin, xmax);
+    keys[i].index = i;
+  }
+  qsort(keys, n, sizeof(TMRLocatorSortKey), TMR_CompareLocatorKey);
+
+  for (int i = 0; i < n; i++) {
+    order[i] = keys[i].index;
+  }
+  delete[] keys;
+}
+
+/*
+  Locate the closest points to each point in a batch of points
+
+  The points are searched in the order of the Morton curve through
+  their bounding box so that consecutive searches visit the same
+  parts of the tree. When compiled with OpenMP, the searches are
+  performed in parallel. The results do not depend on the order.
+
+  input:
+  K:      The number of closest points to find
+  n:      The number of points
+  X:      The points
+
+  output:
+  nk:     The number of closest points found for each point
+  indx:   The indices of the K-closest points (K*n values)
+  dist:   The sorted squared distances (K*n values)
+*/
+void TMRPointLocator::locateClosest(const int K, const int n,
+                                    const TMRPoint X[], int nk[], int indx[],
+                                    double dist[]) {
+  if (n <= 0) {
+    return;
+  }
+
+  // Order the points along the Morton curve
+  int *order = new int[n];
+  TMR_MortonOrder(n, X, order);
+
+#ifdef TMR_HAS_OPENMP
+#pragma omp parallel for schedule(dynamic, 64)
+#endif  // TMR_HAS_OPENMP
+  for (int j = 0; j < n; j++) {
+    int i = order[j];
+    nk[i] = 0;
+    locateClosest(K, 0, X[i], &nk[i], &indx[K * i], &dist[K * i]);
+  }
+
+  delete[] order;
+}
+
 /*
   Locate the closest points to a given point
 
@@ -755,12 +1141,67 @@ double TMRPointFeatureSize::getFeatureSize(TMRPoint pt) {
   // Get the closest points and use them to compute a set of weights
   int indx[MAX_CLOSEST_POINTS];
   double dist[MAX_CLOSEST_POINTS];
-  double weights[MAX_CLOSEST_POINTS];
 
   // Find the closest points
   int n = 0;
   locator->locateClosest(num_sample_pts, pt, &n, indx, dist);
 
+  return computeFeatureSize(n, indx, dist);
+}
+
+/*
+  Get the feature sizes at a batch of points. The points are ordered
+  along the Morton curve and the closest points are found in batches
+  to limit the size of the temporary arrays.
+*/
+void TMRPointFeatureSize::getFeatureSizes(int n, const TMRPoint pts[],
+                                          double h[]) {
+  if (n <= 0) {
+    return;
+  }
+
+  int *order = new int[n];
+  TMR_MortonOrder(n, pts, order);
+
+  const int K = num_sample_pts;
+  int size = (n < FEATURE_SIZE_BATCH_SIZE ? n : FEATURE_SIZE_BATCH_SIZE);
+  TMRPoint *X = new TMRPoint[size];
+  int *nk = new int[size];
+  int *indx = new int[K * size];
+  double *dist = new double[K * size];
+
+  for (int start = 0; start < n; start += size) {
+    int end = (start + size < n ? start + size : n);
+    for (int i = start; i < end; i++) {
+      X[i - start] = pts[order[i]];
+    }
+    locator->locateClosest(K, end - start, X, nk, indx, dist);
+
+#ifdef TMR_HAS_OPENMP
+#pragma omp parallel for
+#endif  // TMR_HAS_OPENMP
+    for (int i = start; i < end; i++) {
+      int j = i - start;
+      h[order[i]] = computeFeatureSize(nk[j], &indx[K * j], &dist[K * j]);
+    }
+  }
+
+  delete[] order;
+  delete[] X;
+  delete[] nk;
+  delete[] indx;
+  delete[] dist;
+}
+
+/*
+  Compute the feature size from the squared distances of the closest
+  points and the feature sizes at those points. Note that this
+  modifies the distances.
+*/
+static double TMR_InterpFeatureSize(int n, double *dist, const double *h,
+                                    double hmin, double hmax) {
+  double weights[TMRPointFeatureSize::MAX_CLOSEST_POINTS];
+
   // The maximum h-size squared
   double d = 10 * hmax;
   double dinv = 1.0 / d;
@@ -789,17 +1230,749 @@ double TMRPointFeatureSize::getFeatureSize(TMRPoint pt) {
   wsum = 1.0 / wsum;
 
   // Compute the new value of h
-  double h = 0.0;
+  double hval = 0.0;
   for (int i = 0; i < n; i++) {
-    h += wsum * weights[i] * hvals[indx[i]];
+    hval += wsum * weights[i] * h[i];
   }
 
-  if (h < hmin) {
-    h = hmin;
+  if (hval < hmin) {
+    hval = hmin;
   }
-  if (h > hmax) {
-    h = hmax;
+  if (hval > hmax) {
+    hval = hmax;
   }
 
-  return h;
+  return hval;
+}
+
+/*
+  Compute the feature size from the indices and squared distances of
+  the closest points. Note that this modifies the distances.
+*/
+double TMRPointFeatureSize::computeFeatureSize(int n, const int *indx,
+                                               double *dist) {
+  double h[MAX_CLOSEST_POINTS];
+  for (int i = 0; i < n; i++) {
+    h[i] = hvals[indx[i]];
+  }
+  return TMR_InterpFeatureSize(n, dist, h, hmin, hmax);
+}
+
+/*
+  Fold the bits of a double into a 32-bit unsigned integer
+*/
+static inline uint32_t TMRFoldDoubleBits(double value) {
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(uint64_t));
+  return (uint32_t)(bits ^ (bits >> 32));
+}
+
+/*
+  The cache of the feature sizes that have been evaluated
+
+  The entries are stored contiguously in the order in which they are
+  added, with an open-addressing (linear probing) table of indices
+  into this storage used for the look up. The points are matched
+  exactly.
+*/
+class TMRDistributedPointFeatureSize::SizeCache {
+ public:
+  SizeCache() {
+    table_size = min_table_size;
+    table = new int[table_size];
+    memset(table, 0xff, table_size * sizeof(int));
+
+    num_points = 0;
+    max_num_points = table_size / 2;
+    pts = new TMRPoint[max_num_points];
+    hvals = new double[max_num_points];
+  }
+  ~SizeCache() {
+    delete[] table;
+    delete[] pts;
+    delete[] hvals;
+  }
+
+  // Remove all of the entries from the cache
+  void clear() {
+    memset(table, 0xff, table_size * sizeof(int));
+    num_points = 0;
+  }
+
+  // Retrieve the feature size at the point (if it exists)
+  int get(const TMRPoint &pt, double *h) {
+    int slot = findSlot(pt);
+    if (table[slot] >= 0) {
+      *h = hvals[table[slot]];
+      return 1;
+    }
+    return 0;
+  }
+
+  // Add the feature size at the point
+  void add(const TMRPoint &pt, double h) {
+    int slot = findSlot(pt);
+    if (table[slot] >= 0) {
+      hvals[table[slot]] = h;
+      return;
+    }
+
+    // Extend the storage if needed
+    if (num_points >= max_num_points) {
+      max_num_points *= 2;
+      TMRPoint *new_pts = new TMRPoint[max_num_points];
+      double *new_hvals = new double[max_num_points];
+      for (int i = 0; i < num_points; i++) {
+        new_pts[i] = pts[i];
+      }
+      memcpy(new_hvals, hvals, num_points * sizeof(double));
+      delete[] pts;
+      delete[] hvals;
+      pts = new_pts;
+      hvals = new_hvals;
+    }
+
+    pts[num_points] = pt;
+    hvals[num_points] = h;
+    table[slot] = num_points;
+    num_points++;
+
+    // Keep the load factor of the table below one half
+    if (2 * num_points > table_size) {
+      resizeTable(2 * table_size);
+    }
+  }
+
+ private:
+  // The minimum table size (must be a power of two)
+  static const int min_table_size = 1 << 12;
+
+  // Compute the hash value based on the bits of the coordinates
+  uint32_t getHash(const TMRPoint &pt) {
+    return TMRIntegerTripletHash(TMRFoldDoubleBits(pt.x),
+                                 TMRFoldDoubleBits(pt.y),
+                                 TMRFoldDoubleBits(pt.z));
+  }
+
+  // Find the slot that contains the point, or the empty slot where
+  // the point would be inserted
+  int findSlot(const TMRPoint &pt) {
+    const uint32_t mask = table_size - 1;
+    uint32_t slot = getHash(pt) & mask;
+    while (table[slot] >= 0) {
+      const TMRPoint &p = pts[table[slot]];
+      if (p.x == pt.x && p.y == pt.y && p.z == pt.z) {
+        break;
+      }
+      slot = (slot + 1) & mask;
+    }
+    return slot;
+  }
+
+  // Resize the table and re-insert the existing points
+  void resizeTable(int new_size) {
+    delete[] table;
+    table_size = new_size;
+    table = new int[table_size];
+    memset(table, 0xff, table_size * sizeof(int));
+
+    const uint32_t mask = table_size - 1;
+    for (int i = 0; i < num_points; i++) {
+      uint32_t slot = getHash(pts[i]) & mask;
+      while (table[slot] >= 0) {
+        slot = (slot + 1) & mask;
+      }
+      table[slot] = i;
+    }
+  }
+
+  // The open-addressing table of indices into the storage
+  int table_size;
+  int *table;
+
+  // The contiguous storage for the points and feature sizes
+  int num_points, max_num_points;
+  TMRPoint *pts;
+  double *hvals;
+};
+
+/*
+  Compute the squared distance between a point and a bounding box
+  stored as the lower and upper bounds
+*/
+static double TMR_BoxDistance2(const double bounds[], const TMRPoint &p) {
+  const double x[3] = {p.x, p.y, p.z};
+  double d2 = 0.0;
+  for (int k = 0; k < 3; k++) {
+    if (x[k] < bounds[k]) {
+      d2 += (bounds[k] - x[k]) * (bounds[k] - x[k]);
+    } else if (x[k] > bounds[3 + k]) {
+      d2 += (x[k] - bounds[3 + k]) * (x[k] - bounds[3 + k]);
+    }
+  }
+  return d2;
+}
+
+/*
+  Merge two lists of the closest points, keeping the K-closest points
+  in the first list. Each list is stored as the number of points,
+  followed by the K sorted squared distances and the K feature sizes.
+*/
+static void TMR_MergeClosest(const int K, double a[], const double b[]) {
+  double dist[TMRDistributedPointFeatureSize::MAX_CLOSEST_POINTS];
+  double h[TMRDistributedPointFeatureSize::MAX_CLOSEST_POINTS];
+
+  int na = (int)a[0], nb = (int)b[0];
+  int ia = 0, ib = 0, n = 0;
+  for (; n < K && (ia < na || ib < nb); n++) {
+    if (ib >= nb || (ia < na && a[1 + ia] <= b[1 + ib])) {
+      dist[n] = a[1 + ia];
+      h[n] = a[1 + K + ia];
+      ia++;
+    } else {
+      dist[n] = b[1 + ib];
+      h[n] = b[1 + K + ib];
+      ib++;
+    }
+  }
+
+  a[0] = n;
+  memcpy(&a[1], dist, n * sizeof(double));
+  memcpy(&a[1 + K], h, n * sizeof(double));
+}
+
+/*
+  Create the distributed feature size from the points on each
+  processor. The points may be located anywhere, they are sent to
+  the processor that owns their location on the Morton curve.
+
+  input:
+  comm:            the communicator
+  npts:            the number of points on this processor
+  pts:             the points on this processor
+  hvals:           the feature sizes at the points
+  hmin:            the minimum feature size
+  hmax:            the maximum feature size
+  num_sample_pts:  the number of closest points used
+  max_coarse_pts:  the max size of the coarse sample of the points
+*/
+TMRDistributedPointFeatureSize::TMRDistributedPointFeatureSize(
+    MPI_Comm _comm, int _npts, TMRPoint *_pts, double *_hvals, double _hmin,
+    double _hmax, int _num_sample_pts, int max_coarse_pts)
+    : TMRElementFeatureSize(_hmin) {
+  comm = _comm;
+  MPI_Comm_rank(comm, &mpi_rank);
+  MPI_Comm_size(comm, &mpi_size);
+  hmax = _hmax;
+
+  // Set the number of sample points
+  num_sample_pts = _num_sample_pts;
+  if (num_sample_pts > MAX_CLOSEST_POINTS) {
+    num_sample_pts = MAX_CLOSEST_POINTS;
+  }
+
+  // Compute the bounding box of all the points. The upper bounds are
+  // negated so that a single reduction can be used.
+  double bounds[6];
+  for (int k = 0; k < 6; k++) {
+    bounds[k] = DBL_MAX;
+  }
+  for (int i = 0; i < _npts; i++) {
+    const double x[3] = {_pts[i].x, _pts[i].y, _pts[i].z};
+    for (int k = 0; k < 3; k++) {
+      if (x[k] < bounds[k]) {
+        bounds[k] = x[k];
+      }
+      if (-x[k] < bounds[3 + k]) {
+        bounds[3 + k] = -x[k];
+      }
+    }
+  }
+  MPI_Allreduce(MPI_IN_PLACE, bounds, 6, MPI_DOUBLE, MPI_MIN, comm);
+  domain_lower.x = bounds[0];
+  domain_lower.y = bounds[1];
+  domain_lower.z = bounds[2];
+  domain_upper.x = -bounds[3];
+  domain_upper.y = -bounds[4];
+  domain_upper.z = -bounds[5];
+
+  // Count the number of points within each segment of the curve
+  const int num_segments = 1 << (3 * NUM_PARTITION_LEVELS);
+  int *counts = new int[num_segments];
+  memset(counts, 0, num_segments * sizeof(int));
+  int *owner = new int[_npts];
+  for (int i = 0; i < _npts; i++) {
+    owner[i] = getSegment(_pts[i]);
+    counts[owner[i]]++;
+  }
+  MPI_Allreduce(MPI_IN_PLACE, counts, num_segments, MPI_INT, MPI_SUM, comm);
+
+  // Assign contiguous ranges of the segments to each processor so
+  // that each processor owns approximately the same number of points
+  double total = 0.0;
+  for (int k = 0; k < num_segments; k++) {
+    total += counts[k];
+  }
+  segment_range = new int[mpi_size + 1];
+  segment_range[0] = 0;
+  int rank = 1;
+  double sum = 0.0;
+  for (int k = 0; k < num_segments && rank < mpi_size; k++) {
+    while (rank < mpi_size && sum >= rank * total / mpi_size) {
+      segment_range[rank] = k;
+      rank++;
+    }
+    sum += counts[k];
+  }
+  for (; rank <= mpi_size; rank++) {
+    segment_range[rank] = num_segments;
+  }
+  delete[] counts;
+
+  // Order the points by the processor that owns them
+  int *send_counts = new int[mpi_size];
+  int *send_ptr = new int[mpi_size + 1];
+  memset(send_counts, 0, mpi_size * sizeof(int));
+  for (int i = 0; i < _npts; i++) {
+    owner[i] = getSegmentOwner(owner[i]);
+    send_counts[owner[i]]++;
+  }
+  send_ptr[0] = 0;
+  for (int k = 0; k < mpi_size; k++) {
+    send_ptr[k + 1] = send_ptr[k] + send_counts[k];
+  }
+
+  TMRPoint *send_pts = new TMRPoint[_npts];
+  double *send_hvals = new double[_npts];
+  for (int i = 0; i < _npts; i++) {
+    int j = send_ptr[owner[i]];
+    send_ptr[owner[i]]++;
+    send_pts[j] = _pts[i];
+    send_hvals[j] = _hvals[i];
+  }
+  for (int k = mpi_size; k > 0; k--) {
+    send_ptr[k] = send_ptr[k - 1];
+  }
+  send_ptr[0] = 0;
+  delete[] owner;
+
+  // Send the points to their owners
+  int *recv_counts = new int[mpi_size];
+  int *recv_ptr = new int[mpi_size + 1];
+  MPI_Alltoall(send_counts, 1, MPI_INT, recv_counts, 1, MPI_INT, comm);
+  recv_ptr[0] = 0;
+  for (int k = 0; k < mpi_size; k++) {
+    recv_ptr[k + 1] = recv_ptr[k] + recv_counts[k];
+  }
+
+  npts = recv_ptr[mpi_size];
+  TMRPoint *owned_pts = new TMRPoint[npts];
+  hvals = new double[npts];
+  MPI_Alltoallv(send_pts, send_counts, send_ptr, TMRPoint_MPI_type,
+                owned_pts, recv_counts, recv_ptr, TMRPoint_MPI_type, comm);
+  MPI_Alltoallv(send_hvals, send_counts, send_ptr, MPI_DOUBLE, hvals,
+                recv_counts, recv_ptr, MPI_DOUBLE, comm);
+  delete[] send_pts;
+  delete[] send_hvals;
+  delete[] send_counts;
+  delete[] send_ptr;
+  delete[] recv_counts;
+  delete[] recv_ptr;
+
+  // Create the locator for the points owned by this processor
+  locator = new TMRPointLocator(npts, owned_pts);
+  locator->incref();
+
+  // Compute the bounding box of the points owned by each processor
+  for (int k = 0; k < 6; k++) {
+    bounds[k] = (k < 3 ? DBL_MAX : -DBL_MAX);
+  }
+  for (int i = 0; i < npts; i++) {
+    const double x[3] = {owned_pts[i].x, owned_pts[i].y, owned_pts[i].z};
+    for (int k = 0; k < 3; k++) {
+      if (x[k] < bounds[k]) {
+        bounds[k] = x[k];
+      }
+      if (x[k] > bounds[3 + k]) {
+        bounds[3 + k] = x[k];
+      }
+    }
+  }
+  owner_counts = new int[mpi_size];
+  owner_bounds = new double[6 * mpi_size];
+  MPI_Allgather(&npts, 1, MPI_INT, owner_counts, 1, MPI_INT, comm);
+  MPI_Allgather(bounds, 6, MPI_DOUBLE, owner_bounds, 6, MPI_DOUBLE, comm);
+
+  // Create the coarse sample of the points that is stored on all
+  // processors. Every stride-th owned point is added to the sample.
+  coarse_hvals = NULL;
+  coarse_locator = NULL;
+  if (max_coarse_pts > 0) {
+    int stride = (int)ceil(total / max_coarse_pts);
+    if (stride < 1) {
+      stride = 1;
+    }
+    int ncoarse = (npts + stride - 1) / stride;
+    TMRPoint *coarse_pts = new TMRPoint[ncoarse];
+    double *coarse_h = new double[ncoarse];
+    for (int i = 0, j = 0; i < npts; i += stride, j++) {
+      coarse_pts[j] = owned_pts[i];
+      coarse_h[j] = hvals[i];
+    }
+
+    int *coarse_counts = new int[mpi_size];
+    int *coarse_ptr = new int[mpi_size + 1];
+    MPI_Allgather(&ncoarse, 1, MPI_INT, coarse_counts, 1, MPI_INT, comm);
+    coarse_ptr[0] = 0;
+    for (int k = 0; k < mpi_size; k++) {
+      coarse_ptr[k + 1] = coarse_ptr[k] + coarse_counts[k];
+    }
+
+    int num_coarse = coarse_ptr[mpi_size];
+    TMRPoint *all_pts = new TMRPoint[num_coarse];
+    coarse_hvals = new double[num_coarse];
+    MPI_Allgatherv(coarse_pts, ncoarse, TMRPoint_MPI_type, all_pts,
+                   coarse_counts, coarse_ptr, TMRPoint_MPI_type, comm);
+    MPI_Allgatherv(coarse_h, ncoarse, MPI_DOUBLE, coarse_hvals,
+                   coarse_counts, coarse_ptr, MPI_DOUBLE, comm);
+
+    coarse_locator = new TMRPointLocator(num_coarse, all_pts);
+    coarse_locator->incref();
+
+    delete[] coarse_pts;
+    delete[] coarse_h;
+    delete[] coarse_counts;
+    delete[] coarse_ptr;
+    delete[] all_pts;
+  }
+  delete[] owned_pts;
+
+  cache = new SizeCache();
+}
+
+TMRDistributedPointFeatureSize::~TMRDistributedPointFeatureSize() {
+  delete[] segment_range;
+  delete[] owner_counts;
+  delete[] owner_bounds;
+  delete[] hvals;
+  locator->decref();
+  if (coarse_hvals) {
+    delete[] coarse_hvals;
+  }
+  if (coarse_locator) {
+    coarse_locator->decref();
+  }
+  delete cache;
+}
+
+/*
+  Clear the feature sizes stored in the cache
+*/
+void TMRDistributedPointFeatureSize::clearCache() { cache->clear(); }
+
+/*
+  Get the segment of the Morton curve that contains the point
+*/
+int TMRDistributedPointFeatureSize::getSegment(TMRPoint pt) {
+  uint64_t key = TMR_LocatorPointKey(pt, domain_lower, domain_upper);
+  return (int)(key >> (63 - 3 * NUM_PARTITION_LEVELS));
+}
+
+/*
+  Find the processor that owns the segment of the Morton curve
+*/
+int TMRDistributedPointFeatureSize::getSegmentOwner(int segment) {
+  int low = 0, high = mpi_size;
+  while (high - low > 1) {
+    int mid = (low + high) / 2;
+    if (segment_range[mid] <= segment) {
+      low = mid;
+    } else {
+      high = mid;
+    }
+  }
+  return low;
+}
+
+/*
+  Get the feature size at a point
+
+  This call is not collective. If the feature size at the point is
+  in the cache, it is returned. Otherwise the feature size is
+  approximated from the coarse sample of the points.
+*/
+double TMRDistributedPointFeatureSize::getFeatureSize(TMRPoint pt) {
+  double hval;
+  if (cache->get(pt, &hval)) {
+    return hval;
+  }
+
+  TMRPointLocator *loc = locator;
+  const double *hv = hvals;
+  if (coarse_locator) {
+    loc = coarse_locator;
+    hv = coarse_hvals;
+  }
+
+  int indx[MAX_CLOSEST_POINTS];
+  double dist[MAX_CLOSEST_POINTS];
+  double h[MAX_CLOSEST_POINTS];
+
+  int n = 0;
+  loc->locateClosest(num_sample_pts, pt, &n, indx, dist);
+  for (int i = 0; i < n; i++) {
+    h[i] = hv[indx[i]];
+  }
+
+  return computeFeatureSize(n, dist, h);
+}
+
+/*
+  Evaluate the feature sizes at the points from the full point cloud
+
+  This call is collective on the communicator, but the number of
+  points may be different on each processor. The points that are
+  not in the cache are evaluated in batches and then added to the
+  cache.
+
+  input:
+  n:      the number of points
+  pts:    the points
+
+  output:
+  h:      the feature sizes at the points
+*/
+void TMRDistributedPointFeatureSize::evalFeatureSizes(int n,
+                                                      const TMRPoint pts[],
+                                                      double h[]) {
+  // Find the points that are not in the cache
+  int nq = 0;
+  int *index = new int[n];
+  for (int i = 0; i < n; i++) {
+    if (!cache->get(pts[i], &h[i])) {
+      index[nq] = i;
+      nq++;
+    }
+  }
+
+  // Find the number of batches required on all processors
+  int num_batches = (nq + QUERY_BATCH_SIZE - 1) / QUERY_BATCH_SIZE;
+  MPI_Allreduce(MPI_IN_PLACE, &num_batches, 1, MPI_INT, MPI_MAX, comm);
+
+  for (int k = 0; k < num_batches; k++) {
+    int start = k * QUERY_BATCH_SIZE;
+    int end = start + QUERY_BATCH_SIZE;
+    if (start > nq) {
+      start = nq;
+    }
+    if (end > nq) {
+      end = nq;
+    }
+    evalBatch(end - start, &index[start], pts, h);
+  }
+
+  delete[] index;
+}
+
+/*
+  Evaluate a batch of the queries
+
+  Each point is first sent to the processor that owns its segment of
+  the Morton curve. The point is then sent to any other processor
+  whose bounding box is closer than the K-th closest point found so
+  far, and the results are merged.
+*/
+void TMRDistributedPointFeatureSize::evalBatch(int n, const int index[],
+                                               const TMRPoint pts[],
+                                               double h[]) {
+  const int K = num_sample_pts;
+  const int size = 2 * K + 1;
+
+  // Send each point to the owner of its segment
+  int *rank = new int[n];
+  TMRPoint *X = new TMRPoint[n];
+  for (int j = 0; j < n; j++) {
+    X[j] = pts[index[j]];
+    rank[j] = getSegmentOwner(getSegment(X[j]));
+  }
+  double *results = new double[size * n];
+  locateRemote(n, rank, X, results);
+
+  // Count up the other processors that may own closer points
+  int nremote = 0;
+  for (int j = 0; j < n; j++) {
+    const double *r = &results[size * j];
+    double d2 = ((int)r[0] == K ? r[K] : DBL_MAX);
+    for (int k = 0; k < mpi_size; k++) {
+      if (k != rank[j] && owner_counts[k] > 0 &&
+          TMR_BoxDistance2(&owner_bounds[6 * k], X[j]) < d2) {
+        nremote++;
+      }
+    }
+  }
+
+  int *remote_rank = new int[nremote];
+  int *remote_index = new int[nremote];
+  TMRPoint *Y = new TMRPoint[nremote];
+  nremote = 0;
+  for (int j = 0; j < n; j++) {
+    const double *r = &results[size * j];
+    double d2 = ((int)r[0] == K ? r[K] : DBL_MAX);
+    for (int k = 0; k < mpi_size; k++) {
+      if (k != rank[j] && owner_counts[k] > 0 &&
+          TMR_BoxDistance2(&owner_bounds[6 * k], X[j]) < d2) {
+        remote_rank[nremote] = k;
+        remote_index[nremote] = j;
+        Y[nremote] = X[j];
+        nremote++;
+      }
+    }
+  }
+
+  // Find the closest points on the other processors and merge them
+  double *remote_results = new double[size * nremote];
+  locateRemote(nremote, remote_rank, Y, remote_results);
+  for (int i = 0; i < nremote; i++) {
+    TMR_MergeClosest(K, &results[size * remote_index[i]],
+                     &remote_results[size * i]);
+  }
+
+  // Compute the feature sizes and add them to the cache
+  for (int j = 0; j < n; j++) {
+    double *r = &results[size * j];
+    double hval = computeFeatureSize((int)r[0], &r[1], &r[1 + K]);
+    h[index[j]] = hval;
+    cache->add(X[j], hval);
+  }
+
+  delete[] rank;
+  delete[] X;
+  delete[] results;
+  delete[] remote_rank;
+  delete[] remote_index;
+  delete[] Y;
+  delete[] remote_results;
+}
+
+/*
+  Send the points to the given processors and find the K-closest
+  points owned by those processors. This call is collective.
+
+  The results for each point are the number of closest points found,
+  followed by the K sorted squared distances and the K feature sizes
+  at the closest points.
+
+  input:
+  n:        the number of points
+  rank:     the processor that each point is sent to
+  X:        the points
+
+  output:
+  results:  the closest points for each point (2*K + 1 values each)
+*/
+void TMRDistributedPointFeatureSize::locateRemote(int n, const int rank[],
+                                                  const TMRPoint X[],
+                                                  double results[]) {
+  const int K = num_sample_pts;
+  const int size = 2 * K + 1;
+
+  // Order the points by the destination processor
+  int *send_counts = new int[mpi_size];
+  int *send_ptr = new int[mpi_size + 1];
+  memset(send_counts, 0, mpi_size * sizeof(int));
+  for (int j = 0; j < n; j++) {
+    send_counts[rank[j]]++;
+  }
+  send_ptr[0] = 0;
+  for (int k = 0; k < mpi_size; k++) {
+    send_ptr[k + 1] = send_ptr[k] + send_counts[k];
+  }
+
+  int *order = new int[n];
+  TMRPoint *send_pts = new TMRPoint[n];
+  for (int j = 0; j < n; j++) {
+    int i = send_ptr[rank[j]];
+    send_ptr[rank[j]]++;
+    order[i] = j;
+    send_pts[i] = X[j];
+  }
+  for (int k = mpi_size; k > 0; k--) {
+    send_ptr[k] = send_ptr[k - 1];
+  }
+  send_ptr[0] = 0;
+
+  // Send the points to the processors
+  int *recv_counts = new int[mpi_size];
+  int *recv_ptr = new int[mpi_size + 1];
+  MPI_Alltoall(send_counts, 1, MPI_INT, recv_counts, 1, MPI_INT, comm);
+  recv_ptr[0] = 0;
+  for (int k = 0; k < mpi_size; k++) {
+    recv_ptr[k + 1] = recv_ptr[k] + recv_counts[k];
+  }
+
+  int nrecv = recv_ptr[mpi_size];
+  TMRPoint *recv_pts = new TMRPoint[nrecv];
+  MPI_Alltoallv(send_pts, send_counts, send_ptr, TMRPoint_MPI_type, recv_pts,
+                recv_counts, recv_ptr, TMRPoint_MPI_type, comm);
+
+  // Find the closest points owned by this processor
+  int *nk = new int[nrecv];
+  int *indx = new int[K * nrecv];
+  double *dist = new double[K * nrecv];
+  locator->locateClosest(K, nrecv, recv_pts, nk, indx, dist);
+
+  double *recv_results = new double[size * nrecv];
+  for (int i = 0; i < nrecv; i++) {
+    double *r = &recv_results[size * i];
+    r[0] = nk[i];
+    for (int k = 0; k < K; k++) {
+      if (k < nk[i]) {
+        r[1 + k] = dist[K * i + k];
+        r[1 + K + k] = hvals[indx[K * i + k]];
+      } else {
+        r[1 + k] = 0.0;
+        r[1 + K + k] = 0.0;
+      }
+    }
+  }
+
+  // Send the results back to the processors that made the queries
+  for (int k = 0; k <= mpi_size; k++) {
+    if (k < mpi_size) {
+      send_counts[k] *= size;
+      recv_counts[k] *= size;
+    }
+    send_ptr[k] *= size;
+    recv_ptr[k] *= size;
+  }
+  double *send_results = new double[size * n];
+  MPI_Alltoallv(recv_results, recv_counts, recv_ptr, MPI_DOUBLE,
+                send_results, send_counts, send_ptr, MPI_DOUBLE, comm);
+
+  for (int i = 0; i < n; i++) {
+    memcpy(&results[size * order[i]], &send_results[size * i],
+           size * sizeof(double));
+  }
+
+  delete[] send_counts;
+  delete[] send_ptr;
+  delete[] order;
+  delete[] send_pts;
+  delete[] recv_counts;
+  delete[] recv_ptr;
+  delete[] recv_pts;
+  delete[] nk;
+  delete[] indx;
+  delete[] dist;
+  delete[] recv_results;
+  delete[] send_results;
+}
+
+/*
+  Compute the feature size from the squared distances of the closest
+  points and the feature sizes at those points
+*/
+double TMRDistributedPointFeatureSize::computeFeatureSize(int n, double *dist,
+                                                          const double *h) {
+  return TMR_InterpFeatureSize(n, dist, h, hmin, hmax);
 }
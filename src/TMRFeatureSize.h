@@ -31,6 +31,7 @@ class TMRElementFeatureSize : public TMREntity {
   TMRElementFeatureSize(double _hmin);
   virtual ~TMRElementFeatureSize();
   virtual double getFeatureSize(TMRPoint pt);
+  virtual void getFeatureSizes(int n, const TMRPoint pts[], double h[]);
 
  protected:
   // The min local feature size
@@ -61,17 +62,22 @@ class TMRBoxFeatureSize : public TMRElementFeatureSize {
   ~TMRBoxFeatureSize();
   void addBox(TMRPoint p1, TMRPoint p2, double h);
   double getFeatureSize(TMRPoint pt);
+  void getFeatureSizes(int n, const TMRPoint pts[], double h[]);
 
  private:
+  // Create/free the flattened octree used for the queries
+  void initFlatTree();
+  void freeFlatTree();
+
+  // Find the feature size from the flattened octree
+  double getFlatTreeSize(TMRPoint pt);
+
   // Maximum feature size
   double hmax;
 
   // Store the information about the points
   class BoxSize {
    public:
-    // Check whether the box contains a point
-    int contains(TMRPoint p);
-
     // Data for the box and its location
     TMRPoint m;  // Center of the box
     TMRPoint d;  // Half-edge length of each box
@@ -101,9 +107,6 @@ class TMRBoxFeatureSize : public TMRElementFeatureSize {
     // Add a box
     void addBox(BoxSize *ptr);
 
-    // Add a box to the data structure
-    void getSize(TMRPoint pt, double *h);
-
     // The mid-point of the node and the distance from the mid-point
     // to the box sides
     TMRPoint m, d;
@@ -115,6 +118,26 @@ class TMRBoxFeatureSize : public TMRElementFeatureSize {
     int num_boxes;
     BoxSize **boxes;
   } * root;
+
+  // The flattened octree that is used for the feature size queries.
+  // This is created from the BoxNode octree on the first query after
+  // a box is added. The eight children of a node are stored
+  // contiguously and the boxes of a leaf are copied into a
+  // contiguous range of the box array.
+  class FlatNode {
+   public:
+    double lo[3], mid[3], hi[3];  // Bounds and mid-point of the node
+    int child;                    // The first child (-1 for a leaf)
+    int offset, count;            // The range of the leaf boxes
+  };
+  class FlatBox {
+   public:
+    double lo[3], hi[3];  // Bounds of the box
+    double h;             // Mesh size within the box
+  };
+  int num_flat_nodes, num_flat_boxes;
+  FlatNode *flat_nodes;
+  FlatBox *flat_boxes;
 };
 
 /*
@@ -133,11 +156,22 @@ class TMRPointLocator : public TMREntity {
   void locateClosest(const int K, const TMRPoint pt, int *nk, int *indx,
                      double *dist);
 
+  // Find the K-closest points to each point in a batch of points
+  void locateClosest(const int K, const int n, const TMRPoint X[], int nk[],
+                     int indx[], double dist[]);
+
  private:
   static const int MAX_BIN_SIZE = 16;
 
+  // The minimum number of points to create the tree in parallel
+  static const int MIN_PARALLEL_BUILD_SIZE = 16384;
+
+  // The nodes within the tree while it is being created
+  class TreeNodes;
+
   // Private functions
-  int split(int start, int end);
+  int split(TreeNodes *tree, int start, int end, int level, int *nsub,
+            int *sub);
   int partitionPoints(TMRPoint *loc, TMRPoint *normal, int *indx, int np);
 
   // Find the points that are closest to the provided point
@@ -153,7 +187,7 @@ class TMRPointLocator : public TMREntity {
   TMRPoint *pts;
 
   // Private data for a sorted spatial data structure
-  int num_nodes, max_num_nodes;
+  int num_nodes;
   int *indices, *nodes;
   int *index_offset, *index_count;
   TMRPoint *node_loc, *node_normal;
@@ -171,8 +205,15 @@ class TMRPointFeatureSize : public TMRElementFeatureSize {
                       double _hmax, int _num_sample_pts = 16);
   ~TMRPointFeatureSize();
   double getFeatureSize(TMRPoint pt);
+  void getFeatureSizes(int n, const TMRPoint pts[], double h[]);
 
  private:
+  // The number of points in each batch of closest point searches
+  static const int FEATURE_SIZE_BATCH_SIZE = 4096;
+
+  // Compute the feature size from the closest points
+  double computeFeatureSize(int n, const int *indx, double *dist);
+
   // Find the closest point in the point cloud
   TMRPointLocator *locator;
 
@@ -187,4 +228,110 @@ class TMRPointFeatureSize : public TMRElementFeatureSize {
   int num_sample_pts;
 };
 
+/*
+  Create a feature size from a point cloud that is distributed across
+  processors
+
+  The points are partitioned across the processors along the Morton
+  curve through the bounding box of the full point cloud so that each
+  processor only stores the points in a compact region of space, and
+  the locator for those points. The exact feature size is computed by
+  the collective call evalFeatureSizes(). Each point is first sent to
+  the processor that owns its location on the Morton curve. The query
+  is then sent to each processor whose points may be closer than the
+  K-th closest point found by the owner, and the results are merged.
+  The queries are sent in batches and the results are cached on the
+  processor that made the query.
+
+  The getFeatureSize() call is not collective, so that this class can
+  be used within the meshing code. If the point was evaluated by a
+  previous call to evalFeatureSizes() the cached value is returned.
+  Otherwise, the feature size is approximated from a coarse sample of
+  the points that is stored on all processors.
+*/
+class TMRDistributedPointFeatureSize : public TMRElementFeatureSize {
+ public:
+  // Maximum number of points used
+  static const int MAX_CLOSEST_POINTS = 64;
+
+  TMRDistributedPointFeatureSize(MPI_Comm _comm, int npts, TMRPoint *pts,
+                                 double *hvals, double _hmin, double _hmax,
+                                 int _num_sample_pts = 16,
+                                 int max_coarse_pts = 65536);
+  ~TMRDistributedPointFeatureSize();
+
+  // Evaluate the feature sizes at the points (collective on comm)
+  void evalFeatureSizes(int n, const TMRPoint pts[], double h[]);
+
+  // Get the cached or approximate feature size (not collective)
+  double getFeatureSize(TMRPoint pt);
+
+  // Get the number of points owned by this processor
+  int getNumOwnedPoints() { return npts; }
+
+  // Clear the cached feature sizes
+  void clearCache();
+
+ private:
+  // The number of levels of the Morton curve used to partition the
+  // points. The curve is divided into 2^(3*NUM_PARTITION_LEVELS)
+  // segments that are assigned to the processors.
+  static const int NUM_PARTITION_LEVELS = 6;
+
+  // The maximum number of points queried by each processor in a batch
+  static const int QUERY_BATCH_SIZE = 65536;
+
+  // The cache of the feature sizes
+  class SizeCache;
+
+  // Get the segment of the Morton curve and its owner
+  int getSegment(TMRPoint pt);
+  int getSegmentOwner(int segment);
+
+  // Evaluate a batch of queries
+  void evalBatch(int n, const int index[], const TMRPoint pts[],
+                 double h[]);
+
+  // Send the points to the given processors and find the closest
+  // points on those processors
+  void locateRemote(int n, const int rank[], const TMRPoint X[],
+                    double results[]);
+
+  // Compute the feature size from the closest points
+  double computeFeatureSize(int n, double *dist, const double *h);
+
+  // The communicator and the rank/size
+  MPI_Comm comm;
+  int mpi_rank, mpi_size;
+
+  // Max feature size
+  double hmax;
+
+  // Number of closest points to sample from
+  int num_sample_pts;
+
+  // The bounding box of all of the points
+  TMRPoint domain_lower, domain_upper;
+
+  // The range of the Morton curve segments owned by each processor
+  int *segment_range;
+
+  // The number of points and the bounding box of the points owned
+  // by each processor
+  int *owner_counts;
+  double *owner_bounds;
+
+  // The points owned by this processor
+  int npts;
+  double *hvals;
+  TMRPointLocator *locator;
+
+  // The coarse sample of the points stored on all processors
+  double *coarse_hvals;
+  TMRPointLocator *coarse_locator;
+
+  // The cached feature sizes
+  SizeCache *cache;
+};
+
 #endif  // TMR_FEATURE_SIZE_H
@@ -0,0 +1,431 @@
+/*
+  This file is part of the package TMR for adaptive mesh refinement.
+
+  Copyright (C) 2015 Georgia Tech Research Corporation.
+  Additional copyright (C) 2015 Graeme Kennedy.
+  All rights reserved.
+
+  TMR is licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this software except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include "TMRForestField.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+  Create the field for the elements of the forest with zero values
+*/
+TMRForestField::TMRForestField(TMROctForest *_forest, int _num_components,
+                               TMRFieldTransferType _transfer_type) {
+  forest = _forest;
+  forest->incref();
+  comm = forest->getMPIComm();
+  MPI_Comm_rank(comm, &mpi_rank);
+  MPI_Comm_size(comm, &mpi_size);
+
+  num_components = (_num_components > 0 ? _num_components : 1);
+  transfer_type = _transfer_type;
+
+  layout = NULL;
+  layout_range = new int[mpi_size + 1];
+  setLayout();
+
+  int size;
+  layout->getArray(NULL, &size);
+  values = new double[num_components * size];
+  memset(values, 0, num_components * size * sizeof(double));
+}
+
+/*
+  Free the field
+*/
+TMRForestField::~TMRForestField() {
+  forest->decref();
+  if (layout) {
+    delete layout;
+  }
+  delete[] layout_range;
+  delete[] values;
+}
+
+/*
+  Record the current octants of the forest and their distribution
+*/
+void TMRForestField::setLayout() {
+  if (layout) {
+    delete layout;
+  }
+
+  TMROctantArray *octants;
+  forest->getOctants(&octants);
+  layout = octants->duplicate();
+
+  int size;
+  layout->getArray(NULL, &size);
+  layout_range[0] = 0;
+  MPI_Allgather(&size, 1, MPI_INT, &layout_range[1], 1, MPI_INT, comm);
+  for (int k = 0; k < mpi_size; k++) {
+    layout_range[k + 1] += layout_range[k];
+  }
+
+  octant_stamp = forest->getOctantStamp();
+  partition_stamp = forest->getPartitionStamp();
+}
+
+/*
+  Get the values for the local elements of the forest
+
+  The values are first transferred to the current octants of the
+  forest, if required. The values for element i are stored in
+  values[num_components*i], ..., values[num_components*(i+1)-1].
+
+  output:
+  values:   the values for the local elements
+
+  returns:
+  the number of local elements
+*/
+int TMRForestField::getValues(double **_values) {
+  update();
+
+  int size;
+  layout->getArray(NULL, &size);
+  if (_values) {
+    *_values = values;
+  }
+  return size;
+}
+
+/*
+  Set the values for the local elements to zero
+*/
+void TMRForestField::zeroValues() {
+  update();
+
+  int size;
+  layout->getArray(NULL, &size);
+  memset(values, 0, num_components * size * sizeof(double));
+}
+
+/*
+  Transfer the values to the current octants of the forest
+
+  This is collective on the communicator of the forest when the forest
+  has changed since the values were last transferred.
+*/
+void TMRForestField::update() {
+  if (octant_stamp != forest->getOctantStamp()) {
+    transferOverlap(forest);
+  } else if (partition_stamp != forest->getPartitionStamp()) {
+    transferPartition();
+  }
+}
+
+/*
+  Transfer the values to the octants of another forest
+
+  The new forest must cover the same domain with the same block
+  connectivity, and must be defined on the same communicator. This is
+  a collective call.
+*/
+void TMRForestField::setForest(TMROctForest *_forest) {
+  if (_forest == forest) {
+    update();
+  } else {
+    transferOverlap(_forest);
+  }
+}
+
+/*
+  Move the values to the new partition of the same octants
+
+  Since the octants are unchanged and ordered globally, the values
+  move in contiguous intervals in the same manner as the octants
+  within TMROctForest::repartitionOctants().
+*/
+void TMRForestField::transferPartition() {
+  int new_size;
+  TMROctantArray *octants;
+  forest->getOctants(&octants);
+  octants->getArray(NULL, &new_size);
+
+  int *new_range = new int[mpi_size + 1];
+  new_range[0] = 0;
+  MPI_Allgather(&new_size, 1, MPI_INT, &new_range[1], 1, MPI_INT, comm);
+  for (int k = 0; k < mpi_size; k++) {
+    new_range[k + 1] += new_range[k];
+  }
+
+  // Find the intervals of the local values that are sent to each
+  // processor and the intervals of the new values that are received
+  // from each processor
+  int size = layout_range[mpi_rank + 1] - layout_range[mpi_rank];
+  int *send_counts = new int[mpi_size];
+  int *send_ptr = new int[mpi_size];
+  int *recv_counts = new int[mpi_size];
+  int *recv_ptr = new int[mpi_size];
+  for (int k = 0; k < mpi_size; k++) {
+    int start = new_range[k] - layout_range[mpi_rank];
+    int end = new_range[k + 1] - layout_range[mpi_rank];
+    start = (start < 0 ? 0 : (start > size ? size : start));
+    end = (end < 0 ? 0 : (end > size ? size : end));
+    send_ptr[k] = num_components * start;
+    send_counts[k] = num_components * (end - start);
+
+    start = layout_range[k] - new_range[mpi_rank];
+    end = layout_range[k + 1] - new_range[mpi_rank];
+    start = (start < 0 ? 0 : (start > new_size ? new_size : start));
+    end = (end < 0 ? 0 : (end > new_size ? new_size : end));
+    recv_ptr[k] = num_components * start;
+    recv_counts[k] = num_components * (end - start);
+  }
+
+  double *new_values = new double[num_components * new_size];
+  MPI_Alltoallv(values, send_counts, send_ptr, MPI_DOUBLE, new_values,
+                recv_counts, recv_ptr, MPI_DOUBLE, comm);
+
+  delete[] send_counts;
+  delete[] send_ptr;
+  delete[] recv_counts;
+  delete[] recv_ptr;
+  delete[] new_range;
+
+  delete[] values;
+  values = new_values;
+  setLayout();
+}
+
+/*
+  Transfer the values to the octants of a new forest
+
+  Each new octant is sent to the processors that owned the recorded
+  octants that overlap it. These processors find the overlapping
+  octants with a range query, and return the partially reduced values
+  and the volume of the overlap. The contributions from each processor
+  are then combined according to the transfer rule.
+*/
+void TMRForestField::transferOverlap(TMROctForest *new_forest) {
+  int size;
+  TMROctant *array;
+  layout->getArray(&array, &size);
+
+  // Gather the first octant of each processor that holds recorded
+  // octants, so that the owners of an octant can be found
+  TMROctant first;
+  memset(&first, 0, sizeof(TMROctant));
+  if (size > 0) {
+    first = array[0];
+  }
+  TMROctant *firsts = new TMROctant[mpi_size];
+  MPI_Allgather(&first, 1, TMROctant_MPI_type, firsts, 1, TMROctant_MPI_type,
+                comm);
+
+  int num_owners = 0;
+  int *owner_ranks = new int[mpi_size];
+  for (int k = 0; k < mpi_size; k++) {
+    if (layout_range[k + 1] > layout_range[k]) {
+      firsts[num_owners] = firsts[k];
+      owner_ranks[num_owners] = k;
+      num_owners++;
+    }
+  }
+
+  // Get the new octants
+  int new_size;
+  TMROctant *new_array;
+  TMROctantArray *new_octants;
+  new_forest->getOctants(&new_octants);
+  new_octants->getArray(&new_array, &new_size);
+
+  // Find the interval of owners for each new octant. Since the new
+  // octants are sorted, the owners are non-decreasing.
+  int *owner_ptr = new int[2 * new_size];
+  int *send_counts = new int[mpi_size];
+  memset(send_counts, 0, mpi_size * sizeof(int));
+  for (int i = 0; i < new_size; i++) {
+    // The first and last positions within the new octant
+    const int32_t h = 1 << (TMR_MAX_LEVEL - new_array[i].level);
+    TMROctant last = new_array[i];
+    last.x += h - 1;
+    last.y += h - 1;
+    last.z += h - 1;
+
+    // Find the last owner whose first octant is not after each
+    // position
+    int k0 = 0, k1 = -1;
+    for (int j = 0; j < 2; j++) {
+      const TMROctant *p = (j == 0 ? &new_array[i] : &last);
+      int low = 0, high = num_owners;
+      while (high - low > 1) {
+        int mid = low + (high - low) / 2;
+        if (firsts[mid].comparePosition(p) <= 0) {
+          low = mid;
+        } else {
+          high = mid;
+        }
+      }
+      if (j == 0) {
+        k0 = low;
+      } else {
+        k1 = low;
+      }
+    }
+
+    if (num_owners == 0) {
+      k1 = -1;
+    }
+    owner_ptr[2 * i] = k0;
+    owner_ptr[2 * i + 1] = k1;
+    for (int k = k0; k <= k1; k++) {
+      send_counts[owner_ranks[k]]++;
+    }
+  }
+
+  // Set up the queries for each owner. The tag stores the index of
+  // the new octant.
+  int *send_ptr = new int[mpi_size + 1];
+  send_ptr[0] = 0;
+  for (int k = 0; k < mpi_size; k++) {
+    send_ptr[k + 1] = send_ptr[k] + send_counts[k];
+  }
+  TMROctant *queries = new TMROctant[send_ptr[mpi_size]];
+  int num_queries = 0;
+  for (int i = 0; i < new_size; i++) {
+    for (int k = owner_ptr[2 * i]; k <= owner_ptr[2 * i + 1]; k++) {
+      queries[num_queries] = new_array[i];
+      queries[num_queries].tag = i;
+      num_queries++;
+    }
+  }
+  delete[] owner_ptr;
+  delete[] owner_ranks;
+  delete[] firsts;
+
+  // Exchange the queries
+  int *recv_counts = new int[mpi_size];
+  int *recv_ptr = new int[mpi_size + 1];
+  MPI_Alltoall(send_counts, 1, MPI_INT, recv_counts, 1, MPI_INT, comm);
+  recv_ptr[0] = 0;
+  for (int k = 0; k < mpi_size; k++) {
+    recv_ptr[k + 1] = recv_ptr[k] + recv_counts[k];
+  }
+  TMROctant *recv_queries = new TMROctant[recv_ptr[mpi_size]];
+  MPI_Alltoallv(queries, send_counts, send_ptr, TMROctant_MPI_type,
+                recv_queries, recv_counts, recv_ptr, TMROctant_MPI_type, comm);
+
+  // Compute the contribution of the local values to each query. Each
+  // reply consists of the partially reduced values followed by the
+  // volume of the overlap. The queries from each processor are
+  // sorted, so the range search sweeps through the local octants.
+  const int ncomp = num_components;
+  double *replies = new double[(ncomp + 1) * recv_ptr[mpi_size]];
+  for (int k = 0; k < mpi_size; k++) {
+    int start = 0;
+    for (int i = recv_ptr[k]; i < recv_ptr[k + 1]; i++) {
+      TMROctant *q = &recv_queries[i];
+      double *r = &replies[(ncomp + 1) * i];
+      memset(r, 0, (ncomp + 1) * sizeof(double));
+
+      // Find the recorded octants within the query octant, or
+      // otherwise the recorded octant that contains it
+      int end;
+      int count = layout->findDescendants(q, &start, &end);
+      int j = start, jend = end;
+      if (count == 0) {
+        if (start > 0 && array[start - 1].contains(q)) {
+          j = start - 1;
+          jend = start;
+        }
+      }
+
+      for (; j < jend; j++) {
+        // The volume of the overlap and of the recorded octant
+        int level = (array[j].level > q->level ? array[j].level : q->level);
+        double overlap = ldexp(1.0, -3 * level);
+        double vol = ldexp(1.0, -3 * array[j].level);
+
+        const double *v = &values[ncomp * j];
+        for (int m = 0; m < ncomp; m++) {
+          if (transfer_type == TMR_FIELD_AVERAGE) {
+            r[m] += overlap * v[m];
+          } else if (transfer_type == TMR_FIELD_SUM) {
+            r[m] += (overlap / vol) * v[m];
+          } else if (r[ncomp] == 0.0 || v[m] > r[m]) {
+            r[m] = v[m];
+          }
+        }
+        r[ncomp] += overlap;
+      }
+    }
+  }
+
+  // Return the replies to the processors that sent the queries
+  for (int k = 0; k < mpi_size; k++) {
+    send_counts[k] *= ncomp + 1;
+    send_ptr[k] *= ncomp + 1;
+    recv_counts[k] *= ncomp + 1;
+    recv_ptr[k] *= ncomp + 1;
+  }
+  double *results = new double[(ncomp + 1) * num_queries];
+  MPI_Alltoallv(replies, recv_counts, recv_ptr, MPI_DOUBLE, results,
+                send_counts, send_ptr, MPI_DOUBLE, comm);
+  delete[] replies;
+  delete[] recv_queries;
+  delete[] recv_counts;
+  delete[] recv_ptr;
+  delete[] send_counts;
+  delete[] send_ptr;
+
+  // Combine the contributions to each new octant
+  double *new_values = new double[ncomp * new_size];
+  double *weights = new double[new_size];
+  memset(new_values, 0, ncomp * new_size * sizeof(double));
+  memset(weights, 0, new_size * sizeof(double));
+  for (int i = 0; i < num_queries; i++) {
+    const double *r = &results[(ncomp + 1) * i];
+    if (r[ncomp] > 0.0) {
+      int index = queries[i].tag;
+      double *v = &new_values[ncomp * index];
+      for (int m = 0; m < ncomp; m++) {
+        if (transfer_type != TMR_FIELD_MAX) {
+          v[m] += r[m];
+        } else if (weights[index] == 0.0 || r[m] > v[m]) {
+          v[m] = r[m];
+        }
+      }
+      weights[index] += r[ncomp];
+    }
+  }
+  if (transfer_type == TMR_FIELD_AVERAGE) {
+    for (int i = 0; i < new_size; i++) {
+      if (weights[i] > 0.0) {
+        for (int m = 0; m < ncomp; m++) {
+          new_values[ncomp * i + m] /= weights[i];
+        }
+      }
+    }
+  }
+  delete[] weights;
+  delete[] results;
+  delete[] queries;
+
+  // Set the new values and the new forest
+  delete[] values;
+  values = new_values;
+  new_forest->incref();
+  forest->decref();
+  forest = new_forest;
+  setLayout();
+}
@@ -0,0 +1,118 @@
+/*
+  This file is part of the package TMR for adaptive mesh refinement.
+
+  Copyright (C) 2015 Georgia Tech Research Corporation.
+  Additional copyright (C) 2015 Graeme Kennedy.
+  All rights reserved.
+
+  TMR is licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this software except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef TMR_FOREST_FIELD_H
+#define TMR_FOREST_FIELD_H
+
+#include "TMROctForest.h"
+
+/*
+  The rule used to transfer the values of a field when the octants of
+  the forest change
+
+  TMR_FIELD_AVERAGE: the volume-weighted average of the overlapping
+  values, for intensive quantities such as the density
+
+  TMR_FIELD_SUM: the overlapping values scaled by the fraction of the
+  volume of the original octant, so that the total is conserved. This
+  is suited to extensive quantities such as element error estimates.
+
+  TMR_FIELD_MAX: the maximum of the overlapping values, for quantities
+  such as refinement indicators
+*/
+enum TMRFieldTransferType { TMR_FIELD_AVERAGE, TMR_FIELD_SUM, TMR_FIELD_MAX };
+
+/*
+  A distributed field with values for each element of a forest
+
+  The field stores a fixed number of values for each locally owned
+  octant of the forest, in the order of the local octant array. The
+  values follow the forest as it is modified: when the octants are
+  repartitioned, the values are moved to the new owners with the same
+  interval exchange that moves the octants, and when the octants are
+  refined, coarsened or balanced, the values are transferred to the
+  new octants from the original octants that overlap them using the
+  transfer rule. A field can also be transferred to another forest
+  that covers the same domain, such as the forest returned by
+  coarsen().
+
+  The field records the octants that its values correspond to and
+  compares the stamps of the forest to detect changes. The transfer is
+  performed by getValues() or update(), which are collective on the
+  communicator of the forest whenever the forest has changed since the
+  values were last transferred. This provides a way to carry
+  adaptation data, such as refinement indicators or density
+  snapshots, between adaptation steps without creating TACS vectors.
+
+  Nodal data depends on the numbering created by createNodes(), and is
+  transferred with TMROctForest::transferNodalField().
+*/
+class TMRForestField : public TMREntity {
+ public:
+  TMRForestField(TMROctForest *_forest, int _num_components = 1,
+                 TMRFieldTransferType _transfer_type = TMR_FIELD_AVERAGE);
+  ~TMRForestField();
+
+  // Get the forest and the number of values per element
+  // ---------------------------------------------------
+  TMROctForest *getForest() { return forest; }
+  int getNumComponents() { return num_components; }
+
+  // Get the values for the local elements and set them to zero
+  // ----------------------------------------------------------
+  int getValues(double **_values);
+  void zeroValues();
+
+  // Transfer the values to the current octants of the forest or to
+  // the octants of another forest
+  // ---------------------------------------------------------------
+  void update();
+  void setForest(TMROctForest *_forest);
+
+ private:
+  // Record the current octants of the forest
+  void setLayout();
+
+  // Move the values to the new partition of the same octants
+  void transferPartition();
+
+  // Transfer the values to the octants of another forest
+  void transferOverlap(TMROctForest *new_forest);
+
+  // The forest and its communicator
+  TMROctForest *forest;
+  MPI_Comm comm;
+  int mpi_rank, mpi_size;
+
+  // The number of values per element and the transfer rule
+  int num_components;
+  TMRFieldTransferType transfer_type;
+
+  // The octants that the values correspond to, their offsets on each
+  // processor and the stamps of the forest when they were recorded
+  TMROctantArray *layout;
+  int *layout_range;
+  int octant_stamp, partition_stamp;
+
+  // The values for each local element
+  double *values;
+};
+
+#endif  // TMR_FOREST_FIELD_H
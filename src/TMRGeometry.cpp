@@ -25,6 +25,20 @@
 
 #include "TMRMesh.h"
 
+/*
+  Evaluate a batch of points. By default, this evaluates each point
+  in turn. Derived classes can implement a more efficient version.
+*/
+int TMRCurve::evalPoints(int n, const double t[], TMRPoint X[]) {
+  int fail = 0;
+  for (int i = 0; i < n; i++) {
+    if (evalPoint(t[i], &X[i])) {
+      fail = 1;
+    }
+  }
+  return fail;
+}
+
 /*
   Compute the inverse: This is not always required. By default it is
   not implemented. Derived classes can implement it if needed.
@@ -35,6 +49,20 @@ int TMRCurve::invEvalPoint(TMRPoint X, double *t) {
   return fail;
 }
 
+/*
+  Perform the inverse evaluation for a batch of points. By default,
+  this inverts each point in turn.
+*/
+int TMRCurve::invEvalPoints(int n, const TMRPoint X[], double t[]) {
+  int fail = 0;
+  for (int i = 0; i < n; i++) {
+    if (invEvalPoint(X[i], &t[i])) {
+      fail = 1;
+    }
+  }
+  return fail;
+}
+
 /*
   Set the step size for the derivative
 */
@@ -175,6 +203,36 @@ void TMRCurve::writeToVTK(const char *filename) {
   }
 }
 
+/*
+  Evaluate a batch of points. By default, this evaluates each point
+  in turn. Derived classes can implement a more efficient version.
+*/
+int TMRSurface::evalPoints(int n, const double u[], const double v[],
+                           TMRPoint X[]) {
+  int fail = 0;
+  for (int i = 0; i < n; i++) {
+    if (evalPoint(u[i], v[i], &X[i])) {
+      fail = 1;
+    }
+  }
+  return fail;
+}
+
+/*
+  Perform the inverse evaluation for a batch of points. By default,
+  this inverts each point in turn.
+*/
+int TMRSurface::invEvalPoints(int n, const TMRPoint p[], double u[],
+                              double v[]) {
+  int fail = 0;
+  for (int i = 0; i < n; i++) {
+    if (invEvalPoint(p[i], &u[i], &v[i])) {
+      fail = 1;
+    }
+  }
+  return fail;
+}
+
 /*
   Set the step size for the derivative
 */
@@ -45,9 +45,15 @@ class TMRCurve : public TMREntity {
   // Given the parametric point, evaluate the x,y,z location
   virtual int evalPoint(double t, TMRPoint *X) = 0;
 
+  // Evaluate the x,y,z locations of a batch of parametric points
+  virtual int evalPoints(int n, const double t[], TMRPoint X[]);
+
   // Given the point, find the parametric location
   virtual int invEvalPoint(TMRPoint X, double *t);
 
+  // Find the parametric locations of a batch of points
+  virtual int invEvalPoints(int n, const TMRPoint X[], double t[]);
+
   // Given the parametric point, evaluate the derivative
   virtual int evalDeriv(double t, TMRPoint *X, TMRPoint *Xt);
 
@@ -74,9 +80,16 @@ class TMRSurface : public TMREntity {
   // Given the parametric point, compute the x,y,z location
   virtual int evalPoint(double u, double v, TMRPoint *X) = 0;
 
+  // Evaluate the x,y,z locations of a batch of parametric points
+  virtual int evalPoints(int n, const double u[], const double v[],
+                         TMRPoint X[]);
+
   // Perform the inverse evaluation
   virtual int invEvalPoint(TMRPoint p, double *u, double *v) = 0;
 
+  // Perform the inverse evaluation for a batch of points
+  virtual int invEvalPoints(int n, const TMRPoint p[], double u[], double v[]);
+
   // Given the parametric point, evaluate the first derivative
   virtual int evalDeriv(double u, double v, TMRPoint *X, TMRPoint *Xu,
                         TMRPoint *Xv);
@@ -0,0 +1,356 @@
+/*
+  This file is part of the package TMR for adaptive mesh refinement.
+
+  Copyright (C) 2015 Georgia Tech Research Corporation.
+  Additional copyright (C) 2015 Graeme Kennedy.
+  All rights reserved.
+
+  TMR is licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this software except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include "TMRInterpCache.h"
+
+#include <stdio.h>
+
+/*
+  The first integers in a file written by writeToFile(): a magic
+  number (the characters "TMRI"), the version of the format, the
+  number of processors and the size of the info array
+*/
+static const int TMR_INTERP_FILE_MAGIC = 0x49524d54;
+static const int TMR_INTERP_FILE_VERSION = 1;
+static const int TMR_INTERP_FILE_HEADER_SIZE = 4;
+
+/*
+  Create an empty interpolation cache
+*/
+TMRInterpCache::TMRInterpCache() {
+  num_rows = 0;
+  max_rows = 1024;
+  rows = new int[max_rows];
+  row_ptr = new int[max_rows + 1];
+  row_ptr[0] = 0;
+
+  num_entries = 0;
+  max_entries = 8 * max_rows;
+  vars = new int[max_entries];
+  weights = new double[max_entries];
+}
+
+/*
+  Free the interpolation cache
+*/
+TMRInterpCache::~TMRInterpCache() {
+  delete[] rows;
+  delete[] row_ptr;
+  delete[] vars;
+  delete[] weights;
+}
+
+/*
+  Remove all the rows from the cache
+*/
+void TMRInterpCache::clear() {
+  num_rows = 0;
+  num_entries = 0;
+  row_ptr[0] = 0;
+}
+
+/*
+  Add a row of the interpolation operator
+
+  input:
+  row:      the global index of the fine node
+  weights:  the interpolation weights
+  vars:     the global indices of the coarse nodes
+  size:     the number of entries in the row
+*/
+void TMRInterpCache::addInterp(int row, const double _weights[],
+                               const int _vars[], int size) {
+  // Extend the row storage if needed
+  if (num_rows >= max_rows) {
+    max_rows *= 2;
+    int *new_rows = new int[max_rows];
+    int *new_row_ptr = new int[max_rows + 1];
+    memcpy(new_rows, rows, num_rows * sizeof(int));
+    memcpy(new_row_ptr, row_ptr, (num_rows + 1) * sizeof(int));
+    delete[] rows;
+    delete[] row_ptr;
+    rows = new_rows;
+    row_ptr = new_row_ptr;
+  }
+
+  // Extend the entry storage if needed
+  if (num_entries + size > max_entries) {
+    max_entries = 2 * (num_entries + size);
+    int *new_vars = new int[max_entries];
+    double *new_weights = new double[max_entries];
+    memcpy(new_vars, vars, num_entries * sizeof(int));
+    memcpy(new_weights, weights, num_entries * sizeof(double));
+    delete[] vars;
+    delete[] weights;
+    vars = new_vars;
+    weights = new_weights;
+  }
+
+  rows[num_rows] = row;
+  memcpy(&vars[num_entries], _vars, size * sizeof(int));
+  memcpy(&weights[num_entries], _weights, size * sizeof(double));
+  num_entries += size;
+  num_rows++;
+  row_ptr[num_rows] = num_entries;
+}
+
+/*
+  Add all the stored rows to the interpolation object
+
+  Note that the interpolation object must still be initialized.
+*/
+void TMRInterpCache::setInterp(TACSBVecInterp *interp) {
+  for (int i = 0; i < num_rows; i++) {
+    int ptr = row_ptr[i];
+    interp->addInterp(rows[i], &weights[ptr], &vars[ptr],
+                      row_ptr[i + 1] - ptr);
+  }
+}
+
+/*
+  Write the rows from all processors to a binary file
+
+  The file contains a header with a magic number, the format version,
+  the number of processors and the size of the info array, followed
+  by the info array and the
+  number of rows and entries on each processor, followed by the rows
+  from each processor in rank order. This is a collective call.
+
+  input:
+  comm:       the communicator
+  filename:   the name of the file
+  info:       integers identifying the operator
+  info_size:  the number of integers
+
+  returns:
+  a non-zero value if the file cannot be written
+*/
+int TMRInterpCache::writeToFile(MPI_Comm comm, const char *filename,
+                                const int info[], int info_size) {
+  int mpi_rank, mpi_size;
+  MPI_Comm_rank(comm, &mpi_rank);
+  MPI_Comm_size(comm, &mpi_size);
+
+  // Gather the number of rows and entries from all processors
+  int local[2];
+  local[0] = num_rows;
+  local[1] = num_entries;
+  int *counts = new int[2 * mpi_size];
+  MPI_Allgather(local, 2, MPI_INT, counts, 2, MPI_INT, comm);
+
+  // Compute the offset to the rows from this processor
+  const int hsize = TMR_INTERP_FILE_HEADER_SIZE;
+  MPI_Offset offset = (hsize + info_size + 2 * mpi_size) * sizeof(int);
+  for (int i = 0; i < mpi_rank; i++) {
+    offset += (2 * counts[2 * i] + 1 + counts[2 * i + 1]) * sizeof(int) +
+              counts[2 * i + 1] * sizeof(double);
+  }
+
+  // Copy the filename to a non-const array
+  char *fname = new char[strlen(filename) + 1];
+  strcpy(fname, filename);
+
+  int fail = 0;
+  MPI_File fp = MPI_FILE_NULL;
+  if (MPI_File_open(comm, fname, MPI_MODE_WRONLY | MPI_MODE_CREATE,
+                    MPI_INFO_NULL, &fp) == MPI_SUCCESS) {
+    // Discard the contents of an existing file
+    MPI_File_set_size(fp, 0);
+
+    // Write out the header
+    if (mpi_rank == 0) {
+      int header[TMR_INTERP_FILE_HEADER_SIZE];
+      header[0] = TMR_INTERP_FILE_MAGIC;
+      header[1] = TMR_INTERP_FILE_VERSION;
+      header[2] = mpi_size;
+      header[3] = info_size;
+      MPI_File_write_at(fp, 0, header, hsize, MPI_INT, MPI_STATUS_IGNORE);
+      MPI_File_write_at(fp, hsize * sizeof(int), (void *)info, info_size,
+                        MPI_INT, MPI_STATUS_IGNORE);
+      MPI_File_write_at(fp, (hsize + info_size) * sizeof(int), counts,
+                        2 * mpi_size, MPI_INT, MPI_STATUS_IGNORE);
+    }
+
+    // Write out the rows from this processor
+    MPI_File_write_at_all(fp, offset, rows, num_rows, MPI_INT,
+                          MPI_STATUS_IGNORE);
+    offset += num_rows * sizeof(int);
+    MPI_File_write_at_all(fp, offset, row_ptr, num_rows + 1, MPI_INT,
+                          MPI_STATUS_IGNORE);
+    offset += (num_rows + 1) * sizeof(int);
+    MPI_File_write_at_all(fp, offset, vars, num_entries, MPI_INT,
+                          MPI_STATUS_IGNORE);
+    offset += num_entries * sizeof(int);
+    MPI_File_write_at_all(fp, offset, weights, num_entries, MPI_DOUBLE,
+                          MPI_STATUS_IGNORE);
+    MPI_File_close(&fp);
+  } else {
+    fail = 1;
+  }
+
+  delete[] counts;
+  delete[] fname;
+
+  return fail;
+}
+
+/*
+  Read the rows for this processor from a binary file
+
+  The file must have been written on the same number of processors
+  with an identical info array, otherwise no rows are read. This is a
+  collective call.
+
+  input:
+  comm:       the communicator
+  filename:   the name of the file
+  info:       integers identifying the operator
+  info_size:  the number of integers
+
+  returns:
+  a non-zero value if the file cannot be read or does not match
+*/
+int TMRInterpCache::readFromFile(MPI_Comm comm, const char *filename,
+                                 const int info[], int info_size) {
+  int mpi_rank, mpi_size;
+  MPI_Comm_rank(comm, &mpi_rank);
+  MPI_Comm_size(comm, &mpi_size);
+
+  // Copy the filename to a non-const array
+  char *fname = new char[strlen(filename) + 1];
+  strcpy(fname, filename);
+
+  MPI_File fp = MPI_FILE_NULL;
+  int open_fail = (MPI_File_open(comm, fname, MPI_MODE_RDONLY, MPI_INFO_NULL,
+                                 &fp) != MPI_SUCCESS);
+  delete[] fname;
+
+  if (open_fail) {
+    if (mpi_rank == 0) {
+      fprintf(stderr, "TMRInterpCache Error: Could not open file %s\n",
+              filename);
+    }
+    return 1;
+  }
+
+  // Read the header. The header is zeroed first so that a short file
+  // fails the checks. Every processor reads the same values, so the
+  // checks below are consistent across processors.
+  const int hsize = TMR_INTERP_FILE_HEADER_SIZE;
+  int header[TMR_INTERP_FILE_HEADER_SIZE];
+  memset(header, 0, sizeof(header));
+  MPI_File_read_at_all(fp, 0, header, hsize, MPI_INT, MPI_STATUS_IGNORE);
+  int fail = (header[0] != TMR_INTERP_FILE_MAGIC ||
+              header[1] != TMR_INTERP_FILE_VERSION ||
+              header[2] != mpi_size || header[3] != info_size);
+  if (!fail) {
+    int *file_info = new int[info_size];
+    memset(file_info, 0, info_size * sizeof(int));
+    MPI_File_read_at_all(fp, hsize * sizeof(int), file_info, info_size,
+                         MPI_INT, MPI_STATUS_IGNORE);
+    for (int i = 0; i < info_size; i++) {
+      if (file_info[i] != info[i]) {
+        fail = 1;
+      }
+    }
+    delete[] file_info;
+  }
+
+  if (fail) {
+    if (mpi_rank == 0) {
+      fprintf(stderr,
+              "TMRInterpCache Error: File %s does not match the "
+              "interpolation operator\n",
+              filename);
+    }
+    MPI_File_close(&fp);
+    return fail;
+  }
+
+  // Read the number of rows and entries on all processors
+  int *counts = new int[2 * mpi_size];
+  memset(counts, 0, 2 * mpi_size * sizeof(int));
+  MPI_File_read_at_all(fp, (hsize + info_size) * sizeof(int), counts,
+                       2 * mpi_size, MPI_INT, MPI_STATUS_IGNORE);
+
+  // Find the offset to the rows from this processor and the size of
+  // the complete file
+  MPI_Offset offset = 0, file_end = 0;
+  file_end = (hsize + info_size + 2 * mpi_size) * sizeof(int);
+  for (int i = 0; i < mpi_size; i++) {
+    if (i == mpi_rank) {
+      offset = file_end;
+    }
+    if (counts[2 * i] < 0 || counts[2 * i + 1] < 0) {
+      fail = 1;
+    }
+    file_end += (2 * counts[2 * i] + 1 + counts[2 * i + 1]) * sizeof(int) +
+                counts[2 * i + 1] * sizeof(double);
+  }
+
+  MPI_Offset file_size = 0;
+  MPI_File_get_size(fp, &file_size);
+  if (fail || file_size < file_end) {
+    if (mpi_rank == 0) {
+      fprintf(stderr, "TMRInterpCache Error: File %s is truncated\n",
+              filename);
+    }
+    delete[] counts;
+    MPI_File_close(&fp);
+    return 1;
+  }
+
+  // Allocate space for the rows on this processor
+  clear();
+  num_rows = counts[2 * mpi_rank];
+  num_entries = counts[2 * mpi_rank + 1];
+  delete[] counts;
+
+  if (num_rows > max_rows) {
+    max_rows = num_rows;
+    delete[] rows;
+    delete[] row_ptr;
+    rows = new int[max_rows];
+    row_ptr = new int[max_rows + 1];
+  }
+  if (num_entries > max_entries) {
+    max_entries = num_entries;
+    delete[] vars;
+    delete[] weights;
+    vars = new int[max_entries];
+    weights = new double[max_entries];
+  }
+
+  // Read in the rows for this processor
+  MPI_File_read_at_all(fp, offset, rows, num_rows, MPI_INT,
+                       MPI_STATUS_IGNORE);
+  offset += num_rows * sizeof(int);
+  MPI_File_read_at_all(fp, offset, row_ptr, num_rows + 1, MPI_INT,
+                       MPI_STATUS_IGNORE);
+  offset += (num_rows + 1) * sizeof(int);
+  MPI_File_read_at_all(fp, offset, vars, num_entries, MPI_INT,
+                       MPI_STATUS_IGNORE);
+  offset += num_entries * sizeof(int);
+  MPI_File_read_at_all(fp, offset, weights, num_entries, MPI_DOUBLE,
+                       MPI_STATUS_IGNORE);
+  MPI_File_close(&fp);
+
+  return 0;
+}
@@ -0,0 +1,77 @@
+/*
+  This file is part of the package TMR for adaptive mesh refinement.
+
+  Copyright (C) 2015 Georgia Tech Research Corporation.
+  Additional copyright (C) 2015 Graeme Kennedy.
+  All rights reserved.
+
+  TMR is licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this software except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef TMR_INTERP_CACHE_H
+#define TMR_INTERP_CACHE_H
+
+#include "TACSBVecInterp.h"
+#include "TMRBase.h"
+
+/*
+  A stored copy of the local rows of an interpolation operator
+
+  Computing the interpolation between two forests requires a search
+  for the enclosing coarse element of every fine node and an exchange
+  of the nodes that lie in elements on other processors. When the
+  forests do not change, the operator is the same each time it is
+  created. This object records the rows of the operator as they are
+  computed so that they can be added to a new TACSBVecInterp object
+  directly, or written to a file and read back on restart.
+
+  The rows are stored in the order in which they are added in a
+  compressed row format. The file format stores the rows from each
+  processor contiguously, so a file can only be read back on the same
+  number of processors with the same node numbering. The info array
+  written to the file is provided by the caller to identify the
+  operator, and must match when the file is read.
+*/
+class TMRInterpCache : public TMREntity {
+ public:
+  TMRInterpCache();
+  ~TMRInterpCache();
+
+  // Add a row, or add all the rows to an interpolation object
+  void addInterp(int row, const double weights[], const int vars[], int size);
+  void setInterp(TACSBVecInterp *interp);
+
+  // Get the number of rows and remove all the rows
+  int getNumRows() { return num_rows; }
+  size_t getMemoryUsage() {
+    return (2 * max_rows + 1) * sizeof(int) +
+           max_entries * (sizeof(int) + sizeof(double));
+  }
+  void clear();
+
+  // Write/read the rows from all processors to/from a file
+  int writeToFile(MPI_Comm comm, const char *filename, const int info[],
+                  int info_size);
+  int readFromFile(MPI_Comm comm, const char *filename, const int info[],
+                   int info_size);
+
+ private:
+  // The rows in a compressed row format
+  int num_rows, max_rows;
+  int *rows, *row_ptr;
+  int num_entries, max_entries;
+  int *vars;
+  double *weights;
+};
+
+#endif  // TMR_INTERP_CACHE_H
@@ -148,6 +148,245 @@ inline void lagrange_shape_func_second_derivative(const int order,
   }
 }
 
+/*
+  Compute the barycentric weights for the Lagrange shape functions
+
+  The weights are the constant denominators of the Lagrange shape
+  functions. Once computed, the shape functions and their derivatives
+  can be evaluated without any divisions.
+
+  input:
+  order:  the order of the polynomial and number of knots
+  knots:  the interpolation knots in parameter space
+
+  output:
+  wts:    the barycentric weights for each knot
+*/
+inline void lagrange_barycentric_weights(const int order, const double *knots,
+                                         double *wts) {
+  for (int i = 0; i < order; i++) {
+    double d = 1.0;
+    for (int j = 0; j < order; j++) {
+      if (i != j) {
+        d *= (knots[i] - knots[j]);
+      }
+    }
+    wts[i] = 1.0 / d;
+  }
+}
+
+/*
+  Evaluate the shape functions at the given parametric point using
+  the precomputed barycentric weights
+
+  The products of (u - knots[j]) for j < i and j > i are accumulated
+  in a forward and a backward pass, so the cost is linear in the
+  order and the shape functions are exact at the knots.
+
+  input:
+  order:  the order of the polynomial and number of knots
+  u:      the parametric coordinate
+  knots:  the interpolation knots in parameter space
+  wts:    the barycentric weights
+
+  output:
+  N:      the values of the shape functions at u
+*/
+inline void lagrange_shape_functions(const int order, const double u,
+                                     const double *knots, const double *wts,
+                                     double *N) {
+  double p = 1.0;
+  for (int i = 0; i < order; i++) {
+    N[i] = wts[i] * p;
+    p *= (u - knots[i]);
+  }
+
+  double s = 1.0;
+  for (int i = order - 1; i >= 0; i--) {
+    N[i] *= s;
+    s *= (u - knots[i]);
+  }
+}
+
+/*
+  Evaluate the shape functions and their derivative at the given
+  parametric point using the precomputed barycentric weights
+
+  input:
+  order:  the order of the polynomial and number of knots
+  u:      the parametric coordinate
+  knots:  the interpolation knots in parameter space
+  wts:    the barycentric weights
+
+  output:
+  N:      the values of the shape functions at u
+  Nd:     the derivative of the shape functions at u
+*/
+inline void lagrange_shape_func_derivative(const int order, const double u,
+                                           const double *knots,
+                                           const double *wts, double *N,
+                                           double *Nd) {
+  // Forward pass: the product over j < i and its derivative
+  double p = 1.0, dp = 0.0;
+  for (int i = 0; i < order; i++) {
+    N[i] = p;
+    Nd[i] = dp;
+    double t = u - knots[i];
+    dp = dp * t + p;
+    p *= t;
+  }
+
+  // Backward pass: combine with the product over j > i
+  double s = 1.0, ds = 0.0;
+  for (int i = order - 1; i >= 0; i--) {
+    Nd[i] = wts[i] * (Nd[i] * s + N[i] * ds);
+    N[i] = wts[i] * N[i] * s;
+    double t = u - knots[i];
+    ds = ds * t + s;
+    s *= t;
+  }
+}
+
+/*
+  Evaluate the shape functions and their first and second derivatives
+  at the given parametric point using the precomputed barycentric
+  weights
+
+  input:
+  order:  the order of the polynomial and number of knots
+  u:      the parametric coordinate
+  knots:  the interpolation knots in parameter space
+  wts:    the barycentric weights
+
+  output:
+  N:      the values of the shape functions at u
+  Nd:     the derivative of the shape functions at u
+  Ndd:    the second derivative of the shape functions at u
+*/
+inline void lagrange_shape_func_second_derivative(
+    const int order, const double u, const double *knots, const double *wts,
+    double *N, double *Nd, double *Ndd) {
+  // Forward pass: the product over j < i and its derivatives
+  double p = 1.0, dp = 0.0, ddp = 0.0;
+  for (int i = 0; i < order; i++) {
+    N[i] = p;
+    Nd[i] = dp;
+    Ndd[i] = ddp;
+    double t = u - knots[i];
+    ddp = ddp * t + 2.0 * dp;
+    dp = dp * t + p;
+    p *= t;
+  }
+
+  // Backward pass: combine with the product over j > i
+  double s = 1.0, ds = 0.0, dds = 0.0;
+  for (int i = order - 1; i >= 0; i--) {
+    Ndd[i] = wts[i] * (Ndd[i] * s + 2.0 * Nd[i] * ds + N[i] * dds);
+    Nd[i] = wts[i] * (Nd[i] * s + N[i] * ds);
+    N[i] = wts[i] * N[i] * s;
+    double t = u - knots[i];
+    dds = dds * t + 2.0 * ds;
+    ds = ds * t + s;
+    s *= t;
+  }
+}
+
+/*
+  Evaluate the shape functions at a block of parametric points using
+  the precomputed barycentric weights
+
+  The shape functions are stored by knot first, so that the values
+  for all points associated with the i-th knot are contiguous. The
+  innermost loops run over the points with unit stride and no
+  dependence between iterations so that they can be vectorized by
+  the compiler.
+
+  input:
+  order:  the order of the polynomial and number of knots
+  npts:   the number of parametric points
+  u:      the parametric coordinates
+  knots:  the interpolation knots in parameter space
+  wts:    the barycentric weights
+  work:   a temporary array of size npts
+
+  output:
+  N:      the values of the shape functions N[npts*i + n]
+*/
+inline void lagrange_shape_functions(const int order, const int npts,
+                                     const double *u, const double *knots,
+                                     const double *wts, double *work,
+                                     double *N) {
+  for (int n = 0; n < npts; n++) {
+    work[n] = 1.0;
+  }
+  for (int i = 0; i < order; i++) {
+    const double x = knots[i], w = wts[i];
+    double *Ni = &N[npts * i];
+    for (int n = 0; n < npts; n++) {
+      Ni[n] = w * work[n];
+      work[n] *= (u[n] - x);
+    }
+  }
+
+  for (int n = 0; n < npts; n++) {
+    work[n] = 1.0;
+  }
+  for (int i = order - 1; i >= 0; i--) {
+    const double x = knots[i];
+    double *Ni = &N[npts * i];
+    for (int n = 0; n < npts; n++) {
+      Ni[n] *= work[n];
+      work[n] *= (u[n] - x);
+    }
+  }
+}
+
+/*
+  Evaluate the Bernstein shape functions at a block of parametric
+  points
+
+  The shape functions are stored by basis function first, as in the
+  Lagrange version above, so that the innermost loops can be
+  vectorized.
+
+  input:
+  order:  the order of the polynomial
+  npts:   the number of parametric points
+  u:      the parametric coordinates
+  work:   a temporary array of size 2*npts
+
+  output:
+  N:      the values of the shape functions N[npts*i + n]
+*/
+inline void bernstein_shape_functions(const int order, const int npts,
+                                      const double *u, double *work,
+                                      double *N) {
+  double *u1 = &work[0];
+  double *u2 = &work[npts];
+  for (int n = 0; n < npts; n++) {
+    u1[n] = 0.5 * (1.0 - u[n]);
+    u2[n] = 0.5 * (u[n] + 1.0);
+    N[n] = 1.0;
+  }
+
+  // Apply the de Casteljau recurrence, keeping the carried value for
+  // each point in the next row of N
+  for (int j = 1; j < order; j++) {
+    double *Nj = &N[npts * j];
+    for (int n = 0; n < npts; n++) {
+      Nj[n] = 0.0;
+    }
+    for (int k = j - 1; k >= 0; k--) {
+      double *Nk = &N[npts * k];
+      double *Nk1 = &N[npts * (k + 1)];
+      for (int n = 0; n < npts; n++) {
+        Nk1[n] += u2[n] * Nk[n];
+        Nk[n] *= u1[n];
+      }
+    }
+  }
+}
+
 /*
   Evaluate the Bernstein shape functions at the given parametric point
 
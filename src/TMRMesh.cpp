@@ -21,6 +21,7 @@
 #include "TMRMesh.h"
 
 #include <math.h>
+#include <stdarg.h>
 #include <stdio.h>
 
 #include "TMRBspline.h"
@@ -28,10 +29,17 @@
 #include "TMRFaceMesh.h"
 #include "TMRMeshSmoothing.h"
 #include "TMRNativeTopology.h"
+#include "TMRRadixSort.h"
+#include "TMRTrace.h"
 #include "TMRTriangularize.h"
 #include "TMRVolumeMesh.h"
+#include "TMR_VTKTools.h"
 #include "tmrlapack.h"
 
+#ifdef TMR_HAS_OPENMP
+#include <omp.h>
+#endif
+
 /*
   The triangle nodes and edges are ordered locally as follows. Note
   that the edges are ordered based on the node across the triangle.
@@ -107,104 +115,11 @@ const int hex_face_nodes[6][4] = {{0, 3, 7, 4}, {1, 2, 6, 5},   // x-faces
                                   {0, 4, 5, 1}, {3, 7, 6, 2},   // y-faces
                                   {0, 1, 2, 3}, {4, 5, 6, 7}};  // z-faces
 
-/*
-  Possible orientations for two connecting faces
-*/
-const int face_orientations[8][4] = {{0, 1, 2, 3}, {1, 2, 3, 0}, {2, 3, 0, 1},
-                                     {3, 0, 1, 2}, {3, 2, 1, 0}, {0, 3, 2, 1},
-                                     {1, 0, 3, 2}, {2, 1, 0, 3}};
-
 /*
   Hexahedral local node to local coordinate ordering transformation
 */
 const int hex_coordinate_order[] = {0, 1, 3, 2, 4, 5, 7, 6};
 
-/*
-  Compare coordinate pairs of points. This uses a Morton ordering
-  comparison to facilitate sorting/searching the list of edges.
-
-  This function can be used by the stdlib functions qsort and
-  bsearch to sort/search the edge pairs.
-*/
-static int compare_edges(const void *avoid, const void *bvoid) {
-  const int *a = static_cast<const int *>(avoid);
-  const int *b = static_cast<const int *>(bvoid);
-
-  // Extract the x/y locations for the a and b points
-  int ax = a[1], ay = a[2];
-  int bx = b[1], by = b[2];
-
-  int xxor = ax ^ bx;
-  int yxor = ay ^ by;
-  int sor = xxor | yxor;
-
-  // Note that here we do not distinguish between levels
-  // Check for the most-significant bit
-  int discrim = 0;
-  if (xxor > (sor ^ xxor)) {
-    discrim = ax - bx;
-  } else {
-    discrim = ay - by;
-  }
-
-  return discrim;
-}
-
-/*
-  Compare two edges to one another directly (not-indexed)
-*/
-static int compare_edges_simple(const void *avoid, const void *bvoid) {
-  const int *a = static_cast<const int *>(avoid);
-  const int *b = static_cast<const int *>(bvoid);
-
-  // Extract the x/y locations for the a and b points
-  int ax = a[0], ay = a[1];
-  int bx = b[0], by = b[1];
-
-  int xxor = ax ^ bx;
-  int yxor = ay ^ by;
-  int sor = xxor | yxor;
-
-  // Note that here we do not distinguish between levels
-  // Check for the most-significant bit
-  int discrim = 0;
-  if (xxor > (sor ^ xxor)) {
-    discrim = ax - bx;
-  } else {
-    discrim = ay - by;
-  }
-
-  return discrim;
-}
-
-/*
-  Compare faces. The faces themselves must be sorted such that
-  the indices are increasing.
-
-  This is used to determine the resulting face number given the
-  corresponding list of nodes.
-*/
-static int compare_faces(const void *avoid, const void *bvoid) {
-  const int *a = static_cast<const int *>(avoid);
-  const int *b = static_cast<const int *>(bvoid);
-
-  if (a[1] == b[1]) {
-    if (a[2] == b[2]) {
-      if (a[3] == b[3]) {
-        return a[4] - b[4];
-      } else {
-        return a[3] - b[3];
-      }
-    } else {
-      return a[2] - b[2];
-    }
-  } else {
-    return a[1] - b[1];
-  }
-
-  return 0;
-}
-
 /*
   Sort the nodes witin a face array
 */
@@ -245,6 +160,266 @@ static inline void sort_face_nodes(int *node) {
   }
 }
 
+/*
+  A table of the unique edges or faces within a mesh
+
+  Each entry is keyed by its sorted node numbers and the entries are
+  numbered consecutively in the order in which they are added. The
+  table is hashed on the lowest node number: the entries are stored
+  in a bucket for each node, so that a look up only scans the few
+  entries that share the lowest node. Since adjacent elements share
+  nodes with similar numbers, this keeps the look ups local in memory.
+
+  The size of each bucket must be set before any entries are added by
+  counting all of the potential entries with countEntry(), which may
+  include duplicates, followed by a call to initialize().
+*/
+class TMRMeshEntityTable {
+ public:
+  TMRMeshEntityTable(int _key_size, int _num_nodes) {
+    key_size = _key_size;
+    num_nodes = _num_nodes;
+    num_entries = 0;
+    ptr = new int[num_nodes + 1];
+    bucket_size = new int[num_nodes];
+    memset(ptr, 0, (num_nodes + 1) * sizeof(int));
+    memset(bucket_size, 0, num_nodes * sizeof(int));
+    keys = NULL;
+  }
+  ~TMRMeshEntityTable() {
+    delete[] ptr;
+    delete[] bucket_size;
+    if (keys) {
+      delete[] keys;
+    }
+  }
+
+  // Count a potential entry with the given nodes
+  void countEntry(const int nodes[]) {
+    int key[4];
+    setKey(nodes, key);
+    ptr[key[0] + 1]++;
+  }
+
+  // Allocate the buckets once all the entries have been counted
+  void initialize() {
+    for (int i = 0; i < num_nodes; i++) {
+      ptr[i + 1] += ptr[i];
+    }
+    keys = new int[key_size * ptr[num_nodes]];
+  }
+
+  // Get the index of the entry with the given nodes, or -1 if the
+  // nodes are not in the table
+  int getIndex(const int nodes[]) {
+    int key[4];
+    setKey(nodes, key);
+    if (key[0] < 0 || key[0] >= num_nodes) {
+      return -1;
+    }
+    int *k = findKey(key);
+    if (k) {
+      return k[key_size - 1];
+    }
+    return -1;
+  }
+
+  // Add the entry with the given nodes (if it does not already
+  // exist) and return its index
+  int addEntry(const int nodes[]) {
+    int key[4];
+    setKey(nodes, key);
+    int *k = findKey(key);
+    if (k) {
+      return k[key_size - 1];
+    }
+
+    // Append the remaining nodes and the index to the bucket
+    k = &keys[key_size * (ptr[key[0]] + bucket_size[key[0]])];
+    for (int j = 1; j < key_size; j++) {
+      k[j - 1] = key[j];
+    }
+    k[key_size - 1] = num_entries;
+    bucket_size[key[0]]++;
+    num_entries++;
+
+    return num_entries - 1;
+  }
+
+  int getNumEntries() { return num_entries; }
+
+ private:
+  // Sort the nodes to form the key
+  void setKey(const int nodes[], int key[]) {
+    if (key_size == 2) {
+      if (nodes[0] < nodes[1]) {
+        key[0] = nodes[0];
+        key[1] = nodes[1];
+      } else {
+        key[0] = nodes[1];
+        key[1] = nodes[0];
+      }
+    } else {
+      for (int j = 0; j < 4; j++) {
+        key[j] = nodes[j];
+      }
+      sort_face_nodes(key);
+    }
+  }
+
+  // Find the remaining nodes and index of the key in its bucket
+  int *findKey(const int key[]) {
+    int *k = &keys[key_size * ptr[key[0]]];
+    for (int i = 0; i < bucket_size[key[0]]; i++, k += key_size) {
+      if (k[0] == key[1] &&
+          (key_size == 2 || (k[1] == key[2] && k[2] == key[3]))) {
+        return k;
+      }
+    }
+    return NULL;
+  }
+
+  // The number of nodes in the key: 2 for edges or 4 for faces
+  int key_size;
+
+  // The buckets for each node
+  int num_nodes;
+  int *ptr, *bucket_size;
+
+  // The remaining sorted nodes and the index of each entry, stored
+  // contiguously within each bucket
+  int num_entries;
+  int *keys;
+};
+
+/*
+  Set the key for the edge between the two nodes. The key is
+  independent of the direction of the edge.
+*/
+static inline void set_edge_key(int n0, int n1, int *key) {
+  if (n0 < n1) {
+    key[0] = n0;
+    key[1] = n1;
+  } else {
+    key[0] = n1;
+    key[1] = n0;
+  }
+}
+
+/*
+  Compare the remaining nodes of two entries within the same bucket
+*/
+static inline int compare_entity_nodes(const int *a, const int *b, int n) {
+  for (int k = 0; k < n; k++) {
+    if (a[k] != b[k]) {
+      return a[k] - b[k];
+    }
+  }
+  return 0;
+}
+
+/*
+  Number the edges or faces within a mesh in the order in which they
+  first appear
+
+  Each entry is given by its sorted node numbers. The entries are
+  sorted with a counting sort on the lowest node number, followed by
+  an insertion sort on the remaining nodes within each bucket, so that
+  the entries for the same entity are adjacent. Each run of equal
+  entries is a single entity. Both sorts are stable, so the first
+  entry within each run is the first appearance of the entity. The
+  buckets are short and independent, so they are sorted in parallel.
+
+  input:
+  num_nodes:  the number of nodes
+  size:       the number of entries
+  key_size:   the number of nodes for each entry
+  keys:       the sorted node numbers for each entry
+
+  output:
+  nums:       the entity number for each entry
+
+  returns:
+  the number of unique entities
+*/
+static int TMR_NumberEntities(int num_nodes, int size, int key_size,
+                              const int *keys, int *nums) {
+  // Count up the number of entries in each bucket
+  int *ptr = new int[num_nodes + 1];
+  memset(ptr, 0, (num_nodes + 1) * sizeof(int));
+  for (int i = 0; i < size; i++) {
+    ptr[keys[key_size * i] + 1]++;
+  }
+  for (int i = 0; i < num_nodes; i++) {
+    ptr[i + 1] += ptr[i];
+  }
+
+  // Place the remaining nodes and the position of each entry in the
+  // bucket for its lowest node
+  const int len = key_size;
+  int *entries = new int[len * size];
+  for (int i = 0; i < size; i++) {
+    const int *key = &keys[key_size * i];
+    int *entry = &entries[len * ptr[key[0]]];
+    for (int k = 1; k < key_size; k++) {
+      entry[k - 1] = key[k];
+    }
+    entry[len - 1] = i;
+    ptr[key[0]]++;
+  }
+  for (int i = num_nodes; i > 0; i--) {
+    ptr[i] = ptr[i - 1];
+  }
+  ptr[0] = 0;
+
+  // Sort each bucket and set the position of the first entry in each
+  // run of equal entries
+#ifdef TMR_HAS_OPENMP
+#pragma omp parallel for schedule(dynamic, 1024)
+#endif  // TMR_HAS_OPENMP
+  for (int node = 0; node < num_nodes; node++) {
+    int *bucket = &entries[len * ptr[node]];
+    int n = ptr[node + 1] - ptr[node];
+    for (int j = 1; j < n; j++) {
+      int tmp[4];
+      memcpy(tmp, &bucket[len * j], len * sizeof(int));
+      int k = j;
+      for (; k > 0 && compare_entity_nodes(&bucket[len * (k - 1)], tmp,
+                                           len - 1) > 0;
+           k--) {
+        memcpy(&bucket[len * k], &bucket[len * (k - 1)], len * sizeof(int));
+      }
+      memcpy(&bucket[len * k], tmp, len * sizeof(int));
+    }
+
+    for (int j = 0, first = 0; j < n; j++) {
+      if (j == 0 || compare_entity_nodes(&bucket[len * (j - 1)],
+                                         &bucket[len * j], len - 1) != 0) {
+        first = bucket[len * j + len - 1];
+      }
+      nums[bucket[len * j + len - 1]] = first;
+    }
+  }
+
+  delete[] ptr;
+  delete[] entries;
+
+  // Number the runs in the order of their first entries. The first
+  // entry precedes the remaining entries in the run, so its number
+  // is always set before it is required.
+  int num = 0;
+  for (int i = 0; i < size; i++) {
+    if (nums[i] == i) {
+      nums[i] = num;
+      num++;
+    } else {
+      nums[i] = nums[nums[i]];
+    }
+  }
+
+  return num;
+}
+
 /*
   Compute a node to triangle or node to quad data structure
 */
@@ -272,12 +447,11 @@ void TMR_ComputeNodeToElems(int nnodes, int nelems, int num_elem_nodes,
   int *node_to_elems = new int[ptr[nnodes]];
   const int *conn_ptr = conn;
   for (int i = 0; i < nelems; i++) {
-    for (int j = 0; j < num_elem_nodes; j++) {
+    for (int j = 0; j < num_elem_nodes; j++, conn_ptr++) {
       int node = conn_ptr[0];
       if (node >= 0) {
         node_to_elems[ptr[node]] = i;
         ptr[node]++;
-        conn_ptr++;
       }
     }
   }
@@ -301,92 +475,58 @@ void TMR_ComputePlanarTriEdges(int nnodes, int ntris, const int tris[],
                                int **_tri_neighbors, int **_dual_edges,
                                int **_node_to_tri_ptr, int **_node_to_tris,
                                int **_tri_edge_nums) {
-  // Compute the edges in the triangular mesh
-  int *ptr;
-  int *node_to_tris;
-  TMR_ComputeNodeToElems(nnodes, ntris, 3, tris, &ptr, &node_to_tris);
-
-  // Now compute the neighbors for each triangle
-  int *tri_edge_nums = new int[3 * ntris];
-  for (int i = 0; i < 3 * ntris; i++) {
-    tri_edge_nums[i] = -1;
-  }
-
-  // Allocate the array for the triangle neighbors
-  int *tri_neighbors = new int[3 * ntris];
-
-  int ne = 0;
+  // Number the edges in the order in which they first appear from
+  // the sorted node numbers of each edge
+  const int nkeys = 3 * ntris;
+  int *keys = new int[2 * nkeys];
+#ifdef TMR_HAS_OPENMP
+#pragma omp parallel for
+#endif  // TMR_HAS_OPENMP
   for (int i = 0; i < ntris; i++) {
-    // Search through each edge of the each triangle
     for (int j = 0; j < 3; j++) {
-      if (tri_edge_nums[3 * i + j] < 0) {
-        tri_edge_nums[3 * i + j] = ne;
-
-        // Triangle edges that have no neighbors are labeled with a -1
-        tri_neighbors[3 * i + j] = -1;
-
-        int e0[2];
-        e0[0] = tris[3 * i + tri_edge_nodes[j][0]];
-        e0[1] = tris[3 * i + tri_edge_nodes[j][1]];
-
-        // Search for the neighboring quad that shares this edge
-        int kp = ptr[e0[0]];
-        int kpend = ptr[e0[0] + 1];
-        for (; kp < kpend; kp++) {
-          // Find the potential quad neighbor
-          int n = node_to_tris[kp];
-
-          // Don't count the same edge twice
-          if (n == i) {
-            continue;
-          }
-
-          // Flag to indicate that we have found the other edge (there
-          // will only be at most one other match since this is
-          // planar in parameter space)
-          int quit = 0;
-
-          // Search over all the edges on this quad, and see
-          // if they match
-          for (int e = 0; e < 3; e++) {
-            int e1[2];
-            e1[0] = tris[3 * n + tri_edge_nodes[e][0]];
-            e1[1] = tris[3 * n + tri_edge_nodes[e][1]];
-
-            // Check if the adjacent edge matches in either direction
-            if ((e0[0] == e1[0] && e0[1] == e1[1]) ||
-                (e0[0] == e1[1] && e0[1] == e1[0])) {
-              // Label the other edge that shares this same node
-              tri_edge_nums[3 * n + e] = ne;
-
-              // Set the triangle neighbors
-              tri_neighbors[3 * n + e] = i;
-              tri_neighbors[3 * i + j] = n;
-
-              quit = 1;
-            }
-          }
-          if (quit) {
-            break;
-          }
-        }
-
-        // Increment the edge number
-        ne++;
-      }
+      set_edge_key(tris[3 * i + tri_edge_nodes[j][0]],
+                   tris[3 * i + tri_edge_nodes[j][1]], &keys[6 * i + 2 * j]);
     }
   }
-
-  // Free the data that is no longer required
-  if (_node_to_tri_ptr) {
-    *_node_to_tri_ptr = ptr;
-  } else {
-    delete[] ptr;
+  int *tri_edge_nums = new int[nkeys];
+  int ne = TMR_NumberEntities(nnodes, nkeys, 2, keys, tri_edge_nums);
+  delete[] keys;
+
+  // Set the triangle neighbors from the first two triangles that
+  // share each edge. Triangle edges that have no neighbors are
+  // labeled with a -1.
+  int *tri_neighbors = new int[nkeys];
+  int *edge_first = new int[ne];
+  for (int i = 0; i < ne; i++) {
+    edge_first[i] = -1;
   }
-  if (_node_to_tris) {
-    *_node_to_tris = node_to_tris;
-  } else {
-    delete[] node_to_tris;
+  for (int i = 0; i < nkeys; i++) {
+    int e = tri_edge_nums[i];
+    tri_neighbors[i] = -1;
+    if (edge_first[e] < 0) {
+      edge_first[e] = i;
+    } else {
+      tri_neighbors[i] = edge_first[e] / 3;
+      tri_neighbors[edge_first[e]] = i / 3;
+    }
+  }
+  delete[] edge_first;
+
+  // Compute the node to triangle data if it is requested
+  if (_node_to_tri_ptr || _node_to_tris) {
+    int *ptr;
+    int *node_to_tris;
+    TMR_ComputeNodeToElems(nnodes, ntris, 3, tris, &ptr, &node_to_tris);
+    if (_node_to_tri_ptr) {
+      *_node_to_tri_ptr = ptr;
+    } else {
+      delete[] ptr;
+    }
+    if (_node_to_tris) {
+      *_node_to_tris = node_to_tris;
+    } else {
+      delete[] node_to_tris;
+    }
   }
 
   // Now we have a unique list of edge numbers and the total number of
@@ -426,42 +566,47 @@ void TMR_ComputePlanarTriEdges(int nnodes, int ntris, const int tris[],
 */
 void TMR_ComputeQuadEdges(int nnodes, int nquads, const int quads[],
                           int *_num_quad_edges, int **_quad_edges) {
-  // 4 edges for each quad, with 2 nodes per edge
+  // 4 edges for each quad. The edges are ordered by interleaving
+  // the bits of the smaller and larger node numbers of each edge.
   int num_edges = 4 * nquads;
-  int *quad_edges = new int[8 * nquads];
-
+  TMRSortKey *keys = new TMRSortKey[2 * num_edges];
+#ifdef TMR_HAS_OPENMP
+#pragma omp parallel for
+#endif  // TMR_HAS_OPENMP
   for (int i = 0; i < nquads; i++) {
     for (int j = 0; j < 4; j++) {
-      int e[2];
-      e[0] = quads[4 * i + quad_edge_nodes[j][0]];
-      e[1] = quads[4 * i + quad_edge_nodes[j][1]];
-
-      if (e[0] < e[1]) {
-        quad_edges[8 * i + 2 * j] = e[0];
-        quad_edges[8 * i + 2 * j + 1] = e[1];
-      } else {
-        quad_edges[8 * i + 2 * j] = e[1];
-        quad_edges[8 * i + 2 * j + 1] = e[0];
+      uint64_t e0 = quads[4 * i + quad_edge_nodes[j][0]];
+      uint64_t e1 = quads[4 * i + quad_edge_nodes[j][1]];
+      if (e0 > e1) {
+        uint64_t tmp = e0;
+        e0 = e1;
+        e1 = tmp;
       }
+      TMRSortKey *key = &keys[4 * i + j];
+      key->hi = 0;
+      key->lo = (TMRSpreadBits2(e0) << 1) | TMRSpreadBits2(e1);
+      key->index = 4 * i + j;
     }
   }
 
   // Sort all of the edges
-  qsort(quad_edges, num_edges, 2 * sizeof(int), compare_edges_simple);
+  TMRSortKey *sorted = TMRRadixSortKeys(num_edges, keys, &keys[num_edges]);
 
+  // Copy the unique edges from the sorted keys
+  int *quad_edges = new int[2 * num_edges];
   int index = 0;
-  for (int i = 0; i < num_edges; index++) {
-    if (i != index) {
-      quad_edges[2 * index] = quad_edges[2 * i];
-      quad_edges[2 * index + 1] = quad_edges[2 * i + 1];
-    }
-
-    // Loop over the edges to find the next unique one
-    while (i < num_edges && compare_edges_simple(&quad_edges[2 * index],
-                                                 &quad_edges[2 * i]) == 0) {
-      i++;
+  for (int i = 0; i < num_edges; i++) {
+    if (i == 0 || sorted[i].lo != sorted[i - 1].lo) {
+      int quad = sorted[i].index / 4;
+      int j = sorted[i].index % 4;
+      int e0 = quads[4 * quad + quad_edge_nodes[j][0]];
+      int e1 = quads[4 * quad + quad_edge_nodes[j][1]];
+      quad_edges[2 * index] = (e0 < e1 ? e0 : e1);
+      quad_edges[2 * index + 1] = (e0 < e1 ? e1 : e0);
+      index++;
     }
   }
+  delete[] keys;
 
   *_quad_edges = quad_edges;
   *_num_quad_edges = index;
@@ -474,95 +619,45 @@ void TMR_ComputePlanarQuadEdges(int nnodes, int nquads, const int quads[],
                                 int *_num_quad_edges, int **_quad_edges,
                                 int **_quad_neighbors, int **_dual_edges,
                                 int **_quad_edge_nums) {
-  // Compute the connectivity from nodes to quads
-  int *ptr;
-  int *node_to_quads;
-  TMR_ComputeNodeToElems(nnodes, nquads, 4, quads, &ptr, &node_to_quads);
-
-  // Now compute the neighbors for each quad
-  int *quad_edge_nums = new int[4 * nquads];
-  for (int i = 0; i < 4 * nquads; i++) {
-    quad_edge_nums[i] = -1;
-  }
-
-  // Allocate an array for the quad neighbors
-  int *quad_neighbors = NULL;
-  if (_quad_neighbors) {
-    quad_neighbors = new int[4 * nquads];
-  }
-
-  int ne = 0;
+  // Number the edges in the order in which they first appear from
+  // the sorted node numbers of each edge
+  const int nkeys = 4 * nquads;
+  int *keys = new int[2 * nkeys];
+#ifdef TMR_HAS_OPENMP
+#pragma omp parallel for
+#endif  // TMR_HAS_OPENMP
   for (int i = 0; i < nquads; i++) {
-    // Search through each edge of the each quadrilateral
     for (int j = 0; j < 4; j++) {
-      if (quad_edge_nums[4 * i + j] < 0) {
-        quad_edge_nums[4 * i + j] = ne;
-
-        // Set the quad neighbor index to -1
-        if (quad_neighbors) {
-          quad_neighbors[4 * i + j] = -1;
-        }
-
-        // Extract the edge nodes for the j-th edge
-        int e0[2];
-        e0[0] = quads[4 * i + quad_edge_nodes[j][0]];
-        e0[1] = quads[4 * i + quad_edge_nodes[j][1]];
-
-        // Search for the neighboring quad that shares this edge
-        int kp = ptr[e0[0]];
-        int kpend = ptr[e0[0] + 1];
-
-        for (; kp < kpend; kp++) {
-          // Find the potential quad neighbor
-          int n = node_to_quads[kp];
-
-          // Don't count the same edge twice
-          if (n == i) {
-            continue;
-          }
-
-          // Flag to indicate that we have found the other edge (there
-          // will only be at most one other match since this is planar)
-          int quit = 0;
-
-          // Search over all the edges on this quad, and see
-          // if they match
-          for (int e = 0; e < 4; e++) {
-            // Extract the edge nodes for the e-th edge
-            int e1[2];
-            e1[0] = quads[4 * n + quad_edge_nodes[e][0]];
-            e1[1] = quads[4 * n + quad_edge_nodes[e][1]];
-
-            // Check if the adjacent edge matches in either direction
-            if ((e0[0] == e1[0] && e0[1] == e1[1]) ||
-                (e0[0] == e1[1] && e0[1] == e1[0])) {
-              // Label the other edge that shares this same node
-              quad_edge_nums[4 * n + e] = ne;
-
-              // Set the quad neighbors
-              if (quad_neighbors) {
-                quad_neighbors[4 * n + e] = i;
-                quad_neighbors[4 * i + j] = n;
-              }
-
-              quit = 1;
-            }
-          }
-          if (quit) {
-            break;
-          }
-        }
+      set_edge_key(quads[4 * i + quad_edge_nodes[j][0]],
+                   quads[4 * i + quad_edge_nodes[j][1]], &keys[8 * i + 2 * j]);
+    }
+  }
+  int *quad_edge_nums = new int[nkeys];
+  int ne = TMR_NumberEntities(nnodes, nkeys, 2, keys, quad_edge_nums);
+  delete[] keys;
 
-        // Increment the edge number
-        ne++;
+  // Set the quad neighbors from the first two quads that share each
+  // edge. Quad edges that have no neighbors are labeled with a -1.
+  int *quad_neighbors = NULL;
+  if (_quad_neighbors || _dual_edges) {
+    quad_neighbors = new int[nkeys];
+    int *edge_first = new int[ne];
+    for (int i = 0; i < ne; i++) {
+      edge_first[i] = -1;
+    }
+    for (int i = 0; i < nkeys; i++) {
+      int e = quad_edge_nums[i];
+      quad_neighbors[i] = -1;
+      if (edge_first[e] < 0) {
+        edge_first[e] = i;
+      } else {
+        quad_neighbors[i] = edge_first[e] / 4;
+        quad_neighbors[edge_first[e]] = i / 4;
       }
     }
+    delete[] edge_first;
   }
 
-  // Free the pointers
-  delete[] ptr;
-  delete[] node_to_quads;
-
   // Now we have a unique list of edge numbers and the total number of
   // edges, we can construct the unique edge list
   int *quad_edges = new int[2 * ne];
@@ -596,6 +691,8 @@ void TMR_ComputePlanarQuadEdges(int nnodes, int nquads, const int quads[],
   *_quad_edges = quad_edges;
   if (_quad_neighbors) {
     *_quad_neighbors = quad_neighbors;
+  } else if (quad_neighbors) {
+    delete[] quad_neighbors;
   }
   if (_dual_edges) {
     *_dual_edges = dual_edges;
@@ -609,118 +706,39 @@ void TMR_ComputeHexEdgesAndFaces(int nnodes, int nhex, const int hex[],
                                  int *_num_hex_edges, int **_hex_edges,
                                  int **_hex_edge_nums, int *_num_hex_faces,
                                  int **_hex_faces, int **_hex_face_nums) {
-  // Compute the connectivity from nodes to hex
-  int *ptr;
-  int *node_to_hex;
-  TMR_ComputeNodeToElems(nnodes, nhex, 8, hex, &ptr, &node_to_hex);
-
-  // Comput the neighbors for each hex
-  int *hex_edge_nums = new int[12 * nhex];
-  int *hex_face_nums = new int[6 * nhex];
-  for (int i = 0; i < 12 * nhex; i++) {
-    hex_edge_nums[i] = -1;
-  }
-  for (int i = 0; i < 6 * nhex; i++) {
-    hex_face_nums[i] = -1;
-  }
-
-  int edge_num = 0, face_num = 0;
+  // Number the edges and faces in the order in which they are first
+  // encountered, using the sorted node numbers to find the edges and
+  // faces that are shared between adjacent hexahedra
+  int *edge_keys = new int[2 * 12 * nhex];
+  int *face_keys = new int[4 * 6 * nhex];
+#ifdef TMR_HAS_OPENMP
+#pragma omp parallel for
+#endif  // TMR_HAS_OPENMP
   for (int i = 0; i < nhex; i++) {
-    // Search through each hexahedral element for the edge
     for (int j = 0; j < 12; j++) {
-      if (hex_edge_nums[12 * i + j] < 0) {
-        hex_edge_nums[12 * i + j] = edge_num;
-
-        // Find the edge nodes for the new edge
-        int e[2];
-        e[0] = hex[8 * i + hex_edge_nodes[j][0]];
-        e[1] = hex[8 * i + hex_edge_nodes[j][1]];
-
-        // Find the node that shares the edge
-        int kp = ptr[e[0]];
-        int kpend = ptr[e[0] + 1];
-
-        for (; kp < kpend; kp++) {
-          // Find the potential hex neighbor
-          int ihex = node_to_hex[kp];
-          if (i == ihex) {
-            continue;
-          }
-
-          // Search over all the edges on this hex, and see if any of
-          // the edges match
-          for (int k = 0; k < 12; k++) {
-            int e2[2];
-            e2[0] = hex[8 * ihex + hex_edge_nodes[k][0]];
-            e2[1] = hex[8 * ihex + hex_edge_nodes[k][1]];
-
-            // Check if the adjacent edge matches in either direction
-            if ((e[0] == e2[0] && e[1] == e2[1]) ||
-                (e[0] == e2[1] && e[1] == e2[0])) {
-              hex_edge_nums[12 * ihex + k] = edge_num;
-            }
-          }
-        }
-
-        // Increment the edge number
-        edge_num++;
-      }
+      set_edge_key(hex[8 * i + hex_edge_nodes[j][0]],
+                   hex[8 * i + hex_edge_nodes[j][1]],
+                   &edge_keys[24 * i + 2 * j]);
     }
 
-    // Search through adjacent hexahedral elements for the faces
     for (int j = 0; j < 6; j++) {
-      if (hex_face_nums[6 * i + j] < 0) {
-        hex_face_nums[6 * i + j] = face_num;
-
-        // Find the nodes associated with face j
-        int f[4];
-        f[0] = hex[8 * i + hex_face_nodes[j][0]];
-        f[1] = hex[8 * i + hex_face_nodes[j][1]];
-        f[2] = hex[8 * i + hex_face_nodes[j][2]];
-        f[3] = hex[8 * i + hex_face_nodes[j][3]];
-
-        // Find a node that shares the face
-        int kp = ptr[f[0]];
-        int kpend = ptr[f[0] + 1];
-
-        for (; kp < kpend; kp++) {
-          // Find the potential hex neighbor
-          int ihex = node_to_hex[kp];
-          if (i == ihex) {
-            continue;
-          }
-
-          // Search over all the faces on this hex, and see if any of
-          // the edges match
-          for (int k = 0; k < 6; k++) {
-            int f2[4];
-            f2[0] = hex[8 * ihex + hex_face_nodes[k][0]];
-            f2[1] = hex[8 * ihex + hex_face_nodes[k][1]];
-            f2[2] = hex[8 * ihex + hex_face_nodes[k][2]];
-            f2[3] = hex[8 * ihex + hex_face_nodes[k][3]];
-
-            // Check if the adjacent edge matches in either direction
-            for (int ort = 0; ort < 8; ort++) {
-              if (f[0] == f2[face_orientations[ort][0]] &&
-                  f[1] == f2[face_orientations[ort][1]] &&
-                  f[2] == f2[face_orientations[ort][2]] &&
-                  f[3] == f2[face_orientations[ort][3]]) {
-                hex_face_nums[6 * ihex + k] = face_num;
-                break;
-              }
-            }
-          }
-        }
-
-        // Increment the face number
-        face_num++;
-      }
+      int *f = &face_keys[24 * i + 4 * j];
+      f[0] = hex[8 * i + hex_face_nodes[j][0]];
+      f[1] = hex[8 * i + hex_face_nodes[j][1]];
+      f[2] = hex[8 * i + hex_face_nodes[j][2]];
+      f[3] = hex[8 * i + hex_face_nodes[j][3]];
+      sort_face_nodes(f);
     }
   }
 
-  // Free the node->hex data
-  delete[] ptr;
-  delete[] node_to_hex;
+  int *hex_edge_nums = new int[12 * nhex];
+  int *hex_face_nums = new int[6 * nhex];
+  int edge_num =
+      TMR_NumberEntities(nnodes, 12 * nhex, 2, edge_keys, hex_edge_nums);
+  int face_num =
+      TMR_NumberEntities(nnodes, 6 * nhex, 4, face_keys, hex_face_nums);
+  delete[] edge_keys;
+  delete[] face_keys;
 
   if (_num_hex_edges) {
     *_num_hex_edges = edge_num;
@@ -799,6 +817,21 @@ TMRMesh::TMRMesh(MPI_Comm _comm, TMRModel *_geo) {
   hex = NULL;
   tet = NULL;
   X = NULL;
+
+  // Set the distributed mesh data
+  distributed = 0;
+  face_owner = NULL;
+  volume_owner = NULL;
+  node_range = NULL;
+  num_ghost_nodes = 0;
+  ghost_nodes = NULL;
+  local_X = NULL;
+  num_local_quads = 0;
+  num_local_tris = 0;
+  num_local_hex = 0;
+  local_quads = NULL;
+  local_tris = NULL;
+  local_hex = NULL;
 }
 
 TMRMesh::~TMRMesh() {
@@ -855,15 +888,26 @@ TMRMesh::~TMRMesh() {
   if (X) {
     delete[] X;
   }
+  if (face_owner) {
+    delete[] face_owner;
+  }
+  if (volume_owner) {
+    delete[] volume_owner;
+  }
+  if (node_range) {
+    delete[] node_range;
+  }
+  freeLocalMesh();
 }
 
 /*
   Call the underlying mesher with the default options
 */
-void TMRMesh::mesh(TMRMeshOptions options, double htarget) {
+void TMRMesh::mesh(TMRMeshOptions options, double htarget,
+                   const char *cache_file) {
   TMRElementFeatureSize *fs = new TMRElementFeatureSize(htarget);
   fs->incref();
-  mesh(options, fs);
+  mesh(options, fs, cache_file);
   fs->decref();
 }
 
@@ -917,21 +961,123 @@ void TMRMesh::resetMesh() {
       volumes[i]->setMesh(NULL);
     }
   }
+
+  // Reset the owners of the face and volume meshes
+  if (face_owner) {
+    delete[] face_owner;
+    face_owner = NULL;
+  }
+  if (volume_owner) {
+    delete[] volume_owner;
+    volume_owner = NULL;
+  }
 }
 
 /*
-  Mesh the underlying geometry
+  Mesh all of the edges in the model that do not yet have a mesh
+
+  The edges are meshed in stages in the same manner as the faces. An
+  edge with a source or copy edge can only be meshed once the mesh of
+  the source or copy edge exists, so it is placed in a later stage.
+  Within each stage, the edges are independent and are assigned to
+  the processors in turn. Each processor meshes its own edges and
+  then the meshes are broadcast from their owners to all processors.
+
+  Any edges whose dependencies cannot be resolved are meshed at the
+  end, one at a time, in the usual fashion.
 */
-void TMRMesh::mesh(TMRMeshOptions options, TMRElementFeatureSize *fs) {
-  // Reset the meshes within the mesh
-  if (options.reset_mesh_objects) {
-    resetMesh();
-  }
+void TMRMesh::meshEdges(TMRMeshOptions options, TMRElementFeatureSize *fs) {
+  TMR_TRACE_SCOPE("TMRMesh::meshEdges");
+
+  int mpi_rank, mpi_size;
+  MPI_Comm_rank(comm, &mpi_rank);
+  MPI_Comm_size(comm, &mpi_size);
 
-  // Mesh the curves
   int num_edges;
   TMREdge **edges;
   geo->getEdges(&num_edges, &edges);
+
+  // Set the stage for each edge. Edges that are already meshed are
+  // labeled with -1, while unresolved edges are labeled with -2.
+  int *stage = new int[num_edges];
+  int *depend = new int[num_edges];
+  for (int i = 0; i < num_edges; i++) {
+    TMREdgeMesh *mesh = NULL;
+    edges[i]->getMesh(&mesh);
+
+    TMREdge *source, *copy;
+    edges[i]->getSource(&source);
+    edges[i]->getCopySource(&copy);
+    if (source == edges[i]) {
+      source = NULL;
+    }
+    if (copy == edges[i]) {
+      copy = NULL;
+    }
+
+    depend[i] = -1;
+    if (mesh) {
+      stage[i] = -1;
+    } else if (source && copy) {
+      stage[i] = -2;
+    } else if (source || copy) {
+      depend[i] = geo->getEdgeIndex(source ? source : copy);
+      stage[i] = -2;
+    } else {
+      stage[i] = 0;
+    }
+  }
+
+  int max_stage = 0;
+  for (int updated = 1; updated;) {
+    updated = 0;
+    for (int i = 0; i < num_edges; i++) {
+      if (stage[i] == -2 && depend[i] >= 0 && depend[i] != i) {
+        if (stage[depend[i]] == -1) {
+          stage[i] = 0;
+          updated = 1;
+        } else if (stage[depend[i]] >= 0) {
+          stage[i] = stage[depend[i]] + 1;
+          if (stage[i] > max_stage) {
+            max_stage = stage[i];
+          }
+          updated = 1;
+        }
+      }
+    }
+  }
+
+  int *owner = new int[num_edges];
+  for (int k = 0; k <= max_stage; k++) {
+    // Create the meshes on all processors, but only compute the
+    // meshes owned by this processor
+    int count = 0;
+    for (int i = 0; i < num_edges; i++) {
+      if (stage[i] == k) {
+        owner[i] = count % mpi_size;
+        count++;
+
+        TMREdgeMesh *mesh = new TMREdgeMesh(comm, edges[i]);
+        edges[i]->setMesh(mesh);
+        if (owner[i] == mpi_rank) {
+          mesh->meshLocal(options, fs);
+        }
+      }
+    }
+
+    // Distribute the meshes to all processors in edge order
+    if (mpi_size > 1) {
+      for (int i = 0; i < num_edges; i++) {
+        if (stage[i] == k) {
+          TMREdgeMesh *mesh = NULL;
+          edges[i]->getMesh(&mesh);
+          mesh->broadcastMesh(owner[i]);
+        }
+      }
+    }
+  }
+
+  // Mesh any remaining edges
   for (int i = 0; i < num_edges; i++) {
     TMREdgeMesh *mesh = NULL;
     edges[i]->getMesh(&mesh);
@@ -942,12 +1088,192 @@ void TMRMesh::mesh(TMRMeshOptions options, TMRElementFeatureSize *fs) {
     }
   }
 
-  // Mesh the surface
-  int num_faces;
-  TMRFace **faces;
-  geo->getFaces(&num_faces, &faces);
-  for (int i = 0; i < num_faces; i++) {
-    TMRFaceMesh *mesh = NULL;
+  delete[] stage;
+  delete[] depend;
+  delete[] owner;
+}
+
+/*
+  The estimated cost of meshing a face, used to distribute the faces
+*/
+struct TMRFaceCost {
+  int face;
+  double cost;
+};
+
+/*
+  Sort the faces by decreasing cost and then by increasing index
+*/
+static int compare_face_cost(const void *a, const void *b) {
+  const TMRFaceCost *A = static_cast<const TMRFaceCost *>(a);
+  const TMRFaceCost *B = static_cast<const TMRFaceCost *>(b);
+  if (A->cost > B->cost) {
+    return -1;
+  } else if (A->cost < B->cost) {
+    return 1;
+  }
+  return A->face - B->face;
+}
+
+/*
+  Mesh all of the faces in the model that do not yet have a mesh
+
+  The faces are meshed in stages. A face with a source or copy face
+  can only be meshed once the mesh of the source or copy face exists,
+  so it is placed in a later stage. Within each stage, the faces are
+  independent and are distributed across the processors based on an
+  estimate of the cost. Each processor meshes its own faces and then
+  the meshes are broadcast from their owners to all processors.
+
+  Any faces whose dependencies cannot be resolved are meshed at the
+  end, one at a time, in the usual fashion.
+*/
+void TMRMesh::meshFaces(TMRMeshOptions options, TMRElementFeatureSize *fs) {
+  TMR_TRACE_SCOPE("TMRMesh::meshFaces");
+
+  int mpi_rank, mpi_size;
+  MPI_Comm_rank(comm, &mpi_rank);
+  MPI_Comm_size(comm, &mpi_size);
+
+  int num_faces;
+  TMRFace **faces;
+  geo->getFaces(&num_faces, &faces);
+
+  // Set the stage for each face. Faces that are already meshed are
+  // labeled with -1, while unresolved faces are labeled with -2.
+  int *stage = new int[num_faces];
+  int *depend = new int[num_faces];
+  for (int i = 0; i < num_faces; i++) {
+    TMRFaceMesh *mesh = NULL;
+    faces[i]->getMesh(&mesh);
+
+    TMRFace *source, *copy;
+    faces[i]->getSource(NULL, &source);
+    faces[i]->getCopySource(NULL, &copy);
+    if (source) {
+      copy = source;
+    }
+
+    depend[i] = -1;
+    if (mesh) {
+      stage[i] = -1;
+    } else if (copy) {
+      depend[i] = geo->getFaceIndex(copy);
+      stage[i] = -2;
+    } else {
+      stage[i] = 0;
+    }
+  }
+
+  int max_stage = 0;
+  for (int updated = 1; updated;) {
+    updated = 0;
+    for (int i = 0; i < num_faces; i++) {
+      if (stage[i] == -2 && depend[i] >= 0 && depend[i] != i) {
+        if (stage[depend[i]] == -1) {
+          stage[i] = 0;
+          updated = 1;
+        } else if (stage[depend[i]] >= 0) {
+          stage[i] = stage[depend[i]] + 1;
+          if (stage[i] > max_stage) {
+            max_stage = stage[i];
+          }
+          updated = 1;
+        }
+      }
+    }
+  }
+
+  // Estimate the cost of meshing each face based on the number of
+  // points on the boundary of the face
+  TMRFaceCost *costs = new TMRFaceCost[num_faces];
+  int *owner = new int[num_faces];
+  double *load = new double[mpi_size];
+
+  // The owner of each face mesh is retained for numbering the nodes
+  // of a distributed mesh
+  if (!face_owner) {
+    face_owner = new int[num_faces];
+    for (int i = 0; i < num_faces; i++) {
+      face_owner[i] = -1;
+    }
+  }
+
+  for (int k = 0; k <= max_stage; k++) {
+    int count = 0;
+    for (int i = 0; i < num_faces; i++) {
+      if (stage[i] == k) {
+        int npts = 0;
+        for (int j = 0; j < faces[i]->getNumEdgeLoops(); j++) {
+          TMREdgeLoop *loop;
+          faces[i]->getEdgeLoop(j, &loop);
+          int nedges;
+          TMREdge **edges;
+          loop->getEdgeLoop(&nedges, &edges, NULL);
+          for (int ii = 0; ii < nedges; ii++) {
+            TMREdgeMesh *mesh = NULL;
+            edges[ii]->getMesh(&mesh);
+            if (mesh) {
+              int n;
+              mesh->getMeshPoints(&n, NULL, NULL);
+              npts += n;
+            }
+          }
+        }
+
+        // Mapping a mesh from a source or copy is cheap compared to
+        // meshing the face from scratch
+        costs[count].face = i;
+        costs[count].cost = 1.0 * npts;
+        if (depend[i] < 0) {
+          costs[count].cost *= npts;
+        }
+        count++;
+      }
+    }
+
+    // Assign the faces to the least loaded processor in order of
+    // decreasing cost
+    qsort(costs, count, sizeof(TMRFaceCost), compare_face_cost);
+    memset(load, 0, mpi_size * sizeof(double));
+    for (int j = 0; j < count; j++) {
+      int rank = 0;
+      for (int r = 1; r < mpi_size; r++) {
+        if (load[r] < load[rank]) {
+          rank = r;
+        }
+      }
+      owner[costs[j].face] = rank;
+      load[rank] += costs[j].cost;
+      face_owner[costs[j].face] = rank;
+    }
+
+    // Create the meshes on all processors, but only compute the
+    // meshes owned by this processor
+    for (int j = 0; j < count; j++) {
+      int i = costs[j].face;
+      TMRFaceMesh *mesh = new TMRFaceMesh(comm, faces[i]);
+      faces[i]->setMesh(mesh);
+      if (owner[i] == mpi_rank) {
+        mesh->meshLocal(options, fs);
+      }
+    }
+
+    // Distribute the meshes to all processors in face order
+    if (mpi_size > 1) {
+      for (int i = 0; i < num_faces; i++) {
+        if (stage[i] == k) {
+          TMRFaceMesh *mesh = NULL;
+          faces[i]->getMesh(&mesh);
+          mesh->broadcastMesh(owner[i]);
+        }
+      }
+    }
+  }
+
+  // Mesh any remaining faces
+  for (int i = 0; i < num_faces; i++) {
+    TMRFaceMesh *mesh = NULL;
     faces[i]->getMesh(&mesh);
     if (!mesh) {
       mesh = new TMRFaceMesh(comm, faces[i]);
@@ -956,16 +1282,75 @@ void TMRMesh::mesh(TMRMeshOptions options, TMRElementFeatureSize *fs) {
     }
   }
 
-  // Update target/source relationships
+  delete[] stage;
+  delete[] depend;
+  delete[] costs;
+  delete[] owner;
+  delete[] load;
+}
+
+/*
+  Mesh all of the volumes in the model that do not yet have a mesh
+
+  The swept volume meshes are independent of one another once the
+  face meshes exist. The connectivity for each volume is created on
+  all processors, while the node locations are only computed by the
+  processor that owns the volume. The volumes are assigned to the
+  least loaded processor based on the number of nodes. The node
+  locations are then broadcast from their owners to all processors,
+  unless the mesh is distributed.
+*/
+void TMRMesh::meshVolumes(TMRMeshOptions options) {
+  TMR_TRACE_SCOPE("TMRMesh::meshVolumes");
+
+  int mpi_rank, mpi_size;
+  MPI_Comm_rank(comm, &mpi_rank);
+  MPI_Comm_size(comm, &mpi_size);
+
   int num_volumes;
   TMRVolume **volumes;
   geo->getVolumes(&num_volumes, &volumes);
+
+  // The owner of each volume mesh that is created. Volume meshes that
+  // already exist, or that fail on all processors, are labeled with -1.
+  int *owner = new int[num_volumes];
+  TMRVolumeMesh **meshes = new TMRVolumeMesh *[num_volumes];
+  double *load = new double[mpi_size];
+  memset(load, 0, mpi_size * sizeof(double));
+
   for (int i = 0; i < num_volumes; i++) {
+    owner[i] = -1;
+    meshes[i] = NULL;
     TMRVolumeMesh *mesh = NULL;
     volumes[i]->getMesh(&mesh);
     if (!mesh) {
       mesh = new TMRVolumeMesh(comm, volumes[i]);
-      int fail = mesh->mesh(options);
+      meshes[i] = mesh;
+
+      int fail = 0;
+      if (options.mesh_type_default == TMR_TRIANGLE) {
+        fail = mesh->mesh(options);
+      } else {
+        fail = mesh->meshConnectivity(options);
+        if (!fail) {
+          // Assign the volume to the least loaded processor and set
+          // the node locations on that processor
+          int rank = 0;
+          for (int r = 1; r < mpi_size; r++) {
+            if (load[r] < load[rank]) {
+              rank = r;
+            }
+          }
+          int npts;
+          mesh->getMeshPoints(&npts, NULL);
+          owner[i] = rank;
+          load[rank] += npts;
+          if (rank == mpi_rank) {
+            fail = mesh->setNodeLocations(options);
+          }
+        }
+      }
+
       if (fail) {
         const char *name = volumes[i]->getName();
         if (name) {
@@ -981,145 +1366,844 @@ void TMRMesh::mesh(TMRMeshOptions options, TMRElementFeatureSize *fs) {
     }
   }
 
-  // Now that we're done meshing, go ahead and uniquely order
-  // the nodes in the mesh
-  int num = 0;
-  int num_vertices = 0;
-  TMRVertex **vertices;
-  geo->getVertices(&num_vertices, &vertices);
-  for (int i = 0; i < num_vertices; i++) {
-    vertices[i]->setNodeNum(&num);
+  // Record the owner of each volume mesh created here
+  if (!volume_owner) {
+    volume_owner = new int[num_volumes];
+    for (int i = 0; i < num_volumes; i++) {
+      volume_owner[i] = -1;
+    }
+  }
+  for (int i = 0; i < num_volumes; i++) {
+    if (owner[i] >= 0) {
+      volume_owner[i] = owner[i];
+    }
   }
 
-  // Order the edges
-  for (int i = 0; i < num_edges; i++) {
-    TMREdgeMesh *mesh = NULL;
-    edges[i]->getMesh(&mesh);
-    mesh->setNodeNums(&num);
+  // Distribute the node locations to all processors in volume order.
+  // The node locations of a distributed mesh are only stored on the
+  // owner of each volume.
+  if (!options.distribute_mesh) {
+    for (int i = 0; i < num_volumes; i++) {
+      if (owner[i] >= 0) {
+        meshes[i]->broadcastNodeLocations(owner[i]);
+      }
+    }
   }
 
-  // Order the faces
-  for (int i = 0; i < num_faces; i++) {
-    TMRFaceMesh *mesh = NULL;
-    faces[i]->getMesh(&mesh);
-    mesh->setNodeNums(&num);
+  delete[] owner;
+  delete[] meshes;
+  delete[] load;
+}
+
+/*
+  The identifier and the number of sampled points along each edge and
+  in each direction on each face used for the mesh cache
+*/
+static const int TMR_MESH_CACHE_ID = 0x544d5243;
+static const int TMR_MESH_CACHE_VERSION = 1;
+static const int TMR_MESH_KEY_SAMPLES = 5;
+
+/*
+  Add the bytes to a 64-bit FNV-1a hash
+*/
+static void TMR_HashBytes(uint64_t *hash, const void *data, size_t len) {
+  const unsigned char *bytes = (const unsigned char *)data;
+  for (size_t i = 0; i < len; i++) {
+    *hash ^= bytes[i];
+    *hash *= 1099511628211ULL;
   }
+}
 
-  // Order the volumes
-  for (int i = 0; i < num_volumes; i++) {
-    TMRVolumeMesh *mesh = NULL;
-    volumes[i]->getMesh(&mesh);
-    mesh->setNodeNums(&num);
+/*
+  Compute the key for the meshing options that affect the edge and
+  face meshes. The print and output options are not included.
+*/
+static uint64_t TMR_ComputeOptionsKey(TMRMeshOptions options) {
+  uint64_t key = 14695981039346656037ULL;
+  int iopts[5];
+  iopts[0] = options.mesh_type_default;
+  iopts[1] = options.num_smoothing_steps;
+  iopts[2] = options.tri_smoothing_type;
+  iopts[3] = options.recombination_type;
+  iopts[4] = options.recombination_patch_size;
+  double dopts[2];
+  dopts[0] = options.frontal_quality_factor;
+  dopts[1] = options.greedy_recombination_quality;
+  TMR_HashBytes(&key, iopts, sizeof(iopts));
+  TMR_HashBytes(&key, dopts, sizeof(dopts));
+  return key;
+}
+
+/*
+  Compute the key for the geometry of an edge from its parameter
+  range, its end points and a set of points along the edge, and the
+  feature size at those points
+*/
+static uint64_t TMR_ComputeEdgeKey(TMREdge *edge, TMRElementFeatureSize *fs) {
+  uint64_t key = 14695981039346656037ULL;
+  const int n = TMR_MESH_KEY_SAMPLES;
+
+  double range[2];
+  edge->getRange(&range[0], &range[1]);
+  int degen = edge->isDegenerate();
+  TMR_HashBytes(&key, range, sizeof(range));
+  TMR_HashBytes(&key, &degen, sizeof(degen));
+
+  TMRVertex *v1, *v2;
+  edge->getVertices(&v1, &v2);
+  TMRPoint Xv[2];
+  Xv[0].zero();
+  Xv[1].zero();
+  if (v1) {
+    v1->evalPoint(&Xv[0]);
   }
+  if (v2) {
+    v2->evalPoint(&Xv[1]);
+  }
+  TMR_HashBytes(&key, Xv, sizeof(Xv));
 
-  // Set the number of nodes in the mesh
-  num_nodes = num;
+  double t[n], h[n];
+  TMRPoint X[n];
+  for (int i = 0; i < n; i++) {
+    X[i].zero();
+    t[i] = range[0] + (range[1] - range[0]) * i / (n - 1);
+  }
+  edge->evalPoints(n, t, X);
+  fs->getFeatureSizes(n, X, h);
+  TMR_HashBytes(&key, X, sizeof(X));
+  TMR_HashBytes(&key, h, sizeof(h));
 
-  // Count up the number of quadrilaterals or hex in the mesh
-  num_quads = 0;
-  num_tris = 0;
-  num_hex = 0;
-  num_tet = 0;
+  return key;
+}
 
-  if (num_volumes > 0) {
-    for (int i = 0; i < num_volumes; i++) {
-      TMRVolumeMesh *mesh = NULL;
-      volumes[i]->getMesh(&mesh);
-      num_hex += mesh->getHexConnectivity(NULL);
-      num_tet += mesh->getTetConnectivity(NULL);
+/*
+  Compute the key for the geometry of a face from its parameter range,
+  orientation, edge loops and a grid of points on the face, and the
+  feature size at those points
+*/
+static uint64_t TMR_ComputeFaceKey(TMRModel *geo, TMRFace *face,
+                                   TMRElementFeatureSize *fs) {
+  uint64_t key = 14695981039346656037ULL;
+  const int n = TMR_MESH_KEY_SAMPLES;
+
+  double range[4];
+  face->getRange(&range[0], &range[1], &range[2], &range[3]);
+  int orient = face->getOrientation();
+  TMR_HashBytes(&key, range, sizeof(range));
+  TMR_HashBytes(&key, &orient, sizeof(orient));
+
+  // Add the edge indices and directions for each loop
+  int nloops = face->getNumEdgeLoops();
+  TMR_HashBytes(&key, &nloops, sizeof(nloops));
+  for (int k = 0; k < nloops; k++) {
+    TMREdgeLoop *loop;
+    face->getEdgeLoop(k, &loop);
+    int nedges;
+    TMREdge **edges;
+    const int *dir;
+    loop->getEdgeLoop(&nedges, &edges, &dir);
+    TMR_HashBytes(&key, &nedges, sizeof(nedges));
+    for (int i = 0; i < nedges; i++) {
+      int index = geo->getEdgeIndex(edges[i]);
+      TMR_HashBytes(&key, &index, sizeof(index));
+      TMR_HashBytes(&key, &dir[i], sizeof(int));
     }
   }
-  if (num_faces > 0) {
-    for (int i = 0; i < num_faces; i++) {
-      TMRFaceMesh *mesh = NULL;
-      faces[i]->getMesh(&mesh);
-      TMRFace *copy_face = NULL;
-      faces[i]->getCopySource(NULL, &copy_face);
-      if (!copy_face) {
-        num_quads += mesh->getQuadConnectivity(NULL);
-        num_tris += mesh->getTriConnectivity(NULL);
-      }
+
+  double u[n * n], v[n * n], h[n * n];
+  TMRPoint X[n * n];
+  for (int j = 0; j < n; j++) {
+    for (int i = 0; i < n; i++) {
+      X[i + n * j].zero();
+      u[i + n * j] = range[0] + (range[2] - range[0]) * i / (n - 1);
+      v[i + n * j] = range[1] + (range[3] - range[1]) * j / (n - 1);
     }
+  }
+  face->evalPoints(n * n, u, v, X);
+  fs->getFeatureSizes(n * n, X, h);
+  TMR_HashBytes(&key, X, sizeof(X));
+  TMR_HashBytes(&key, h, sizeof(h));
 
-    // Add the mesh quality to the bins from each mesh
-    const int nbins = 20;
-    int bins[nbins];
-    memset(bins, 0, nbins * sizeof(int));
-    for (int i = 0; i < num_faces; i++) {
-      TMRFaceMesh *mesh = NULL;
-      faces[i]->getMesh(&mesh);
-      TMRFace *copy_face = NULL;
-      faces[i]->getCopySource(NULL, &copy_face);
-      if (!copy_face) {
-        mesh->addMeshQuality(nbins, bins);
+  return key;
+}
+
+/*
+  Compute the keys for the edge and face meshes
+
+  The key for each edge includes the key of its source or copy edge,
+  while the key for each face includes the keys of the edges in its
+  loops and the key of its source or copy face, so that a mesh is
+  only re-used when all of the meshes it depends on are unchanged.
+*/
+void TMRMesh::computeMeshKeys(TMRMeshOptions options,
+                              TMRElementFeatureSize *fs, uint64_t *edge_keys,
+                              uint64_t *face_keys) {
+  int num_edges;
+  TMREdge **edges;
+  geo->getEdges(&num_edges, &edges);
+
+  int num_faces;
+  TMRFace **faces;
+  geo->getFaces(&num_faces, &faces);
+
+  uint64_t options_key = TMR_ComputeOptionsKey(options);
+
+  uint64_t *edge_geo_keys = new uint64_t[num_edges];
+  for (int i = 0; i < num_edges; i++) {
+    edge_geo_keys[i] = TMR_ComputeEdgeKey(edges[i], fs);
+  }
+  for (int i = 0; i < num_edges; i++) {
+    TMREdge *source, *copy;
+    edges[i]->getSource(&source);
+    edges[i]->getCopySource(&copy);
+
+    uint64_t key = options_key;
+    TMR_HashBytes(&key, &edge_geo_keys[i], sizeof(uint64_t));
+    TMREdge *depend[2] = {source, copy};
+    for (int j = 0; j < 2; j++) {
+      int index = -1;
+      if (depend[j]) {
+        index = geo->getEdgeIndex(depend[j]);
+      }
+      TMR_HashBytes(&key, &index, sizeof(index));
+      if (index >= 0 && index < num_edges) {
+        TMR_HashBytes(&key, &edge_geo_keys[index], sizeof(uint64_t));
       }
     }
+    edge_keys[i] = key;
+  }
 
-    // Sum up the total number of elements
-    int total = 0;
-    for (int i = 0; i < nbins; i++) {
-      total += bins[i];
+  uint64_t *face_geo_keys = new uint64_t[num_faces];
+  for (int i = 0; i < num_faces; i++) {
+    face_geo_keys[i] = TMR_ComputeFaceKey(geo, faces[i], fs);
+  }
+  for (int i = 0; i < num_faces; i++) {
+    uint64_t key = options_key;
+    TMR_HashBytes(&key, &face_geo_keys[i], sizeof(uint64_t));
+
+    for (int k = 0; k < faces[i]->getNumEdgeLoops(); k++) {
+      TMREdgeLoop *loop;
+      faces[i]->getEdgeLoop(k, &loop);
+      int nedges;
+      TMREdge **loop_edges;
+      loop->getEdgeLoop(&nedges, &loop_edges, NULL);
+      for (int j = 0; j < nedges; j++) {
+        int index = geo->getEdgeIndex(loop_edges[j]);
+        if (index >= 0 && index < num_edges) {
+          TMR_HashBytes(&key, &edge_keys[index], sizeof(uint64_t));
+        }
+      }
     }
 
-    // Get the MPI rank and print out the quality on the root processor
-    int mpi_rank;
-    MPI_Comm_rank(comm, &mpi_rank);
-
-    if (options.write_mesh_quality_histogram && mpi_rank == 0) {
-      printf("Quality   # elements   percentage\n");
-      for (int k = 0; k < nbins; k++) {
-        printf("< %.2f    %10d   %10.3f\n", 1.0 * (k + 1) / nbins, bins[k],
-               100.0 * bins[k] / total);
+    TMRFace *source, *copy;
+    int copy_orient = 0;
+    faces[i]->getSource(NULL, &source);
+    faces[i]->getCopySource(&copy_orient, &copy);
+    TMRFace *depend[2] = {source, copy};
+    for (int j = 0; j < 2; j++) {
+      int index = -1;
+      if (depend[j]) {
+        index = geo->getFaceIndex(depend[j]);
+      }
+      TMR_HashBytes(&key, &index, sizeof(index));
+      if (index >= 0 && index < num_faces) {
+        TMR_HashBytes(&key, &face_geo_keys[index], sizeof(uint64_t));
       }
-      printf("          %10d\n", total);
     }
+    TMR_HashBytes(&key, &copy_orient, sizeof(copy_orient));
+    face_keys[i] = key;
   }
+
+  delete[] edge_geo_keys;
+  delete[] face_geo_keys;
 }
 
 /*
-  Allocate and initialize the global mesh using the global ordering
+  Read the cached edge and face meshes for the edges and faces that
+  do not yet have a mesh
+
+  The cache file is read on the root processor. An edge or face mesh
+  is only re-used when its key matches the key computed from the
+  current geometry, feature size and options. The re-used meshes are
+  broadcast to all processors. Returns the number of re-used meshes.
 */
-void TMRMesh::initMesh(int count_nodes) {
-  // Allocate the global arrays
-  X = new TMRPoint[num_nodes];
+int TMRMesh::readMeshCache(const char *filename, TMRMeshOptions options,
+                           TMRElementFeatureSize *fs) {
+  TMR_TRACE_SCOPE("TMRMesh::readMeshCache");
 
-  if (num_hex > 0) {
-    hex = new int[8 * num_hex];
+  int mpi_rank;
+  MPI_Comm_rank(comm, &mpi_rank);
 
-    int *count = NULL;
-    if (count_nodes) {
-      count = new int[num_nodes];
-      memset(count, 0, num_nodes * sizeof(int));
-    }
+  int num_edges;
+  TMREdge **edges;
+  geo->getEdges(&num_edges, &edges);
 
-    // Retrieve the surface information
-    int num_volumes;
-    TMRVolume **volumes;
-    geo->getVolumes(&num_volumes, &volumes);
+  int num_faces;
+  TMRFace **faces;
+  geo->getFaces(&num_faces, &faces);
 
-    // Set the values into the global arrays
-    int *h = hex;
-    for (int i = 0; i < num_volumes; i++) {
-      // Get the mesh
-      TMRVolumeMesh *mesh = NULL;
-      volumes[i]->getMesh(&mesh);
+  // Flags indicating whether the edge or face mesh was read
+  int *flags = new int[num_edges + num_faces];
+  memset(flags, 0, (num_edges + num_faces) * sizeof(int));
+  TMREdgeMesh **edge_meshes = new TMREdgeMesh *[num_edges];
+  TMRFaceMesh **face_meshes = new TMRFaceMesh *[num_faces];
+  memset(edge_meshes, 0, num_edges * sizeof(TMREdgeMesh *));
+  memset(face_meshes, 0, num_faces * sizeof(TMRFaceMesh *));
+
+  FILE *fp = NULL;
+  if (mpi_rank == 0) {
+    fp = fopen(filename, "rb");
+  }
 
-      // Get the local mesh points
-      int npts;
-      TMRPoint *Xpts;
-      mesh->getMeshPoints(&npts, &Xpts);
+  if (fp) {
+    uint64_t *edge_keys = new uint64_t[num_edges];
+    uint64_t *face_keys = new uint64_t[num_faces];
+    computeMeshKeys(options, fs, edge_keys, face_keys);
+
+    int header[4];
+    int fail = (fread(header, sizeof(int), 4, fp) != 4 ||
+                header[0] != TMR_MESH_CACHE_ID ||
+                header[1] != TMR_MESH_CACHE_VERSION || header[2] < 0 ||
+                header[3] < 0);
+    int ncache = 0;
+    if (!fail) {
+      ncache = header[2] + header[3];
+    }
 
-      // Get the local quadrilateral connectivity
-      const int *hex_local;
-      int nlocal = mesh->getHexConnectivity(&hex_local);
+    // Read the entries for the edges followed by those for the faces
+    for (int k = 0; k < ncache && !fail; k++) {
+      uint64_t key;
+      int64_t nbytes;
+      if (fread(&key, sizeof(uint64_t), 1, fp) != 1 ||
+          fread(&nbytes, sizeof(int64_t), 1, fp) != 1 || nbytes < 0) {
+        fail = 1;
+        break;
+      }
 
-      // Get the local to global variable numbering
-      const int *vars;
-      mesh->getNodeNums(&vars);
+      int is_edge = (k < header[2]);
+      int index = (is_edge ? k : k - header[2]);
+      long start = ftell(fp);
+      if (nbytes > 0 && is_edge && index < num_edges &&
+          key == edge_keys[index]) {
+        TMREdgeMesh *mesh = NULL;
+        edges[index]->getMesh(&mesh);
+        if (!mesh) {
+          mesh = new TMREdgeMesh(comm, edges[index]);
+          mesh->incref();
+          if (mesh->readMeshData(fp) == 0 && ftell(fp) == start + nbytes) {
+            edge_meshes[index] = mesh;
+            flags[index] = 1;
+          } else {
+            mesh->decref();
+          }
+        }
+      } else if (nbytes > 0 && !is_edge && index < num_faces &&
+                 key == face_keys[index]) {
+        TMRFaceMesh *mesh = NULL;
+        faces[index]->getMesh(&mesh);
+        if (!mesh) {
+          mesh = new TMRFaceMesh(comm, faces[index]);
+          mesh->incref();
+          if (mesh->readMeshData(fp) == 0 && ftell(fp) == start + nbytes) {
+            face_meshes[index] = mesh;
+            flags[num_edges + index] = 1;
+          } else {
+            mesh->decref();
+          }
+        }
+      }
 
-      // Set the quadrilateral connectivity
-      for (int j = 0; j < 8 * nlocal; j++, h++) {
-        h[0] = vars[hex_local[j]];
+      // Move to the next entry, skipping any data that was not used
+      if (fseek(fp, start + nbytes, SEEK_SET) != 0) {
+        fail = 1;
+      }
+    }
+
+    if (fail) {
+      fprintf(stderr, "TMRMesh Warning: Failed to read mesh cache %s\n",
+              filename);
+    }
+
+    // A face mesh can only be re-used when all the meshes it depends
+    // on were also read
+    for (int i = 0; i < num_faces; i++) {
+      if (flags[num_edges + i]) {
+        int use_mesh = 1;
+        for (int k = 0; k < faces[i]->getNumEdgeLoops(); k++) {
+          TMREdgeLoop *loop;
+          faces[i]->getEdgeLoop(k, &loop);
+          int nedges;
+          TMREdge **loop_edges;
+          loop->getEdgeLoop(&nedges, &loop_edges, NULL);
+          for (int j = 0; j < nedges; j++) {
+            int index = geo->getEdgeIndex(loop_edges[j]);
+            TMREdgeMesh *mesh = NULL;
+            loop_edges[j]->getMesh(&mesh);
+            if (!mesh && (index < 0 || !flags[index])) {
+              use_mesh = 0;
+            }
+          }
+        }
+        if (!use_mesh) {
+          face_meshes[i]->decref();
+          face_meshes[i] = NULL;
+          flags[num_edges + i] = 0;
+        }
+      }
+    }
+
+    fclose(fp);
+    delete[] edge_keys;
+    delete[] face_keys;
+  }
+
+  // Distribute the meshes that were read to all processors
+  MPI_Bcast(flags, num_edges + num_faces, MPI_INT, 0, comm);
+
+  int count = 0;
+  for (int i = 0; i < num_edges; i++) {
+    if (flags[i]) {
+      if (!edge_meshes[i]) {
+        edge_meshes[i] = new TMREdgeMesh(comm, edges[i]);
+        edge_meshes[i]->incref();
+      }
+      edge_meshes[i]->broadcastMesh(0);
+      edges[i]->setMesh(edge_meshes[i]);
+      count++;
+    }
+  }
+  for (int i = 0; i < num_faces; i++) {
+    if (flags[num_edges + i]) {
+      if (!face_meshes[i]) {
+        face_meshes[i] = new TMRFaceMesh(comm, faces[i]);
+        face_meshes[i]->incref();
+      }
+      face_meshes[i]->broadcastMesh(0);
+      faces[i]->setMesh(face_meshes[i]);
+      count++;
+    }
+  }
+
+  delete[] flags;
+  delete[] edge_meshes;
+  delete[] face_meshes;
+
+  return count;
+}
+
+/*
+  Write the edge and face meshes to the cache file
+
+  The binary file contains:
+  4 integers: the identifier, the version, the number of edges and
+  the number of faces
+
+  Followed by an entry for each edge and then each face:
+  1 uint64_t: the key for the mesh
+  1 int64_t: the number of bytes of mesh data = n (zero for no mesh)
+  n bytes: the mesh data written by writeMeshData()
+
+  The file is written on the root processor to a temporary file that
+  is renamed so that a partially written cache is never read.
+*/
+int TMRMesh::writeMeshCache(const char *filename, TMRMeshOptions options,
+                            TMRElementFeatureSize *fs) {
+  TMR_TRACE_SCOPE("TMRMesh::writeMeshCache");
+
+  int mpi_rank;
+  MPI_Comm_rank(comm, &mpi_rank);
+  if (mpi_rank != 0) {
+    return 0;
+  }
+
+  int num_edges;
+  TMREdge **edges;
+  geo->getEdges(&num_edges, &edges);
+
+  int num_faces;
+  TMRFace **faces;
+  geo->getFaces(&num_faces, &faces);
+
+  char *tmp_name = new char[strlen(filename) + 8];
+  sprintf(tmp_name, "%s.tmp", filename);
+  FILE *fp = fopen(tmp_name, "wb");
+  if (!fp) {
+    fprintf(stderr, "TMRMesh Error: Could not open file %s\n", tmp_name);
+    delete[] tmp_name;
+    return 1;
+  }
+
+  uint64_t *edge_keys = new uint64_t[num_edges];
+  uint64_t *face_keys = new uint64_t[num_faces];
+  computeMeshKeys(options, fs, edge_keys, face_keys);
+
+  int header[4];
+  header[0] = TMR_MESH_CACHE_ID;
+  header[1] = TMR_MESH_CACHE_VERSION;
+  header[2] = num_edges;
+  header[3] = num_faces;
+  fwrite(header, sizeof(int), 4, fp);
+
+  int fail = 0;
+  for (int k = 0; k < num_edges + num_faces && !fail; k++) {
+    TMREdgeMesh *edge_mesh = NULL;
+    TMRFaceMesh *face_mesh = NULL;
+    uint64_t key = 0;
+    if (k < num_edges) {
+      edges[k]->getMesh(&edge_mesh);
+      key = edge_keys[k];
+    } else {
+      faces[k - num_edges]->getMesh(&face_mesh);
+      key = face_keys[k - num_edges];
+    }
+
+    // Write a placeholder for the size of the data
+    int64_t nbytes = 0;
+    fwrite(&key, sizeof(uint64_t), 1, fp);
+    long pos = ftell(fp);
+    fwrite(&nbytes, sizeof(int64_t), 1, fp);
+
+    long start = ftell(fp);
+    if (edge_mesh) {
+      fail = edge_mesh->writeMeshData(fp);
+    } else if (face_mesh) {
+      fail = face_mesh->writeMeshData(fp);
+    }
+    long end = ftell(fp);
+
+    // Set the size of the data
+    nbytes = end - start;
+    if (!fail && nbytes > 0) {
+      fail = (fseek(fp, pos, SEEK_SET) != 0 ||
+              fwrite(&nbytes, sizeof(int64_t), 1, fp) != 1 ||
+              fseek(fp, end, SEEK_SET) != 0);
+    }
+  }
+
+  if (ferror(fp)) {
+    fail = 1;
+  }
+  if (fclose(fp) != 0) {
+    fail = 1;
+  }
+  if (!fail) {
+    fail = rename(tmp_name, filename);
+  }
+  if (fail) {
+    fprintf(stderr, "TMRMesh Error: Failed to write mesh cache %s\n",
+            filename);
+    remove(tmp_name);
+  }
+
+  delete[] tmp_name;
+  delete[] edge_keys;
+  delete[] face_keys;
+
+  return fail;
+}
+
+/*
+  Mesh the underlying geometry
+*/
+void TMRMesh::mesh(TMRMeshOptions options, TMRElementFeatureSize *fs,
+                   const char *cache_file) {
+  TMR_TRACE_SCOPE("TMRMesh::mesh");
+
+  // Reset the times for each phase
+  times = TMRMeshTimes();
+  double tstart = MPI_Wtime();
+
+  // Reset the meshes within the mesh
+  if (options.reset_mesh_objects) {
+    resetMesh();
+  }
+
+  // Re-use the cached meshes for the unchanged edges and faces
+  if (cache_file) {
+    readMeshCache(cache_file, options, fs);
+  }
+
+  // Mesh the curves in parallel
+  double t0 = MPI_Wtime();
+  meshEdges(options, fs);
+  times.edges = MPI_Wtime() - t0;
+
+  int num_edges;
+  TMREdge **edges;
+  geo->getEdges(&num_edges, &edges);
+
+  // Mesh the surfaces in parallel
+  t0 = MPI_Wtime();
+  meshFaces(options, fs);
+  times.faces = MPI_Wtime() - t0;
+
+  int num_faces;
+  TMRFace **faces;
+  geo->getFaces(&num_faces, &faces);
+
+  // Add the contributions from the face meshes created here
+  for (int i = 0; i < num_faces; i++) {
+    TMRFaceMesh *mesh = NULL;
+    faces[i]->getMesh(&mesh);
+    if (mesh) {
+      mesh->addMeshTimes(&times);
+    }
+  }
+
+  // Mesh the volumes in parallel
+  t0 = MPI_Wtime();
+  meshVolumes(options);
+  times.volumes = MPI_Wtime() - t0;
+
+  // Update the cache with the edge and face meshes
+  if (cache_file) {
+    writeMeshCache(cache_file, options, fs);
+  }
+
+  int num_volumes;
+  TMRVolume **volumes;
+  geo->getVolumes(&num_volumes, &volumes);
+
+  // Free the local part of any previous distributed mesh
+  freeLocalMesh();
+  distributed = options.distribute_mesh;
+
+  if (distributed) {
+    // Order the nodes so that each processor owns a contiguous range
+    numberNodesByOwner();
+  } else {
+    // Now that we're done meshing, go ahead and uniquely order
+    // the nodes in the mesh
+    int num = 0;
+    int num_vertices = 0;
+    TMRVertex **vertices;
+    geo->getVertices(&num_vertices, &vertices);
+    for (int i = 0; i < num_vertices; i++) {
+      vertices[i]->setNodeNum(&num);
+    }
+
+    // Order the edges
+    for (int i = 0; i < num_edges; i++) {
+      TMREdgeMesh *mesh = NULL;
+      edges[i]->getMesh(&mesh);
+      mesh->setNodeNums(&num);
+    }
+
+    // Order the faces
+    for (int i = 0; i < num_faces; i++) {
+      TMRFaceMesh *mesh = NULL;
+      faces[i]->getMesh(&mesh);
+      mesh->setNodeNums(&num);
+    }
+
+    // Order the volumes
+    for (int i = 0; i < num_volumes; i++) {
+      TMRVolumeMesh *mesh = NULL;
+      volumes[i]->getMesh(&mesh);
+      mesh->setNodeNums(&num);
+    }
+
+    // Set the number of nodes in the mesh
+    num_nodes = num;
+  }
+
+  // Count up the number of quadrilaterals or hex in the mesh
+  num_quads = 0;
+  num_tris = 0;
+  num_hex = 0;
+  num_tet = 0;
+
+  if (num_volumes > 0) {
+    for (int i = 0; i < num_volumes; i++) {
+      TMRVolumeMesh *mesh = NULL;
+      volumes[i]->getMesh(&mesh);
+      num_hex += mesh->getHexConnectivity(NULL);
+      num_tet += mesh->getTetConnectivity(NULL);
+    }
+  }
+  if (num_faces > 0) {
+    for (int i = 0; i < num_faces; i++) {
+      TMRFaceMesh *mesh = NULL;
+      faces[i]->getMesh(&mesh);
+      TMRFace *copy_face = NULL;
+      faces[i]->getCopySource(NULL, &copy_face);
+      if (!copy_face) {
+        num_quads += mesh->getQuadConnectivity(NULL);
+        num_tris += mesh->getTriConnectivity(NULL);
+      }
+    }
+
+    // Add the mesh quality to the bins from each mesh
+    const int nbins = 20;
+    int bins[nbins];
+    memset(bins, 0, nbins * sizeof(int));
+    for (int i = 0; i < num_faces; i++) {
+      TMRFaceMesh *mesh = NULL;
+      faces[i]->getMesh(&mesh);
+      TMRFace *copy_face = NULL;
+      faces[i]->getCopySource(NULL, &copy_face);
+      if (!copy_face) {
+        mesh->addMeshQuality(nbins, bins);
+      }
+    }
+
+    // Sum up the total number of elements
+    int total = 0;
+    for (int i = 0; i < nbins; i++) {
+      total += bins[i];
+    }
+
+    // Get the MPI rank and print out the quality on the root processor
+    int mpi_rank;
+    MPI_Comm_rank(comm, &mpi_rank);
+
+    if (options.write_mesh_quality_histogram && mpi_rank == 0) {
+      printf("Quality   # elements   percentage\n");
+      for (int k = 0; k < nbins; k++) {
+        printf("< %.2f    %10d   %10.3f\n", 1.0 * (k + 1) / nbins, bins[k],
+               100.0 * bins[k] / total);
+      }
+      printf("          %10d\n", total);
+    }
+  }
+
+  times.total = MPI_Wtime() - tstart;
+}
+
+/*
+  Retrieve the times for each phase of the last call to mesh()
+
+  The times are local to this processor. The triangulation,
+  recombination and smoothing times only include the face meshes that
+  were computed on this processor.
+*/
+void TMRMesh::getMeshTimes(TMRMeshTimes *_times) { *_times = times; }
+
+/*
+  Compare integers for sorting
+*/
+static int compare_integers(const void *a, const void *b) {
+  return (*(int *)a - *(int *)b);
+}
+
+/*
+  Get the local index of a node in a distributed mesh, or -1 if the
+  node is neither owned by this processor nor a ghost node
+*/
+static int TMR_GetLocalNodeIndex(int node, int start, int num_owned,
+                                 int num_ghosts, const int *ghosts) {
+  if (node >= start && node < start + num_owned) {
+    return node - start;
+  }
+  const int *item = (const int *)bsearch(&node, ghosts, num_ghosts,
+                                         sizeof(int), compare_integers);
+  if (item) {
+    return num_owned + (item - ghosts);
+  }
+  return -1;
+}
+
+/*
+  Add the quads and triangles from the face mesh in the global node
+  numbering, reversing the orientation of the elements if needed
+*/
+static void TMR_AddFaceElements(TMRFace *face, TMRFaceMesh *mesh, int **_q,
+                                int **_t) {
+  int *q = *_q;
+  int *t = *_t;
+
+  // Get the local quadrilateral connectivity
+  const int *quad_local, *tri_local;
+  int nquad_local = mesh->getQuadConnectivity(&quad_local);
+  int ntri_local = mesh->getTriConnectivity(&tri_local);
+
+  // Get the local to global variable numbering
+  const int *vars;
+  mesh->getNodeNums(&vars);
+
+  // Set the quadrilateral connectivity
+  if (face->getOrientation() > 0) {
+    for (int j = 0; j < 4 * nquad_local; j++, q++) {
+      q[0] = vars[quad_local[j]];
+    }
+    for (int j = 0; j < 3 * ntri_local; j++, t++) {
+      t[0] = vars[tri_local[j]];
+    }
+  } else {
+    for (int j = 0; j < nquad_local; j++) {
+      for (int k = 0; k < 4; k++) {
+        q[k] = vars[quad_local[4 * j + k]];
+      }
+
+      // Flip the orientation of the quad
+      int tmp = q[1];
+      q[1] = q[3];
+      q[3] = tmp;
+      q += 4;
+    }
+    for (int j = 0; j < ntri_local; j++) {
+      for (int k = 0; k < 3; k++) {
+        t[k] = vars[tri_local[3 * j + k]];
+      }
+
+      // Flip the orientation of the quad
+      int tmp = t[1];
+      t[1] = t[2];
+      t[2] = tmp;
+      t += 3;
+    }
+  }
+
+  *_q = q;
+  *_t = t;
+}
+
+/*
+  Allocate and initialize the global mesh using the global ordering
+*/
+void TMRMesh::initMesh(int count_nodes) {
+  TMR_TRACE_SCOPE("TMRMesh::initMesh");
+
+  // Allocate the global arrays
+  X = new TMRPoint[num_nodes];
+
+  if (num_hex > 0) {
+    hex = new int[8 * num_hex];
+
+    int *count = NULL;
+    if (count_nodes) {
+      count = new int[num_nodes];
+      memset(count, 0, num_nodes * sizeof(int));
+    }
+
+    // Retrieve the surface information
+    int num_volumes;
+    TMRVolume **volumes;
+    geo->getVolumes(&num_volumes, &volumes);
+
+    // Set the values into the global arrays
+    int *h = hex;
+    for (int i = 0; i < num_volumes; i++) {
+      // Get the mesh
+      TMRVolumeMesh *mesh = NULL;
+      volumes[i]->getMesh(&mesh);
+
+      // Get the local mesh points
+      int npts;
+      TMRPoint *Xpts;
+      mesh->getMeshPoints(&npts, &Xpts);
+
+      // Get the local quadrilateral connectivity
+      const int *hex_local;
+      int nlocal = mesh->getHexConnectivity(&hex_local);
+
+      // Get the local to global variable numbering
+      const int *vars;
+      mesh->getNodeNums(&vars);
+
+      // Set the quadrilateral connectivity
+      for (int j = 0; j < 8 * nlocal; j++, h++) {
+        h[0] = vars[hex_local[j]];
       }
 
       // Set the node locations
@@ -1172,421 +2256,2034 @@ void TMRMesh::initMesh(int count_nodes) {
         TMRFaceMesh *mesh = NULL;
         faces[i]->getMesh(&mesh);
 
-        // Get the local mesh points
-        int npts;
-        TMRPoint *Xpts;
-        mesh->getMeshPoints(&npts, NULL, &Xpts);
+        // Get the local mesh points
+        int npts;
+        TMRPoint *Xpts;
+        mesh->getMeshPoints(&npts, NULL, &Xpts);
+
+        // Set the element connectivity
+        TMR_AddFaceElements(faces[i], mesh, &q, &t);
+
+        // Get the local to global variable numbering
+        const int *vars;
+        mesh->getNodeNums(&vars);
+
+        // Set the node locations
+        for (int j = 0; j < npts; j++) {
+          X[vars[j]] = Xpts[j];
+        }
+      }
+    }
+  }
+}
+
+/*
+  Number the nodes of a distributed mesh
+
+  Each node is owned by the processor that owns the lowest-dimensional
+  entity that contains it. The nodes of each volume are owned by the
+  processor that computed the volume mesh, the nodes of each face are
+  owned by the lowest-ranked owner of the adjacent volumes (or by the
+  processor that computed the face mesh if there are no volumes) and
+  the nodes of each edge and vertex are owned by the lowest-ranked
+  owner of the adjacent faces and edges, respectively. The owner of
+  the source of a copied entity is lowered to the owner of the copy.
+
+  With this choice, the entities that bound an entity are never owned
+  by a higher rank, so numbering the entities owned by each processor
+  in turn gives each processor a contiguous range of node numbers,
+  and the boundary nodes shared between processors are numbered by
+  the first processor that owns them.
+*/
+void TMRMesh::numberNodesByOwner() {
+  TMR_TRACE_SCOPE("TMRMesh::numberNodesByOwner");
+
+  int mpi_size;
+  MPI_Comm_size(comm, &mpi_size);
+
+  int num_vertices, num_edges, num_faces, num_volumes;
+  TMRVertex **vertices;
+  TMREdge **edges;
+  TMRFace **faces;
+  TMRVolume **volumes;
+  geo->getVertices(&num_vertices, &vertices);
+  geo->getEdges(&num_edges, &edges);
+  geo->getFaces(&num_faces, &faces);
+  geo->getVolumes(&num_volumes, &volumes);
+
+  // Set the owners of the volumes. Volumes that were not meshed in
+  // parallel are assigned to the processors in turn.
+  int *vol_owner = new int[num_volumes];
+  for (int i = 0; i < num_volumes; i++) {
+    vol_owner[i] = i % mpi_size;
+    if (volume_owner && volume_owner[i] >= 0) {
+      vol_owner[i] = volume_owner[i];
+    }
+  }
+
+  // Set the face owners from the adjacent volumes
+  int *face_node_owner = new int[num_faces];
+  for (int i = 0; i < num_faces; i++) {
+    face_node_owner[i] = -1;
+  }
+  for (int i = 0; i < num_volumes; i++) {
+    int nfaces;
+    TMRFace **vol_faces;
+    volumes[i]->getFaces(&nfaces, &vol_faces);
+    for (int j = 0; j < nfaces; j++) {
+      int index = geo->getFaceIndex(vol_faces[j]);
+      if (face_node_owner[index] < 0 ||
+          vol_owner[i] < face_node_owner[index]) {
+        face_node_owner[index] = vol_owner[i];
+      }
+    }
+  }
+  for (int i = 0; i < num_faces; i++) {
+    if (face_node_owner[i] < 0) {
+      face_node_owner[i] = i % mpi_size;
+      if (face_owner && face_owner[i] >= 0) {
+        face_node_owner[i] = face_owner[i];
+      }
+    }
+  }
+
+  // Lower the owners of the faces that are copied
+  for (int updated = 1; updated;) {
+    updated = 0;
+    for (int i = 0; i < num_faces; i++) {
+      TMRFace *copy = NULL;
+      faces[i]->getCopySource(NULL, &copy);
+      if (copy) {
+        int index = geo->getFaceIndex(copy);
+        if (face_node_owner[i] < face_node_owner[index]) {
+          face_node_owner[index] = face_node_owner[i];
+          updated = 1;
+        }
+      }
+    }
+  }
+
+  // Set the edge owners from the adjacent faces
+  int *edge_owner = new int[num_edges];
+  for (int i = 0; i < num_edges; i++) {
+    edge_owner[i] = -1;
+  }
+  for (int i = 0; i < num_faces; i++) {
+    for (int k = 0; k < faces[i]->getNumEdgeLoops(); k++) {
+      TMREdgeLoop *loop;
+      faces[i]->getEdgeLoop(k, &loop);
+      int nedges;
+      TMREdge **loop_edges;
+      loop->getEdgeLoop(&nedges, &loop_edges, NULL);
+      for (int j = 0; j < nedges; j++) {
+        int index = geo->getEdgeIndex(loop_edges[j]);
+        if (edge_owner[index] < 0 ||
+            face_node_owner[i] < edge_owner[index]) {
+          edge_owner[index] = face_node_owner[i];
+        }
+      }
+    }
+  }
+  for (int i = 0; i < num_edges; i++) {
+    if (edge_owner[i] < 0) {
+      edge_owner[i] = i % mpi_size;
+    }
+  }
+
+  // Lower the owners of the edges that are copied
+  for (int updated = 1; updated;) {
+    updated = 0;
+    for (int i = 0; i < num_edges; i++) {
+      TMREdge *copy = NULL;
+      edges[i]->getCopySource(&copy);
+      if (copy && copy != edges[i]) {
+        int index = geo->getEdgeIndex(copy);
+        if (edge_owner[i] < edge_owner[index]) {
+          edge_owner[index] = edge_owner[i];
+          updated = 1;
+        }
+      }
+    }
+  }
+
+  // Set the vertex owners from the adjacent edges
+  int *vert_owner = new int[num_vertices];
+  for (int i = 0; i < num_vertices; i++) {
+    vert_owner[i] = -1;
+  }
+  for (int i = 0; i < num_edges; i++) {
+    TMRVertex *v[2];
+    edges[i]->getVertices(&v[0], &v[1]);
+    for (int j = 0; j < 2; j++) {
+      if (v[j]) {
+        int index = geo->getVertexIndex(v[j]);
+        if (vert_owner[index] < 0 || edge_owner[i] < vert_owner[index]) {
+          vert_owner[index] = edge_owner[i];
+        }
+      }
+    }
+  }
+  for (int i = 0; i < num_vertices; i++) {
+    if (vert_owner[i] < 0) {
+      vert_owner[i] = i % mpi_size;
+    }
+  }
+
+  // Lower the owners of the vertices that are copied
+  for (int updated = 1; updated;) {
+    updated = 0;
+    for (int i = 0; i < num_vertices; i++) {
+      TMRVertex *copy = NULL;
+      vertices[i]->getCopySource(&copy);
+      if (copy) {
+        int index = geo->getVertexIndex(copy);
+        if (vert_owner[i] < vert_owner[index]) {
+          vert_owner[index] = vert_owner[i];
+          updated = 1;
+        }
+      }
+    }
+  }
+
+  // Number the entities owned by each processor in turn. The offsets
+  // are the prefix sum of the number of nodes owned by each processor.
+  if (!node_range) {
+    node_range = new int[mpi_size + 1];
+  }
+
+  int num = 0;
+  for (int rank = 0; rank < mpi_size; rank++) {
+    node_range[rank] = num;
+
+    for (int i = 0; i < num_vertices; i++) {
+      if (vert_owner[i] == rank) {
+        vertices[i]->setNodeNum(&num);
+      }
+    }
+    for (int i = 0; i < num_edges; i++) {
+      if (edge_owner[i] == rank) {
+        TMREdgeMesh *mesh = NULL;
+        edges[i]->getMesh(&mesh);
+        mesh->setNodeNums(&num);
+      }
+    }
+    for (int i = 0; i < num_faces; i++) {
+      if (face_node_owner[i] == rank) {
+        TMRFaceMesh *mesh = NULL;
+        faces[i]->getMesh(&mesh);
+        mesh->setNodeNums(&num);
+      }
+    }
+    for (int i = 0; i < num_volumes; i++) {
+      if (vol_owner[i] == rank) {
+        TMRVolumeMesh *mesh = NULL;
+        volumes[i]->getMesh(&mesh);
+        mesh->setNodeNums(&num);
+      }
+    }
+  }
+  node_range[mpi_size] = num;
+
+  // Set the number of nodes in the mesh
+  num_nodes = num;
+
+  // Keep the owners of the face and volume meshes for the elements
+  if (!face_owner) {
+    face_owner = new int[num_faces];
+  }
+  memcpy(face_owner, face_node_owner, num_faces * sizeof(int));
+  if (!volume_owner) {
+    volume_owner = new int[num_volumes];
+  }
+  memcpy(volume_owner, vol_owner, num_volumes * sizeof(int));
+
+  delete[] vol_owner;
+  delete[] face_node_owner;
+  delete[] edge_owner;
+  delete[] vert_owner;
+}
+
+/*
+  Allocate and initialize the local part of a distributed mesh
+
+  The local elements are the hexahedra in the volumes and the quads
+  and triangles in the faces whose nodes are owned by this processor.
+  The nodes referenced by the local elements that are owned by other
+  processors are the ghost nodes. The local node locations are the
+  locations of the owned nodes followed by the ghost nodes, and the
+  element connectivity is stored in this local numbering.
+*/
+void TMRMesh::initLocalMesh() {
+  int mpi_rank;
+  MPI_Comm_rank(comm, &mpi_rank);
+  const int start = node_range[mpi_rank];
+  const int num_owned = node_range[mpi_rank + 1] - start;
+
+  int num_vertices, num_edges, num_faces, num_volumes;
+  TMRVertex **vertices;
+  TMREdge **edges;
+  TMRFace **faces;
+  TMRVolume **volumes;
+  geo->getVertices(&num_vertices, &vertices);
+  geo->getEdges(&num_edges, &edges);
+  geo->getFaces(&num_faces, &faces);
+  geo->getVolumes(&num_volumes, &volumes);
+
+  // Count up the number of local elements
+  num_local_hex = 0;
+  num_local_quads = 0;
+  num_local_tris = 0;
+  for (int i = 0; i < num_volumes; i++) {
+    if (volume_owner[i] == mpi_rank) {
+      TMRVolumeMesh *mesh = NULL;
+      volumes[i]->getMesh(&mesh);
+      num_local_hex += mesh->getHexConnectivity(NULL);
+    }
+  }
+  for (int i = 0; i < num_faces; i++) {
+    TMRFace *copy_face = NULL;
+    faces[i]->getCopySource(NULL, &copy_face);
+    if (!copy_face && face_owner[i] == mpi_rank) {
+      TMRFaceMesh *mesh = NULL;
+      faces[i]->getMesh(&mesh);
+      num_local_quads += mesh->getQuadConnectivity(NULL);
+      num_local_tris += mesh->getTriConnectivity(NULL);
+    }
+  }
+
+  // Set the local elements in the global node numbering
+  local_hex = new int[8 * num_local_hex];
+  local_quads = new int[4 * num_local_quads];
+  local_tris = new int[3 * num_local_tris];
+
+  int *h = local_hex;
+  for (int i = 0; i < num_volumes; i++) {
+    if (volume_owner[i] == mpi_rank) {
+      TMRVolumeMesh *mesh = NULL;
+      volumes[i]->getMesh(&mesh);
+
+      const int *hex_local, *vars;
+      int nlocal = mesh->getHexConnectivity(&hex_local);
+      mesh->getNodeNums(&vars);
+      for (int j = 0; j < 8 * nlocal; j++, h++) {
+        h[0] = vars[hex_local[j]];
+      }
+    }
+  }
+
+  int *q = local_quads;
+  int *t = local_tris;
+  for (int i = 0; i < num_faces; i++) {
+    TMRFace *copy_face = NULL;
+    faces[i]->getCopySource(NULL, &copy_face);
+    if (!copy_face && face_owner[i] == mpi_rank) {
+      TMRFaceMesh *mesh = NULL;
+      faces[i]->getMesh(&mesh);
+      TMR_AddFaceElements(faces[i], mesh, &q, &t);
+    }
+  }
+
+  // Find the sorted, unique list of nodes owned by other processors
+  int size = 8 * num_local_hex + 4 * num_local_quads + 3 * num_local_tris;
+  ghost_nodes = new int[size];
+  num_ghost_nodes = 0;
+  int *conn[3] = {local_hex, local_quads, local_tris};
+  const int len[3] = {8 * num_local_hex, 4 * num_local_quads,
+                      3 * num_local_tris};
+  for (int k = 0; k < 3; k++) {
+    for (int j = 0; j < len[k]; j++) {
+      if (conn[k][j] < start || conn[k][j] >= start + num_owned) {
+        ghost_nodes[num_ghost_nodes] = conn[k][j];
+        num_ghost_nodes++;
+      }
+    }
+  }
+  qsort(ghost_nodes, num_ghost_nodes, sizeof(int), compare_integers);
+  int count = 0;
+  for (int j = 0; j < num_ghost_nodes; j++) {
+    if (count == 0 || ghost_nodes[j] != ghost_nodes[count - 1]) {
+      ghost_nodes[count] = ghost_nodes[j];
+      count++;
+    }
+  }
+  num_ghost_nodes = count;
+
+  // Convert the elements to the local node numbering
+  for (int k = 0; k < 3; k++) {
+    for (int j = 0; j < len[k]; j++) {
+      conn[k][j] = TMR_GetLocalNodeIndex(conn[k][j], start, num_owned,
+                                         num_ghost_nodes, ghost_nodes);
+    }
+  }
+
+  // Set the locations of the local nodes from the vertices, the edge
+  // and face meshes that are stored on all processors and the volume
+  // meshes owned by this processor
+  local_X = new TMRPoint[num_owned + num_ghost_nodes];
+  for (int i = 0; i < num_vertices; i++) {
+    int var;
+    vertices[i]->getNodeNum(&var);
+    int index = TMR_GetLocalNodeIndex(var, start, num_owned,
+                                      num_ghost_nodes, ghost_nodes);
+    if (index >= 0) {
+      vertices[i]->evalPoint(&local_X[index]);
+    }
+  }
+  for (int i = 0; i < num_edges; i++) {
+    TMREdgeMesh *mesh = NULL;
+    edges[i]->getMesh(&mesh);
+
+    int npts;
+    TMRPoint *Xpts;
+    const int *vars;
+    mesh->getMeshPoints(&npts, NULL, &Xpts);
+    mesh->getNodeNums(&vars);
+    for (int j = 0; vars && j < npts; j++) {
+      int index = TMR_GetLocalNodeIndex(vars[j], start, num_owned,
+                                        num_ghost_nodes, ghost_nodes);
+      if (index >= 0) {
+        local_X[index] = Xpts[j];
+      }
+    }
+  }
+  for (int i = 0; i < num_faces; i++) {
+    TMRFaceMesh *mesh = NULL;
+    faces[i]->getMesh(&mesh);
+
+    int npts;
+    TMRPoint *Xpts;
+    const int *vars;
+    mesh->getMeshPoints(&npts, NULL, &Xpts);
+    mesh->getNodeNums(&vars);
+    for (int j = 0; j < npts; j++) {
+      int index = TMR_GetLocalNodeIndex(vars[j], start, num_owned,
+                                        num_ghost_nodes, ghost_nodes);
+      if (index >= 0) {
+        local_X[index] = Xpts[j];
+      }
+    }
+  }
+  for (int i = 0; i < num_volumes; i++) {
+    if (volume_owner[i] == mpi_rank) {
+      TMRVolumeMesh *mesh = NULL;
+      volumes[i]->getMesh(&mesh);
+
+      int npts;
+      TMRPoint *Xpts;
+      const int *vars;
+      mesh->getMeshPoints(&npts, &Xpts);
+      mesh->getNodeNums(&vars);
+      for (int j = 0; j < npts; j++) {
+        int index = TMR_GetLocalNodeIndex(vars[j], start, num_owned,
+                                          num_ghost_nodes, ghost_nodes);
+        if (index >= 0) {
+          local_X[index] = Xpts[j];
+        }
+      }
+    }
+  }
+}
+
+/*
+  Free the local part of the distributed mesh
+*/
+void TMRMesh::freeLocalMesh() {
+  if (ghost_nodes) {
+    delete[] ghost_nodes;
+  }
+  if (local_X) {
+    delete[] local_X;
+  }
+  if (local_quads) {
+    delete[] local_quads;
+  }
+  if (local_tris) {
+    delete[] local_tris;
+  }
+  if (local_hex) {
+    delete[] local_hex;
+  }
+  num_ghost_nodes = 0;
+  num_local_quads = 0;
+  num_local_tris = 0;
+  num_local_hex = 0;
+  ghost_nodes = NULL;
+  local_X = NULL;
+  local_quads = NULL;
+  local_tris = NULL;
+  local_hex = NULL;
+}
+
+/*
+  Retrieve the mesh points (allocate them if they do not exist)
+
+  For a distributed mesh, the local node locations are returned: the
+  nodes owned by this processor followed by the ghost nodes.
+*/
+int TMRMesh::getMeshPoints(TMRPoint **_X) {
+  if (distributed) {
+    int mpi_rank;
+    MPI_Comm_rank(comm, &mpi_rank);
+    if (!local_X) {
+      initLocalMesh();
+    }
+    if (_X) {
+      *_X = local_X;
+    }
+    return node_range[mpi_rank + 1] - node_range[mpi_rank] + num_ghost_nodes;
+  }
+  if (_X) {
+    if (!X) {
+      initMesh();
+    }
+    *_X = X;
+  }
+  return num_nodes;
+}
+
+/*
+  Retrieve the underlying mesh connectivity (allocate it if it does
+  not already exist)
+
+  For a distributed mesh, the local elements are returned in the local
+  node numbering.
+*/
+void TMRMesh::getQuadConnectivity(int *_nquads, const int **_quads) {
+  if (distributed) {
+    if (!local_X) {
+      initLocalMesh();
+    }
+    if (_nquads) {
+      *_nquads = num_local_quads;
+    }
+    if (_quads) {
+      *_quads = local_quads;
+    }
+    return;
+  }
+  if (!X) {
+    initMesh();
+  }
+  if (_nquads) {
+    *_nquads = num_quads;
+  }
+  if (_quads) {
+    *_quads = quads;
+  }
+}
+
+/*
+  Get the triangluar mesh connectivity
+*/
+void TMRMesh::getTriConnectivity(int *_ntris, const int **_tris) {
+  if (distributed) {
+    if (!local_X) {
+      initLocalMesh();
+    }
+    if (_ntris) {
+      *_ntris = num_local_tris;
+    }
+    if (_tris) {
+      *_tris = local_tris;
+    }
+    return;
+  }
+  if (!X) {
+    initMesh();
+  }
+  if (_ntris) {
+    *_ntris = num_tris;
+  }
+  if (_tris) {
+    *_tris = tris;
+  }
+}
+
+/*
+  Get the hexahedral connectivity
+*/
+void TMRMesh::getHexConnectivity(int *_nhex, const int **_hex) {
+  if (distributed) {
+    if (!local_X) {
+      initLocalMesh();
+    }
+    if (_nhex) {
+      *_nhex = num_local_hex;
+    }
+    if (_hex) {
+      *_hex = local_hex;
+    }
+    return;
+  }
+  if (!X) {
+    initMesh();
+  }
+  if (_nhex) {
+    *_nhex = num_hex;
+  }
+  if (_hex) {
+    *_hex = hex;
+  }
+}
+
+/*
+  Retrieve the range of node numbers owned by each processor
+
+  The nodes owned by processor k are node_range[k] <= node <
+  node_range[k+1]. This is only defined for a distributed mesh.
+
+  returns: the number of nodes owned by this processor
+*/
+int TMRMesh::getNodeRange(const int **_node_range) {
+  if (!distributed) {
+    if (_node_range) {
+      *_node_range = NULL;
+    }
+    return num_nodes;
+  }
+  int mpi_rank;
+  MPI_Comm_rank(comm, &mpi_rank);
+  if (_node_range) {
+    *_node_range = node_range;
+  }
+  return node_range[mpi_rank + 1] - node_range[mpi_rank];
+}
+
+/*
+  Retrieve the sorted global node numbers of the ghost nodes
+
+  The ghost nodes follow the owned nodes in the local numbering of a
+  distributed mesh.
+
+  returns: the number of ghost nodes
+*/
+int TMRMesh::getGhostNodes(const int **_ghost_nodes) {
+  if (distributed && !local_X) {
+    initLocalMesh();
+  }
+  if (_ghost_nodes) {
+    *_ghost_nodes = ghost_nodes;
+  }
+  return num_ghost_nodes;
+}
+
+/*
+  Report the memory held by the global and distributed mesh arrays
+
+  The arrays are only included once they have been created by one of
+  the calls that retrieve the mesh. This call is collective on the mesh
+  communicator, and the report is reduced across all processors.
+
+  returns: the memory report
+*/
+TMRMemoryUsage *TMRMesh::getMemoryUsage() {
+  TMRMemoryUsage *usage = new TMRMemoryUsage();
+
+  // The number of local nodes in a distributed mesh
+  int nlocal = 0;
+  if (local_X) {
+    nlocal = getNodeRange(NULL) + num_ghost_nodes;
+  }
+
+  usage->addArray("X", X ? num_nodes * sizeof(TMRPoint) : 0);
+  usage->addArray("quads", quads ? 4 * num_quads * sizeof(int) : 0);
+  usage->addArray("tris", tris ? 3 * num_tris * sizeof(int) : 0);
+  usage->addArray("hex", hex ? 8 * num_hex * sizeof(int) : 0);
+  usage->addArray("tet", tet ? 4 * num_tet * sizeof(int) : 0);
+  usage->addArray("ghost_nodes", num_ghost_nodes * sizeof(int));
+  usage->addArray("local_X", nlocal * sizeof(TMRPoint));
+  usage->addArray("local_quads", 4 * num_local_quads * sizeof(int));
+  usage->addArray("local_tris", 3 * num_local_tris * sizeof(int));
+  usage->addArray("local_hex", 8 * num_local_hex * sizeof(int));
+
+  usage->reduce(comm);
+  return usage;
+}
+
+/*
+  A growable character buffer used to format the output files
+*/
+class TMRCardBuffer {
+ public:
+  TMRCardBuffer() {
+    size = 0;
+    max_size = 0;
+    data = NULL;
+  }
+  ~TMRCardBuffer() {
+    if (data) {
+      delete[] data;
+    }
+  }
+
+  // Reset the buffer without freeing the memory
+  void reset() { size = 0; }
+
+  // Append the formatted output to the buffer
+  void print(const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    vprint(fmt, args);
+    va_end(args);
+  }
+  void vprint(const char *fmt, va_list args) {
+    while (1) {
+      size_t avail = max_size - size;
+      va_list copy;
+      va_copy(copy, args);
+      int len = vsnprintf(&data[size], avail, fmt, copy);
+      va_end(copy);
+      if (len < 0) {
+        return;
+      } else if ((size_t)len < avail) {
+        size += len;
+        return;
+      }
+
+      // Extend the buffer and try again
+      extend(len + 1);
+    }
+  }
+
+  // Append the binary data to the buffer
+  void append(const void *ptr, size_t len) {
+    if (size + len > max_size) {
+      extend(len);
+    }
+    memcpy(&data[size], ptr, len);
+    size += len;
+  }
+
+  // Get the contents of the buffer
+  const char *getData() { return data; }
+  size_t getSize() { return size; }
+
+ private:
+  // Extend the buffer so that it can hold len more characters
+  void extend(size_t len) {
+    max_size = 2 * (size + len);
+    char *temp = new char[max_size];
+    if (data) {
+      memcpy(temp, data, size);
+      delete[] data;
+    }
+    data = temp;
+  }
+
+  size_t size, max_size;
+  char *data;
+};
+
+/*
+  The largest number of bytes written by one MPI-IO call
+*/
+static const long long TMR_MPI_IO_MAX_SIZE = 1 << 30;
+
+/*
+  An output file for the mesh
+
+  When the mesh is stored on all processors, only the root processor
+  writes the file. When the mesh is distributed, each processor
+  formats its part of the mesh into a buffer and the buffers are
+  written to the file in rank order with MPI-IO when flush() is
+  called, so that the mesh is never gathered on one processor. For a
+  distributed mesh, the constructor, flush() and close() are
+  collective on the communicator.
+*/
+class TMRMeshFile {
+ public:
+  TMRMeshFile(MPI_Comm _comm, const char *filename, const char *mode,
+              int _distributed) {
+    comm = _comm;
+    distributed = _distributed;
+    fp = NULL;
+    offset = 0;
+    fail = 0;
+    if (distributed) {
+      fail = MPI_File_open(comm, filename, MPI_MODE_WRONLY | MPI_MODE_CREATE,
+                           MPI_INFO_NULL, &mpi_fp);
+      if (!fail) {
+        MPI_File_set_size(mpi_fp, 0);
+      }
+    } else {
+      fp = fopen(filename, mode);
+      fail = (fp == NULL);
+    }
+    opened = !fail;
+  }
+  ~TMRMeshFile() { close(); }
+
+  // Check whether the file was opened
+  int isOpen() { return opened; }
+
+  // Write formatted output or binary data to the file
+  void print(const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    if (distributed) {
+      buffer.vprint(fmt, args);
+    } else {
+      vfprintf(fp, fmt, args);
+    }
+    va_end(args);
+  }
+  void write(const void *ptr, size_t size, size_t count) {
+    if (distributed) {
+      buffer.append(ptr, size * count);
+    } else {
+      fwrite(ptr, size, count, fp);
+    }
+  }
+
+  // Write the output from each processor to the file in rank order
+  void flush() {
+    if (!distributed || !opened) {
+      return;
+    }
+    int mpi_rank;
+    MPI_Comm_rank(comm, &mpi_rank);
+
+    // Find the offset to the output from this processor
+    long long size = buffer.getSize();
+    long long pos = 0, total = 0;
+    MPI_Exscan(&size, &pos, 1, MPI_LONG_LONG, MPI_SUM, comm);
+    MPI_Allreduce(&size, &total, 1, MPI_LONG_LONG, MPI_SUM, comm);
+    if (mpi_rank == 0) {
+      pos = 0;
+    }
+
+    const char *data = buffer.getData();
+    for (long long k = 0; k < size; k += TMR_MPI_IO_MAX_SIZE) {
+      int len = TMR_MPI_IO_MAX_SIZE;
+      if (size - k < TMR_MPI_IO_MAX_SIZE) {
+        len = size - k;
+      }
+      if (MPI_File_write_at(mpi_fp, offset + pos + k, &data[k], len,
+                            MPI_BYTE, MPI_STATUS_IGNORE) != MPI_SUCCESS) {
+        fail = 1;
+      }
+    }
+
+    offset += total;
+    buffer.reset();
+  }
+
+  // Flush and close the file and return a non-zero value if any of
+  // the writes failed
+  int close() {
+    if (opened) {
+      if (distributed) {
+        flush();
+        MPI_File_close(&mpi_fp);
+        int flag = fail;
+        MPI_Allreduce(&flag, &fail, 1, MPI_INT, MPI_MAX, comm);
+      } else {
+        if (ferror(fp)) {
+          fail = 1;
+        }
+        fclose(fp);
+      }
+      opened = 0;
+    }
+    return fail;
+  }
+
+ private:
+  MPI_Comm comm;
+  int distributed;
+  int opened, fail;
+
+  // The file when the mesh is written from the root processor
+  FILE *fp;
+
+  // The file, the current offset and the buffered output from this
+  // processor when the mesh is distributed
+  MPI_File mpi_fp;
+  MPI_Offset offset;
+  TMRCardBuffer buffer;
+};
+
+/*
+  Convert the local elements of a distributed mesh to the global node
+  numbering
+*/
+static int *TMR_GetGlobalElements(int size, const int *local, int start,
+                                  int num_owned, const int *ghosts) {
+  int *conn = new int[size];
+  for (int j = 0; j < size; j++) {
+    if (local[j] < num_owned) {
+      conn[j] = start + local[j];
+    } else {
+      conn[j] = ghosts[local[j] - num_owned];
+    }
+  }
+  return conn;
+}
+
+/*
+  Print out the mesh to a VTK file
+
+  For a distributed mesh, each processor writes its owned nodes and its
+  local elements in the global node numbering to the same file.
+*/
+void TMRMesh::writeToVTK(const char *filename, int flag) {
+  int rank;
+  MPI_Comm_rank(comm, &rank);
+
+  if ((distributed || rank == 0) && num_nodes > 0) {
+    // Check whether to print out just quads or hex or both
+    int nquad = num_quads;
+    int nhex = num_hex;
+    int ntris = num_tris;
+    if (!(flag & TMR_QUAD)) {
+      nquad = 0;
+    }
+    if (!(flag & TMR_HEX)) {
+      nhex = 0;
+    }
+
+    // Set the nodes and elements written by this processor
+    int npts = num_nodes;
+    const TMRPoint *Xpts = X;
+    int nq = nquad, nt = ntris, nh = nhex;
+    int *q = quads, *t = tris, *h = hex;
+    if (distributed) {
+      if (!local_X) {
+        initLocalMesh();
+      }
+      int start = node_range[rank];
+      npts = node_range[rank + 1] - start;
+      Xpts = local_X;
+      nq = (nquad > 0 ? num_local_quads : 0);
+      nt = num_local_tris;
+      nh = (nhex > 0 ? num_local_hex : 0);
+      q = TMR_GetGlobalElements(4 * nq, local_quads, start, npts,
+                                ghost_nodes);
+      t = TMR_GetGlobalElements(3 * nt, local_tris, start, npts, ghost_nodes);
+      h = TMR_GetGlobalElements(8 * nh, local_hex, start, npts, ghost_nodes);
+    } else if (!X) {
+      initMesh();
+      Xpts = X;
+      q = quads;
+      t = tris;
+      h = hex;
+    }
+
+    TMRMeshFile fp(comm, filename, "w", distributed);
+    if (fp.isOpen()) {
+      if (rank == 0) {
+        fp.print("# vtk DataFile Version 3.0\n");
+        fp.print("vtk output\nASCII\n");
+        fp.print("DATASET UNSTRUCTURED_GRID\n");
+        fp.print("POINTS %d float\n", num_nodes);
+      }
+
+      // Write out the points
+      for (int k = 0; k < npts; k++) {
+        fp.print("%e %e %e\n", Xpts[k].x, Xpts[k].y, Xpts[k].z);
+      }
+      fp.flush();
+
+      if (rank == 0) {
+        fp.print("\nCELLS %d %d\n", nquad + ntris + nhex,
+                 5 * nquad + 4 * ntris + 9 * nhex);
+      }
+
+      // Write out the cell connectivities
+      for (int k = 0; k < nq; k++) {
+        fp.print("4 %d %d %d %d\n", q[4 * k], q[4 * k + 1], q[4 * k + 2],
+                 q[4 * k + 3]);
+      }
+      fp.flush();
+      for (int k = 0; k < nt; k++) {
+        fp.print("3 %d %d %d\n", t[3 * k], t[3 * k + 1], t[3 * k + 2]);
+      }
+      fp.flush();
+      for (int k = 0; k < nh; k++) {
+        fp.print("8 %d %d %d %d %d %d %d %d\n", h[8 * k], h[8 * k + 1],
+                 h[8 * k + 2], h[8 * k + 3], h[8 * k + 4], h[8 * k + 5],
+                 h[8 * k + 6], h[8 * k + 7]);
+      }
+      fp.flush();
+
+      // All quadrilaterals
+      if (rank == 0) {
+        fp.print("\nCELL_TYPES %d\n", nquad + ntris + nhex);
+      }
+      for (int k = 0; k < nq; k++) {
+        fp.print("%d\n", 9);
+      }
+      fp.flush();
+      for (int k = 0; k < nt; k++) {
+        fp.print("%d\n", 5);
+      }
+      fp.flush();
+      for (int k = 0; k < nh; k++) {
+        fp.print("%d\n", 12);
+      }
+      fp.close();
+    }
+
+    if (distributed) {
+      delete[] q;
+      delete[] t;
+      delete[] h;
+    }
+  }
+}
+
+/*
+  Print out the mesh to a binary VTK XML (.vtu) file
+
+  For a distributed mesh, each processor writes its local nodes and
+  elements to the file prefix_<rank>.vtu, where the prefix is the file
+  name without the .vtu extension, and the root processor writes
+  prefix.pvtu which references all of the pieces.
+*/
+void TMRMesh::writeToVTU(const char *filename, int flag, int compress) {
+  int rank, size;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &size);
+
+  if ((distributed || rank == 0) && num_nodes > 0) {
+    // Check whether to print out just quads or hex or both
+    int nquad = num_quads;
+    int nhex = num_hex;
+    int ntris = num_tris;
+    if (!(flag & TMR_QUAD)) {
+      nquad = 0;
+    }
+    if (!(flag & TMR_HEX)) {
+      nhex = 0;
+    }
+
+    // Set the nodes and elements written by this processor
+    int npts = num_nodes;
+    const TMRPoint *Xpts = X;
+    const int *q = quads, *t = tris, *h = hex;
+    if (distributed) {
+      if (!local_X) {
+        initLocalMesh();
+      }
+      npts = node_range[rank + 1] - node_range[rank] + num_ghost_nodes;
+      Xpts = local_X;
+      nquad = (nquad > 0 ? num_local_quads : 0);
+      ntris = num_local_tris;
+      nhex = (nhex > 0 ? num_local_hex : 0);
+      q = local_quads;
+      t = local_tris;
+      h = local_hex;
+    } else if (!X) {
+      initMesh();
+      Xpts = X;
+      q = quads;
+      t = tris;
+      h = hex;
+    }
+
+    // Set the connectivity for all of the cells
+    int ncells = nquad + ntris + nhex;
+    int *ptr = new int[ncells + 1];
+    int *cell_conn = new int[4 * nquad + 3 * ntris + 8 * nhex];
+    int *cell_types = new int[ncells];
+    if (nquad > 0) {
+      memcpy(cell_conn, q, 4 * nquad * sizeof(int));
+    }
+    if (ntris > 0) {
+      memcpy(&cell_conn[4 * nquad], t, 3 * ntris * sizeof(int));
+    }
+    if (nhex > 0) {
+      memcpy(&cell_conn[4 * nquad + 3 * ntris], h, 8 * nhex * sizeof(int));
+    }
+
+    ptr[0] = 0;
+    int n = 0;
+    for (int k = 0; k < nquad; k++, n++) {
+      ptr[n + 1] = ptr[n] + 4;
+      cell_types[n] = TMR_VTK_QUAD;
+    }
+    for (int k = 0; k < ntris; k++, n++) {
+      ptr[n + 1] = ptr[n] + 3;
+      cell_types[n] = TMR_VTK_TRIANGLE;
+    }
+    for (int k = 0; k < nhex; k++, n++) {
+      ptr[n + 1] = ptr[n] + 8;
+      cell_types[n] = TMR_VTK_HEXAHEDRON;
+    }
+
+    if (distributed) {
+      // Strip the extension to get the prefix for the pieces
+      size_t len = strlen(filename);
+      char *prefix = new char[len + 1];
+      strcpy(prefix, filename);
+      if (len > 4 && strcmp(&prefix[len - 4], ".vtu") == 0) {
+        prefix[len - 4] = '\0';
+      }
+
+      // Write out this processor's piece of the mesh
+      char *piece = new char[len + 20];
+      sprintf(piece, "%s_%d.vtu", prefix, rank);
+      TMR_WriteVTUFile(piece, npts, Xpts, ncells, ptr, cell_conn, cell_types,
+                       0, NULL, NULL, compress);
+      if (rank == 0) {
+        TMR_WritePVTUFile(prefix, size, 0, NULL);
+      }
+      delete[] piece;
+      delete[] prefix;
+    } else {
+      TMR_WriteVTUFile(filename, npts, Xpts, ncells, ptr, cell_conn,
+                       cell_types, 0, NULL, NULL, compress);
+    }
+
+    delete[] ptr;
+    delete[] cell_conn;
+    delete[] cell_types;
+  }
+}
+
+/*
+  The number of cards that are formatted together in one chunk
+*/
+static const int TMR_BDF_CHUNK_SIZE = 4096;
+
+/*
+  The data needed to format the GRID cards
+*/
+struct TMRBDFGridData {
+  const TMRPoint *X;  // The node locations
+  int offset;         // Offset to the node numbers
+};
+
+/*
+  The data needed to format the shell or solid element cards
+*/
+struct TMRBDFElementData {
+  const int *vars;  // Local to global node numbers
+  const int *conn;  // Local element connectivity
+  int offset;       // Offset to the element numbers
+  int part;         // The part number
+  int reverse;      // Flag to indicate a reversed orientation
+};
+
+/*
+  Format the GRID cards for the nodes in the range [start, end)
+*/
+static void TMR_FormatGridCards(TMRCardBuffer *buf, int start, int end,
+                                const void *data) {
+  const TMRBDFGridData *d = (const TMRBDFGridData *)data;
+  const TMRPoint *X = d->X;
+  int coord_disp = 0, coord_id = 0, seid = 0;
+  for (int i = start; i < end; i++) {
+    int id = d->offset + i + 1;
+    buf->print("%-8s%16d%16d%16.9f%16.9f*%7d\n", "GRID*", id, coord_id,
+               X[i].x, X[i].y, id);
+    buf->print("*%7d%16.9f%16d%16s%16d        \n", id, X[i].z, coord_disp,
+               " ", seid);
+  }
+}
+
+/*
+  Format the CQUADR cards for the elements in the range [start, end)
+*/
+static void TMR_FormatQuadCards(TMRCardBuffer *buf, int start, int end,
+                                const void *data) {
+  const TMRBDFElementData *d = (const TMRBDFElementData *)data;
+  const int *vars = d->vars;
+  const int *quad_local = d->conn;
+  for (int k = start; k < end; k++) {
+    if (!d->reverse) {
+      buf->print("%-8s%8d%8d%8d%8d%8d%8d%8d\n", "CQUADR", d->offset + k + 1,
+                 d->part, vars[quad_local[4 * k]] + 1,
+                 vars[quad_local[4 * k + 1]] + 1,
+                 vars[quad_local[4 * k + 2]] + 1,
+                 vars[quad_local[4 * k + 3]] + 1, d->part);
+    } else {
+      // Print out the nodes in the reversed orientation
+      buf->print("%-8s%8d%8d%8d%8d%8d%8d%8d\n", "CQUADR", d->offset + k + 1,
+                 d->part, vars[quad_local[4 * k]] + 1,
+                 vars[quad_local[4 * k + 3]] + 1,
+                 vars[quad_local[4 * k + 2]] + 1,
+                 vars[quad_local[4 * k + 1]] + 1, d->part);
+    }
+  }
+}
+
+/*
+  Format the CHEXA cards for the elements in the range [start, end)
+*/
+static void TMR_FormatHexCards(TMRCardBuffer *buf, int start, int end,
+                               const void *data) {
+  const TMRBDFElementData *d = (const TMRBDFElementData *)data;
+  const int *vars = d->vars;
+  const int *hex_local = d->conn;
+  for (int k = start; k < end; k++) {
+    buf->print(
+        "%-8s%8d%8d%8d%8d%8d%8d%8d%8d\n", "CHEXA", d->offset + k + 1, d->part,
+        vars[hex_local[8 * k]] + 1, vars[hex_local[8 * k + 1]] + 1,
+        vars[hex_local[8 * k + 2]] + 1, vars[hex_local[8 * k + 3]] + 1,
+        vars[hex_local[8 * k + 4]] + 1, vars[hex_local[8 * k + 5]] + 1);
+    buf->print("%-8s%8d%8d\n", " ", vars[hex_local[8 * k + 6]] + 1,
+               vars[hex_local[8 * k + 7]] + 1);
+  }
+}
+
+/*
+  Format the cards in chunks and write them to the file in order
+
+  The cards in each chunk are formatted into separate buffers. When
+  OpenMP is enabled, the chunks are formatted in parallel by the
+  threads and then written to the file in order.
+*/
+static void TMR_WriteCards(TMRMeshFile *fp, int num, const void *data,
+                           void (*format)(TMRCardBuffer *, int, int,
+                                          const void *)) {
+  const int num_chunks = (num + TMR_BDF_CHUNK_SIZE - 1) / TMR_BDF_CHUNK_SIZE;
+  int num_buffers = 1;
+#ifdef TMR_HAS_OPENMP
+  num_buffers = 4 * omp_get_max_threads();
+#endif  // TMR_HAS_OPENMP
+  if (num_buffers > num_chunks) {
+    num_buffers = num_chunks;
+  }
+  TMRCardBuffer *buffers = new TMRCardBuffer[num_buffers];
+
+  for (int start = 0; start < num_chunks; start += num_buffers) {
+    int end = start + num_buffers;
+    if (end > num_chunks) {
+      end = num_chunks;
+    }
+
+#ifdef TMR_HAS_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif  // TMR_HAS_OPENMP
+    for (int k = start; k < end; k++) {
+      int first = k * TMR_BDF_CHUNK_SIZE;
+      int last = first + TMR_BDF_CHUNK_SIZE;
+      if (last > num) {
+        last = num;
+      }
+      buffers[k - start].reset();
+      format(&buffers[k - start], first, last, data);
+    }
+
+    for (int k = start; k < end; k++) {
+      fp->write(buffers[k - start].getData(), 1, buffers[k - start].getSize());
+    }
+  }
+
+  delete[] buffers;
+}
+
+/*
+  Write the bulk data file with material properties
+
+  For a distributed mesh, each processor writes the GRID cards for its
+  owned nodes and the element cards for the faces and volumes that it
+  owns to the same file. The node and element numbers are the same as
+  for the mesh stored on all processors.
+*/
+void TMRMesh::writeToBDF(const char *filename, int flag,
+                         TMRBoundaryConditions *bcs) {
+  // Static string for the beginning of the file
+  const char nastran_file_header[] =
+      "$ Generated by TMR\n$ NASTRAN input deck\nSOL 101\nBEGIN BULK\n";
+
+  int rank;
+  MPI_Comm_rank(comm, &rank);
+
+  if ((distributed || rank == 0) && num_nodes > 0) {
+    // Set the nodes written by this processor
+    TMRBDFGridData gdata;
+    gdata.X = X;
+    gdata.offset = 0;
+    int npts = num_nodes;
+    if (distributed) {
+      if (!local_X) {
+        initLocalMesh();
+      }
+      gdata.X = local_X;
+      gdata.offset = node_range[rank];
+      npts = node_range[rank + 1] - node_range[rank];
+    } else if (!X) {
+      initMesh();
+      gdata.X = X;
+    }
+
+    TMRMeshFile fp(comm, filename, "w", distributed);
+    if (fp.isOpen()) {
+      if (rank == 0) {
+        fp.print(nastran_file_header);
+        fp.print("$ Grid data\n");
+      }
+
+      // Write out the coordinates to the BDF file
+      TMR_WriteCards(&fp, npts, &gdata, TMR_FormatGridCards);
+
+      if (num_quads > 0 && (flag & TMR_QUAD)) {
+        int num_faces;
+        TMRFace **faces;
+        geo->getFaces(&num_faces, &faces);
+
+        // Write out the element data for each component
+        for (int i = 0, j = 0; i < num_faces; i++) {
+          TMRFaceMesh *mesh = NULL;
+          faces[i]->getMesh(&mesh);
+
+          // Loop over all possible edges in the surface mesh
+          const int *quad_local;
+          int nlocal = mesh->getQuadConnectivity(&quad_local);
+
+          // Skip the faces owned by other processors
+          if (distributed && face_owner[i] != rank) {
+            j += nlocal;
+            continue;
+          }
+
+          // Get the local to global variable numbering
+          const int *vars;
+          mesh->getNodeNums(&vars);
+
+          // Set the face id == name
+          char descript[128];
+          snprintf(descript, sizeof(descript), "FACE%d",
+                   faces[i]->getEntityId());
+          if (faces[i]->getName() != NULL) {
+            strncpy(descript, faces[i]->getName(), sizeof(descript));
+          }
+
+          // Print a local description of the face - use the entity
+          // data if it exists, otherwise use the id value
+          fp.print("%-41s", "$       Shell element data");
+          fp.print("%s\n", descript);
+
+          // Write out the elements, reversing the orientation if needed
+          TMRBDFElementData edata;
+          edata.vars = vars;
+          edata.conn = quad_local;
+          edata.offset = j;
+          edata.part = i + 1;
+          edata.reverse = (faces[i]->getOrientation() <= 0);
+          TMR_WriteCards(&fp, nlocal, &edata, TMR_FormatQuadCards);
+          j += nlocal;
+        }
+      }
+      if (num_hex > 0 && (flag & TMR_HEX)) {
+        int num_volumes;
+        TMRVolume **volumes;
+        geo->getVolumes(&num_volumes, &volumes);
+
+        // Write out the element data for each component
+        for (int i = 0, j = 0; i < num_volumes; i++) {
+          TMRVolumeMesh *mesh = NULL;
+          volumes[i]->getMesh(&mesh);
+
+          // Loop over all possible edges in the surface mesh
+          const int *hex_local;
+          int nlocal = mesh->getHexConnectivity(&hex_local);
+
+          // Skip the volumes owned by other processors
+          if (distributed && volume_owner[i] != rank) {
+            j += nlocal;
+            continue;
+          }
+
+          // Get the local to global variable numbering
+          const int *vars;
+          mesh->getNodeNums(&vars);
+
+          // Set the face id == name
+          char descript[128];
+          snprintf(descript, sizeof(descript), "VOLUME%d",
+                   volumes[i]->getEntityId());
+          if (volumes[i]->getName() != NULL) {
+            strncpy(descript, volumes[i]->getName(), sizeof(descript));
+          }
+
+          // Print a local description of the face - use the entity
+          // data if it exists, otherwise use the id value
+          int part = i + 1;
+          fp.print("%-41s", "$       Volume element data");
+          fp.print("%s\n", descript);
+          // fprintf(fp, "%-8s%8d%8d%8d\n", "PSOLID", part, part, 0);
+
+          TMRBDFElementData edata;
+          edata.vars = vars;
+          edata.conn = hex_local;
+          edata.offset = j;
+          edata.part = part;
+          edata.reverse = 0;
+          TMR_WriteCards(&fp, nlocal, &edata, TMR_FormatHexCards);
+          j += nlocal;
+        }
+      }
+      fp.flush();
 
-        // Get the local quadrilateral connectivity
-        const int *quad_local, *tri_local;
-        int nquad_local = mesh->getQuadConnectivity(&quad_local);
-        int ntri_local = mesh->getTriConnectivity(&tri_local);
+      // Write out the boundary conditions if BC information
+      // is supplied to the function
+      if (bcs && rank == 0) {
+        int nentries = bcs->getNumBoundaryConditions();
+        for (int index = 0; index < nentries; index++) {
+          // Retrieve the boundary condition
+          const char *name;
+          int num_bcs;
+          const int *bc_nums;
+          const double *bc_vals;
+          bcs->getBoundaryCondition(index, &name, &num_bcs, &bc_nums, &bc_vals);
 
-        // Get the local to global variable numbering
-        const int *vars;
-        mesh->getNodeNums(&vars);
+          // Print out a description about the boundary condition name
+          fp.print("%-41s%s\n", "$       Boundary data", name);
 
-        // Set the quadrilateral connectivity
-        if (faces[i]->getOrientation() > 0) {
-          for (int j = 0; j < 4 * nquad_local; j++, q++) {
-            q[0] = vars[quad_local[j]];
-          }
-          for (int j = 0; j < 3 * ntri_local; j++, t++) {
-            t[0] = vars[tri_local[j]];
-          }
-        } else {
-          for (int j = 0; j < nquad_local; j++) {
-            for (int k = 0; k < 4; k++) {
-              q[k] = vars[quad_local[4 * j + k]];
+          // Set the SPC constrain string
+          char spc[16];
+          const char *spc_list = "123456789";
+          for (int i = 0, j = 0; i < num_bcs; i++) {
+            if (bc_nums[i] >= 0 && bc_nums[i] <= 8) {
+              spc[j] = spc_list[bc_nums[i]];
+              spc[j + 1] = '\0';
+              j++;
             }
+          }
+
+          // Find the faces, edges and nodes with this name
+          int num_faces;
+          TMRFace **faces;
+          geo->getFaces(&num_faces, &faces);
+          for (int i = 0; i < num_faces; i++) {
+            // Set the face id == name
+            const char *face_name = faces[i]->getName();
+            if (face_name && strcmp(name, face_name) == 0) {
+              // Get the face mesh
+              TMRFaceMesh *mesh = NULL;
+              faces[i]->getMesh(&mesh);
+
+              // Get the local to global variable numbering
+              const int *vars;
+              int nnodes = mesh->getNodeNums(&vars);
 
-            // Flip the orientation of the quad
-            int tmp = q[1];
-            q[1] = q[3];
-            q[3] = tmp;
-            q += 4;
+              for (int k = 0; k < nnodes; k++) {
+                fp.print("%-8s%8d%8d%8s%8.2f\n", "SPC", 1, vars[k] + 1, spc,
+                         0.0);
+              }
+            }
           }
-          for (int j = 0; j < ntri_local; j++) {
-            for (int k = 0; k < 3; k++) {
-              t[k] = vars[tri_local[3 * j + k]];
+
+          int num_edges;
+          TMREdge **edges;
+          geo->getEdges(&num_edges, &edges);
+          for (int i = 0; i < num_edges; i++) {
+            // Set the face id == name
+            const char *edge_name = edges[i]->getName();
+            if (edge_name && strcmp(name, edge_name) == 0) {
+              // Get the edge mesh
+              TMREdgeMesh *mesh = NULL;
+              edges[i]->getMesh(&mesh);
+
+              // Get the local to global variable numbering
+              const int *vars;
+              int nnodes = mesh->getNodeNums(&vars);
+
+              for (int k = 0; k < nnodes; k++) {
+                fp.print("%-8s%8d%8d%8s%8f\n", "SPC", 1, vars[k] + 1, spc, 0.0);
+              }
             }
+          }
 
-            // Flip the orientation of the quad
-            int tmp = t[1];
-            t[1] = t[2];
-            t[2] = tmp;
-            t += 3;
+          int num_vertices = 0;
+          TMRVertex **vertices;
+          geo->getVertices(&num_vertices, &vertices);
+          for (int i = 0; i < num_vertices; i++) {
+            // Set the face id == name
+            const char *vert_name = vertices[i]->getName();
+            if (vert_name && strcmp(name, vert_name) == 0) {
+              int vnum;
+              vertices[i]->getNodeNum(&vnum);
+              fp.print("%-8s%8d%8d%8s%8f\n", "SPC", 1, vnum + 1, spc, 0.0);
+            }
           }
         }
+      }
 
-        // Set the node locations
-        for (int j = 0; j < npts; j++) {
-          X[vars[j]] = Xpts[j];
-        }
+      // Signal end of bulk data section and close file handle
+      if (rank == 0) {
+        fp.print("ENDDATA\n");
       }
+      fp.close();
     }
   }
 }
 
 /*
-  Retrieve the mesh points (allocate them if they do not exist)
-*/
-int TMRMesh::getMeshPoints(TMRPoint **_X) {
-  if (_X) {
-    if (!X) {
-      initMesh();
-    }
-    *_X = X;
-  }
-  return num_nodes;
-}
+  Find the nodes on the faces, edges and vertices with the given name
 
-/*
-  Retrieve the underlying mesh connectivity (allocate it if it does
-  not already exist)
+  The nodes are ordered in the same way as the SPC cards written to
+  the BDF file and may contain duplicates.
 */
-void TMRMesh::getQuadConnectivity(int *_nquads, const int **_quads) {
-  if (!X) {
-    initMesh();
-  }
-  if (_nquads) {
-    *_nquads = num_quads;
-  }
-  if (_quads) {
-    *_quads = quads;
-  }
-}
+static int TMR_GetNamedNodes(TMRModel *geo, const char *name, int **_nodes) {
+  int num_faces;
+  TMRFace **faces;
+  geo->getFaces(&num_faces, &faces);
+  int num_edges;
+  TMREdge **edges;
+  geo->getEdges(&num_edges, &edges);
+  int num_vertices;
+  TMRVertex **vertices;
+  geo->getVertices(&num_vertices, &vertices);
 
-/*
-  Get the triangluar mesh connectivity
-*/
-void TMRMesh::getTriConnectivity(int *_ntris, const int **_tris) {
-  if (!X) {
-    initMesh();
+  // Count up the number of nodes
+  int size = 0;
+  for (int i = 0; i < num_faces; i++) {
+    const char *face_name = faces[i]->getName();
+    if (face_name && strcmp(name, face_name) == 0) {
+      TMRFaceMesh *mesh = NULL;
+      faces[i]->getMesh(&mesh);
+      size += mesh->getNodeNums(NULL);
+    }
   }
-  if (_ntris) {
-    *_ntris = num_tris;
+  for (int i = 0; i < num_edges; i++) {
+    const char *edge_name = edges[i]->getName();
+    if (edge_name && strcmp(name, edge_name) == 0) {
+      TMREdgeMesh *mesh = NULL;
+      edges[i]->getMesh(&mesh);
+      size += mesh->getNodeNums(NULL);
+    }
   }
-  if (_tris) {
-    *_tris = tris;
+  for (int i = 0; i < num_vertices; i++) {
+    const char *vert_name = vertices[i]->getName();
+    if (vert_name && strcmp(name, vert_name) == 0) {
+      size++;
+    }
   }
-}
 
-/*
-  Get the hexahedral connectivity
-*/
-void TMRMesh::getHexConnectivity(int *_nhex, const int **_hex) {
-  if (!X) {
-    initMesh();
+  // Copy over the node numbers
+  int *nodes = new int[size];
+  int n = 0;
+  for (int i = 0; i < num_faces; i++) {
+    const char *face_name = faces[i]->getName();
+    if (face_name && strcmp(name, face_name) == 0) {
+      TMRFaceMesh *mesh = NULL;
+      faces[i]->getMesh(&mesh);
+      const int *vars;
+      int nnodes = mesh->getNodeNums(&vars);
+      memcpy(&nodes[n], vars, nnodes * sizeof(int));
+      n += nnodes;
+    }
   }
-  if (_nhex) {
-    *_nhex = num_hex;
+  for (int i = 0; i < num_edges; i++) {
+    const char *edge_name = edges[i]->getName();
+    if (edge_name && strcmp(name, edge_name) == 0) {
+      TMREdgeMesh *mesh = NULL;
+      edges[i]->getMesh(&mesh);
+      const int *vars;
+      int nnodes = mesh->getNodeNums(&vars);
+      memcpy(&nodes[n], vars, nnodes * sizeof(int));
+      n += nnodes;
+    }
   }
-  if (_hex) {
-    *_hex = hex;
+  for (int i = 0; i < num_vertices; i++) {
+    const char *vert_name = vertices[i]->getName();
+    if (vert_name && strcmp(name, vert_name) == 0) {
+      vertices[i]->getNodeNum(&nodes[n]);
+      n++;
+    }
   }
+
+  *_nodes = nodes;
+  return size;
 }
 
 /*
-  Print out the mesh to a VTK file
+  Write the mesh to a compact binary file
+
+  The binary file can be read back with TMRBinaryMesh. This avoids
+  formatting and parsing text for large meshes. The file format is:
+
+  4 integers: the number of nodes, quads, hex and boundary conditions
+  3*num_nodes doubles: the node locations
+  num_quads integers: the part number for each quad
+  4*num_quads integers: the quad connectivity
+  num_hex integers: the part number for each hex
+  8*num_hex integers: the hex connectivity
+
+  Followed by the data for each boundary condition:
+  1 integer: the length of the name (including the null character)
+  the characters in the name
+  1 integer: the number of constrained degrees of freedom = n
+  n integers and n doubles: the degrees of freedom and values
+  1 integer: the number of nodes = m
+  m integers: the node numbers
+
+  The node numbers are zero-based and the quads are written with the
+  same orientation as in the BDF file.
+
+  For a distributed mesh, each processor writes its owned nodes and
+  its local elements in the global node numbering to the same file.
 */
-void TMRMesh::writeToVTK(const char *filename, int flag) {
+int TMRMesh::writeToBinary(const char *filename, int flag,
+                           TMRBoundaryConditions *bcs) {
   int rank;
   MPI_Comm_rank(comm, &rank);
-  if (rank == 0 && num_nodes > 0) {
-    // Check whether to print out just quads or hex or both
+  int fail = 0;
+
+  if ((distributed || rank == 0) && num_nodes > 0) {
+    // Check whether to write out the quads, hex or both
     int nquad = num_quads;
     int nhex = num_hex;
-    int ntris = num_tris;
     if (!(flag & TMR_QUAD)) {
       nquad = 0;
     }
     if (!(flag & TMR_HEX)) {
       nhex = 0;
     }
-
-    if (!X) {
-      initMesh();
+    int nbcs = 0;
+    if (bcs) {
+      nbcs = bcs->getNumBoundaryConditions();
     }
-    FILE *fp = fopen(filename, "w");
-    if (fp) {
-      fprintf(fp, "# vtk DataFile Version 3.0\n");
-      fprintf(fp, "vtk output\nASCII\n");
-      fprintf(fp, "DATASET UNSTRUCTURED_GRID\n");
-
-      // Write out the points
-      fprintf(fp, "POINTS %d float\n", num_nodes);
-      for (int k = 0; k < num_nodes; k++) {
-        fprintf(fp, "%e %e %e\n", X[k].x, X[k].y, X[k].z);
-      }
 
-      fprintf(fp, "\nCELLS %d %d\n", nquad + ntris + nhex,
-              5 * nquad + 4 * ntris + 9 * nhex);
+    int num_faces, num_volumes;
+    TMRFace **faces;
+    TMRVolume **volumes;
+    geo->getFaces(&num_faces, &faces);
+    geo->getVolumes(&num_volumes, &volumes);
 
-      // Write out the cell connectivities
-      for (int k = 0; k < nquad; k++) {
-        fprintf(fp, "4 %d %d %d %d\n", quads[4 * k], quads[4 * k + 1],
-                quads[4 * k + 2], quads[4 * k + 3]);
-      }
-      for (int k = 0; k < ntris; k++) {
-        fprintf(fp, "3 %d %d %d\n", tris[3 * k], tris[3 * k + 1],
-                tris[3 * k + 2]);
-      }
-      for (int k = 0; k < nhex; k++) {
-        fprintf(fp, "8 %d %d %d %d %d %d %d %d\n", hex[8 * k], hex[8 * k + 1],
-                hex[8 * k + 2], hex[8 * k + 3], hex[8 * k + 4], hex[8 * k + 5],
-                hex[8 * k + 6], hex[8 * k + 7]);
+    // Set the nodes and elements written by this processor
+    int npts = num_nodes;
+    const TMRPoint *Xpts = X;
+    int nq = nquad, nh = nhex;
+    int *q = quads, *h = hex;
+    if (distributed) {
+      if (!local_X) {
+        initLocalMesh();
       }
+      int start = node_range[rank];
+      npts = node_range[rank + 1] - start;
+      Xpts = local_X;
+      nq = (nquad > 0 ? num_local_quads : 0);
+      nh = (nhex > 0 ? num_local_hex : 0);
+      q = TMR_GetGlobalElements(4 * nq, local_quads, start, npts,
+                                ghost_nodes);
+      h = TMR_GetGlobalElements(8 * nh, local_hex, start, npts, ghost_nodes);
+    } else if (!X) {
+      initMesh();
+      Xpts = X;
+      q = quads;
+      h = hex;
+    }
 
-      // All quadrilaterals
-      fprintf(fp, "\nCELL_TYPES %d\n", nquad + ntris + nhex);
-      for (int k = 0; k < nquad; k++) {
-        fprintf(fp, "%d\n", 9);
+    TMRMeshFile fp(comm, filename, "wb", distributed);
+    if (!fp.isOpen()) {
+      if (rank == 0) {
+        fprintf(stderr, "TMRMesh Error: Could not open file %s\n", filename);
       }
-      for (int k = 0; k < ntris; k++) {
-        fprintf(fp, "%d\n", 5);
-      }
-      for (int k = 0; k < nhex; k++) {
-        fprintf(fp, "%d\n", 12);
+      if (distributed) {
+        delete[] q;
+        delete[] h;
       }
+      return 1;
+    }
 
-      fclose(fp);
+    if (rank == 0) {
+      int header[4];
+      header[0] = num_nodes;
+      header[1] = nquad;
+      header[2] = nhex;
+      header[3] = nbcs;
+      fp.write(header, sizeof(int), 4);
+    }
+    fp.write(Xpts, sizeof(TMRPoint), npts);
+    fp.flush();
+
+    if (nquad > 0) {
+      // Set the part number for each quad
+      int *parts = new int[nq];
+      for (int i = 0, j = 0; i < num_faces; i++) {
+        TMRFace *copy_face = NULL;
+        if (distributed) {
+          faces[i]->getCopySource(NULL, &copy_face);
+        }
+        if (!distributed || (!copy_face && face_owner[i] == rank)) {
+          TMRFaceMesh *mesh = NULL;
+          faces[i]->getMesh(&mesh);
+          int nlocal = mesh->getQuadConnectivity(NULL);
+          for (int k = 0; k < nlocal; k++, j++) {
+            parts[j] = i + 1;
+          }
+        }
+      }
+      fp.write(parts, sizeof(int), nq);
+      fp.flush();
+      fp.write(q, sizeof(int), 4 * nq);
+      fp.flush();
+      delete[] parts;
     }
-  }
-}
 
-/*
-  Write the bulk data file with material properties
-*/
-void TMRMesh::writeToBDF(const char *filename, int flag,
-                         TMRBoundaryConditions *bcs) {
-  // Static string for the beginning of the file
-  const char nastran_file_header[] =
-      "$ Generated by TMR\n$ NASTRAN input deck\nSOL 101\nBEGIN BULK\n";
+    if (nhex > 0) {
+      // Set the part number for each hex
+      int *parts = new int[nh];
+      for (int i = 0, j = 0; i < num_volumes; i++) {
+        if (!distributed || volume_owner[i] == rank) {
+          TMRVolumeMesh *mesh = NULL;
+          volumes[i]->getMesh(&mesh);
+          int nlocal = mesh->getHexConnectivity(NULL);
+          for (int k = 0; k < nlocal; k++, j++) {
+            parts[j] = i + 1;
+          }
+        }
+      }
+      fp.write(parts, sizeof(int), nh);
+      fp.flush();
+      fp.write(h, sizeof(int), 8 * nh);
+      fp.flush();
+      delete[] parts;
+    }
 
-  int rank;
-  MPI_Comm_rank(comm, &rank);
-  if (rank == 0 && num_nodes > 0) {
-    if (!X) {
-      initMesh();
+    for (int index = 0; rank == 0 && index < nbcs; index++) {
+      const char *name;
+      int num_bcs;
+      const int *bc_nums;
+      const double *bc_vals;
+      bcs->getBoundaryCondition(index, &name, &num_bcs, &bc_nums, &bc_vals);
+
+      int len = strlen(name) + 1;
+      fp.write(&len, sizeof(int), 1);
+      fp.write(name, sizeof(char), len);
+      fp.write(&num_bcs, sizeof(int), 1);
+      fp.write(bc_nums, sizeof(int), num_bcs);
+      fp.write(bc_vals, sizeof(double), num_bcs);
+
+      int *nodes;
+      int nnodes = TMR_GetNamedNodes(geo, name, &nodes);
+      fp.write(&nnodes, sizeof(int), 1);
+      fp.write(nodes, sizeof(int), nnodes);
+      delete[] nodes;
     }
 
-    FILE *fp = fopen(filename, "w");
-    if (fp) {
-      fprintf(fp, nastran_file_header);
-      fprintf(fp, "$ Grid data\n");
+    fail = fp.close();
 
-      // Write out the coordinates to the BDF file
-      int coord_disp = 0, coord_id = 0, seid = 0;
-      for (int i = 0; i < num_nodes; i++) {
-        fprintf(fp, "%-8s%16d%16d%16.9f%16.9f*%7d\n", "GRID*", i + 1, coord_id,
-                X[i].x, X[i].y, i + 1);
-        fprintf(fp, "*%7d%16.9f%16d%16s%16d        \n", i + 1, X[i].z,
-                coord_disp, " ", seid);
-      }
+    if (distributed) {
+      delete[] q;
+      delete[] h;
+    }
+  }
 
-      if (num_quads > 0 && (flag & TMR_QUAD)) {
-        int num_faces;
-        TMRFace **faces;
-        geo->getFaces(&num_faces, &faces);
+  return fail;
+}
 
-        // Write out the element data for each component
-        for (int i = 0, j = 0; i < num_faces; i++) {
-          TMRFaceMesh *mesh = NULL;
-          faces[i]->getMesh(&mesh);
+/*
+  Create an empty binary mesh
+*/
+TMRBinaryMesh::TMRBinaryMesh() {
+  num_nodes = 0;
+  X = NULL;
+  num_quads = 0;
+  quads = quad_parts = NULL;
+  num_hex = 0;
+  hex = hex_parts = NULL;
+  num_bcs = 0;
+  bc_names = NULL;
+  bc_num_nums = NULL;
+  bc_nums = NULL;
+  bc_vals = NULL;
+  bc_num_nodes = NULL;
+  bc_nodes = NULL;
+}
 
-          // Loop over all possible edges in the surface mesh
-          const int *quad_local;
-          int nlocal = mesh->getQuadConnectivity(&quad_local);
+TMRBinaryMesh::~TMRBinaryMesh() { freeData(); }
 
-          // Get the local to global variable numbering
-          const int *vars;
-          mesh->getNodeNums(&vars);
+/*
+  Free the mesh data
+*/
+void TMRBinaryMesh::freeData() {
+  if (X) {
+    delete[] X;
+  }
+  if (quads) {
+    delete[] quads;
+  }
+  if (quad_parts) {
+    delete[] quad_parts;
+  }
+  if (hex) {
+    delete[] hex;
+  }
+  if (hex_parts) {
+    delete[] hex_parts;
+  }
+  for (int i = 0; i < num_bcs; i++) {
+    delete[] bc_names[i];
+    delete[] bc_nums[i];
+    delete[] bc_vals[i];
+    delete[] bc_nodes[i];
+  }
+  if (bc_names) {
+    delete[] bc_names;
+    delete[] bc_num_nums;
+    delete[] bc_nums;
+    delete[] bc_vals;
+    delete[] bc_num_nodes;
+    delete[] bc_nodes;
+  }
 
-          // Set the face id == name
-          char descript[128];
-          snprintf(descript, sizeof(descript), "FACE%d",
-                   faces[i]->getEntityId());
-          if (faces[i]->getName() != NULL) {
-            strncpy(descript, faces[i]->getName(), sizeof(descript));
-          }
+  num_nodes = 0;
+  X = NULL;
+  num_quads = 0;
+  quads = quad_parts = NULL;
+  num_hex = 0;
+  hex = hex_parts = NULL;
+  num_bcs = 0;
+  bc_names = NULL;
+  bc_num_nums = NULL;
+  bc_nums = NULL;
+  bc_vals = NULL;
+  bc_num_nodes = NULL;
+  bc_nodes = NULL;
+}
 
-          // Print a local description of the face - use the entity
-          // data if it exists, otherwise use the id value
-          fprintf(fp, "%-41s", "$       Shell element data");
-          fprintf(fp, "%s\n", descript);
+/*
+  Read the mesh from a binary file written by TMRMesh::writeToBinary()
 
-          if (faces[i]->getOrientation() > 0) {
-            for (int k = 0; k < nlocal; k++, j++) {
-              int part = i + 1;
-              fprintf(fp, "%-8s%8d%8d%8d%8d%8d%8d%8d\n", "CQUADR", j + 1, part,
-                      vars[quad_local[4 * k]] + 1,
-                      vars[quad_local[4 * k + 1]] + 1,
-                      vars[quad_local[4 * k + 2]] + 1,
-                      vars[quad_local[4 * k + 3]] + 1, part);
-            }
-          } else {
-            // Print out the nodes in the reversed orientation
-            for (int k = 0; k < nlocal; k++, j++) {
-              int part = i + 1;
-              fprintf(fp, "%-8s%8d%8d%8d%8d%8d%8d%8d\n", "CQUADR", j + 1, part,
-                      vars[quad_local[4 * k]] + 1,
-                      vars[quad_local[4 * k + 3]] + 1,
-                      vars[quad_local[4 * k + 2]] + 1,
-                      vars[quad_local[4 * k + 1]] + 1, part);
-            }
-          }
-        }
-      }
-      if (num_hex > 0 && (flag & TMR_HEX)) {
-        int num_volumes;
-        TMRVolume **volumes;
-        geo->getVolumes(&num_volumes, &volumes);
+  This is a serial call.
 
-        // Write out the element data for each component
-        for (int i = 0, j = 0; i < num_volumes; i++) {
-          TMRVolumeMesh *mesh = NULL;
-          volumes[i]->getMesh(&mesh);
+  input:
+  filename:  the name of the binary file
 
-          // Loop over all possible edges in the surface mesh
-          const int *hex_local;
-          int nlocal = mesh->getHexConnectivity(&hex_local);
+  returns:
+  a non-zero value if the file could not be read
+*/
+int TMRBinaryMesh::readFromFile(const char *filename) {
+  freeData();
+
+  FILE *fp = fopen(filename, "rb");
+  if (!fp) {
+    fprintf(stderr, "TMRBinaryMesh Error: Could not open file %s\n",
+            filename);
+    return 1;
+  }
 
-          // Get the local to global variable numbering
-          const int *vars;
-          mesh->getNodeNums(&vars);
+  int fail = 0;
+  int header[4];
+  if (fread(header, sizeof(int), 4, fp) != 4 || header[0] < 0 ||
+      header[1] < 0 || header[2] < 0 || header[3] < 0) {
+    fail = 1;
+  }
 
-          // Set the face id == name
-          char descript[128];
-          snprintf(descript, sizeof(descript), "VOLUME%d",
-                   volumes[i]->getEntityId());
-          if (volumes[i]->getName() != NULL) {
-            strncpy(descript, volumes[i]->getName(), sizeof(descript));
-          }
+  if (!fail) {
+    num_nodes = header[0];
+    num_quads = header[1];
+    num_hex = header[2];
 
-          // Print a local description of the face - use the entity
-          // data if it exists, otherwise use the id value
-          int part = i + 1;
-          fprintf(fp, "%-41s", "$       Volume element data");
-          fprintf(fp, "%s\n", descript);
-          // fprintf(fp, "%-8s%8d%8d%8d\n", "PSOLID", part, part, 0);
+    X = new TMRPoint[num_nodes];
+    quads = new int[4 * num_quads];
+    quad_parts = new int[num_quads];
+    hex = new int[8 * num_hex];
+    hex_parts = new int[num_hex];
+    if (fread(X, sizeof(TMRPoint), num_nodes, fp) != (size_t)num_nodes ||
+        fread(quad_parts, sizeof(int), num_quads, fp) != (size_t)num_quads ||
+        fread(quads, sizeof(int), 4 * num_quads, fp) !=
+            (size_t)(4 * num_quads) ||
+        fread(hex_parts, sizeof(int), num_hex, fp) != (size_t)num_hex ||
+        fread(hex, sizeof(int), 8 * num_hex, fp) != (size_t)(8 * num_hex)) {
+      fail = 1;
+    }
+  }
 
-          for (int k = 0; k < nlocal; k++, j++) {
-            fprintf(
-                fp, "%-8s%8d%8d%8d%8d%8d%8d%8d%8d\n", "CHEXA", j + 1, part,
-                vars[hex_local[8 * k]] + 1, vars[hex_local[8 * k + 1]] + 1,
-                vars[hex_local[8 * k + 2]] + 1, vars[hex_local[8 * k + 3]] + 1,
-                vars[hex_local[8 * k + 4]] + 1, vars[hex_local[8 * k + 5]] + 1);
-            fprintf(fp, "%-8s%8d%8d\n", " ", vars[hex_local[8 * k + 6]] + 1,
-                    vars[hex_local[8 * k + 7]] + 1);
-          }
-        }
+  if (!fail) {
+    num_bcs = header[3];
+    bc_names = new char *[num_bcs];
+    bc_num_nums = new int[num_bcs];
+    bc_nums = new int *[num_bcs];
+    bc_vals = new double *[num_bcs];
+    bc_num_nodes = new int[num_bcs];
+    bc_nodes = new int *[num_bcs];
+    memset(bc_names, 0, num_bcs * sizeof(char *));
+    memset(bc_num_nums, 0, num_bcs * sizeof(int));
+    memset(bc_nums, 0, num_bcs * sizeof(int *));
+    memset(bc_vals, 0, num_bcs * sizeof(double *));
+    memset(bc_num_nodes, 0, num_bcs * sizeof(int));
+    memset(bc_nodes, 0, num_bcs * sizeof(int *));
+
+    for (int i = 0; i < num_bcs && !fail; i++) {
+      int len = 0;
+      if (fread(&len, sizeof(int), 1, fp) != 1 || len <= 0) {
+        fail = 1;
+        break;
       }
+      bc_names[i] = new char[len];
+      if (fread(bc_names[i], sizeof(char), len, fp) != (size_t)len) {
+        fail = 1;
+        break;
+      }
+      bc_names[i][len - 1] = '\0';
 
-      // Write out the boundary conditions if BC information
-      // is supplied to the function
-      if (bcs) {
-        int nentries = bcs->getNumBoundaryConditions();
-        for (int index = 0; index < nentries; index++) {
-          // Retrieve the boundary condition
-          const char *name;
-          int num_bcs;
-          const int *bc_nums;
-          const double *bc_vals;
-          bcs->getBoundaryCondition(index, &name, &num_bcs, &bc_nums, &bc_vals);
-
-          // Print out a description about the boundary condition name
-          fprintf(fp, "%-41s%s\n", "$       Boundary data", name);
-
-          // Set the SPC constrain string
-          char spc[16];
-          const char *spc_list = "123456789";
-          for (int i = 0, j = 0; i < num_bcs; i++) {
-            if (bc_nums[i] >= 0 && bc_nums[i] <= 8) {
-              spc[j] = spc_list[bc_nums[i]];
-              spc[j + 1] = '\0';
-              j++;
-            }
-          }
+      int n = 0;
+      if (fread(&n, sizeof(int), 1, fp) != 1 || n < 0) {
+        fail = 1;
+        break;
+      }
+      bc_num_nums[i] = n;
+      bc_nums[i] = new int[n];
+      bc_vals[i] = new double[n];
+      if (fread(bc_nums[i], sizeof(int), n, fp) != (size_t)n ||
+          fread(bc_vals[i], sizeof(double), n, fp) != (size_t)n) {
+        fail = 1;
+        break;
+      }
 
-          // Find the faces, edges and nodes with this name
-          int num_faces;
-          TMRFace **faces;
-          geo->getFaces(&num_faces, &faces);
-          for (int i = 0; i < num_faces; i++) {
-            // Set the face id == name
-            const char *face_name = faces[i]->getName();
-            if (face_name && strcmp(name, face_name) == 0) {
-              // Get the face mesh
-              TMRFaceMesh *mesh = NULL;
-              faces[i]->getMesh(&mesh);
+      int m = 0;
+      if (fread(&m, sizeof(int), 1, fp) != 1 || m < 0) {
+        fail = 1;
+        break;
+      }
+      bc_num_nodes[i] = m;
+      bc_nodes[i] = new int[m];
+      if (fread(bc_nodes[i], sizeof(int), m, fp) != (size_t)m) {
+        fail = 1;
+      }
+    }
+  }
+  fclose(fp);
 
-              // Get the local to global variable numbering
-              const int *vars;
-              int nnodes = mesh->getNodeNums(&vars);
+  if (fail) {
+    fprintf(stderr, "TMRBinaryMesh Error: Failed to read file %s\n",
+            filename);
+    freeData();
+  }
 
-              for (int k = 0; k < nnodes; k++) {
-                fprintf(fp, "%-8s%8d%8d%8s%8.2f\n", "SPC", 1, vars[k] + 1, spc,
-                        0.0);
-              }
-            }
-          }
+  return fail;
+}
 
-          int num_edges;
-          TMREdge **edges;
-          geo->getEdges(&num_edges, &edges);
-          for (int i = 0; i < num_edges; i++) {
-            // Set the face id == name
-            const char *edge_name = edges[i]->getName();
-            if (edge_name && strcmp(name, edge_name) == 0) {
-              // Get the edge mesh
-              TMREdgeMesh *mesh = NULL;
-              edges[i]->getMesh(&mesh);
+/*
+  Retrieve the node locations
+*/
+int TMRBinaryMesh::getMeshPoints(TMRPoint **_X) {
+  if (_X) {
+    *_X = X;
+  }
+  return num_nodes;
+}
 
-              // Get the local to global variable numbering
-              const int *vars;
-              int nnodes = mesh->getNodeNums(&vars);
+/*
+  Retrieve the quadrilateral connectivity and part numbers
+*/
+int TMRBinaryMesh::getQuadConnectivity(const int **_quads,
+                                       const int **_quad_parts) {
+  if (_quads) {
+    *_quads = quads;
+  }
+  if (_quad_parts) {
+    *_quad_parts = quad_parts;
+  }
+  return num_quads;
+}
 
-              for (int k = 0; k < nnodes; k++) {
-                fprintf(fp, "%-8s%8d%8d%8s%8f\n", "SPC", 1, vars[k] + 1, spc,
-                        0.0);
-              }
-            }
-          }
+/*
+  Retrieve the hexahedral connectivity and part numbers
+*/
+int TMRBinaryMesh::getHexConnectivity(const int **_hex,
+                                      const int **_hex_parts) {
+  if (_hex) {
+    *_hex = hex;
+  }
+  if (_hex_parts) {
+    *_hex_parts = hex_parts;
+  }
+  return num_hex;
+}
 
-          int num_vertices = 0;
-          TMRVertex **vertices;
-          geo->getVertices(&num_vertices, &vertices);
-          for (int i = 0; i < num_vertices; i++) {
-            // Set the face id == name
-            const char *vert_name = vertices[i]->getName();
-            if (vert_name && strcmp(name, vert_name) == 0) {
-              int vnum;
-              vertices[i]->getNodeNum(&vnum);
-              fprintf(fp, "%-8s%8d%8d%8s%8f\n", "SPC", 1, vnum + 1, spc, 0.0);
-            }
-          }
-        }
-      }
+/*
+  Get the number of boundary conditions
+*/
+int TMRBinaryMesh::getNumBoundaryConditions() { return num_bcs; }
 
-      // Signal end of bulk data section and close file handle
-      fprintf(fp, "ENDDATA\n");
-      fclose(fp);
+/*
+  Retrieve the boundary condition information and the nodes
+*/
+void TMRBinaryMesh::getBoundaryCondition(int bc, const char **_name,
+                                         int *_num_bcs, const int **_bc_nums,
+                                         const double **_bc_vals,
+                                         int *_num_bc_nodes,
+                                         const int **_bc_nodes) {
+  if (bc >= 0 && bc < num_bcs) {
+    if (_name) {
+      *_name = bc_names[bc];
     }
+    if (_num_bcs) {
+      *_num_bcs = bc_num_nums[bc];
+    }
+    if (_bc_nums) {
+      *_bc_nums = bc_nums[bc];
+    }
+    if (_bc_vals) {
+      *_bc_vals = bc_vals[bc];
+    }
+    if (_num_bc_nodes) {
+      *_num_bc_nodes = bc_num_nodes[bc];
+    }
+    if (_bc_nodes) {
+      *_bc_nodes = bc_nodes[bc];
+    }
+  }
+}
+
+/*
+  Get the node numbers of an entity mesh in the local node numbering
+  of the mesh. The nodes that are not local are set to -1.
+*/
+static int *TMR_GetLocalNodeNums(int n, const int *vars, int start,
+                                 int num_owned, int num_ghosts,
+                                 const int *ghosts) {
+  int *local = new int[n];
+  for (int j = 0; j < n; j++) {
+    local[j] = TMR_GetLocalNodeIndex(vars[j], start, num_owned, num_ghosts,
+                                     ghosts);
   }
+  return local;
 }
 
 /*
   Create the topology object, generating the vertices, edges and faces
   for each element in the underlying mesh.
+
+  For a distributed mesh, the model is created from the local part of
+  the mesh on each processor. The vertices are the owned nodes followed
+  by the ghost nodes, and the faces or volumes are the local elements.
+  The entities on the boundary between processors are created on each
+  processor that references them.
 */
 TMRModel *TMRMesh::createModelFromMesh() {
-  // Initialize the mesh
-  initMesh();
+  // Set the nodes and elements used to create the model
+  int mpi_rank;
+  MPI_Comm_rank(comm, &mpi_rank);
+  int start = 0, num_owned = num_nodes;
+  int nghosts = 0;
+  const int *ghosts = NULL;
+  int nnodes = num_nodes;
+  const TMRPoint *Xpts = NULL;
+  int nquads = num_quads, nhex = num_hex;
+  const int *quad_conn = NULL, *hex_conn = NULL;
+  if (distributed) {
+    if (!local_X) {
+      initLocalMesh();
+    }
+    start = node_range[mpi_rank];
+    num_owned = node_range[mpi_rank + 1] - start;
+    nghosts = num_ghost_nodes;
+    ghosts = ghost_nodes;
+    nnodes = num_owned + nghosts;
+    Xpts = local_X;
+    nquads = num_local_quads;
+    nhex = num_local_hex;
+    quad_conn = local_quads;
+    hex_conn = local_hex;
+  } else {
+    initMesh();
+    Xpts = X;
+    quad_conn = quads;
+    hex_conn = hex;
+  }
 
   // Create vertices
-  TMRVertex **new_verts = new TMRVertex *[num_nodes];
-  memset(new_verts, 0, num_nodes * sizeof(TMRVertex *));
+  TMRVertex **new_verts = new TMRVertex *[nnodes];
+  memset(new_verts, 0, nnodes * sizeof(TMRVertex *));
 
   // Copy over the vertices in the original geometry
   int num_vertices;
@@ -1598,7 +4295,10 @@ TMRModel *TMRMesh::createModelFromMesh() {
     if (!copy_vert) {
       int vnum;
       vertices[i]->getNodeNum(&vnum);
-      new_verts[vnum] = vertices[i];
+      vnum = TMR_GetLocalNodeIndex(vnum, start, num_owned, nghosts, ghosts);
+      if (vnum >= 0) {
+        new_verts[vnum] = vertices[i];
+      }
     }
   }
 
@@ -1613,17 +4313,23 @@ TMRModel *TMRMesh::createModelFromMesh() {
       TMREdgeMesh *mesh = NULL;
       edges[i]->getMesh(&mesh);
 
-      // Get the variable numbers
-      const int *vars;
-      mesh->getNodeNums(&vars);
+      // Get the local variable numbers
+      const int *global_vars;
+      int nvars = mesh->getNodeNums(&global_vars);
+      int *vars = TMR_GetLocalNodeNums(nvars, global_vars, start, num_owned,
+                                       nghosts, ghosts);
 
       // Get the parametric points associated with the mesh
       int npts;
       const double *tpts;
       mesh->getMeshPoints(&npts, &tpts, NULL);
       for (int j = 1; j < npts - 1; j++) {
-        new_verts[vars[j]] = new TMRVertexFromEdge(edges[i], tpts[j]);
+        if (vars[j] >= 0) {
+          new_verts[vars[j]] = new TMRVertexFromEdge(edges[i], tpts[j]);
+        }
       }
+
+      delete[] vars;
     }
   }
 
@@ -1638,9 +4344,11 @@ TMRModel *TMRMesh::createModelFromMesh() {
       TMRFaceMesh *mesh = NULL;
       faces[i]->getMesh(&mesh);
 
-      // Get the variable numbers
-      const int *vars;
-      mesh->getNodeNums(&vars);
+      // Get the local variable numbers
+      const int *global_vars;
+      int nvars = mesh->getNodeNums(&global_vars);
+      int *vars = TMR_GetLocalNodeNums(nvars, global_vars, start, num_owned,
+                                       nghosts, ghosts);
 
       // Get the mesh points
       int npts;
@@ -1650,18 +4358,22 @@ TMRModel *TMRMesh::createModelFromMesh() {
       // Get the point-offset for this surface
       int offset = mesh->getNumFixedPoints();
       for (int j = offset; j < npts; j++) {
-        new_verts[vars[j]] =
-            new TMRVertexFromFace(faces[i], pts[2 * j], pts[2 * j + 1]);
+        if (vars[j] >= 0) {
+          new_verts[vars[j]] =
+              new TMRVertexFromFace(faces[i], pts[2 * j], pts[2 * j + 1]);
+        }
       }
+
+      delete[] vars;
     }
   }
 
   // Create all the remaining nodes. These are associated with the
   // TMRVolumeMesh since they do not lie on an edge or face
-  if (num_hex > 0) {
-    for (int i = 0; i < num_nodes; i++) {
+  if (nhex > 0) {
+    for (int i = 0; i < nnodes; i++) {
       if (!new_verts[i]) {
-        new_verts[i] = new TMRVertexFromPoint(X[i]);
+        new_verts[i] = new TMRVertexFromPoint(Xpts[i]);
       }
     }
   }
@@ -1675,26 +4387,26 @@ TMRModel *TMRMesh::createModelFromMesh() {
   int *hex_edges = NULL, *hex_faces = NULL;
   int *hex_edge_nums = NULL, *hex_face_nums = NULL;
 
-  if (num_hex > 0) {
+  if (nhex > 0) {
     // Compute the hexahedral edges and surfaces
-    TMR_ComputeHexEdgesAndFaces(num_nodes, num_hex, hex, &num_hex_edges,
+    TMR_ComputeHexEdgesAndFaces(nnodes, nhex, hex_conn, &num_hex_edges,
                                 &hex_edges, &hex_edge_nums, &num_hex_faces,
                                 &hex_faces, &hex_face_nums);
   } else {
     // Compute the quadrilateral edges
-    TMR_ComputeQuadEdges(num_nodes, num_quads, quads, &num_quad_edges,
+    TMR_ComputeQuadEdges(nnodes, nquads, quad_conn, &num_quad_edges,
                          &quad_edges);
   }
 
   // Set a pointer to all of the edges
-  int num_mesh_faces = num_quads;
+  int num_mesh_faces = nquads;
   int num_mesh_edges = num_quad_edges;
 
   // Set the pointer to all of the edges within the mesh
   // This points to either the quad edges (if they were
   // computed) or the hex edges
   const int *mesh_edges = quad_edges;
-  const int *mesh_faces = quads;
+  const int *mesh_faces = quad_conn;
   if (hex_edges) {
     num_mesh_edges = num_hex_edges;
     num_mesh_faces = num_hex_faces;
@@ -1703,32 +4415,22 @@ TMRModel *TMRMesh::createModelFromMesh() {
     mesh_faces = hex_faces;
   }
 
-  // Create a searchable array that stores the edge number and the two
-  // connecting node numbers. The node numbers are sorted such that
-  // the lowest one comes first. This enables fast sorting/searching
-  int *sorted_edges = new int[3 * num_mesh_edges];
-
-  // Populate the sorted_edges array, sorting each edge as we go...
+  // Create a table that maps the two connecting node numbers of each
+  // edge to the edge number. This enables fast searching
+  TMRMeshEntityTable *edge_table = new TMRMeshEntityTable(2, nnodes);
   for (int i = 0; i < num_mesh_edges; i++) {
-    sorted_edges[3 * i] = i;
-
-    // Set the quad edge, setting the lower edge number first
-    if (mesh_edges[2 * i] < mesh_edges[2 * i + 1]) {
-      sorted_edges[3 * i + 1] = mesh_edges[2 * i];
-      sorted_edges[3 * i + 2] = mesh_edges[2 * i + 1];
-    } else {
-      sorted_edges[3 * i + 1] = mesh_edges[2 * i + 1];
-      sorted_edges[3 * i + 2] = mesh_edges[2 * i];
-    }
+    edge_table->countEntry(&mesh_edges[2 * i]);
+  }
+  edge_table->initialize();
+  for (int i = 0; i < num_mesh_edges; i++) {
+    edge_table->addEntry(&mesh_edges[2 * i]);
   }
-
-  // Sort all of the edges/nodes so that they can be easily searched
-  qsort(sorted_edges, num_mesh_edges, 3 * sizeof(int), compare_edges);
 
   // Keep track of the orientation of the mesh edges.  edge_dir[i]
-  // > 0 means that the ordering of the vertices in the sorted_edges
-  // array is consistent with the orientation in the mesh. edge_dir[i]
-  // < 0 means the edge is flipped relative to the sorted_edges array.
+  // > 0 means that the ordering of the vertices, with the lowest node
+  // number first, is consistent with the orientation in the
+  // mesh. edge_dir[i] < 0 means the edge is flipped relative to this
+  // ordering.
   int *edge_dir = new int[num_mesh_edges];
   memset(edge_dir, 0, num_mesh_edges * sizeof(int));
 
@@ -1747,32 +4449,26 @@ TMRModel *TMRMesh::createModelFromMesh() {
       TMREdgeMesh *mesh = NULL;
       edges[i]->getMesh(&mesh);
 
-      // Get the global variables associated with the edge
-      const int *vars;
-      mesh->getNodeNums(&vars);
+      // Get the local variables associated with the edge
+      const int *global_vars;
+      int nvars = mesh->getNodeNums(&global_vars);
+      int *vars = TMR_GetLocalNodeNums(nvars, global_vars, start, num_owned,
+                                       nghosts, ghosts);
 
       // Get the parametric points associated with the mesh
       int npts;
       const double *tpts;
       mesh->getMeshPoints(&npts, &tpts, NULL);
       for (int j = 0; j < npts - 1; j++) {
-        // Find the edge associated with this curve
-        int edge[3];
-        edge[0] = 0;
-        if (vars[j] < vars[j + 1]) {
-          edge[1] = vars[j];
-          edge[2] = vars[j + 1];
-        } else {
-          edge[1] = vars[j + 1];
-          edge[2] = vars[j];
+        // Skip the segments that are not local
+        if (vars[j] < 0 || vars[j + 1] < 0) {
+          continue;
         }
 
-        // Find the associated edge number
-        int *res = (int *)bsearch(edge, sorted_edges, num_mesh_edges,
-                                  3 * sizeof(int), compare_edges);
+        // Find the edge number associated with this curve
+        int edge_num = edge_table->getIndex(&vars[j]);
 
-        if (res) {
-          int edge_num = res[0];
+        if (edge_num >= 0) {
           if (!new_edges[edge_num]) {
             // Check whether the node ordering is consistent with the
             // edge orientation. If not, tag this edge as reversed.
@@ -1785,12 +4481,14 @@ TMRModel *TMRMesh::createModelFromMesh() {
             new_edges[edge_num] =
                 new TMRSplitEdge(edges[i], tpts[j], tpts[j + 1]);
           }
-        } else {
+        } else if (!distributed) {
           fprintf(stderr,
                   "TMRMesh Error: Could not find edge (%d, %d) to split\n",
-                  edge[1], edge[2]);
+                  vars[j], vars[j + 1]);
         }
       }
+
+      delete[] vars;
     }
   }
 
@@ -1812,9 +4510,11 @@ TMRModel *TMRMesh::createModelFromMesh() {
       const int *quad_local;
       int nlocal = mesh->getQuadConnectivity(&quad_local);
 
-      // Get the global variables associated with the local mesh
-      const int *vars;
-      mesh->getNodeNums(&vars);
+      // Get the local variables associated with the face mesh
+      const int *global_vars;
+      int nvars = mesh->getNodeNums(&global_vars);
+      int *vars = TMR_GetLocalNodeNums(nvars, global_vars, start, num_owned,
+                                       nghosts, ghosts);
 
       for (int j = 0; j < nlocal; j++) {
         for (int k = 0; k < 4; k++) {
@@ -1828,24 +4528,18 @@ TMRModel *TMRMesh::createModelFromMesh() {
             l2 = quad_local[4 * j + flipped_quad_edge_nodes[k][1]];
           }
 
-          // Get the global edge number
-          int edge[3];
-          edge[0] = 0;
-          if (vars[l1] < vars[l2]) {
-            edge[1] = vars[l1];
-            edge[2] = vars[l2];
-          } else {
-            edge[1] = vars[l2];
-            edge[2] = vars[l1];
+          // Skip the edges that are not local
+          if (vars[l1] < 0 || vars[l2] < 0) {
+            continue;
           }
 
           // Find the associated edge number
-          int *res = (int *)bsearch(edge, sorted_edges, num_mesh_edges,
-                                    3 * sizeof(int), compare_edges);
+          int edge[2];
+          edge[0] = vars[l1];
+          edge[1] = vars[l2];
+          int edge_num = edge_table->getIndex(edge);
 
-          if (res) {
-            // Get the edge number
-            int edge_num = res[0];
+          if (edge_num >= 0) {
             if (!new_edges[edge_num]) {
               // These edges are constructed such that they are
               // always in the forward orientation.
@@ -1867,18 +4561,20 @@ TMRModel *TMRMesh::createModelFromMesh() {
               TMRBsplinePcurve *pcurve = new TMRBsplinePcurve(2, 2, cpts);
               new_edges[edge_num] = new TMREdgeFromFace(faces[i], pcurve);
             }
-          } else {
+          } else if (!distributed) {
             fprintf(stderr,
                     "TMRMesh Error: Could not find edge (%d, %d) for Pcurve\n",
-                    edge[1], edge[2]);
+                    edge[0], edge[1]);
           }
         }
       }
+
+      delete[] vars;
     }
   }
 
   // Create the hexahedral elements
-  if (num_hex > 0) {
+  if (nhex > 0) {
     for (int i = 0; i < num_mesh_edges; i++) {
       if (!new_edges[i]) {
         // Get the edges
@@ -1902,24 +4598,18 @@ TMRModel *TMRMesh::createModelFromMesh() {
   TMRFace **new_faces = new TMRFace *[num_mesh_faces];
   memset(new_faces, 0, num_mesh_faces * sizeof(TMRFace *));
 
-  // Create the face array
-  int *sorted_faces = NULL;
-
-  if (num_hex > 0) {
-    // Allocate an array to store the searchable array that
-    // stores the face nodes
-    sorted_faces = new int[5 * num_hex_faces];
+  // Create the table that maps the face nodes to the face number
+  TMRMeshEntityTable *face_table = NULL;
 
+  if (nhex > 0) {
+    face_table = new TMRMeshEntityTable(4, nnodes);
     for (int i = 0; i < num_hex_faces; i++) {
-      sorted_faces[5 * i] = i;
-      for (int k = 0; k < 4; k++) {
-        sorted_faces[5 * i + 1 + k] = hex_faces[4 * i + k];
-      }
-      sort_face_nodes(&sorted_faces[5 * i + 1]);
+      face_table->countEntry(&hex_faces[4 * i]);
+    }
+    face_table->initialize();
+    for (int i = 0; i < num_hex_faces; i++) {
+      face_table->addEntry(&hex_faces[4 * i]);
     }
-
-    // Sort all of the faces so that they can be easily searched
-    qsort(sorted_faces, num_mesh_faces, 5 * sizeof(int), compare_faces);
   }
 
   // Allocate the faces
@@ -1941,12 +4631,48 @@ TMRModel *TMRMesh::createModelFromMesh() {
       const int *quad_local;
       int nlocal = mesh->getQuadConnectivity(&quad_local);
 
-      // Get the global variables associated with the local mesh
-      const int *vars;
-      mesh->getNodeNums(&vars);
+      // Get the local variables associated with the face mesh
+      const int *global_vars;
+      int nvars = mesh->getNodeNums(&global_vars);
+      int *vars = TMR_GetLocalNodeNums(nvars, global_vars, start, num_owned,
+                                       nghosts, ghosts);
+
+      // For a distributed quad mesh, the local quads are the quads in
+      // the faces owned by this processor
+      if (distributed && !face_table && face_owner[i] != mpi_rank) {
+        nlocal = 0;
+      }
 
       // Iterate over all of the edges, creating the appropriate faces
       for (int j = 0; j < nlocal; j++) {
+        // Skip the quads that are not local
+        if (vars[quad_local[4 * j]] < 0 || vars[quad_local[4 * j + 1]] < 0 ||
+            vars[quad_local[4 * j + 2]] < 0 ||
+            vars[quad_local[4 * j + 3]] < 0) {
+          continue;
+        }
+
+        // If this is a hexahedral mesh, then we need to be consistent
+        // with how the faces are ordered. This code searches for the
+        // face number within the face table to obtain the required
+        // face number
+        if (face_table) {
+          // Set the nodes associated with this face
+          int face[4];
+          for (int k = 0; k < 4; k++) {
+            face[k] = vars[quad_local[4 * j + k]];
+          }
+
+          // Search for the face and set the face number. Skip the
+          // faces that are not in the local part of a distributed mesh.
+          int index = face_table->getIndex(face);
+          if (index >= 0) {
+            face_num = index;
+          } else if (distributed) {
+            continue;
+          }
+        }
+
         TMREdge *c[4];
         int dir[4];
         TMRVertex *v[4];
@@ -1976,24 +4702,13 @@ TMRModel *TMRMesh::createModelFromMesh() {
             l2 = quad_local[4 * j + flipped_quad_edge_nodes[k][1]];
           }
 
-          // Get the global edge number
-          int edge[3];
-          edge[0] = 0;
-          if (vars[l1] < vars[l2]) {
-            edge[1] = vars[l1];
-            edge[2] = vars[l2];
-          } else {
-            edge[1] = vars[l2];
-            edge[2] = vars[l1];
-          }
-
           // Find the associated edge number
-          int *res = (int *)bsearch(edge, sorted_edges, num_mesh_edges,
-                                    3 * sizeof(int), compare_edges);
+          int edge[2];
+          edge[0] = vars[l1];
+          edge[1] = vars[l2];
+          int edge_num = edge_table->getIndex(edge);
 
-          if (res) {
-            // Get the global edge number
-            int edge_num = res[0];
+          if (edge_num >= 0) {
             c[k] = new_edges[edge_num];
 
             if (vars[l1] < vars[l2]) {
@@ -2005,30 +4720,7 @@ TMRModel *TMRMesh::createModelFromMesh() {
           } else {
             fprintf(stderr,
                     "TMRMesh Error: Could not find edge (%d, %d) for surface\n",
-                    edge[1], edge[2]);
-          }
-        }
-
-        // If this is a hexahedral mesh, then we need to be consistent
-        // with how the faces are ordered. This code searches for the
-        // face number within the sorted_faces array to obtain the
-        // required face number
-        if (sorted_faces) {
-          // Set the nodes associated with this face and sort them
-          int face[5];
-          face[0] = 0;
-          for (int k = 0; k < 4; k++) {
-            face[k + 1] = vars[quad_local[4 * j + k]];
-          }
-          sort_face_nodes(&face[1]);
-
-          // Search for the face
-          int *res = (int *)bsearch(face, sorted_faces, num_mesh_faces,
-                                    5 * sizeof(int), compare_faces);
-
-          // Set the face number
-          if (res) {
-            face_num = res[0];
+                    edge[0], edge[1]);
           }
         }
 
@@ -2036,11 +4728,13 @@ TMRModel *TMRMesh::createModelFromMesh() {
         new_faces[face_num] = new TMRParametricTFIFace(faces[i], c, dir, v);
         face_num++;
       }
+
+      delete[] vars;
     }
   }
 
   // Create the remaining faces
-  if (num_hex > 0) {
+  if (nhex > 0) {
     for (int i = 0; i < num_mesh_faces; i++) {
       if (!new_faces[i]) {
         // The edge, direction and vertex information
@@ -2057,32 +4751,20 @@ TMRModel *TMRMesh::createModelFromMesh() {
           int e0 = mesh_faces[4 * i + quad_edge_nodes[k][0]];
           int e1 = mesh_faces[4 * i + quad_edge_nodes[k][1]];
 
-          // Get the global edge number
-          int edge[3];
-          edge[0] = 0;
-          dir[k] = 1;
-          if (e0 < e1) {
-            edge[1] = e0;
-            edge[2] = e1;
-          } else {
-            dir[k] = -1;
-            edge[1] = e1;
-            edge[2] = e0;
-          }
-
-          // Find the associated edge number
-          int *res = (int *)bsearch(edge, sorted_edges, num_mesh_edges,
-                                    3 * sizeof(int), compare_edges);
+          // Find the associated global edge number
+          int edge[2];
+          edge[0] = e0;
+          edge[1] = e1;
+          dir[k] = (e0 < e1 ? 1 : -1);
+          int edge_num = edge_table->getIndex(edge);
 
-          if (res) {
-            // Get the global edge number
-            int edge_num = res[0];
+          if (edge_num >= 0) {
             c[k] = new_edges[edge_num];
             dir[k] *= edge_dir[edge_num];
           } else {
             fprintf(stderr,
                     "TMRMesh Error: Could not find edge (%d, %d) for hex\n",
-                    edge[1], edge[2]);
+                    edge[0], edge[1]);
           }
         }
 
@@ -2092,18 +4774,18 @@ TMRModel *TMRMesh::createModelFromMesh() {
   }
 
   // Free all of the edge search information
-  delete[] sorted_edges;
-  if (sorted_faces) {
-    delete[] sorted_faces;
+  delete edge_table;
+  if (face_table) {
+    delete face_table;
   }
 
   TMRVolume **new_volumes = NULL;
 
-  if (num_hex > 0) {
+  if (nhex > 0) {
     // Create the new volume array
-    new_volumes = new TMRVolume *[num_hex];
+    new_volumes = new TMRVolume *[nhex];
 
-    for (int i = 0; i < num_hex; i++) {
+    for (int i = 0; i < nhex; i++) {
       // Get the edges
       TMRVertex *v[8];
       TMREdge *e[12];
@@ -2112,15 +4794,15 @@ TMRModel *TMRMesh::createModelFromMesh() {
 
       // Get the vertices
       for (int j = 0; j < 8; j++) {
-        v[j] = new_verts[hex[8 * i + hex_coordinate_order[j]]];
+        v[j] = new_verts[hex_conn[8 * i + hex_coordinate_order[j]]];
       }
 
       // Get the edges and their directions
       for (int j = 0; j < 12; j++) {
         int edge_num = hex_edge_nums[12 * i + j];
         edir[j] = 1;
-        if (hex[8 * i + hex_edge_nodes[j][0]] >
-            hex[8 * i + hex_edge_nodes[j][1]]) {
+        if (hex_conn[8 * i + hex_edge_nodes[j][0]] >
+            hex_conn[8 * i + hex_edge_nodes[j][1]]) {
           edir[j] = -1;
         }
         edir[j] *= edge_dir[edge_num];
@@ -2155,11 +4837,11 @@ TMRModel *TMRMesh::createModelFromMesh() {
   // Create the geometry object
   TMRModel *geo = NULL;
 
-  if (num_hex > 0) {
-    geo = new TMRModel(num_nodes, new_verts, num_mesh_edges, new_edges,
-                       num_mesh_faces, new_faces, num_hex, new_volumes);
+  if (nhex > 0) {
+    geo = new TMRModel(nnodes, new_verts, num_mesh_edges, new_edges,
+                       num_mesh_faces, new_faces, nhex, new_volumes);
   } else {
-    geo = new TMRModel(num_nodes, new_verts, num_mesh_edges, new_edges,
+    geo = new TMRModel(nnodes, new_verts, num_mesh_edges, new_edges,
                        num_mesh_faces, new_faces);
   }
 
@@ -35,6 +35,21 @@ enum TMRFaceMeshType {
   TMR_TRIANGLE
 };
 
+/*
+  The matching algorithm used to recombine triangles into quads.
+
+  The optimal matching is the minimum-weight perfect matching of the
+  entire dual graph. The patch matching partitions the dual graph into
+  spatial patches that are matched independently and then repairs the
+  seams between them. The greedy matching is the fastest but produces
+  lower-quality quads.
+*/
+enum TMRQuadRecombinationType {
+  TMR_OPTIMAL_MATCHING,
+  TMR_PATCH_MATCHING,
+  TMR_GREEDY_MATCHING
+};
+
 /*
   Methods for computing the mesh connectivity and dual connectivity
   information from other data.
@@ -81,9 +96,17 @@ class TMRMeshOptions {
     tri_smoothing_type = TMR_LAPLACIAN;
     frontal_quality_factor = 1.5;
 
+    // Set the default recombination options
+    recombination_type = TMR_OPTIMAL_MATCHING;
+    recombination_patch_size = 20000;
+    greedy_recombination_quality = 0.5;
+
     // By default, reset the mesh objects
     reset_mesh_objects = 1;
 
+    // By default, replicate the mesh on all processors
+    distribute_mesh = 0;
+
     // By default, write nothing to any files
     write_init_domain_triangle = 0;
     write_triangularize_intermediate = 0;
@@ -108,9 +131,18 @@ class TMRMeshOptions {
   TriangleSmoothingType tri_smoothing_type;
   double frontal_quality_factor;
 
+  // Options to control the recombination of triangles into quads
+  TMRQuadRecombinationType recombination_type;
+  int recombination_patch_size;
+  double greedy_recombination_quality;
+
   // Reset the mesh objects in each geometry object
   int reset_mesh_objects;
 
+  // Distribute the volume node locations and the assembled mesh
+  // across the processors instead of replicating them
+  int distribute_mesh;
+
   // Write intermediate surface meshes to file
   int write_init_domain_triangle;
   int write_triangularize_intermediate;
@@ -122,6 +154,31 @@ class TMRMeshOptions {
   int write_quad_dual;
 };
 
+/*
+  The wall-clock times spent in each phase of meshing
+
+  The edge, face and volume times are the times for meshing all of
+  the edges, faces and volumes. The triangulation, recombination and
+  smoothing times are the contributions to the face time from the
+  face meshes computed on this processor.
+*/
+class TMRMeshTimes {
+ public:
+  TMRMeshTimes() {
+    edges = faces = volumes = 0.0;
+    triangulation = recombination = smoothing = 0.0;
+    total = 0.0;
+  }
+
+  double edges;
+  double faces;
+  double triangulation;
+  double recombination;
+  double smoothing;
+  double volumes;
+  double total;
+};
+
 /*
   Mesh the geometry model.
 
@@ -136,32 +193,79 @@ class TMRMesh : public TMREntity {
   TMRMesh(MPI_Comm _comm, TMRModel *_geo);
   ~TMRMesh();
 
-  // Mesh the underlying geometry
-  void mesh(TMRMeshOptions options, double htarget);
-  void mesh(TMRMeshOptions options, TMRElementFeatureSize *fs);
+  // Get the communicator
+  MPI_Comm getMPIComm() { return comm; }
+
+  // Mesh the underlying geometry. When a cache file is provided, the
+  // edge and face meshes from the file are re-used for the unchanged
+  // edges and faces and the file is updated with the new meshes.
+  void mesh(TMRMeshOptions options, double htarget,
+            const char *cache_file = NULL);
+  void mesh(TMRMeshOptions options, TMRElementFeatureSize *fs,
+            const char *cache_file = NULL);
 
   // Write the mesh to a VTK file
   void writeToVTK(const char *filename,
                   int flag = (TMRMesh::TMR_QUAD | TMRMesh::TMR_HEX));
+  void writeToVTU(const char *filename,
+                  int flag = (TMRMesh::TMR_QUAD | TMRMesh::TMR_HEX),
+                  int compress = 0);
 
   // Write the mesh to a BDF file
   void writeToBDF(const char *filename,
                   int flag = (TMRMesh::TMR_QUAD | TMRMesh::TMR_HEX),
                   TMRBoundaryConditions *bcs = NULL);
 
+  // Write the mesh to a compact binary file
+  int writeToBinary(const char *filename,
+                    int flag = (TMRMesh::TMR_QUAD | TMRMesh::TMR_HEX),
+                    TMRBoundaryConditions *bcs = NULL);
+
   // Retrieve the mesh components
   int getMeshPoints(TMRPoint **_X);
   void getQuadConnectivity(int *_nquads, const int **_quads);
   void getTriConnectivity(int *_ntris, const int **_tris);
   void getHexConnectivity(int *_nhex, const int **_hex);
 
+  // Retrieve the ownership of the nodes in a distributed mesh
+  int getNodeRange(const int **_node_range);
+  int getGhostNodes(const int **_ghost_nodes);
+
+  // Report the memory held by the mesh arrays
+  TMRMemoryUsage *getMemoryUsage();
+
+  // Retrieve the times for each phase of the last call to mesh()
+  void getMeshTimes(TMRMeshTimes *_times);
+
   // Create a topology object (with underlying mesh geometry)
   TMRModel *createModelFromMesh();
 
  private:
+  // Mesh the edges and faces in parallel
+  void meshEdges(TMRMeshOptions options, TMRElementFeatureSize *fs);
+  void meshFaces(TMRMeshOptions options, TMRElementFeatureSize *fs);
+
+  // Mesh the volumes in parallel
+  void meshVolumes(TMRMeshOptions options);
+
+  // Read and write the cached edge and face meshes
+  void computeMeshKeys(TMRMeshOptions options, TMRElementFeatureSize *fs,
+                       uint64_t *edge_keys, uint64_t *face_keys);
+  int readMeshCache(const char *filename, TMRMeshOptions options,
+                    TMRElementFeatureSize *fs);
+  int writeMeshCache(const char *filename, TMRMeshOptions options,
+                     TMRElementFeatureSize *fs);
+
   // Allocate and initialize the underlying mesh
   void initMesh(int count_nodes = 0);
 
+  // Number the nodes so that each processor owns a contiguous range
+  void numberNodesByOwner();
+
+  // Allocate and initialize the local part of a distributed mesh
+  void initLocalMesh();
+  void freeLocalMesh();
+
   // Reset the mesh
   void resetMesh();
 
@@ -188,6 +292,78 @@ class TMRMesh : public TMREntity {
   // The number of tetrahedral elements
   int num_tet;
   int *tet;
+
+  // Flag to indicate whether the mesh is distributed
+  int distributed;
+
+  // The processor that owns the nodes of each face and volume mesh
+  int *face_owner, *volume_owner;
+
+  // The range of node numbers owned by each processor
+  int *node_range;
+
+  // The local part of a distributed mesh. The local nodes are the
+  // nodes owned by this processor followed by the ghost nodes, and the
+  // local elements are stored in the local node numbering.
+  int num_ghost_nodes;
+  int *ghost_nodes;
+  TMRPoint *local_X;
+  int num_local_quads, num_local_tris, num_local_hex;
+  int *local_quads, *local_tris, *local_hex;
+
+  // The times for each phase of meshing
+  TMRMeshTimes times;
+};
+
+/*
+  A mesh read from the binary file written by TMRMesh::writeToBinary()
+
+  The file contains the node locations, the quadrilateral and
+  hexahedral connectivity with the part number for each element, and
+  the nodes associated with each named boundary condition. All node
+  numbers are zero-based.
+*/
+class TMRBinaryMesh : public TMREntity {
+ public:
+  TMRBinaryMesh();
+  ~TMRBinaryMesh();
+
+  // Read the mesh from the binary file
+  int readFromFile(const char *filename);
+
+  // Retrieve the mesh components
+  int getMeshPoints(TMRPoint **_X);
+  int getQuadConnectivity(const int **_quads, const int **_quad_parts);
+  int getHexConnectivity(const int **_hex, const int **_hex_parts);
+
+  // Retrieve the boundary conditions and their nodes
+  int getNumBoundaryConditions();
+  void getBoundaryCondition(int bc, const char **_name, int *_num_bcs,
+                            const int **_bc_nums, const double **_bc_vals,
+                            int *_num_bc_nodes, const int **_bc_nodes);
+
+ private:
+  // Free the mesh data
+  void freeData();
+
+  // The node locations
+  int num_nodes;
+  TMRPoint *X;
+
+  // The quadrilateral and hexahedral connectivity and part numbers
+  int num_quads;
+  int *quads, *quad_parts;
+  int num_hex;
+  int *hex, *hex_parts;
+
+  // The boundary condition data
+  int num_bcs;
+  char **bc_names;
+  int *bc_num_nums;
+  int **bc_nums;
+  double **bc_vals;
+  int *bc_num_nodes;
+  int **bc_nodes;
 };
 
 #endif  // TMR_MESH_H
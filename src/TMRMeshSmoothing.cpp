@@ -45,6 +45,29 @@ inline void addParamMovement(double alpha, TMRPoint *Xu, TMRPoint *Xv,
   delta[1] += invdet * (g11 * b2 - g12 * b1);
 }
 
+/*
+  Compute the length of each edge
+*/
+static void TMR_ComputeEdgeLengths(int num_edges, const int *edge_list,
+                                   const TMRPoint *p, double *len) {
+#ifdef TMR_HAS_OPENMP
+#pragma omp parallel for
+#endif  // TMR_HAS_OPENMP
+  for (int i = 0; i < num_edges; i++) {
+    int n1 = edge_list[2 * i];
+    int n2 = edge_list[2 * i + 1];
+
+    // Compute the difference between the points along the
+    // specified edge
+    TMRPoint d;
+    d.x = p[n2].x - p[n1].x;
+    d.y = p[n2].y - p[n1].y;
+    d.z = p[n2].z - p[n1].z;
+
+    len[i] = sqrt(d.dot(d));
+  }
+}
+
 /*
   Apply Laplacian smoothing
 */
@@ -61,6 +84,9 @@ void TMR_LaplacianSmoothing(int nsmooth, int num_fixed_pts, int num_edges,
     memset(new_params, 0, 2 * num_pts * sizeof(double));
 
     // Evaluate the derivatives w.r.t. the parameter locations
+#ifdef TMR_HAS_OPENMP
+#pragma omp parallel for
+#endif  // TMR_HAS_OPENMP
     for (int i = num_fixed_pts; i < num_pts; i++) {
       TMRPoint X;
       face->evalDeriv(prm[2 * i], prm[2 * i + 1], &X, &Xu[i], &Xv[i]);
@@ -92,6 +118,9 @@ void TMR_LaplacianSmoothing(int nsmooth, int num_fixed_pts, int num_edges,
     }
 
     // Set the locations for the new points, keep in place
+#ifdef TMR_HAS_OPENMP
+#pragma omp parallel for
+#endif  // TMR_HAS_OPENMP
     for (int i = num_fixed_pts; i < num_pts; i++) {
       if (count[i] > 0) {
         prm[2 * i] += new_params[2 * i] / count[i];
@@ -119,24 +148,17 @@ void TMR_SpringSmoothing(int nsmooth, double alpha, int num_fixed_pts,
   TMRPoint *Xv = new TMRPoint[num_pts];
 
   for (int iter = 0; iter < nsmooth; iter++) {
+    TMR_ComputeEdgeLengths(num_edges, edge_list, p, len);
     double sum = 0.0;
     for (int i = 0; i < num_edges; i++) {
-      int n1 = edge_list[2 * i];
-      int n2 = edge_list[2 * i + 1];
-
-      // Compute the difference between the points along the
-      // specified edge
-      TMRPoint d;
-      d.x = p[n2].x - p[n1].x;
-      d.y = p[n2].y - p[n1].y;
-      d.z = p[n2].z - p[n1].z;
-
-      len[i] = sqrt(d.dot(d));
       sum += len[i];
     }
     double len0 = 0.9 * sum / num_edges;
 
     // Evaluate the derivatives w.r.t. the parameter locations
+#ifdef TMR_HAS_OPENMP
+#pragma omp parallel for
+#endif  // TMR_HAS_OPENMP
     for (int i = num_fixed_pts; i < num_pts; i++) {
       TMRPoint X;
       face->evalDeriv(prm[2 * i], prm[2 * i + 1], &X, &Xu[i], &Xv[i]);
@@ -169,6 +191,9 @@ void TMR_SpringSmoothing(int nsmooth, double alpha, int num_fixed_pts,
     }
 
     // Set the locations for the new points, keep in place
+#ifdef TMR_HAS_OPENMP
+#pragma omp parallel for
+#endif  // TMR_HAS_OPENMP
     for (int i = num_fixed_pts; i < num_pts; i++) {
       prm[2 * i] += alpha * new_params[2 * i];
       prm[2 * i + 1] += alpha * new_params[2 * i + 1];
@@ -202,24 +227,17 @@ void TMR_SpringQuadSmoothing(int nsmooth, double alpha, int num_fixed_pts,
   const double sqrt2 = 1.1 * sqrt(2.0);
 
   for (int iter = 0; iter < nsmooth; iter++) {
+    TMR_ComputeEdgeLengths(num_edges, edge_list, p, len);
     double sum = 0.0;
     for (int i = 0; i < num_edges; i++) {
-      int n1 = edge_list[2 * i];
-      int n2 = edge_list[2 * i + 1];
-
-      // Compute the difference between the points along the
-      // specified edge
-      TMRPoint d;
-      d.x = p[n2].x - p[n1].x;
-      d.y = p[n2].y - p[n1].y;
-      d.z = p[n2].z - p[n1].z;
-
-      len[i] = sqrt(d.dot(d));
       sum += len[i];
     }
     double len0 = sum / num_edges;
 
     // Evaluate the derivatives w.r.t. the parameter locations
+#ifdef TMR_HAS_OPENMP
+#pragma omp parallel for
+#endif  // TMR_HAS_OPENMP
     for (int i = num_fixed_pts; i < num_pts; i++) {
       TMRPoint X;
       face->evalDeriv(prm[2 * i], prm[2 * i + 1], &X, &Xu[i], &Xv[i]);
@@ -287,6 +305,9 @@ void TMR_SpringQuadSmoothing(int nsmooth, double alpha, int num_fixed_pts,
     }
 
     // Set the locations for the new points, keep in place
+#ifdef TMR_HAS_OPENMP
+#pragma omp parallel for
+#endif  // TMR_HAS_OPENMP
     for (int i = num_fixed_pts; i < num_pts; i++) {
       prm[2 * i] += alpha * new_params[2 * i];
       prm[2 * i + 1] += alpha * new_params[2 * i + 1];
@@ -301,12 +322,188 @@ void TMR_SpringQuadSmoothing(int nsmooth, double alpha, int num_fixed_pts,
 }
 
 /*
-  Smooth the mesh
+  Apply the smoothing update to a single point of the quadrilateral
+  mesh. This only modifies the parameters and location of point i.
 */
-void TMR_QuadSmoothing(int nsmooth, int num_fixed_pts, int num_pts,
-                       const int *ptr, const int *pts_to_quads, int num_quads,
-                       const int *quads, double *prm, TMRPoint *p,
-                       TMRFace *face) {
+static void TMR_QuadSmoothPoint(int i, const int *ptr,
+                                const int *pts_to_quads, const int *quads,
+                                double *prm, TMRPoint *p, TMRFace *face) {
+  int N = ptr[i + 1] - ptr[i];
+
+  // Evaluate the derivatives w.r.t. the parameter locations so
+  // that we can take movement in the physical plane and convert
+  // it to movement in the parametric coordinates
+  TMRPoint X, Xu, Xv;
+  face->evalDeriv(prm[2 * i], prm[2 * i + 1], &X, &Xu, &Xv);
+
+  // Normalize the directions Xu, Xv to form a locally-orthonormal
+  // coordinate frame aligned with the surface
+  TMRPoint xdir, ydir;
+
+  // Normalize the x-direction
+  double xnorm = sqrt(Xu.dot(Xu));
+  xdir.x = Xu.x / xnorm;
+  xdir.y = Xu.y / xnorm;
+  xdir.z = Xu.z / xnorm;
+
+  // Remove the component of the x-direction from Xv
+  double dot = xdir.dot(Xv);
+  ydir.x = Xv.x - dot * xdir.x;
+  ydir.y = Xv.y - dot * xdir.y;
+  ydir.z = Xv.z - dot * xdir.z;
+
+  double ynorm = sqrt(ydir.dot(ydir));
+  ydir.x = ydir.x / ynorm;
+  ydir.y = ydir.y / ynorm;
+  ydir.z = ydir.z / ynorm;
+
+  if (N > 0) {
+    // Loop over the quadrilaterals that reference this point
+    double A = 0.0, B = 0.0;
+    for (int qp = ptr[i]; qp < ptr[i + 1]; qp++) {
+      const int *quad = &quads[4 * pts_to_quads[qp]];
+
+      // Pick out the influence triangle points from the quadrilateral
+      // This consists of the base point i and the following two
+      int ijk[3];
+      if (quad[0] == i) {
+        ijk[0] = quad[0];
+        ijk[1] = quad[1];
+        ijk[2] = quad[3];
+      } else if (quad[1] == i) {
+        ijk[0] = quad[1];
+        ijk[1] = quad[2];
+        ijk[2] = quad[0];
+      } else if (quad[2] == i) {
+        ijk[0] = quad[2];
+        ijk[1] = quad[3];
+        ijk[2] = quad[1];
+      } else {
+        ijk[0] = quad[3];
+        ijk[1] = quad[0];
+        ijk[2] = quad[2];
+      }
+
+      // Now compute the geometric quantities
+      // p = yj - yk, q = xk - xj
+      double xi = xdir.dot(p[ijk[0]]);
+      double yi = ydir.dot(p[ijk[0]]);
+      double xj = xdir.dot(p[ijk[1]]);
+      double yj = ydir.dot(p[ijk[1]]);
+      double xk = xdir.dot(p[ijk[2]]);
+      double yk = ydir.dot(p[ijk[2]]);
+      double p = yj - yk;
+      double q = xk - xj;
+      double r = xj * yk - xk * yj;
+      double a = 0.5 * (p * xi + q * yi + r);
+      double b = sqrt(p * p + q * q);
+      A += a;
+      B += b;
+    }
+
+    double hbar = 2.0 * A / B;
+    double bbar = B / N;
+
+    // Set the weights
+    double w1 = 1.0 / (hbar * hbar);
+    double w2 = 4.0 / (bbar * bbar);
+
+    // The parameters for the Jacobian/right-hand-side
+    double s1 = 0.0, s2 = 0.0, s3 = 0.0, s4 = 0.0, s5 = 0.0;
+
+    for (int qp = ptr[i]; qp < ptr[i + 1]; qp++) {
+      const int *quad = &quads[4 * pts_to_quads[qp]];
+
+      // Pick out the influence triangle points from the quadrilateral
+      // This consists of the base point i and the following two
+      int ijk[3];
+      if (quad[0] == i) {
+        ijk[0] = quad[0];
+        ijk[1] = quad[1];
+        ijk[2] = quad[3];
+      } else if (quad[1] == i) {
+        ijk[0] = quad[1];
+        ijk[1] = quad[2];
+        ijk[2] = quad[0];
+      } else if (quad[2] == i) {
+        ijk[0] = quad[2];
+        ijk[1] = quad[3];
+        ijk[2] = quad[1];
+      } else {
+        ijk[0] = quad[3];
+        ijk[1] = quad[0];
+        ijk[2] = quad[2];
+      }
+
+      // Now compute the geometric quantities
+      // p = yj - yk, q = xk - xj
+      double xi = xdir.dot(p[ijk[0]]);
+      double yi = ydir.dot(p[ijk[0]]);
+      double xj = xdir.dot(p[ijk[1]]);
+      double yj = ydir.dot(p[ijk[1]]);
+      double xk = xdir.dot(p[ijk[2]]);
+      double yk = ydir.dot(p[ijk[2]]);
+      double p = yj - yk;
+      double q = xk - xj;
+      double r = xj * yk - xk * yj;
+      double a = 0.5 * (p * xi + q * yi + r);
+      double b = sqrt(p * p + q * q);
+
+      // Other quantities derived from the in-plane triangle data
+      double xm = 0.5 * (xj + xk);
+      double ym = 0.5 * (yj + yk);
+      double binv2 = 1.0 / (b * b);
+
+      // Sum up the contributions to the s terms
+      s1 += binv2 * (w1 * p * p + w2 * q * q);
+      s2 += binv2 * p * q * (w1 - w2);
+      s3 += binv2 * (w1 * p * (hbar * b - 2 * a) -
+                     w2 * q * ((xi - xm) * q - (yi - ym) * p));
+      s4 += binv2 * (w1 * q * q + w2 * p * p);
+      s5 += binv2 * (w1 * q * (hbar * b - 2 * a) -
+                     w2 * p * ((yi - ym) * p - (xi - xm) * q));
+    }
+
+    // Compute the updates in the physical plane
+    double det = s1 * s4 - s2 * s2;
+    double lx = 0.0, ly = 0.0;
+    if (det != 0.0) {
+      det = 1.0 / det;
+      lx = det * (s3 * s4 - s2 * s5);
+      ly = det * (s1 * s5 - s2 * s3);
+    }
+
+    // Check that the requested move direction is well-defined
+    if (lx == lx && ly == ly) {
+      // Add up the displacements along the local coordinate directions
+      TMRPoint dir;
+      dir.x = lx * xdir.x + ly * ydir.x;
+      dir.y = lx * xdir.y + ly * ydir.y;
+      dir.z = lx * xdir.z + ly * ydir.z;
+
+      // Add the parameter movement along the specified direction
+      // and compute the update
+      addParamMovement(1.0, &Xu, &Xv, &dir, &prm[2 * i]);
+      face->evalPoint(prm[2 * i], prm[2 * i + 1], &p[i]);
+    }
+  }
+}
+
+/*
+  Color the free points so that no two points of the same color are
+  contained in the same quadrilateral. Points with the same color can
+  then be smoothed concurrently.
+
+  The points are returned in the order that they are smoothed, sorted
+  by degree and then by color, with one range for each degree/color
+  pair.
+*/
+static void TMR_ColorQuadPoints(int num_fixed_pts, int num_pts,
+                                const int *ptr, const int *pts_to_quads,
+                                const int *quads, int *_num_ranges,
+                                int **_range_ptr, int **_order) {
+  int num_free = num_pts - num_fixed_pts;
+
   // Compute the min/max degree
   int min_degree = 0;
   int max_degree = 0;
@@ -324,171 +521,99 @@ void TMR_QuadSmoothing(int nsmooth, int num_fixed_pts, int num_pts,
     }
   }
 
-  for (int iter = 0; iter < nsmooth; iter++) {
-    for (int degree = min_degree; degree <= max_degree; degree++) {
-      for (int i = num_fixed_pts; i < num_pts; i++) {
-        int N = ptr[i + 1] - ptr[i];
-
-        if (N == degree) {
-          // Evaluate the derivatives w.r.t. the parameter locations so
-          // that we can take movement in the physical plane and convert
-          // it to movement in the parametric coordinates
-          TMRPoint X, Xu, Xv;
-          face->evalDeriv(prm[2 * i], prm[2 * i + 1], &X, &Xu, &Xv);
-
-          // Normalize the directions Xu, Xv to form a locally-orthonormal
-          // coordinate frame aligned with the surface
-          TMRPoint xdir, ydir;
-
-          // Normalize the x-direction
-          double xnorm = sqrt(Xu.dot(Xu));
-          xdir.x = Xu.x / xnorm;
-          xdir.y = Xu.y / xnorm;
-          xdir.z = Xu.z / xnorm;
-
-          // Remove the component of the x-direction from Xv
-          double dot = xdir.dot(Xv);
-          ydir.x = Xv.x - dot * xdir.x;
-          ydir.y = Xv.y - dot * xdir.y;
-          ydir.z = Xv.z - dot * xdir.z;
-
-          double ynorm = sqrt(ydir.dot(ydir));
-          ydir.x = ydir.x / ynorm;
-          ydir.y = ydir.y / ynorm;
-          ydir.z = ydir.z / ynorm;
-
-          if (N > 0) {
-            // Loop over the quadrilaterals that reference this point
-            double A = 0.0, B = 0.0;
-            for (int qp = ptr[i]; qp < ptr[i + 1]; qp++) {
-              const int *quad = &quads[4 * pts_to_quads[qp]];
-
-              // Pick out the influence triangle points from the quadrilateral
-              // This consists of the base point i and the following two
-              int ijk[3];
-              if (quad[0] == i) {
-                ijk[0] = quad[0];
-                ijk[1] = quad[1];
-                ijk[2] = quad[3];
-              } else if (quad[1] == i) {
-                ijk[0] = quad[1];
-                ijk[1] = quad[2];
-                ijk[2] = quad[0];
-              } else if (quad[2] == i) {
-                ijk[0] = quad[2];
-                ijk[1] = quad[3];
-                ijk[2] = quad[1];
-              } else {
-                ijk[0] = quad[3];
-                ijk[1] = quad[0];
-                ijk[2] = quad[2];
-              }
-
-              // Now compute the geometric quantities
-              // p = yj - yk, q = xk - xj
-              double xi = xdir.dot(p[ijk[0]]);
-              double yi = ydir.dot(p[ijk[0]]);
-              double xj = xdir.dot(p[ijk[1]]);
-              double yj = ydir.dot(p[ijk[1]]);
-              double xk = xdir.dot(p[ijk[2]]);
-              double yk = ydir.dot(p[ijk[2]]);
-              double p = yj - yk;
-              double q = xk - xj;
-              double r = xj * yk - xk * yj;
-              double a = 0.5 * (p * xi + q * yi + r);
-              double b = sqrt(p * p + q * q);
-              A += a;
-              B += b;
-            }
-
-            double hbar = 2.0 * A / B;
-            double bbar = B / N;
-
-            // Set the weights
-            double w1 = 1.0 / (hbar * hbar);
-            double w2 = 4.0 / (bbar * bbar);
-
-            // The parameters for the Jacobian/right-hand-side
-            double s1 = 0.0, s2 = 0.0, s3 = 0.0, s4 = 0.0, s5 = 0.0;
-
-            for (int qp = ptr[i]; qp < ptr[i + 1]; qp++) {
-              const int *quad = &quads[4 * pts_to_quads[qp]];
-
-              // Pick out the influence triangle points from the quadrilateral
-              // This consists of the base point i and the following two
-              int ijk[3];
-              if (quad[0] == i) {
-                ijk[0] = quad[0];
-                ijk[1] = quad[1];
-                ijk[2] = quad[3];
-              } else if (quad[1] == i) {
-                ijk[0] = quad[1];
-                ijk[1] = quad[2];
-                ijk[2] = quad[0];
-              } else if (quad[2] == i) {
-                ijk[0] = quad[2];
-                ijk[1] = quad[3];
-                ijk[2] = quad[1];
-              } else {
-                ijk[0] = quad[3];
-                ijk[1] = quad[0];
-                ijk[2] = quad[2];
-              }
-
-              // Now compute the geometric quantities
-              // p = yj - yk, q = xk - xj
-              double xi = xdir.dot(p[ijk[0]]);
-              double yi = ydir.dot(p[ijk[0]]);
-              double xj = xdir.dot(p[ijk[1]]);
-              double yj = ydir.dot(p[ijk[1]]);
-              double xk = xdir.dot(p[ijk[2]]);
-              double yk = ydir.dot(p[ijk[2]]);
-              double p = yj - yk;
-              double q = xk - xj;
-              double r = xj * yk - xk * yj;
-              double a = 0.5 * (p * xi + q * yi + r);
-              double b = sqrt(p * p + q * q);
-
-              // Other quantities derived from the in-plane triangle data
-              double xm = 0.5 * (xj + xk);
-              double ym = 0.5 * (yj + yk);
-              double binv2 = 1.0 / (b * b);
-
-              // Sum up the contributions to the s terms
-              s1 += binv2 * (w1 * p * p + w2 * q * q);
-              s2 += binv2 * p * q * (w1 - w2);
-              s3 += binv2 * (w1 * p * (hbar * b - 2 * a) -
-                             w2 * q * ((xi - xm) * q - (yi - ym) * p));
-              s4 += binv2 * (w1 * q * q + w2 * p * p);
-              s5 += binv2 * (w1 * q * (hbar * b - 2 * a) -
-                             w2 * p * ((yi - ym) * p - (xi - xm) * q));
-            }
-
-            // Compute the updates in the physical plane
-            double det = s1 * s4 - s2 * s2;
-            double lx = 0.0, ly = 0.0;
-            if (det != 0.0) {
-              det = 1.0 / det;
-              lx = det * (s3 * s4 - s2 * s5);
-              ly = det * (s1 * s5 - s2 * s3);
-            }
-
-            // Check that the requested move direction is well-defined
-            if (lx == lx && ly == ly) {
-              // Add up the displacements along the local coordinate directions
-              TMRPoint dir;
-              dir.x = lx * xdir.x + ly * ydir.x;
-              dir.y = lx * xdir.y + ly * ydir.y;
-              dir.z = lx * xdir.z + ly * ydir.z;
-
-              // Add the parameter movement along the specified direction
-              // and compute the update
-              addParamMovement(1.0, &Xu, &Xv, &dir, &prm[2 * i]);
-              face->evalPoint(prm[2 * i], prm[2 * i + 1], &p[i]);
-            }
-          }
+  // Greedily color the points. Each point has at most 3 neighbors
+  // through each quadrilateral.
+  int max_colors = 3 * max_degree + 1;
+  int num_colors = 0;
+  int *color = new int[num_pts];
+  int *used = new int[max_colors];
+  for (int c = 0; c < max_colors; c++) {
+    used[c] = -1;
+  }
+  for (int i = 0; i < num_pts; i++) {
+    color[i] = -1;
+  }
+  for (int i = num_fixed_pts; i < num_pts; i++) {
+    for (int qp = ptr[i]; qp < ptr[i + 1]; qp++) {
+      const int *quad = &quads[4 * pts_to_quads[qp]];
+      for (int k = 0; k < 4; k++) {
+        if (quad[k] != i && color[quad[k]] >= 0) {
+          used[color[quad[k]]] = i;
         }
       }
     }
+    int c = 0;
+    while (used[c] == i) {
+      c++;
+    }
+    color[i] = c;
+    if (c + 1 > num_colors) {
+      num_colors = c + 1;
+    }
+  }
+  delete[] used;
+
+  // Sort the points by degree and color
+  int num_ranges = (max_degree - min_degree + 1) * num_colors;
+  if (num_free == 0) {
+    num_ranges = 0;
+  }
+  int *range_ptr = new int[num_ranges + 1];
+  memset(range_ptr, 0, (num_ranges + 1) * sizeof(int));
+  for (int i = num_fixed_pts; i < num_pts; i++) {
+    int N = ptr[i + 1] - ptr[i];
+    range_ptr[(N - min_degree) * num_colors + color[i] + 1]++;
+  }
+  for (int k = 0; k < num_ranges; k++) {
+    range_ptr[k + 1] += range_ptr[k];
+  }
+
+  int *order = new int[num_free];
+  for (int i = num_fixed_pts; i < num_pts; i++) {
+    int N = ptr[i + 1] - ptr[i];
+    int k = (N - min_degree) * num_colors + color[i];
+    order[range_ptr[k]] = i;
+    range_ptr[k]++;
+  }
+  for (int k = num_ranges; k > 0; k--) {
+    range_ptr[k] = range_ptr[k - 1];
+  }
+  range_ptr[0] = 0;
+
+  delete[] color;
+
+  *_num_ranges = num_ranges;
+  *_range_ptr = range_ptr;
+  *_order = order;
+}
+
+/*
+  Smooth the mesh
+
+  The points are smoothed in order of increasing degree, as in a
+  Gauss-Seidel sweep. Within each degree, the points are smoothed
+  one color at a time so that the points of each color can be
+  updated concurrently without changing the result.
+*/
+void TMR_QuadSmoothing(int nsmooth, int num_fixed_pts, int num_pts,
+                       const int *ptr, const int *pts_to_quads, int num_quads,
+                       const int *quads, double *prm, TMRPoint *p,
+                       TMRFace *face) {
+  int num_ranges, *range_ptr, *order;
+  TMR_ColorQuadPoints(num_fixed_pts, num_pts, ptr, pts_to_quads, quads,
+                      &num_ranges, &range_ptr, &order);
+
+  for (int iter = 0; iter < nsmooth; iter++) {
+    for (int k = 0; k < num_ranges; k++) {
+#ifdef TMR_HAS_OPENMP
+#pragma omp parallel for
+#endif  // TMR_HAS_OPENMP
+      for (int j = range_ptr[k]; j < range_ptr[k + 1]; j++) {
+        TMR_QuadSmoothPoint(order[j], ptr, pts_to_quads, quads, prm, p, face);
+      }
+    }
   }
+
+  delete[] range_ptr;
+  delete[] order;
 }
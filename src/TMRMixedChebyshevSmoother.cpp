@@ -0,0 +1,408 @@
+/*
+  This file is part of the package TMR for adaptive mesh refinement.
+
+  Copyright (C) 2015 Georgia Tech Research Corporation.
+  Additional copyright (C) 2015 Graeme Kennedy.
+  All rights reserved.
+
+  TMR is licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this software except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include "TMRMixedChebyshevSmoother.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "tmrlapack.h"
+
+// The number of power iterations used to estimate the spectrum
+static const int TMR_CHEBYSHEV_POWER_ITERS = 10;
+
+/*
+  Create the single precision Chebyshev smoother
+
+  input:
+  assembler:  the assembler object for the matrix
+  mat:        the matrix
+  degree:     the degree of the Chebyshev polynomial
+  lower:      the lower bound of the interval relative to the estimate
+  upper:      the upper bound of the interval relative to the estimate
+  iters:      the number of smoothing iterations
+*/
+TMRMixedChebyshevSmoother::TMRMixedChebyshevSmoother(
+    TACSAssembler *assembler, TACSParallelMat *_mat, int _degree,
+    double _lower, double _upper, int _iters) {
+  comm = assembler->getMPIComm();
+
+#ifdef TACS_USE_COMPLEX
+  // The matrix and vectors are copied to real single precision values,
+  // so the imaginary parts would be lost
+  int mpi_rank;
+  MPI_Comm_rank(comm, &mpi_rank);
+  if (mpi_rank == 0) {
+    fprintf(stderr,
+            "TMRMixedChebyshevSmoother Warning: The smoother is real-valued "
+            "and discards the imaginary parts in complex builds\n");
+  }
+#endif  // TACS_USE_COMPLEX
+  mat = _mat;
+  mat->incref();
+
+  degree = (_degree < 1 ? 1 : _degree);
+  iters = (_iters < 1 ? 1 : _iters);
+  lower = _lower;
+  upper = _upper;
+  rho = 1.0;
+
+  mat->getRowMap(&bsize, &nrows, &ncoupling);
+  mat->getBCSRMat(&Aloc, &Bext);
+  Aloc->incref();
+  Bext->incref();
+
+  // Allocate space for the single precision matrix values
+  const int b2 = bsize * bsize;
+  const int *rowp, *cols;
+  TacsScalar *vals;
+  Aloc->getArrays(NULL, NULL, NULL, &rowp, &cols, &vals);
+  Avals = new float[b2 * rowp[nrows] + 1];
+
+  const int *browp, *bcols;
+  Bext->getArrays(NULL, NULL, &next, &browp, &bcols, &vals);
+  Bvals = new float[b2 * browp[ncoupling] + 1];
+  Dinv = new float[b2 * nrows + 1];
+
+  mat->getExtColMap(&ext_dist);
+  ext_dist->incref();
+  ctx = ext_dist->createCtx(bsize);
+  ctx->incref();
+
+  // Allocate the vectors
+  const int size = bsize * nrows;
+  xd = new TacsScalar[size + 1];
+  x_ext = new TacsScalar[bsize * next + 1];
+  r = new float[size + 1];
+  d = new float[size + 1];
+  y = new float[size + 1];
+  t = new float[size + 1];
+}
+
+/*
+  Free the smoother
+*/
+TMRMixedChebyshevSmoother::~TMRMixedChebyshevSmoother() {
+  mat->decref();
+  Aloc->decref();
+  Bext->decref();
+  ctx->decref();
+  ext_dist->decref();
+  delete[] Avals;
+  delete[] Bvals;
+  delete[] Dinv;
+  delete[] xd;
+  delete[] x_ext;
+  delete[] r;
+  delete[] d;
+  delete[] y;
+  delete[] t;
+}
+
+/*
+  Copy the matrix values to single precision, invert the block
+  diagonal and estimate the largest eigenvalue of D^{-1}*A
+*/
+void TMRMixedChebyshevSmoother::factor() {
+  const int b2 = bsize * bsize;
+
+  const int *rowp, *cols;
+  TacsScalar *vals;
+  Aloc->getArrays(NULL, NULL, NULL, &rowp, &cols, &vals);
+  for (int i = 0; i < b2 * rowp[nrows]; i++) {
+    Avals[i] = TacsRealPart(vals[i]);
+  }
+
+  const int *browp, *bcols;
+  Bext->getArrays(NULL, NULL, NULL, &browp, &bcols, &vals);
+  for (int i = 0; i < b2 * browp[ncoupling]; i++) {
+    Bvals[i] = TacsRealPart(vals[i]);
+  }
+
+  // Invert the diagonal blocks in double precision. The blocks are
+  // stored in row-major order, so they are factored as the transpose
+  // and the inverse is returned in row-major order.
+  Aloc->getArrays(NULL, NULL, NULL, NULL, NULL, &vals);
+  double *A = new double[b2];
+  double *Ainv = new double[b2];
+  int *ipiv = new int[bsize];
+  int nfail = 0;
+  for (int i = 0; i < nrows; i++) {
+    memset(Ainv, 0, b2 * sizeof(double));
+    for (int k = 0; k < bsize; k++) {
+      Ainv[(bsize + 1) * k] = 1.0;
+    }
+
+    int info = 1;
+    for (int jp = rowp[i]; jp < rowp[i + 1]; jp++) {
+      if (cols[jp] == i) {
+        for (int k = 0; k < b2; k++) {
+          A[k] = TacsRealPart(vals[b2 * jp + k]);
+        }
+        int n = bsize;
+        TmrLAPACKdgetrf(&n, &n, A, &n, ipiv, &info);
+        if (info == 0) {
+          TmrLAPACKdgetrs("N", &n, &n, A, &n, ipiv, Ainv, &n, &info);
+        }
+        break;
+      }
+    }
+
+    // Use the identity when the diagonal block is missing or singular
+    if (info != 0) {
+      nfail++;
+      memset(Ainv, 0, b2 * sizeof(double));
+      for (int k = 0; k < bsize; k++) {
+        Ainv[(bsize + 1) * k] = 1.0;
+      }
+    }
+    for (int k = 0; k < b2; k++) {
+      Dinv[b2 * i + k] = Ainv[k];
+    }
+  }
+  delete[] A;
+  delete[] Ainv;
+  delete[] ipiv;
+
+  if (nfail > 0) {
+    fprintf(stderr,
+            "TMRMixedChebyshevSmoother Warning: %d singular diagonal "
+            "blocks\n",
+            nfail);
+  }
+
+  rho = estimateMaxEigenvalue(TMR_CHEBYSHEV_POWER_ITERS);
+}
+
+/*
+  Compute y = A*x in single precision
+
+  The ghost values are exchanged in double precision while the
+  product with the local part of the matrix is computed.
+*/
+void TMRMixedChebyshevSmoother::mult(const float *xf, float *yf) {
+  const int b2 = bsize * bsize;
+  const int size = bsize * nrows;
+  for (int i = 0; i < size; i++) {
+    xd[i] = xf[i];
+  }
+  ext_dist->beginForward(ctx, xd, x_ext);
+
+  const int *rowp, *cols;
+  Aloc->getArrays(NULL, NULL, NULL, &rowp, &cols, NULL);
+
+#ifdef TMR_HAS_OPENMP
+#pragma omp parallel for
+#endif  // TMR_HAS_OPENMP
+  for (int i = 0; i < nrows; i++) {
+    float *yi = &yf[bsize * i];
+    for (int ii = 0; ii < bsize; ii++) {
+      yi[ii] = 0.0f;
+    }
+    for (int jp = rowp[i]; jp < rowp[i + 1]; jp++) {
+      const float *a = &Avals[b2 * jp];
+      const float *xj = &xf[bsize * cols[jp]];
+      for (int ii = 0; ii < bsize; ii++) {
+        float val = 0.0f;
+        for (int jj = 0; jj < bsize; jj++) {
+          val += a[bsize * ii + jj] * xj[jj];
+        }
+        yi[ii] += val;
+      }
+    }
+  }
+
+  ext_dist->endForward(ctx, xd, x_ext);
+
+  // Add the contributions from the external columns
+  const int *browp, *bcols;
+  Bext->getArrays(NULL, NULL, NULL, &browp, &bcols, NULL);
+  const int np = nrows - ncoupling;
+
+#ifdef TMR_HAS_OPENMP
+#pragma omp parallel for
+#endif  // TMR_HAS_OPENMP
+  for (int ib = 0; ib < ncoupling; ib++) {
+    float *yi = &yf[bsize * (np + ib)];
+    for (int jp = browp[ib]; jp < browp[ib + 1]; jp++) {
+      const float *b = &Bvals[b2 * jp];
+      const TacsScalar *xj = &x_ext[bsize * bcols[jp]];
+      for (int ii = 0; ii < bsize; ii++) {
+        float val = 0.0f;
+        for (int jj = 0; jj < bsize; jj++) {
+          val += b[bsize * ii + jj] * (float)TacsRealPart(xj[jj]);
+        }
+        yi[ii] += val;
+      }
+    }
+  }
+}
+
+/*
+  Compute y = D^{-1}*x in single precision
+*/
+void TMRMixedChebyshevSmoother::applyDiagInv(const float *xf, float *yf) {
+  const int b2 = bsize * bsize;
+
+#ifdef TMR_HAS_OPENMP
+#pragma omp parallel for
+#endif  // TMR_HAS_OPENMP
+  for (int i = 0; i < nrows; i++) {
+    const float *dinv = &Dinv[b2 * i];
+    const float *xi = &xf[bsize * i];
+    float *yi = &yf[bsize * i];
+    for (int ii = 0; ii < bsize; ii++) {
+      float val = 0.0f;
+      for (int jj = 0; jj < bsize; jj++) {
+        val += dinv[bsize * ii + jj] * xi[jj];
+      }
+      yi[ii] = val;
+    }
+  }
+}
+
+/*
+  Estimate the largest eigenvalue of D^{-1}*A with the power method
+
+  The norms are accumulated in double precision.
+*/
+double TMRMixedChebyshevSmoother::estimateMaxEigenvalue(int num_iters) {
+  const int size = bsize * nrows;
+
+  // Use a deterministic starting vector that is not aligned with the
+  // smooth modes of the matrix
+  for (int i = 0; i < size; i++) {
+    d[i] = 1.0f + 0.5f * (float)((7 * i) % 11) / 11.0f;
+  }
+
+  double lambda = 1.0;
+  for (int iter = 0; iter < num_iters; iter++) {
+    double local[2] = {0.0, 0.0}, global[2];
+    for (int i = 0; i < size; i++) {
+      local[0] += (double)d[i] * d[i];
+    }
+
+    mult(d, t);
+    applyDiagInv(t, r);
+    for (int i = 0; i < size; i++) {
+      local[1] += (double)r[i] * r[i];
+    }
+    MPI_Allreduce(local, global, 2, MPI_DOUBLE, MPI_SUM, comm);
+    if (global[0] <= 0.0 || global[1] <= 0.0) {
+      break;
+    }
+    lambda = sqrt(global[1] / global[0]);
+
+    float scale = (float)(1.0 / sqrt(global[1]));
+    for (int i = 0; i < size; i++) {
+      d[i] = scale * r[i];
+    }
+  }
+
+  return lambda;
+}
+
+/*
+  Apply the Chebyshev smoother with a zero initial guess
+
+  The polynomial is applied with the three-term recurrence
+
+  d = D^{-1}*r/theta
+  for k in range(degree):
+  .   y = y + d
+  .   r = r - A*d
+  .   rho_k = 1/(2*sigma - rho_{k-1})
+  .   d = rho_k*rho_{k-1}*d + 2*rho_k/delta*D^{-1}*r
+
+  where theta and delta are the center and half-width of the interval.
+*/
+void TMRMixedChebyshevSmoother::applyFactor(TACSVec *xvec, TACSVec *yvec) {
+  TACSBVec *x = dynamic_cast<TACSBVec *>(xvec);
+  TACSBVec *yv = dynamic_cast<TACSBVec *>(yvec);
+  if (!x || !yv) {
+    fprintf(stderr,
+            "TMRMixedChebyshevSmoother Error: Vector type must be "
+            "TACSBVec\n");
+    return;
+  }
+
+  TacsScalar *xvals, *yvals;
+  int size = x->getArray(&xvals);
+  yv->getArray(&yvals);
+
+  const double a = lower * rho, b = upper * rho;
+  const double theta = 0.5 * (b + a), delta = 0.5 * (b - a);
+  const double sigma = theta / delta;
+
+  for (int i = 0; i < size; i++) {
+    y[i] = 0.0f;
+    r[i] = TacsRealPart(xvals[i]);
+  }
+
+  for (int iter = 0; iter < iters; iter++) {
+    if (iter > 0) {
+      // Compute the residual r = x - A*y
+      mult(y, t);
+      for (int i = 0; i < size; i++) {
+        r[i] = TacsRealPart(xvals[i]) - t[i];
+      }
+    }
+
+    applyDiagInv(r, d);
+    float scale = (float)(1.0 / theta);
+    for (int i = 0; i < size; i++) {
+      d[i] *= scale;
+    }
+
+    double rho_prev = 1.0 / sigma;
+    for (int k = 0; k < degree; k++) {
+      for (int i = 0; i < size; i++) {
+        y[i] += d[i];
+      }
+      if (k == degree - 1) {
+        break;
+      }
+
+      mult(d, t);
+      for (int i = 0; i < size; i++) {
+        r[i] -= t[i];
+      }
+
+      double rho_next = 1.0 / (2.0 * sigma - rho_prev);
+      float c1 = (float)(rho_next * rho_prev);
+      float c2 = (float)(2.0 * rho_next / delta);
+      applyDiagInv(r, t);
+      for (int i = 0; i < size; i++) {
+        d[i] = c1 * d[i] + c2 * t[i];
+      }
+      rho_prev = rho_next;
+    }
+  }
+
+  for (int i = 0; i < size; i++) {
+    yvals[i] = y[i];
+  }
+}
+
+/*
+  Get the matrix associated with the smoother
+*/
+void TMRMixedChebyshevSmoother::getMat(TACSMat **_mat) { *_mat = mat; }
@@ -0,0 +1,102 @@
+/*
+  This file is part of the package TMR for adaptive mesh refinement.
+
+  Copyright (C) 2015 Georgia Tech Research Corporation.
+  Additional copyright (C) 2015 Graeme Kennedy.
+  All rights reserved.
+
+  TMR is licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this software except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef TMR_MIXED_CHEBYSHEV_SMOOTHER_H
+#define TMR_MIXED_CHEBYSHEV_SMOOTHER_H
+
+#include "KSM.h"
+#include "TACSAssembler.h"
+#include "TACSParallelMat.h"
+
+/*
+  A Chebyshev smoother that is applied in single precision
+
+  The smoother stores a single precision copy of the values of the
+  parallel matrix, together with the inverse of its block diagonal,
+  when it is factored. The smoother applies the Chebyshev polynomial
+  of the block-Jacobi preconditioned matrix D^{-1}*A with the given
+  degree on the eigenvalue interval [lower*rho, upper*rho], where rho
+  is an estimate of the largest eigenvalue computed with the power
+  method. The input and output vectors remain in double precision,
+  but all the matrix products are computed in single precision. This
+  halves the memory traffic of the products, which dominate the cost
+  of the smoothing.
+
+  The double precision matrix is not modified and is still used to
+  form the Galerkin coarse grid operators and the residuals of the
+  outer Krylov method. As a result, the single precision values are
+  stored in addition to the double precision values, which increases
+  the storage for the matrix by about half. The smoother is only
+  intended to be used as a preconditioner, where the loss of accuracy
+  is unimportant. Only the real parts of the values are used, so the
+  smoother is not intended for complex builds (TACS_USE_COMPLEX).
+  TMR_CreateTACSMg uses TACSChebyshevSmoother instead in complex
+  builds.
+*/
+class TMRMixedChebyshevSmoother : public TACSPc {
+ public:
+  TMRMixedChebyshevSmoother(TACSAssembler *assembler, TACSParallelMat *_mat,
+                            int _degree, double _lower = 1.0 / 30.0,
+                            double _upper = 1.1, int _iters = 1);
+  ~TMRMixedChebyshevSmoother();
+
+  // Copy the matrix to single precision and estimate the spectrum
+  void factor();
+
+  // Apply the smoother with a zero initial guess
+  void applyFactor(TACSVec *xvec, TACSVec *yvec);
+
+  // Get the matrix
+  void getMat(TACSMat **_mat);
+
+ private:
+  // Compute y = A*x in single precision
+  void mult(const float *x, float *y);
+
+  // Compute y = D^{-1}*x in single precision
+  void applyDiagInv(const float *x, float *y);
+
+  // Estimate the largest eigenvalue of D^{-1}*A
+  double estimateMaxEigenvalue(int num_iters);
+
+  // The matrix, its communicator and the smoother parameters
+  TACSParallelMat *mat;
+  MPI_Comm comm;
+  int degree, iters;
+  double lower, upper, rho;
+
+  // The local and external parts of the matrix
+  BCSRMat *Aloc, *Bext;
+  int bsize, nrows, ncoupling, next;
+
+  // The single precision values of the matrix and the inverse of the
+  // block diagonal
+  float *Avals, *Bvals, *Dinv;
+
+  // The distribution object for the external column values
+  TACSBVecDistribute *ext_dist;
+  TACSBVecDistCtx *ctx;
+
+  // Storage for the external values and the single precision vectors
+  TacsScalar *xd, *x_ext;
+  float *r, *d, *y, *t;
+};
+
+#endif  // TMR_MIXED_CHEBYSHEV_SMOOTHER_H
@@ -0,0 +1,374 @@
+/*
+  This file is part of the package TMR for adaptive mesh refinement.
+
+  Copyright (C) 2015 Georgia Tech Research Corporation.
+  Additional copyright (C) 2015 Graeme Kennedy.
+  All rights reserved.
+
+  TMR is licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this software except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include "TMRNameIndex.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/*
+  Compare two names and two integers for sorting
+*/
+static int compare_names(const void *a, const void *b) {
+  return strcmp(*(const char **)a, *(const char **)b);
+}
+
+static int compare_integers(const void *a, const void *b) {
+  return (*(const int *)a - *(const int *)b);
+}
+
+/*
+  Create the name index from the entities in the topology
+*/
+TMRNameIndex::TMRNameIndex(TMRTopology *topo) {
+  name_stamp = TMREntity::getNameStamp();
+
+  int nverts = topo->getNumVertices();
+  int nedges = topo->getNumEdges();
+  int nfaces = topo->getNumFaces();
+  int nvols = topo->getNumVolumes();
+
+  // Collect the names of all the entities
+  int count = 0;
+  const char **all = new const char *[nverts + nedges + nfaces + nvols];
+  for (int i = 0; i < nverts; i++) {
+    TMRVertex *vert;
+    topo->getVertex(i, &vert);
+    if (vert->getName()) {
+      all[count] = vert->getName();
+      count++;
+    }
+  }
+  for (int i = 0; i < nedges; i++) {
+    TMREdge *edge;
+    topo->getEdge(i, &edge);
+    if (edge->getName()) {
+      all[count] = edge->getName();
+      count++;
+    }
+  }
+  for (int i = 0; i < nfaces; i++) {
+    TMRFace *face;
+    topo->getFace(i, &face);
+    if (face->getName()) {
+      all[count] = face->getName();
+      count++;
+    }
+  }
+  for (int i = 0; i < nvols; i++) {
+    TMRVolume *vol;
+    topo->getVolume(i, &vol);
+    if (vol->getName()) {
+      all[count] = vol->getName();
+      count++;
+    }
+  }
+
+  // Sort the names and copy the distinct names
+  qsort(all, count, sizeof(const char *), compare_names);
+  num_names = 0;
+  names = new char *[count];
+  for (int i = 0; i < count; i++) {
+    if (i == 0 || strcmp(all[i], all[i - 1]) != 0) {
+      names[num_names] = new char[strlen(all[i]) + 1];
+      strcpy(names[num_names], all[i]);
+      num_names++;
+    }
+  }
+  delete[] all;
+
+  // Set the name index of each entity
+  vert_names = new int[nverts];
+  for (int i = 0; i < nverts; i++) {
+    TMRVertex *vert;
+    topo->getVertex(i, &vert);
+    vert_names[i] = getNameIndex(vert->getName());
+  }
+  edge_names = new int[nedges];
+  for (int i = 0; i < nedges; i++) {
+    TMREdge *edge;
+    topo->getEdge(i, &edge);
+    edge_names[i] = getNameIndex(edge->getName());
+  }
+  face_names = new int[nfaces];
+  for (int i = 0; i < nfaces; i++) {
+    TMRFace *face;
+    topo->getFace(i, &face);
+    face_names[i] = getNameIndex(face->getName());
+  }
+  vol_names = new int[nvols];
+  for (int i = 0; i < nvols; i++) {
+    TMRVolume *vol;
+    topo->getVolume(i, &vol);
+    vol_names[i] = getNameIndex(vol->getName());
+  }
+
+  // Allocate space for the entries
+  num_elems = 0;
+  max_elems = 1024;
+  elem_ptr = NULL;
+  elem_names = new int[max_elems];
+  elems = new int[max_elems];
+  elem_info = new int[max_elems];
+
+  num_nodes = 0;
+  max_nodes = 1024;
+  node_ptr = NULL;
+  node_names = new int[max_nodes];
+  nodes = new int[max_nodes];
+}
+
+/*
+  Free the name index
+*/
+TMRNameIndex::~TMRNameIndex() {
+  for (int i = 0; i < num_names; i++) {
+    delete[] names[i];
+  }
+  delete[] names;
+  delete[] vert_names;
+  delete[] edge_names;
+  delete[] face_names;
+  delete[] vol_names;
+  if (elem_ptr) {
+    delete[] elem_ptr;
+  }
+  if (elem_names) {
+    delete[] elem_names;
+  }
+  delete[] elems;
+  delete[] elem_info;
+  if (node_ptr) {
+    delete[] node_ptr;
+  }
+  if (node_names) {
+    delete[] node_names;
+  }
+  delete[] nodes;
+}
+
+/*
+  Get the index associated with a name
+
+  The index 0 is returned for a NULL name, and -1 is returned if no
+  entity has the name.
+*/
+int TMRNameIndex::getNameIndex(const char *name) {
+  if (!name) {
+    return 0;
+  }
+
+  int low = 0, high = num_names - 1;
+  while (low <= high) {
+    int mid = low + (high - low) / 2;
+    int cmp = strcmp(name, names[mid]);
+    if (cmp == 0) {
+      return mid + 1;
+    } else if (cmp < 0) {
+      high = mid - 1;
+    } else {
+      low = mid + 1;
+    }
+  }
+
+  return -1;
+}
+
+/*
+  Add an element with the given info value to the list for a name
+*/
+void TMRNameIndex::addElement(int name, int elem, int info) {
+  if (num_elems >= max_elems) {
+    max_elems = 2 * max_elems;
+    int *tmp = new int[max_elems];
+    memcpy(tmp, elem_names, num_elems * sizeof(int));
+    delete[] elem_names;
+    elem_names = tmp;
+
+    tmp = new int[max_elems];
+    memcpy(tmp, elems, num_elems * sizeof(int));
+    delete[] elems;
+    elems = tmp;
+
+    tmp = new int[max_elems];
+    memcpy(tmp, elem_info, num_elems * sizeof(int));
+    delete[] elem_info;
+    elem_info = tmp;
+  }
+  elem_names[num_elems] = name;
+  elems[num_elems] = elem;
+  elem_info[num_elems] = info;
+  num_elems++;
+}
+
+/*
+  Add a node to the list for a name
+*/
+void TMRNameIndex::addNode(int name, int node) {
+  if (num_nodes >= max_nodes) {
+    max_nodes = 2 * max_nodes;
+    int *tmp = new int[max_nodes];
+    memcpy(tmp, node_names, num_nodes * sizeof(int));
+    delete[] node_names;
+    node_names = tmp;
+
+    tmp = new int[max_nodes];
+    memcpy(tmp, nodes, num_nodes * sizeof(int));
+    delete[] nodes;
+    nodes = tmp;
+  }
+  node_names[num_nodes] = name;
+  nodes[num_nodes] = node;
+  num_nodes++;
+}
+
+/*
+  Sort the entries by name into the compressed row format
+
+  The sort is stable so that the elements for each name retain the
+  order in which they were added. The nodes for each name are then
+  sorted and the duplicates removed.
+*/
+void TMRNameIndex::finalize() {
+  if (elem_ptr) {
+    return;
+  }
+
+  // Sort the elements by name
+  elem_ptr = new int[num_names + 2];
+  memset(elem_ptr, 0, (num_names + 2) * sizeof(int));
+  for (int i = 0; i < num_elems; i++) {
+    elem_ptr[elem_names[i] + 1]++;
+  }
+  for (int i = 0; i <= num_names; i++) {
+    elem_ptr[i + 1] += elem_ptr[i];
+  }
+
+  int *new_elems = new int[num_elems > 0 ? num_elems : 1];
+  int *new_info = new int[num_elems > 0 ? num_elems : 1];
+  for (int i = 0; i < num_elems; i++) {
+    int index = elem_ptr[elem_names[i]];
+    new_elems[index] = elems[i];
+    new_info[index] = elem_info[i];
+    elem_ptr[elem_names[i]]++;
+  }
+  for (int i = num_names + 1; i > 0; i--) {
+    elem_ptr[i] = elem_ptr[i - 1];
+  }
+  elem_ptr[0] = 0;
+
+  delete[] elem_names;
+  delete[] elems;
+  delete[] elem_info;
+  elem_names = NULL;
+  elems = new_elems;
+  elem_info = new_info;
+
+  // Sort the nodes by name
+  node_ptr = new int[num_names + 2];
+  memset(node_ptr, 0, (num_names + 2) * sizeof(int));
+  for (int i = 0; i < num_nodes; i++) {
+    node_ptr[node_names[i] + 1]++;
+  }
+  for (int i = 0; i <= num_names; i++) {
+    node_ptr[i + 1] += node_ptr[i];
+  }
+
+  int *new_nodes = new int[num_nodes > 0 ? num_nodes : 1];
+  for (int i = 0; i < num_nodes; i++) {
+    new_nodes[node_ptr[node_names[i]]] = nodes[i];
+    node_ptr[node_names[i]]++;
+  }
+  for (int i = num_names + 1; i > 0; i--) {
+    node_ptr[i] = node_ptr[i - 1];
+  }
+  node_ptr[0] = 0;
+
+  delete[] node_names;
+  delete[] nodes;
+  node_names = NULL;
+  nodes = new_nodes;
+
+  // Sort the nodes for each name and remove the duplicates in place
+  int len = 0;
+  for (int i = 0; i <= num_names; i++) {
+    int start = node_ptr[i];
+    int end = node_ptr[i + 1];
+    qsort(&nodes[start], end - start, sizeof(int), compare_integers);
+
+    node_ptr[i] = len;
+    for (int j = start; j < end; j++) {
+      if (j == start || nodes[j] != nodes[j - 1]) {
+        nodes[len] = nodes[j];
+        len++;
+      }
+    }
+  }
+  node_ptr[num_names + 1] = len;
+  num_nodes = len;
+}
+
+/*
+  Get the elements and their info values associated with a name
+
+  input:
+  name:    the name (may be NULL)
+
+  output:
+  elems:   the element indices
+  info:    the info value added with each element
+
+  returns: the number of elements
+*/
+int TMRNameIndex::getElements(const char *name, const int **_elems,
+                              const int **_info) {
+  int index = getNameIndex(name);
+  if (!elem_ptr || index < 0) {
+    *_elems = NULL;
+    *_info = NULL;
+    return 0;
+  }
+
+  *_elems = &elems[elem_ptr[index]];
+  *_info = &elem_info[elem_ptr[index]];
+  return elem_ptr[index + 1] - elem_ptr[index];
+}
+
+/*
+  Get the sorted, unique nodes associated with a name
+
+  input:
+  name:    the name (may be NULL)
+
+  output:
+  nodes:   the node numbers
+
+  returns: the number of nodes
+*/
+int TMRNameIndex::getNodes(const char *name, const int **_nodes) {
+  int index = getNameIndex(name);
+  if (!node_ptr || index < 0) {
+    *_nodes = NULL;
+    return 0;
+  }
+
+  *_nodes = &nodes[node_ptr[index]];
+  return node_ptr[index + 1] - node_ptr[index];
+}
@@ -0,0 +1,91 @@
+/*
+  This file is part of the package TMR for adaptive mesh refinement.
+
+  Copyright (C) 2015 Georgia Tech Research Corporation.
+  Additional copyright (C) 2015 Graeme Kennedy.
+  All rights reserved.
+
+  TMR is licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this software except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef TMR_NAME_INDEX_H
+#define TMR_NAME_INDEX_H
+
+#include "TMRTopology.h"
+
+/*
+  An index from the names of the topological entities to the local
+  elements and nodes associated with each name
+
+  The distinct names of the vertices, edges, faces and volumes are
+  copied from the topology when the index is created and assigned an
+  integer. The index 0 is reserved for entities that have no name,
+  and the remaining names are sorted. The forest adds the elements
+  and nodes for each name in a single pass over its elements, and
+  finalize() sorts the entries into a compressed row format. The
+  elements for each name are stored in the order they were added,
+  while the nodes for each name are sorted and unique.
+
+  The index reflects the names at the time it was created. It records
+  the name stamp of TMREntity, so isCurrent() returns false once any
+  entity has been renamed and the forests then create a new index.
+*/
+class TMRNameIndex : public TMREntity {
+ public:
+  TMRNameIndex(TMRTopology *topo);
+  ~TMRNameIndex();
+
+  // Check whether no entity has been renamed since the index was created
+  int isCurrent() { return name_stamp == TMREntity::getNameStamp(); }
+
+  // Get the index for a name or for the name of an entity
+  // -----------------------------------------------------
+  int getNameIndex(const char *name);
+  int getVertexName(int v) { return vert_names[v]; }
+  int getEdgeName(int e) { return edge_names[e]; }
+  int getFaceName(int f) { return face_names[f]; }
+  int getVolumeName(int v) { return vol_names[v]; }
+
+  // Add the elements and nodes associated with a name index
+  // -------------------------------------------------------
+  void addElement(int name, int elem, int info);
+  void addNode(int name, int node);
+  void finalize();
+
+  // Get the elements and nodes associated with a name
+  // -------------------------------------------------
+  int getElements(const char *name, const int **elems, const int **info);
+  int getNodes(const char *name, const int **nodes);
+
+ private:
+  // The name stamp when the index was created
+  int name_stamp;
+
+  // The sorted distinct names, excluding the entities with no name
+  int num_names;
+  char **names;
+
+  // The name index of each topological entity
+  int *vert_names, *edge_names, *face_names, *vol_names;
+
+  // The elements and the element info for each name. The name of
+  // each entry is only stored until the index is finalized.
+  int num_elems, max_elems;
+  int *elem_ptr, *elem_names, *elems, *elem_info;
+
+  // The nodes for each name
+  int num_nodes, max_nodes;
+  int *node_ptr, *node_names, *nodes;
+};
+
+#endif  // TMR_NAME_INDEX_H
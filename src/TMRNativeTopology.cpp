@@ -184,6 +184,26 @@ int TMREdgeFromFace::evalPoint(double t, TMRPoint *X) {
   return fail;
 }
 
+/*
+  Evaluate a batch of points by evaluating the parameters along the
+  curve and then evaluating the points on the face together
+*/
+int TMREdgeFromFace::evalPoints(int n, const double t[], TMRPoint X[]) {
+  int fail = 0;
+  double *u = new double[2 * n];
+  double *v = &u[n];
+  for (int i = 0; i < n; i++) {
+    if (pcurves[0]->evalPoint(t[i], &u[i], &v[i])) {
+      fail = 1;
+    }
+  }
+  if (faces[0]->evalPoints(n, u, v, X)) {
+    fail = 1;
+  }
+  delete[] u;
+  return fail;
+}
+
 /*
   Parametrize the curve on the given surface
 */
@@ -499,6 +519,65 @@ int TMRTFIFace::evalPoint(double u, double v, TMRPoint *X) {
   }
 
   // Evaluate the point on the surface
+  interpolate(u, v, e, X);
+
+  return fail;
+}
+
+/*
+  Evaluate the surface on a tensor grid of parametric points
+
+  Each edge depends on only one of the parameters, so the points on
+  the edges are evaluated once for each distinct parameter value and
+  re-used for all the points on the grid.
+*/
+int TMRTFIFace::evalGrid(int nu, const double u[], int nv, const double v[],
+                         TMRPoint X[]) {
+  int fail = 0;
+
+  // Allocate space for the edge parameters and points. Edges 0 and 2
+  // depend on u, while edges 1 and 3 depend on v.
+  double *t = new double[nu > nv ? nu : nv];
+  TMRPoint *ue = new TMRPoint[2 * (nu + nv)];
+  TMRPoint *ve = &ue[2 * nu];
+
+  for (int k = 0; k < 4; k++) {
+    // The number of points and the parameters for this edge
+    int n = (k % 2 == 0 ? nu : nv);
+    const double *params = (k % 2 == 0 ? u : v);
+    TMRPoint *e = (k % 2 == 0 ? &ue[(k / 2) * nu] : &ve[(k / 2) * nv]);
+
+    for (int i = 0; i < n; i++) {
+      double p = (k < 2 ? params[i] : 1.0 - params[i]);
+      t[i] = (1.0 - p) * tmin[k] + p * tmax[k];
+    }
+    if (edges[k]->evalPoints(n, t, e)) {
+      fail = 1;
+    }
+  }
+
+  for (int j = 0; j < nv; j++) {
+    for (int i = 0; i < nu; i++) {
+      TMRPoint e[4];
+      e[0] = ue[i];
+      e[1] = ve[j];
+      e[2] = ue[nu + i];
+      e[3] = ve[nv + j];
+      interpolate(u[i], v[j], e, &X[i + nu * j]);
+    }
+  }
+
+  delete[] t;
+  delete[] ue;
+
+  return fail;
+}
+
+/*
+  Compute the transfinite interpolation from the points on the edges
+*/
+void TMRTFIFace::interpolate(double u, double v, const TMRPoint e[],
+                             TMRPoint *X) {
   X->x = (1.0 - u) * e[3].x + u * e[1].x + (1.0 - v) * e[0].x + v * e[2].x -
          ((1.0 - u) * (1.0 - v) * c[0].x + u * (1.0 - v) * c[1].x +
           u * v * c[2].x + v * (1.0 - u) * c[3].x);
@@ -510,8 +589,6 @@ int TMRTFIFace::evalPoint(double u, double v, TMRPoint *X) {
   X->z = (1.0 - u) * e[3].z + u * e[1].z + (1.0 - v) * e[0].z + v * e[2].z -
          ((1.0 - u) * (1.0 - v) * c[0].z + u * (1.0 - v) * c[1].z +
           u * v * c[2].z + v * (1.0 - u) * c[3].z);
-
-  return fail;
 }
 
 /*
@@ -794,18 +871,89 @@ int TMRParametricTFIFace::evalPoint(double u, double v, TMRPoint *X) {
 
   // Compute the parametric coordinates
   double us, vs;
-  us = (1.0 - u) * cupt[3] + u * cupt[1] + (1.0 - v) * cupt[0] + v * cupt[2] -
-       ((1.0 - u) * (1.0 - v) * vupt[0] + u * (1.0 - v) * vupt[1] +
-        u * v * vupt[2] + v * (1.0 - u) * vupt[3]);
-
-  vs = (1.0 - u) * cvpt[3] + u * cvpt[1] + (1.0 - v) * cvpt[0] + v * cvpt[2] -
-       ((1.0 - u) * (1.0 - v) * vvpt[0] + u * (1.0 - v) * vvpt[1] +
-        u * v * vvpt[2] + v * (1.0 - u) * vvpt[3]);
+  interpolate(u, v, cupt, cvpt, &us, &vs);
 
   fail = fail || face->evalPoint(us, vs, X);
   return fail;
 }
 
+/*
+  Evaluate the surface on a tensor grid of parametric points
+
+  The parameters along each edge are computed once for each distinct
+  parameter value. The interpolated parametric coordinates of the
+  whole grid are then evaluated on the surface together.
+*/
+int TMRParametricTFIFace::evalGrid(int nu, const double u[], int nv,
+                                   const double v[], TMRPoint X[]) {
+  int fail = 0;
+
+  // Compute the parameters on the surface along each edge. Edges 0
+  // and 2 depend on u, while edges 1 and 3 depend on v.
+  double *cu = new double[4 * (nu + nv)];
+  double *cv = &cu[2 * (nu + nv)];
+  for (int k = 0; k < 4; k++) {
+    int n = (k % 2 == 0 ? nu : nv);
+    const double *params = (k % 2 == 0 ? u : v);
+    int offset = (k % 2 == 0 ? (k / 2) * nu : 2 * nu + (k / 2) * nv);
+
+    for (int i = 0; i < n; i++) {
+      double p = (k < 2 ? params[i] : 1.0 - params[i]);
+      if (dir[k] < 0) {
+        p = 1.0 - p;
+      }
+      if (edges[k]->getParamsOnFace(face, p, 0, &cu[offset + i],
+                                    &cv[offset + i])) {
+        fail = 1;
+      }
+    }
+  }
+
+  // Compute the parametric coordinates of the grid
+  double *us = new double[2 * nu * nv];
+  double *vs = &us[nu * nv];
+  for (int j = 0; j < nv; j++) {
+    for (int i = 0; i < nu; i++) {
+      double cupt[4], cvpt[4];
+      cupt[0] = cu[i];
+      cupt[1] = cu[2 * nu + j];
+      cupt[2] = cu[nu + i];
+      cupt[3] = cu[2 * nu + nv + j];
+      cvpt[0] = cv[i];
+      cvpt[1] = cv[2 * nu + j];
+      cvpt[2] = cv[nu + i];
+      cvpt[3] = cv[2 * nu + nv + j];
+      interpolate(u[i], v[j], cupt, cvpt, &us[i + nu * j], &vs[i + nu * j]);
+    }
+  }
+
+  if (face->evalPoints(nu * nv, us, vs, X)) {
+    fail = 1;
+  }
+
+  delete[] cu;
+  delete[] us;
+
+  return fail;
+}
+
+/*
+  Compute the transfinite interpolation of the parametric coordinates
+  from the parameters along the edges
+*/
+void TMRParametricTFIFace::interpolate(double u, double v,
+                                       const double cupt[],
+                                       const double cvpt[], double *us,
+                                       double *vs) {
+  *us = (1.0 - u) * cupt[3] + u * cupt[1] + (1.0 - v) * cupt[0] + v * cupt[2] -
+        ((1.0 - u) * (1.0 - v) * vupt[0] + u * (1.0 - v) * vupt[1] +
+         u * v * vupt[2] + v * (1.0 - u) * vupt[3]);
+
+  *vs = (1.0 - u) * cvpt[3] + u * cvpt[1] + (1.0 - v) * cvpt[0] + v * cvpt[2] -
+        ((1.0 - u) * (1.0 - v) * vvpt[0] + u * (1.0 - v) * vvpt[1] +
+         u * v * vvpt[2] + v * (1.0 - u) * vvpt[3]);
+}
+
 /*
   Inverse evaluation: This is not yet implemented
 */
@@ -901,6 +1049,88 @@ int TMRTFIVolume::evalPoint(double u, double v, double w, TMRPoint *X) {
     }
   }
 
+  interpolate(u, v, w, e, X);
+
+  return 1;
+}
+
+/*
+  Evaluate the volume on a tensor grid of parametric points
+
+  Each edge depends on only one of the parameters, so the points on
+  the edges are evaluated once for each distinct parameter value and
+  re-used for all the points on the grid.
+*/
+int TMRTFIVolume::evalGrid(int nu, const double u[], int nv, const double v[],
+                           int nw, const double w[], TMRPoint X[]) {
+  int fail = 0;
+
+  // Allocate space for the edge parameters and points. Edges 0 - 3
+  // depend on u, edges 4 - 7 on v and edges 8 - 11 on w.
+  int nmax = nu;
+  if (nv > nmax) {
+    nmax = nv;
+  }
+  if (nw > nmax) {
+    nmax = nw;
+  }
+  double *t = new double[nmax];
+  TMRPoint *ue = new TMRPoint[4 * (nu + nv + nw)];
+  TMRPoint *ve = &ue[4 * nu];
+  TMRPoint *we = &ve[4 * nv];
+
+  for (int k = 0; k < 12; k++) {
+    // The number of points, the parameters and the points for this edge
+    int n = nu;
+    const double *params = u;
+    TMRPoint *e = &ue[k * nu];
+    if (k >= 4 && k < 8) {
+      n = nv;
+      params = v;
+      e = &ve[(k - 4) * nv];
+    } else if (k >= 8) {
+      n = nw;
+      params = w;
+      e = &we[(k - 8) * nw];
+    }
+
+    for (int i = 0; i < n; i++) {
+      if (edge_dir[k] > 0) {
+        t[i] = params[i];
+      } else {
+        t[i] = 1.0 - params[i];
+      }
+    }
+    if (edges[k]->evalPoints(n, t, e)) {
+      fail = 1;
+    }
+  }
+
+  for (int kk = 0; kk < nw; kk++) {
+    for (int jj = 0; jj < nv; jj++) {
+      for (int ii = 0; ii < nu; ii++) {
+        TMRPoint e[12];
+        for (int k = 0; k < 4; k++) {
+          e[k] = ue[k * nu + ii];
+          e[4 + k] = ve[k * nv + jj];
+          e[8 + k] = we[k * nw + kk];
+        }
+        interpolate(u[ii], v[jj], w[kk], e, &X[ii + nu * (jj + nv * kk)]);
+      }
+    }
+  }
+
+  delete[] t;
+  delete[] ue;
+
+  return fail;
+}
+
+/*
+  Compute the transfinite interpolation from the points on the edges
+*/
+void TMRTFIVolume::interpolate(double u, double v, double w,
+                               const TMRPoint e[], TMRPoint *X) {
   X->x =
       ((1.0 - v) * (1.0 - w) * e[0].x + v * (1.0 - w) * e[1].x +
        (1.0 - v) * w * e[2].x + v * w * e[3].x +
@@ -940,7 +1170,6 @@ int TMRTFIVolume::evalPoint(double u, double v, double w, TMRPoint *X) {
              (1.0 - u) * (1.0 - v) * w * c[4].z + u * (1.0 - v) * w * c[5].z +
              (1.0 - u) * v * w * c[6].z + u * v * w * c[7].z);
 
-  return 1;
 }
 
 /*
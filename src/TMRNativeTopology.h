@@ -35,7 +35,13 @@ class TMREdgeFromCurve : public TMREdge {
   ~TMREdgeFromCurve() { curve->decref(); }
   void getRange(double *tmin, double *tmax) { curve->getRange(tmin, tmax); }
   int evalPoint(double t, TMRPoint *X) { return curve->evalPoint(t, X); }
+  int evalPoints(int n, const double t[], TMRPoint X[]) {
+    return curve->evalPoints(n, t, X);
+  }
   int invEvalPoint(TMRPoint p, double *t) { return curve->invEvalPoint(p, t); }
+  int invEvalPoints(int n, const TMRPoint p[], double t[]) {
+    return curve->invEvalPoints(n, p, t);
+  }
   int evalDeriv(double t, TMRPoint *X, TMRPoint *Xt) {
     return curve->evalDeriv(t, X, Xt);
   }
@@ -60,9 +66,15 @@ class TMRFaceFromSurface : public TMRFace {
   int evalPoint(double u, double v, TMRPoint *X) {
     return surf->evalPoint(u, v, X);
   }
+  int evalPoints(int n, const double u[], const double v[], TMRPoint X[]) {
+    return surf->evalPoints(n, u, v, X);
+  }
   int invEvalPoint(TMRPoint p, double *u, double *v) {
     return surf->invEvalPoint(p, u, v);
   }
+  int invEvalPoints(int n, const TMRPoint p[], double u[], double v[]) {
+    return surf->invEvalPoints(n, p, u, v);
+  }
   int evalDeriv(double u, double v, TMRPoint *X, TMRPoint *Xu, TMRPoint *Xv) {
     return surf->evalDeriv(u, v, X, Xu, Xv);
   }
@@ -133,6 +145,7 @@ class TMREdgeFromFace : public TMREdge {
   ~TMREdgeFromFace();
   void getRange(double *tmin, double *tmax);
   int evalPoint(double t, TMRPoint *X);
+  int evalPoints(int n, const double t[], TMRPoint X[]);
   int getParamsOnFace(TMRFace *face, double t, int dir, double *u, double *v);
   int invEvalPoint(TMRPoint X, double *t);
   int evalDeriv(double t, TMRPoint *X, TMRPoint *Xt);
@@ -199,10 +212,15 @@ class TMRTFIFace : public TMRFace {
 
   void getRange(double *umin, double *vmin, double *umax, double *vmax);
   int evalPoint(double u, double v, TMRPoint *X);
+  int evalGrid(int nu, const double u[], int nv, const double v[],
+               TMRPoint X[]);
   int invEvalPoint(TMRPoint p, double *u, double *v);
   int evalDeriv(double u, double v, TMRPoint *X, TMRPoint *Xu, TMRPoint *Xv);
 
  private:
+  // Interpolate the point from the points on the edges
+  void interpolate(double u, double v, const TMRPoint e[], TMRPoint *X);
+
   // Set the number of Newton iterations
   static int max_newton_iters;
 
@@ -251,10 +269,16 @@ class TMRParametricTFIFace : public TMRFace {
   ~TMRParametricTFIFace();
   void getRange(double *umin, double *vmin, double *umax, double *vmax);
   int evalPoint(double u, double v, TMRPoint *X);
+  int evalGrid(int nu, const double u[], int nv, const double v[],
+               TMRPoint X[]);
   int invEvalPoint(TMRPoint p, double *u, double *v);
   int evalDeriv(double u, double v, TMRPoint *X, TMRPoint *Xu, TMRPoint *Xv);
 
  private:
+  // Interpolate the parametric coordinates from the edge parameters
+  void interpolate(double u, double v, const double cupt[],
+                   const double cvpt[], double *us, double *vs);
+
   TMRFace *face;
   TMREdge *edges[4];
   int dir[4];
@@ -300,9 +324,15 @@ class TMRTFIVolume : public TMRVolume {
   void getRange(double *umin, double *vmin, double *wmin, double *umax,
                 double *vmax, double *wmax);
   int evalPoint(double u, double v, double w, TMRPoint *X);
+  int evalGrid(int nu, const double u[], int nv, const double v[], int nw,
+               const double w[], TMRPoint X[]);
   void getEntities(TMRFace ***_faces, TMREdge ***_edges, TMRVertex ***_verts);
 
  private:
+  // Interpolate the point from the points on the edges
+  void interpolate(double u, double v, double w, const TMRPoint e[],
+                   TMRPoint *X);
+
   // Faces surrounding the volume: coordinate ordered
   TMRFace *faces[6];
 
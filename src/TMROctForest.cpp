@@ -21,8 +21,42 @@
 #include "TMROctForest.h"
 
 #include "TMRInterpolation.h"
+#include "TMRTrace.h"
+#include "TMR_VTKTools.h"
 #include "tmrlapack.h"
 
+#ifdef TMR_HAS_OPENMP
+#include <omp.h>
+#endif
+
+/*
+  The interpolation between forests is computed for blocks of nodes.
+  The weights for a block are computed in parallel and then added to
+  the interpolation in the order of the nodes, so the result does not
+  depend on the number of threads. Each thread computes a few chunks
+  of nodes in a block, which bounds the storage for the weights.
+*/
+static const int TMR_INTERP_CHUNK_SIZE = 8;
+static const int TMR_INTERP_CHUNKS_PER_THREAD = 4;
+
+/*
+  Interpolation weights with a magnitude below this tolerance are
+  dropped. Fine nodes that coincide with the knots of a coarse
+  element give exact (or round-off) zero weights for the other coarse
+  nodes. Removing them keeps the interpolation, and the sparsity of
+  the Galerkin coarse operators formed from it, as small as possible.
+*/
+static const double TMR_INTERP_WEIGHT_TOL = 1e-14;
+
+/*
+  The header of a file written by writeOctantsToFile(): a magic number
+  (the characters "TMRO"), the version of the format, the number of
+  blocks and the total number of octants
+*/
+static const int TMR_OCTANT_FILE_MAGIC = 0x4f524d54;
+static const int TMR_OCTANT_FILE_VERSION = 1;
+static const int TMR_OCTANT_FILE_HEADER_SIZE = 4;
+
 /*
   Map from a block edge number to the local node numbers
 */
@@ -283,12 +317,28 @@ static int compare_integers(const void *a, const void *b) {
 }
 
 /*
-  Compare tags for sorting
+  Compare the node locations of two octants and then their tags
 */
-static int compare_octant_tags(const void *a, const void *b) {
+static int compare_node_tags(const void *a, const void *b) {
   const TMROctant *A = static_cast<const TMROctant *>(a);
   const TMROctant *B = static_cast<const TMROctant *>(b);
-  return A->tag - B->tag;
+  int cmp = A->compareNode(B);
+  if (cmp == 0) {
+    cmp = A->tag - B->tag;
+  }
+  return cmp;
+}
+
+/*
+  Compare pairs of integers for sorting
+*/
+static int compare_integer_pairs(const void *a, const void *b) {
+  const int *A = static_cast<const int *>(a);
+  const int *B = static_cast<const int *>(b);
+  if (A[0] != B[0]) {
+    return A[0] - B[0];
+  }
+  return A[1] - B[1];
 }
 
 /*
@@ -310,7 +360,8 @@ static double convert_to_coordinate(const int32_t x) {
   Create the TMROctForest object
 */
 TMROctForest::TMROctForest(MPI_Comm _comm, int _mesh_order,
-                           TMRInterpolationType _interp_type) {
+                           TMRInterpolationType _interp_type,
+                           int _release_flags) {
   // Initialize the TMR-specific MPI data types
   if (!TMRIsInitialized()) {
     TMRInitialize();
@@ -323,9 +374,51 @@ TMROctForest::TMROctForest(MPI_Comm _comm, int _mesh_order,
 
   mesh_order = 2;
   interp_knots = NULL;
+  interp_wts = NULL;
 
   // Set the topology object to NULL to begin with
   topo = NULL;
+  node_cache = NULL;
+
+  // No interpolation is stored initially
+  use_interp_cache = 0;
+
+  // Store the adjacent octants as an array of octants by default
+  use_compact_storage = 0;
+
+  // Create all of the nodes in each call to createNodes() by default
+  use_incremental_nodes = 0;
+  prev_octants = NULL;
+  prev_nodes = NULL;
+  prev_conn = NULL;
+
+  // Number the owned nodes in the order they are created by default
+  node_ordering = TMR_NATURAL_NODE_ORDER;
+  node_bandwidth[0] = node_bandwidth[1] = 0;
+
+  // No transient memory has been allocated
+  memory_phase = TMR_NODES_PHASE;
+  transient_bytes = 0;
+  peak_bytes[TMR_NODES_PHASE] = 0;
+  peak_bytes[TMR_INTERP_PHASE] = 0;
+  interp_cache = NULL;
+  interp_cache_id = -1;
+  interp_cache_stamp = -1;
+  node_stamp = -1;
+  name_index = NULL;
+
+  // Do not repartition automatically by default
+  repartition_tol = 0.0;
+  last_imbalance = 1.0;
+  last_bytes_moved = 0.0;
+  last_repartitioned = 0;
+
+  // No octants have been created yet
+  octant_stamp = 0;
+  partition_stamp = 0;
+
+  // Set the data to release after the TACSAssembler object is created
+  release_flags = _release_flags;
 
   // Set the block data to zero initially
   bdata = NULL;
@@ -334,6 +427,7 @@ TMROctForest::TMROctForest(MPI_Comm _comm, int _mesh_order,
   owners = NULL;
   octants = NULL;
   adjacent = NULL;
+  adjacent_keys = NULL;
   X = NULL;
 
   // Set data for the number of elements/nodes/dependents
@@ -348,6 +442,15 @@ TMROctForest::TMROctForest(MPI_Comm _comm, int _mesh_order,
   dep_ptr = NULL;
   dep_conn = NULL;
   dep_weights = NULL;
+  dep_tmpl = NULL;
+  dep_tmpl_weights = NULL;
+
+  // No ghost layer or element neighbors have been computed
+  ghosts = NULL;
+  ghost_elems = NULL;
+  neighbor_ptr = NULL;
+  neighbor_conn = NULL;
+  neighbor_types = NULL;
 
   // Set the mesh order
   setMeshOrder(_mesh_order, _interp_type);
@@ -361,6 +464,12 @@ TMROctForest::~TMROctForest() {
   if (topo) {
     topo->decref();
   }
+  if (node_cache) {
+    node_cache->decref();
+  }
+  if (interp_cache) {
+    interp_cache->decref();
+  }
 
   freeData();
 }
@@ -373,6 +482,12 @@ void TMROctForest::freeData() {
   }
   bdata = NULL;
 
+  // Free the name index
+  if (name_index) {
+    name_index->decref();
+  }
+  name_index = NULL;
+
   // Free the octants/adjacency/dependency data
   if (owners) {
     delete[] owners;
@@ -383,9 +498,13 @@ void TMROctForest::freeData() {
   if (adjacent) {
     delete adjacent;
   }
+  if (adjacent_keys) {
+    delete adjacent_keys;
+  }
   if (X) {
     delete[] X;
   }
+  freePrevNodes();
 
   if (node_range) {
     delete[] node_range;
@@ -399,11 +518,18 @@ void TMROctForest::freeData() {
   if (dep_weights) {
     delete[] dep_weights;
   }
+  if (dep_tmpl) {
+    delete[] dep_tmpl;
+  }
+  if (dep_tmpl_weights) {
+    delete[] dep_tmpl_weights;
+  }
 
   // Null the octant owners/octant list
   owners = NULL;
   octants = NULL;
   adjacent = NULL;
+  adjacent_keys = NULL;
   X = NULL;
 
   // Set data for the number of elements/nodes/dependents
@@ -418,6 +544,10 @@ void TMROctForest::freeData() {
   dep_ptr = NULL;
   dep_conn = NULL;
   dep_weights = NULL;
+  dep_tmpl = NULL;
+  dep_tmpl_weights = NULL;
+
+  freeElementNeighbors();
 }
 
 /*
@@ -441,6 +571,9 @@ void TMROctForest::freeMeshData(int free_octs, int free_owners) {
   if (adjacent) {
     delete adjacent;
   }
+  if (adjacent_keys) {
+    delete adjacent_keys;
+  }
   if (X) {
     delete[] X;
   }
@@ -463,9 +596,16 @@ void TMROctForest::freeMeshData(int free_octs, int free_owners) {
   if (dep_weights) {
     delete[] dep_weights;
   }
+  if (dep_tmpl) {
+    delete[] dep_tmpl;
+  }
+  if (dep_tmpl_weights) {
+    delete[] dep_tmpl_weights;
+  }
 
   // Null the octant owners/octant list
   adjacent = NULL;
+  adjacent_keys = NULL;
   X = NULL;
 
   // Set data for the number of elements/nodes/dependents
@@ -480,6 +620,23 @@ void TMROctForest::freeMeshData(int free_octs, int free_owners) {
   dep_ptr = NULL;
   dep_conn = NULL;
   dep_weights = NULL;
+  dep_tmpl = NULL;
+  dep_tmpl_weights = NULL;
+
+  // The neighbors refer to the old octants
+  freeElementNeighbors();
+
+  // The stored interpolation refers to the old node numbers
+  if (interp_cache) {
+    interp_cache->decref();
+  }
+  interp_cache = NULL;
+
+  // The name index refers to the old elements and nodes
+  if (name_index) {
+    name_index->decref();
+  }
+  name_index = NULL;
 }
 
 /*
@@ -497,6 +654,30 @@ void TMROctForest::copyData(TMROctForest *copy) {
   if (copy->topo) {
     copy->topo->incref();
   }
+
+  // Share the cache of node locations
+  if (node_cache) {
+    node_cache->incref();
+  }
+  if (copy->node_cache) {
+    copy->node_cache->decref();
+  }
+  copy->node_cache = node_cache;
+
+  // Use the same storage for the adjacent octants
+  copy->use_compact_storage = use_compact_storage;
+
+  // Create the nodes in the same manner
+  copy->use_incremental_nodes = use_incremental_nodes;
+
+  // Use the same order for the owned nodes
+  copy->node_ordering = node_ordering;
+
+  // Release the same data once the nodes are no longer needed
+  copy->release_flags = release_flags;
+
+  // Use the same repartitioning policy
+  copy->repartition_tol = repartition_tol;
 }
 
 /*
@@ -515,16 +696,33 @@ void TMROctForest::setTopology(TMRTopology *_topo) {
     }
     topo = _topo;
 
-    // Compute the connectivity
-    int _num_nodes, _num_edges, _num_faces, _num_blocks;
-    const int *_block_conn, *_block_edge_conn;
-    const int *_block_face_conn;
-    topo->getConnectivity(&_num_nodes, &_num_edges, &_num_faces, &_num_blocks,
-                          &_block_conn, &_block_edge_conn, &_block_face_conn);
+    // Create a new cache for the node locations
+    if (node_cache) {
+      node_cache->decref();
+    }
+    node_cache = new TMRPointCache();
+    node_cache->incref();
+
+    // Re-use the block connectivity if it has already been computed
+    // by another forest created from the same topology
+    TMREntity *conn = topo->getOctConnCache();
+    if (conn) {
+      bdata = static_cast<TMRBlockConn *>(conn);
+      bdata->incref();
+    } else {
+      // Compute the connectivity
+      int _num_nodes, _num_edges, _num_faces, _num_blocks;
+      const int *_block_conn, *_block_edge_conn;
+      const int *_block_face_conn;
+      topo->getConnectivity(&_num_nodes, &_num_edges, &_num_faces,
+                            &_num_blocks, &_block_conn, &_block_edge_conn,
+                            &_block_face_conn);
 
-    // Set the connectivity internally
-    setFullConnectivity(_num_nodes, _num_edges, _num_faces, _num_blocks,
-                        _block_conn, _block_edge_conn, _block_face_conn);
+      // Set the connectivity internally and cache it in the topology
+      setFullConnectivity(_num_nodes, _num_edges, _num_faces, _num_blocks,
+                          _block_conn, _block_edge_conn, _block_face_conn);
+      topo->setOctConnCache(bdata);
+    }
   }
 }
 
@@ -535,6 +733,20 @@ void TMROctForest::setTopology(TMRTopology *_topo) {
 */
 TMRTopology *TMROctForest::getTopology() { return topo; }
 
+/*
+  Clear the cache of node locations
+
+  The node locations evaluated from the topology are cached so that
+  nodes that also exist in a previous mesh, created from this forest or
+  a duplicated, coarsened or refined version of it, are not evaluated
+  a second time. This frees the memory associated with these points.
+*/
+void TMROctForest::clearNodeLocationCache() {
+  if (node_cache) {
+    node_cache->clear();
+  }
+}
+
 /*
   Set the connectivity of the blocks
 
@@ -585,8 +797,8 @@ void TMROctForest::setConnectivity(int _num_nodes, const int *_block_conn,
   computeFacesFromNodes();
   computeFacesToBlocks();
 
-  // Compute the block owners based on the node, edge and face data
-  computeBlockOwners();
+  // Compute the transformations between adjacent blocks
+  computeBlockTransforms();
 }
 
 /*
@@ -634,8 +846,8 @@ void TMROctForest::setFullConnectivity(int _num_nodes, int _num_edges,
   // Compute the face to block information
   computeFacesToBlocks();
 
-  // Compute the block owners based on the node, edge and face data
-  computeBlockOwners();
+  // Compute the transformations between adjacent blocks
+  computeBlockTransforms();
 }
 
 /*
@@ -731,7 +943,12 @@ void TMROctForest::computeEdgesToBlocks() {
   }
   bdata->edge_block_ptr[0] = 0;
 
-  // Loop over all edges and determine their relative orientation
+  // Loop over all edges and determine their relative orientation.
+  // Each edge only modifies its own entries, so the edges are
+  // independent.
+#ifdef TMR_HAS_OPENMP
+#pragma omp parallel for
+#endif  // TMR_HAS_OPENMP
   for (int edge = 0; edge < num_edges; edge++) {
     int block_owner = num_blocks;
     int owner_index = 0;
@@ -787,175 +1004,178 @@ void TMROctForest::computeEdgesToBlocks() {
 
 /*
   Establish a unique ordering of the edges along each block
+
+  Each block edge is placed in a bucket associated with its lowest
+  node number, so that matching edges are found by scanning the short
+  list of edges within a single bucket. The edges are numbered in the
+  order in which they first appear in the block connectivity.
 */
 void TMROctForest::computeEdgesFromNodes() {
   const int num_blocks = bdata->num_blocks;
+  const int num_nodes = bdata->num_nodes;
+  const int *block_conn = bdata->block_conn;
 
-  bdata->block_edge_conn = new int[12 * num_blocks];
-  for (int i = 0; i < 12 * num_blocks; i++) {
-    bdata->block_edge_conn[i] = -1;
+  // Count up the number of block edges in each bucket
+  int *ptr = new int[num_nodes + 1];
+  memset(ptr, 0, (num_nodes + 1) * sizeof(int));
+  for (int i = 0; i < num_blocks; i++) {
+    for (int j = 0; j < 12; j++) {
+      int n1 = block_conn[8 * i + block_to_edge_nodes[j][0]];
+      int n2 = block_conn[8 * i + block_to_edge_nodes[j][1]];
+      ptr[(n1 < n2 ? n1 : n2) + 1]++;
+    }
+  }
+  for (int i = 0; i < num_nodes; i++) {
+    ptr[i + 1] += ptr[i];
   }
 
-  int edge = 0;
+  // Add the block edge index and the other edge node to the buckets.
+  // The entries in each bucket are sorted by the block edge index.
+  int *bucket = new int[2 * 12 * num_blocks];
   for (int i = 0; i < num_blocks; i++) {
-    // Loop over each edge on this block
     for (int j = 0; j < 12; j++) {
-      if (bdata->block_edge_conn[12 * i + j] < 0) {
-        int n1 = bdata->block_conn[8 * i + block_to_edge_nodes[j][0]];
-        int n2 = bdata->block_conn[8 * i + block_to_edge_nodes[j][1]];
-
-        // Keep track of the number of edges found
-        const int max_nedges = 128;
-        int edge_index[max_nedges];
-        int nedges = 1;
-        edge_index[0] = 12 * i + j;
-
-        // Set the edge number - if any is found
-        int edge_num = -1;
-
-        // Scan through the blocks that share the same node and check
-        // if any of the edges are also shared
-        for (int ip = bdata->node_block_ptr[n1];
-             ip < bdata->node_block_ptr[n1 + 1]; ip++) {
-          int ii = bdata->node_block_conn[ip] / 8;
-
-          // Loop over each edge in the new block
-          for (int jj = 0; jj < 12; jj++) {
-            int nn1 = bdata->block_conn[8 * ii + block_to_edge_nodes[jj][0]];
-            int nn2 = bdata->block_conn[8 * ii + block_to_edge_nodes[jj][1]];
-
-            // Check if the block matches
-            if ((n1 == nn1 && n2 == nn2) || (n1 == nn2 && n2 == nn1)) {
-              if (bdata->block_edge_conn[12 * ii + jj] >= 0) {
-                // If this edge has been ordered, copy over
-                // the edge number
-                edge_num = bdata->block_edge_conn[12 * ii + jj];
-              } else if (nedges < max_nedges) {
-                // This edge has not yet been ordered, add it
-                // to the unordered list if there is still room
-                // if not, we will detect and order it during
-                // a future iteration
-                edge_index[nedges] = 12 * ii + jj;
-                nedges++;
-              }
-            }
-          }
-        }
-
-        // If this edge does not have an edge number, assign
-        // a new one to the list
-        if (edge_num < 0) {
-          edge_num = edge;
-          edge++;
-        }
+      int n1 = block_conn[8 * i + block_to_edge_nodes[j][0]];
+      int n2 = block_conn[8 * i + block_to_edge_nodes[j][1]];
+      int k = (n1 < n2 ? ptr[n1]++ : ptr[n2]++);
+      bucket[2 * k] = 12 * i + j;
+      bucket[2 * k + 1] = (n1 < n2 ? n2 : n1);
+    }
+  }
+  for (int i = num_nodes; i >= 1; i--) {
+    ptr[i] = ptr[i - 1];
+  }
+  ptr[0] = 0;
 
-        // Set the edge numbers for all the edges that we found
-        for (int ii = 0; ii < nedges; ii++) {
-          bdata->block_edge_conn[edge_index[ii]] = edge_num;
-        }
+  // Find the first block edge that matches each block edge
+  int *block_edge_conn = new int[12 * num_blocks];
+#ifdef TMR_HAS_OPENMP
+#pragma omp parallel for
+#endif  // TMR_HAS_OPENMP
+  for (int node = 0; node < num_nodes; node++) {
+    for (int ip = ptr[node]; ip < ptr[node + 1]; ip++) {
+      int jp = ptr[node];
+      while (bucket[2 * jp + 1] != bucket[2 * ip + 1]) {
+        jp++;
       }
+      block_edge_conn[bucket[2 * ip]] = bucket[2 * jp];
+    }
+  }
+
+  delete[] ptr;
+  delete[] bucket;
+
+  // Number the edges in the order they first appear. The first
+  // matching edge always has a lower index and is numbered first.
+  int edge = 0;
+  for (int i = 0; i < 12 * num_blocks; i++) {
+    if (block_edge_conn[i] == i) {
+      block_edge_conn[i] = edge;
+      edge++;
+    } else {
+      block_edge_conn[i] = block_edge_conn[block_edge_conn[i]];
     }
   }
 
-  // Set the total number of edges
+  // Set the edge connectivity and the total number of edges
+  bdata->block_edge_conn = block_edge_conn;
   bdata->num_edges = edge;
 }
 
 /*
   Establish a unique ordering of the faces for each block
+
+  This uses the same approach as computeEdgesFromNodes. Each block face
+  is placed in the bucket associated with its lowest node number along
+  with its remaining nodes in sorted order, and the faces are numbered
+  in the order in which they first appear.
 */
 void TMROctForest::computeFacesFromNodes() {
   const int num_blocks = bdata->num_blocks;
+  const int num_nodes = bdata->num_nodes;
+  const int *block_conn = bdata->block_conn;
 
-  bdata->block_face_conn = new int[6 * num_blocks];
-  for (int i = 0; i < 6 * num_blocks; i++) {
-    bdata->block_face_conn[i] = -1;
+  // Count up the number of block faces in each bucket
+  int *ptr = new int[num_nodes + 1];
+  memset(ptr, 0, (num_nodes + 1) * sizeof(int));
+  for (int i = 0; i < num_blocks; i++) {
+    for (int j = 0; j < 6; j++) {
+      int nmin = block_conn[8 * i + block_to_face_nodes[j][0]];
+      for (int k = 1; k < 4; k++) {
+        int n = block_conn[8 * i + block_to_face_nodes[j][k]];
+        if (n < nmin) {
+          nmin = n;
+        }
+      }
+      ptr[nmin + 1]++;
+    }
+  }
+  for (int i = 0; i < num_nodes; i++) {
+    ptr[i + 1] += ptr[i];
   }
 
-  // Count up and order the number of faces in the mesh
-  int face = 0;
+  // Add the block face index and the remaining sorted face nodes to
+  // the buckets. The entries in each bucket are sorted by the block
+  // face index.
+  int *bucket = new int[4 * 6 * num_blocks];
   for (int i = 0; i < num_blocks; i++) {
-    // Loop over all the face for this block
     for (int j = 0; j < 6; j++) {
-      if (bdata->block_face_conn[6 * i + j] < 0) {
-        // Get the face nodes for the j-th face of the i-th block
-        int face_nodes[4];
-        for (int k = 0; k < 4; k++) {
-          face_nodes[k] = bdata->block_conn[8 * i + block_to_face_nodes[j][k]];
+      // Sort the face nodes with an insertion sort
+      int face_nodes[4];
+      for (int k = 0; k < 4; k++) {
+        int n = block_conn[8 * i + block_to_face_nodes[j][k]];
+        int m = k;
+        for (; m > 0 && face_nodes[m - 1] > n; m--) {
+          face_nodes[m] = face_nodes[m - 1];
         }
+        face_nodes[m] = n;
+      }
 
-        // Keep track of the number of connecting faces
-        const int max_nfaces = 128;
-        int face_index[max_nfaces];
-        int nfaces = 1;
-        face_index[0] = 6 * i + j;
-
-        // Set the face number
-        int face_num = -1;
-
-        // Scan through and find the blocks that share a common
-        // node that is also on this face
-        int node = face_nodes[0];
-        for (int ip = bdata->node_block_ptr[node];
-             ip < bdata->node_block_ptr[node + 1]; ip++) {
-          int ii = bdata->node_block_conn[ip] / 8;
-
-          // Skip this if the blocks are the same
-          if (ii == i) {
-            continue;
-          }
-
-          // Loop over all the faces for the ii-th block
-          int face_equiv = 0;
-          for (int jj = 0; jj < 6; jj++) {
-            // Get the nodes corresponding to this face
-            int adj_face_nodes[4];
-            for (int k = 0; k < 4; k++) {
-              adj_face_nodes[k] =
-                  bdata->block_conn[8 * ii + block_to_face_nodes[jj][k]];
-            }
-
-            // Loop over the relative orientations between this block
-            // and the last block
-            for (int ort = 0; ort < 8; ort++) {
-              face_equiv =
-                  (face_nodes[0] == adj_face_nodes[face_orientations[ort][0]] &&
-                   face_nodes[1] == adj_face_nodes[face_orientations[ort][1]] &&
-                   face_nodes[2] == adj_face_nodes[face_orientations[ort][2]] &&
-                   face_nodes[3] == adj_face_nodes[face_orientations[ort][3]]);
-              // We've found a matching face
-              if (face_equiv) {
-                break;
-              }
-            }
+      int k = ptr[face_nodes[0]];
+      ptr[face_nodes[0]]++;
+      bucket[4 * k] = 6 * i + j;
+      bucket[4 * k + 1] = face_nodes[1];
+      bucket[4 * k + 2] = face_nodes[2];
+      bucket[4 * k + 3] = face_nodes[3];
+    }
+  }
+  for (int i = num_nodes; i >= 1; i--) {
+    ptr[i] = ptr[i - 1];
+  }
+  ptr[0] = 0;
 
-            if (face_equiv) {
-              if (bdata->block_face_conn[6 * ii + jj] >= 0) {
-                face_num = bdata->block_face_conn[6 * ii + jj];
-              } else if (nfaces < max_nfaces) {
-                face_index[nfaces] = 6 * ii + jj;
-                nfaces++;
-              }
-            }
-          }
-        }
+  // Find the first block face that matches each block face
+  int *block_face_conn = new int[6 * num_blocks];
+#ifdef TMR_HAS_OPENMP
+#pragma omp parallel for
+#endif  // TMR_HAS_OPENMP
+  for (int node = 0; node < num_nodes; node++) {
+    for (int ip = ptr[node]; ip < ptr[node + 1]; ip++) {
+      const int *key = &bucket[4 * ip + 1];
+      int jp = ptr[node];
+      while (bucket[4 * jp + 1] != key[0] || bucket[4 * jp + 2] != key[1] ||
+             bucket[4 * jp + 3] != key[2]) {
+        jp++;
+      }
+      block_face_conn[bucket[4 * ip]] = bucket[4 * jp];
+    }
+  }
 
-        // If this face does not have an associated face number
-        // give it one
-        if (face_num < 0) {
-          face_num = face;
-          face++;
-        }
+  delete[] ptr;
+  delete[] bucket;
 
-        // Set the face numbers
-        for (int ii = 0; ii < nfaces; ii++) {
-          bdata->block_face_conn[face_index[ii]] = face_num;
-        }
-      }
+  // Number the faces in the order they first appear
+  int face = 0;
+  for (int i = 0; i < 6 * num_blocks; i++) {
+    if (block_face_conn[i] == i) {
+      block_face_conn[i] = face;
+      face++;
+    } else {
+      block_face_conn[i] = block_face_conn[block_face_conn[i]];
     }
   }
 
-  // Set the number of faces
+  // Set the face connectivity and the number of faces
+  bdata->block_face_conn = block_face_conn;
   bdata->num_faces = face;
 }
 
@@ -1002,7 +1222,11 @@ void TMROctForest::computeFacesToBlocks() {
 
   // Determine the face block ids. These ids store both the
   // orientation of the face relative to the face owner - the
-  // face owner is on the block with the lowest block index.
+  // face owner is on the block with the lowest block index. Each
+  // face only modifies its own entries, so the faces are independent.
+#ifdef TMR_HAS_OPENMP
+#pragma omp parallel for
+#endif  // TMR_HAS_OPENMP
   for (int face = 0; face < num_faces; face++) {
     int block_owner = num_blocks;
     int owner_index = 0;
@@ -1086,57 +1310,105 @@ void TMROctForest::computeFacesToBlocks() {
 }
 
 /*
-  Once the connectivity for the blocks/faces/edges have been set,
-  compute the owners of each object.
+  Compute the transformations from each face, edge and corner of each
+  block to the coordinates of the block that owns the entity
+
+  The transformations are affine maps with integer coefficients that
+  are evaluated in transformNode(), which is called within the inner
+  loops of the node creation, the balancing and the search for the
+  enclosing octants. The face transformations are obtained by
+  evaluating the face orientation at the corners of a unit face.
 */
-void TMROctForest::computeBlockOwners() {
+void TMROctForest::computeBlockTransforms() {
   const int num_blocks = bdata->num_blocks;
-  const int num_faces = bdata->num_faces;
-  const int num_edges = bdata->num_edges;
-  const int num_nodes = bdata->num_nodes;
+  const int ntrans = TMRBlockConn::NUM_BLOCK_TRANSFORMS;
 
-  // Find the block numbers corresponding to the owner for each face,
-  // edge and corner so that we know who should be ordering what!
-  bdata->face_block_owners = new int[num_faces];
-  bdata->edge_block_owners = new int[num_edges];
-  bdata->node_block_owners = new int[num_nodes];
+  bdata->block_transforms = new TMRBlockConn::Transform[ntrans * num_blocks];
+  memset(bdata->block_transforms, 0,
+         ntrans * num_blocks * sizeof(TMRBlockConn::Transform));
 
-  // Find the owners for the faces, edges and nodes. The owner is
-  // chosen as the connecting block with the lowest block number
-  for (int face = 0; face < num_faces; face++) {
-    bdata->face_block_owners[face] = num_blocks;
+  for (int block = 0; block < num_blocks; block++) {
+    TMRBlockConn::Transform *t = &bdata->block_transforms[ntrans * block];
 
-    int ipend = bdata->face_block_ptr[face + 1];
-    for (int ip = bdata->face_block_ptr[face]; ip < ipend; ip++) {
-      int block = bdata->face_block_conn[ip] / 6;
-      if (block < bdata->face_block_owners[face]) {
-        bdata->face_block_owners[face] = block;
-      }
-    }
-  }
+    // Compute the transformations for the faces
+    for (int face_index = 0; face_index < 6; face_index++, t++) {
+      int face = bdata->block_face_conn[6 * block + face_index];
+      t->adj = -1;
+      if (block != bdata->getFaceOwner(face)) {
+        int face_id = bdata->block_face_ids[6 * block + face_index];
+        int ptr = bdata->face_block_ptr[face];
+        int adj_index = bdata->face_block_conn[ptr] % 6;
+        t->adj = bdata->face_block_conn[ptr] / 6;
+        t->face_id = face_id;
+
+        // Find the tangent directions on the source and owner faces
+        // and the normal direction of the owner face
+        int s0 = (face_index < 2 ? 1 : 0);
+        int s1 = (face_index < 4 ? 2 : 1);
+        int d0 = (adj_index < 2 ? 1 : 0);
+        int d1 = (adj_index < 4 ? 2 : 1);
+        int dn = adj_index / 2;
+
+        // Evaluate the face orientation at the corners of a unit face
+        int32_t u0, v0, ux, vx, uy, vy;
+        get_face_node_coords(face_id, 1, 0, 0, &u0, &v0);
+        get_face_node_coords(face_id, 1, 1, 0, &ux, &vx);
+        get_face_node_coords(face_id, 1, 0, 1, &uy, &vy);
+        t->A[3 * d0 + s0] = ux - u0;
+        t->A[3 * d0 + s1] = uy - u0;
+        t->A[3 * d1 + s0] = vx - v0;
+        t->A[3 * d1 + s1] = vy - v0;
+        t->b[d0] = u0;
+        t->b[d1] = v0;
+        t->b[dn] = adj_index % 2;
+      }
+    }
+
+    // Compute the transformations for the edges
+    for (int edge_index = 0; edge_index < 12; edge_index++, t++) {
+      int edge = bdata->block_edge_conn[12 * block + edge_index];
+      t->adj = -1;
+      if (block != bdata->getEdgeOwner(edge)) {
+        int ptr = bdata->edge_block_ptr[edge];
+        int adj = bdata->edge_block_conn[ptr] / 12;
+        int adj_index = bdata->edge_block_conn[ptr] % 12;
 
-  // Find the edge owners
-  for (int edge = 0; edge < num_edges; edge++) {
-    bdata->edge_block_owners[edge] = num_blocks;
+        // Determine the relative orientation of the edges from the
+        // first and second node numbers along each edge
+        int n1 =
+            bdata->block_conn[8 * block + block_to_edge_nodes[edge_index][0]];
+        int n2 =
+            bdata->block_conn[8 * block + block_to_edge_nodes[edge_index][1]];
+        int nn1 =
+            bdata->block_conn[8 * adj + block_to_edge_nodes[adj_index][0]];
+        int nn2 =
+            bdata->block_conn[8 * adj + block_to_edge_nodes[adj_index][1]];
+        int reverse = (n1 == nn2 && n2 == nn1);
+        t->adj = adj;
+        t->reversed = reverse;
 
-    int ipend = bdata->edge_block_ptr[edge + 1];
-    for (int ip = bdata->edge_block_ptr[edge]; ip < ipend; ip++) {
-      int block = bdata->edge_block_conn[ip] / 12;
-      if (block < bdata->edge_block_owners[edge]) {
-        bdata->edge_block_owners[edge] = block;
+        // Map the direction along the source edge to the direction
+        // along the owner edge and fix the remaining coordinates
+        int s = edge_index / 4;
+        int d = adj_index / 4;
+        t->A[3 * d + s] = (reverse ? -1 : 1);
+        t->b[d] = (reverse ? 1 : 0);
+        t->b[d == 0 ? 1 : 0] = adj_index % 2;
+        t->b[d == 2 ? 1 : 2] = (adj_index % 4) / 2;
       }
     }
-  }
-
-  // Find the node owners
-  for (int node = 0; node < num_nodes; node++) {
-    bdata->node_block_owners[node] = num_blocks;
 
-    int ipend = bdata->node_block_ptr[node + 1];
-    for (int ip = bdata->node_block_ptr[node]; ip < ipend; ip++) {
-      int block = bdata->node_block_conn[ip] / 8;
-      if (block < bdata->node_block_owners[node]) {
-        bdata->node_block_owners[node] = block;
+    // Compute the transformations for the corners
+    for (int corner = 0; corner < 8; corner++, t++) {
+      int node = bdata->block_conn[8 * block + corner];
+      t->adj = -1;
+      if (block != bdata->getNodeOwner(node)) {
+        int ptr = bdata->node_block_ptr[node];
+        int adj_index = bdata->node_block_conn[ptr] % 8;
+        t->adj = bdata->node_block_conn[ptr] / 8;
+        t->b[0] = adj_index % 2;
+        t->b[1] = (adj_index % 4) / 2;
+        t->b[2] = adj_index / 4;
       }
     }
   }
@@ -1150,7 +1422,6 @@ void TMROctForest::writeToVTK(const char *filename) {
   const int num_blocks = bdata->num_blocks;
   const int num_nodes = bdata->num_nodes;
   const int *block_conn = bdata->block_conn;
-  const int *node_block_owners = bdata->node_block_owners;
 
   if (mpi_rank == 0 && topo) {
     FILE *fp = fopen(filename, "w");
@@ -1163,7 +1434,7 @@ void TMROctForest::writeToVTK(const char *filename) {
       fprintf(fp, "POINTS %d float\n", num_nodes);
       for (int k = 0; k < num_nodes; k++) {
         // Get the owner of this node
-        int block = node_block_owners[k];
+        int block = bdata->getNodeOwner(k);
 
         // Check where the node is located
         int corner = 0;
@@ -1234,7 +1505,6 @@ void TMROctForest::writeToTecplot(const char *filename) {
   const int num_blocks = bdata->num_blocks;
   const int num_nodes = bdata->num_nodes;
   const int *block_conn = bdata->block_conn;
-  const int *node_block_owners = bdata->node_block_owners;
 
   if (mpi_rank == 0 && topo) {
     FILE *fp = fopen(filename, "w");
@@ -1250,7 +1520,7 @@ void TMROctForest::writeToTecplot(const char *filename) {
       // Write out the points
       for (int k = 0; k < num_nodes; k++) {
         // Get the owner of this node
-        int block = node_block_owners[k];
+        int block = bdata->getNodeOwner(k);
 
         // Check where the node is located
         int corner = 0;
@@ -1383,6 +1653,86 @@ void TMROctForest::writeForestToVTK(const char *filename) {
   }
 }
 
+/*
+  Write the entire forest to a binary VTK XML file
+
+  This is a collective call. Each processor writes its octants to the
+  file prefix_<rank>.vtu and the root processor writes prefix.pvtu
+  which references all of the pieces.
+
+  input:
+  prefix:    the file prefix
+  compress:  compress the data (if TMR is compiled with zlib)
+*/
+void TMROctForest::writeForestToVTU(const char *prefix, int compress) {
+  if (octants && topo) {
+    int size;
+    TMROctant *octs;
+    octants->getArray(&octs, &size);
+
+    // Allocate space for the points, connectivity and cell data
+    TMRPoint *Xpts = new TMRPoint[8 * size];
+    int *ptr = new int[size + 1];
+    int *cell_conn = new int[8 * size];
+    int *cell_types = new int[size];
+    double *entity = new double[size];
+    double *level = new double[size];
+
+    // Set the edge length
+    const int32_t hmax = 1 << TMR_MAX_LEVEL;
+
+    ptr[0] = 0;
+    for (int k = 0; k < size; k++) {
+      const int32_t h = 1 << (TMR_MAX_LEVEL - octs[k].level);
+
+      // Get the volume object and evaluate the point
+      TMRVolume *vol;
+      topo->getVolume(octs[k].block, &vol);
+
+      for (int kk = 0; kk < 2; kk++) {
+        for (int jj = 0; jj < 2; jj++) {
+          for (int ii = 0; ii < 2; ii++) {
+            double u = 1.0 * (octs[k].x + ii * h) / hmax;
+            double v = 1.0 * (octs[k].y + jj * h) / hmax;
+            double w = 1.0 * (octs[k].z + kk * h) / hmax;
+            vol->evalPoint(u, v, w, &Xpts[8 * k + ii + 2 * jj + 4 * kk]);
+          }
+        }
+      }
+
+      // Set the connectivity in the VTK ordering
+      const int order[] = {0, 1, 3, 2, 4, 5, 7, 6};
+      for (int j = 0; j < 8; j++) {
+        cell_conn[8 * k + j] = 8 * k + order[j];
+      }
+      ptr[k + 1] = 8 * (k + 1);
+      cell_types[k] = TMR_VTK_HEXAHEDRON;
+      entity[k] = 1.0 * octs[k].block;
+      level[k] = 1.0 * octs[k].level;
+    }
+
+    // Write out this processor's piece of the forest
+    const char *field_names[] = {"entity_index", "level"};
+    const double *fields[] = {entity, level};
+    char *filename = new char[strlen(prefix) + 20];
+    sprintf(filename, "%s_%d.vtu", prefix, mpi_rank);
+    TMR_WriteVTUFile(filename, 8 * size, Xpts, size, ptr, cell_conn,
+                     cell_types, 2, field_names, fields, compress);
+    delete[] filename;
+
+    if (mpi_rank == 0) {
+      TMR_WritePVTUFile(prefix, mpi_size, 2, field_names);
+    }
+
+    delete[] Xpts;
+    delete[] ptr;
+    delete[] cell_conn;
+    delete[] cell_types;
+    delete[] entity;
+    delete[] level;
+  }
+}
+
 /*
   Free the mesh element data if it exists
 */
@@ -1391,6 +1741,7 @@ void TMROctForest::setMeshOrder(int _mesh_order,
   // Don't free the octants/owner information if it exists,
   // but free the connectivity and node data
   freeMeshData(0, 0);
+  freePrevNodes();
 
   // Free the interpolation knots
   if (interp_knots) {
@@ -1424,6 +1775,11 @@ void TMROctForest::setMeshOrder(int _mesh_order,
       interp_knots[i] = -1.0 + 2.0 * i / (mesh_order - 1);
     }
   }
+
+  // Store the barycentric weights for the Lagrange shape functions
+  // after the knots
+  interp_wts = &interp_knots[mesh_order];
+  lagrange_barycentric_weights(mesh_order, interp_knots, interp_wts);
 }
 
 /*
@@ -1457,8 +1813,14 @@ void TMROctForest::getOctants(TMROctantArray **_octants) {
 
 /*
   Get the node numbers (note that this may be NULL)
+
+  The node numbers are re-created from the connectivity if they have
+  been released.
 */
 int TMROctForest::getNodeNumbers(const int **_node_numbers) {
+  if (!node_numbers && conn) {
+    createNodeNumbers();
+  }
   if (_node_numbers) {
     *_node_numbers = node_numbers;
   }
@@ -1484,6 +1846,9 @@ int TMROctForest::getPoints(TMRPoint **_X) {
   Retrieve the local node number
 */
 int TMROctForest::getLocalNodeNumber(int node) {
+  if (!node_numbers && conn) {
+    createNodeNumbers();
+  }
   if (node_numbers) {
     int *item = (int *)bsearch(&node, node_numbers, num_local_nodes,
                                sizeof(int), compare_integers);
@@ -1516,9 +1881,9 @@ void TMROctForest::evalInterp(const double pt[], double N[]) {
     bernstein_shape_functions(mesh_order, pt[2], Nw);
   } else {
     // Evaluate the shape functions
-    lagrange_shape_functions(mesh_order, pt[0], interp_knots, Nu);
-    lagrange_shape_functions(mesh_order, pt[1], interp_knots, Nv);
-    lagrange_shape_functions(mesh_order, pt[2], interp_knots, Nw);
+    lagrange_shape_functions(mesh_order, pt[0], interp_knots, interp_wts, Nu);
+    lagrange_shape_functions(mesh_order, pt[1], interp_knots, interp_wts, Nv);
+    lagrange_shape_functions(mesh_order, pt[2], interp_knots, interp_wts, Nw);
   }
 
   for (int k = 0; k < mesh_order; k++) {
@@ -1545,9 +1910,12 @@ void TMROctForest::evalInterp(const double pt[], double N[], double Nxi[],
     bernstein_shape_func_derivative(mesh_order, pt[2], Nw, Nwd);
   } else {
     // Evaluate the shape functions
-    lagrange_shape_func_derivative(mesh_order, pt[0], interp_knots, Nu, Nud);
-    lagrange_shape_func_derivative(mesh_order, pt[1], interp_knots, Nv, Nvd);
-    lagrange_shape_func_derivative(mesh_order, pt[2], interp_knots, Nw, Nwd);
+    lagrange_shape_func_derivative(mesh_order, pt[0], interp_knots, interp_wts,
+                                   Nu, Nud);
+    lagrange_shape_func_derivative(mesh_order, pt[1], interp_knots, interp_wts,
+                                   Nv, Nvd);
+    lagrange_shape_func_derivative(mesh_order, pt[2], interp_knots, interp_wts,
+                                   Nw, Nwd);
   }
 
   for (int k = 0; k < mesh_order; k++) {
@@ -1583,12 +1951,12 @@ void TMROctForest::evalInterp(const double pt[], double N[], double N1[],
     bernstein_shape_func_second_derivative(mesh_order, pt[2], Nw, Nwd, Nwdd);
   } else {
     // Evaluate the shape functions
-    lagrange_shape_func_second_derivative(mesh_order, pt[0], interp_knots, Nu,
-                                          Nud, Nudd);
-    lagrange_shape_func_second_derivative(mesh_order, pt[1], interp_knots, Nv,
-                                          Nvd, Nvdd);
-    lagrange_shape_func_second_derivative(mesh_order, pt[2], interp_knots, Nw,
-                                          Nwd, Nwdd);
+    lagrange_shape_func_second_derivative(mesh_order, pt[0], interp_knots,
+                                          interp_wts, Nu, Nud, Nudd);
+    lagrange_shape_func_second_derivative(mesh_order, pt[1], interp_knots,
+                                          interp_wts, Nv, Nvd, Nvdd);
+    lagrange_shape_func_second_derivative(mesh_order, pt[2], interp_knots,
+                                          interp_wts, Nw, Nwd, Nwdd);
   }
 
   for (int k = 0; k < mesh_order; k++) {
@@ -1740,6 +2108,11 @@ void TMROctForest::getInverseConnectivity(const int **_node_block_conn,
 
 /*
   Allocate the trees for each element within the mesh
+
+  The uniform octants are ordered by block and then along the Morton
+  curve within each block. Each processor computes its own contiguous
+  range within this global order and generates only the octants in
+  that range, so the initial forest is already evenly partitioned.
 */
 void TMROctForest::createTrees(int refine_level) {
   const int num_blocks = bdata->num_blocks;
@@ -1755,48 +2128,46 @@ void TMROctForest::createTrees(int refine_level) {
     level = TMR_MAX_LEVEL - 1;
   }
 
-  // Set who owns what blocks
-  int nblocks = num_blocks / mpi_size;
-  int remain = num_blocks % mpi_size;
-  int start = mpi_rank * nblocks;
-  int end = (mpi_rank + 1) * nblocks;
-  if (mpi_rank < remain) {
-    nblocks += 1;
-    start += mpi_rank;
-    end += mpi_rank + 1;
-  } else {
-    start += remain;
-    end += remain;
-  }
+  // Find the range of octants in the global order on this processor
+  const int64_t num_per_block = (int64_t)1 << (3 * level);
+  const int64_t total = num_per_block * num_blocks;
+  const int64_t start = (total / mpi_size) * mpi_rank +
+                        (mpi_rank < total % mpi_size ? mpi_rank
+                                                     : total % mpi_size);
+  const int64_t end = start + total / mpi_size +
+                      (mpi_rank < total % mpi_size ? 1 : 0);
 
   // Create an array of the octants that will be stored
-  int nelems = 1 << refine_level;
-  int size = nelems * nelems * nelems * nblocks;
+  int size = (int)(end - start);
   TMROctant *array = new TMROctant[size];
 
-  // Generate all of the octants on the associated blocks
+  // Generate the octants by decoding their Morton index within the
+  // block. The x-coordinate is the most significant bit of each
+  // triplet, consistent with the octant ordering.
   const int32_t hmax = 1 << TMR_MAX_LEVEL;
-  const int32_t h = 1 << (TMR_MAX_LEVEL - level);
-  for (int count = 0, block = start; block < end; block++) {
-    for (int32_t x = 0; x < hmax; x += h) {
-      for (int32_t y = 0; y < hmax; y += h) {
-        for (int32_t z = 0; z < hmax; z += h) {
-          array[count].tag = 0;
-          array[count].block = block;
-          array[count].level = level;
-          array[count].info = 0;
-          array[count].x = x;
-          array[count].y = y;
-          array[count].z = z;
-          count++;
-        }
-      }
+  for (int count = 0; count < size; count++) {
+    int64_t index = start + count;
+    uint64_t morton = index % num_per_block;
+    int32_t x = 0, y = 0, z = 0;
+    for (int32_t k = 0; k < level; k++) {
+      z |= ((morton >> (3 * k)) & 1) << k;
+      y |= ((morton >> (3 * k + 1)) & 1) << k;
+      x |= ((morton >> (3 * k + 2)) & 1) << k;
     }
+
+    array[count].tag = 0;
+    array[count].block = (int32_t)(index / num_per_block);
+    array[count].level = level;
+    array[count].info = 0;
+    array[count].x = x << (TMR_MAX_LEVEL - level);
+    array[count].y = y << (TMR_MAX_LEVEL - level);
+    array[count].z = z << (TMR_MAX_LEVEL - level);
   }
 
   // Create the array of octants
   octants = new TMROctantArray(array, size);
   octants->sort();
+  octant_stamp++;
 
   // Set the local reordering for the elements
   int oct_size;
@@ -1833,47 +2204,253 @@ void TMROctForest::createTrees(int refine_level) {
 }
 
 /*
-  Create a set of random trees
+  Write the octants from all processors to a binary file
+
+  The file contains a header with a magic number, the format version,
+  the number of blocks and the total number of octants, followed by
+  the octants in the global order. The file can
+  be read back on any number of processors with readOctantsFromFile().
+  Note that only the octants are stored: the mesh order, connectivity
+  and topology must be set separately, and the nodes must be created
+  again after the file is read. This is a collective call.
+
+  input:
+  filename:  the name of the file
+
+  returns:
+  a non-zero value if the file cannot be written
 */
-void TMROctForest::createRandomTrees(int nrand, int min_level, int max_level) {
-  const int num_blocks = bdata->num_blocks;
+int TMROctForest::writeOctantsToFile(const char *filename) {
+  if (!octants || !bdata) {
+    fprintf(stderr,
+            "TMROctForest Error: Cannot write octants, "
+            "no octants have been created\n");
+    return 1;
+  }
 
-  // Free all the mesh-specific data
-  freeMeshData();
+  // Get the local octants
+  int size;
+  TMROctant *array;
+  octants->getArray(&array, &size);
 
-  // Set who owns what blocks
-  int nblocks = num_blocks / mpi_size;
-  int remain = num_blocks % mpi_size;
-  int start = mpi_rank * nblocks;
-  int end = (mpi_rank + 1) * nblocks;
-  if (mpi_rank < remain) {
-    nblocks += 1;
-    start += mpi_rank;
-    end += mpi_rank + 1;
+  // Compute the offset to the octants from this processor
+  int *range = new int[mpi_size + 1];
+  range[0] = 0;
+  MPI_Allgather(&size, 1, MPI_INT, &range[1], 1, MPI_INT, comm);
+  for (int i = 0; i < mpi_size; i++) {
+    range[i + 1] += range[i];
+  }
+
+  // Copy the filename to a non-const array
+  char *fname = new char[strlen(filename) + 1];
+  strcpy(fname, filename);
+
+  int fail = 0;
+  MPI_File fp = MPI_FILE_NULL;
+  if (MPI_File_open(comm, fname, MPI_MODE_WRONLY | MPI_MODE_CREATE,
+                    MPI_INFO_NULL, &fp) == MPI_SUCCESS) {
+    // Discard the contents of an existing file
+    MPI_File_set_size(fp, 0);
+
+    // Write out the header
+    if (mpi_rank == 0) {
+      int header[TMR_OCTANT_FILE_HEADER_SIZE];
+      header[0] = TMR_OCTANT_FILE_MAGIC;
+      header[1] = TMR_OCTANT_FILE_VERSION;
+      header[2] = bdata->num_blocks;
+      header[3] = range[mpi_size];
+      MPI_File_write_at(fp, 0, header, TMR_OCTANT_FILE_HEADER_SIZE, MPI_INT,
+                        MPI_STATUS_IGNORE);
+    }
+
+    // Write out all the octants to the file
+    char datarep[] = "native";
+    const MPI_Offset header_bytes = TMR_OCTANT_FILE_HEADER_SIZE * sizeof(int);
+    MPI_File_set_view(fp, header_bytes, TMROctant_MPI_type,
+                      TMROctant_MPI_type, datarep, MPI_INFO_NULL);
+    MPI_File_write_at_all(fp, range[mpi_rank], array, size,
+                          TMROctant_MPI_type, MPI_STATUS_IGNORE);
+    MPI_File_close(&fp);
   } else {
-    start += remain;
-    end += remain;
+    fail = 1;
   }
 
-  // Create an array of the octants that will be stored
-  int size = nrand * nblocks;
-  TMROctant *array = new TMROctant[size];
+  delete[] range;
+  delete[] fname;
 
-  // Generate a random number of octants along random directions
-  for (int count = 0, block = start; block < end; block++) {
-    for (int i = 0; i < nrand; i++, count++) {
-      int32_t level = min_level + (rand() % (max_level - min_level + 1));
+  return fail;
+}
 
-      const int32_t h = 1 << (TMR_MAX_LEVEL - level);
-      int32_t x = h * (rand() % (1 << level));
-      int32_t y = h * (rand() % (1 << level));
-      int32_t z = h * (rand() % (1 << level));
-      array[count].tag = 0;
-      array[count].block = block;
-      array[count].level = level;
-      array[count].info = 0;
-      array[count].x = x;
-      array[count].y = y;
+/*
+  Read the octants from a binary file written by writeOctantsToFile()
+
+  The octants are stored in the global order, so each processor reads
+  a contiguous interval of the octants that is of nearly equal size.
+  The file may have been written on a different number of processors.
+  The connectivity (or topology) must be set before the file is read
+  and have the same number of blocks. This is a collective call.
+
+  input:
+  filename:  the name of the file
+
+  returns:
+  a non-zero value if the file cannot be read or does not match
+*/
+int TMROctForest::readOctantsFromFile(const char *filename) {
+  if (!bdata) {
+    fprintf(stderr,
+            "TMROctForest Error: Cannot read octants, "
+            "the connectivity must be set first\n");
+    return 1;
+  }
+  const int num_blocks = bdata->num_blocks;
+
+  // Copy the filename to a non-const array
+  char *fname = new char[strlen(filename) + 1];
+  strcpy(fname, filename);
+
+  MPI_File fp = MPI_FILE_NULL;
+  int open_fail = (MPI_File_open(comm, fname, MPI_MODE_RDONLY, MPI_INFO_NULL,
+                                 &fp) != MPI_SUCCESS);
+  delete[] fname;
+
+  if (open_fail) {
+    if (mpi_rank == 0) {
+      fprintf(stderr, "TMROctForest Error: Could not open file %s\n",
+              filename);
+    }
+    return 1;
+  }
+
+  // Read in the header. The header is zeroed first so that a short
+  // file fails the checks. Every processor reads the same values, so
+  // the checks are consistent across processors.
+  int header[TMR_OCTANT_FILE_HEADER_SIZE];
+  memset(header, 0, sizeof(header));
+  MPI_File_read_at_all(fp, 0, header, TMR_OCTANT_FILE_HEADER_SIZE, MPI_INT,
+                       MPI_STATUS_IGNORE);
+
+  // Find the size of the file and of the data it must contain
+  MPI_Offset file_size = 0;
+  MPI_File_get_size(fp, &file_size);
+  int type_size = 0;
+  MPI_Type_size(TMROctant_MPI_type, &type_size);
+  const MPI_Offset header_bytes = TMR_OCTANT_FILE_HEADER_SIZE * sizeof(int);
+
+  const char *errmsg = NULL;
+  if (header[0] != TMR_OCTANT_FILE_MAGIC) {
+    errmsg = "is not a TMROctForest octant file";
+  } else if (header[1] != TMR_OCTANT_FILE_VERSION) {
+    errmsg = "has an unsupported format version";
+  } else if (header[2] != num_blocks) {
+    errmsg = "does not match the number of blocks in the connectivity";
+  } else if (header[3] < 0 ||
+             file_size < header_bytes + (MPI_Offset)type_size * header[3]) {
+    errmsg = "is truncated";
+  }
+  if (errmsg) {
+    if (mpi_rank == 0) {
+      fprintf(stderr, "TMROctForest Error: File %s %s\n", filename, errmsg);
+    }
+    MPI_File_close(&fp);
+    return 1;
+  }
+
+  // Free all of the mesh data
+  freeMeshData();
+
+  // Compute the interval of octants for this processor
+  const int total = header[3];
+  int start = (int)(((int64_t)total * mpi_rank) / mpi_size);
+  int end = (int)(((int64_t)total * (mpi_rank + 1)) / mpi_size);
+  int size = end - start;
+  TMROctant *array = new TMROctant[size];
+
+  char datarep[] = "native";
+  MPI_File_set_view(fp, header_bytes, TMROctant_MPI_type, TMROctant_MPI_type,
+                    datarep, MPI_INFO_NULL);
+  MPI_File_read_at_all(fp, start, array, size, TMROctant_MPI_type,
+                       MPI_STATUS_IGNORE);
+  MPI_File_close(&fp);
+
+  // Create the array of octants. The octants are already sorted.
+  octants = new TMROctantArray(array, size);
+  octants->sort();
+  octant_stamp++;
+
+  // Set the local reordering for the elements
+  for (int i = 0; i < size; i++) {
+    array[i].tag = i;
+  }
+
+  // Set the last octant
+  const int32_t hmax = 1 << TMR_MAX_LEVEL;
+  TMROctant p;
+  p.block = num_blocks - 1;
+  p.tag = -1;
+  p.level = 0;
+  p.info = 0;
+  p.x = p.y = p.z = hmax;
+  if (size > 0) {
+    p = array[0];
+  }
+
+  owners = new TMROctant[mpi_size];
+  MPI_Allgather(&p, 1, TMROctant_MPI_type, owners, 1, TMROctant_MPI_type, comm);
+
+  // Set the offsets if some of the processors have zero
+  // octants
+  for (int k = 1; k < mpi_size; k++) {
+    if (owners[k].tag == -1) {
+      owners[k] = owners[k - 1];
+    }
+  }
+
+  return 0;
+}
+
+/*
+  Create a set of random trees
+*/
+void TMROctForest::createRandomTrees(int nrand, int min_level, int max_level) {
+  const int num_blocks = bdata->num_blocks;
+
+  // Free all the mesh-specific data
+  freeMeshData();
+
+  // Set who owns what blocks
+  int nblocks = num_blocks / mpi_size;
+  int remain = num_blocks % mpi_size;
+  int start = mpi_rank * nblocks;
+  int end = (mpi_rank + 1) * nblocks;
+  if (mpi_rank < remain) {
+    nblocks += 1;
+    start += mpi_rank;
+    end += mpi_rank + 1;
+  } else {
+    start += remain;
+    end += remain;
+  }
+
+  // Create an array of the octants that will be stored
+  int size = nrand * nblocks;
+  TMROctant *array = new TMROctant[size];
+
+  // Generate a random number of octants along random directions
+  for (int count = 0, block = start; block < end; block++) {
+    for (int i = 0; i < nrand; i++, count++) {
+      int32_t level = min_level + (rand() % (max_level - min_level + 1));
+
+      const int32_t h = 1 << (TMR_MAX_LEVEL - level);
+      int32_t x = h * (rand() % (1 << level));
+      int32_t y = h * (rand() % (1 << level));
+      int32_t z = h * (rand() % (1 << level));
+      array[count].tag = 0;
+      array[count].block = block;
+      array[count].level = level;
+      array[count].info = 0;
+      array[count].x = x;
+      array[count].y = y;
       array[count].z = z;
     }
   }
@@ -1881,6 +2458,7 @@ void TMROctForest::createRandomTrees(int nrand, int min_level, int max_level) {
   // Create the array of octants
   octants = new TMROctantArray(array, size);
   octants->sort();
+  octant_stamp++;
 
   // Set the local reordering for the elements
   int oct_size;
@@ -1918,9 +2496,13 @@ void TMROctForest::createRandomTrees(int nrand, int min_level, int max_level) {
 
 /*
   Repartition the octants across all processors
+
+  The octants are divided into contiguous intervals in the Morton
+  order with an equal, or nearly equal, number of octants on the first
+  max_rank processors.
 */
 void TMROctForest::repartition(int max_rank) {
-  const int num_blocks = bdata->num_blocks;
+  TMR_TRACE_SCOPE("TMROctForest::repartition");
 
   // Free everything but the octants
   freeMeshData(0);
@@ -1963,101 +2545,312 @@ void TMROctForest::repartition(int max_rank) {
     new_ptr[k + 1] = new_ptr[k];
   }
 
-  // Allocate the new array of octants
-  int new_size = new_ptr[mpi_rank + 1] - new_ptr[mpi_rank];
-  TMROctant *new_array = NULL;
-  if (new_size > 0) {
-    new_array = new TMROctant[new_size];
+  // Move the octants to their new owners
+  repartitionOctants(ptr, new_ptr);
+
+  delete[] ptr;
+  delete[] new_ptr;
+}
+
+/*
+  Repartition the octants across all processors based on their cost
+
+  The octants are divided into contiguous intervals in the Morton
+  order such that the sum of the weights on each processor is as
+  close as possible to the average. Each octant is assigned to the
+  processor whose interval of the global weighted prefix sum contains
+  the midpoint of the octant's own weight.
+
+  If any weight is negative or NaN, or the weights sum to zero, an
+  error is printed and the octants are repartitioned by count on all
+  processors.
+
+  input:
+  weights:  non-negative weights for each local octant, in the order
+            of the local octant array
+
+  returns:
+  the imbalance: the max processor weight divided by the average
+*/
+double TMROctForest::repartition(const double *weights) {
+  // Free everything but the octants
+  freeMeshData(0);
+
+  int size;
+  TMROctant *array;
+  octants->getArray(&array, &size);
+
+  // Compute the offset of the local weights in the global weighted
+  // prefix sum and the total weight
+  double local_weight = 0.0;
+  int num_invalid = 0;
+  for (int i = 0; i < size; i++) {
+    if (!(weights[i] >= 0.0)) {
+      num_invalid++;
+    }
+    local_weight += weights[i];
   }
 
-  // Ptr:      |----|---|--------------------|-|
-  // New ptr:  |-------|-------|-------|-------|
+  double offset = 0.0;
+  MPI_Exscan(&local_weight, &offset, 1, MPI_DOUBLE, MPI_SUM, comm);
+  if (mpi_rank == 0) {
+    offset = 0.0;
+  }
 
-  // Count up the number of sends/recvs
-  int send_count = 0;
-  for (int i = 0; i < mpi_size; i++) {
-    if (i != mpi_rank && new_ptr[i + 1] >= ptr[mpi_rank] &&
-        new_ptr[i] < ptr[mpi_rank + 1]) {
-      send_count++;
+  // Find the total weight and the number of negative (or NaN) weights
+  // on all processors. A negative weight would break the ordering of
+  // the destinations, so all processors fall back to the repartition
+  // by count.
+  double local_data[2], total_data[2];
+  local_data[0] = local_weight;
+  local_data[1] = num_invalid;
+  MPI_Allreduce(local_data, total_data, 2, MPI_DOUBLE, MPI_SUM, comm);
+  double total_weight = total_data[0];
+
+  if (total_data[1] > 0.0 || !(total_weight > 0.0)) {
+    if (mpi_rank == 0) {
+      fprintf(stderr,
+              "TMROctForest Error: Weights must be non-negative with a "
+              "positive sum, repartitioning by octant count\n");
+    }
+    repartition();
+    return 1.0;
+  }
+
+  // Count the number of octants and the weight destined for each
+  // processor. Since the weights are non-negative, the destinations
+  // are non-decreasing in the Morton order.
+  int *new_count = new int[mpi_size];
+  double *new_weight = new double[mpi_size];
+  memset(new_count, 0, mpi_size * sizeof(int));
+  memset(new_weight, 0, mpi_size * sizeof(double));
+
+  double sum = offset;
+  for (int i = 0; i < size; i++) {
+    double mid = sum + 0.5 * weights[i];
+    int rank = (int)(mpi_size * (mid / total_weight));
+    if (rank < 0) {
+      rank = 0;
+    } else if (rank >= mpi_size) {
+      rank = mpi_size - 1;
     }
+    new_count[rank]++;
+    new_weight[rank] += weights[i];
+    sum += weights[i];
   }
 
-  // Allocate arrays send/recv arrays
-  MPI_Request *send_requests = new MPI_Request[send_count];
+  // Compute the new distribution of the octants
+  int *ptr = new int[mpi_size + 1];
+  int *new_ptr = new int[mpi_size + 1];
+  MPI_Allgather(&size, 1, MPI_INT, &ptr[1], 1, MPI_INT, comm);
+  MPI_Allreduce(new_count, &new_ptr[1], mpi_size, MPI_INT, MPI_SUM, comm);
+  ptr[0] = new_ptr[0] = 0;
+  for (int k = 0; k < mpi_size; k++) {
+    ptr[k + 1] += ptr[k];
+    new_ptr[k + 1] += new_ptr[k];
+  }
 
-  // Zero the send/recv counts
-  send_count = 0;
+  // Compute the imbalance of the new distribution
+  MPI_Allreduce(MPI_IN_PLACE, new_weight, mpi_size, MPI_DOUBLE, MPI_SUM,
+                comm);
+  double max_weight = 0.0;
+  for (int k = 0; k < mpi_size; k++) {
+    if (new_weight[k] > max_weight) {
+      max_weight = new_weight[k];
+    }
+  }
+  double imbalance = mpi_size * max_weight / total_weight;
 
-  // Match up the intervals for sends
-  for (int i = 0; i < mpi_size; i++) {
-    // If we're on the correct interval,
-    if (new_ptr[i + 1] >= ptr[mpi_rank] && new_ptr[i] < ptr[mpi_rank + 1]) {
-      // The start and end locations within the local array
-      int start = new_ptr[i] - ptr[mpi_rank];
-      if (start < 0) {
-        start = 0;
-      }
+  delete[] new_count;
+  delete[] new_weight;
 
-      int max_count = ptr[mpi_rank + 1] - ptr[mpi_rank];
-      int end = new_ptr[i + 1] - ptr[mpi_rank];
-      if (end > max_count) {
-        end = max_count;
-      }
+  // Move the octants to their new owners
+  repartitionOctants(ptr, new_ptr);
 
-      // Set the count
-      int count = end - start;
+  delete[] ptr;
+  delete[] new_ptr;
 
-      if (i == mpi_rank) {
-        int new_start = ptr[i] - new_ptr[i];
-        if (new_start < 0) {
-          new_start = 0;
-        }
-        memcpy(&new_array[new_start], &array[start], count * sizeof(TMROctant));
-      } else if (count > 0) {
-        // Send the element array to the new owner
-        MPI_Isend(&array[start], count, TMROctant_MPI_type, i, 0, comm,
-                  &send_requests[send_count]);
-        send_count++;
-      }
+  return imbalance;
+}
+
+/*
+  Set the imbalance tolerance that triggers an automatic repartition
+
+  When the tolerance is positive, repartitionIfImbalanced() is called
+  with this tolerance whenever balance() or refineAndBalance()
+  completes. Since refine() is followed by balance(), the octants are
+  not repartitioned after refine(). A tolerance of zero disables the
+  automatic repartition.
+*/
+void TMROctForest::setRepartitionTolerance(double tol) {
+  repartition_tol = (tol > 0.0 ? tol : 0.0);
+}
+
+/*
+  Repartition the octants when the load is imbalanced
+
+  The load on each processor is the number of octants or, when weights
+  are provided, the sum of the weights of its octants. The octants are
+  repartitioned only when the maximum load divided by the average
+  load exceeds the tolerance. The imbalance, the decision and the
+  number of bytes of octants moved between processors are retained and
+  can be retrieved with getRepartitionStats().
+
+  input:
+  tol:      the imbalance tolerance (maximum/average load)
+  weights:  optional non-negative weights for each local octant
+
+  returns:
+  1 if the octants were repartitioned, 0 otherwise
+*/
+int TMROctForest::repartitionIfImbalanced(double tol, const double *weights) {
+  last_imbalance = 1.0;
+  last_bytes_moved = 0.0;
+  last_repartitioned = 0;
+  if (!octants) {
+    return 0;
+  }
+
+  int size;
+  TMROctant *array;
+  octants->getArray(&array, &size);
+
+  // Compute the load on this processor
+  double load[2];
+  load[0] = size;
+  if (weights) {
+    load[0] = 0.0;
+    for (int i = 0; i < size; i++) {
+      load[0] += weights[i];
     }
   }
+  load[1] = load[0];
+  MPI_Allreduce(MPI_IN_PLACE, &load[0], 1, MPI_DOUBLE, MPI_MAX, comm);
+  MPI_Allreduce(MPI_IN_PLACE, &load[1], 1, MPI_DOUBLE, MPI_SUM, comm);
+  if (load[1] > 0.0) {
+    last_imbalance = mpi_size * load[0] / load[1];
+  }
 
-  // Match up the intervals for recvs
-  for (int i = 0; i < mpi_size; i++) {
-    // If we're on the correct interval,
-    if (i != mpi_rank && ptr[i + 1] >= new_ptr[mpi_rank] &&
-        ptr[i] < new_ptr[mpi_rank + 1]) {
-      // The start location within the local array
-      int start = ptr[i] - new_ptr[mpi_rank];
-      if (start < 0) {
-        start = 0;
-      }
+  if (last_imbalance <= tol) {
+    return 0;
+  }
 
-      // Set the end location
-      int max_count = new_ptr[mpi_rank + 1] - new_ptr[mpi_rank];
-      int end = ptr[i + 1] - new_ptr[mpi_rank];
-      if (end > max_count) {
-        end = max_count;
-      }
+  // Record the current distribution of the octants
+  int *ptr = new int[mpi_size + 1];
+  int *new_ptr = new int[mpi_size + 1];
+  MPI_Allgather(&size, 1, MPI_INT, &ptr[1], 1, MPI_INT, comm);
+
+  if (weights) {
+    repartition(weights);
+  } else {
+    repartition();
+  }
 
-      // Set the count
-      int count = end - start;
+  // Find the number of octants that changed processor. Since the
+  // global order is unchanged, these are the octants outside the
+  // intersection of the old and new intervals on each processor.
+  octants->getArray(&array, &size);
+  MPI_Allgather(&size, 1, MPI_INT, &new_ptr[1], 1, MPI_INT, comm);
+  ptr[0] = new_ptr[0] = 0;
+  for (int k = 0; k < mpi_size; k++) {
+    ptr[k + 1] += ptr[k];
+    new_ptr[k + 1] += new_ptr[k];
+  }
 
-      // Send the element array to the new owner
-      if (count > 0) {
-        MPI_Recv(&new_array[start], count, TMROctant_MPI_type, i, 0, comm,
-                 MPI_STATUS_IGNORE);
-      }
+  int num_kept = 0;
+  for (int k = 0; k < mpi_size; k++) {
+    int start = (ptr[k] > new_ptr[k] ? ptr[k] : new_ptr[k]);
+    int end = (ptr[k + 1] < new_ptr[k + 1] ? ptr[k + 1] : new_ptr[k + 1]);
+    if (end > start) {
+      num_kept += end - start;
     }
   }
+  last_bytes_moved = (double)sizeof(TMROctant) * (ptr[mpi_size] - num_kept);
+  last_repartitioned = 1;
 
-  // Free the memory
   delete[] ptr;
   delete[] new_ptr;
 
-  // Wait for any remaining sends to complete
-  MPI_Waitall(send_count, send_requests, MPI_STATUSES_IGNORE);
-  delete[] send_requests;
+  return 1;
+}
+
+/*
+  Get the outcome of the last call to repartitionIfImbalanced()
+
+  output:
+  imbalance:      the maximum/average load before repartitioning
+  repartitioned:  flag indicating whether the octants were moved
+  bytes_moved:    the total bytes of octants sent between processors
+*/
+void TMROctForest::getRepartitionStats(double *imbalance, int *repartitioned,
+                                       double *bytes_moved) {
+  if (imbalance) {
+    *imbalance = last_imbalance;
+  }
+  if (repartitioned) {
+    *repartitioned = last_repartitioned;
+  }
+  if (bytes_moved) {
+    *bytes_moved = last_bytes_moved;
+  }
+}
+
+/*
+  Move the octants to their new owners
+
+  input:
+  ptr:        the current offsets of the octants on each processor
+  new_ptr:    the new offsets of the octants on each processor
+  reset_tags: set the tags to the new local octant ordering
+*/
+void TMROctForest::repartitionOctants(const int *ptr, const int *new_ptr,
+                                      int reset_tags) {
+  TMR_TRACE_SCOPE("TMROctForest::repartitionOctants");
+
+  const int num_blocks = bdata->num_blocks;
+
+  int size;
+  TMROctant *array;
+  octants->getArray(&array, &size);
+
+  // Ptr:      |----|---|--------------------|-|
+  // New ptr:  |-------|-------|-------|-------|
+
+  // Find the intervals of the local array that are sent to each
+  // processor and the intervals of the new array that are received
+  // from each processor
+  int new_size = new_ptr[mpi_rank + 1] - new_ptr[mpi_rank];
+  int *send_ptr = new int[mpi_size + 1];
+  int *recv_ptr = new int[mpi_size + 1];
+  for (int i = 0; i <= mpi_size; i++) {
+    send_ptr[i] = new_ptr[i] - ptr[mpi_rank];
+    if (send_ptr[i] < 0) {
+      send_ptr[i] = 0;
+    } else if (send_ptr[i] > size) {
+      send_ptr[i] = size;
+    }
+
+    recv_ptr[i] = ptr[i] - new_ptr[mpi_rank];
+    if (recv_ptr[i] < 0) {
+      recv_ptr[i] = 0;
+    } else if (recv_ptr[i] > new_size) {
+      recv_ptr[i] = new_size;
+    }
+  }
+
+  // Exchange the octants
+  TMR_TRACE_BYTES(sizeof(TMROctant) *
+                  (size - send_ptr[mpi_rank + 1] + send_ptr[mpi_rank]));
+  TMROctantExchange *exchange =
+      new TMROctantExchange(comm, octants, send_ptr, recv_ptr);
+  exchange->begin();
+  TMROctantArray *new_octants = exchange->end();
+  delete exchange;
+  delete[] send_ptr;
+  delete[] recv_ptr;
+
+  TMROctant *new_array;
+  new_octants->getArray(&new_array, &new_size);
 
   // Set the last octant
   TMROctant p;
@@ -2072,7 +2865,8 @@ void TMROctForest::repartition(int max_rank) {
 
   // Free the octant arrays
   delete octants;
-  octants = new TMROctantArray(new_array, new_size);
+  octants = new_octants;
+  partition_stamp++;
 
   if (owners) {
     delete[] owners;
@@ -2081,9 +2875,11 @@ void TMROctForest::repartition(int max_rank) {
   MPI_Allgather(&p, 1, TMROctant_MPI_type, owners, 1, TMROctant_MPI_type, comm);
 
   // Set the local reordering for the elements
-  octants->getArray(&array, &size);
-  for (int i = 0; i < size; i++) {
-    array[i].tag = i;
+  if (reset_tags) {
+    octants->getArray(&array, &size);
+    for (int i = 0; i < size; i++) {
+      array[i].tag = i;
+    }
   }
 }
 
@@ -2165,12 +2961,13 @@ TMROctForest *TMROctForest::coarsen() {
 
 /*
   Refine the octree mesh based on the input refinement levels
+
+  If the refinement does not change any element on any processor, the
+  existing mesh data is retained, so that a following call to
+  createNodes() does not recompute the nodes.
 */
 void TMROctForest::refine(const int refinement[], int min_level,
                           int max_level) {
-  // Free the mesh data
-  freeMeshData(0, 0);
-
   // Adjust the min and max levels to ensure consistency
   if (min_level < 0) {
     min_level = 0;
@@ -2184,16 +2981,33 @@ void TMROctForest::refine(const int refinement[], int min_level,
     min_level = max_level;
   }
 
+  // Check whether any element will be changed by the refinement
+  int size;
+  TMROctant *array;
+  octants->getArray(&array, &size);
+
+  int changed = 0;
+  for (int i = 0; i < size && !changed; i++) {
+    if (refinement) {
+      changed = ((refinement[i] < 0 && array[i].level > min_level) ||
+                 (refinement[i] > 0 && array[i].level < max_level));
+    } else {
+      changed = (array[i].level < max_level);
+    }
+  }
+  MPI_Allreduce(MPI_IN_PLACE, &changed, 1, MPI_INT, MPI_LOR, comm);
+  if (!changed) {
+    return;
+  }
+
+  // Free the mesh data
+  freeMeshData(0, 0);
+
   // Create a hash table for the refined octants and the octants
   // that are external (on other processors)
   TMROctantHash *hash = new TMROctantHash();
   TMROctantHash *ext_hash = new TMROctantHash();
 
-  // Get the current array of octants
-  int size;
-  TMROctant *array;
-  octants->getArray(&array, &size);
-
   if (refinement) {
     for (int i = 0; i < size; i++) {
       if (refinement[i] == 0) {
@@ -2318,6 +3132,7 @@ void TMROctForest::refine(const int refinement[], int min_level,
   // Cover the hash table to a list and uniquely sort it
   octants = hash->toArray();
   octants->sort();
+  octant_stamp++;
 
   delete hash;
 
@@ -2332,14 +3147,20 @@ void TMROctForest::refine(const int refinement[], int min_level,
   Get the owner of the octant
 */
 int TMROctForest::getOctantMPIOwner(TMROctant *oct) {
-  int rank = 0;
-
-  // while (owners[rank+1] <= oct) rank++
-  for (; (rank < mpi_size - 1 && owners[rank + 1].comparePosition(oct) <= 0);
-       rank++)
-    ;
+  // Find the last rank such that owners[rank] <= oct using a binary
+  // search. The owners are sorted, but may contain duplicates when
+  // processors have no octants.
+  int low = 0, high = mpi_size - 1;
+  while (low < high) {
+    int mid = high - (high - low) / 2;
+    if (owners[mid].comparePosition(oct) <= 0) {
+      low = mid;
+    } else {
+      high = mid - 1;
+    }
+  }
 
-  return rank;
+  return low;
 }
 
 /*
@@ -2412,7 +3233,7 @@ TMROctantArray *TMROctForest::distributeOctants(TMROctantArray *list,
   // Now distribute the octants to their destination octrees and
   // balance the corresponding octrees including the new elements.
   int *oct_recv_counts = new int[mpi_size];
-  MPI_Alltoall(oct_counts, 1, MPI_INT, oct_recv_counts, 1, MPI_INT, comm);
+  TMRExchangeCounts(comm, oct_counts, oct_recv_counts);
 
   // Now use oct_ptr to point into the recv array
   oct_recv_ptr[0] = 0;
@@ -2449,63 +3270,121 @@ TMROctantArray *TMROctForest::sendOctants(TMROctantArray *list,
                                           const int *oct_ptr,
                                           const int *oct_recv_ptr,
                                           int use_node_index) {
-  // Get the array itself
+  TMR_TRACE_SCOPE("TMROctForest::sendOctants");
+  TMR_TRACE_BYTES(sizeof(TMROctant) *
+                  (oct_ptr[mpi_size] - oct_ptr[0] - oct_ptr[mpi_rank + 1] +
+                   oct_ptr[mpi_rank]));
+  TMROctantExchange *exchange = new TMROctantExchange(
+      comm, list, oct_ptr, oct_recv_ptr, use_node_index);
+  exchange->begin();
+  TMROctantArray *recv_list = exchange->end();
+  delete exchange;
+
+  return recv_list;
+}
+
+/*
+  Exchange octants with the processors designated by their tags
+
+  The number of octants that will be received is not known in advance
+  by the recieving processors. Instead of computing the counts with an
+  all-to-all, each processor posts synchronous sends only to the
+  processors it has data for, and receives messages as they arrive.
+  Once all of its sends have been matched a processor enters a
+  non-blocking barrier. When the barrier completes all messages have
+  been received. This is the non-blocking consensus algorithm of
+  Hoefler et al. and requires communication only between the
+  processors that actually exchange data.
+
+  input:
+  list:  the octants sorted by their tag (the destination rank)
+
+  returns:
+  the octants received from other processors
+*/
+TMROctantArray *TMROctForest::exchangeOctants(TMROctantArray *list) {
+  // Tag for the messages in the exchange
+  const int exchange_tag = 7;
+
   int size;
   TMROctant *array;
   list->getArray(&array, &size);
 
-  // Count up the number of recvs
-  int nsends = 0, nrecvs = 0;
+  // Find the ranges of octants destined for each processor
+  int *ptr = new int[mpi_size + 1];
+  matchTagIntervals(array, size, ptr);
+
+  int nsends = 0;
   for (int i = 0; i < mpi_size; i++) {
-    if (i != mpi_rank) {
-      if (oct_ptr[i + 1] - oct_ptr[i] > 0) {
-        nsends++;
-      }
-      if (oct_recv_ptr[i + 1] - oct_recv_ptr[i] > 0) {
-        nrecvs++;
-      }
+    if (i != mpi_rank && ptr[i + 1] > ptr[i]) {
+      nsends++;
     }
   }
 
-  // Allocate the space for the recving array
-  int recv_size = oct_recv_ptr[mpi_size];
-  TMROctant *recv_array = new TMROctant[recv_size];
-
-  // Allocate space for the requests
-  MPI_Request *send_request = new MPI_Request[nsends];
-
-  // Loop over all the ranks and send
+  // Post the sends
+  MPI_Request *send_requests = new MPI_Request[nsends];
   for (int i = 0, j = 0; i < mpi_size; i++) {
-    if (i != mpi_rank && oct_ptr[i + 1] - oct_ptr[i] > 0) {
-      // Post the send to the destination
-      int count = oct_ptr[i + 1] - oct_ptr[i];
-      MPI_Isend(&array[oct_ptr[i]], count, TMROctant_MPI_type, i, 0, comm,
-                &send_request[j]);
+    if (i != mpi_rank && ptr[i + 1] > ptr[i]) {
+      MPI_Issend(&array[ptr[i]], ptr[i + 1] - ptr[i], TMROctant_MPI_type, i,
+                 exchange_tag, comm, &send_requests[j]);
       j++;
-    } else if (i == mpi_rank) {
-      int count = oct_recv_ptr[i + 1] - oct_recv_ptr[i];
-      if (count > 0 && (count == oct_ptr[i + 1] - oct_ptr[i])) {
-        memcpy(&recv_array[oct_recv_ptr[i]], &array[oct_ptr[i]],
-               count * sizeof(TMROctant));
-      }
     }
   }
 
-  // Loop over the recieve calls
-  for (int i = 0; i < mpi_size; i++) {
-    if (i != mpi_rank && oct_recv_ptr[i + 1] > oct_recv_ptr[i]) {
-      int recv_count = oct_recv_ptr[i + 1] - oct_recv_ptr[i];
+  // Receive the octants as they arrive
+  int recv_size = 0, max_recv_size = 0;
+  TMROctant *recv_array = NULL;
+
+  int barrier_active = 0;
+  MPI_Request barrier_request;
+  while (1) {
+    int flag;
+    MPI_Status status;
+    MPI_Iprobe(MPI_ANY_SOURCE, exchange_tag, comm, &flag, &status);
+    if (flag) {
+      int count;
+      MPI_Get_count(&status, TMROctant_MPI_type, &count);
+
+      // Extend the receive array if needed
+      if (recv_size + count > max_recv_size) {
+        max_recv_size = 2 * (recv_size + count);
+        TMROctant *temp = new TMROctant[max_recv_size];
+        if (recv_array) {
+          memcpy(temp, recv_array, recv_size * sizeof(TMROctant));
+          delete[] recv_array;
+        }
+        recv_array = temp;
+      }
+
+      MPI_Recv(&recv_array[recv_size], count, TMROctant_MPI_type,
+               status.MPI_SOURCE, exchange_tag, comm, MPI_STATUS_IGNORE);
+      recv_size += count;
+    }
 
-      MPI_Recv(&recv_array[oct_recv_ptr[i]], recv_count, TMROctant_MPI_type, i,
-               0, comm, MPI_STATUS_IGNORE);
+    if (barrier_active) {
+      int done;
+      MPI_Test(&barrier_request, &done, MPI_STATUS_IGNORE);
+      if (done) {
+        break;
+      }
+    } else {
+      int sent;
+      MPI_Testall(nsends, send_requests, &sent, MPI_STATUSES_IGNORE);
+      if (sent) {
+        MPI_Ibarrier(comm, &barrier_request);
+        barrier_active = 1;
+      }
     }
   }
 
-  // Wait for any remaining sends to complete
-  MPI_Waitall(nsends, send_request, MPI_STATUSES_IGNORE);
-  delete[] send_request;
+  delete[] ptr;
+  delete[] send_requests;
+
+  if (!recv_array) {
+    recv_array = new TMROctant[1];
+  }
 
-  return new TMROctantArray(recv_array, recv_size, use_node_index);
+  return new TMROctantArray(recv_array, recv_size);
 }
 
 /*
@@ -2894,6 +3773,255 @@ void TMROctForest::balanceOctant(TMROctant *oct, TMROctantHash *hash,
   }
 }
 
+/*
+  Balance the given octants locally
+
+  Each 0-sibling of the input octants is added to the hash table (or
+  the external hash table if it is owned by another processor) along
+  with all of the octants required to balance it. This produces the
+  locally balanced set of 0-siblings.
+
+  The octants that are required to balance a given octant depend only
+  on that octant, so the balanced set generated from a union of octants
+  is the union of the balanced sets generated from each. When OpenMP
+  is enabled, this is used to balance contiguous ranges of the
+  Morton-ordered input concurrently, with thread-local hash tables and
+  queues, before the results are merged into the output hash tables.
+
+  input:
+  array:           the input octants
+  size:            the number of input octants
+  balance_corner:  balance across corners
+
+  output:
+  hash:            the hash table of locally owned octants
+  ext_hash:        the hash table of octants owned by other processors
+*/
+void TMROctForest::balanceLocal(TMROctant *array, int size,
+                                TMROctantHash *hash, TMROctantHash *ext_hash,
+                                const int balance_corner) {
+  const int balance_tree = 1;
+
+  int num_threads = 1;
+#ifdef TMR_HAS_OPENMP
+  num_threads = omp_get_max_threads();
+  if (size < min_octants_per_thread * num_threads) {
+    num_threads = size / min_octants_per_thread;
+  }
+  if (num_threads < 1) {
+    num_threads = 1;
+  }
+#endif  // TMR_HAS_OPENMP
+
+  if (num_threads == 1) {
+    TMROctantQueue *queue = new TMROctantQueue();
+
+    // Add all the elements
+    for (int i = 0; i < size; i++) {
+      TMROctant oct;
+      array[i].getSibling(0, &oct);
+
+      // Get the octant owner
+      int owner = getOctantMPIOwner(&oct);
+
+      // Add the owner
+      if (owner == mpi_rank) {
+        hash->addOctant(&oct);
+      } else {
+        ext_hash->addOctant(&oct);
+      }
+
+      // Balance the octants locally
+      balanceOctant(&oct, hash, ext_hash, queue, balance_corner, balance_tree);
+    }
+
+    while (queue->length() > 0) {
+      // Now continue until the queue of added octants is
+      // empty. At each iteration, pop an octant and add
+      // its neighbours until nothing new is added. This code
+      // handles the propagation of octants to adjacent octants.
+      TMROctant oct = queue->pop();
+      balanceOctant(&oct, hash, ext_hash, queue, balance_corner, balance_tree);
+    }
+
+    delete queue;
+  }
+#ifdef TMR_HAS_OPENMP
+  else {
+    TMROctantArray **local = new TMROctantArray *[num_threads];
+    TMROctantArray **ext_local = new TMROctantArray *[num_threads];
+
+#pragma omp parallel num_threads(num_threads)
+    {
+      const int t = omp_get_thread_num();
+      const int start = (int)(((int64_t)size * t) / num_threads);
+      const int end = (int)(((int64_t)size * (t + 1)) / num_threads);
+
+      // Balance the octants in this range using thread-local data
+      TMROctantHash *thread_hash = new TMROctantHash(0, end - start);
+      TMROctantHash *thread_ext_hash = new TMROctantHash();
+      TMROctantQueue *queue = new TMROctantQueue();
+
+      for (int i = start; i < end; i++) {
+        TMROctant oct;
+        array[i].getSibling(0, &oct);
+        if (getOctantMPIOwner(&oct) == mpi_rank) {
+          thread_hash->addOctant(&oct);
+        } else {
+          thread_ext_hash->addOctant(&oct);
+        }
+        balanceOctant(&oct, thread_hash, thread_ext_hash, queue,
+                      balance_corner, balance_tree);
+      }
+
+      while (queue->length() > 0) {
+        TMROctant oct = queue->pop();
+        balanceOctant(&oct, thread_hash, thread_ext_hash, queue,
+                      balance_corner, balance_tree);
+      }
+
+      local[t] = thread_hash->toArray();
+      ext_local[t] = thread_ext_hash->toArray();
+      delete thread_hash;
+      delete thread_ext_hash;
+      delete queue;
+    }
+
+    // Merge the results from each thread. Octants near the boundaries
+    // of the ranges may be generated by more than one thread, these
+    // are removed by the hash tables.
+    for (int t = 0; t < num_threads; t++) {
+      int local_size;
+      TMROctant *local_array;
+      local[t]->getArray(&local_array, &local_size);
+      for (int i = 0; i < local_size; i++) {
+        hash->addOctant(&local_array[i]);
+      }
+      delete local[t];
+
+      ext_local[t]->getArray(&local_array, &local_size);
+      for (int i = 0; i < local_size; i++) {
+        ext_hash->addOctant(&local_array[i]);
+      }
+      delete ext_local[t];
+    }
+
+    delete[] local;
+    delete[] ext_local;
+  }
+#endif  // TMR_HAS_OPENMP
+}
+
+/*
+  Complete the balance using a single sparse exchange
+
+  After balanceLocal(), each processor holds the locally balanced set
+  of 0-siblings generated by its own octants, including the octants
+  that it generated within the domain of other processors. Since the
+  octants required for balance depend only on the octant itself, the
+  global balanced set is the union of these local sets. Each processor
+  therefore only needs to send each 0-sibling to the processors that
+  own one of its siblings. No further balancing is required on the
+  receiving processor: the families of the local, external and
+  received 0-siblings are expanded and the locally owned octants are
+  retained. This requires a single round of communication between
+  neighboring processors only.
+
+  input:
+  hash:      the locally owned 0-siblings (freed on exit)
+  ext_hash:  the 0-siblings owned by other processors (freed on exit)
+*/
+void TMROctForest::balanceSparse(TMROctantHash *hash,
+                                 TMROctantHash *ext_hash) {
+  // Create the arrays of local and external 0-siblings
+  TMROctantArray *elems0[2];
+  elems0[0] = hash->toArray();
+  elems0[1] = ext_hash->toArray();
+  delete ext_hash;
+
+  // Find the destinations of the 0-siblings
+  TMROctantQueue *queue = new TMROctantQueue();
+  for (int k = 0; k < 2; k++) {
+    int size;
+    TMROctant *array;
+    elems0[k]->getArray(&array, &size);
+    for (int i = 0; i < size; i++) {
+      int num_siblings = (array[i].level > 0 ? 8 : 1);
+
+      // Keep track of the ranks that have been sent this octant
+      int dest[8];
+      int num_dest = 0;
+      for (int j = 0; j < num_siblings; j++) {
+        TMROctant q;
+        array[i].getSibling(j, &q);
+        int owner = getOctantMPIOwner(&q);
+
+        int found = (owner == mpi_rank);
+        for (int ii = 0; ii < num_dest && !found; ii++) {
+          if (dest[ii] == owner) {
+            found = 1;
+          }
+        }
+        if (!found) {
+          dest[num_dest] = owner;
+          num_dest++;
+
+          TMROctant oct = array[i];
+          oct.tag = owner;
+          queue->push(&oct);
+        }
+      }
+    }
+  }
+
+  // Send the octants to the neighboring processors
+  TMROctantArray *list = queue->toArray();
+  delete queue;
+  list->sortByTag();
+  TMROctantArray *recv = exchangeOctants(list);
+  delete list;
+
+  // Expand the families of the local, external and received
+  // 0-siblings and retain the locally owned octants
+  for (int k = 0; k < 3; k++) {
+    int size;
+    TMROctant *array;
+    if (k < 2) {
+      elems0[k]->getArray(&array, &size);
+    } else {
+      recv->getArray(&array, &size);
+    }
+
+    for (int i = 0; i < size; i++) {
+      int num_siblings = (array[i].level > 0 ? 8 : 1);
+      for (int j = 0; j < num_siblings; j++) {
+        TMROctant q;
+        array[i].getSibling(j, &q);
+        if (getOctantMPIOwner(&q) == mpi_rank) {
+          hash->addOctant(&q);
+        }
+      }
+    }
+  }
+  delete elems0[0];
+  delete elems0[1];
+  delete recv;
+
+  // Set the elements into the octree
+  octants = hash->toArray();
+  octants->sort();
+  octant_stamp++;
+  delete hash;
+
+  // Get the octants and order their labels
+  int size;
+  TMROctant *array;
+  octants->getArray(&array, &size);
+  for (int i = 0; i < size; i++) {
+    array[i].tag = i;
+  }
+}
+
 /*
   Balance the forest of octrees
 
@@ -2913,8 +4041,15 @@ void TMROctForest::balanceOctant(TMROctant *oct, TMROctantHash *hash,
   of the elements and corner balances across corners. The code always
   balances faces and edges (so that there is at most one depdent node
   per edge) and balances across corners optionally.
+
+  When sparse_balance is set, the inter-processor part of the balance
+  is completed with a single exchange between neighboring processors
+  (see balanceSparse()) instead of the two rounds of all-to-all
+  communication.
 */
-void TMROctForest::balance(int balance_corner) {
+void TMROctForest::balance(int balance_corner, int sparse_balance) {
+  TMR_TRACE_SCOPE("TMROctForest::balance");
+
   if (!octants) {
     fprintf(stderr,
             "TMROctForest Error: Cannot call balance(), "
@@ -2922,47 +4057,27 @@ void TMROctForest::balance(int balance_corner) {
     return;
   }
 
-  // Create a hash table for the balanced tree
-  TMROctantHash *hash = new TMROctantHash();
-  TMROctantHash *ext_hash = new TMROctantHash();
-  TMROctantQueue *queue = new TMROctantQueue();
-
   // Get the array of octants
   int oct_size;
   TMROctant *oct_array;
   octants->getArray(&oct_array, &oct_size);
 
-  // Add all the elements
-  for (int i = 0; i < oct_size; i++) {
-    TMROctant oct;
-    oct_array[i].getSibling(0, &oct);
-
-    // Get the octant owner
-    int owner = getOctantMPIOwner(&oct);
-
-    // Add the owner
-    if (owner == mpi_rank) {
-      hash->addOctant(&oct);
-    } else {
-      ext_hash->addOctant(&oct);
-    }
+  // Create a hash table for the balanced tree
+  TMROctantHash *hash = new TMROctantHash(0, oct_size);
+  TMROctantHash *ext_hash = new TMROctantHash();
 
-    // Balance the octants locally
-    const int balance_tree = 1;
-    balanceOctant(&oct, hash, ext_hash, queue, balance_corner, balance_tree);
-  }
+  // Balance the local octants
+  balanceLocal(oct_array, oct_size, hash, ext_hash, balance_corner);
 
   // Free the original octant array and set it to NULL
   delete octants;
 
-  while (queue->length() > 0) {
-    // Now continue until the queue of added octants is
-    // empty. At each iteration, pop an octant and add
-    // its neighbours until nothing new is added. This code
-    // handles the propagation of octants to adjacent octants.
-    TMROctant oct = queue->pop();
-    const int balance_tree = 1;
-    balanceOctant(&oct, hash, ext_hash, queue, balance_corner, balance_tree);
+  if (sparse_balance) {
+    balanceSparse(hash, ext_hash);
+    if (repartition_tol > 0.0) {
+      repartitionIfImbalanced(repartition_tol);
+    }
+    return;
   }
 
   // Now everything is locally balanced - all the elements on the
@@ -2975,6 +4090,9 @@ void TMROctForest::balance(int balance_corner) {
   delete ext_hash;
   elems0->sort();
 
+  // Create the queue of the parent octants to send
+  TMROctantQueue *queue = new TMROctantQueue();
+
   // Get the array of 0-octants
   int size;
   TMROctant *array;
@@ -3077,6 +4195,7 @@ void TMROctForest::balance(int balance_corner) {
   // Set the elements into the octree
   octants = hash->toArray();
   octants->sort();
+  octant_stamp++;
 
   // Get the octants and order their labels
   octants->getArray(&array, &size);
@@ -3086,100 +4205,599 @@ void TMROctForest::balance(int balance_corner) {
 
   // Free the hash
   delete hash;
+
+  if (repartition_tol > 0.0) {
+    repartitionIfImbalanced(repartition_tol);
+  }
 }
 
 /*
-  Add the octant to the processor queues corresponding to the
-  non-local blocks that touch the given face
-*/
-void TMROctForest::addAdjacentFaceToQueue(int face_index, TMROctant p,
-                                          TMROctantQueue *queue,
-                                          TMROctant orig) {
-  // Determine the global face number
-  int block = p.block;
-  int face = bdata->block_face_conn[6 * block + face_index];
-  int face_id = bdata->block_face_ids[6 * block + face_index];
+  Coarsen the forest by up to the specified number of levels
 
-  // Set the size of the side-length of the octant
-  const int32_t hmax = 1 << TMR_MAX_LEVEL;
-  const int32_t h = 1 << (TMR_MAX_LEVEL - p.level);
+  This produces the forest in a single pass instead of calling
+  coarsen() nlevels times. Each complete family of eight sibling
+  octants is replaced by its parent, and this is repeated until the
+  parent would be more than nlevels coarser than one of the original
+  octants it contains. Octants whose siblings are refined are not
+  coarsened. The partition boundaries of the new forest are first
+  moved so that no family that can be coarsened is split between
+  processors. As with coarsen(), the new forest is not balanced.
 
-  // Get the u/v coordinates of this face
-  int32_t u, v;
-  if (face_index < 2) {  // x-face
-    get_face_oct_coords(face_id, h, p.y, p.z, &u, &v);
-  } else if (face_index < 4) {  // y-face
-    get_face_oct_coords(face_id, h, p.x, p.z, &u, &v);
-  } else {  // z-face
-    get_face_oct_coords(face_id, h, p.x, p.y, &u, &v);
-  }
+  input:
+  nlevels:  the maximum number of levels to coarsen each octant
 
-  // Loop over all the adjacent faces and add the block
-  for (int ip = bdata->face_block_ptr[face];
-       ip < bdata->face_block_ptr[face + 1]; ip++) {
-    // Get the adjacent block and the face index on the adjacent block
-    int adj_block = bdata->face_block_conn[ip] / 6;
-    if (adj_block != block) {
-      // Get the face index on the adjacent block
-      int adj_index = bdata->face_block_conn[ip] % 6;
+  returns:
+  the coarsened forest
+*/
+TMROctForest *TMROctForest::coarsen(int nlevels) {
+  TMROctForest *coarse = new TMROctForest(comm, mesh_order, interp_type);
+  if (bdata) {
+    copyData(coarse);
 
-      // Get the face id for the matching face
-      face_id = bdata->block_face_ids[6 * adj_block + adj_index];
+    // Copy the octants
+    coarse->octants = octants->duplicate();
+    coarse->owners = new TMROctant[mpi_size];
+    memcpy(coarse->owners, owners, sizeof(TMROctant) * mpi_size);
 
-      // Get the neighboring octant on the face
-      TMROctant neighbor;
-      neighbor.block = adj_block;
-      neighbor.level = p.level;
-      neighbor.info = 0;
-      if (adj_index < 2) {
-        neighbor.x = (hmax - h) * (adj_index % 2);
-        set_face_oct_coords(face_id, h, u, v, &neighbor.y, &neighbor.z);
-      } else if (adj_index < 4) {
-        neighbor.y = (hmax - h) * (adj_index % 2);
-        set_face_oct_coords(face_id, h, u, v, &neighbor.x, &neighbor.z);
-      } else {
-        neighbor.z = (hmax - h) * (adj_index % 2);
-        set_face_oct_coords(face_id, h, u, v, &neighbor.x, &neighbor.y);
-      }
+    if (nlevels > 0) {
+      // Align the partition with the families and coarsen them
+      TMROctantArray *coarse_octs;
+      coarse->alignFamilies(nlevels);
+      coarse->coarsenFamilies(nlevels, 0, TMR_MAX_LEVEL + 1, &coarse_octs);
+      delete coarse->octants;
+      coarse->octants = coarse_octs;
+    }
 
-      // Find the octant owner
-      int owner = getOctantMPIOwner(&neighbor);
-      if (owner != mpi_rank) {
-        orig.tag = owner;
-        queue->push(&orig);
-      }
+    // Order the labels of the coarse octants
+    int size;
+    TMROctant *array;
+    coarse->octants->getArray(&array, &size);
+    for (int i = 0; i < size; i++) {
+      array[i].tag = i;
     }
+
+    // Set the owner array
+    TMROctant p;
+    p.block = bdata->num_blocks - 1;
+    p.tag = -1;
+    p.level = 0;
+    p.info = 0;
+    p.x = p.y = p.z = 1 << TMR_MAX_LEVEL;
+    if (size > 0) {
+      p = array[0];
+    }
+    MPI_Allgather(&p, 1, TMROctant_MPI_type, coarse->owners, 1,
+                  TMROctant_MPI_type, comm);
   }
+
+  return coarse;
 }
 
 /*
-  Add the octant to the processor queue corresponding to the non-local
-  blocks that touch the given edge
-*/
-void TMROctForest::addAdjacentEdgeToQueue(int edge_index, TMROctant p,
-                                          TMROctantQueue *queue,
-                                          TMROctant orig) {
-  // First determine the global edge number
-  int block = p.block;
-  int edge = bdata->block_edge_conn[12 * block + edge_index];
-
-  // Compute the edge length
-  const int32_t hmax = 1 << TMR_MAX_LEVEL;
-  const int32_t h = 1 << (TMR_MAX_LEVEL - p.level);
+  Coarsen the forest until it has at most the specified number of
+  elements
+
+  The octants are coarsened by complete families, as in
+  coarsen(nlevels), with the least important families coarsened
+  first. The importance of a family is the largest indicator value of
+  the original octants that it contains. When no indicator is
+  provided, the finest families are coarsened first. The number of
+  levels is increased until the budget can be met, and the importance
+  threshold is then found by bisection. Only the local octants are
+  traversed at each step of the bisection, followed by a reduction of
+  the count. The budget applies to the forest before it is balanced,
+  so the balanced forest may contain more elements.
 
-  // Store the u coordinate along the edge
-  int32_t ucoord = 0;
-  if (edge_index < 4) {
-    ucoord = p.x;
-  } else if (edge_index < 8) {
-    ucoord = p.y;
-  } else {
-    ucoord = p.z;
-  }
+  input:
+  max_elements:  the maximum number of elements in the new forest
+  indicator:     optional importance of each local element (may be NULL)
 
-  // Retrieve the first and second node numbers
-  int n1 = bdata->block_conn[8 * block + block_to_edge_nodes[edge_index][0]];
-  int n2 = bdata->block_conn[8 * block + block_to_edge_nodes[edge_index][1]];
+  returns:
+  the coarsened forest
+*/
+TMROctForest *TMROctForest::coarsenToBudget(int max_elements,
+                                            const double *indicator) {
+  TMROctForest *coarse = new TMROctForest(comm, mesh_order, interp_type);
+  if (bdata) {
+    copyData(coarse);
+
+    // Copy the octants
+    coarse->octants = octants->duplicate();
+    coarse->owners = new TMROctant[mpi_size];
+    memcpy(coarse->owners, owners, sizeof(TMROctant) * mpi_size);
+
+    int size;
+    TMROctant *array;
+    coarse->octants->getArray(&array, &size);
+
+    // Store the importance of each octant in its tag, scaled to
+    // integers in the interval [0, 2^30]
+    int use_priority = 0;
+    int max_priority = TMR_MAX_LEVEL;
+    if (indicator) {
+      double bounds[2] = {-1e300, -1e300};
+      for (int i = 0; i < size; i++) {
+        if (-indicator[i] > bounds[0]) {
+          bounds[0] = -indicator[i];
+        }
+        if (indicator[i] > bounds[1]) {
+          bounds[1] = indicator[i];
+        }
+      }
+      MPI_Allreduce(MPI_IN_PLACE, bounds, 2, MPI_DOUBLE, MPI_MAX, comm);
+
+      use_priority = 1;
+      max_priority = 1 << 30;
+      double scale = 0.0;
+      if (bounds[1] + bounds[0] > 0.0) {
+        scale = max_priority / (bounds[1] + bounds[0]);
+      }
+      for (int i = 0; i < size; i++) {
+        array[i].tag = (int)(scale * (indicator[i] + bounds[0]));
+        if (array[i].tag > max_priority) {
+          array[i].tag = max_priority;
+        }
+      }
+    }
+
+    // Find the total number of octants
+    int count = size;
+    MPI_Allreduce(MPI_IN_PLACE, &count, 1, MPI_INT, MPI_SUM, comm);
+
+    if (count > max_elements) {
+      // Find the number of levels required to meet the budget
+      int nlevels = 0;
+      int threshold = max_priority + 1;
+      while (count > max_elements && nlevels < TMR_MAX_LEVEL) {
+        nlevels++;
+        coarse->alignFamilies(nlevels);
+        int new_count =
+            coarse->coarsenFamilies(nlevels, use_priority, threshold, NULL);
+        MPI_Allreduce(MPI_IN_PLACE, &new_count, 1, MPI_INT, MPI_SUM, comm);
+
+        // Coarsening by more levels will not reduce the count further
+        if (new_count == count) {
+          break;
+        }
+        count = new_count;
+      }
+
+      // Find the smallest threshold that meets the budget. The count
+      // is non-increasing with the threshold.
+      if (count <= max_elements) {
+        int low = 0, high = threshold;
+        while (high - low > 1) {
+          int mid = low + (high - low) / 2;
+          int new_count =
+              coarse->coarsenFamilies(nlevels, use_priority, mid, NULL);
+          MPI_Allreduce(MPI_IN_PLACE, &new_count, 1, MPI_INT, MPI_SUM, comm);
+          if (new_count <= max_elements) {
+            high = mid;
+          } else {
+            low = mid;
+          }
+        }
+        threshold = high;
+      }
+
+      TMROctantArray *coarse_octs;
+      coarse->coarsenFamilies(nlevels, use_priority, threshold, &coarse_octs);
+      delete coarse->octants;
+      coarse->octants = coarse_octs;
+    }
+
+    // Order the labels of the coarse octants
+    coarse->octants->getArray(&array, &size);
+    for (int i = 0; i < size; i++) {
+      array[i].tag = i;
+    }
+
+    // Set the owner array
+    TMROctant p;
+    p.block = bdata->num_blocks - 1;
+    p.tag = -1;
+    p.level = 0;
+    p.info = 0;
+    p.x = p.y = p.z = 1 << TMR_MAX_LEVEL;
+    if (size > 0) {
+      p = array[0];
+    }
+    MPI_Allgather(&p, 1, TMROctant_MPI_type, coarse->owners, 1,
+                  TMROctant_MPI_type, comm);
+  }
+
+  return coarse;
+}
+
+/*
+  Move the partition boundaries so that the families coarsened by
+  coarsenFamilies() are not split between processors
+
+  Any family that is coarsened by at most nlevels and that contains
+  the first octant on a processor is contained in the ancestor of
+  that octant that is nlevels coarser. The boundary is therefore moved
+  back to the start of this ancestor. The tags of the octants are
+  retained.
+
+  input:
+  nlevels:  the maximum number of levels that octants are coarsened
+*/
+void TMROctForest::alignFamilies(int nlevels) {
+  int size;
+  TMROctant *array;
+  octants->getArray(&array, &size);
+
+  // Find the coarse ancestor of the first local octant
+  TMROctant a;
+  a.block = -1;
+  a.tag = a.level = a.info = 0;
+  a.x = a.y = a.z = 0;
+  if (size > 0) {
+    a = array[0];
+    a.level = (a.level > nlevels ? a.level - nlevels : 0);
+    a.info = 0;
+    const int32_t h = 1 << (TMR_MAX_LEVEL - a.level);
+    a.x = a.x - (a.x % h);
+    a.y = a.y - (a.y % h);
+    a.z = a.z - (a.z % h);
+  }
+  TMROctant *ancestors = new TMROctant[mpi_size];
+  MPI_Allgather(&a, 1, TMROctant_MPI_type, ancestors, 1, TMROctant_MPI_type,
+                comm);
+
+  // Compute the current offsets of the octants
+  int *ptr = new int[mpi_size + 1];
+  int *new_ptr = new int[mpi_size + 1];
+  MPI_Allgather(&size, 1, MPI_INT, &ptr[1], 1, MPI_INT, comm);
+  ptr[0] = 0;
+  for (int k = 0; k < mpi_size; k++) {
+    ptr[k + 1] += ptr[k];
+  }
+
+  // Count the number of local octants that precede each ancestor
+  memset(new_ptr, 0, (mpi_size + 1) * sizeof(int));
+  for (int k = 1; k < mpi_size; k++) {
+    if (ancestors[k].block < 0) {
+      continue;
+    }
+    int low = 0, high = size;
+    while (low < high) {
+      int mid = low + (high - low) / 2;
+      if (array[mid].compare(&ancestors[k]) < 0) {
+        low = mid + 1;
+      } else {
+        high = mid;
+      }
+    }
+    new_ptr[k] = low;
+  }
+  MPI_Allreduce(MPI_IN_PLACE, new_ptr, mpi_size + 1, MPI_INT, MPI_SUM, comm);
+
+  // Processors without octants keep their boundary. Ensure that the
+  // new offsets are non-decreasing.
+  new_ptr[0] = 0;
+  new_ptr[mpi_size] = ptr[mpi_size];
+  for (int k = mpi_size - 1; k > 0; k--) {
+    if (ancestors[k].block < 0) {
+      new_ptr[k] = ptr[k];
+    }
+    if (new_ptr[k] > new_ptr[k + 1]) {
+      new_ptr[k] = new_ptr[k + 1];
+    }
+  }
+  delete[] ancestors;
+
+  // Move the octants if any boundary has changed
+  int changed = 0;
+  for (int k = 0; k <= mpi_size; k++) {
+    if (new_ptr[k] != ptr[k]) {
+      changed = 1;
+    }
+  }
+  if (changed) {
+    repartitionOctants(ptr, new_ptr, 0);
+  }
+
+  delete[] ptr;
+  delete[] new_ptr;
+}
+
+/*
+  Coarsen the complete families of the local octants
+
+  The sorted octants are pushed onto a stack. Whenever the top eight
+  entries are a complete family of siblings, they are replaced by
+  their parent, provided that the parent is at most nlevels coarser
+  than the original octants and the importance of the family is less
+  than the threshold. This coarsens across multiple levels in a single
+  pass.
+
+  input:
+  nlevels:       the maximum number of levels to coarsen
+  use_priority:  use the importance stored in the tags, otherwise the
+                 finest families are the least important
+  threshold:     only coarsen families with importance below this value
+
+  output:
+  coarse:        the coarse octants (may be NULL)
+
+  returns:
+  the number of local coarse octants
+*/
+int TMROctForest::coarsenFamilies(int nlevels, int use_priority,
+                                  int threshold, TMROctantArray **coarse) {
+  int size;
+  TMROctant *array;
+  octants->getArray(&array, &size);
+
+  // The stack of octants and the number of levels each was coarsened.
+  // The importance of each entry is stored in its tag.
+  TMROctant *stack = new TMROctant[size > 0 ? size : 1];
+  int *depth = new int[size > 0 ? size : 1];
+  int top = 0;
+
+  for (int i = 0; i < size; i++) {
+    stack[top] = array[i];
+    if (!use_priority) {
+      stack[top].tag = TMR_MAX_LEVEL - array[i].level;
+    }
+    depth[top] = 0;
+    top++;
+
+    // Coarsen the families at the top of the stack
+    while (top >= 8) {
+      TMROctant *fam = &stack[top - 8];
+      const int level = fam[0].level;
+      if (level == 0) {
+        break;
+      }
+
+      // Check whether the top entries are a complete family. Since the
+      // entries are distinct, this is the case when they all have the
+      // same level and parent.
+      TMROctant p;
+      fam[0].parent(&p);
+      int is_family = 1;
+      int max_depth = 0, priority = 0;
+      for (int j = 0; j < 8 && is_family; j++) {
+        TMROctant q;
+        fam[j].parent(&q);
+        if (fam[j].level != level || q.comparePosition(&p) != 0) {
+          is_family = 0;
+        }
+        if (depth[top - 8 + j] > max_depth) {
+          max_depth = depth[top - 8 + j];
+        }
+        if (fam[j].tag > priority) {
+          priority = fam[j].tag;
+        }
+      }
+      if (!is_family || max_depth >= nlevels || priority >= threshold) {
+        break;
+      }
+
+      // Replace the family with its parent
+      top -= 8;
+      p.info = 0;
+      p.tag = (use_priority ? priority : TMR_MAX_LEVEL - p.level);
+      stack[top] = p;
+      depth[top] = max_depth + 1;
+      top++;
+    }
+  }
+
+  if (coarse) {
+    TMROctant *coarse_array = new TMROctant[top > 0 ? top : 1];
+    memcpy(coarse_array, stack, top * sizeof(TMROctant));
+    *coarse = new TMROctantArray(coarse_array, top);
+  }
+
+  delete[] stack;
+  delete[] depth;
+
+  return top;
+}
+
+/*
+  Refine the octree mesh to the target levels and balance it
+
+  This produces the same mesh as refine() followed by balance() with a
+  sparse exchange, but the refined octants are never formed. Instead,
+  the 0-siblings at the target level that cover each element (or the
+  0-sibling of its ancestor, when the element is coarsened) are used
+  directly as the seeds for the local balance. The balanced set is
+  then completed with the single exchange in balanceSparse(). This
+  avoids the intermediate hash table, sort and redistribution of the
+  full set of refined octants, which is 8 times larger than the set of
+  seeds.
+
+  input:
+  target_levels:   the target level for each local element
+  balance_corner:  balance across corners
+*/
+void TMROctForest::refineAndBalance(const int target_levels[],
+                                    int balance_corner) {
+  if (!octants) {
+    fprintf(stderr,
+            "TMROctForest Error: Cannot call refineAndBalance(), "
+            "no octants have been created\n");
+    return;
+  }
+
+  // Free the mesh data
+  freeMeshData(0, 0);
+
+  int size;
+  TMROctant *array;
+  octants->getArray(&array, &size);
+
+  // Count up the number of seed octants
+  int num_seeds = 0;
+  for (int i = 0; i < size; i++) {
+    int level = target_levels[i];
+    if (level < 0) {
+      level = 0;
+    } else if (level > TMR_MAX_LEVEL) {
+      level = TMR_MAX_LEVEL;
+    }
+    if (level > array[i].level) {
+      num_seeds += 1 << (3 * (level - array[i].level - 1));
+    } else {
+      num_seeds++;
+    }
+  }
+
+  // Create the 0-siblings at the target level
+  TMROctant *seeds = new TMROctant[num_seeds];
+  num_seeds = 0;
+  for (int i = 0; i < size; i++) {
+    int level = target_levels[i];
+    if (level < 0) {
+      level = 0;
+    } else if (level > TMR_MAX_LEVEL) {
+      level = TMR_MAX_LEVEL;
+    }
+
+    // Copy the octant and set the new level
+    TMROctant oct = array[i];
+    oct.level = level;
+    oct.info = 0;
+
+    // Compute the new side-length of the octant and find the
+    // 0-sibling of the first octant at the new level
+    const int32_t h = 1 << (TMR_MAX_LEVEL - oct.level);
+    oct.x = oct.x - (oct.x % h);
+    oct.y = oct.y - (oct.y % h);
+    oct.z = oct.z - (oct.z % h);
+    oct.getSibling(0, &oct);
+    const int32_t x = oct.x, y = oct.y, z = oct.z;
+
+    // Add the 0-siblings within the element
+    const int ref = (level > array[i].level ? 1 << (level - array[i].level - 1)
+                                            : 1);
+    for (int ii = 0; ii < ref; ii++) {
+      for (int jj = 0; jj < ref; jj++) {
+        for (int kk = 0; kk < ref; kk++) {
+          seeds[num_seeds] = oct;
+          seeds[num_seeds].x = x + 2 * ii * h;
+          seeds[num_seeds].y = y + 2 * jj * h;
+          seeds[num_seeds].z = z + 2 * kk * h;
+          num_seeds++;
+        }
+      }
+    }
+  }
+
+  // Free the original octants
+  delete octants;
+  octants = NULL;
+
+  // Balance the seeds locally and then complete the balance with a
+  // single exchange between neighboring processors
+  TMROctantHash *hash = new TMROctantHash(0, num_seeds);
+  TMROctantHash *ext_hash = new TMROctantHash();
+  balanceLocal(seeds, num_seeds, hash, ext_hash, balance_corner);
+  delete[] seeds;
+
+  balanceSparse(hash, ext_hash);
+
+  if (repartition_tol > 0.0) {
+    repartitionIfImbalanced(repartition_tol);
+  }
+}
+
+/*
+  Add the octant to the processor queues corresponding to the
+  non-local blocks that touch the given face
+*/
+void TMROctForest::addAdjacentFaceToQueue(int face_index, TMROctant p,
+                                          TMROctantQueue *queue,
+                                          TMROctant orig) {
+  // Determine the global face number
+  int block = p.block;
+  int face = bdata->block_face_conn[6 * block + face_index];
+  int face_id = bdata->block_face_ids[6 * block + face_index];
+
+  // Set the size of the side-length of the octant
+  const int32_t hmax = 1 << TMR_MAX_LEVEL;
+  const int32_t h = 1 << (TMR_MAX_LEVEL - p.level);
+
+  // Get the u/v coordinates of this face
+  int32_t u, v;
+  if (face_index < 2) {  // x-face
+    get_face_oct_coords(face_id, h, p.y, p.z, &u, &v);
+  } else if (face_index < 4) {  // y-face
+    get_face_oct_coords(face_id, h, p.x, p.z, &u, &v);
+  } else {  // z-face
+    get_face_oct_coords(face_id, h, p.x, p.y, &u, &v);
+  }
+
+  // Loop over all the adjacent faces and add the block
+  for (int ip = bdata->face_block_ptr[face];
+       ip < bdata->face_block_ptr[face + 1]; ip++) {
+    // Get the adjacent block and the face index on the adjacent block
+    int adj_block = bdata->face_block_conn[ip] / 6;
+    if (adj_block != block) {
+      // Get the face index on the adjacent block
+      int adj_index = bdata->face_block_conn[ip] % 6;
+
+      // Get the face id for the matching face
+      face_id = bdata->block_face_ids[6 * adj_block + adj_index];
+
+      // Get the neighboring octant on the face
+      TMROctant neighbor;
+      neighbor.block = adj_block;
+      neighbor.level = p.level;
+      neighbor.info = 0;
+      if (adj_index < 2) {
+        neighbor.x = (hmax - h) * (adj_index % 2);
+        set_face_oct_coords(face_id, h, u, v, &neighbor.y, &neighbor.z);
+      } else if (adj_index < 4) {
+        neighbor.y = (hmax - h) * (adj_index % 2);
+        set_face_oct_coords(face_id, h, u, v, &neighbor.x, &neighbor.z);
+      } else {
+        neighbor.z = (hmax - h) * (adj_index % 2);
+        set_face_oct_coords(face_id, h, u, v, &neighbor.x, &neighbor.y);
+      }
+
+      // Find the octant owner
+      int owner = getOctantMPIOwner(&neighbor);
+      if (owner != mpi_rank) {
+        orig.tag = owner;
+        queue->push(&orig);
+      }
+    }
+  }
+}
+
+/*
+  Add the octant to the processor queue corresponding to the non-local
+  blocks that touch the given edge
+*/
+void TMROctForest::addAdjacentEdgeToQueue(int edge_index, TMROctant p,
+                                          TMROctantQueue *queue,
+                                          TMROctant orig) {
+  // First determine the global edge number
+  int block = p.block;
+  int edge = bdata->block_edge_conn[12 * block + edge_index];
+
+  // Compute the edge length
+  const int32_t hmax = 1 << TMR_MAX_LEVEL;
+  const int32_t h = 1 << (TMR_MAX_LEVEL - p.level);
+
+  // Store the u coordinate along the edge
+  int32_t ucoord = 0;
+  if (edge_index < 4) {
+    ucoord = p.x;
+  } else if (edge_index < 8) {
+    ucoord = p.y;
+  } else {
+    ucoord = p.z;
+  }
+
+  // Retrieve the first and second node numbers
+  int n1 = bdata->block_conn[8 * block + block_to_edge_nodes[edge_index][0]];
+  int n2 = bdata->block_conn[8 * block + block_to_edge_nodes[edge_index][1]];
 
   // Now, cycle through all the adjacent faces
   for (int ip = bdata->edge_block_ptr[edge];
@@ -3288,7 +4906,28 @@ void TMROctForest::computeAdjacentOctants() {
   if (adjacent) {
     delete adjacent;
   }
+  if (adjacent_keys) {
+    delete adjacent_keys;
+  }
+  adjacent = NULL;
+  adjacent_keys = NULL;
+
+  // Exchange the octants
+  adjacent = exchangeAdjacentOctants();
+
+  // Convert the adjacent octants to the compact form if possible
+  if (use_compact_storage && TMROctantKeyArray::canStore(adjacent)) {
+    adjacent_keys = new TMROctantKeyArray(adjacent);
+    delete adjacent;
+    adjacent = NULL;
+  }
+}
 
+/*
+  Find the sorted array of the octants on other processors that touch
+  a face, edge or corner of one of the local octants
+*/
+TMROctantArray *TMROctForest::exchangeAdjacentOctants() {
   // Allocate the queue that stores the octants destined for each of
   // the processors
   TMROctantQueue *queue = new TMROctantQueue();
@@ -3439,19 +5078,298 @@ void TMROctForest::computeAdjacentOctants() {
   TMROctantArray *list = queue->toArray();
   delete queue;
 
-  list->getArray(&array, &size);
-  qsort(array, size, sizeof(TMROctant), compare_octant_tags);
+  list->sortByTag();
 
   // Distribute the octants
   int use_tags = 1;
-  adjacent = distributeOctants(list, use_tags);
-  adjacent->sort();
+  addTransient(list->getMemoryUsage());
+  TMROctantArray *adj = distributeOctants(list, use_tags);
+  adj->sort();
 
+  removeTransient(list->getMemoryUsage());
   delete list;
+
+  return adj;
 }
 
 /*
-  Determine if there is an adjacent octant on the connecting face.
+  Compute the ghost layer and the neighbors of each local element
+
+  The ghost layer consists of the octants on other processors that
+  touch a face, edge or corner of a local octant. The global element
+  number of each ghost octant is retrieved from its owner.
+
+  The neighbors are found from the 26 points on the boundary of each
+  local and ghost octant: the corners, the edge midpoints and the face
+  centers. These points are transformed to the global coordinate
+  system, so that neighbors in adjacent blocks are found without any
+  special treatment. Since the forest is 2:1 balanced, two octants
+  touch only if they share at least one of these points. The number
+  of shared points determines the type of neighbor: at least 4 for a
+  face, 2 or 3 for an edge and 1 for a corner.
+
+  The neighbors are stored in CSR form. Neighbor indices less than the
+  number of local elements refer to local elements, otherwise they
+  refer to the ghost octants offset by the number of local elements.
+  The data is freed whenever the octants change.
+*/
+void TMROctForest::computeElementNeighbors() {
+  if (!octants) {
+    fprintf(stderr,
+            "TMROctForest Error: Cannot call computeElementNeighbors(), "
+            "no octants have been created\n");
+    return;
+  }
+  freeElementNeighbors();
+
+  int size;
+  TMROctant *array;
+  octants->getArray(&array, &size);
+
+  // Exchange the octants that form the ghost layer
+  ghosts = exchangeAdjacentOctants();
+  int num_ghosts;
+  TMROctant *ghost_array;
+  ghosts->getArray(&ghost_array, &num_ghosts);
+
+  // Find the element offset on each processor
+  int *elem_range = new int[mpi_size + 1];
+  elem_range[0] = 0;
+  MPI_Allgather(&size, 1, MPI_INT, &elem_range[1], 1, MPI_INT, comm);
+  for (int k = 0; k < mpi_size; k++) {
+    elem_range[k + 1] += elem_range[k];
+  }
+
+  // Send the ghost octants to their owners, which set the global
+  // element number in the tag and send them back in the same order
+  int *oct_ptr, *oct_recv_ptr;
+  TMROctantArray *list = ghosts->duplicate();
+  TMROctantArray *dist = distributeOctants(list, 0, &oct_ptr, &oct_recv_ptr);
+  delete list;
+
+  int dist_size;
+  TMROctant *dist_array;
+  dist->getArray(&dist_array, &dist_size);
+  TMROctant **found = new TMROctant *[dist_size];
+  octants->containsMany(dist_size, dist_array, found);
+  for (int i = 0; i < dist_size; i++) {
+    TMROctant *t = found[i];
+    dist_array[i].tag = (t ? elem_range[mpi_rank] + (t - array) : -1);
+  }
+  delete[] found;
+  list = sendOctants(dist, oct_recv_ptr, oct_ptr);
+  delete dist;
+  delete[] oct_ptr;
+  delete[] oct_recv_ptr;
+  delete[] elem_range;
+
+  TMROctant *list_array;
+  list->getArray(&list_array, NULL);
+  ghost_elems = new int[num_ghosts];
+  for (int i = 0; i < num_ghosts; i++) {
+    ghost_elems[i] = list_array[i].tag;
+  }
+  delete list;
+
+  // Create the boundary points of all the local and ghost octants
+  const int num_elems = size + num_ghosts;
+  TMROctant *pts = new TMROctant[26 * num_elems];
+  int num_pts = 0;
+  for (int i = 0; i < num_elems; i++) {
+    const TMROctant *oct = (i < size ? &array[i] : &ghost_array[i - size]);
+    const int32_t h = (1 << (TMR_MAX_LEVEL - oct->level)) / 2;
+    for (int kk = 0; kk < 3; kk++) {
+      for (int jj = 0; jj < 3; jj++) {
+        for (int ii = 0; ii < 3; ii++) {
+          if (ii == 1 && jj == 1 && kk == 1) {
+            continue;
+          }
+          TMROctant p;
+          p.block = oct->block;
+          p.x = oct->x + ii * h;
+          p.y = oct->y + jj * h;
+          p.z = oct->z + kk * h;
+          transformNode(&p);
+          p.level = 0;
+          p.info = 0;
+          p.tag = i;
+          pts[num_pts] = p;
+          num_pts++;
+        }
+      }
+    }
+  }
+  qsort(pts, num_pts, sizeof(TMROctant), compare_node_tags);
+
+  // Count the pairs of octants that share a point, where the first
+  // octant is a local octant
+  int num_pairs = 0;
+  for (int start = 0, end = 0; start < num_pts; start = end) {
+    int num_local = 0;
+    for (end = start; end < num_pts && pts[end].compareNode(&pts[start]) == 0;
+         end++) {
+      if (pts[end].tag < size) {
+        num_local++;
+      }
+    }
+    num_pairs += num_local * (end - start - 1);
+  }
+
+  int *pairs = new int[2 * (num_pairs > 0 ? num_pairs : 1)];
+  num_pairs = 0;
+  for (int start = 0, end = 0; start < num_pts; start = end) {
+    for (end = start; end < num_pts && pts[end].compareNode(&pts[start]) == 0;
+         end++);
+    for (int j = start; j < end && pts[j].tag < size; j++) {
+      for (int k = start; k < end; k++) {
+        if (pts[k].tag != pts[j].tag) {
+          pairs[2 * num_pairs] = pts[j].tag;
+          pairs[2 * num_pairs + 1] = pts[k].tag;
+          num_pairs++;
+        }
+      }
+    }
+  }
+  delete[] pts;
+  qsort(pairs, num_pairs, 2 * sizeof(int), compare_integer_pairs);
+
+  // Create the CSR data structure from the number of shared points
+  neighbor_ptr = new int[size + 1];
+  memset(neighbor_ptr, 0, (size + 1) * sizeof(int));
+  int num_neighbors = 0;
+  for (int i = 0; i < num_pairs; num_neighbors++) {
+    int j = i;
+    while (j < num_pairs && pairs[2 * j] == pairs[2 * i] &&
+           pairs[2 * j + 1] == pairs[2 * i + 1]) {
+      j++;
+    }
+    neighbor_ptr[pairs[2 * i] + 1]++;
+    i = j;
+  }
+  for (int i = 0; i < size; i++) {
+    neighbor_ptr[i + 1] += neighbor_ptr[i];
+  }
+
+  neighbor_conn = new int[num_neighbors];
+  neighbor_types = new int[num_neighbors];
+  for (int i = 0, n = 0; i < num_pairs; n++) {
+    int j = i;
+    while (j < num_pairs && pairs[2 * j] == pairs[2 * i] &&
+           pairs[2 * j + 1] == pairs[2 * i + 1]) {
+      j++;
+    }
+    neighbor_conn[n] = pairs[2 * i + 1];
+    if (j - i >= 4) {
+      neighbor_types[n] = TMR_FACE_NEIGHBOR;
+    } else if (j - i >= 2) {
+      neighbor_types[n] = TMR_EDGE_NEIGHBOR;
+    } else {
+      neighbor_types[n] = TMR_CORNER_NEIGHBOR;
+    }
+    i = j;
+  }
+  delete[] pairs;
+}
+
+/*
+  Get the ghost layer of octants from other processors
+
+  Note that computeElementNeighbors() must be called first.
+
+  output:
+  ghosts:       the sorted ghost octants
+  ghost_elems:  the global element number of each ghost octant
+
+  returns:
+  the number of ghost octants
+*/
+int TMROctForest::getGhostOctants(TMROctantArray **_ghosts,
+                                  const int **_ghost_elems) {
+  int num_ghosts = 0;
+  if (ghosts) {
+    ghosts->getArray(NULL, &num_ghosts);
+  }
+  if (_ghosts) {
+    *_ghosts = ghosts;
+  }
+  if (_ghost_elems) {
+    *_ghost_elems = ghost_elems;
+  }
+  return num_ghosts;
+}
+
+/*
+  Get the face, edge and corner neighbors of each local element
+
+  Note that computeElementNeighbors() must be called first.
+
+  output:
+  ptr:    pointer into the neighbors of each local element
+  conn:   the local element or the ghost octant index plus the number
+          of local elements
+  types:  the type of each neighbor (face, edge or corner)
+
+  returns:
+  the number of local elements
+*/
+int TMROctForest::getElementNeighbors(const int **_ptr, const int **_conn,
+                                      const int **_types) {
+  int size = 0;
+  if (neighbor_ptr && octants) {
+    octants->getArray(NULL, &size);
+  }
+  if (_ptr) {
+    *_ptr = neighbor_ptr;
+  }
+  if (_conn) {
+    *_conn = neighbor_conn;
+  }
+  if (_types) {
+    *_types = neighbor_types;
+  }
+  return size;
+}
+
+/*
+  Free the ghost layer and the element neighbors
+*/
+void TMROctForest::freeElementNeighbors() {
+  if (ghosts) {
+    delete ghosts;
+  }
+  if (ghost_elems) {
+    delete[] ghost_elems;
+  }
+  if (neighbor_ptr) {
+    delete[] neighbor_ptr;
+  }
+  if (neighbor_conn) {
+    delete[] neighbor_conn;
+  }
+  if (neighbor_types) {
+    delete[] neighbor_types;
+  }
+  ghosts = NULL;
+  ghost_elems = NULL;
+  neighbor_ptr = NULL;
+  neighbor_conn = NULL;
+  neighbor_types = NULL;
+}
+
+/*
+  Check whether the octant is one of the adjacent octants
+*/
+int TMROctForest::containsAdjacent(TMROctant *oct) {
+  if (adjacent) {
+    return (adjacent->contains(oct) != NULL);
+  } else if (adjacent_keys) {
+    return (adjacent_keys->findIndex(oct) >= 0);
+  }
+  return 0;
+}
+
+/*
+  Determine if there is an adjacent octant on the connecting face.
 
   Return true if an adjacent face is found across a block-face and
   false if no octant is found.
@@ -3511,7 +5429,7 @@ int TMROctForest::checkAdjacentFaces(int face_index, TMROctant *neighbor) {
 
       // If the more-refined element exists then label the
       // corresponding nodes as dependent
-      if (octants->contains(&oct) || (adjacent && adjacent->contains(&oct))) {
+      if (octants->contains(&oct) || containsAdjacent(&oct)) {
         return 1;
       }
     }
@@ -3595,7 +5513,7 @@ int TMROctForest::checkAdjacentEdges(int edge_index, TMROctant *neighbor) {
 
       // If the more-refined element exists then label the
       // corresponding nodes as dependent
-      if (octants->contains(&oct) || (adjacent && adjacent->contains(&oct))) {
+      if (octants->contains(&oct) || containsAdjacent(&oct)) {
         return 1;
       }
     }
@@ -3649,8 +5567,7 @@ void TMROctForest::computeDepFacesAndEdges() {
         if ((neighbor.x >= 0 && neighbor.x < hmax) &&
             (neighbor.y >= 0 && neighbor.y < hmax) &&
             (neighbor.z >= 0 && neighbor.z < hmax)) {
-          if (octants->contains(&neighbor) ||
-              (adjacent && adjacent->contains(&neighbor))) {
+          if (octants->contains(&neighbor) || containsAdjacent(&neighbor)) {
             face_info |= 1 << face_index;
           }
         } else if (checkAdjacentFaces(face_index, &neighbor)) {
@@ -3686,8 +5603,7 @@ void TMROctForest::computeDepFacesAndEdges() {
             edge_info |= 1 << edge_index;
           }
         } else {
-          if (octants->contains(&neighbor) ||
-              (adjacent && adjacent->contains(&neighbor))) {
+          if (octants->contains(&neighbor) || containsAdjacent(&neighbor)) {
             edge_info |= 1 << edge_index;
           }
         }
@@ -3837,6 +5753,8 @@ void TMROctForest::labelDependentNodes(int *nodes) {
 
   This transforms the given octant to the coordinate system of the
   lowest octant touching this node if it is on an octree boundary.
+  The transformation is looked up from the table computed in
+  computeBlockTransforms().
 
   input (optional):
   edge_dir:    -1 (for no direction) 0, 1, 2 for x,y,z
@@ -3866,161 +5784,45 @@ void TMROctForest::transformNode(TMROctant *oct, int edge_dir,
   }
 
   if (fx || fy || fz) {
-    // Get the original block index
-    int block = oct->block;
-
+    // Find the index of the face, edge or corner within the block
+    // transformations: faces are 0-5, edges 6-17 and corners 18-25
+    int index = 0;
     if (fx && fy && fz) {
-      // This node lies on a corner
-      int corner = (fx0 ? 0 : 1) + (fy0 ? 0 : 2) + (fz0 ? 0 : 4);
-      int node = bdata->block_conn[8 * block + corner];
-
-      // Transform the octant to each other octree frame and check
-      // which processor owns it
-      if (block != bdata->node_block_owners[node]) {
-        int ptr = bdata->node_block_ptr[node];
-        int adj = bdata->node_block_conn[ptr] / 8;
-        int adj_index = bdata->node_block_conn[ptr] % 8;
-
-        oct->block = adj;
-        oct->x = hmax * (adj_index % 2);
-        oct->y = hmax * ((adj_index % 4) / 2);
-        oct->z = hmax * (adj_index / 4);
-      }
-    } else if ((fy && fz) || (fx && fz) || (fx && fy)) {
-      // This node lies on an edge
-      int edge_index = 0;
-      int32_t u = 0;
-      if (fy && fz) {
-        edge_index = (fy0 ? 0 : 1) + (fz0 ? 0 : 2);
-        u = oct->x;
-      } else if (fx && fz) {
-        edge_index = (fx0 ? 4 : 5) + (fz0 ? 0 : 2);
-        u = oct->y;
-      } else {
-        edge_index = (fx0 ? 8 : 9) + (fy0 ? 0 : 2);
-        u = oct->z;
-      }
-
-      // Get the edge number
-      int edge = bdata->block_edge_conn[12 * block + edge_index];
-
-      // Check that the edge is not the block owner
-      if (block != bdata->edge_block_owners[edge]) {
-        int ptr = bdata->edge_block_ptr[edge];
-        int adj = bdata->edge_block_conn[ptr] / 12;
-        int adj_index = bdata->edge_block_conn[ptr] % 12;
-
-        // Retrieve the first and second node numbers to determine the
-        // relative orientation between this edge and each adjacent edge
-        int n1 =
-            bdata->block_conn[8 * block + block_to_edge_nodes[edge_index][0]];
-        int n2 =
-            bdata->block_conn[8 * block + block_to_edge_nodes[edge_index][1]];
-
-        int nn1 =
-            bdata->block_conn[8 * adj + block_to_edge_nodes[adj_index][0]];
-        int nn2 =
-            bdata->block_conn[8 * adj + block_to_edge_nodes[adj_index][1]];
-
-        // Determine whether the edges are in the same direction
-        // or are reversed
-        int reverse = (n1 == nn2 && n2 == nn1);
-        if (edge_reversed) {
-          *edge_reversed = reverse;
-        }
-
-        // Set the u-coordinate along the edge
-        int32_t uoct = u;
-        if (reverse) {
-          uoct = hmax - u;
-        }
-
-        // Transform the octant to the adjacent coordinate system
-        oct->block = adj;
-        if (adj_index < 4) {
-          oct->x = uoct;
-          oct->y = hmax * (adj_index % 2);
-          oct->z = hmax * (adj_index / 2);
-        } else if (adj_index < 8) {
-          oct->x = hmax * (adj_index % 2);
-          oct->y = uoct;
-          oct->z = hmax * ((adj_index - 4) / 2);
-        } else {
-          oct->x = hmax * (adj_index % 2);
-          oct->y = hmax * ((adj_index - 8) / 2);
-          oct->z = uoct;
-        }
-      }
+      index = 18 + (fx0 ? 0 : 1) + (fy0 ? 0 : 2) + (fz0 ? 0 : 4);
+    } else if (fy && fz) {
+      index = 6 + (fy0 ? 0 : 1) + (fz0 ? 0 : 2);
+    } else if (fx && fz) {
+      index = 6 + (fx0 ? 4 : 5) + (fz0 ? 0 : 2);
+    } else if (fx && fy) {
+      index = 6 + (fx0 ? 8 : 9) + (fy0 ? 0 : 2);
     } else {
-      // Which face index are we dealing with?
-      int face_index =
-          fx * (fx0 ? 0 : 1) + fy * (fy0 ? 2 : 3) + fz * (fz0 ? 4 : 5);
-
-      // Get the face owner
-      int face = bdata->block_face_conn[6 * block + face_index];
-
-      // Get the face owner
-      if (block != bdata->face_block_owners[face]) {
-        // Get source face id number. Note that this is the transformation
-        // from the source face to its owner
-        int face_id = bdata->block_face_ids[6 * block + face_index];
-        if (src_face_id) {
-          *src_face_id = face_id;
-        }
-
-        // Get the u/v coordinates for this node on the owner face
-        int32_t u, v;
-        if (face_index < 2) {  // x-face
-          get_face_node_coords(face_id, hmax, oct->y, oct->z, &u, &v);
-        } else if (face_index < 4) {  // y-face
-          get_face_node_coords(face_id, hmax, oct->x, oct->z, &u, &v);
-        } else {  // z-face
-          get_face_node_coords(face_id, hmax, oct->x, oct->y, &u, &v);
-        }
-
-        // Compute the edge_reversed flag (if needed)
-        if (edge_reversed) {
-          *edge_reversed = 0;
-          int32_t x = 0, y = 0, z = 0;
-          if (edge_dir == 0) {
-            x = 1;
-          } else if (edge_dir == 1) {
-            y = 1;
-          } else if (edge_dir == 2) {
-            z = 1;
-          }
-          if (face_index < 2) {  // x-face
-            get_face_node_coords(face_id, 0, y, z, &y, &z);
-          } else if (face_index < 4) {  // y-face
-            get_face_node_coords(face_id, 0, x, z, &x, &z);
-          } else {  // z-face
-            get_face_node_coords(face_id, 0, x, y, &x, &y);
-          }
-          if (x < 0 || y < 0 || z < 0) {
-            *edge_reversed = 1;
-          }
+      index = fx * (fx0 ? 0 : 1) + fy * (fy0 ? 2 : 3) + fz * (fz0 ? 4 : 5);
+    }
+
+    // Transform the node to the block that owns the entity
+    const TMRBlockConn::Transform *t =
+        &bdata->block_transforms[TMRBlockConn::NUM_BLOCK_TRANSFORMS *
+                                     oct->block +
+                                 index];
+    if (t->adj >= 0) {
+      const int32_t x = oct->x, y = oct->y, z = oct->z;
+      oct->block = t->adj;
+      oct->x = (t->A[0] * x + t->A[1] * y + t->A[2] * z) + hmax * t->b[0];
+      oct->y = (t->A[3] * x + t->A[4] * y + t->A[5] * z) + hmax * t->b[1];
+      oct->z = (t->A[6] * x + t->A[7] * y + t->A[8] * z) + hmax * t->b[2];
+
+      if (index < 6) {
+        // The edge direction is reversed if it maps to a negative
+        // direction on the owner face
+        if (edge_reversed && edge_dir >= 0 && edge_dir < 3) {
+          *edge_reversed = (t->A[edge_dir] < 0 || t->A[3 + edge_dir] < 0 ||
+                            t->A[6 + edge_dir] < 0);
         }
-
-        // Now find the owner block
-        int ptr = bdata->face_block_ptr[face];
-        int adj = bdata->face_block_conn[ptr] / 6;
-        int adj_index = bdata->face_block_conn[ptr] % 6;
-
-        // Transform the octant p to the local octant coordinates
-        oct->block = adj;
-        if (adj_index < 2) {
-          oct->x = hmax * (adj_index % 2);
-          oct->y = u;
-          oct->z = v;
-        } else if (adj_index < 4) {
-          oct->x = u;
-          oct->y = hmax * (adj_index % 2);
-          oct->z = v;
-        } else {
-          oct->x = u;
-          oct->y = v;
-          oct->z = hmax * (adj_index % 2);
+        if (src_face_id) {
+          *src_face_id = t->face_id;
         }
+      } else if (index < 18 && edge_reversed) {
+        *edge_reversed = t->reversed;
       }
     }
 
@@ -4060,8 +5862,19 @@ void TMROctForest::transformNode(TMROctant *oct, int edge_dir,
   and corners. Finally, the new node numbers are returned to the
   processors that border the octree owners. And lastly, the non-local
   partial octrees are freed.
+
+  If the nodes already exist, for instance because refine() did not
+  change any element, the call returns immediately. When incremental
+  node creation is set, the local connectivity of the elements that
+  are unchanged since the previous call is reused, and only the new
+  elements and the dependent nodes are searched for in the node array.
+  The global node numbers are always assigned again, since they are
+  contiguous in Morton order and any change shifts the numbers of the
+  nodes that follow it.
 */
 void TMROctForest::createNodes() {
+  TMR_TRACE_SCOPE("TMROctForest::createNodes");
+
   if (!octants) {
     fprintf(stderr,
             "TMROctForest Error: Cannot call createNodes(), "
@@ -4074,15 +5887,30 @@ void TMROctForest::createNodes() {
     return;
   }
 
+  // Mark this as a new numbering of the nodes
+  static int node_stamp_count = 0;
+  node_stamp = node_stamp_count;
+  node_stamp_count++;
+
+  // Record the transient memory used to create the nodes
+  beginMemoryPhase(TMR_NODES_PHASE);
+
   // Send/recv the adjacent octants
   computeAdjacentOctants();
 
   // Compute the dependent face nodes
   computeDepFacesAndEdges();
 
+  // Match the elements with the elements from the previous call so
+  // that the connectivity of the unchanged elements can be reused
+  int *prev_elems = NULL;
+  if (use_incremental_nodes && prev_octants) {
+    prev_elems = matchPrevElements();
+  }
+
   // Create the local copies of the nodes and determine their
   // ownership (MPI rank that owns them)
-  TMROctantArray *nodes = createLocalNodes();
+  TMROctantArray *nodes = createLocalNodes(prev_elems);
 
   // Retrieve the size of the node array and count up the offsets for
   // each node. When mesh_order <= 3, the offset array will be equal
@@ -4094,6 +5922,7 @@ void TMROctForest::createNodes() {
   nodes->getArray(&node_array, &node_size);
 
   int *node_offset = new int[node_size];
+  addTransient(node_size * sizeof(int));
   num_local_nodes = 0;
   for (int i = 0; i < node_size; i++) {
     node_offset[i] = num_local_nodes;
@@ -4101,7 +5930,22 @@ void TMROctForest::createNodes() {
   }
 
   // Create the connectivity based on the node array
-  createLocalConn(nodes, node_offset);
+  createLocalConn(nodes, node_offset, prev_elems);
+  if (prev_elems) {
+    delete[] prev_elems;
+  }
+
+  // Keep a copy of the octants and the local connectivity for the
+  // next call. The local node array is kept once it is complete.
+  freePrevNodes();
+  if (use_incremental_nodes) {
+    int num_elements;
+    octants->getArray(NULL, &num_elements);
+    int size = mesh_order * mesh_order * mesh_order * num_elements;
+    prev_octants = octants->duplicate();
+    prev_conn = new int[size];
+    memcpy(prev_conn, conn, size * sizeof(int));
+  }
 
   // Allocate an array that will store the new node numbers
   node_numbers = new int[num_local_nodes];
@@ -4172,25 +6016,18 @@ void TMROctForest::createNodes() {
   }
 
   // Set the global node numbers for the owned nodes
-  num_owned_nodes = 0;
-  for (int i = 0; i < num_local_nodes; i++) {
-    if (node_numbers[i] >= 0) {
-      node_numbers[i] = node_range[mpi_rank] + num_owned_nodes;
-      num_owned_nodes++;
-    }
-  }
+  orderOwnedNodes(node_size, node_offset);
 
   // Create an array of all the independent nodes that are owned by
   // other processors and referenced by the elements on this
   // processor.
   TMROctantArray *ext_array = ext_nodes->toArray();
+  addTransient(ext_nodes->getMemoryUsage() + ext_array->getMemoryUsage());
+  removeTransient(ext_nodes->getMemoryUsage());
   delete ext_nodes;
 
   // Sort based on the tags
-  int ext_size;
-  TMROctant *ext_octs;
-  ext_array->getArray(&ext_octs, &ext_size);
-  qsort(ext_octs, ext_size, sizeof(TMROctant), compare_octant_tags);
+  ext_array->sortByTag();
 
   // Distribute the non-local nodes back to their owning processors to
   // determine their node numbers
@@ -4198,6 +6035,8 @@ void TMROctForest::createNodes() {
   int *send_ptr, *recv_ptr;
   TMROctantArray *dist_nodes = distributeOctants(ext_array, use_tags, &send_ptr,
                                                  &recv_ptr, use_node_index);
+  addTransient(dist_nodes->getMemoryUsage());
+  removeTransient(ext_array->getMemoryUsage());
   delete ext_array;
 
   // Loop over the off-processor nodes and search for them in the
@@ -4205,37 +6044,56 @@ void TMROctForest::createNodes() {
   int dist_size;
   TMROctant *dist_octs;
   dist_nodes->getArray(&dist_octs, &dist_size);
+  TMROctant **found = new TMROctant *[dist_size];
+  nodes->containsMany(dist_size, dist_octs, found);
   for (int i = 0; i < dist_size; i++) {
-    TMROctant *t = nodes->contains(&dist_octs[i]);
+    TMROctant *t = found[i];
     if (t) {
       // Compute the node number
       int index = t - node_array;
       dist_octs[i].tag = node_numbers[node_offset[index]];
     }
   }
+  delete[] found;
 
   // Send the nodes back to the original processors
-  TMROctantArray *return_nodes =
-      sendOctants(dist_nodes, recv_ptr, send_ptr, use_node_index);
-  delete dist_nodes;
-  delete[] recv_ptr;
-  delete[] send_ptr;
+  TMROctantExchange *exchange = new TMROctantExchange(
+      comm, dist_nodes, recv_ptr, send_ptr, use_node_index);
+  exchange->begin();
 
-  // Now go back through and set the external node numbers
+  // Now go back through and set the external node numbers as the
+  // nodes are received from each processor
   int return_size;
   TMROctant *return_octs;
-  return_nodes->getArray(&return_octs, &return_size);
-  for (int i = 0; i < return_size; i++) {
-    TMROctant *t = nodes->contains(&return_octs[i]);
-    for (int k = 0; k < t->level; k++) {
-      int index = t - node_array;
-      node_numbers[node_offset[index] + k] = return_octs[i].tag + k;
+  while (exchange->waitAny(&return_octs, &return_size) >= 0) {
+    TMROctant **found = new TMROctant *[return_size];
+    nodes->containsMany(return_size, return_octs, found);
+    for (int i = 0; i < return_size; i++) {
+      TMROctant *t = found[i];
+      for (int k = 0; k < t->level; k++) {
+        int index = t - node_array;
+        node_numbers[node_offset[index] + k] = return_octs[i].tag + k;
+      }
     }
+    delete[] found;
   }
+  TMROctantArray *return_nodes = exchange->end();
+  addTransient(return_nodes->getMemoryUsage());
+  removeTransient(return_nodes->getMemoryUsage() +
+                  dist_nodes->getMemoryUsage());
+  delete exchange;
   delete return_nodes;
+  delete dist_nodes;
+  delete[] recv_ptr;
+  delete[] send_ptr;
 
-  // Free the local node array
-  delete nodes;
+  // Free the local node array, unless it is kept for the next call
+  removeTransient(nodes->getMemoryUsage() + node_size * sizeof(int));
+  if (use_incremental_nodes) {
+    prev_nodes = nodes;
+  } else {
+    delete nodes;
+  }
   delete[] node_offset;
 
   // Apply the node numbering scheme to the local connectivity to
@@ -4286,8 +6144,15 @@ void TMROctForest::createNodes() {
   1. tag represents the MPI owner
   2. info represents the label (node/edge/face)
   3. level represents the number of nodes represented by the quad
+
+  When prev_elems is provided, the nodes of the elements that are
+  unchanged since the previous call to createNodes() are copied from
+  the previous node array rather than created again.
+
+  input:
+  prev_elems:  the previous index of each element or -1 (may be NULL)
 */
-TMROctantArray *TMROctForest::createLocalNodes() {
+TMROctantArray *TMROctForest::createLocalNodes(const int *prev_elems) {
   // Allocate the array of elements
   int num_elements;
   TMROctant *octs;
@@ -4316,6 +6181,9 @@ TMROctantArray *TMROctForest::createLocalNodes() {
     // First add all the nodes from the local elements on this
     // processor
     for (int i = 0; i < num_elements; i++) {
+      if (prev_elems && prev_elems[i] >= 0) {
+        continue;
+      }
       const int32_t h = 1 << (TMR_MAX_LEVEL - octs[i].level);
       for (int kk = 0; kk < 2; kk++) {
         for (int jj = 0; jj < 2; jj++) {
@@ -4336,6 +6204,9 @@ TMROctantArray *TMROctForest::createLocalNodes() {
     }
   } else {
     for (int i = 0; i < num_elements; i++) {
+      if (prev_elems && prev_elems[i] >= 0) {
+        continue;
+      }
       const int32_t h = 1 << (TMR_MAX_LEVEL - octs[i].level - 1);
       for (int kk = 0; kk < 3; kk++) {
         for (int jj = 0; jj < 3; jj++) {
@@ -4535,9 +6406,22 @@ TMROctantArray *TMROctForest::createLocalNodes() {
   // (dependent, indepdnent and non-local) that are referenced by this
   // processor
   TMROctantArray *nodes = local_nodes->toArray();
+  addTransient(local_nodes->getMemoryUsage() + nodes->getMemoryUsage());
+  removeTransient(local_nodes->getMemoryUsage());
   delete local_nodes;
   nodes->sort();
 
+  // Add the nodes of the unchanged elements. These take precedence
+  // over the same nodes added for a dependent node.
+  if (prev_elems) {
+    TMROctantArray *prev_elem_nodes = getPrevElementNodes(prev_elems);
+    removeTransient(nodes->getMemoryUsage());
+    prev_elem_nodes->merge(nodes);
+    addTransient(prev_elem_nodes->getMemoryUsage());
+    delete nodes;
+    nodes = prev_elem_nodes;
+  }
+
   // Now, determine the node ownership - if nodes that are not
   // dependent on this processor
   int use_tags = 0, include_local = 0;
@@ -4548,6 +6432,7 @@ TMROctantArray *TMROctForest::createLocalNodes() {
   // Create a unique list of the nodes sent to this processor
   TMROctantArray *recv_sorted = recv_nodes->duplicate();
   recv_sorted->sort();
+  addTransient(recv_nodes->getMemoryUsage() + recv_sorted->getMemoryUsage());
 
   // Now loop over nodes sent from other processors and decide which
   // processor owns the node.
@@ -4555,12 +6440,16 @@ TMROctantArray *TMROctForest::createLocalNodes() {
   TMROctant *recv_array;
   recv_nodes->getArray(&recv_array, &recv_size);
 
+  // Locate all of the received nodes in the sorted list at once
+  TMROctant **recv_found = new TMROctant *[recv_size];
+  recv_sorted->containsMany(recv_size, recv_array, recv_found);
+
   // Loop over all the nodes and see if they have a donor element from
   // another processor that is not from a dependent node relationship
   for (int i = 0; i < recv_size; i++) {
     // This is the processor that donates
     if (recv_array[i].tag >= 0) {
-      TMROctant *t = recv_sorted->contains(&recv_array[i]);
+      TMROctant *t = recv_found[i];
       if (t->tag < 0) {
         // t is not the owner, it is defined from a dependent edge
         t->tag = recv_array[i].tag;
@@ -4579,8 +6468,10 @@ TMROctantArray *TMROctForest::createLocalNodes() {
   int sorted_size;
   TMROctant *sorted_array;
   recv_sorted->getArray(&sorted_array, &sorted_size);
+  TMROctant **sorted_found = new TMROctant *[sorted_size];
+  nodes->containsMany(sorted_size, sorted_array, sorted_found);
   for (int i = 0; i < sorted_size; i++) {
-    TMROctant *t = nodes->contains(&sorted_array[i]);
+    TMROctant *t = sorted_found[i];
     // Note that even though these nodes are mapped to this processor,
     // they may not be defined on it for some corner cases...
     if (t) {
@@ -4596,14 +6487,18 @@ TMROctantArray *TMROctForest::createLocalNodes() {
     }
   }
 
+  delete[] sorted_found;
+
   // Make the return nodes consistent with the sorted list that is
   // unique
   for (int i = 0; i < recv_size; i++) {
     // This is the processor that donates from an owner
-    TMROctant *t = recv_sorted->contains(&recv_array[i]);
+    TMROctant *t = recv_found[i];
     recv_array[i].tag = t->tag;
   }
+  delete[] recv_found;
 
+  removeTransient(recv_sorted->getMemoryUsage());
   delete recv_sorted;
 
   // Adjust the send_ptr array since there will be a gap
@@ -4615,25 +6510,33 @@ TMROctantArray *TMROctForest::createLocalNodes() {
 
   // Return the nodes back to the senders with the new owner
   // information attached
-  TMROctantArray *owner_nodes =
-      sendOctants(recv_nodes, recv_ptr, send_ptr, use_node_index);
-  delete recv_nodes;
-  delete[] recv_ptr;
-  delete[] send_ptr;
+  TMROctantExchange *exchange = new TMROctantExchange(
+      comm, recv_nodes, recv_ptr, send_ptr, use_node_index);
+  exchange->begin();
 
-  // Go trhough the owner nodes and assign the MPI owner
+  // Go trhough the owner nodes and assign the MPI owner as they are
+  // received from each processor
   int owner_size;
   TMROctant *owner_array;
-  owner_nodes->getArray(&owner_array, &owner_size);
-
-  for (int i = 0; i < owner_size; i++) {
-    // Get the owner of the node on this processor
-    TMROctant *t = nodes->contains(&owner_array[i]);
+  while (exchange->waitAny(&owner_array, &owner_size) >= 0) {
+    // Get the owners of the nodes on this processor
+    TMROctant **found = new TMROctant *[owner_size];
+    nodes->containsMany(owner_size, owner_array, found);
 
     // Assign the MPI owner rank
-    t->tag = owner_array[i].tag;
+    for (int i = 0; i < owner_size; i++) {
+      found[i]->tag = owner_array[i].tag;
+    }
+    delete[] found;
   }
+  TMROctantArray *owner_nodes = exchange->end();
+  addTransient(owner_nodes->getMemoryUsage());
+  removeTransient(owner_nodes->getMemoryUsage() + recv_nodes->getMemoryUsage());
+  delete exchange;
   delete owner_nodes;
+  delete recv_nodes;
+  delete[] recv_ptr;
+  delete[] send_ptr;
 
   // Return the owners for each node
   return nodes;
@@ -4653,12 +6556,70 @@ TMROctantArray *TMROctForest::createLocalNodes() {
   3. The level member contains the number of nodes per node object
   which depends on the order of the mesh.
 
+  The connectivity of the elements that are unchanged since the
+  previous call to createNodes() is copied from the previous local
+  connectivity, with the previous local node numbers mapped to the
+  new ones.
+
   input:
   nodes:        the array of octants that represent nodes
   node_offset:  the array of offsets for each node
+  prev_elems:   the previous index of each element or -1 (may be NULL)
 */
 void TMROctForest::createLocalConn(TMROctantArray *nodes,
-                                   const int *node_offset) {
+                                   const int *node_offset,
+                                   const int *prev_elems) {
+  switch (mesh_order) {
+    case 2:
+      createLocalConnKernel<2>(nodes, node_offset, prev_elems);
+      break;
+    case 3:
+      createLocalConnKernel<3>(nodes, node_offset, prev_elems);
+      break;
+    case 4:
+      createLocalConnKernel<4>(nodes, node_offset, prev_elems);
+      break;
+    case 5:
+      createLocalConnKernel<5>(nodes, node_offset, prev_elems);
+      break;
+    default:
+      createLocalConnKernel<0>(nodes, node_offset, prev_elems);
+      break;
+  }
+
+  if (prev_elems) {
+    int num_elements;
+    octants->getArray(NULL, &num_elements);
+    const int nodes_per_element = mesh_order * mesh_order * mesh_order;
+
+    // Copy the connectivity of the unchanged elements
+    int *node_map = mapPrevNodes(nodes, node_offset);
+    for (int i = 0; i < num_elements; i++) {
+      if (prev_elems[i] >= 0) {
+        int *c = &conn[nodes_per_element * i];
+        const int *pc = &prev_conn[nodes_per_element * prev_elems[i]];
+        for (int j = 0; j < nodes_per_element; j++) {
+          c[j] = node_map[pc[j]];
+        }
+      }
+    }
+    delete[] node_map;
+  }
+}
+
+/*
+  The node-creation kernels are templated on the mesh order so that
+  the loops over the nodes of an element, edge or face have fixed
+  bounds for the common orders 2 to 5, and the buffers can be sized
+  at compile time. The order is selected once per call. ORDER = 0 is
+  the generic kernel which uses the order of the forest.
+*/
+template <int ORDER>
+void TMROctForest::createLocalConnKernel(TMROctantArray *nodes,
+                                         const int *node_offset,
+                                         const int *prev_elems) {
+  const int order = (ORDER > 0 ? ORDER : mesh_order);
+
   // Retrieve the octants on this processor
   int num_elements;
   TMROctant *octs;
@@ -4676,7 +6637,7 @@ void TMROctForest::createLocalConn(TMROctantArray *nodes,
   int label_type[4];
   // If the mesh order is high enough, we will have multiple nodes
   // per edge/face
-  initLabel(mesh_order, interp_type, label_type);
+  initLabel(order, interp_type, label_type);
 
   node_label = label_type[0];
   edge_label = label_type[1];
@@ -4684,37 +6645,64 @@ void TMROctForest::createLocalConn(TMROctantArray *nodes,
   block_label = label_type[3];
 
   // Allocate the connectivity
-  int size = mesh_order * mesh_order * mesh_order * num_elements;
+  int size = order * order * order * num_elements;
   conn = new int[size];
   memset(conn, 0, size * sizeof(int));
 
-  for (int i = 0; i < num_elements; i++) {
-    int *c = &conn[mesh_order * mesh_order * mesh_order * i];
+  // Find the elements that have changed since the previous call
+  int num_new = num_elements;
+  int *new_elems = NULL;
+  if (prev_elems) {
+    num_new = 0;
+    new_elems = new int[num_elements];
+    for (int i = 0; i < num_elements; i++) {
+      if (prev_elems[i] < 0) {
+        new_elems[num_new] = i;
+        num_new++;
+      }
+    }
+  }
+
+  // Create the corner nodes of all the new elements and search for
+  // them in the node array at once
+  TMROctant *corners = new TMROctant[8 * num_new];
+  for (int n = 0; n < num_new; n++) {
+    const int i = (new_elems ? new_elems[n] : n);
+    const int32_t h = 1 << (TMR_MAX_LEVEL - octs[i].level);
+    for (int k = 0; k < 8; k++) {
+      TMROctant *node = &corners[8 * n + k];
+      node->block = octs[i].block;
+      node->level = 0;
+      node->info = node_label;
+      node->x = octs[i].x + h * (k % 2);
+      node->y = octs[i].y + h * ((k % 4) / 2);
+      node->z = octs[i].z + h * (k / 4);
+      transformNode(node);
+    }
+  }
+  TMROctant **corner_nodes = new TMROctant *[8 * num_new];
+  nodes->containsMany(8 * num_new, corners, corner_nodes);
+  delete[] corners;
+
+  for (int n = 0; n < num_new; n++) {
+    const int i = (new_elems ? new_elems[n] : n);
+    int *c = &conn[order * order * order * i];
     const int32_t h = 1 << (TMR_MAX_LEVEL - octs[i].level - 1);
 
     // Loop over the element nodes
     for (int kk = 0; kk < 2; kk++) {
       for (int jj = 0; jj < 2; jj++) {
         for (int ii = 0; ii < 2; ii++) {
-          TMROctant node;
-          node.block = octs[i].block;
-          node.level = 0;
-          node.info = node_label;
-          node.x = octs[i].x + 2 * h * ii;
-          node.y = octs[i].y + 2 * h * jj;
-          node.z = octs[i].z + 2 * h * kk;
-          transformNode(&node);
-          TMROctant *t = nodes->contains(&node);
+          TMROctant *t = corner_nodes[8 * n + ii + 2 * jj + 4 * kk];
           int index = t - node_array;
-          int offset = (mesh_order - 1) * ii +
-                       (mesh_order - 1) * mesh_order * jj +
-                       (mesh_order - 1) * mesh_order * mesh_order * kk;
+          int offset = (order - 1) * ii + (order - 1) * order * jj +
+                       (order - 1) * order * order * kk;
           c[offset] = node_offset[index];
         }
       }
     }
 
-    if (mesh_order >= 3) {
+    if (order >= 3) {
       // Loop over the edges and get the owners
       for (int edge_index = 0; edge_index < 12; edge_index++) {
         TMROctant node;
@@ -4742,34 +6730,34 @@ void TMROctForest::createLocalConn(TMROctantArray *nodes,
         int index = t - node_array;
 
         if (edge_index < 4) {
-          const int jj = (mesh_order - 1) * (edge_index % 2);
-          const int kk = (mesh_order - 1) * (edge_index / 2);
-          for (int ii = 1; ii < mesh_order - 1; ii++) {
-            int offset = ii + jj * mesh_order + kk * mesh_order * mesh_order;
+          const int jj = (order - 1) * (edge_index % 2);
+          const int kk = (order - 1) * (edge_index / 2);
+          for (int ii = 1; ii < order - 1; ii++) {
+            int offset = ii + jj * order + kk * order * order;
             if (edge_reversed) {
-              c[offset] = node_offset[index] + mesh_order - 2 - ii;
+              c[offset] = node_offset[index] + order - 2 - ii;
             } else {
               c[offset] = node_offset[index] + ii - 1;
             }
           }
         } else if (edge_index < 8) {
-          const int ii = (mesh_order - 1) * (edge_index % 2);
-          const int kk = (mesh_order - 1) * ((edge_index - 4) / 2);
-          for (int jj = 1; jj < mesh_order - 1; jj++) {
-            int offset = ii + jj * mesh_order + kk * mesh_order * mesh_order;
+          const int ii = (order - 1) * (edge_index % 2);
+          const int kk = (order - 1) * ((edge_index - 4) / 2);
+          for (int jj = 1; jj < order - 1; jj++) {
+            int offset = ii + jj * order + kk * order * order;
             if (edge_reversed) {
-              c[offset] = node_offset[index] + mesh_order - 2 - jj;
+              c[offset] = node_offset[index] + order - 2 - jj;
             } else {
               c[offset] = node_offset[index] + jj - 1;
             }
           }
         } else {
-          const int ii = (mesh_order - 1) * (edge_index % 2);
-          const int jj = (mesh_order - 1) * ((edge_index - 8) / 2);
-          for (int kk = 1; kk < mesh_order - 1; kk++) {
-            int offset = ii + jj * mesh_order + kk * mesh_order * mesh_order;
+          const int ii = (order - 1) * (edge_index % 2);
+          const int jj = (order - 1) * ((edge_index - 8) / 2);
+          for (int kk = 1; kk < order - 1; kk++) {
+            int offset = ii + jj * order + kk * order * order;
             if (edge_reversed) {
-              c[offset] = node_offset[index] + mesh_order - 2 - kk;
+              c[offset] = node_offset[index] + order - 2 - kk;
             } else {
               c[offset] = node_offset[index] + kk - 1;
             }
@@ -4805,36 +6793,33 @@ void TMROctForest::createLocalConn(TMROctantArray *nodes,
         int index = t - node_array;
 
         if (face_index < 2) {
-          const int ii = (mesh_order - 1) * (face_index % 2);
-          for (int kk = 1; kk < mesh_order - 1; kk++) {
-            for (int jj = 1; jj < mesh_order - 1; jj++) {
+          const int ii = (order - 1) * (face_index % 2);
+          for (int kk = 1; kk < order - 1; kk++) {
+            for (int jj = 1; jj < order - 1; jj++) {
               int32_t u, v;
-              get_face_node_coords(face_id, mesh_order - 1, jj, kk, &u, &v);
-              int offset = ii + jj * mesh_order + kk * mesh_order * mesh_order;
-              c[offset] =
-                  node_offset[index] + (u - 1) + (v - 1) * (mesh_order - 2);
+              get_face_node_coords(face_id, order - 1, jj, kk, &u, &v);
+              int offset = ii + jj * order + kk * order * order;
+              c[offset] = node_offset[index] + (u - 1) + (v - 1) * (order - 2);
             }
           }
         } else if (face_index < 4) {
-          const int jj = (mesh_order - 1) * (face_index % 2);
-          for (int kk = 1; kk < mesh_order - 1; kk++) {
-            for (int ii = 1; ii < mesh_order - 1; ii++) {
+          const int jj = (order - 1) * (face_index % 2);
+          for (int kk = 1; kk < order - 1; kk++) {
+            for (int ii = 1; ii < order - 1; ii++) {
               int32_t u, v;
-              get_face_node_coords(face_id, mesh_order - 1, ii, kk, &u, &v);
-              int offset = ii + jj * mesh_order + kk * mesh_order * mesh_order;
-              c[offset] =
-                  node_offset[index] + (u - 1) + (v - 1) * (mesh_order - 2);
+              get_face_node_coords(face_id, order - 1, ii, kk, &u, &v);
+              int offset = ii + jj * order + kk * order * order;
+              c[offset] = node_offset[index] + (u - 1) + (v - 1) * (order - 2);
             }
           }
         } else {
-          const int kk = (mesh_order - 1) * (face_index % 2);
-          for (int jj = 1; jj < mesh_order - 1; jj++) {
-            for (int ii = 1; ii < mesh_order - 1; ii++) {
+          const int kk = (order - 1) * (face_index % 2);
+          for (int jj = 1; jj < order - 1; jj++) {
+            for (int ii = 1; ii < order - 1; ii++) {
               int32_t u, v;
-              get_face_node_coords(face_id, mesh_order - 1, ii, jj, &u, &v);
-              int offset = ii + jj * mesh_order + kk * mesh_order * mesh_order;
-              c[offset] =
-                  node_offset[index] + (u - 1) + (v - 1) * (mesh_order - 2);
+              get_face_node_coords(face_id, order - 1, ii, jj, &u, &v);
+              int offset = ii + jj * order + kk * order * order;
+              c[offset] = node_offset[index] + (u - 1) + (v - 1) * (order - 2);
             }
           }
         }
@@ -4852,46 +6837,427 @@ void TMROctForest::createLocalConn(TMROctantArray *nodes,
       TMROctant *t = nodes->contains(&node);
       int index = t - node_array;
 
-      for (int kk = 1; kk < mesh_order - 1; kk++) {
-        for (int jj = 1; jj < mesh_order - 1; jj++) {
-          for (int ii = 1; ii < mesh_order - 1; ii++) {
-            int offset = ii + jj * mesh_order + kk * mesh_order * mesh_order;
-            c[offset] = node_offset[index] + (ii - 1) +
-                        (jj - 1) * (mesh_order - 2) +
-                        (kk - 1) * (mesh_order - 2) * (mesh_order - 2);
+      for (int kk = 1; kk < order - 1; kk++) {
+        for (int jj = 1; jj < order - 1; jj++) {
+          for (int ii = 1; ii < order - 1; ii++) {
+            int offset = ii + jj * order + kk * order * order;
+            c[offset] = node_offset[index] + (ii - 1) + (jj - 1) * (order - 2) +
+                        (kk - 1) * (order - 2) * (order - 2);
           }
         }
       }
     }
   }
+
+  delete[] corner_nodes;
+  if (new_elems) {
+    delete[] new_elems;
+  }
 }
 
 /*
-  Get the local nodes along a given octant edge
-
-  This uses the ordering implied by the nodes octant array to compute
-  the local node numbers. Note that the input octant may not actually
-  exist in the octree, but its nodes along the given edge will be
-  present.
+  Match the local elements with the elements kept from the previous
+  call to createNodes()
 
-  input:
-  oct:          the parent octant
-  edge_index:   the edge index along the parent octant
-  nodes:        the sorted node array that results in an ordering
-  node_offset:  the offset to the local number
+  Both arrays of octants are sorted, so a single pass finds the
+  elements that are identical in both. The connectivity of an element
+  only depends on the element itself, so the local connectivity of a
+  matched element can be reused, even if the dependent nodes around it
+  have changed.
 
-  output:
-  edge_nodes:   the local node numbers along the edge
+  returns: the previous index of each element or -1
 */
-void TMROctForest::getEdgeNodes(TMROctant *oct, int edge_index,
-                                TMROctantArray *nodes, const int *node_offset,
-                                int *edge_nodes) {
-  TMROctant *node_array;
-  nodes->getArray(&node_array, NULL);
-  const int32_t h = 1 << (TMR_MAX_LEVEL - oct->level - 1);
-  const int32_t hp = 1 << (TMR_MAX_LEVEL - oct->level);
+int *TMROctForest::matchPrevElements() {
+  int num_elements, prev_size;
+  TMROctant *octs, *prev_octs;
+  octants->getArray(&octs, &num_elements);
+  prev_octants->getArray(&prev_octs, &prev_size);
 
-  if (mesh_order == 2) {
+  int *prev_elems = new int[num_elements];
+  int j = 0;
+  for (int i = 0; i < num_elements; i++) {
+    prev_elems[i] = -1;
+    while (j < prev_size && prev_octs[j].compare(&octs[i]) < 0) {
+      j++;
+    }
+    if (j < prev_size && prev_octs[j].compare(&octs[i]) == 0) {
+      prev_elems[i] = j;
+      j++;
+    }
+  }
+
+  return prev_elems;
+}
+
+/*
+  Get the nodes of the unchanged elements from the previous node array
+
+  The nodes are copied in order, so the array that is returned is
+  sorted. The owner of each node is reset to this processor since it
+  is created from a local element.
+
+  input:
+  prev_elems:  the previous index of each element or -1
+
+  returns: the sorted array of nodes
+*/
+TMROctantArray *TMROctForest::getPrevElementNodes(const int *prev_elems) {
+  int num_elements;
+  octants->getArray(NULL, &num_elements);
+  const int nodes_per_element = mesh_order * mesh_order * mesh_order;
+
+  int prev_size;
+  TMROctant *prev_array;
+  prev_nodes->getArray(&prev_array, &prev_size);
+  int prev_num_nodes = 0;
+  for (int i = 0; i < prev_size; i++) {
+    prev_num_nodes += prev_array[i].level;
+  }
+
+  // Mark the previous local nodes referenced by the unchanged elements
+  char *marked = new char[prev_num_nodes];
+  memset(marked, 0, prev_num_nodes * sizeof(char));
+  for (int i = 0; i < num_elements; i++) {
+    if (prev_elems[i] >= 0) {
+      const int *pc = &prev_conn[nodes_per_element * prev_elems[i]];
+      for (int j = 0; j < nodes_per_element; j++) {
+        marked[pc[j]] = 1;
+      }
+    }
+  }
+
+  // Copy the marked nodes. An element references all the nodes
+  // represented by an octant, so checking the first one is enough.
+  int size = 0;
+  for (int i = 0, offset = 0; i < prev_size; i++) {
+    if (marked[offset]) {
+      size++;
+    }
+    offset += prev_array[i].level;
+  }
+  TMROctant *array = new TMROctant[size];
+  size = 0;
+  for (int i = 0, offset = 0; i < prev_size; i++) {
+    if (marked[offset]) {
+      array[size] = prev_array[i];
+      array[size].tag = mpi_rank;
+      size++;
+    }
+    offset += prev_array[i].level;
+  }
+  delete[] marked;
+
+  const int use_node_index = 1;
+  return new TMROctantArray(array, size, use_node_index);
+}
+
+/*
+  Map the local node numbers from the previous call to createNodes()
+  to the local node numbers in the new node array
+
+  input:
+  nodes:        the sorted array of the new nodes
+  node_offset:  the offset of each new node
+
+  returns: the new local number of each previous node or -1
+*/
+int *TMROctForest::mapPrevNodes(TMROctantArray *nodes,
+                                const int *node_offset) {
+  int node_size, prev_size;
+  TMROctant *node_array, *prev_array;
+  nodes->getArray(&node_array, &node_size);
+  prev_nodes->getArray(&prev_array, &prev_size);
+  int prev_num_nodes = 0;
+  for (int i = 0; i < prev_size; i++) {
+    prev_num_nodes += prev_array[i].level;
+  }
+
+  int *node_map = new int[prev_num_nodes];
+  for (int i = 0, j = 0, offset = 0; i < prev_size; i++) {
+    while (j < node_size && node_array[j].compareNode(&prev_array[i]) < 0) {
+      j++;
+    }
+    int match =
+        (j < node_size && node_array[j].compareNode(&prev_array[i]) == 0);
+    for (int k = 0; k < prev_array[i].level; k++) {
+      node_map[offset + k] = (match ? node_offset[j] + k : -1);
+    }
+    offset += prev_array[i].level;
+  }
+
+  return node_map;
+}
+
+/*
+  Free the data kept from the previous call to createNodes()
+*/
+void TMROctForest::freePrevNodes() {
+  if (prev_octants) {
+    delete prev_octants;
+  }
+  if (prev_nodes) {
+    delete prev_nodes;
+  }
+  if (prev_conn) {
+    delete[] prev_conn;
+  }
+  prev_octants = NULL;
+  prev_nodes = NULL;
+  prev_conn = NULL;
+}
+
+/*
+  Compute the maximum difference between the numbers of the nodes
+  within each element, skipping nodes with a negative number
+*/
+static int computeElementBandwidth(int num_elements, int nodes_per_element,
+                                   const int *conn, const int *numbers) {
+  int bandwidth = 0;
+  for (int i = 0; i < num_elements; i++) {
+    const int *c = &conn[nodes_per_element * i];
+    int min_num = -1, max_num = -1;
+    for (int j = 0; j < nodes_per_element; j++) {
+      int num = numbers[c[j]];
+      if (num >= 0) {
+        if (min_num < 0 || num < min_num) {
+          min_num = num;
+        }
+        if (num > max_num) {
+          max_num = num;
+        }
+      }
+    }
+    if (max_num - min_num > bandwidth) {
+      bandwidth = max_num - min_num;
+    }
+  }
+  return bandwidth;
+}
+
+/*
+  Number the locally owned nodes
+
+  On input, the owned nodes have a non-negative entry in node_numbers
+  and the local connectivity refers to the local node indices. The
+  nodes that are represented by one entry in the node array are
+  numbered consecutively since the numbers of the external nodes are
+  exchanged one entry at a time.
+
+  With TMR_ELEMENT_NODE_ORDER, the entries are numbered in the order
+  that they are first referenced by the Morton-ordered elements. With
+  TMR_RCM_NODE_ORDER, the entries are ordered by the level sets of the
+  graph where two entries are adjacent when they share an element.
+  Each level set starts from the unordered entry within the fewest
+  elements, the entries added from each node are sorted by their
+  number of elements and the final order is reversed.
+
+  The maximum bandwidth of the owned node numbers within the elements
+  is recorded for the natural order and the selected order.
+*/
+void TMROctForest::orderOwnedNodes(int node_size, const int *node_offset) {
+  int num_elements;
+  octants->getArray(NULL, &num_elements);
+  const int nodes_per_element = mesh_order * mesh_order * mesh_order;
+  const int conn_size = nodes_per_element * num_elements;
+
+  // Find the entry of each local node. The label of each entry is
+  // its position in the new order, -1 for owned entries that are not
+  // yet ordered and -2 for entries that are not owned.
+  int *entry = new int[num_local_nodes];
+  int *label = new int[node_size];
+  int *order = new int[node_size];
+  addTransient(num_local_nodes * sizeof(int) + 2 * node_size * sizeof(int));
+  for (int i = 0; i < node_size; i++) {
+    int end = (i < node_size - 1 ? node_offset[i + 1] : num_local_nodes);
+    for (int k = node_offset[i]; k < end; k++) {
+      entry[k] = i;
+    }
+    label[i] = (node_numbers[node_offset[i]] >= 0 ? -1 : -2);
+  }
+
+  int num = 0;
+  if (node_ordering == TMR_ELEMENT_NODE_ORDER) {
+    for (int i = 0; i < conn_size; i++) {
+      int e = entry[conn[i]];
+      if (label[e] == -1) {
+        label[e] = num;
+        order[num] = e;
+        num++;
+      }
+    }
+  } else if (node_ordering == TMR_RCM_NODE_ORDER) {
+    // Compute the elements that contain each owned entry
+    int *elem_ptr = new int[node_size + 1];
+    int *elems = new int[conn_size + 1];
+    addTransient((node_size + conn_size + 2) * sizeof(int));
+    memset(elem_ptr, 0, (node_size + 1) * sizeof(int));
+    for (int i = 0; i < conn_size; i++) {
+      int e = entry[conn[i]];
+      if (label[e] == -1) {
+        elem_ptr[e + 1]++;
+      }
+    }
+    for (int i = 0; i < node_size; i++) {
+      elem_ptr[i + 1] += elem_ptr[i];
+    }
+    for (int i = 0; i < conn_size; i++) {
+      int e = entry[conn[i]];
+      if (label[e] == -1) {
+        elems[elem_ptr[e]] = i / nodes_per_element;
+        elem_ptr[e]++;
+      }
+    }
+    for (int i = node_size; i > 0; i--) {
+      elem_ptr[i] = elem_ptr[i - 1];
+    }
+    elem_ptr[0] = 0;
+
+    int start = 0, end = 0;
+    while (1) {
+      // Find the next root
+      int root = -1, min_degree = conn_size + 1;
+      for (int i = 0; i < node_size; i++) {
+        if (label[i] == -1 && elem_ptr[i + 1] - elem_ptr[i] < min_degree) {
+          root = i;
+          min_degree = elem_ptr[i + 1] - elem_ptr[i];
+        }
+      }
+
+      // Nothing is left to order
+      if (root < 0) {
+        break;
+      }
+
+      label[root] = num;
+      order[num] = root;
+      num++;
+      end++;
+
+      while (start < end) {
+        // Iterate over the entries added to the previous level set
+        for (int current = start; current < end; current++) {
+          int e = order[current];
+          int first = num;
+
+          // Add the unordered entries that share an element
+          for (int jp = elem_ptr[e]; jp < elem_ptr[e + 1]; jp++) {
+            const int *c = &conn[nodes_per_element * elems[jp]];
+            for (int k = 0; k < nodes_per_element; k++) {
+              int next = entry[c[k]];
+              if (label[next] == -1) {
+                label[next] = num;
+                order[num] = next;
+                num++;
+              }
+            }
+          }
+
+          // Sort the new entries by their number of elements
+          for (int i = first + 1; i < num; i++) {
+            int t = order[i];
+            int degree = elem_ptr[t + 1] - elem_ptr[t];
+            int j = i;
+            while (j > first &&
+                   elem_ptr[order[j - 1] + 1] - elem_ptr[order[j - 1]] >
+                       degree) {
+              order[j] = order[j - 1];
+              j--;
+            }
+            order[j] = t;
+          }
+        }
+
+        start = end;
+        end = num;
+      }
+    }
+
+    // Reverse the order
+    for (int i = 0; i < num / 2; i++) {
+      int t = order[i];
+      order[i] = order[num - 1 - i];
+      order[num - 1 - i] = t;
+    }
+
+    removeTransient((node_size + conn_size + 2) * sizeof(int));
+    delete[] elem_ptr;
+    delete[] elems;
+  }
+
+  // Add the owned entries that have not been ordered in their
+  // natural order
+  for (int i = 0; i < node_size; i++) {
+    if (label[i] == -1) {
+      label[i] = num;
+      order[num] = i;
+      num++;
+    }
+  }
+
+  // Compute the bandwidth of the natural order
+  int *natural = new int[num_local_nodes];
+  addTransient(num_local_nodes * sizeof(int));
+  for (int i = 0, count = 0; i < num_local_nodes; i++) {
+    natural[i] = (node_numbers[i] >= 0 ? count++ : -1);
+  }
+  int bandwidth[2];
+  bandwidth[0] =
+      computeElementBandwidth(num_elements, nodes_per_element, conn, natural);
+  removeTransient(num_local_nodes * sizeof(int));
+  delete[] natural;
+
+  // Set the global node numbers in the new order
+  num_owned_nodes = 0;
+  for (int n = 0; n < num; n++) {
+    int i = order[n];
+    int end = (i < node_size - 1 ? node_offset[i + 1] : num_local_nodes);
+    for (int k = node_offset[i]; k < end; k++) {
+      if (node_numbers[k] >= 0) {
+        node_numbers[k] = node_range[mpi_rank] + num_owned_nodes;
+        num_owned_nodes++;
+      }
+    }
+  }
+
+  bandwidth[1] = computeElementBandwidth(num_elements, nodes_per_element,
+                                         conn, node_numbers);
+  MPI_Allreduce(bandwidth, node_bandwidth, 2, MPI_INT, MPI_MAX, comm);
+
+  removeTransient(num_local_nodes * sizeof(int) + 2 * node_size * sizeof(int));
+  delete[] entry;
+  delete[] label;
+  delete[] order;
+}
+
+/*
+  Get the local nodes along a given octant edge
+
+  This uses the ordering implied by the nodes octant array to compute
+  the local node numbers. Note that the input octant may not actually
+  exist in the octree, but its nodes along the given edge will be
+  present.
+
+  input:
+  oct:          the parent octant
+  edge_index:   the edge index along the parent octant
+  nodes:        the sorted node array that results in an ordering
+  node_offset:  the offset to the local number
+
+  output:
+  edge_nodes:   the local node numbers along the edge
+*/
+template <int ORDER>
+void TMROctForest::getEdgeNodes(TMROctant *oct, int edge_index,
+                                TMROctantArray *nodes, const int *node_offset,
+                                int *edge_nodes) {
+  const int order = (ORDER > 0 ? ORDER : mesh_order);
+
+  TMROctant *node_array;
+  nodes->getArray(&node_array, NULL);
+  const int32_t h = 1 << (TMR_MAX_LEVEL - oct->level - 1);
+  const int32_t hp = 1 << (TMR_MAX_LEVEL - oct->level);
+
+  if (order == 2) {
     for (int ii = 0; ii < 2; ii++) {
       TMROctant node;
       node.block = oct->block;
@@ -4918,8 +7284,8 @@ void TMROctForest::getEdgeNodes(TMROctant *oct, int edge_index,
   } else {
     // Set the edge label
     int edge_label = TMR_OCT_NODE_LABEL;
-    if (mesh_order > 3 ||
-        (mesh_order >= 3 && interp_type == TMR_BERNSTEIN_POINTS)) {
+    if (order > 3 ||
+        (order >= 3 && interp_type == TMR_BERNSTEIN_POINTS)) {
       edge_label = TMR_OCT_EDGE_LABEL;
     }
 
@@ -4945,7 +7311,7 @@ void TMROctForest::getEdgeNodes(TMROctant *oct, int edge_index,
         transformNode(&node);
         TMROctant *t = nodes->contains(&node);
         int index = t - node_array;
-        edge_nodes[(ii / 2) * (mesh_order - 1)] = node_offset[index];
+        edge_nodes[(ii / 2) * (order - 1)] = node_offset[index];
       } else {
         int edge_dir = edge_index / 4;
         int edge_reversed = 0;
@@ -4954,11 +7320,11 @@ void TMROctForest::getEdgeNodes(TMROctant *oct, int edge_index,
         TMROctant *t = nodes->contains(&node);
         int index = t - node_array;
         if (edge_reversed) {
-          for (int k = 1; k < mesh_order - 1; k++) {
-            edge_nodes[k] = node_offset[index] + mesh_order - 2 - k;
+          for (int k = 1; k < order - 1; k++) {
+            edge_nodes[k] = node_offset[index] + order - 2 - k;
           }
         } else {
-          for (int k = 1; k < mesh_order - 1; k++) {
+          for (int k = 1; k < order - 1; k++) {
             edge_nodes[k] = node_offset[index] + k - 1;
           }
         }
@@ -4987,14 +7353,17 @@ void TMROctForest::getEdgeNodes(TMROctant *oct, int edge_index,
   output:
   face_nodes:   the local node numbers on this face
 */
+template <int ORDER>
 void TMROctForest::getFaceNodes(TMROctant *oct, int face_index,
                                 TMROctantArray *nodes, const int *node_offset,
                                 int *face_nodes) {
+  const int order = (ORDER > 0 ? ORDER : mesh_order);
+
   TMROctant *node_array;
   nodes->getArray(&node_array, NULL);
   const int32_t h = 1 << (TMR_MAX_LEVEL - oct->level - 1);
 
-  if (mesh_order == 2) {
+  if (order == 2) {
     for (int jj = 0; jj < 2; jj++) {
       for (int ii = 0; ii < 2; ii++) {
         TMROctant node;
@@ -5025,8 +7394,8 @@ void TMROctForest::getFaceNodes(TMROctant *oct, int face_index,
     // Set the edge/face labels
     int edge_label = TMR_OCT_NODE_LABEL;
     int face_label = TMR_OCT_NODE_LABEL;
-    if (mesh_order > 3 ||
-        (mesh_order >= 3 && interp_type == TMR_BERNSTEIN_POINTS)) {
+    if (order > 3 ||
+        (order >= 3 && interp_type == TMR_BERNSTEIN_POINTS)) {
       edge_label = TMR_OCT_EDGE_LABEL;
       face_label = TMR_OCT_FACE_LABEL;
     }
@@ -5057,12 +7426,12 @@ void TMROctForest::getFaceNodes(TMROctant *oct, int face_index,
           int index = t - node_array;
 
           // Compute the offset to one of the face corners
-          int offset = ((ii / 2) * (mesh_order - 1) +
-                        (jj / 2) * (mesh_order - 1) * mesh_order);
+          int offset =
+              ((ii / 2) * (order - 1) + (jj / 2) * (order - 1) * order);
           face_nodes[offset] = node_offset[index];
         } else if (ii == 0 || ii == 2 || jj == 0 || jj == 2) {
           node.info = edge_label;
-          node.level = mesh_order - 2;
+          node.level = order - 2;
 
           // Compute the local edge index on the face
           int e = 0;
@@ -5086,23 +7455,23 @@ void TMROctForest::getFaceNodes(TMROctant *oct, int face_index,
 
           // Compute the local offset into the array
           int incr = 1;
-          int start = (jj / 2) * (mesh_order - 1) * mesh_order;
+          int start = (jj / 2) * (order - 1) * order;
           if (ii == 0 || ii == 2) {
-            incr = mesh_order;
-            start = (ii / 2) * (mesh_order - 1);
+            incr = order;
+            start = (ii / 2) * (order - 1);
           }
 
-          for (int k = 1; k < mesh_order - 1; k++) {
+          for (int k = 1; k < order - 1; k++) {
             int offset = start + k * incr;
             if (edge_reversed) {
-              face_nodes[offset] = node_offset[index] + mesh_order - 2 - k;
+              face_nodes[offset] = node_offset[index] + order - 2 - k;
             } else {
               face_nodes[offset] = node_offset[index] + k - 1;
             }
           }
         } else {
           node.info = face_label;
-          node.level = (mesh_order - 2) * (mesh_order - 2);
+          node.level = (order - 2) * (order - 2);
 
           // Compute the face node and its index
           int face_id = 0;
@@ -5112,30 +7481,30 @@ void TMROctForest::getFaceNodes(TMROctant *oct, int face_index,
           int index = t - node_array;
 
           if (face_index < 2) {
-            for (int k = 1; k < mesh_order - 1; k++) {
-              for (int j = 1; j < mesh_order - 1; j++) {
+            for (int k = 1; k < order - 1; k++) {
+              for (int j = 1; j < order - 1; j++) {
                 int32_t u, v;
-                get_face_node_coords(face_id, mesh_order - 1, j, k, &u, &v);
-                face_nodes[j + k * mesh_order] =
-                    node_offset[index] + (u - 1) + (v - 1) * (mesh_order - 2);
+                get_face_node_coords(face_id, order - 1, j, k, &u, &v);
+                face_nodes[j + k * order] =
+                    node_offset[index] + (u - 1) + (v - 1) * (order - 2);
               }
             }
           } else if (face_index < 4) {
-            for (int k = 1; k < mesh_order - 1; k++) {
-              for (int i = 1; i < mesh_order - 1; i++) {
+            for (int k = 1; k < order - 1; k++) {
+              for (int i = 1; i < order - 1; i++) {
                 int32_t u, v;
-                get_face_node_coords(face_id, mesh_order - 1, i, k, &u, &v);
-                face_nodes[i + k * mesh_order] =
-                    node_offset[index] + (u - 1) + (v - 1) * (mesh_order - 2);
+                get_face_node_coords(face_id, order - 1, i, k, &u, &v);
+                face_nodes[i + k * order] =
+                    node_offset[index] + (u - 1) + (v - 1) * (order - 2);
               }
             }
           } else {
-            for (int j = 1; j < mesh_order - 1; j++) {
-              for (int i = 1; i < mesh_order - 1; i++) {
+            for (int j = 1; j < order - 1; j++) {
+              for (int i = 1; i < order - 1; i++) {
                 int32_t u, v;
-                get_face_node_coords(face_id, mesh_order - 1, i, j, &u, &v);
-                face_nodes[i + j * mesh_order] =
-                    node_offset[index] + (u - 1) + (v - 1) * (mesh_order - 2);
+                get_face_node_coords(face_id, order - 1, i, j, &u, &v);
+                face_nodes[i + j * order] =
+                    node_offset[index] + (u - 1) + (v - 1) * (order - 2);
               }
             }
           }
@@ -5157,6 +7526,31 @@ void TMROctForest::getFaceNodes(TMROctant *oct, int face_index,
 void TMROctForest::createDependentConn(const int *node_nums,
                                        TMROctantArray *nodes,
                                        const int *node_offset) {
+  switch (mesh_order) {
+    case 2:
+      createDependentConnKernel<2>(node_nums, nodes, node_offset);
+      break;
+    case 3:
+      createDependentConnKernel<3>(node_nums, nodes, node_offset);
+      break;
+    case 4:
+      createDependentConnKernel<4>(node_nums, nodes, node_offset);
+      break;
+    case 5:
+      createDependentConnKernel<5>(node_nums, nodes, node_offset);
+      break;
+    default:
+      createDependentConnKernel<0>(node_nums, nodes, node_offset);
+      break;
+  }
+}
+
+template <int ORDER>
+void TMROctForest::createDependentConnKernel(const int *node_nums,
+                                             TMROctantArray *nodes,
+                                             const int *node_offset) {
+  const int order = (ORDER > 0 ? ORDER : mesh_order);
+
   // Allocate space for the connectivity
   dep_ptr = new int[num_dep_nodes + 1];
   memset(dep_ptr, 0, (num_dep_nodes + 1) * sizeof(int));
@@ -5171,13 +7565,10 @@ void TMROctForest::createDependentConn(const int *node_nums,
   TMROctant *node_array;
   nodes->getArray(&node_array, &node_size);
 
-  // Allocate space to store the free node variables
-  int *edge_nodes = new int[mesh_order];
-  int *dep_edge_nodes = new int[mesh_order];
-  int *face_nodes = new int[mesh_order * mesh_order];
-  int *dep_face_nodes = new int[mesh_order * mesh_order];
-  double *Nu = new double[mesh_order];
-  double *Nv = new double[mesh_order];
+  // Space to store the free node variables
+  const int size = (ORDER > 0 ? ORDER : MAX_ORDER);
+  int edge_nodes[size], dep_edge_nodes[size];
+  int face_nodes[size * size], dep_face_nodes[size * size];
 
   for (int i = 0; i < num_elements; i++) {
     if (octs[i].info) {
@@ -5185,42 +7576,42 @@ void TMROctForest::createDependentConn(const int *node_nums,
       int edge_info;
       decode_index_from_info(&octs[i], octs[i].info, NULL, &edge_info);
 
-      const int *c = &conn[mesh_order * mesh_order * mesh_order * i];
+      const int *c = &conn[order * order * order * i];
 
       // Find the edge nodes and check whether they are dependent
       for (int edge_index = 0; edge_index < 12; edge_index++) {
         if (edge_info & 1 << edge_index) {
           // Get the edges node numbers from the dependent edge
           if (edge_index < 4) {
-            const int jj = (mesh_order - 1) * (edge_index % 2);
-            const int kk = (mesh_order - 1) * (edge_index / 2);
-            for (int ii = 0; ii < mesh_order; ii++) {
-              int offset = ii + jj * mesh_order + kk * mesh_order * mesh_order;
+            const int jj = (order - 1) * (edge_index % 2);
+            const int kk = (order - 1) * (edge_index / 2);
+            for (int ii = 0; ii < order; ii++) {
+              int offset = ii + jj * order + kk * order * order;
               dep_edge_nodes[ii] = c[offset];
             }
           } else if (edge_index < 8) {
-            const int ii = (mesh_order - 1) * (edge_index % 2);
-            const int kk = (mesh_order - 1) * ((edge_index - 4) / 2);
-            for (int jj = 0; jj < mesh_order; jj++) {
-              int offset = ii + jj * mesh_order + kk * mesh_order * mesh_order;
+            const int ii = (order - 1) * (edge_index % 2);
+            const int kk = (order - 1) * ((edge_index - 4) / 2);
+            for (int jj = 0; jj < order; jj++) {
+              int offset = ii + jj * order + kk * order * order;
               dep_edge_nodes[jj] = c[offset];
             }
           } else {
-            const int ii = (mesh_order - 1) * (edge_index % 2);
-            const int jj = (mesh_order - 1) * ((edge_index - 8) / 2);
-            for (int kk = 0; kk < mesh_order; kk++) {
-              int offset = ii + jj * mesh_order + kk * mesh_order * mesh_order;
+            const int ii = (order - 1) * (edge_index % 2);
+            const int jj = (order - 1) * ((edge_index - 8) / 2);
+            for (int kk = 0; kk < order; kk++) {
+              int offset = ii + jj * order + kk * order * order;
               dep_edge_nodes[kk] = c[offset];
             }
           }
 
           // Mark any dependent nodes
-          for (int k = 0; k < mesh_order; k++) {
+          for (int k = 0; k < order; k++) {
             int index = node_nums[dep_edge_nodes[k]];
             if (index < 0) {
               index = -index - 1;
               if (dep_ptr[index + 1] == 0) {
-                dep_ptr[index + 1] = mesh_order;
+                dep_ptr[index + 1] = order;
               }
             }
           }
@@ -5235,47 +7626,44 @@ void TMROctForest::createDependentConn(const int *node_nums,
       int face_info;
       decode_index_from_info(&octs[i], octs[i].info, &face_info, NULL);
 
-      const int *c = &conn[mesh_order * mesh_order * mesh_order * i];
+      const int *c = &conn[order * order * order * i];
 
       // Next, set the dependent face nodes on this face
       for (int face_index = 0; face_index < 6; face_index++) {
         if (face_info & 1 << face_index) {
           if (face_index < 2) {
-            const int ii = (mesh_order - 1) * (face_index % 2);
-            for (int kk = 0; kk < mesh_order; kk++) {
-              for (int jj = 0; jj < mesh_order; jj++) {
-                int offset =
-                    ii + jj * mesh_order + kk * mesh_order * mesh_order;
-                dep_face_nodes[jj + kk * mesh_order] = c[offset];
+            const int ii = (order - 1) * (face_index % 2);
+            for (int kk = 0; kk < order; kk++) {
+              for (int jj = 0; jj < order; jj++) {
+                int offset = ii + jj * order + kk * order * order;
+                dep_face_nodes[jj + kk * order] = c[offset];
               }
             }
           } else if (face_index < 4) {
-            const int jj = (mesh_order - 1) * (face_index % 2);
-            for (int kk = 0; kk < mesh_order; kk++) {
-              for (int ii = 0; ii < mesh_order; ii++) {
-                int offset =
-                    ii + jj * mesh_order + kk * mesh_order * mesh_order;
-                dep_face_nodes[ii + kk * mesh_order] = c[offset];
+            const int jj = (order - 1) * (face_index % 2);
+            for (int kk = 0; kk < order; kk++) {
+              for (int ii = 0; ii < order; ii++) {
+                int offset = ii + jj * order + kk * order * order;
+                dep_face_nodes[ii + kk * order] = c[offset];
               }
             }
           } else {
-            const int kk = (mesh_order - 1) * (face_index % 2);
-            for (int jj = 0; jj < mesh_order; jj++) {
-              for (int ii = 0; ii < mesh_order; ii++) {
-                int offset =
-                    ii + jj * mesh_order + kk * mesh_order * mesh_order;
-                dep_face_nodes[ii + jj * mesh_order] = c[offset];
+            const int kk = (order - 1) * (face_index % 2);
+            for (int jj = 0; jj < order; jj++) {
+              for (int ii = 0; ii < order; ii++) {
+                int offset = ii + jj * order + kk * order * order;
+                dep_face_nodes[ii + jj * order] = c[offset];
               }
             }
           }
 
           // Mark any dependent nodes
-          for (int k = 0; k < mesh_order * mesh_order; k++) {
+          for (int k = 0; k < order * order; k++) {
             int index = node_nums[dep_face_nodes[k]];
             if (index < 0) {
               index = -index - 1;
               if (dep_ptr[index + 1] == 0) {
-                dep_ptr[index + 1] = mesh_order * mesh_order;
+                dep_ptr[index + 1] = order * order;
               }
             }
           }
@@ -5291,7 +7679,27 @@ void TMROctForest::createDependentConn(const int *node_nums,
 
   // Allocate the space for the node numbers
   dep_conn = new int[dep_ptr[num_dep_nodes]];
-  dep_weights = new double[dep_ptr[num_dep_nodes]];
+
+  // Compute the weight templates. The weights along a dependent edge
+  // depend only on the position of the child along the parent edge
+  // and the index of the node along the edge. The weights of a
+  // dependent face node are the tensor product of the weights along
+  // the two face directions.
+  dep_tmpl_weights = new double[2 * order * order];
+  for (int x = 0; x < 2; x++) {
+    for (int k = 0; k < order; k++) {
+      double *N = &dep_tmpl_weights[order * (order * x + k)];
+      if (interp_type == TMR_BERNSTEIN_POINTS) {
+        eval_bernstein_weights(order, (order - 1) * (x - 1) + k, N);
+      } else {
+        double u = 1.0 * (x - 1) + 0.5 * (1.0 + interp_knots[k]);
+        lagrange_shape_functions(order, u, interp_knots, interp_wts, N);
+      }
+    }
+  }
+
+  // Set the weight templates for each dependent node
+  dep_tmpl = new int[2 * num_dep_nodes];
 
   // Loop over the elements again, this time setting the local
   // connectivity
@@ -5309,38 +7717,39 @@ void TMROctForest::createDependentConn(const int *node_nums,
       int id = octs[i].childId();
 
       // Set the offset into the local connectivity array
-      const int *c = &conn[mesh_order * mesh_order * mesh_order * i];
+      const int *c = &conn[order * order * order * i];
 
       for (int edge_index = 0; edge_index < 12; edge_index++) {
         if (edge_info & 1 << edge_index) {
           // Get the edges node numbers from the dependent edge
           if (edge_index < 4) {
-            const int jj = (mesh_order - 1) * (edge_index % 2);
-            const int kk = (mesh_order - 1) * (edge_index / 2);
-            for (int ii = 0; ii < mesh_order; ii++) {
-              int offset = ii + jj * mesh_order + kk * mesh_order * mesh_order;
+            const int jj = (order - 1) * (edge_index % 2);
+            const int kk = (order - 1) * (edge_index / 2);
+            for (int ii = 0; ii < order; ii++) {
+              int offset = ii + jj * order + kk * order * order;
               dep_edge_nodes[ii] = c[offset];
             }
           } else if (edge_index < 8) {
-            const int ii = (mesh_order - 1) * (edge_index % 2);
-            const int kk = (mesh_order - 1) * ((edge_index - 4) / 2);
-            for (int jj = 0; jj < mesh_order; jj++) {
-              int offset = ii + jj * mesh_order + kk * mesh_order * mesh_order;
+            const int ii = (order - 1) * (edge_index % 2);
+            const int kk = (order - 1) * ((edge_index - 4) / 2);
+            for (int jj = 0; jj < order; jj++) {
+              int offset = ii + jj * order + kk * order * order;
               dep_edge_nodes[jj] = c[offset];
             }
           } else {
-            const int ii = (mesh_order - 1) * (edge_index % 2);
-            const int jj = (mesh_order - 1) * ((edge_index - 8) / 2);
-            for (int kk = 0; kk < mesh_order; kk++) {
-              int offset = ii + jj * mesh_order + kk * mesh_order * mesh_order;
+            const int ii = (order - 1) * (edge_index % 2);
+            const int jj = (order - 1) * ((edge_index - 8) / 2);
+            for (int kk = 0; kk < order; kk++) {
+              int offset = ii + jj * order + kk * order * order;
               dep_edge_nodes[kk] = c[offset];
             }
           }
 
           // Find the node indices of the parent
-          getEdgeNodes(&parent, edge_index, nodes, node_offset, edge_nodes);
+          getEdgeNodes<ORDER>(&parent, edge_index, nodes, node_offset,
+                              edge_nodes);
 
-          for (int k = 0; k < mesh_order; k++) {
+          for (int k = 0; k < order; k++) {
             // If it's a negative number, it's a dependent node
             // whose interpolation must be set
             int index = node_nums[dep_edge_nodes[k]];
@@ -5348,44 +7757,27 @@ void TMROctForest::createDependentConn(const int *node_nums,
               index = -index - 1;
 
               int len = dep_ptr[index + 1] - dep_ptr[index];
-              if (len == mesh_order) {
+              if (len == order) {
                 // Compute the offsets to add (if any)
                 int x = id % 2;
                 int y = ((id % 4) / 2);
                 int z = id / 4;
 
-                // Compute the shape functions
+                // Set the connectivity
                 int ptr = dep_ptr[index];
-                for (int j = 0; j < mesh_order; j++) {
+                for (int j = 0; j < order; j++) {
                   dep_conn[ptr + j] = edge_nodes[j];
                 }
 
-                // Evaluate the weights based on the interpolation type
-                if (interp_type == TMR_BERNSTEIN_POINTS) {
-                  int u = 0;
-                  if (edge_index < 4) {
-                    u = (mesh_order - 1) * (x - 1) + k;
-                  } else if (edge_index < 8) {
-                    u = (mesh_order - 1) * (y - 1) + k;
-                  } else {
-                    u = (mesh_order - 1) * (z - 1) + k;
-                  }
-                  // Evaluate dependent weights
-                  eval_bernstein_weights(mesh_order, u, &dep_weights[ptr]);
+                // Set the weight template along the edge
+                if (edge_index < 4) {
+                  dep_tmpl[2 * index] = order * x + k;
+                } else if (edge_index < 8) {
+                  dep_tmpl[2 * index] = order * y + k;
                 } else {
-                  // Compute parametric location along the edge
-                  double u = 0.0;
-                  if (edge_index < 4) {
-                    u = 1.0 * (x - 1) + 0.5 * (1.0 + interp_knots[k]);
-                  } else if (edge_index < 8) {
-                    u = 1.0 * (y - 1) + 0.5 * (1.0 + interp_knots[k]);
-                  } else {
-                    u = 1.0 * (z - 1) + 0.5 * (1.0 + interp_knots[k]);
-                  }
-                  // Evaluate the shape functions
-                  lagrange_shape_functions(mesh_order, u, interp_knots,
-                                           &dep_weights[ptr]);
+                  dep_tmpl[2 * index] = order * z + k;
                 }
+                dep_tmpl[2 * index + 1] = -1;
               }
             }
           }
@@ -5396,110 +7788,68 @@ void TMROctForest::createDependentConn(const int *node_nums,
         if (face_info & 1 << face_index) {
           // Get the edges node numbers from the dependent edge
           if (face_index < 2) {
-            const int ii = (mesh_order - 1) * (face_index % 2);
-            for (int kk = 0; kk < mesh_order; kk++) {
-              for (int jj = 0; jj < mesh_order; jj++) {
-                int offset =
-                    ii + jj * mesh_order + kk * mesh_order * mesh_order;
-                dep_face_nodes[jj + kk * mesh_order] = c[offset];
+            const int ii = (order - 1) * (face_index % 2);
+            for (int kk = 0; kk < order; kk++) {
+              for (int jj = 0; jj < order; jj++) {
+                int offset = ii + jj * order + kk * order * order;
+                dep_face_nodes[jj + kk * order] = c[offset];
               }
             }
           } else if (face_index < 4) {
-            const int jj = (mesh_order - 1) * (face_index % 2);
-            for (int kk = 0; kk < mesh_order; kk++) {
-              for (int ii = 0; ii < mesh_order; ii++) {
-                int offset =
-                    ii + jj * mesh_order + kk * mesh_order * mesh_order;
-                dep_face_nodes[ii + kk * mesh_order] = c[offset];
+            const int jj = (order - 1) * (face_index % 2);
+            for (int kk = 0; kk < order; kk++) {
+              for (int ii = 0; ii < order; ii++) {
+                int offset = ii + jj * order + kk * order * order;
+                dep_face_nodes[ii + kk * order] = c[offset];
               }
             }
           } else {
-            const int kk = (mesh_order - 1) * (face_index % 2);
-            for (int jj = 0; jj < mesh_order; jj++) {
-              for (int ii = 0; ii < mesh_order; ii++) {
-                int offset =
-                    ii + jj * mesh_order + kk * mesh_order * mesh_order;
-                dep_face_nodes[ii + jj * mesh_order] = c[offset];
+            const int kk = (order - 1) * (face_index % 2);
+            for (int jj = 0; jj < order; jj++) {
+              for (int ii = 0; ii < order; ii++) {
+                int offset = ii + jj * order + kk * order * order;
+                dep_face_nodes[ii + jj * order] = c[offset];
               }
             }
           }
 
           // Get the face nodes associated with the parent face
-          getFaceNodes(&parent, face_index, nodes, node_offset, face_nodes);
+          getFaceNodes<ORDER>(&parent, face_index, nodes, node_offset,
+                              face_nodes);
 
           // Set the node index in the mesh
-          for (int jj = 0; jj < mesh_order; jj++) {
-            for (int ii = 0; ii < mesh_order; ii++) {
+          for (int jj = 0; jj < order; jj++) {
+            for (int ii = 0; ii < order; ii++) {
               // Get the dependent edge nodes
-              int offset = ii + jj * mesh_order;
+              int offset = ii + jj * order;
 
               int index = node_nums[dep_face_nodes[offset]];
               if (index < 0) {
                 index = -index - 1;
 
                 int len = dep_ptr[index + 1] - dep_ptr[index];
-                if (len == mesh_order * mesh_order) {
+                if (len == order * order) {
                   // Compute the offsets to add (if any)
                   int x = id % 2;
                   int y = ((id % 4) / 2);
                   int z = id / 4;
 
-                  // Compute the distance along the edges
-                  double u = 0.0;
-                  double v = 0.0;
-
-                  // Evaluate the parametric point differently depending on the
-                  // interpolation type
-                  if (interp_type == TMR_BERNSTEIN_POINTS) {
-                    int u = -(mesh_order - 1) + ii;
-                    int v = -(mesh_order - 1) + jj;
-
-                    if (face_index < 2) {
-                      // add the y/z components
-                      u += (mesh_order - 1) * y;
-                      v += (mesh_order - 1) * z;
-                    } else if (face_index < 4) {
-                      // add the x/z components
-                      u += (mesh_order - 1) * x;
-                      v += (mesh_order - 1) * z;
-                    } else {
-                      // add the x/y components
-                      u += (mesh_order - 1) * x;
-                      v += (mesh_order - 1) * y;
-                    }
-
-                    // Evaluate dependent weights
-                    eval_bernstein_weights(mesh_order, u, Nu);
-                    eval_bernstein_weights(mesh_order, v, Nv);
+                  // Set the weight templates along the u/v directions
+                  if (face_index < 2) {
+                    dep_tmpl[2 * index] = order * y + ii;
+                    dep_tmpl[2 * index + 1] = order * z + jj;
+                  } else if (face_index < 4) {
+                    dep_tmpl[2 * index] = order * x + ii;
+                    dep_tmpl[2 * index + 1] = order * z + jj;
                   } else {
-                    u = -1.0 + 0.5 * (1.0 + interp_knots[ii]);
-                    v = -1.0 + 0.5 * (1.0 + interp_knots[jj]);
-
-                    if (face_index < 2) {
-                      // add the y/z components
-                      u += 1.0 * y;
-                      v += 1.0 * z;
-                    } else if (face_index < 4) {
-                      // add the x/z components
-                      u += 1.0 * x;
-                      v += 1.0 * z;
-                    } else {
-                      // add the x/y components
-                      u += 1.0 * x;
-                      v += 1.0 * y;
-                    }
-
-                    // Evaluate the shape functions
-                    lagrange_shape_functions(mesh_order, u, interp_knots, Nu);
-                    lagrange_shape_functions(mesh_order, v, interp_knots, Nv);
+                    dep_tmpl[2 * index] = order * x + ii;
+                    dep_tmpl[2 * index + 1] = order * y + jj;
                   }
 
-                  // Add the appropriate offset along the u/v directions
+                  // Set the connectivity
                   int ptr = dep_ptr[index];
-                  for (int j = 0; j < mesh_order * mesh_order; j++) {
+                  for (int j = 0; j < order * order; j++) {
                     dep_conn[ptr + j] = face_nodes[j];
-                    dep_weights[ptr + j] =
-                        Nu[j % mesh_order] * Nv[j / mesh_order];
                   }
                 }
               }
@@ -5510,12 +7860,6 @@ void TMROctForest::createDependentConn(const int *node_nums,
     }
   }
 
-  delete[] edge_nodes;
-  delete[] dep_edge_nodes;
-  delete[] face_nodes;
-  delete[] dep_face_nodes;
-  delete[] Nu;
-  delete[] Nv;
 }
 
 /*
@@ -5528,6 +7872,7 @@ void TMROctForest::evaluateNodeLocations() {
 
   int *flags = new int[num_local_nodes];
   memset(flags, 0, num_local_nodes * sizeof(int));
+  addTransient(num_local_nodes * sizeof(int));
 
   int num_elements;
   TMROctant *octs;
@@ -5595,17 +7940,14 @@ void TMROctForest::evaluateNodeLocations() {
       // Set the offset into the connectivity array
       const int *c = &conn[mesh_order * mesh_order * mesh_order * i];
 
-      for (int kk = 0; kk < mesh_order; kk++) {
-        for (int jj = 0; jj < mesh_order; jj++) {
-          for (int ii = 0; ii < mesh_order; ii++) {
-            int local_index =
-                ii + jj * mesh_order + kk * mesh_order * mesh_order;
-            vol->evalPoint(u + 0.5 * d * (1.0 + knots[ii]),
-                           v + 0.5 * d * (1.0 + knots[jj]),
-                           w + 0.5 * d * (1.0 + knots[kk]), &Xtmp[local_index]);
-          }
-        }
+      // Evaluate the grid of points within the element
+      double upts[MAX_ORDER], vpts[MAX_ORDER], wpts[MAX_ORDER];
+      for (int ii = 0; ii < mesh_order; ii++) {
+        upts[ii] = u + 0.5 * d * (1.0 + knots[ii]);
+        vpts[ii] = v + 0.5 * d * (1.0 + knots[ii]);
+        wpts[ii] = w + 0.5 * d * (1.0 + knots[ii]);
       }
+      evalNodeGrid(vol, octs[i].block, mesh_order, upts, vpts, wpts, Xtmp);
 
       // Look for nodes that are not assigned
       for (int kk = 0; kk < mesh_order; kk++) {
@@ -5634,6 +7976,9 @@ void TMROctForest::evaluateNodeLocations() {
     delete[] inverse;
     delete[] Xtmp;
   } else if (topo) {
+    // Allocate storage for the element node locations
+    TMRPoint *Xtmp = new TMRPoint[mesh_order * mesh_order * mesh_order];
+
     for (int i = 0; i < num_elements; i++) {
       // Get the right surface
       TMRVolume *vol;
@@ -5652,28 +7997,121 @@ void TMROctForest::evaluateNodeLocations() {
       // Set the offset into the connectivity array
       const int *c = &conn[mesh_order * mesh_order * mesh_order * i];
 
+      // Count the nodes that are not assigned
+      int count = 0;
+      for (int k = 0; k < mesh_order * mesh_order * mesh_order; k++) {
+        if (!flags[getLocalNodeNumber(c[k])]) {
+          count++;
+        }
+      }
+
+      // When enough of the nodes are not assigned, evaluate the whole
+      // grid of points within the element at once. This evaluates
+      // the volume along each direction only mesh_order times.
+      int use_grid = (count > mesh_order);
+      if (use_grid) {
+        double upts[MAX_ORDER], vpts[MAX_ORDER], wpts[MAX_ORDER];
+        for (int ii = 0; ii < mesh_order; ii++) {
+          upts[ii] = u + 0.5 * d * (1.0 + knots[ii]);
+          vpts[ii] = v + 0.5 * d * (1.0 + knots[ii]);
+          wpts[ii] = w + 0.5 * d * (1.0 + knots[ii]);
+        }
+        evalNodeGrid(vol, octs[i].block, mesh_order, upts, vpts, wpts, Xtmp);
+      }
+
       // Look for nodes that are not assigned
       for (int kk = 0; kk < mesh_order; kk++) {
         for (int jj = 0; jj < mesh_order; jj++) {
           for (int ii = 0; ii < mesh_order; ii++) {
             // Compute the mesh index
-            int node = c[ii + jj * mesh_order + kk * mesh_order * mesh_order];
-            int index = getLocalNodeNumber(node);
+            int local_index =
+                ii + jj * mesh_order + kk * mesh_order * mesh_order;
+            int index = getLocalNodeNumber(c[local_index]);
             if (!flags[index]) {
               flags[index] = 1;
-              vol->evalPoint(u + 0.5 * d * (1.0 + knots[ii]),
-                             v + 0.5 * d * (1.0 + knots[jj]),
-                             w + 0.5 * d * (1.0 + knots[kk]), &X[index]);
+              if (use_grid) {
+                X[index] = Xtmp[local_index];
+              } else {
+                evalNodePoint(vol, octs[i].block,
+                              u + 0.5 * d * (1.0 + knots[ii]),
+                              v + 0.5 * d * (1.0 + knots[jj]),
+                              w + 0.5 * d * (1.0 + knots[kk]), &X[index]);
+              }
             }
           }
         }
       }
     }
+
+    delete[] Xtmp;
   }
 
+  removeTransient(num_local_nodes * sizeof(int));
   delete[] flags;
 }
 
+/*
+  Evaluate the location of a point within a volume
+
+  The point is retrieved from the cache of node locations if it has
+  already been evaluated. Otherwise it is evaluated from the volume and
+  added to the cache.
+*/
+void TMROctForest::evalNodePoint(TMRVolume *vol, int block, double u,
+                                 double v, double w, TMRPoint *pt) {
+  if (node_cache && node_cache->getPoint(block, u, v, w, pt)) {
+    return;
+  }
+  vol->evalPoint(u, v, w, pt);
+  if (node_cache) {
+    node_cache->addPoint(block, u, v, w, pt);
+  }
+}
+
+/*
+  Evaluate the locations of the n^3 tensor grid of points within a
+  volume, X[i + n*(j + n*k)] at (u[i], v[j], w[k])
+
+  The grid is evaluated from the volume unless all of the points are
+  already in the cache. The points that are in the cache are retrieved
+  from it, while the remaining points are added to the cache.
+*/
+void TMROctForest::evalNodeGrid(TMRVolume *vol, int block, int n,
+                                const double u[], const double v[],
+                                const double w[], TMRPoint X[]) {
+  if (node_cache) {
+    int nmiss = 0;
+    for (int k = 0; k < n; k++) {
+      for (int j = 0; j < n; j++) {
+        for (int i = 0; i < n; i++) {
+          if (!node_cache->getPoint(block, u[i], v[j], w[k],
+                                    &X[i + n * (j + n * k)])) {
+            nmiss++;
+          }
+        }
+      }
+    }
+    if (nmiss == 0) {
+      return;
+    }
+  }
+
+  vol->evalGrid(n, u, n, v, n, w, X);
+
+  if (node_cache) {
+    for (int k = 0; k < n; k++) {
+      for (int j = 0; j < n; j++) {
+        for (int i = 0; i < n; i++) {
+          TMRPoint *pt = &X[i + n * (j + n * k)];
+          if (!node_cache->getPoint(block, u[i], v[j], w[k], pt)) {
+            node_cache->addPoint(block, u[i], v[j], w[k], pt);
+          }
+        }
+      }
+    }
+  }
+}
+
 /*
   Get the nodal connectivity. This can only be called after the nodes
   have been created.
@@ -5723,216 +8161,95 @@ int TMROctForest::getDepNodeConn(const int **ptr, const int **conn,
     *conn = dep_conn;
   }
   if (weights) {
+    // Expand the weights from the templates the first time they
+    // are requested
+    if (!dep_weights && dep_tmpl) {
+      dep_weights = new double[dep_ptr[num_dep_nodes]];
+      for (int i = 0; i < num_dep_nodes; i++) {
+        const double *Nu = &dep_tmpl_weights[mesh_order * dep_tmpl[2 * i]];
+        double *w = &dep_weights[dep_ptr[i]];
+        if (dep_tmpl[2 * i + 1] < 0) {
+          for (int j = 0; j < mesh_order; j++) {
+            w[j] = Nu[j];
+          }
+        } else {
+          const double *Nv =
+              &dep_tmpl_weights[mesh_order * dep_tmpl[2 * i + 1]];
+          for (int j = 0; j < mesh_order * mesh_order; j++) {
+            w[j] = Nu[j % mesh_order] * Nv[j / mesh_order];
+          }
+        }
+      }
+    }
     *weights = dep_weights;
   }
   return num_dep_nodes;
 }
 
 /*
-  Get the elements that either lie in a volume, on a face or on a
-  curve with a given name.
+  Get the compact form of the dependent node weights. Note that this
+  call is not collective.
 
-  This code loops over all octants that are locally owned on this
-  processor and checks the name of the underlying topological
-  entry. If the volume name matches, the octant is added
-  directly, otherwise the local face or volume index is set as the
-  tag.
+  The weights of each dependent node are stored as indices into a
+  small table of templates that depend only on the mesh order, the
+  interpolation type and the position of the node on the refined
+  edge or face. Each template contains mesh_order weights. The
+  weights of dependent node i are
 
-  input:
-  name:   string name associated with the geometric feature
+  Nu = &tmpl_weights[mesh_order*tmpl[2*i]]
 
-  returns:
-  list:   an array of octants satisfying the name
-*/
-TMROctantArray *TMROctForest::getOctsWithName(const char *name) {
-  if (!topo) {
-    fprintf(stderr,
-            "TMROctForest Error: Must define topology to use "
-            "getOctsWithName()\n");
-    return NULL;
-  }
-  if (!octants) {
-    fprintf(stderr,
-            "TMROctForest: Must create octants to use "
-            "getOctsWithName()\n");
-    return NULL;
-  }
+  on an edge, where tmpl[2*i+1] = -1, and the tensor product
 
-  // Set the flag if the name is NULL
-  int name_is_null = 1;
-  if (name) {
-    name_is_null = 0;
-  }
+  Nu[j % mesh_order]*Nv[j / mesh_order]
 
-  // Create a queue to store the elements that we find
-  TMROctantQueue *queue = new TMROctantQueue();
+  with Nv = &tmpl_weights[mesh_order*tmpl[2*i+1]] on a face.
 
-  // Get the octants
-  int size;
-  TMROctant *array;
-  octants->getArray(&array, &size);
+  output:
+  tmpl:          the pair of template indices for each dependent node
+  tmpl_weights:  the table of templates
 
-  // Loop over the octants and find out whether it touches
-  // a face or edge with the prescribed name
-  const int32_t hmax = 1 << TMR_MAX_LEVEL;
-  for (int i = 0; i < size; i++) {
-    const int32_t h = 1 << (TMR_MAX_LEVEL - array[i].level);
-
-    // Get the surface octant
-    TMRVolume *vol;
-    topo->getVolume(array[i].block, &vol);
-    const char *vol_name = vol->getName();
-    if ((name_is_null && !vol_name) ||
-        (vol_name && strcmp(vol_name, name) == 0)) {
-      queue->push(&array[i]);
-    } else {
-      // If this is a root octant, then we should check all of the
-      // sides, otherwise we will only check a maximum of three of the
-      // sides to see if the face name matches
-      if (array[i].level == 0) {
-        for (int face_index = 0; face_index < 6; face_index++) {
-          TMROctant oct = array[i];
-          int face_num =
-              bdata->block_face_conn[6 * array[i].block + face_index];
-          TMRFace *face;
-          topo->getFace(face_num, &face);
-          const char *face_name = face->getName();
-          if ((name_is_null && !face_name) ||
-              (face_name && strcmp(face_name, name) == 0)) {
-            oct.info = face_index;
-            queue->push(&oct);
-          }
-        }
-      } else {
-        // Check if this octant lies on one or more face
-        int fx0 = (array[i].x == 0);
-        int fy0 = (array[i].y == 0);
-        int fz0 = (array[i].z == 0);
-        int fx = (fx0 || array[i].x + h == hmax);
-        int fy = (fy0 || array[i].y + h == hmax);
-        int fz = (fz0 || array[i].z + h == hmax);
-
-        if (fx || fy || fz) {
-          TMRFace *face = NULL;
-          TMROctant oct = array[i];
-          if (fx) {
-            int face_index = (fx0 ? 0 : 1);
-            int face_num =
-                bdata->block_face_conn[6 * array[i].block + face_index];
-            topo->getFace(face_num, &face);
-            const char *face_name = face->getName();
-            if ((name_is_null && !face_name) ||
-                (face_name && strcmp(face_name, name) == 0)) {
-              oct.info = face_index;
-              queue->push(&oct);
-            }
-          }
-          if (fy) {
-            int face_index = (fy0 ? 2 : 3);
-            int face_num =
-                bdata->block_face_conn[6 * array[i].block + face_index];
-            topo->getFace(face_num, &face);
-            const char *face_name = face->getName();
-            if ((name_is_null && !face_name) ||
-                (face_name && strcmp(face_name, name) == 0)) {
-              oct.info = face_index;
-              queue->push(&oct);
-            }
-          }
-          if (fz) {
-            int face_index = (fz0 ? 4 : 5);
-            int face_num =
-                bdata->block_face_conn[6 * array[i].block + face_index];
-            topo->getFace(face_num, &face);
-            const char *face_name = face->getName();
-            if ((name_is_null && !face_name) ||
-                (face_name && strcmp(face_name, name) == 0)) {
-              oct.info = face_index;
-              queue->push(&oct);
-            }
-          }
-        }
-      }
-    }
+  returns:       the number of dependent nodes
+*/
+int TMROctForest::getDepNodeTemplates(const int **tmpl,
+                                      const double **tmpl_weights) {
+  if (tmpl) {
+    *tmpl = dep_tmpl;
   }
-
-  TMROctantArray *list = queue->toArray();
-  delete queue;
-  return list;
+  if (tmpl_weights) {
+    *tmpl_weights = dep_tmpl_weights;
+  }
+  return num_dep_nodes;
 }
 
 /*
-  Create an array of the nodes that are lie on a surface, edge or
-  corner with a given name
-
-  This code loops over all nodes and check whether they lie on a
-  geometric entity that has the given name. If the intersect flag
-  is active (which is the default), then only the owner is checked,
-  e.g. if the node lies on a corner, only the name of the vertex
-  is checked. If intersect is false then the edge, face and volume
-  names are also check and the node is added if any of them
-  match.
-
-  input:
-  name:       the string of the name to search
-
-  returns:
-  list:   the nodes matching the specified name
+  Create the index from the names of the topological entities to the
+  local octants and nodes
+
+  An octant is added for the name of its volume and, for each face of
+  the block that it touches with a different name, a copy of the
+  octant is added with the face index as its info. Octants at the
+  root level are added for all six faces of the block. The nodes of
+  the octant that lie on each vertex, edge or face of the block are
+  added for the name of that entity, and all the nodes of the octant
+  are added for the name of its volume, if it is named. The nodes are
+  only added when the connectivity has been created.
 */
-int TMROctForest::getNodesWithName(const char *name, int **_nodes) {
-  if (!topo) {
-    fprintf(stderr,
-            "TMROctForest Error: Must define topology to use "
-            "getNodesWithName()\n");
-    *_nodes = NULL;
-    return 0;
-  }
-  if (!conn) {
-    fprintf(stderr,
-            "TMROctForest Error: Nodes must be created before calling "
-            "getNodesWithName()\n");
-    *_nodes = NULL;
-    return 0;
-  }
+TMRNameIndex *TMROctForest::createNameIndex() {
+  TMRNameIndex *index = new TMRNameIndex(topo);
 
   // The max octant edge length
   const int32_t hmax = 1 << TMR_MAX_LEVEL;
 
-  // Set the flag if the name is NULL
-  int name_is_null = 1;
-  if (name) {
-    name_is_null = 0;
-  }
-
-  int count = 0;                      // Current node count
-  int max_len = 1024;                 // max length of the node list
-  int *node_list = new int[max_len];  // Nodes touching this name
-
   // Get the octants
   int size;
   TMROctant *octs;
   octants->getArray(&octs, &size);
 
-  // Max node increment
-  const int max_node_incr = 8 + 12 * mesh_order + 6 * mesh_order * mesh_order +
-                            mesh_order * mesh_order * mesh_order;
-
-  // Loop over the octants and find out whether it touches a face or
-  // edge with the prescribed name
   for (int i = 0; i < size; i++) {
-    if (count + max_node_incr > max_len) {
-      // Extend the length of the array
-      max_len = 2 * max_len + max_node_incr;
-      int *tmp = new int[max_len];
-      memcpy(tmp, node_list, count * sizeof(int));
-      delete[] node_list;
-      node_list = tmp;
-    }
-
     // Compute the octant edge length
     const int32_t h = 1 << (TMR_MAX_LEVEL - octs[i].level);
 
-    // Check if this node lies on an octree boundary
+    // Check if this octant lies on an octree boundary
     int fx0 = (octs[i].x == 0);
     int fy0 = (octs[i].y == 0);
     int fz0 = (octs[i].z == 0);
@@ -5943,6 +8260,44 @@ int TMROctForest::getNodesWithName(const char *name, int **_nodes) {
     int fy = fy0 || fy1;
     int fz = fz0 || fz1;
 
+    // Add the octant for the volume name and the face names
+    const int *face_conn = &bdata->block_face_conn[6 * octs[i].block];
+    int vol_name = index->getVolumeName(octs[i].block);
+    index->addElement(vol_name, i, -1);
+
+    if (octs[i].level == 0) {
+      for (int face_index = 0; face_index < 6; face_index++) {
+        int face_name = index->getFaceName(face_conn[face_index]);
+        if (face_name != vol_name) {
+          index->addElement(face_name, i, face_index);
+        }
+      }
+    } else {
+      int face_index[3], nfaces = 0;
+      if (fx) {
+        face_index[nfaces] = (fx0 ? 0 : 1);
+        nfaces++;
+      }
+      if (fy) {
+        face_index[nfaces] = (fy0 ? 2 : 3);
+        nfaces++;
+      }
+      if (fz) {
+        face_index[nfaces] = (fz0 ? 4 : 5);
+        nfaces++;
+      }
+      for (int k = 0; k < nfaces; k++) {
+        int face_name = index->getFaceName(face_conn[face_index[k]]);
+        if (face_name != vol_name) {
+          index->addElement(face_name, i, face_index[k]);
+        }
+      }
+    }
+
+    if (!conn) {
+      continue;
+    }
+
     // Set a pointer into the connectivity array
     const int *c = &conn[mesh_order * mesh_order * mesh_order * octs[i].tag];
 
@@ -5984,20 +8339,13 @@ int TMROctForest::getNodesWithName(const char *name, int **_nodes) {
       }
 
       for (int k = 0; k < nverts; k++) {
-        TMRVertex *vert;
         int vert_num = bdata->block_conn[8 * octs[i].block + vert_index[k]];
-        topo->getVertex(vert_num, &vert);
-        const char *vert_name = vert->getName();
-        if ((name_is_null && !vert_name) ||
-            (vert_name && strcmp(vert_name, name) == 0)) {
-          int offset =
-              ((mesh_order - 1) * (vert_index[k] % 2) +
-               (mesh_order - 1) * mesh_order * ((vert_index[k] % 4) / 2) +
-               (mesh_order - 1) * mesh_order * mesh_order *
-                   (vert_index[k] / 4));
-          node_list[count] = c[offset];
-          count++;
-        }
+        int vert_name = index->getVertexName(vert_num);
+        int offset =
+            ((mesh_order - 1) * (vert_index[k] % 2) +
+             (mesh_order - 1) * mesh_order * ((vert_index[k] % 4) / 2) +
+             (mesh_order - 1) * mesh_order * mesh_order * (vert_index[k] / 4));
+        index->addNode(vert_name, c[offset]);
       }
     }
     if ((fy && fz) || (fx && fz) || (fx && fy)) {
@@ -6060,37 +8408,29 @@ int TMROctForest::getNodesWithName(const char *name, int **_nodes) {
 
       // This node lies on an edge
       for (int k = 0; k < nedges; k++) {
-        TMREdge *edge;
         int edge_num =
             bdata->block_edge_conn[12 * octs[i].block + edge_index[k]];
-        topo->getEdge(edge_num, &edge);
-        const char *edge_name = edge->getName();
-        if ((name_is_null && !edge_name) ||
-            (edge_name && strcmp(edge_name, name) == 0)) {
-          if (edge_index[k] < 4) {
-            const int jj = (mesh_order - 1) * (edge_index[k] % 2);
-            const int kk = (mesh_order - 1) * (edge_index[k] / 2);
-            for (int ii = 0; ii < mesh_order; ii++) {
-              int offset = ii + jj * mesh_order + kk * mesh_order * mesh_order;
-              node_list[count] = c[offset];
-              count++;
-            }
-          } else if (edge_index[k] < 8) {
-            const int ii = (mesh_order - 1) * (edge_index[k] % 2);
-            const int kk = (mesh_order - 1) * ((edge_index[k] - 4) / 2);
-            for (int jj = 0; jj < mesh_order; jj++) {
-              int offset = ii + jj * mesh_order + kk * mesh_order * mesh_order;
-              node_list[count] = c[offset];
-              count++;
-            }
-          } else {
-            const int ii = (mesh_order - 1) * (edge_index[k] % 2);
-            const int jj = (mesh_order - 1) * ((edge_index[k] - 8) / 2);
-            for (int kk = 0; kk < mesh_order; kk++) {
-              int offset = ii + jj * mesh_order + kk * mesh_order * mesh_order;
-              node_list[count] = c[offset];
-              count++;
-            }
+        int edge_name = index->getEdgeName(edge_num);
+        if (edge_index[k] < 4) {
+          const int jj = (mesh_order - 1) * (edge_index[k] % 2);
+          const int kk = (mesh_order - 1) * (edge_index[k] / 2);
+          for (int ii = 0; ii < mesh_order; ii++) {
+            int offset = ii + jj * mesh_order + kk * mesh_order * mesh_order;
+            index->addNode(edge_name, c[offset]);
+          }
+        } else if (edge_index[k] < 8) {
+          const int ii = (mesh_order - 1) * (edge_index[k] % 2);
+          const int kk = (mesh_order - 1) * ((edge_index[k] - 4) / 2);
+          for (int jj = 0; jj < mesh_order; jj++) {
+            int offset = ii + jj * mesh_order + kk * mesh_order * mesh_order;
+            index->addNode(edge_name, c[offset]);
+          }
+        } else {
+          const int ii = (mesh_order - 1) * (edge_index[k] % 2);
+          const int jj = (mesh_order - 1) * ((edge_index[k] - 8) / 2);
+          for (int kk = 0; kk < mesh_order; kk++) {
+            int offset = ii + jj * mesh_order + kk * mesh_order * mesh_order;
+            index->addNode(edge_name, c[offset]);
           }
         }
       }
@@ -6123,85 +8463,216 @@ int TMROctForest::getNodesWithName(const char *name, int **_nodes) {
         nfaces++;
       }
 
-      // Which face index are we dealing with?
       for (int k = 0; k < nfaces; k++) {
-        TMRFace *face;
-        int face_num =
-            bdata->block_face_conn[6 * octs[i].block + face_index[k]];
-        topo->getFace(face_num, &face);
-        const char *face_name = face->getName();
-        if ((name_is_null && !face_name) ||
-            (face_name && strcmp(face_name, name) == 0)) {
-          if (face_index[k] < 2) {
-            const int ii = (mesh_order - 1) * (face_index[k] % 2);
-            for (int kk = 0; kk < mesh_order; kk++) {
-              for (int jj = 0; jj < mesh_order; jj++) {
-                int offset =
-                    ii + jj * mesh_order + kk * mesh_order * mesh_order;
-                node_list[count] = c[offset];
-                count++;
-              }
-            }
-          } else if (face_index[k] < 4) {
-            const int jj = (mesh_order - 1) * (face_index[k] % 2);
-            for (int kk = 0; kk < mesh_order; kk++) {
-              for (int ii = 0; ii < mesh_order; ii++) {
-                int offset =
-                    ii + jj * mesh_order + kk * mesh_order * mesh_order;
-                node_list[count] = c[offset];
-                count++;
-              }
-            }
-          } else {
-            const int kk = (mesh_order - 1) * (face_index[k] % 2);
+        int face_name = index->getFaceName(face_conn[face_index[k]]);
+        if (face_index[k] < 2) {
+          const int ii = (mesh_order - 1) * (face_index[k] % 2);
+          for (int kk = 0; kk < mesh_order; kk++) {
             for (int jj = 0; jj < mesh_order; jj++) {
-              for (int ii = 0; ii < mesh_order; ii++) {
-                int offset =
-                    ii + jj * mesh_order + kk * mesh_order * mesh_order;
-                node_list[count] = c[offset];
-                count++;
-              }
+              int offset = ii + jj * mesh_order + kk * mesh_order * mesh_order;
+              index->addNode(face_name, c[offset]);
             }
           }
-        }
-      }
-    } else {
-      TMRVolume *volume;
-      topo->getVolume(octs[i].block, &volume);
-      const char *volume_name = volume->getName();
-      if ((name_is_null && !volume_name) ||
-          (volume_name && strcmp(volume_name, name) == 0)) {
-        for (int kk = 0; kk < mesh_order; kk++) {
+        } else if (face_index[k] < 4) {
+          const int jj = (mesh_order - 1) * (face_index[k] % 2);
+          for (int kk = 0; kk < mesh_order; kk++) {
+            for (int ii = 0; ii < mesh_order; ii++) {
+              int offset = ii + jj * mesh_order + kk * mesh_order * mesh_order;
+              index->addNode(face_name, c[offset]);
+            }
+          }
+        } else {
+          const int kk = (mesh_order - 1) * (face_index[k] % 2);
           for (int jj = 0; jj < mesh_order; jj++) {
             for (int ii = 0; ii < mesh_order; ii++) {
               int offset = ii + jj * mesh_order + kk * mesh_order * mesh_order;
-              node_list[count] = c[offset];
+              index->addNode(face_name, c[offset]);
             }
           }
         }
       }
     }
+
+    // Add all the nodes of the octant for a named volume
+    if (vol_name > 0) {
+      const int len = mesh_order * mesh_order * mesh_order;
+      for (int k = 0; k < len; k++) {
+        index->addNode(vol_name, c[k]);
+      }
+    }
   }
 
-  // Now, sort the node numbers and remove duplicates
-  qsort(node_list, count, sizeof(int), compare_integers);
+  index->finalize();
+  return index;
+}
 
-  // Remove duplicates from the array
-  int len = 0;
-  for (int ptr = 0; ptr < count; ptr++, len++) {
-    while ((ptr < count - 1) && (node_list[ptr] == node_list[ptr + 1])) {
-      ptr++;
+/*
+  Get the elements that either lie in a volume, on a face or on a
+  curve with a given name.
+
+  The octants are found from the name index. If the volume name
+  matches, the octant is added directly, otherwise the local face
+  index is set as the info. Once the nodes have been created, the
+  index is stored and re-used until the mesh data is freed, so that
+  each call only costs the size of the result.
+
+  input:
+  name:   string name associated with the geometric feature
+
+  returns:
+  list:   an array of octants satisfying the name
+*/
+TMROctantArray *TMROctForest::getOctsWithName(const char *name) {
+  if (!topo) {
+    fprintf(stderr,
+            "TMROctForest Error: Must define topology to use "
+            "getOctsWithName()\n");
+    return NULL;
+  }
+  if (!octants) {
+    fprintf(stderr,
+            "TMROctForest: Must create octants to use "
+            "getOctsWithName()\n");
+    return NULL;
+  }
+
+  // Discard the stored index if an entity has been renamed
+  if (name_index && !name_index->isCurrent()) {
+    name_index->decref();
+    name_index = NULL;
+  }
+
+  // Use the stored index if the nodes exist, otherwise create a
+  // temporary index for the octants alone
+  TMRNameIndex *index = name_index;
+  if (!index) {
+    index = createNameIndex();
+    if (conn) {
+      name_index = index;
+      name_index->incref();
     }
+  }
+  index->incref();
+
+  // Get the octants
+  int size;
+  TMROctant *array;
+  octants->getArray(&array, &size);
 
-    if (ptr != len) {
-      node_list[len] = node_list[ptr];
+  const int *elems, *info;
+  int nelems = index->getElements(name, &elems, &info);
+  TMROctant *list = new TMROctant[nelems];
+  for (int i = 0; i < nelems; i++) {
+    list[i] = array[elems[i]];
+    if (info[i] >= 0) {
+      list[i].info = info[i];
     }
   }
+  index->decref();
+
+  return new TMROctantArray(list, nelems);
+}
+
+/*
+  Create an array of the nodes that are lie on a surface, edge or
+  corner with a given name
+
+  The nodes are those that lie on a vertex, edge or face with the
+  given name, or within a volume with the given name. The nodes are
+  found from the name index that is created once for each set of
+  nodes, and again if an entity is renamed.
+
+  input:
+  name:       the string of the name to search
+
+  returns:
+  list:   the sorted nodes matching the specified name
+*/
+int TMROctForest::getNodesWithName(const char *name, int **_nodes) {
+  if (!topo) {
+    fprintf(stderr,
+            "TMROctForest Error: Must define topology to use "
+            "getNodesWithName()\n");
+    *_nodes = NULL;
+    return 0;
+  }
+  if (!conn) {
+    fprintf(stderr,
+            "TMROctForest Error: Nodes must be created before calling "
+            "getNodesWithName()\n");
+    *_nodes = NULL;
+    return 0;
+  }
+
+  // Create the index if it does not exist or an entity has been renamed
+  if (name_index && !name_index->isCurrent()) {
+    name_index->decref();
+    name_index = NULL;
+  }
+  if (!name_index) {
+    name_index = createNameIndex();
+    name_index->incref();
+  }
+
+  const int *nodes;
+  int len = name_index->getNodes(name, &nodes);
+  int *node_list = new int[len];
+  memcpy(node_list, nodes, len * sizeof(int));
 
   *_nodes = node_list;
   return len;
 }
 
+/*
+  Find the index in the element array at which to begin the search
+  for the element that encloses a node
+
+  The search only uses the position of the element that contains the
+  node and not the node index itself. The result can therefore be
+  computed once and passed to findEnclosing() for every node of the
+  same element.
+*/
+int TMROctForest::findEnclosingStart(TMROctant *node) {
+  // Retrieve the array of elements
+  int size = 0;
+  TMROctant *array = NULL;
+  octants->getArray(&array, &size);
+
+  // Set the low and high indices to the first and last element of the
+  // element array
+  int low = 0;
+  int high = size - 1;
+  int mid = low + (int)((high - low) / 2);
+
+  // Maintain values of low/high and mid such that the octant is
+  // between (elems[low], elems[high]).  Note that if high-low=1, then
+  // mid = low
+  while (mid != low) {
+    // Check if the node is contained by the mid octant
+    if (array[mid].contains(node)) {
+      break;
+    }
+
+    // Compare the ordering of the two octants - if the octant is less
+    // than the other, then adjust the mid point
+    int stat = array[mid].comparePosition(node);
+
+    // array[mid] ? node
+    if (stat == 0) {
+      break;
+    } else if (stat < 0) {
+      low = mid + 1;
+    } else {
+      high = mid - 1;
+    }
+
+    // Re compute the mid-point and repeat
+    mid = low + (int)((high - low) / 2);
+  }
+
+  return mid;
+}
+
 /*
   Given a node, find the enclosing octant.
 
@@ -6224,9 +8695,13 @@ int TMROctForest::getNodesWithName(const char *name, int **_nodes) {
   |      |      |
   |      |      |
   NE---- o ---- o
+
+  The optional search_start is the index returned by
+  findEnclosingStart() for the element of the node.
 */
 TMROctant *TMROctForest::findEnclosing(const int order, const double *knots,
-                                       TMROctant *node, int *mpi_owner) {
+                                       TMROctant *node, int *mpi_owner,
+                                       int search_start) {
   // Assume that we'll find the node on this processor for now.
   if (mpi_owner) {
     *mpi_owner = mpi_rank;
@@ -6273,37 +8748,13 @@ TMROctant *TMROctForest::findEnclosing(const int order, const double *knots,
   const double yd = node->y + 0.5 * h * (1.0 + knots[jj]);
   const double zd = node->z + 0.5 * h * (1.0 + knots[kk]);
 
-  // Set the low and high indices to the first and last element of the
-  // element array
-  int low = 0;
-  int high = size - 1;
-  int mid = low + (int)((high - low) / 2);
-
-  // Maintain values of low/high and mid such that the octant is
-  // between (elems[low], elems[high]).  Note that if high-low=1, then
-  // mid = low
-  while (mid != low) {
-    // Check if the node is contained by the mid octant
-    if (array[mid].contains(node)) {
-      break;
-    }
-
-    // Compare the ordering of the two octants - if the octant is less
-    // than the other, then adjust the mid point
-    int stat = array[mid].comparePosition(node);
-
-    // array[mid] ? node
-    if (stat == 0) {
-      break;
-    } else if (stat < 0) {
-      low = mid + 1;
-    } else {
-      high = mid - 1;
-    }
-
-    // Re compute the mid-point and repeat
-    mid = low + (int)((high - low) / 2);
-  }
+  // Find the index at which to start the search. This depends only
+  // on the element that contains the node, so it can be provided by
+  // the caller for all the nodes of one element.
+  int mid = search_start;
+  if (mid < 0 || mid >= size) {
+    mid = findEnclosingStart(node);
+  }
 
   // Compute the bounding octant. Octants greater than this octant
   // cannot own the node so a further search is futile.
@@ -6396,9 +8847,29 @@ TMROctant *TMROctForest::findEnclosing(const int order, const double *knots,
 int TMROctForest::computeElemInterp(TMROctant *node, TMROctForest *coarse,
                                     TMROctant *oct, TMRIndexWeight *weights,
                                     double *tmp) {
+  switch (coarse->mesh_order) {
+    case 2:
+      return computeElemInterpKernel<2>(node, coarse, oct, weights, tmp);
+    case 3:
+      return computeElemInterpKernel<3>(node, coarse, oct, weights, tmp);
+    case 4:
+      return computeElemInterpKernel<4>(node, coarse, oct, weights, tmp);
+    case 5:
+      return computeElemInterpKernel<5>(node, coarse, oct, weights, tmp);
+    default:
+      return computeElemInterpKernel<0>(node, coarse, oct, weights, tmp);
+  }
+}
+
+template <int ORDER>
+int TMROctForest::computeElemInterpKernel(TMROctant *node,
+                                          TMROctForest *coarse, TMROctant *oct,
+                                          TMRIndexWeight *weights,
+                                          double *tmp) {
+  const int coarse_order = (ORDER > 0 ? ORDER : coarse->mesh_order);
   // Loop over the array of nodes
   const int coarse_nodes_per_element =
-      coarse->mesh_order * coarse->mesh_order * coarse->mesh_order;
+      coarse_order * coarse_order * coarse_order;
 
   // Compute the i, j, k location of the fine mesh node on the element
   const int i = node->info % mesh_order;
@@ -6410,12 +8881,12 @@ int TMROctForest::computeElemInterp(TMROctant *node, TMROctForest *coarse,
   const int32_t hc = 1 << (TMR_MAX_LEVEL - oct->level);
 
   // Set pointers to create the interpolation
-  int istart = 0, iend = coarse->mesh_order;
-  int jstart = 0, jend = coarse->mesh_order;
-  int kstart = 0, kend = coarse->mesh_order;
+  int istart = 0, iend = coarse_order;
+  int jstart = 0, jend = coarse_order;
+  int kstart = 0, kend = coarse_order;
   double *Nu = &tmp[0];
-  double *Nv = &tmp[coarse->mesh_order];
-  double *Nw = &tmp[2 * coarse->mesh_order];
+  double *Nv = &tmp[coarse_order];
+  double *Nw = &tmp[2 * coarse_order];
 
   // Check that the interpolation type between the meshes are identical
   if (interp_type != coarse->interp_type) {
@@ -6425,9 +8896,9 @@ int TMROctForest::computeElemInterp(TMROctant *node, TMROctForest *coarse,
   }
 
   if (interp_type == TMR_BERNSTEIN_POINTS &&
-      mesh_order - coarse->mesh_order > 1) {
+      mesh_order - coarse_order > 1) {
     fprintf(stderr,
-            "TMROctForest Error: Mesh order difference across "
+            "TMROctForest Error: Mesh coarse_order difference across "
             "grids should be 1\n");
   }
 
@@ -6442,17 +8913,17 @@ int TMROctForest::computeElemInterp(TMROctant *node, TMROctForest *coarse,
       Nu[istart] = 1.0;
     } else if ((i == 0 && oct->x + hc == node->x) ||
                (i == mesh_order - 1 && oct->x + hc == node->x + h)) {
-      istart = coarse->mesh_order - 1;
-      iend = coarse->mesh_order;
+      istart = coarse_order - 1;
+      iend = coarse_order;
       Nu[istart] = 1.0;
     } else {
-      if (mesh_order == coarse->mesh_order) {
+      if (mesh_order == coarse_order) {
         double u =
             -1.0 +
             2.0 * (node->x + 0.5 * h * (1.0 + bern_knots[i]) - oct->x) / hc;
         bernstein_shape_functions(mesh_order, u, Nu);
       } else {
-        eval_bernstein_interp_weights(mesh_order, coarse->mesh_order, i, Nu);
+        eval_bernstein_interp_weights(mesh_order, coarse_order, i, Nu);
       }
     }
     if ((j == 0 && oct->y == node->y) ||
@@ -6462,17 +8933,17 @@ int TMROctForest::computeElemInterp(TMROctant *node, TMROctForest *coarse,
       Nv[jstart] = 1.0;
     } else if ((j == 0 && oct->y + hc == node->y) ||
                (j == mesh_order - 1 && oct->y + hc == node->y + h)) {
-      jstart = coarse->mesh_order - 1;
-      jend = coarse->mesh_order;
+      jstart = coarse_order - 1;
+      jend = coarse_order;
       Nv[jstart] = 1.0;
     } else {
-      if (mesh_order == coarse->mesh_order) {
+      if (mesh_order == coarse_order) {
         double v =
             -1.0 +
             2.0 * (node->y + 0.5 * h * (1.0 + bern_knots[j]) - oct->y) / hc;
         bernstein_shape_functions(mesh_order, v, Nv);
       } else {
-        eval_bernstein_interp_weights(mesh_order, coarse->mesh_order, j, Nv);
+        eval_bernstein_interp_weights(mesh_order, coarse_order, j, Nv);
       }
     }
     if ((k == 0 && oct->z == node->z) ||
@@ -6482,17 +8953,17 @@ int TMROctForest::computeElemInterp(TMROctant *node, TMROctForest *coarse,
       Nw[kstart] = 1.0;
     } else if ((k == 0 && oct->z + hc == node->z) ||
                (k == mesh_order - 1 && oct->z + hc == node->z + h)) {
-      kstart = coarse->mesh_order - 1;
-      kend = coarse->mesh_order;
+      kstart = coarse_order - 1;
+      kend = coarse_order;
       Nw[kstart] = 1.0;
     } else {
-      if (mesh_order == coarse->mesh_order) {
+      if (mesh_order == coarse_order) {
         double w =
             -1.0 +
             2.0 * (node->z + 0.5 * h * (1.0 + bern_knots[k]) - oct->z) / hc;
         bernstein_shape_functions(mesh_order, w, Nw);
       } else {
-        eval_bernstein_interp_weights(mesh_order, coarse->mesh_order, k, Nw);
+        eval_bernstein_interp_weights(mesh_order, coarse_order, k, Nw);
       }
     }
   } else {
@@ -6505,14 +8976,15 @@ int TMROctForest::computeElemInterp(TMROctant *node, TMROctForest *coarse,
       Nu[istart] = 1.0;
     } else if ((i == 0 && oct->x + hc == node->x) ||
                (i == mesh_order - 1 && oct->x + hc == node->x + h)) {
-      istart = coarse->mesh_order - 1;
-      iend = coarse->mesh_order;
+      istart = coarse_order - 1;
+      iend = coarse_order;
       Nu[istart] = 1.0;
     } else {
       double u =
           -1.0 +
           2.0 * (node->x + 0.5 * h * (1.0 + interp_knots[i]) - oct->x) / hc;
-      lagrange_shape_functions(coarse->mesh_order, u, coarse->interp_knots, Nu);
+      lagrange_shape_functions(coarse_order, u, coarse->interp_knots,
+                               coarse->interp_wts, Nu);
     }
     if ((j == 0 && oct->y == node->y) ||
         (j == mesh_order - 1 && oct->y == node->y + h)) {
@@ -6521,14 +8993,15 @@ int TMROctForest::computeElemInterp(TMROctant *node, TMROctForest *coarse,
       Nv[jstart] = 1.0;
     } else if ((j == 0 && oct->y + hc == node->y) ||
                (j == mesh_order - 1 && oct->y + hc == node->y + h)) {
-      jstart = coarse->mesh_order - 1;
-      jend = coarse->mesh_order;
+      jstart = coarse_order - 1;
+      jend = coarse_order;
       Nv[jstart] = 1.0;
     } else {
       double v =
           -1.0 +
           2.0 * (node->y + 0.5 * h * (1.0 + interp_knots[j]) - oct->y) / hc;
-      lagrange_shape_functions(coarse->mesh_order, v, coarse->interp_knots, Nv);
+      lagrange_shape_functions(coarse_order, v, coarse->interp_knots,
+                               coarse->interp_wts, Nv);
     }
     if ((k == 0 && oct->z == node->z) ||
         (k == mesh_order - 1 && oct->z == node->z + h)) {
@@ -6537,22 +9010,25 @@ int TMROctForest::computeElemInterp(TMROctant *node, TMROctForest *coarse,
       Nw[kstart] = 1.0;
     } else if ((k == 0 && oct->z + hc == node->z) ||
                (k == mesh_order - 1 && oct->z + hc == node->z + h)) {
-      kstart = coarse->mesh_order - 1;
-      kend = coarse->mesh_order;
+      kstart = coarse_order - 1;
+      kend = coarse_order;
       Nw[kstart] = 1.0;
     } else {
       double w =
           -1.0 +
           2.0 * (node->z + 0.5 * h * (1.0 + interp_knots[k]) - oct->z) / hc;
-      lagrange_shape_functions(coarse->mesh_order, w, coarse->interp_knots, Nw);
+      lagrange_shape_functions(coarse_order, w, coarse->interp_knots,
+                               coarse->interp_wts, Nw);
     }
   }
 
   // Get the coarse grid information
   const int *cdep_ptr;
   const int *cdep_conn;
-  const double *cdep_weights;
-  coarse->getDepNodeConn(&cdep_ptr, &cdep_conn, &cdep_weights);
+  const int *cdep_tmpl;
+  const double *cdep_tmpl_weights;
+  coarse->getDepNodeConn(&cdep_ptr, &cdep_conn);
+  coarse->getDepNodeTemplates(&cdep_tmpl, &cdep_tmpl_weights);
 
   // Get the coarse connectivity array
   const int num = oct->tag;
@@ -6564,8 +9040,8 @@ int TMROctForest::computeElemInterp(TMROctant *node, TMROctForest *coarse,
     for (int jj = jstart; jj < jend; jj++) {
       for (int ii = istart; ii < iend; ii++) {
         // Compute the offset into the coarse mesh
-        int offset = (ii + jj * coarse->mesh_order +
-                      kk * coarse->mesh_order * coarse->mesh_order);
+        int offset =
+            (ii + jj * coarse_order + kk * coarse_order * coarse_order);
 
         // Compute the interpolation weight
         double weight = Nu[ii] * Nv[jj] * Nw[kk];
@@ -6576,19 +9052,36 @@ int TMROctForest::computeElemInterp(TMROctant *node, TMROctForest *coarse,
           weights[nweights].weight = weight;
           nweights++;
         } else {
+          // Expand the dependent node weights from the templates
           int node = -c[offset] - 1;
-          for (int jp = cdep_ptr[node]; jp < cdep_ptr[node + 1]; jp++) {
-            weights[nweights].index = cdep_conn[jp];
-            weights[nweights].weight = weight * cdep_weights[jp];
-            nweights++;
+          const int *dc = &cdep_conn[cdep_ptr[node]];
+          const double *Nd =
+              &cdep_tmpl_weights[coarse_order * cdep_tmpl[2 * node]];
+          if (cdep_tmpl[2 * node + 1] < 0) {
+            for (int jp = 0; jp < coarse_order; jp++) {
+              weights[nweights].index = dc[jp];
+              weights[nweights].weight = weight * Nd[jp];
+              nweights++;
+            }
+          } else {
+            const double *Ne =
+                &cdep_tmpl_weights[coarse_order * cdep_tmpl[2 * node + 1]];
+            for (int jp = 0; jp < coarse_order * coarse_order; jp++) {
+              weights[nweights].index = dc[jp];
+              weights[nweights].weight =
+                  weight * Nd[jp % coarse_order] * Ne[jp / coarse_order];
+              nweights++;
+            }
           }
         }
       }
     }
   }
 
-  // Sort and add up the weight values
+  // Sort and add up the weight values and remove the zero weights
   nweights = TMRIndexWeight::uniqueSort(weights, nweights);
+  nweights = TMRIndexWeight::removeSmallWeights(weights, nweights,
+                                                TMR_INTERP_WEIGHT_TOL);
 
   return nweights;
 }
@@ -6610,23 +9103,503 @@ int TMROctForest::computeElemInterp(TMROctant *node, TMROctForest *coarse,
 */
 void TMROctForest::createInterpolation(TMROctForest *coarse,
                                        TACSBVecInterp *interp) {
-  // Ensure that the nodes are allocated on both octree forests
+  TMR_TRACE_SCOPE("TMROctForest::createInterpolation");
+
+  // Use the stored interpolation if it matches the coarse forest
+  if (hasInterpCache(coarse)) {
+    interp_cache->setInterp(interp);
+    return;
+  }
+
+  // Record the transient memory used to create the interpolation
+  beginMemoryPhase(TMR_INTERP_PHASE);
+
+  // Record the interpolation as it is computed
+  TMRInterpCache *cache = NULL;
+  if (use_interp_cache) {
+    if (!interp_cache) {
+      interp_cache = new TMRInterpCache();
+      interp_cache->incref();
+    }
+    interp_cache->clear();
+    cache = interp_cache;
+  }
+
+  computeInterpolation(coarse, interp, cache);
+
+  if (cache) {
+    interp_cache_id = coarse->getEntityId();
+    interp_cache_stamp = coarse->node_stamp;
+  }
+}
+
+/*
+  Set whether to store the adjacent octants in a compact form
+
+  The octants from neighboring processors that are adjacent to the
+  local octants are kept for the lifetime of the mesh. When the flag
+  is set, they are stored as Morton keys with their block index,
+  which halves their memory. The compact form is only used when all
+  the adjacent octants have a level no greater than
+  TMROctantKeyArray::max_level. The flag is copied to the forests
+  created from this forest and takes effect when the nodes are next
+  created.
+*/
+void TMROctForest::setUseCompactStorage(int flag) {
+  use_compact_storage = flag;
+}
+
+/*
+  Set whether to create the nodes incrementally
+
+  When the flag is set, the octants, the local nodes and the local
+  connectivity are kept after each call to createNodes(). The next
+  call reuses the local connectivity of the elements that are
+  unchanged since then, and only creates the nodes and connectivity of
+  the new elements and the nodes that the dependent nodes rely on. The
+  ownership and the global numbers of all nodes are still determined
+  by the full exchange. The flag is copied to the forests created from
+  this forest.
+*/
+void TMROctForest::setUseIncrementalNodes(int flag) {
+  use_incremental_nodes = flag;
+  if (!use_incremental_nodes) {
+    freePrevNodes();
+  }
+}
+
+/*
+  Set the order of the locally owned nodes
+
+  The owned nodes are numbered in the order that they are created by
+  default, which follows the Morton order of the nodes. The element
+  order numbers the nodes as they are first referenced by the
+  elements, while the RCM order reduces the bandwidth of the local
+  element-node graph. The setting is copied to the forests created
+  from this forest and takes effect when the nodes are next created.
+*/
+void TMROctForest::setNodeOrdering(TMRNodeOrderingType order_type) {
+  node_ordering = order_type;
+}
+
+/*
+  Get the maximum bandwidth of the owned node numbers within the
+  local elements over all processors, for the natural order and for
+  the selected order, from the last call to createNodes()
+*/
+void TMROctForest::getNodeBandwidth(int *natural, int *ordered) {
+  if (natural) {
+    *natural = node_bandwidth[0];
+  }
+  if (ordered) {
+    *ordered = node_bandwidth[1];
+  }
+}
+
+/*
+  Release the data that can be rebuilt when it is next required
+
+  The adjacent octants are only used while the nodes are created, and
+  are re-computed by createNodes(). The sorted local node numbers are
+  re-created from the connectivity by the first call that requires
+  them, and the name index and the stored interpolation are re-created
+  by the calls that use them. The release flags set in the constructor
+  are applied by the TACS creator once the TACSAssembler object is
+  created.
+
+  Note that the node numbers are not re-created in a thread-safe
+  manner. Call getNodeNumbers() before querying the local node numbers
+  from multiple threads.
+
+  input:
+  flags:   the TMR_RELEASE_* flags for the data to release
+*/
+void TMROctForest::releaseTransientData(int flags) {
+  if (flags & TMR_RELEASE_ADJACENT) {
+    if (adjacent) {
+      delete adjacent;
+    }
+    if (adjacent_keys) {
+      delete adjacent_keys;
+    }
+    adjacent = NULL;
+    adjacent_keys = NULL;
+  }
+  if ((flags & TMR_RELEASE_NODE_NUMBERS) && conn) {
+    if (node_numbers) {
+      delete[] node_numbers;
+    }
+    node_numbers = NULL;
+  }
+  if (flags & TMR_RELEASE_NAME_INDEX) {
+    if (name_index) {
+      name_index->decref();
+    }
+    name_index = NULL;
+  }
+  if (flags & TMR_RELEASE_INTERP_CACHE) {
+    if (interp_cache) {
+      interp_cache->decref();
+    }
+    interp_cache = NULL;
+  }
+}
+
+/*
+  Re-create the sorted local node numbers from the connectivity
+
+  The locally referenced nodes are the nodes of the local elements
+  and the independent nodes of the dependent node weights, so the
+  sorted, unique entries of the element and dependent connectivity
+  are the local node numbers.
+*/
+void TMROctForest::createNodeNumbers() {
+  int num_elements;
+  octants->getArray(NULL, &num_elements);
+  int conn_size = mesh_order * mesh_order * mesh_order * num_elements;
+  int dep_size = (dep_ptr ? dep_ptr[num_dep_nodes] : 0);
+  int size = conn_size + dep_size;
+
+  int *nums = new int[size > 0 ? size : 1];
+  memcpy(nums, conn, conn_size * sizeof(int));
+  if (dep_size > 0) {
+    memcpy(&nums[conn_size], dep_conn, dep_size * sizeof(int));
+  }
+  qsort(nums, size, sizeof(int), compare_integers);
+
+  int len = 0;
+  for (int i = 0; i < size; i++) {
+    if (i == 0 || nums[i] != nums[len - 1]) {
+      nums[len] = nums[i];
+      len++;
+    }
+  }
+
+  if (len != num_local_nodes) {
+    fprintf(stderr,
+            "TMROctForest Error: Inconsistent number of local nodes %d "
+            "in the connectivity (expected %d)\n",
+            len, num_local_nodes);
+  }
+
+  node_numbers = new int[num_local_nodes];
+  memset(node_numbers, 0, num_local_nodes * sizeof(int));
+  memcpy(node_numbers, nums,
+         (len < num_local_nodes ? len : num_local_nodes) * sizeof(int));
+  delete[] nums;
+}
+
+/*
+  Start recording the peak transient memory for a phase
+*/
+void TMROctForest::beginMemoryPhase(int phase) {
+  memory_phase = phase;
+  transient_bytes = 0;
+  peak_bytes[phase] = 0;
+}
+
+/*
+  Add the bytes of a transient allocation and update the peak
+*/
+void TMROctForest::addTransient(size_t bytes) {
+  transient_bytes += bytes;
+  if (transient_bytes > peak_bytes[memory_phase]) {
+    peak_bytes[memory_phase] = transient_bytes;
+  }
+}
+
+/*
+  Remove the bytes of a transient allocation that has been freed
+*/
+void TMROctForest::removeTransient(size_t bytes) {
+  if (bytes > transient_bytes) {
+    transient_bytes = 0;
+  } else {
+    transient_bytes -= bytes;
+  }
+}
+
+/*
+  Report the memory held by the major arrays of the forest
+
+  The report includes the peak transient memory allocated on top of
+  these arrays during the last calls to createNodes() and
+  createInterpolation(). The node location cache is shared with the
+  forests created from this one, and the block connectivity with all
+  forests created from the same topology. This call is collective on
+  the forest communicator, and the report is reduced across all
+  processors.
+
+  returns: the memory report
+*/
+TMRMemoryUsage *TMROctForest::getMemoryUsage() {
+  TMRMemoryUsage *usage = new TMRMemoryUsage();
+
+  int num_elements = 0;
+  if (octants) {
+    octants->getArray(NULL, &num_elements);
+  }
+  const int nodes_per_element = mesh_order * mesh_order * mesh_order;
+
+  usage->addArray("octants", octants ? octants->getMemoryUsage() : 0);
+  size_t adj_bytes = 0;
+  if (adjacent) {
+    adj_bytes = adjacent->getMemoryUsage();
+  } else if (adjacent_keys) {
+    adj_bytes = adjacent_keys->getMemoryUsage();
+  }
+  usage->addArray("adjacent", adj_bytes);
+  usage->addArray("owners", owners ? mpi_size * sizeof(TMROctant) : 0);
+  int num_ghosts = 0;
+  if (ghosts) {
+    ghosts->getArray(NULL, &num_ghosts);
+  }
+  usage->addArray("ghosts", ghosts ? ghosts->getMemoryUsage() +
+                                         num_ghosts * sizeof(int)
+                                   : 0);
+  int num_neighbors = (neighbor_ptr ? neighbor_ptr[num_elements] : 0);
+  usage->addArray("neighbors",
+                  neighbor_ptr ? (num_elements + 1 + 2 * num_neighbors) *
+                                     sizeof(int)
+                               : 0);
+  usage->addArray("conn",
+                  conn ? nodes_per_element * num_elements * sizeof(int) : 0);
+  usage->addArray("node_numbers",
+                  node_numbers ? num_local_nodes * sizeof(int) : 0);
+  usage->addArray("dep_ptr", dep_ptr ? (num_dep_nodes + 1) * sizeof(int) : 0);
+  int dep_size = (dep_ptr ? dep_ptr[num_dep_nodes] : 0);
+  usage->addArray("dep_conn", dep_conn ? dep_size * sizeof(int) : 0);
+  usage->addArray("dep_weights", dep_weights ? dep_size * sizeof(double) : 0);
+  usage->addArray("dep_tmpl", dep_tmpl ? 2 * num_dep_nodes * sizeof(int) : 0);
+  usage->addArray(
+      "dep_tmpl_weights",
+      dep_tmpl_weights ? 2 * mesh_order * mesh_order * sizeof(double) : 0);
+  usage->addArray("X", X ? num_local_nodes * sizeof(TMRPoint) : 0);
+  size_t prev_bytes = 0;
+  if (prev_octants) {
+    int prev_size;
+    prev_octants->getArray(NULL, &prev_size);
+    prev_bytes = prev_octants->getMemoryUsage() +
+                 prev_nodes->getMemoryUsage() +
+                 nodes_per_element * prev_size * sizeof(int);
+  }
+  usage->addArray("prev_nodes", prev_bytes);
+  usage->addArray("block_conn", bdata ? bdata->getMemoryUsage() : 0);
+  usage->addArray("node_cache", node_cache ? node_cache->getMemoryUsage() : 0);
+  usage->addArray("interp_cache",
+                  interp_cache ? interp_cache->getMemoryUsage() : 0);
+  usage->addPeak("createNodes peak", peak_bytes[TMR_NODES_PHASE]);
+  usage->addPeak("createInterpolation peak", peak_bytes[TMR_INTERP_PHASE]);
+
+  usage->reduce(comm);
+  return usage;
+}
+
+/*
+  Set whether to store the interpolation operator
+
+  When the flag is set, the interpolation created by
+  createInterpolation() is stored. Subsequent calls with the same
+  coarse forest add the stored operator directly, as long as the nodes
+  on neither forest have been re-created.
+*/
+void TMROctForest::setUseInterpCache(int flag) {
+  use_interp_cache = flag;
+  if (!use_interp_cache && interp_cache) {
+    interp_cache->decref();
+    interp_cache = NULL;
+  }
+}
+
+/*
+  Write the interpolation from the coarse forest to a file
+
+  The interpolation is computed if it is not already stored. This is a
+  collective call.
+
+  input:
+  coarse:    the coarse octree forest that has the same layout as this
+  filename:  the name of the file
+
+  returns:
+  a non-zero value if the file cannot be written
+*/
+int TMROctForest::writeInterpolation(TMROctForest *coarse,
+                                     const char *filename) {
+  if (!hasInterpCache(coarse)) {
+    if (!interp_cache) {
+      interp_cache = new TMRInterpCache();
+      interp_cache->incref();
+    }
+    interp_cache->clear();
+    computeInterpolation(coarse, NULL, interp_cache);
+    interp_cache_id = coarse->getEntityId();
+    interp_cache_stamp = coarse->node_stamp;
+  }
+
+  int info[6];
+  getInterpCacheInfo(coarse, info);
+  return interp_cache->writeToFile(comm, filename, info, 6);
+}
+
+/*
+  Read the interpolation from the coarse forest from a file
+
+  The file must have been written by writeInterpolation() for forests
+  with the same partition and node numbering. After a successful read,
+  createInterpolation() with this coarse forest uses the stored
+  operator. This is a collective call.
+
+  input:
+  coarse:    the coarse octree forest that has the same layout as this
+  filename:  the name of the file
+
+  returns:
+  a non-zero value if the file cannot be read or does not match
+*/
+int TMROctForest::readInterpolation(TMROctForest *coarse,
+                                    const char *filename) {
   createNodes();
   coarse->createNodes();
 
-  // Get the dependent node information
-  const int *cdep_ptr, *cdep_conn;
-  const double *cdep_weights;
-  coarse->getDepNodeConn(&cdep_ptr, &cdep_conn, &cdep_weights);
+  if (!interp_cache) {
+    interp_cache = new TMRInterpCache();
+    interp_cache->incref();
+  }
+
+  int info[6];
+  getInterpCacheInfo(coarse, info);
+  int fail = interp_cache->readFromFile(comm, filename, info, 6);
+  if (fail) {
+    interp_cache->decref();
+    interp_cache = NULL;
+  } else {
+    interp_cache_id = coarse->getEntityId();
+    interp_cache_stamp = coarse->node_stamp;
+  }
+
+  return fail;
+}
+
+/*
+  Check whether the stored interpolation is from the coarse forest
+*/
+int TMROctForest::hasInterpCache(TMROctForest *coarse) {
+  // Make sure the nodes exist so that the node stamps are current
+  createNodes();
+  coarse->createNodes();
+
+  return (interp_cache && interp_cache_id == coarse->getEntityId() &&
+          interp_cache_stamp == coarse->node_stamp);
+}
+
+/*
+  Get the information used to check that a stored interpolation file
+  matches the forests
+*/
+void TMROctForest::getInterpCacheInfo(TMROctForest *coarse, int info[]) {
+  info[0] = mesh_order;
+  info[1] = coarse->mesh_order;
+  info[2] = interp_type;
+  info[3] = node_range[mpi_size];
+  info[4] = coarse->node_range[mpi_size];
+
+  int num_elements;
+  octants->getArray(NULL, &num_elements);
+  MPI_Allreduce(MPI_IN_PLACE, &num_elements, 1, MPI_INT, MPI_SUM, comm);
+  info[5] = num_elements;
+}
+
+/*
+  Compute the interpolation from the coarse forest
+
+  The rows of the interpolation are added to the interpolation object
+  and the cache, if either is provided.
+*/
+void TMROctForest::computeInterpolation(TMROctForest *coarse,
+                                        TACSBVecInterp *interp,
+                                        TMRInterpCache *cache) {
+  // Compute the interpolation for the nodes that lie within coarse
+  // elements on this processor
+  int *oct_ptr;
+  TMROctantArray *ext_array =
+      createLocalInterp(coarse, interp, cache, &oct_ptr);
+
+  // Count up the number of octants destined for other procs
+  int *oct_counts = new int[mpi_size];
+  for (int i = 0; i < mpi_size; i++) {
+    if (i == mpi_rank) {
+      oct_counts[i] = 0;
+    } else {
+      oct_counts[i] = oct_ptr[i + 1] - oct_ptr[i];
+    }
+  }
+
+  // Now distribute the octants to their destination processors
+  int *oct_recv_counts = new int[mpi_size];
+  TMRExchangeCounts(comm, oct_counts, oct_recv_counts);
+
+  // Now use oct_recv_ptr to point into the recv array
+  int *oct_recv_ptr = new int[mpi_size + 1];
+  oct_recv_ptr[0] = 0;
+  for (int i = 0; i < mpi_size; i++) {
+    oct_recv_ptr[i + 1] = oct_recv_ptr[i] + oct_recv_counts[i];
+  }
+
+  delete[] oct_counts;
+  delete[] oct_recv_counts;
+
+  // Distribute the octants based on the oct_ptr/oct_recv_ptr arrays
+  TMROctantExchange *exchange =
+      new TMROctantExchange(comm, ext_array, oct_ptr, oct_recv_ptr);
+  exchange->begin();
+  delete[] oct_ptr;
+  delete[] oct_recv_ptr;
+
+  // Compute the interpolation for the nodes from other processors
+  addExternalInterp(coarse, interp, cache, exchange);
+  removeTransient(ext_array->getMemoryUsage());
+  delete exchange;
+  delete ext_array;
+}
+
+/*
+  Compute the interpolation for the locally owned nodes that lie
+  within a coarse element on this processor
+
+  The nodes that lie within a coarse element on another processor are
+  returned, sorted by the rank of the processor, with the tag set to
+  the node number.
+
+  input:
+  coarse:   the coarse octree forest that has the same layout as this
+  interp:   the interpolation object (may be NULL)
+  cache:    the interpolation cache (may be NULL)
+
+  output:
+  oct_ptr:  the intervals of the returned array for each processor
+
+  returns:
+  the array of nodes to be sent to other processors
+
+  The coarse search and the element interpolation for the owned nodes
+  are computed in parallel for each block of nodes. The interpolation
+  objects are not thread-safe, so the weights are added afterwards by
+  a single thread.
+*/
+TMROctantArray *TMROctForest::createLocalInterp(TMROctForest *coarse,
+                                                TACSBVecInterp *interp,
+                                                TMRInterpCache *cache,
+                                                int **_oct_ptr) {
+  // Ensure that the nodes are allocated on both octree forests
+  createNodes();
+  coarse->createNodes();
 
   // First, loop over the local list
   int local_size = node_range[mpi_rank + 1] - node_range[mpi_rank];
   int *flags = new int[local_size];
   memset(flags, 0, local_size * sizeof(int));
 
-  // Allocate additional space for the interpolation
-  double *tmp = new double[3 * coarse->mesh_order];
-
   // The interpolation variables/weights on the coarse mesh
   const int order = coarse->mesh_order;
   int max_nodes = order * order * order;
@@ -6635,7 +9608,6 @@ void TMROctForest::createInterpolation(TMROctForest *coarse,
 
   // Maximum number of weights
   int max_weights = order * order * order * order * order;
-  TMRIndexWeight *weights = new TMRIndexWeight[max_weights];
 
   // Loop over the array of nodes
   const int nodes_per_element = mesh_order * mesh_order * mesh_order;
@@ -6645,14 +9617,18 @@ void TMROctForest::createInterpolation(TMROctForest *coarse,
   TMROctant *octs;
   octants->getArray(&octs, &num_elements);
 
-  // Allocate a queue to store the nodes that are on other procs
-  TMROctantQueue *ext_queue = new TMROctantQueue();
-
-  // Set the knots to use in the interpolation
-  const double *knots = interp_knots;
-
+  // Find the element and local node used to interpolate each owned
+  // node, in the order in which the nodes are first visited, and the
+  // start of the coarse search, shared by the nodes of each element
+  int num_owned = 0;
+  int *owned_elems = new int[local_size];
+  int *owned_nodes = new int[local_size];
+  int *owned_starts = new int[local_size];
+  addTransient(4 * local_size * sizeof(int));
   for (int i = 0; i < num_elements; i++) {
     const int *c = &conn[nodes_per_element * i];
+    int search_start = -1;
+
     for (int j = 0; j < nodes_per_element; j++) {
       // Check if the fine node is owned by this processor
       if (c[j] >= node_range[mpi_rank] && c[j] < node_range[mpi_rank + 1]) {
@@ -6661,71 +9637,476 @@ void TMROctForest::createInterpolation(TMROctForest *coarse,
           // We're going to handle this node now, mark it as done
           flags[index] = 1;
 
-          // Find the enclosing coarse octant on this
-          // processor if it exits
-          TMROctant node = octs[i];
-          node.info = j;
+          if (search_start < 0) {
+            TMROctant node = octs[i];
+            node.info = j;
+            search_start = coarse->findEnclosingStart(&node);
+          }
+          owned_elems[num_owned] = i;
+          owned_nodes[num_owned] = j;
+          owned_starts[num_owned] = search_start;
+          num_owned++;
+        }
+      }
+    }
+  }
 
-          // Find the MPI owner or the
-          int mpi_owner = mpi_rank;
-          TMROctant *t =
-              coarse->findEnclosing(mesh_order, knots, &node, &mpi_owner);
+  // Free the data
+  removeTransient(local_size * sizeof(int));
+  delete[] flags;
 
-          // The node is owned a coarse element on this processor
-          if (t) {
-            // Compute the element interpolation
-            int nweights = computeElemInterp(&node, coarse, t, weights, tmp);
+  // Allocate space for the weights and the owners of a block of nodes
+  const int block_size = TMR_INTERP_CHUNK_SIZE *
+                         TMR_INTERP_CHUNKS_PER_THREAD * TMRGetMaxThreads();
+  int *block_nweights = new int[block_size];
+  int *block_owners = new int[block_size];
+  TMRIndexWeight *block_weights = new TMRIndexWeight[block_size * max_weights];
+  size_t block_bytes =
+      block_size * (2 * sizeof(int) + max_weights * sizeof(TMRIndexWeight));
+  addTransient(block_bytes);
+
+  // Allocate a queue to store the nodes that are on other procs
+  TMROctantQueue *ext_queue = new TMROctantQueue();
+
+  // Set the knots to use in the interpolation
+  const double *knots = interp_knots;
+
+#ifdef TMR_HAS_OPENMP
+#pragma omp parallel
+#endif  // TMR_HAS_OPENMP
+  {
+    // Allocate additional space for the interpolation
+    double *tmp = new double[3 * coarse->mesh_order];
+
+    for (int start = 0; start < num_owned; start += block_size) {
+      int end = start + block_size;
+      if (end > num_owned) {
+        end = num_owned;
+      }
+
+      // Compute the interpolation for the nodes in this block
+#ifdef TMR_HAS_OPENMP
+#pragma omp for schedule(dynamic, TMR_INTERP_CHUNK_SIZE)
+#endif  // TMR_HAS_OPENMP
+      for (int k = start; k < end; k++) {
+        // Find the enclosing coarse octant on this
+        // processor if it exits
+        TMROctant node = octs[owned_elems[k]];
+        node.info = owned_nodes[k];
+
+        // Find the MPI owner or the
+        int mpi_owner = mpi_rank;
+        TMROctant *t = coarse->findEnclosing(mesh_order, knots, &node,
+                                             &mpi_owner, owned_starts[k]);
+
+        // The node is owned a coarse element on this processor
+        block_owners[k - start] = mpi_owner;
+        block_nweights[k - start] = -1;
+        if (t) {
+          // Compute the element interpolation
+          block_nweights[k - start] = computeElemInterp(
+              &node, coarse, t, &block_weights[(k - start) * max_weights],
+              tmp);
+        }
+      }
 
-            for (int k = 0; k < nweights; k++) {
-              vars[k] = weights[k].index;
-              wvals[k] = weights[k].weight;
+      // Add the interpolation in the order of the nodes
+#ifdef TMR_HAS_OPENMP
+#pragma omp single
+#endif  // TMR_HAS_OPENMP
+      {
+        for (int k = start; k < end; k++) {
+          const int *c = &conn[nodes_per_element * owned_elems[k]];
+          const int j = owned_nodes[k];
+
+          int nweights = block_nweights[k - start];
+          if (nweights >= 0) {
+            const TMRIndexWeight *weights =
+                &block_weights[(k - start) * max_weights];
+            for (int ii = 0; ii < nweights; ii++) {
+              vars[ii] = weights[ii].index;
+              wvals[ii] = weights[ii].weight;
+            }
+            if (interp) {
+              interp->addInterp(c[j], wvals, vars, nweights);
+            }
+            if (cache) {
+              cache->addInterp(c[j], wvals, vars, nweights);
             }
-            interp->addInterp(c[j], wvals, vars, nweights);
           } else {
             // We've got to transfer the node to the processor that
             // owns an enclosing element. Do to that, add the
             // octant to the list of externals and store its mpi owner
-            node.tag = mpi_owner;
+            TMROctant node = octs[owned_elems[k]];
+            node.info = j;
+            node.tag = block_owners[k - start];
             ext_queue->push(&node);
           }
         }
       }
     }
+
+    delete[] tmp;
   }
 
   // Free the data
-  delete[] flags;
+  removeTransient(3 * local_size * sizeof(int) + block_bytes);
+  delete[] owned_elems;
+  delete[] owned_nodes;
+  delete[] owned_starts;
+  delete[] block_nweights;
+  delete[] block_owners;
+  delete[] block_weights;
+  delete[] vars;
+  delete[] wvals;
 
   // Sort the sending octants by MPI rank
   TMROctantArray *ext_array = ext_queue->toArray();
+  addTransient(ext_array->getMemoryUsage());
   delete ext_queue;
 
   // Sort the node
   int size;
   TMROctant *array;
+  ext_array->sortByTag();
   ext_array->getArray(&array, &size);
-  qsort(array, size, sizeof(TMROctant), compare_octant_tags);
 
   // The number of octants that will be sent from this processor
   // to all other processors in the communicator
   int *oct_ptr = new int[mpi_size + 1];
-  int *oct_recv_ptr = new int[mpi_size + 1];
 
   // Match the octant intervals to determine how mnay octants
   // need to be sent to each processor
   matchTagIntervals(array, size, oct_ptr);
 
   // Now convert the node tags nodes back to node numbers
-  // from the connectivity
+  // from the connectivity. Search for all the octants in the octants
+  // array at once.
+  TMROctant **found = new TMROctant *[size];
+  octants->containsMany(size, array, found);
   for (int i = 0; i < size; i++) {
-    // Search for the octant in the octants array
-    TMROctant *t = octants->contains(&array[i]);
-
     // Set the tag value as the global node number
-    array[i].tag = conn[nodes_per_element * t->tag + array[i].info];
+    array[i].tag = conn[nodes_per_element * found[i]->tag + array[i].info];
   }
+  delete[] found;
 
-  // Count up the number of octants destined for other procs
+  *_oct_ptr = oct_ptr;
+  return ext_array;
+}
+
+/*
+  Compute the interpolation for the nodes received from other
+  processors as they arrive
+
+  input:
+  coarse:    the coarse octree forest that has the same layout as this
+  interp:    the interpolation object (may be NULL)
+  cache:     the interpolation cache (may be NULL)
+  exchange:  the active exchange of the nodes created by
+             createLocalInterp()
+*/
+void TMROctForest::addExternalInterp(TMROctForest *coarse,
+                                     TACSBVecInterp *interp,
+                                     TMRInterpCache *cache,
+                                     TMROctantExchange *exchange) {
+  // Allocate additional space for the interpolation
+  double *tmp = new double[3 * coarse->mesh_order];
+
+  // The interpolation variables/weights on the coarse mesh
+  const int order = coarse->mesh_order;
+  int max_nodes = order * order * order;
+  int *vars = new int[max_nodes];
+  double *wvals = new double[max_nodes];
+
+  // Maximum number of weights
+  int max_weights = order * order * order * order * order;
+  TMRIndexWeight *weights = new TMRIndexWeight[max_weights];
+
+  // Set the knots to use in the interpolation
+  const double *knots = interp_knots;
+
+  // Recv the nodes from other processors and compute their
+  // interpolation as they arrive
+  int recv_size;
+  TMROctant *recv_nodes;
+  while (exchange->waitAny(&recv_nodes, &recv_size) >= 0) {
+    int search_start = -1;
+    for (int i = 0; i < recv_size; i++) {
+      // The nodes of one element are sent together. Only repeat the
+      // search from the start when the element changes.
+      if (i == 0 || recv_nodes[i].comparePosition(&recv_nodes[i - 1]) != 0) {
+        search_start = coarse->findEnclosingStart(&recv_nodes[i]);
+      }
+
+      int mpi_owner;
+      TMROctant *t = coarse->findEnclosing(mesh_order, knots, &recv_nodes[i],
+                                           &mpi_owner, search_start);
+      if (t) {
+        // Compute the element interpolation
+        int nweights =
+            computeElemInterp(&recv_nodes[i], coarse, t, weights, tmp);
+
+        for (int k = 0; k < nweights; k++) {
+          vars[k] = weights[k].index;
+          wvals[k] = weights[k].weight;
+        }
+        if (interp) {
+          interp->addInterp(recv_nodes[i].tag, wvals, vars, nweights);
+        }
+        if (cache) {
+          cache->addInterp(recv_nodes[i].tag, wvals, vars, nweights);
+        }
+      } else {
+        // This should not happen. Print out an error message here.
+        fprintf(stderr,
+                "[%d] TMROctForest Error: Destination processor does "
+                "not own node\n",
+                mpi_rank);
+      }
+    }
+  }
+
+  // Free the recv array
+  TMROctantArray *recv_array = exchange->end();
+  addTransient(recv_array->getMemoryUsage());
+  removeTransient(recv_array->getMemoryUsage());
+  delete recv_array;
+
+  // Free the temporary arrays
+  delete[] tmp;
+  delete[] vars;
+  delete[] wvals;
+  delete[] weights;
+}
+
+/*
+  Compute the weights for transferring the value at a node from an
+  element of another forest.
+
+  When the element of the node is also an element of the old forest
+  with the same mesh order and nodal (non-Bernstein) interpolation,
+  the node value is copied from the same node of the old element.
+  Otherwise, the node is interpolated from the old element, which
+  gives the same weights as createInterpolation().
+
+  input:
+  node:        the node (element octant with info = element node index)
+  old_forest:  the forest that the values are transferred from
+  oct:         an enclosing octant on the old forest
+  tmp:         temporary array (must be of size 3*old_forest->mesh_order)
+
+  output:
+  weights:     the index/weight pairs for the node
+
+  returns:
+  the number of weights
+*/
+int TMROctForest::computeTransferWeights(TMROctant *node,
+                                         TMROctForest *old_forest,
+                                         TMROctant *oct,
+                                         TMRIndexWeight *weights,
+                                         double *tmp) {
+  if (oct->level == node->level && oct->comparePosition(node) == 0 &&
+      old_forest->mesh_order == mesh_order &&
+      old_forest->interp_type == interp_type &&
+      interp_type != TMR_BERNSTEIN_POINTS) {
+    const int nodes_per_element = mesh_order * mesh_order * mesh_order;
+    const int c = old_forest->conn[nodes_per_element * oct->tag + node->info];
+    if (c >= 0) {
+      weights[0].index = c;
+      weights[0].weight = 1.0;
+      return 1;
+    }
+
+    // The node is a dependent node on the old forest
+    const int *dep_ptr, *dep_conn, *tmpl;
+    const double *tmpl_weights;
+    old_forest->getDepNodeConn(&dep_ptr, &dep_conn);
+    old_forest->getDepNodeTemplates(&tmpl, &tmpl_weights);
+
+    int nweights = 0;
+    const int dep = -c - 1;
+    const int order = old_forest->mesh_order;
+    const double *Nu = &tmpl_weights[order * tmpl[2 * dep]];
+    const double *Nv = NULL;
+    if (tmpl[2 * dep + 1] >= 0) {
+      Nv = &tmpl_weights[order * tmpl[2 * dep + 1]];
+    }
+    for (int jp = dep_ptr[dep]; jp < dep_ptr[dep + 1]; jp++, nweights++) {
+      int j = jp - dep_ptr[dep];
+      weights[nweights].index = dep_conn[jp];
+      if (Nv) {
+        weights[nweights].weight = Nu[j % order] * Nv[j / order];
+      } else {
+        weights[nweights].weight = Nu[j];
+      }
+    }
+    return nweights;
+  }
+
+  return computeElemInterp(node, old_forest, oct, weights, tmp);
+}
+
+/*
+  Evaluate the values at a node from the index/weight pairs
+*/
+static void TMR_EvalTransferValues(TACSBVec *vec, int bsize, int nweights,
+                                   const TMRIndexWeight *weights, int *vars,
+                                   TacsScalar *vals, TacsScalar *out) {
+  for (int k = 0; k < nweights; k++) {
+    vars[k] = weights[k].index;
+  }
+  vec->getValues(nweights, vars, vals);
+
+  for (int b = 0; b < bsize; b++) {
+    out[b] = 0.0;
+  }
+  for (int k = 0; k < nweights; k++) {
+    for (int b = 0; b < bsize; b++) {
+      out[b] += weights[k].weight * vals[bsize * k + b];
+    }
+  }
+}
+
+/*
+  Transfer a nodal field from another forest to this forest
+
+  The forests must share the same connectivity, but this forest may
+  be a refined, coarsened and/or repartitioned version of the old
+  forest. The value at each node on this forest is evaluated directly
+  from the old element that encloses it, without forming an
+  interpolation matrix. Since both octant arrays are sorted, the
+  enclosing old octants are found in a single merge over the local
+  octants. The values for the nodes of unchanged elements are copied.
+  Only the nodes that lie within an old element on another processor
+  are sent to that processor, which returns their values.
+
+  This is a collective call.
+
+  input:
+  old_forest:  the forest that the values are transferred from
+  old_vec:     the nodal values on the old forest
+
+  output:
+  new_vec:     the nodal values on this forest
+*/
+void TMROctForest::transferNodalField(TMROctForest *old_forest,
+                                      TACSBVec *old_vec, TACSBVec *new_vec) {
+  // Ensure that the nodes are allocated on both octree forests
+  createNodes();
+  old_forest->createNodes();
+
+  const int bsize = new_vec->getBlockSize();
+  if (old_vec->getBlockSize() != bsize) {
+    fprintf(stderr,
+            "TMROctForest Error: Inconsistent block sizes for the "
+            "nodal field transfer\n");
+    return;
+  }
+
+  // Distribute the values to the ghost nodes on the old forest
+  old_vec->beginDistributeValues();
+  old_vec->endDistributeValues();
+
+  // Get the locally owned values on this forest
+  TacsScalar *xnew;
+  new_vec->getArray(&xnew);
+
+  // Flag the locally owned nodes once they have been set
+  int local_size = node_range[mpi_rank + 1] - node_range[mpi_rank];
+  int *flags = new int[local_size];
+  memset(flags, 0, local_size * sizeof(int));
+
+  // Allocate space for the interpolation weights and values
+  const int order = old_forest->mesh_order;
+  double *tmp = new double[3 * order];
+  int max_weights = order * order * order * order * order;
+  TMRIndexWeight *weights = new TMRIndexWeight[max_weights];
+  int *vars = new int[max_weights];
+  TacsScalar *vals = new TacsScalar[bsize * max_weights];
+
+  const int nodes_per_element = mesh_order * mesh_order * mesh_order;
+
+  // Get the octants on both forests
+  int num_elements;
+  TMROctant *octs;
+  octants->getArray(&octs, &num_elements);
+
+  int old_size;
+  TMROctant *old_octs;
+  old_forest->octants->getArray(&old_octs, &old_size);
+
+  // Allocate a queue to store the nodes that are on other procs
+  TMROctantQueue *ext_queue = new TMROctantQueue();
+
+  // Set the knots to use in the interpolation
+  const double *knots = interp_knots;
+
+  // The index of the first old octant that may enclose the element
+  int start = 0;
+
+  for (int i = 0; i < num_elements; i++) {
+    const int *c = &conn[nodes_per_element * i];
+
+    // Skip the old octants that lie before this element
+    while (start < old_size && old_octs[start].comparePosition(&octs[i]) < 0 &&
+           !old_octs[start].contains(&octs[i])) {
+      start++;
+    }
+
+    for (int j = 0; j < nodes_per_element; j++) {
+      // Check if the node is owned by this processor
+      if (c[j] >= node_range[mpi_rank] && c[j] < node_range[mpi_rank + 1]) {
+        int index = c[j] - node_range[mpi_rank];
+        if (!flags[index]) {
+          flags[index] = 1;
+
+          TMROctant node = octs[i];
+          node.info = j;
+
+          int mpi_owner = mpi_rank;
+          TMROctant *t = old_forest->findEnclosing(mesh_order, knots, &node,
+                                                   &mpi_owner, start);
+
+          if (t) {
+            int nweights =
+                computeTransferWeights(&node, old_forest, t, weights, tmp);
+            TMR_EvalTransferValues(old_vec, bsize, nweights, weights, vars,
+                                   vals, &xnew[bsize * index]);
+          } else {
+            // Send the node to the processor that owns the enclosing
+            // element on the old forest
+            node.tag = mpi_owner;
+            ext_queue->push(&node);
+          }
+        }
+      }
+    }
+  }
+
+  delete[] flags;
+
+  // Sort the nodes by the destination rank
+  TMROctantArray *ext_array = ext_queue->toArray();
+  delete ext_queue;
+
+  int size;
+  TMROctant *array;
+  ext_array->sortByTag();
+  ext_array->getArray(&array, &size);
+
+  int *oct_ptr = new int[mpi_size + 1];
+  matchTagIntervals(array, size, oct_ptr);
+
+  // Convert the tags to the local node numbers
+  TMROctant **found = new TMROctant *[size];
+  octants->containsMany(size, array, found);
+  for (int i = 0; i < size; i++) {
+    array[i].tag = conn[nodes_per_element * found[i]->tag + array[i].info];
+  }
+  delete[] found;
+
+  // Count up the number of nodes destined for other procs
   int *oct_counts = new int[mpi_size];
   for (int i = 0; i < mpi_size; i++) {
     if (i == mpi_rank) {
@@ -6735,61 +10116,106 @@ void TMROctForest::createInterpolation(TMROctForest *coarse,
     }
   }
 
-  // Now distribute the octants to their destination processors
   int *oct_recv_counts = new int[mpi_size];
-  MPI_Alltoall(oct_counts, 1, MPI_INT, oct_recv_counts, 1, MPI_INT, comm);
+  TMRExchangeCounts(comm, oct_counts, oct_recv_counts);
 
-  // Now use oct_ptr to point into the recv array
+  int *oct_recv_ptr = new int[mpi_size + 1];
   oct_recv_ptr[0] = 0;
   for (int i = 0; i < mpi_size; i++) {
     oct_recv_ptr[i + 1] = oct_recv_ptr[i] + oct_recv_counts[i];
   }
 
-  delete[] oct_counts;
-  delete[] oct_recv_counts;
+  // Post the receives for the values of the nodes that are sent
+  const int value_tag = 1;
+  int nrecvs = 0, nsends = 0;
+  MPI_Request *recv_requests = new MPI_Request[mpi_size];
+  MPI_Request *send_requests = new MPI_Request[mpi_size];
+  TacsScalar *ext_vals = new TacsScalar[bsize * size];
+  memset(ext_vals, 0, bsize * size * sizeof(TacsScalar));
+  for (int i = 0; i < mpi_size; i++) {
+    if (oct_counts[i] > 0) {
+      MPI_Irecv(&ext_vals[bsize * oct_ptr[i]], bsize * oct_counts[i],
+                TACS_MPI_TYPE, i, value_tag, comm, &recv_requests[nrecvs]);
+      nrecvs++;
+    }
+  }
 
-  // Distribute the octants based on the oct_ptr/oct_recv_ptr arrays
-  TMROctantArray *recv_array = sendOctants(ext_array, oct_ptr, oct_recv_ptr);
-  delete[] oct_ptr;
-  delete[] oct_recv_ptr;
-  delete ext_array;
+  // Send the nodes to the processors that own the old elements
+  TMROctantExchange *exchange =
+      new TMROctantExchange(comm, ext_array, oct_ptr, oct_recv_ptr);
+  exchange->begin();
 
-  // Get the nodes recv'd from other processors
+  // Evaluate the values of the nodes from other processors as they
+  // arrive and send them back
   int recv_size;
   TMROctant *recv_nodes;
-  recv_array->getArray(&recv_nodes, &recv_size);
-
-  // Recv the nodes and loop over the connectivity
-  for (int i = 0; i < recv_size; i++) {
-    int mpi_owner;
-    TMROctant *t =
-        coarse->findEnclosing(mesh_order, knots, &recv_nodes[i], &mpi_owner);
-    if (t) {
-      // Compute the element interpolation
-      int nweights = computeElemInterp(&recv_nodes[i], coarse, t, weights, tmp);
-
-      for (int k = 0; k < nweights; k++) {
-        vars[k] = weights[k].index;
-        wvals[k] = weights[k].weight;
+  TacsScalar *recv_vals = new TacsScalar[bsize * oct_recv_ptr[mpi_size]];
+  int rank;
+  while ((rank = exchange->waitAny(&recv_nodes, &recv_size)) >= 0) {
+    if (recv_size == 0) {
+      continue;
+    }
+
+    TacsScalar *out = &recv_vals[bsize * oct_recv_ptr[rank]];
+    int search_start = -1;
+    for (int i = 0; i < recv_size; i++) {
+      // The nodes of one element are sent together
+      if (i == 0 || recv_nodes[i].comparePosition(&recv_nodes[i - 1]) != 0) {
+        search_start = old_forest->findEnclosingStart(&recv_nodes[i]);
+      }
+
+      TMROctant *t = old_forest->findEnclosing(mesh_order, knots,
+                                               &recv_nodes[i], NULL,
+                                               search_start);
+      if (t) {
+        int nweights =
+            computeTransferWeights(&recv_nodes[i], old_forest, t, weights, tmp);
+        TMR_EvalTransferValues(old_vec, bsize, nweights, weights, vars, vals,
+                               &out[bsize * i]);
+      } else {
+        fprintf(stderr,
+                "[%d] TMROctForest Error: Destination processor does "
+                "not own node\n",
+                mpi_rank);
+        for (int b = 0; b < bsize; b++) {
+          out[bsize * i + b] = 0.0;
+        }
       }
-      interp->addInterp(recv_nodes[i].tag, wvals, vars, nweights);
-    } else {
-      // This should not happen. Print out an error message here.
-      fprintf(stderr,
-              "[%d] TMROctForest Error: Destination processor does "
-              "not own node\n",
-              mpi_rank);
     }
+
+    MPI_Isend(out, bsize * recv_size, TACS_MPI_TYPE, rank, value_tag, comm,
+              &send_requests[nsends]);
+    nsends++;
   }
 
-  // Free the recv array
+  TMROctantArray *recv_array = exchange->end();
   delete recv_array;
+  delete exchange;
 
-  // Free the temporary arrays
+  // Set the values returned from the other processors
+  MPI_Waitall(nrecvs, recv_requests, MPI_STATUSES_IGNORE);
+  for (int i = 0; i < size; i++) {
+    int index = array[i].tag - node_range[mpi_rank];
+    for (int b = 0; b < bsize; b++) {
+      xnew[bsize * index + b] = ext_vals[bsize * i + b];
+    }
+  }
+  MPI_Waitall(nsends, send_requests, MPI_STATUSES_IGNORE);
+
+  // Free the data
+  delete ext_array;
+  delete[] oct_ptr;
+  delete[] oct_counts;
+  delete[] oct_recv_counts;
+  delete[] oct_recv_ptr;
+  delete[] recv_requests;
+  delete[] send_requests;
+  delete[] ext_vals;
+  delete[] recv_vals;
   delete[] tmp;
-  delete[] vars;
-  delete[] wvals;
   delete[] weights;
+  delete[] vars;
+  delete[] vals;
 }
 
 /*
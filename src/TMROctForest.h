@@ -22,7 +22,10 @@
 #define TMR_OCTANT_FOREST_H
 
 #include "TACSBVecInterp.h"
+#include "TMRInterpCache.h"
+#include "TMRNameIndex.h"
 #include "TMROctant.h"
+#include "TMRPointCache.h"
 #include "TMRTopology.h"
 
 /*
@@ -48,8 +51,21 @@ class TMROctForest : public TMREntity {
   // This is the max order of the mesh
   static const int MAX_ORDER = 16;
 
+  // Flags for the data that can be released and rebuilt on demand
+  static const int TMR_RELEASE_ADJACENT = 1;
+  static const int TMR_RELEASE_NODE_NUMBERS = 2;
+  static const int TMR_RELEASE_NAME_INDEX = 4;
+  static const int TMR_RELEASE_INTERP_CACHE = 8;
+  static const int TMR_RELEASE_ALL = 15;
+
+  // The types of neighbors between elements
+  static const int TMR_FACE_NEIGHBOR = 0;
+  static const int TMR_EDGE_NEIGHBOR = 1;
+  static const int TMR_CORNER_NEIGHBOR = 2;
+
   TMROctForest(MPI_Comm _comm, int mesh_order = 2,
-               TMRInterpolationType interp_type = TMR_GAUSS_LOBATTO_POINTS);
+               TMRInterpolationType interp_type = TMR_GAUSS_LOBATTO_POINTS,
+               int release_flags = 0);
   ~TMROctForest();
 
   // Get the MPI communicator
@@ -61,6 +77,10 @@ class TMROctForest : public TMREntity {
   void setTopology(TMRTopology *_topo);
   TMRTopology *getTopology();
 
+  // Clear the cache of node locations evaluated from the topology
+  // -------------------------------------------------------------
+  void clearNodeLocationCache();
+
   // Set the connectivity
   // --------------------
   void setConnectivity(int _num_nodes, const int *_block_conn, int _num_blocks);
@@ -76,19 +96,41 @@ class TMROctForest : public TMREntity {
   int getMeshOrder();
   TMRInterpolationType getInterpType();
 
-  // Re-partition the octrees based on element count
-  // -----------------------------------------------
+  // Re-partition the octrees based on element count or cost
+  // -------------------------------------------------------
   void repartition(int max_rank = -1);
+  double repartition(const double *weights);
+
+  // Repartition automatically when the load is imbalanced
+  // -----------------------------------------------------
+  void setRepartitionTolerance(double tol);
+  int repartitionIfImbalanced(double tol, const double *weights = NULL);
+  void getRepartitionStats(double *imbalance, int *repartitioned,
+                           double *bytes_moved);
+
+  // Get stamps that change with the octants, partition or nodes
+  // ------------------------------------------------------------
+  int getOctantStamp() { return octant_stamp; }
+  int getPartitionStamp() { return partition_stamp; }
+  int getNodeStamp() { return node_stamp; }
 
   // Create the forest of octrees
   // ----------------------------
   void createTrees(int refine_level);
   void createRandomTrees(int nrand = 10, int min_level = 0, int max_level = 8);
 
+  // Write/read the octants to/from a binary file for restart
+  // --------------------------------------------------------
+  int writeOctantsToFile(const char *filename);
+  int readOctantsFromFile(const char *filename);
+
   // Duplicate or coarsen the forest
   // -------------------------------
   TMROctForest *duplicate();
   TMROctForest *coarsen();
+  TMROctForest *coarsen(int nlevels);
+  TMROctForest *coarsenToBudget(int max_elements,
+                                const double *indicator = NULL);
 
   // Refine the mesh
   // ---------------
@@ -97,7 +139,11 @@ class TMROctForest : public TMREntity {
 
   // Balance the octree meshes
   // -------------------------
-  void balance(int balance_corner = 0);
+  void balance(int balance_corner = 0, int sparse_balance = 0);
+
+  // Refine to the target levels and balance in a single operation
+  // -------------------------------------------------------------
+  void refineAndBalance(const int target_levels[], int balance_corner = 0);
 
   // Create and order the nodes
   // --------------------------
@@ -109,11 +155,56 @@ class TMROctForest : public TMREntity {
                    int *_num_owned_nodes = NULL, int *_num_local_nodes = NULL);
   int getDepNodeConn(const int **_ptr = NULL, const int **_conn = NULL,
                      const double **_weights = NULL);
+  int getDepNodeTemplates(const int **_tmpl = NULL,
+                          const double **_tmpl_weights = NULL);
+
+  // Retrieve the ghost layer and the neighbors of each element
+  // ----------------------------------------------------------
+  void computeElementNeighbors();
+  int getGhostOctants(TMROctantArray **_ghosts,
+                      const int **_ghost_elems = NULL);
+  int getElementNeighbors(const int **_ptr, const int **_conn,
+                          const int **_types = NULL);
 
   // Create interpolation/restriction operators
   // ------------------------------------------
   void createInterpolation(TMROctForest *coarse, TACSBVecInterp *interp);
 
+  // Transfer a nodal field from another forest with the same layout
+  // ---------------------------------------------------------------
+  void transferNodalField(TMROctForest *old_forest, TACSBVec *old_vec,
+                          TACSBVec *new_vec);
+
+  // Store the interpolation operators for reuse or restart
+  // ------------------------------------------------------
+  void setUseInterpCache(int flag);
+  int writeInterpolation(TMROctForest *coarse, const char *filename);
+  int readInterpolation(TMROctForest *coarse, const char *filename);
+
+  // Store the adjacent octants in a compact form
+  // ---------------------------------------------
+  void setUseCompactStorage(int flag);
+
+  // Reuse the connectivity of unchanged elements in createNodes()
+  // -------------------------------------------------------------
+  void setUseIncrementalNodes(int flag);
+
+  // Set the order of the locally owned nodes
+  // ----------------------------------------
+  void setNodeOrdering(TMRNodeOrderingType order_type);
+  void getNodeBandwidth(int *natural, int *ordered);
+
+  // Report the memory held by the forest
+  // ------------------------------------
+  TMRMemoryUsage *getMemoryUsage();
+
+  // Release the data that can be rebuilt when it is next required
+  // -------------------------------------------------------------
+  void releaseTransientData(int flags = TMR_RELEASE_ALL);
+  void compact() { releaseTransientData(TMR_RELEASE_ALL); }
+  void setReleaseFlags(int flags) { release_flags = flags; }
+  int getReleaseFlags() { return release_flags; }
+
   // Get the nodes or elements with a certain name
   // ---------------------------------------------
   TMROctantArray *getOctsWithName(const char *name);
@@ -154,7 +245,9 @@ class TMROctForest : public TMREntity {
   // Find the octant enclosing the given node
   // ----------------------------------------
   TMROctant *findEnclosing(const int order, const double *knots,
-                           TMROctant *node, int *mpi_owner = NULL);
+                           TMROctant *node, int *mpi_owner = NULL,
+                           int search_start = -1);
+  int findEnclosingStart(TMROctant *node);
 
   // Transform the octant to the global order
   // ----------------------------------------
@@ -179,8 +272,12 @@ class TMROctForest : public TMREntity {
   void writeToVTK(const char *filename);
   void writeToTecplot(const char *filename);
   void writeForestToVTK(const char *filename);
+  void writeForestToVTU(const char *prefix, int compress = 0);
 
  private:
+  // The hierarchy batches the interpolation between levels
+  friend class TMROctForestHierarchy;
+
   // Labels for the nodes
   static const int TMR_OCT_NODE_LABEL = 0;
   static const int TMR_OCT_EDGE_LABEL = 1;
@@ -202,9 +299,7 @@ class TMROctForest : public TMREntity {
   // Compute the inverse connectivities
   void computeEdgesToBlocks();
   void computeFacesToBlocks();
-
-  // Set the owners - this determines how the mesh will be ordered
-  void computeBlockOwners();
+  void computeBlockTransforms();
 
   // Get the octant owner
   int getOctantMPIOwner(TMROctant *oct);
@@ -215,6 +310,31 @@ class TMROctForest : public TMREntity {
 
   // Balance-related routines
   // ------------------------
+  // The minimum number of octants balanced by each thread
+  static const int min_octants_per_thread = 10000;
+
+  // Balance the element octants locally
+  void balanceLocal(TMROctant *array, int size, TMROctantHash *hash,
+                    TMROctantHash *ext_hash, const int balance_corner);
+
+  // Move the octants to a new partition
+  void repartitionOctants(const int *ptr, const int *new_ptr,
+                          int reset_tags = 1);
+
+  // Multi-level coarsening routines
+  // -------------------------------
+  // Move the partition boundaries so no family coarsened by up to
+  // nlevels is split between processors
+  void alignFamilies(int nlevels);
+
+  // Coarsen the complete families of octants in one pass
+  int coarsenFamilies(int nlevels, int use_priority, int threshold,
+                      TMROctantArray **coarse);
+
+  // Complete the balance with a single sparse exchange
+  void balanceSparse(TMROctantHash *hash, TMROctantHash *ext_hash);
+  TMROctantArray *exchangeOctants(TMROctantArray *list);
+
   // Balance the octant across the local tree and the forest
   void balanceOctant(TMROctant *oct, TMROctantHash *hash,
                      TMROctantHash *ext_hash, TMROctantQueue *queue,
@@ -238,6 +358,9 @@ class TMROctForest : public TMREntity {
 
   // Exchange non-local octant neighbors
   void computeAdjacentOctants();
+  TMROctantArray *exchangeAdjacentOctants();
+  void freeElementNeighbors();
+  int containsAdjacent(TMROctant *oct);
 
   // Find the dependent faces and edges in the mesh
   void computeDepFacesAndEdges();
@@ -248,27 +371,88 @@ class TMROctForest : public TMREntity {
   void labelDependentNodes(int *nodes);
 
   // Create the global node ownership data
-  TMROctantArray *createLocalNodes();
+  TMROctantArray *createLocalNodes(const int *prev_elems = NULL);
 
   // Create the local connectivity based on the input node array
-  void createLocalConn(TMROctantArray *nodes, const int *node_offset);
+  void createLocalConn(TMROctantArray *nodes, const int *node_offset,
+                       const int *prev_elems = NULL);
+  template <int ORDER>
+  void createLocalConnKernel(TMROctantArray *nodes, const int *node_offset,
+                             const int *prev_elems);
+
+  // Reuse the nodes and connectivity from the previous createNodes()
+  int *matchPrevElements();
+  TMROctantArray *getPrevElementNodes(const int *prev_elems);
+  int *mapPrevNodes(TMROctantArray *nodes, const int *node_offset);
+  void freePrevNodes();
+
+  // Number the owned nodes in the selected order
+  void orderOwnedNodes(int node_size, const int *node_offset);
 
   // Get the local node numbers associated with an edge/face
+  template <int ORDER>
   void getEdgeNodes(TMROctant *oct, int edge_index, TMROctantArray *nodes,
                     const int *node_offset, int *edge_nodes);
+  template <int ORDER>
   void getFaceNodes(TMROctant *oct, int face_index, TMROctantArray *nodes,
                     const int *node_offset, int *face_nodes);
 
   // Create the dependent node connectivity
   void createDependentConn(const int *node_nums, TMROctantArray *nodes,
                            const int *node_offset);
+  template <int ORDER>
+  void createDependentConnKernel(const int *node_nums, TMROctantArray *nodes,
+                                 const int *node_offset);
 
   // Compute the node locations
   void evaluateNodeLocations();
+  // Evaluate a point, using the cached location if possible
+  void evalNodePoint(TMRVolume *vol, int block, double u, double v, double w,
+                     TMRPoint *pt);
+  // Evaluate the n^3 tensor grid of points, using the cached
+  // locations if possible
+  void evalNodeGrid(TMRVolume *vol, int block, int n, const double u[],
+                    const double v[], const double w[], TMRPoint X[]);
+
+  // Compute the interpolation in two phases: first for the nodes
+  // within local coarse elements, then for the nodes received. The
+  // rows are added to the interpolation object and/or the cache.
+  void computeInterpolation(TMROctForest *coarse, TACSBVecInterp *interp,
+                            TMRInterpCache *cache);
+  TMROctantArray *createLocalInterp(TMROctForest *coarse,
+                                    TACSBVecInterp *interp,
+                                    TMRInterpCache *cache, int **_oct_ptr);
+  void addExternalInterp(TMROctForest *coarse, TACSBVecInterp *interp,
+                         TMRInterpCache *cache, TMROctantExchange *exchange);
+
+  // Check if the interpolation cache contains the operator
+  int hasInterpCache(TMROctForest *coarse);
+  void getInterpCacheInfo(TMROctForest *coarse, int info[]);
 
   // Compute the element interpolation
   int computeElemInterp(TMROctant *node, TMROctForest *coarse, TMROctant *oct,
                         TMRIndexWeight *weights, double *tmp);
+  template <int ORDER>
+  int computeElemInterpKernel(TMROctant *node, TMROctForest *coarse,
+                              TMROctant *oct, TMRIndexWeight *weights,
+                              double *tmp);
+
+  // Compute the weights for transferring a node value from an element
+  // of another forest
+  int computeTransferWeights(TMROctant *node, TMROctForest *old_forest,
+                             TMROctant *oct, TMRIndexWeight *weights,
+                             double *tmp);
+
+  // Create the index from the entity names to the elements and nodes
+  TMRNameIndex *createNameIndex();
+
+  // Re-create the sorted local node numbers from the connectivity
+  void createNodeNumbers();
+
+  // Record the peak transient memory allocated during a phase
+  void beginMemoryPhase(int phase);
+  void addTransient(size_t bytes);
+  void removeTransient(size_t bytes);
 
   // Initialize the node label
   void initLabel(int mesh_order, TMRInterpolationType interp_type,
@@ -281,6 +465,7 @@ class TMROctForest : public TMREntity {
   // Information about the type of interpolation
   TMRInterpolationType interp_type;
   double *interp_knots;
+  double *interp_wts;
 
   // The owner octants which dictates the partitioning of the octants
   // across processors
@@ -303,15 +488,40 @@ class TMROctForest : public TMREntity {
   int num_owned_nodes;  // Number of nodes that are owned by me
   int ext_pre_offset;   // Number of nodes before pre
 
+  // The order of the owned nodes and the maximum bandwidth of the
+  // local element-node connectivity in the natural and selected order
+  TMRNodeOrderingType node_ordering;
+  int node_bandwidth[2];
+
   // The dependent node information
   int *dep_ptr, *dep_conn;
   double *dep_weights;
 
+  // The weight templates referenced by each dependent node. The
+  // expanded dep_weights are only created when they are requested.
+  int *dep_tmpl;
+  double *dep_tmpl_weights;
+
   // The array of all octants
   TMROctantArray *octants;
 
-  // The octants that are adjacent to this processor
+  // The octants, local nodes and local connectivity from the previous
+  // call to createNodes(), kept when the nodes are created incrementally
+  int use_incremental_nodes;
+  TMROctantArray *prev_octants, *prev_nodes;
+  int *prev_conn;
+
+  // The octants that are adjacent to this processor, stored either
+  // as an array of octants or, in the compact storage mode, as keys
+  int use_compact_storage;
   TMROctantArray *adjacent;
+  TMROctantKeyArray *adjacent_keys;
+
+  // The ghost layer of octants from other processors, their global
+  // element numbers and the neighbors of each local element
+  TMROctantArray *ghosts;
+  int *ghost_elems;
+  int *neighbor_ptr, *neighbor_conn, *neighbor_types;
 
   // The array of all the nodes
   TMRPoint *X;
@@ -319,6 +529,43 @@ class TMROctForest : public TMREntity {
   // The topology of the underlying model (if any)
   TMRTopology *topo;
 
+  // The node locations evaluated from the topology. This is shared
+  // between forests created from one another.
+  TMRPointCache *node_cache;
+
+  // The stored interpolation to a coarse forest, identified by the
+  // entity id and node stamp of the coarse forest
+  int use_interp_cache;
+  TMRInterpCache *interp_cache;
+  int interp_cache_id, interp_cache_stamp;
+
+  // A stamp that is unique to each numbering of the nodes
+  int node_stamp;
+
+  // The imbalance that triggers an automatic repartition and the
+  // outcome of the last check
+  double repartition_tol;
+  double last_imbalance, last_bytes_moved;
+  int last_repartitioned;
+
+  // Stamps that are incremented whenever the set of octants changes
+  // and whenever the octants are moved between processors
+  int octant_stamp, partition_stamp;
+
+  // The index from the entity names to the elements and nodes
+  TMRNameIndex *name_index;
+
+  // The data released once the TACSAssembler object is created
+  int release_flags;
+
+  // The transient memory that is currently allocated and its peak
+  // during the creation of the nodes and of the interpolation
+  static const int TMR_NODES_PHASE = 0;
+  static const int TMR_INTERP_PHASE = 1;
+  int memory_phase;
+  size_t transient_bytes;
+  size_t peak_bytes[2];
+
   // Class for the block connectivity
   class TMRBlockConn : public TMREntity {
    public:
@@ -340,9 +587,7 @@ class TMROctForest : public TMREntity {
       edge_block_conn = NULL;
       face_block_ptr = NULL;
       face_block_conn = NULL;
-      face_block_owners = NULL;
-      edge_block_owners = NULL;
-      node_block_owners = NULL;
+      block_transforms = NULL;
     }
     ~TMRBlockConn() {
       // Free the connectivity data
@@ -376,16 +621,8 @@ class TMROctForest : public TMREntity {
       if (face_block_conn) {
         delete[] face_block_conn;
       }
-
-      // Free the ownership data
-      if (face_block_owners) {
-        delete[] face_block_owners;
-      }
-      if (edge_block_owners) {
-        delete[] edge_block_owners;
-      }
-      if (node_block_owners) {
-        delete[] node_block_owners;
+      if (block_transforms) {
+        delete[] block_transforms;
       }
     }
 
@@ -400,13 +637,62 @@ class TMROctForest : public TMREntity {
     int *edge_block_ptr, *edge_block_conn;
     int *face_block_ptr, *face_block_conn;
 
-    // Store the face/edge/node owners
-    int *face_block_owners;
-    int *edge_block_owners;
-    int *node_block_owners;
-
     // Information to enable transformations between faces
     int *block_face_ids;
+
+    // The affine transformation of a node on a face, edge or corner
+    // of a block to the coordinates of the block that owns the
+    // entity, x' = A*x + hmax*b. The entries for each block are
+    // ordered by the 6 faces, the 12 edges and then the 8 corners.
+    // The adjacent block is -1 when the block owns the entity.
+    static const int NUM_BLOCK_TRANSFORMS = 26;
+    struct Transform {
+      int adj;       // The owner block or -1
+      int face_id;   // The source face id (faces only)
+      int reversed;  // Whether the edge is reversed (edges only)
+      int A[9];
+      int b[3];
+    };
+    Transform *block_transforms;
+
+    // Get the face/edge/node owners - the adjacent block with the
+    // lowest block number. The adjacent blocks are stored in
+    // ascending order, so the owner is the first block in the list.
+    int getFaceOwner(int face) const {
+      int ptr = face_block_ptr[face];
+      return (ptr < face_block_ptr[face + 1] ? face_block_conn[ptr] / 6
+                                             : num_blocks);
+    }
+    int getEdgeOwner(int edge) const {
+      int ptr = edge_block_ptr[edge];
+      return (ptr < edge_block_ptr[edge + 1] ? edge_block_conn[ptr] / 12
+                                             : num_blocks);
+    }
+    int getNodeOwner(int node) const {
+      int ptr = node_block_ptr[node];
+      return (ptr < node_block_ptr[node + 1] ? node_block_conn[ptr] / 8
+                                             : num_blocks);
+    }
+
+    // Get the memory held by the connectivity arrays
+    size_t getMemoryUsage() const {
+      size_t len = (8 + 6 + 12 + 6) * num_blocks;
+      len += num_nodes + 1 + num_edges + 1 + num_faces + 1;
+      if (node_block_ptr) {
+        len += node_block_ptr[num_nodes];
+      }
+      if (edge_block_ptr) {
+        len += edge_block_ptr[num_edges];
+      }
+      if (face_block_ptr) {
+        len += face_block_ptr[num_faces];
+      }
+      len *= sizeof(int);
+      if (block_transforms) {
+        len += NUM_BLOCK_TRANSFORMS * num_blocks * sizeof(Transform);
+      }
+      return len;
+    }
   } * bdata;
 };
 
@@ -0,0 +1,210 @@
+/*
+  This file is part of the package TMR for adaptive mesh refinement.
+
+  Copyright (C) 2015 Georgia Tech Research Corporation.
+  Additional copyright (C) 2015 Graeme Kennedy.
+  All rights reserved.
+
+  TMR is licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this software except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include "TMROctForestHierarchy.h"
+
+/*
+  Create the hierarchy of forests
+
+  The nodes are created on all levels of the hierarchy.
+
+  input:
+  forest:          the finest forest (must contain balanced octants)
+  num_levels:      the number of levels in the hierarchy
+  min_order:       the order is reduced down to this value before the
+                   forests are coarsened
+  balance_corner:  balance the coarsened forests across corners
+  repartition:     repartition the coarsened forests
+*/
+TMROctForestHierarchy::TMROctForestHierarchy(TMROctForest *forest,
+                                             int _num_levels, int min_order,
+                                             int balance_corner,
+                                             int repartition) {
+  num_levels = _num_levels;
+  if (num_levels < 1) {
+    num_levels = 1;
+  }
+  if (min_order < 2) {
+    min_order = 2;
+  }
+
+  forests = new TMROctForest *[num_levels];
+  forests[0] = forest;
+  forests[0]->incref();
+  forests[0]->createNodes();
+
+  for (int level = 1; level < num_levels; level++) {
+    TMROctForest *fine = forests[level - 1];
+    int order = fine->getMeshOrder();
+
+    if (order > min_order) {
+      forests[level] = fine->duplicate();
+      forests[level]->setMeshOrder(order - 1, fine->getInterpType());
+    } else {
+      forests[level] = fine->coarsen();
+      forests[level]->balance(balance_corner);
+      if (repartition) {
+        forests[level]->repartition();
+      }
+    }
+    forests[level]->incref();
+    forests[level]->createNodes();
+  }
+}
+
+/*
+  Free the hierarchy
+*/
+TMROctForestHierarchy::~TMROctForestHierarchy() {
+  for (int level = 0; level < num_levels; level++) {
+    forests[level]->decref();
+  }
+  delete[] forests;
+}
+
+/*
+  Get the forest at the specified level
+
+  Note that this returns NULL if the level is out of range.
+*/
+TMROctForest *TMROctForestHierarchy::getForest(int level) {
+  if (level >= 0 && level < num_levels) {
+    return forests[level];
+  }
+  return NULL;
+}
+
+/*
+  Create the interpolation between all adjacent levels
+
+  The operator interp[level] interpolates from level+1 to level.
+
+  input:
+  interp:  the num_levels-1 interpolation objects
+*/
+void TMROctForestHierarchy::createInterpolation(TACSBVecInterp *interp[]) {
+  createInterpolation(num_levels, forests, interp);
+}
+
+/*
+  Create the interpolation between all adjacent forests
+
+  The operator interp[level] interpolates from forest[level+1] to
+  forest[level]. The levels that use a stored interpolation are set
+  first. The local interpolation is then computed on each remaining
+  level. The counts of the nodes sent to other processors for all
+  these levels are exchanged together, and the exchanges for all
+  levels are started, each with its own message tag, before the
+  received nodes are processed.
+
+  input:
+  nlevels:  the number of forests
+  forest:   the forests ordered from finest to coarsest
+  interp:   the nlevels-1 interpolation objects
+*/
+void TMROctForestHierarchy::createInterpolation(int nlevels,
+                                                TMROctForest *forest[],
+                                                TACSBVecInterp *interp[]) {
+  if (nlevels < 2) {
+    return;
+  }
+
+  MPI_Comm comm = forest[0]->getMPIComm();
+  int mpi_rank, mpi_size;
+  MPI_Comm_rank(comm, &mpi_rank);
+  MPI_Comm_size(comm, &mpi_size);
+
+  // Set the levels that store their interpolation one at a time. The
+  // remaining levels are computed together.
+  int nbatch = 0;
+  int *batch = new int[nlevels - 1];
+  for (int level = 0; level < nlevels - 1; level++) {
+    if (forest[level]->use_interp_cache ||
+        forest[level]->hasInterpCache(forest[level + 1])) {
+      forest[level]->createInterpolation(forest[level + 1], interp[level]);
+    } else {
+      batch[nbatch] = level;
+      nbatch++;
+    }
+  }
+  if (nbatch == 0) {
+    delete[] batch;
+    return;
+  }
+
+  // Compute the local part of the interpolation on each level
+  TMROctantArray **ext_arrays = new TMROctantArray *[nbatch];
+  int **oct_ptrs = new int *[nbatch];
+  for (int k = 0; k < nbatch; k++) {
+    int level = batch[k];
+    forest[level]->beginMemoryPhase(TMROctForest::TMR_INTERP_PHASE);
+    ext_arrays[k] = forest[level]->createLocalInterp(
+        forest[level + 1], interp[level], NULL, &oct_ptrs[k]);
+  }
+
+  // Exchange the counts for all the levels at once. The counts are
+  // ordered by processor, then by level.
+  int *counts = new int[nbatch * mpi_size];
+  int *recv_counts = new int[nbatch * mpi_size];
+  for (int i = 0; i < mpi_size; i++) {
+    for (int k = 0; k < nbatch; k++) {
+      if (i == mpi_rank) {
+        counts[nbatch * i + k] = 0;
+      } else {
+        const int *ptr = oct_ptrs[k];
+        counts[nbatch * i + k] = ptr[i + 1] - ptr[i];
+      }
+    }
+  }
+  MPI_Alltoall(counts, nbatch, MPI_INT, recv_counts, nbatch, MPI_INT, comm);
+
+  // Start the exchanges for all the levels
+  int *recv_ptr = new int[mpi_size + 1];
+  TMROctantExchange **exchanges = new TMROctantExchange *[nbatch];
+  for (int k = 0; k < nbatch; k++) {
+    recv_ptr[0] = 0;
+    for (int i = 0; i < mpi_size; i++) {
+      recv_ptr[i + 1] = recv_ptr[i] + recv_counts[nbatch * i + k];
+    }
+
+    const int use_node_index = 0;
+    exchanges[k] = new TMROctantExchange(comm, ext_arrays[k], oct_ptrs[k],
+                                         recv_ptr, use_node_index, k);
+    exchanges[k]->begin();
+    delete[] oct_ptrs[k];
+  }
+  delete[] recv_ptr;
+  delete[] counts;
+  delete[] recv_counts;
+  delete[] oct_ptrs;
+
+  // Complete the interpolation on each level
+  for (int k = 0; k < nbatch; k++) {
+    int level = batch[k];
+    forest[level]->addExternalInterp(forest[level + 1], interp[level], NULL,
+                                     exchanges[k]);
+    forest[level]->removeTransient(ext_arrays[k]->getMemoryUsage());
+    delete exchanges[k];
+    delete ext_arrays[k];
+  }
+  delete[] exchanges;
+  delete[] ext_arrays;
+  delete[] batch;
+}
@@ -0,0 +1,67 @@
+/*
+  This file is part of the package TMR for adaptive mesh refinement.
+
+  Copyright (C) 2015 Georgia Tech Research Corporation.
+  Additional copyright (C) 2015 Graeme Kennedy.
+  All rights reserved.
+
+  TMR is licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this software except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef TMR_OCTANT_FOREST_HIERARCHY_H
+#define TMR_OCTANT_FOREST_HIERARCHY_H
+
+#include "TMROctForest.h"
+
+/*
+  A hierarchy of octree forests for multigrid
+
+  The hierarchy is created from the finest forest in a single pass.
+  Each coarser level is created either by reducing the mesh order of
+  the previous level (until the minimum order is reached) or by
+  coarsening the previous level. All of the levels share the block
+  connectivity, the topology and the cache of node locations, so that
+  nodes that exist on a finer level are not evaluated again by the
+  geometry.
+
+  The interpolation operators between all adjacent levels can be
+  created together. The counts for all levels are exchanged with a
+  single all-to-all, and the node exchanges for all levels are in
+  flight at the same time. The static version creates the operators
+  for any list of forests ordered from finest to coarsest, and is used
+  by TMR_CreateTACSMg().
+*/
+class TMROctForestHierarchy : public TMREntity {
+ public:
+  TMROctForestHierarchy(TMROctForest *forest, int _num_levels,
+                        int min_order = 2, int balance_corner = 0,
+                        int repartition = 0);
+  ~TMROctForestHierarchy();
+
+  // Get the forests in the hierarchy (level 0 is the finest)
+  // --------------------------------------------------------
+  int getNumLevels() { return num_levels; }
+  TMROctForest *getForest(int level);
+
+  // Create the interpolation between each level and the next coarser
+  // -----------------------------------------------------------------
+  void createInterpolation(TACSBVecInterp *interp[]);
+  static void createInterpolation(int nlevels, TMROctForest *forest[],
+                                  TACSBVecInterp *interp[]);
+
+ private:
+  int num_levels;
+  TMROctForest **forests;
+};
+
+#endif  // TMR_OCTANT_FOREST_HIERARCHY_H
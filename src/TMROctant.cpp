@@ -21,6 +21,7 @@
 #include "TMROctant.h"
 
 #include "TMRHashFunction.h"
+#include "TMRRadixSort.h"
 
 /*
   Get the child id of the octant
@@ -320,6 +321,70 @@ static int compare_nodes(const void *a, const void *b) {
   return ao->compareNode(bo);
 }
 
+/*
+  Sort the octants based on the Morton encoding using a radix sort.
+
+  The key for each octant consists of the block index, the 93-bit
+  Morton code formed from interleaving the x, y and z coordinates and
+  a 16-bit value that breaks ties: the level when sorting elements and
+  the info when sorting nodes. This reproduces the ordering of
+  TMROctant::compare and TMROctant::compareNode. The x bit is the most
+  significant bit within each interleaved triplet, since ties in the
+  most-significant bit are resolved in favor of x.
+
+  The function returns 0 and does nothing if the coordinates or block
+  indices lie outside the range that can be represented by the key.
+*/
+static int radix_sort_octants(TMROctant *array, int size,
+                              int use_node_index) {
+  // Check that the octants can be represented by the keys
+  int32_t min_block = array[0].block, max_block = array[0].block;
+  for (int i = 0; i < size; i++) {
+    if (array[i].x < 0 || array[i].y < 0 || array[i].z < 0) {
+      return 0;
+    }
+    if (array[i].block < min_block) {
+      min_block = array[i].block;
+    }
+    if (array[i].block > max_block) {
+      max_block = array[i].block;
+    }
+  }
+  if ((uint64_t)((int64_t)max_block - min_block) >= (1ULL << 19)) {
+    return 0;
+  }
+
+  TMRSortKey *keys = new TMRSortKey[2 * size];
+  for (int i = 0; i < size; i++) {
+    const uint64_t x = array[i].x, y = array[i].y, z = array[i].z;
+
+    // Interleave the lower 21 bits and upper 10 bits separately
+    uint64_t mlo = ((TMRSpreadBits3(x) << 2) | (TMRSpreadBits3(y) << 1) |
+                    TMRSpreadBits3(z));
+    uint64_t mhi = ((TMRSpreadBits3(x >> 21) << 2) |
+                    (TMRSpreadBits3(y >> 21) << 1) | TMRSpreadBits3(z >> 21));
+
+    uint64_t tie = 0;
+    if (use_node_index) {
+      tie = (uint16_t)(array[i].info ^ 0x8000);
+    } else {
+      tie = (uint16_t)(array[i].level ^ 0x8000);
+    }
+
+    keys[i].hi = ((uint64_t)(array[i].block - min_block) << 45) | (mhi << 15) |
+                 (mlo >> 48);
+    keys[i].lo = (mlo << 16) | tie;
+    keys[i].index = i;
+  }
+
+  TMRSortKey *sorted = TMRRadixSortKeys(size, keys, &keys[size]);
+  TMRSortKey *temp = (sorted == keys ? &keys[size] : keys);
+  TMRApplySortPermutation(size, sorted, array, temp);
+  delete[] keys;
+
+  return 1;
+}
+
 /*
   Store a array of octants
 */
@@ -355,8 +420,16 @@ TMROctantArray *TMROctantArray::duplicate() {
   entries.
 */
 void TMROctantArray::sort() {
+  // Order the octants with the radix sort when possible
+  int sorted = 0;
+  if (size >= min_radix_sort_size) {
+    sorted = radix_sort_octants(array, size, use_node_index);
+  }
+
   if (use_node_index) {
-    qsort(array, size, sizeof(TMROctant), compare_nodes);
+    if (!sorted) {
+      qsort(array, size, sizeof(TMROctant), compare_nodes);
+    }
 
     // Now that the Octants are sorted, remove duplicates
     int i = 0;  // Location from which to take entries
@@ -375,7 +448,9 @@ void TMROctantArray::sort() {
     // The new size of the array
     size = j;
   } else {
-    qsort(array, size, sizeof(TMROctant), compare_octants);
+    if (!sorted) {
+      qsort(array, size, sizeof(TMROctant), compare_octants);
+    }
 
     // Now that the Octants are sorted, remove duplicates
     int i = 0;  // Location from which to take entries
@@ -398,6 +473,29 @@ void TMROctantArray::sort() {
   is_sorted = 1;
 }
 
+/*
+  Sort the array based on the tag values alone.
+
+  This ordering is used to group octants by their destination
+  processor. The sort is stable and the array is no longer considered
+  to be sorted in the Morton order.
+*/
+void TMROctantArray::sortByTag() {
+  TMRSortKey *keys = new TMRSortKey[2 * size];
+  for (int i = 0; i < size; i++) {
+    keys[i].hi = 0;
+    keys[i].lo = (uint32_t)array[i].tag ^ 0x80000000U;
+    keys[i].index = i;
+  }
+
+  TMRSortKey *sorted = TMRRadixSortKeys(size, keys, &keys[size]);
+  TMRSortKey *temp = (sorted == keys ? &keys[size] : keys);
+  TMRApplySortPermutation(size, sorted, array, temp);
+  delete[] keys;
+
+  is_sorted = 0;
+}
+
 /*
   Determine if the array contains the specified octant
 */
@@ -423,8 +521,183 @@ TMROctant *TMROctantArray::contains(TMROctant *q, int use_position) {
   }
 }
 
+/*
+  Find the first entry in the sorted array, at or after the given
+  starting index, that is not less than the query.
+
+  The search gallops forward from the starting index with steps that
+  double in length, and then bisects the last step. The cost is
+  logarithmic in the distance between the start and the result, so a
+  sequence of increasing queries is located with a single sweep.
+*/
+static int gallop_lower_bound(const TMROctant *array, int size, int start,
+                              const TMROctant *q,
+                              int (*cmp)(const void *, const void *)) {
+  if (start >= size || cmp(&array[start], q) >= 0) {
+    return start;
+  }
+
+  // Gallop until array[lo] < q <= array[hi]
+  int lo = start, hi = start + 1, step = 1;
+  while (hi < size && cmp(&array[hi], q) < 0) {
+    lo = hi;
+    step *= 2;
+    hi = lo + step;
+  }
+  if (hi > size) {
+    hi = size;
+  }
+
+  // Bisect the interval (lo, hi]
+  while (hi - lo > 1) {
+    int mid = lo + (hi - lo) / 2;
+    if (cmp(&array[mid], q) < 0) {
+      lo = mid;
+    } else {
+      hi = mid;
+    }
+  }
+
+  return hi;
+}
+
+/*
+  Determine whether the array contains each of the specified octants
+
+  This is equivalent to calling contains() for each query, with
+  results[i] set to the matching entry in the array or NULL. The
+  queries are sorted (if they are not already in order) and the two
+  sorted sequences are swept together, so that the array is traversed
+  once in order rather than with an independent binary search for
+  each query.
+*/
+void TMROctantArray::containsMany(int n, const TMROctant *queries,
+                                  TMROctant **results, int use_position) {
+  if (!is_sorted) {
+    is_sorted = 1;
+    sort();
+  }
+
+  int (*cmp)(const void *, const void *) = compare_octants;
+  if (use_node_index) {
+    cmp = compare_nodes;
+  } else if (use_position) {
+    cmp = compare_position;
+  }
+
+  // Check whether the queries are already in order
+  int in_order = 1;
+  for (int i = 1; i < n; i++) {
+    if (cmp(&queries[i - 1], &queries[i]) > 0) {
+      in_order = 0;
+      break;
+    }
+  }
+
+  if (in_order) {
+    int pos = 0;
+    for (int i = 0; i < n; i++) {
+      pos = gallop_lower_bound(array, size, pos, &queries[i], cmp);
+      if (pos < size && cmp(&array[pos], &queries[i]) == 0) {
+        results[i] = &array[pos];
+      } else {
+        results[i] = NULL;
+      }
+    }
+    return;
+  }
+
+  // Sort a copy of the queries, using the tag to record the original
+  // index of each query. The ordering of compare() and compareNode()
+  // is consistent with comparePosition().
+  TMROctant *sorted = new TMROctant[n];
+  memcpy(sorted, queries, n * sizeof(TMROctant));
+  for (int i = 0; i < n; i++) {
+    sorted[i].tag = i;
+  }
+  int radix_sorted = 0;
+  if (n >= min_radix_sort_size) {
+    radix_sorted = radix_sort_octants(sorted, n, use_node_index);
+  }
+  if (!radix_sorted) {
+    if (use_node_index) {
+      qsort(sorted, n, sizeof(TMROctant), compare_nodes);
+    } else {
+      qsort(sorted, n, sizeof(TMROctant), compare_octants);
+    }
+  }
+
+  int pos = 0;
+  for (int i = 0; i < n; i++) {
+    pos = gallop_lower_bound(array, size, pos, &sorted[i], cmp);
+    if (pos < size && cmp(&array[pos], &sorted[i]) == 0) {
+      results[sorted[i].tag] = &array[pos];
+    } else {
+      results[sorted[i].tag] = NULL;
+    }
+  }
+
+  delete[] sorted;
+}
+
+/*
+  Find the range of entries in the array that lie within the given
+  octant
+
+  On input, start is the index from which to begin the search, which
+  can be used to sweep through a sequence of increasing octants. On
+  output, the entries array[start], ..., array[end-1] are the entries
+  that lie within the octant. For element arrays, these are the
+  octant itself and its descendants. The number of entries in the
+  range is returned.
+*/
+int TMROctantArray::findDescendants(TMROctant *oct, int *start, int *end) {
+  if (!is_sorted) {
+    is_sorted = 1;
+    sort();
+  }
+
+  int pos = *start;
+  if (pos < 0) {
+    pos = 0;
+  }
+
+  // The first entry is not less than the octant. Elements at the
+  // same position as the octant with a lower level are larger than
+  // the octant and are excluded.
+  if (use_node_index) {
+    pos = gallop_lower_bound(array, size, pos, oct, compare_position);
+  } else {
+    pos = gallop_lower_bound(array, size, pos, oct, compare_octants);
+  }
+
+  // The last possible entry is the finest octant in the far corner
+  const int32_t h = 1 << (TMR_MAX_LEVEL - oct->level);
+  TMROctant last;
+  last.block = oct->block;
+  last.x = oct->x + h - 1;
+  last.y = oct->y + h - 1;
+  last.z = oct->z + h - 1;
+  last.level = TMR_MAX_LEVEL;
+
+  // Find the first entry that lies strictly after the last corner
+  int last_pos = gallop_lower_bound(array, size, pos, &last, compare_position);
+  while (last_pos < size && array[last_pos].comparePosition(&last) == 0) {
+    last_pos++;
+  }
+
+  *start = pos;
+  *end = last_pos;
+
+  return last_pos - pos;
+}
+
 /*
   Merge the entries of two arrays
+
+  When the arrays contain nodes, they are compared as nodes. The
+  entries of this array are kept when both arrays contain the same
+  entry.
 */
 void TMROctantArray::merge(TMROctantArray *list) {
   if (!is_sorted) {
@@ -434,6 +707,12 @@ void TMROctantArray::merge(TMROctantArray *list) {
     list->sort();
   }
 
+  // Compare either the octants or the nodes
+  int (*cmp)(const void *, const void *) = compare_octants;
+  if (use_node_index) {
+    cmp = compare_nodes;
+  }
+
   // Keep track of the number of duplicates
   int nduplicates = 0;
 
@@ -441,13 +720,13 @@ void TMROctantArray::merge(TMROctantArray *list) {
   // of duplicates
   int j = 0, i = 0;
   for (; i < size; i++) {
-    while ((j < list->size) && (list->array[j].compare(&array[i]) < 0)) {
+    while ((j < list->size) && (cmp(&list->array[j], &array[i]) < 0)) {
       j++;
     }
     if (j >= list->size) {
       break;
     }
-    if (array[i].compare(&list->array[j]) == 0) {
+    if (cmp(&array[i], &list->array[j]) == 0) {
       nduplicates++;
     }
   }
@@ -474,10 +753,10 @@ void TMROctantArray::merge(TMROctantArray *list) {
   i = size - 1;
   j = list->size - 1;
   while (i >= 0 && j >= 0) {
-    if (array[i].compare(&list->array[j]) > 0) {
+    if (cmp(&array[i], &list->array[j]) > 0) {
       array[end] = array[i];
       end--, i--;
-    } else if (list->array[j].compare(&array[i]) > 0) {
+    } else if (cmp(&list->array[j], &array[i]) > 0) {
       array[end] = list->array[j];
       end--, j--;
     } else {  // b[j] == a[i]
@@ -508,23 +787,252 @@ void TMROctantArray::getArray(TMROctant **_array, int *_size) {
   }
 }
 
+/*
+  Create the compact array from a sorted list of octants
+
+  The octants in the list must satisfy canStore(). When store_tags is
+  true, the tag and info values are kept unless they are all zero.
+
+  input:
+  list:        the sorted array of octants
+  store_tags:  flag to indicate whether to keep the tag and info values
+*/
+TMROctantKeyArray::TMROctantKeyArray(TMROctantArray *list, int store_tags) {
+  TMROctant *array;
+  list->getArray(&array, &size);
+
+  blocks = new int32_t[size];
+  keys = new uint64_t[size];
+  for (int i = 0; i < size; i++) {
+    blocks[i] = array[i].block;
+    keys[i] = getKey(&array[i]);
+  }
+
+  // Only store the tags/info values when one of them is non-zero
+  tags = NULL;
+  infos = NULL;
+  if (store_tags) {
+    int has_tags = 0;
+    for (int i = 0; i < size; i++) {
+      if (array[i].tag != 0 || array[i].info != 0) {
+        has_tags = 1;
+        break;
+      }
+    }
+
+    if (has_tags) {
+      tags = new int32_t[size];
+      infos = new int16_t[size];
+      for (int i = 0; i < size; i++) {
+        tags[i] = array[i].tag;
+        infos[i] = array[i].info;
+      }
+    }
+  }
+}
+
+/*
+  Free the compact array
+*/
+TMROctantKeyArray::~TMROctantKeyArray() {
+  delete[] blocks;
+  delete[] keys;
+  if (tags) {
+    delete[] tags;
+  }
+  if (infos) {
+    delete[] infos;
+  }
+}
+
+/*
+  Check whether all the octants in the list can be stored
+
+  The octants must have a level no greater than max_level and lie
+  within the block.
+*/
+int TMROctantKeyArray::canStore(TMROctantArray *list) {
+  int size;
+  TMROctant *array;
+  list->getArray(&array, &size);
+
+  const int32_t hmax = 1 << TMR_MAX_LEVEL;
+  const int32_t mask = (1 << (TMR_MAX_LEVEL - max_level)) - 1;
+  for (int i = 0; i < size; i++) {
+    if (array[i].level < 0 || array[i].level > max_level) {
+      return 0;
+    }
+    if (array[i].x < 0 || array[i].x >= hmax || array[i].y < 0 ||
+        array[i].y >= hmax || array[i].z < 0 || array[i].z >= hmax) {
+      return 0;
+    }
+    if ((array[i].x & mask) || (array[i].y & mask) || (array[i].z & mask)) {
+      return 0;
+    }
+  }
+
+  return 1;
+}
+
+/*
+  Compute the key for an octant
+
+  The key consists of the Morton code of the first max_level bits of
+  the coordinates, with the x bit the most significant bit within each
+  triplet as in TMROctant::compare, followed by 5 bits for the level.
+*/
+uint64_t TMROctantKeyArray::getKey(const TMROctant *oct) {
+  const int shift = TMR_MAX_LEVEL - max_level;
+  const uint64_t x = oct->x >> shift;
+  const uint64_t y = oct->y >> shift;
+  const uint64_t z = oct->z >> shift;
+  uint64_t code =
+      (TMRSpreadBits3(x) << 2) | (TMRSpreadBits3(y) << 1) | TMRSpreadBits3(z);
+
+  return (code << 5) | (uint64_t)(oct->level & 0x1f);
+}
+
+/*
+  Get the bytes held by the compact array
+*/
+size_t TMROctantKeyArray::getMemoryUsage() {
+  size_t bytes = size * (sizeof(int32_t) + sizeof(uint64_t));
+  if (tags) {
+    bytes += size * (sizeof(int32_t) + sizeof(int16_t));
+  }
+  return bytes;
+}
+
+/*
+  Retrieve an octant from the array
+
+  input:
+  index:   the index of the octant
+
+  output:
+  oct:     the octant
+*/
+void TMROctantKeyArray::getOctant(int index, TMROctant *oct) {
+  const int shift = TMR_MAX_LEVEL - max_level;
+  const uint64_t code = keys[index] >> 5;
+
+  oct->block = blocks[index];
+  oct->x = (int32_t)(TMRCompactBits3(code >> 2) << shift);
+  oct->y = (int32_t)(TMRCompactBits3(code >> 1) << shift);
+  oct->z = (int32_t)(TMRCompactBits3(code) << shift);
+  oct->level = (int16_t)(keys[index] & 0x1f);
+  oct->tag = (tags ? tags[index] : 0);
+  oct->info = (infos ? infos[index] : 0);
+}
+
+/*
+  Find the last entry in the array that is less than or equal to the
+  block and key. Return -1 if there is no such entry.
+*/
+int TMROctantKeyArray::findLast(int32_t block, uint64_t key) {
+  int low = 0, high = size;
+  while (low < high) {
+    int mid = low + (high - low) / 2;
+    if (blocks[mid] < block || (blocks[mid] == block && keys[mid] <= key)) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+
+  return low - 1;
+}
+
+/*
+  Find the index of an octant with the same block, position and level
+
+  input:
+  oct:     the octant to search for
+
+  returns: the index of the octant or -1 if it is not in the array
+*/
+int TMROctantKeyArray::findIndex(TMROctant *oct) {
+  const int32_t hmax = 1 << TMR_MAX_LEVEL;
+  const int32_t mask = (1 << (TMR_MAX_LEVEL - max_level)) - 1;
+  if (oct->level < 0 || oct->level > max_level || oct->x < 0 ||
+      oct->x >= hmax || oct->y < 0 || oct->y >= hmax || oct->z < 0 ||
+      oct->z >= hmax) {
+    return -1;
+  }
+  if ((oct->x & mask) || (oct->y & mask) || (oct->z & mask)) {
+    return -1;
+  }
+
+  const uint64_t key = getKey(oct);
+  int index = findLast(oct->block, key);
+  if (index >= 0 && blocks[index] == oct->block && keys[index] == key) {
+    return index;
+  }
+
+  return -1;
+}
+
+/*
+  Find the index of the octant that contains the given octant or node
+
+  The octants in the array must not overlap one another, as is the
+  case for the elements.
+
+  input:
+  oct:     the octant or node to search for
+
+  returns: the index of the enclosing octant or -1 if none is found
+*/
+int TMROctantKeyArray::findEnclosingIndex(TMROctant *oct) {
+  const int32_t hmax = 1 << TMR_MAX_LEVEL;
+  if (oct->x < 0 || oct->x >= hmax || oct->y < 0 || oct->y >= hmax ||
+      oct->z < 0 || oct->z >= hmax) {
+    return -1;
+  }
+
+  // Search with the largest level so that the enclosing octant
+  // precedes the position of the node
+  TMROctant t = *oct;
+  t.level = 0x1f;
+  int index = findLast(oct->block, getKey(&t));
+  if (index >= 0) {
+    getOctant(index, &t);
+    if (t.contains(oct)) {
+      return index;
+    }
+  }
+
+  return -1;
+}
+
+/*
+  Convert the compact array to an array of octants
+*/
+TMROctantArray *TMROctantKeyArray::toArray() {
+  TMROctant *array = new TMROctant[size];
+  for (int i = 0; i < size; i++) {
+    getOctant(i, &array[i]);
+  }
+
+  return new TMROctantArray(array, size);
+}
+
 /*
   Create an queue of octants
 */
 TMROctantQueue::TMROctantQueue() {
-  root = tip = NULL;
+  start = 0;
   num_elems = 0;
+  max_num_elems = 0;
+  elems = NULL;
 }
 
 /*
   Free the queue
 */
 TMROctantQueue::~TMROctantQueue() {
-  OctQueueNode *node = root;
-  while (node) {
-    OctQueueNode *tmp = node;
-    node = node->next;
-    delete tmp;
+  if (elems) {
+    delete[] elems;
   }
 }
 
@@ -537,15 +1045,26 @@ int TMROctantQueue::length() { return num_elems; }
   Push a value onto the octant queue
 */
 void TMROctantQueue::push(TMROctant *oct) {
-  if (!tip) {
-    root = new OctQueueNode();
-    root->oct = *oct;
-    tip = root;
-  } else {
-    tip->next = new OctQueueNode();
-    tip->next->oct = *oct;
-    tip = tip->next;
+  if (num_elems >= max_num_elems) {
+    // Double the size of the buffer and copy the entries so that
+    // they start at the beginning of the new buffer
+    int new_size = 2 * max_num_elems;
+    if (new_size < min_queue_size) {
+      new_size = min_queue_size;
+    }
+    TMROctant *temp = new TMROctant[new_size];
+    for (int i = 0; i < num_elems; i++) {
+      temp[i] = elems[(start + i) & (max_num_elems - 1)];
+    }
+    if (elems) {
+      delete[] elems;
+    }
+    elems = temp;
+    max_num_elems = new_size;
+    start = 0;
   }
+
+  elems[(start + num_elems) & (max_num_elems - 1)] = *oct;
   num_elems++;
 }
 
@@ -553,39 +1072,218 @@ void TMROctantQueue::push(TMROctant *oct) {
   Pop a value from the octant queue
 */
 TMROctant TMROctantQueue::pop() {
-  if (!root) {
+  if (num_elems == 0) {
     return TMROctant();
   } else {
+    TMROctant temp = elems[start];
+    start = (start + 1) & (max_num_elems - 1);
     num_elems--;
-    TMROctant temp = root->oct;
-    OctQueueNode *tmp = root;
-    root = root->next;
-    delete tmp;
-    if (num_elems == 0) {
-      tip = NULL;
-    }
     return temp;
   }
 }
 
 /*
   Convert the queue to an array
+
+  The storage of the queue is passed to the array object directly
+  when the entries do not wrap around the end of the buffer. After
+  this call the queue is empty.
 */
 TMROctantArray *TMROctantQueue::toArray() {
-  // Allocate the array
-  TMROctant *array = new TMROctant[num_elems];
-
-  // Scan through the queue and retrieve the octants
-  OctQueueNode *node = root;
-  int index = 0;
-  while (node) {
-    array[index] = node->oct;
-    node = node->next;
-    index++;
+  TMROctant *array = NULL;
+  if (!elems) {
+    array = new TMROctant[0];
+  } else if (start + num_elems <= max_num_elems) {
+    // The entries are contiguous, shift them to the beginning of the
+    // buffer (if required) and take the storage
+    if (start > 0) {
+      memmove(elems, &elems[start], num_elems * sizeof(TMROctant));
+    }
+    array = elems;
+  } else {
+    // The entries wrap around the end of the buffer, copy the two
+    // segments in order
+    array = new TMROctant[num_elems];
+    int len = max_num_elems - start;
+    memcpy(array, &elems[start], len * sizeof(TMROctant));
+    memcpy(&array[len], elems, (num_elems - len) * sizeof(TMROctant));
+    delete[] elems;
   }
 
   // Create the array object
   TMROctantArray *list = new TMROctantArray(array, num_elems);
+
+  // Reset the queue
+  start = 0;
+  num_elems = 0;
+  max_num_elems = 0;
+  elems = NULL;
+
+  return list;
+}
+
+/*
+  Create the exchange object
+
+  input:
+  comm:            the MPI communicator
+  list:            the octants to send
+  ptr:             the intervals of the list to send to each processor
+  recv_ptr:        the intervals of the receive array for each processor
+  use_node_index:  the receive array uses the node index
+  tag:             the tag for the messages
+*/
+TMROctantExchange::TMROctantExchange(MPI_Comm _comm, TMROctantArray *list,
+                                     const int *_ptr, const int *_recv_ptr,
+                                     int _use_node_index, int _tag) {
+  comm = _comm;
+  tag = _tag;
+  MPI_Comm_rank(comm, &mpi_rank);
+  MPI_Comm_size(comm, &mpi_size);
+  use_node_index = _use_node_index;
+
+  int size;
+  list->getArray(&send_array, &size);
+
+  // Copy the intervals
+  ptr = new int[mpi_size + 1];
+  recv_ptr = new int[mpi_size + 1];
+  memcpy(ptr, _ptr, (mpi_size + 1) * sizeof(int));
+  memcpy(recv_ptr, _recv_ptr, (mpi_size + 1) * sizeof(int));
+
+  // Allocate the receive array
+  recv_size = recv_ptr[mpi_size];
+  recv_array = new TMROctant[recv_size];
+  local_pending = 0;
+
+  // Count up the number of sends and receives
+  nsends = nrecvs = 0;
+  for (int i = 0; i < mpi_size; i++) {
+    if (i != mpi_rank) {
+      if (ptr[i + 1] > ptr[i]) {
+        nsends++;
+      }
+      if (recv_ptr[i + 1] > recv_ptr[i]) {
+        nrecvs++;
+      }
+    }
+  }
+
+  recv_ranks = new int[nrecvs];
+  send_requests = new MPI_Request[nsends];
+  recv_requests = new MPI_Request[nrecvs];
+  for (int i = 0; i < nsends; i++) {
+    send_requests[i] = MPI_REQUEST_NULL;
+  }
+  for (int i = 0; i < nrecvs; i++) {
+    recv_requests[i] = MPI_REQUEST_NULL;
+  }
+}
+
+/*
+  Free the exchange object, completing any outstanding communication
+*/
+TMROctantExchange::~TMROctantExchange() {
+  MPI_Waitall(nrecvs, recv_requests, MPI_STATUSES_IGNORE);
+  MPI_Waitall(nsends, send_requests, MPI_STATUSES_IGNORE);
+  delete[] ptr;
+  delete[] recv_ptr;
+  delete[] recv_ranks;
+  delete[] send_requests;
+  delete[] recv_requests;
+  if (recv_array) {
+    delete[] recv_array;
+  }
+}
+
+/*
+  Post the receives and sends and copy the processor-local octants
+*/
+void TMROctantExchange::begin() {
+  // Post the receives first so that the messages can be received
+  // directly into the receive array
+  for (int i = 0, j = 0; i < mpi_size; i++) {
+    if (i != mpi_rank && recv_ptr[i + 1] > recv_ptr[i]) {
+      int count = recv_ptr[i + 1] - recv_ptr[i];
+      MPI_Irecv(&recv_array[recv_ptr[i]], count, TMROctant_MPI_type, i, tag,
+                comm, &recv_requests[j]);
+      recv_ranks[j] = i;
+      j++;
+    }
+  }
+
+  // Post the sends
+  for (int i = 0, j = 0; i < mpi_size; i++) {
+    if (i != mpi_rank && ptr[i + 1] > ptr[i]) {
+      int count = ptr[i + 1] - ptr[i];
+      MPI_Isend(&send_array[ptr[i]], count, TMROctant_MPI_type, i, tag, comm,
+                &send_requests[j]);
+      j++;
+    }
+  }
+
+  // Copy the processor-local octants
+  int count = recv_ptr[mpi_rank + 1] - recv_ptr[mpi_rank];
+  if (count > 0 && (count == ptr[mpi_rank + 1] - ptr[mpi_rank])) {
+    memcpy(&recv_array[recv_ptr[mpi_rank]], &send_array[ptr[mpi_rank]],
+           count * sizeof(TMROctant));
+    local_pending = 1;
+  }
+}
+
+/*
+  Wait for any of the receives to complete
+
+  The processor-local octants are returned first, then the octants
+  from the other processors in the order in which they arrive.
+
+  output:
+  array:   pointer to the received octants within the receive array
+  size:    the number of received octants
+
+  returns:
+  the rank of the sending processor, or -1 if all octants have been
+  received
+*/
+int TMROctantExchange::waitAny(TMROctant **array, int *size) {
+  int rank = -1;
+  if (local_pending) {
+    local_pending = 0;
+    rank = mpi_rank;
+  } else if (nrecvs > 0) {
+    int index;
+    MPI_Waitany(nrecvs, recv_requests, &index, MPI_STATUS_IGNORE);
+    if (index != MPI_UNDEFINED) {
+      rank = recv_ranks[index];
+    }
+  }
+
+  if (rank >= 0) {
+    *array = &recv_array[recv_ptr[rank]];
+    *size = recv_ptr[rank + 1] - recv_ptr[rank];
+  } else {
+    *array = NULL;
+    *size = 0;
+  }
+
+  return rank;
+}
+
+/*
+  Complete the exchange and return the received octants
+
+  The receive array is handed over to the new octant array object.
+*/
+TMROctantArray *TMROctantExchange::end() {
+  MPI_Waitall(nrecvs, recv_requests, MPI_STATUSES_IGNORE);
+  MPI_Waitall(nsends, send_requests, MPI_STATUSES_IGNORE);
+  local_pending = 0;
+
+  TMROctantArray *list =
+      new TMROctantArray(recv_array, recv_size, use_node_index);
+  recv_array = NULL;
+  recv_size = 0;
+
   return list;
 }
 
@@ -595,52 +1293,46 @@ TMROctantArray *TMROctantQueue::toArray() {
   Note that this isn't a true hash table since it does not associate
   elements with other values. It is used to create unique lists of
   elements and nodes within the octree mesh.
+
+  The optional size hint is an estimate of the number of unique
+  octants that will be added. This avoids re-hashing the table when
+  the final size is known in advance.
 */
-TMROctantHash::TMROctantHash(int _use_node_index) {
+TMROctantHash::TMROctantHash(int _use_node_index, int size_hint) {
   use_node_index = _use_node_index;
+
+  // Set the initial table size so that the load factor does not
+  // exceed 1/2 for the expected number of entries
+  table_size = min_table_size;
+  while (table_size < 2 * size_hint) {
+    table_size *= 2;
+  }
+  table = new int[table_size];
+  memset(table, 0xff, table_size * sizeof(int));
+
   num_elems = 0;
-  num_buckets = min_num_buckets;
-  hash_buckets = new OctHashNode *[num_buckets];
-  memset(hash_buckets, 0, num_buckets * sizeof(OctHashNode *));
+  max_num_elems = table_size / 2;
+  elems = new TMROctant[max_num_elems];
 }
 
 /*
   Free the memory allocated by the octant hash
 */
 TMROctantHash::~TMROctantHash() {
-  // Free all the elements in the hash
-  for (int i = 0; i < num_buckets; i++) {
-    OctHashNode *node = hash_buckets[i];
-    while (node) {
-      // Delete the old guy
-      OctHashNode *tmp = node;
-      node = node->next;
-      delete tmp;
-    }
-  }
-
-  delete[] hash_buckets;
+  delete[] table;
+  delete[] elems;
 }
 
 /*
   Covert the hash table to an array
+
+  The octants are stored contiguously in the order in which they were
+  added, so this only requires a single copy.
 */
 TMROctantArray *TMROctantHash::toArray() {
   // Create an array of octants
   TMROctant *array = new TMROctant[num_elems];
-
-  // Loop over all the buckets
-  for (int i = 0, index = 0; i < num_buckets; i++) {
-    // Get the hash bucket and extract all the elements from this
-    // bucket into the array
-    OctHashNode *node = hash_buckets[i];
-
-    while (node) {
-      array[index] = node->oct;
-      index++;
-      node = node->next;
-    }
-  }
+  memcpy(array, elems, num_elems * sizeof(TMROctant));
 
   // Create an array object and add it to the list
   TMROctantArray *list = new TMROctantArray(array, num_elems, use_node_index);
@@ -661,138 +1353,81 @@ TMROctantArray *TMROctantHash::toArray() {
   true if the octant is added, false if it is not
 */
 int TMROctantHash::addOctant(TMROctant *oct) {
-  if (num_elems > 10 * num_buckets) {
-    // Redistribute the octants to new buckets
-    int num_old_buckets = num_buckets;
-    num_buckets = 2 * num_buckets;
-    OctHashNode **new_buckets = new OctHashNode *[num_buckets];
-    memset(new_buckets, 0, num_buckets * sizeof(OctHashNode *));
-
-    // Keep track of the end bucket
-    OctHashNode **end_buckets = new OctHashNode *[num_buckets];
-
-    // Redistribute the octant nodes based on the new
-    // number of buckets within the hash data structure
-    for (int i = 0; i < num_old_buckets; i++) {
-      OctHashNode *node = hash_buckets[i];
-      while (node) {
-        int bucket = getBucket(&(node->oct));
-
-        // If this is the first new bucket, create
-        // the new node
-        if (!new_buckets[bucket]) {
-          new_buckets[bucket] = new OctHashNode;
-          new_buckets[bucket]->oct = node->oct;
-          end_buckets[bucket] = new_buckets[bucket];
-        } else {
-          end_buckets[bucket]->next = new OctHashNode;
-          end_buckets[bucket]->next->oct = node->oct;
-          end_buckets[bucket] = end_buckets[bucket]->next;
-        }
-
-        // Delete the old guy
-        OctHashNode *tmp = node;
-
-        // Increment the node to the next hash
-        node = node->next;
-
-        // Free the node
-        delete tmp;
-      }
-    }
-
-    delete[] end_buckets;
-    delete[] hash_buckets;
-    hash_buckets = new_buckets;
+  // Keep the load factor below 1/2 so the probe sequences stay short
+  if (2 * (num_elems + 1) > table_size) {
+    resizeTable(2 * table_size);
   }
 
-  int bucket = getBucket(oct);
-
-  // If no octant has been added to the bucket,
-  // create a new bucket
-  if (!hash_buckets[bucket]) {
-    hash_buckets[bucket] = new OctHashNode;
-    hash_buckets[bucket]->oct = *oct;
-    num_elems++;
-    return 1;
-  } else {
-    // Get the head node for the corresponding bucket
-    OctHashNode *node = hash_buckets[bucket];
-    if (use_node_index) {
-      while (node) {
-        // The octant is in the list, quit now and return false
-        if (node->oct.compareNode(oct) == 0) {
-          return 0;
-        }
-
-        // If the next node does not exist, quit
-        // while node is the last node in the linked
-        // list
-        if (!node->next) {
-          break;
-        }
-        node = node->next;
+  // Probe the table until we find the octant or an empty slot
+  const uint32_t mask = table_size - 1;
+  uint32_t slot = getHash(oct) & mask;
+  if (use_node_index) {
+    while (table[slot] >= 0) {
+      if (elems[table[slot]].compareNode(oct) == 0) {
+        return 0;
       }
-    } else {
-      while (node) {
-        // The octant is in the list, quit now and return false
-        if (node->oct.compare(oct) == 0) {
-          return 0;
-        }
-
-        // If the next node does not exist, quit
-        // while node is the last node in the linked
-        // list
-        if (!node->next) {
-          break;
-        }
-        node = node->next;
+      slot = (slot + 1) & mask;
+    }
+  } else {
+    while (table[slot] >= 0) {
+      if (elems[table[slot]].compare(oct) == 0) {
+        return 0;
       }
+      slot = (slot + 1) & mask;
     }
+  }
 
-    // Add the octant as the last node
-    node->next = new OctHashNode;
-    node->next->oct = *oct;
-    num_elems++;
+  // Extend the contiguous storage if required
+  if (num_elems >= max_num_elems) {
+    max_num_elems = 2 * max_num_elems;
+    TMROctant *temp = new TMROctant[max_num_elems];
+    memcpy(temp, elems, num_elems * sizeof(TMROctant));
+    delete[] elems;
+    elems = temp;
   }
 
+  // Add the octant to the end of the storage
+  elems[num_elems] = *oct;
+  table[slot] = num_elems;
+  num_elems++;
+
   return 1;
 }
 
 /*
-  Get a bucket to place the octant in.
+  Re-build the open-addressing table with a new size.
 
-  This code creates a value based on the octant location within the
-  mesh and then takes the remainder of the number of buckets.
+  The octants themselves do not move, only their indices are
+  re-inserted into the new table.
 */
-int TMROctantHash::getBucket(TMROctant *oct) {
-  // The has value
-  uint32_t val = 0;
-
-  if (use_node_index) {
-    uint32_t u = 0, v = 0, w = 0, x = 0;
-    u = oct->block;
-    v = (1 << TMR_MAX_LEVEL) + oct->x;
-    w = (1 << TMR_MAX_LEVEL) + oct->y;
-    x = (1 << TMR_MAX_LEVEL) + oct->z;
-    // y = oct->info;
-
-    // Compute the hash value
-    // val = TMRIntegerFiveTupleHash(u, v, w, x, y);
-    val = TMRIntegerFourTupleHash(u, v, w, x);
-  } else {
-    uint32_t u = 0, v = 0, w = 0, x = 0;
-    u = oct->block;
-    v = (1 << TMR_MAX_LEVEL) + oct->x;
-    w = (1 << TMR_MAX_LEVEL) + oct->y;
-    x = (1 << TMR_MAX_LEVEL) + oct->z;
-
-    // Compute the hash value
-    val = TMRIntegerFourTupleHash(u, v, w, x);
+void TMROctantHash::resizeTable(int new_size) {
+  delete[] table;
+  table_size = new_size;
+  table = new int[table_size];
+  memset(table, 0xff, table_size * sizeof(int));
+
+  const uint32_t mask = table_size - 1;
+  for (int i = 0; i < num_elems; i++) {
+    uint32_t slot = getHash(&elems[i]) & mask;
+    while (table[slot] >= 0) {
+      slot = (slot + 1) & mask;
+    }
+    table[slot] = i;
   }
+}
 
-  // Compute the bucket value
-  int bucket = val % num_buckets;
+/*
+  Compute the hash value for the octant.
+
+  This code creates a value based on the octant location within the
+  mesh. Note that the level and info are not used so that nodes and
+  elements at the same position hash to the same slot.
+*/
+uint32_t TMROctantHash::getHash(const TMROctant *oct) {
+  uint32_t u = oct->block;
+  uint32_t v = (1 << TMR_MAX_LEVEL) + oct->x;
+  uint32_t w = (1 << TMR_MAX_LEVEL) + oct->y;
+  uint32_t x = (1 << TMR_MAX_LEVEL) + oct->z;
 
-  return bucket;
+  return TMRIntegerFourTupleHash(u, v, w, x);
 }
@@ -69,22 +69,81 @@ class TMROctantArray {
 
   TMROctantArray *duplicate();
   void getArray(TMROctant **_array, int *_size);
+  size_t getMemoryUsage() { return max_size * sizeof(TMROctant); }
   void sort();
+  void sortByTag();
   TMROctant *contains(TMROctant *q, int use_nodes = 0);
+  void containsMany(int n, const TMROctant *queries, TMROctant **results,
+                    int use_nodes = 0);
+  int findDescendants(TMROctant *oct, int *start, int *end);
   void merge(TMROctantArray *list);
 
  private:
+  // Arrays shorter than this are sorted with qsort
+  static const int min_radix_sort_size = 256;
+
   int use_node_index;
   int is_sorted;
   int size, max_size;
   TMROctant *array;
 };
 
+/*
+  A compact, sorted array of octants
+
+  Each octant is stored as its block index and a 64-bit key that
+  holds the Morton code of the coordinates and the level, so that an
+  octant takes 12 bytes instead of the 24 bytes of a TMROctant. Only
+  the first max_level bits of the coordinates are kept, so the array
+  can only hold octants with a level no greater than max_level. The
+  tag and info values are kept in side arrays only when they are
+  requested and not all zero.
+
+  The keys follow the ordering of TMROctant::compare, so the array can
+  be searched directly either for an identical octant or for the
+  octant that contains a given octant or node.
+*/
+class TMROctantKeyArray {
+ public:
+  TMROctantKeyArray(TMROctantArray *list, int store_tags = 0);
+  ~TMROctantKeyArray();
+
+  // Check whether the octants in the list can be stored
+  static int canStore(TMROctantArray *list);
+
+  int getSize() { return size; }
+  size_t getMemoryUsage();
+  void getOctant(int index, TMROctant *oct);
+  int findIndex(TMROctant *oct);
+  int findEnclosingIndex(TMROctant *oct);
+  TMROctantArray *toArray();
+
+  // The maximum level of the octants that can be stored
+  static const int max_level = 19;
+
+ private:
+  // Compute the key for the coordinates and level of an octant
+  static uint64_t getKey(const TMROctant *oct);
+
+  // Find the last entry that is less than or equal to the key
+  int findLast(int32_t block, uint64_t key);
+
+  int size;
+  int32_t *blocks;
+  uint64_t *keys;
+
+  // The optional tag and info values
+  int32_t *tags;
+  int16_t *infos;
+};
+
 /*
   Create a queue of octants
 
   This class defines a queue of octants that are used for the balance
-  and coarsen operations.
+  and coarsen operations. The octants are stored in a contiguous,
+  growable circular buffer that is handed over to the array object
+  by toArray() without a copy whenever possible.
 */
 class TMROctantQueue {
  public:
@@ -97,17 +156,60 @@ class TMROctantQueue {
   TMROctantArray *toArray();
 
  private:
-  // Class that defines an element within the queue
-  class OctQueueNode {
-   public:
-    OctQueueNode() { next = NULL; }
-    TMROctant oct;
-    OctQueueNode *next;
-  };
-
-  // Keep track of the number of elements in the queue
-  int num_elems;
-  OctQueueNode *root, *tip;
+  // The minimum capacity of the queue (must be a power of two)
+  static const int min_queue_size = 1 << 8;
+
+  // The circular buffer of octants: The entries start at the index
+  // start and wrap around the end of the buffer
+  int start, num_elems, max_num_elems;
+  TMROctant *elems;
+};
+
+/*
+  Exchange octants between processors
+
+  The octants in the interval [ptr[i], ptr[i+1]) of the input list are
+  sent to processor i, and the octants from processor i are received
+  into the interval [recv_ptr[i], recv_ptr[i+1]) of the receive array.
+  All the receives and sends are posted by begin(). The received
+  octants can then be processed in the order in which they arrive by
+  calling waitAny(), so that local work overlaps the communication.
+  The call to end() completes the exchange and hands over the receive
+  array. The input list must not be modified until end() is called.
+  Several exchanges may be active at once if they use different tags.
+*/
+class TMROctantExchange {
+ public:
+  TMROctantExchange(MPI_Comm _comm, TMROctantArray *list, const int *_ptr,
+                    const int *_recv_ptr, int _use_node_index = 0,
+                    int _tag = 0);
+  ~TMROctantExchange();
+
+  void begin();
+  int waitAny(TMROctant **array, int *size);
+  TMROctantArray *end();
+
+ private:
+  // The communicator, message tag and the octants to send
+  MPI_Comm comm;
+  int mpi_rank, mpi_size, tag;
+  int use_node_index;
+  TMROctant *send_array;
+
+  // The send/recv intervals for each processor
+  int *ptr, *recv_ptr;
+
+  // The receive array for the octants
+  int recv_size;
+  TMROctant *recv_array;
+
+  // The processor-local octants have not been returned by waitAny()
+  int local_pending;
+
+  // The requests for the sends and receives
+  int nsends, nrecvs;
+  int *recv_ranks;
+  MPI_Request *send_requests, *recv_requests;
 };
 
 /*
@@ -116,38 +218,43 @@ class TMROctantQueue {
   This object enables the creation of a unique set of octants such
   that no two have the same position/level combination. This hash
   table can then be made into an array of unique elements or nodes.
+
+  The octants are stored contiguously in the order in which they are
+  added. A separate open-addressing (linear probing) table of indices
+  into this storage is used for the look up so that no per-entry
+  allocation is required.
 */
 class TMROctantHash {
  public:
-  TMROctantHash(int _use_node_index = 0);
+  TMROctantHash(int _use_node_index = 0, int size_hint = 0);
   ~TMROctantHash();
 
   TMROctantArray *toArray();
   int addOctant(TMROctant *oct);
+  int length() { return num_elems; }
+  size_t getMemoryUsage() {
+    return table_size * sizeof(int) + max_num_elems * sizeof(TMROctant);
+  }
 
  private:
-  // The minimum bucket size
-  static const int min_num_buckets = (1 << 12) - 1;
-
-  class OctHashNode {
-   public:
-    OctHashNode() { next = NULL; }
-    TMROctant oct;
-    OctHashNode *next;
-  };
+  // The minimum table size (must be a power of two)
+  static const int min_table_size = 1 << 12;
 
   // Keep track of whether to use a node-based search
   int use_node_index;
 
-  // Keep track of the bucket size
-  int num_buckets;
-  OctHashNode **hash_buckets;
+  // The open-addressing table of indices into the octants array.
+  // Empty slots are marked with a negative index.
+  int table_size;
+  int *table;
 
-  // Keep track of the number of elements
-  int num_elems;
+  // The contiguous storage for the unique octants
+  int num_elems, max_num_elems;
+  TMROctant *elems;
 
-  // Get the buckets to place the octant in
-  int getBucket(TMROctant *oct);
+  // Get the initial slot for the octant and resize the table
+  uint32_t getHash(const TMROctant *oct);
+  void resizeTable(int new_size);
 };
 
 #endif  // TMR_OCTANT_H
@@ -0,0 +1,211 @@
+/*
+  This file is part of the package TMR for adaptive mesh refinement.
+
+  Copyright (C) 2015 Georgia Tech Research Corporation.
+  Additional copyright (C) 2015 Graeme Kennedy.
+  All rights reserved.
+
+  TMR is licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this software except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include "TMRPointCache.h"
+
+#include <string.h>
+
+#include "TMRHashFunction.h"
+
+/*
+  Fold the bits of a double into a 32-bit unsigned integer
+*/
+static inline uint32_t TMRFoldDoubleBits(double value) {
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(uint64_t));
+  return (uint32_t)(bits ^ (bits >> 32));
+}
+
+/*
+  The default maximum number of points stored in the cache
+*/
+static const int TMR_POINT_CACHE_DEFAULT_MAX_SIZE = 1 << 21;
+
+/*
+  Create an empty point cache
+*/
+TMRPointCache::TMRPointCache() {
+  table_size = min_table_size;
+  table = new int[table_size];
+  memset(table, 0xff, table_size * sizeof(int));
+
+  num_points = 0;
+  max_cache_size = TMR_POINT_CACHE_DEFAULT_MAX_SIZE;
+  max_num_points = table_size / 2;
+  indices = new int[max_num_points];
+  params = new double[3 * max_num_points];
+  pts = new TMRPoint[max_num_points];
+}
+
+/*
+  Free the point cache
+*/
+TMRPointCache::~TMRPointCache() {
+  delete[] table;
+  delete[] indices;
+  delete[] params;
+  delete[] pts;
+}
+
+/*
+  Remove all the points from the cache
+*/
+void TMRPointCache::clear() {
+  memset(table, 0xff, table_size * sizeof(int));
+  num_points = 0;
+}
+
+/*
+  Set the maximum number of points stored in the cache
+
+  When the cache is full, all of the entries are discarded before the
+  next point is added, so the memory used by the cache remains bounded.
+*/
+void TMRPointCache::setMaxSize(int max_size) {
+  max_cache_size = (max_size > 1 ? max_size : 1);
+  if (num_points >= max_cache_size) {
+    clear();
+  }
+}
+
+/*
+  Retrieve a point from the cache
+
+  input:
+  index:    the index of the geometric entity
+  u, v, w:  the parametric location of the point
+
+  output:
+  X:        the physical location of the point (if found)
+
+  returns:
+  1 if the point is found, 0 otherwise
+*/
+int TMRPointCache::getPoint(int index, double u, double v, double w,
+                            TMRPoint *X) {
+  int slot = findSlot(index, u, v, w);
+  if (table[slot] >= 0) {
+    *X = pts[table[slot]];
+    return 1;
+  }
+  return 0;
+}
+
+/*
+  Add a point to the cache
+
+  input:
+  index:    the index of the geometric entity
+  u, v, w:  the parametric location of the point
+  X:        the physical location of the point
+*/
+void TMRPointCache::addPoint(int index, double u, double v, double w,
+                             const TMRPoint *X) {
+  int slot = findSlot(index, u, v, w);
+  if (table[slot] >= 0) {
+    pts[table[slot]] = *X;
+    return;
+  }
+
+  // Discard the existing entries once the cache is full
+  if (num_points >= max_cache_size) {
+    clear();
+    slot = findSlot(index, u, v, w);
+  }
+
+  // Extend the storage if needed
+  if (num_points >= max_num_points) {
+    max_num_points *= 2;
+    int *new_indices = new int[max_num_points];
+    double *new_params = new double[3 * max_num_points];
+    TMRPoint *new_pts = new TMRPoint[max_num_points];
+    memcpy(new_indices, indices, num_points * sizeof(int));
+    memcpy(new_params, params, 3 * num_points * sizeof(double));
+    for (int i = 0; i < num_points; i++) {
+      new_pts[i] = pts[i];
+    }
+    delete[] indices;
+    delete[] params;
+    delete[] pts;
+    indices = new_indices;
+    params = new_params;
+    pts = new_pts;
+  }
+
+  indices[num_points] = index;
+  params[3 * num_points] = u;
+  params[3 * num_points + 1] = v;
+  params[3 * num_points + 2] = w;
+  pts[num_points] = *X;
+  table[slot] = num_points;
+  num_points++;
+
+  // Keep the load factor of the table below one half
+  if (2 * num_points > table_size) {
+    resizeTable(2 * table_size);
+  }
+}
+
+/*
+  Find the slot in the table that either contains the key, or the
+  empty slot where the key would be inserted
+*/
+int TMRPointCache::findSlot(int index, double u, double v, double w) {
+  const uint32_t mask = table_size - 1;
+  uint32_t slot = getHash(index, u, v, w) & mask;
+  while (table[slot] >= 0) {
+    int k = table[slot];
+    if (indices[k] == index && params[3 * k] == u && params[3 * k + 1] == v &&
+        params[3 * k + 2] == w) {
+      break;
+    }
+    slot = (slot + 1) & mask;
+  }
+  return slot;
+}
+
+/*
+  Resize the table and re-insert the existing points
+*/
+void TMRPointCache::resizeTable(int new_size) {
+  delete[] table;
+  table_size = new_size;
+  table = new int[table_size];
+  memset(table, 0xff, table_size * sizeof(int));
+
+  const uint32_t mask = table_size - 1;
+  for (int i = 0; i < num_points; i++) {
+    const double *p = &params[3 * i];
+    uint32_t slot = getHash(indices[i], p[0], p[1], p[2]) & mask;
+    while (table[slot] >= 0) {
+      slot = (slot + 1) & mask;
+    }
+    table[slot] = i;
+  }
+}
+
+/*
+  Compute the hash value for the key based on the bits of the
+  parametric location
+*/
+uint32_t TMRPointCache::getHash(int index, double u, double v, double w) {
+  return TMRIntegerFourTupleHash(index, TMRFoldDoubleBits(u),
+                                 TMRFoldDoubleBits(v), TMRFoldDoubleBits(w));
+}
@@ -0,0 +1,82 @@
+/*
+  This file is part of the package TMR for adaptive mesh refinement.
+
+  Copyright (C) 2015 Georgia Tech Research Corporation.
+  Additional copyright (C) 2015 Graeme Kennedy.
+  All rights reserved.
+
+  TMR is licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this software except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef TMR_POINT_CACHE_H
+#define TMR_POINT_CACHE_H
+
+#include "TMRBase.h"
+
+/*
+  A cache of the physical locations of points within the geometry
+
+  Evaluating points through a CAD kernel is expensive. This object
+  stores the result of each evaluation keyed by the index of the
+  geometric entity (block or face) and the parametric location of the
+  point. Nodes that are shared between meshes created from the same
+  forest, through duplicate(), coarsen() or refine(), are evaluated
+  from the same parametric locations and can therefore be retrieved
+  from the cache, rather than re-evaluated by the geometry.
+
+  The entries are stored contiguously in the order in which they are
+  added, with an open-addressing (linear probing) table of indices
+  into this storage used for the look up. The number of entries is
+  limited by setMaxSize(): once the limit is reached, the cache is
+  cleared before the next point is added.
+*/
+class TMRPointCache : public TMREntity {
+ public:
+  TMRPointCache();
+  ~TMRPointCache();
+
+  int getPoint(int index, double u, double v, double w, TMRPoint *X);
+  void addPoint(int index, double u, double v, double w, const TMRPoint *X);
+  int getNumPoints() { return num_points; }
+  void setMaxSize(int max_size);
+  int getMaxSize() { return max_cache_size; }
+  size_t getMemoryUsage() {
+    return table_size * sizeof(int) +
+           max_num_points *
+               (sizeof(int) + 3 * sizeof(double) + sizeof(TMRPoint));
+  }
+  void clear();
+
+ private:
+  // The minimum table size (must be a power of two)
+  static const int min_table_size = 1 << 12;
+
+  // The open-addressing table of indices into the point storage.
+  // Empty slots are marked with a negative index.
+  int table_size;
+  int *table;
+
+  // The contiguous storage for the keys and the points
+  int num_points, max_num_points;
+  int max_cache_size;
+  int *indices;
+  double *params;
+  TMRPoint *pts;
+
+  // Get the initial slot for the key and resize the table
+  uint32_t getHash(int index, double u, double v, double w);
+  int findSlot(int index, double u, double v, double w);
+  void resizeTable(int new_size);
+};
+
+#endif  // TMR_POINT_CACHE_H
@@ -23,8 +23,38 @@
 #include <stdlib.h>
 
 #include "TMRInterpolation.h"
+#include "TMRTrace.h"
+#include "TMR_VTKTools.h"
 #include "tmrlapack.h"
 
+/*
+  The interpolation between forests is computed for blocks of nodes.
+  The weights for a block are computed in parallel and then added to
+  the interpolation in the order of the nodes, so the result does not
+  depend on the number of threads. Each thread computes a few chunks
+  of nodes in a block, which bounds the storage for the weights.
+*/
+static const int TMR_INTERP_CHUNK_SIZE = 8;
+static const int TMR_INTERP_CHUNKS_PER_THREAD = 4;
+
+/*
+  Interpolation weights with a magnitude below this tolerance are
+  dropped. Fine nodes that coincide with the knots of a coarse
+  element give exact (or round-off) zero weights for the other coarse
+  nodes. Removing them keeps the interpolation, and the sparsity of
+  the Galerkin coarse operators formed from it, as small as possible.
+*/
+static const double TMR_INTERP_WEIGHT_TOL = 1e-14;
+
+/*
+  The header of a file written by writeQuadrantsToFile(): a magic number
+  (the characters "TMRQ"), the version of the format, the number of
+  faces and the total number of quadrants
+*/
+static const int TMR_QUADRANT_FILE_MAGIC = 0x51524d54;
+static const int TMR_QUADRANT_FILE_VERSION = 1;
+static const int TMR_QUADRANT_FILE_HEADER_SIZE = 4;
+
 /*
   Face to edge node connectivity
 */
@@ -37,15 +67,6 @@ static int compare_integers(const void *a, const void *b) {
   return (*(int *)a - *(int *)b);
 }
 
-/*
-  Compare tags for sorting
-*/
-static int compare_quadrant_tags(const void *a, const void *b) {
-  const TMRQuadrant *A = static_cast<const TMRQuadrant *>(a);
-  const TMRQuadrant *B = static_cast<const TMRQuadrant *>(b);
-  return A->tag - B->tag;
-}
-
 /*
   Convert from the integer coordinate system to a physical coordinate
   with the off-by-one check.
@@ -79,9 +100,37 @@ TMRQuadForest::TMRQuadForest(MPI_Comm _comm, int _mesh_order,
   // Set default mesh data
   mesh_order = 2;
   interp_knots = NULL;
+  interp_wts = NULL;
 
   // Set the topology object to NULL
   topo = NULL;
+  node_cache = NULL;
+
+  // No interpolation is stored initially
+  use_interp_cache = 0;
+
+  // Create all of the nodes in each call to createNodes() by default
+  use_incremental_nodes = 0;
+  prev_quadrants = NULL;
+  prev_nodes = NULL;
+  prev_conn = NULL;
+
+  // No transient memory has been allocated
+  memory_phase = TMR_NODES_PHASE;
+  transient_bytes = 0;
+  peak_bytes[TMR_NODES_PHASE] = 0;
+  peak_bytes[TMR_INTERP_PHASE] = 0;
+  interp_cache = NULL;
+  interp_cache_id = -1;
+  interp_cache_stamp = -1;
+  node_stamp = -1;
+  name_index = NULL;
+
+  // Do not repartition automatically by default
+  repartition_tol = 0.0;
+  last_imbalance = 1.0;
+  last_bytes_moved = 0.0;
+  last_repartitioned = 0;
 
   // Null out the face data
   fdata = NULL;
@@ -104,6 +153,8 @@ TMRQuadForest::TMRQuadForest(MPI_Comm _comm, int _mesh_order,
   dep_ptr = NULL;
   dep_conn = NULL;
   dep_weights = NULL;
+  dep_tmpl = NULL;
+  dep_tmpl_weights = NULL;
 
   // Set the mesh order
   setMeshOrder(_mesh_order, _interp_type);
@@ -117,6 +168,12 @@ TMRQuadForest::~TMRQuadForest() {
   if (topo) {
     topo->decref();
   }
+  if (node_cache) {
+    node_cache->decref();
+  }
+  if (interp_cache) {
+    interp_cache->decref();
+  }
 
   freeData();
 }
@@ -130,6 +187,12 @@ void TMRQuadForest::freeData() {
   }
   fdata = NULL;
 
+  // Free the name index
+  if (name_index) {
+    name_index->decref();
+  }
+  name_index = NULL;
+
   // Free the quadrants/adjacency
   if (owners) {
     delete[] owners;
@@ -143,6 +206,7 @@ void TMRQuadForest::freeData() {
   if (X) {
     delete[] X;
   }
+  freePrevNodes();
 
   if (conn) {
     delete[] conn;
@@ -162,6 +226,12 @@ void TMRQuadForest::freeData() {
   if (dep_weights) {
     delete[] dep_weights;
   }
+  if (dep_tmpl) {
+    delete[] dep_tmpl;
+  }
+  if (dep_tmpl_weights) {
+    delete[] dep_tmpl_weights;
+  }
 
   // Null the quadrant owners/quadrant list
   owners = NULL;
@@ -181,6 +251,8 @@ void TMRQuadForest::freeData() {
   dep_ptr = NULL;
   dep_conn = NULL;
   dep_weights = NULL;
+  dep_tmpl = NULL;
+  dep_tmpl_weights = NULL;
 }
 
 /*
@@ -226,6 +298,12 @@ void TMRQuadForest::freeMeshData(int free_quads, int free_owners) {
   if (dep_weights) {
     delete[] dep_weights;
   }
+  if (dep_tmpl) {
+    delete[] dep_tmpl;
+  }
+  if (dep_tmpl_weights) {
+    delete[] dep_tmpl_weights;
+  }
 
   // Reset the data
   adjacent = NULL;
@@ -238,12 +316,26 @@ void TMRQuadForest::freeMeshData(int free_quads, int free_owners) {
   dep_ptr = NULL;
   dep_conn = NULL;
   dep_weights = NULL;
+  dep_tmpl = NULL;
+  dep_tmpl_weights = NULL;
 
   // Set the data to NULL
   num_local_nodes = 0;
   num_owned_nodes = 0;
   num_dep_nodes = 0;
   ext_pre_offset = 0;
+
+  // The stored interpolation refers to the old node numbers
+  if (interp_cache) {
+    interp_cache->decref();
+  }
+  interp_cache = NULL;
+
+  // The name index refers to the old elements and nodes
+  if (name_index) {
+    name_index->decref();
+  }
+  name_index = NULL;
 }
 
 /*
@@ -262,6 +354,21 @@ void TMRQuadForest::copyData(TMRQuadForest *copy) {
   if (copy->topo) {
     copy->topo->incref();
   }
+
+  // Share the cache of node locations
+  if (node_cache) {
+    node_cache->incref();
+  }
+  if (copy->node_cache) {
+    copy->node_cache->decref();
+  }
+  copy->node_cache = node_cache;
+
+  // Create the nodes in the same manner
+  copy->use_incremental_nodes = use_incremental_nodes;
+
+  // Use the same repartitioning policy
+  copy->repartition_tol = repartition_tol;
 }
 
 /*
@@ -279,15 +386,31 @@ void TMRQuadForest::setTopology(TMRTopology *_topo) {
     }
     topo = _topo;
 
-    // Compute the topology and set it internally
-    int _num_faces, _num_edges, _num_nodes;
-    const int *_face_conn, *_face_edge_conn;
-    topo->getConnectivity(&_num_nodes, &_num_edges, &_num_faces, &_face_conn,
-                          &_face_edge_conn);
-
-    // Set the full connectivity
-    setFullConnectivity(_num_nodes, _num_edges, _num_faces, _face_conn,
-                        _face_edge_conn);
+    // Create a new cache for the node locations
+    if (node_cache) {
+      node_cache->decref();
+    }
+    node_cache = new TMRPointCache();
+    node_cache->incref();
+
+    // Re-use the face connectivity if it has already been computed
+    // by another forest created from the same topology
+    TMREntity *conn = topo->getQuadConnCache();
+    if (conn) {
+      fdata = static_cast<TMRFaceConn *>(conn);
+      fdata->incref();
+    } else {
+      // Compute the topology and set it internally
+      int _num_faces, _num_edges, _num_nodes;
+      const int *_face_conn, *_face_edge_conn;
+      topo->getConnectivity(&_num_nodes, &_num_edges, &_num_faces,
+                            &_face_conn, &_face_edge_conn);
+
+      // Set the full connectivity and cache it in the topology
+      setFullConnectivity(_num_nodes, _num_edges, _num_faces, _face_conn,
+                          _face_edge_conn);
+      topo->setQuadConnCache(fdata);
+    }
   }
 }
 
@@ -298,6 +421,20 @@ void TMRQuadForest::setTopology(TMRTopology *_topo) {
 */
 TMRTopology *TMRQuadForest::getTopology() { return topo; }
 
+/*
+  Clear the cache of node locations
+
+  The node locations evaluated from the topology are cached so that
+  nodes that also exist in a previous mesh, created from this forest or
+  a duplicated, coarsened or refined version of it, are not evaluated
+  a second time. This frees the memory associated with these points.
+*/
+void TMRQuadForest::clearNodeLocationCache() {
+  if (node_cache) {
+    node_cache->clear();
+  }
+}
+
 /*
   Set the connectivity of the faces
 
@@ -340,8 +477,8 @@ void TMRQuadForest::setConnectivity(int _num_nodes, const int *_face_conn,
   computeEdgesFromNodes();
   computeEdgesToFaces();
 
-  // Compute the face owners based on the node, edge and face data
-  computeFaceOwners();
+  // Compute the transformations between adjacent faces
+  computeFaceTransforms();
 }
 
 /*
@@ -377,8 +514,8 @@ void TMRQuadForest::setFullConnectivity(int _num_nodes, int _num_edges,
   // Compute the edge to face information
   computeEdgesToFaces();
 
-  // Compute the face owners based on the node, edge and face data
-  computeFaceOwners();
+  // Compute the transformations between adjacent faces
+  computeFaceTransforms();
 }
 
 /*
@@ -475,7 +612,12 @@ void TMRQuadForest::computeEdgesToFaces() {
   }
   fdata->edge_face_ptr[0] = 0;
 
-  // Loop over all edges and determine their relative orientation
+  // Loop over all edges and determine their relative orientation.
+  // Each edge only modifies its own entries, so the edges are
+  // independent.
+#ifdef TMR_HAS_OPENMP
+#pragma omp parallel for
+#endif  // TMR_HAS_OPENMP
   for (int edge = 0; edge < num_edges; edge++) {
     int face_owner = num_faces;
     int owner_index = 0;
@@ -528,120 +670,146 @@ void TMRQuadForest::computeEdgesToFaces() {
 }
 
 /*
-  Compute the edges from the nodes
+  Compute the transformations from each edge and corner of each face
+  to the coordinates of the face that owns the entity
+
+  The transformations are affine maps with integer coefficients that
+  are evaluated in transformNode().
 */
-void TMRQuadForest::computeEdgesFromNodes() {
+void TMRQuadForest::computeFaceTransforms() {
   const int num_faces = fdata->num_faces;
+  const int ntrans = TMRFaceConn::NUM_FACE_TRANSFORMS;
 
-  // Now establish a unique ordering of the edges along each face
-  fdata->face_edge_conn = new int[4 * num_faces];
-  for (int i = 0; i < 4 * num_faces; i++) {
-    fdata->face_edge_conn[i] = -1;
-  }
+  fdata->face_transforms = new TMRFaceConn::Transform[ntrans * num_faces];
+  memset(fdata->face_transforms, 0,
+         ntrans * num_faces * sizeof(TMRFaceConn::Transform));
 
-  // Keep track of the edge numbers
-  int edge = 0;
-  for (int i = 0; i < num_faces; i++) {
-    // Loop over each edge on this face
-    for (int j = 0; j < 4; j++) {
-      if (fdata->face_edge_conn[4 * i + j] < 0) {
-        int n1 = fdata->face_conn[4 * i + face_to_edge_nodes[j][0]];
-        int n2 = fdata->face_conn[4 * i + face_to_edge_nodes[j][1]];
-
-        // Keep track of the number of edges found
-        const int max_nedges = 20;
-        int edge_index[max_nedges];
-        int nedges = 1;
-        edge_index[0] = 4 * i + j;
-
-        // Set the edge number - if any is found
-        int edge_num = -1;
-
-        // Scan through the faces that share the same node and check
-        // if any of the edges are also shared
-        for (int ip = fdata->node_face_ptr[n1];
-             ip < fdata->node_face_ptr[n1 + 1]; ip++) {
-          int ii = fdata->node_face_conn[ip] / 4;
-
-          // Loop over each edge in the new face
-          for (int jj = 0; jj < 4; jj++) {
-            int nn1 = fdata->face_conn[4 * ii + face_to_edge_nodes[jj][0]];
-            int nn2 = fdata->face_conn[4 * ii + face_to_edge_nodes[jj][1]];
-
-            // Check if the face matches
-            if ((n1 == nn1 && n2 == nn2) || (n1 == nn2 && n2 == nn1)) {
-              if (fdata->face_edge_conn[4 * ii + jj] >= 0) {
-                // If this edge has been ordered, copy over the edge
-                // number
-                edge_num = fdata->face_edge_conn[4 * ii + jj];
-              } else if (nedges < max_nedges) {
-                // This edge has not yet been ordered, add it to the
-                // unordered list if there is still room if not, we
-                // will detect and order it during a future iteration
-                edge_index[nedges] = 4 * ii + jj;
-                nedges++;
-              }
-            }
-          }
-        }
+  for (int face = 0; face < num_faces; face++) {
+    TMRFaceConn::Transform *t = &fdata->face_transforms[ntrans * face];
 
-        // If this edge does not have an edge number, assign
-        // a new one to the list
-        if (edge_num < 0) {
-          edge_num = edge;
-          edge++;
-        }
+    // Compute the transformations for the edges
+    for (int edge_index = 0; edge_index < 4; edge_index++, t++) {
+      int edge = fdata->face_edge_conn[4 * face + edge_index];
+      t->adj = -1;
+      if (face != fdata->getEdgeOwner(edge)) {
+        int ptr = fdata->edge_face_ptr[edge];
+        int adj = fdata->edge_face_conn[ptr] / 4;
+        int adj_index = fdata->edge_face_conn[ptr] % 4;
 
-        // Set the edge numbers for all the edges that we found
-        for (int ii = 0; ii < nedges; ii++) {
-          fdata->face_edge_conn[edge_index[ii]] = edge_num;
-        }
+        // Determine the relative orientation of the edges from the
+        // first and second node numbers along each edge
+        int n1 =
+            fdata->face_conn[4 * face + face_to_edge_nodes[edge_index][0]];
+        int n2 =
+            fdata->face_conn[4 * face + face_to_edge_nodes[edge_index][1]];
+        int nn1 = fdata->face_conn[4 * adj + face_to_edge_nodes[adj_index][0]];
+        int nn2 = fdata->face_conn[4 * adj + face_to_edge_nodes[adj_index][1]];
+        int reverse = (n1 == nn2 && n2 == nn1);
+        t->adj = adj;
+        t->reversed = reverse;
+
+        // Map the direction along the source edge to the direction
+        // along the owner edge and fix the remaining coordinate
+        int s = (edge_index < 2 ? 1 : 0);
+        int d = (adj_index < 2 ? 1 : 0);
+        t->A[2 * d + s] = (reverse ? -1 : 1);
+        t->b[d] = (reverse ? 1 : 0);
+        t->b[1 - d] = adj_index % 2;
       }
     }
-  }
 
-  // Set the total number of edges
-  fdata->num_edges = edge;
+    // Compute the transformations for the corners
+    for (int corner = 0; corner < 4; corner++, t++) {
+      int node = fdata->face_conn[4 * face + corner];
+      t->adj = -1;
+      if (face != fdata->getNodeOwner(node)) {
+        int ptr = fdata->node_face_ptr[node];
+        int adj_index = fdata->node_face_conn[ptr] % 4;
+        t->adj = fdata->node_face_conn[ptr] / 4;
+        t->b[0] = adj_index % 2;
+        t->b[1] = adj_index / 2;
+      }
+    }
+  }
 }
 
 /*
-  Compute the face index that owns the edges/nodes
+  Compute the edges from the nodes
+
+  Each face edge is placed in a bucket associated with its lowest node
+  number, so that matching edges are found by scanning the short list
+  of edges within a single bucket. The edges are numbered in the order
+  in which they first appear in the face connectivity.
 */
-void TMRQuadForest::computeFaceOwners() {
+void TMRQuadForest::computeEdgesFromNodes() {
   const int num_faces = fdata->num_faces;
-  const int num_edges = fdata->num_edges;
   const int num_nodes = fdata->num_nodes;
+  const int *face_conn = fdata->face_conn;
 
-  // Allocate the edge/node ownership data
-  fdata->edge_face_owners = new int[num_edges];
-  fdata->node_face_owners = new int[num_nodes];
+  // Count up the number of face edges in each bucket
+  int *ptr = new int[num_nodes + 1];
+  memset(ptr, 0, (num_nodes + 1) * sizeof(int));
+  for (int i = 0; i < num_faces; i++) {
+    for (int j = 0; j < 4; j++) {
+      int n1 = face_conn[4 * i + face_to_edge_nodes[j][0]];
+      int n2 = face_conn[4 * i + face_to_edge_nodes[j][1]];
+      ptr[(n1 < n2 ? n1 : n2) + 1]++;
+    }
+  }
+  for (int i = 0; i < num_nodes; i++) {
+    ptr[i + 1] += ptr[i];
+  }
 
-  // The owner is chosen as the connecting face with the lowest face
-  // number
-  for (int edge = 0; edge < num_edges; edge++) {
-    fdata->edge_face_owners[edge] = num_faces;
+  // Add the face edge index and the other edge node to the buckets.
+  // The entries in each bucket are sorted by the face edge index.
+  int *bucket = new int[2 * 4 * num_faces];
+  for (int i = 0; i < num_faces; i++) {
+    for (int j = 0; j < 4; j++) {
+      int n1 = face_conn[4 * i + face_to_edge_nodes[j][0]];
+      int n2 = face_conn[4 * i + face_to_edge_nodes[j][1]];
+      int k = (n1 < n2 ? ptr[n1]++ : ptr[n2]++);
+      bucket[2 * k] = 4 * i + j;
+      bucket[2 * k + 1] = (n1 < n2 ? n2 : n1);
+    }
+  }
+  for (int i = num_nodes; i >= 1; i--) {
+    ptr[i] = ptr[i - 1];
+  }
+  ptr[0] = 0;
 
-    int ipend = fdata->edge_face_ptr[edge + 1];
-    for (int ip = fdata->edge_face_ptr[edge]; ip < ipend; ip++) {
-      int face = fdata->edge_face_conn[ip] / 4;
-      if (face < fdata->edge_face_owners[edge]) {
-        fdata->edge_face_owners[edge] = face;
+  // Find the first face edge that matches each face edge
+  int *face_edge_conn = new int[4 * num_faces];
+#ifdef TMR_HAS_OPENMP
+#pragma omp parallel for
+#endif  // TMR_HAS_OPENMP
+  for (int node = 0; node < num_nodes; node++) {
+    for (int ip = ptr[node]; ip < ptr[node + 1]; ip++) {
+      int jp = ptr[node];
+      while (bucket[2 * jp + 1] != bucket[2 * ip + 1]) {
+        jp++;
       }
+      face_edge_conn[bucket[2 * ip]] = bucket[2 * jp];
     }
   }
 
-  // Find the node owners
-  for (int node = 0; node < num_nodes; node++) {
-    fdata->node_face_owners[node] = num_faces;
+  delete[] ptr;
+  delete[] bucket;
 
-    int ipend = fdata->node_face_ptr[node + 1];
-    for (int ip = fdata->node_face_ptr[node]; ip < ipend; ip++) {
-      int face = fdata->node_face_conn[ip] / 4;
-      if (face < fdata->node_face_owners[node]) {
-        fdata->node_face_owners[node] = face;
-      }
+  // Number the edges in the order they first appear. The first
+  // matching edge always has a lower index and is numbered first.
+  int edge = 0;
+  for (int i = 0; i < 4 * num_faces; i++) {
+    if (face_edge_conn[i] == i) {
+      face_edge_conn[i] = edge;
+      edge++;
+    } else {
+      face_edge_conn[i] = face_edge_conn[face_edge_conn[i]];
     }
   }
+
+  // Set the edge connectivity and the total number of edges
+  fdata->face_edge_conn = face_edge_conn;
+  fdata->num_edges = edge;
 }
 
 /*
@@ -652,7 +820,6 @@ void TMRQuadForest::writeToVTK(const char *filename) {
   const int num_faces = fdata->num_faces;
   const int num_nodes = fdata->num_nodes;
   const int *face_conn = fdata->face_conn;
-  const int *node_face_owners = fdata->node_face_owners;
 
   if (mpi_rank == 0 && topo) {
     FILE *fp = fopen(filename, "w");
@@ -665,7 +832,7 @@ void TMRQuadForest::writeToVTK(const char *filename) {
       fprintf(fp, "POINTS %d float\n", num_nodes);
       for (int k = 0; k < num_nodes; k++) {
         // Get the owner of this node
-        int face = node_face_owners[k];
+        int face = fdata->getNodeOwner(k);
 
         // Check where the node is located
         int corner = 0;
@@ -730,7 +897,6 @@ void TMRQuadForest::writeToTecplot(const char *filename) {
   const int num_faces = fdata->num_faces;
   const int num_nodes = fdata->num_nodes;
   const int *face_conn = fdata->face_conn;
-  const int *node_face_owners = fdata->node_face_owners;
 
   if (mpi_rank == 0 && topo) {
     FILE *fp = fopen(filename, "w");
@@ -746,7 +912,7 @@ void TMRQuadForest::writeToTecplot(const char *filename) {
       // Write out the points
       for (int k = 0; k < num_nodes; k++) {
         // Get the owner of this node
-        int face = node_face_owners[k];
+        int face = fdata->getNodeOwner(k);
 
         // Check where the node is located
         int corner = 0;
@@ -871,6 +1037,83 @@ void TMRQuadForest::writeForestToVTK(const char *filename) {
   }
 }
 
+/*
+  Write the entire forest to a binary VTK XML file
+
+  This is a collective call. Each processor writes its quadrants to the
+  file prefix_<rank>.vtu and the root processor writes prefix.pvtu
+  which references all of the pieces.
+
+  input:
+  prefix:    the file prefix
+  compress:  compress the data (if TMR is compiled with zlib)
+*/
+void TMRQuadForest::writeForestToVTU(const char *prefix, int compress) {
+  if (quadrants && topo) {
+    int size;
+    TMRQuadrant *quads;
+    quadrants->getArray(&quads, &size);
+
+    // Allocate space for the points, connectivity and cell data
+    TMRPoint *Xpts = new TMRPoint[4 * size];
+    int *ptr = new int[size + 1];
+    int *cell_conn = new int[4 * size];
+    int *cell_types = new int[size];
+    double *entity = new double[size];
+    double *level = new double[size];
+
+    // Set the edge length
+    const int32_t hmax = 1 << TMR_MAX_LEVEL;
+
+    ptr[0] = 0;
+    for (int k = 0; k < size; k++) {
+      const int32_t h = 1 << (TMR_MAX_LEVEL - quads[k].level);
+
+      // Get the surface object and evaluate the point
+      TMRFace *surf;
+      topo->getFace(quads[k].face, &surf);
+
+      for (int jj = 0; jj < 2; jj++) {
+        for (int ii = 0; ii < 2; ii++) {
+          double u = 1.0 * (quads[k].x + ii * h) / hmax;
+          double v = 1.0 * (quads[k].y + jj * h) / hmax;
+          surf->evalPoint(u, v, &Xpts[4 * k + ii + 2 * jj]);
+        }
+      }
+
+      // Set the connectivity in the VTK ordering
+      const int order[] = {0, 1, 3, 2};
+      for (int j = 0; j < 4; j++) {
+        cell_conn[4 * k + j] = 4 * k + order[j];
+      }
+      ptr[k + 1] = 4 * (k + 1);
+      cell_types[k] = TMR_VTK_QUAD;
+      entity[k] = 1.0 * quads[k].face;
+      level[k] = 1.0 * quads[k].level;
+    }
+
+    // Write out this processor's piece of the forest
+    const char *field_names[] = {"entity_index", "level"};
+    const double *fields[] = {entity, level};
+    char *filename = new char[strlen(prefix) + 20];
+    sprintf(filename, "%s_%d.vtu", prefix, mpi_rank);
+    TMR_WriteVTUFile(filename, 4 * size, Xpts, size, ptr, cell_conn,
+                     cell_types, 2, field_names, fields, compress);
+    delete[] filename;
+
+    if (mpi_rank == 0) {
+      TMR_WritePVTUFile(prefix, mpi_size, 2, field_names);
+    }
+
+    delete[] Xpts;
+    delete[] ptr;
+    delete[] cell_conn;
+    delete[] cell_types;
+    delete[] entity;
+    delete[] level;
+  }
+}
+
 /*
   Write the entire forest to a VTK file
 */
@@ -950,6 +1193,7 @@ void TMRQuadForest::setMeshOrder(int _mesh_order,
   // Don't free the octants/owner information if it exists,
   // but free the connectivity and node data
   freeMeshData(0, 0);
+  freePrevNodes();
 
   // Free the interpolation knots
   if (interp_knots) {
@@ -983,6 +1227,11 @@ void TMRQuadForest::setMeshOrder(int _mesh_order,
       interp_knots[i] = -1.0 + 2.0 * i / (mesh_order - 1);
     }
   }
+
+  // Store the barycentric weights for the Lagrange shape functions
+  // after the knots
+  interp_wts = &interp_knots[mesh_order];
+  lagrange_barycentric_weights(mesh_order, interp_knots, interp_wts);
 }
 
 /*
@@ -1074,8 +1323,8 @@ void TMRQuadForest::evalInterp(const double pt[], double N[]) {
     bernstein_shape_functions(mesh_order, pt[1], Nv);
   } else {
     // Evaluate the lagrange shape functions
-    lagrange_shape_functions(mesh_order, pt[0], interp_knots, Nu);
-    lagrange_shape_functions(mesh_order, pt[1], interp_knots, Nv);
+    lagrange_shape_functions(mesh_order, pt[0], interp_knots, interp_wts, Nu);
+    lagrange_shape_functions(mesh_order, pt[1], interp_knots, interp_wts, Nv);
   }
 
   for (int j = 0; j < mesh_order; j++) {
@@ -1100,8 +1349,10 @@ void TMRQuadForest::evalInterp(const double pt[], double N[], double N1[],
     bernstein_shape_func_derivative(mesh_order, pt[1], Nv, Nvd);
   } else {
     // Evaluate the shape functions
-    lagrange_shape_func_derivative(mesh_order, pt[0], interp_knots, Nu, Nud);
-    lagrange_shape_func_derivative(mesh_order, pt[1], interp_knots, Nv, Nvd);
+    lagrange_shape_func_derivative(mesh_order, pt[0], interp_knots, interp_wts,
+                                   Nu, Nud);
+    lagrange_shape_func_derivative(mesh_order, pt[1], interp_knots, interp_wts,
+                                   Nv, Nvd);
   }
 
   for (int j = 0; j < mesh_order; j++) {
@@ -1131,10 +1382,10 @@ void TMRQuadForest::evalInterp(const double pt[], double N[], double N1[],
     bernstein_shape_func_second_derivative(mesh_order, pt[0], Nv, Nvd, Nvdd);
   } else {
     // Evaluate the shape functions
-    lagrange_shape_func_second_derivative(mesh_order, pt[0], interp_knots, Nu,
-                                          Nud, Nudd);
-    lagrange_shape_func_second_derivative(mesh_order, pt[1], interp_knots, Nv,
-                                          Nvd, Nvdd);
+    lagrange_shape_func_second_derivative(mesh_order, pt[0], interp_knots,
+                                          interp_wts, Nu, Nud, Nudd);
+    lagrange_shape_func_second_derivative(mesh_order, pt[1], interp_knots,
+                                          interp_wts, Nv, Nvd, Nvdd);
   }
 
   for (int j = 0; j < mesh_order; j++) {
@@ -1235,6 +1486,11 @@ void TMRQuadForest::getInverseConnectivity(const int **_node_face_conn,
 
 /*
   Create a forest with the specified refinement level
+
+  The uniform quadrants are ordered by face and then along the Morton
+  curve within each face. Each processor computes its own contiguous
+  range within this global order and generates only the quadrants in
+  that range, so the initial forest is already evenly partitioned.
 */
 void TMRQuadForest::createTrees(int refine_level) {
   const int num_faces = fdata->num_faces;
@@ -1250,40 +1506,38 @@ void TMRQuadForest::createTrees(int refine_level) {
     level = TMR_MAX_LEVEL - 1;
   }
 
-  // Set who owns what faces
-  int nfaces = num_faces / mpi_size;
-  int remain = num_faces % mpi_size;
-  int start = mpi_rank * nfaces;
-  int end = (mpi_rank + 1) * nfaces;
-  if (mpi_rank < remain) {
-    nfaces += 1;
-    start += mpi_rank;
-    end += mpi_rank + 1;
-  } else {
-    start += remain;
-    end += remain;
-  }
+  // Find the range of quadrants in the global order on this processor
+  const int64_t num_per_face = (int64_t)1 << (2 * level);
+  const int64_t total = num_per_face * num_faces;
+  const int64_t start = (total / mpi_size) * mpi_rank +
+                        (mpi_rank < total % mpi_size ? mpi_rank
+                                                     : total % mpi_size);
+  const int64_t end = start + total / mpi_size +
+                      (mpi_rank < total % mpi_size ? 1 : 0);
 
   // Create an array of the quadrants that will be stored
-  int nelems = 1 << level;
-  int size = nelems * nelems * nfaces;
+  int size = (int)(end - start);
   TMRQuadrant *array = new TMRQuadrant[size];
 
-  // Generate all of the quadrants on the associated faces
+  // Generate the quadrants by decoding their Morton index within the
+  // face. The x-coordinate is the most significant bit of each pair,
+  // consistent with the quadrant ordering.
   const int32_t hmax = 1 << TMR_MAX_LEVEL;
-  const int32_t h = 1 << (TMR_MAX_LEVEL - level);
-  for (int count = 0, face = start; face < end; face++) {
-    for (int32_t x = 0; x < hmax; x += h) {
-      for (int32_t y = 0; y < hmax; y += h) {
-        array[count].tag = 0;
-        array[count].face = face;
-        array[count].level = level;
-        array[count].info = 0;
-        array[count].x = x;
-        array[count].y = y;
-        count++;
-      }
+  for (int count = 0; count < size; count++) {
+    int64_t index = start + count;
+    uint64_t morton = index % num_per_face;
+    int32_t x = 0, y = 0;
+    for (int32_t k = 0; k < level; k++) {
+      y |= ((morton >> (2 * k)) & 1) << k;
+      x |= ((morton >> (2 * k + 1)) & 1) << k;
     }
+
+    array[count].tag = 0;
+    array[count].face = (int32_t)(index / num_per_face);
+    array[count].level = level;
+    array[count].info = 0;
+    array[count].x = x << (TMR_MAX_LEVEL - level);
+    array[count].y = y << (TMR_MAX_LEVEL - level);
   }
 
   // Create the array of quadrants
@@ -1321,6 +1575,213 @@ void TMRQuadForest::createTrees(int refine_level) {
   }
 }
 
+/*
+  Write the quadrants from all processors to a binary file
+
+  The file contains a header with a magic number, the format version,
+  the number of faces and the total number of quadrants, followed by
+  the quadrants in the global order. The file
+  can be read back on any number of processors with
+  readQuadrantsFromFile().
+  Note that only the quadrants are stored: the mesh order, connectivity
+  and topology must be set separately, and the nodes must be created
+  again after the file is read. This is a collective call.
+
+  input:
+  filename:  the name of the file
+
+  returns:
+  a non-zero value if the file cannot be written
+*/
+int TMRQuadForest::writeQuadrantsToFile(const char *filename) {
+  if (!quadrants || !fdata) {
+    fprintf(stderr,
+            "TMRQuadForest Error: Cannot write quadrants, "
+            "no quadrants have been created\n");
+    return 1;
+  }
+
+  // Get the local quadrants
+  int size;
+  TMRQuadrant *array;
+  quadrants->getArray(&array, &size);
+
+  // Compute the offset to the quadrants from this processor
+  int *range = new int[mpi_size + 1];
+  range[0] = 0;
+  MPI_Allgather(&size, 1, MPI_INT, &range[1], 1, MPI_INT, comm);
+  for (int i = 0; i < mpi_size; i++) {
+    range[i + 1] += range[i];
+  }
+
+  // Copy the filename to a non-const array
+  char *fname = new char[strlen(filename) + 1];
+  strcpy(fname, filename);
+
+  int fail = 0;
+  MPI_File fp = MPI_FILE_NULL;
+  if (MPI_File_open(comm, fname, MPI_MODE_WRONLY | MPI_MODE_CREATE,
+                    MPI_INFO_NULL, &fp) == MPI_SUCCESS) {
+    // Discard the contents of an existing file
+    MPI_File_set_size(fp, 0);
+
+    // Write out the header
+    if (mpi_rank == 0) {
+      int header[TMR_QUADRANT_FILE_HEADER_SIZE];
+      header[0] = TMR_QUADRANT_FILE_MAGIC;
+      header[1] = TMR_QUADRANT_FILE_VERSION;
+      header[2] = fdata->num_faces;
+      header[3] = range[mpi_size];
+      MPI_File_write_at(fp, 0, header, TMR_QUADRANT_FILE_HEADER_SIZE, MPI_INT,
+                        MPI_STATUS_IGNORE);
+    }
+
+    // Write out all the quadrants to the file
+    char datarep[] = "native";
+    const MPI_Offset header_bytes = TMR_QUADRANT_FILE_HEADER_SIZE * sizeof(int);
+    MPI_File_set_view(fp, header_bytes, TMRQuadrant_MPI_type,
+                      TMRQuadrant_MPI_type, datarep, MPI_INFO_NULL);
+    MPI_File_write_at_all(fp, range[mpi_rank], array, size,
+                          TMRQuadrant_MPI_type, MPI_STATUS_IGNORE);
+    MPI_File_close(&fp);
+  } else {
+    fail = 1;
+  }
+
+  delete[] range;
+  delete[] fname;
+
+  return fail;
+}
+
+/*
+  Read the quadrants from a binary file written by writeQuadrantsToFile()
+
+  The quadrants are stored in the global order, so each processor reads
+  a contiguous interval of the quadrants that is of nearly equal size.
+  The file may have been written on a different number of processors.
+  The connectivity (or topology) must be set before the file is read
+  and have the same number of faces. This is a collective call.
+
+  input:
+  filename:  the name of the file
+
+  returns:
+  a non-zero value if the file cannot be read or does not match
+*/
+int TMRQuadForest::readQuadrantsFromFile(const char *filename) {
+  if (!fdata) {
+    fprintf(stderr,
+            "TMRQuadForest Error: Cannot read quadrants, "
+            "the connectivity must be set first\n");
+    return 1;
+  }
+  const int num_faces = fdata->num_faces;
+
+  // Copy the filename to a non-const array
+  char *fname = new char[strlen(filename) + 1];
+  strcpy(fname, filename);
+
+  MPI_File fp = MPI_FILE_NULL;
+  int open_fail = (MPI_File_open(comm, fname, MPI_MODE_RDONLY, MPI_INFO_NULL,
+                                 &fp) != MPI_SUCCESS);
+  delete[] fname;
+
+  if (open_fail) {
+    if (mpi_rank == 0) {
+      fprintf(stderr, "TMRQuadForest Error: Could not open file %s\n",
+              filename);
+    }
+    return 1;
+  }
+
+  // Read in the header. The header is zeroed first so that a short
+  // file fails the checks. Every processor reads the same values, so
+  // the checks are consistent across processors.
+  int header[TMR_QUADRANT_FILE_HEADER_SIZE];
+  memset(header, 0, sizeof(header));
+  MPI_File_read_at_all(fp, 0, header, TMR_QUADRANT_FILE_HEADER_SIZE, MPI_INT,
+                       MPI_STATUS_IGNORE);
+
+  // Find the size of the file and of the data it must contain
+  MPI_Offset file_size = 0;
+  MPI_File_get_size(fp, &file_size);
+  int type_size = 0;
+  MPI_Type_size(TMRQuadrant_MPI_type, &type_size);
+  const MPI_Offset header_bytes = TMR_QUADRANT_FILE_HEADER_SIZE * sizeof(int);
+
+  const char *errmsg = NULL;
+  if (header[0] != TMR_QUADRANT_FILE_MAGIC) {
+    errmsg = "is not a TMRQuadForest quadrant file";
+  } else if (header[1] != TMR_QUADRANT_FILE_VERSION) {
+    errmsg = "has an unsupported format version";
+  } else if (header[2] != num_faces) {
+    errmsg = "does not match the number of faces in the connectivity";
+  } else if (header[3] < 0 ||
+             file_size < header_bytes + (MPI_Offset)type_size * header[3]) {
+    errmsg = "is truncated";
+  }
+  if (errmsg) {
+    if (mpi_rank == 0) {
+      fprintf(stderr, "TMRQuadForest Error: File %s %s\n", filename, errmsg);
+    }
+    MPI_File_close(&fp);
+    return 1;
+  }
+
+  // Free all of the mesh data
+  freeMeshData();
+
+  // Compute the interval of quadrants for this processor
+  const int total = header[3];
+  int start = (int)(((int64_t)total * mpi_rank) / mpi_size);
+  int end = (int)(((int64_t)total * (mpi_rank + 1)) / mpi_size);
+  int size = end - start;
+  TMRQuadrant *array = new TMRQuadrant[size];
+
+  char datarep[] = "native";
+  MPI_File_set_view(fp, header_bytes, TMRQuadrant_MPI_type,
+                    TMRQuadrant_MPI_type, datarep, MPI_INFO_NULL);
+  MPI_File_read_at_all(fp, start, array, size, TMRQuadrant_MPI_type,
+                       MPI_STATUS_IGNORE);
+  MPI_File_close(&fp);
+
+  // Create the array of quadrants. The quadrants are already sorted.
+  quadrants = new TMRQuadrantArray(array, size);
+  quadrants->sort();
+
+  // Set the local reordering for the elements
+  for (int i = 0; i < size; i++) {
+    array[i].tag = i;
+  }
+
+  // Set the last octant
+  const int32_t hmax = 1 << TMR_MAX_LEVEL;
+  TMRQuadrant p;
+  p.face = num_faces - 1;
+  p.tag = -1;
+  p.level = 0;
+  p.info = 0;
+  p.x = p.y = hmax;
+  if (size > 0) {
+    p = array[0];
+  }
+
+  owners = new TMRQuadrant[mpi_size];
+  MPI_Allgather(&p, 1, TMRQuadrant_MPI_type, owners, 1, TMRQuadrant_MPI_type,
+                comm);
+
+  // Set the offsets if some of the processors have zero
+  // quadrants
+  for (int k = 1; k < mpi_size; k++) {
+    if (owners[k].tag == -1) {
+      owners[k] = owners[k - 1];
+    }
+  }
+
+  return 0;
+}
+
 /*
   Create a forest with the specified refinement level
 */
@@ -1407,7 +1868,7 @@ void TMRQuadForest::createRandomTrees(int nrand, int min_level, int max_level) {
   after this call so be careful.
 */
 void TMRQuadForest::repartition() {
-  const int num_faces = fdata->num_faces;
+  TMR_TRACE_SCOPE("TMRQuadForest::repartition");
 
   // Free everything but the quadrants
   freeMeshData(0);
@@ -1442,41 +1903,306 @@ void TMRQuadForest::repartition() {
     }
   }
 
-  // Allocate the new array of quadrants
-  int new_size = new_ptr[mpi_rank + 1] - new_ptr[mpi_rank];
-  TMRQuadrant *new_array = new TMRQuadrant[new_size];
+  // Move the quadrants to their new owners
+  repartitionQuadrants(ptr, new_ptr);
 
-  // Ptr:      |----|---|--------------------|-|
-  // New ptr:  |-------|-------|-------|-------|
+  delete[] ptr;
+  delete[] new_ptr;
+}
 
-  // Count up the number of sends/recvs
-  int send_count = 0;
-  for (int i = 0; i < mpi_size; i++) {
-    if (i != mpi_rank && new_ptr[i + 1] >= ptr[mpi_rank] &&
-        new_ptr[i] < ptr[mpi_rank + 1]) {
-      send_count++;
-    }
-  }
+/*
+  Repartition the quadrants across all processors based on their cost
 
-  // Allocate arrays send/recv arrays
-  MPI_Request *send_requests = new MPI_Request[send_count];
+  The quadrants are divided into contiguous intervals in the Morton
+  order such that the sum of the weights on each processor is as
+  close as possible to the average. Each quadrant is assigned to the
+  processor whose interval of the global weighted prefix sum contains
+  the midpoint of the quadrant's own weight.
 
-  // Zero the send/recv counts
-  send_count = 0;
+  If any weight is negative or NaN, or the weights sum to zero, an
+  error is printed and the quadrants are repartitioned by count on all
+  processors.
 
-  // Match up the intervals for sends
-  for (int i = 0; i < mpi_size; i++) {
-    // If we're on the correct interval,
-    if (new_ptr[i + 1] >= ptr[mpi_rank] && new_ptr[i] < ptr[mpi_rank + 1]) {
-      // The start and end locations within the local array
-      int start = new_ptr[i] - ptr[mpi_rank];
-      if (start < 0) {
-        start = 0;
-      }
+  input:
+  weights:  non-negative weights for each local quadrant, in the order
+            of the local quadrant array
 
-      int max_count = ptr[mpi_rank + 1] - ptr[mpi_rank];
-      int end = new_ptr[i + 1] - ptr[mpi_rank];
-      if (end > max_count) {
+  returns:
+  the imbalance: the max processor weight divided by the average
+*/
+double TMRQuadForest::repartition(const double *weights) {
+  // Free everything but the quadrants
+  freeMeshData(0);
+
+  int size;
+  TMRQuadrant *array;
+  quadrants->getArray(&array, &size);
+
+  // Compute the offset of the local weights in the global weighted
+  // prefix sum and the total weight
+  double local_weight = 0.0;
+  int num_invalid = 0;
+  for (int i = 0; i < size; i++) {
+    if (!(weights[i] >= 0.0)) {
+      num_invalid++;
+    }
+    local_weight += weights[i];
+  }
+
+  double offset = 0.0;
+  MPI_Exscan(&local_weight, &offset, 1, MPI_DOUBLE, MPI_SUM, comm);
+  if (mpi_rank == 0) {
+    offset = 0.0;
+  }
+
+  // Find the total weight and the number of negative (or NaN) weights
+  // on all processors. A negative weight would break the ordering of
+  // the destinations, so all processors fall back to the repartition
+  // by count.
+  double local_data[2], total_data[2];
+  local_data[0] = local_weight;
+  local_data[1] = num_invalid;
+  MPI_Allreduce(local_data, total_data, 2, MPI_DOUBLE, MPI_SUM, comm);
+  double total_weight = total_data[0];
+
+  if (total_data[1] > 0.0 || !(total_weight > 0.0)) {
+    if (mpi_rank == 0) {
+      fprintf(stderr,
+              "TMRQuadForest Error: Weights must be non-negative with a "
+              "positive sum, repartitioning by quadrant count\n");
+    }
+    repartition();
+    return 1.0;
+  }
+
+  // Count the number of quadrants and the weight destined for each
+  // processor. Since the weights are non-negative, the destinations
+  // are non-decreasing in the Morton order.
+  int *new_count = new int[mpi_size];
+  double *new_weight = new double[mpi_size];
+  memset(new_count, 0, mpi_size * sizeof(int));
+  memset(new_weight, 0, mpi_size * sizeof(double));
+
+  double sum = offset;
+  for (int i = 0; i < size; i++) {
+    double mid = sum + 0.5 * weights[i];
+    int rank = (int)(mpi_size * (mid / total_weight));
+    if (rank < 0) {
+      rank = 0;
+    } else if (rank >= mpi_size) {
+      rank = mpi_size - 1;
+    }
+    new_count[rank]++;
+    new_weight[rank] += weights[i];
+    sum += weights[i];
+  }
+
+  // Compute the new distribution of the quadrants
+  int *ptr = new int[mpi_size + 1];
+  int *new_ptr = new int[mpi_size + 1];
+  MPI_Allgather(&size, 1, MPI_INT, &ptr[1], 1, MPI_INT, comm);
+  MPI_Allreduce(new_count, &new_ptr[1], mpi_size, MPI_INT, MPI_SUM, comm);
+  ptr[0] = new_ptr[0] = 0;
+  for (int k = 0; k < mpi_size; k++) {
+    ptr[k + 1] += ptr[k];
+    new_ptr[k + 1] += new_ptr[k];
+  }
+
+  // Compute the imbalance of the new distribution
+  MPI_Allreduce(MPI_IN_PLACE, new_weight, mpi_size, MPI_DOUBLE, MPI_SUM,
+                comm);
+  double max_weight = 0.0;
+  for (int k = 0; k < mpi_size; k++) {
+    if (new_weight[k] > max_weight) {
+      max_weight = new_weight[k];
+    }
+  }
+  double imbalance = mpi_size * max_weight / total_weight;
+
+  delete[] new_count;
+  delete[] new_weight;
+
+  // Move the quadrants to their new owners
+  repartitionQuadrants(ptr, new_ptr);
+
+  delete[] ptr;
+  delete[] new_ptr;
+
+  return imbalance;
+}
+
+/*
+  Set the imbalance tolerance that triggers an automatic repartition
+
+  When the tolerance is positive, repartitionIfImbalanced() is called
+  with this tolerance whenever balance() completes. Since refine() is
+  followed by balance(), the quadrants are not repartitioned after
+  refine(). A tolerance of zero disables the automatic repartition.
+*/
+void TMRQuadForest::setRepartitionTolerance(double tol) {
+  repartition_tol = (tol > 0.0 ? tol : 0.0);
+}
+
+/*
+  Repartition the quadrants when the load is imbalanced
+
+  The load on each processor is the number of quadrants or, when weights
+  are provided, the sum of the weights of its quadrants. The quadrants are
+  repartitioned only when the maximum load divided by the average
+  load exceeds the tolerance. The imbalance, the decision and the
+  number of bytes of quadrants moved between processors are retained and
+  can be retrieved with getRepartitionStats().
+
+  input:
+  tol:      the imbalance tolerance (maximum/average load)
+  weights:  optional non-negative weights for each local quadrant
+
+  returns:
+  1 if the quadrants were repartitioned, 0 otherwise
+*/
+int TMRQuadForest::repartitionIfImbalanced(double tol, const double *weights) {
+  last_imbalance = 1.0;
+  last_bytes_moved = 0.0;
+  last_repartitioned = 0;
+  if (!quadrants) {
+    return 0;
+  }
+
+  int size;
+  TMRQuadrant *array;
+  quadrants->getArray(&array, &size);
+
+  // Compute the load on this processor
+  double load[2];
+  load[0] = size;
+  if (weights) {
+    load[0] = 0.0;
+    for (int i = 0; i < size; i++) {
+      load[0] += weights[i];
+    }
+  }
+  load[1] = load[0];
+  MPI_Allreduce(MPI_IN_PLACE, &load[0], 1, MPI_DOUBLE, MPI_MAX, comm);
+  MPI_Allreduce(MPI_IN_PLACE, &load[1], 1, MPI_DOUBLE, MPI_SUM, comm);
+  if (load[1] > 0.0) {
+    last_imbalance = mpi_size * load[0] / load[1];
+  }
+
+  if (last_imbalance <= tol) {
+    return 0;
+  }
+
+  // Record the current distribution of the quadrants
+  int *ptr = new int[mpi_size + 1];
+  int *new_ptr = new int[mpi_size + 1];
+  MPI_Allgather(&size, 1, MPI_INT, &ptr[1], 1, MPI_INT, comm);
+
+  if (weights) {
+    repartition(weights);
+  } else {
+    repartition();
+  }
+
+  // Find the number of quadrants that changed processor. Since the
+  // global order is unchanged, these are the quadrants outside the
+  // intersection of the old and new intervals on each processor.
+  quadrants->getArray(&array, &size);
+  MPI_Allgather(&size, 1, MPI_INT, &new_ptr[1], 1, MPI_INT, comm);
+  ptr[0] = new_ptr[0] = 0;
+  for (int k = 0; k < mpi_size; k++) {
+    ptr[k + 1] += ptr[k];
+    new_ptr[k + 1] += new_ptr[k];
+  }
+
+  int num_kept = 0;
+  for (int k = 0; k < mpi_size; k++) {
+    int start = (ptr[k] > new_ptr[k] ? ptr[k] : new_ptr[k]);
+    int end = (ptr[k + 1] < new_ptr[k + 1] ? ptr[k + 1] : new_ptr[k + 1]);
+    if (end > start) {
+      num_kept += end - start;
+    }
+  }
+  last_bytes_moved = (double)sizeof(TMRQuadrant) * (ptr[mpi_size] - num_kept);
+  last_repartitioned = 1;
+
+  delete[] ptr;
+  delete[] new_ptr;
+
+  return 1;
+}
+
+/*
+  Get the outcome of the last call to repartitionIfImbalanced()
+
+  output:
+  imbalance:      the maximum/average load before repartitioning
+  repartitioned:  flag indicating whether the quadrants were moved
+  bytes_moved:    the total bytes of quadrants sent between processors
+*/
+void TMRQuadForest::getRepartitionStats(double *imbalance, int *repartitioned,
+                                        double *bytes_moved) {
+  if (imbalance) {
+    *imbalance = last_imbalance;
+  }
+  if (repartitioned) {
+    *repartitioned = last_repartitioned;
+  }
+  if (bytes_moved) {
+    *bytes_moved = last_bytes_moved;
+  }
+}
+
+/*
+  Move the quadrants to their new owners
+
+  input:
+  ptr:      the current offsets of the quadrants on each processor
+  new_ptr:  the new offsets of the quadrants on each processor
+*/
+void TMRQuadForest::repartitionQuadrants(const int *ptr, const int *new_ptr) {
+  TMR_TRACE_SCOPE("TMRQuadForest::repartitionQuadrants");
+
+  const int num_faces = fdata->num_faces;
+
+  int size;
+  TMRQuadrant *array;
+  quadrants->getArray(&array, &size);
+
+  // Allocate the new array of quadrants
+  int new_size = new_ptr[mpi_rank + 1] - new_ptr[mpi_rank];
+  TMRQuadrant *new_array = new TMRQuadrant[new_size];
+
+  // Ptr:      |----|---|--------------------|-|
+  // New ptr:  |-------|-------|-------|-------|
+
+  // Count up the number of sends/recvs
+  int send_count = 0;
+  for (int i = 0; i < mpi_size; i++) {
+    if (i != mpi_rank && new_ptr[i + 1] >= ptr[mpi_rank] &&
+        new_ptr[i] < ptr[mpi_rank + 1]) {
+      send_count++;
+    }
+  }
+
+  // Allocate arrays send/recv arrays
+  MPI_Request *send_requests = new MPI_Request[send_count];
+
+  // Zero the send/recv counts
+  send_count = 0;
+
+  // Match up the intervals for sends
+  for (int i = 0; i < mpi_size; i++) {
+    // If we're on the correct interval,
+    if (new_ptr[i + 1] >= ptr[mpi_rank] && new_ptr[i] < ptr[mpi_rank + 1]) {
+      // The start and end locations within the local array
+      int start = new_ptr[i] - ptr[mpi_rank];
+      if (start < 0) {
+        start = 0;
+      }
+
+      int max_count = ptr[mpi_rank + 1] - ptr[mpi_rank];
+      int end = new_ptr[i + 1] - ptr[mpi_rank];
+      if (end > max_count) {
         end = max_count;
       }
 
@@ -1492,6 +2218,7 @@ void TMRQuadForest::repartition() {
                count * sizeof(TMRQuadrant));
       } else if (count > 0) {
         // Send the element array to the new owner
+        TMR_TRACE_BYTES(count * sizeof(TMRQuadrant));
         MPI_Isend(&array[start], count, TMRQuadrant_MPI_type, i, 0, comm,
                   &send_requests[send_count]);
         send_count++;
@@ -1528,10 +2255,6 @@ void TMRQuadForest::repartition() {
     }
   }
 
-  // Free the memory
-  delete[] ptr;
-  delete[] new_ptr;
-
   // Wait for any remaining sends to complete
   MPI_Waitall(send_count, send_requests, MPI_STATUSES_IGNORE);
   delete[] send_requests;
@@ -1551,6 +2274,9 @@ void TMRQuadForest::repartition() {
   delete quadrants;
   quadrants = new TMRQuadrantArray(new_array, new_size);
 
+  if (owners) {
+    delete[] owners;
+  }
   owners = new TMRQuadrant[mpi_size];
   MPI_Allgather(&q, 1, TMRQuadrant_MPI_type, owners, 1, TMRQuadrant_MPI_type,
                 comm);
@@ -1640,12 +2366,13 @@ TMRQuadForest *TMRQuadForest::coarsen() {
 
 /*
   Refine the quadrant mesh based on the input refinement level
+
+  If the refinement does not change any element on any processor, the
+  existing mesh data is retained, so that a following call to
+  createNodes() does not recompute the nodes.
 */
 void TMRQuadForest::refine(const int refinement[], int min_level,
                            int max_level) {
-  // Free the data associated with the mesh but not the quadrants/owners
-  freeMeshData(0, 0);
-
   // Adjust the min and max levels to ensure consistency
   if (min_level < 0) {
     min_level = 0;
@@ -1659,16 +2386,33 @@ void TMRQuadForest::refine(const int refinement[], int min_level,
     min_level = max_level;
   }
 
+  // Check whether any element will be changed by the refinement
+  int size;
+  TMRQuadrant *array;
+  quadrants->getArray(&array, &size);
+
+  int changed = 0;
+  for (int i = 0; i < size && !changed; i++) {
+    if (refinement) {
+      changed = ((refinement[i] < 0 && array[i].level > min_level) ||
+                 (refinement[i] > 0 && array[i].level < max_level));
+    } else {
+      changed = (array[i].level < max_level);
+    }
+  }
+  MPI_Allreduce(MPI_IN_PLACE, &changed, 1, MPI_INT, MPI_LOR, comm);
+  if (!changed) {
+    return;
+  }
+
+  // Free the data associated with the mesh but not the quadrants/owners
+  freeMeshData(0, 0);
+
   // Create a hash table for the refined quadrants and the quadrants
   // that are external (on other processors)
   TMRQuadrantHash *hash = new TMRQuadrantHash();
   TMRQuadrantHash *ext_hash = new TMRQuadrantHash();
 
-  // Get the current array of quadrants
-  int size;
-  TMRQuadrant *array;
-  quadrants->getArray(&array, &size);
-
   if (refinement) {
     for (int i = 0; i < size; i++) {
       if (refinement[i] == 0) {
@@ -1801,12 +2545,20 @@ void TMRQuadForest::refine(const int refinement[], int min_level,
   Get the owner of the quadrant
 */
 int TMRQuadForest::getQuadrantMPIOwner(TMRQuadrant *quad) {
-  int rank = 0;
-  for (; (rank < mpi_size - 1 && owners[rank + 1].comparePosition(quad) <= 0);
-       rank++)
-    ;
+  // Find the last rank such that owners[rank] <= quad using a binary
+  // search. The owners are sorted, but may contain duplicates when
+  // processors have no quadrants.
+  int low = 0, high = mpi_size - 1;
+  while (low < high) {
+    int mid = high - (high - low) / 2;
+    if (owners[mid].comparePosition(quad) <= 0) {
+      low = mid;
+    } else {
+      high = mid - 1;
+    }
+  }
 
-  return rank;
+  return low;
 }
 
 /*
@@ -1879,7 +2631,7 @@ TMRQuadrantArray *TMRQuadForest::distributeQuadrants(
   // Now distribute the quadrants to their destination quadrees and
   // balance the corresponding quadrees including the new elements.
   int *quad_recv_counts = new int[mpi_size];
-  MPI_Alltoall(quad_counts, 1, MPI_INT, quad_recv_counts, 1, MPI_INT, comm);
+  TMRExchangeCounts(comm, quad_counts, quad_recv_counts);
 
   // Now use quad_ptr to point into the recv array
   quad_recv_ptr[0] = 0;
@@ -1916,6 +2668,8 @@ TMRQuadrantArray *TMRQuadForest::sendQuadrants(TMRQuadrantArray *list,
                                                const int *quad_ptr,
                                                const int *quad_recv_ptr,
                                                int use_node_index) {
+  TMR_TRACE_SCOPE("TMRQuadForest::sendQuadrants");
+
   // Get the array itself
   int size;
   TMRQuadrant *array;
@@ -1946,6 +2700,7 @@ TMRQuadrantArray *TMRQuadForest::sendQuadrants(TMRQuadrantArray *list,
     if (i != mpi_rank && quad_ptr[i + 1] - quad_ptr[i] > 0) {
       // Post the send to the destination
       int count = quad_ptr[i + 1] - quad_ptr[i];
+      TMR_TRACE_BYTES(count * sizeof(TMRQuadrant));
       MPI_Isend(&array[quad_ptr[i]], count, TMRQuadrant_MPI_type, i, 0, comm,
                 &send_request[j]);
       j++;
@@ -2235,6 +2990,8 @@ void TMRQuadForest::balanceQuadrant(TMRQuadrant *quad, TMRQuadrantHash *hash,
   per edge) and balances across corners optionally.
 */
 void TMRQuadForest::balance(int balance_corner) {
+  TMR_TRACE_SCOPE("TMRQuadForest::balance");
+
   if (!quadrants) {
     fprintf(stderr,
             "TMRQuadForest Error: Cannot call balance(), "
@@ -2406,6 +3163,10 @@ void TMRQuadForest::balance(int balance_corner) {
 
   // Free the hash
   delete hash;
+
+  if (repartition_tol > 0.0) {
+    repartitionIfImbalanced(repartition_tol);
+  }
 }
 
 /*
@@ -2627,12 +3388,14 @@ void TMRQuadForest::computeAdjacentQuadrants() {
 
   // Convert the local adjacency non-local list of quadrants
   TMRQuadrantArray *list = queue->toArray();
-  list->getArray(&array, &size);
-  qsort(array, size, sizeof(TMRQuadrant), compare_quadrant_tags);
+  delete queue;
+  list->sortByTag();
 
   // Distribute the quadrants
   int use_tags = 1;
+  addTransient(list->getMemoryUsage());
   adjacent = distributeQuadrants(list, use_tags);
+  removeTransient(list->getMemoryUsage());
   delete list;
   adjacent->sort();
 
@@ -2866,7 +3629,8 @@ void TMRQuadForest::labelDependentNodes(int *nodes) {
   node numbering scheme.
 
   This transforms the given quadrant to the coordinate system of the
-  lowest owner face.
+  lowest owner face. The transformation is looked up from the table
+  computed in computeFaceTransforms().
 
   input/output:
   quad:  the quadrant representing a node in the local coordinate system
@@ -2888,74 +3652,26 @@ void TMRQuadForest::transformNode(TMRQuadrant *quad, int *edge_reversed) {
   }
 
   if (fx || fy) {
-    // Get the original face index
-    int face = quad->face;
-
+    // Find the index of the edge or corner within the face
+    // transformations: edges are 0-3 and corners 4-7
+    int index = 0;
     if (fx && fy) {
-      // This node lies on a corner
-      int corner = (fx0 ? 0 : 1) + (fy0 ? 0 : 2);
-      int node = fdata->face_conn[4 * face + corner];
-
-      if (face != fdata->node_face_owners[node]) {
-        // Get the pointer information
-        int ptr = fdata->node_face_ptr[node];
-        int adj = fdata->node_face_conn[ptr] / 4;
-        int adj_index = fdata->node_face_conn[ptr] % 4;
-
-        // Copy the coordinates of the adjacent face
-        quad->face = adj;
-        quad->x = hmax * (adj_index % 2);
-        quad->y = hmax * (adj_index / 2);
-      }
+      index = 4 + (fx0 ? 0 : 1) + (fy0 ? 0 : 2);
     } else {
-      // Which edge index are we dealing with?
-      int edge_index = fx * (fx0 ? 0 : 1) + fy * (fy0 ? 2 : 3);
-      int edge = fdata->face_edge_conn[4 * face + edge_index];
-
-      if (face != fdata->edge_face_owners[edge]) {
-        // Get the adjacent edge index on the opposite face
-        int ptr = fdata->edge_face_ptr[edge];
-        int adj = fdata->edge_face_conn[ptr] / 4;
-        int adj_index = fdata->edge_face_conn[ptr] % 4;
-
-        // Retrieve the first and second node numbers to determine the
-        // relative orientation between this edge and each adjacent edge
-        int n1 = fdata->face_conn[4 * face + face_to_edge_nodes[edge_index][0]];
-        int n2 = fdata->face_conn[4 * face + face_to_edge_nodes[edge_index][1]];
-
-        // Get the orientation
-        int nn1 = fdata->face_conn[4 * adj + face_to_edge_nodes[adj_index][0]];
-        int nn2 = fdata->face_conn[4 * adj + face_to_edge_nodes[adj_index][1]];
-
-        // Determine whether the edges are in the same direction
-        // or are reversed
-        int reverse = (n1 == nn2 && n2 == nn1);
-
-        if (reverse && edge_reversed) {
-          *edge_reversed = 1;
-        }
-
-        // Get the edge coordinate index
-        int32_t u = quad->x;
-        if (edge_index < 2) {
-          u = quad->y;
-        }
-
-        // Set the u-coordinate along the edge
-        int32_t uquad = u;
-        if (reverse) {
-          uquad = hmax - u;
-        }
+      index = fx * (fx0 ? 0 : 1) + fy * (fy0 ? 2 : 3);
+    }
 
-        // Transform the quadant to the adjacent coordinate system
-        quad->face = adj;
-        if (adj_index < 2) {
-          quad->x = hmax * (adj_index % 2);
-          quad->y = uquad;
-        } else {
-          quad->x = uquad;
-          quad->y = hmax * (adj_index % 2);
-        }
+    // Transform the node to the face that owns the entity
+    const TMRFaceConn::Transform *t =
+        &fdata->face_transforms[TMRFaceConn::NUM_FACE_TRANSFORMS * quad->face +
+                                index];
+    if (t->adj >= 0) {
+      const int32_t x = quad->x, y = quad->y;
+      quad->face = t->adj;
+      quad->x = (t->A[0] * x + t->A[1] * y) + hmax * t->b[0];
+      quad->y = (t->A[2] * x + t->A[3] * y) + hmax * t->b[1];
+      if (index < 4 && edge_reversed) {
+        *edge_reversed = t->reversed;
       }
     }
 
@@ -2992,8 +3708,19 @@ void TMRQuadForest::transformNode(TMRQuadrant *quad, int *edge_reversed) {
   and corners. Finally, the new node numbers are returned to the
   processors that border the quadtree owners. And lastly, the non-local
   partial quadtrees are freed.
+
+  If the nodes already exist, for instance because refine() did not
+  change any element, the call returns immediately. When incremental
+  node creation is set, the local connectivity of the elements that
+  are unchanged since the previous call is reused, and only the new
+  elements and the dependent nodes are searched for in the node array.
+  The global node numbers are always assigned again, since they are
+  contiguous in Morton order and any change shifts the numbers of the
+  nodes that follow it.
 */
 void TMRQuadForest::createNodes() {
+  TMR_TRACE_SCOPE("TMRQuadForest::createNodes");
+
   if (!quadrants) {
     fprintf(stderr,
             "TMRQuadForest Error: Cannot call createNodes(), "
@@ -3006,14 +3733,29 @@ void TMRQuadForest::createNodes() {
     return;
   }
 
+  // Mark this as a new numbering of the nodes
+  static int node_stamp_count = 0;
+  node_stamp = node_stamp_count;
+  node_stamp_count++;
+
+  // Record the transient memory used to create the nodes
+  beginMemoryPhase(TMR_NODES_PHASE);
+
   // Send/recv the adjacent quadrants
   computeAdjacentQuadrants();
 
   // Compute the dependent face nodes
   computeDepEdges();
 
+  // Match the elements with the elements from the previous call so
+  // that the connectivity of the unchanged elements can be reused
+  int *prev_elems = NULL;
+  if (use_incremental_nodes && prev_quadrants) {
+    prev_elems = matchPrevElements();
+  }
+
   // Create and assign the ownership for the local node numbers
-  TMRQuadrantArray *nodes = createLocalNodes();
+  TMRQuadrantArray *nodes = createLocalNodes(prev_elems);
 
   // Retrieve the size of the node array and count up the offsets for
   // each node. When mesh_order <= 3, the offset array will be equal
@@ -3025,6 +3767,7 @@ void TMRQuadForest::createNodes() {
   nodes->getArray(&node_array, &node_size);
 
   int *node_offset = new int[node_size];
+  addTransient(node_size * sizeof(int));
   num_local_nodes = 0;
   for (int i = 0; i < node_size; i++) {
     node_offset[i] = num_local_nodes;
@@ -3032,7 +3775,22 @@ void TMRQuadForest::createNodes() {
   }
 
   // Create the connectivity based on the node array
-  createLocalConn(nodes, node_offset);
+  createLocalConn(nodes, node_offset, prev_elems);
+  if (prev_elems) {
+    delete[] prev_elems;
+  }
+
+  // Keep a copy of the quadrants and the local connectivity for the
+  // next call. The local node array is kept once it is complete.
+  freePrevNodes();
+  if (use_incremental_nodes) {
+    int num_elements;
+    quadrants->getArray(NULL, &num_elements);
+    int size = mesh_order * mesh_order * num_elements;
+    prev_quadrants = quadrants->duplicate();
+    prev_conn = new int[size];
+    memcpy(prev_conn, conn, size * sizeof(int));
+  }
 
   // Allocate an array that will store the new node numbers
   node_numbers = new int[num_local_nodes];
@@ -3115,13 +3873,12 @@ void TMRQuadForest::createNodes() {
   // owned by other processors and referenced by the
   // elements on this processor.
   TMRQuadrantArray *ext_array = ext_nodes->toArray();
+  addTransient(ext_nodes->getMemoryUsage() + ext_array->getMemoryUsage());
+  removeTransient(ext_nodes->getMemoryUsage());
   delete ext_nodes;
 
   // Sort based on the tags
-  int ext_size;
-  TMRQuadrant *ext_quads;
-  ext_array->getArray(&ext_quads, &ext_size);
-  qsort(ext_quads, ext_size, sizeof(TMRQuadrant), compare_quadrant_tags);
+  ext_array->sortByTag();
 
   // Distribute the non-local nodes back to their owning processors
   // to determine their node numbers
@@ -3129,6 +3886,8 @@ void TMRQuadForest::createNodes() {
   int *send_ptr, *recv_ptr;
   TMRQuadrantArray *dist_nodes =
       distributeQuadrants(ext_array, use_tags, &send_ptr, &recv_ptr);
+  addTransient(dist_nodes->getMemoryUsage());
+  removeTransient(ext_array->getMemoryUsage());
   delete ext_array;
 
   // Loop over the off-processor nodes and search for them in the
@@ -3148,6 +3907,8 @@ void TMRQuadForest::createNodes() {
   // Send the nodes back to the original processors
   TMRQuadrantArray *return_nodes =
       sendQuadrants(dist_nodes, recv_ptr, send_ptr);
+  addTransient(return_nodes->getMemoryUsage());
+  removeTransient(dist_nodes->getMemoryUsage());
   delete dist_nodes;
   delete[] recv_ptr;
   delete[] send_ptr;
@@ -3163,10 +3924,16 @@ void TMRQuadForest::createNodes() {
       node_numbers[node_offset[index] + k] = return_quads[i].tag + k;
     }
   }
+  removeTransient(return_nodes->getMemoryUsage());
   delete return_nodes;
 
-  // Free the local node array
-  delete nodes;
+  // Free the local node array, unless it is kept for the next call
+  removeTransient(nodes->getMemoryUsage() + node_size * sizeof(int));
+  if (use_incremental_nodes) {
+    prev_nodes = nodes;
+  } else {
+    delete nodes;
+  }
   delete[] node_offset;
 
   // Apply the node numbering scheme to the local connectivity to
@@ -3214,8 +3981,15 @@ void TMRQuadForest::createNodes() {
   1. tag represents the MPI owner
   2. info represents the label (node/edge/face)
   3. level represents the number of nodes represented by the quad
+
+  When prev_elems is provided, the nodes of the elements that are
+  unchanged since the previous call to createNodes() are copied from
+  the previous node array rather than created again.
+
+  input:
+  prev_elems:  the previous index of each element or -1 (may be NULL)
 */
-TMRQuadrantArray *TMRQuadForest::createLocalNodes() {
+TMRQuadrantArray *TMRQuadForest::createLocalNodes(const int *prev_elems) {
   // Allocate the array of elements
   int num_elements;
   TMRQuadrant *quads;
@@ -3243,6 +4017,9 @@ TMRQuadrantArray *TMRQuadForest::createLocalNodes() {
     // First of all, add all the nodes from the local elements
     // on this processor
     for (int i = 0; i < num_elements; i++) {
+      if (prev_elems && prev_elems[i] >= 0) {
+        continue;
+      }
       const int32_t h = 1 << (TMR_MAX_LEVEL - quads[i].level);
       for (int jj = 0; jj < 2; jj++) {
         for (int ii = 0; ii < 2; ii++) {
@@ -3292,6 +4069,9 @@ TMRQuadrantArray *TMRQuadForest::createLocalNodes() {
     }
   } else {
     for (int i = 0; i < num_elements; i++) {
+      if (prev_elems && prev_elems[i] >= 0) {
+        continue;
+      }
       const int32_t h = 1 << (TMR_MAX_LEVEL - quads[i].level - 1);
       for (int jj = 0; jj < 3; jj++) {
         for (int ii = 0; ii < 3; ii++) {
@@ -3359,9 +4139,22 @@ TMRQuadrantArray *TMRQuadForest::createLocalNodes() {
   // (dependent, indepdnent and non-local) that are referenced by
   // this processor
   TMRQuadrantArray *nodes = local_nodes->toArray();
+  addTransient(local_nodes->getMemoryUsage() + nodes->getMemoryUsage());
+  removeTransient(local_nodes->getMemoryUsage());
   delete local_nodes;
   nodes->sort();
 
+  // Add the nodes of the unchanged elements. These take precedence
+  // over the same nodes added for a dependent node.
+  if (prev_elems) {
+    TMRQuadrantArray *prev_elem_nodes = getPrevElementNodes(prev_elems);
+    removeTransient(nodes->getMemoryUsage());
+    prev_elem_nodes->merge(nodes);
+    addTransient(prev_elem_nodes->getMemoryUsage());
+    delete nodes;
+    nodes = prev_elem_nodes;
+  }
+
   // Now, determine the node ownership - if nodes that are not
   // dependent on this processor
   int use_tags = 0, include_local = 0;
@@ -3372,6 +4165,7 @@ TMRQuadrantArray *TMRQuadForest::createLocalNodes() {
   // Create a unique list of the nodes sent to this processor
   TMRQuadrantArray *recv_sorted = recv_nodes->duplicate();
   recv_sorted->sort();
+  addTransient(recv_nodes->getMemoryUsage() + recv_sorted->getMemoryUsage());
 
   // Now loop over nodes sent from other processors and decide
   // which processor owns the node.
@@ -3429,6 +4223,7 @@ TMRQuadrantArray *TMRQuadForest::createLocalNodes() {
     recv_array[i].tag = t->tag;
   }
 
+  removeTransient(recv_sorted->getMemoryUsage());
   delete recv_sorted;
 
   // Adjust the send_ptr array since there will be a gap
@@ -3442,6 +4237,8 @@ TMRQuadrantArray *TMRQuadForest::createLocalNodes() {
   // owner information attached
   TMRQuadrantArray *owner_nodes =
       sendQuadrants(recv_nodes, recv_ptr, send_ptr, use_node_index);
+  addTransient(owner_nodes->getMemoryUsage());
+  removeTransient(recv_nodes->getMemoryUsage());
   delete recv_nodes;
   delete[] recv_ptr;
   delete[] send_ptr;
@@ -3458,6 +4255,7 @@ TMRQuadrantArray *TMRQuadForest::createLocalNodes() {
     // Assign the MPI owner rank
     t->tag = owner_array[i].tag;
   }
+  removeTransient(owner_nodes->getMemoryUsage());
   delete owner_nodes;
 
   // Return the owners for each node
@@ -3478,12 +4276,19 @@ TMRQuadrantArray *TMRQuadForest::createLocalNodes() {
   3. The level member contains the number of nodes per node object
   which depends on the order of the mesh.
 
+  The connectivity of the elements that are unchanged since the
+  previous call to createNodes() is copied from the previous local
+  connectivity, with the previous local node numbers mapped to the
+  new ones.
+
   input:
   nodes:        the array of quadrants that represent nodes
   node_offset:  the array of offsets for each node
+  prev_elems:   the previous index of each element or -1 (may be NULL)
 */
 void TMRQuadForest::createLocalConn(TMRQuadrantArray *nodes,
-                                    const int *node_offset) {
+                                    const int *node_offset,
+                                    const int *prev_elems) {
   // Retrieve the quadrants on this processor
   int num_elements;
   TMRQuadrant *quads;
@@ -3514,6 +4319,9 @@ void TMRQuadForest::createLocalConn(TMRQuadrantArray *nodes,
 
   if (mesh_order <= 3) {
     for (int i = 0; i < num_elements; i++) {
+      if (prev_elems && prev_elems[i] >= 0) {
+        continue;
+      }
       int *c = &conn[mesh_order * mesh_order * i];
       const int32_t h = 1 << (TMR_MAX_LEVEL - quads[i].level - 1);
 
@@ -3572,6 +4380,9 @@ void TMRQuadForest::createLocalConn(TMRQuadrantArray *nodes,
     // Loop over all the elements and assign the local index owners
     // for each node
     for (int i = 0; i < num_elements; i++) {
+      if (prev_elems && prev_elems[i] >= 0) {
+        continue;
+      }
       int *c = &conn[mesh_order * mesh_order * i];
 
       // Compute the half-edge length of the quadrant
@@ -3659,21 +4470,189 @@ void TMRQuadForest::createLocalConn(TMRQuadrantArray *nodes,
       }
     }
   }
+
+  if (prev_elems) {
+    const int nodes_per_element = mesh_order * mesh_order;
+
+    // Copy the connectivity of the unchanged elements
+    int *node_map = mapPrevNodes(nodes, node_offset);
+    for (int i = 0; i < num_elements; i++) {
+      if (prev_elems[i] >= 0) {
+        int *c = &conn[nodes_per_element * i];
+        const int *pc = &prev_conn[nodes_per_element * prev_elems[i]];
+        for (int j = 0; j < nodes_per_element; j++) {
+          c[j] = node_map[pc[j]];
+        }
+      }
+    }
+    delete[] node_map;
+  }
 }
 
 /*
-  Create the dependent mesh information for all local dependent
-  nodes.
+  Match the local elements with the elements kept from the previous
+  call to createNodes()
 
-  output:
-  ptr:      pointer for each dependent node number
-  conn:     connectivity to each (global) independent node
-  weights:  the weight values for each dependent node
+  Both arrays of quadrants are sorted, so a single pass finds the
+  elements that are identical in both. The connectivity of an element
+  only depends on the element itself, so the local connectivity of a
+  matched element can be reused, even if the dependent nodes around it
+  have changed.
+
+  returns: the previous index of each element or -1
 */
-void TMRQuadForest::createDependentConn(const int *node_nums,
-                                        TMRQuadrantArray *nodes,
-                                        const int *node_offset) {
-  // Allocate space for the connectivity
+int *TMRQuadForest::matchPrevElements() {
+  int num_elements, prev_size;
+  TMRQuadrant *quads, *prev_quads;
+  quadrants->getArray(&quads, &num_elements);
+  prev_quadrants->getArray(&prev_quads, &prev_size);
+
+  int *prev_elems = new int[num_elements];
+  int j = 0;
+  for (int i = 0; i < num_elements; i++) {
+    prev_elems[i] = -1;
+    while (j < prev_size && prev_quads[j].compare(&quads[i]) < 0) {
+      j++;
+    }
+    if (j < prev_size && prev_quads[j].compare(&quads[i]) == 0) {
+      prev_elems[i] = j;
+      j++;
+    }
+  }
+
+  return prev_elems;
+}
+
+/*
+  Get the nodes of the unchanged elements from the previous node array
+
+  The nodes are copied in order, so the array that is returned is
+  sorted. The owner of each node is reset to this processor since it
+  is created from a local element.
+
+  input:
+  prev_elems:  the previous index of each element or -1
+
+  returns: the sorted array of nodes
+*/
+TMRQuadrantArray *TMRQuadForest::getPrevElementNodes(const int *prev_elems) {
+  int num_elements;
+  quadrants->getArray(NULL, &num_elements);
+  const int nodes_per_element = mesh_order * mesh_order;
+
+  int prev_size;
+  TMRQuadrant *prev_array;
+  prev_nodes->getArray(&prev_array, &prev_size);
+  int prev_num_nodes = 0;
+  for (int i = 0; i < prev_size; i++) {
+    prev_num_nodes += prev_array[i].level;
+  }
+
+  // Mark the previous local nodes referenced by the unchanged elements
+  char *marked = new char[prev_num_nodes];
+  memset(marked, 0, prev_num_nodes * sizeof(char));
+  for (int i = 0; i < num_elements; i++) {
+    if (prev_elems[i] >= 0) {
+      const int *pc = &prev_conn[nodes_per_element * prev_elems[i]];
+      for (int j = 0; j < nodes_per_element; j++) {
+        marked[pc[j]] = 1;
+      }
+    }
+  }
+
+  // Copy the marked nodes. An element references all the nodes
+  // represented by a quadrant, so checking the first one is enough.
+  int size = 0;
+  for (int i = 0, offset = 0; i < prev_size; i++) {
+    if (marked[offset]) {
+      size++;
+    }
+    offset += prev_array[i].level;
+  }
+  TMRQuadrant *array = new TMRQuadrant[size];
+  size = 0;
+  for (int i = 0, offset = 0; i < prev_size; i++) {
+    if (marked[offset]) {
+      array[size] = prev_array[i];
+      array[size].tag = mpi_rank;
+      size++;
+    }
+    offset += prev_array[i].level;
+  }
+  delete[] marked;
+
+  const int use_node_index = 1;
+  return new TMRQuadrantArray(array, size, use_node_index);
+}
+
+/*
+  Map the local node numbers from the previous call to createNodes()
+  to the local node numbers in the new node array
+
+  input:
+  nodes:        the sorted array of the new nodes
+  node_offset:  the offset of each new node
+
+  returns: the new local number of each previous node or -1
+*/
+int *TMRQuadForest::mapPrevNodes(TMRQuadrantArray *nodes,
+                                 const int *node_offset) {
+  int node_size, prev_size;
+  TMRQuadrant *node_array, *prev_array;
+  nodes->getArray(&node_array, &node_size);
+  prev_nodes->getArray(&prev_array, &prev_size);
+  int prev_num_nodes = 0;
+  for (int i = 0; i < prev_size; i++) {
+    prev_num_nodes += prev_array[i].level;
+  }
+
+  int *node_map = new int[prev_num_nodes];
+  for (int i = 0, j = 0, offset = 0; i < prev_size; i++) {
+    while (j < node_size && node_array[j].compareNode(&prev_array[i]) < 0) {
+      j++;
+    }
+    int match =
+        (j < node_size && node_array[j].compareNode(&prev_array[i]) == 0);
+    for (int k = 0; k < prev_array[i].level; k++) {
+      node_map[offset + k] = (match ? node_offset[j] + k : -1);
+    }
+    offset += prev_array[i].level;
+  }
+
+  return node_map;
+}
+
+/*
+  Free the data kept from the previous call to createNodes()
+*/
+void TMRQuadForest::freePrevNodes() {
+  if (prev_quadrants) {
+    delete prev_quadrants;
+  }
+  if (prev_nodes) {
+    delete prev_nodes;
+  }
+  if (prev_conn) {
+    delete[] prev_conn;
+  }
+  prev_quadrants = NULL;
+  prev_nodes = NULL;
+  prev_conn = NULL;
+}
+
+/*
+  Create the dependent mesh information for all local dependent
+  nodes.
+
+  output:
+  ptr:      pointer for each dependent node number
+  conn:     connectivity to each (global) independent node
+  weights:  the weight values for each dependent node
+*/
+void TMRQuadForest::createDependentConn(const int *node_nums,
+                                        TMRQuadrantArray *nodes,
+                                        const int *node_offset) {
+  // Allocate space for the connectivity
   dep_ptr = new int[num_dep_nodes + 1];
   for (int k = 0; k < num_dep_nodes + 1; k++) {
     dep_ptr[k] = k * mesh_order;
@@ -3681,7 +4660,23 @@ void TMRQuadForest::createDependentConn(const int *node_nums,
 
   // Allocate the space for the node numbers
   dep_conn = new int[mesh_order * num_dep_nodes];
-  dep_weights = new double[mesh_order * num_dep_nodes];
+  dep_tmpl = new int[num_dep_nodes];
+
+  // Compute the weight templates. The weights of a dependent node
+  // depend only on the position of the child along the parent edge
+  // and the index of the node along the edge.
+  dep_tmpl_weights = new double[2 * mesh_order * mesh_order];
+  for (int x = 0; x < 2; x++) {
+    for (int k = 0; k < mesh_order; k++) {
+      double *N = &dep_tmpl_weights[mesh_order * (mesh_order * x + k)];
+      if (interp_type == TMR_BERNSTEIN_POINTS) {
+        eval_bernstein_weights(mesh_order, (mesh_order - 1) * (x - 1) + k, N);
+      } else {
+        double u = 1.0 * (x - 1) + 0.5 * (1.0 + interp_knots[k]);
+        lagrange_shape_functions(mesh_order, u, interp_knots, interp_wts, N);
+      }
+    }
+  }
 
   // Get the quadrants
   int num_elements;
@@ -3777,75 +4772,33 @@ void TMRQuadForest::createDependentConn(const int *node_nums,
 
           // Set the offset into the local connectivity array
           const int *c = &conn[mesh_order * mesh_order * i];
-          if (interp_type == TMR_BERNSTEIN_POINTS) {
-            for (int k = 0; k < mesh_order; k++) {
-              // Compute the offset to the local edge
-              int offset = 0;
-              if (edge_index < 2) {
-                offset = k * mesh_order + (mesh_order - 1) * edge_index;
-              } else {
-                offset = k + (mesh_order - 1) * mesh_order * (edge_index % 2);
-              }
-
-              // If it's a negative number, it's a dependent node
-              // whose interpolation must be set
-              int index = node_nums[c[offset]];
-              if (index < 0) {
-                index = -index - 1;
-
-                // Compute the shape functions
-                int ptr = dep_ptr[index];
-                for (int j = 0; j < mesh_order; j++) {
-                  dep_conn[ptr + j] = edge_nodes[j];
-                }
+          for (int k = 0; k < mesh_order; k++) {
+            // Compute the offset to the local edge
+            int offset = 0;
+            if (edge_index < 2) {
+              offset = k * mesh_order + (mesh_order - 1) * edge_index;
+            } else {
+              offset = k + (mesh_order - 1) * mesh_order * (edge_index % 2);
+            }
 
-                // Compute parametric location along the edge
-                int u = 0.0;
-                if (edge_index < 2) {
-                  u = (mesh_order - 1) * (-1 + (quads[i].childId() / 2)) + k;
-                } else {
-                  u = (mesh_order - 1) * (-1 + (quads[i].childId() % 2)) + k;
-                }
+            // If it's a negative number, it's a dependent node
+            // whose interpolation must be set
+            int index = node_nums[c[offset]];
+            if (index < 0) {
+              index = -index - 1;
 
-                // Evaluate dependent weights
-                eval_bernstein_weights(mesh_order, u, &dep_weights[ptr]);
+              // Set the connectivity
+              int ptr = dep_ptr[index];
+              for (int j = 0; j < mesh_order; j++) {
+                dep_conn[ptr + j] = edge_nodes[j];
               }
-            }
-          } else {
-            for (int k = 0; k < mesh_order; k++) {
-              // Compute the offset to the local edge
-              int offset = 0;
+
+              // Set the weight template from the position of the
+              // child along the parent edge
               if (edge_index < 2) {
-                offset = k * mesh_order + (mesh_order - 1) * edge_index;
+                dep_tmpl[index] = mesh_order * (quads[i].childId() / 2) + k;
               } else {
-                offset = k + (mesh_order - 1) * mesh_order * (edge_index % 2);
-              }
-
-              // If it's a negative number, it's a dependent node
-              // whose interpolation must be set
-              int index = node_nums[c[offset]];
-              if (index < 0) {
-                index = -index - 1;
-
-                // Compute the shape functions
-                int ptr = dep_ptr[index];
-                for (int j = 0; j < mesh_order; j++) {
-                  dep_conn[ptr + j] = edge_nodes[j];
-                }
-
-                // Compute parametric location along the edge
-                double u = 0.0;
-                if (edge_index < 2) {
-                  u = 1.0 * (-1 + (quads[i].childId() / 2)) +
-                      0.5 * (1.0 + interp_knots[k]);
-                } else {
-                  u = 1.0 * (-1 + (quads[i].childId() % 2)) +
-                      0.5 * (1.0 + interp_knots[k]);
-                }
-
-                // Evaluate the shape functions
-                lagrange_shape_functions(mesh_order, u, interp_knots,
-                                         &dep_weights[ptr]);
+                dep_tmpl[index] = mesh_order * (quads[i].childId() % 2) + k;
               }
             }
           }
@@ -3867,6 +4820,7 @@ void TMRQuadForest::evaluateNodeLocations() {
 
   int *flags = new int[num_local_nodes];
   memset(flags, 0, num_local_nodes * sizeof(int));
+  addTransient(num_local_nodes * sizeof(int));
 
   int num_elements;
   TMRQuadrant *quads;
@@ -3929,13 +4883,12 @@ void TMRQuadForest::evaluateNodeLocations() {
       double u = convert_to_coordinate(quads[i].x);
       double v = convert_to_coordinate(quads[i].y);
 
-      for (int jj = 0; jj < mesh_order; jj++) {
-        for (int ii = 0; ii < mesh_order; ii++) {
-          int local_index = ii + jj * mesh_order;
-          surf->evalPoint(u + 0.5 * d * (1.0 + knots[ii]),
-                          v + 0.5 * d * (1.0 + knots[jj]), &Xtmp[local_index]);
-        }
+      double upts[MAX_ORDER], vpts[MAX_ORDER];
+      for (int ii = 0; ii < mesh_order; ii++) {
+        upts[ii] = u + 0.5 * d * (1.0 + knots[ii]);
+        vpts[ii] = v + 0.5 * d * (1.0 + knots[ii]);
       }
+      evalNodeGrid(surf, quads[i].face, mesh_order, upts, vpts, Xtmp);
 
       for (int jj = 0; jj < mesh_order; jj++) {
         for (int ii = 0; ii < mesh_order; ii++) {
@@ -3975,6 +4928,9 @@ void TMRQuadForest::evaluateNodeLocations() {
       double v = convert_to_coordinate(quads[i].y);
 
       // Look for nodes that are not assigned
+      int npts = 0;
+      int indices[MAX_ORDER * MAX_ORDER];
+      double upts[MAX_ORDER * MAX_ORDER], vpts[MAX_ORDER * MAX_ORDER];
       for (int jj = 0; jj < mesh_order; jj++) {
         for (int ii = 0; ii < mesh_order; ii++) {
           // Compute the mesh index
@@ -3982,17 +4938,105 @@ void TMRQuadForest::evaluateNodeLocations() {
           int index = getLocalNodeNumber(node);
           if (!flags[index]) {
             flags[index] = 1;
-            surf->evalPoint(u + 0.5 * d * (1.0 + knots[ii]),
-                            v + 0.5 * d * (1.0 + knots[jj]), &X[index]);
+            indices[npts] = index;
+            upts[npts] = u + 0.5 * d * (1.0 + knots[ii]);
+            vpts[npts] = v + 0.5 * d * (1.0 + knots[jj]);
+            npts++;
           }
         }
       }
+
+      // Evaluate the new nodes together
+      TMRPoint Xpts[MAX_ORDER * MAX_ORDER];
+      evalNodePoints(surf, quads[i].face, npts, upts, vpts, Xpts);
+      for (int k = 0; k < npts; k++) {
+        X[indices[k]] = Xpts[k];
+      }
     }
   }
 
+  removeTransient(num_local_nodes * sizeof(int));
   delete[] flags;
 }
 
+/*
+  Evaluate the locations of a set of points on a surface
+
+  The points are retrieved from the cache of node locations if they
+  have already been evaluated. The remaining points are evaluated from
+  the surface together and added to the cache. At most
+  MAX_ORDER*MAX_ORDER points can be evaluated at once.
+*/
+void TMRQuadForest::evalNodePoints(TMRFace *surf, int face, int npts,
+                                   const double u[], const double v[],
+                                   TMRPoint X[]) {
+  if (!node_cache) {
+    surf->evalPoints(npts, u, v, X);
+    return;
+  }
+
+  // Find the points that are not in the cache
+  int nmiss = 0;
+  int miss[MAX_ORDER * MAX_ORDER];
+  double umiss[MAX_ORDER * MAX_ORDER], vmiss[MAX_ORDER * MAX_ORDER];
+  for (int i = 0; i < npts; i++) {
+    if (!node_cache->getPoint(face, u[i], v[i], 0.0, &X[i])) {
+      miss[nmiss] = i;
+      umiss[nmiss] = u[i];
+      vmiss[nmiss] = v[i];
+      nmiss++;
+    }
+  }
+
+  if (nmiss > 0) {
+    TMRPoint Xmiss[MAX_ORDER * MAX_ORDER];
+    surf->evalPoints(nmiss, umiss, vmiss, Xmiss);
+    for (int k = 0; k < nmiss; k++) {
+      X[miss[k]] = Xmiss[k];
+      node_cache->addPoint(face, u[miss[k]], v[miss[k]], 0.0, &Xmiss[k]);
+    }
+  }
+}
+
+/*
+  Evaluate the locations of the n^2 tensor grid of points on a
+  surface, X[i + n*j] at (u[i], v[j])
+
+  The grid is evaluated from the surface unless all of the points are
+  already in the cache. The points that are in the cache are retrieved
+  from it, while the remaining points are added to the cache.
+*/
+void TMRQuadForest::evalNodeGrid(TMRFace *surf, int face, int n,
+                                 const double u[], const double v[],
+                                 TMRPoint X[]) {
+  if (node_cache) {
+    int nmiss = 0;
+    for (int j = 0; j < n; j++) {
+      for (int i = 0; i < n; i++) {
+        if (!node_cache->getPoint(face, u[i], v[j], 0.0, &X[i + n * j])) {
+          nmiss++;
+        }
+      }
+    }
+    if (nmiss == 0) {
+      return;
+    }
+  }
+
+  surf->evalGrid(n, u, n, v, X);
+
+  if (node_cache) {
+    for (int j = 0; j < n; j++) {
+      for (int i = 0; i < n; i++) {
+        TMRPoint *pt = &X[i + n * j];
+        if (!node_cache->getPoint(face, u[i], v[j], 0.0, pt)) {
+          node_cache->addPoint(face, u[i], v[j], 0.0, pt);
+        }
+      }
+    }
+  }
+}
+
 /*
   Get the nodal connectivity. This can only be called after the nodes
   have been created.
@@ -4040,177 +5084,113 @@ int TMRQuadForest::getDepNodeConn(const int **ptr, const int **conn,
     *conn = dep_conn;
   }
   if (weights) {
+    // Expand the weights from the templates the first time they
+    // are requested
+    if (!dep_weights && dep_tmpl) {
+      dep_weights = new double[mesh_order * num_dep_nodes];
+      for (int i = 0; i < num_dep_nodes; i++) {
+        memcpy(&dep_weights[mesh_order * i],
+               &dep_tmpl_weights[mesh_order * dep_tmpl[i]],
+               mesh_order * sizeof(double));
+      }
+    }
     *weights = dep_weights;
   }
   return num_dep_nodes;
 }
 
 /*
-  Get the elements that either lie on a face or curve with a given
-  name.
+  Get the compact form of the dependent node weights. Note that this
+  call is not collective.
 
-  This code loops over all quadrants owned locally on this processor
-  and checks if each quadrant lies on a face or boundary. If the face
-  name matches, the quadrant is added without modification. If
-  the quadrant lies on an edge, the quadrant is modified so that the
-  info indicates which edge the quadrant lies on using the regular edge
-  ordering scheme.
+  The weights of each dependent node are stored as an index into a
+  small table of templates that depend only on the mesh order, the
+  interpolation type and the position of the node on the refined
+  edge. The weights of dependent node i are the mesh_order entries
+  starting at &tmpl_weights[mesh_order*tmpl[i]].
 
-  input:
-  name:   string name associated with the geometric feature
+  output:
+  tmpl:          the template index for each dependent node
+  tmpl_weights:  the table of templates
 
-  returns:
-  list:   an array of quadrants satisfying the name
+  returns:       the number of dependent nodes
 */
-TMRQuadrantArray *TMRQuadForest::getQuadsWithName(const char *name) {
-  if (!topo) {
-    fprintf(stderr,
-            "TMRQuadForest Error: Must define topology to use "
-            "getQuadsWithName()\n");
-    return NULL;
-  }
-  if (!quadrants) {
-    fprintf(stderr,
-            "TMRQuadForest Error: Must create quadrants to use "
-            "getQuadsWithName()\n");
-    return NULL;
+int TMRQuadForest::getDepNodeTemplates(const int **tmpl,
+                                       const double **tmpl_weights) {
+  if (tmpl) {
+    *tmpl = dep_tmpl;
   }
-
-  // Create a queue to store the elements that we find
-  TMRQuadrantQueue *queue = new TMRQuadrantQueue();
-
-  // Get the quadrants
-  int size;
-  TMRQuadrant *array;
-  quadrants->getArray(&array, &size);
-
-  // Loop over the quadrants and find out whether it touches
-  // a face or edge with the prescribed name
-  const int32_t hmax = 1 << TMR_MAX_LEVEL;
-  for (int i = 0; i < size; i++) {
-    const int32_t h = 1 << (TMR_MAX_LEVEL - array[i].level);
-
-    // Get the surface quadrant
-    TMRFace *surf;
-    topo->getFace(array[i].face, &surf);
-    const char *face_name = surf->getName();
-    if ((!name && !face_name) || (face_name && strcmp(face_name, name) == 0)) {
-      queue->push(&array[i]);
-    } else {
-      // If this quadrant was not added from a face
-      // name, check to see if it should be added
-      // as an edge/curve name
-      TMREdge *edge;
-      if (array[i].x == 0) {
-        int edge_num = fdata->face_edge_conn[4 * array[i].face];
-        topo->getEdge(edge_num, &edge);
-        const char *edge_name = edge->getName();
-        if (edge_name && strcmp(edge_name, name) == 0) {
-          TMRQuadrant p = array[i];
-          p.info = 0;
-          queue->push(&p);
-        }
-      }
-      if (array[i].x + h == hmax) {
-        int edge_num = fdata->face_edge_conn[4 * array[i].face + 1];
-        topo->getEdge(edge_num, &edge);
-        const char *edge_name = edge->getName();
-        if (edge_name && strcmp(edge_name, name) == 0) {
-          TMRQuadrant p = array[i];
-          p.info = 1;
-          queue->push(&p);
-        }
-      }
-      if (array[i].y == 0) {
-        int edge_num = fdata->face_edge_conn[4 * array[i].face + 2];
-        topo->getEdge(edge_num, &edge);
-        const char *edge_name = edge->getName();
-        if (edge_name && strcmp(edge_name, name) == 0) {
-          TMRQuadrant p = array[i];
-          p.info = 2;
-          queue->push(&p);
-        }
-      }
-      if (array[i].y + h == hmax) {
-        int edge_num = fdata->face_edge_conn[4 * array[i].face + 3];
-        topo->getEdge(edge_num, &edge);
-        const char *edge_name = edge->getName();
-        if (edge_name && strcmp(edge_name, name) == 0) {
-          TMRQuadrant p = array[i];
-          p.info = 3;
-          queue->push(&p);
-        }
-      }
-    }
+  if (tmpl_weights) {
+    *tmpl_weights = dep_tmpl_weights;
   }
-
-  TMRQuadrantArray *list = queue->toArray();
-  delete queue;
-  return list;
+  return num_dep_nodes;
 }
 
 /*
-  Create an array of the nodes that are lie on a surface, edge or
-  corner with a given name
-
-  This code loops over all nodes and check whether they lie on a
-  geometric entity that has the given name. The nodes are not
-  unique if they are lie on a shared boundary between processors.
-
-  input:
-  name:   the string of the name to search
-
-  returns:
-  list:   the nodes matching the specified name
+  Create the index from the names of the topological entities to the
+  local quadrants and nodes
+
+  A quadrant is added for the name of its face and, for each named
+  edge of the face that it touches with a different name, a copy of
+  the quadrant is added with the edge index as its info. The nodes of
+  the quadrant that lie on each named vertex, edge or face are added
+  for the name of that entity. The nodes are only added when the
+  connectivity has been created.
 */
-int TMRQuadForest::getNodesWithName(const char *name, int **_nodes) {
-  if (!topo) {
-    fprintf(stderr,
-            "TMRQuadForest Error: Must define topology to use "
-            "getNodesWithName()\n");
-    *_nodes = NULL;
-    return 0;
-  }
-  if (!conn) {
-    fprintf(stderr,
-            "TMRQuadForest Error: Nodes must be created before "
-            "calling getNodesWithName()\n");
-    *_nodes = NULL;
-    return 0;
-  }
+TMRNameIndex *TMRQuadForest::createNameIndex() {
+  TMRNameIndex *index = new TMRNameIndex(topo);
 
   // The maximum quadrant edge length
   const int32_t hmax = 1 << TMR_MAX_LEVEL;
 
-  // Get the local nodal quadrants
+  // Get the local quadrants
   int size;
   TMRQuadrant *quads;
   quadrants->getArray(&quads, &size);
 
-  int count = 0;                      // Current node count
-  int max_len = 1024;                 // max length of the node list
-  int *node_list = new int[max_len];  // Nodes touching this name
+  for (int i = 0; i < size; i++) {
+    // Compute the quadrant edge length
+    const int32_t h = 1 << (TMR_MAX_LEVEL - quads[i].level);
 
-  // Max number of nodes added by one quadrant
-  const int max_node_incr = 4 + 4 * mesh_order + mesh_order * mesh_order;
+    // Keep track of which edges this element touches
+    int nedges = 0;
+    int edge_index[4];
+    if (quads[i].x == 0) {
+      edge_index[nedges] = 0;
+      nedges++;
+    }
+    if (quads[i].x + h == hmax) {
+      edge_index[nedges] = 1;
+      nedges++;
+    }
+    if (quads[i].y == 0) {
+      edge_index[nedges] = 2;
+      nedges++;
+    }
+    if (quads[i].y + h == hmax) {
+      edge_index[nedges] = 3;
+      nedges++;
+    }
 
-  // Loop over the quadrants and find out whether it touches a face or
-  // edge with the prescribed name
-  for (int i = 0; i < size; i++) {
-    if (count + max_node_incr > max_len) {
-      // Extend the length of the array
-      max_len = 2 * max_len + max_node_incr;
-      int *tmp = new int[max_len];
-      memcpy(tmp, node_list, count * sizeof(int));
-      delete[] node_list;
-      node_list = tmp;
+    // Add the quadrant for the face name and the edge names
+    int face_name = index->getFaceName(quads[i].face);
+    index->addElement(face_name, i, -1);
+    for (int ii = 0; ii < nedges; ii++) {
+      int edge_num = fdata->face_edge_conn[4 * quads[i].face + edge_index[ii]];
+      int edge_name = index->getEdgeName(edge_num);
+      if (edge_name > 0 && edge_name != face_name) {
+        index->addElement(edge_name, i, edge_index[ii]);
+      }
     }
 
-    // Compute the quadrant edge length
-    const int32_t h = 1 << (TMR_MAX_LEVEL - quads[i].level);
+    if (!conn) {
+      continue;
+    }
+
+    // Set a pointer into the connectivity array
+    const int *c = &conn[mesh_order * mesh_order * quads[i].tag];
 
-    // Check if this node is on a corner, edge or face, and whether it
-    // shares the appropriate name
+    // Check if this node is on a corner
     int fx0 = (quads[i].x == 0);
     int fy0 = (quads[i].y == 0);
     int fx = (fx0 || quads[i].x + h == hmax);
@@ -4238,142 +5218,177 @@ int TMRQuadForest::getNodesWithName(const char *name, int **_nodes) {
       }
 
       for (int ii = 0; ii < ncorners; ii++) {
-        TMRVertex *vert;
         int vert_num = fdata->face_conn[4 * quads[i].face + corner_index[ii]];
-        topo->getVertex(vert_num, &vert);
-        const char *vert_name = vert->getName();
-        if (vert_name && strcmp(vert_name, name) == 0) {
+        int vert_name = index->getVertexName(vert_num);
+        if (vert_name > 0) {
           int offset = ((mesh_order - 1) * (corner_index[ii] % 2) +
                         (mesh_order - 1) * mesh_order * (corner_index[ii] / 2));
-          node_list[count] =
-              conn[mesh_order * mesh_order * quads[i].tag + offset];
-          count++;
+          index->addNode(vert_name, c[offset]);
         }
       }
     }
-    if (fx || fy) {
-      // Keep track of which edges this element touches
-      int nedges = 0;
-      int edge_index[4];
-      if (quads[i].x == 0) {
-        edge_index[nedges] = 0;
-        nedges++;
-      }
-      if (quads[i].x + h == hmax) {
-        edge_index[nedges] = 1;
-        nedges++;
-      }
-      if (quads[i].y == 0) {
-        edge_index[nedges] = 2;
-        nedges++;
-      }
-      if (quads[i].y + h == hmax) {
-        edge_index[nedges] = 3;
-        nedges++;
-      }
 
-      for (int ii = 0; ii < nedges; ii++) {
-        TMREdge *edge;
-        int edge_num =
-            fdata->face_edge_conn[4 * quads[i].face + edge_index[ii]];
-        topo->getEdge(edge_num, &edge);
-        const char *edge_name = edge->getName();
-        if (edge_name && strcmp(edge_name, name) == 0) {
-          for (int k = 0; k < mesh_order; k++) {
-            int offset = 0;
-            if (edge_index[ii] < 2) {
-              offset = k * mesh_order + (mesh_order - 1) * edge_index[ii];
-            } else {
-              offset = k + (mesh_order - 1) * mesh_order * (edge_index[ii] % 2);
-            }
-            node_list[count] =
-                conn[mesh_order * mesh_order * quads[i].tag + offset];
-            count++;
+    // Add the nodes on the edges
+    for (int ii = 0; ii < nedges; ii++) {
+      int edge_num = fdata->face_edge_conn[4 * quads[i].face + edge_index[ii]];
+      int edge_name = index->getEdgeName(edge_num);
+      if (edge_name > 0) {
+        for (int k = 0; k < mesh_order; k++) {
+          int offset = 0;
+          if (edge_index[ii] < 2) {
+            offset = k * mesh_order + (mesh_order - 1) * edge_index[ii];
+          } else {
+            offset = k + (mesh_order - 1) * mesh_order * (edge_index[ii] % 2);
           }
+          index->addNode(edge_name, c[offset]);
         }
       }
     }
 
-    // This node lies on the face
-    TMRFace *face;
-    topo->getFace(quads[i].face, &face);
-    const char *face_name = face->getName();
-    if (face_name && strcmp(face_name, name) == 0) {
-      for (int jj = 0; jj < mesh_order; jj++) {
-        for (int ii = 0; ii < mesh_order; ii++) {
-          int offset = ii + jj * mesh_order;
-          node_list[count] =
-              conn[mesh_order * mesh_order * quads[i].tag + offset];
-          count++;
-        }
+    // Add the nodes on the face
+    if (face_name > 0) {
+      for (int k = 0; k < mesh_order * mesh_order; k++) {
+        index->addNode(face_name, c[k]);
       }
     }
   }
 
-  // Now, sort the node numbers and remove duplicates
-  qsort(node_list, count, sizeof(int), compare_integers);
-
-  // Remove duplicates from the array
-  int len = 0;
-  for (int ptr = 0; ptr < count; ptr++, len++) {
-    while ((ptr < count - 1) && (node_list[ptr] == node_list[ptr + 1])) {
-      ptr++;
-    }
-
-    if (ptr != len) {
-      node_list[len] = node_list[ptr];
-    }
-  }
-
-  *_nodes = node_list;
-  return len;
+  index->finalize();
+  return index;
 }
 
 /*
-  Given a node, find the enclosing quadrant
+  Get the elements that either lie on a face or curve with a given
+  name.
 
-  This code is used to find the quadrant in the quadrant array that
-  encloses the given node.
-*/
-TMRQuadrant *TMRQuadForest::findEnclosing(const int order, const double *knots,
-                                          TMRQuadrant *node, int *mpi_owner) {
-  // Assume that we'll find octant on this processor for now..
-  if (mpi_owner) {
-    *mpi_owner = mpi_rank;
+  The quadrants are found from the name index. If the face name
+  matches, the quadrant is added without modification. If the
+  quadrant lies on an edge, the quadrant is modified so that the info
+  indicates which edge the quadrant lies on using the regular edge
+  ordering scheme. Once the nodes have been created, the index is
+  stored and re-used until the mesh data is freed, so that each call
+  only costs the size of the result.
+
+  input:
+  name:   string name associated with the geometric feature
+
+  returns:
+  list:   an array of quadrants satisfying the name
+*/
+TMRQuadrantArray *TMRQuadForest::getQuadsWithName(const char *name) {
+  if (!topo) {
+    fprintf(stderr,
+            "TMRQuadForest Error: Must define topology to use "
+            "getQuadsWithName()\n");
+    return NULL;
+  }
+  if (!quadrants) {
+    fprintf(stderr,
+            "TMRQuadForest Error: Must create quadrants to use "
+            "getQuadsWithName()\n");
+    return NULL;
   }
 
-  // Retrieve the array of elements
-  int size = 0;
-  TMRQuadrant *array = NULL;
+  // Discard the stored index if an entity has been renamed
+  if (name_index && !name_index->isCurrent()) {
+    name_index->decref();
+    name_index = NULL;
+  }
+
+  // Use the stored index if the nodes exist, otherwise create a
+  // temporary index for the quadrants alone
+  TMRNameIndex *index = name_index;
+  if (!index) {
+    index = createNameIndex();
+    if (conn) {
+      name_index = index;
+      name_index->incref();
+    }
+  }
+  index->incref();
+
+  // Get the quadrants
+  int size;
+  TMRQuadrant *array;
   quadrants->getArray(&array, &size);
 
-  // Set the lower and upper bounds for the quadrant
-  const int32_t face = node->face;
-  const int32_t h = 1 << (TMR_MAX_LEVEL - node->level);
+  const int *elems, *info;
+  int nelems = index->getElements(name, &elems, &info);
+  TMRQuadrant *list = new TMRQuadrant[nelems];
+  for (int i = 0; i < nelems; i++) {
+    list[i] = array[elems[i]];
+    if (info[i] >= 0) {
+      list[i].info = info[i];
+    }
+  }
+  index->decref();
 
-  // Compute the ii/jj locations
-  const int ii = node->info % order;
-  const int jj = node->info / order;
+  return new TMRQuadrantArray(list, nelems);
+}
 
-  // Compute the integer locations for the x/y nodes if they lie
-  // exactly along a coordinate line. These will take precidence over
-  // the real value parametric locations since comparisons will be
-  // exact.
-  int32_t xi = -1, yi = -1;
-  if (ii == 0 || ii == order - 1) {
-    xi = node->x + (ii / (order - 1)) * h;
-  } else if (order % 2 == 1 && ii == order / 2) {
-    xi = node->x + h / 2;
+/*
+  Create an array of the nodes that are lie on a surface, edge or
+  corner with a given name
+
+  The nodes are those that lie on a vertex, edge or face with the
+  given name. The nodes are found from the name index that is created
+  once for each set of nodes.
+
+  input:
+  name:   the string of the name to search
+
+  returns:
+  list:   the sorted nodes matching the specified name
+*/
+int TMRQuadForest::getNodesWithName(const char *name, int **_nodes) {
+  if (!topo) {
+    fprintf(stderr,
+            "TMRQuadForest Error: Must define topology to use "
+            "getNodesWithName()\n");
+    *_nodes = NULL;
+    return 0;
   }
-  if (jj == 0 || jj == order - 1) {
-    yi = node->y + (jj / (order - 1)) * h;
-  } else if (order % 2 == 1 && jj == order / 2) {
-    yi = node->y + h / 2;
+  if (!conn) {
+    fprintf(stderr,
+            "TMRQuadForest Error: Nodes must be created before "
+            "calling getNodesWithName()\n");
+    *_nodes = NULL;
+    return 0;
   }
 
-  // Compute the parametric node location on this block
-  const double xd = node->x + 0.5 * h * (1.0 + knots[ii]);
-  const double yd = node->y + 0.5 * h * (1.0 + knots[jj]);
+  // Create the index if it does not exist or an entity has been renamed
+  if (name_index && !name_index->isCurrent()) {
+    name_index->decref();
+    name_index = NULL;
+  }
+  if (!name_index) {
+    name_index = createNameIndex();
+    name_index->incref();
+  }
+
+  const int *nodes;
+  int len = name_index->getNodes(name, &nodes);
+  int *node_list = new int[len];
+  memcpy(node_list, nodes, len * sizeof(int));
+
+  *_nodes = node_list;
+  return len;
+}
+
+/*
+  Find the index in the element array at which to begin the search
+  for the element that encloses a node
+
+  The search only uses the position of the element that contains the
+  node and not the node index itself. The result can therefore be
+  computed once and passed to findEnclosing() for every node of the
+  same element.
+*/
+int TMRQuadForest::findEnclosingStart(TMRQuadrant *node) {
+  // Retrieve the array of elements
+  int size = 0;
+  TMRQuadrant *array = NULL;
+  quadrants->getArray(&array, &size);
 
   // Set the low and high indices to the first and last
   // element of the element array
@@ -4407,6 +5422,65 @@ TMRQuadrant *TMRQuadForest::findEnclosing(const int order, const double *knots,
     mid = low + (int)((high - low) / 2);
   }
 
+  return mid;
+}
+
+/*
+  Given a node, find the enclosing quadrant
+
+  This code is used to find the quadrant in the quadrant array that
+  encloses the given node. The optional search_start is the index
+  returned by findEnclosingStart() for the element of the node.
+*/
+TMRQuadrant *TMRQuadForest::findEnclosing(const int order, const double *knots,
+                                          TMRQuadrant *node, int *mpi_owner,
+                                          int search_start) {
+  // Assume that we'll find octant on this processor for now..
+  if (mpi_owner) {
+    *mpi_owner = mpi_rank;
+  }
+
+  // Retrieve the array of elements
+  int size = 0;
+  TMRQuadrant *array = NULL;
+  quadrants->getArray(&array, &size);
+
+  // Set the lower and upper bounds for the quadrant
+  const int32_t face = node->face;
+  const int32_t h = 1 << (TMR_MAX_LEVEL - node->level);
+
+  // Compute the ii/jj locations
+  const int ii = node->info % order;
+  const int jj = node->info / order;
+
+  // Compute the integer locations for the x/y nodes if they lie
+  // exactly along a coordinate line. These will take precidence over
+  // the real value parametric locations since comparisons will be
+  // exact.
+  int32_t xi = -1, yi = -1;
+  if (ii == 0 || ii == order - 1) {
+    xi = node->x + (ii / (order - 1)) * h;
+  } else if (order % 2 == 1 && ii == order / 2) {
+    xi = node->x + h / 2;
+  }
+  if (jj == 0 || jj == order - 1) {
+    yi = node->y + (jj / (order - 1)) * h;
+  } else if (order % 2 == 1 && jj == order / 2) {
+    yi = node->y + h / 2;
+  }
+
+  // Compute the parametric node location on this block
+  const double xd = node->x + 0.5 * h * (1.0 + knots[ii]);
+  const double yd = node->y + 0.5 * h * (1.0 + knots[jj]);
+
+  // Find the index at which to start the search. This depends only
+  // on the element that contains the node, so it can be provided by
+  // the caller for all the nodes of one element.
+  int mid = search_start;
+  if (mid < 0 || mid >= size) {
+    mid = findEnclosingStart(node);
+  }
+
   // Compute the bounding quadrant. Quadrants greater than this quad
   // cannot own the node so a further search is futile.
   TMRQuadrant quad;
@@ -4580,7 +5654,8 @@ int TMRQuadForest::computeElemInterp(TMRQuadrant *node, TMRQuadForest *coarse,
       double u =
           -1.0 +
           2.0 * (node->x + 0.5 * h * (1.0 + interp_knots[i]) - quad->x) / hc;
-      lagrange_shape_functions(coarse->mesh_order, u, coarse->interp_knots, Nu);
+      lagrange_shape_functions(coarse->mesh_order, u, coarse->interp_knots,
+                               coarse->interp_wts, Nu);
     }
     if ((j == 0 && quad->y == node->y) ||
         (j == mesh_order - 1 && quad->y == node->y + h)) {
@@ -4596,15 +5671,18 @@ int TMRQuadForest::computeElemInterp(TMRQuadrant *node, TMRQuadForest *coarse,
       double v =
           -1.0 +
           2.0 * (node->y + 0.5 * h * (1.0 + interp_knots[j]) - quad->y) / hc;
-      lagrange_shape_functions(coarse->mesh_order, v, coarse->interp_knots, Nv);
+      lagrange_shape_functions(coarse->mesh_order, v, coarse->interp_knots,
+                               coarse->interp_wts, Nv);
     }
   }
 
   // Get the coarse grid information
   const int *cdep_ptr;
   const int *cdep_conn;
-  const double *cdep_weights;
-  coarse->getDepNodeConn(&cdep_ptr, &cdep_conn, &cdep_weights);
+  const int *cdep_tmpl;
+  const double *cdep_tmpl_weights;
+  coarse->getDepNodeConn(&cdep_ptr, &cdep_conn);
+  coarse->getDepNodeTemplates(&cdep_tmpl, &cdep_tmpl_weights);
 
   // Get the coarse connectivity array
   const int num = quad->tag;
@@ -4627,17 +5705,21 @@ int TMRQuadForest::computeElemInterp(TMRQuadrant *node, TMRQuadForest *coarse,
         nweights++;
       } else {
         int node = -c[offset] - 1;
+        const double *Nd =
+            &cdep_tmpl_weights[coarse->mesh_order * cdep_tmpl[node]];
         for (int jp = cdep_ptr[node]; jp < cdep_ptr[node + 1]; jp++) {
           weights[nweights].index = cdep_conn[jp];
-          weights[nweights].weight = weight * cdep_weights[jp];
+          weights[nweights].weight = weight * Nd[jp - cdep_ptr[node]];
           nweights++;
         }
       }
     }
   }
 
-  // Sort and add up the weight values
+  // Sort and add up the weight values and remove the zero weights
   nweights = TMRIndexWeight::uniqueSort(weights, nweights);
+  nweights = TMRIndexWeight::removeSmallWeights(weights, nweights,
+                                                TMR_INTERP_WEIGHT_TOL);
 
   return nweights;
 }
@@ -4659,14 +5741,279 @@ int TMRQuadForest::computeElemInterp(TMRQuadrant *node, TMRQuadForest *coarse,
 */
 void TMRQuadForest::createInterpolation(TMRQuadForest *coarse,
                                         TACSBVecInterp *interp) {
+  TMR_TRACE_SCOPE("TMRQuadForest::createInterpolation");
+
+  // Use the stored interpolation if it matches the coarse forest
+  if (hasInterpCache(coarse)) {
+    interp_cache->setInterp(interp);
+    return;
+  }
+
+  // Record the transient memory used to create the interpolation
+  beginMemoryPhase(TMR_INTERP_PHASE);
+
+  // Record the interpolation as it is computed
+  TMRInterpCache *cache = NULL;
+  if (use_interp_cache) {
+    if (!interp_cache) {
+      interp_cache = new TMRInterpCache();
+      interp_cache->incref();
+    }
+    interp_cache->clear();
+    cache = interp_cache;
+  }
+
+  computeInterpolation(coarse, interp, cache);
+
+  if (cache) {
+    interp_cache_id = coarse->getEntityId();
+    interp_cache_stamp = coarse->node_stamp;
+  }
+}
+
+/*
+  Start recording the peak transient memory for a phase
+*/
+void TMRQuadForest::beginMemoryPhase(int phase) {
+  memory_phase = phase;
+  transient_bytes = 0;
+  peak_bytes[phase] = 0;
+}
+
+/*
+  Add the bytes of a transient allocation and update the peak
+*/
+void TMRQuadForest::addTransient(size_t bytes) {
+  transient_bytes += bytes;
+  if (transient_bytes > peak_bytes[memory_phase]) {
+    peak_bytes[memory_phase] = transient_bytes;
+  }
+}
+
+/*
+  Remove the bytes of a transient allocation that has been freed
+*/
+void TMRQuadForest::removeTransient(size_t bytes) {
+  if (bytes > transient_bytes) {
+    transient_bytes = 0;
+  } else {
+    transient_bytes -= bytes;
+  }
+}
+
+/*
+  Report the memory held by the major arrays of the forest
+
+  The report includes the peak transient memory allocated on top of
+  these arrays during the last calls to createNodes() and
+  createInterpolation(). The node location cache is shared with the
+  forests created from this one, and the face connectivity with all
+  forests created from the same topology. This call is collective on
+  the forest communicator, and the report is reduced across all
+  processors.
+
+  returns: the memory report
+*/
+TMRMemoryUsage *TMRQuadForest::getMemoryUsage() {
+  TMRMemoryUsage *usage = new TMRMemoryUsage();
+
+  int num_elements = 0;
+  if (quadrants) {
+    quadrants->getArray(NULL, &num_elements);
+  }
+  const int nodes_per_element = mesh_order * mesh_order;
+
+  usage->addArray("quadrants", quadrants ? quadrants->getMemoryUsage() : 0);
+  usage->addArray("adjacent", adjacent ? adjacent->getMemoryUsage() : 0);
+  usage->addArray("owners", owners ? mpi_size * sizeof(TMRQuadrant) : 0);
+  usage->addArray("conn",
+                  conn ? nodes_per_element * num_elements * sizeof(int) : 0);
+  usage->addArray("node_numbers",
+                  node_numbers ? num_local_nodes * sizeof(int) : 0);
+  usage->addArray("dep_ptr", dep_ptr ? (num_dep_nodes + 1) * sizeof(int) : 0);
+  int dep_size = (dep_ptr ? dep_ptr[num_dep_nodes] : 0);
+  usage->addArray("dep_conn", dep_conn ? dep_size * sizeof(int) : 0);
+  usage->addArray("dep_weights", dep_weights ? dep_size * sizeof(double) : 0);
+  usage->addArray("dep_tmpl", dep_tmpl ? num_dep_nodes * sizeof(int) : 0);
+  usage->addArray(
+      "dep_tmpl_weights",
+      dep_tmpl_weights ? 2 * mesh_order * mesh_order * sizeof(double) : 0);
+  usage->addArray("X", X ? num_local_nodes * sizeof(TMRPoint) : 0);
+  size_t prev_bytes = 0;
+  if (prev_quadrants) {
+    int prev_size;
+    prev_quadrants->getArray(NULL, &prev_size);
+    prev_bytes = prev_quadrants->getMemoryUsage() +
+                 prev_nodes->getMemoryUsage() +
+                 nodes_per_element * prev_size * sizeof(int);
+  }
+  usage->addArray("prev_nodes", prev_bytes);
+  usage->addArray("face_conn", fdata ? fdata->getMemoryUsage() : 0);
+  usage->addArray("node_cache", node_cache ? node_cache->getMemoryUsage() : 0);
+  usage->addArray("interp_cache",
+                  interp_cache ? interp_cache->getMemoryUsage() : 0);
+  usage->addPeak("createNodes peak", peak_bytes[TMR_NODES_PHASE]);
+  usage->addPeak("createInterpolation peak", peak_bytes[TMR_INTERP_PHASE]);
+
+  usage->reduce(comm);
+  return usage;
+}
+
+/*
+  Set whether to store the interpolation operator
+
+  When the flag is set, the interpolation created by
+  createInterpolation() is stored. Subsequent calls with the same
+  coarse forest add the stored operator directly, as long as the nodes
+  on neither forest have been re-created.
+*/
+void TMRQuadForest::setUseInterpCache(int flag) {
+  use_interp_cache = flag;
+  if (!use_interp_cache && interp_cache) {
+    interp_cache->decref();
+    interp_cache = NULL;
+  }
+}
+
+/*
+  Set whether to create the nodes incrementally
+
+  When the flag is set, the quadrants, the local nodes and the local
+  connectivity are kept after each call to createNodes(). The next
+  call reuses the local connectivity of the elements that are
+  unchanged since then, and only creates the nodes and connectivity of
+  the new elements and the nodes that the dependent nodes rely on. The
+  ownership and the global numbers of all nodes are still determined
+  by the full exchange. The flag is copied to the forests created from
+  this forest.
+*/
+void TMRQuadForest::setUseIncrementalNodes(int flag) {
+  use_incremental_nodes = flag;
+  if (!use_incremental_nodes) {
+    freePrevNodes();
+  }
+}
+
+/*
+  Write the interpolation from the coarse forest to a file
+
+  The interpolation is computed if it is not already stored. This is a
+  collective call.
+
+  input:
+  coarse:    the coarse quadtree forest that has the same layout as this
+  filename:  the name of the file
+
+  returns:
+  a non-zero value if the file cannot be written
+*/
+int TMRQuadForest::writeInterpolation(TMRQuadForest *coarse,
+                                      const char *filename) {
+  if (!hasInterpCache(coarse)) {
+    if (!interp_cache) {
+      interp_cache = new TMRInterpCache();
+      interp_cache->incref();
+    }
+    interp_cache->clear();
+    computeInterpolation(coarse, NULL, interp_cache);
+    interp_cache_id = coarse->getEntityId();
+    interp_cache_stamp = coarse->node_stamp;
+  }
+
+  int info[6];
+  getInterpCacheInfo(coarse, info);
+  return interp_cache->writeToFile(comm, filename, info, 6);
+}
+
+/*
+  Read the interpolation from the coarse forest from a file
+
+  The file must have been written by writeInterpolation() for forests
+  with the same partition and node numbering. After a successful read,
+  createInterpolation() with this coarse forest uses the stored
+  operator. This is a collective call.
+
+  input:
+  coarse:    the coarse quadtree forest that has the same layout as this
+  filename:  the name of the file
+
+  returns:
+  a non-zero value if the file cannot be read or does not match
+*/
+int TMRQuadForest::readInterpolation(TMRQuadForest *coarse,
+                                     const char *filename) {
+  createNodes();
+  coarse->createNodes();
+
+  if (!interp_cache) {
+    interp_cache = new TMRInterpCache();
+    interp_cache->incref();
+  }
+
+  int info[6];
+  getInterpCacheInfo(coarse, info);
+  int fail = interp_cache->readFromFile(comm, filename, info, 6);
+  if (fail) {
+    interp_cache->decref();
+    interp_cache = NULL;
+  } else {
+    interp_cache_id = coarse->getEntityId();
+    interp_cache_stamp = coarse->node_stamp;
+  }
+
+  return fail;
+}
+
+/*
+  Check whether the stored interpolation is from the coarse forest
+*/
+int TMRQuadForest::hasInterpCache(TMRQuadForest *coarse) {
+  // Make sure the nodes exist so that the node stamps are current
+  createNodes();
+  coarse->createNodes();
+
+  return (interp_cache && interp_cache_id == coarse->getEntityId() &&
+          interp_cache_stamp == coarse->node_stamp);
+}
+
+/*
+  Get the information used to check that a stored interpolation file
+  matches the forests
+*/
+void TMRQuadForest::getInterpCacheInfo(TMRQuadForest *coarse, int info[]) {
+  info[0] = mesh_order;
+  info[1] = coarse->mesh_order;
+  info[2] = interp_type;
+  info[3] = node_range[mpi_size];
+  info[4] = coarse->node_range[mpi_size];
+
+  int num_elements;
+  quadrants->getArray(NULL, &num_elements);
+  MPI_Allreduce(MPI_IN_PLACE, &num_elements, 1, MPI_INT, MPI_SUM, comm);
+  info[5] = num_elements;
+}
+
+/*
+  Compute the interpolation from the coarse forest
+
+  The rows of the interpolation are added to the interpolation object
+  and the cache, if either is provided.
+
+  The coarse search and the element interpolation for the owned nodes
+  are computed in parallel for each block of nodes. The interpolation
+  objects are not thread-safe, so the weights are added afterwards by
+  a single thread.
+*/
+void TMRQuadForest::computeInterpolation(TMRQuadForest *coarse,
+                                         TACSBVecInterp *interp,
+                                         TMRInterpCache *cache) {
   // Ensure that the nodes are allocated on both octree forests
   createNodes();
   coarse->createNodes();
 
   // Get the dependent node information
   const int *cdep_ptr, *cdep_conn;
-  const double *cdep_weights;
-  coarse->getDepNodeConn(&cdep_ptr, &cdep_conn, &cdep_weights);
+  coarse->getDepNodeConn(&cdep_ptr, &cdep_conn);
 
   // First, loop over the local list
   int local_size = node_range[mpi_rank + 1] - node_range[mpi_rank];
@@ -4700,8 +6047,18 @@ void TMRQuadForest::createInterpolation(TMRQuadForest *coarse,
   // Set the knots to use in the interpolation
   const double *knots = interp_knots;
 
+  // Find the element and local node used to interpolate each owned
+  // node, in the order in which the nodes are first visited, and the
+  // start of the coarse search, shared by the nodes of each element
+  int num_owned = 0;
+  int *owned_elems = new int[local_size];
+  int *owned_nodes = new int[local_size];
+  int *owned_starts = new int[local_size];
+  addTransient(4 * local_size * sizeof(int));
   for (int i = 0; i < num_elements; i++) {
     const int *c = &conn[nodes_per_element * i];
+    int search_start = -1;
+
     for (int j = 0; j < nodes_per_element; j++) {
       // Check if the fine node is owned by this processor
       if (c[j] >= node_range[mpi_rank] && c[j] < node_range[mpi_rank + 1]) {
@@ -4710,50 +6067,127 @@ void TMRQuadForest::createInterpolation(TMRQuadForest *coarse,
           // We're going to handle this node now, mark it as done
           flags[index] = 1;
 
-          // Find the enclosing coarse quad on this
-          // processor if it exits
-          TMRQuadrant node = quads[i];
-          node.info = j;
+          if (search_start < 0) {
+            TMRQuadrant node = quads[i];
+            node.info = j;
+            search_start = coarse->findEnclosingStart(&node);
+          }
+          owned_elems[num_owned] = i;
+          owned_nodes[num_owned] = j;
+          owned_starts[num_owned] = search_start;
+          num_owned++;
+        }
+      }
+    }
+  }
 
-          // Find the MPI owner or the
-          int mpi_owner = mpi_rank;
-          TMRQuadrant *t =
-              coarse->findEnclosing(mesh_order, knots, &node, &mpi_owner);
+  // Allocate space for the weights and the owners of a block of nodes
+  const int block_size = TMR_INTERP_CHUNK_SIZE *
+                         TMR_INTERP_CHUNKS_PER_THREAD * TMRGetMaxThreads();
+  int *block_nweights = new int[block_size];
+  int *block_owners = new int[block_size];
+  TMRIndexWeight *block_weights = new TMRIndexWeight[block_size * max_weights];
+  size_t block_bytes =
+      block_size * (2 * sizeof(int) + max_weights * sizeof(TMRIndexWeight));
+  addTransient(block_bytes);
+
+#ifdef TMR_HAS_OPENMP
+#pragma omp parallel
+#endif  // TMR_HAS_OPENMP
+  {
+    // Allocate additional space for the interpolation
+    double *thread_tmp = new double[2 * coarse->mesh_order];
+
+    for (int start = 0; start < num_owned; start += block_size) {
+      int end = start + block_size;
+      if (end > num_owned) {
+        end = num_owned;
+      }
 
-          // The node is owned a coarse element on this processor
-          if (t) {
-            // Compute the element interpolation
-            int nweights = computeElemInterp(&node, coarse, t, weights, tmp);
+      // Compute the interpolation for the nodes in this block
+#ifdef TMR_HAS_OPENMP
+#pragma omp for schedule(dynamic, TMR_INTERP_CHUNK_SIZE)
+#endif  // TMR_HAS_OPENMP
+      for (int k = start; k < end; k++) {
+        // Find the enclosing coarse quad on this
+        // processor if it exits
+        TMRQuadrant node = quads[owned_elems[k]];
+        node.info = owned_nodes[k];
+
+        // Find the MPI owner or the
+        int mpi_owner = mpi_rank;
+        TMRQuadrant *t = coarse->findEnclosing(mesh_order, knots, &node,
+                                               &mpi_owner, owned_starts[k]);
+
+        // The node is owned a coarse element on this processor
+        block_owners[k - start] = mpi_owner;
+        block_nweights[k - start] = -1;
+        if (t) {
+          // Compute the element interpolation
+          block_nweights[k - start] = computeElemInterp(
+              &node, coarse, t, &block_weights[(k - start) * max_weights],
+              thread_tmp);
+        }
+      }
 
-            for (int k = 0; k < nweights; k++) {
-              vars[k] = weights[k].index;
-              wvals[k] = weights[k].weight;
+      // Add the interpolation in the order of the nodes
+#ifdef TMR_HAS_OPENMP
+#pragma omp single
+#endif  // TMR_HAS_OPENMP
+      {
+        for (int k = start; k < end; k++) {
+          const int *c = &conn[nodes_per_element * owned_elems[k]];
+          const int j = owned_nodes[k];
+
+          int nweights = block_nweights[k - start];
+          if (nweights >= 0) {
+            const TMRIndexWeight *w = &block_weights[(k - start) * max_weights];
+            for (int ii = 0; ii < nweights; ii++) {
+              vars[ii] = w[ii].index;
+              wvals[ii] = w[ii].weight;
+            }
+            if (interp) {
+              interp->addInterp(c[j], wvals, vars, nweights);
+            }
+            if (cache) {
+              cache->addInterp(c[j], wvals, vars, nweights);
             }
-            interp->addInterp(c[j], wvals, vars, nweights);
           } else {
             // We've got to transfer the node to the processor that
             // owns an enclosing element. To do that, add the quad to
             // the list of externals and store its mpi owner
-            node.tag = mpi_owner;
+            TMRQuadrant node = quads[owned_elems[k]];
+            node.info = j;
+            node.tag = block_owners[k - start];
             ext_queue->push(&node);
           }
         }
       }
     }
+
+    delete[] thread_tmp;
   }
 
   // Free the data
+  removeTransient(4 * local_size * sizeof(int) + block_bytes);
   delete[] flags;
+  delete[] owned_elems;
+  delete[] owned_nodes;
+  delete[] owned_starts;
+  delete[] block_nweights;
+  delete[] block_owners;
+  delete[] block_weights;
 
   // Sort the sending quadrants by MPI rank
   TMRQuadrantArray *ext_array = ext_queue->toArray();
+  addTransient(ext_array->getMemoryUsage());
   delete ext_queue;
 
   // Sort the node
   int size;
   TMRQuadrant *array;
+  ext_array->sortByTag();
   ext_array->getArray(&array, &size);
-  qsort(array, size, sizeof(TMRQuadrant), compare_quadrant_tags);
 
   // The number of quadrants that will be sent from this processor
   // to all other processors in the communicator
@@ -4786,7 +6220,7 @@ void TMRQuadForest::createInterpolation(TMRQuadForest *coarse,
 
   // Now distribute the quad to their destination processors
   int *quad_recv_counts = new int[mpi_size];
-  MPI_Alltoall(quad_counts, 1, MPI_INT, quad_recv_counts, 1, MPI_INT, comm);
+  TMRExchangeCounts(comm, quad_counts, quad_recv_counts);
 
   // Now use oct_ptr to point into the recv array
   quad_recv_ptr[0] = 0;
@@ -4800,6 +6234,8 @@ void TMRQuadForest::createInterpolation(TMRQuadForest *coarse,
   // Distribute the quad based on the oct_ptr/oct_recv_ptr arrays
   TMRQuadrantArray *recv_array =
       sendQuadrants(ext_array, quad_ptr, quad_recv_ptr);
+  addTransient(recv_array->getMemoryUsage());
+  removeTransient(ext_array->getMemoryUsage());
   delete[] quad_ptr;
   delete[] quad_recv_ptr;
   delete ext_array;
@@ -4810,8 +6246,16 @@ void TMRQuadForest::createInterpolation(TMRQuadForest *coarse,
   recv_array->getArray(&recv_nodes, &recv_size);
 
   // Recv the nodes and loop over the connectivity
+  int search_start = -1;
   for (int i = 0; i < recv_size; i++) {
-    TMRQuadrant *t = coarse->findEnclosing(mesh_order, knots, &recv_nodes[i]);
+    // The nodes of one element are sent together. Only repeat the
+    // search from the start when the element changes.
+    if (i == 0 || recv_nodes[i].comparePosition(&recv_nodes[i - 1]) != 0) {
+      search_start = coarse->findEnclosingStart(&recv_nodes[i]);
+    }
+
+    TMRQuadrant *t = coarse->findEnclosing(mesh_order, knots, &recv_nodes[i],
+                                           NULL, search_start);
     if (t) {
       // Compute the element interpolation
       int nweights = computeElemInterp(&recv_nodes[i], coarse, t, weights, tmp);
@@ -4820,7 +6264,12 @@ void TMRQuadForest::createInterpolation(TMRQuadForest *coarse,
         vars[k] = weights[k].index;
         wvals[k] = weights[k].weight;
       }
-      interp->addInterp(recv_nodes[i].tag, wvals, vars, nweights);
+      if (interp) {
+        interp->addInterp(recv_nodes[i].tag, wvals, vars, nweights);
+      }
+      if (cache) {
+        cache->addInterp(recv_nodes[i].tag, wvals, vars, nweights);
+      }
     } else {
       // This should not happen. Print out an error message here.
       fprintf(stderr,
@@ -4831,6 +6280,7 @@ void TMRQuadForest::createInterpolation(TMRQuadForest *coarse,
   }
 
   // Free the recv array
+  removeTransient(recv_array->getMemoryUsage());
   delete recv_array;
 
   // Free the temporary arrays
@@ -4840,6 +6290,326 @@ void TMRQuadForest::createInterpolation(TMRQuadForest *coarse,
   delete[] weights;
 }
 
+/*
+  Compute the weights for transferring the value at a node from an
+  element of another forest.
+
+  When the element of the node is also an element of the old forest
+  with the same mesh order and nodal (non-Bernstein) interpolation,
+  the node value is copied from the same node of the old element.
+  Otherwise, the node is interpolated from the old element, which
+  gives the same weights as createInterpolation().
+
+  input:
+  node:        the node (element quadrant with info = element node index)
+  old_forest:  the forest that the values are transferred from
+  quad:        an enclosing quadrant on the old forest
+  tmp:         temporary array (must be of size 2*old_forest->mesh_order)
+
+  output:
+  weights:     the index/weight pairs for the node
+
+  returns:
+  the number of weights
+*/
+int TMRQuadForest::computeTransferWeights(TMRQuadrant *node,
+                                          TMRQuadForest *old_forest,
+                                          TMRQuadrant *quad,
+                                          TMRIndexWeight *weights,
+                                          double *tmp) {
+  if (quad->level == node->level && quad->comparePosition(node) == 0 &&
+      old_forest->mesh_order == mesh_order &&
+      old_forest->interp_type == interp_type &&
+      interp_type != TMR_BERNSTEIN_POINTS) {
+    const int nodes_per_element = mesh_order * mesh_order;
+    const int c = old_forest->conn[nodes_per_element * quad->tag + node->info];
+    if (c >= 0) {
+      weights[0].index = c;
+      weights[0].weight = 1.0;
+      return 1;
+    }
+
+    // The node is a dependent node on the old forest
+    const int *dep_ptr, *dep_conn, *tmpl;
+    const double *tmpl_weights;
+    old_forest->getDepNodeConn(&dep_ptr, &dep_conn);
+    old_forest->getDepNodeTemplates(&tmpl, &tmpl_weights);
+
+    int nweights = 0;
+    const int dep = -c - 1;
+    const double *N = &tmpl_weights[old_forest->mesh_order * tmpl[dep]];
+    for (int jp = dep_ptr[dep]; jp < dep_ptr[dep + 1]; jp++, nweights++) {
+      weights[nweights].index = dep_conn[jp];
+      weights[nweights].weight = N[jp - dep_ptr[dep]];
+    }
+    return nweights;
+  }
+
+  return computeElemInterp(node, old_forest, quad, weights, tmp);
+}
+
+/*
+  Evaluate the values at a node from the index/weight pairs
+*/
+static void TMR_EvalTransferValues(TACSBVec *vec, int bsize, int nweights,
+                                   const TMRIndexWeight *weights, int *vars,
+                                   TacsScalar *vals, TacsScalar *out) {
+  for (int k = 0; k < nweights; k++) {
+    vars[k] = weights[k].index;
+  }
+  vec->getValues(nweights, vars, vals);
+
+  for (int b = 0; b < bsize; b++) {
+    out[b] = 0.0;
+  }
+  for (int k = 0; k < nweights; k++) {
+    for (int b = 0; b < bsize; b++) {
+      out[b] += weights[k].weight * vals[bsize * k + b];
+    }
+  }
+}
+
+/*
+  Transfer a nodal field from another forest to this forest
+
+  The forests must share the same connectivity, but this forest may
+  be a refined, coarsened and/or repartitioned version of the old
+  forest. The value at each node on this forest is evaluated directly
+  from the old element that encloses it, without forming an
+  interpolation matrix. Since both quadrant arrays are sorted, the
+  enclosing old quadrants are found in a single merge over the local
+  quadrants. The values for the nodes of unchanged elements are
+  copied. Only the nodes that lie within an old element on another
+  processor are sent to that processor, which returns their values.
+
+  This is a collective call.
+
+  input:
+  old_forest:  the forest that the values are transferred from
+  old_vec:     the nodal values on the old forest
+
+  output:
+  new_vec:     the nodal values on this forest
+*/
+void TMRQuadForest::transferNodalField(TMRQuadForest *old_forest,
+                                       TACSBVec *old_vec, TACSBVec *new_vec) {
+  // Ensure that the nodes are allocated on both quadtree forests
+  createNodes();
+  old_forest->createNodes();
+
+  const int bsize = new_vec->getBlockSize();
+  if (old_vec->getBlockSize() != bsize) {
+    fprintf(stderr,
+            "TMRQuadForest Error: Inconsistent block sizes for the "
+            "nodal field transfer\n");
+    return;
+  }
+
+  // Distribute the values to the ghost nodes on the old forest
+  old_vec->beginDistributeValues();
+  old_vec->endDistributeValues();
+
+  // Get the locally owned values on this forest
+  TacsScalar *xnew;
+  new_vec->getArray(&xnew);
+
+  // Flag the locally owned nodes once they have been set
+  int local_size = node_range[mpi_rank + 1] - node_range[mpi_rank];
+  int *flags = new int[local_size];
+  memset(flags, 0, local_size * sizeof(int));
+
+  // Allocate space for the interpolation weights and values
+  const int order = old_forest->mesh_order;
+  double *tmp = new double[2 * order];
+  int max_weights = order * order * order * order;
+  TMRIndexWeight *weights = new TMRIndexWeight[max_weights];
+  int *vars = new int[max_weights];
+  TacsScalar *vals = new TacsScalar[bsize * max_weights];
+
+  const int nodes_per_element = mesh_order * mesh_order;
+
+  // Get the quadrants on both forests
+  int num_elements;
+  TMRQuadrant *quads;
+  quadrants->getArray(&quads, &num_elements);
+
+  int old_size;
+  TMRQuadrant *old_quads;
+  old_forest->quadrants->getArray(&old_quads, &old_size);
+
+  // Allocate a queue to store the nodes that are on other procs
+  TMRQuadrantQueue *ext_queue = new TMRQuadrantQueue();
+
+  // Set the knots to use in the interpolation
+  const double *knots = interp_knots;
+
+  // The index of the first old quadrant that may enclose the element
+  int start = 0;
+
+  for (int i = 0; i < num_elements; i++) {
+    const int *c = &conn[nodes_per_element * i];
+
+    // Skip the old quadrants that lie before this element
+    while (start < old_size &&
+           old_quads[start].comparePosition(&quads[i]) < 0 &&
+           !old_quads[start].contains(&quads[i])) {
+      start++;
+    }
+
+    for (int j = 0; j < nodes_per_element; j++) {
+      // Check if the node is owned by this processor
+      if (c[j] >= node_range[mpi_rank] && c[j] < node_range[mpi_rank + 1]) {
+        int index = c[j] - node_range[mpi_rank];
+        if (!flags[index]) {
+          flags[index] = 1;
+
+          TMRQuadrant node = quads[i];
+          node.info = j;
+
+          int mpi_owner = mpi_rank;
+          TMRQuadrant *t = old_forest->findEnclosing(mesh_order, knots, &node,
+                                                     &mpi_owner, start);
+
+          if (t) {
+            int nweights =
+                computeTransferWeights(&node, old_forest, t, weights, tmp);
+            TMR_EvalTransferValues(old_vec, bsize, nweights, weights, vars,
+                                   vals, &xnew[bsize * index]);
+          } else {
+            // Send the node to the processor that owns the enclosing
+            // element on the old forest
+            node.tag = mpi_owner;
+            ext_queue->push(&node);
+          }
+        }
+      }
+    }
+  }
+
+  delete[] flags;
+
+  // Sort the nodes by the destination rank
+  TMRQuadrantArray *ext_array = ext_queue->toArray();
+  delete ext_queue;
+
+  int size;
+  TMRQuadrant *array;
+  ext_array->sortByTag();
+  ext_array->getArray(&array, &size);
+
+  int *quad_ptr = new int[mpi_size + 1];
+  matchTagIntervals(array, size, quad_ptr);
+
+  // Convert the tags to the local node numbers
+  for (int i = 0; i < size; i++) {
+    TMRQuadrant *t = quadrants->contains(&array[i]);
+    array[i].tag = conn[nodes_per_element * t->tag + array[i].info];
+  }
+
+  // Count up the number of nodes destined for other procs
+  int *quad_counts = new int[mpi_size];
+  for (int i = 0; i < mpi_size; i++) {
+    if (i == mpi_rank) {
+      quad_counts[i] = 0;
+    } else {
+      quad_counts[i] = quad_ptr[i + 1] - quad_ptr[i];
+    }
+  }
+
+  int *quad_recv_counts = new int[mpi_size];
+  TMRExchangeCounts(comm, quad_counts, quad_recv_counts);
+
+  int *quad_recv_ptr = new int[mpi_size + 1];
+  quad_recv_ptr[0] = 0;
+  for (int i = 0; i < mpi_size; i++) {
+    quad_recv_ptr[i + 1] = quad_recv_ptr[i] + quad_recv_counts[i];
+  }
+
+  // Send the nodes to the processors that own the old elements
+  TMRQuadrantArray *recv_array =
+      sendQuadrants(ext_array, quad_ptr, quad_recv_ptr);
+
+  int recv_size;
+  TMRQuadrant *recv_nodes;
+  recv_array->getArray(&recv_nodes, &recv_size);
+
+  // Evaluate the values of the nodes from other processors
+  TacsScalar *recv_vals = new TacsScalar[bsize * recv_size];
+  int search_start = -1;
+  for (int i = 0; i < recv_size; i++) {
+    // The nodes of one element are sent together
+    if (i == 0 || recv_nodes[i].comparePosition(&recv_nodes[i - 1]) != 0) {
+      search_start = old_forest->findEnclosingStart(&recv_nodes[i]);
+    }
+
+    TMRQuadrant *t = old_forest->findEnclosing(mesh_order, knots,
+                                               &recv_nodes[i], NULL,
+                                               search_start);
+    if (t) {
+      int nweights =
+          computeTransferWeights(&recv_nodes[i], old_forest, t, weights, tmp);
+      TMR_EvalTransferValues(old_vec, bsize, nweights, weights, vars, vals,
+                             &recv_vals[bsize * i]);
+    } else {
+      fprintf(stderr,
+              "[%d] TMRQuadForest Error: Destination processor does "
+              "not own node\n",
+              mpi_rank);
+      for (int b = 0; b < bsize; b++) {
+        recv_vals[bsize * i + b] = 0.0;
+      }
+    }
+  }
+  delete recv_array;
+
+  // Return the values in the order that the nodes were sent. Only
+  // the processors that exchanged nodes communicate.
+  const int value_tag = 1;
+  int nrecvs = 0, nsends = 0;
+  MPI_Request *recv_requests = new MPI_Request[mpi_size];
+  MPI_Request *send_requests = new MPI_Request[mpi_size];
+  TacsScalar *ext_vals = new TacsScalar[bsize * size];
+  memset(ext_vals, 0, bsize * size * sizeof(TacsScalar));
+  for (int i = 0; i < mpi_size; i++) {
+    if (quad_counts[i] > 0) {
+      MPI_Irecv(&ext_vals[bsize * quad_ptr[i]], bsize * quad_counts[i],
+                TACS_MPI_TYPE, i, value_tag, comm, &recv_requests[nrecvs]);
+      nrecvs++;
+    }
+    if (quad_recv_counts[i] > 0) {
+      MPI_Isend(&recv_vals[bsize * quad_recv_ptr[i]],
+                bsize * quad_recv_counts[i], TACS_MPI_TYPE, i, value_tag, comm,
+                &send_requests[nsends]);
+      nsends++;
+    }
+  }
+  MPI_Waitall(nrecvs, recv_requests, MPI_STATUSES_IGNORE);
+  MPI_Waitall(nsends, send_requests, MPI_STATUSES_IGNORE);
+
+  // Set the values returned from the other processors
+  for (int i = 0; i < size; i++) {
+    int index = array[i].tag - node_range[mpi_rank];
+    for (int b = 0; b < bsize; b++) {
+      xnew[bsize * index + b] = ext_vals[bsize * i + b];
+    }
+  }
+
+  // Free the data
+  delete ext_array;
+  delete[] quad_ptr;
+  delete[] quad_counts;
+  delete[] quad_recv_counts;
+  delete[] quad_recv_ptr;
+  delete[] recv_requests;
+  delete[] send_requests;
+  delete[] ext_vals;
+  delete[] recv_vals;
+  delete[] tmp;
+  delete[] weights;
+  delete[] vars;
+  delete[] vals;
+}
+
 /*
   Initialize the node label
 */
@@ -22,7 +22,10 @@
 #define TMR_QUADTREE_FOREST_H
 
 #include "TACSBVecInterp.h"
+#include "TMRInterpCache.h"
+#include "TMRNameIndex.h"
 #include "TMRQuadrant.h"
+#include "TMRPointCache.h"
 #include "TMRTopology.h"
 
 /*
@@ -55,6 +58,10 @@ class TMRQuadForest : public TMREntity {
   void setTopology(TMRTopology *_topo);
   TMRTopology *getTopology();
 
+  // Clear the cache of node locations evaluated from the topology
+  // -------------------------------------------------------------
+  void clearNodeLocationCache();
+
   // Set the connectivity directly
   // -----------------------------
   void setConnectivity(int _num_nodes, const int *_face_conn, int _num_faces);
@@ -68,15 +75,28 @@ class TMRQuadForest : public TMREntity {
   int getMeshOrder();
   TMRInterpolationType getInterpType();
 
-  // Re-partition the quadtrees based on element count
-  // -------------------------------------------------
+  // Re-partition the quadtrees based on element count or cost
+  // ---------------------------------------------------------
   void repartition();
+  double repartition(const double *weights);
+
+  // Repartition automatically when the load is imbalanced
+  // -----------------------------------------------------
+  void setRepartitionTolerance(double tol);
+  int repartitionIfImbalanced(double tol, const double *weights = NULL);
+  void getRepartitionStats(double *imbalance, int *repartitioned,
+                           double *bytes_moved);
 
   // Create the forest of quadtrees
   // ----------------------------
   void createTrees(int refine_level);
   void createRandomTrees(int nrand = 10, int min_level = 0, int max_level = 8);
 
+  // Write/read the quadrants to/from a binary file for restart
+  // ----------------------------------------------------------
+  int writeQuadrantsToFile(const char *filename);
+  int readQuadrantsFromFile(const char *filename);
+
   // Duplicate or coarsen the forest
   // -------------------------------
   TMRQuadForest *duplicate();
@@ -101,11 +121,32 @@ class TMRQuadForest : public TMREntity {
                    int *_num_owned_nodes = NULL, int *_num_local_nodes = NULL);
   int getDepNodeConn(const int **_ptr = NULL, const int **_conn = NULL,
                      const double **_weights = NULL);
+  int getDepNodeTemplates(const int **_tmpl = NULL,
+                          const double **_tmpl_weights = NULL);
 
   // Create interpolation/restriction operators
   // ------------------------------------------
   void createInterpolation(TMRQuadForest *coarse, TACSBVecInterp *interp);
 
+  // Transfer a nodal field from another forest with the same layout
+  // ---------------------------------------------------------------
+  void transferNodalField(TMRQuadForest *old_forest, TACSBVec *old_vec,
+                          TACSBVec *new_vec);
+
+  // Store the interpolation operators for reuse or restart
+  // ------------------------------------------------------
+  void setUseInterpCache(int flag);
+  int writeInterpolation(TMRQuadForest *coarse, const char *filename);
+  int readInterpolation(TMRQuadForest *coarse, const char *filename);
+
+  // Reuse the connectivity of unchanged elements in createNodes()
+  // -------------------------------------------------------------
+  void setUseIncrementalNodes(int flag);
+
+  // Report the memory held by the forest
+  // ------------------------------------
+  TMRMemoryUsage *getMemoryUsage();
+
   // Get the nodes or elements with a certain name
   // ---------------------------------------------
   TMRQuadrantArray *getQuadsWithName(const char *name);
@@ -115,6 +156,10 @@ class TMRQuadForest : public TMREntity {
   // --------------------------------------
   int getOwnedNodeRange(const int **_node_range);
 
+  // Get a stamp that changes each time the nodes are created
+  // --------------------------------------------------------
+  int getNodeStamp() { return node_stamp; }
+
   // Get the quadrants and the nodes and interpolation
   // -------------------------------------------------
   void getQuadrants(TMRQuadrantArray **_quadrants);
@@ -140,7 +185,9 @@ class TMRQuadForest : public TMREntity {
   // Find the quadrant enclosing the given node
   // ------------------------------------------
   TMRQuadrant *findEnclosing(const int order, const double *knots,
-                             TMRQuadrant *node, int *mpi_owner = NULL);
+                             TMRQuadrant *node, int *mpi_owner = NULL,
+                             int search_start = -1);
+  int findEnclosingStart(TMRQuadrant *node);
 
   // Distribute the quadrant array
   // -----------------------------
@@ -158,6 +205,7 @@ class TMRQuadForest : public TMREntity {
   void writeToVTK(const char *filename);
   void writeToTecplot(const char *filename);
   void writeForestToVTK(const char *filename);
+  void writeForestToVTU(const char *prefix, int compress = 0);
   void writeAdjacentToVTK(const char *filename);
 
  private:
@@ -177,13 +225,14 @@ class TMRQuadForest : public TMREntity {
   // Set up the edge connectivity
   void computeEdgesFromNodes();
   void computeEdgesToFaces();
-
-  // Compute the faces that own the edges and nodes
-  void computeFaceOwners();
+  void computeFaceTransforms();
 
   // Get the quadrant owner
   int getQuadrantMPIOwner(TMRQuadrant *quad);
 
+  // Move the quadrants to a new partition
+  void repartitionQuadrants(const int *ptr, const int *new_ptr);
+
   // match the ownership intervals
   void matchQuadrantIntervals(TMRQuadrant *array, int size, int *ptr);
   void matchTagIntervals(TMRQuadrant *array, int size, int *ptr);
@@ -223,10 +272,17 @@ class TMRQuadForest : public TMREntity {
   void labelDependentNodes(int *nodes);
 
   // Create the global node ownership data
-  TMRQuadrantArray *createLocalNodes();
+  TMRQuadrantArray *createLocalNodes(const int *prev_elems = NULL);
 
   // Create the local connectivity based on the input node array
-  void createLocalConn(TMRQuadrantArray *nodes, const int *node_offset);
+  void createLocalConn(TMRQuadrantArray *nodes, const int *node_offset,
+                       const int *prev_elems = NULL);
+
+  // Reuse the nodes and connectivity from the previous createNodes()
+  int *matchPrevElements();
+  TMRQuadrantArray *getPrevElementNodes(const int *prev_elems);
+  int *mapPrevNodes(TMRQuadrantArray *nodes, const int *node_offset);
+  void freePrevNodes();
 
   // Create the dependent node connectivity
   void createDependentConn(const int *node_nums, TMRQuadrantArray *nodes,
@@ -234,12 +290,42 @@ class TMRQuadForest : public TMREntity {
 
   // Compute the node locations
   void evaluateNodeLocations();
+  // Evaluate points, using the cached locations if possible
+  void evalNodePoints(TMRFace *surf, int face, int npts, const double u[],
+                      const double v[], TMRPoint X[]);
+  // Evaluate the n^2 tensor grid of points, using the cached
+  // locations if possible
+  void evalNodeGrid(TMRFace *surf, int face, int n, const double u[],
+                    const double v[], TMRPoint X[]);
+
+  // Compute the interpolation, adding the rows to the interpolation
+  // object and/or the cache
+  void computeInterpolation(TMRQuadForest *coarse, TACSBVecInterp *interp,
+                            TMRInterpCache *cache);
+
+  // Check if the interpolation cache contains the operator
+  int hasInterpCache(TMRQuadForest *coarse);
+  void getInterpCacheInfo(TMRQuadForest *coarse, int info[]);
 
   // Compute the element interpolation
   int computeElemInterp(TMRQuadrant *node, TMRQuadForest *coarse,
                         TMRQuadrant *quad, TMRIndexWeight *weights,
                         double *tmp);
 
+  // Compute the weights for transferring a node value from an element
+  // of another forest
+  int computeTransferWeights(TMRQuadrant *node, TMRQuadForest *old_forest,
+                             TMRQuadrant *quad, TMRIndexWeight *weights,
+                             double *tmp);
+
+  // Create the index from the entity names to the elements and nodes
+  TMRNameIndex *createNameIndex();
+
+  // Record the peak transient memory allocated during a phase
+  void beginMemoryPhase(int phase);
+  void addTransient(size_t bytes);
+  void removeTransient(size_t bytes);
+
   // Initialize the node label
   void initLabel(int mesh_order, TMRInterpolationType interp_type,
                  int label_type[]);
@@ -251,6 +337,7 @@ class TMRQuadForest : public TMREntity {
   // Information about the type of interpolation
   TMRInterpolationType interp_type;
   double *interp_knots;
+  double *interp_wts;
 
   // The owner quadrant ranges for each processor. Note that this is
   // in the quadrant space not the node space
@@ -277,9 +364,21 @@ class TMRQuadForest : public TMREntity {
   int *dep_ptr, *dep_conn;
   double *dep_weights;
 
+  // The weight templates referenced by each dependent node. The
+  // expanded dep_weights are only created when they are requested.
+  int *dep_tmpl;
+  double *dep_tmpl_weights;
+
   // The array of all quadrants
   TMRQuadrantArray *quadrants;
 
+  // The quadrants, local nodes and local connectivity from the
+  // previous call to createNodes(), kept when the nodes are created
+  // incrementally
+  int use_incremental_nodes;
+  TMRQuadrantArray *prev_quadrants, *prev_nodes;
+  int *prev_conn;
+
   // The quadrants that are adjacent to this processor
   TMRQuadrantArray *adjacent;
 
@@ -289,6 +388,36 @@ class TMRQuadForest : public TMREntity {
   // The topology of the underlying model (if any)
   TMRTopology *topo;
 
+  // The node locations evaluated from the topology. This is shared
+  // between forests created from one another.
+  TMRPointCache *node_cache;
+
+  // The stored interpolation to a coarse forest, identified by the
+  // entity id and node stamp of the coarse forest
+  int use_interp_cache;
+  TMRInterpCache *interp_cache;
+  int interp_cache_id, interp_cache_stamp;
+
+  // A stamp that is unique to each numbering of the nodes
+  int node_stamp;
+
+  // The imbalance that triggers an automatic repartition and the
+  // outcome of the last check
+  double repartition_tol;
+  double last_imbalance, last_bytes_moved;
+  int last_repartitioned;
+
+  // The index from the entity names to the elements and nodes
+  TMRNameIndex *name_index;
+
+  // The transient memory that is currently allocated and its peak
+  // during the creation of the nodes and of the interpolation
+  static const int TMR_NODES_PHASE = 0;
+  static const int TMR_INTERP_PHASE = 1;
+  int memory_phase;
+  size_t transient_bytes;
+  size_t peak_bytes[2];
+
   // Class for the block connectivity
   class TMRFaceConn : public TMREntity {
    public:
@@ -305,8 +434,7 @@ class TMRQuadForest : public TMREntity {
       node_face_conn = NULL;
       edge_face_ptr = NULL;
       edge_face_conn = NULL;
-      edge_face_owners = NULL;
-      node_face_owners = NULL;
+      face_transforms = NULL;
     }
     ~TMRFaceConn() {
       // Free the connectivity data
@@ -328,13 +456,8 @@ class TMRQuadForest : public TMREntity {
       if (edge_face_conn) {
         delete[] edge_face_conn;
       }
-
-      // Free the ownership data
-      if (edge_face_owners) {
-        delete[] edge_face_owners;
-      }
-      if (node_face_owners) {
-        delete[] node_face_owners;
+      if (face_transforms) {
+        delete[] face_transforms;
       }
     }
 
@@ -348,8 +471,49 @@ class TMRQuadForest : public TMREntity {
     int *node_face_ptr, *node_face_conn;
     int *edge_face_ptr, *edge_face_conn;
 
-    // Set the node/edge owners
-    int *node_face_owners, *edge_face_owners;
+    // The affine transformation of a node on an edge or corner of a
+    // face to the coordinates of the face that owns the entity,
+    // x' = A*x + hmax*b. The entries for each face are ordered by the
+    // 4 edges and then the 4 corners. The adjacent face is -1 when
+    // the face owns the entity.
+    static const int NUM_FACE_TRANSFORMS = 8;
+    struct Transform {
+      int adj;       // The owner face or -1
+      int reversed;  // Whether the edge is reversed (edges only)
+      int A[4];
+      int b[2];
+    };
+    Transform *face_transforms;
+
+    // Get the node/edge owners - the adjacent face with the lowest
+    // face number. The adjacent faces are stored in ascending order,
+    // so the owner is the first face in the list.
+    int getEdgeOwner(int edge) const {
+      int ptr = edge_face_ptr[edge];
+      return (ptr < edge_face_ptr[edge + 1] ? edge_face_conn[ptr] / 4
+                                            : num_faces);
+    }
+    int getNodeOwner(int node) const {
+      int ptr = node_face_ptr[node];
+      return (ptr < node_face_ptr[node + 1] ? node_face_conn[ptr] / 4
+                                            : num_faces);
+    }
+
+    // Get the memory held by the connectivity arrays
+    size_t getMemoryUsage() const {
+      size_t len = (4 + 4) * num_faces + num_nodes + 1 + num_edges + 1;
+      if (node_face_ptr) {
+        len += node_face_ptr[num_nodes];
+      }
+      if (edge_face_ptr) {
+        len += edge_face_ptr[num_edges];
+      }
+      len *= sizeof(int);
+      if (face_transforms) {
+        len += NUM_FACE_TRANSFORMS * num_faces * sizeof(Transform);
+      }
+      return len;
+    }
   } * fdata;
 };
 
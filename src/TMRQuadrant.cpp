@@ -21,6 +21,7 @@
 #include "TMRQuadrant.h"
 
 #include "TMRHashFunction.h"
+#include "TMRRadixSort.h"
 
 /*
   Get the child id of the quadrant
@@ -242,6 +243,57 @@ static int compare_nodes(const void *a, const void *b) {
   return ao->compareNode(bo);
 }
 
+/*
+  Sort the quadrants based on the Morton encoding using a radix sort.
+
+  The key for each quadrant consists of the face index, the 62-bit
+  Morton code formed from interleaving the x and y coordinates and a
+  16-bit value that breaks ties: the level when sorting elements and
+  the info when sorting nodes. This reproduces the ordering of
+  TMRQuadrant::compare and TMRQuadrant::compareNode.
+
+  The function returns 0 and does nothing if the coordinates lie
+  outside the range that can be represented by the key.
+*/
+static int radix_sort_quadrants(TMRQuadrant *array, int size,
+                                int use_node_index) {
+  // Check that the quadrants can be represented by the keys
+  int32_t min_face = array[0].face;
+  for (int i = 0; i < size; i++) {
+    if (array[i].x < 0 || array[i].y < 0) {
+      return 0;
+    }
+    if (array[i].face < min_face) {
+      min_face = array[i].face;
+    }
+  }
+
+  TMRSortKey *keys = new TMRSortKey[2 * size];
+  for (int i = 0; i < size; i++) {
+    const uint64_t x = array[i].x, y = array[i].y;
+    uint64_t m = (TMRSpreadBits2(x) << 1) | TMRSpreadBits2(y);
+
+    uint64_t tie = 0;
+    if (use_node_index) {
+      tie = (uint16_t)(array[i].info ^ 0x8000);
+    } else {
+      tie = (uint16_t)(array[i].level ^ 0x8000);
+    }
+
+    keys[i].hi = ((uint64_t)(uint32_t)(array[i].face - min_face) << 32) |
+                 (m >> 30);
+    keys[i].lo = (m << 34) | tie;
+    keys[i].index = i;
+  }
+
+  TMRSortKey *sorted = TMRRadixSortKeys(size, keys, &keys[size]);
+  TMRSortKey *temp = (sorted == keys ? &keys[size] : keys);
+  TMRApplySortPermutation(size, sorted, array, temp);
+  delete[] keys;
+
+  return 1;
+}
+
 /*
   Store a array of quadrants
 */
@@ -277,8 +329,16 @@ TMRQuadrantArray *TMRQuadrantArray::duplicate() {
   entries.
 */
 void TMRQuadrantArray::sort() {
+  // Order the quadrants with the radix sort when possible
+  int sorted = 0;
+  if (size >= min_radix_sort_size) {
+    sorted = radix_sort_quadrants(array, size, use_node_index);
+  }
+
   if (use_node_index) {
-    qsort(array, size, sizeof(TMRQuadrant), compare_nodes);
+    if (!sorted) {
+      qsort(array, size, sizeof(TMRQuadrant), compare_nodes);
+    }
 
     // Now that the Quadrants are sorted, remove duplicates
     int i = 0;  // Location from which to take entries
@@ -297,7 +357,9 @@ void TMRQuadrantArray::sort() {
     // The new size of the array
     size = j;
   } else {
-    qsort(array, size, sizeof(TMRQuadrant), compare_quadrants);
+    if (!sorted) {
+      qsort(array, size, sizeof(TMRQuadrant), compare_quadrants);
+    }
 
     // Now that the Quadrants are sorted, remove duplicates
     int i = 0;  // Location from which to take entries
@@ -320,6 +382,29 @@ void TMRQuadrantArray::sort() {
   is_sorted = 1;
 }
 
+/*
+  Sort the array based on the tag values alone.
+
+  This ordering is used to group quadrants by their destination
+  processor. The sort is stable and the array is no longer considered
+  to be sorted in the Morton order.
+*/
+void TMRQuadrantArray::sortByTag() {
+  TMRSortKey *keys = new TMRSortKey[2 * size];
+  for (int i = 0; i < size; i++) {
+    keys[i].hi = 0;
+    keys[i].lo = (uint32_t)array[i].tag ^ 0x80000000U;
+    keys[i].index = i;
+  }
+
+  TMRSortKey *sorted = TMRRadixSortKeys(size, keys, &keys[size]);
+  TMRSortKey *temp = (sorted == keys ? &keys[size] : keys);
+  TMRApplySortPermutation(size, sorted, array, temp);
+  delete[] keys;
+
+  is_sorted = 0;
+}
+
 /*
   Determine if the array contains the specified quadrant
 */
@@ -348,6 +433,10 @@ TMRQuadrant *TMRQuadrantArray::contains(TMRQuadrant *q,
 
 /*
   Merge the entries of two arrays
+
+  When the arrays contain nodes, they are compared as nodes. The
+  entries of this array are kept when both arrays contain the same
+  entry.
 */
 void TMRQuadrantArray::merge(TMRQuadrantArray *list) {
   if (!is_sorted) {
@@ -357,6 +446,12 @@ void TMRQuadrantArray::merge(TMRQuadrantArray *list) {
     list->sort();
   }
 
+  // Compare either the quadrants or the nodes
+  int (*cmp)(const void *, const void *) = compare_quadrants;
+  if (use_node_index) {
+    cmp = compare_nodes;
+  }
+
   // Keep track of the number of duplicates
   int nduplicates = 0;
 
@@ -364,13 +459,13 @@ void TMRQuadrantArray::merge(TMRQuadrantArray *list) {
   // of duplicates
   int j = 0, i = 0;
   for (; i < size; i++) {
-    while ((j < list->size) && (list->array[j].compare(&array[i]) < 0)) {
+    while ((j < list->size) && (cmp(&list->array[j], &array[i]) < 0)) {
       j++;
     }
     if (j >= list->size) {
       break;
     }
-    if (array[i].compare(&list->array[j]) == 0) {
+    if (cmp(&array[i], &list->array[j]) == 0) {
       nduplicates++;
     }
   }
@@ -397,10 +492,10 @@ void TMRQuadrantArray::merge(TMRQuadrantArray *list) {
   i = size - 1;
   j = list->size - 1;
   while (i >= 0 && j >= 0) {
-    if (array[i].compare(&list->array[j]) > 0) {
+    if (cmp(&array[i], &list->array[j]) > 0) {
       array[end] = array[i];
       end--, i--;
-    } else if (list->array[j].compare(&array[i]) > 0) {
+    } else if (cmp(&list->array[j], &array[i]) > 0) {
       array[end] = list->array[j];
       end--, j--;
     } else {  // b[j] == a[i]
@@ -435,19 +530,18 @@ void TMRQuadrantArray::getArray(TMRQuadrant **_array, int *_size) {
   Create an queue of quadrants
 */
 TMRQuadrantQueue::TMRQuadrantQueue() {
-  root = tip = NULL;
+  start = 0;
   num_elems = 0;
+  max_num_elems = 0;
+  elems = NULL;
 }
 
 /*
   Free the queue
 */
 TMRQuadrantQueue::~TMRQuadrantQueue() {
-  QuadQueueNode *node = root;
-  while (node) {
-    QuadQueueNode *tmp = node;
-    node = node->next;
-    delete tmp;
+  if (elems) {
+    delete[] elems;
   }
 }
 
@@ -460,15 +554,26 @@ int TMRQuadrantQueue::length() { return num_elems; }
   Push a value onto the quadrant queue
 */
 void TMRQuadrantQueue::push(TMRQuadrant *quad) {
-  if (!tip) {
-    root = new QuadQueueNode();
-    root->quad = *quad;
-    tip = root;
-  } else {
-    tip->next = new QuadQueueNode();
-    tip->next->quad = *quad;
-    tip = tip->next;
+  if (num_elems >= max_num_elems) {
+    // Double the size of the buffer and copy the entries so that
+    // they start at the beginning of the new buffer
+    int new_size = 2 * max_num_elems;
+    if (new_size < min_queue_size) {
+      new_size = min_queue_size;
+    }
+    TMRQuadrant *temp = new TMRQuadrant[new_size];
+    for (int i = 0; i < num_elems; i++) {
+      temp[i] = elems[(start + i) & (max_num_elems - 1)];
+    }
+    if (elems) {
+      delete[] elems;
+    }
+    elems = temp;
+    max_num_elems = new_size;
+    start = 0;
   }
+
+  elems[(start + num_elems) & (max_num_elems - 1)] = *quad;
   num_elems++;
 }
 
@@ -476,39 +581,53 @@ void TMRQuadrantQueue::push(TMRQuadrant *quad) {
   Pop a value from the quadrant queue
 */
 TMRQuadrant TMRQuadrantQueue::pop() {
-  if (!root) {
+  if (num_elems == 0) {
     return TMRQuadrant();
   } else {
+    TMRQuadrant temp = elems[start];
+    start = (start + 1) & (max_num_elems - 1);
     num_elems--;
-    TMRQuadrant temp = root->quad;
-    QuadQueueNode *tmp = root;
-    root = root->next;
-    delete tmp;
-    if (num_elems == 0) {
-      tip = NULL;
-    }
     return temp;
   }
 }
 
 /*
   Convert the queue to an array
+
+  The storage of the queue is passed to the array object directly
+  when the entries do not wrap around the end of the buffer. After
+  this call the queue is empty.
 */
 TMRQuadrantArray *TMRQuadrantQueue::toArray() {
-  // Allocate the array
-  TMRQuadrant *array = new TMRQuadrant[num_elems];
-
-  // Scan through the queue and retrieve the quadrants
-  QuadQueueNode *node = root;
-  int index = 0;
-  while (node) {
-    array[index] = node->quad;
-    node = node->next;
-    index++;
+  TMRQuadrant *array = NULL;
+  if (!elems) {
+    array = new TMRQuadrant[0];
+  } else if (start + num_elems <= max_num_elems) {
+    // The entries are contiguous, shift them to the beginning of the
+    // buffer (if required) and take the storage
+    if (start > 0) {
+      memmove(elems, &elems[start], num_elems * sizeof(TMRQuadrant));
+    }
+    array = elems;
+  } else {
+    // The entries wrap around the end of the buffer, copy the two
+    // segments in order
+    array = new TMRQuadrant[num_elems];
+    int len = max_num_elems - start;
+    memcpy(array, &elems[start], len * sizeof(TMRQuadrant));
+    memcpy(&array[len], elems, (num_elems - len) * sizeof(TMRQuadrant));
+    delete[] elems;
   }
 
   // Create the array object
   TMRQuadrantArray *list = new TMRQuadrantArray(array, num_elems);
+
+  // Reset the queue
+  start = 0;
+  num_elems = 0;
+  max_num_elems = 0;
+  elems = NULL;
+
   return list;
 }
 
@@ -518,52 +637,46 @@ TMRQuadrantArray *TMRQuadrantQueue::toArray() {
   Note that this isn't a true hash table since it does not associate
   elements with other values. It is used to create unique lists of
   elements and nodes within the quadree mesh.
+
+  The optional size hint is an estimate of the number of unique
+  quadrants that will be added. This avoids re-hashing the table when
+  the final size is known in advance.
 */
-TMRQuadrantHash::TMRQuadrantHash(int _use_node_index) {
+TMRQuadrantHash::TMRQuadrantHash(int _use_node_index, int size_hint) {
   use_node_index = _use_node_index;
+
+  // Set the initial table size so that the load factor does not
+  // exceed 1/2 for the expected number of entries
+  table_size = min_table_size;
+  while (table_size < 2 * size_hint) {
+    table_size *= 2;
+  }
+  table = new int[table_size];
+  memset(table, 0xff, table_size * sizeof(int));
+
   num_elems = 0;
-  num_buckets = min_num_buckets;
-  hash_buckets = new QuadHashNode *[num_buckets];
-  memset(hash_buckets, 0, num_buckets * sizeof(QuadHashNode *));
+  max_num_elems = table_size / 2;
+  elems = new TMRQuadrant[max_num_elems];
 }
 
 /*
   Free the memory allocated by the quadrant hash
 */
 TMRQuadrantHash::~TMRQuadrantHash() {
-  // Free all the elements in the hash
-  for (int i = 0; i < num_buckets; i++) {
-    QuadHashNode *node = hash_buckets[i];
-    while (node) {
-      // Delete the old guy
-      QuadHashNode *tmp = node;
-      node = node->next;
-      delete tmp;
-    }
-  }
-
-  delete[] hash_buckets;
+  delete[] table;
+  delete[] elems;
 }
 
 /*
   Covert the hash table to an array
+
+  The quadrants are stored contiguously in the order in which they
+  were added, so this only requires a single copy.
 */
 TMRQuadrantArray *TMRQuadrantHash::toArray() {
   // Create an array of quadrants
   TMRQuadrant *array = new TMRQuadrant[num_elems];
-
-  // Loop over all the buckets
-  for (int i = 0, index = 0; i < num_buckets; i++) {
-    // Get the hash bucket and extract all the elements from this
-    // bucket into the array
-    QuadHashNode *node = hash_buckets[i];
-
-    while (node) {
-      array[index] = node->quad;
-      index++;
-      node = node->next;
-    }
-  }
+  memcpy(array, elems, num_elems * sizeof(TMRQuadrant));
 
   // Create an array object and add it to the list
   TMRQuadrantArray *list =
@@ -572,11 +685,11 @@ TMRQuadrantArray *TMRQuadrantHash::toArray() {
 }
 
 /*
-  Add an quadrant to the hash table.
+  Add a quadrant to the hash table.
 
   A new quadrant is added only if it is unique within the list of
-  objects. The function returns true if the quadrant is added, and false
-  if it already exists within the hash table.
+  objects. The function returns true if the quadrant is added, and
+  false if it already exists within the hash table.
 
   input:
   quad:   the quadrant that may be added to the hash table
@@ -585,130 +698,80 @@ TMRQuadrantArray *TMRQuadrantHash::toArray() {
   true if the quadrant is added, false if it is not
 */
 int TMRQuadrantHash::addQuadrant(TMRQuadrant *quad) {
-  if (num_elems > 10 * num_buckets) {
-    // Redistribute the quadrants to new buckets
-    int num_old_buckets = num_buckets;
-    num_buckets = 2 * num_buckets;
-    QuadHashNode **new_buckets = new QuadHashNode *[num_buckets];
-    memset(new_buckets, 0, num_buckets * sizeof(QuadHashNode *));
-
-    // Keep track of the end bucket
-    QuadHashNode **end_buckets = new QuadHashNode *[num_buckets];
-
-    // Redistribute the quadrant nodes based on the new
-    // number of buckets within the hash data structure
-    for (int i = 0; i < num_old_buckets; i++) {
-      QuadHashNode *node = hash_buckets[i];
-      while (node) {
-        int bucket = getBucket(&(node->quad));
-
-        // If this is the first new bucket, create
-        // the new node
-        if (!new_buckets[bucket]) {
-          new_buckets[bucket] = new QuadHashNode;
-          new_buckets[bucket]->quad = node->quad;
-          end_buckets[bucket] = new_buckets[bucket];
-        } else {
-          end_buckets[bucket]->next = new QuadHashNode;
-          end_buckets[bucket]->next->quad = node->quad;
-          end_buckets[bucket] = end_buckets[bucket]->next;
-        }
-
-        // Delete the old guy
-        QuadHashNode *tmp = node;
-
-        // Increment the node to the next hash
-        node = node->next;
-
-        // Free the node
-        delete tmp;
-      }
-    }
-
-    delete[] end_buckets;
-    delete[] hash_buckets;
-    hash_buckets = new_buckets;
+  // Keep the load factor below 1/2 so the probe sequences stay short
+  if (2 * (num_elems + 1) > table_size) {
+    resizeTable(2 * table_size);
   }
 
-  int bucket = getBucket(quad);
-
-  // If no quadrant has been added to the bucket,
-  // create a new bucket
-  if (!hash_buckets[bucket]) {
-    hash_buckets[bucket] = new QuadHashNode;
-    hash_buckets[bucket]->quad = *quad;
-    num_elems++;
-    return 1;
-  } else {
-    // Get the head node for the corresponding bucket
-    QuadHashNode *node = hash_buckets[bucket];
-    if (use_node_index) {
-      // Search the bucket to see if there's another node in the list
-      while (node) {
-        if (node->quad.compareNode(quad) == 0) {
-          return 0;
-        }
-
-        // If the next node does not exist, quit while node
-        // is the last node in the linked list
-        if (!node->next) {
-          break;
-        }
-        node = node->next;
+  // Probe the table until we find the quadrant or an empty slot
+  const uint32_t mask = table_size - 1;
+  uint32_t slot = getHash(quad) & mask;
+  if (use_node_index) {
+    while (table[slot] >= 0) {
+      if (elems[table[slot]].compareNode(quad) == 0) {
+        return 0;
       }
-    } else {
-      // Perform the same search, except using quads
-      while (node) {
-        if (node->quad.compare(quad) == 0) {
-          return 0;
-        }
-
-        if (!node->next) {
-          break;
-        }
-        node = node->next;
+      slot = (slot + 1) & mask;
+    }
+  } else {
+    while (table[slot] >= 0) {
+      if (elems[table[slot]].compare(quad) == 0) {
+        return 0;
       }
+      slot = (slot + 1) & mask;
     }
+  }
 
-    // Add the quadrant as the last node
-    node->next = new QuadHashNode;
-    node->next->quad = *quad;
-    num_elems++;
+  // Extend the contiguous storage if required
+  if (num_elems >= max_num_elems) {
+    max_num_elems = 2 * max_num_elems;
+    TMRQuadrant *temp = new TMRQuadrant[max_num_elems];
+    memcpy(temp, elems, num_elems * sizeof(TMRQuadrant));
+    delete[] elems;
+    elems = temp;
   }
 
+  // Add the quadrant to the end of the storage
+  elems[num_elems] = *quad;
+  table[slot] = num_elems;
+  num_elems++;
+
   return 1;
 }
 
 /*
-  Get a bucket to place the quadrant in.
+  Re-build the open-addressing table with a new size.
 
-  This code creates a value based on the quadrant location within the
-  mesh and then takes the remainder of the number of buckets.
+  The quadrants themselves do not move, only their indices are
+  re-inserted into the new table.
 */
-int TMRQuadrantHash::getBucket(TMRQuadrant *quad) {
-  // The hash value
-  uint32_t val = 0;
-
-  if (use_node_index) {
-    uint32_t u = 0, v = 0, w = 0;
-    u = quad->face;
-    v = (1 << TMR_MAX_LEVEL) + quad->x;
-    w = (1 << TMR_MAX_LEVEL) + quad->y;
-
-    // Compute the hash value
-    val = TMRIntegerTripletHash(u, v, w);
-  } else {
-    uint32_t u = 0, v = 0, w = 0;
-    u = quad->face;
-    v = (1 << TMR_MAX_LEVEL) + quad->x;
-    w = (1 << TMR_MAX_LEVEL) + quad->y;
-
-    // Compute the hash value
-    val = TMRIntegerTripletHash(u, v, w);
+void TMRQuadrantHash::resizeTable(int new_size) {
+  delete[] table;
+  table_size = new_size;
+  table = new int[table_size];
+  memset(table, 0xff, table_size * sizeof(int));
+
+  const uint32_t mask = table_size - 1;
+  for (int i = 0; i < num_elems; i++) {
+    uint32_t slot = getHash(&elems[i]) & mask;
+    while (table[slot] >= 0) {
+      slot = (slot + 1) & mask;
+    }
+    table[slot] = i;
   }
+}
+
+/*
+  Compute the hash value for the quadrant.
 
-  // Compute the bucket value
-  int bucket = val % num_buckets;
+  This code creates a value based on the quadrant location within the
+  mesh. Note that the level and info are not used so that nodes and
+  elements at the same position hash to the same slot.
+*/
+uint32_t TMRQuadrantHash::getHash(const TMRQuadrant *quad) {
+  uint32_t u = quad->face;
+  uint32_t v = (1 << TMR_MAX_LEVEL) + quad->x;
+  uint32_t w = (1 << TMR_MAX_LEVEL) + quad->y;
 
-  return bucket;
+  return TMRIntegerTripletHash(u, v, w);
 }
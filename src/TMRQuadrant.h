@@ -66,11 +66,16 @@ class TMRQuadrantArray {
 
   TMRQuadrantArray *duplicate();
   void getArray(TMRQuadrant **_array, int *_size);
+  size_t getMemoryUsage() { return max_size * sizeof(TMRQuadrant); }
   void sort();
+  void sortByTag();
   TMRQuadrant *contains(TMRQuadrant *q, const int use_position = 0);
   void merge(TMRQuadrantArray *list);
 
  private:
+  // Arrays shorter than this are sorted with qsort
+  static const int min_radix_sort_size = 256;
+
   int use_node_index;
   int is_sorted;
   int size, max_size;
@@ -81,7 +86,9 @@ class TMRQuadrantArray {
   Create a queue of quadrants
 
   This class defines a queue of quadrants that are used for the balance
-  and coarsen operations.
+  and coarsen operations. The quadrants are stored in a contiguous,
+  growable circular buffer that is handed over to the array object
+  by toArray() without a copy whenever possible.
 */
 class TMRQuadrantQueue {
  public:
@@ -94,17 +101,13 @@ class TMRQuadrantQueue {
   TMRQuadrantArray *toArray();
 
  private:
-  // Class that defines an element within the queue
-  class QuadQueueNode {
-   public:
-    QuadQueueNode() { next = NULL; }
-    TMRQuadrant quad;
-    QuadQueueNode *next;
-  };
-
-  // Keep track of the number of elements in the queue
-  int num_elems;
-  QuadQueueNode *root, *tip;
+  // The minimum capacity of the queue (must be a power of two)
+  static const int min_queue_size = 1 << 8;
+
+  // The circular buffer of quadrants: The entries start at the index
+  // start and wrap around the end of the buffer
+  int start, num_elems, max_num_elems;
+  TMRQuadrant *elems;
 };
 
 /*
@@ -113,38 +116,43 @@ class TMRQuadrantQueue {
   This object enables the creation of a unique set of quadrants such
   that no two have the same position/level combination. This hash
   table can then be made into an array of unique elements or nodes.
+
+  The quadrants are stored contiguously in the order in which they are
+  added. A separate open-addressing (linear probing) table of indices
+  into this storage is used for the look up so that no per-entry
+  allocation is required.
 */
 class TMRQuadrantHash {
  public:
-  TMRQuadrantHash(int _use_node_index = 0);
+  TMRQuadrantHash(int _use_node_index = 0, int size_hint = 0);
   ~TMRQuadrantHash();
 
   TMRQuadrantArray *toArray();
   int addQuadrant(TMRQuadrant *quad);
+  int length() { return num_elems; }
+  size_t getMemoryUsage() {
+    return table_size * sizeof(int) + max_num_elems * sizeof(TMRQuadrant);
+  }
 
  private:
-  // The minimum bucket size
-  static const int min_num_buckets = (1 << 12) - 1;
-
-  class QuadHashNode {
-   public:
-    QuadHashNode() { next = NULL; }
-    TMRQuadrant quad;
-    QuadHashNode *next;
-  };
+  // The minimum table size (must be a power of two)
+  static const int min_table_size = 1 << 12;
 
   // Set the element index/node
   int use_node_index;
 
-  // Keep track of the bucket size
-  int num_buckets;
-  QuadHashNode **hash_buckets;
+  // The open-addressing table of indices into the quadrant array.
+  // Empty slots are marked with a negative index.
+  int table_size;
+  int *table;
 
-  // Keep track of the number of elements
-  int num_elems;
+  // The contiguous storage for the unique quadrants
+  int num_elems, max_num_elems;
+  TMRQuadrant *elems;
 
-  // Get the buckets to place the quadrant in
-  int getBucket(TMRQuadrant *quad);
+  // Get the initial slot for the quadrant and resize the table
+  uint32_t getHash(const TMRQuadrant *quad);
+  void resizeTable(int new_size);
 };
 
 #endif  // TMR_QUADRANT_H
@@ -0,0 +1,175 @@
+/*
+  This file is part of the package TMR for adaptive mesh refinement.
+
+  Copyright (C) 2015 Georgia Tech Research Corporation.
+  Additional copyright (C) 2015 Graeme Kennedy.
+  All rights reserved.
+
+  TMR is licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this software except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef TMR_RADIX_SORT_H
+#define TMR_RADIX_SORT_H
+
+#include "TMRBase.h"
+
+/*
+  The following file defines the LSD radix sort used to order octants
+  and quadrants based on their Morton encoding.
+
+  Each entry is represented by a 128-bit unsigned key and the index of
+  the entry in the original array. The keys are sorted one byte at a
+  time starting from the least-significant byte. Bytes that are the
+  same for all keys are skipped, so the cost is proportional to the
+  number of bits that actually differ across the array. The sort is
+  stable.
+*/
+class TMRSortKey {
+ public:
+  uint64_t hi, lo;
+  int index;
+};
+
+/*
+  Spread the lower 21 bits of the input so that there are two zero
+  bits between each of the original bits
+*/
+inline uint64_t TMRSpreadBits3(uint64_t v) {
+  v &= 0x1fffff;
+  v = (v | v << 32) & 0x1f00000000ffffULL;
+  v = (v | v << 16) & 0x1f0000ff0000ffULL;
+  v = (v | v << 8) & 0x100f00f00f00f00fULL;
+  v = (v | v << 4) & 0x10c30c30c30c30c3ULL;
+  v = (v | v << 2) & 0x1249249249249249ULL;
+  return v;
+}
+
+/*
+  Compact every third bit of the input into the lower 21 bits. This
+  is the inverse of TMRSpreadBits3.
+*/
+inline uint64_t TMRCompactBits3(uint64_t v) {
+  v &= 0x1249249249249249ULL;
+  v = (v ^ (v >> 2)) & 0x10c30c30c30c30c3ULL;
+  v = (v ^ (v >> 4)) & 0x100f00f00f00f00fULL;
+  v = (v ^ (v >> 8)) & 0x1f0000ff0000ffULL;
+  v = (v ^ (v >> 16)) & 0x1f00000000ffffULL;
+  v = (v ^ (v >> 32)) & 0x1fffff;
+  return v;
+}
+
+/*
+  Spread the lower 32 bits of the input so that there is a zero bit
+  between each of the original bits
+*/
+inline uint64_t TMRSpreadBits2(uint64_t v) {
+  v &= 0xffffffffULL;
+  v = (v | v << 16) & 0x0000ffff0000ffffULL;
+  v = (v | v << 8) & 0x00ff00ff00ff00ffULL;
+  v = (v | v << 4) & 0x0f0f0f0f0f0f0f0fULL;
+  v = (v | v << 2) & 0x3333333333333333ULL;
+  v = (v | v << 1) & 0x5555555555555555ULL;
+  return v;
+}
+
+/*
+  Sort the keys using an LSD radix sort
+
+  input:
+  size:   the number of keys
+  keys:   the keys to sort
+  temp:   temporary storage of the same length as the keys
+
+  returns:
+  the pointer to the sorted keys (either keys or temp)
+*/
+inline TMRSortKey *TMRRadixSortKeys(int size, TMRSortKey *keys,
+                                    TMRSortKey *temp) {
+  // Compute the histograms for all the digits in a single pass
+  int *count = new int[16 * 256];
+  memset(count, 0, 16 * 256 * sizeof(int));
+  for (int i = 0; i < size; i++) {
+    uint64_t lo = keys[i].lo, hi = keys[i].hi;
+    for (int k = 0; k < 8; k++) {
+      count[256 * k + ((lo >> (8 * k)) & 0xff)]++;
+      count[256 * (k + 8) + ((hi >> (8 * k)) & 0xff)]++;
+    }
+  }
+
+  TMRSortKey *src = keys, *dest = temp;
+  for (int k = 0; k < 16; k++) {
+    int *c = &count[256 * k];
+
+    // Skip this digit if all the keys share the same value
+    int skip = 0;
+    for (int j = 0; j < 256; j++) {
+      if (c[j] == size) {
+        skip = 1;
+        break;
+      } else if (c[j] > 0) {
+        break;
+      }
+    }
+    if (skip) {
+      continue;
+    }
+
+    // Convert the counts to offsets
+    for (int j = 0, offset = 0; j < 256; j++) {
+      int tmp = c[j];
+      c[j] = offset;
+      offset += tmp;
+    }
+
+    // Scatter the keys into the destination array
+    const int shift = 8 * (k % 8);
+    if (k < 8) {
+      for (int i = 0; i < size; i++) {
+        dest[c[(src[i].lo >> shift) & 0xff]++] = src[i];
+      }
+    } else {
+      for (int i = 0; i < size; i++) {
+        dest[c[(src[i].hi >> shift) & 0xff]++] = src[i];
+      }
+    }
+
+    TMRSortKey *tmp = src;
+    src = dest;
+    dest = tmp;
+  }
+
+  delete[] count;
+
+  return src;
+}
+
+/*
+  Apply the permutation defined by the sorted keys to the array so
+  that array[i] = original array[keys[i].index].
+
+  The temporary storage must be large enough to hold size entries of
+  the array type. The unused half of the key storage from
+  TMRRadixSortKeys() can be used when the array entries are not larger
+  than the keys.
+*/
+template <class ArrayType>
+inline void TMRApplySortPermutation(int size, const TMRSortKey *keys,
+                                    ArrayType *array, void *temp) {
+  ArrayType *t = static_cast<ArrayType *>(temp);
+  for (int i = 0; i < size; i++) {
+    t[i] = array[keys[i].index];
+  }
+  memcpy(array, t, size * sizeof(ArrayType));
+}
+
+#endif  // TMR_RADIX_SORT_H
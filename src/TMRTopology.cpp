@@ -23,8 +23,10 @@
 #include <math.h>
 #include <stdio.h>
 
+#include "TMRHashFunction.h"
 #include "TMRMesh.h"
 #include "TMRNativeTopology.h"
+#include "TMRRadixSort.h"
 
 TMR_EXTERN_C_BEGIN
 #include "metis.h"
@@ -145,6 +147,20 @@ TMREdge::~TMREdge() {
   }
 }
 
+/*
+  Evaluate a batch of points. By default, this evaluates each point
+  in turn. Derived classes can implement a more efficient version.
+*/
+int TMREdge::evalPoints(int n, const double t[], TMRPoint X[]) {
+  int fail = 0;
+  for (int i = 0; i < n; i++) {
+    if (evalPoint(t[i], &X[i])) {
+      fail = 1;
+    }
+  }
+  return fail;
+}
+
 /*
   Perform the inverse evaluation
 */
@@ -154,6 +170,20 @@ int TMREdge::invEvalPoint(TMRPoint p, double *t) {
   return fail;
 }
 
+/*
+  Perform the inverse evaluation for a batch of points. By default,
+  this inverts each point in turn.
+*/
+int TMREdge::invEvalPoints(int n, const TMRPoint p[], double t[]) {
+  int fail = 0;
+  for (int i = 0; i < n; i++) {
+    if (invEvalPoint(p[i], &t[i])) {
+      fail = 1;
+    }
+  }
+  return fail;
+}
+
 /*
   Set the step size for the derivative
 */
@@ -636,6 +666,42 @@ int TMRFace::eval2ndDeriv(double u, double v, TMRPoint *X, TMRPoint *Xu,
   return fail;
 }
 
+/*
+  Evaluate a batch of points. By default, this evaluates each point
+  in turn. Derived classes can implement a more efficient version.
+*/
+int TMRFace::evalPoints(int n, const double u[], const double v[],
+                        TMRPoint X[]) {
+  int fail = 0;
+  for (int i = 0; i < n; i++) {
+    if (evalPoint(u[i], v[i], &X[i])) {
+      fail = 1;
+    }
+  }
+  return fail;
+}
+
+/*
+  Evaluate the points on a tensor grid. By default, this evaluates the
+  grid as a batch of points.
+*/
+int TMRFace::evalGrid(int nu, const double u[], int nv, const double v[],
+                      TMRPoint X[]) {
+  int n = nu * nv;
+  double *upts = new double[2 * n];
+  double *vpts = &upts[n];
+  for (int j = 0; j < nv; j++) {
+    for (int i = 0; i < nu; i++) {
+      upts[i + nu * j] = u[i];
+      vpts[i + nu * j] = v[j];
+    }
+  }
+
+  int fail = evalPoints(n, upts, vpts, X);
+  delete[] upts;
+  return fail;
+}
+
 /*
   Perform the inverse evaluation
 */
@@ -645,6 +711,21 @@ int TMRFace::invEvalPoint(TMRPoint p, double *u, double *v) {
   return fail;
 }
 
+/*
+  Perform the inverse evaluation for a batch of points. By default,
+  this inverts each point in turn.
+*/
+int TMRFace::invEvalPoints(int n, const TMRPoint p[], double u[],
+                           double v[]) {
+  int fail = 0;
+  for (int i = 0; i < n; i++) {
+    if (invEvalPoint(p[i], &u[i], &v[i])) {
+      fail = 1;
+    }
+  }
+  return fail;
+}
+
 /*
   Add the curves that bound the surface
 */
@@ -654,7 +735,7 @@ void TMRFace::addEdgeLoop(int loop_dir, TMREdgeLoop *loop) {
 
   if (num_loops >= max_num_loops) {
     // Extend the loops array
-    max_num_loops = (2 * num_loops > 10 ? 2 * num_loops : 10);
+    max_num_loops = (num_loops > 0 ? 2 * num_loops : 1);
 
     // Allocate the new loops array
     TMREdgeLoop **lps = new TMREdgeLoop *[max_num_loops];
@@ -945,6 +1026,25 @@ int TMRVolume::evalPoint(double u, double v, double w, TMRPoint *X) {
   return 1;
 }
 
+/*
+  Evaluate the points on a tensor grid. By default, this evaluates
+  each point in turn.
+*/
+int TMRVolume::evalGrid(int nu, const double u[], int nv, const double v[],
+                        int nw, const double w[], TMRPoint X[]) {
+  int fail = 0;
+  for (int k = 0; k < nw; k++) {
+    for (int j = 0; j < nv; j++) {
+      for (int i = 0; i < nu; i++) {
+        if (evalPoint(u[i], v[j], w[k], &X[i + nu * (j + nv * k)])) {
+          fail = 1;
+        }
+      }
+    }
+  }
+  return fail;
+}
+
 /*
   Get the faces that enclose this volume
 */
@@ -1045,35 +1145,43 @@ TMRModel::TMRModel(int _num_vertices, TMRVertex **_vertices, int _num_edges,
   edges = NULL;
   faces = NULL;
   volumes = NULL;
-  ordered_verts = NULL;
-  ordered_edges = NULL;
-  ordered_faces = NULL;
-  ordered_volumes = NULL;
+  vert_table = NULL;
+  edge_table = NULL;
+  face_table = NULL;
+  volume_table = NULL;
   initialize(_num_vertices, _vertices, _num_edges, _edges, _num_faces, _faces,
              _num_volumes, _volumes);
 
   int fix_me = verify();
 
   if (fix_me) {
-    TMRVertex **temp_verts = new TMRVertex *[num_vertices];
-    memcpy(temp_verts, vertices, num_vertices * sizeof(TMRVertex *));
-
-    TMREdge **temp_edges = new TMREdge *[num_edges];
-    memcpy(temp_edges, edges, num_edges * sizeof(TMREdge *));
-
-    TMRFace **temp_faces = new TMRFace *[num_faces];
-    memcpy(temp_faces, faces, num_faces * sizeof(TMRFace *));
-
-    TMRVolume **temp_vols = new TMRVolume *[num_volumes];
-    memcpy(temp_vols, volumes, num_volumes * sizeof(TMRVolume *));
+    // Remove the unreferenced vertices and edges, which have been
+    // released and set to NULL by verify(), and re-create the index
+    // tables. The reference counts of the remaining entities are
+    // already set.
+    int count = 0;
+    for (int i = 0; i < num_vertices; i++) {
+      if (vertices[i]) {
+        vertices[count] = vertices[i];
+        count++;
+      }
+    }
+    num_vertices = count;
 
-    initialize(num_vertices, temp_verts, num_edges, temp_edges, num_faces,
-               temp_faces, num_volumes, temp_vols);
+    count = 0;
+    for (int i = 0; i < num_edges; i++) {
+      if (edges[i]) {
+        edges[count] = edges[i];
+        count++;
+      }
+    }
+    num_edges = count;
 
-    delete[] temp_verts;
-    delete[] temp_edges;
-    delete[] temp_faces;
-    delete[] temp_vols;
+    delete[] vert_table;
+    delete[] edge_table;
+    vert_table =
+        createIndexTable(num_vertices, (void **)vertices, &vert_table_size);
+    edge_table = createIndexTable(num_edges, (void **)edges, &edge_table_size);
   }
 }
 
@@ -1193,54 +1301,26 @@ void TMRModel::initialize(int _num_vertices, TMRVertex **_vertices,
     }
   }
 
-  if (ordered_verts) {
-    delete[] ordered_verts;
+  if (vert_table) {
+    delete[] vert_table;
   }
-  if (ordered_edges) {
-    delete[] ordered_edges;
+  if (edge_table) {
+    delete[] edge_table;
   }
-  if (ordered_faces) {
-    delete[] ordered_faces;
+  if (face_table) {
+    delete[] face_table;
   }
-  if (ordered_volumes) {
-    delete[] ordered_volumes;
+  if (volume_table) {
+    delete[] volume_table;
   }
 
-  // Order the entities
-  ordered_verts = new OrderedPair<TMRVertex>[num_vertices];
-  ordered_edges = new OrderedPair<TMREdge>[num_edges];
-  ordered_faces = new OrderedPair<TMRFace>[num_faces];
-  ordered_volumes = new OrderedPair<TMRVolume>[num_volumes];
-
-  for (int i = 0; i < num_vertices; i++) {
-    ordered_verts[i].num = i;
-    ordered_verts[i].obj = vertices[i];
-  }
-
-  for (int i = 0; i < num_edges; i++) {
-    ordered_edges[i].num = i;
-    ordered_edges[i].obj = edges[i];
-  }
-
-  for (int i = 0; i < num_faces; i++) {
-    ordered_faces[i].num = i;
-    ordered_faces[i].obj = faces[i];
-  }
-
-  for (int i = 0; i < num_volumes; i++) {
-    ordered_volumes[i].num = i;
-    ordered_volumes[i].obj = volumes[i];
-  }
-
-  // Sort the vertices, curves and surfaces
-  qsort(ordered_verts, num_vertices, sizeof(OrderedPair<TMRVertex>),
-        compare_ordered_pairs<TMRVertex>);
-  qsort(ordered_edges, num_edges, sizeof(OrderedPair<TMREdge>),
-        compare_ordered_pairs<TMREdge>);
-  qsort(ordered_faces, num_faces, sizeof(OrderedPair<TMRFace>),
-        compare_ordered_pairs<TMRFace>);
-  qsort(ordered_volumes, num_volumes, sizeof(OrderedPair<TMRVolume>),
-        compare_ordered_pairs<TMRVolume>);
+  // Create the tables for the index look up
+  vert_table =
+      createIndexTable(num_vertices, (void **)vertices, &vert_table_size);
+  edge_table = createIndexTable(num_edges, (void **)edges, &edge_table_size);
+  face_table = createIndexTable(num_faces, (void **)faces, &face_table_size);
+  volume_table =
+      createIndexTable(num_volumes, (void **)volumes, &volume_table_size);
 }
 
 /*
@@ -1271,10 +1351,10 @@ TMRModel::~TMRModel() {
   delete[] edges;
   delete[] faces;
   delete[] volumes;
-  delete[] ordered_verts;
-  delete[] ordered_edges;
-  delete[] ordered_faces;
-  delete[] ordered_volumes;
+  delete[] vert_table;
+  delete[] edge_table;
+  delete[] face_table;
+  delete[] volume_table;
 }
 
 /*
@@ -1449,108 +1529,194 @@ void TMRModel::getVolumes(int *_num_volumes, TMRVolume ***_volumes) {
 }
 
 /*
-  Static member function for sorting the ordered pairs
+  Compute the hash value of the pointer to an object
 */
-template <class ctype>
-int TMRModel::compare_ordered_pairs(const void *avoid, const void *bvoid) {
-  const OrderedPair<ctype> *a = static_cast<const OrderedPair<ctype> *>(avoid);
-  const OrderedPair<ctype> *b = static_cast<const OrderedPair<ctype> *>(bvoid);
+uint32_t TMRModel::getPointerHash(const void *obj) {
+  uint64_t p = (uint64_t)((uintptr_t)obj);
+  return TMRIntegerPairHash(p & 0xffffffff, p >> 32);
+}
 
-  if (a->obj && b->obj) {
-    return a->obj->getEntityId() - b->obj->getEntityId();
-  } else if (a->obj) {
-    return 1;
-  } else if (b->obj) {
-    return -1;
+/*
+  Create the table that maps the pointer to each object to its index
+*/
+TMRModel::IndexPair *TMRModel::createIndexTable(int num, void *const *objs,
+                                                int *table_size) {
+  // Size the table so that it is at most half full
+  int size = 16;
+  while (size < 2 * num) {
+    size *= 2;
   }
-  return 0;
+
+  IndexPair *table = new IndexPair[size];
+  memset(table, 0, size * sizeof(IndexPair));
+
+  const uint32_t mask = size - 1;
+  for (int i = 0; i < num; i++) {
+    uint32_t slot = getPointerHash(objs[i]) & mask;
+    while (table[slot].obj) {
+      slot = (slot + 1) & mask;
+    }
+    table[slot].obj = objs[i];
+    table[slot].num = i;
+  }
+
+  *table_size = size;
+  return table;
+}
+
+/*
+  Find the index of the object within the table, or -1 if the object
+  is not in the table
+*/
+int TMRModel::findIndex(const void *obj, const IndexPair *table,
+                        int table_size) {
+  if (obj) {
+    const uint32_t mask = table_size - 1;
+    uint32_t slot = getPointerHash(obj) & mask;
+    while (table[slot].obj) {
+      if (table[slot].obj == obj) {
+        return table[slot].num;
+      }
+      slot = (slot + 1) & mask;
+    }
+  }
+  return -1;
 }
 
 /*
   Retrieve the index given the vertex point
 */
 int TMRModel::getVertexIndex(TMRVertex *vertex) {
-  OrderedPair<TMRVertex> pair;
-  pair.num = -1;
-  pair.obj = vertex;
-
-  // Search for the ordered pair
-  OrderedPair<TMRVertex> *item = (OrderedPair<TMRVertex> *)bsearch(
-      &pair, ordered_verts, num_vertices, sizeof(OrderedPair<TMRVertex>),
-      compare_ordered_pairs<TMRVertex>);
-  if (item) {
-    return item->num;
+  int index = findIndex(vertex, vert_table, vert_table_size);
+  if (index < 0) {
+    fprintf(stderr, "TMRModel error: Vertex index search failed\n");
   }
-
-  fprintf(stderr, "TMRModel error: Vertex index search failed\n");
-  return -1;
+  return index;
 }
 
 /*
   Retrieve the index given the pointer to the curve object
 */
 int TMRModel::getEdgeIndex(TMREdge *edge) {
-  OrderedPair<TMREdge> pair;
-  pair.num = -1;
-  pair.obj = edge;
-
-  // Search for the ordered pair
-  OrderedPair<TMREdge> *item = (OrderedPair<TMREdge> *)bsearch(
-      &pair, ordered_edges, num_edges, sizeof(OrderedPair<TMREdge>),
-      compare_ordered_pairs<TMREdge>);
-  if (item) {
-    return item->num;
+  int index = findIndex(edge, edge_table, edge_table_size);
+  if (index < 0) {
+    fprintf(stderr, "TMRModel error: Edge index search failed\n");
   }
-
-  fprintf(stderr, "TMRModel error: Edge index search failed\n");
-  return -1;
+  return index;
 }
 
 /*
   Retrieve the index given the pointer to the surface object
 */
 int TMRModel::getFaceIndex(TMRFace *face) {
-  OrderedPair<TMRFace> pair;
-  pair.num = -1;
-  pair.obj = face;
-
-  // Search for the ordered pair
-  OrderedPair<TMRFace> *item = (OrderedPair<TMRFace> *)bsearch(
-      &pair, ordered_faces, num_faces, sizeof(OrderedPair<TMRFace>),
-      compare_ordered_pairs<TMRFace>);
-  if (item) {
-    return item->num;
+  int index = findIndex(face, face_table, face_table_size);
+  if (index < 0) {
+    fprintf(stderr, "TMRModel error: Face index search failed\n");
   }
-
-  fprintf(stderr, "TMRModel error: Face index search failed\n");
-  return -1;
+  return index;
 }
 
 /*
   Retrieve the index given the pointer to the volume
 */
 int TMRModel::getVolumeIndex(TMRVolume *volume) {
-  OrderedPair<TMRVolume> pair;
-  pair.num = -1;
-  pair.obj = volume;
+  int index = findIndex(volume, volume_table, volume_table_size);
+  if (index < 0) {
+    fprintf(stderr, "TMRModel error: Volume index search failed\n");
+  }
+  return index;
+}
+
+/*
+  Compute the centroid of the vertices of the edges that bound a face
+*/
+static void computeFaceCentroid(TMRFace *face, TMRPoint *c) {
+  c->zero();
+  int count = 0;
+  for (int k = 0; k < face->getNumEdgeLoops(); k++) {
+    TMREdgeLoop *loop;
+    face->getEdgeLoop(k, &loop);
+
+    int nedges;
+    TMREdge **e;
+    loop->getEdgeLoop(&nedges, &e, NULL);
+    for (int j = 0; j < nedges; j++) {
+      TMRVertex *v[2];
+      e[j]->getVertices(&v[0], &v[1]);
+      for (int ii = 0; ii < 2; ii++) {
+        TMRPoint p;
+        if (v[ii] && v[ii]->evalPoint(&p) == 0) {
+          c->x += p.x;
+          c->y += p.y;
+          c->z += p.z;
+          count++;
+        }
+      }
+    }
+  }
+  if (count > 0) {
+    c->x /= count;
+    c->y /= count;
+    c->z /= count;
+  }
+}
+
+/*
+  Compute the index along the Hilbert curve of the point with the
+  given integer coordinates, each with the given number of bits.
+
+  This uses the transpose form of the Hilbert index from J. Skilling,
+  "Programming the Hilbert curve", AIP Conference Proceedings 707,
+  2004, and interleaves the transposed bits.
+*/
+static uint64_t computeHilbertIndex(uint32_t x[], int bits) {
+  const uint32_t m = 1U << (bits - 1);
 
-  // Search for the ordered pair
-  OrderedPair<TMRVolume> *item = (OrderedPair<TMRVolume> *)bsearch(
-      &pair, ordered_volumes, num_volumes, sizeof(OrderedPair<TMRVolume>),
-      compare_ordered_pairs<TMRVolume>);
-  if (item) {
-    return item->num;
+  // Undo the excess work of the inverse transform
+  for (uint32_t q = m; q > 1; q >>= 1) {
+    uint32_t p = q - 1;
+    for (int i = 0; i < 3; i++) {
+      if (x[i] & q) {
+        x[0] ^= p;
+      } else {
+        uint32_t t = (x[0] ^ x[i]) & p;
+        x[0] ^= t;
+        x[i] ^= t;
+      }
+    }
   }
 
-  fprintf(stderr, "TMRModel error: Volume index search failed\n");
-  return -1;
+  // Gray encode the coordinates
+  for (int i = 1; i < 3; i++) {
+    x[i] ^= x[i - 1];
+  }
+  uint32_t t = 0;
+  for (uint32_t q = m; q > 1; q >>= 1) {
+    if (x[2] & q) {
+      t ^= q - 1;
+    }
+  }
+  for (int i = 0; i < 3; i++) {
+    x[i] ^= t;
+  }
+
+  // Interleave the bits, starting from the most significant bit
+  uint64_t index = 0;
+  for (int b = bits - 1; b >= 0; b--) {
+    for (int i = 0; i < 3; i++) {
+      index = (index << 1) | ((x[i] >> b) & 1U);
+    }
+  }
+
+  return index;
 }
 
 /*
   The main topology class that contains the objects used to build the
   underlying mesh.
 */
-TMRTopology::TMRTopology(MPI_Comm _comm, TMRModel *_geo) {
+TMRTopology::TMRTopology(MPI_Comm _comm, TMRModel *_geo,
+                         TMRBlockOrderingType block_order) {
   // Set the communicator
   comm = _comm;
 
@@ -1575,6 +1741,10 @@ TMRTopology::TMRTopology(MPI_Comm _comm, TMRModel *_geo) {
   volume_to_new_num = NULL;
   new_num_to_volume = NULL;
 
+  // No forest connectivity has been cached yet
+  quad_conn_cache = NULL;
+  oct_conn_cache = NULL;
+
   // Get the geometry objects
   int num_vertices, num_edges, num_faces, num_volumes;
   TMRVertex **vertices;
@@ -1625,10 +1795,31 @@ TMRTopology::TMRTopology(MPI_Comm _comm, TMRModel *_geo) {
     volume_to_new_num = new int[num_volumes];
     new_num_to_volume = new int[num_volumes];
 
-    // Do not use the RCM reordering for the volumes
-    int use_rcm = 0;
-    reorderEntities(6, num_faces, num_volumes, volume_faces, volume_to_new_num,
-                    new_num_to_volume, use_rcm);
+    if (block_order == TMR_HILBERT_BLOCK_ORDER) {
+      // Order the volumes by the centroids of their faces
+      TMRPoint *centroids = new TMRPoint[num_volumes];
+      for (int i = 0; i < num_volumes; i++) {
+        int nfaces;
+        TMRFace **f;
+        volumes[i]->getFaces(&nfaces, &f);
+        centroids[i].zero();
+        for (int j = 0; j < nfaces; j++) {
+          TMRPoint c;
+          computeFaceCentroid(f[j], &c);
+          centroids[i].x += c.x / nfaces;
+          centroids[i].y += c.y / nfaces;
+          centroids[i].z += c.z / nfaces;
+        }
+      }
+      computeHilbertOrder(num_volumes, centroids, volume_to_new_num,
+                          new_num_to_volume);
+      delete[] centroids;
+    } else {
+      // Do not use the RCM reordering for the volumes
+      int use_rcm = 0;
+      reorderEntities(6, num_faces, num_volumes, volume_faces,
+                      volume_to_new_num, new_num_to_volume, use_rcm);
+    }
 
     // Free the temporary volume to faces pointer
     delete[] volume_faces;
@@ -1685,9 +1876,19 @@ TMRTopology::TMRTopology(MPI_Comm _comm, TMRModel *_geo) {
     face_to_new_num = new int[num_faces];
     new_num_to_face = new int[num_faces];
 
-    int use_rcm = 0;
-    reorderEntities(4, num_edges, num_faces, face_edges, face_to_new_num,
-                    new_num_to_face, use_rcm);
+    if (block_order == TMR_HILBERT_BLOCK_ORDER) {
+      TMRPoint *centroids = new TMRPoint[num_faces];
+      for (int i = 0; i < num_faces; i++) {
+        computeFaceCentroid(faces[i], &centroids[i]);
+      }
+      computeHilbertOrder(num_faces, centroids, face_to_new_num,
+                          new_num_to_face);
+      delete[] centroids;
+    } else {
+      int use_rcm = 0;
+      reorderEntities(4, num_edges, num_faces, face_edges, face_to_new_num,
+                      new_num_to_face, use_rcm);
+    }
 
     // Delete face edges
     delete[] face_edges;
@@ -1737,6 +1938,14 @@ TMRTopology::~TMRTopology() {
   if (new_num_to_volume) {
     delete[] new_num_to_volume;
   }
+
+  // Free the cached forest connectivity
+  if (quad_conn_cache) {
+    quad_conn_cache->decref();
+  }
+  if (oct_conn_cache) {
+    oct_conn_cache->decref();
+  }
 }
 
 /*
@@ -2139,6 +2348,75 @@ void TMRTopology::reorderEntities(int num_entities, int num_edges,
   }
 }
 
+/*
+  Order the entities along a Hilbert curve through their centroids
+
+  The centroids are scaled to the bounding box of all the centroids
+  and rounded to a grid with 2^21 points along each direction. The
+  ordering is computed on the root processor and broadcast so that
+  all processors use the same ordering.
+
+  input:
+  num_entities:       the number of entities
+  centroids:          the centroid of each entity
+
+  output:
+  entity_to_new_num:  the new number of each entity
+  new_num_to_entity:  the entity for each new number
+*/
+void TMRTopology::computeHilbertOrder(int num_entities,
+                                      const TMRPoint *centroids,
+                                      int *entity_to_new_num,
+                                      int *new_num_to_entity) {
+  int mpi_rank;
+  MPI_Comm_rank(comm, &mpi_rank);
+
+  if (mpi_rank == 0 && num_entities > 0) {
+    // Find the bounding box of the centroids
+    TMRPoint xmin = centroids[0], xmax = centroids[0];
+    for (int i = 1; i < num_entities; i++) {
+      xmin.x = (centroids[i].x < xmin.x ? centroids[i].x : xmin.x);
+      xmin.y = (centroids[i].y < xmin.y ? centroids[i].y : xmin.y);
+      xmin.z = (centroids[i].z < xmin.z ? centroids[i].z : xmin.z);
+      xmax.x = (centroids[i].x > xmax.x ? centroids[i].x : xmax.x);
+      xmax.y = (centroids[i].y > xmax.y ? centroids[i].y : xmax.y);
+      xmax.z = (centroids[i].z > xmax.z ? centroids[i].z : xmax.z);
+    }
+
+    // Use the same scale along each direction
+    double d = xmax.x - xmin.x;
+    d = (xmax.y - xmin.y > d ? xmax.y - xmin.y : d);
+    d = (xmax.z - xmin.z > d ? xmax.z - xmin.z : d);
+    const int bits = 21;
+    const double scale = (d > 0.0 ? ((1 << bits) - 1) / d : 0.0);
+
+    TMRSortKey *keys = new TMRSortKey[2 * num_entities];
+    for (int i = 0; i < num_entities; i++) {
+      uint32_t x[3];
+      x[0] = (uint32_t)(scale * (centroids[i].x - xmin.x));
+      x[1] = (uint32_t)(scale * (centroids[i].y - xmin.y));
+      x[2] = (uint32_t)(scale * (centroids[i].z - xmin.z));
+      keys[i].hi = 0;
+      keys[i].lo = computeHilbertIndex(x, bits);
+      keys[i].index = i;
+    }
+
+    TMRSortKey *sorted =
+        TMRRadixSortKeys(num_entities, keys, &keys[num_entities]);
+    for (int i = 0; i < num_entities; i++) {
+      entity_to_new_num[sorted[i].index] = i;
+    }
+    delete[] keys;
+  }
+
+  // Broadcast the new ordering
+  MPI_Bcast(entity_to_new_num, num_entities, MPI_INT, 0, comm);
+
+  for (int i = 0; i < num_entities; i++) {
+    new_num_to_entity[entity_to_new_num[i]] = i;
+  }
+}
+
 /*
   Get the volume associated with the given volume number
 */
@@ -2276,3 +2554,45 @@ void TMRTopology::getConnectivity(int *nnodes, int *nedges, int *nfaces,
   *volume_edges = volume_to_edges;
   *volume_faces = volume_to_faces;
 }
+
+/*
+  Set the quadtree connectivity data derived from this topology
+
+  The connectivity is owned by TMRQuadForest and is opaque to the
+  topology. It must not be modified once it has been cached.
+*/
+void TMRTopology::setQuadConnCache(TMREntity *conn) {
+  if (conn) {
+    conn->incref();
+  }
+  if (quad_conn_cache) {
+    quad_conn_cache->decref();
+  }
+  quad_conn_cache = conn;
+}
+
+/*
+  Retrieve the cached quadtree connectivity, or NULL if none is set
+*/
+TMREntity *TMRTopology::getQuadConnCache() { return quad_conn_cache; }
+
+/*
+  Set the octree connectivity data derived from this topology
+
+  The connectivity is owned by TMROctForest and is opaque to the
+  topology. It must not be modified once it has been cached.
+*/
+void TMRTopology::setOctConnCache(TMREntity *conn) {
+  if (conn) {
+    conn->incref();
+  }
+  if (oct_conn_cache) {
+    oct_conn_cache->decref();
+  }
+  oct_conn_cache = conn;
+}
+
+/*
+  Retrieve the cached octree connectivity, or NULL if none is set
+*/
+TMREntity *TMRTopology::getOctConnCache() { return oct_conn_cache; }
@@ -87,9 +87,15 @@ class TMREdge : public TMREntity {
   // Given the parametric point, compute the x,y,z location
   virtual int evalPoint(double t, TMRPoint *X) = 0;
 
+  // Evaluate the x,y,z locations of a batch of parametric points
+  virtual int evalPoints(int n, const double t[], TMRPoint X[]);
+
   // Perform the inverse evaluation
   virtual int invEvalPoint(TMRPoint p, double *t);
 
+  // Perform the inverse evaluation for a batch of points
+  virtual int invEvalPoints(int n, const TMRPoint p[], double t[]);
+
   // Given the parametric point, evaluate the first derivative
   virtual int evalDeriv(double t, TMRPoint *X, TMRPoint *Xt);
 
@@ -180,9 +186,21 @@ class TMRFace : public TMREntity {
   // Given the parametric point, compute the x,y,z location
   virtual int evalPoint(double u, double v, TMRPoint *X) = 0;
 
+  // Evaluate the x,y,z locations of a batch of parametric points
+  virtual int evalPoints(int n, const double u[], const double v[],
+                         TMRPoint X[]);
+
+  // Evaluate the x,y,z locations on the tensor grid of parametric
+  // points, X[i + nu*j] at (u[i], v[j])
+  virtual int evalGrid(int nu, const double u[], int nv, const double v[],
+                       TMRPoint X[]);
+
   // Perform the inverse evaluation
   virtual int invEvalPoint(TMRPoint p, double *u, double *v);
 
+  // Perform the inverse evaluation for a batch of points
+  virtual int invEvalPoints(int n, const TMRPoint p[], double u[], double v[]);
+
   // Given the parametric point, evaluate the first derivative
   virtual int evalDeriv(double u, double v, TMRPoint *X, TMRPoint *Xu,
                         TMRPoint *Xv);
@@ -260,6 +278,11 @@ class TMRVolume : public TMREntity {
   // Given the parametric point u,v,w compute the physical location x,y,z
   virtual int evalPoint(double u, double v, double w, TMRPoint *X);
 
+  // Evaluate the x,y,z locations on the tensor grid of parametric
+  // points, X[i + nu*(j + nv*k)] at (u[i], v[j], w[k])
+  virtual int evalGrid(int nu, const double u[], int nv, const double v[],
+                       int nw, const double w[], TMRPoint X[]);
+
   // Get the faces that enclose this volume
   void getFaces(int *_num_faces, TMRFace ***_faces);
 
@@ -321,24 +344,37 @@ class TMRModel : public TMREntity {
   TMRFace **faces;
   TMRVolume **volumes;
 
-  // This keeps track of the ordering of the geometry objects and
-  // enables a fast object -> object index lookup
-  template <class ctype>
-  class OrderedPair {
+  // Open-addressing (linear probing) tables that map the pointer to
+  // each object to its index. This enables a fast object -> index
+  // lookup without accessing the object itself. Empty slots are
+  // marked with a NULL pointer.
+  class IndexPair {
    public:
+    const void *obj;
     int num;
-    ctype *obj;
   };
 
-  template <class ctype>
-  static int compare_ordered_pairs(const void *avoid, const void *bvoid);
+  static IndexPair *createIndexTable(int num, void *const *objs,
+                                     int *table_size);
+  static int findIndex(const void *obj, const IndexPair *table,
+                       int table_size);
+  static uint32_t getPointerHash(const void *obj);
 
-  OrderedPair<TMRVertex> *ordered_verts;
-  OrderedPair<TMREdge> *ordered_edges;
-  OrderedPair<TMRFace> *ordered_faces;
-  OrderedPair<TMRVolume> *ordered_volumes;
+  int vert_table_size, edge_table_size, face_table_size, volume_table_size;
+  IndexPair *vert_table, *edge_table, *face_table, *volume_table;
 };
 
+/*
+  The order of the blocks (the faces or volumes) of the forest
+
+  The graph order partitions the connectivity graph of the blocks on
+  multiple processors, or orders it by level sets on one processor.
+  The Hilbert order sorts the blocks along a Hilbert curve through
+  their centroids, so that any contiguous range of blocks is compact
+  in space independent of the number of processors.
+*/
+enum TMRBlockOrderingType { TMR_GRAPH_BLOCK_ORDER, TMR_HILBERT_BLOCK_ORDER };
+
 /*
   The main topology class that contains the objects used to build the
   underlying mesh.
@@ -381,7 +417,8 @@ class TMRModel : public TMREntity {
 */
 class TMRTopology : public TMREntity {
  public:
-  TMRTopology(MPI_Comm _comm, TMRModel *geo);
+  TMRTopology(MPI_Comm _comm, TMRModel *geo,
+              TMRBlockOrderingType block_order = TMR_GRAPH_BLOCK_ORDER);
   ~TMRTopology();
 
   // Retrieve the face/edge/node information
@@ -403,6 +440,13 @@ class TMRTopology : public TMREntity {
                        const int **volume_nodes, const int **volume_edges,
                        const int **volume_faces);
 
+  // Cache the connectivity data derived by the quadtree and octree
+  // forests so that other forests built from this topology re-use it
+  void setQuadConnCache(TMREntity *conn);
+  TMREntity *getQuadConnCache();
+  void setOctConnCache(TMREntity *conn);
+  TMREntity *getOctConnCache();
+
  private:
   // Compute the face connectivity
   void computeConnectivty(int num_entities, int num_edges, int num_faces,
@@ -411,6 +455,8 @@ class TMRTopology : public TMREntity {
   void reorderEntities(int num_entities, int num_edges, int num_faces,
                        const int *ftoedges, int *entity_to_new_num,
                        int *new_num_to_entity, int use_rcm = 1);
+  void computeHilbertOrder(int num_entities, const TMRPoint *centroids,
+                           int *entity_to_new_num, int *new_num_to_entity);
 
   // Connectivity for face -> edge, face -> vertex and edge -> vertex
   void computeFaceConn();
@@ -437,6 +483,10 @@ class TMRTopology : public TMREntity {
   int *volume_to_new_num;
   int *new_num_to_volume;
 
+  // The connectivity cached by the quadtree and octree forests
+  TMREntity *quad_conn_cache;
+  TMREntity *oct_conn_cache;
+
   // The geometry class
   TMRModel *geo;
 };
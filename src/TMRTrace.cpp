@@ -0,0 +1,236 @@
+/*
+  This file is part of the package TMR for adaptive mesh refinement.
+
+  Copyright (C) 2015 Georgia Tech Research Corporation.
+  Additional copyright (C) 2015 Graeme Kennedy.
+  All rights reserved.
+
+  TMR is licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this software except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include "TMRTrace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef TMR_HAS_OPENMP
+#include <omp.h>
+#endif  // TMR_HAS_OPENMP
+
+#ifdef TMR_HAS_TRACE
+
+/*
+  A completed event in the trace. The name is not copied, so it must
+  be a string literal.
+*/
+class TMRTraceEvent {
+ public:
+  const char *name;
+  double start, duration;
+  long long bytes;
+};
+
+// The state of the trace on this processor
+static int TMR_trace_active = 0;
+static char *TMR_trace_filename = NULL;
+static double TMR_trace_start = 0.0;
+static int TMR_trace_num_events = 0;
+static int TMR_trace_max_events = 0;
+static TMRTraceEvent *TMR_trace_events = NULL;
+
+/*
+  Start recording the trace events, to be written to the given file
+*/
+void TMRTraceInitialize(const char *filename) {
+  if (TMR_trace_active || !filename) {
+    return;
+  }
+  if (filename[0] == '\0') {
+    filename = "tmr_trace.json";
+  }
+
+  TMR_trace_filename = new char[strlen(filename) + 1];
+  strcpy(TMR_trace_filename, filename);
+
+  TMR_trace_num_events = 0;
+  TMR_trace_max_events = 4096;
+  TMR_trace_events = new TMRTraceEvent[TMR_trace_max_events];
+  TMR_trace_start = MPI_Wtime();
+  TMR_trace_active = 1;
+}
+
+/*
+  Check whether the trace is being recorded
+*/
+int TMRTraceIsActive() { return TMR_trace_active; }
+
+/*
+  Start an event for the enclosing scope
+*/
+TMRTraceScope::TMRTraceScope(const char *_name) {
+  active = TMR_trace_active;
+#ifdef TMR_HAS_OPENMP
+  if (omp_in_parallel()) {
+    active = 0;
+  }
+#endif  // TMR_HAS_OPENMP
+  name = _name;
+  bytes = 0;
+  start = 0.0;
+  if (active) {
+    start = MPI_Wtime();
+  }
+}
+
+/*
+  Complete the event and add it to the trace
+*/
+TMRTraceScope::~TMRTraceScope() {
+  if (active) {
+    TMRTraceAddEvent(name, start, MPI_Wtime(), bytes);
+  }
+}
+
+/*
+  Add an event that started and ended at the given times
+*/
+void TMRTraceAddEvent(const char *name, double start, double end,
+                      long long bytes) {
+  if (!TMR_trace_active) {
+    return;
+  }
+#ifdef TMR_HAS_OPENMP
+  if (omp_in_parallel()) {
+    return;
+  }
+#endif  // TMR_HAS_OPENMP
+
+  // Extend the event array if needed
+  if (TMR_trace_num_events >= TMR_trace_max_events) {
+    TMR_trace_max_events *= 2;
+    TMRTraceEvent *events = new TMRTraceEvent[TMR_trace_max_events];
+    memcpy(events, TMR_trace_events,
+           TMR_trace_num_events * sizeof(TMRTraceEvent));
+    delete[] TMR_trace_events;
+    TMR_trace_events = events;
+  }
+
+  TMRTraceEvent *e = &TMR_trace_events[TMR_trace_num_events];
+  e->name = name;
+  e->start = start - TMR_trace_start;
+  e->duration = end - start;
+  e->bytes = bytes;
+  TMR_trace_num_events++;
+}
+
+/*
+  Gather the events from all processors onto the root processor and
+  write them to the trace file. This must be called on all processors
+  in MPI_COMM_WORLD.
+*/
+void TMRTraceFinalize() {
+  int finalized;
+  MPI_Finalized(&finalized);
+  if (!TMR_trace_active || finalized) {
+    return;
+  }
+  TMR_trace_active = 0;
+
+  int mpi_rank, mpi_size;
+  MPI_Comm_rank(MPI_COMM_WORLD, &mpi_rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &mpi_size);
+
+  // Write the events from this processor into a buffer. Each event
+  // takes at most the length of its name plus the formatted numbers.
+  int max_len = 128;
+  for (int i = 0; i < TMR_trace_num_events; i++) {
+    max_len += strlen(TMR_trace_events[i].name) + 160;
+  }
+  char *buffer = new char[max_len];
+  int len = sprintf(buffer,
+                    "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,"
+                    "\"args\":{\"name\":\"rank %d\"}}",
+                    mpi_rank, mpi_rank);
+  for (int i = 0; i < TMR_trace_num_events; i++) {
+    const TMRTraceEvent *e = &TMR_trace_events[i];
+    len += sprintf(&buffer[len],
+                   ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":0,"
+                   "\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"bytes\":%lld}}",
+                   e->name, mpi_rank, 1e6 * e->start, 1e6 * e->duration,
+                   e->bytes);
+  }
+
+  // Gather the buffers onto the root processor
+  int *counts = NULL, *ptr = NULL;
+  if (mpi_rank == 0) {
+    counts = new int[mpi_size];
+    ptr = new int[mpi_size + 1];
+  }
+  MPI_Gather(&len, 1, MPI_INT, counts, 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+  char *all = NULL;
+  if (mpi_rank == 0) {
+    ptr[0] = 0;
+    for (int i = 0; i < mpi_size; i++) {
+      ptr[i + 1] = ptr[i] + counts[i];
+    }
+    all = new char[ptr[mpi_size]];
+  }
+  MPI_Gatherv(buffer, len, MPI_CHAR, all, counts, ptr, MPI_CHAR, 0,
+              MPI_COMM_WORLD);
+
+  if (mpi_rank == 0) {
+    FILE *fp = fopen(TMR_trace_filename, "w");
+    if (fp) {
+      fprintf(fp, "{\"traceEvents\":[\n");
+      for (int i = 0; i < mpi_size; i++) {
+        if (i > 0) {
+          fprintf(fp, ",\n");
+        }
+        fwrite(&all[ptr[i]], 1, counts[i], fp);
+      }
+      fprintf(fp, "\n],\"displayTimeUnit\":\"ms\"}\n");
+      fclose(fp);
+    } else {
+      fprintf(stderr, "TMRTraceFinalize: Could not open file %s\n",
+              TMR_trace_filename);
+    }
+    delete[] counts;
+    delete[] ptr;
+    delete[] all;
+  }
+
+  delete[] buffer;
+  delete[] TMR_trace_events;
+  delete[] TMR_trace_filename;
+  TMR_trace_events = NULL;
+  TMR_trace_filename = NULL;
+  TMR_trace_num_events = TMR_trace_max_events = 0;
+}
+
+#else
+
+void TMRTraceInitialize(const char *filename) {
+  if (filename) {
+    fprintf(stderr,
+            "TMRTraceInitialize Warning: TMR was compiled without "
+            "-DTMR_HAS_TRACE, no trace will be recorded\n");
+  }
+}
+
+int TMRTraceIsActive() { return 0; }
+
+void TMRTraceFinalize() {}
+
+#endif  // TMR_HAS_TRACE
@@ -0,0 +1,88 @@
+/*
+  This file is part of the package TMR for adaptive mesh refinement.
+
+  Copyright (C) 2015 Georgia Tech Research Corporation.
+  Additional copyright (C) 2015 Graeme Kennedy.
+  All rights reserved.
+
+  TMR is licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this software except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef TMR_TRACE_H
+#define TMR_TRACE_H
+
+#include "mpi.h"
+
+/*
+  A low-overhead trace of the major operations within TMR
+
+  The trace is only compiled when TMR is built with -DTMR_HAS_TRACE.
+  Otherwise the TMR_TRACE_* macros expand to nothing and the
+  instrumentation has no cost.
+
+  When compiled in, the trace is switched on by passing a file name to
+  TMRInitialize() or by setting the TMR_TRACE environment variable to
+  the file name. Each TMR_TRACE_SCOPE records the wall time of the
+  enclosing C++ scope on each processor, together with the number of
+  bytes that the operation reports with TMR_TRACE_BYTES. Operations
+  that are not confined to a single scope are recorded with
+  TMR_TRACE_EVENT using start and end times from MPI_Wtime(). The
+  events are kept in memory on each processor, and TMRFinalize()
+  gathers them onto the root of MPI_COMM_WORLD, which writes a Chrome
+  trace (JSON) file that can be loaded in Perfetto or
+  chrome://tracing. Each processor appears as a separate process in
+  the trace. The timestamps are measured from the time that the trace
+  is started on each processor.
+
+  Only scopes entered outside of an OpenMP parallel region are
+  recorded.
+*/
+void TMRTraceInitialize(const char *filename);
+int TMRTraceIsActive();
+void TMRTraceFinalize();
+
+#ifdef TMR_HAS_TRACE
+
+class TMRTraceScope {
+ public:
+  TMRTraceScope(const char *_name);
+  ~TMRTraceScope();
+
+  // Add to the number of bytes recorded for this event
+  void addBytes(long long nbytes) { bytes += nbytes; }
+
+ private:
+  const char *name;
+  double start;
+  long long bytes;
+  int active;
+};
+
+// Add an event that was timed by the caller with MPI_Wtime()
+void TMRTraceAddEvent(const char *name, double start, double end,
+                      long long bytes);
+
+#define TMR_TRACE_SCOPE(name) TMRTraceScope tmr_trace_scope(name)
+#define TMR_TRACE_BYTES(nbytes) tmr_trace_scope.addBytes(nbytes)
+#define TMR_TRACE_EVENT(name, start, end) \
+  TMRTraceAddEvent(name, start, end, 0)
+
+#else
+
+#define TMR_TRACE_SCOPE(name)
+#define TMR_TRACE_BYTES(nbytes)
+#define TMR_TRACE_EVENT(name, start, end)
+
+#endif  // TMR_HAS_TRACE
+
+#endif  // TMR_TRACE_H
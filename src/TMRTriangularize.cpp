@@ -243,6 +243,19 @@ TMRQuadNode::~TMRQuadNode() {
   }
 }
 
+/*
+  Get the memory used by the point arrays of this node and its children
+*/
+size_t TMRQuadNode::getMemoryUsage() {
+  size_t bytes = sizeof(TMRQuadNode) +
+                 NODES_PER_LEVEL * (2 * sizeof(double) + sizeof(uint32_t));
+  if (low_left) {
+    bytes += (low_left->getMemoryUsage() + low_right->getMemoryUsage() +
+              up_left->getMemoryUsage() + up_right->getMemoryUsage());
+  }
+  return bytes;
+}
+
 /*
   Add a node to the quadtree.
 
@@ -503,17 +516,36 @@ void TMRTriangularize::initialize(int npts, const double inpts[], int nholes,
   face = surf;
   face->incref();
 
-  // Allocate and initialize/zero the hash table data for the edges
-  num_hash_nodes = 0;
-  num_buckets = 100;
-  buckets = new EdgeHashNode *[num_buckets];
-  memset(buckets, 0, num_buckets * sizeof(EdgeHashNode *));
-
-  // Set the initial root/current location of the doubly-linked
-  // triangle list structure. These are allocated as we add new
+  // Allocate the initial triangle arrays. These are sized for the
+  // triangulation of the initial points and extended as we add new
   // triangles.
-  list_start = NULL;
-  list_end = NULL;
+  num_tri_entries = 0;
+  max_num_tris = 1024;
+  if (max_num_tris < 2 * (npts + FIXED_POINT_OFFSET)) {
+    max_num_tris = 2 * (npts + FIXED_POINT_OFFSET);
+  }
+
+  // Allocate and initialize the edge table so that it remains at most
+  // half full for the initial triangles. The entries are all set to
+  // NO_TRIANGLE.
+  num_edges = 0;
+  edge_table_size = 1024;
+  while (edge_table_size < 6 * (uint32_t)max_num_tris) {
+    edge_table_size *= 2;
+  }
+  edge_table = new uint32_t[edge_table_size];
+  memset(edge_table, 0xff, edge_table_size * sizeof(uint32_t));
+
+  tris = new TMRTriangle[max_num_tris];
+  adjacent = new uint32_t[3 * max_num_tris];
+  stamps = new uint32_t[max_num_tris];
+  free_tris = NO_TRIANGLE;
+  next_stamp = 0;
+
+  // Allocate space to store the newly added triangles
+  num_new_tris = 0;
+  max_num_new_tris = 64;
+  new_tris = new uint32_t[max_num_new_tris];
 
   // Keep track of the total number of triangles
   num_triangles = 0;
@@ -530,7 +562,7 @@ void TMRTriangularize::initialize(int npts, const double inpts[], int nholes,
 
   // Allocate the initial set of points
   pts = new double[2 * max_num_points];
-  pts_to_tris = new TMRTriangle *[max_num_points];
+  pts_to_tris = new uint32_t[max_num_points];
 
   // If we have a face object
   X = new TMRPoint[max_num_points];
@@ -566,6 +598,7 @@ void TMRTriangularize::initialize(int npts, const double inpts[], int nholes,
   // Allocate the new root mode
   root = new TMRQuadNode(&domain);
   search_tag = 0;
+  last_point = 0;
 
   // Set up the PSLG edges
   setUpPSLGEdges(nsegs, segs);
@@ -602,8 +635,12 @@ void TMRTriangularize::initialize(int npts, const double inpts[], int nholes,
 
   // Add the points to the triangle. This creates a CDT of the
   // original set of points.
-  for (int i = 0; i < npts; i++) {
-    addPointToMesh(&inpts[2 * i], NULL);
+  if (npts > BULK_INSERTION_POINTS) {
+    addPointsToMesh(npts, inpts);
+  } else {
+    for (int i = 0; i < npts; i++) {
+      addPointToMesh(&inpts[2 * i], NULL);
+    }
   }
 
   // Ensure that all the segments are in the triangulation to
@@ -631,31 +668,27 @@ void TMRTriangularize::initialize(int npts, const double inpts[], int nholes,
   // Mark all the triangles in the list that contain or touch nodes
   // that are in the FIXED_POINT_OFFSET list that are not separated by
   // a PSLG edge. These triangles will be deleted.
-  TriListNode *node = list_start;
   uint32_t max_node_num = num_points - nholes;
-  while (node) {
-    if (node->tri.status != DELETE_ME && node->tri.tag == 0 &&
-        ((node->tri.u < FIXED_POINT_OFFSET ||
-          node->tri.v < FIXED_POINT_OFFSET ||
-          node->tri.w < FIXED_POINT_OFFSET) ||
-         (node->tri.u >= max_node_num || node->tri.v >= max_node_num ||
-          node->tri.w >= max_node_num))) {
-      tagTriangles(&node->tri);
+  for (int i = 0; i < num_tri_entries; i++) {
+    TMRTriangle *t = &tris[i];
+    if (t->status != DELETE_ME && t->tag == 0 &&
+        ((t->u < FIXED_POINT_OFFSET || t->v < FIXED_POINT_OFFSET ||
+          t->w < FIXED_POINT_OFFSET) ||
+         (t->u >= max_node_num || t->v >= max_node_num ||
+          t->w >= max_node_num))) {
+      tagTriangles(t);
     }
-    node = node->next;
   }
 
   // Free the triangles that have been tagged
-  node = list_start;
-  while (node) {
-    if (node->tri.tag == 1) {
-      deleteTriangle(node->tri);
+  for (int i = 0; i < num_tri_entries; i++) {
+    if (tris[i].status != DELETE_ME && tris[i].tag == 1) {
+      deleteTriangle(&tris[i]);
     }
-    node = node->next;
   }
 
-  // Free the trianlges marked for deletion from the list
-  deleteTrianglesFromList();
+  // Remove the deleted triangles from the array
+  compactTriangles();
 
   // Free the points and holes from the quadtree
   for (int num = 0; num < FIXED_POINT_OFFSET; num++) {
@@ -671,18 +704,16 @@ void TMRTriangularize::initialize(int npts, const double inpts[], int nholes,
   // Perform the delaunay edge flip algorithm
   delaunayEdgeFlip();
 
-  // Free the trianlges marked for deletion from the list
-  deleteTrianglesFromList();
+  // Remove the deleted triangles from the array
+  compactTriangles();
 
   // Reset the node->traingle pointers to avoid referring to a
   // triangle that belonged to a hole and was deleted.
-  node = list_start;
-  memset(pts_to_tris, 0, num_points * sizeof(TMRTriangle *));
-  while (node) {
-    pts_to_tris[node->tri.u] = &(node->tri);
-    pts_to_tris[node->tri.v] = &(node->tri);
-    pts_to_tris[node->tri.w] = &(node->tri);
-    node = node->next;
+  memset(pts_to_tris, 0xff, num_points * sizeof(uint32_t));
+  for (int i = 0; i < num_tri_entries; i++) {
+    pts_to_tris[tris[i].u] = i;
+    pts_to_tris[tris[i].v] = i;
+    pts_to_tris[tris[i].w] = i;
   }
 }
 
@@ -705,23 +736,38 @@ TMRTriangularize::~TMRTriangularize() {
     delete[] pslg_edges;
   }
 
-  // Free the data for the edge hash table
-  for (int i = 0; i < num_buckets; i++) {
-    EdgeHashNode *node = buckets[i];
-    while (node) {
-      EdgeHashNode *tmp = node;
-      node = node->next;
-      delete tmp;
-    }
-  }
-  delete[] buckets;
+  // Free the edge table and the triangles
+  delete[] edge_table;
+  delete[] tris;
+  delete[] adjacent;
+  delete[] stamps;
+  delete[] new_tris;
+}
 
-  // Free the doubly linked edge list
-  while (list_start) {
-    TriListNode *tmp = list_start;
-    list_start = list_start->next;
-    delete tmp;
-  }
+/*
+  Report the memory held by the arrays of the triangulation
+
+  The report is local to this processor. Note that the arrays grow by
+  doubling, so the bytes reported are the allocated lengths, not the
+  number of entries in use.
+
+  returns: the memory report
+*/
+TMRMemoryUsage *TMRTriangularize::getMemoryUsage() {
+  TMRMemoryUsage *usage = new TMRMemoryUsage();
+
+  usage->addArray("pts", 2 * max_num_points * sizeof(double));
+  usage->addArray("X", max_num_points * sizeof(TMRPoint));
+  usage->addArray("pts_to_tris", max_num_points * sizeof(uint32_t));
+  usage->addArray("pslg_edges", 2 * num_pslg_edges * sizeof(uint32_t));
+  usage->addArray("quadtree", root ? root->getMemoryUsage() : 0);
+  usage->addArray("tris", max_num_tris * sizeof(TMRTriangle));
+  usage->addArray("adjacent", 3 * max_num_tris * sizeof(uint32_t));
+  usage->addArray("stamps", max_num_tris * sizeof(uint32_t));
+  usage->addArray("new_tris", max_num_new_tris * sizeof(uint32_t));
+  usage->addArray("edge_table", edge_table_size * sizeof(uint32_t));
+
+  return usage;
 }
 
 /*
@@ -740,11 +786,13 @@ TMRTriangularize::~TMRTriangularize() {
 void TMRTriangularize::delaunayEdgeFlip() {
   std::queue<TriEdge> q;
 
-  TriListNode *node = list_start;
-  while (node) {
-    uint32_t u = node->tri.u;
-    uint32_t v = node->tri.v;
-    uint32_t w = node->tri.w;
+  for (int i = 0; i < num_tri_entries; i++) {
+    if (tris[i].status == DELETE_ME) {
+      continue;
+    }
+    uint32_t u = tris[i].u;
+    uint32_t v = tris[i].v;
+    uint32_t w = tris[i].w;
 
     // Push only the internal edges that have the first node number
     // less than the second node number
@@ -763,7 +811,6 @@ void TMRTriangularize::delaunayEdgeFlip() {
         q.push(TriEdge(w, u));
       }
     }
-    node = node->next;
   }
 
   while (!q.empty()) {
@@ -816,8 +863,8 @@ void TMRTriangularize::delaunayEdgeFlip() {
 
         if (not_delaunay && delaunay) {
           // Delete the existing triangles
-          deleteTriangle(*t1);
-          deleteTriangle(*t2);
+          deleteTriangle(t1);
+          deleteTriangle(t2);
 
           // Flip the edges
           addTriangle(TMRTriangle(x, w, u));
@@ -890,12 +937,12 @@ void TMRTriangularize::removeDegenerateEdges(int num_degen, const int degen[]) {
       TMRTriangle *t;
       completeMe(u, v, &t);
       if (t) {
-        deleteTriangle(*t);
+        deleteTriangle(t);
         fail = 0;
       }
       completeMe(v, u, &t);
       if (t) {
-        deleteTriangle(*t);
+        deleteTriangle(t);
         fail = 0;
       }
       if (fail) {
@@ -906,8 +953,8 @@ void TMRTriangularize::removeDegenerateEdges(int num_degen, const int degen[]) {
       }
     }
 
-    // Free the deleted triangles from the list
-    deleteTrianglesFromList();
+    // Remove the deleted triangles from the array
+    compactTriangles();
 
     // Find a mapping between the old node numbers and the new
     // condensed node number list
@@ -933,14 +980,16 @@ void TMRTriangularize::removeDegenerateEdges(int num_degen, const int degen[]) {
     num_points = count;
 
     // Now, readjust the node numbers in the triangle
-    TriListNode *node = list_start;
-    while (node) {
-      node->tri.u = old_to_new[node->tri.u];
-      node->tri.v = old_to_new[node->tri.v];
-      node->tri.w = old_to_new[node->tri.w];
-      node = node->next;
+    for (int i = 0; i < num_tri_entries; i++) {
+      tris[i].u = old_to_new[tris[i].u];
+      tris[i].v = old_to_new[tris[i].v];
+      tris[i].w = old_to_new[tris[i].w];
     }
 
+    // The edges are indexed by the node numbers, so the edge table
+    // must be rebuilt
+    rebuildEdgeTable();
+
     // Free the data
     delete[] old_to_new;
     delete[] sorted_degen;
@@ -978,14 +1027,16 @@ void TMRTriangularize::getMesh(int *_num_points, int *_num_triangles,
     *_conn = new int[3 * num_triangles];
     int *t = *_conn;
 
+    // Remove any deleted triangles so that the triangles are
+    // returned in the order they were created
+    compactTriangles();
+
     // Determine the connectivity
-    TriListNode *node = list_start;
-    while (node) {
-      t[0] = node->tri.u - FIXED_POINT_OFFSET;
-      t[1] = node->tri.v - FIXED_POINT_OFFSET;
-      t[2] = node->tri.w - FIXED_POINT_OFFSET;
+    for (int i = 0; i < num_tri_entries; i++) {
+      t[0] = tris[i].u - FIXED_POINT_OFFSET;
+      t[1] = tris[i].v - FIXED_POINT_OFFSET;
+      t[2] = tris[i].w - FIXED_POINT_OFFSET;
       t += 3;
-      node = node->next;
     }
   }
 }
@@ -994,30 +1045,35 @@ void TMRTriangularize::getMesh(int *_num_points, int *_num_triangles,
   Reset the tags of all the triangles within the list
 */
 void TMRTriangularize::setTriangleTags(uint32_t tag) {
-  TriListNode *node = list_start;
-  while (node) {
-    node->tri.tag = tag;
-    node = node->next;
+  for (int i = 0; i < num_tri_entries; i++) {
+    tris[i].tag = tag;
   }
 }
 
 /*
   Mark triangles that should be deleted.
 
-  This is used to mark triangles that are in holes
+  This is used to mark triangles that are in holes. The triangles are
+  visited with a queue rather than by recursion, since the number of
+  connected triangles can be large enough to exhaust the stack.
 */
 void TMRTriangularize::tagTriangles(TMRTriangle *tri) {
-  // Set the combinations of edge pairs that will be added
-  // to the hash table
-  uint32_t edge_pairs[][2] = {
-      {tri->u, tri->v}, {tri->v, tri->w}, {tri->w, tri->u}};
-  for (int k = 0; k < 3; k++) {
-    if (!edgeInPSLG(edge_pairs[k][0], edge_pairs[k][1])) {
-      TMRTriangle *t;
-      completeMe(edge_pairs[k][1], edge_pairs[k][0], &t);
-      if (t && t->tag == 0) {
-        t->tag = 1;
-        tagTriangles(t);
+  TriQueue queue;
+  queue.append(tri);
+
+  while (queue.size > 0) {
+    TMRTriangle *t = queue.pop();
+
+    // Set the combinations of edge pairs that will be added
+    // to the hash table
+    uint32_t edge_pairs[][2] = {{t->u, t->v}, {t->v, t->w}, {t->w, t->u}};
+    for (int k = 0; k < 3; k++) {
+      if (!edgeInPSLG(edge_pairs[k][0], edge_pairs[k][1])) {
+        TMRTriangle *t2 = getAdjacent(t, k);
+        if (t2 && t2->tag == 0) {
+          t2->tag = 1;
+          queue.append(t2);
+        }
       }
     }
   }
@@ -1048,12 +1104,10 @@ void TMRTriangularize::writeToVTK(const char *filename, const int param_space) {
     // Write out the cell values
     fprintf(fp, "\nCELLS %d %d\n", num_triangles, 4 * num_triangles);
 
-    TriListNode *node = list_start;
-    while (node) {
-      if (node->tri.status != DELETE_ME) {
-        fprintf(fp, "3 %d %d %d\n", node->tri.u, node->tri.v, node->tri.w);
+    for (int i = 0; i < num_tri_entries; i++) {
+      if (tris[i].status != DELETE_ME) {
+        fprintf(fp, "3 %d %d %d\n", tris[i].u, tris[i].v, tris[i].w);
       }
-      node = node->next;
     }
 
     // All quadrilaterals
@@ -1066,26 +1120,22 @@ void TMRTriangularize::writeToVTK(const char *filename, const int param_space) {
     fprintf(fp, "CELL_DATA %d\n", num_triangles);
     fprintf(fp, "SCALARS status float 1\n");
     fprintf(fp, "LOOKUP_TABLE default\n");
-    node = list_start;
-    while (node) {
-      if (node->tri.status != DELETE_ME) {
-        fprintf(fp, "%d\n", node->tri.status);
+    for (int i = 0; i < num_tri_entries; i++) {
+      if (tris[i].status != DELETE_ME) {
+        fprintf(fp, "%d\n", tris[i].status);
       }
-      node = node->next;
     }
 
     fprintf(fp, "SCALARS quality float 1\n");
     fprintf(fp, "LOOKUP_TABLE default\n");
-    node = list_start;
-    while (node) {
-      if (node->tri.status != DELETE_ME) {
-        double quality = node->tri.quality;
+    for (int i = 0; i < num_tri_entries; i++) {
+      if (tris[i].status != DELETE_ME) {
+        double quality = tris[i].quality;
         if (quality != quality) {
           quality = -1e20;
         }
         fprintf(fp, "%e\n", quality);
       }
-      node = node->next;
     }
 
     fclose(fp);
@@ -1100,271 +1150,392 @@ inline uint32_t TMRTriangularize::getEdgeHash(uint32_t x, uint32_t y) {
 }
 
 /*
-  Remove/delete the deleted triangles from the list
+  Get the ordered nodes (u, v) associated with the half-edge
+
+  The half-edge 4*i + k is the k-th edge of the i-th triangle where
+  the edges are ordered (u, v), (v, w) and (w, u).
 */
-void TMRTriangularize::deleteTrianglesFromList() {
-  TriListNode *ptr = list_start;
-  while (ptr) {
-    TriListNode *next = ptr->next;
-
-    if (ptr->tri.status == DELETE_ME) {
-      if (ptr == list_start) {
-        list_start = next;
-        if (list_start) {
-          list_start->prev = NULL;
-        }
-      } else {
-        // Set the pointers from the previous and next objects in the
-        // list so that they point past the ptr member
-        if (ptr->prev) {
-          ptr->prev->next = ptr->next;
-        }
-        if (ptr->next) {
-          ptr->next->prev = ptr->prev;
+inline void TMRTriangularize::getHalfEdge(uint32_t edge, uint32_t *u,
+                                          uint32_t *v) {
+  const TMRTriangle *t = &tris[edge >> 2];
+  uint32_t k = edge & 3;
+  if (k == 0) {
+    *u = t->u;
+    *v = t->v;
+  } else if (k == 1) {
+    *u = t->v;
+    *v = t->w;
+  } else {
+    *u = t->w;
+    *v = t->u;
+  }
+}
+
+/*
+  Add the half-edge to the edge table
+
+  If the ordered edge already exists in the table, the entry is
+  overwritten and the function returns 0.
+*/
+int TMRTriangularize::addHalfEdge(uint32_t edge) {
+  // Keep the table at most half full so that the probe sequences
+  // remain short
+  if (2 * (num_edges + 1) > (int)edge_table_size) {
+    uint32_t *old_table = edge_table;
+    uint32_t old_size = edge_table_size;
+
+    edge_table_size *= 2;
+    edge_table = new uint32_t[edge_table_size];
+    memset(edge_table, 0xff, edge_table_size * sizeof(uint32_t));
+
+    // Re-insert the existing entries into the new table
+    uint32_t mask = edge_table_size - 1;
+    for (uint32_t i = 0; i < old_size; i++) {
+      if (old_table[i] != NO_TRIANGLE) {
+        uint32_t u, v;
+        getHalfEdge(old_table[i], &u, &v);
+        uint32_t j = getEdgeHash(u, v) & mask;
+        while (edge_table[j] != NO_TRIANGLE) {
+          j = (j + 1) & mask;
         }
+        edge_table[j] = old_table[i];
       }
-
-      delete ptr;
     }
 
-    ptr = next;
+    delete[] old_table;
   }
 
-  // Point the list back to the end of the list
-  list_end = list_start;
-  while (list_end && list_end->next) {
-    list_end = list_end->next;
+  uint32_t u, v;
+  getHalfEdge(edge, &u, &v);
+  uint32_t mask = edge_table_size - 1;
+  uint32_t i = getEdgeHash(u, v) & mask;
+  while (edge_table[i] != NO_TRIANGLE) {
+    uint32_t eu, ev;
+    getHalfEdge(edge_table[i], &eu, &ev);
+    if (eu == u && ev == v) {
+      // The edge already exists, it will be overwritten, but
+      // we'll call this a failure...
+      edge_table[i] = edge;
+      return 0;
+    }
+    i = (i + 1) & mask;
   }
+
+  edge_table[i] = edge;
+  num_edges++;
+
+  return 1;
 }
 
 /*
-  Add a triangle to the mesh
+  Find the half-edge with the ordered nodes (u, v)
+
+  returns: the half-edge or NO_TRIANGLE if it does not exist
 */
-int TMRTriangularize::addTriangle(TMRTriangle tri) {
-  int success = 1;
+uint32_t TMRTriangularize::findHalfEdge(uint32_t u, uint32_t v) {
+  uint32_t mask = edge_table_size - 1;
+  uint32_t i = getEdgeHash(u, v) & mask;
+  while (edge_table[i] != NO_TRIANGLE) {
+    uint32_t eu, ev;
+    getHalfEdge(edge_table[i], &eu, &ev);
+    if (eu == u && ev == v) {
+      return edge_table[i];
+    }
+    i = (i + 1) & mask;
+  }
 
-  // Add the triangle to the list of nodes
-  if (!list_start) {
-    // Create the root triangle node
-    list_start = new TriListNode();
-    list_start->tri = tri;
-    list_start->next = NULL;
-    list_start->prev = NULL;
+  return NO_TRIANGLE;
+}
 
-    // Update the current node
-    list_end = list_start;
-  } else {
-    // Create the new member in the triangle list
-    TriListNode *next = new TriListNode();
-    next->tri = tri;
-    next->next = NULL;
-    next->prev = list_end;
+/*
+  Remove the half-edge from the edge table
 
-    // Update the current member in the triangle list
-    list_end->next = next;
-    list_end = list_end->next;
+  The entry is only removed if the table refers to this half-edge.
+  The following entries in the probe sequence are shifted back so
+  that no tombstones are required.
+*/
+void TMRTriangularize::removeHalfEdge(uint32_t edge) {
+  uint32_t u, v;
+  getHalfEdge(edge, &u, &v);
+  uint32_t mask = edge_table_size - 1;
+  uint32_t i = getEdgeHash(u, v) & mask;
+  while (edge_table[i] != edge) {
+    if (edge_table[i] == NO_TRIANGLE) {
+      return;
+    }
+    i = (i + 1) & mask;
   }
 
-  list_end->tri.tag = 0;
-  list_end->tri.status = NO_STATUS;
+  edge_table[i] = NO_TRIANGLE;
+  num_edges--;
 
-  // Set the pointer to the list of triangles
-  pts_to_tris[tri.u] = &(list_end->tri);
-  pts_to_tris[tri.v] = &(list_end->tri);
-  pts_to_tris[tri.w] = &(list_end->tri);
-
-  // Add the triangle to the triangle count
-  num_triangles++;
+  // Shift back any entries that can no longer be reached
+  uint32_t j = i;
+  while (1) {
+    j = (j + 1) & mask;
+    if (edge_table[j] == NO_TRIANGLE) {
+      break;
+    }
 
-  // Redistribute the members in the hash table if required
-  if (num_hash_nodes > 10 * num_buckets) {
-    // Create a new array of buckets, twice the size of the old array
-    // of buckets and re-insert the entries back into the new array
-    int num_old_buckets = num_buckets;
-    num_buckets *= 2;
-
-    // Create a new array pointing to the new buckets and the
-    // end of the bucket array
-    EdgeHashNode **new_buckets = new EdgeHashNode *[num_buckets];
-    EdgeHashNode **end_buckets = new EdgeHashNode *[num_buckets];
-    memset(new_buckets, 0, num_buckets * sizeof(EdgeHashNode *));
-    memset(end_buckets, 0, num_buckets * sizeof(EdgeHashNode *));
-
-    // Assign the new buckets
-    for (int i = 0; i < num_old_buckets; i++) {
-      EdgeHashNode *node = buckets[i];
-
-      while (node) {
-        // Get the new hash values
-        EdgeHashNode *tmp = node->next;
-        uint32_t value = getEdgeHash(node->u, node->v);
-        uint32_t bucket = value % num_buckets;
-
-        // If the new bucket linked list does not exist, create a new
-        // one and set the end_buckets pointer
-        if (!new_buckets[bucket]) {
-          new_buckets[bucket] = node;
-          node->next = NULL;
-          end_buckets[bucket] = new_buckets[bucket];
-        } else {
-          end_buckets[bucket]->next = node;
-          end_buckets[bucket] = end_buckets[bucket]->next;
-          node->next = NULL;
-        }
+    // Find the first slot in the probe sequence for this entry. The
+    // entry must be moved if the empty slot i lies cyclically between
+    // this first slot and the current slot j.
+    uint32_t eu, ev;
+    getHalfEdge(edge_table[j], &eu, &ev);
+    uint32_t k = getEdgeHash(eu, ev) & mask;
+    if (((j - k) & mask) >= ((j - i) & mask)) {
+      edge_table[i] = edge_table[j];
+      edge_table[j] = NO_TRIANGLE;
+      i = j;
+    }
+  }
+}
 
-        node = tmp;
+/*
+  Rebuild the edge table from the triangles in the array
+*/
+void TMRTriangularize::rebuildEdgeTable() {
+  num_edges = 0;
+  memset(edge_table, 0xff, edge_table_size * sizeof(uint32_t));
+  for (int i = 0; i < num_tri_entries; i++) {
+    if (tris[i].status != DELETE_ME) {
+      for (int k = 0; k < 3; k++) {
+        addHalfEdge(4 * i + k);
       }
     }
+  }
+}
 
-    delete[] end_buckets;
-    delete[] buckets;
-    buckets = new_buckets;
+/*
+  Compare two triangle creation stamps
+*/
+static int compare_stamps(const void *avoid, const void *bvoid) {
+  const uint32_t *a = static_cast<const uint32_t *>(avoid);
+  const uint32_t *b = static_cast<const uint32_t *>(bvoid);
+
+  if (a[0] < b[0]) {
+    return -1;
+  } else if (a[0] > b[0]) {
+    return 1;
   }
+  return 0;
+}
 
-  // Set the combinations of edge pairs that will be added
-  // to the hash table
-  uint32_t edge_pairs[][2] = {{tri.u, tri.v}, {tri.v, tri.w}, {tri.w, tri.u}};
+/*
+  Remove the deleted triangles from the array
 
-  // Add the triangle to the hash table
-  for (int k = 0; k < 3; k++) {
-    // Add a hash for each pair of edges around the triangle
-    uint32_t u = edge_pairs[k][0];
-    uint32_t v = edge_pairs[k][1];
-    uint32_t value = getEdgeHash(u, v);
-    uint32_t bucket = value % num_buckets;
-    if (!buckets[bucket]) {
-      // Create the new buckets node and assign the values
-      buckets[bucket] = new EdgeHashNode();
-      buckets[bucket]->u = u;
-      buckets[bucket]->v = v;
-      buckets[bucket]->tri_node = list_end;
-      buckets[bucket]->next = NULL;
-      num_hash_nodes++;
-    } else {
-      // Scan through to the end of the array and determine if the
-      // edge exists in the hash table already or not
-      EdgeHashNode *node = buckets[bucket];
-      while (node) {
-        // The edge already exists -- overwrite it
-        if (node->u == u && node->v == v) {
-          // The edge already exists, it will be overwritten, but
-          // we'll call this a failure...
-          success = 0;
-
-          // Overwite the triangle
-          node->tri_node = list_end;
-
-          // Set the pointer to NULL so that the new node will not be
-          // created
-          node = NULL;
-          break;
-        }
+  The remaining triangles are ordered by the order in which they were
+  created, the adjacency, the edge table and the point to triangle
+  pointers are all updated and the free list is emptied. Note that
+  this invalidates all triangle pointers and indices.
+*/
+void TMRTriangularize::compactTriangles() {
+  // Count up the triangles and check if they are already in order
+  int count = 0;
+  int ordered = 1;
+  uint32_t last_stamp = 0;
+  for (int i = 0; i < num_tri_entries; i++) {
+    if (tris[i].status != DELETE_ME) {
+      if (count > 0 && stamps[i] < last_stamp) {
+        ordered = 0;
+      }
+      last_stamp = stamps[i];
+      count++;
+    }
+  }
 
-        // If the next node does not exist, then break
-        if (!node->next) {
-          break;
-        }
+  if (count < num_tri_entries || !ordered) {
+    // Sort the (stamp, index) pairs for the remaining triangles
+    uint32_t *order = new uint32_t[2 * count];
+    for (int i = 0, j = 0; i < num_tri_entries; i++) {
+      if (tris[i].status != DELETE_ME) {
+        order[2 * j] = stamps[i];
+        order[2 * j + 1] = i;
+        j++;
+      }
+    }
+    if (!ordered) {
+      qsort(order, count, 2 * sizeof(uint32_t), compare_stamps);
+    }
+
+    // Compute the new index for each old triangle index
+    uint32_t *old_to_new = new uint32_t[num_tri_entries];
+    memset(old_to_new, 0xff, num_tri_entries * sizeof(uint32_t));
+    for (int j = 0; j < count; j++) {
+      old_to_new[order[2 * j + 1]] = j;
+    }
 
-        // Increment the node to the next position
-        node = node->next;
+    // Copy the triangles into their new locations
+    TMRTriangle *new_tris_array = new TMRTriangle[max_num_tris];
+    uint32_t *new_adjacent = new uint32_t[3 * max_num_tris];
+    for (int j = 0; j < count; j++) {
+      uint32_t i = order[2 * j + 1];
+      new_tris_array[j] = tris[i];
+      for (int k = 0; k < 3; k++) {
+        uint32_t adj = adjacent[3 * i + k];
+        if (adj != NO_TRIANGLE) {
+          adj = old_to_new[adj];
+        }
+        new_adjacent[3 * j + k] = adj;
       }
+    }
 
-      if (node) {
-        // Create the new hash node
-        node->next = new EdgeHashNode();
-        node = node->next;
-
-        // Set the data into the object
-        node->u = u;
-        node->v = v;
-        node->tri_node = list_end;
-        node->next = NULL;
-        num_hash_nodes++;
-      } else {
-        success = 0;
+    // Update the point to triangle pointers
+    for (int i = 0; i < num_points; i++) {
+      if (pts_to_tris[i] != NO_TRIANGLE) {
+        pts_to_tris[i] = old_to_new[pts_to_tris[i]];
       }
     }
+
+    delete[] order;
+    delete[] old_to_new;
+    delete[] tris;
+    delete[] adjacent;
+    tris = new_tris_array;
+    adjacent = new_adjacent;
+    num_tri_entries = count;
+
+    // Rebuild the edge table since the half-edges have changed
+    rebuildEdgeTable();
   }
 
-  return success;
+  // Reset the creation stamps and the free list
+  for (int i = 0; i < num_tri_entries; i++) {
+    stamps[i] = i;
+  }
+  next_stamp = num_tri_entries;
+  free_tris = NO_TRIANGLE;
+  num_new_tris = 0;
 }
 
 /*
-  Delete the triangle from the mesh.
+  Add a triangle to the mesh
 
-  This deletes the triangle from the hash table but not the list.
+  The triangle is placed in an entry from the free list if one is
+  available, otherwise it is added to the end of the array. Note that
+  this may re-allocate the array and invalidate pointers to the
+  triangles.
 */
-int TMRTriangularize::deleteTriangle(TMRTriangle tri) {
-  // Keep track of whether we successfully delete all of the edges, or
-  // just some of the edges (deleting only 1 or 2 out of 3 is bad!)
+int TMRTriangularize::addTriangle(TMRTriangle tri) {
   int success = 1;
 
-  // Set the combinations of edge pairs that will be added
-  // to the hash table
-  uint32_t edge_pairs[][2] = {{tri.u, tri.v}, {tri.v, tri.w}, {tri.w, tri.u}};
+  // Find the index for the new triangle
+  uint32_t index = 0;
+  if (free_tris != NO_TRIANGLE) {
+    index = free_tris;
+    free_tris = adjacent[3 * index];
+  } else {
+    if (num_tri_entries >= max_num_tris) {
+      // Extend the length of the triangle arrays
+      max_num_tris *= 2;
 
-  // Keep track if this is the first edge we find
-  int first = 1;
+      TMRTriangle *new_tris_array = new TMRTriangle[max_num_tris];
+      memcpy(new_tris_array, tris, num_tri_entries * sizeof(TMRTriangle));
+      delete[] tris;
+      tris = new_tris_array;
 
-  // Remove the triangle from the hash table
-  for (int k = 0; k < 3; k++) {
-    // Add a hash for each pair of edges around the triangle
-    uint32_t u = edge_pairs[k][0];
-    uint32_t v = edge_pairs[k][1];
-
-    // Keep track of whether we've deleted this edge
-    int edge_success = 0;
-
-    // Get the hash values and access the first entry of the bucket
-    // it's listed under
-    uint32_t value = getEdgeHash(u, v);
-    uint32_t bucket = value % num_buckets;
-    EdgeHashNode *node = buckets[bucket];
-    EdgeHashNode *prev = node;
-    while (node) {
-      // The edge matches, we have to delete this triangle
-      if (u == node->u && v == node->v) {
-        // If this is the first edge we've found, delete the
-        // corresponding list entry as well.
-        if (first) {
-          // This triangle will be deleted. Adjust the triangle
-          // count to reflect this
-          num_triangles--;
-
-          // Mark the triangle in the edge list so that it is
-          // 'deleted'. The memory is not freed at this point.
-          node->tri_node->tri.status = DELETE_ME;
-
-          // We've already encountered this triangle once.
-          first = 0;
-        }
+      uint32_t *new_adjacent = new uint32_t[3 * max_num_tris];
+      memcpy(new_adjacent, adjacent, 3 * num_tri_entries * sizeof(uint32_t));
+      delete[] adjacent;
+      adjacent = new_adjacent;
 
-        // Delete the edge from the hash table
-        if (node == prev) {
-          buckets[bucket] = node->next;
-          delete node;
-          num_hash_nodes--;
-        } else {
-          prev->next = node->next;
-          delete node;
-          num_hash_nodes--;
-        }
+      uint32_t *new_stamps = new uint32_t[max_num_tris];
+      memcpy(new_stamps, stamps, num_tri_entries * sizeof(uint32_t));
+      delete[] stamps;
+      stamps = new_stamps;
+    }
+    index = num_tri_entries;
+    num_tri_entries++;
+  }
 
-        edge_success = 1;
-        break;
-      }
+  tris[index] = tri;
+  tris[index].tag = 0;
+  tris[index].status = NO_STATUS;
+  stamps[index] = next_stamp;
+  next_stamp++;
+
+  // Set the pointer to the list of triangles
+  pts_to_tris[tri.u] = index;
+  pts_to_tris[tri.v] = index;
+  pts_to_tris[tri.w] = index;
+
+  // Add the triangle to the triangle count
+  num_triangles++;
 
-      prev = node;
-      node = node->next;
+  // Record the new triangle
+  if (num_new_tris >= max_num_new_tris) {
+    max_num_new_tris *= 2;
+    uint32_t *tmp = new uint32_t[max_num_new_tris];
+    memcpy(tmp, new_tris, num_new_tris * sizeof(uint32_t));
+    delete[] new_tris;
+    new_tris = tmp;
+  }
+  new_tris[num_new_tris] = index;
+  num_new_tris++;
+
+  // Add the half-edges to the edge table and connect the triangle to
+  // the adjacent triangles
+  for (int k = 0; k < 3; k++) {
+    uint32_t edge = 4 * index + k;
+    if (!addHalfEdge(edge)) {
+      success = 0;
     }
 
-    // Keep track of each individual edge
-    success = success && edge_success;
+    uint32_t u, v;
+    getHalfEdge(edge, &u, &v);
+    uint32_t opposite = findHalfEdge(v, u);
+    if (opposite != NO_TRIANGLE) {
+      adjacent[3 * index + k] = opposite >> 2;
+      adjacent[3 * (opposite >> 2) + (opposite & 3)] = index;
+    } else {
+      adjacent[3 * index + k] = NO_TRIANGLE;
+    }
   }
 
   return success;
 }
 
+/*
+  Delete the triangle from the mesh.
+
+  This removes the triangle from the edge table and disconnects it
+  from the adjacent triangles. The triangle is marked as deleted and
+  its entry is placed on the free list.
+*/
+int TMRTriangularize::deleteTriangle(TMRTriangle *tri) {
+  if (tri->status == DELETE_ME) {
+    return 0;
+  }
+
+  uint32_t index = tri - tris;
+  for (int k = 0; k < 3; k++) {
+    removeHalfEdge(4 * index + k);
+
+    // Remove the pointers from the adjacent triangle
+    uint32_t adj = adjacent[3 * index + k];
+    if (adj != NO_TRIANGLE) {
+      for (int j = 0; j < 3; j++) {
+        if (adjacent[3 * adj + j] == index) {
+          adjacent[3 * adj + j] = NO_TRIANGLE;
+        }
+      }
+    }
+  }
+
+  // This triangle will be deleted. Adjust the triangle count to
+  // reflect this.
+  num_triangles--;
+  tri->status = DELETE_ME;
+
+  // Place the entry on the free list
+  adjacent[3 * index] = free_tris;
+  adjacent[3 * index + 1] = NO_TRIANGLE;
+  adjacent[3 * index + 2] = NO_TRIANGLE;
+  free_tris = index;
+
+  return 1;
+}
+
 /*
   Retrieve the triangle hash
 */
@@ -1382,21 +1553,35 @@ inline uint32_t TMRTriangularize::getTriangleHash(TMRTriangle *tri) {
 void TMRTriangularize::completeMe(uint32_t u, uint32_t v, TMRTriangle **tri) {
   *tri = NULL;
 
-  // Retrieve the hash value/bucket for this edge
-  uint32_t value = getEdgeHash(u, v);
-  uint32_t bucket = value % num_buckets;
-  EdgeHashNode *node = buckets[bucket];
+  uint32_t edge = findHalfEdge(u, v);
+  if (edge != NO_TRIANGLE) {
+    *tri = &tris[edge >> 2];
+  }
+}
 
-  // Loop over the edges until we find the matching triangle
-  while (node) {
-    if (node->u == u && node->v == v) {
-      *tri = &(node->tri_node->tri);
-      break;
-    }
+/*
+  Get the triangle adjacent to the given edge of the triangle
 
-    // Increment the pointer to the next member of this bucket
-    node = node->next;
-  }
+  The edges are ordered (u, v), (v, w) and (w, u). If the triangle
+  has been deleted, the adjacent triangle is found from the edge
+  table instead.
+*/
+inline TMRTriangle *TMRTriangularize::getAdjacent(TMRTriangle *tri,
+                                                  int edge) {
+  uint32_t index = tri - tris;
+  if (tri->status != DELETE_ME) {
+    uint32_t adj = adjacent[3 * index + edge];
+    if (adj != NO_TRIANGLE) {
+      return &tris[adj];
+    }
+    return NULL;
+  }
+
+  uint32_t u, v;
+  getHalfEdge(4 * index + edge, &u, &v);
+  TMRTriangle *t;
+  completeMe(v, u, &t);
+  return t;
 }
 
 /*
@@ -1535,8 +1720,8 @@ uint32_t TMRTriangularize::addPoint(const double pt[]) {
 
     // Allocate a new array for the pointer from the triangle vertices
     // to an attaching triangle
-    TMRTriangle **new_pts_to_tris = new TMRTriangle *[2 * max_num_points];
-    memcpy(new_pts_to_tris, pts_to_tris, num_points * sizeof(TMRTriangle *));
+    uint32_t *new_pts_to_tris = new uint32_t[max_num_points];
+    memcpy(new_pts_to_tris, pts_to_tris, num_points * sizeof(uint32_t));
     delete[] pts_to_tris;
     pts_to_tris = new_pts_to_tris;
 
@@ -1555,7 +1740,7 @@ uint32_t TMRTriangularize::addPoint(const double pt[]) {
   pts[2 * num_points + 1] = pt[1];
 
   // No new triangle has been assigned yet
-  pts_to_tris[num_points] = NULL;
+  pts_to_tris[num_points] = NO_TRIANGLE;
 
   // Evaluate the face location
   face->evalPoint(pt[0], pt[1], &X[num_points]);
@@ -1577,18 +1762,7 @@ void TMRTriangularize::addPointToMesh(const double pt[], TMRFace *metric) {
 
   // Add the point to the quadtree
   uint32_t u = addPoint(pt);
-
-  if (tri) {
-    uint32_t v = tri->u;
-    uint32_t w = tri->v;
-    uint32_t x = tri->w;
-    deleteTriangle(*tri);
-    digCavity(u, v, w, metric);
-    digCavity(u, w, x, metric);
-    digCavity(u, x, v, metric);
-  }
-
-  return;
+  insertPoint(u, tri, metric);
 }
 
 /*
@@ -1598,16 +1772,137 @@ void TMRTriangularize::addPointToMesh(const double pt[], TMRFace *metric) {
 void TMRTriangularize::addPointToMesh(const double pt[], TMRTriangle *tri,
                                       TMRFace *metric) {
   uint32_t u = addPoint(pt);
+  insertPoint(u, tri, metric);
+}
+
+/*
+  Insert the point u into the mesh by digging the cavity of the
+  enclosing triangle. The point must already be in the point list.
+*/
+void TMRTriangularize::insertPoint(uint32_t u, TMRTriangle *tri,
+                                   TMRFace *metric) {
+  num_new_tris = 0;
 
   if (tri) {
     uint32_t v = tri->u;
     uint32_t w = tri->v;
     uint32_t x = tri->w;
-    deleteTriangle(*tri);
+    deleteTriangle(tri);
     digCavity(u, v, w, metric);
     digCavity(u, w, x, metric);
     digCavity(u, x, v, metric);
+
+    // Seed the next search from this point
+    last_point = u;
+  }
+}
+
+/*
+  Compare the points by their insertion round and then by their
+  position along the Morton curve within the round
+*/
+static int compare_insertion_order(const void *avoid, const void *bvoid) {
+  const uint32_t *a = static_cast<const uint32_t *>(avoid);
+  const uint32_t *b = static_cast<const uint32_t *>(bvoid);
+
+  if (a[0] != b[0]) {
+    return (a[0] < b[0] ? -1 : 1);
   }
+  int discrim = compare_edges(&a[1], &b[1]);
+  if (discrim != 0) {
+    return discrim;
+  }
+  return (a[3] < b[3] ? -1 : (a[3] > b[3] ? 1 : 0));
+}
+
+/*
+  Add the initial points to the mesh in a biased randomized insertion
+  order (BRIO)
+
+  Inserting the points in the input order is slow for long boundary
+  discretizations: consecutive points along a boundary create long,
+  thin triangles, so that each new point lies within the circumcircle
+  of many triangles. Instead, the points are split into rounds with
+  sizes that double from one round to the next, where each point is
+  assigned to a round based on a hash of its index. The points within
+  each round are sorted along a Morton curve so that each point is
+  close to the previous one and the walk from the last point finds
+  the enclosing triangle in a few steps.
+
+  The points are still numbered in the input order.
+*/
+void TMRTriangularize::addPointsToMesh(int npts, const double inpts[]) {
+  // Set the point locations in the input order. The points are only
+  // added to the quadtree once they are inserted into the mesh, since
+  // the quadtree is used to find the triangles attached to the points
+  // that are closest to a query point.
+  uint32_t start = num_points;
+  double *u = new double[npts];
+  double *v = new double[npts];
+  for (int i = 0; i < npts; i++) {
+    pts[2 * (start + i)] = u[i] = inpts[2 * i];
+    pts[2 * (start + i) + 1] = v[i] = inpts[2 * i + 1];
+    pts_to_tris[start + i] = NO_TRIANGLE;
+  }
+  face->evalPoints(npts, u, v, &X[start]);
+  num_points += npts;
+  delete[] u;
+  delete[] v;
+
+  // Find the bounding box of the points
+  double xlow = inpts[0], xhigh = inpts[0];
+  double ylow = inpts[1], yhigh = inpts[1];
+  for (int i = 1; i < npts; i++) {
+    xlow = (inpts[2 * i] < xlow ? inpts[2 * i] : xlow);
+    xhigh = (inpts[2 * i] > xhigh ? inpts[2 * i] : xhigh);
+    ylow = (inpts[2 * i + 1] < ylow ? inpts[2 * i + 1] : ylow);
+    yhigh = (inpts[2 * i + 1] > yhigh ? inpts[2 * i + 1] : yhigh);
+  }
+  double xscale = 0.0, yscale = 0.0;
+  const double qmax = 1 << 30;
+  if (xhigh > xlow) {
+    xscale = qmax / (xhigh - xlow);
+  }
+  if (yhigh > ylow) {
+    yscale = qmax / (yhigh - ylow);
+  }
+
+  // Set the number of rounds so that the first round contains only a
+  // few points
+  uint32_t max_round = 0;
+  while ((npts >> (max_round + 1)) > 8) {
+    max_round++;
+  }
+
+  // Set the round, the integer coordinates and the index of each
+  // point. Half of the points are placed in the last round, a quarter
+  // in the round before it and so on.
+  uint32_t *order = new uint32_t[4 * npts];
+  for (int i = 0; i < npts; i++) {
+    uint32_t hash = TMRIntegerPairHash(i, npts);
+    uint32_t round = 0;
+    while (round < max_round && (hash & 1)) {
+      hash >>= 1;
+      round++;
+    }
+    order[4 * i] = max_round - round;
+    order[4 * i + 1] = (uint32_t)(xscale * (inpts[2 * i] - xlow));
+    order[4 * i + 2] = (uint32_t)(yscale * (inpts[2 * i + 1] - ylow));
+    order[4 * i + 3] = i;
+  }
+  qsort(order, npts, 4 * sizeof(uint32_t), compare_insertion_order);
+
+  // Insert the points in order
+  for (int k = 0; k < npts; k++) {
+    uint32_t num = start + order[4 * k + 3];
+
+    TMRTriangle *tri;
+    findEnclosing(&pts[2 * num], &tri);
+    root->addNode(num, &pts[2 * num]);
+    insertPoint(num, tri, NULL);
+  }
+
+  delete[] order;
 }
 
 /*
@@ -1646,7 +1941,7 @@ void TMRTriangularize::digCavity(uint32_t u, uint32_t v, uint32_t w,
 
     // Check whether the point lies within the circumcircle
     if (inCircle(u, v, w, x, metric) > 0.0) {
-      deleteTriangle(*tri);
+      deleteTriangle(tri);
       digCavity(u, v, x, metric);
       digCavity(u, x, w, metric);
       return;
@@ -1661,7 +1956,10 @@ void TMRTriangularize::digCavity(uint32_t u, uint32_t v, uint32_t w,
 */
 void TMRTriangularize::insertSegment(uint32_t u, uint32_t v) {
   // Identify and delete all the triangles between u and v
-  TMRTriangle *t = pts_to_tris[u];
+  TMRTriangle *t = NULL;
+  if (pts_to_tris[u] != NO_TRIANGLE) {
+    t = &tris[pts_to_tris[u]];
+  }
   TMRTriangle *tri = NULL;
 
   // Find the triangle that the point intersects
@@ -1695,8 +1993,8 @@ void TMRTriangularize::insertSegment(uint32_t u, uint32_t v) {
     completeMe(u, x, &t);
   }
 
-  if (!t) {
-    t = pts_to_tris[u];
+  if (!t && pts_to_tris[u] != NO_TRIANGLE) {
+    t = &tris[pts_to_tris[u]];
 
     while (t) {
       if (u == t->u) {
@@ -1735,7 +2033,7 @@ void TMRTriangularize::insertSegment(uint32_t u, uint32_t v) {
   neg[1] = w;
 
   // Delete the triangle
-  deleteTriangle(*tri);
+  deleteTriangle(tri);
 
   // Now search through to find the next triangle
   while (1) {
@@ -1760,7 +2058,7 @@ void TMRTriangularize::insertSegment(uint32_t u, uint32_t v) {
     }
 
     // Free this triangle
-    deleteTriangle(*tri);
+    deleteTriangle(tri);
 
     if (y == v) {
       pos[pos_count] = v;
@@ -1827,22 +2125,104 @@ void TMRTriangularize::giftWrap(const uint32_t v[], int size, int orient) {
 }
 
 /*
-  Find the enclosing triangle within the mesh.
-
-  This code uses a quadtree for geometric searching. First, we find
-  the node that is closest to the query point. This node is not
-  necessarily connected with the enclosing triangle that we
-  want. Next, we find one triangle associated with this node. If this
-  triangle does not contain the point, we march over the mesh, marking
-  the triangles that we have visited.
+  Get a new tag value for marking the triangles visited during a
+  search. Reset the triangle tags if the tag value would overflow.
 */
-void TMRTriangularize::findEnclosing(const double pt[], TMRTriangle **ptr) {
-  *ptr = NULL;
+uint32_t TMRTriangularize::getSearchTag() {
   if (search_tag == UINT_MAX) {
     search_tag = 0;
     setTriangleTags(0);
   }
   search_tag++;
+  return search_tag;
+}
+
+/*
+  Walk through the mesh along a straight line from the starting
+  triangle towards the point.
+
+  At each step, the walk crosses an edge of the current triangle that
+  separates the triangle from the point. The walk fails when it
+  reaches the boundary of the mesh, encounters a triangle that has
+  already been visited (which can occur when the mesh is not
+  Delaunay) or exceeds the maximum number of steps.
+
+  returns: 1 if the enclosing triangle is found, 0 otherwise
+*/
+int TMRTriangularize::walkToEnclosing(const double pt[], TMRTriangle *start,
+                                      TMRTriangle **ptr) {
+  *ptr = NULL;
+  uint32_t tag = getSearchTag();
+  double p[2] = {pt[0], pt[1]};
+
+  // Set the maximum number of steps. This prevents long walks across
+  // the mesh when the starting triangle is far from the point.
+  const int max_steps = 256;
+
+  TMRTriangle *t = start;
+  for (int step = 0; step < max_steps; step++) {
+    t->tag = tag;
+
+    // Find an edge of the triangle that separates it from the point.
+    // Start from a different edge on each step to avoid cycling
+    // between triangles.
+    uint32_t edge_pairs[][2] = {{t->u, t->v}, {t->v, t->w}, {t->w, t->u}};
+    int edge = -1;
+    for (int j = 0; j < 3; j++) {
+      int k = (j + step) % 3;
+      if (orient2d(&pts[2 * edge_pairs[k][0]], &pts[2 * edge_pairs[k][1]],
+                   p) < 0.0) {
+        edge = k;
+        break;
+      }
+    }
+
+    // The point is on the positive side of all edges
+    if (edge < 0) {
+      *ptr = t;
+      return 1;
+    }
+
+    // Cross the edge into the adjacent triangle
+    TMRTriangle *t2 = getAdjacent(t, edge);
+    if (!t2 || t2->tag == tag) {
+      return 0;
+    }
+    t = t2;
+  }
+
+  return 0;
+}
+
+/*
+  Find the enclosing triangle within the mesh.
+
+  Points are often added close to the previous point. As a result,
+  we first walk from a triangle attached to the last point that was
+  added to the mesh towards the query point.
+
+  If the walk fails, we use the quadtree for geometric searching.
+  First, we find the node that is closest to the query point. This
+  node is not necessarily connected with the enclosing triangle that
+  we want. Next, we find one triangle associated with this node. If
+  this triangle does not contain the point, we march over the mesh,
+  marking the triangles that we have visited.
+*/
+void TMRTriangularize::findEnclosing(const double pt[], TMRTriangle **ptr) {
+  *ptr = NULL;
+
+  // Walk from the triangle attached to the last point
+  if (last_point < (uint32_t)num_points &&
+      pts_to_tris[last_point] != NO_TRIANGLE) {
+    TMRTriangle *start = &tris[pts_to_tris[last_point]];
+    if (start->status != DELETE_ME) {
+      if (walkToEnclosing(pt, start, ptr)) {
+        return;
+      }
+    }
+  }
+
+  uint32_t tag = getSearchTag();
 
   // Find the closest point to the given
   uint32_t u = root->findClosest(pt);
@@ -1851,13 +2231,16 @@ void TMRTriangularize::findEnclosing(const double pt[], TMRTriangle **ptr) {
   // not contain the node, but will hopefully be close to the node.
   // We'll walk the mesh to nearby elements until we find the proper
   // enclosing triangle.
-  TMRTriangle *tri = pts_to_tris[u];
+  if (pts_to_tris[u] == NO_TRIANGLE) {
+    return;
+  }
+  TMRTriangle *tri = &tris[pts_to_tris[u]];
 
   if (enclosed(pt, tri->u, tri->v, tri->w)) {
     *ptr = tri;
     return;
   } else {
-    tri->tag = search_tag;
+    tri->tag = tag;
   }
 
   // Members of the list do not enclose the point and have been
@@ -1869,15 +2252,11 @@ void TMRTriangularize::findEnclosing(const double pt[], TMRTriangle **ptr) {
     // Pop the top member from the queue
     TMRTriangle *t = queue.pop();
 
-    // Search the adjacent triangles across edges
-    uint32_t edge_pairs[][2] = {{t->u, t->v}, {t->v, t->w}, {t->w, t->u}};
-
-    // Search the adjacent triangles and determine whether they have
-    // been tagged
+    // Search the adjacent triangles across the edges and determine
+    // whether they have been tagged
     for (int k = 0; k < 3; k++) {
-      TMRTriangle *t2;
-      completeMe(edge_pairs[k][1], edge_pairs[k][0], &t2);
-      if (t2 && t2->tag != search_tag) {
+      TMRTriangle *t2 = getAdjacent(t, k);
+      if (t2 && t2->tag != tag) {
         // Check whether the point is enclosed by t2
         if (enclosed(pt, t2->u, t2->v, t2->w)) {
           *ptr = t2;
@@ -1886,7 +2265,7 @@ void TMRTriangularize::findEnclosing(const double pt[], TMRTriangle **ptr) {
 
         // If the triangle does not enclose the point, label this guy
         // as having been searched
-        t2->tag = search_tag;
+        t2->tag = tag;
 
         // Append this guy to the queue
         queue.append(t2);
@@ -1983,7 +2362,7 @@ void TMRTriangularize::frontal(TMRMeshOptions options,
   // std::priority_queue<TMRTriangle*, std::vector<TMRTriangle*>,
   //   TMRTriangleCompare> active;
 
-  std::queue<TMRTriangle *> active;
+  std::queue<TriIndex> active;
 
   // Get the quality factor
   double frontal_quality_factor = options.frontal_quality_factor;
@@ -1994,63 +2373,50 @@ void TMRTriangularize::frontal(TMRMeshOptions options,
   }
 
   // Add the triangles to the active set that
-  TriListNode *node = list_start;
-  while (node) {
-    if (node->tri.status != DELETE_ME) {
+  for (int i = 0; i < num_tri_entries; i++) {
+    TMRTriangle *node = &tris[i];
+    if (node->status != DELETE_ME) {
       // Set the status by default as waiting
-      node->tri.status = WAITING;
+      node->status = WAITING;
 
       // Compute the 'quality' indicator for this triangle
-      TMRTriangle t = node->tri;
       double R = 0.0;
-      node->tri.quality = computeSizeRatio(t.u, t.v, t.w, fs, &R);
-      node->tri.R = R;
-      if (node->tri.quality < frontal_quality_factor) {
-        node->tri.status = ACCEPTED;
+      node->quality = computeSizeRatio(node->u, node->v, node->w, fs, &R);
+      node->R = R;
+      if (node->quality < frontal_quality_factor) {
+        node->status = ACCEPTED;
       } else {
         // If any of the triangles touches an edge in the planar
         // straight line graph, change it to a waiting triangle
-        uint32_t edge_pairs[][2] = {{node->tri.u, node->tri.v},
-                                    {node->tri.v, node->tri.w},
-                                    {node->tri.w, node->tri.u}};
+        uint32_t edge_pairs[][2] = {
+            {node->u, node->v}, {node->v, node->w}, {node->w, node->u}};
         for (int k = 0; k < 3; k++) {
           if (edgeInPSLG(edge_pairs[k][0], edge_pairs[k][1])) {
-            node->tri.status = ACTIVE;
-            active.push(&node->tri);
+            node->status = ACTIVE;
+            active.push(TriIndex(i, stamps[i]));
             break;
           }
         }
       }
     }
-
-    // Go to the next triangle in the list
-    node = node->next;
   }
 
   // Iterate over the list again and add any triangles that are
   // adjacent to an ACCEPTED triangle to the ACTIVE set of triangles
-  node = list_start;
-  while (node) {
-    if (node->tri.status == ACCEPTED) {
+  for (int i = 0; i < num_tri_entries; i++) {
+    TMRTriangle *node = &tris[i];
+    if (node->status == ACCEPTED) {
       // Check if any of the adjacent triangles are WAITING.  If so,
       // change their status to ACTIVE
-      uint32_t edge_pairs[][2] = {{node->tri.u, node->tri.v},
-                                  {node->tri.v, node->tri.w},
-                                  {node->tri.w, node->tri.u}};
-
       for (int k = 0; k < 3; k++) {
-        TMRTriangle *adjacent;
-        completeMe(edge_pairs[k][1], edge_pairs[k][0], &adjacent);
-        if (adjacent && adjacent->status == WAITING) {
-          node->tri.status = ACTIVE;
-          active.push(&node->tri);
+        TMRTriangle *adj = getAdjacent(node, k);
+        if (adj && adj->status == WAITING) {
+          node->status = ACTIVE;
+          active.push(TriIndex(i, stamps[i]));
           break;
         }
       }
     }
-
-    // Increment the pointer to the next member of the list
-    node = node->next;
   }
 
   if (options.triangularize_print_level > 0) {
@@ -2088,18 +2454,16 @@ void TMRTriangularize::frontal(TMRMeshOptions options,
 
     // Find the first active triangle that is not marked to be deleted
     while (active.size() > 0 && !tri) {
-      // This wonderful syntax brought to you by C++! Constant
-      // reference to a pointer, which we can just copy to a
-      // non-constant pointer.
-      TMRTriangle *const &tri_ptr = active.front();
-      tri = tri_ptr;
+      const TriIndex entry = active.front();
 
       // Pop the top member of the priority queue, but only use it if
       // the triangle is still active (note: the queue can contain
-      // non-active triangles)
+      // non-active triangles). Entries that were deleted and then
+      // re-used by a new triangle have a different stamp.
       active.pop();
-      if (tri->status != ACTIVE) {
-        tri = NULL;
+      if (stamps[entry.index] == entry.stamp &&
+          tris[entry.index].status == ACTIVE) {
+        tri = &tris[entry.index];
       }
     }
 
@@ -2130,8 +2494,7 @@ void TMRTriangularize::frontal(TMRMeshOptions options,
         v = edge_pairs[k][1];
 
         // Compute the completed triangle
-        TMRTriangle *t;
-        completeMe(v, u, &t);
+        TMRTriangle *t = getAdjacent(tri, k);
         if (t && t->status == ACCEPTED) {
           found = 1;
           break;
@@ -2321,11 +2684,10 @@ void TMRTriangularize::frontal(TMRMeshOptions options,
 
         // Search from adjacent triangles
         for (int k = 0; k < 3; k++) {
-          TMRTriangle *adjacent;
-          completeMe(edge_pairs[k][1], edge_pairs[k][0], &adjacent);
-          if (adjacent && adjacent->status == WAITING) {
-            adjacent->status = ACTIVE;
-            active.push(adjacent);
+          TMRTriangle *adj = getAdjacent(tri, k);
+          if (adj && adj->status == WAITING) {
+            adj->status = ACTIVE;
+            active.push(TriIndex(adj - tris, stamps[adj - tris]));
           }
         }
       }
@@ -2333,28 +2695,25 @@ void TMRTriangularize::frontal(TMRMeshOptions options,
       // Add up the update time
       t0_update += MPI_Wtime();
 
-      // Set the pointer to the last member in the list
-      TriListNode *list_marker = list_end;
+      // Add the point. Note that this may invalidate the pointer to
+      // the current triangle.
       addPointToMesh(pt, pt_tri, face);
-      pt_tri = NULL;
+      tri = pt_tri = NULL;
 
       // Compute the size ratio of the new triangles and check whether
       // they belong in the accepted category or not...
-      TriListNode *ptr = list_start;
-      if (list_marker) {
-        ptr = list_marker->next;
-      }
-      while (ptr) {
-        TMRTriangle t = ptr->tri;
-        double R = 0.0;
-        ptr->tri.quality = computeSizeRatio(t.u, t.v, t.w, fs, &R);
-        ptr->tri.R = R;
-        if (ptr->tri.quality < frontal_quality_factor) {
-          ptr->tri.status = ACCEPTED;
-        } else {
-          ptr->tri.status = WAITING;
+      for (int j = 0; j < num_new_tris; j++) {
+        TMRTriangle *ptr = &tris[new_tris[j]];
+        if (ptr->status != DELETE_ME) {
+          double R = 0.0;
+          ptr->quality = computeSizeRatio(ptr->u, ptr->v, ptr->w, fs, &R);
+          ptr->R = R;
+          if (ptr->quality < frontal_quality_factor) {
+            ptr->status = ACCEPTED;
+          } else {
+            ptr->status = WAITING;
+          }
         }
-        ptr = ptr->next;
       }
 
       // Complete me with the newly created triangle. This triangle
@@ -2367,26 +2726,22 @@ void TMRTriangularize::frontal(TMRMeshOptions options,
 
       // Scan through the list of the added triangles and mark which
       // ones are active/working/accepted.
-      ptr = list_start;
-      if (list_marker) {
-        ptr = list_marker->next;
-      }
-
-      while (ptr) {
-        if (ptr->tri.status != ACCEPTED) {
+      for (int j = 0; j < num_new_tris; j++) {
+        uint32_t index = new_tris[j];
+        TMRTriangle *ptr = &tris[index];
+        if (ptr->status != ACCEPTED && ptr->status != DELETE_ME) {
           // If any of the triangles touches an edge in the planar
           // straight line graph, change it to a waiting triangle
           int flag = 0;
-          uint32_t edge_pairs[][2] = {{ptr->tri.u, ptr->tri.v},
-                                      {ptr->tri.v, ptr->tri.w},
-                                      {ptr->tri.w, ptr->tri.u}};
+          uint32_t edge_pairs[][2] = {
+              {ptr->u, ptr->v}, {ptr->v, ptr->w}, {ptr->w, ptr->u}};
 
           // Loop over all of the edges in the triangle and check
           // whether they're in the PSLG
           for (int k = 0; k < 3; k++) {
             if (edgeInPSLG(edge_pairs[k][0], edge_pairs[k][1])) {
-              ptr->tri.status = ACTIVE;
-              active.push(&ptr->tri);
+              ptr->status = ACTIVE;
+              active.push(TriIndex(index, stamps[index]));
               flag = 1;
               break;
             }
@@ -2396,19 +2751,15 @@ void TMRTriangularize::frontal(TMRMeshOptions options,
           // then change the status of the new triangle to be active
           if (!flag) {
             for (int k = 0; k < 3; k++) {
-              TMRTriangle *adjacent;
-              completeMe(edge_pairs[k][1], edge_pairs[k][0], &adjacent);
-              if (adjacent && adjacent->status == ACCEPTED) {
-                ptr->tri.status = ACTIVE;
-                active.push(&ptr->tri);
+              TMRTriangle *adj = getAdjacent(ptr, k);
+              if (adj && adj->status == ACCEPTED) {
+                ptr->status = ACTIVE;
+                active.push(TriIndex(index, stamps[index]));
                 break;
               }
             }
           }
         }
-
-        // Increment the pointer to the next member of the list
-        ptr = ptr->next;
       }
       t1_update += MPI_Wtime();
     }
@@ -2421,21 +2772,21 @@ void TMRTriangularize::frontal(TMRMeshOptions options,
     // which will cause problems if we do a conversion to a
     // quadrilateral mesh. This will not do "good" things to the
     // triangularization.
-    node = list_start;
-    while (node) {
-      if (node->tri.status == ACCEPTED) {
-        const uint32_t u = node->tri.u;
-        const uint32_t v = node->tri.v;
-        const uint32_t w = node->tri.w;
+    // Note that points may be added within the loop, which may
+    // re-allocate the triangle array
+    for (int i = 0; i < num_tri_entries; i++) {
+      if (tris[i].status == ACCEPTED) {
+        const uint32_t u = tris[i].u;
+        const uint32_t v = tris[i].v;
+        const uint32_t w = tris[i].w;
 
         if ((u - FIXED_POINT_OFFSET < init_boundary_points) &&
             (v - FIXED_POINT_OFFSET < init_boundary_points) &&
             (w - FIXED_POINT_OFFSET < init_boundary_points)) {
           // Check if only one adjacent triangle exists
-          TMRTriangle *t1, *t2, *t3;
-          completeMe(v, u, &t1);
-          completeMe(w, v, &t2);
-          completeMe(u, w, &t3);
+          TMRTriangle *t1 = getAdjacent(&tris[i], 0);
+          TMRTriangle *t2 = getAdjacent(&tris[i], 1);
+          TMRTriangle *t3 = getAdjacent(&tris[i], 2);
 
           if (!t1 && !t2) {
             TMRPoint p;
@@ -2467,12 +2818,11 @@ void TMRTriangularize::frontal(TMRMeshOptions options,
           }
         }
       }
-      node = node->next;
     }
   }
 
-  // Free the deleted trianlges from the doubly linked list
-  deleteTrianglesFromList();
+  // Remove the deleted triangles from the array
+  compactTriangles();
 
   if (options.triangularize_print_level > 0) {
     printf("%10d %10d\n", iter, num_triangles);
@@ -64,6 +64,9 @@ class TMRQuadNode {
   // -------------------------------------------------------------
   uint32_t findClosest(const double pt[], double *_dist = NULL);
 
+  // Get the memory used by this node and its children
+  size_t getMemoryUsage();
+
  private:
   // This is only for creating children
   TMRQuadNode(TMRQuadDomain *_domain, uint32_t _u, uint32_t _v, int _level);
@@ -157,12 +160,19 @@ class TMRTriangularize : public TMREntity {
   // Write the triangulation to an outputfile
   void writeToVTK(const char *filename, const int param_space = 0);
 
+  // Report the memory held by the arrays of the triangulation
+  TMRMemoryUsage *getMemoryUsage();
+
  private:
   // The Bowyer-Watson algorithm is started with 4 points (2 triangles)
   // that cover the entire domain. These are deleted at the end
   // of the algorithm.
   static const int FIXED_POINT_OFFSET = 4;
 
+  // The number of initial points above which the points are inserted
+  // in a biased randomized order instead of in the input order
+  static const int BULK_INSERTION_POINTS = 1024;
+
   // TAGS for the triangles
   static const uint32_t NO_STATUS = 0;
   static const uint32_t WAITING = 1;
@@ -170,6 +180,9 @@ class TMRTriangularize : public TMREntity {
   static const uint32_t ACCEPTED = 3;
   static const uint32_t DELETE_ME = 4;
 
+  // Flag to indicate that there is no triangle
+  static const uint32_t NO_TRIANGLE = 0xffffffff;
+
   // Initialize the underlying data structures
   void initialize(int npts, const double inpts[], int nholes, int nsegs,
                   const int segs[], TMRFace *surf);
@@ -183,15 +196,28 @@ class TMRTriangularize : public TMREntity {
   void addPointToMesh(const double pt[], TMRFace *metric);
   void addPointToMesh(const double pt[], TMRTriangle *tri, TMRFace *metric);
 
+  // Add a large set of points to the mesh in a biased randomized order
+  void addPointsToMesh(int npts, const double inpts[]);
+
+  // Insert an existing point into the mesh, given the enclosing triangle
+  void insertPoint(uint32_t u, TMRTriangle *tri, TMRFace *metric);
+
   // Get a hash value for the given edge
   inline uint32_t getEdgeHash(uint32_t u, uint32_t v);
 
-  // Delete the triangles marked for deletion
-  void deleteTrianglesFromList();
+  // Add/find/remove the half-edges in the edge table
+  inline void getHalfEdge(uint32_t edge, uint32_t *u, uint32_t *v);
+  int addHalfEdge(uint32_t edge);
+  uint32_t findHalfEdge(uint32_t u, uint32_t v);
+  void removeHalfEdge(uint32_t edge);
+  void rebuildEdgeTable();
+
+  // Compact the triangle array, removing the deleted triangles
+  void compactTriangles();
 
   // Add/delete a triangle from the data structure
   int addTriangle(TMRTriangle tri);
-  int deleteTriangle(TMRTriangle tri);
+  int deleteTriangle(TMRTriangle *tri);
 
   // Get a hash value for the given triangle
   inline uint32_t getTriangleHash(TMRTriangle *tri);
@@ -203,6 +229,9 @@ class TMRTriangularize : public TMREntity {
   // Given the two ordered nodes, add the triangle to the list
   void completeMe(uint32_t u, uint32_t v, TMRTriangle **tri);
 
+  // Get the triangle adjacent to the given edge of a triangle
+  inline TMRTriangle *getAdjacent(TMRTriangle *tri, int edge);
+
   // Dig cavity
   void digCavity(uint32_t u, uint32_t v, uint32_t w, TMRFace *metric = NULL);
 
@@ -217,6 +246,9 @@ class TMRTriangularize : public TMREntity {
 
   // Find the enclosing triangle
   void findEnclosing(const double pt[], TMRTriangle **tri);
+  int walkToEnclosing(const double pt[], TMRTriangle *start,
+                      TMRTriangle **tri);
+  uint32_t getSearchTag();
 
   // Compute the maximum edge length of the triangle
   double computeSizeRatio(uint32_t u, uint32_t v, uint32_t w,
@@ -244,7 +276,7 @@ class TMRTriangularize : public TMREntity {
   // Array of the points that have been set
   double *pts;
   TMRPoint *X;
-  TMRTriangle **pts_to_tris;
+  uint32_t *pts_to_tris;
 
   // The PSLG edges
   int num_pslg_edges;
@@ -255,38 +287,50 @@ class TMRTriangularize : public TMREntity {
   TMRQuadNode *root;
   uint32_t search_tag;
 
-  // Keep a doubly-linked list to store the added triangles. The list
-  // is doubly-linked facilitate deleting triangles from the list.
-  class TriListNode {
-   public:
-    TMRTriangle tri;           // The actual triangle we've allocated
-    TriListNode *next, *prev;  // Next/previous list entries
-  };
-
-  // Keep track of the current set of triangles
-  TriListNode *list_start, *list_end;
+  // The last point added to the mesh, used to seed the point location
+  uint32_t last_point;
+
+  // The triangles are stored in a contiguous array. Deleted triangles
+  // are marked with the DELETE_ME status and their entries are placed
+  // on a free list for re-use. The adjacent array stores the index of
+  // the triangle across each edge (u, v), (v, w) and (w, u) or
+  // NO_TRIANGLE. The stamps record the order the triangles were
+  // created so that the compacted array preserves this order.
+  TMRTriangle *tris;
+  uint32_t *adjacent;
+  uint32_t *stamps;
+  int num_tri_entries;  // The number of entries in use (or freed)
+  int max_num_tris;     // The length of the triangle arrays
+  uint32_t free_tris;   // The first entry in the free list
+  uint32_t next_stamp;  // The next creation stamp
 
   // Keep track of the number of triangles
   int num_triangles;
 
-  // Keep a hash tabled based on the ordered edges of the triangular
-  // mesh. The order must match the counter clockwise ordering of the
-  // triangle, making the edge to triangle mapping unique. Each
-  // triangle is stored three times within the hash table.
-  class EdgeHashNode {
+  // The triangles added since the last call to addPointToMesh
+  uint32_t *new_tris;
+  int num_new_tris, max_num_new_tris;
+
+  // The edge table maps the ordered edges of the triangular mesh to
+  // half-edges. The order must match the counter clockwise ordering
+  // of the triangle, making the edge to triangle mapping unique. Each
+  // half-edge is stored as 4*triangle + edge within an open-addressed
+  // table with linear probing.
+  uint32_t *edge_table;
+  uint32_t edge_table_size;  // The table size (a power of two)
+  int num_edges;             // The number of half-edges in the table
+
+  // Class to store an entry in the queue of active triangles. The
+  // stamp is used to detect entries that have been deleted and re-used.
+  class TriIndex {
    public:
-    uint32_t u, v;          // The edge indices
-    TriListNode *tri_node;  // Pointer to the node within the triangle list
-    EdgeHashNode *next;     // Next node
+    TriIndex(uint32_t _index, uint32_t _stamp) {
+      index = _index;
+      stamp = _stamp;
+    }
+    uint32_t index, stamp;
   };
 
-  // Create the array of hash buckets
-  EdgeHashNode **buckets;
-
-  // The number of buckets
-  int num_buckets;
-  int num_hash_nodes;
-
   // Class to store an edge in a triangle
   class TriEdge {
    public:
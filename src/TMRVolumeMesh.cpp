@@ -27,6 +27,10 @@
 #include "TMRNativeTopology.h"
 #include "tmrlapack.h"
 
+#ifdef TMR_HAS_OPENMP
+#include <omp.h>
+#endif  // TMR_HAS_OPENMP
+
 #ifdef TMR_USE_NETGEN
 // The namespace is required because of the way nglib is compiled by
 // default. This is a funny way to do it, but who am I to complain.
@@ -168,13 +172,27 @@ void TMRVolumeMesh::writeToVTK(const char *filename) {
   Mesh the volume via sweeping (or tetrahedral meshing)
 */
 int TMRVolumeMesh::mesh(TMRMeshOptions options) {
-  int mpi_rank;
-  MPI_Comm_rank(comm, &mpi_rank);
-
   if (options.mesh_type_default == TMR_TRIANGLE) {
     return tetMesh(options);
   }
 
+  // Create the connectivity and then set the node locations using a
+  // swept meshing algorithm
+  int mesh_fail = meshConnectivity(options);
+  mesh_fail = mesh_fail || setNodeLocations(options);
+
+  return mesh_fail;
+}
+
+/*
+  Create the swept hexahedral connectivity for the volume
+
+  This finds the source and target faces and the structured faces
+  that connect them, and creates the hexahedral connectivity. The
+  node locations are allocated, but are only set by a subsequent call
+  to setNodeLocations(). This does not require any communication.
+*/
+int TMRVolumeMesh::meshConnectivity(TMRMeshOptions options) {
   // Keep track of whether the mesh has failed at any time. Try and
   // print out a helpful message.
   int mesh_fail = 0;
@@ -432,9 +450,6 @@ int TMRVolumeMesh::mesh(TMRMeshOptions options) {
     }
   }
 
-  // Set the node locations using a swept meshing algorithm
-  mesh_fail = mesh_fail || setNodeLocations(options);
-
   return mesh_fail;
 }
 
@@ -541,26 +556,40 @@ int TMRVolumeMesh::setNodeLocations(TMRMeshOptions options) {
   // Set the regularization factor
   double tolerance = 1e-10;
 
+  // The least-squares matrices for the mappings from the source and
+  // target planes only depend on the source and target planes, so
+  // they are factored once and used for every plane
+  double cs[3], Qs[81], eigs[9];
+  int icode = factorSweptMapping(0, num_fixed_pts, num_quad_pts, tolerance,
+                                 cs, Qs, eigs);
+  if (icode) {
+    fprintf(stderr, "TMRVolumeMesh Error: LAPACK error code %d\n", icode);
+  }
+
+  double ct[3], Qt[81], eigt[9];
+  icode = factorSweptMapping(num_swept_pts - 1, num_fixed_pts, num_quad_pts,
+                             tolerance, ct, Qt, eigt);
+  if (icode) {
+    fprintf(stderr, "TMRVolumeMesh Error: LAPACK error code %d\n", icode);
+  }
+
   // Set the remaining volume node locations based on a least-squares
-  // method
+  // method. Each plane only depends on the source, the target and
+  // its own fixed points, so the planes can be set in any order.
+#ifdef TMR_HAS_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif  // TMR_HAS_OPENMP
   for (int j = 1; j < num_swept_pts - 1; j++) {
     double u = 1.0 * j / (num_swept_pts - 1);
 
     // Compute the mapping from source to plane j
-    double As[9], bs[3], cs[3];
-    int icode = getSweptMapping(0, j, num_fixed_pts, num_quad_pts, As, bs, cs,
-                                tolerance);
-    if (icode) {
-      fprintf(stderr, "TMRVolumeMesh Error: LAPACK error code %d\n", icode);
-    }
+    double As[9], bs[3];
+    getSweptMapping(0, j, num_fixed_pts, num_quad_pts, cs, Qs, eigs, As, bs);
 
     // Compute the mapping from the target plane to plane j
-    double At[9], bt[3], ct[3];
-    icode = getSweptMapping(num_swept_pts - 1, j, num_fixed_pts, num_quad_pts,
-                            At, bt, ct, tolerance);
-    if (icode) {
-      fprintf(stderr, "TMRVolumeMesh Error: LAPACK error code %d\n", icode);
-    }
+    double At[9], bt[3];
+    getSweptMapping(num_swept_pts - 1, j, num_fixed_pts, num_quad_pts, ct, Qt,
+                    eigt, At, bt);
 
     for (int i = num_fixed_pts; i < num_quad_pts; i++) {
       // Compute the mapped point from the source location
@@ -582,8 +611,6 @@ int TMRVolumeMesh::setNodeLocations(TMRMeshOptions options) {
       Xt.z = At[6] * t.x + At[7] * t.y + At[8] * t.z + bt[2];
 
       int index = i + num_quad_pts * j;
-      // Xs = X[i];
-      // Xt = X[i + (num_swept_pts-1)*num_quad_pts];
       X[index].x = (1.0 - u) * Xs.x + u * Xt.x;
       X[index].y = (1.0 - u) * Xs.y + u * Xt.y;
       X[index].z = (1.0 - u) * Xs.z + u * Xt.z;
@@ -594,13 +621,28 @@ int TMRVolumeMesh::setNodeLocations(TMRMeshOptions options) {
 }
 
 /*
-  Compute the mapping between the provided source plane and the
-  resulting destination plane
+  Factor the least-squares matrix for the mapping from the provided
+  source plane
+
+  The mapping from the source plane to a destination plane takes the
+  form A*(x - c) + b, where c and b are the centroids of the fixed
+  points on the source and destination planes. The least-squares
+  matrix for A only depends on the source plane. This computes the
+  centroid and the eigenvalues and eigenvectors of the matrix. The
+  eigenvalues that are small relative to the maximum eigenvalue are
+  set to zero.
+
+  output:
+  c:     the centroid of the fixed points on the source plane
+  Q:     the eigenvectors of the least-squares matrix
+  eigs:  the eigenvalues of the least-squares matrix
+
+  returns:
+  the LAPACK error code
 */
-int TMRVolumeMesh::getSweptMapping(int source_plane, int dest_plane,
-                                   int num_fixed_pts, int num_quad_pts,
-                                   double *A, double *b, double *c,
-                                   double tolerance) {
+int TMRVolumeMesh::factorSweptMapping(int source_plane, int num_fixed_pts,
+                                      int num_quad_pts, double tolerance,
+                                      double *c, double *Q, double *eigs) {
   // Compute the centroid of the source plane
   const TMRPoint *Xsrc = &X[source_plane * num_quad_pts];
   c[0] = c[1] = c[2] = 0.0;
@@ -613,51 +655,30 @@ int TMRVolumeMesh::getSweptMapping(int source_plane, int dest_plane,
   c[1] = c[1] / num_fixed_pts;
   c[2] = c[2] / num_fixed_pts;
 
-  // Compute the centroid of the destination plane
-  const TMRPoint *Xdest = &X[dest_plane * num_quad_pts];
-  b[0] = b[1] = b[2] = 0.0;
-  for (int k = 0; k < num_fixed_pts; k++) {
-    b[0] += Xdest[k].x;
-    b[1] += Xdest[k].y;
-    b[2] += Xdest[k].z;
-  }
-  b[0] = b[0] / num_fixed_pts;
-  b[1] = b[1] / num_fixed_pts;
-  b[2] = b[2] / num_fixed_pts;
-
-  // Loop over the fixed points on the destination plane
-  double N[81];
-  memset(N, 0, 81 * sizeof(double));
-  memset(A, 0, 9 * sizeof(double));
+  // Loop over the fixed points on the source plane
+  memset(Q, 0, 81 * sizeof(double));
   for (int k = 0; k < num_fixed_pts; k++) {
-    // Compute the difference between the destination and
     double xs[3];
     xs[0] = Xsrc[k].x - c[0];
     xs[1] = Xsrc[k].y - c[1];
     xs[2] = Xsrc[k].z - c[2];
 
-    double xd[3];
-    xd[0] = Xdest[k].x - b[0];
-    xd[1] = Xdest[k].y - b[1];
-    xd[2] = Xdest[k].z - b[2];
-
     for (int i = 0; i < 9; i++) {
       // Enforce i/3 == j/3
       int start = i / 3;
       int end = i / 3 + 1;
       for (int j = 3 * start; j < 3 * end; j++) {
-        N[i + 9 * j] += xs[i % 3] * xs[j % 3];
+        Q[i + 9 * j] += xs[i % 3] * xs[j % 3];
       }
-      A[i] += xs[i % 3] * xd[i / 3];
     }
   }
 
-  // Compute the eigenvalues and eigenvectors of the matrix N
+  // Compute the eigenvalues and eigenvectors of the matrix
   int info = 0, n = 9;
   int lwork = 256, liwork = 128;
-  double eigs[9], work[256];
+  double work[256];
   int iwork[128];
-  TmrLAPACKsyevd("V", "U", &n, N, &n, eigs, work, &lwork, iwork, &liwork,
+  TmrLAPACKsyevd("V", "U", &n, Q, &n, eigs, work, &lwork, iwork, &liwork,
                  &info);
 
   // Find the maximum eigenvalue for the purposes of applying a
@@ -668,15 +689,69 @@ int TMRVolumeMesh::getSweptMapping(int source_plane, int dest_plane,
       max_eig = eigs[i];
     }
   }
+  for (int i = 0; i < 9; i++) {
+    if (!(eigs[i] > tolerance * max_eig)) {
+      eigs[i] = 0.0;
+    }
+  }
+
+  return info;
+}
+
+/*
+  Compute the mapping between the provided source plane and the
+  resulting destination plane using the factored least-squares matrix
+  from factorSweptMapping()
+
+  output:
+  A:     the linear part of the mapping
+  b:     the centroid of the fixed points on the destination plane
+*/
+void TMRVolumeMesh::getSweptMapping(int source_plane, int dest_plane,
+                                    int num_fixed_pts, int num_quad_pts,
+                                    const double *c, const double *Q,
+                                    const double *eigs, double *A,
+                                    double *b) {
+  const TMRPoint *Xsrc = &X[source_plane * num_quad_pts];
+
+  // Compute the centroid of the destination plane
+  const TMRPoint *Xdest = &X[dest_plane * num_quad_pts];
+  b[0] = b[1] = b[2] = 0.0;
+  for (int k = 0; k < num_fixed_pts; k++) {
+    b[0] += Xdest[k].x;
+    b[1] += Xdest[k].y;
+    b[2] += Xdest[k].z;
+  }
+  b[0] = b[0] / num_fixed_pts;
+  b[1] = b[1] / num_fixed_pts;
+  b[2] = b[2] / num_fixed_pts;
+
+  // Compute the right-hand-side from the fixed points
+  memset(A, 0, 9 * sizeof(double));
+  for (int k = 0; k < num_fixed_pts; k++) {
+    double xs[3];
+    xs[0] = Xsrc[k].x - c[0];
+    xs[1] = Xsrc[k].y - c[1];
+    xs[2] = Xsrc[k].z - c[2];
+
+    double xd[3];
+    xd[0] = Xdest[k].x - b[0];
+    xd[1] = Xdest[k].y - b[1];
+    xd[2] = Xdest[k].z - b[2];
+
+    for (int i = 0; i < 9; i++) {
+      A[i] += xs[i % 3] * xd[i / 3];
+    }
+  }
 
   // N*A = rhs
   // A = Q*Lambda^{-1}*Q^{T}*rhs
   double temp[9];
   for (int i = 0; i < 9; i++) {
     temp[i] = 0.0;
-    if (eigs[i] > tolerance * max_eig) {
+    if (eigs[i] != 0.0) {
       for (int j = 0; j < 9; j++) {
-        temp[i] += N[9 * i + j] * A[j];
+        temp[i] += Q[9 * i + j] * A[j];
       }
       temp[i] = temp[i] / eigs[i];
     }
@@ -686,12 +761,25 @@ int TMRVolumeMesh::getSweptMapping(int source_plane, int dest_plane,
   for (int i = 0; i < 9; i++) {
     if (temp[i] != 0.0) {
       for (int j = 0; j < 9; j++) {
-        A[j] += N[9 * i + j] * temp[i];
+        A[j] += Q[9 * i + j] * temp[i];
       }
     }
   }
+}
 
-  return info;
+/*
+  Broadcast the node locations from the root processor
+
+  The connectivity must be created on all processors with
+  meshConnectivity() and the node locations must be set on the root
+  processor with setNodeLocations().
+*/
+void TMRVolumeMesh::broadcastNodeLocations(int root) {
+  int mpi_size;
+  MPI_Comm_size(comm, &mpi_size);
+  if (mpi_size > 1 && X) {
+    MPI_Bcast(X, num_points, TMRPoint_MPI_type, root, comm);
+  }
 }
 
 /*
@@ -38,6 +38,13 @@ class TMRVolumeMesh : public TMREntity {
   // Create the volume mesh
   int mesh(TMRMeshOptions options);
 
+  // Create the swept mesh in parallel: create the connectivity on all
+  // processors, set the node locations on one processor and then
+  // distribute them from that processor
+  int meshConnectivity(TMRMeshOptions options);
+  int setNodeLocations(TMRMeshOptions options);
+  void broadcastNodeLocations(int root);
+
   // Retrieve the mesh points
   void getMeshPoints(int *_npts, TMRPoint **X);
 
@@ -56,13 +63,13 @@ class TMRVolumeMesh : public TMREntity {
   // Create a tetrahedral mesh (if possible)
   int tetMesh(TMRMeshOptions options);
 
-  // Set the node locations based on the surface node locations
-  int setNodeLocations(TMRMeshOptions options);
-
   // Get the mapping for the swept mesh
-  int getSweptMapping(int source_plane, int dest_plane, int num_fixed_pts,
-                      int num_quad_pts, double *A, double *b, double *c,
-                      double regfactor);
+  int factorSweptMapping(int source_plane, int num_fixed_pts,
+                         int num_quad_pts, double tolerance, double *c,
+                         double *Q, double *eigs);
+  void getSweptMapping(int source_plane, int dest_plane, int num_fixed_pts,
+                       int num_quad_pts, const double *c, const double *Q,
+                       const double *eigs, double *A, double *b);
 
   // The underlying volume
   MPI_Comm comm;
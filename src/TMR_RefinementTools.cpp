@@ -21,6 +21,9 @@
 #include "TMR_RefinementTools.h"
 
 #include "TACSElementAlgebra.h"
+#include "TMRAgglomeratedPc.h"
+#include "TMRMixedChebyshevSmoother.h"
+#include "TMROctForestHierarchy.h"
 #include "tacslapack.h"
 
 // Include the stdlib set/string classes
@@ -28,19 +31,52 @@
 #include <string>
 
 // Include for writing output file
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 
+/*
+  The element loops in the reconstruction and the error estimates are
+  independent for each element. When the loop adds the element results
+  to a distributed vector, the elements are processed in blocks: the
+  results for a block are computed in parallel and then added to the
+  vector in element order so that the sum does not depend on the
+  number of threads. Loops that write only to the element entries are
+  scheduled in chunks of elements. Loops that call the TACS elements
+  are only threaded when TMRSetThreadSafeElements() has been called,
+  since the elements and constitutive objects keep shared scratch
+  space.
+*/
+static const int TMR_RECON_BLOCK_SIZE = 256;
+static const int TMR_RECON_CHUNK_SIZE = 16;
+
 /*
   Create a multgrid object for a forest of octrees
 */
 void TMR_CreateTACSMg(int num_levels, TACSAssembler *assembler[],
                       TMROctForest *forest[], TACSMg **_mg, double omega,
                       int use_galerkin, int use_coarse_direct_solve,
-                      int use_chebyshev_smoother) {
+                      int use_chebyshev_smoother, int coarse_solve_procs,
+                      int use_mixed_precision) {
   // Get the communicator
   MPI_Comm comm = assembler[0]->getMPIComm();
 
+#ifdef TACS_USE_COMPLEX
+  // The single precision smoother discards the imaginary parts, so use
+  // the Chebyshev smoother in double precision in complex builds
+  if (use_mixed_precision) {
+    int mpi_rank;
+    MPI_Comm_rank(comm, &mpi_rank);
+    if (mpi_rank == 0) {
+      fprintf(stderr,
+              "TMR_CreateTACSMg Warning: The mixed precision smoother is "
+              "real-valued, using the Chebyshev smoother\n");
+    }
+    use_mixed_precision = 0;
+    use_chebyshev_smoother = 1;
+  }
+#endif  // TACS_USE_COMPLEX
+
   // Create the multigrid object
   int zero_guess = 0;
   double lower = 1.0 / 30.0, upper = 1.1;
@@ -51,19 +87,31 @@ void TMR_CreateTACSMg(int num_levels, TACSAssembler *assembler[],
   TACSMg *mg =
       new TACSMg(comm, num_levels, omega, mg_smooth_iters, mg_sor_symm);
 
-  // Create the intepolation/restriction objects between mesh levels
+  // Create the intepolation/restriction objects between mesh levels.
+  // The operators for all the levels are created together.
+  TACSBVecInterp **interps = new TACSBVecInterp *[num_levels];
   for (int level = 0; level < num_levels - 1; level++) {
-    // Create the interpolation object
-    TACSBVecInterp *interp =
-        new TACSBVecInterp(assembler[level + 1], assembler[level]);
-
-    // Set the interpolation
-    forest[level]->createInterpolation(forest[level + 1], interp);
+    interps[level] = new TACSBVecInterp(assembler[level + 1], assembler[level]);
+  }
+  TMROctForestHierarchy::createInterpolation(num_levels, forest, interps);
 
+  for (int level = 0; level < num_levels - 1; level++) {
     // Initialize the interpolation
+    TACSBVecInterp *interp = interps[level];
     interp->initialize();
 
-    if (use_chebyshev_smoother) {
+    if (use_mixed_precision) {
+      // Create the matrix
+      TACSParallelMat *mat = assembler[level]->createMat();
+
+      // Set up the single precision smoother
+      TMRMixedChebyshevSmoother *pc = new TMRMixedChebyshevSmoother(
+          assembler[level], mat, cheb_degree, lower, upper, mg_smooth_iters);
+
+      // Set the interpolation and TACS object within the multigrid object
+      mg->setLevel(level, assembler[level], interp, mg_iters_per_level,
+                   use_galerkin, mat, pc);
+    } else if (use_chebyshev_smoother) {
       // Create the matrix
       TACSParallelMat *mat = assembler[level]->createMat();
 
@@ -79,8 +127,41 @@ void TMR_CreateTACSMg(int num_levels, TACSAssembler *assembler[],
                    use_galerkin);
     }
   }
+  delete[] interps;
+
+  // Only gather the lowest level onto a subset of the processors when
+  // it is small enough to be stored as a dense matrix. The dense
+  // factorization is real-valued, so it is not used in complex builds.
+  int use_agglomerated_solve = 0;
+  if (use_coarse_direct_solve && coarse_solve_procs != 0) {
+    int mpi_rank;
+    MPI_Comm_rank(comm, &mpi_rank);
+#ifdef TACS_USE_COMPLEX
+    if (mpi_rank == 0) {
+      fprintf(stderr,
+              "TMR_CreateTACSMg Warning: The agglomerated coarse solve is "
+              "real-valued, using the parallel direct solve\n");
+    }
+#else
+    use_agglomerated_solve =
+        TMRAgglomeratedPc::isSizeSupported(assembler[num_levels - 1]);
+    if (!use_agglomerated_solve && mpi_rank == 0) {
+      fprintf(stderr,
+              "TMR_CreateTACSMg Warning: Coarse problem exceeds %d unknowns, "
+              "using the parallel direct solve\n",
+              TMRAgglomeratedPc::MAX_DENSE_SIZE);
+    }
+#endif  // TACS_USE_COMPLEX
+  }
 
-  if (use_coarse_direct_solve) {
+  if (use_agglomerated_solve) {
+    // Factor the lowest level on a subset of the processors
+    TACSParallelMat *mat = assembler[num_levels - 1]->createMat();
+    TMRAgglomeratedPc *pc = new TMRAgglomeratedPc(
+        assembler[num_levels - 1], mat, coarse_solve_procs);
+    mg->setLevel(num_levels - 1, assembler[num_levels - 1], NULL, 1,
+                 use_galerkin, mat, pc);
+  } else if (use_coarse_direct_solve) {
     // Set the lowest level - with no interpolation object
     mg->setLevel(num_levels - 1, assembler[num_levels - 1], NULL, 1,
                  use_galerkin);
@@ -88,7 +169,12 @@ void TMR_CreateTACSMg(int num_levels, TACSAssembler *assembler[],
     TACSParallelMat *mat = assembler[num_levels - 1]->createMat();
     TACSPc *pc = NULL;
 
-    if (use_chebyshev_smoother) {
+    if (use_mixed_precision) {
+      // Set up the single precision smoother
+      pc = new TMRMixedChebyshevSmoother(assembler[num_levels - 1], mat,
+                                         cheb_degree, lower, upper,
+                                         mg_smooth_iters);
+    } else if (use_chebyshev_smoother) {
       // Set up the smoother
       pc = new TACSChebyshevSmoother(mat, cheb_degree, lower, upper,
                                      mg_smooth_iters);
@@ -112,10 +198,27 @@ void TMR_CreateTACSMg(int num_levels, TACSAssembler *assembler[],
 void TMR_CreateTACSMg(int num_levels, TACSAssembler *assembler[],
                       TMRQuadForest *forest[], TACSMg **_mg, double omega,
                       int use_galerkin, int use_coarse_direct_solve,
-                      int use_chebyshev_smoother) {
+                      int use_chebyshev_smoother, int coarse_solve_procs,
+                      int use_mixed_precision) {
   // Get the communicator
   MPI_Comm comm = assembler[0]->getMPIComm();
 
+#ifdef TACS_USE_COMPLEX
+  // The single precision smoother discards the imaginary parts, so use
+  // the Chebyshev smoother in double precision in complex builds
+  if (use_mixed_precision) {
+    int mpi_rank;
+    MPI_Comm_rank(comm, &mpi_rank);
+    if (mpi_rank == 0) {
+      fprintf(stderr,
+              "TMR_CreateTACSMg Warning: The mixed precision smoother is "
+              "real-valued, using the Chebyshev smoother\n");
+    }
+    use_mixed_precision = 0;
+    use_chebyshev_smoother = 1;
+  }
+#endif  // TACS_USE_COMPLEX
+
   // Create the multigrid object
   int zero_guess = 0;
   double lower = 1.0 / 30.0, upper = 1.1;
@@ -138,7 +241,18 @@ void TMR_CreateTACSMg(int num_levels, TACSAssembler *assembler[],
     // Initialize the interpolation
     interp->initialize();
 
-    if (use_chebyshev_smoother) {
+    if (use_mixed_precision) {
+      // Create the matrix
+      TACSParallelMat *mat = assembler[level]->createMat();
+
+      // Set up the single precision smoother
+      TMRMixedChebyshevSmoother *pc = new TMRMixedChebyshevSmoother(
+          assembler[level], mat, cheb_degree, lower, upper, mg_smooth_iters);
+
+      // Set the interpolation and TACS object within the multigrid object
+      mg->setLevel(level, assembler[level], interp, mg_iters_per_level,
+                   use_galerkin, mat, pc);
+    } else if (use_chebyshev_smoother) {
       // Create the matrix
       TACSParallelMat *mat = assembler[level]->createMat();
 
@@ -155,7 +269,39 @@ void TMR_CreateTACSMg(int num_levels, TACSAssembler *assembler[],
     }
   }
 
-  if (use_coarse_direct_solve) {
+  // Only gather the lowest level onto a subset of the processors when
+  // it is small enough to be stored as a dense matrix. The dense
+  // factorization is real-valued, so it is not used in complex builds.
+  int use_agglomerated_solve = 0;
+  if (use_coarse_direct_solve && coarse_solve_procs != 0) {
+    int mpi_rank;
+    MPI_Comm_rank(comm, &mpi_rank);
+#ifdef TACS_USE_COMPLEX
+    if (mpi_rank == 0) {
+      fprintf(stderr,
+              "TMR_CreateTACSMg Warning: The agglomerated coarse solve is "
+              "real-valued, using the parallel direct solve\n");
+    }
+#else
+    use_agglomerated_solve =
+        TMRAgglomeratedPc::isSizeSupported(assembler[num_levels - 1]);
+    if (!use_agglomerated_solve && mpi_rank == 0) {
+      fprintf(stderr,
+              "TMR_CreateTACSMg Warning: Coarse problem exceeds %d unknowns, "
+              "using the parallel direct solve\n",
+              TMRAgglomeratedPc::MAX_DENSE_SIZE);
+    }
+#endif  // TACS_USE_COMPLEX
+  }
+
+  if (use_agglomerated_solve) {
+    // Factor the lowest level on a subset of the processors
+    TACSParallelMat *mat = assembler[num_levels - 1]->createMat();
+    TMRAgglomeratedPc *pc = new TMRAgglomeratedPc(
+        assembler[num_levels - 1], mat, coarse_solve_procs);
+    mg->setLevel(num_levels - 1, assembler[num_levels - 1], NULL, 1,
+                 use_galerkin, mat, pc);
+  } else if (use_coarse_direct_solve) {
     // Set the lowest level - with no interpolation object
     mg->setLevel(num_levels - 1, assembler[num_levels - 1], NULL, 1,
                  use_galerkin);
@@ -163,7 +309,12 @@ void TMR_CreateTACSMg(int num_levels, TACSAssembler *assembler[],
     TACSParallelMat *mat = assembler[num_levels - 1]->createMat();
     TACSPc *pc = NULL;
 
-    if (use_chebyshev_smoother) {
+    if (use_mixed_precision) {
+      // Set up the single precision smoother
+      pc = new TMRMixedChebyshevSmoother(assembler[num_levels - 1], mat,
+                                         cheb_degree, lower, upper,
+                                         mg_smooth_iters);
+    } else if (use_chebyshev_smoother) {
       // Set up the smoother
       pc = new TACSChebyshevSmoother(mat, cheb_degree, lower, upper,
                                      mg_smooth_iters);
@@ -1317,6 +1468,11 @@ static void computeNodeDeriv3D(TMROctForest *forest, TACSAssembler *tacs,
 
 /*
   Reconstruct the solution on a more refined mesh
+
+  The elements are processed in blocks. The refined solution for each
+  element in a block is computed independently, in parallel when
+  OpenMP is enabled, and the contributions are then added to the
+  refined vector in element order.
 */
 void addRefinedSolution2D(TMRQuadForest *forest, TACSAssembler *tacs,
                           TMRQuadForest *forest_refined,
@@ -1343,165 +1499,156 @@ void addRefinedSolution2D(TMRQuadForest *forest, TACSAssembler *tacs,
   // number of nodes for each element
   const int neq = 2 * order * order;
 
-  // Allocate space for the element reconstruction problem
-  TacsScalar *tmp = new TacsScalar[neq * (nenrich + vars_per_node)];
-
-  // Element solution on the coarse TACS mesh
-  TacsScalar *uelem = new TacsScalar[vars_per_node * num_nodes];
-  TacsScalar *delem = new TacsScalar[deriv_per_node * num_nodes];
-  TacsScalar *ubar = new TacsScalar[vars_per_node * nenrich];
-
-  // Refined element solution
-  TacsScalar *uref = new TacsScalar[vars_per_node * num_refined_nodes];
-
-  // The maximum number of nodes for any element
-  TacsScalar Xpts[3 * MAX_ORDER * MAX_ORDER];
-
   // Number of local elements in the coarse version of TACS
   int nelems = tacs->getNumElements();
   if (element_nums) {
     nelems = num_elements;
   }
 
-  for (int index = 0; index < nelems; index++) {
-    // Get the element number
-    int elem = index;
-    if (element_nums) {
-      elem = element_nums[index];
-    }
+  // Refined element solutions for a block of elements
+  const int uref_size = vars_per_node * num_refined_nodes;
+  TacsScalar *uref_block = new TacsScalar[TMR_RECON_BLOCK_SIZE * uref_size];
 
-    // Get the node numbers and node locations for this element
-    int len;
-    const int *nodes;
-    tacs->getElement(elem, &len, &nodes);
+  for (int start = 0; start < nelems; start += TMR_RECON_BLOCK_SIZE) {
+    int end = start + TMR_RECON_BLOCK_SIZE;
+    if (end > nelems) {
+      end = nelems;
+    }
 
-    // Get the derivatives at the nodes
-    vec->getValues(len, nodes, uelem);
-    vecDeriv->getValues(len, nodes, delem);
+#ifdef TMR_HAS_OPENMP
+#pragma omp parallel
+#endif  // TMR_HAS_OPENMP
+    {
+      // Allocate space for the element reconstruction problem
+      TacsScalar *tmp = new TacsScalar[neq * (nenrich + vars_per_node)];
+
+      // Element solution on the coarse TACS mesh
+      TacsScalar *uelem = new TacsScalar[vars_per_node * num_nodes];
+      TacsScalar *delem = new TacsScalar[deriv_per_node * num_nodes];
+      TacsScalar *ubar = new TacsScalar[vars_per_node * nenrich];
+
+      // The maximum number of nodes for any element
+      TacsScalar Xpts[3 * MAX_ORDER * MAX_ORDER];
+
+#ifdef TMR_HAS_OPENMP
+#pragma omp for schedule(dynamic)
+#endif  // TMR_HAS_OPENMP
+      for (int index = start; index < end; index++) {
+        // Get the element number
+        int elem = index;
+        if (element_nums) {
+          elem = element_nums[index];
+        }
 
-    // Get the node locateions
-    tacs_refined->getElement(elem, Xpts);
+        // Get the node numbers and node locations for this element
+        int len;
+        const int *nodes;
+        tacs->getElement(elem, &len, &nodes);
 
-    // Compute the reconstruction weights for the enrichment functions
-    computeElemRecon2D(vars_per_node, forest, forest_refined, Xpts, uelem,
-                       delem, ubar, tmp);
+        // Get the derivatives at the nodes
+        vec->getValues(len, nodes, uelem);
+        vecDeriv->getValues(len, nodes, delem);
 
-    if (compute_difference) {
-      // Get the refined element nodes
-      const int *refined_nodes;
-      tacs_refined->getElement(elem, &len, &refined_nodes);
+        // Get the node locateions
+        tacs_refined->getElement(elem, Xpts);
 
-      // Zero the refined element contribution
-      memset(uref, 0, vars_per_node * num_refined_nodes * sizeof(TacsScalar));
+        // Compute the reconstruction weights for the enrichment functions
+        computeElemRecon2D(vars_per_node, forest, forest_refined, Xpts, uelem,
+                           delem, ubar, tmp);
 
-      // Compute the solution at the refined points
-      for (int m = 0; m < refined_order; m++) {
-        for (int n = 0; n < refined_order; n++) {
-          // Set the new parameter point in the refined element
-          double pt[2];
-          pt[0] = refined_knots[n];
-          pt[1] = refined_knots[m];
+        // Get the refined element nodes
+        const int *refined_nodes;
+        tacs_refined->getElement(elem, &len, &refined_nodes);
 
-          // Evaluate the shape functions and the enrichment
-          // functions at the new parametric point
-          double Nr[MAX_2D_ENRICH];
-          evalEnrichmentFuncs2D(order, pt, knots, Nr);
+        // Zero the refined element contribution
+        TacsScalar *uref = &uref_block[uref_size * (index - start)];
+        memset(uref, 0, uref_size * sizeof(TacsScalar));
 
-          // Add the portion from the enrichment functions
-          for (int i = 0; i < vars_per_node; i++) {
-            const TacsScalar *ue = &ubar[i];
-            TacsScalar *u = &uref[vars_per_node * (n + refined_order * m) + i];
+        // Compute the solution at the refined points
+        for (int m = 0; m < refined_order; m++) {
+          for (int n = 0; n < refined_order; n++) {
+            // Set the new parameter point in the refined element
+            double pt[2];
+            pt[0] = refined_knots[n];
+            pt[1] = refined_knots[m];
 
-            for (int k = 0; k < nenrich; k++) {
-              u[0] += Nr[k] * ue[vars_per_node * k];
+            if (!compute_difference) {
+              // Evaluate the shape functions
+              double N[MAX_ORDER * MAX_ORDER];
+              forest->evalInterp(pt, N);
+
+              // Set the values of the variables at this point
+              for (int i = 0; i < vars_per_node; i++) {
+                const TacsScalar *ue = &uelem[i];
+                TacsScalar *u =
+                    &uref[vars_per_node * (n + refined_order * m) + i];
+
+                for (int k = 0; k < num_nodes; k++) {
+                  u[0] += N[k] * ue[0];
+                  ue += vars_per_node;
+                }
+              }
             }
-          }
-        }
-      }
-
-      // Zero the contribution if it goes to a dependent node
-      for (int i = 0; i < num_refined_nodes; i++) {
-        if (refined_nodes[i] < 0) {
-          for (int j = 0; j < vars_per_node; j++) {
-            uref[vars_per_node * i + j] = 0.0;
-          }
-        }
-      }
-
-      // Add the contributions to the element
-      vec_refined->setValues(len, refined_nodes, uref, TACS_ADD_VALUES);
-    } else {
-      // Get the refined element nodes
-      const int *refined_nodes;
-      tacs_refined->getElement(elem, &len, &refined_nodes);
-
-      // Zero the refined element contribution
-      memset(uref, 0, vars_per_node * num_refined_nodes * sizeof(TacsScalar));
 
-      // Compute the element order
-      for (int m = 0; m < refined_order; m++) {
-        for (int n = 0; n < refined_order; n++) {
-          // Set the new parameter point in the refined element
-          double pt[2];
-          pt[0] = refined_knots[n];
-          pt[1] = refined_knots[m];
-
-          // Evaluate the shape functions
-          double N[MAX_ORDER * MAX_ORDER];
-          forest->evalInterp(pt, N);
+            // Evaluate the enrichment functions at the new parametric
+            // point and add them to the solution
+            double Nr[MAX_2D_ENRICH];
+            evalEnrichmentFuncs2D(order, pt, knots, Nr);
 
-          // Set the values of the variables at this point
-          for (int i = 0; i < vars_per_node; i++) {
-            const TacsScalar *ue = &uelem[i];
-            TacsScalar *u = &uref[vars_per_node * (n + refined_order * m) + i];
+            // Add the portion from the enrichment functions
+            for (int i = 0; i < vars_per_node; i++) {
+              const TacsScalar *ue = &ubar[i];
+              TacsScalar *u =
+                  &uref[vars_per_node * (n + refined_order * m) + i];
 
-            for (int k = 0; k < num_nodes; k++) {
-              u[0] += N[k] * ue[0];
-              ue += vars_per_node;
+              for (int k = 0; k < nenrich; k++) {
+                u[0] += Nr[k] * ue[vars_per_node * k];
+              }
             }
           }
+        }
 
-          // Evaluate the enrichment functions and add them to the
-          // solution
-          double Nr[MAX_2D_ENRICH];
-          evalEnrichmentFuncs2D(order, pt, knots, Nr);
-
-          // Add the portion from the enrichment functions
-          for (int i = 0; i < vars_per_node; i++) {
-            const TacsScalar *ue = &ubar[i];
-            TacsScalar *u = &uref[vars_per_node * (n + refined_order * m) + i];
-
-            for (int k = 0; k < nenrich; k++) {
-              u[0] += Nr[k] * ue[vars_per_node * k];
+        // Zero the contribution if it goes to a dependent node
+        for (int i = 0; i < num_refined_nodes; i++) {
+          if (refined_nodes[i] < 0) {
+            for (int j = 0; j < vars_per_node; j++) {
+              uref[vars_per_node * i + j] = 0.0;
             }
           }
         }
       }
 
-      // Zero the contribution if it goes to a dependent node
-      for (int i = 0; i < num_refined_nodes; i++) {
-        if (refined_nodes[i] < 0) {
-          for (int j = 0; j < vars_per_node; j++) {
-            uref[vars_per_node * i + j] = 0.0;
-          }
-        }
+      // Free the element data
+      delete[] tmp;
+      delete[] uelem;
+      delete[] delem;
+      delete[] ubar;
+    }
+
+    // Add the contributions to the elements in order
+    for (int index = start; index < end; index++) {
+      int elem = index;
+      if (element_nums) {
+        elem = element_nums[index];
       }
 
-      // Add the contributions to the element
-      vec_refined->setValues(len, refined_nodes, uref, TACS_ADD_VALUES);
+      int len;
+      const int *refined_nodes;
+      tacs_refined->getElement(elem, &len, &refined_nodes);
+      vec_refined->setValues(len, refined_nodes,
+                             &uref_block[uref_size * (index - start)],
+                             TACS_ADD_VALUES);
     }
   }
 
-  // Free allocated data
-  delete[] tmp;
-  delete[] uelem;
-  delete[] delem;
-  delete[] ubar;
-  delete[] uref;
+  delete[] uref_block;
 }
 
 /*
   Reconstruct the solution on a more refined mesh
+
+  The elements are processed in blocks in the same manner as the
+  quadtree version.
 */
 void addRefinedSolution3D(TMROctForest *forest, TACSAssembler *tacs,
                           TMROctForest *refined_forest,
@@ -1518,181 +1665,163 @@ void addRefinedSolution3D(TMROctForest *forest, TACSAssembler *tacs,
   const double *knots, *refined_knots;
   const int order = forest->getInterpKnots(&knots);
   const int refined_order = refined_forest->getInterpKnots(&refined_knots);
+  const int num_nodes = order * order * order;
   const int num_refined_nodes = refined_order * refined_order * refined_order;
 
   // The number of enrichment functions
   const int nenrich = getNum3dEnrich(order);
 
-  // The number of equations for the reconstruction: 2 times the
+  // The number of equations for the reconstruction: 3 times the
   // number of nodes for each element
   const int neq = 3 * order * order * order;
 
-  // Allocate space for the element reconstruction problem
-  TacsScalar *tmp = new TacsScalar[neq * (nenrich + vars_per_node)];
-
-  // Element solution on the coarse TACS mesh
-  TacsScalar *uelem = new TacsScalar[vars_per_node * order * order * order];
-  TacsScalar *delem = new TacsScalar[deriv_per_node * order * order * order];
-  TacsScalar *ubar = new TacsScalar[vars_per_node * nenrich];
-
-  // Refined element solution
-  TacsScalar *uref = new TacsScalar[vars_per_node * order * order * order];
-
-  // The maximum number of nodes for any element
-  TacsScalar Xpts[3 * MAX_ORDER * MAX_ORDER * MAX_ORDER];
-
   // Number of local elements in the coarse version of TACS
   int nelems = tacs->getNumElements();
   if (element_nums) {
     nelems = num_elements;
   }
 
-  for (int index = 0; index < nelems; index++) {
-    // Get the element number
-    int elem = index;
-    if (element_nums) {
-      elem = element_nums[index];
-    }
-
-    // Get the node numbers for this element
-    int len;
-    const int *nodes;
-    tacs->getElement(elem, &len, &nodes);
-
-    // Get the derivatives at the nodes
-    vec->getValues(len, nodes, uelem);
-    vecDeriv->getValues(len, nodes, delem);
+  // Refined element solutions for a block of elements
+  const int uref_size = vars_per_node * num_refined_nodes;
+  TacsScalar *uref_block = new TacsScalar[TMR_RECON_BLOCK_SIZE * uref_size];
 
-    // Get the refined node locations
-    refined_tacs->getElement(elem, Xpts);
-
-    // Compute the reconstruction weights for the enrichment functions
-    computeElemRecon3D(vars_per_node, forest, refined_forest, Xpts, uelem,
-                       delem, ubar, tmp);
-
-    if (compute_difference) {
-      // Get the refined element nodes
-      const int *refined_nodes;
-      refined_tacs->getElement(elem, &len, &refined_nodes);
+  for (int start = 0; start < nelems; start += TMR_RECON_BLOCK_SIZE) {
+    int end = start + TMR_RECON_BLOCK_SIZE;
+    if (end > nelems) {
+      end = nelems;
+    }
 
-      // Zero the refined element contribution
-      memset(uref, 0, vars_per_node * num_refined_nodes * sizeof(TacsScalar));
+#ifdef TMR_HAS_OPENMP
+#pragma omp parallel
+#endif  // TMR_HAS_OPENMP
+    {
+      // Allocate space for the element reconstruction problem
+      TacsScalar *tmp = new TacsScalar[neq * (nenrich + vars_per_node)];
+
+      // Element solution on the coarse TACS mesh
+      TacsScalar *uelem = new TacsScalar[vars_per_node * num_nodes];
+      TacsScalar *delem = new TacsScalar[deriv_per_node * num_nodes];
+      TacsScalar *ubar = new TacsScalar[vars_per_node * nenrich];
+
+      // The maximum number of nodes for any element
+      TacsScalar Xpts[3 * MAX_ORDER * MAX_ORDER * MAX_ORDER];
+
+#ifdef TMR_HAS_OPENMP
+#pragma omp for schedule(dynamic)
+#endif  // TMR_HAS_OPENMP
+      for (int index = start; index < end; index++) {
+        // Get the element number
+        int elem = index;
+        if (element_nums) {
+          elem = element_nums[index];
+        }
 
-      for (int p = 0; p < refined_order; p++) {
-        for (int m = 0; m < refined_order; m++) {
-          for (int n = 0; n < refined_order; n++) {
-            // Set the new parameter point in the refined element
-            double pt[3];
-            pt[0] = refined_knots[n];
-            pt[1] = refined_knots[m];
-            pt[2] = refined_knots[p];
+        // Get the node numbers for this element
+        int len;
+        const int *nodes;
+        tacs->getElement(elem, &len, &nodes);
+
+        // Get the derivatives at the nodes
+        vec->getValues(len, nodes, uelem);
+        vecDeriv->getValues(len, nodes, delem);
+
+        // Get the refined node locations
+        refined_tacs->getElement(elem, Xpts);
+
+        // Compute the reconstruction weights for the enrichment functions
+        computeElemRecon3D(vars_per_node, forest, refined_forest, Xpts, uelem,
+                           delem, ubar, tmp);
+
+        // Get the refined element nodes
+        const int *refined_nodes;
+        refined_tacs->getElement(elem, &len, &refined_nodes);
+
+        // Zero the refined element contribution
+        TacsScalar *uref = &uref_block[uref_size * (index - start)];
+        memset(uref, 0, uref_size * sizeof(TacsScalar));
+
+        for (int p = 0; p < refined_order; p++) {
+          for (int m = 0; m < refined_order; m++) {
+            for (int n = 0; n < refined_order; n++) {
+              // Set the new parameter point in the refined element
+              double pt[3];
+              pt[0] = refined_knots[n];
+              pt[1] = refined_knots[m];
+              pt[2] = refined_knots[p];
+
+              // Add the portion from the enrichment functions
+              int offset =
+                  (n + refined_order * m + refined_order * refined_order * p);
+              TacsScalar *u = &uref[vars_per_node * offset];
+
+              if (!compute_difference) {
+                // Evaluate the shape functions at the new parametric
+                // point
+                double N[MAX_ORDER * MAX_ORDER * MAX_ORDER];
+                forest->evalInterp(pt, N);
+
+                for (int i = 0; i < vars_per_node; i++) {
+                  const TacsScalar *ue = &uelem[i];
+                  for (int k = 0; k < num_nodes; k++) {
+                    u[i] += N[k] * ue[vars_per_node * k];
+                  }
+                }
+              }
 
-            // Evaluate the shape functions and the enrichment
-            // functions at the new parametric point
-            double Nr[MAX_3D_ENRICH];
-            if (order == 2) {
-              eval2ndEnrichmentFuncs3D(pt, Nr);
-            } else if (order == 3) {
-              eval3rdEnrichmentFuncs3D(pt, Nr);
-            }
+              // Evaluate the enrichment functions at the new
+              // parametric point
+              double Nr[MAX_3D_ENRICH];
+              if (order == 2) {
+                eval2ndEnrichmentFuncs3D(pt, Nr);
+              } else if (order == 3) {
+                eval3rdEnrichmentFuncs3D(pt, Nr);
+              }
 
-            // Add the portion from the enrichment functions
-            int offset =
-                (n + refined_order * m + refined_order * refined_order * p);
-            TacsScalar *u = &uref[vars_per_node * offset];
-            for (int i = 0; i < vars_per_node; i++) {
-              const TacsScalar *ue = &ubar[i];
-              for (int k = 0; k < nenrich; k++) {
-                u[i] += Nr[k] * ue[vars_per_node * k];
+              // Add the portion from the enrichment functions
+              for (int i = 0; i < vars_per_node; i++) {
+                const TacsScalar *ue = &ubar[i];
+                for (int k = 0; k < nenrich; k++) {
+                  u[i] += Nr[k] * ue[vars_per_node * k];
+                }
               }
             }
           }
         }
-      }
-
-      // Zero the contribution if it goes to a dependent node
-      for (int i = 0; i < num_refined_nodes; i++) {
-        if (refined_nodes[i] < 0) {
-          for (int j = 0; j < vars_per_node; j++) {
-            uref[vars_per_node * i + j] = 0.0;
-          }
-        }
-      }
-
-      // Add the contributions to the element
-      vec_refined->setValues(len, refined_nodes, uref, TACS_ADD_VALUES);
-    } else {
-      // Get the refined element nodes
-      const int *refined_nodes;
-      refined_tacs->getElement(elem, &len, &refined_nodes);
-
-      // Zero the refined element contribution
-      memset(uref, 0, vars_per_node * num_refined_nodes * sizeof(TacsScalar));
-
-      for (int p = 0; p < refined_order; p++) {
-        for (int m = 0; m < refined_order; m++) {
-          for (int n = 0; n < refined_order; n++) {
-            // Set the new parameter point in the refined element
-            double pt[3];
-            pt[0] = refined_knots[n];
-            pt[1] = refined_knots[m];
-            pt[2] = refined_knots[p];
-
-            // Evaluate the shape functions and the enrichment
-            // functions at the new parametric point
-            double N[MAX_ORDER * MAX_ORDER * MAX_ORDER];
-            forest->evalInterp(pt, N);
-
-            // Add the portion from the enrichment functions
-            int offset =
-                (n + refined_order * m + refined_order * refined_order * p);
-            TacsScalar *u = &uref[vars_per_node * offset];
-
-            for (int i = 0; i < vars_per_node; i++) {
-              const TacsScalar *ue = &uelem[i];
-              for (int k = 0; k < order * order * order; k++) {
-                u[i] += N[k] * ue[vars_per_node * k];
-              }
-            }
-
-            double Nr[MAX_3D_ENRICH];
-            if (order == 2) {
-              eval2ndEnrichmentFuncs3D(pt, Nr);
-            } else if (order == 3) {
-              eval3rdEnrichmentFuncs3D(pt, Nr);
-            }
 
-            // Add the portion from the enrichment functions
-            for (int i = 0; i < vars_per_node; i++) {
-              const TacsScalar *ue = &ubar[i];
-              for (int k = 0; k < nenrich; k++) {
-                u[i] += Nr[k] * ue[vars_per_node * k];
-              }
+        // Zero the contribution if it goes to a dependent node
+        for (int i = 0; i < num_refined_nodes; i++) {
+          if (refined_nodes[i] < 0) {
+            for (int j = 0; j < vars_per_node; j++) {
+              uref[vars_per_node * i + j] = 0.0;
             }
           }
         }
       }
 
-      // Zero the contribution if it goes to a dependent node
-      for (int i = 0; i < num_refined_nodes; i++) {
-        if (refined_nodes[i] < 0) {
-          for (int j = 0; j < vars_per_node; j++) {
-            uref[vars_per_node * i + j] = 0.0;
-          }
-        }
+      // Free the element data
+      delete[] tmp;
+      delete[] uelem;
+      delete[] delem;
+      delete[] ubar;
+    }
+
+    // Add the contributions to the elements in order
+    for (int index = start; index < end; index++) {
+      int elem = index;
+      if (element_nums) {
+        elem = element_nums[index];
       }
 
-      // Add the contributions to the element
-      vec_refined->setValues(len, refined_nodes, uref, TACS_ADD_VALUES);
+      int len;
+      const int *refined_nodes;
+      refined_tacs->getElement(elem, &len, &refined_nodes);
+      vec_refined->setValues(len, refined_nodes,
+                             &uref_block[uref_size * (index - start)],
+                             TACS_ADD_VALUES);
     }
   }
 
-  // Free allocated data
-  delete[] tmp;
-  delete[] uelem;
-  delete[] delem;
-  delete[] ubar;
-  delete[] uref;
+  delete[] uref_block;
 }
 
 /*
@@ -2397,21 +2526,6 @@ double TMR_StrainEnergyErrorEst(TMRQuadForest *forest, TACSAssembler *tacs,
   // Number of local elements
   const int nelems = tacs->getNumElements();
 
-  // Allocate space for the element reconstruction problem
-  TacsScalar *tmp = new TacsScalar[neq * (nenrich + vars_per_node)];
-  TacsScalar *ubar = new TacsScalar[vars_per_node * nenrich];
-  TacsScalar *delem = new TacsScalar[deriv_per_node * order * order];
-
-  // Allocate arrays needed for the reconstruction
-  TacsScalar *vars_elem = new TacsScalar[vars_per_node * order * order];
-
-  // The interpolated variables on the refined mesh
-  TacsScalar *dvars = new TacsScalar[vars_per_node * num_refined_nodes];
-  TacsScalar *vars_interp = new TacsScalar[vars_per_node * num_refined_nodes];
-
-  // Zero the refined nodes
-  memset(dvars, 0, vars_per_node * num_refined_nodes * sizeof(TacsScalar));
-
   // Get the communicator
   MPI_Comm comm = tacs->getMPIComm();
 
@@ -2440,64 +2554,100 @@ double TMR_StrainEnergyErrorEst(TMRQuadForest *forest, TACSAssembler *tacs,
   computeNodeDeriv2D(forest, tacs, uvec, weights, uderiv);
   weights->decref();
 
-  // Keep track of the total error
-  TacsScalar SE_total_error = 0.0;
-
-  for (int i = 0; i < nelems; i++) {
-    // The simulation time -- we assume time-independent analysis
-    double time = 0.0;
+  // Compute the error in each element. The elements are independent
+  // so each thread uses its own storage for the reconstruction. The
+  // energies are computed by the elements, so the loop is only
+  // threaded when the elements are flagged as thread-safe.
+#ifdef TMR_HAS_OPENMP
+#pragma omp parallel if (TMRGetThreadSafeElements())
+#endif  // TMR_HAS_OPENMP
+  {
+    // Allocate space for the element reconstruction problem
+    TacsScalar *tmp = new TacsScalar[neq * (nenrich + vars_per_node)];
+    TacsScalar *ubar = new TacsScalar[vars_per_node * nenrich];
+    TacsScalar *delem = new TacsScalar[deriv_per_node * order * order];
+
+    // Allocate arrays needed for the reconstruction
+    TacsScalar *vars_elem = new TacsScalar[vars_per_node * order * order];
+
+    // The interpolated variables on the refined mesh
+    TacsScalar *dvars = new TacsScalar[vars_per_node * num_refined_nodes];
+    TacsScalar *vars_interp =
+        new TacsScalar[vars_per_node * num_refined_nodes];
+
+    // Zero the refined nodes
+    memset(dvars, 0, vars_per_node * num_refined_nodes * sizeof(TacsScalar));
+
+#ifdef TMR_HAS_OPENMP
+#pragma omp for schedule(dynamic, TMR_RECON_CHUNK_SIZE)
+#endif  // TMR_HAS_OPENMP
+    for (int i = 0; i < nelems; i++) {
+      // The simulation time -- we assume time-independent analysis
+      double time = 0.0;
 
-    // Get the variables for this element on the coarse mesh
-    tacs->getElement(i, NULL, vars_elem);
+      // Get the variables for this element on the coarse mesh
+      tacs->getElement(i, NULL, vars_elem);
 
-    // Get the node numbers for this element
-    int len;
-    const int *nodes;
-    tacs->getElement(i, &len, &nodes);
+      // Get the node numbers for this element
+      int len;
+      const int *nodes;
+      tacs->getElement(i, &len, &nodes);
 
-    // Compute the solution on the refined mesh
-    uderiv->getValues(len, nodes, delem);
+      // Compute the solution on the refined mesh
+      uderiv->getValues(len, nodes, delem);
 
-    // Get the refined node locations
-    TacsScalar Xpts[3 * max_num_nodes];
-    TACSElement *elem = tacs_refined->getElement(i, Xpts);
+      // Get the refined node locations
+      TacsScalar Xpts[3 * max_num_nodes];
+      TACSElement *elem = tacs_refined->getElement(i, Xpts);
 
-    // Compute the enrichment functions for each degree of freedom
-    computeElemRecon2D(vars_per_node, forest, forest_refined, Xpts, vars_elem,
-                       delem, ubar, tmp);
+      // Compute the enrichment functions for each degree of freedom
+      computeElemRecon2D(vars_per_node, forest, forest_refined, Xpts,
+                         vars_elem, delem, ubar, tmp);
 
-    // Set the variables to zero
-    memset(vars_interp, 0,
-           vars_per_node * num_refined_nodes * sizeof(TacsScalar));
+      // Set the variables to zero
+      memset(vars_interp, 0,
+             vars_per_node * num_refined_nodes * sizeof(TacsScalar));
 
-    // Evaluate the interpolation on the refined mesh
-    for (int m = 0; m < refined_order; m++) {
-      for (int n = 0; n < refined_order; n++) {
-        double pt[2];
-        pt[0] = refined_knots[n];
-        pt[1] = refined_knots[m];
+      // Evaluate the interpolation on the refined mesh
+      for (int m = 0; m < refined_order; m++) {
+        for (int n = 0; n < refined_order; n++) {
+          double pt[2];
+          pt[0] = refined_knots[n];
+          pt[1] = refined_knots[m];
 
-        // Add the contribution from the enrichment functions
-        double Nr[MAX_2D_ENRICH];
-        evalEnrichmentFuncs2D(order, pt, knots, Nr);
+          // Add the contribution from the enrichment functions
+          double Nr[MAX_2D_ENRICH];
+          evalEnrichmentFuncs2D(order, pt, knots, Nr);
 
-        // Add the portion from the enrichment functions
-        for (int k = 0; k < nenrich; k++) {
-          // Evaluate the interpolation part of the reconstruction
-          for (int kk = 0; kk < vars_per_node; kk++) {
-            vars_interp[vars_per_node * (n + m * refined_order) + kk] +=
-                ubar[vars_per_node * k + kk] * Nr[k];
+          // Add the portion from the enrichment functions
+          for (int k = 0; k < nenrich; k++) {
+            // Evaluate the interpolation part of the reconstruction
+            for (int kk = 0; kk < vars_per_node; kk++) {
+              vars_interp[vars_per_node * (n + m * refined_order) + kk] +=
+                  ubar[vars_per_node * k + kk] * Nr[k];
+            }
           }
         }
       }
+
+      // Compute the strain/potential energy
+      TacsScalar Te, Pe;
+      elem->computeEnergies(i, time, Xpts, vars_interp, dvars, &Te, &Pe);
+      error[i] = fabs(TacsRealPart(Pe));
     }
 
-    // Compute the strain/potential energy
-    TacsScalar Te, Pe;
-    elem->computeEnergies(i, time, Xpts, vars_interp, dvars, &Te, &Pe);
-    error[i] = fabs(TacsRealPart(Pe));
+    // Free the element-related data
+    delete[] tmp;
+    delete[] ubar;
+    delete[] delem;
+    delete[] vars_elem;
+    delete[] dvars;
+    delete[] vars_interp;
+  }
 
-    // Add up the total error
+  // Add up the total error
+  TacsScalar SE_total_error = 0.0;
+  for (int i = 0; i < nelems; i++) {
     SE_total_error += error[i];
   }
 
@@ -2510,14 +2660,6 @@ double TMR_StrainEnergyErrorEst(TMRQuadForest *forest, TACSAssembler *tacs,
   uvec->decref();
   uderiv->decref();
 
-  // Free the element-related data
-  delete[] tmp;
-  delete[] ubar;
-  delete[] delem;
-  delete[] vars_elem;
-  delete[] dvars;
-  delete[] vars_interp;
-
   // Return the error
   return SE_total_error;
 }
@@ -2557,18 +2699,6 @@ double TMR_StrainEnergyErrorEst(TMROctForest *forest, TACSAssembler *tacs,
   // Number of local elements
   const int nelems = tacs->getNumElements();
 
-  // Allocate space for the element reconstruction problem
-  TacsScalar *tmp = new TacsScalar[neq * (nenrich + vars_per_node)];
-  TacsScalar *ubar = new TacsScalar[vars_per_node * nenrich];
-  TacsScalar *delem = new TacsScalar[deriv_per_node * num_nodes];
-
-  // Allocate arrays needed for the reconstruction
-  TacsScalar *vars_elem = new TacsScalar[vars_per_node * num_nodes];
-
-  // The interpolated variables on the refined mesh
-  TacsScalar *dvars = new TacsScalar[vars_per_node * num_refined_nodes];
-  TacsScalar *vars_interp = new TacsScalar[vars_per_node * num_refined_nodes];
-
   // Get the communicator
   MPI_Comm comm = tacs->getMPIComm();
 
@@ -2597,70 +2727,109 @@ double TMR_StrainEnergyErrorEst(TMROctForest *forest, TACSAssembler *tacs,
   computeNodeDeriv3D(forest, tacs, uvec, weights, uderiv);
   weights->decref();
 
-  // Keep track of the total error
-  double SE_total_error = 0.0;
+  // Compute the error in each element. The elements are independent
+  // so each thread uses its own storage for the reconstruction. The
+  // energies are computed by the elements, so the loop is only
+  // threaded when the elements are flagged as thread-safe.
+#ifdef TMR_HAS_OPENMP
+#pragma omp parallel if (TMRGetThreadSafeElements())
+#endif  // TMR_HAS_OPENMP
+  {
+    // Allocate space for the element reconstruction problem
+    TacsScalar *tmp = new TacsScalar[neq * (nenrich + vars_per_node)];
+    TacsScalar *ubar = new TacsScalar[vars_per_node * nenrich];
+    TacsScalar *delem = new TacsScalar[deriv_per_node * num_nodes];
+
+    // Allocate arrays needed for the reconstruction
+    TacsScalar *vars_elem = new TacsScalar[vars_per_node * num_nodes];
+
+    // The interpolated variables on the refined mesh
+    TacsScalar *dvars = new TacsScalar[vars_per_node * num_refined_nodes];
+    TacsScalar *vars_interp =
+        new TacsScalar[vars_per_node * num_refined_nodes];
+
+    // Zero the refined nodes
+    memset(dvars, 0, vars_per_node * num_refined_nodes * sizeof(TacsScalar));
+
+#ifdef TMR_HAS_OPENMP
+#pragma omp for schedule(dynamic, TMR_RECON_CHUNK_SIZE)
+#endif  // TMR_HAS_OPENMP
+    for (int i = 0; i < nelems; i++) {
+      // The simulation time -- we assume time-independent analysis
+      double time = 0.0;
 
-  for (int i = 0; i < nelems; i++) {
-    // The simulation time -- we assume time-independent analysis
-    double time = 0.0;
+      // Get the variables for this element on the coarse mesh
+      tacs->getElement(i, NULL, vars_elem);
 
-    // Get the node numbers for this element
-    int len;
-    const int *nodes;
-    tacs->getElement(i, &len, &nodes);
+      // Get the node numbers for this element
+      int len;
+      const int *nodes;
+      tacs->getElement(i, &len, &nodes);
 
-    // Get the values of the derivatives at the nodes
-    uderiv->getValues(len, nodes, delem);
+      // Get the values of the derivatives at the nodes
+      uderiv->getValues(len, nodes, delem);
 
-    // Get the node locations on the new mesh
-    TacsScalar Xpts[3 * max_num_nodes];
-    TACSElement *elem = refined_tacs->getElement(i, Xpts);
+      // Get the node locations on the new mesh
+      TacsScalar Xpts[3 * max_num_nodes];
+      TACSElement *elem = refined_tacs->getElement(i, Xpts);
 
-    // Compute the enrichment functions for each degree of freedom
-    computeElemRecon3D(vars_per_node, forest, refined_forest, Xpts, vars_elem,
-                       delem, ubar, tmp);
+      // Compute the enrichment functions for each degree of freedom
+      computeElemRecon3D(vars_per_node, forest, refined_forest, Xpts,
+                         vars_elem, delem, ubar, tmp);
 
-    // Set the variables to zero
-    memset(vars_interp, 0,
-           vars_per_node * num_refined_nodes * sizeof(TacsScalar));
+      // Set the variables to zero
+      memset(vars_interp, 0,
+             vars_per_node * num_refined_nodes * sizeof(TacsScalar));
 
-    for (int p = 0; p < refined_order; p++) {
-      for (int m = 0; m < refined_order; m++) {
-        for (int n = 0; n < refined_order; n++) {
-          double pt[3];
-          pt[0] = refined_knots[n];
-          pt[1] = refined_knots[m];
-          pt[2] = refined_knots[p];
+      for (int p = 0; p < refined_order; p++) {
+        for (int m = 0; m < refined_order; m++) {
+          for (int n = 0; n < refined_order; n++) {
+            double pt[3];
+            pt[0] = refined_knots[n];
+            pt[1] = refined_knots[m];
+            pt[2] = refined_knots[p];
 
-          // Evaluate the difference between the interpolation
-          // and the reconstruction (just the reconstruction part)
-          double Nr[MAX_3D_ENRICH];
-          if (order == 2) {
-            eval2ndEnrichmentFuncs3D(pt, Nr);
-          } else {
-            eval3rdEnrichmentFuncs3D(pt, Nr);
-          }
+            // Evaluate the difference between the interpolation
+            // and the reconstruction (just the reconstruction part)
+            double Nr[MAX_3D_ENRICH];
+            if (order == 2) {
+              eval2ndEnrichmentFuncs3D(pt, Nr);
+            } else {
+              eval3rdEnrichmentFuncs3D(pt, Nr);
+            }
 
-          // Add the portion from the enrichment functions
-          int offset =
-              (n + m * refined_order + p * refined_order * refined_order);
-          TacsScalar *v = &vars_interp[vars_per_node * offset];
-          for (int k = 0; k < nenrich; k++) {
-            // Evaluate the interpolation part of the reconstruction
-            for (int kk = 0; kk < vars_per_node; kk++) {
-              v[kk] += ubar[vars_per_node * k + kk] * Nr[k];
+            // Add the portion from the enrichment functions
+            int offset =
+                (n + m * refined_order + p * refined_order * refined_order);
+            TacsScalar *v = &vars_interp[vars_per_node * offset];
+            for (int k = 0; k < nenrich; k++) {
+              // Evaluate the interpolation part of the reconstruction
+              for (int kk = 0; kk < vars_per_node; kk++) {
+                v[kk] += ubar[vars_per_node * k + kk] * Nr[k];
+              }
             }
           }
         }
       }
+
+      // Compute the strain/potential energy
+      TacsScalar Te, Pe;
+      elem->computeEnergies(i, time, Xpts, vars_interp, dvars, &Te, &Pe);
+      error[i] = fabs(TacsRealPart(Pe));
     }
 
-    // Compute the strain/potential energy
-    TacsScalar Te, Pe;
-    elem->computeEnergies(i, time, Xpts, vars_interp, dvars, &Te, &Pe);
-    error[i] = fabs(TacsRealPart(Pe));
+    // Free the element-related data
+    delete[] tmp;
+    delete[] ubar;
+    delete[] delem;
+    delete[] vars_elem;
+    delete[] dvars;
+    delete[] vars_interp;
+  }
 
-    // Add up the total error
+  // Add up the total error
+  double SE_total_error = 0.0;
+  for (int i = 0; i < nelems; i++) {
     SE_total_error += error[i];
   }
 
@@ -2673,14 +2842,6 @@ double TMR_StrainEnergyErrorEst(TMROctForest *forest, TACSAssembler *tacs,
   uvec->decref();
   uderiv->decref();
 
-  // Free the element-related data
-  delete[] tmp;
-  delete[] ubar;
-  delete[] delem;
-  delete[] vars_elem;
-  delete[] dvars;
-  delete[] vars_interp;
-
   return SE_total_error;
 }
 
@@ -2771,6 +2932,150 @@ void TMR_PrintErrorBins(MPI_Comm comm, const double *error, const int nelems,
   }
 }
 
+/*
+  Map a double to an unsigned integer with the same ordering
+*/
+static uint64_t get_ordered_key(double value) {
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(uint64_t));
+  if (bits & (1ULL << 63)) {
+    return ~bits;
+  }
+  return bits | (1ULL << 63);
+}
+
+/*
+  Find the k-th largest value across all processors
+
+  This performs a bisection on the ordered integer keys of the values
+  so that the exact value is found after at most 64 reductions without
+  gathering or sorting the values themselves.
+*/
+static double find_kth_largest(MPI_Comm comm, const double *values,
+                               const int size, int k) {
+  uint64_t low = 0, high = ~0ULL;
+  while (low < high) {
+    uint64_t mid = low + (high - low) / 2 + 1;
+
+    int count = 0;
+    for (int i = 0; i < size; i++) {
+      if (get_ordered_key(values[i]) >= mid) {
+        count++;
+      }
+    }
+    MPI_Allreduce(MPI_IN_PLACE, &count, 1, MPI_INT, MPI_SUM, comm);
+
+    if (count >= k) {
+      low = mid;
+    } else {
+      high = mid - 1;
+    }
+  }
+
+  // Convert the key back to the value
+  uint64_t bits = low;
+  if (bits & (1ULL << 63)) {
+    bits &= ~(1ULL << 63);
+  } else {
+    bits = ~bits;
+  }
+  double value;
+  memcpy(&value, &bits, sizeof(double));
+  return value;
+}
+
+/*
+  Refine the elements with a ratio of the error to the target error
+  above the threshold
+*/
+int TMR_DecreasingThresholdRefine(MPI_Comm comm, const double *error,
+                                  const int nelems, double error_tol,
+                                  double threshold, int refine[]) {
+  int ntotal = nelems;
+  MPI_Allreduce(MPI_IN_PLACE, &ntotal, 1, MPI_INT, MPI_SUM, comm);
+  const double target = error_tol / ntotal;
+
+  int nrefine = 0;
+  for (int i = 0; i < nelems; i++) {
+    refine[i] = 0;
+    if (error[i] / target >= threshold) {
+      refine[i] = 1;
+      nrefine++;
+    }
+  }
+  MPI_Allreduce(MPI_IN_PLACE, &nrefine, 1, MPI_INT, MPI_SUM, comm);
+
+  return nrefine;
+}
+
+/*
+  Refine and coarsen a fixed fraction of the elements with the largest
+  and smallest ratios of the error to the target error
+*/
+void TMR_FixedGrowthRefine(MPI_Comm comm, const double *error,
+                           const int nelems, double error_tol,
+                           double refine_factor, double coarsen_factor,
+                           int refine[], double *refine_threshold,
+                           double *coarsen_threshold) {
+  int ntotal = nelems;
+  MPI_Allreduce(MPI_IN_PLACE, &ntotal, 1, MPI_INT, MPI_SUM, comm);
+  const double target = error_tol / ntotal;
+  const int nrefine = (int)(refine_factor * ntotal);
+  const int ncoarsen = (int)(coarsen_factor * ntotal);
+
+  // Compute the error ratios
+  double *ratio = new double[nelems];
+  for (int i = 0; i < nelems; i++) {
+    ratio[i] = error[i] / target;
+    refine[i] = 0;
+  }
+
+  // Find the bounds on the ratios for the refined/coarsened elements
+  double refine_bound = 0.0, coarsen_bound = 0.0;
+  if (nrefine > 0 && nrefine <= ntotal) {
+    refine_bound = find_kth_largest(comm, ratio, nelems, nrefine);
+  }
+  if (ncoarsen > 0 && ncoarsen <= ntotal) {
+    coarsen_bound =
+        find_kth_largest(comm, ratio, nelems, ntotal - ncoarsen + 1);
+  }
+
+  // Set the refinement indicator and the extreme ratios
+  double values[2] = {-1.0, -1.0};
+  for (int i = 0; i < nelems; i++) {
+    if (nrefine > 0 && ratio[i] >= refine_bound && ratio[i] >= 1.0) {
+      refine[i] = 1;
+      if (values[0] < 0.0 || ratio[i] < values[0]) {
+        values[0] = ratio[i];
+      }
+    } else if (ncoarsen > 0 && ratio[i] <= coarsen_bound && ratio[i] < 1.0) {
+      refine[i] = -1;
+      if (ratio[i] > values[1]) {
+        values[1] = ratio[i];
+      }
+    }
+  }
+  delete[] ratio;
+
+  // Find the smallest refined ratio and largest coarsened ratio. The
+  // refined value is negated so that both use the maximum.
+  if (values[0] >= 0.0) {
+    values[0] = -values[0];
+  } else {
+    values[0] = -HUGE_VAL;
+  }
+  MPI_Allreduce(MPI_IN_PLACE, values, 2, MPI_DOUBLE, MPI_MAX, comm);
+  if (refine_threshold) {
+    *refine_threshold = -1.0;
+    if (values[0] != -HUGE_VAL) {
+      *refine_threshold = -values[0];
+    }
+  }
+  if (coarsen_threshold) {
+    *coarsen_threshold = values[1];
+  }
+}
+
 /*!
   Create a nodal vector from the forest
 */
@@ -2879,23 +3184,6 @@ double TMR_AdjointErrorEst(TMRQuadForest *forest, TACSAssembler *tacs,
   // Get the communicator
   MPI_Comm comm = tacs->getMPIComm();
 
-  // Allocate the element arrays needed for the adjoint-weighted residual
-  TacsScalar *vars_refined = new TacsScalar[vars_per_node * num_refined_nodes];
-  TacsScalar *dvars_refined = new TacsScalar[vars_per_node * num_refined_nodes];
-  TacsScalar *ddvars_refined =
-      new TacsScalar[vars_per_node * num_refined_nodes];
-  TacsScalar *adj_refined = new TacsScalar[vars_per_node * num_refined_nodes];
-  TacsScalar *res_refined = new TacsScalar[vars_per_node * num_refined_nodes];
-  memset(dvars_refined, 0,
-         vars_per_node * num_refined_nodes * sizeof(TacsScalar));
-  memset(ddvars_refined, 0,
-         vars_per_node * num_refined_nodes * sizeof(TacsScalar));
-
-  // Allocate arrays for storing the nodal error esimates and nodal
-  // element counts - updated per element
-  TacsScalar *err = new TacsScalar[num_refined_nodes];
-  TacsScalar *weights = new TacsScalar[num_refined_nodes];
-
   // Keep track of the total output functional error estimate and the total
   // output functional correction terms
   TacsScalar total_error_est = 0.0;
@@ -2932,63 +3220,129 @@ double TMR_AdjointErrorEst(TMRQuadForest *forest, TACSAssembler *tacs,
     num_aux_elems = aux_elements->getAuxElements(&aux);
   }
 
-  // Compute the nodal error estimates using an adjoint-weighted residual for
-  // each element on this proc
+  // Find the range of auxiliary elements that belong to each element
+  int *aux_ptr = new int[nelems + 1];
   int aux_count = 0;
   for (int elem = 0; elem < nelems; elem++) {
-    // Set the simulation time
-    double time = 0.0;
-
-    // Get the node numbers for this element in the refined mesh
-    int nnodes = 0;
-    const int *node_inds;
-    tacs_refined->getElement(elem, &nnodes, &node_inds);
-
-    // Get the node locations for this element
-    TacsScalar Xpts[3 * max_num_nodes];
-    TACSElement *element = tacs_refined->getElement(elem, Xpts);
-
-    // Get the state and adjoint variables for this element
-    solution_refined->getValues(nnodes, node_inds, vars_refined);
-    adjoint_refined->getValues(nnodes, node_inds, adj_refined);
-
-    // Compute the residual on the element
-    memset(err, 0, nnodes * sizeof(TacsScalar));
-    memset(res_refined, 0, nnodes * vars_per_node * sizeof(TacsScalar));
-    element->addResidual(elem, time, Xpts, vars_refined, dvars_refined,
-                         ddvars_refined, res_refined);
-
-    // Compute the nodal error estimates with the adjoint-weighted residual
-    for (int inode = 0; inode < nnodes; inode++) {
-      for (int ivar = 0; ivar < vars_per_node; ivar++) {
-        int ind = vars_per_node * inode + ivar;
-        err[inode] += -1. * (res_refined[ind] * adj_refined[ind]);
-      }
+    aux_ptr[elem] = aux_count;
+    while (aux_count < num_aux_elems && aux[aux_count].num == elem) {
+      aux_count++;
     }
+  }
+  aux_ptr[nelems] = aux_count;
 
-    // Add the contribution from any loads - opposite sign for error
-    // contribution
-    while (aux_count < num_aux_elems && aux[aux_count].num == elem) {
-      memset(res_refined, 0, nnodes * vars_per_node * sizeof(TacsScalar));
-      aux[aux_count].elem->addResidual(elem, time, Xpts, vars_refined,
-                                       dvars_refined, ddvars_refined,
-                                       res_refined);
-      for (int inode = 0; inode < nnodes; inode++) {
-        for (int ivar = 0; ivar < vars_per_node; ivar++) {
-          int ind = vars_per_node * inode + ivar;
-          err[inode] += 1. * (res_refined[ind] * adj_refined[ind]);
+  // The nodal error estimates for a block of elements
+  TacsScalar *err_block = new TacsScalar[TMR_RECON_BLOCK_SIZE * max_num_nodes];
+
+  // Compute the nodal error estimates using an adjoint-weighted residual for
+  // each element on this proc. The estimates for a block of elements are
+  // computed independently and then added in element order. The
+  // residuals are computed by the elements, so the block is only
+  // computed in parallel when the elements are flagged as thread-safe.
+  for (int start = 0; start < nelems; start += TMR_RECON_BLOCK_SIZE) {
+    int end = start + TMR_RECON_BLOCK_SIZE;
+    if (end > nelems) {
+      end = nelems;
+    }
+
+#ifdef TMR_HAS_OPENMP
+#pragma omp parallel if (TMRGetThreadSafeElements())
+#endif  // TMR_HAS_OPENMP
+    {
+      // Allocate the element arrays needed for the adjoint-weighted residual
+      TacsScalar *vars_refined =
+          new TacsScalar[vars_per_node * num_refined_nodes];
+      TacsScalar *dvars_refined =
+          new TacsScalar[vars_per_node * num_refined_nodes];
+      TacsScalar *ddvars_refined =
+          new TacsScalar[vars_per_node * num_refined_nodes];
+      TacsScalar *adj_refined =
+          new TacsScalar[vars_per_node * num_refined_nodes];
+      TacsScalar *res_refined =
+          new TacsScalar[vars_per_node * num_refined_nodes];
+      memset(dvars_refined, 0,
+             vars_per_node * num_refined_nodes * sizeof(TacsScalar));
+      memset(ddvars_refined, 0,
+             vars_per_node * num_refined_nodes * sizeof(TacsScalar));
+
+#ifdef TMR_HAS_OPENMP
+#pragma omp for schedule(dynamic)
+#endif  // TMR_HAS_OPENMP
+      for (int elem = start; elem < end; elem++) {
+        // Set the simulation time
+        double time = 0.0;
+
+        // Get the node numbers for this element in the refined mesh
+        int nnodes = 0;
+        const int *node_inds;
+        tacs_refined->getElement(elem, &nnodes, &node_inds);
+
+        // Get the node locations for this element
+        TacsScalar Xpts[3 * max_num_nodes];
+        TACSElement *element = tacs_refined->getElement(elem, Xpts);
+
+        // Get the state and adjoint variables for this element
+        solution_refined->getValues(nnodes, node_inds, vars_refined);
+        adjoint_refined->getValues(nnodes, node_inds, adj_refined);
+
+        // Compute the residual on the element
+        TacsScalar *err = &err_block[max_num_nodes * (elem - start)];
+        memset(err, 0, nnodes * sizeof(TacsScalar));
+        memset(res_refined, 0, nnodes * vars_per_node * sizeof(TacsScalar));
+        element->addResidual(elem, time, Xpts, vars_refined, dvars_refined,
+                             ddvars_refined, res_refined);
+
+        // Compute the nodal error estimates with the adjoint-weighted
+        // residual
+        for (int inode = 0; inode < nnodes; inode++) {
+          for (int ivar = 0; ivar < vars_per_node; ivar++) {
+            int ind = vars_per_node * inode + ivar;
+            err[inode] += -1. * (res_refined[ind] * adj_refined[ind]);
+          }
+        }
+
+        // Add the contribution from any loads - opposite sign for error
+        // contribution
+        for (int k = aux_ptr[elem]; k < aux_ptr[elem + 1]; k++) {
+          memset(res_refined, 0, nnodes * vars_per_node * sizeof(TacsScalar));
+          aux[k].elem->addResidual(elem, time, Xpts, vars_refined,
+                                   dvars_refined, ddvars_refined, res_refined);
+          for (int inode = 0; inode < nnodes; inode++) {
+            for (int ivar = 0; ivar < vars_per_node; ivar++) {
+              int ind = vars_per_node * inode + ivar;
+              err[inode] += 1. * (res_refined[ind] * adj_refined[ind]);
+            }
+          }
         }
       }
-      aux_count++;
+
+      // Free the element arrays
+      delete[] vars_refined;
+      delete[] dvars_refined;
+      delete[] ddvars_refined;
+      delete[] adj_refined;
+      delete[] res_refined;
     }
 
-    // Add the nodal errors to the total output functional correction term
-    for (int i = 0; i < nnodes; i++) total_output_corr += TacsRealPart(err[i]);
+    for (int elem = start; elem < end; elem++) {
+      int nnodes = 0;
+      const int *node_inds;
+      tacs_refined->getElement(elem, &nnodes, &node_inds);
+      TacsScalar *err = &err_block[max_num_nodes * (elem - start)];
 
-    // Add the nodal errors from this element to the nodal error vector
-    nodal_error->setValues(nnodes, node_inds, err, TACS_ADD_VALUES);
+      // Add the nodal errors to the total output functional correction term
+      for (int i = 0; i < nnodes; i++) {
+        total_output_corr += TacsRealPart(err[i]);
+      }
+
+      // Add the nodal errors from this element to the nodal error vector
+      nodal_error->setValues(nnodes, node_inds, err, TACS_ADD_VALUES);
+    }
   }
 
+  delete[] aux_ptr;
+  delete[] err_block;
+
   // Finish setting the values into the nodal error array
   nodal_error->beginSetValues(TACS_ADD_VALUES);
   nodal_error->endSetValues(TACS_ADD_VALUES);
@@ -2998,26 +3352,43 @@ double TMR_AdjointErrorEst(TMRQuadForest *forest, TACSAssembler *tacs,
   nodal_error->endDistributeValues();
 
   // Localize the error from the nodes to the elements with an equal split
-  for (int elem = 0; elem < nelems; elem++) {
-    // Get the node numbers for this element in the refined mesh
-    int nnodes = 0;
-    const int *node_inds;
-    tacs_refined->getElement(elem, &nnodes, &node_inds);
-
-    // Get the errors and element counts for the nodes of this element
-    nodal_error->getValues(nnodes, node_inds, err);
-    nodal_weights->getValues(nnodes, node_inds, weights);
-
-    // Compute the element indicator error as a function of the nodal
-    // error estimate.
-    elem_error[elem] = 0.0;
-    for (int i = 0; i < nnodes; i++) {
-      if (node_inds[i] < 0) {
-        // skip dependent nodes - handled in beginSetValues() with dep weights
-        continue;
+#ifdef TMR_HAS_OPENMP
+#pragma omp parallel
+#endif  // TMR_HAS_OPENMP
+  {
+    // Allocate arrays for storing the nodal error esimates and nodal
+    // element counts - updated per element
+    TacsScalar *err = new TacsScalar[num_refined_nodes];
+    TacsScalar *weights = new TacsScalar[num_refined_nodes];
+
+#ifdef TMR_HAS_OPENMP
+#pragma omp for schedule(dynamic, TMR_RECON_CHUNK_SIZE)
+#endif  // TMR_HAS_OPENMP
+    for (int elem = 0; elem < nelems; elem++) {
+      // Get the node numbers for this element in the refined mesh
+      int nnodes = 0;
+      const int *node_inds;
+      tacs_refined->getElement(elem, &nnodes, &node_inds);
+
+      // Get the errors and element counts for the nodes of this element
+      nodal_error->getValues(nnodes, node_inds, err);
+      nodal_weights->getValues(nnodes, node_inds, weights);
+
+      // Compute the element indicator error as a function of the nodal
+      // error estimate.
+      elem_error[elem] = 0.0;
+      for (int i = 0; i < nnodes; i++) {
+        if (node_inds[i] < 0) {
+          // skip dependent nodes - handled in beginSetValues() with dep
+          // weights
+          continue;
+        }
+        elem_error[elem] += fabs(TacsRealPart(err[i])) / weights[i];
       }
-      elem_error[elem] += fabs(TacsRealPart(err[i])) / weights[i];
     }
+
+    delete[] err;
+    delete[] weights;
   }
 
   // Add up the absolute value of the nodal errors to get the output
@@ -3038,13 +3409,6 @@ double TMR_AdjointErrorEst(TMRQuadForest *forest, TACSAssembler *tacs,
   total_output_corr = temp[1];
 
   // Free the data that is no longer required
-  delete[] vars_refined;
-  delete[] dvars_refined;
-  delete[] ddvars_refined;
-  delete[] adj_refined;
-  delete[] res_refined;
-  delete[] err;
-  delete[] weights;
   nodal_error->decref();
   nodal_weights->decref();
 
@@ -3236,30 +3600,79 @@ double TMR_AdjointErrorEst(TMROctForest *forest, TACSAssembler *tacs,
 }
 
 /*
-  Evaluate the stress constraints on a more-refined mesh
+  The values stored at each quadrature point by the stress constraint:
+  the transpose of the Jacobian transformation (9), the strain (6),
+  the point location (3), the quadrature weight times the determinant
+  of the Jacobian (1) and the failure value (1)
 */
+static const int TMR_STRESS_POINT_SIZE = 20;
+
 /*
-TMRStressConstraint::TMRStressConstraint( TMROctForest *_forest,
-                                          TACSAssembler *_tacs,
-                                          TacsScalar _ks_weight ){
+  Compute the Gauss quadrature points and weights on the interval
+  [-1, 1] using Newton's method applied to the Legendre polynomial
+*/
+static void computeGaussQuadrature(int n, double pts[], double wts[]) {
+  for (int i = 0; i < n; i++) {
+    double x = cos(M_PI * (i + 0.75) / (n + 0.5));
+    double dp = 1.0;
+    for (int iter = 0; iter < 100; iter++) {
+      // Evaluate P_{n}(x) and P_{n-1}(x) using the recurrence
+      double p0 = 1.0, p1 = x;
+      for (int k = 2; k <= n; k++) {
+        double p2 = ((2 * k - 1) * x * p1 - (k - 1) * p0) / k;
+        p0 = p1;
+        p1 = p2;
+      }
+      dp = n * (x * p1 - p0) / (x * x - 1.0);
+      double dx = p1 / dp;
+      x -= dx;
+      if (fabs(dx) < 1e-15) {
+        break;
+      }
+    }
+    pts[n - 1 - i] = x;
+    wts[n - 1 - i] = 2.0 / ((1.0 - x * x) * dp * dp);
+  }
+}
+
+/*
+  Evaluate the stress constraints on a more-refined mesh
+*/
+TMRStressConstraint::TMRStressConstraint(TMROctForest *_forest,
+                                         TACSAssembler *_tacs,
+                                         TACSConstitutive *_con,
+                                         TacsScalar _ks_weight) {
   tacs = _tacs;
   tacs->incref();
+  con = _con;
+  con->incref();
 
   // Set the order/ksweight
   forest = _forest;
   forest->incref();
   ks_weight = _ks_weight;
+  ks_max_fail = 0.0;
+  ks_fail_sum = 0.0;
 
   // Get the mesh order
   order = forest->getMeshOrder();
   TMRInterpolationType interp_type = forest->getInterpType();
+  if (order < 2 || order > 3) {
+    fprintf(stderr, "TMRStressConstraint: Mesh order %d not supported\n",
+            order);
+  }
+  if (tacs->getVarsPerNode() != 3) {
+    fprintf(stderr,
+            "TMRStressConstraint: Expected 3 variables per node, not %d\n",
+            tacs->getVarsPerNode());
+  }
 
   // Create a forest with elevated order
   interp_forest = forest->duplicate();
   interp_forest->incref();
 
   // Create the mesh for the forest
-  interp_forest->setMeshOrder(order+1, interp_type);
+  interp_forest->setMeshOrder(order + 1, interp_type);
 
   // Create the nodes for the duplicated forest
   interp_forest->createNodes();
@@ -3271,8 +3684,7 @@ TMRStressConstraint::TMRStressConstraint( TMROctForest *_forest,
   // Create the weight vector - the weights are the number of times
   // each node is referenced by adjacent elements, including
   // inter-process references.
-  weights = new TACSBVec(tacs->getNodeMap(), 1,
-                         tacs->getBVecDistribute(),
+  weights = new TACSBVec(tacs->getNodeMap(), 1, tacs->getBVecDistribute(),
                          tacs->getBVecDepNodes());
   weights->incref();
 
@@ -3281,59 +3693,76 @@ TMRStressConstraint::TMRStressConstraint( TMROctForest *_forest,
 
   // Allocate a vector for the derivatives
   int vars_per_node = tacs->getVarsPerNode();
-  int deriv_per_node = 3*vars_per_node;
+  int deriv_per_node = 3 * vars_per_node;
   uderiv = new TACSBVec(tacs->getNodeMap(), deriv_per_node,
                         tacs->getBVecDistribute(), tacs->getBVecDepNodes());
   uderiv->incref();
 
   // Allocate derivative vector
-  dfduderiv = new TACSBVec(tacs->getNodeMap(), deriv_per_node,
-                           tacs->getBVecDistribute(), tacs->getBVecDepNodes());
+  dfduderiv =
+      new TACSBVec(tacs->getNodeMap(), deriv_per_node,
+                   tacs->getBVecDistribute(), tacs->getBVecDepNodes());
   dfduderiv->incref();
 
-  // Allocate the vectors
-  int max_nodes = tacs->getMaxElementNodes();
-  Xpts = new TacsScalar[ 3*(order+1)*(order+1)*(order+1) ];
-  vars = new TacsScalar[ vars_per_node*max_nodes ];
-  dvars = new TacsScalar[ vars_per_node*max_nodes ];
-  ddvars = new TacsScalar[ vars_per_node*max_nodes ];
-
-  // Set the maximum number of nodes
-  int neq = 3*max_nodes;
-  int max_enrich = 15;
-  varderiv = new TacsScalar[ deriv_per_node*max_nodes ];
-  ubar = new TacsScalar[ vars_per_node*max_enrich ];
-  tmp = new TacsScalar[ neq*(max_enrich + vars_per_node) ];
+  // Set the quadrature scheme
+  num_quad_pts = order + 1;
+  computeGaussQuadrature(num_quad_pts, quad_pts, quad_wts);
+
+  // Find the maximum number of design variable nodes for any element
+  const int nelems = tacs->getNumElements();
+  max_dv_nodes = 0;
+  for (int i = 0; i < nelems; i++) {
+    int n = con->getDesignVarNums(i, 0, NULL);
+    if (n > max_dv_nodes) {
+      max_dv_nodes = n;
+    }
+  }
+
+  // Allocate the storage for the values from evalConstraint()
+  const int interp_size = (order + 1) * (order + 1) * (order + 1);
+  const int npts = num_quad_pts * num_quad_pts * num_quad_pts;
+  has_recon = 0;
+  elem_Xpts = new TacsScalar[3 * interp_size * nelems];
+  elem_ubar = new TacsScalar[vars_per_node * getNum3dEnrich(order) * nelems];
+  point_data = new TacsScalar[TMR_STRESS_POINT_SIZE * npts * nelems];
 }
-*/
 
 /*
   Free the data that was allocated
 */
-/*
-TMRStressConstraint::~TMRStressConstraint(){
+TMRStressConstraint::~TMRStressConstraint() {
   forest->decref();
   interp_forest->decref();
+  con->decref();
   tacs->decref();
   weights->decref();
   uderiv->decref();
   uvec->decref();
   dfduderiv->decref();
-  delete [] Xpts;
-  delete [] vars;
-  delete [] dvars;
-  delete [] ddvars;
-  delete [] varderiv;
-  delete [] ubar;
-  delete [] tmp;
+  delete[] elem_Xpts;
+  delete[] elem_ubar;
+  delete[] point_data;
 }
+
+/*
+  Get the parametric point for the quadrature point with the given
+  index
 */
+void TMRStressConstraint::getQuadraturePoint(int index, double pt[]) {
+  pt[0] = quad_pts[index % num_quad_pts];
+  pt[1] = quad_pts[(index / num_quad_pts) % num_quad_pts];
+  pt[2] = quad_pts[index / (num_quad_pts * num_quad_pts)];
+}
 
 /*
   Evaluate the constraint on the refined mesh
+
+  The reconstruction only reads the distributed vectors, so the
+  element loop is threaded. The failure values are evaluated by the
+  constitutive object, so that loop is only threaded when the elements
+  are flagged as thread-safe.
 */
-/*
-TacsScalar TMRStressConstraint::evalConstraint( TACSBVec *_uvec ){
+TacsScalar TMRStressConstraint::evalConstraint(TACSBVec *_uvec) {
   const int vars_per_node = tacs->getVarsPerNode();
 
   // Copy the values
@@ -3353,20 +3782,12 @@ TacsScalar TMRStressConstraint::evalConstraint( TACSBVec *_uvec ){
   // Set the communicator
   MPI_Comm comm = tacs->getMPIComm();
 
-  // First, go through and evaluate the maximum stress
-  // in all of the elements
-  ks_max_fail = -1e20;
-
-  // Get the quadrature points/weights
-  const double *gaussPts, *gaussWts;
-
-  //int num_quad_pts = FElibrary::getGaussPtsWts(order+1, &gaussPts, &gaussWts);
-  int num_quad_pts = 0;
-  // FElibrary::getGaussPtsWts(order+1, &gaussPts, &gaussWts);
-
-  // int num_quad_pts =
-  //   FElibrary::getGaussPtsWts(LOBATTO_QUADRATURE, order+2,
-  //                             &gaussPts, &gaussWts);
+  // The sizes of the element arrays
+  const int num_nodes = order * order * order;
+  const int interp_size = (order + 1) * (order + 1) * (order + 1);
+  const int nenrich = getNum3dEnrich(order);
+  const int neq = 3 * num_nodes;
+  const int npts = num_quad_pts * num_quad_pts * num_quad_pts;
 
   // Get the local connectivity for the higher-order mesh
   const int *conn = NULL;
@@ -3376,157 +3797,139 @@ TacsScalar TMRStressConstraint::evalConstraint( TACSBVec *_uvec ){
   TMRPoint *X;
   interp_forest->getPoints(&X);
 
-  for ( int i = 0; i < nelems; i++ ){
-    // Get the element class and the variables associated with it
-    TACSElement *elem = tacs->getElement(i, Xpts, vars, dvars, ddvars);
+#ifdef TMR_HAS_OPENMP
+#pragma omp parallel
+#endif  // TMR_HAS_OPENMP
+  {
+    // Allocate space for the element reconstruction problem
+    TacsScalar *tmp = new TacsScalar[neq * (nenrich + vars_per_node)];
+    TacsScalar *vars = new TacsScalar[vars_per_node * num_nodes];
+    TacsScalar *varderiv = new TacsScalar[3 * vars_per_node * num_nodes];
+
+#ifdef TMR_HAS_OPENMP
+#pragma omp for schedule(dynamic, TMR_RECON_CHUNK_SIZE)
+#endif  // TMR_HAS_OPENMP
+    for (int i = 0; i < nelems; i++) {
+      // Get the node numbers for this element
+      int len;
+      const int *nodes;
+      tacs->getElement(i, &len, &nodes);
+
+      // Retrieve the nodal values and nodal derivatives
+      uvec->getValues(len, nodes, vars);
+      uderiv->getValues(len, nodes, varderiv);
+
+      // Now get the node locations for the locally refined mesh
+      TacsScalar *Xpts = &elem_Xpts[3 * interp_size * i];
+      for (int j = 0; j < interp_size; j++) {
+        int c = conn[interp_size * i + j];
+        int node = interp_forest->getLocalNodeNumber(c);
+        Xpts[3 * j] = X[node].x;
+        Xpts[3 * j + 1] = X[node].y;
+        Xpts[3 * j + 2] = X[node].z;
+      }
 
-    // Get the constitutive relationship
-    TACSConstitutive *con = elem->getConstitutive();
+      // Compute the values of the enrichment coefficient for each
+      // degree of freedom
+      TacsScalar *ubar = &elem_ubar[vars_per_node * nenrich * i];
+      computeElemRecon3D(vars_per_node, forest, interp_forest, Xpts, vars,
+                         varderiv, ubar, tmp);
 
-    // Get the node numbers and node locations for this element
-    int len;
-    const int *nodes;
-    tacs->getElement(i, &len, &nodes);
-    tacs->getElement(i, Xpts);
-
-    // Retrieve the nodal values and nodal derivatives
-    uvec->getValues(len, nodes, vars);
-    uderiv->getValues(len, nodes, varderiv);
-
-    // Now get the node locations for the locally refined mesh
-    const int interp_elem_size = (order+1)*(order+1)*(order+1);
-    for ( int j = 0; j < interp_elem_size; j++ ){
-      int c = conn[interp_elem_size*i + j];
-      int node = interp_forest->getLocalNodeNumber(c);
-      Xpts[3*j] = X[node].x;
-      Xpts[3*j+1] = X[node].y;
-      Xpts[3*j+2] = X[node].z;
-    }
+      // Evaluate and store the strain at each quadrature point
+      TacsScalar *data = &point_data[TMR_STRESS_POINT_SIZE * npts * i];
+      for (int p = 0; p < npts; p++, data += TMR_STRESS_POINT_SIZE) {
+        double pt[3];
+        getQuadraturePoint(p, pt);
+        TacsScalar detJ = evalStrain(pt, Xpts, vars, ubar, &data[0], &data[9]);
 
-    // Compute the values of the enrichment coefficient for each
-    // degree of freedom
-    computeElemRecon3D(vars_per_node, forest, interp_forest,
-                       Xpts, vars, varderiv, ubar, tmp);
-
-    // For each quadrature point, evaluate the strain at the
-    // quadrature point and evaluate the stress constraint
-    for ( int kk = 0; kk < num_quad_pts; kk++ ){
-      for ( int jj = 0; jj < num_quad_pts; jj++ ){
-        for ( int ii = 0; ii < num_quad_pts; ii++ ){
-          // Pick the quadrature point at which we will
-          // evaluate the strain
-          double pt[3];
-          pt[0] = gaussPts[ii];
-          pt[1] = gaussPts[jj];
-          pt[2] = gaussPts[kk];
+        // Evaluate the location of the point
+        double N[MAX_ORDER * MAX_ORDER * MAX_ORDER];
+        interp_forest->evalInterp(pt, N);
+        TacsScalar *Xpt = &data[15];
+        Xpt[0] = Xpt[1] = Xpt[2] = 0.0;
+        for (int k = 0; k < interp_size; k++) {
+          Xpt[0] += Xpts[3 * k] * N[k];
+          Xpt[1] += Xpts[3 * k + 1] * N[k];
+          Xpt[2] += Xpts[3 * k + 2] * N[k];
+        }
 
-          // Evaluate the strain
-          TacsScalar J[9], e[6];
-          evalStrain(pt, Xpts, vars, ubar, J, e);
+        data[18] = detJ * quad_wts[p % num_quad_pts] *
+                   quad_wts[(p / num_quad_pts) % num_quad_pts] *
+                   quad_wts[p / (num_quad_pts * num_quad_pts)];
+      }
+    }
 
-          // Evaluate the failure criteria
-          TacsScalar fval;
-          con->failure(pt, e, &fval);
+    delete[] tmp;
+    delete[] vars;
+    delete[] varderiv;
+  }
 
-          if (TacsRealPart(fval) >
-              TacsRealPart(ks_max_fail)){
-            ks_max_fail = fval;
-          }
-        }
+  // Evaluate the failure criterion at each quadrature point
+#ifdef TMR_HAS_OPENMP
+#pragma omp parallel if (TMRGetThreadSafeElements())
+#endif  // TMR_HAS_OPENMP
+  {
+#ifdef TMR_HAS_OPENMP
+#pragma omp for schedule(dynamic, TMR_RECON_CHUNK_SIZE)
+#endif  // TMR_HAS_OPENMP
+    for (int i = 0; i < nelems; i++) {
+      TacsScalar *data = &point_data[TMR_STRESS_POINT_SIZE * npts * i];
+      for (int p = 0; p < npts; p++, data += TMR_STRESS_POINT_SIZE) {
+        double pt[3];
+        getQuadraturePoint(p, pt);
+        data[19] = con->evalFailure(i, pt, &data[15], &data[9]);
       }
     }
   }
 
-  // Find the maximum failure value across all of the processors
-  MPI_Allreduce(MPI_IN_PLACE, &ks_max_fail, 1, TACS_MPI_TYPE, MPI_MAX, comm);
+  // Find the maximum failure value across all of the processors. The
+  // offset cancels in the KS function, so only the real part is used.
+  double max_fail = -1e20;
+  for (int i = 0; i < npts * nelems; i++) {
+    double fval = TacsRealPart(point_data[TMR_STRESS_POINT_SIZE * i + 19]);
+    if (fval > max_fail) {
+      max_fail = fval;
+    }
+  }
+  MPI_Allreduce(MPI_IN_PLACE, &max_fail, 1, MPI_DOUBLE, MPI_MAX, comm);
+  ks_max_fail = max_fail;
 
   // Compute the sum over all the element - integrate the sum over all
   // elements/procs
   ks_fail_sum = 0.0;
-
-  for ( int i = 0; i < nelems; i++ ){
-    // Get the element class and the variables associated with it
-    TACSElement *elem = tacs->getElement(i, Xpts, vars, dvars, ddvars);
-
-    // Get the constitutive relationship
-    TACSConstitutive *con = elem->getConstitutive();
-
-    // Get the node numbers and node locations for this element
-    int len;
-    const int *nodes;
-    tacs->getElement(i, &len, &nodes);
-    tacs->getElement(i, Xpts);
-
-    // Retrieve the nodal values and nodal derivatives
-    uvec->getValues(len, nodes, vars);
-    uderiv->getValues(len, nodes, varderiv);
-
-    // Now get the node locations for the locally refined mesh
-    const int interp_elem_size = (order+1)*(order+1)*(order+1);
-    for ( int j = 0; j < interp_elem_size; j++ ){
-      int c = conn[interp_elem_size*i + j];
-      int node = interp_forest->getLocalNodeNumber(c);
-      Xpts[3*j] = X[node].x;
-      Xpts[3*j+1] = X[node].y;
-      Xpts[3*j+2] = X[node].z;
-    }
-
-    // Compute the values of the enrichment coefficient for each
-    // degree of freedom
-    computeElemRecon3D(vars_per_node, forest, interp_forest,
-                       Xpts, vars, varderiv, ubar, tmp);
-
-    // For each quadrature point, evaluate the strain at the
-    // quadrature point and evaluate the stress constraint
-    for ( int kk = 0; kk < num_quad_pts; kk++ ){
-      for ( int jj = 0; jj < num_quad_pts; jj++ ){
-        for ( int ii = 0; ii < num_quad_pts; ii++ ){
-          // Pick the quadrature point at which we will
-          // evaluate the strain
-          double pt[3];
-          pt[0] = gaussPts[ii];
-          pt[1] = gaussPts[jj];
-          pt[2] = gaussPts[kk];
-
-          // Evaluate the strain
-          TacsScalar J[9], e[6];
-          TacsScalar detJ = evalStrain(pt, Xpts, vars, ubar, J, e);
-          detJ *= gaussWts[ii]*gaussWts[jj]*gaussWts[kk];
-
-          // Evaluate the failure criteria
-          TacsScalar fval;
-          con->failure(pt, e, &fval);
-
-          // Compute the sum of KS failure values
-          ks_fail_sum += detJ*exp(ks_weight*(fval - ks_max_fail));
-        }
-      }
-    }
+  for (int i = 0; i < npts * nelems; i++) {
+    const TacsScalar *data = &point_data[TMR_STRESS_POINT_SIZE * i];
+    ks_fail_sum += data[18] * exp(ks_weight * (data[19] - ks_max_fail));
   }
-
   MPI_Allreduce(MPI_IN_PLACE, &ks_fail_sum, 1, TACS_MPI_TYPE, MPI_SUM, comm);
 
-  TacsScalar ks_func_val = ks_max_fail + log(ks_fail_sum)/ks_weight;
-
-  int mpi_rank;
-  MPI_Comm_rank(comm, &mpi_rank);
-  if (mpi_rank == 0){
-    printf("KS stress value:  %25.10e\n", ks_func_val);
-    printf("Max stress value: %25.10e\n", ks_max_fail);
-  }
+  has_recon = 1;
 
-  return ks_func_val;
+  return ks_max_fail + log(ks_fail_sum) / ks_weight;
 }
-*/
 
 /*
   Evaluate the derivative w.r.t. state and design vectors
+
+  The derivatives are computed from the values stored by the last call
+  to evalConstraint(), so the reconstruction and the strains are not
+  evaluated again. The elements are processed in blocks. The calls to
+  the constitutive object for a block are only threaded when the
+  elements are flagged as thread-safe, while the derivatives of the
+  reconstruction are always computed in parallel. The contributions
+  are added to the vectors in element order.
 */
-/*
-void TMRStressConstraint::evalConDeriv( TacsScalar *dfdx, int size,
-                                        TACSBVec *dfdu ){
+void TMRStressConstraint::evalConDeriv(TACSBVec *dfdx, TACSBVec *dfdu) {
+  dfdx->zeroEntries();
+  dfdu->zeroEntries();
+  dfduderiv->zeroEntries();
 
-  memset(dfdx, 0, size*sizeof(TacsScalar));
+  if (!has_recon) {
+    fprintf(stderr,
+            "TMRStressConstraint: evalConstraint() must be called before "
+            "evalConDeriv()\n");
+    return;
+  }
 
   // Get information about the interpolation
   const double *knots;
@@ -3537,238 +3940,239 @@ void TMRStressConstraint::evalConDeriv( TacsScalar *dfdx, int size,
 
   // Get vars per node and compute other size variables
   const int vars_per_node = tacs->getVarsPerNode();
-  const int num_nodes = order*order*order;
-  const int neq = num_nodes*vars_per_node;
+  const int num_nodes = order * order * order;
+  const int neq = num_nodes * vars_per_node;
+  const int interp_size = (order + 1) * (order + 1) * (order + 1);
+  const int npts = num_quad_pts * num_quad_pts * num_quad_pts;
 
-  // Set the derivative of the function w.r.t. the state variables
-  dfdu->zeroEntries();
-  dfduderiv->zeroEntries();
+  // The number of design variable values for each element
+  const int dv_size = tacs->getDesignVarsPerNode() * max_dv_nodes;
 
   // Number of local elements
   const int nelems = tacs->getNumElements();
 
   // Set the weights
   double wvals[3];
-  if (order == 2){
+  if (order == 2) {
     wvals[0] = wvals[1] = 1.0;
-  }
-  else if (order == 3){
+  } else if (order == 3) {
     wvals[0] = wvals[2] = 0.5;
     wvals[1] = 1.0;
   }
 
-  // Get the quadrature points/weights
-  const double *gaussPts, *gaussWts;
-  int num_quad_pts =
-    FElibrary::getGaussPtsWts(order+1, &gaussPts, &gaussWts);
-  // int num_quad_pts =
-  //   FElibrary::getGaussPtsWts(LOBATTO_QUADRATURE, order+2,
-  //                             &gaussPts, &gaussWts);
-
-  // Get the local connectivity for the higher-order mesh
-  const int *conn = NULL;
-  interp_forest->getNodeConn(&conn);
-
-  // Get the higher-order points
-  TMRPoint *X;
-  interp_forest->getPoints(&X);
-
   // Set the matrix dimensions
-  int m = nenrich;
-  int n = neq;
-  int p = num_nodes; //num_quad_pts*num_quad_pts*num_quad_pts;
-
-  // Initialize variables
-  TacsScalar *dfdu_elem = new TacsScalar[3*p];
-  TacsScalar *dfdubar = new TacsScalar[3*m];
-  TacsScalar *dubardu = new TacsScalar[m*p];
-  TacsScalar *A = new TacsScalar[n*m];
-  TacsScalar *dbdu = new TacsScalar[n*p];
-  TacsScalar *dubar_duderiv = new TacsScalar[m*n];
-  TacsScalar *dfduderiv_elem = new TacsScalar[3*n];
-  TacsScalar *duderiv_du = new TacsScalar[3*n*3*p];
-
-  for ( int i = 0; i < nelems; i++ ){
-    // Get the element class and the variables associated with it
-    TACSElement *elem = tacs->getElement(i, Xpts, vars, dvars, ddvars);
-
-    // Get the constitutive relationship
-    TACSConstitutive *con = elem->getConstitutive();
-
-    // Get the node numbers and node locations for this element
-    int len;
-    const int *nodes;
-    tacs->getElement(i, &len, &nodes);
-
-    // Get the local weight used for computing uderiv
-    TacsScalar welem[order*order*order];
-    weights->getValues(len, nodes, welem);
-
-    // Retrieve the nodal values and nodal derivatives
-    uvec->getValues(len, nodes, vars);
-    uderiv->getValues(len, nodes, varderiv);
-
-    // Now get the node locations for the locally refined mesh
-    const int interp_elem_size = (order+1)*(order+1)*(order+1);
-    for ( int j = 0; j < interp_elem_size; j++ ){
-      int c = conn[interp_elem_size*i + j];
-      int node = interp_forest->getLocalNodeNumber(c);
-      Xpts[3*j] = X[node].x;
-      Xpts[3*j+1] = X[node].y;
-      Xpts[3*j+2] = X[node].z;
+  const int m = nenrich;
+  const int n = neq;
+  const int p = num_nodes;
+
+  // The element contributions for a block of elements
+  int *dv_len_block = new int[TMR_RECON_BLOCK_SIZE];
+  int *dv_nums_block = new int[TMR_RECON_BLOCK_SIZE * max_dv_nodes];
+  TacsScalar *dfdx_block = new TacsScalar[TMR_RECON_BLOCK_SIZE * dv_size];
+  TacsScalar *dfde_block = new TacsScalar[TMR_RECON_BLOCK_SIZE * 6 * npts];
+  TacsScalar *dfdu_block = new TacsScalar[TMR_RECON_BLOCK_SIZE * 3 * p];
+  TacsScalar *dfduderiv_block = new TacsScalar[TMR_RECON_BLOCK_SIZE * 3 * n];
+
+  for (int start = 0; start < nelems; start += TMR_RECON_BLOCK_SIZE) {
+    int end = start + TMR_RECON_BLOCK_SIZE;
+    if (end > nelems) {
+      end = nelems;
     }
 
-    // Compute the values of the enrichment coefficient for each
-    // degree of freedom
-    computeElemRecon3D(vars_per_node, forest, interp_forest,
-                       Xpts, vars, varderiv, ubar, tmp);
-
-    // Zero variables before elementwise operations begin
-    memset(dfdu_elem, 0, 3*p*sizeof(TacsScalar));
-    memset(dfdubar, 0, 3*m*sizeof(TacsScalar));
-    memset(dubardu, 0, m*p*sizeof(TacsScalar));
-    memset(A, 0, n*m*sizeof(TacsScalar));
-    memset(dbdu, 0, n*p*sizeof(TacsScalar));
-    memset(dubar_duderiv, 0, m*n*sizeof(TacsScalar));
-    memset(duderiv_du, 0, 3*n*3*p*sizeof(TacsScalar));
-
-    // Compute the partial derivatives (df/du) and (df/dubar)
-    for ( int c = 0, kk = 0; kk < num_quad_pts; kk++ ){
-      for ( int jj = 0; jj < num_quad_pts; jj++ ){
-        for ( int ii = 0; ii < num_quad_pts; ii++, c += 3 ){
-          // Pick the quadrature point at which we will
-          // evaluate the strain
+    // Add the derivative w.r.t. the design variables and compute the
+    // derivative w.r.t. the strain at each quadrature point
+#ifdef TMR_HAS_OPENMP
+#pragma omp parallel if (TMRGetThreadSafeElements())
+#endif  // TMR_HAS_OPENMP
+    {
+#ifdef TMR_HAS_OPENMP
+#pragma omp for schedule(dynamic, TMR_RECON_CHUNK_SIZE)
+#endif  // TMR_HAS_OPENMP
+      for (int i = start; i < end; i++) {
+        int *dv_nums = &dv_nums_block[max_dv_nodes * (i - start)];
+        dv_len_block[i - start] =
+            con->getDesignVarNums(i, max_dv_nodes, dv_nums);
+
+        TacsScalar *dfdx_elem = &dfdx_block[dv_size * (i - start)];
+        memset(dfdx_elem, 0, dv_size * sizeof(TacsScalar));
+
+        const TacsScalar *data = &point_data[TMR_STRESS_POINT_SIZE * npts * i];
+        TacsScalar *dfde = &dfde_block[6 * npts * (i - start)];
+        for (int k = 0; k < npts; k++, data += TMR_STRESS_POINT_SIZE) {
           double pt[3];
-          pt[0] = gaussPts[ii];
-          pt[1] = gaussPts[jj];
-          pt[2] = gaussPts[kk];
-
-          // Evaluate the strain
-          TacsScalar J[9], e[6];
-          TacsScalar detJ = evalStrain(pt, Xpts, vars, ubar, J, e);
-          detJ *= gaussWts[ii]*gaussWts[jj]*gaussWts[kk];
-
-          // Evaluate the failure criteria
-          TacsScalar fval;
-          con->failure(pt, e, &fval);
+          getQuadraturePoint(k, pt);
 
           // Compute the weight at this point
-          TacsScalar kw = detJ*exp(ks_weight*(fval - ks_max_fail))/ks_fail_sum;
+          TacsScalar kw = data[18] *
+                          exp(ks_weight * (data[19] - ks_max_fail)) /
+                          ks_fail_sum;
 
           // Add the derivative w.r.t. the design variables
-          con->addFailureDVSens(pt, e, kw, dfdx, size);
+          con->addFailureDVSens(i, kw, pt, &data[15], &data[9], dv_size,
+                                dfdx_elem);
 
-          // Add the derivative w.r.t. the strain
-          TacsScalar dfde[6];
-          con->failureStrainSens(pt, e, dfde);
-
-          // Add the derivative of the strain
-          addStrainDeriv(pt, J, kw, dfde, dfdu_elem, dfdubar);
+          // Evaluate the weighted derivative w.r.t. the strain
+          con->evalFailureStrainSens(i, pt, &data[15], &data[9], &dfde[6 * k]);
+          for (int j = 0; j < 6; j++) {
+            dfde[6 * k + j] *= kw;
+          }
         }
       }
     }
 
-    // Add the partial dertiv df/du term to the total deriv
-    dfdu->setValues(len, nodes, dfdu_elem, TACS_ADD_VALUES);
-
-    //
-    // Compute A and (db/du)
-    //
-    for ( int c = 0, kk = 0; kk < order; kk++ ){
-      for ( int jj = 0; jj < order; jj++ ){
-        for ( int ii = 0; ii < order; ii++, c += 3 ){
-          // Evaluate the knot locations
-          double kt[3];
-          kt[0] = knots[ii];
-          kt[1] = knots[jj];
-          kt[2] = knots[kk];
-
-          // Compute the element shape functions at this point
-          double N[MAX_ORDER*MAX_ORDER*MAX_ORDER];
-          double Na[MAX_ORDER*MAX_ORDER*MAX_ORDER];
-          double Nb[MAX_ORDER*MAX_ORDER*MAX_ORDER];
-          double Nc[MAX_ORDER*MAX_ORDER*MAX_ORDER];
-          interp_forest->evalInterp(kt, N, Na, Nb, Nc);
-
-          // Evaluate the Jacobian transformation at this point
-          TacsScalar Xd[9], J[9];
-          computeJacobianTrans3D(Xpts, Na, Nb, Nc, Xd, J,
-                                 (order+1)*(order+1)*(order+1));
+    // Compute the derivatives through the reconstruction
+#ifdef TMR_HAS_OPENMP
+#pragma omp parallel
+#endif  // TMR_HAS_OPENMP
+    {
+      TacsScalar *dfdubar = new TacsScalar[3 * m];
+      TacsScalar *dubardu = new TacsScalar[m * p];
+      TacsScalar *A = new TacsScalar[n * m];
+      TacsScalar *dbdu = new TacsScalar[n * p];
+      TacsScalar *dubar_duderiv = new TacsScalar[m * n];
+
+#ifdef TMR_HAS_OPENMP
+#pragma omp for schedule(dynamic)
+#endif  // TMR_HAS_OPENMP
+      for (int i = start; i < end; i++) {
+        const TacsScalar *Xpts = &elem_Xpts[3 * interp_size * i];
+        TacsScalar *dfdu_elem = &dfdu_block[3 * p * (i - start)];
+        TacsScalar *dfduderiv_elem = &dfduderiv_block[3 * n * (i - start)];
+
+        // Compute the partial derivatives (df/du) and (df/dubar)
+        memset(dfdu_elem, 0, 3 * p * sizeof(TacsScalar));
+        memset(dfdubar, 0, 3 * m * sizeof(TacsScalar));
+        const TacsScalar *data = &point_data[TMR_STRESS_POINT_SIZE * npts * i];
+        const TacsScalar *dfde = &dfde_block[6 * npts * (i - start)];
+        for (int k = 0; k < npts; k++, data += TMR_STRESS_POINT_SIZE) {
+          double pt[3];
+          getQuadraturePoint(k, pt);
+          addStrainDeriv(pt, &data[0], 1.0, &dfde[6 * k], dfdu_elem, dfdubar);
+        }
 
-          // Evaluate the enrichment shape functions
-          double Nr[MAX_3D_ENRICH];
-          double Nar[MAX_3D_ENRICH], Nbr[MAX_3D_ENRICH], Ncr[MAX_3D_ENRICH];
-          if (order == 2){
-            eval2ndEnrichmentFuncs3D(kt, Nr, Nar, Nbr, Ncr);
-          }
-          else if (order == 3){
-            eval3rdEnrichmentFuncs3D(kt, Nr, Nar, Nbr, Ncr);
-          }
+        // Compute A and (db/du) for the reconstruction, along with the
+        // weight on each equation
+        double weq[MAX_ORDER * MAX_ORDER * MAX_ORDER];
+        for (int c = 0, kk = 0; kk < order; kk++) {
+          for (int jj = 0; jj < order; jj++) {
+            for (int ii = 0; ii < order; ii++, c += 3) {
+              // Evaluate the knot locations
+              double kt[3];
+              kt[0] = knots[ii];
+              kt[1] = knots[jj];
+              kt[2] = knots[kk];
+              const double w = wvals[ii] * wvals[jj] * wvals[kk];
+              weq[c / 3] = w;
+
+              // Compute the element shape functions at this point
+              double N[MAX_ORDER * MAX_ORDER * MAX_ORDER];
+              double Na[MAX_ORDER * MAX_ORDER * MAX_ORDER];
+              double Nb[MAX_ORDER * MAX_ORDER * MAX_ORDER];
+              double Nc[MAX_ORDER * MAX_ORDER * MAX_ORDER];
+              interp_forest->evalInterp(kt, N, Na, Nb, Nc);
+
+              // Evaluate the Jacobian transformation at this point
+              TacsScalar Xd[9], J[9];
+              computeJacobianTrans3D(Xpts, Na, Nb, Nc, Xd, J, interp_size);
+
+              // Evaluate the enrichment shape functions
+              double Nr[MAX_3D_ENRICH];
+              double Nar[MAX_3D_ENRICH], Nbr[MAX_3D_ENRICH];
+              double Ncr[MAX_3D_ENRICH];
+              if (order == 2) {
+                eval2ndEnrichmentFuncs3D(kt, Nr, Nar, Nbr, Ncr);
+              } else if (order == 3) {
+                eval3rdEnrichmentFuncs3D(kt, Nr, Nar, Nbr, Ncr);
+              }
 
-          // Evaluate the shape functions and their derivatives
-          forest->evalInterp(kt, N, Na, Nb, Nc);
+              // Evaluate the shape functions and their derivatives
+              forest->evalInterp(kt, N, Na, Nb, Nc);
 
-          for ( int aa = 0; aa < num_nodes; aa++ ){
-            // Compute and assemble (db/du)
-            TacsScalar d[3];
-            d[0] = Na[aa]*J[0] + Nb[aa]*J[1] + Nc[aa]*J[2];
-            d[1] = Na[aa]*J[3] + Nb[aa]*J[4] + Nc[aa]*J[5];
-            d[2] = Na[aa]*J[6] + Nb[aa]*J[7] + Nc[aa]*J[8];
+              for (int aa = 0; aa < num_nodes; aa++) {
+                // Compute and assemble (db/du)
+                TacsScalar d[3];
+                d[0] = Na[aa] * J[0] + Nb[aa] * J[1] + Nc[aa] * J[2];
+                d[1] = Na[aa] * J[3] + Nb[aa] * J[4] + Nc[aa] * J[5];
+                d[2] = Na[aa] * J[6] + Nb[aa] * J[7] + Nc[aa] * J[8];
 
-            dbdu[neq*aa+c] = -wvals[ii]*wvals[jj]*wvals[kk]*d[0];
-            dbdu[neq*aa+c+1] = -wvals[ii]*wvals[jj]*wvals[kk]*d[1];
-            dbdu[neq*aa+c+2] = -wvals[ii]*wvals[jj]*wvals[kk]*d[2];
-          }
+                dbdu[neq * aa + c] = -w * d[0];
+                dbdu[neq * aa + c + 1] = -w * d[1];
+                dbdu[neq * aa + c + 2] = -w * d[2];
+              }
 
-          for ( int aa = 0; aa < nenrich; aa++ ){
-            // Compute and assemble A
-            TacsScalar dr[3];
-            dr[0] = Nar[aa]*J[0] + Nbr[aa]*J[1] + Ncr[aa]*J[2];
-            dr[1] = Nar[aa]*J[3] + Nbr[aa]*J[4] + Ncr[aa]*J[5];
-            dr[2] = Nar[aa]*J[6] + Nbr[aa]*J[7] + Ncr[aa]*J[8];
+              for (int aa = 0; aa < nenrich; aa++) {
+                // Compute and assemble A
+                TacsScalar dr[3];
+                dr[0] = Nar[aa] * J[0] + Nbr[aa] * J[1] + Ncr[aa] * J[2];
+                dr[1] = Nar[aa] * J[3] + Nbr[aa] * J[4] + Ncr[aa] * J[5];
+                dr[2] = Nar[aa] * J[6] + Nbr[aa] * J[7] + Ncr[aa] * J[8];
 
-            A[neq*aa+c] = wvals[ii]*wvals[jj]*wvals[kk]*dr[0];
-            A[neq*aa+c+1] = wvals[ii]*wvals[jj]*wvals[kk]*dr[1];
-            A[neq*aa+c+2] = wvals[ii]*wvals[jj]*wvals[kk]*dr[2];
+                A[neq * aa + c] = w * dr[0];
+                A[neq * aa + c + 1] = w * dr[1];
+                A[neq * aa + c + 2] = w * dr[2];
+              }
+            }
           }
         }
-      }
-    }
 
-    // Compute dubar/du and dubar/duderiv
-    addEnrichDeriv(A, dbdu, dubardu, dubar_duderiv);
+        // Compute dubar/du and dubar/db
+        addEnrichDeriv(A, dbdu, dubardu, dubar_duderiv);
 
-    // Compute the product (df/dubar)(dubar/du)
-    memset(dfdu_elem, 0, 3*p*sizeof(TacsScalar));
-
-    for ( int ii = 0; ii < m; ii++ ){
-      for ( int jj = 0; jj < p; jj++ ){
-        for ( int c = 0; c < 3; c++ ){
-          dfdu_elem[3*jj+c] += dfdubar[3*ii+c]*dubardu[m*jj+ii];
+        // Add the product (df/dubar)(dubar/du)
+        for (int ii = 0; ii < m; ii++) {
+          for (int jj = 0; jj < p; jj++) {
+            for (int c = 0; c < 3; c++) {
+              dfdu_elem[3 * jj + c] +=
+                  dfdubar[3 * ii + c] * dubardu[m * jj + ii];
+            }
+          }
         }
-      }
-    }
-
-    // Add the product (df/dubar)(dubar/du) to the total deriv
-    dfdu->setValues(len, nodes, dfdu_elem, TACS_ADD_VALUES);
 
-    // Compute the product (df/duderiv) = (df/dubar)(dubar/duderiv)
-    memset(dfduderiv_elem, 0, 3*n*sizeof(TacsScalar));
-    for ( int ii = 0; ii < n; ii++ ){
-      for ( int jj = 0; jj < m; jj++ ){
-        for ( int c = 0; c < 3; c++ ){
-          dfduderiv_elem[9*(ii/3) + 3*c + (ii % 3)] +=
-            dfdubar[3*jj+c]*dubar_duderiv[m*ii+jj];
+        // Compute the product (df/duderiv) = (df/dubar)(dubar/duderiv).
+        // The right-hand-side of the reconstruction is the weighted
+        // derivative at each node.
+        memset(dfduderiv_elem, 0, 3 * n * sizeof(TacsScalar));
+        for (int ii = 0; ii < n; ii++) {
+          for (int jj = 0; jj < m; jj++) {
+            for (int c = 0; c < 3; c++) {
+              dfduderiv_elem[9 * (ii / 3) + 3 * c + (ii % 3)] +=
+                  weq[ii / 3] * dfdubar[3 * jj + c] *
+                  dubar_duderiv[m * ii + jj];
+            }
+          }
         }
       }
+
+      delete[] dfdubar;
+      delete[] dubardu;
+      delete[] A;
+      delete[] dbdu;
+      delete[] dubar_duderiv;
     }
 
-    // Add the contributions to the derivative of the function
-    // w.r.t. the derivatives at the nodes
-    dfduderiv->setValues(len, nodes, dfduderiv_elem, TACS_ADD_VALUES);
+    // Add the contributions to the vectors in element order
+    for (int i = start; i < end; i++) {
+      int len;
+      const int *nodes;
+      tacs->getElement(i, &len, &nodes);
+      dfdx->setValues(dv_len_block[i - start],
+                      &dv_nums_block[max_dv_nodes * (i - start)],
+                      &dfdx_block[dv_size * (i - start)], TACS_ADD_VALUES);
+      dfdu->setValues(len, nodes, &dfdu_block[3 * p * (i - start)],
+                      TACS_ADD_VALUES);
+      dfduderiv->setValues(len, nodes, &dfduderiv_block[3 * n * (i - start)],
+                           TACS_ADD_VALUES);
+    }
   }
 
+  delete[] dv_len_block;
+  delete[] dv_nums_block;
+  delete[] dfdx_block;
+  delete[] dfde_block;
+
   // Add the values across all processors
+  dfdx->beginSetValues(TACS_ADD_VALUES);
+  dfdx->endSetValues(TACS_ADD_VALUES);
   dfduderiv->beginSetValues(TACS_ADD_VALUES);
   dfduderiv->endSetValues(TACS_ADD_VALUES);
 
@@ -3776,132 +4180,135 @@ void TMRStressConstraint::evalConDeriv( TacsScalar *dfdx, int size,
   dfduderiv->beginDistributeValues();
   dfduderiv->endDistributeValues();
 
-  //
-  // Compute the product of (df/duderiv)(duderiv/du)
-  //
-
-  // Allocate a temporary array to store a component of the derivative
-  TacsScalar *dUd = new TacsScalar[ 3*vars_per_node ];
-
-  // Perform the reconstruction for the local
-  for ( int elem = 0; elem < nelems; elem++ ){
-    // Get the element nodes
-    int len = 0;
-    const int *nodes = NULL;
-    tacs->getElement(elem, &len, &nodes);
-
-    // Get the local weight values for this element
-    TacsScalar welem[MAX_ORDER*MAX_ORDER*MAX_ORDER];
-    weights->getValues(len, nodes, welem);
-
-    // Get the values of the derivatives
-    dfduderiv->getValues(len, nodes, dfduderiv_elem);
-
-    // Now get the node locations for the locally refined mesh
-    const int interp_elem_size = (order+1)*(order+1)*(order+1);
-    for ( int j = 0; j < interp_elem_size; j++ ){
-      int c = conn[interp_elem_size*elem + j];
-      int node = interp_forest->getLocalNodeNumber(c);
-      Xpts[3*j] = X[node].x;
-      Xpts[3*j+1] = X[node].y;
-      Xpts[3*j+2] = X[node].z;
+  // Compute the product of (df/duderiv)(duderiv/du). This is the
+  // transpose of the computation in computeNodeDeriv3D().
+  for (int start = 0; start < nelems; start += TMR_RECON_BLOCK_SIZE) {
+    int end = start + TMR_RECON_BLOCK_SIZE;
+    if (end > nelems) {
+      end = nelems;
     }
 
-    // Set the pointer for the derivatives of the components of the
-    // variables along each of the 3-coordinate directions
-    const TacsScalar *d = dfduderiv_elem;
-
-    // Zero the element derivative
-    memset(dfdu_elem, 0, 3*p*sizeof(TacsScalar));
-
-    // Compute the contributions to the derivative from this side of
-    // the element
-    for ( int kk = 0; kk < order; kk++ ){
-      for ( int jj = 0; jj < order; jj++ ){
-        for ( int ii = 0; ii < order; ii++ ){
-          double pt[3];
-          pt[0] = knots[ii];
-          pt[1] = knots[jj];
-          pt[2] = knots[kk];
-
-          // Evaluate the the shape functions
-          double N[MAX_ORDER*MAX_ORDER*MAX_ORDER];
-          double Na[MAX_ORDER*MAX_ORDER*MAX_ORDER];
-          double Nb[MAX_ORDER*MAX_ORDER*MAX_ORDER];
-          double Nc[MAX_ORDER*MAX_ORDER*MAX_ORDER];
-          interp_forest->evalInterp(pt, N, Na, Nb, Nc);
-
-          // Evaluate the Jacobian transformation at this point
-          TacsScalar Xd[9], J[9];
-          computeJacobianTrans3D(Xpts, Na, Nb, Nc, Xd, J,
-                                 (order+1)*(order+1)*(order+1));
-
-          // Evaluate the interpolation
-          forest->evalInterp(pt, N, Na, Nb, Nc);
-
-          // Accumulate the derivatives w.r.t. x/y/z for each value at
-          // the independent nodes
-          TacsScalar winv = 1.0/welem[ii + jj*order + kk*order*order];
-          if (nodes[ii + jj*order + kk*order*order] >= 0){
-            for ( int k = 0; k < vars_per_node; k++ ){
-              dUd[3*k]   = winv*(J[0]*d[0] + J[3]*d[1] + J[6]*d[2]);
-              dUd[3*k+1] = winv*(J[1]*d[0] + J[4]*d[1] + J[7]*d[2]);
-              dUd[3*k+2] = winv*(J[2]*d[0] + J[5]*d[1] + J[8]*d[2]);
-              d += 3;
-            }
-
-            // Compute the derivatives from the interpolated solution
-            for ( int k = 0; k < vars_per_node; k++ ){
-              TacsScalar *ue = &dfdu_elem[k];
-              for ( int i = 0; i < order*order*order; i++ ){
-                ue[0] += (Na[i]*dUd[3*k] + Nb[i]*dUd[3*k+1] + Nc[i]*dUd[3*k+2]);
-                ue += vars_per_node;
+#ifdef TMR_HAS_OPENMP
+#pragma omp parallel
+#endif  // TMR_HAS_OPENMP
+    {
+      TacsScalar *dUd = new TacsScalar[3 * vars_per_node];
+      TacsScalar *dfduderiv_elem = new TacsScalar[3 * n];
+
+#ifdef TMR_HAS_OPENMP
+#pragma omp for schedule(dynamic, TMR_RECON_CHUNK_SIZE)
+#endif  // TMR_HAS_OPENMP
+      for (int elem = start; elem < end; elem++) {
+        // Get the element nodes
+        int len = 0;
+        const int *nodes = NULL;
+        tacs->getElement(elem, &len, &nodes);
+
+        // Get the local weight values for this element
+        TacsScalar welem[MAX_ORDER * MAX_ORDER * MAX_ORDER];
+        weights->getValues(len, nodes, welem);
+
+        // Get the values of the derivatives
+        dfduderiv->getValues(len, nodes, dfduderiv_elem);
+
+        // Get the node locations for the element
+        TacsScalar Xpts[3 * MAX_ORDER * MAX_ORDER * MAX_ORDER];
+        tacs->getElement(elem, Xpts);
+
+        // Set the pointer for the derivatives of the components of the
+        // variables along each of the 3-coordinate directions
+        const TacsScalar *d = dfduderiv_elem;
+
+        // Zero the element derivative
+        TacsScalar *dfdu_elem = &dfdu_block[3 * p * (elem - start)];
+        memset(dfdu_elem, 0, 3 * p * sizeof(TacsScalar));
+
+        for (int kk = 0; kk < order; kk++) {
+          for (int jj = 0; jj < order; jj++) {
+            for (int ii = 0; ii < order; ii++) {
+              double pt[3];
+              pt[0] = knots[ii];
+              pt[1] = knots[jj];
+              pt[2] = knots[kk];
+
+              // Evaluate the the shape functions
+              double N[MAX_ORDER * MAX_ORDER * MAX_ORDER];
+              double Na[MAX_ORDER * MAX_ORDER * MAX_ORDER];
+              double Nb[MAX_ORDER * MAX_ORDER * MAX_ORDER];
+              double Nc[MAX_ORDER * MAX_ORDER * MAX_ORDER];
+              forest->evalInterp(pt, N, Na, Nb, Nc);
+
+              // Evaluate the Jacobian transformation at this point
+              TacsScalar Xd[9], J[9];
+              computeJacobianTrans3D(Xpts, Na, Nb, Nc, Xd, J, num_nodes);
+
+              // Accumulate the derivatives w.r.t. x/y/z for each value
+              // at the independent nodes
+              const int node = ii + jj * order + kk * order * order;
+              if (nodes[node] >= 0) {
+                TacsScalar winv = 1.0 / welem[node];
+                for (int k = 0; k < vars_per_node; k++) {
+                  dUd[3 * k] = winv * (J[0] * d[0] + J[3] * d[1] + J[6] * d[2]);
+                  dUd[3 * k + 1] =
+                      winv * (J[1] * d[0] + J[4] * d[1] + J[7] * d[2]);
+                  dUd[3 * k + 2] =
+                      winv * (J[2] * d[0] + J[5] * d[1] + J[8] * d[2]);
+                  d += 3;
+                }
+
+                // Compute the derivatives from the interpolated solution
+                for (int k = 0; k < vars_per_node; k++) {
+                  TacsScalar *ue = &dfdu_elem[k];
+                  for (int i = 0; i < num_nodes; i++) {
+                    ue[0] += (Na[i] * dUd[3 * k] + Nb[i] * dUd[3 * k + 1] +
+                              Nc[i] * dUd[3 * k + 2]);
+                    ue += vars_per_node;
+                  }
+                }
+              } else {
+                d += 3 * vars_per_node;
               }
             }
           }
-          else {
-            d += 3*vars_per_node;
-          }
         }
       }
+
+      delete[] dUd;
+      delete[] dfduderiv_elem;
     }
 
-    // Get the local element variables
-    dfdu->setValues(len, nodes, dfdu_elem, TACS_ADD_VALUES);
+    // Add the contributions to the elements in order
+    for (int elem = start; elem < end; elem++) {
+      int len;
+      const int *nodes;
+      tacs->getElement(elem, &len, &nodes);
+      dfdu->setValues(len, nodes, &dfdu_block[3 * p * (elem - start)],
+                      TACS_ADD_VALUES);
+    }
   }
 
+  delete[] dfdu_block;
+  delete[] dfduderiv_block;
+
   dfdu->beginSetValues(TACS_ADD_VALUES);
   dfdu->endSetValues(TACS_ADD_VALUES);
 
   tacs->applyBCs(dfdu);
-
-  // Free allocated memory
-  delete [] dfdu_elem;
-  delete [] dfdubar;
-  delete [] dubardu;
-  delete [] A;
-  delete [] dbdu;
-  delete [] dubar_duderiv;
-  delete [] duderiv_du;
-  delete [] dUd;
 }
-*/
 
 /*
   Evaluate the strain
 */
-/*
-TacsScalar TMRStressConstraint::evalStrain( const double pt[],
-                                            const TacsScalar *Xpts,
-                                            const TacsScalar *vars,
-                                            const TacsScalar *ubar,
-                                            TacsScalar J[],
-                                            TacsScalar e[] ){
+TacsScalar TMRStressConstraint::evalStrain(const double pt[],
+                                           const TacsScalar *Xpts,
+                                           const TacsScalar *vars,
+                                           const TacsScalar *ubar,
+                                           TacsScalar J[], TacsScalar e[]) {
   // Evaluate the product of the adjoint
-  double N[MAX_ORDER*MAX_ORDER*MAX_ORDER];
-  double Na[MAX_ORDER*MAX_ORDER*MAX_ORDER];
-  double Nb[MAX_ORDER*MAX_ORDER*MAX_ORDER];
-  double Nc[MAX_ORDER*MAX_ORDER*MAX_ORDER];
+  double N[MAX_ORDER * MAX_ORDER * MAX_ORDER];
+  double Na[MAX_ORDER * MAX_ORDER * MAX_ORDER];
+  double Nb[MAX_ORDER * MAX_ORDER * MAX_ORDER];
+  double Nc[MAX_ORDER * MAX_ORDER * MAX_ORDER];
 
   // Evaluate the basis functions on the original mesh
   forest->evalInterp(pt, N, Na, Nb, Nc);
@@ -3909,26 +4316,25 @@ TacsScalar TMRStressConstraint::evalStrain( const double pt[],
   // First evaluate the contributions to the derivatives from
   // the regular element interpolation
   TacsScalar Ud[9], Xd[9];
-  memset(Ud, 0, 9*sizeof(TacsScalar));
-  memset(Xd, 0, 9*sizeof(TacsScalar));
+  memset(Ud, 0, 9 * sizeof(TacsScalar));
+  memset(Xd, 0, 9 * sizeof(TacsScalar));
 
   // Evaluate the derivative
   const TacsScalar *u = vars;
-  const double *na = Na, *nb = Nb, *nc = Nc;
-  const int ulen = order*order*order;
-  for ( int i = 0; i < ulen; i++ ){
+  const int ulen = order * order * order;
+  for (int i = 0; i < ulen; i++) {
     // Compute the displacement gradient
-    Ud[0] += Na[i]*u[0];
-    Ud[1] += Nb[i]*u[0];
-    Ud[2] += Nc[i]*u[0];
+    Ud[0] += Na[i] * u[0];
+    Ud[1] += Nb[i] * u[0];
+    Ud[2] += Nc[i] * u[0];
 
-    Ud[3] += Na[i]*u[1];
-    Ud[4] += Nb[i]*u[1];
-    Ud[5] += Nc[i]*u[1];
+    Ud[3] += Na[i] * u[1];
+    Ud[4] += Nb[i] * u[1];
+    Ud[5] += Nc[i] * u[1];
 
-    Ud[6] += Na[i]*u[2];
-    Ud[7] += Nb[i]*u[2];
-    Ud[8] += Nc[i]*u[2];
+    Ud[6] += Na[i] * u[2];
+    Ud[7] += Nb[i] * u[2];
+    Ud[8] += Nc[i] * u[2];
     u += 3;
   }
 
@@ -3937,21 +4343,20 @@ TacsScalar TMRStressConstraint::evalStrain( const double pt[],
   interp_forest->evalInterp(pt, N, Na, Nb, Nc);
 
   const TacsScalar *x = Xpts;
-  na = Na;  nb = Nb;  nc = Nc;
-  const int xlen = (order+1)*(order+1)*(order+1);
-  for ( int i = 0; i < xlen; i++ ){
+  const int xlen = (order + 1) * (order + 1) * (order + 1);
+  for (int i = 0; i < xlen; i++) {
     // Compute the inverse of the Jacobian transformation
-    Xd[0] += Na[i]*x[0];
-    Xd[1] += Nb[i]*x[0];
-    Xd[2] += Nc[i]*x[0];
+    Xd[0] += Na[i] * x[0];
+    Xd[1] += Nb[i] * x[0];
+    Xd[2] += Nc[i] * x[0];
 
-    Xd[3] += Na[i]*x[1];
-    Xd[4] += Nb[i]*x[1];
-    Xd[5] += Nc[i]*x[1];
+    Xd[3] += Na[i] * x[1];
+    Xd[4] += Nb[i] * x[1];
+    Xd[5] += Nc[i] * x[1];
 
-    Xd[6] += Na[i]*x[2];
-    Xd[7] += Nb[i]*x[2];
-    Xd[8] += Nc[i]*x[2];
+    Xd[6] += Na[i] * x[2];
+    Xd[7] += Nb[i] * x[2];
+    Xd[8] += Nc[i] * x[2];
     x += 3;
   }
 
@@ -3962,10 +4367,9 @@ TacsScalar TMRStressConstraint::evalStrain( const double pt[],
   // Evaluate the contribution from the enrichment functions
   double Nr[MAX_3D_ENRICH];
   double Nar[MAX_3D_ENRICH], Nbr[MAX_3D_ENRICH], Ncr[MAX_3D_ENRICH];
-  if (order == 2){
+  if (order == 2) {
     eval2ndEnrichmentFuncs3D(pt, Nr, Nar, Nbr, Ncr);
-  }
-  else if (order == 3){
+  } else if (order == 3) {
     eval3rdEnrichmentFuncs3D(pt, Nr, Nar, Nbr, Ncr);
   }
 
@@ -3974,36 +4378,34 @@ TacsScalar TMRStressConstraint::evalStrain( const double pt[],
 
   // Add the contributions from the enrichment functions
   u = ubar;
-  na = Nar; nb = Nbr; nc = Ncr;
-  for ( int i = 0; i < nenrich; i++ ){
-    Ud[0] += ubar[0]*na[i];
-    Ud[1] += ubar[0]*nb[i];
-    Ud[2] += ubar[0]*nc[i];
-
-    Ud[3] += ubar[1]*na[i];
-    Ud[4] += ubar[1]*nb[i];
-    Ud[5] += ubar[1]*nc[i];
+  for (int i = 0; i < nenrich; i++) {
+    Ud[0] += u[0] * Nar[i];
+    Ud[1] += u[0] * Nbr[i];
+    Ud[2] += u[0] * Ncr[i];
 
-    Ud[6] += ubar[2]*na[i];
-    Ud[7] += ubar[2]*nb[i];
-    Ud[8] += ubar[2]*nc[i];
+    Ud[3] += u[1] * Nar[i];
+    Ud[4] += u[1] * Nbr[i];
+    Ud[5] += u[1] * Ncr[i];
 
-    ubar += 3;
+    Ud[6] += u[2] * Nar[i];
+    Ud[7] += u[2] * Nbr[i];
+    Ud[8] += u[2] * Ncr[i];
+    u += 3;
   }
 
   // Compute the displacement gradient
   TacsScalar Ux[9];
-  Ux[0] = Ud[0]*J[0] + Ud[1]*J[3] + Ud[2]*J[6];
-  Ux[3] = Ud[3]*J[0] + Ud[4]*J[3] + Ud[5]*J[6];
-  Ux[6] = Ud[6]*J[0] + Ud[7]*J[3] + Ud[8]*J[6];
+  Ux[0] = Ud[0] * J[0] + Ud[1] * J[3] + Ud[2] * J[6];
+  Ux[3] = Ud[3] * J[0] + Ud[4] * J[3] + Ud[5] * J[6];
+  Ux[6] = Ud[6] * J[0] + Ud[7] * J[3] + Ud[8] * J[6];
 
-  Ux[1] = Ud[0]*J[1] + Ud[1]*J[4] + Ud[2]*J[7];
-  Ux[4] = Ud[3]*J[1] + Ud[4]*J[4] + Ud[5]*J[7];
-  Ux[7] = Ud[6]*J[1] + Ud[7]*J[4] + Ud[8]*J[7];
+  Ux[1] = Ud[0] * J[1] + Ud[1] * J[4] + Ud[2] * J[7];
+  Ux[4] = Ud[3] * J[1] + Ud[4] * J[4] + Ud[5] * J[7];
+  Ux[7] = Ud[6] * J[1] + Ud[7] * J[4] + Ud[8] * J[7];
 
-  Ux[2] = Ud[0]*J[2] + Ud[1]*J[5] + Ud[2]*J[8];
-  Ux[5] = Ud[3]*J[2] + Ud[4]*J[5] + Ud[5]*J[8];
-  Ux[8] = Ud[6]*J[2] + Ud[7]*J[5] + Ud[8]*J[8];
+  Ux[2] = Ud[0] * J[2] + Ud[1] * J[5] + Ud[2] * J[8];
+  Ux[5] = Ud[3] * J[2] + Ud[4] * J[5] + Ud[5] * J[8];
+  Ux[8] = Ud[6] * J[2] + Ud[7] * J[5] + Ud[8] * J[8];
 
   // Compute the strain
   e[0] = Ux[0];
@@ -4016,31 +4418,29 @@ TacsScalar TMRStressConstraint::evalStrain( const double pt[],
 
   return detJ;
 }
-*/
+
 /*
   Add the element contribution to the strain derivative
 */
-/*
-TacsScalar TMRStressConstraint::addStrainDeriv( const double pt[],
-                                                const TacsScalar J[],
-                                                const TacsScalar alpha,
-                                                const TacsScalar dfde[],
-                                                TacsScalar dfdu[],
-                                                TacsScalar dfdubar[] ){
+void TMRStressConstraint::addStrainDeriv(const double pt[],
+                                         const TacsScalar J[],
+                                         const TacsScalar alpha,
+                                         const TacsScalar dfde[],
+                                         TacsScalar dfdu[],
+                                         TacsScalar dfdubar[]) {
   // Evaluate the product of the adjoint
-  double N[MAX_ORDER*MAX_ORDER*MAX_ORDER];
-  double Na[MAX_ORDER*MAX_ORDER*MAX_ORDER];
-  double Nb[MAX_ORDER*MAX_ORDER*MAX_ORDER];
-  double Nc[MAX_ORDER*MAX_ORDER*MAX_ORDER];
+  double N[MAX_ORDER * MAX_ORDER * MAX_ORDER];
+  double Na[MAX_ORDER * MAX_ORDER * MAX_ORDER];
+  double Nb[MAX_ORDER * MAX_ORDER * MAX_ORDER];
+  double Nc[MAX_ORDER * MAX_ORDER * MAX_ORDER];
   forest->evalInterp(pt, N, Na, Nb, Nc);
 
   // Evaluate the contribution from the enrichment functions
   double Nr[MAX_3D_ENRICH];
   double Nar[MAX_3D_ENRICH], Nbr[MAX_3D_ENRICH], Ncr[MAX_3D_ENRICH];
-  if (order == 2){
+  if (order == 2) {
     eval2ndEnrichmentFuncs3D(pt, Nr, Nar, Nbr, Ncr);
-  }
-  if (order == 3){
+  } else if (order == 3) {
     eval3rdEnrichmentFuncs3D(pt, Nr, Nar, Nbr, Ncr);
   }
 
@@ -4048,237 +4448,143 @@ TacsScalar TMRStressConstraint::addStrainDeriv( const double pt[],
   const int nenrich = getNum3dEnrich(order);
 
   // Evaluate the derivative
-  const int len = order*order*order;
+  const int len = order * order * order;
   const double *na = Na, *nb = Nb, *nc = Nc;
-  for ( int i = 0; i < len; i++ ){
-    TacsScalar Dx = na[0]*J[0] + nb[0]*J[3] + nc[0]*J[6];
-    TacsScalar Dy = na[0]*J[1] + nb[0]*J[4] + nc[0]*J[7];
-    TacsScalar Dz = na[0]*J[2] + nb[0]*J[5] + nc[0]*J[8];
+  for (int i = 0; i < len; i++) {
+    TacsScalar Dx = na[0] * J[0] + nb[0] * J[3] + nc[0] * J[6];
+    TacsScalar Dy = na[0] * J[1] + nb[0] * J[4] + nc[0] * J[7];
+    TacsScalar Dz = na[0] * J[2] + nb[0] * J[5] + nc[0] * J[8];
 
-    dfdu[0] += alpha*(dfde[0]*Dx + dfde[4]*Dz + dfde[5]*Dy);
-    dfdu[1] += alpha*(dfde[1]*Dy + dfde[3]*Dz + dfde[5]*Dx);
-    dfdu[2] += alpha*(dfde[2]*Dz + dfde[3]*Dy + dfde[4]*Dx);
+    dfdu[0] += alpha * (dfde[0] * Dx + dfde[4] * Dz + dfde[5] * Dy);
+    dfdu[1] += alpha * (dfde[1] * Dy + dfde[3] * Dz + dfde[5] * Dx);
+    dfdu[2] += alpha * (dfde[2] * Dz + dfde[3] * Dy + dfde[4] * Dx);
 
     dfdu += 3;
-    na++; nb++; nc++;
+    na++;
+    nb++;
+    nc++;
   }
 
   // Add the contributions from the enrichment functions
-  na = Nar; nb = Nbr; nc = Ncr;
-  for ( int i = 0; i < nenrich; i++ ){
-    TacsScalar Dx = na[0]*J[0] + nb[0]*J[3] + nc[0]*J[6];
-    TacsScalar Dy = na[0]*J[1] + nb[0]*J[4] + nc[0]*J[7];
-    TacsScalar Dz = na[0]*J[2] + nb[0]*J[5] + nc[0]*J[8];
+  na = Nar;
+  nb = Nbr;
+  nc = Ncr;
+  for (int i = 0; i < nenrich; i++) {
+    TacsScalar Dx = na[0] * J[0] + nb[0] * J[3] + nc[0] * J[6];
+    TacsScalar Dy = na[0] * J[1] + nb[0] * J[4] + nc[0] * J[7];
+    TacsScalar Dz = na[0] * J[2] + nb[0] * J[5] + nc[0] * J[8];
 
-    dfdubar[0] += alpha*(dfde[0]*Dx + dfde[4]*Dz + dfde[5]*Dy);
-    dfdubar[1] += alpha*(dfde[1]*Dy + dfde[3]*Dz + dfde[5]*Dx);
-    dfdubar[2] += alpha*(dfde[2]*Dz + dfde[3]*Dy + dfde[4]*Dx);
+    dfdubar[0] += alpha * (dfde[0] * Dx + dfde[4] * Dz + dfde[5] * Dy);
+    dfdubar[1] += alpha * (dfde[1] * Dy + dfde[3] * Dz + dfde[5] * Dx);
+    dfdubar[2] += alpha * (dfde[2] * Dz + dfde[3] * Dy + dfde[4] * Dx);
 
     dfdubar += 3;
-    na++; nb++; nc++;
+    na++;
+    nb++;
+    nc++;
   }
-
-  return 0.0;
 }
-*/
-/*
-  Add the element contribution to the derivative dubar/du
-*/
+
 /*
-void TMRStressConstraint::addEnrichDeriv( TacsScalar A[],
-                                          TacsScalar dbdu[],
-                                          TacsScalar dubardu[],
-                                          TacsScalar dubar_duderiv[] ){
+  Compute the derivative of the enrichment coefficients w.r.t. the
+  right-hand-side of the reconstruction and the nodal variables
 
+  The enrichment coefficients are the least-squares solution
+  ubar = (A^{T}A)^{-1} A^{T} b, so that dubar/db = (A^{T}A)^{-1} A^{T}
+  and dubar/du = (dubar/db)(db/du).
+*/
+void TMRStressConstraint::addEnrichDeriv(TacsScalar A[], TacsScalar dbdu[],
+                                         TacsScalar dubardu[],
+                                         TacsScalar dubar_duderiv[]) {
   // Get the number of enrichment functions
   const int nenrich = getNum3dEnrich(order);
 
   // Get vars per node and other dimensions
   const int vars_per_node = tacs->getVarsPerNode();
-  const int num_nodes = order*order*order;
-  const int neq = num_nodes*vars_per_node;
+  const int num_nodes = order * order * order;
+  const int neq = num_nodes * vars_per_node;
 
   // Set the matrix dimensions
   int m = nenrich;
   int n = neq;
   int p = num_nodes;
 
-  TacsScalar *ATA = new TacsScalar[m*m]; // store A^T A
-  TacsScalar *dbduT_A = new TacsScalar[p*m];
-
   // Compute A^T A
+  TacsScalar ATA[MAX_3D_ENRICH * MAX_3D_ENRICH];
   TacsScalar a = 1.0, b = 0.0;
   BLASgemm("T", "N", &m, &m, &n, &a, A, &n, A, &n, &b, ATA, &m);
 
-  // Factor A^T A
-  int * ipiv = new int[ nenrich ];
+  // Set dubar_duderiv = A^T and solve (A^T A) dubar_duderiv = A^T
+  for (int i = 0; i < n; i++) {
+    for (int j = 0; j < m; j++) {
+      dubar_duderiv[m * i + j] = A[n * j + i];
+    }
+  }
+
+  int ipiv[MAX_3D_ENRICH];
   int info;
   LAPACKgetrf(&m, &m, ATA, &m, ipiv, &info);
-
-  // Invert A^T A
-  int lwork = 10*18;
-  TacsScalar work[10*18];
-  LAPACKgetri(&m, ATA, &m, ipiv, work, &lwork, &info);
-
-  // Compute dubar_duderiv = (A^T A)^-1 A^T
-  BLASgemm("N", "T", &m, &n, &m, &a, ATA, &m, A, &n, &b, dubar_duderiv, &m);
+  LAPACKgetrs("N", &m, &n, ATA, &m, ipiv, dubar_duderiv, &m, &info);
 
   // Evaluate dubar/du as (dubar/duderiv)(db/du)
   BLASgemm("N", "N", &m, &p, &n, &a, dubar_duderiv, &m, dbdu, &n, &b, dubardu,
-&m);
-
-  // Delete variables
-  delete [] ATA;
-  delete [] dbduT_A;
-  delete [] ipiv;
+           &m);
 }
-*/
 
 /*
-  Output the von Misess stress from the reconstructed solution to a
+  Output the von Mises stress from the reconstructed solution to a
   tecplot file
-*/
-/*
-void TMRStressConstraint::writeReconToTec( TACSBVec *_uvec,
-                                           const char *fname,
-                                           TacsScalar ys ){
-  const int vars_per_node = tacs->getVarsPerNode();
-
-  // Copy the values
-  uvec->copyValues(_uvec);
 
-  // Distribute the variable values so that the non-owned values can
-  // be accessed locally
-  uvec->beginDistributeValues();
-  uvec->endDistributeValues();
-
-  // Compute the derivatives at the nodes
-  computeNodeDeriv3D(forest, tacs, uvec, weights, uderiv);
+  The stress is written at the quadrature points of each local element,
+  so each processor should write to a separate file.
+*/
+void TMRStressConstraint::writeReconToTec(TACSBVec *_uvec, const char *fname,
+                                          TacsScalar ys) {
+  // Evaluate the constraint to compute the failure values
+  evalConstraint(_uvec);
 
   // Number of local elements
   const int nelems = tacs->getNumElements();
-
-  // Get the quadrature points/weights
-  const double *gaussPts, *gaussWts;
-  int num_quad_pts =
-    FElibrary::getGaussPtsWts(LOBATTO_QUADRATURE, order+1,
-                              &gaussPts, &gaussWts);
-
-  // Get the local connectivity for the higher-order mesh
-  const int *conn = NULL;
-  interp_forest->getNodeConn(&conn);
-
-  // Get the higher-order points
-  TMRPoint *X;
-  interp_forest->getPoints(&X);
+  const int npts = num_quad_pts * num_quad_pts * num_quad_pts;
 
   // Create file to write out the von Misses stress to .dat file
   FILE *fp = fopen(fname, "w");
+  if (!fp) {
+    fprintf(stderr, "TMRStressConstraint: Unable to open file %s\n", fname);
+    return;
+  }
+
   fprintf(fp, "TITLE = \"Reconstruction Solution\"\n");
   fprintf(fp, "FILETYPE = FULL\n");
   fprintf(fp, "VARIABLES = X, Y, Z, svm\n");
-  // fprintf(fp, "VARIABLES = \"X\", \"Y\", \"Z\", ");
-  // fprintf(fp, "\"exx\", \"eyy\", \"ezz\", \"exy\", \"eyz\", \"exz\",
-\"svm\"\n"); int num_tec_elems =
-(num_quad_pts-1)*(num_quad_pts-1)*(num_quad_pts-1)*nelems; int num_tec_pts =
-num_quad_pts*num_quad_pts*num_quad_pts*nelems; fprintf(fp, "ZONE ZONETYPE =
-FEBRICK, N = %d, E = %d, DATAPACKING = POINT\n", num_tec_pts, num_tec_elems);
-
-  for ( int i = 0; i < nelems; i++ ){
-    // Get the element class and the variables associated with it
-    TACSElement *elem = tacs->getElement(i, Xpts, vars, dvars, ddvars);
-
-    // Get the constitutive relationship
-    TACSConstitutive *con = elem->getConstitutive();
-
-    // Get the node numbers and node locations for this element
-    int len;
-    const int *nodes;
-    tacs->getElement(i, &len, &nodes);
-    tacs->getElement(i, Xpts);
-
-    // Retrieve the nodal values and nodal derivatives
-    uvec->getValues(len, nodes, vars);
-    uderiv->getValues(len, nodes, varderiv);
-
-    // Now get the node locations for the locally refined mesh
-    const int interp_elem_size = (order+1)*(order+1)*(order+1);
-    for ( int j = 0; j < interp_elem_size; j++ ){
-      int c = conn[interp_elem_size*i + j];
-      int node = interp_forest->getLocalNodeNumber(c);
-      Xpts[3*j] = X[node].x;
-      Xpts[3*j+1] = X[node].y;
-      Xpts[3*j+2] = X[node].z;
-    }
-
-    // Compute the values of the enrichment coefficient for each
-    // degree of freedom
-    computeElemRecon3D(vars_per_node, forest, interp_forest,
-                       Xpts, vars, varderiv, ubar, tmp);
-
-    // For each quadrature point, evaluate the strain at the
-    // quadrature point and evaluate the stress constraint
-    for ( int kk = 0; kk < num_quad_pts; kk++ ){
-      for ( int jj = 0; jj < num_quad_pts; jj++ ){
-        for ( int ii = 0; ii < num_quad_pts; ii++ ){
-          // Pick the quadrature point at which we will
-          // evaluate the strain
-          double pt[3];
-          pt[0] = gaussPts[ii];
-          pt[1] = gaussPts[jj];
-          pt[2] = gaussPts[kk];
-
-          // Evaluate the strain
-          TacsScalar J[9], e[6];
-          evalStrain(pt, Xpts, vars, ubar, J, e);
-
-          // Evaluate the failure criteria
-          TacsScalar fval;
-          con->failure(pt, e, &fval);
-
-          // Compute von Misess stress from failure
-          TacsScalar svm = fval*ys;
-
-          // Write the value of von Misess stress
-          TacsScalar Xpt[3] = {0.0, 0.0, 0.0};
-          double N[MAX_ORDER*MAX_ORDER*MAX_ORDER];
-          interp_forest->evalInterp(pt, N);
-          for ( int k = 0; k < interp_elem_size; k++ ){
-            Xpt[0] += Xpts[3*k]*N[k];
-            Xpt[1] += Xpts[3*k+1]*N[k];
-            Xpt[2] += Xpts[3*k+2]*N[k];
-          }
-
-          fprintf(fp, "%e %e %e %e\n",
-                  Xpt[0], Xpt[1], Xpt[2], svm);
-          // fprintf(fp, "%f %f %f %e %e %e %e %e %e %e\n",
-          //        Xpt[0], Xpt[1], Xpt[2],
-          //        e[0], e[1], e[2], e[3], e[4], e[5], svm);
-        }
-      }
-    }
+  int num_tec_elems =
+      (num_quad_pts - 1) * (num_quad_pts - 1) * (num_quad_pts - 1) * nelems;
+  int num_tec_pts = npts * nelems;
+  fprintf(fp,
+          "ZONE ZONETYPE = FEBRICK, N = %d, E = %d, DATAPACKING = POINT\n",
+          num_tec_pts, num_tec_elems);
+
+  // Write the point locations and the von Mises stress
+  for (int i = 0; i < npts * nelems; i++) {
+    const TacsScalar *data = &point_data[TMR_STRESS_POINT_SIZE * i];
+    TacsScalar svm = data[19] * ys;
+    fprintf(fp, "%e %e %e %e\n", TacsRealPart(data[15]),
+            TacsRealPart(data[16]), TacsRealPart(data[17]), TacsRealPart(svm));
   }
 
   // Seperate the point data from the connectivity by a blank line
   fprintf(fp, "\n");
 
   // Write the element connectivity
-  for ( int i = 0; i < nelems; i++ ){
-    // Write the connectivity
-    for ( int kk = 0; kk < num_quad_pts-1; kk++ ){
-      for ( int jj = 0; jj < num_quad_pts-1; jj++ ){
-        for ( int ii = 0; ii < num_quad_pts-1; ii++ ){
-          int off = num_quad_pts*num_quad_pts*num_quad_pts*i + 1;
-          fprintf(fp, "%d %d %d %d %d %d %d %d\n",
-                  off + ii + jj*num_quad_pts + kk*num_quad_pts*num_quad_pts,
-                  off + ii+1 + jj*num_quad_pts + kk*num_quad_pts*num_quad_pts,
-                  off + ii+1 + (jj+1)*num_quad_pts +
-kk*num_quad_pts*num_quad_pts, off + ii + (jj+1)*num_quad_pts +
-kk*num_quad_pts*num_quad_pts, off + ii + jj*num_quad_pts +
-(kk+1)*num_quad_pts*num_quad_pts, off + ii+1 + jj*num_quad_pts +
-(kk+1)*num_quad_pts*num_quad_pts, off + ii+1 + (jj+1)*num_quad_pts +
-(kk+1)*num_quad_pts*num_quad_pts, off + ii + (jj+1)*num_quad_pts +
-(kk+1)*num_quad_pts*num_quad_pts);
+  const int nq = num_quad_pts;
+  for (int i = 0; i < nelems; i++) {
+    for (int kk = 0; kk < nq - 1; kk++) {
+      for (int jj = 0; jj < nq - 1; jj++) {
+        for (int ii = 0; ii < nq - 1; ii++) {
+          int off = npts * i + 1 + ii + jj * nq + kk * nq * nq;
+          fprintf(fp, "%d %d %d %d %d %d %d %d\n", off, off + 1, off + nq + 1,
+                  off + nq, off + nq * nq, off + nq * nq + 1,
+                  off + nq * nq + nq + 1, off + nq * nq + nq);
         }
       }
     }
@@ -4287,4 +4593,3 @@ kk*num_quad_pts*num_quad_pts, off + ii + jj*num_quad_pts +
   // Close the file
   fclose(fp);
 }
-*/
@@ -22,21 +22,46 @@
 #define TMR_REFINEMENT_TOOLS_H
 
 #include "TACSAssembler.h"
+#include "TACSConstitutive.h"
 #include "TACSMg.h"
 #include "TMROctForest.h"
 #include "TMRQuadForest.h"
 
 /*
   Create a TACS multigrid object
+
+  When use_coarse_direct_solve is set and coarse_solve_procs is
+  non-zero, the coarsest level is gathered onto a subset of the
+  processors and factored there with TMRAgglomeratedPc. A positive
+  value gives the number of solve processors, while a negative value
+  uses one solve processor per shared-memory node. Since the coarse
+  matrix is stored as a dense matrix, the parallel direct solve is
+  used instead when the coarse problem has more than
+  TMRAgglomeratedPc::MAX_DENSE_SIZE unknowns, or when TACS is built
+  with complex values.
+
+  When use_mixed_precision is set, the smoothing on the levels that
+  are not solved directly is performed with a Chebyshev smoother that
+  stores the level matrices and applies the smoother in single
+  precision (TMRMixedChebyshevSmoother). The outer Krylov method and
+  the residuals remain in double precision. The single precision
+  copies are stored in addition to the double precision matrices, so
+  this trades about half again the matrix storage on these levels for
+  less memory traffic in the smoothing. In complex builds, the
+  Chebyshev smoother is used in double precision instead.
 */
 void TMR_CreateTACSMg(int nlevels, TACSAssembler *tacs[],
                       TMROctForest *forest[], TACSMg **_mg, double omega = 1.0,
                       int use_galerkin = 0, int use_coarse_direct_solve = 1,
-                      int use_chebyshev_smoother = 0);
+                      int use_chebyshev_smoother = 0,
+                      int coarse_solve_procs = 0,
+                      int use_mixed_precision = 0);
 void TMR_CreateTACSMg(int nlevels, TACSAssembler *tacs[],
                       TMRQuadForest *forest[], TACSMg **_mg, double omega = 1.0,
                       int use_galerkin = 0, int use_coarse_direct_solve = 1,
-                      int use_chebyshev_smoother = 0);
+                      int use_chebyshev_smoother = 0,
+                      int coarse_solve_procs = 0,
+                      int use_mixed_precision = 0);
 
 /*
   Compute a direct interpolation from a lower-order mesh to a
@@ -73,6 +98,28 @@ void TMR_ComputeReconSolution(TMROctForest *forest, TACSAssembler *tacs,
 void TMR_PrintErrorBins(MPI_Comm comm, const double *error, const int nelems,
                         double *mean = NULL, double *stddev = NULL);
 
+/*
+  Compute the refinement indicators for the adaptation strategies
+
+  The element errors are compared against the equidistributed target
+  error, error_tol/N, where N is the total number of elements. The
+  decreasing threshold strategy refines all elements with an error
+  ratio above the threshold and returns the total number of refined
+  elements. The fixed growth strategy refines the fraction
+  refine_factor of elements with the largest error ratios above one
+  and coarsens the fraction coarsen_factor with the smallest ratios
+  below one. The smallest refined and largest coarsened ratios are
+  returned, or -1 if no elements are refined or coarsened.
+*/
+int TMR_DecreasingThresholdRefine(MPI_Comm comm, const double *error,
+                                  const int nelems, double error_tol,
+                                  double threshold, int refine[]);
+void TMR_FixedGrowthRefine(MPI_Comm comm, const double *error,
+                           const int nelems, double error_tol,
+                           double refine_factor, double coarsen_factor,
+                           int refine[], double *refine_threshold = NULL,
+                           double *coarsen_threshold = NULL);
+
 /*
   Perform a mesh refinement based on the strain engery refinement
   criteria.
@@ -105,49 +152,61 @@ double TMR_AdjointErrorEst(TMROctForest *forest, TACSAssembler *tacs,
   of the stresses in the problem.
 
   This makes strong assumptions about the element type and constitutive
-  matrix. Be careful when using this method
+  matrix. Be careful when using this method. The solution must be a 3D
+  displacement field with 3 variables per node and a mesh order of 2
+  or 3, and the forest must have a geometry so that the node locations
+  of the higher-order mesh can be evaluated. The failure criterion is
+  evaluated with the constitutive object, which must be the one used
+  by the elements.
+
+  evalConstraint() computes the nodal derivatives and the enrichment
+  coefficients and stores the strain, the Jacobian transformation and
+  the failure value at each quadrature point. evalConDeriv() uses the
+  stored values, so it must be called after evalConstraint() with the
+  same design variables and state.
 */
-/*
 class TMRStressConstraint : public TMREntity {
  public:
-  TMRStressConstraint( TMROctForest *_forest,
-                       TACSAssembler *tacs,
-                       TacsScalar _ks_weight=30.0 );
+  TMRStressConstraint(TMROctForest *_forest, TACSAssembler *_tacs,
+                      TACSConstitutive *_con, TacsScalar _ks_weight = 30.0);
   ~TMRStressConstraint();
 
   // Evaluate the aggregated stress constraint across all processors
-  TacsScalar evalConstraint( TACSBVec *_uvec );
+  TacsScalar evalConstraint(TACSBVec *_uvec);
 
-  // Evaluate the terms required for the total derivative
-  void evalConDeriv( TacsScalar *dfdx, int size, TACSBVec *dfdu );
+  // Evaluate the derivative w.r.t. the design variables and the state
+  void evalConDeriv(TACSBVec *dfdx, TACSBVec *dfdu);
 
-  // Write the von Misses stress from the reconstruction to tecplot
-  void writeReconToTec( TACSBVec *_uvec, const char *fname,
-                        TacsScalar ys=1e6 );
+  // Write the von Mises stress from the reconstruction to tecplot
+  void writeReconToTec(TACSBVec *_uvec, const char *fname,
+                       TacsScalar ys = 1e6);
 
  private:
   // Evaluate the element strain at the given point
-  TacsScalar evalStrain( const double pt[],
-                         const TacsScalar *Xpts,
-                         const TacsScalar *vars,
-                         const TacsScalar *ubar,
-                         TacsScalar J[], TacsScalar e[] );
+  TacsScalar evalStrain(const double pt[], const TacsScalar *Xpts,
+                        const TacsScalar *vars, const TacsScalar *ubar,
+                        TacsScalar J[], TacsScalar e[]);
 
   // Evaluate the derivatives of the element strain
-  TacsScalar addStrainDeriv( const double pt[], const TacsScalar J[],
-                             const TacsScalar alpha, const TacsScalar dfde[],
-                             TacsScalar dfdu[], TacsScalar dfdubar[] );
+  void addStrainDeriv(const double pt[], const TacsScalar J[],
+                      const TacsScalar alpha, const TacsScalar dfde[],
+                      TacsScalar dfdu[], TacsScalar dfdubar[]);
 
   // Compute the derivative terms related to the reconstructed solution
-  void addEnrichDeriv( TacsScalar A[], TacsScalar dbdu[],
-                       TacsScalar dubardu[],
-                       TacsScalar dubar_duderiv[] );
+  void addEnrichDeriv(TacsScalar A[], TacsScalar dbdu[], TacsScalar dubardu[],
+                      TacsScalar dubar_duderiv[]);
+
+  // Get the parametric point for the given quadrature point index
+  void getQuadraturePoint(int index, double pt[]);
 
   // The mesh order
   int order;
   TMROctForest *forest;
   TMROctForest *interp_forest;
 
+  // The constitutive object used to evaluate the failure criterion
+  TACSConstitutive *con;
+
   // The values used to compute the KS function
   TacsScalar ks_weight;
   TacsScalar ks_max_fail, ks_fail_sum;
@@ -164,19 +223,23 @@ class TMRStressConstraint : public TMREntity {
   // The weights on the local
   TACSBVec *weights;
 
-  // Arrays to store the element-wise variables
-  TacsScalar *Xpts;
-  TacsScalar *vars, *dvars, *ddvars;
+  // The tensor-product Gauss quadrature with order+1 points in each
+  // direction (the order is at most 3)
+  int num_quad_pts;
+  double quad_pts[4], quad_wts[4];
 
-  // The values of the element-wise reconstructed derivatives
-  // at each node
-  TacsScalar *varderiv;
+  // The maximum number of design variable nodes for any element
+  int max_dv_nodes;
 
-  // Values of the variables for each enrichment function
-  TacsScalar *ubar;
+  // Flag to indicate that the values from evalConstraint() are stored
+  int has_recon;
 
-  // Temporary vector
-  TacsScalar *tmp;
+  // The stored values from the last call to evalConstraint(): the node
+  // locations of the higher-order element, the enrichment coefficients
+  // and TMR_STRESS_POINT_SIZE values at each quadrature point
+  TacsScalar *elem_Xpts;
+  TacsScalar *elem_ubar;
+  TacsScalar *point_data;
 };
-*/
+
 #endif  // TMR_REFINEMENT_TOOLS_H
@@ -13,9 +13,18 @@
 
 #include "TMR_STLTools.h"
 
+#include <fcntl.h>
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef TMR_HAS_OPENMP
+#include <omp.h>
+#endif  // TMR_HAS_OPENMP
 
 const int edgeTable[256] = {
     0x0,   0x109, 0x203, 0x30a, 0x406, 0x50f, 0x605, 0x70c, 0x80c, 0x905, 0xa0f,
@@ -541,43 +550,25 @@ class TriangleList {
     len++;
   }
 
+  // Add an array of triangles to the list
+  void addTriangles(int ntris, const TMR_STLTriangle *tris) {
+    if (len + ntris > max_len) {
+      max_len = len + ntris;
+      TMR_STLTriangle *temp = new TMR_STLTriangle[max_len];
+      memcpy(temp, triangles, len * sizeof(TMR_STLTriangle));
+      delete[] triangles;
+      triangles = temp;
+    }
+    memcpy(&triangles[len], tris, ntris * sizeof(TMR_STLTriangle));
+    len += ntris;
+  }
+
   // Get the list of triangles
   void getTriangles(int *ntris, TMR_STLTriangle **tris) {
     *tris = triangles;
     *ntris = len;
   }
 
-  // Write all the triangles to a list
-  int writeSTLFile(const char *filename) {
-    // Open the file and see if we were successful
-    FILE *fp = fopen(filename, "w");
-    if (!fp) {
-      return 1;
-    }
-
-    fprintf(fp, "solid topology\n");
-    for (int i = 0; i < len; i++) {
-      double n[3];
-      compute_normal(triangles[i], n);
-
-      // Write the facet normal
-      fprintf(fp, "facet normal %e %e %e\n", n[0], n[1], n[2]);
-
-      // Write the vertex loop
-      fprintf(fp, "outer loop\n");
-      for (int k = 0; k < 3; k++) {
-        fprintf(fp, "vertex %e %e %e\n", triangles[i].p[k].x,
-                triangles[i].p[k].y, triangles[i].p[k].z);
-      }
-      fprintf(fp, "endloop\nendfacet\n");
-    }
-
-    fprintf(fp, "endsolid topology\n");
-    fclose(fp);
-
-    return 0;
-  }
-
  private:
   int len, max_len, len_incr;
   TMR_STLTriangle *triangles;
@@ -633,72 +624,37 @@ void add_faces(TriangleList *list, Cell *grid, double cutoff, int bound[]) {
 
 const int ordering_transform[] = {0, 1, 3, 2, 4, 5, 7, 6};
 
-/**
-  Create a list of STL triangles
+/*
+  The number of contiguous blocks of octants processed by each thread.
+  The octants are stored in Morton order, so each block covers a
+  compact region of the domain. Using several blocks per thread
+  balances the work since many octants are skipped entirely.
 */
-int TMR_GenerateSTLTriangles(TMROctForest *filter, TACSBVec *x, int x_offset,
-                             double cutoff, TriangleList **_list) {
-  // Set the return flag
-  int fail = 0;
-
-  // Get the MPI communicator
-  int mpi_size, mpi_rank;
-  MPI_Comm comm = filter->getMPIComm();
-  MPI_Comm_size(comm, &mpi_size);
-  MPI_Comm_rank(comm, &mpi_rank);
+static const int TMR_STL_BLOCKS_PER_THREAD = 4;
 
+/*
+  Add the triangles from a contiguous range of octants to the list
+*/
+static void TMR_AddOctantTriangles(
+    TMROctForest *filter, TACSBVec *x, int x_offset, double cutoff,
+    const TMROctant *octs, int start, int end, const int *conn,
+    const TMRPoint *X, const int *block_face_conn, const int *face_block_ptr,
+    const int *dep_ptr, const int *dep_conn, const double *dep_weights,
+    const double *Nbern, TriangleList *list) {
   // Retrieve the mesh order
   const int mesh_order = filter->getMeshOrder();
-
-  // Ensure that the values are distributed so that we can access them
-  // directly
-  x->beginDistributeValues();
-  x->endDistributeValues();
-
-  // Get the dependent nodes and weight values
-  const int *dep_ptr, *dep_conn;
-  const double *dep_weights;
-  filter->getDepNodeConn(&dep_ptr, &dep_conn, &dep_weights);
+  const int nnodes = mesh_order * mesh_order * mesh_order;
 
   // Set the maximum length of any of the block sides
   const int32_t hmax = 1 << TMR_MAX_LEVEL;
 
-  // Create the list of Triangles
-  TriangleList *list = new TriangleList(4096);
-
-  // Get the block -> face information and the face -> block info.
-  // This will be used to determine which faces lie on the boundaries
-  // of the domain
-  const int *block_face_conn;
-  filter->getConnectivity(NULL, NULL, NULL, NULL, NULL, &block_face_conn, NULL,
-                          NULL);
-
-  const int *face_block_ptr;
-  filter->getInverseConnectivity(NULL, NULL, NULL, NULL, NULL, &face_block_ptr);
-
-  // Get the array of octants
-  TMROctantArray *octants;
-  int nelems;
-  TMROctant *octs;
-  filter->getOctants(&octants);
-  octants->getArray(&octs, &nelems);
-
-  // Get the connectivity
-  const int *conn;
-  filter->getNodeConn(&conn);
-
-  // Get the nodal locations from the TMROctree object
-  TMRPoint *X;
-  filter->getPoints(&X);
-
   // Allocate space to store the node locations and levelset values
   const int bsize = x->getBlockSize();
   TacsScalar *xvars = new TacsScalar[bsize];
-  TacsScalar *levelvals = new TacsScalar[mesh_order * mesh_order * mesh_order];
-  TMRPoint *Xe = new TMRPoint[mesh_order * mesh_order * mesh_order];
+  TacsScalar *levelvals = new TacsScalar[nnodes];
+  TMRPoint *Xe = new TMRPoint[nnodes];
 
-  // Get the mesh coordinates from the filter
-  for (int i = 0; i < nelems; i++) {
+  for (int i = start; i < end; i++) {
     // Compute the side-length of this element
     const int32_t h = 1 << (TMR_MAX_LEVEL - octs[i].level);
 
@@ -724,40 +680,54 @@ int TMR_GenerateSTLTriangles(TMROctForest *filter, TACSBVec *x, int x_offset,
     octree_face_boundary[5] =
         octree_face_boundary[5] && (octs[i].z + h == hmax);
 
+    int element_boundary = 0;
+    for (int k = 0; k < 6; k++) {
+      element_boundary = element_boundary || octree_face_boundary[k];
+    }
+
     // Get the local connectivity
-    const int *c = &conn[mesh_order * mesh_order * mesh_order * i];
-
-    // Loop over the nodes within the element
-    for (int kk = 0; kk < mesh_order; kk++) {
-      for (int jj = 0; jj < mesh_order; jj++) {
-        for (int ii = 0; ii < mesh_order; ii++) {
-          // Find the local index
-          int index = (ii + jj * mesh_order + kk * mesh_order * mesh_order);
-
-          // Find the local node number
-          int node = filter->getLocalNodeNumber(c[index]);
-          if (node >= 0) {
-            // Get the node location
-            Xe[index] = X[node];
-          } else {
-            printf(
-                "TMR_GenerateBinFile: Failed at node with block: "
-                "%d x %d y: %d z: %d\n",
-                octs[i].block, octs[i].x, octs[i].y, octs[i].z);
-          }
-          if (c[index] >= 0) {
-            x->getValues(1, &c[index], xvars);
-            levelvals[index] = xvars[x_offset];
-          } else {
-            int dep = -c[index] - 1;
-            levelvals[index] = 0.0;
-            for (int jp = dep_ptr[dep]; jp < dep_ptr[dep + 1]; jp++) {
-              x->getValues(1, &dep_conn[jp], xvars);
-              levelvals[index] += dep_weights[jp] * xvars[x_offset];
-            }
-          }
+    const int *c = &conn[nnodes * i];
+
+    // Evaluate the level set values at the nodes and count the
+    // number of nodes below the cutoff
+    int nbelow = 0;
+    for (int index = 0; index < nnodes; index++) {
+      if (c[index] >= 0) {
+        x->getValues(1, &c[index], xvars);
+        levelvals[index] = xvars[x_offset];
+      } else {
+        int dep = -c[index] - 1;
+        levelvals[index] = 0.0;
+        for (int jp = dep_ptr[dep]; jp < dep_ptr[dep + 1]; jp++) {
+          x->getValues(1, &dep_conn[jp], xvars);
+          levelvals[index] += dep_weights[jp] * xvars[x_offset];
         }
       }
+      if (levelvals[index] < cutoff) {
+        nbelow++;
+      }
+    }
+
+    // The cell values are either the nodal values or, for Bernstein
+    // points, a convex combination of them. If all of the values lie
+    // below the cutoff, the element is void and no surface is
+    // generated. If all of the values lie above the cutoff, the
+    // element is solid and only the boundary faces are generated.
+    if (nbelow == nnodes || (nbelow == 0 && !element_boundary)) {
+      continue;
+    }
+
+    // Get the node locations
+    for (int index = 0; index < nnodes; index++) {
+      int node = filter->getLocalNodeNumber(c[index]);
+      if (node >= 0) {
+        Xe[index] = X[node];
+      } else {
+        printf(
+            "TMR_GenerateBinFile: Failed at node with block: "
+            "%d x %d y: %d z: %d\n",
+            octs[i].block, octs[i].x, octs[i].y, octs[i].z);
+      }
     }
 
     // Loop over each octant in the mesh (if the mesh is higher-order)
@@ -782,21 +752,10 @@ int TMR_GenerateSTLTriangles(TMROctForest *filter, TACSBVec *x, int x_offset,
                 int offset = (ix + ii) + (iy + jj) * mesh_order +
                              (iz + kk) * mesh_order * mesh_order;
 
-                if (filter->getInterpType() == TMR_BERNSTEIN_POINTS) {
-                  int w = (int)((offset) / (mesh_order * mesh_order));
-                  int v = (int)((offset - mesh_order * mesh_order * w) /
-                                mesh_order);
-                  int u = offset - mesh_order * v - mesh_order * mesh_order * w;
-                  double pt[3];
-                  pt[0] = -1.0 + 2.0 / (mesh_order - 1.0) * u;
-                  pt[1] = -1.0 + 2.0 / (mesh_order - 1.0) * v;
-                  pt[2] = -1.0 + 2.0 / (mesh_order - 1.0) * w;
-
-                  int nweights = mesh_order * mesh_order * mesh_order;
-                  double N[nweights];
-                  filter->evalInterp(pt, N);
+                if (Nbern) {
+                  const double *N = &Nbern[nnodes * offset];
                   cell.val[index] = 0.0;
-                  for (int nn = 0; nn < nweights; nn++) {
+                  for (int nn = 0; nn < nnodes; nn++) {
                     cell.val[index] += N[nn] * levelvals[nn];
                   }
                 } else {
@@ -845,8 +804,128 @@ int TMR_GenerateSTLTriangles(TMROctForest *filter, TACSBVec *x, int x_offset,
   delete[] xvars;
   delete[] levelvals;
   delete[] Xe;
+}
+
+/**
+  Create a list of STL triangles
+
+  The octants are split into contiguous blocks that are processed
+  concurrently (when compiled with OpenMP) with a separate list for
+  each block. The lists are concatenated in block order so that the
+  triangles are in the same order as a serial traversal.
+*/
+int TMR_GenerateSTLTriangles(TMROctForest *filter, TACSBVec *x, int x_offset,
+                             double cutoff, TriangleList **_list) {
+  // Set the return flag
+  int fail = 0;
+
+  // Retrieve the mesh order
+  const int mesh_order = filter->getMeshOrder();
+  const int nnodes = mesh_order * mesh_order * mesh_order;
+
+  // Ensure that the values are distributed so that we can access them
+  // directly
+  x->beginDistributeValues();
+  x->endDistributeValues();
+
+  // Get the dependent nodes and weight values
+  const int *dep_ptr, *dep_conn;
+  const double *dep_weights;
+  filter->getDepNodeConn(&dep_ptr, &dep_conn, &dep_weights);
+
+  // Get the block -> face information and the face -> block info.
+  // This will be used to determine which faces lie on the boundaries
+  // of the domain
+  const int *block_face_conn;
+  filter->getConnectivity(NULL, NULL, NULL, NULL, NULL, &block_face_conn, NULL,
+                          NULL);
+
+  const int *face_block_ptr;
+  filter->getInverseConnectivity(NULL, NULL, NULL, NULL, NULL, &face_block_ptr);
+
+  // Get the array of octants
+  TMROctantArray *octants;
+  int nelems;
+  TMROctant *octs;
+  filter->getOctants(&octants);
+  octants->getArray(&octs, &nelems);
+
+  // Get the connectivity
+  const int *conn;
+  filter->getNodeConn(&conn);
+
+  // Get the nodal locations from the TMROctree object
+  TMRPoint *X;
+  filter->getPoints(&X);
+
+  // For Bernstein points, the interpolation at the nodes of the
+  // sub-cells is the same for all elements, so evaluate it once
+  double *Nbern = NULL;
+  if (filter->getInterpType() == TMR_BERNSTEIN_POINTS) {
+    Nbern = new double[nnodes * nnodes];
+    for (int offset = 0; offset < nnodes; offset++) {
+      int w = (int)((offset) / (mesh_order * mesh_order));
+      int v = (int)((offset - mesh_order * mesh_order * w) / mesh_order);
+      int u = offset - mesh_order * v - mesh_order * mesh_order * w;
+      double pt[3];
+      pt[0] = -1.0 + 2.0 / (mesh_order - 1.0) * u;
+      pt[1] = -1.0 + 2.0 / (mesh_order - 1.0) * v;
+      pt[2] = -1.0 + 2.0 / (mesh_order - 1.0) * w;
+      filter->evalInterp(pt, &Nbern[nnodes * offset]);
+    }
+  }
+
+  // Set the number of blocks of octants
+  int nblocks = 1;
+#ifdef TMR_HAS_OPENMP
+  nblocks = TMR_STL_BLOCKS_PER_THREAD * omp_get_max_threads();
+  if (nblocks > nelems) {
+    nblocks = (nelems > 0 ? nelems : 1);
+  }
+#endif  // TMR_HAS_OPENMP
+
+  // Create the list of triangles for each block
+  TriangleList **lists = new TriangleList *[nblocks];
+
+#ifdef TMR_HAS_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif  // TMR_HAS_OPENMP
+  for (int k = 0; k < nblocks; k++) {
+    int start = (int)(((long int)nelems * k) / nblocks);
+    int end = (int)(((long int)nelems * (k + 1)) / nblocks);
+    lists[k] = new TriangleList(4096);
+    TMR_AddOctantTriangles(filter, x, x_offset, cutoff, octs, start, end, conn,
+                           X, block_face_conn, face_block_ptr, dep_ptr,
+                           dep_conn, dep_weights, Nbern, lists[k]);
+  }
+
+  if (nblocks == 1) {
+    *_list = lists[0];
+  } else {
+    // Concatenate the lists in order
+    int ntotal = 0;
+    for (int k = 0; k < nblocks; k++) {
+      int ntris;
+      TMR_STLTriangle *tris;
+      lists[k]->getTriangles(&ntris, &tris);
+      ntotal += ntris;
+    }
 
-  *_list = list;
+    TriangleList *list = new TriangleList(ntotal);
+    for (int k = 0; k < nblocks; k++) {
+      int ntris;
+      TMR_STLTriangle *tris;
+      lists[k]->getTriangles(&ntris, &tris);
+      list->addTriangles(ntris, tris);
+      delete lists[k];
+    }
+    *_list = list;
+  }
+
+  delete[] lists;
+  if (Nbern) {
+    delete[] Nbern;
+  }
 
   return fail;
 }
@@ -962,32 +1041,639 @@ int TMR_GenerateBinFile(const char *filename, TMROctForest *filter, TACSBVec *x,
 }
 
 /*
-  Take the binary file generated from above and convert to the .STL
-  data format (in ASCII).
+  The size of the header and of each triangle record in a binary STL
+  file
 */
-int TMR_ConvertBinToSTL(const char *binfile, const char *stlfile) {
-  FILE *fp = fopen(binfile, "rb");
-  if (!fp) {
+static const int TMR_STL_HEADER_SIZE = 80;
+static const int TMR_STL_RECORD_SIZE = 50;
+
+/*
+  Pack a triangle into a binary STL record: the normal and the three
+  vertices as single-precision values followed by a zero attribute
+*/
+static void TMR_PackSTLRecord(const TMR_STLTriangle *tri, char *record) {
+  double n[3];
+  compute_normal(*tri, n);
+
+  float vals[12];
+  for (int k = 0; k < 3; k++) {
+    vals[k] = n[k];
+  }
+  for (int j = 0; j < 3; j++) {
+    vals[3 + 3 * j] = tri->p[j].x;
+    vals[4 + 3 * j] = tri->p[j].y;
+    vals[5 + 3 * j] = tri->p[j].z;
+  }
+  memcpy(record, vals, 12 * sizeof(float));
+  memset(&record[12 * sizeof(float)], 0, 2);
+}
+
+/*
+  The data for a binary STL file that is being written
+*/
+class TMRSTLFileRequest {
+ public:
+  TMRSTLFileRequest() {
+    fp = MPI_FILE_NULL;
+    request = MPI_REQUEST_NULL;
+    buffer = NULL;
+    fail = 0;
+  }
+
+  MPI_File fp;
+  MPI_Request request;
+  char *buffer;
+  int fail;
+};
+
+/*
+  Begin writing the binary STL file.
+
+  The triangles are extracted and packed into a buffer owned by the
+  request, so the design variables may be modified as soon as this
+  call returns. When the MPI library supports non-blocking collective
+  I/O, the triangles are written in the background until the request
+  is completed by TMR_EndWriteSTLFile.
+*/
+int TMR_BeginWriteSTLFile(const char *filename, TMROctForest *filter,
+                          TACSBVec *x, int x_offset, double cutoff,
+                          TMRSTLFileRequest **_request) {
+  TMRSTLFileRequest *request = new TMRSTLFileRequest();
+  *_request = request;
+
+  // Generate the triangle
+  TriangleList *list;
+  int fail = TMR_GenerateSTLTriangles(filter, x, x_offset, cutoff, &list);
+  if (fail) {
+    request->fail = fail;
+    return fail;
+  }
+
+  // Get the MPI communicator
+  int mpi_rank;
+  MPI_Comm comm = filter->getMPIComm();
+  MPI_Comm_rank(comm, &mpi_rank);
+
+  // Get the local triangles
+  int ntris;
+  TMR_STLTriangle *tris;
+  list->getTriangles(&ntris, &tris);
+
+  // Compute the offset to the local triangles and the total number
+  long long int count = ntris, offset = 0, total = 0;
+  MPI_Exscan(&count, &offset, 1, MPI_LONG_LONG_INT, MPI_SUM, comm);
+  MPI_Allreduce(&count, &total, 1, MPI_LONG_LONG_INT, MPI_SUM, comm);
+  if (mpi_rank == 0) {
+    offset = 0;
+  }
+
+  if (total > 0xffffffffLL) {
+    if (mpi_rank == 0) {
+      fprintf(stderr,
+              "TMR_WriteSTLFile: Too many triangles (%lld) for a binary "
+              "STL file\n",
+              total);
+    }
+    delete list;
+    request->fail = 1;
     return 1;
   }
 
-  // Try to read in the number of triangles
+  // Pack the local triangles into the binary STL records
+  request->buffer = new char[(size_t)TMR_STL_RECORD_SIZE * ntris];
+  for (int i = 0; i < ntris; i++) {
+    TMR_PackSTLRecord(&tris[i],
+                      &request->buffer[(size_t)TMR_STL_RECORD_SIZE * i]);
+  }
+  delete list;
+
+  // Copy the filename to a non-const array
+  char *fname = new char[strlen(filename) + 1];
+  strcpy(fname, filename);
+
+  // Create the file and write out the information
+  if (MPI_File_open(comm, fname, MPI_MODE_WRONLY | MPI_MODE_CREATE,
+                    MPI_INFO_NULL, &request->fp) == MPI_SUCCESS) {
+    // Truncate any existing file to the new size
+    const MPI_Offset header_size = TMR_STL_HEADER_SIZE + sizeof(uint32_t);
+    MPI_File_set_size(request->fp, header_size + TMR_STL_RECORD_SIZE * total);
+
+    // Write the header and the number of triangles
+    if (mpi_rank == 0) {
+      char header[TMR_STL_HEADER_SIZE + sizeof(uint32_t)];
+      memset(header, 0, sizeof(header));
+      snprintf(header, TMR_STL_HEADER_SIZE, "TMR level set");
+      uint32_t ntotal = total;
+      memcpy(&header[TMR_STL_HEADER_SIZE], &ntotal, sizeof(uint32_t));
+      MPI_File_write_at(request->fp, 0, header, sizeof(header), MPI_BYTE,
+                        MPI_STATUS_IGNORE);
+    }
+
+    // Write out all the triangles to the file
+    MPI_Offset file_offset = header_size + TMR_STL_RECORD_SIZE * offset;
+#if MPI_VERSION > 3 || (MPI_VERSION == 3 && MPI_SUBVERSION >= 1)
+    MPI_File_iwrite_at_all(request->fp, file_offset, request->buffer,
+                           TMR_STL_RECORD_SIZE * ntris, MPI_BYTE,
+                           &request->request);
+#else
+    MPI_File_write_at_all(request->fp, file_offset, request->buffer,
+                          TMR_STL_RECORD_SIZE * ntris, MPI_BYTE,
+                          MPI_STATUS_IGNORE);
+#endif
+  } else {
+    if (mpi_rank == 0) {
+      fprintf(stderr, "TMR_WriteSTLFile: Could not open file %s\n", filename);
+    }
+    request->fp = MPI_FILE_NULL;
+    request->fail = fail = 1;
+  }
+
+  delete[] fname;
+
+  return fail;
+}
+
+/*
+  Complete the writing of the binary STL file and free the request.
+
+  This is a collective call on the communicator of the forest.
+*/
+int TMR_EndWriteSTLFile(TMRSTLFileRequest *request) {
+  if (!request) {
+    return 1;
+  }
+
+  if (request->request != MPI_REQUEST_NULL) {
+    MPI_Wait(&request->request, MPI_STATUS_IGNORE);
+  }
+  if (request->fp != MPI_FILE_NULL) {
+    MPI_File_close(&request->fp);
+  }
+  if (request->buffer) {
+    delete[] request->buffer;
+  }
+
+  int fail = request->fail;
+  delete request;
+
+  return fail;
+}
+
+/*
+  Write the level set directly to a binary STL file using MPI/IO
+*/
+int TMR_WriteSTLFile(const char *filename, TMROctForest *filter, TACSBVec *x,
+                     int x_offset, double cutoff) {
+  TMRSTLFileRequest *request;
+  int fail =
+      TMR_BeginWriteSTLFile(filename, filter, x, x_offset, cutoff, &request);
+  int end_fail = TMR_EndWriteSTLFile(request);
+  return (fail ? fail : end_fail);
+}
+
+/*
+  The number of triangles that are read from the binary file and
+  converted at one time
+*/
+static const int TMR_STL_CONVERT_CHUNK_SIZE = 65536;
+
+/*
+  An upper bound on the length of the text of a single facet in an
+  ASCII STL file
+*/
+static const int TMR_STL_MAX_FACET_TEXT = 384;
+
+/*
+  Read the triangles from the binary file created by
+  TMR_GenerateBinFile.
+
+  The file is memory-mapped when possible so that it is streamed from
+  the page cache without an intermediate copy of the whole file.
+  Otherwise, the triangles are read from the file on demand. In both
+  cases, the triangles are read in sequential chunks.
+*/
+class TMRBinTriangleReader {
+ public:
+  TMRBinTriangleReader(const char *binfile) {
+    fp = NULL;
+    data = NULL;
+    data_size = 0;
+    ntris = -1;
+
+    int fd = open(binfile, O_RDONLY);
+    if (fd < 0) {
+      return;
+    }
+
+    // Try to read in the number of triangles
+    struct stat st;
+    int count = 0;
+    if (fstat(fd, &st) != 0 || read(fd, &count, sizeof(int)) != sizeof(int)) {
+      close(fd);
+      return;
+    }
+    long long int file_size =
+        sizeof(int) + (long long int)count * sizeof(TMR_STLTriangle);
+    if (count < 0 || (long long int)st.st_size < file_size) {
+      close(fd);
+      return;
+    }
+    ntris = count;
+
+    // Map the file into memory
+    data_size = st.st_size;
+    void *ptr = mmap(NULL, data_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (ptr != MAP_FAILED) {
+      data = (char *)ptr;
+      madvise(ptr, data_size, MADV_SEQUENTIAL);
+      close(fd);
+    } else {
+      // Fall back to reading the file
+      fp = fdopen(fd, "rb");
+      if (fp) {
+        fseek(fp, sizeof(int), SEEK_SET);
+      } else {
+        close(fd);
+        ntris = -1;
+      }
+    }
+  }
+  ~TMRBinTriangleReader() {
+    if (data) {
+      munmap(data, data_size);
+    }
+    if (fp) {
+      fclose(fp);
+    }
+  }
+
+  // Get the number of triangles, or -1 if the file could not be read
+  int getNumTriangles() { return ntris; }
+
+  // Read the next set of triangles from the file. The triangles are
+  // copied since they are not aligned within the file.
+  int readTriangles(long long int start, int n, TMR_STLTriangle *tris) {
+    if (data) {
+      memcpy(tris, &data[sizeof(int) + start * sizeof(TMR_STLTriangle)],
+             n * sizeof(TMR_STLTriangle));
+      return 0;
+    }
+    if (fread(tris, sizeof(TMR_STLTriangle), n, fp) != (size_t)n) {
+      return 1;
+    }
+    return 0;
+  }
+
+ private:
+  FILE *fp;
+  char *data;
+  size_t data_size;
   int ntris;
-  if (fread(&ntris, sizeof(int), 1, fp) != 1) {
+};
+
+/*
+  Format a triangle as a facet within an ASCII STL file and return the
+  number of characters written
+*/
+static int TMR_FormatSTLFacet(const TMR_STLTriangle *tri, char *text) {
+  double n[3];
+  compute_normal(*tri, n);
+
+  int len = sprintf(text, "facet normal %e %e %e\nouter loop\n", n[0], n[1],
+                    n[2]);
+  for (int k = 0; k < 3; k++) {
+    len += sprintf(&text[len], "vertex %e %e %e\n", tri->p[k].x, tri->p[k].y,
+                   tri->p[k].z);
+  }
+  len += sprintf(&text[len], "endloop\nendfacet\n");
+
+  return len;
+}
+
+/*
+  Take the binary file generated from above and convert to the .STL
+  data format.
+
+  The triangles are streamed from the input file in chunks. The facets
+  within each chunk are formatted or packed concurrently when compiled
+  with OpenMP, and then written out in order.
+*/
+int TMR_ConvertBinToSTL(const char *binfile, const char *stlfile,
+                        int binary_stl) {
+  TMRBinTriangleReader *reader = new TMRBinTriangleReader(binfile);
+  int ntris = reader->getNumTriangles();
+  if (ntris < 0) {
+    fprintf(stderr, "TMR_ConvertBinToSTL: Could not read file %s\n", binfile);
+    delete reader;
     return 1;
   }
 
-  // Read in the triangles themselves
-  TMR_STLTriangle *tris = new TMR_STLTriangle[ntris];
-  unsigned int unsigned_ntris = ntris;
-  if (fread(tris, sizeof(TMR_STLTriangle), ntris, fp) != unsigned_ntris) {
-    delete[] tris;
+  FILE *fp = fopen(stlfile, (binary_stl ? "wb" : "w"));
+  if (!fp) {
+    fprintf(stderr, "TMR_ConvertBinToSTL: Could not open file %s\n", stlfile);
+    delete reader;
     return 1;
   }
 
-  TriangleList *list = new TriangleList(tris, ntris);
-  list->writeSTLFile(stlfile);
-  delete list;
+  // Write the header
+  if (binary_stl) {
+    char header[TMR_STL_HEADER_SIZE + sizeof(uint32_t)];
+    memset(header, 0, sizeof(header));
+    snprintf(header, TMR_STL_HEADER_SIZE, "TMR level set");
+    uint32_t ntotal = ntris;
+    memcpy(&header[TMR_STL_HEADER_SIZE], &ntotal, sizeof(uint32_t));
+    fwrite(header, 1, sizeof(header), fp);
+  } else {
+    fprintf(fp, "solid topology\n");
+  }
+
+  // Set the number of blocks within each chunk
+  int nblocks = 1;
+#ifdef TMR_HAS_OPENMP
+  nblocks = TMR_STL_BLOCKS_PER_THREAD * omp_get_max_threads();
+#endif  // TMR_HAS_OPENMP
+
+  // Allocate space for the triangles and the output
+  const int chunk_size = TMR_STL_CONVERT_CHUNK_SIZE;
+  const int record_size =
+      (binary_stl ? TMR_STL_RECORD_SIZE : TMR_STL_MAX_FACET_TEXT);
+  TMR_STLTriangle *tris = new TMR_STLTriangle[chunk_size];
+  char *buffer = new char[(size_t)record_size * chunk_size];
+  int *block_len = new int[nblocks];
+
+  int fail = 0;
+  for (long long int start = 0; start < ntris; start += chunk_size) {
+    int n = chunk_size;
+    if (start + n > ntris) {
+      n = ntris - start;
+    }
+    if (reader->readTriangles(start, n, tris)) {
+      fprintf(stderr, "TMR_ConvertBinToSTL: Failed reading file %s\n",
+              binfile);
+      fail = 1;
+      break;
+    }
+
+    // Format each block of triangles into its own segment of the
+    // buffer
+#ifdef TMR_HAS_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif  // TMR_HAS_OPENMP
+    for (int k = 0; k < nblocks; k++) {
+      int kstart = (int)(((long int)n * k) / nblocks);
+      int kend = (int)(((long int)n * (k + 1)) / nblocks);
+      char *text = &buffer[(size_t)record_size * kstart];
+      int len = 0;
+      for (int i = kstart; i < kend; i++) {
+        if (binary_stl) {
+          TMR_PackSTLRecord(&tris[i], &text[len]);
+          len += TMR_STL_RECORD_SIZE;
+        } else {
+          len += TMR_FormatSTLFacet(&tris[i], &text[len]);
+        }
+      }
+      block_len[k] = len;
+    }
+
+    // Write the blocks out in order
+    for (int k = 0; k < nblocks; k++) {
+      int kstart = (int)(((long int)n * k) / nblocks);
+      size_t len = block_len[k];
+      if (fwrite(&buffer[(size_t)record_size * kstart], 1, len, fp) != len) {
+        fail = 1;
+      }
+    }
+    if (fail) {
+      fprintf(stderr, "TMR_ConvertBinToSTL: Failed writing file %s\n",
+              stlfile);
+      break;
+    }
+  }
+
+  if (!binary_stl) {
+    fprintf(fp, "endsolid topology\n");
+  }
+  fclose(fp);
+
+  delete[] tris;
+  delete[] buffer;
+  delete[] block_len;
+  delete reader;
+
+  return fail;
+}
+
+/*
+  A hash table that welds the vertices of the triangles
+
+  Vertices are identified by the single-precision values of their
+  coordinates, which are the values that are written out. The
+  intersection points on an edge shared by neighboring elements are
+  computed from the same data on each element, so they are welded
+  into a single vertex.
+*/
+class TMRVertexWelder {
+ public:
+  TMRVertexWelder() {
+    nverts = 0;
+    max_verts = 1024;
+    verts = new float[3 * max_verts];
+    table_size = 2 * max_verts;
+    table = new int[table_size];
+    memset(table, 0xff, table_size * sizeof(int));
+  }
+  ~TMRVertexWelder() {
+    delete[] verts;
+    delete[] table;
+  }
+
+  // Add the point and return the index of the welded vertex
+  int addVertex(const TMRPoint *pt) {
+    float v[3];
+    v[0] = pt->x;
+    v[1] = pt->y;
+    v[2] = pt->z;
+    for (int k = 0; k < 3; k++) {
+      if (v[k] == 0.0f) {
+        v[k] = 0.0f;  // Weld -0.0 and 0.0
+      }
+    }
+
+    // Search for the vertex in the table
+    uint32_t mask = table_size - 1;
+    uint32_t index = hashVertex(v) & mask;
+    while (table[index] >= 0) {
+      const float *u = &verts[3 * table[index]];
+      if (u[0] == v[0] && u[1] == v[1] && u[2] == v[2]) {
+        return table[index];
+      }
+      index = (index + 1) & mask;
+    }
+
+    // Add the new vertex
+    if (nverts >= max_verts) {
+      max_verts *= 2;
+      float *temp = new float[3 * max_verts];
+      memcpy(temp, verts, 3 * nverts * sizeof(float));
+      delete[] verts;
+      verts = temp;
+    }
+    table[index] = nverts;
+    memcpy(&verts[3 * nverts], v, 3 * sizeof(float));
+    nverts++;
+
+    // Keep the table less than half full
+    if (2 * nverts > table_size) {
+      rehash();
+    }
+
+    return nverts - 1;
+  }
+
+  // Get the welded vertices
+  int getVertices(const float **_verts) {
+    *_verts = verts;
+    return nverts;
+  }
+
+ private:
+  static uint32_t hashVertex(const float v[]) {
+    uint32_t u[3];
+    memcpy(u, v, 3 * sizeof(uint32_t));
+    uint32_t h = u[0] * 0x9e3779b1U;
+    h = (h ^ (h >> 15) ^ u[1]) * 0x85ebca77U;
+    h = (h ^ (h >> 13) ^ u[2]) * 0xc2b2ae3dU;
+    return h ^ (h >> 16);
+  }
+
+  void rehash() {
+    delete[] table;
+    table_size *= 2;
+    table = new int[table_size];
+    memset(table, 0xff, table_size * sizeof(int));
+    uint32_t mask = table_size - 1;
+    for (int i = 0; i < nverts; i++) {
+      uint32_t index = hashVertex(&verts[3 * i]) & mask;
+      while (table[index] >= 0) {
+        index = (index + 1) & mask;
+      }
+      table[index] = i;
+    }
+  }
+
+  int nverts, max_verts;
+  float *verts;
+  int table_size;
+  int *table;
+};
+
+/*
+  Take the binary file generated from above and convert it to an
+  indexed mesh in the binary .PLY format.
+
+  The vertices of the triangles are welded so that each vertex is
+  stored once, and triangles that collapse when their vertices are
+  welded are discarded. The face indices are held in memory until the
+  number of vertices is known, but the triangles themselves are
+  streamed from the input file.
+*/
+int TMR_ConvertBinToPLY(const char *binfile, const char *plyfile) {
+  TMRBinTriangleReader *reader = new TMRBinTriangleReader(binfile);
+  int ntris = reader->getNumTriangles();
+  if (ntris < 0) {
+    fprintf(stderr, "TMR_ConvertBinToPLY: Could not read file %s\n", binfile);
+    delete reader;
+    return 1;
+  }
+
+  // Weld the vertices of the triangles
+  TMRVertexWelder *welder = new TMRVertexWelder();
+  int nfaces = 0;
+  int *faces = new int[3 * (size_t)ntris];
+  TMR_STLTriangle *tris = new TMR_STLTriangle[TMR_STL_CONVERT_CHUNK_SIZE];
+  int fail = 0;
+  for (long long int start = 0; start < ntris;
+       start += TMR_STL_CONVERT_CHUNK_SIZE) {
+    int n = TMR_STL_CONVERT_CHUNK_SIZE;
+    if (start + n > ntris) {
+      n = ntris - start;
+    }
+    if (reader->readTriangles(start, n, tris)) {
+      fprintf(stderr, "TMR_ConvertBinToPLY: Failed reading file %s\n",
+              binfile);
+      fail = 1;
+      break;
+    }
 
-  return 0;
+    for (int i = 0; i < n; i++) {
+      int *f = &faces[3 * (size_t)nfaces];
+      for (int k = 0; k < 3; k++) {
+        f[k] = welder->addVertex(&tris[i].p[k]);
+      }
+      if (f[0] != f[1] && f[1] != f[2] && f[0] != f[2]) {
+        nfaces++;
+      }
+    }
+  }
+  delete[] tris;
+  delete reader;
+
+  FILE *fp = NULL;
+  if (!fail) {
+    fp = fopen(plyfile, "wb");
+    if (!fp) {
+      fprintf(stderr, "TMR_ConvertBinToPLY: Could not open file %s\n",
+              plyfile);
+      fail = 1;
+    }
+  }
+
+  if (fp) {
+    const float *verts;
+    int nverts = welder->getVertices(&verts);
+
+    // Write the header in the native byte order
+    const uint16_t one = 1;
+    const char *format = "binary_big_endian";
+    if (*(const char *)&one) {
+      format = "binary_little_endian";
+    }
+    fprintf(fp,
+            "ply\nformat %s 1.0\ncomment TMR level set\n"
+            "element vertex %d\nproperty float x\nproperty float y\n"
+            "property float z\nelement face %d\n"
+            "property list uchar int vertex_indices\nend_header\n",
+            format, nverts, nfaces);
+
+    // Write the vertices and then the faces
+    fwrite(verts, sizeof(float), 3 * (size_t)nverts, fp);
+
+    const int face_size = 1 + 3 * sizeof(int);
+    char *buffer = new char[(size_t)face_size * TMR_STL_CONVERT_CHUNK_SIZE];
+    for (int start = 0; start < nfaces; start += TMR_STL_CONVERT_CHUNK_SIZE) {
+      int n = TMR_STL_CONVERT_CHUNK_SIZE;
+      if (start + n > nfaces) {
+        n = nfaces - start;
+      }
+      for (int i = 0; i < n; i++) {
+        char *f = &buffer[(size_t)face_size * i];
+        f[0] = 3;
+        memcpy(&f[1], &faces[3 * (size_t)(start + i)], 3 * sizeof(int));
+      }
+      fwrite(buffer, face_size, n, fp);
+    }
+    delete[] buffer;
+
+    if (ferror(fp)) {
+      fprintf(stderr, "TMR_ConvertBinToPLY: Failed writing file %s\n",
+              plyfile);
+      fail = 1;
+    }
+    fclose(fp);
+  }
+
+  delete[] faces;
+  delete welder;
+
+  return fail;
 }
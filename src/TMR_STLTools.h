@@ -35,10 +35,15 @@
   intermediate binary file format that contains the point loops
 
   2) The point loop data file is post-processed to create the actual
-  STL file in the standard ASCII format.
+  STL file in the standard ASCII or binary format, or an indexed .PLY
+  mesh with welded vertices.
 
   This two-step process is required because the design variables are
   distributed across processors.
+
+  Alternatively, TMR_WriteSTLFile writes a binary STL file directly in
+  a single collective step. When compiled with OpenMP, the triangles
+  on each processor are extracted concurrently.
 */
 
 int TMR_GenerateSTLTriangles(int root, TMROctForest *filter, TACSBVec *x,
@@ -68,13 +73,70 @@ int TMR_GenerateSTLTriangles(int root, TMROctForest *filter, TACSBVec *x,
 extern int TMR_GenerateBinFile(const char *filename, TMROctForest *filter,
                                TACSBVec *x, int x_offset, double cutoff);
 
+/*
+  Given the design variables, write out the intersection of the level
+  set with the grid directly to a binary STL file.
+
+  This is a collective call that writes a single file using MPI/IO.
+  Each processor writes its triangles at an offset computed from the
+  number of triangles on the lower ranks, so no intermediate file or
+  serial conversion is required. The values are written in the native
+  byte order, which is the little-endian order required by the format
+  on most machines.
+
+  input:
+  filename:   the filename (the same on all processors)
+  filter:     the octant forest
+  x:          the vertex-values of the design variables
+  x_offset:   the offset variable values
+  cutoff      the level set design variable value
+*/
+extern int TMR_WriteSTLFile(const char *filename, TMROctForest *filter,
+                            TACSBVec *x, int x_offset, double cutoff);
+
+/*
+  Write the binary STL file in two phases so that the file I/O can
+  proceed while the caller continues with other work.
+
+  TMR_BeginWriteSTLFile extracts and packs the triangles into a buffer
+  owned by the request and starts the collective write. The design
+  variables may be modified once it returns. TMR_EndWriteSTLFile waits
+  for the write to complete, closes the file and frees the request.
+  Both calls are collective, and every request must be completed,
+  even when TMR_BeginWriteSTLFile returns a failure flag.
+*/
+class TMRSTLFileRequest;
+
+extern int TMR_BeginWriteSTLFile(const char *filename, TMROctForest *filter,
+                                 TACSBVec *x, int x_offset, double cutoff,
+                                 TMRSTLFileRequest **request);
+extern int TMR_EndWriteSTLFile(TMRSTLFileRequest *request);
+
 /*
   Take the binary file generated from above and convert to the .STL
-  data format (in ASCII).
+  data format, either in ASCII (the default) or in binary.
+
+  The binary file is memory-mapped and converted in chunks, so the
+  whole file is never held in memory. When compiled with OpenMP, the
+  triangles within each chunk are formatted concurrently.
+
+  Note that this is a serial code and should only be called by a
+  single processor.
+*/
+extern int TMR_ConvertBinToSTL(const char *binfile, const char *stlfile,
+                               int binary_stl = 0);
+
+/*
+  Take the binary file generated from above and convert it to an
+  indexed triangle mesh in the binary .PLY format.
+
+  The coincident vertices of the triangles are welded together, and
+  triangles that collapse as a result are discarded. Only the welded
+  vertices and the face indices are held in memory.
 
   Note that this is a serial code and should only be called by a
   single processor.
 */
-extern int TMR_ConvertBinToSTL(const char *binfile, const char *stlfile);
+extern int TMR_ConvertBinToPLY(const char *binfile, const char *plyfile);
 
 #endif  // TMR_STL_TOOLS_H
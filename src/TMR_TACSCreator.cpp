@@ -33,6 +33,7 @@ TMRQuadTACSCreator::TMRQuadTACSCreator() {
   bcs = NULL;
   filter = NULL;
   design_vars_per_node = 1;
+  thread_safe_elements = 0;
 }
 
 /*
@@ -65,6 +66,7 @@ void TMRQuadTACSCreator::initialize(TMRBoundaryConditions *_bcs,
   if (filter) {
     filter->incref();
   }
+  thread_safe_elements = 0;
 }
 
 /*
@@ -118,6 +120,7 @@ TACSAssembler *TMRQuadTACSCreator::createTACS(
         int elem_id = quads[j].tag;
         elements[elem_id]->setComponentNum(i);
       }
+      delete array;
     }
   }
 
@@ -292,6 +295,7 @@ TMROctTACSCreator::TMROctTACSCreator() {
   bcs = NULL;
   filter = NULL;
   design_vars_per_node = 1;
+  thread_safe_elements = 0;
 }
 
 /*
@@ -324,6 +328,7 @@ void TMROctTACSCreator::initialize(TMRBoundaryConditions *_bcs,
   if (filter) {
     filter->incref();
   }
+  thread_safe_elements = 0;
 }
 
 /*
@@ -381,6 +386,7 @@ TACSAssembler *TMROctTACSCreator::createTACS(
         int elem_id = octs[j].tag;
         elements[elem_id]->setComponentNum(i);
       }
+      delete array;
     }
   }
 
@@ -457,6 +463,11 @@ TACSAssembler *TMROctTACSCreator::createTACS(
   // Set the node locations
   setNodeLocations(forest, assembler);
 
+  // Release the forest data that is not needed once TACS is created
+  if (forest->getReleaseFlags()) {
+    forest->releaseTransientData(forest->getReleaseFlags());
+  }
+
   return assembler;
 }
 
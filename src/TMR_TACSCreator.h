@@ -31,6 +31,16 @@
   createElement() and optionally the createAuxElement()
   functions. These functions create the appropriate TACS element
   objects needed for TACSAssembler.
+
+  The creators that construct one element at a time through a
+  per-element createElement() call may construct the elements with
+  several threads. This is only done when setThreadSafeElements() has
+  been called with a non-zero flag, which asserts that createElement()
+  may be called concurrently for different elements. The python
+  creators release the GIL in createTACS() when the flag is set and
+  acquire it again within each callback. The flag only applies to the
+  creation of the elements: the elements themselves are not made
+  thread-safe (see TMRSetThreadSafeElements()).
 */
 
 #include "TACSAssembler.h"
@@ -67,6 +77,10 @@ class TMRQuadTACSCreator : public TMREntity {
 
   TMRQuadForest *getFilter() { return filter; }
 
+  // Indicate whether the elements may be created concurrently
+  void setThreadSafeElements(int flag) { thread_safe_elements = flag; }
+  int getThreadSafeElements() { return thread_safe_elements; }
+
  protected:
   // Initialize the data
   void initialize(TMRBoundaryConditions *_bcs, int _design_vars_per_node,
@@ -81,6 +95,7 @@ class TMRQuadTACSCreator : public TMREntity {
   TMRBoundaryConditions *bcs;
   int design_vars_per_node;
   TMRQuadForest *filter;
+  int thread_safe_elements;
 };
 
 /*
@@ -115,6 +130,10 @@ class TMROctTACSCreator : public TMREntity {
 
   TMROctForest *getFilter() { return filter; }
 
+  // Indicate whether the elements may be created concurrently
+  void setThreadSafeElements(int flag) { thread_safe_elements = flag; }
+  int getThreadSafeElements() { return thread_safe_elements; }
+
  protected:
   // Initialize the data
   void initialize(TMRBoundaryConditions *_bcs, int _design_vars_per_node,
@@ -129,6 +148,7 @@ class TMROctTACSCreator : public TMREntity {
   TMRBoundaryConditions *bcs;
   int design_vars_per_node;
   TMROctForest *filter;
+  int thread_safe_elements;
 };
 
 #endif  // TMR_TACS_CREATOR
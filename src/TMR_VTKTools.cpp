@@ -0,0 +1,301 @@
+/*
+  This file is part of the package TMR for adaptive mesh refinement.
+
+  Copyright (C) 2015 Georgia Tech Research Corporation.
+  Additional copyright (C) 2015 Graeme Kennedy.
+  All rights reserved.
+
+  TMR is licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this software except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include "TMR_VTKTools.h"
+
+#include <stdio.h>
+
+#ifdef TMR_HAS_ZLIB
+#include <zlib.h>
+#endif  // TMR_HAS_ZLIB
+
+/*
+  The size of the blocks used when compressing the data arrays
+*/
+static const uint64_t TMR_VTK_BLOCK_SIZE = 1 << 20;
+
+/*
+  A data array that is written to the appended section of the file.
+
+  Each array is preceded by a header. For uncompressed data, the
+  header is the number of bytes in the array. For compressed data, the
+  header consists of the number of blocks, the block size, the size of
+  the last partial block and the compressed size of each block,
+  followed by the compressed blocks.
+*/
+class TMRVTKArray {
+ public:
+  TMRVTKArray() {
+    data = NULL;
+    nbytes = 0;
+    header = NULL;
+    header_size = 0;
+    buffer = NULL;
+    buffer_size = 0;
+  }
+  ~TMRVTKArray() {
+    if (header) {
+      delete[] header;
+    }
+    if (buffer) {
+      delete[] buffer;
+    }
+  }
+
+  // Set the data and compress it (if required)
+  void setData(const void *_data, uint64_t _nbytes, int compress) {
+    data = (const char *)_data;
+    nbytes = _nbytes;
+#ifdef TMR_HAS_ZLIB
+    if (compress) {
+      uint64_t nblocks =
+          (nbytes + TMR_VTK_BLOCK_SIZE - 1) / TMR_VTK_BLOCK_SIZE;
+      header_size = 3 + nblocks;
+      header = new uint64_t[header_size];
+      header[0] = nblocks;
+      header[1] = TMR_VTK_BLOCK_SIZE;
+      header[2] = nbytes % TMR_VTK_BLOCK_SIZE;
+
+      // Compress each block into one contiguous buffer
+      uLong bound = compressBound(TMR_VTK_BLOCK_SIZE);
+      buffer = new char[nblocks * bound];
+      buffer_size = 0;
+      for (uint64_t i = 0; i < nblocks; i++) {
+        uint64_t offset = i * TMR_VTK_BLOCK_SIZE;
+        uint64_t size = nbytes - offset;
+        if (size > TMR_VTK_BLOCK_SIZE) {
+          size = TMR_VTK_BLOCK_SIZE;
+        }
+        uLongf len = bound;
+        compress2((Bytef *)&buffer[buffer_size], &len,
+                  (const Bytef *)&data[offset], size, Z_BEST_SPEED);
+        header[3 + i] = len;
+        buffer_size += len;
+      }
+      return;
+    }
+#endif  // TMR_HAS_ZLIB
+    header_size = 1;
+    header = new uint64_t[1];
+    header[0] = nbytes;
+  }
+
+  // Get the total size of the array in the appended section
+  uint64_t getSize() {
+    if (buffer) {
+      return sizeof(uint64_t) * header_size + buffer_size;
+    }
+    return sizeof(uint64_t) * header_size + nbytes;
+  }
+
+  // Write the array to the file
+  void write(FILE *fp) {
+    fwrite(header, sizeof(uint64_t), header_size, fp);
+    if (buffer) {
+      fwrite(buffer, 1, buffer_size, fp);
+    } else {
+      fwrite(data, 1, nbytes, fp);
+    }
+  }
+
+ private:
+  const char *data;
+  uint64_t nbytes;
+  uint64_t *header;
+  uint64_t header_size;
+  char *buffer;
+  uint64_t buffer_size;
+};
+
+/*
+  Get the byte order of this machine
+*/
+static const char *TMR_VTKByteOrder() {
+  int one = 1;
+  if (*(char *)&one == 1) {
+    return "LittleEndian";
+  }
+  return "BigEndian";
+}
+
+/*
+  Write the file header for the .vtu and .pvtu files
+*/
+static void TMR_WriteVTKFileHeader(FILE *fp, const char *type,
+                                   int compress) {
+  fprintf(fp, "<?xml version=\"1.0\"?>\n");
+  fprintf(fp,
+          "<VTKFile type=\"%s\" version=\"1.0\" byte_order=\"%s\" "
+          "header_type=\"UInt64\"",
+          type, TMR_VTKByteOrder());
+  if (compress) {
+    fprintf(fp, " compressor=\"vtkZLibDataCompressor\"");
+  }
+  fprintf(fp, ">\n");
+}
+
+/*
+  Write a single unstructured mesh to a binary .vtu file
+*/
+int TMR_WriteVTUFile(const char *filename, int npts, const TMRPoint *X,
+                     int ncells, const int *ptr, const int *conn,
+                     const int *cell_types, int nfields,
+                     const char *field_names[], const double *fields[],
+                     int compress) {
+#ifndef TMR_HAS_ZLIB
+  compress = 0;
+#endif  // TMR_HAS_ZLIB
+
+  FILE *fp = fopen(filename, "wb");
+  if (!fp) {
+    fprintf(stderr, "TMR_WriteVTUFile: Could not open file %s\n", filename);
+    return 1;
+  }
+
+  // Set the offsets and cell types in the format required by VTK
+  int32_t *offsets = new int32_t[ncells];
+  uint8_t *types = new uint8_t[ncells];
+  for (int i = 0; i < ncells; i++) {
+    offsets[i] = ptr[i + 1];
+    types[i] = cell_types[i];
+  }
+
+  // Set the data for all of the arrays
+  const int narrays = 4 + nfields;
+  TMRVTKArray *arrays = new TMRVTKArray[narrays];
+  arrays[0].setData(X, 3 * sizeof(double) * npts, compress);
+  arrays[1].setData(conn, sizeof(int32_t) * ptr[ncells], compress);
+  arrays[2].setData(offsets, sizeof(int32_t) * ncells, compress);
+  arrays[3].setData(types, sizeof(uint8_t) * ncells, compress);
+  for (int k = 0; k < nfields; k++) {
+    arrays[4 + k].setData(fields[k], sizeof(double) * ncells, compress);
+  }
+
+  // Compute the offset to each array within the appended section
+  uint64_t *aoffset = new uint64_t[narrays + 1];
+  aoffset[0] = 0;
+  for (int k = 0; k < narrays; k++) {
+    aoffset[k + 1] = aoffset[k] + arrays[k].getSize();
+  }
+
+  TMR_WriteVTKFileHeader(fp, "UnstructuredGrid", compress);
+  fprintf(fp, "<UnstructuredGrid>\n");
+  fprintf(fp, "<Piece NumberOfPoints=\"%d\" NumberOfCells=\"%d\">\n", npts,
+          ncells);
+  fprintf(fp, "<Points>\n");
+  fprintf(fp,
+          "<DataArray type=\"Float64\" NumberOfComponents=\"3\" "
+          "format=\"appended\" offset=\"%llu\"/>\n",
+          (unsigned long long)aoffset[0]);
+  fprintf(fp, "</Points>\n");
+  fprintf(fp, "<Cells>\n");
+  fprintf(fp,
+          "<DataArray type=\"Int32\" Name=\"connectivity\" "
+          "format=\"appended\" offset=\"%llu\"/>\n",
+          (unsigned long long)aoffset[1]);
+  fprintf(fp,
+          "<DataArray type=\"Int32\" Name=\"offsets\" "
+          "format=\"appended\" offset=\"%llu\"/>\n",
+          (unsigned long long)aoffset[2]);
+  fprintf(fp,
+          "<DataArray type=\"UInt8\" Name=\"types\" "
+          "format=\"appended\" offset=\"%llu\"/>\n",
+          (unsigned long long)aoffset[3]);
+  fprintf(fp, "</Cells>\n");
+  if (nfields > 0) {
+    fprintf(fp, "<CellData Scalars=\"%s\">\n", field_names[0]);
+    for (int k = 0; k < nfields; k++) {
+      fprintf(fp,
+              "<DataArray type=\"Float64\" Name=\"%s\" "
+              "format=\"appended\" offset=\"%llu\"/>\n",
+              field_names[k], (unsigned long long)aoffset[4 + k]);
+    }
+    fprintf(fp, "</CellData>\n");
+  }
+  fprintf(fp, "</Piece>\n");
+  fprintf(fp, "</UnstructuredGrid>\n");
+
+  // Write out the binary data
+  fprintf(fp, "<AppendedData encoding=\"raw\">\n_");
+  for (int k = 0; k < narrays; k++) {
+    arrays[k].write(fp);
+  }
+  fprintf(fp, "\n</AppendedData>\n");
+  fprintf(fp, "</VTKFile>\n");
+  fclose(fp);
+
+  delete[] offsets;
+  delete[] types;
+  delete[] arrays;
+  delete[] aoffset;
+
+  return 0;
+}
+
+/*
+  Write the .pvtu file that collects the pieces from each processor
+*/
+int TMR_WritePVTUFile(const char *prefix, int npieces, int nfields,
+                      const char *field_names[]) {
+  char *filename = new char[strlen(prefix) + 10];
+  sprintf(filename, "%s.pvtu", prefix);
+  FILE *fp = fopen(filename, "w");
+  if (!fp) {
+    fprintf(stderr, "TMR_WritePVTUFile: Could not open file %s\n", filename);
+    delete[] filename;
+    return 1;
+  }
+  delete[] filename;
+
+  // The pieces are referenced relative to the .pvtu file
+  const char *base = strrchr(prefix, '/');
+  if (base) {
+    base++;
+  } else {
+    base = prefix;
+  }
+
+  TMR_WriteVTKFileHeader(fp, "PUnstructuredGrid", 0);
+  fprintf(fp, "<PUnstructuredGrid GhostLevel=\"0\">\n");
+  fprintf(fp, "<PPoints>\n");
+  fprintf(fp, "<PDataArray type=\"Float64\" NumberOfComponents=\"3\"/>\n");
+  fprintf(fp, "</PPoints>\n");
+  fprintf(fp, "<PCells>\n");
+  fprintf(fp, "<PDataArray type=\"Int32\" Name=\"connectivity\"/>\n");
+  fprintf(fp, "<PDataArray type=\"Int32\" Name=\"offsets\"/>\n");
+  fprintf(fp, "<PDataArray type=\"UInt8\" Name=\"types\"/>\n");
+  fprintf(fp, "</PCells>\n");
+  if (nfields > 0) {
+    fprintf(fp, "<PCellData Scalars=\"%s\">\n", field_names[0]);
+    for (int k = 0; k < nfields; k++) {
+      fprintf(fp, "<PDataArray type=\"Float64\" Name=\"%s\"/>\n",
+              field_names[k]);
+    }
+    fprintf(fp, "</PCellData>\n");
+  }
+  for (int k = 0; k < npieces; k++) {
+    fprintf(fp, "<Piece Source=\"%s_%d.vtu\"/>\n", base, k);
+  }
+  fprintf(fp, "</PUnstructuredGrid>\n");
+  fprintf(fp, "</VTKFile>\n");
+  fclose(fp);
+
+  return 0;
+}
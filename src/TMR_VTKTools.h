@@ -0,0 +1,93 @@
+/*
+  This file is part of the package TMR for adaptive mesh refinement.
+
+  Copyright (C) 2015 Georgia Tech Research Corporation.
+  Additional copyright (C) 2015 Graeme Kennedy.
+  All rights reserved.
+
+  TMR is licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this software except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef TMR_VTK_TOOLS_H
+#define TMR_VTK_TOOLS_H
+
+#include "TMRBase.h"
+
+/*
+  The following file contains tools for writing unstructured meshes
+  to the binary VTK XML format (.vtu) with the data stored in the
+  appended section of the file.
+
+  In parallel, each processor writes its own piece of the mesh to a
+  separate .vtu file and the root processor writes a .pvtu file that
+  collects all of the pieces.
+
+  If TMR is compiled with -DTMR_HAS_ZLIB (and linked with -lz), the
+  data arrays can be compressed with zlib. Otherwise the compression
+  flag is ignored and the data is written uncompressed.
+*/
+
+// The VTK cell types used within TMR
+const int TMR_VTK_TRIANGLE = 5;
+const int TMR_VTK_QUAD = 9;
+const int TMR_VTK_HEXAHEDRON = 12;
+
+/*
+  Write a single unstructured mesh to a binary .vtu file
+
+  The cells are specified in compressed row format so that cells of
+  different types can be mixed. This is a serial call.
+
+  input:
+  filename:     the name of the file
+  npts:         the number of points
+  X:            the point locations
+  ncells:       the number of cells
+  ptr:          pointer into the connectivity for each cell
+  conn:         the cell connectivity
+  cell_types:   the VTK cell type for each cell
+  nfields:      the number of cell-data fields
+  field_names:  the names of the cell-data fields
+  fields:       the cell-data field values (ncells values per field)
+  compress:     flag to indicate whether to compress the data
+
+  returns:
+  a non-zero value if the file could not be written
+*/
+int TMR_WriteVTUFile(const char *filename, int npts, const TMRPoint *X,
+                     int ncells, const int *ptr, const int *conn,
+                     const int *cell_types, int nfields,
+                     const char *field_names[], const double *fields[],
+                     int compress = 0);
+
+/*
+  Write the .pvtu file that collects the pieces written by each
+  processor.
+
+  The pieces must be named prefix_<rank>.vtu and must be located in
+  the same directory as the prefix.pvtu file. This should only be
+  called on a single processor.
+
+  input:
+  prefix:       the file prefix (including the directory)
+  npieces:      the number of pieces
+  nfields:      the number of cell-data fields
+  field_names:  the names of the cell-data fields
+
+  returns:
+  a non-zero value if the file could not be written
+*/
+int TMR_WritePVTUFile(const char *prefix, int npieces, int nfields,
+                      const char *field_names[]);
+
+#endif  // TMR_VTK_TOOLS_H
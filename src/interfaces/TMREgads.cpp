@@ -20,12 +20,33 @@
 
 #include "TMREgads.h"
 
+#include <math.h>
+
 #include <map>
 
+#include "TMRFeatureSize.h"
+
 #ifdef TMR_HAS_EGADS
 
+#ifdef TMR_HAS_OPENMP
+#include <omp.h>
+#endif
+
 using namespace TMR_EgadsInterface;
 
+/*
+  Check if the calling thread is within an OpenMP parallel region. The
+  evaluation cache and the seed locators are not modified within a
+  parallel region.
+*/
+static int in_parallel_region() {
+#ifdef TMR_HAS_OPENMP
+  return omp_in_parallel();
+#else
+  return 0;
+#endif  // TMR_HAS_OPENMP
+}
+
 TMR_EgadsContext::TMR_EgadsContext() {
   EG_open(&ctx);
   ismine = 1;
@@ -44,6 +65,134 @@ TMR_EgadsContext::~TMR_EgadsContext() {
 
 ego TMR_EgadsContext::getContext() { return ctx; }
 
+/*
+  Create the body tessellation object. The tessellation itself is
+  only created when it is first required.
+*/
+TMR_EgadsBodyTess::TMR_EgadsBodyTess(TMR_EgadsContext *_ctx, ego _body) {
+  ctx = _ctx;
+  ctx->incref();
+  body = _body;
+  tess = NULL;
+  tess_fail = 0;
+}
+
+TMR_EgadsBodyTess::~TMR_EgadsBodyTess() {
+  if (tess) {
+    EG_deleteObject(tess);
+  }
+  ctx->decref();
+}
+
+/*
+  Create a coarse tessellation of the body scaled by the size of its
+  bounding box. Returns a non-zero value if the tessellation fails.
+*/
+int TMR_EgadsBodyTess::createTess() {
+  if (!tess && !tess_fail) {
+    double box[6];
+    int icode = EG_getBoundingBox(body, box);
+    if (icode == EGADS_SUCCESS) {
+      double dx = box[3] - box[0];
+      double dy = box[4] - box[1];
+      double dz = box[5] - box[2];
+      double size = sqrt(dx * dx + dy * dy + dz * dz);
+
+      // The maximum edge length, sag and dihedral angle
+      double params[3];
+      params[0] = 0.05 * size;
+      params[1] = 0.005 * size;
+      params[2] = 30.0;
+      icode = EG_makeTessBody(body, params, &tess);
+    }
+    if (icode != EGADS_SUCCESS) {
+      tess = NULL;
+      tess_fail = 1;
+    }
+  }
+
+  return (tess == NULL);
+}
+
+/*
+  Get the tessellation points and parameters on an edge of the body
+*/
+int TMR_EgadsBodyTess::getTessEdge(ego edge, int *npts, const double **xyz,
+                                   const double **t) {
+  *npts = 0;
+  if (createTess()) {
+    return 1;
+  }
+
+  int index = EG_indexBodyTopo(body, edge);
+  if (index <= 0) {
+    return 1;
+  }
+
+  int icode = EG_getTessEdge(tess, index, npts, xyz, t);
+  return (icode != EGADS_SUCCESS || *npts == 0);
+}
+
+/*
+  Get the tessellation points and parameters on a face of the body
+*/
+int TMR_EgadsBodyTess::getTessFace(ego face, int *npts, const double **xyz,
+                                   const double **uv) {
+  *npts = 0;
+  if (createTess()) {
+    return 1;
+  }
+
+  int index = EG_indexBodyTopo(body, face);
+  if (index <= 0) {
+    return 1;
+  }
+
+  const int *ptype, *pindex, *tris, *tric;
+  int ntris;
+  int icode = EG_getTessFace(tess, index, npts, xyz, uv, &ptype, &pindex,
+                             &ntris, &tris, &tric);
+  return (icode != EGADS_SUCCESS || *npts == 0);
+}
+
+TMR_EgadsEvalCache::TMR_EgadsEvalCache() {
+  num_entries = 0;
+  next = 0;
+}
+
+/*
+  Evaluate the object, re-using the result of a recent evaluation at
+  the same parameters if one exists
+*/
+int TMR_EgadsEvalCache::evaluate(ego obj, const double params[],
+                                 double eval[]) {
+  if (in_parallel_region()) {
+    double p[2] = {params[0], params[1]};
+    return EG_evaluate(obj, p, eval);
+  }
+
+  for (int i = 0; i < num_entries; i++) {
+    if (cache_params[i][0] == params[0] && cache_params[i][1] == params[1]) {
+      memcpy(eval, cache_evals[i], 18 * sizeof(double));
+      return cache_icodes[i];
+    }
+  }
+
+  // Replace the oldest entry in the cache
+  int i = next;
+  next = (next + 1) % CACHE_SIZE;
+  if (num_entries < CACHE_SIZE) {
+    num_entries++;
+  }
+
+  cache_params[i][0] = params[0];
+  cache_params[i][1] = params[1];
+  cache_icodes[i] = EG_evaluate(obj, cache_params[i], cache_evals[i]);
+  memcpy(eval, cache_evals[i], 18 * sizeof(double));
+
+  return cache_icodes[i];
+}
+
 TMR_EgadsNode::TMR_EgadsNode(TMR_EgadsContext *_ctx, ego _node) {
   ctx = _ctx;
   ctx->incref();
@@ -108,9 +257,112 @@ TMR_EgadsEdge::TMR_EgadsEdge(TMR_EgadsContext *_ctx, ego _edge,
   ctx->incref();
   edge = _edge;
   is_degenerate = _is_degenerate;
+  body_tess = NULL;
+  seed_init = 0;
+  seed_locator = NULL;
+  seed_params = NULL;
 }
 
-TMR_EgadsEdge::~TMR_EgadsEdge() { ctx->decref(); }
+TMR_EgadsEdge::~TMR_EgadsEdge() {
+  ctx->decref();
+  if (body_tess) {
+    body_tess->decref();
+  }
+  if (seed_locator) {
+    seed_locator->decref();
+  }
+  if (seed_params) {
+    delete[] seed_params;
+  }
+}
+
+/*
+  Set the body tessellation used to seed the inverse evaluation
+*/
+void TMR_EgadsEdge::setBodyTess(TMR_EgadsBodyTess *_body_tess) {
+  if (_body_tess) {
+    _body_tess->incref();
+  }
+  if (body_tess) {
+    body_tess->decref();
+  }
+  body_tess = _body_tess;
+}
+
+/*
+  Evaluate the edge and its derivatives through the cache
+*/
+int TMR_EgadsEdge::evaluate(double t, double eval[]) {
+  double params[2];
+  params[0] = t;
+  params[1] = 0.0;
+  return cache.evaluate(edge, params, eval);
+}
+
+/*
+  Create the point locator from the tessellation points on the edge
+*/
+void TMR_EgadsEdge::initSeedLocator() {
+  if (seed_init) {
+    return;
+  }
+  seed_init = 1;
+
+  int npts = 0;
+  const double *xyz, *t;
+  if (!body_tess || is_degenerate ||
+      body_tess->getTessEdge(edge, &npts, &xyz, &t)) {
+    return;
+  }
+
+  TMRPoint *X = new TMRPoint[npts];
+  seed_params = new double[npts];
+  for (int i = 0; i < npts; i++) {
+    X[i].x = xyz[3 * i];
+    X[i].y = xyz[3 * i + 1];
+    X[i].z = xyz[3 * i + 2];
+    seed_params[i] = t[i];
+  }
+  seed_locator = new TMRPointLocator(npts, X);
+  seed_locator->incref();
+  delete[] X;
+}
+
+/*
+  Perform the inverse evaluation starting from the parameter of the
+  closest tessellation point, if available
+*/
+int TMR_EgadsEdge::invEvaluate(TMRPoint X, double *t) {
+  // Set the position
+  double pos[3];
+  pos[0] = X.x;
+  pos[1] = X.y;
+  pos[2] = X.z;
+
+  double params[2];
+  double result[3];
+  int icode = EGADS_NOTFOUND;
+  if (seed_locator) {
+    int nk, index;
+    double dist;
+    seed_locator->locateClosest(1, X, &nk, &index, &dist);
+    if (nk > 0) {
+      params[0] = seed_params[index];
+      params[1] = 0.0;
+      icode = EG_invEvaluateGuess(edge, pos, params, result);
+    }
+  }
+
+  // Fall back to the inverse evaluation without a guess
+  if (icode != EGADS_SUCCESS) {
+    icode = EG_invEvaluate(edge, pos, params, result);
+  }
+
+  // Set the parameters
+  *t = params[0];
+
+  return icode;
+}
 
 void TMR_EgadsEdge::getRange(double *tmin, double *tmax) {
   double range[4];
@@ -154,12 +406,7 @@ int TMR_EgadsEdge::getParamsOnFace(TMRFace *surface, double t, int dir,
 
 int TMR_EgadsEdge::evalPoint(double t, TMRPoint *X) {
   double eval[18];
-
-  // Evaluate the position of the object
-  double params[2];
-  params[0] = t;
-  params[1] = 0.0;
-  int icode = EG_evaluate(edge, params, eval);
+  int icode = evaluate(t, eval);
 
   X->x = eval[0];
   X->y = eval[1];
@@ -168,31 +415,34 @@ int TMR_EgadsEdge::evalPoint(double t, TMRPoint *X) {
 }
 
 int TMR_EgadsEdge::invEvalPoint(TMRPoint X, double *t) {
-  // Set the position
-  double pos[3];
-  pos[0] = X.x;
-  pos[1] = X.y;
-  pos[2] = X.z;
-
-  // Perform the inverse evaluation
-  double params[2];
-  double result[3];
-  int icode = EG_invEvaluate(edge, pos, params, result);
+  if (!in_parallel_region()) {
+    initSeedLocator();
+  }
+  return invEvaluate(X, t);
+}
 
-  // Set the parameters
-  *t = params[0];
+/*
+  Perform the inverse evaluation for a batch of points on the edge.
+  EGADS is not thread-safe within a context, so the points are
+  evaluated in serial.
+*/
+int TMR_EgadsEdge::invEvalPoints(int n, const TMRPoint X[], double t[]) {
+  if (!in_parallel_region()) {
+    initSeedLocator();
+  }
 
-  return icode;
+  int fail = 0;
+  for (int i = 0; i < n; i++) {
+    if (invEvaluate(X[i], &t[i])) {
+      fail = 1;
+    }
+  }
+  return fail;
 }
 
 int TMR_EgadsEdge::evalDeriv(double t, TMRPoint *X, TMRPoint *Xt) {
   double eval[18];
-
-  // Evaluate the position of the object
-  double params[2];
-  params[0] = t;
-  params[1] = 0.0;
-  int icode = EG_evaluate(edge, params, eval);
+  int icode = evaluate(t, eval);
 
   X->x = eval[0];
   X->y = eval[1];
@@ -208,12 +458,7 @@ int TMR_EgadsEdge::evalDeriv(double t, TMRPoint *X, TMRPoint *Xt) {
 int TMR_EgadsEdge::eval2ndDeriv(double t, TMRPoint *X, TMRPoint *Xt,
                                 TMRPoint *Xtt) {
   double eval[18];
-
-  // Evaluate the position of the object
-  double params[2];
-  params[0] = t;
-  params[1] = 0.0;
-  int icode = EG_evaluate(edge, params, eval);
+  int icode = evaluate(t, eval);
 
   X->x = eval[0];
   X->y = eval[1];
@@ -250,9 +495,113 @@ TMR_EgadsFace::TMR_EgadsFace(TMR_EgadsContext *_ctx, int _normal_dir, ego _face)
   ctx = _ctx;
   ctx->incref();
   face = _face;
+  body_tess = NULL;
+  seed_init = 0;
+  seed_locator = NULL;
+  seed_params = NULL;
+}
+
+TMR_EgadsFace::~TMR_EgadsFace() {
+  ctx->decref();
+  if (body_tess) {
+    body_tess->decref();
+  }
+  if (seed_locator) {
+    seed_locator->decref();
+  }
+  if (seed_params) {
+    delete[] seed_params;
+  }
+}
+
+/*
+  Set the body tessellation used to seed the inverse evaluation
+*/
+void TMR_EgadsFace::setBodyTess(TMR_EgadsBodyTess *_body_tess) {
+  if (_body_tess) {
+    _body_tess->incref();
+  }
+  if (body_tess) {
+    body_tess->decref();
+  }
+  body_tess = _body_tess;
+}
+
+/*
+  Evaluate the face and its derivatives through the cache
+*/
+int TMR_EgadsFace::evaluate(double u, double v, double eval[]) {
+  double params[2];
+  params[0] = u;
+  params[1] = v;
+  return cache.evaluate(face, params, eval);
+}
+
+/*
+  Create the point locator from the tessellation points on the face
+*/
+void TMR_EgadsFace::initSeedLocator() {
+  if (seed_init) {
+    return;
+  }
+  seed_init = 1;
+
+  int npts = 0;
+  const double *xyz, *uv;
+  if (!body_tess || body_tess->getTessFace(face, &npts, &xyz, &uv)) {
+    return;
+  }
+
+  TMRPoint *X = new TMRPoint[npts];
+  seed_params = new double[2 * npts];
+  for (int i = 0; i < npts; i++) {
+    X[i].x = xyz[3 * i];
+    X[i].y = xyz[3 * i + 1];
+    X[i].z = xyz[3 * i + 2];
+    seed_params[2 * i] = uv[2 * i];
+    seed_params[2 * i + 1] = uv[2 * i + 1];
+  }
+  seed_locator = new TMRPointLocator(npts, X);
+  seed_locator->incref();
+  delete[] X;
 }
 
-TMR_EgadsFace::~TMR_EgadsFace() { ctx->decref(); }
+/*
+  Perform the inverse evaluation starting from the parameters of the
+  closest tessellation point, if available
+*/
+int TMR_EgadsFace::invEvaluate(TMRPoint X, double *u, double *v) {
+  // Set the position
+  double pos[3];
+  pos[0] = X.x;
+  pos[1] = X.y;
+  pos[2] = X.z;
+
+  double params[2];
+  double result[3];
+  int icode = EGADS_NOTFOUND;
+  if (seed_locator) {
+    int nk, index;
+    double dist;
+    seed_locator->locateClosest(1, X, &nk, &index, &dist);
+    if (nk > 0) {
+      params[0] = seed_params[2 * index];
+      params[1] = seed_params[2 * index + 1];
+      icode = EG_invEvaluateGuess(face, pos, params, result);
+    }
+  }
+
+  // Fall back to the inverse evaluation without a guess
+  if (icode != EGADS_SUCCESS) {
+    icode = EG_invEvaluate(face, pos, params, result);
+  }
+
+  // Set the parameters
+  *u = params[0];
+  *v = params[1];
+
+  return icode;
+}
 
 void TMR_EgadsFace::getRange(double *umin, double *vmin, double *umax,
                              double *vmax) {
@@ -270,12 +619,7 @@ void TMR_EgadsFace::getRange(double *umin, double *vmin, double *umax,
 
 int TMR_EgadsFace::evalPoint(double u, double v, TMRPoint *X) {
   double eval[18];
-
-  // Evaluate the position of the object
-  double params[2];
-  params[0] = u;
-  params[1] = v;
-  int icode = EG_evaluate(face, params, eval);
+  int icode = evaluate(u, v, eval);
 
   X->x = eval[0];
   X->y = eval[1];
@@ -284,33 +628,36 @@ int TMR_EgadsFace::evalPoint(double u, double v, TMRPoint *X) {
 }
 
 int TMR_EgadsFace::invEvalPoint(TMRPoint X, double *u, double *v) {
-  // Set the position
-  double pos[3];
-  pos[0] = X.x;
-  pos[1] = X.y;
-  pos[2] = X.z;
-
-  // Perform the inverse evaluation
-  double params[2];
-  double result[3];
-  int icode = EG_invEvaluate(face, pos, params, result);
+  if (!in_parallel_region()) {
+    initSeedLocator();
+  }
+  return invEvaluate(X, u, v);
+}
 
-  // Set the parameters
-  *u = params[0];
-  *v = params[1];
+/*
+  Perform the inverse evaluation for a batch of points on the face.
+  EGADS is not thread-safe within a context, so the points are
+  evaluated in serial.
+*/
+int TMR_EgadsFace::invEvalPoints(int n, const TMRPoint X[], double u[],
+                                 double v[]) {
+  if (!in_parallel_region()) {
+    initSeedLocator();
+  }
 
-  return icode;
+  int fail = 0;
+  for (int i = 0; i < n; i++) {
+    if (invEvaluate(X[i], &u[i], &v[i])) {
+      fail = 1;
+    }
+  }
+  return fail;
 }
 
 int TMR_EgadsFace::evalDeriv(double u, double v, TMRPoint *X, TMRPoint *Xu,
                              TMRPoint *Xv) {
   double eval[18];
-
-  // Evaluate the position of the object
-  double params[2];
-  params[0] = u;
-  params[1] = v;
-  int icode = EG_evaluate(face, params, eval);
+  int icode = evaluate(u, v, eval);
 
   X->x = eval[0];
   X->y = eval[1];
@@ -331,12 +678,7 @@ int TMR_EgadsFace::eval2ndDeriv(double u, double v, TMRPoint *X, TMRPoint *Xu,
                                 TMRPoint *Xv, TMRPoint *Xuu, TMRPoint *Xuv,
                                 TMRPoint *Xvv) {
   double eval[18];
-
-  // Evaluate the position of the object
-  double params[2];
-  params[0] = u;
-  params[1] = v;
-  int icode = EG_evaluate(face, params, eval);
+  int icode = evaluate(u, v, eval);
 
   X->x = eval[0];
   X->y = eval[1];
@@ -425,6 +767,10 @@ TMRModel *TMR_EgadsInterface::TMR_ConvertEGADSModel(ego model,
   std::map<ego, int> edge_map;
   std::map<ego, int> face_map;
 
+  // The index of the body containing each edge and face
+  std::map<int, int> edge_body;
+  std::map<int, int> face_body;
+
   // Get the values
   ego ref;
   int oclass, mtype;
@@ -480,6 +826,7 @@ TMRModel *TMR_EgadsInterface::TMR_ConvertEGADSModel(ego model,
     for (int i = 0; i < ntopos; i++) {
       faces[nfaces] = topos[i];
       face_map[topos[i]] = nfaces;
+      face_body[nfaces] = index;
       nfaces++;
     }
     EG_free(topos);
@@ -488,6 +835,7 @@ TMRModel *TMR_EgadsInterface::TMR_ConvertEGADSModel(ego model,
     for (int i = 0; i < ntopos; i++) {
       edges[nedges] = topos[i];
       edge_map[topos[i]] = nedges;
+      edge_body[nedges] = index;
       nedges++;
     }
     EG_free(topos);
@@ -508,6 +856,14 @@ TMRModel *TMR_EgadsInterface::TMR_ConvertEGADSModel(ego model,
         nverts, nedges, nfaces, nsolids);
   }
 
+  // Create the coarse body tessellations used to seed the inverse
+  // evaluations on the edges and faces
+  TMR_EgadsBodyTess **body_tess = new TMR_EgadsBodyTess *[nsolids];
+  for (int index = 0; index < nsolids; index++) {
+    body_tess[index] = new TMR_EgadsBodyTess(ctx, solids[index]);
+    body_tess[index]->incref();
+  }
+
   // Re-iterate through the list and create the objects needed to
   // define the geometry in TMR
   TMRVertex **all_vertices = new TMRVertex *[nverts];
@@ -551,7 +907,11 @@ TMRModel *TMR_EgadsInterface::TMR_ConvertEGADSModel(ego model,
     }
 
     // Set a flag to indicate that the edge is degenerate
-    all_edges[index] = new TMR_EgadsEdge(ctx, edges[index], isdegenerate);
+    TMR_EgadsEdge *edge = new TMR_EgadsEdge(ctx, edges[index], isdegenerate);
+    if (edge_body[index] < nsolids) {
+      edge->setBodyTess(body_tess[edge_body[index]]);
+    }
+    all_edges[index] = edge;
 
     if ((idx1 >= 0 && idx1 < nverts) && (idx2 >= 0 && idx2 < nverts)) {
       all_edges[index]->setVertices(all_vertices[idx1], all_vertices[idx2]);
@@ -592,7 +952,11 @@ TMRModel *TMR_EgadsInterface::TMR_ConvertEGADSModel(ego model,
       orientation = -1;
     }
 
-    all_faces[index] = new TMR_EgadsFace(ctx, orientation, faces[index]);
+    TMR_EgadsFace *face = new TMR_EgadsFace(ctx, orientation, faces[index]);
+    if (face_body[index] < nsolids) {
+      face->setBodyTess(body_tess[face_body[index]]);
+    }
+    all_faces[index] = face;
 
     // Set the "name" attribute
     int atype, len;
@@ -728,6 +1092,12 @@ TMRModel *TMR_EgadsInterface::TMR_ConvertEGADSModel(ego model,
   delete[] all_faces;
   delete[] all_vols;
 
+  // The edges and faces hold their own references to the tessellations
+  for (int index = 0; index < nsolids; index++) {
+    body_tess[index]->decref();
+  }
+  delete[] body_tess;
+
   return geo;
 }
 
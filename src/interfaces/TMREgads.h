@@ -29,6 +29,8 @@
 #include "TMRTopology.h"
 #include "egads.h"
 
+class TMRPointLocator;
+
 namespace TMR_EgadsInterface {
 
 class TMR_EgadsContext : public TMREntity {
@@ -43,6 +45,47 @@ class TMR_EgadsContext : public TMREntity {
   ego ctx;
 };
 
+/*
+  A coarse tessellation of an EGADS body. This is used to find initial
+  guesses for the inverse evaluation on the edges and faces of the
+  body. The tessellation is created when it is first required.
+*/
+class TMR_EgadsBodyTess : public TMREntity {
+ public:
+  TMR_EgadsBodyTess(TMR_EgadsContext *_ctx, ego _body);
+  ~TMR_EgadsBodyTess();
+
+  // Get the tessellation points on an edge or face of the body
+  int getTessEdge(ego edge, int *npts, const double **xyz, const double **t);
+  int getTessFace(ego face, int *npts, const double **xyz, const double **uv);
+
+ private:
+  int createTess();
+
+  TMR_EgadsContext *ctx;
+  ego body, tess;
+  int tess_fail;
+};
+
+/*
+  A small cache of the most recent evaluations of an EGADS edge or
+  face. EG_evaluate computes the point and all its derivatives at
+  once, so repeated point and derivative evaluations at the same
+  parameters only require a single call.
+*/
+class TMR_EgadsEvalCache {
+ public:
+  TMR_EgadsEvalCache();
+  int evaluate(ego obj, const double params[], double eval[]);
+
+ private:
+  static const int CACHE_SIZE = 4;
+  int num_entries, next;
+  double cache_params[CACHE_SIZE][2];
+  double cache_evals[CACHE_SIZE][18];
+  int cache_icodes[CACHE_SIZE];
+};
+
 /*
   Topoloy objects from EGADS:
 
@@ -72,6 +115,7 @@ class TMR_EgadsEdge : public TMREdge {
   void getRange(double *tmin, double *tmax);
   int evalPoint(double t, TMRPoint *X);
   int invEvalPoint(TMRPoint X, double *t);
+  int invEvalPoints(int n, const TMRPoint X[], double t[]);
   int evalDeriv(double t, TMRPoint *X, TMRPoint *Xt);
   int eval2ndDeriv(double t, TMRPoint *X, TMRPoint *Xt, TMRPoint *Xtt);
   int getParamsOnFace(TMRFace *face, double t, int dir, double *u, double *v);
@@ -79,10 +123,26 @@ class TMR_EgadsEdge : public TMREdge {
   int isDegenerate();
   void getEdgeObject(ego *e);
 
+  // Set the body tessellation used for the inverse evaluation
+  void setBodyTess(TMR_EgadsBodyTess *_body_tess);
+
  private:
+  int evaluate(double t, double eval[]);
+  void initSeedLocator();
+  int invEvaluate(TMRPoint X, double *t);
+
   TMR_EgadsContext *ctx;
   ego edge;
   int is_degenerate;
+
+  // The cached evaluations
+  TMR_EgadsEvalCache cache;
+
+  // The tessellation points used to seed the inverse evaluation
+  TMR_EgadsBodyTess *body_tess;
+  int seed_init;
+  TMRPointLocator *seed_locator;
+  double *seed_params;
 };
 
 class TMR_EgadsFace : public TMRFace {
@@ -92,15 +152,32 @@ class TMR_EgadsFace : public TMRFace {
   void getRange(double *umin, double *vmin, double *umax, double *vmax);
   int evalPoint(double u, double v, TMRPoint *X);
   int invEvalPoint(TMRPoint p, double *u, double *v);
+  int invEvalPoints(int n, const TMRPoint p[], double u[], double v[]);
   int evalDeriv(double u, double v, TMRPoint *X, TMRPoint *Xu, TMRPoint *Xv);
   int eval2ndDeriv(double u, double v, TMRPoint *X, TMRPoint *Xu, TMRPoint *Xv,
                    TMRPoint *Xuu, TMRPoint *Xuv, TMRPoint *Xvv);
   int isSame(TMRFace *v);
   void getFaceObject(ego *f);
 
+  // Set the body tessellation used for the inverse evaluation
+  void setBodyTess(TMR_EgadsBodyTess *_body_tess);
+
  private:
+  int evaluate(double u, double v, double eval[]);
+  void initSeedLocator();
+  int invEvaluate(TMRPoint X, double *u, double *v);
+
   TMR_EgadsContext *ctx;
   ego face;
+
+  // The cached evaluations
+  TMR_EgadsEvalCache cache;
+
+  // The tessellation points used to seed the inverse evaluation
+  TMR_EgadsBodyTess *body_tess;
+  int seed_init;
+  TMRPointLocator *seed_locator;
+  double *seed_params;
 };
 
 /*
@@ -22,6 +22,92 @@
 
 #ifdef TMR_HAS_OPENCASCADE
 
+#include <stdint.h>
+#include <unistd.h>
+
+#include <sstream>
+#include <string>
+
+#ifdef TMR_HAS_OPENMP
+#include <omp.h>
+#endif
+
+/*
+  The minimum number of points in a batch that is evaluated in
+  parallel. Smaller batches are evaluated by a single thread.
+*/
+static const int TMR_OCC_PARALLEL_BATCH_SIZE = 64;
+
+/*
+  Check if the calling thread is within an OpenMP parallel region. The
+  cached OpenCascade evaluators are not thread-safe, so evaluations
+  within a parallel region use their own local evaluators instead.
+*/
+static int in_parallel_region() {
+#ifdef TMR_HAS_OPENMP
+  return omp_in_parallel();
+#else
+  return 0;
+#endif  // TMR_HAS_OPENMP
+}
+
+/*
+  Initialize the projection onto the 3D curve of the edge
+*/
+static int init_curve_projection(const TopoDS_Edge &edge,
+                                 GeomAPI_ProjectPointOnCurve *projection) {
+  double t0, t1;
+  const Handle(Geom_Curve) curve = BRep_Tool::Curve(edge, t0, t1);
+  if (curve.IsNull()) {
+    return 1;
+  }
+  projection->Init(curve, curve->FirstParameter(), curve->LastParameter());
+  return 0;
+}
+
+/*
+  Project the point onto the curve and retrieve the closest parameter
+*/
+static int project_point(GeomAPI_ProjectPointOnCurve *projection, TMRPoint X,
+                         double *t) {
+  gp_Pnt pt(X.x, X.y, X.z);
+  projection->Perform(pt);
+  if (projection->NbPoints() == 0) {
+    return 1;
+  }
+  *t = projection->LowerDistanceParameter();
+  return 0;
+}
+
+/*
+  Initialize the projection onto the surface of the face
+*/
+static int init_surface_projection(const Handle(Geom_Surface) & surf,
+                                   GeomAPI_ProjectPointOnSurf *projection) {
+  if (surf.IsNull()) {
+    return 1;
+  }
+  double umin, umax, vmin, vmax;
+  surf->Bounds(umin, umax, vmin, vmax);
+  projection->Init(surf, umin, umax, vmin, vmax);
+  return 0;
+}
+
+/*
+  Project the point onto the surface and retrieve the closest parameters
+*/
+static int project_point(GeomAPI_ProjectPointOnSurf *projection, TMRPoint X,
+                         double *u, double *v) {
+  gp_Pnt pt(X.x, X.y, X.z);
+  projection->Perform(pt);
+  if (projection->NbPoints() == 0) {
+    *u = *v = 0.0;
+    return 1;
+  }
+  projection->LowerDistanceParameters(*u, *v);
+  return 0;
+}
+
 /*
   The TMR interface to the underlying OpenCascade vertex object
 */
@@ -78,10 +164,40 @@ TMR_OCCEdge::TMR_OCCEdge(TopoDS_Edge &e) {
   edge = e;
   reverse_edge = e;
   reverse_edge.Reverse();
+  adaptor_init = 0;
+  projection_init = 0;
 }
 
 TMR_OCCEdge::~TMR_OCCEdge() {}
 
+/*
+  Get the cached curve evaluator, creating it on the first call
+*/
+BRepAdaptor_Curve *TMR_OCCEdge::getAdaptor() {
+  if (!adaptor_init) {
+    adaptor.Initialize(edge);
+    adaptor_init = 1;
+  }
+  return &adaptor;
+}
+
+/*
+  Get the cached projection, creating it on the first call. This
+  returns NULL if the edge has no 3D curve.
+*/
+GeomAPI_ProjectPointOnCurve *TMR_OCCEdge::getProjection() {
+  if (!projection_init) {
+    projection_init = 1;
+    if (init_curve_projection(edge, &projection)) {
+      projection_init = -1;
+    }
+  }
+  if (projection_init < 0) {
+    return NULL;
+  }
+  return &projection;
+}
+
 void TMR_OCCEdge::getRange(double *tmin, double *tmax) {
   BRep_Tool::Range(edge, *tmin, *tmax);
 }
@@ -121,35 +237,98 @@ int TMR_OCCEdge::getParamsOnFace(TMRFace *surface, double t, int dir, double *u,
 }
 
 int TMR_OCCEdge::evalPoint(double t, TMRPoint *X) {
-  BRepAdaptor_Curve curve(edge);
   gp_Pnt p;
-  curve.D0(t, p);
+  if (in_parallel_region()) {
+    BRepAdaptor_Curve curve(edge);
+    curve.D0(t, p);
+  } else {
+    getAdaptor()->D0(t, p);
+  }
   X->x = p.X();
   X->y = p.Y();
   X->z = p.Z();
   return 0;
 }
 
+/*
+  Evaluate a batch of points on the edge. Each thread uses its own
+  curve evaluator, which is created once for the batch, so this may
+  also be called from within a parallel region.
+*/
+int TMR_OCCEdge::evalPoints(int n, const double t[], TMRPoint X[]) {
+#ifdef TMR_HAS_OPENMP
+#pragma omp parallel if (n >= TMR_OCC_PARALLEL_BATCH_SIZE)
+#endif  // TMR_HAS_OPENMP
+  {
+    BRepAdaptor_Curve curve(edge);
+
+#ifdef TMR_HAS_OPENMP
+#pragma omp for
+#endif  // TMR_HAS_OPENMP
+    for (int i = 0; i < n; i++) {
+      gp_Pnt p;
+      curve.D0(t[i], p);
+      X[i].x = p.X();
+      X[i].y = p.Y();
+      X[i].z = p.Z();
+    }
+  }
+
+  return 0;
+}
+
 int TMR_OCCEdge::invEvalPoint(TMRPoint X, double *t) {
-  gp_Pnt pt(X.x, X.y, X.z);
-  double tmin, tmax;
-  getRange(&tmin, &tmax);
-  const Handle(Geom_Curve) curve = BRep_Tool::Curve(edge, tmin, tmax);
-  GeomAPI_ProjectPointOnCurve projection(pt, curve);
-  if (projection.NbPoints() == 0) {
+  if (in_parallel_region()) {
+    GeomAPI_ProjectPointOnCurve proj;
+    if (init_curve_projection(edge, &proj)) {
+      return 1;
+    }
+    return project_point(&proj, X, t);
+  }
+
+  GeomAPI_ProjectPointOnCurve *proj = getProjection();
+  if (!proj) {
     return 1;
-  } else {
-    *t = projection.LowerDistanceParameter();
-    return 0;
   }
+  return project_point(proj, X, t);
+}
+
+/*
+  Perform the inverse evaluation for a batch of points. Each thread
+  initializes its own projection once for the batch.
+*/
+int TMR_OCCEdge::invEvalPoints(int n, const TMRPoint X[], double t[]) {
+  int nfail = 0;
+#ifdef TMR_HAS_OPENMP
+#pragma omp parallel if (n >= TMR_OCC_PARALLEL_BATCH_SIZE) reduction(+ : nfail)
+#endif  // TMR_HAS_OPENMP
+  {
+    GeomAPI_ProjectPointOnCurve proj;
+    int init_fail = init_curve_projection(edge, &proj);
+
+#ifdef TMR_HAS_OPENMP
+#pragma omp for
+#endif  // TMR_HAS_OPENMP
+    for (int i = 0; i < n; i++) {
+      if (init_fail || project_point(&proj, X[i], &t[i])) {
+        nfail++;
+      }
+    }
+  }
+
+  return (nfail > 0);
 }
 
 int TMR_OCCEdge::evalDeriv(double t, TMRPoint *X, TMRPoint *Xt) {
   int fail = 0;
   gp_Pnt p;
   gp_Vec pt;
-  BRepAdaptor_Curve curve(edge);
-  curve.D1(t, p, pt);
+  if (in_parallel_region()) {
+    BRepAdaptor_Curve curve(edge);
+    curve.D1(t, p, pt);
+  } else {
+    getAdaptor()->D1(t, p, pt);
+  }
   X->x = p.X();
   X->y = p.Y();
   X->z = p.Z();
@@ -165,8 +344,12 @@ int TMR_OCCEdge::eval2ndDeriv(double t, TMRPoint *X, TMRPoint *Xt,
   int fail = 0;
   gp_Pnt p;
   gp_Vec pt, ptt;
-  BRepAdaptor_Curve curve(edge);
-  curve.D2(t, p, pt, ptt);
+  if (in_parallel_region()) {
+    BRepAdaptor_Curve curve(edge);
+    curve.D2(t, p, pt, ptt);
+  } else {
+    getAdaptor()->D2(t, p, pt, ptt);
+  }
   X->x = p.X();
   X->y = p.Y();
   X->z = p.Z();
@@ -199,17 +382,38 @@ void TMR_OCCEdge::getEdgeObject(TopoDS_Edge &e) { e = edge; }
 TMR_OCCFace::TMR_OCCFace(int _normal_dir, TopoDS_Face &f)
     : TMRFace(_normal_dir) {
   face = f;
+
+  // Retrieve the surface once since this creates a transformed copy
+  // of the underlying surface when the face has a location
+  surf = BRep_Tool::Surface(face);
+  projection_init = 0;
 }
 
 TMR_OCCFace::~TMR_OCCFace() {}
 
+/*
+  Get the cached projection, creating it on the first call. This
+  returns NULL if the face has no surface.
+*/
+GeomAPI_ProjectPointOnSurf *TMR_OCCFace::getProjection() {
+  if (!projection_init) {
+    projection_init = 1;
+    if (init_surface_projection(surf, &projection)) {
+      projection_init = -1;
+    }
+  }
+  if (projection_init < 0) {
+    return NULL;
+  }
+  return &projection;
+}
+
 void TMR_OCCFace::getRange(double *umin, double *vmin, double *umax,
                            double *vmax) {
   BRepTools::UVBounds(face, *umin, *umax, *vmin, *vmax);
 }
 
 int TMR_OCCFace::evalPoint(double u, double v, TMRPoint *X) {
-  const Handle(Geom_Surface) surf = BRep_Tool::Surface(face);
   gp_Pnt p;
   surf->D0(u, v, p);
   X->x = p.X();
@@ -218,22 +422,76 @@ int TMR_OCCFace::evalPoint(double u, double v, TMRPoint *X) {
   return 0;
 }
 
+/*
+  Evaluate a batch of points on the face. The surface evaluation does
+  not modify the surface, so the points are evaluated in parallel.
+*/
+int TMR_OCCFace::evalPoints(int n, const double u[], const double v[],
+                            TMRPoint X[]) {
+#ifdef TMR_HAS_OPENMP
+#pragma omp parallel for if (n >= TMR_OCC_PARALLEL_BATCH_SIZE)
+#endif  // TMR_HAS_OPENMP
+  for (int i = 0; i < n; i++) {
+    gp_Pnt p;
+    surf->D0(u[i], v[i], p);
+    X[i].x = p.X();
+    X[i].y = p.Y();
+    X[i].z = p.Z();
+  }
+
+  return 0;
+}
+
 int TMR_OCCFace::invEvalPoint(TMRPoint X, double *u, double *v) {
-  gp_Pnt pt(X.x, X.y, X.z);
-  const Handle(Geom_Surface) surf = BRep_Tool::Surface(face);
-  GeomAPI_ProjectPointOnSurf projection(pt, surf);
-  if (projection.NbPoints() == 0) {
+  if (in_parallel_region()) {
+    GeomAPI_ProjectPointOnSurf proj;
+    if (init_surface_projection(surf, &proj)) {
+      *u = *v = 0.0;
+      return 1;
+    }
+    return project_point(&proj, X, u, v);
+  }
+
+  GeomAPI_ProjectPointOnSurf *proj = getProjection();
+  if (!proj) {
     *u = *v = 0.0;
     return 1;
-  } else {
-    projection.LowerDistanceParameters(*u, *v);
-    return 0;
   }
+  return project_point(proj, X, u, v);
+}
+
+/*
+  Perform the inverse evaluation for a batch of points. Each thread
+  initializes its own projection once for the batch.
+*/
+int TMR_OCCFace::invEvalPoints(int n, const TMRPoint X[], double u[],
+                               double v[]) {
+  int nfail = 0;
+#ifdef TMR_HAS_OPENMP
+#pragma omp parallel if (n >= TMR_OCC_PARALLEL_BATCH_SIZE) reduction(+ : nfail)
+#endif  // TMR_HAS_OPENMP
+  {
+    GeomAPI_ProjectPointOnSurf proj;
+    int init_fail = init_surface_projection(surf, &proj);
+
+#ifdef TMR_HAS_OPENMP
+#pragma omp for
+#endif  // TMR_HAS_OPENMP
+    for (int i = 0; i < n; i++) {
+      if (init_fail) {
+        u[i] = v[i] = 0.0;
+        nfail++;
+      } else if (project_point(&proj, X[i], &u[i], &v[i])) {
+        nfail++;
+      }
+    }
+  }
+
+  return (nfail > 0);
 }
 
 int TMR_OCCFace::evalDeriv(double u, double v, TMRPoint *X, TMRPoint *Xu,
                            TMRPoint *Xv) {
-  const Handle(Geom_Surface) surf = BRep_Tool::Surface(face);
   gp_Pnt p;
   gp_Vec pu, pv;
   surf->D1(u, v, p, pu, pv);
@@ -254,7 +512,6 @@ int TMR_OCCFace::evalDeriv(double u, double v, TMRPoint *X, TMRPoint *Xu,
 int TMR_OCCFace::eval2ndDeriv(double u, double v, TMRPoint *X, TMRPoint *Xu,
                               TMRPoint *Xv, TMRPoint *Xuu, TMRPoint *Xuv,
                               TMRPoint *Xvv) {
-  const Handle(Geom_Surface) surf = BRep_Tool::Surface(face);
   gp_Pnt p;
   gp_Vec pu, pv;
   gp_Vec puu, puv, pvv;
@@ -746,13 +1003,13 @@ void TMR_FixCompound(TopoDS_Compound &compound, int print_level, double tol) {
 }
 
 /*
-  Create the TMRModel based on the IGES input file
+  Read the shapes from an IGES file into a compound
 */
-TMRModel *TMR_LoadModelFromIGESFile(const char *filename, const char *units,
-                                    int print_level) {
+static int read_iges_compound(const char *filename, const char *units,
+                              TopoDS_Compound &compound) {
   FILE *fp = fopen(filename, "r");
   if (!fp) {
-    return NULL;
+    return 1;
   }
   fclose(fp);
 
@@ -779,7 +1036,6 @@ TMRModel *TMR_LoadModelFromIGESFile(const char *filename, const char *units,
   int nbs = reader.NbShapes();
 
   // Build the shape
-  TopoDS_Compound compound;
   BRep_Builder builder;
   builder.MakeCompound(compound);
   for (int i = 1; i <= nbs; i++) {
@@ -789,17 +1045,17 @@ TMRModel *TMR_LoadModelFromIGESFile(const char *filename, const char *units,
 
   // TMR_RemoveFloatingShapes(compound, TopAbs_FACE);
 
-  return TMR_LoadModelFromCompound(compound, print_level);
+  return 0;
 }
 
 /*
-  Create the TMRModel based on the STEP input file
+  Read the shapes from a STEP file into a compound
 */
-TMRModel *TMR_LoadModelFromSTEPFile(const char *filename, const char *units,
-                                    int print_level) {
+static int read_step_compound(const char *filename, const char *units,
+                              TopoDS_Compound &compound) {
   FILE *fp = fopen(filename, "r");
   if (!fp) {
-    return NULL;
+    return 1;
   }
   fclose(fp);
 
@@ -826,7 +1082,6 @@ TMRModel *TMR_LoadModelFromSTEPFile(const char *filename, const char *units,
   int nbs = reader.NbShapes();
 
   // Build the shape
-  TopoDS_Compound compound;
   BRep_Builder builder;
   builder.MakeCompound(compound);
   for (int i = 1; i <= nbs; i++) {
@@ -836,9 +1091,265 @@ TMRModel *TMR_LoadModelFromSTEPFile(const char *filename, const char *units,
 
   TMR_RemoveFloatingShapes(compound, TopAbs_EDGE);
 
+  return 0;
+}
+
+/*
+  Create the TMRModel based on the IGES input file
+*/
+TMRModel *TMR_LoadModelFromIGESFile(const char *filename, const char *units,
+                                    int print_level) {
+  TopoDS_Compound compound;
+  if (read_iges_compound(filename, units, compound)) {
+    return NULL;
+  }
+
+  return TMR_LoadModelFromCompound(compound, print_level);
+}
+
+/*
+  Create the TMRModel based on the STEP input file
+*/
+TMRModel *TMR_LoadModelFromSTEPFile(const char *filename, const char *units,
+                                    int print_level) {
+  TopoDS_Compound compound;
+  if (read_step_compound(filename, units, compound)) {
+    return NULL;
+  }
+
   return TMR_LoadModelFromCompound(compound, print_level);
 }
 
+/*
+  Add the bytes to a 64-bit FNV-1a hash
+*/
+static void hash_bytes(uint64_t *hash, const void *data, size_t len) {
+  const unsigned char *bytes = (const unsigned char *)data;
+  for (size_t i = 0; i < len; i++) {
+    *hash ^= bytes[i];
+    *hash *= 1099511628211ULL;
+  }
+}
+
+/*
+  Compute the key for the processed model from the contents of the
+  file and the options used to process it. Returns a non-zero value
+  if the file cannot be read.
+*/
+static int compute_model_key(const char *filename, const char *units,
+                             int is_step, int sew_model, double sew_tol,
+                             uint64_t *key) {
+  FILE *fp = fopen(filename, "rb");
+  if (!fp) {
+    return 1;
+  }
+
+  uint64_t hash = 14695981039346656037ULL;
+  char buffer[65536];
+  size_t len = 0;
+  while ((len = fread(buffer, 1, sizeof(buffer), fp)) > 0) {
+    hash_bytes(&hash, buffer, len);
+  }
+  fclose(fp);
+
+  hash_bytes(&hash, units, strlen(units));
+  hash_bytes(&hash, &is_step, sizeof(is_step));
+  hash_bytes(&hash, &sew_model, sizeof(sew_model));
+  if (sew_model) {
+    hash_bytes(&hash, &sew_tol, sizeof(sew_tol));
+  }
+  *key = hash;
+
+  return 0;
+}
+
+/*
+  Read the entire contents of a file into the string
+*/
+static int read_file_contents(const char *filename, std::string &data) {
+  FILE *fp = fopen(filename, "rb");
+  if (!fp) {
+    return 1;
+  }
+
+  data.clear();
+  char buffer[65536];
+  size_t len = 0;
+  while ((len = fread(buffer, 1, sizeof(buffer), fp)) > 0) {
+    data.append(buffer, len);
+  }
+  int fail = ferror(fp);
+  fclose(fp);
+
+  return fail;
+}
+
+/*
+  Write the string to a file. The data is first written to a temporary
+  file and then renamed so that other jobs never read a partial file.
+*/
+static int write_file_contents(const char *filename, const std::string &data) {
+  char tmp_name[512];
+  snprintf(tmp_name, sizeof(tmp_name), "%s.%d.tmp", filename, (int)getpid());
+
+  FILE *fp = fopen(tmp_name, "wb");
+  if (!fp) {
+    return 1;
+  }
+  size_t len = fwrite(data.data(), 1, data.size(), fp);
+  int fail = (fclose(fp) != 0 || len != data.size());
+  if (!fail) {
+    fail = rename(tmp_name, filename);
+  }
+  if (fail) {
+    remove(tmp_name);
+  }
+
+  return fail;
+}
+
+/*
+  Load the STEP or IGES file on the root processor, apply the optional
+  sewing operation and serialize the resulting compound in the BRep
+  format. If a cache directory is provided, the serialized compound is
+  stored under a key computed from the file contents and the options
+  so that subsequent loads of the same file skip the translation.
+*/
+static int load_serialized_compound(const char *filename, const char *units,
+                                    int is_step, int print_level,
+                                    int sew_model, double sew_tol,
+                                    const char *cache_dir, std::string &data) {
+  uint64_t key = 0;
+  if (compute_model_key(filename, units, is_step, sew_model, sew_tol, &key)) {
+    return 1;
+  }
+
+  char cache_file[512];
+  cache_file[0] = '\0';
+  if (cache_dir) {
+    snprintf(cache_file, sizeof(cache_file), "%s/tmr_model_%016llx.brep",
+             cache_dir, (unsigned long long)key);
+    if (read_file_contents(cache_file, data) == 0 && data.size() > 0) {
+      if (print_level > 0) {
+        printf("TMR: Loaded the processed model from %s\n", cache_file);
+      }
+      return 0;
+    }
+  }
+
+  TopoDS_Compound compound;
+  int fail = 0;
+  if (is_step) {
+    fail = read_step_compound(filename, units, compound);
+  } else {
+    fail = read_iges_compound(filename, units, compound);
+  }
+  if (fail) {
+    return 1;
+  }
+
+  if (sew_model) {
+    TMR_SewCompound(compound, print_level, sew_tol, false);
+  }
+
+  std::ostringstream out;
+  BRepTools::Write(compound, out);
+  data = out.str();
+
+  if (cache_dir && write_file_contents(cache_file, data)) {
+    fprintf(stderr, "TMR Warning: Unable to write the model cache %s\n",
+            cache_file);
+  }
+
+  return 0;
+}
+
+/*
+  Create the TMRModel from a STEP or IGES file that is read on the
+  root processor only. The root processor translates (and optionally
+  sews) the file, or reads the translated model from the cache, and
+  broadcasts the BRep serialization of the compound. Every processor
+  then builds the TMRModel from the identical compound so that the
+  ordering of the geometry objects is consistent across processors.
+*/
+static TMRModel *load_model_from_file(MPI_Comm comm, const char *filename,
+                                      const char *units, int is_step,
+                                      int print_level, int sew_model,
+                                      double sew_tol, const char *cache_dir) {
+  int mpi_rank;
+  MPI_Comm_rank(comm, &mpi_rank);
+
+  std::string data;
+  long size = 0;
+  if (mpi_rank == 0) {
+    if (load_serialized_compound(filename, units, is_step, print_level,
+                                 sew_model, sew_tol, cache_dir, data) == 0) {
+      size = data.size();
+    } else {
+      size = -1;
+    }
+  }
+  MPI_Bcast(&size, 1, MPI_LONG, 0, comm);
+  if (size <= 0) {
+    return NULL;
+  }
+
+  // Broadcast the serialized compound in blocks that fit in an int
+  data.resize(size);
+  const long max_block = 1L << 30;
+  for (long offset = 0; offset < size; offset += max_block) {
+    long len = size - offset;
+    if (len > max_block) {
+      len = max_block;
+    }
+    MPI_Bcast(&data[offset], (int)len, MPI_CHAR, 0, comm);
+  }
+
+  // Re-create the compound from the serialized data
+  TopoDS_Shape shape;
+  BRep_Builder builder;
+  std::istringstream in(data);
+  BRepTools::Read(shape, in, builder);
+  data.clear();
+
+  TopoDS_Compound compound;
+  if (shape.IsNull()) {
+    return NULL;
+  } else if (shape.ShapeType() == TopAbs_COMPOUND) {
+    compound = TopoDS::Compound(shape);
+  } else {
+    builder.MakeCompound(compound);
+    builder.Add(compound, shape);
+  }
+
+  if (mpi_rank != 0) {
+    print_level = 0;
+  }
+  return TMR_LoadModelFromCompound(compound, print_level);
+}
+
+/*
+  Create the TMRModel from an IGES file read on the root processor
+*/
+TMRModel *TMR_LoadModelFromIGESFile(MPI_Comm comm, const char *filename,
+                                    const char *units, int print_level,
+                                    int sew_model, double sew_tol,
+                                    const char *cache_dir) {
+  return load_model_from_file(comm, filename, units, 0, print_level,
+                              sew_model, sew_tol, cache_dir);
+}
+
+/*
+  Create the TMRModel from a STEP file read on the root processor
+*/
+TMRModel *TMR_LoadModelFromSTEPFile(MPI_Comm comm, const char *filename,
+                                    const char *units, int print_level,
+                                    int sew_model, double sew_tol,
+                                    const char *cache_dir) {
+  return load_model_from_file(comm, filename, units, 1, print_level,
+                              sew_model, sew_tol, cache_dir);
+}
+
 /*
   Create the TMRModel based on the TopoDS_Compound object
 */
@@ -142,7 +142,9 @@ class TMR_OCCEdge : public TMREdge {
   ~TMR_OCCEdge();
   void getRange(double *tmin, double *tmax);
   int evalPoint(double t, TMRPoint *X);
+  int evalPoints(int n, const double t[], TMRPoint X[]);
   int invEvalPoint(TMRPoint X, double *t);
+  int invEvalPoints(int n, const TMRPoint X[], double t[]);
   int evalDeriv(double t, TMRPoint *X, TMRPoint *Xt);
   int eval2ndDeriv(double t, TMRPoint *X, TMRPoint *Xt, TMRPoint *Xtt);
   int getParamsOnFace(TMRFace *face, double t, int dir, double *u, double *v);
@@ -151,8 +153,18 @@ class TMR_OCCEdge : public TMREdge {
   void getEdgeObject(TopoDS_Edge &e);
 
  private:
+  // Get the cached curve evaluator and projection
+  BRepAdaptor_Curve *getAdaptor();
+  GeomAPI_ProjectPointOnCurve *getProjection();
+
   TopoDS_Edge edge;
   TopoDS_Edge reverse_edge;
+
+  // The cached evaluator and projection. These carry internal state
+  // so they are only used outside of OpenMP parallel regions.
+  int adaptor_init, projection_init;
+  BRepAdaptor_Curve adaptor;
+  GeomAPI_ProjectPointOnCurve projection;
 };
 
 class TMR_OCCFace : public TMRFace {
@@ -161,7 +173,9 @@ class TMR_OCCFace : public TMRFace {
   ~TMR_OCCFace();
   void getRange(double *umin, double *vmin, double *umax, double *vmax);
   int evalPoint(double u, double v, TMRPoint *X);
+  int evalPoints(int n, const double u[], const double v[], TMRPoint X[]);
   int invEvalPoint(TMRPoint p, double *u, double *v);
+  int invEvalPoints(int n, const TMRPoint p[], double u[], double v[]);
   int evalDeriv(double u, double v, TMRPoint *X, TMRPoint *Xu, TMRPoint *Xv);
   int eval2ndDeriv(double u, double v, TMRPoint *X, TMRPoint *Xu, TMRPoint *Xv,
                    TMRPoint *Xuu, TMRPoint *Xuv, TMRPoint *Xvv);
@@ -169,7 +183,18 @@ class TMR_OCCFace : public TMRFace {
   void getFaceObject(TopoDS_Face &f);
 
  private:
+  // Get the cached projection onto the surface
+  GeomAPI_ProjectPointOnSurf *getProjection();
+
   TopoDS_Face face;
+
+  // The surface of the face with its location applied
+  Handle(Geom_Surface) surf;
+
+  // The cached projection. This carries internal state so it is only
+  // used outside of OpenMP parallel regions.
+  int projection_init;
+  GeomAPI_ProjectPointOnSurf projection;
 };
 
 /*
@@ -186,5 +211,22 @@ TMRModel *TMR_LoadModelFromSTEPFile(const char *filename, const char *units,
 TMRModel *TMR_LoadModelFromCompound(TopoDS_Compound &compound,
                                     int print_level = 0);
 
+/*
+  Load the IGES/STEP file on the root processor and broadcast the
+  translated model to all processors in the communicator. The model is
+  optionally sewn on the root processor. When cache_dir is provided,
+  the translated model is stored in that directory under a key based
+  on the contents of the file and the options, and re-used by later
+  calls with the same file.
+*/
+TMRModel *TMR_LoadModelFromIGESFile(MPI_Comm comm, const char *filename,
+                                    const char *units, int print_level = 0,
+                                    int sew_model = 0, double sew_tol = 1.e-6,
+                                    const char *cache_dir = NULL);
+TMRModel *TMR_LoadModelFromSTEPFile(MPI_Comm comm, const char *filename,
+                                    const char *units, int print_level = 0,
+                                    int sew_model = 0, double sew_tol = 1.e-6,
+                                    const char *cache_dir = NULL);
+
 #endif  // TMR_HAS_OPENCASCADE
 #endif  // TMR_OPENCASCADE_H
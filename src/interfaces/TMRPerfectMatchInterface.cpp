@@ -20,7 +20,10 @@
 
 #include "TMRPerfectMatchInterface.h"
 
+#include <math.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 // Include the perfect matching code
@@ -92,3 +95,440 @@ int TMR_PerfectMatchGraph(int nnodes, int nedges, const int *edges,
 
   return nmatch;
 }
+
+/*
+  Compute the node to edge data structure for the graph
+*/
+static void TMR_ComputeNodeToEdges(int nnodes, int nedges, const int *edges,
+                                   int **_ptr, int **_node_edges) {
+  int *ptr = new int[nnodes + 1];
+  memset(ptr, 0, (nnodes + 1) * sizeof(int));
+  for (int i = 0; i < nedges; i++) {
+    ptr[edges[2 * i] + 1]++;
+    ptr[edges[2 * i + 1] + 1]++;
+  }
+  for (int i = 0; i < nnodes; i++) {
+    ptr[i + 1] += ptr[i];
+  }
+
+  int *node_edges = new int[ptr[nnodes]];
+  for (int i = 0; i < nedges; i++) {
+    node_edges[ptr[edges[2 * i]]] = i;
+    ptr[edges[2 * i]]++;
+    node_edges[ptr[edges[2 * i + 1]]] = i;
+    ptr[edges[2 * i + 1]]++;
+  }
+  for (int i = nnodes; i > 0; i--) {
+    ptr[i] = ptr[i - 1];
+  }
+  ptr[0] = 0;
+
+  *_ptr = ptr;
+  *_node_edges = node_edges;
+}
+
+/*
+  Find the minimum-weight matching of the sub-graph of nodes for
+  which part[node] == id.
+
+  Only edges with both nodes in the sub-graph are considered. Since
+  the sub-graph may not possess a perfect matching, it is doubled: the
+  copy of each node is connected to its original by an edge with a
+  large penalty and the copies are connected to each other with zero
+  weight. The perfect matching of the doubled graph always exists and
+  leaves a node unmatched only when this cannot be avoided.
+
+  On exit, mate[node] is the edge matched to each node in the
+  sub-graph, or -1 if the node is unmatched.
+*/
+static void TMR_MatchSubgraph(int nnodes, const int *edges,
+                              const double *weights, const int *ptr,
+                              const int *node_edges, const int *part, int id,
+                              int nsub, const int *sub_nodes, int *local,
+                              int *mate) {
+  if (nsub == 0) {
+    return;
+  }
+
+  // Set the local node numbers and count the sub-graph edges
+  int nsub_edges = 0;
+  double penalty = 1.0;
+  for (int i = 0; i < nsub; i++) {
+    local[sub_nodes[i]] = i;
+  }
+  for (int i = 0; i < nsub; i++) {
+    int n = sub_nodes[i];
+    for (int jp = ptr[n]; jp < ptr[n + 1]; jp++) {
+      int e = node_edges[jp];
+      int n1 = edges[2 * e], n2 = edges[2 * e + 1];
+      if (n1 == n && part[n2] == id) {
+        nsub_edges++;
+        penalty += fabs(weights[e]);
+      }
+    }
+  }
+
+  // Set the edges in the doubled graph: the original edges, the copy
+  // edges and the edges from each node to its copy
+  int ndouble_edges = 2 * nsub_edges + nsub;
+  int *sub_edges = new int[2 * ndouble_edges];
+  double *sub_weights = new double[ndouble_edges];
+  int *sub_edge_index = new int[nsub_edges];
+  int count = 0;
+  for (int i = 0; i < nsub; i++) {
+    int n = sub_nodes[i];
+    for (int jp = ptr[n]; jp < ptr[n + 1]; jp++) {
+      int e = node_edges[jp];
+      int n1 = edges[2 * e], n2 = edges[2 * e + 1];
+      if (n1 == n && part[n2] == id) {
+        sub_edges[2 * count] = i;
+        sub_edges[2 * count + 1] = local[n2];
+        sub_weights[count] = weights[e];
+        sub_edges[2 * (nsub_edges + count)] = nsub + i;
+        sub_edges[2 * (nsub_edges + count) + 1] = nsub + local[n2];
+        sub_weights[nsub_edges + count] = 0.0;
+        sub_edge_index[count] = e;
+        count++;
+      }
+    }
+  }
+  for (int i = 0; i < nsub; i++) {
+    int k = 2 * nsub_edges + i;
+    sub_edges[2 * k] = i;
+    sub_edges[2 * k + 1] = nsub + i;
+    sub_weights[k] = penalty;
+  }
+
+  int *sub_match = new int[nsub];
+  int nsub_match = TMR_PerfectMatchGraph(2 * nsub, ndouble_edges, sub_edges,
+                                         sub_weights, sub_match);
+
+  for (int i = 0; i < nsub; i++) {
+    mate[sub_nodes[i]] = -1;
+  }
+  for (int i = 0; i < nsub_match; i++) {
+    if (sub_match[i] < nsub_edges) {
+      int e = sub_edge_index[sub_match[i]];
+      mate[edges[2 * e]] = e;
+      mate[edges[2 * e + 1]] = e;
+    }
+  }
+
+  delete[] sub_edges;
+  delete[] sub_weights;
+  delete[] sub_edge_index;
+  delete[] sub_match;
+}
+
+/*
+  Repair a matching by re-matching the nodes near any unmatched nodes
+
+  The region that is re-matched consists of all nodes within depth
+  edges of an unmatched node, along with their matched partners. The
+  depth is doubled until either all nodes are matched or the region
+  covers the entire graph.
+*/
+static void TMR_RepairMatching(int nnodes, const int *edges,
+                               const double *weights, const int *ptr,
+                               const int *node_edges, int *mate) {
+  int *part = new int[nnodes];
+  int *local = new int[nnodes];
+  int *region = new int[nnodes];
+  for (int i = 0; i < nnodes; i++) {
+    part[i] = -1;
+  }
+
+  int prev_nregion = 0;
+  for (int depth = 2, id = 0;; depth *= 2, id++) {
+    // Add the unmatched nodes to the region
+    int nregion = 0;
+    for (int i = 0; i < nnodes; i++) {
+      if (mate[i] < 0) {
+        part[i] = id;
+        region[nregion] = i;
+        nregion++;
+      }
+    }
+    if (nregion <= 1) {
+      break;
+    }
+
+    // Add the nodes within depth edges of an unmatched node
+    for (int level = 0, start = 0; level < depth; level++) {
+      int end = nregion;
+      for (int i = start; i < end; i++) {
+        int n = region[i];
+        for (int jp = ptr[n]; jp < ptr[n + 1]; jp++) {
+          int e = node_edges[jp];
+          int m = (edges[2 * e] == n ? edges[2 * e + 1] : edges[2 * e]);
+          if (part[m] != id) {
+            part[m] = id;
+            region[nregion] = m;
+            nregion++;
+          }
+        }
+      }
+      start = end;
+    }
+
+    // Add the partners of the matched nodes in the region
+    int end = nregion;
+    for (int i = 0; i < end; i++) {
+      int e = mate[region[i]];
+      if (e >= 0) {
+        int m = (edges[2 * e] == region[i] ? edges[2 * e + 1] : edges[2 * e]);
+        if (part[m] != id) {
+          part[m] = id;
+          region[nregion] = m;
+          nregion++;
+        }
+      }
+    }
+
+    TMR_MatchSubgraph(nnodes, edges, weights, ptr, node_edges, part, id,
+                      nregion, region, local, mate);
+
+    // Stop once the region can no longer grow
+    if (nregion == nnodes || nregion == prev_nregion) {
+      break;
+    }
+    prev_nregion = nregion;
+  }
+
+  int nunmatched = 0;
+  for (int i = 0; i < nnodes; i++) {
+    if (mate[i] < 0) {
+      nunmatched++;
+    }
+  }
+  if (nunmatched > 0) {
+    fprintf(stderr, "TMR_RepairMatching warning: %d nodes not matched\n",
+            nunmatched);
+  }
+
+  delete[] part;
+  delete[] local;
+  delete[] region;
+}
+
+/*
+  Set the matched edges from the mate of each node in ascending order
+*/
+static int TMR_GetMatchedEdges(int nedges, const int *edges, const int *mate,
+                               int *match) {
+  int nmatch = 0;
+  for (int i = 0; i < nedges; i++) {
+    if (mate[edges[2 * i]] == i) {
+      match[nmatch] = i;
+      nmatch++;
+    }
+  }
+
+  return nmatch;
+}
+
+/*
+  Sort keys used to order the nodes and edges
+*/
+struct TMRMatchSortKey {
+  uint64_t key;
+  int index;
+};
+
+struct TMRMatchSortWeight {
+  double weight;
+  int index;
+};
+
+static int TMR_CompareMatchKey(const void *a, const void *b) {
+  const TMRMatchSortKey *A = static_cast<const TMRMatchSortKey *>(a);
+  const TMRMatchSortKey *B = static_cast<const TMRMatchSortKey *>(b);
+  if (A->key < B->key) {
+    return -1;
+  } else if (A->key > B->key) {
+    return 1;
+  }
+  return A->index - B->index;
+}
+
+static int TMR_CompareMatchWeight(const void *a, const void *b) {
+  const TMRMatchSortWeight *A = static_cast<const TMRMatchSortWeight *>(a);
+  const TMRMatchSortWeight *B = static_cast<const TMRMatchSortWeight *>(b);
+  if (A->weight < B->weight) {
+    return -1;
+  } else if (A->weight > B->weight) {
+    return 1;
+  }
+  return A->index - B->index;
+}
+
+/*
+  Compute the Morton key from the quantized (x, y, z) coordinates
+*/
+static uint64_t TMR_MortonKey(uint32_t x, uint32_t y, uint32_t z) {
+  uint64_t key = 0;
+  for (int k = 0; k < 21; k++) {
+    key |= ((uint64_t)((x >> k) & 1) << (3 * k));
+    key |= ((uint64_t)((y >> k) & 1) << (3 * k + 1));
+    key |= ((uint64_t)((z >> k) & 1) << (3 * k + 2));
+  }
+  return key;
+}
+
+int TMR_PatchMatchGraph(int nnodes, int nedges, const int *edges,
+                        const double *weights, const double *xpts,
+                        int patch_size, int *match) {
+  if (patch_size < 2 || nnodes <= patch_size) {
+    return TMR_PerfectMatchGraph(nnodes, nedges, edges, weights, match);
+  }
+
+  // Compute the bounding box of the nodes
+  double xmin[3], xmax[3];
+  for (int k = 0; k < 3; k++) {
+    xmin[k] = xmax[k] = xpts[k];
+  }
+  for (int i = 1; i < nnodes; i++) {
+    for (int k = 0; k < 3; k++) {
+      if (xpts[3 * i + k] < xmin[k]) {
+        xmin[k] = xpts[3 * i + k];
+      }
+      if (xpts[3 * i + k] > xmax[k]) {
+        xmax[k] = xpts[3 * i + k];
+      }
+    }
+  }
+
+  // Order the nodes along the Morton curve
+  const double max_int = (1 << 21) - 1;
+  TMRMatchSortKey *keys = new TMRMatchSortKey[nnodes];
+  for (int i = 0; i < nnodes; i++) {
+    uint32_t u[3];
+    for (int k = 0; k < 3; k++) {
+      double d = xmax[k] - xmin[k];
+      u[k] = 0;
+      if (d > 0.0) {
+        u[k] = (uint32_t)(max_int * (xpts[3 * i + k] - xmin[k]) / d);
+      }
+    }
+    keys[i].key = TMR_MortonKey(u[0], u[1], u[2]);
+    keys[i].index = i;
+  }
+  qsort(keys, nnodes, sizeof(TMRMatchSortKey), TMR_CompareMatchKey);
+
+  // Assign the nodes to the patches
+  int npatches = (nnodes + patch_size - 1) / patch_size;
+  int *patch_nodes = new int[nnodes];
+  int *part = new int[nnodes];
+  for (int i = 0; i < nnodes; i++) {
+    patch_nodes[i] = keys[i].index;
+    part[keys[i].index] = i / patch_size;
+  }
+  delete[] keys;
+
+  int *ptr, *node_edges;
+  TMR_ComputeNodeToEdges(nnodes, nedges, edges, &ptr, &node_edges);
+
+  // Match each of the patches independently. The patches are
+  // disjoint, so each patch only writes to its own entries.
+  int *local = new int[nnodes];
+  int *mate = new int[nnodes];
+#ifdef TMR_HAS_OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif  // TMR_HAS_OPENMP
+  for (int p = 0; p < npatches; p++) {
+    int start = p * patch_size;
+    int end = start + patch_size;
+    if (end > nnodes) {
+      end = nnodes;
+    }
+    TMR_MatchSubgraph(nnodes, edges, weights, ptr, node_edges, part, p,
+                      end - start, &patch_nodes[start], local, mate);
+  }
+
+  // Find the seam: the nodes with an edge that crosses between
+  // patches and the nodes left unmatched, along with their partners
+  int nseam = 0;
+  int *seam = patch_nodes;
+  int *seam_part = new int[nnodes];
+  for (int i = 0; i < nnodes; i++) {
+    seam_part[i] = -1;
+    int on_seam = (mate[i] < 0);
+    for (int jp = ptr[i]; !on_seam && jp < ptr[i + 1]; jp++) {
+      int e = node_edges[jp];
+      on_seam = (part[edges[2 * e]] != part[edges[2 * e + 1]]);
+    }
+    if (on_seam) {
+      seam_part[i] = 0;
+      seam[nseam] = i;
+      nseam++;
+    }
+  }
+  int end = nseam;
+  for (int i = 0; i < end; i++) {
+    int e = mate[seam[i]];
+    if (e >= 0) {
+      int m = (edges[2 * e] == seam[i] ? edges[2 * e + 1] : edges[2 * e]);
+      if (seam_part[m] != 0) {
+        seam_part[m] = 0;
+        seam[nseam] = m;
+        nseam++;
+      }
+    }
+  }
+
+  // Re-match the seam and repair any remaining unmatched nodes
+  TMR_MatchSubgraph(nnodes, edges, weights, ptr, node_edges, seam_part, 0,
+                    nseam, seam, local, mate);
+  TMR_RepairMatching(nnodes, edges, weights, ptr, node_edges, mate);
+
+  int nmatch = TMR_GetMatchedEdges(nedges, edges, mate, match);
+
+  delete[] patch_nodes;
+  delete[] part;
+  delete[] seam_part;
+  delete[] ptr;
+  delete[] node_edges;
+  delete[] local;
+  delete[] mate;
+
+  return nmatch;
+}
+
+int TMR_GreedyMatchGraph(int nnodes, int nedges, const int *edges,
+                         const double *weights, double max_weight,
+                         int *match) {
+  // Sort the edges by increasing weight
+  TMRMatchSortWeight *sorted = new TMRMatchSortWeight[nedges];
+  for (int i = 0; i < nedges; i++) {
+    sorted[i].weight = weights[i];
+    sorted[i].index = i;
+  }
+  qsort(sorted, nedges, sizeof(TMRMatchSortWeight), TMR_CompareMatchWeight);
+
+  // Greedily match the edges with weights below the maximum weight
+  int *mate = new int[nnodes];
+  for (int i = 0; i < nnodes; i++) {
+    mate[i] = -1;
+  }
+  for (int i = 0; i < nedges && sorted[i].weight <= max_weight; i++) {
+    int e = sorted[i].index;
+    int n1 = edges[2 * e], n2 = edges[2 * e + 1];
+    if (mate[n1] < 0 && mate[n2] < 0) {
+      mate[n1] = mate[n2] = e;
+    }
+  }
+  delete[] sorted;
+
+  // Re-match the regions around the unmatched nodes
+  int *ptr, *node_edges;
+  TMR_ComputeNodeToEdges(nnodes, nedges, edges, &ptr, &node_edges);
+  TMR_RepairMatching(nnodes, edges, weights, ptr, node_edges, mate);
+
+  int nmatch = TMR_GetMatchedEdges(nedges, edges, mate, match);
+
+  delete[] ptr;
+  delete[] node_edges;
+  delete[] mate;
+
+  return nmatch;
+}
@@ -24,4 +24,55 @@
 int TMR_PerfectMatchGraph(int nnodes, int nedges, const int *edges,
                           const double *weights, int *match);
 
+/*
+  Compute an approximate minimum-weight perfect matching by
+  partitioning the graph into spatial patches.
+
+  The nodes are ordered along a space-filling curve based on their
+  locations and split into patches with at most patch_size nodes. The
+  patches are matched independently (concurrently when compiled with
+  OpenMP). The band of nodes along the patch seams, and any nodes left
+  unmatched, are then re-matched together with the nodes near them.
+
+  input:
+  nnodes:      the number of nodes in the graph
+  nedges:      the number of edges in the graph
+  edges:       the node pairs for each edge
+  weights:     the weight associated with each edge
+  xpts:        the (x, y, z) location of each node
+  patch_size:  the maximum number of nodes in each patch
+
+  output:
+  match:       the matched edges (nnodes/2 entries)
+
+  returns:     the number of matched edges
+*/
+int TMR_PatchMatchGraph(int nnodes, int nedges, const int *edges,
+                        const double *weights, const double *xpts,
+                        int patch_size, int *match);
+
+/*
+  Compute an approximate minimum-weight perfect matching with a greedy
+  algorithm.
+
+  The edges with a weight less than max_weight are matched greedily in
+  order of increasing weight. The nodes that remain unmatched are then
+  matched by re-matching the nodes near them.
+
+  input:
+  nnodes:      the number of nodes in the graph
+  nedges:      the number of edges in the graph
+  edges:       the node pairs for each edge
+  weights:     the weight associated with each edge
+  max_weight:  the maximum weight of an edge in the greedy matching
+
+  output:
+  match:       the matched edges (nnodes/2 entries)
+
+  returns:     the number of matched edges
+*/
+int TMR_GreedyMatchGraph(int nnodes, int nedges, const int *edges,
+                         const double *weights, double max_weight,
+                         int *match);
+
 #endif  // TMR_PERFECT_MATCH_INTERFACE
@@ -21,6 +21,7 @@
 #include "TMRApproximateDistance.h"
 
 #include <math.h>
+#include <stdlib.h>
 
 #include "KSM.h"
 #include "TACSElement2D.h"
@@ -32,116 +33,414 @@
 #include "TACSToFH5.h"
 #include "TMRHelmholtzModel.h"
 
-void TMRApproximateDistance(TMRQuadForest *filter, int index, double cutoff,
-                            double t, TACSBVec *rho, const char *filename,
-                            double *min_dist) {
+/*
+  Compare integers for sorting
+*/
+static int compare_integers(const void *a, const void *b) {
+  return (*(int *)a - *(int *)b);
+}
+
+/*
+  Get the number of refinement levels applied to the interface
+  elements for a filter of the given order
+*/
+static int get_num_refine(int order) {
+  if (order <= 3) {
+    return 1;
+  } else if (order <= 5) {
+    return 2;
+  }
+  return 3;
+}
+
+/*
+  Check whether the design values at the nodes of a filter element
+  are intermediate or change from low to high within the element
+*/
+static int is_interface_element(int bsize, int index, double cutoff, int len,
+                                const TacsScalar *values) {
+  int start = 0, end = bsize;
+  if (index >= 0 && index < bsize) {
+    start = index;
+    end = index + 1;
+  }
+
+  for (int kk = start; kk < end; kk++) {
+    int low = 0, high = 0;
+    for (int j = 0; j < len; j++) {
+      if (values[bsize * j + kk] < cutoff) {
+        low = 1;
+      } else if (values[bsize * j + kk] > 1.0 - cutoff) {
+        high = 1;
+      } else {
+        return 1;
+      }
+    }
+    if (low && high) {
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+/*
+  Check whether the design values at a point are intermediate
+*/
+static int is_intermediate(int bsize, int index, double cutoff,
+                           const TacsScalar *values) {
+  int start = 0, end = bsize;
+  if (index >= 0 && index < bsize) {
+    start = index;
+    end = index + 1;
+  }
+
+  for (int kk = start; kk < end; kk++) {
+    if (values[kk] >= cutoff && values[kk] <= 1.0 - cutoff) {
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+/*
+  Sort the interface nodes and remove the duplicates
+*/
+static int sort_and_uniquify(int nbcs, int *bcs) {
+  qsort(bcs, nbcs, sizeof(int), compare_integers);
+
+  int n = 0;
+  for (int i = 0; i < nbcs; i++) {
+    if (n == 0 || bcs[i] != bcs[n - 1]) {
+      bcs[n] = bcs[i];
+      n++;
+    }
+  }
+
+  return n;
+}
+
+/*
+  Solve the Helmholtz equation with unit values at the interface nodes
+*/
+static void solve_helmholtz(TACSAssembler *assembler, TACSBVec *dist) {
   int mpi_rank;
+  MPI_Comm_rank(assembler->getMPIComm(), &mpi_rank);
+
+  // Approximately solve the equations....
+  TACSParallelMat *mat = assembler->createMat();
+  int zero_guess = 1;
+  TacsScalar omega = 1.0;
+  int niters = 5;
+  int symm = 1;
+  TACSGaussSeidel *pc =
+      new TACSGaussSeidel(mat, zero_guess, omega, niters, symm);
+
+  // Allocate the GMRES object
+  int m = 20;
+  int nrestart = 4;
+  int isflexible = 1;
+  GMRES *gmres = new GMRES(mat, pc, m, nrestart, isflexible);
+  gmres->incref();
+  gmres->setTolerances(1e-12, 1e-30);
+
+  TACSBVec *rhs = assembler->createVec();
+  rhs->incref();
+
+  // Assemble the matrix
+  assembler->assembleJacobian(1.0, 0.0, 0.0, NULL, mat);
+  pc->factor();
+
+  // Set boundary conditions for the right-hand-side (w(x) = 1 on boundary)
+  assembler->setBCs(rhs);
+
+  // Set a monitor for the Helmholtz equation
+  gmres->setMonitor(new KSMPrintStdout("Helmholtz", mpi_rank, 10));
+
+  // Solve the discrete Helmholtz equation to obtain the approximate distance
+  // function
+  gmres->solve(rhs, dist);
+
+  // Deallocate the variable values
+  gmres->decref();
+  rhs->decref();
+
+  dist->beginDistributeValues();
+  dist->endDistributeValues();
+}
+
+/*
+  Convert the Helmholtz solution to a distance
+*/
+static void convert_to_distance(TACSBVec *vec, double t) {
+  TacsScalar *array;
+  int size = vec->getArray(&array);
+  for (int i = 0; i < size; i++) {
+    if (array[i] <= 0.0) {
+      array[i] = 1e20;
+    } else if (array[i] >= 1.0) {
+      array[i] = 0.0;
+    } else {
+      array[i] = -t * log(array[i]);
+    }
+  }
+}
+
+/*
+  Create the distance field for the given filter
+*/
+TMRQuadDistanceField::TMRQuadDistanceField(TMRQuadForest *_filter, int _index,
+                                           double _cutoff, double _t) {
+  filter = _filter;
+  filter->incref();
+  index = _index;
+  cutoff = _cutoff;
+  t = _t;
+
+  filter_stamp = -1;
+  filter_quads = NULL;
+  num_filter_elements = 0;
+  refine = NULL;
+
+  forest = NULL;
+  node_elems = NULL;
+  node_pts = NULL;
+
+  num_bc_nodes = 0;
+  bc_nodes = NULL;
+  assembler = NULL;
+  dist = NULL;
+}
+
+/*
+  Free the distance field
+*/
+TMRQuadDistanceField::~TMRQuadDistanceField() {
+  filter->decref();
+  if (forest) {
+    forest->decref();
+  }
+  if (assembler) {
+    assembler->decref();
+  }
+  if (dist) {
+    dist->decref();
+  }
+  if (refine) {
+    delete[] refine;
+  }
+  if (node_elems) {
+    delete[] node_elems;
+  }
+  if (node_pts) {
+    delete[] node_pts;
+  }
+  if (bc_nodes) {
+    delete[] bc_nodes;
+  }
+}
+
+/*
+  Create the refined forest, unless the node stamp of the filter and
+  the refinement computed from rho match those used to create the
+  current forest
+*/
+void TMRQuadDistanceField::createForest(TACSBVec *rho) {
   MPI_Comm comm = filter->getMPIComm();
-  MPI_Comm_rank(comm, &mpi_rank);
 
   // Ensure that the nodes exist and then get the mesh order
   filter->createNodes();
-  int order = filter->getMeshOrder();
+  const int order = filter->getMeshOrder();
+  const int len = order * order;
   const int *filter_conn;
-  int num_filter_elements = 0;
-  filter->getNodeConn(&filter_conn, &num_filter_elements);
+  int num_elems = 0;
+  filter->getNodeConn(&filter_conn, &num_elems);
 
-  // Get the block size
-  int bsize = rho->getBlockSize();
+  TMRQuadrantArray *quad_array;
+  filter->getQuadrants(&quad_array);
+
+  // Refine the filter elements that contain the interface
+  const int bsize = rho->getBlockSize();
+  const int num_refine = get_num_refine(order);
+  int *new_refine = new int[num_elems];
+  TacsScalar *rho_values = new TacsScalar[bsize * len];
+  for (int i = 0; i < num_elems; i++) {
+    rho->getValues(len, &filter_conn[len * i], rho_values);
+    new_refine[i] = 0;
+    if (is_interface_element(bsize, index, cutoff, len, rho_values)) {
+      new_refine[i] = num_refine;
+    }
+  }
+  delete[] rho_values;
 
-  double *N = new double[order * order];
-  TacsScalar *rho_values = new TacsScalar[bsize * order * order];
-  TacsScalar *rho_local = new TacsScalar[bsize];
+  int changed = 1;
+  if (forest && filter->getNodeStamp() == filter_stamp &&
+      num_elems == num_filter_elements) {
+    changed = (memcmp(new_refine, refine, num_elems * sizeof(int)) != 0);
+  }
+  MPI_Allreduce(MPI_IN_PLACE, &changed, 1, MPI_INT, MPI_MAX, comm);
+  filter_quads = quad_array;
+  if (!changed) {
+    delete[] new_refine;
+    return;
+  }
 
-  // Distribute the design values
-  rho->beginDistributeValues();
-  rho->endDistributeValues();
+  // Free the data that depends on the refined forest
+  if (forest) {
+    forest->decref();
+  }
+  if (assembler) {
+    assembler->decref();
+    assembler = NULL;
+  }
+  if (dist) {
+    dist->decref();
+    dist = NULL;
+  }
+  if (refine) {
+    delete[] refine;
+  }
+  if (node_elems) {
+    delete[] node_elems;
+  }
+  if (node_pts) {
+    delete[] node_pts;
+  }
+  if (bc_nodes) {
+    delete[] bc_nodes;
+    bc_nodes = NULL;
+  }
+  num_bc_nodes = 0;
 
-  TMRQuadForest *forest = filter->duplicate();
-  forest->incref();
+  filter_stamp = filter->getNodeStamp();
+  num_filter_elements = num_elems;
+  refine = new_refine;
 
-  // Set the mesh order
+  // Refine the forest and balance it
+  forest = filter->duplicate();
+  forest->incref();
   forest->setMeshOrder(2);
+  forest->refine(refine);
+  forest->balance(0);
+  forest->createNodes();
 
-  // Set the number of refinements
-  int num_refine = 0;
-  if (order <= 3) {
-    num_refine = 1;
-  } else if (order <= 5) {
-    num_refine = 2;
-  } else {
-    num_refine = 3;
-  }
+  // Get the connectivity
+  const int *conn;
+  int num_elements = 0;
+  forest->getNodeConn(&conn, &num_elements);
 
-  // Search for those filter elements that need to be refined...
-  int *refine = new int[num_filter_elements];
+  // Get the array of the quadrants from the mesh
+  TMRQuadrant *quads;
+  TMRQuadrantArray *forest_quads;
+  forest->getQuadrants(&forest_quads);
+  forest_quads->getArray(&quads, NULL);
 
-  // Flag those nodes which have low, high or intermediate values
-  int *low = new int[bsize];
-  int *high = new int[bsize];
-  int *intermediate = new int[bsize];
+  // Locate each of the element corners within the filter
+  node_elems = new int[4 * num_elements];
+  node_pts = new double[2 * 4 * num_elements];
+  for (int i = 0; i < num_elements; i++) {
+    TMRQuadrant n = quads[i];
+    const int32_t hf = 1 << (TMR_MAX_LEVEL - quads[i].level);
 
-  for (int i = 0; i < num_filter_elements; i++) {
-    refine[i] = 0;
-    rho->getValues(order * order, &filter_conn[order * order * i], rho_values);
+    for (int jj = 0; jj < 2; jj++) {
+      for (int ii = 0; ii < 2; ii++) {
+        const int corner = 4 * i + ii + 2 * jj;
+        node_elems[corner] = -1;
 
-    // Reset the flags
-    for (int kk = 0; kk < bsize; kk++) {
-      low[kk] = 0;
-      high[kk] = 0;
-      intermediate[kk] = 0;
-    }
+        // Only locate the node if it is independent
+        if (conn[corner] >= 0) {
+          n.info = ii + 2 * jj;
 
-    // Scan through all the local node values for the filter
-    if (index >= 0 && index < bsize) {
-      for (int j = 0; j < order * order; j++) {
-        if (rho_values[bsize * j + index] < cutoff) {
-          low[0] = 1;
-        } else if (rho_values[bsize * j + index] > 1.0 - cutoff) {
-          high[0] = 1;
-        } else {
-          intermediate[0] = 1;
-        }
-      }
-    } else {
-      for (int j = 0; j < order * order; j++) {
-        for (int kk = 0; kk < bsize; kk++) {
-          if (rho_values[bsize * j + kk] < cutoff) {
-            low[kk] = 1;
-          } else if (rho_values[bsize * j + kk] > 1.0 - cutoff) {
-            high[kk] = 1;
-          } else {
-            intermediate[kk] = 1;
+          // Find the enclosing element on the filter mesh
+          const double knots[] = {-1.0, 1.0};
+          TMRQuadrant *filter_quad = filter->findEnclosing(2, knots, &n);
+
+          if (filter_quad && filter_quad->tag >= 0 &&
+              filter_quad->tag < num_filter_elements) {
+            node_elems[corner] = filter_quad->tag;
+
+            // Get the size of the filter element
+            const int32_t h = 1 << (TMR_MAX_LEVEL - filter_quad->level);
+
+            double *pt = &node_pts[2 * corner];
+            pt[0] = -1.0 + 2.0 * (quads[i].x + hf * ii - filter_quad->x) / h;
+            pt[1] = -1.0 + 2.0 * (quads[i].y + hf * jj - filter_quad->y) / h;
           }
         }
       }
     }
+  }
+}
 
-    if (index >= 0 && index < bsize) {
-      if ((low[0] && high[0]) || intermediate[0]) {
-        refine[i] = num_refine;
-      }
-    } else {
-      for (int kk = 0; kk < bsize; kk++) {
-        if ((low[kk] && high[kk]) || intermediate[kk]) {
-          refine[i] = num_refine;
+/*
+  Find the sorted list of the nodes of the refined forest where the
+  interpolated design values are intermediate
+*/
+int TMRQuadDistanceField::computeBCNodes(TACSBVec *rho, int *bcs) {
+  const int order = filter->getMeshOrder();
+  const int len = order * order;
+  const int *filter_conn;
+  filter->getNodeConn(&filter_conn);
+
+  const int *conn;
+  int num_elements = 0;
+  forest->getNodeConn(&conn, &num_elements);
+
+  const int bsize = rho->getBlockSize();
+  double *N = new double[len];
+  TacsScalar *rho_values = new TacsScalar[bsize * len];
+  TacsScalar *rho_local = new TacsScalar[bsize];
+
+  int nbcs = 0;
+  for (int corner = 0; corner < 4 * num_elements; corner++) {
+    const int filter_elem = node_elems[corner];
+    if (conn[corner] >= 0 && filter_elem >= 0) {
+      rho->getValues(len, &filter_conn[len * filter_elem], rho_values);
+
+      // Evaluate the local values of rho based on the interpolation
+      filter->evalInterp(&node_pts[2 * corner], N);
+      memset(rho_local, 0, bsize * sizeof(TacsScalar));
+      for (int k = 0; k < len; k++) {
+        for (int kk = 0; kk < bsize; kk++) {
+          rho_local[kk] += rho_values[k * bsize + kk] * N[k];
         }
       }
+
+      if (is_intermediate(bsize, index, cutoff, rho_local)) {
+        bcs[nbcs] = conn[corner];
+        nbcs++;
+      }
     }
   }
 
-  delete[] low;
-  delete[] high;
-  delete[] intermediate;
+  delete[] N;
+  delete[] rho_values;
+  delete[] rho_local;
 
-  // Refine the forest and balance it
-  forest->refine(refine);
-  delete[] refine;
+  return sort_and_uniquify(nbcs, bcs);
+}
 
-  forest->balance(0);
+/*
+  Create the assembler with the given interface nodes and solve for
+  the distance. This takes ownership of the array of interface nodes.
+*/
+void TMRQuadDistanceField::solveDistance(int nbcs, int *bcs) {
+  int mpi_rank;
+  MPI_Comm comm = filter->getMPIComm();
+  MPI_Comm_rank(comm, &mpi_rank);
 
-  // Balance the forest and create the nodes
-  forest->createNodes();
+  if (assembler) {
+    assembler->decref();
+  }
+  if (dist) {
+    dist->decref();
+  }
+  if (bc_nodes) {
+    delete[] bc_nodes;
+  }
+  num_bc_nodes = nbcs;
+  bc_nodes = bcs;
 
   // Get the connectivity
   const int *conn;
@@ -174,7 +473,7 @@ void TMRApproximateDistance(TMRQuadForest *filter, int index, double cutoff,
   }
 
   // Create the associated TACSAssembler object
-  TACSAssembler *assembler =
+  assembler =
       new TACSAssembler(comm, 1, num_owned_nodes, num_elements, num_dep_nodes);
   assembler->incref();
 
@@ -189,94 +488,10 @@ void TMRApproximateDistance(TMRQuadForest *filter, int index, double cutoff,
   assembler->setElements(elements);
   delete[] elements;
 
-  // Filter quadrants
-  TMRQuadrant *filter_quads;
-  TMRQuadrantArray *filter_quad_array;
-  filter->getQuadrants(&filter_quad_array);
-  filter_quad_array->getArray(&filter_quads, NULL);
-
-  // Get the array of the quadrants from the mesh
-  TMRQuadrant *quads;
-  TMRQuadrantArray *quad_array;
-  forest->getQuadrants(&quad_array);
-  quad_array->getArray(&quads, NULL);
-
-  for (int i = 0; i < num_elements; i++) {
-    // Set the node location
-    TMRQuadrant n = quads[i];
-    const int32_t hf = 1 << (TMR_MAX_LEVEL - quads[i].level);
-
-    for (int jj = 0; jj < 2; jj++) {
-      for (int ii = 0; ii < 2; ii++) {
-        // Only execute the loop if the node is positive
-        int node = conn[4 * i + ii + 2 * jj];
-        if (node >= 0) {
-          // Set the node location
-          n.info = ii + 2 * jj;
-
-          // Find the enclosing element on the filter mesh
-          const double knots[] = {-1.0, 1.0};
-          TMRQuadrant *filter_quad = filter->findEnclosing(2, knots, &n);
-
-          if (filter_quad) {
-            // Get the values of the density at the nodes
-            int filter_elem = filter_quad->tag;
-            if (filter_elem >= 0 && filter_elem < num_filter_elements) {
-              rho->getValues(order * order,
-                             &filter_conn[order * order * filter_elem],
-                             rho_values);
-
-              // Get the size of the filter element
-              const int32_t h = 1 << (TMR_MAX_LEVEL - filter_quad->level);
-
-              double pt[2];
-              pt[0] = -1.0 + 2.0 * (quads[i].x + hf * ii - filter_quad->x) / h;
-              pt[1] = -1.0 + 2.0 * (quads[i].y + hf * jj - filter_quad->y) / h;
-
-              // Compute the interpolation
-              filter->evalInterp(pt, N);
-
-              // Evaluate the local values of rho based on the interpolation
-              memset(rho_local, 0, bsize * sizeof(TacsScalar));
-              for (int k = 0; k < order * order; k++) {
-                for (int kk = 0; kk < bsize; kk++) {
-                  rho_local[kk] += rho_values[k * bsize + kk] * N[k];
-                }
-              }
-
-              // Check if this is an intermediate value of the design variables
-              if (index >= 0 && index < bsize) {
-                if (rho_local[index] >= cutoff &&
-                    rho_local[index] <= 1.0 - cutoff) {
-                  int nbcs = 1;
-                  int vars = 0;
-                  TacsScalar value = 1.0;
-                  assembler->addBCs(1, &node, nbcs, &vars, &value);
-                }
-              } else {
-                // Loop over all the dimension
-                for (int kk = 0; kk < bsize; kk++) {
-                  if (rho_local[kk] >= cutoff &&
-                      rho_local[kk] <= 1.0 - cutoff) {
-                    int nbcs = 1;
-                    int vars = 0;
-                    TacsScalar value = 1.0;
-                    assembler->addBCs(1, &node, nbcs, &vars, &value);
-                    break;
-                  }
-                }
-              }
-            }
-          }
-        }
-      }
-    }
-  }
-
-  // Free the data
-  delete[] N;
-  delete[] rho_values;
-  delete[] rho_local;
+  // Set the unit values at the interface nodes
+  int vars = 0;
+  TacsScalar value = 1.0;
+  assembler->addBCs(num_bc_nodes, bc_nodes, 1, &vars, &value);
 
   assembler->initialize();
 
@@ -314,66 +529,91 @@ void TMRApproximateDistance(TMRQuadForest *filter, int index, double cutoff,
   assembler->setNodes(X);
   X->decref();
 
-  // Approximately solve the equations....
-  TACSParallelMat *mat = assembler->createMat();
-  int zero_guess = 1;
-  TacsScalar omega = 1.0;
-  int niters = 5;
-  int symm = 1;
-  TACSGaussSeidel *pc =
-      new TACSGaussSeidel(mat, zero_guess, omega, niters, symm);
-
-  // Allocate the GMRES object
-  int m = 20;
-  int nrestart = 4;
-  int isflexible = 1;
-  GMRES *gmres = new GMRES(mat, pc, m, nrestart, isflexible);
-  gmres->incref();
-  gmres->setTolerances(1e-12, 1e-30);
-
-  TACSBVec *rhs = assembler->createVec();
-  TACSBVec *dist = assembler->createVec();
-  rhs->incref();
+  dist = assembler->createVec();
   dist->incref();
+  solve_helmholtz(assembler, dist);
+}
 
-  // Assemble the matrix
-  assembler->assembleJacobian(1.0, 0.0, 0.0, NULL, mat);
-  pc->factor();
+/*
+  Write the distance on the refined forest to an f5 file
+*/
+void TMRQuadDistanceField::writeDistance(const char *filename) {
+  TACSBVec *vec = assembler->createVec();
+  vec->incref();
+  vec->copyValues(dist);
+  convert_to_distance(vec, t);
+  assembler->setVariables(vec);
+  vec->decref();
+
+  int write_flag = (TACS_OUTPUT_CONNECTIVITY | TACS_OUTPUT_NODES |
+                    TACS_OUTPUT_DISPLACEMENTS);
+  TACSToFH5 *f5 = new TACSToFH5(assembler, TACS_SCALAR_2D_ELEMENT, write_flag);
+  f5->incref();
+  f5->writeToFile(filename);
+  f5->decref();
+}
 
-  // Set boundary conditions for the right-hand-side (w(x) = 1 on boundary)
-  assembler->setBCs(rhs);
+/*
+  Compute the minimum distance within each filter element
 
-  // Set a monitor for the Helmholtz equation
-  gmres->setMonitor(new KSMPrintStdout("Helmholtz", mpi_rank, 10));
+  The design values are distributed here. The Helmholtz problem is
+  only solved when the interface nodes on the refined forest differ
+  from those used for the current solution.
+*/
+void TMRQuadDistanceField::computeDistance(TACSBVec *rho, double *min_dist,
+                                           const char *filename) {
+  MPI_Comm comm = filter->getMPIComm();
 
-  // Solve the discrete Helmholtz equation to obtain the approximate distance
-  // function
-  gmres->solve(rhs, dist);
+  // Distribute the design values
+  rho->beginDistributeValues();
+  rho->endDistributeValues();
 
-  // Deallocate the variable values
-  gmres->decref();
-  rhs->decref();
+  // Create or re-use the refined forest
+  createForest(rho);
 
-  dist->beginDistributeValues();
-  dist->endDistributeValues();
+  // Get the connectivity
+  const int *conn;
+  int num_elements = 0;
+  forest->getNodeConn(&conn, &num_elements);
+
+  // Find the interface nodes and solve if they have changed
+  int *bcs = new int[4 * num_elements];
+  int nbcs = computeBCNodes(rho, bcs);
+  int changed = 1;
+  if (assembler && nbcs == num_bc_nodes) {
+    changed = (nbcs > 0 && memcmp(bcs, bc_nodes, nbcs * sizeof(int)) != 0);
+  }
+  MPI_Allreduce(MPI_IN_PLACE, &changed, 1, MPI_INT, MPI_MAX, comm);
+  if (changed) {
+    solveDistance(nbcs, bcs);
+  } else {
+    delete[] bcs;
+  }
+
+  // Get the filter and forest quadrants
+  TMRQuadrant *fquads, *quads;
+  filter_quads->getArray(&fquads, NULL);
+  TMRQuadrantArray *quad_array;
+  forest->getQuadrants(&quad_array);
+  quad_array->getArray(&quads, NULL);
 
   // Extract the actual distance using the transformation
-  for (int i = 0, index = 0; i < num_filter_elements; i++) {
+  for (int i = 0, elem = 0; i < num_filter_elements; i++) {
     double max_val = -1e20;
 
-    while (index < num_elements && filter_quads[i].contains(&quads[index])) {
+    while (elem < num_elements && fquads[i].contains(&quads[elem])) {
       for (int ii = 0; ii < 4; ii++) {
         // Only execute the loop if the node is positive
-        int node = conn[4 * index + ii];
+        int node = conn[4 * elem + ii];
         if (node >= 0) {
           TacsScalar value;
           dist->getValues(1, &node, &value);
-          if (value > max_val) {
-            max_val = value;
+          if (TacsRealPart(value) > max_val) {
+            max_val = TacsRealPart(value);
           }
         }
       }
-      index++;
+      elem++;
     }
 
     min_dist[i] = 1e20;
@@ -384,147 +624,267 @@ void TMRApproximateDistance(TMRQuadForest *filter, int index, double cutoff,
 
   // Write out the result to an f5 file
   if (filename) {
-    // Convert to a distance
-    TacsScalar *dist_array;
-    int size = dist->getArray(&dist_array);
-    for (int i = 0; i < size; i++) {
-      if (dist_array[i] <= 0.0) {
-        dist_array[i] = 1e20;
-      } else if (dist_array[i] >= 1.0) {
-        dist_array[i] = 0.0;
-      } else {
-        dist_array[i] = -t * log(dist_array[i]);
-      }
-    }
+    writeDistance(filename);
+  }
+}
 
-    assembler->setVariables(dist);
+/*
+  Create the distance field for the given filter
+*/
+TMROctDistanceField::TMROctDistanceField(TMROctForest *_filter, int _index,
+                                         double _cutoff, double _t) {
+  filter = _filter;
+  filter->incref();
+  index = _index;
+  cutoff = _cutoff;
+  t = _t;
+
+  filter_stamp = -1;
+  filter_octs = NULL;
+  num_filter_elements = 0;
+  refine = NULL;
+
+  forest = NULL;
+  node_elems = NULL;
+  node_pts = NULL;
+
+  num_bc_nodes = 0;
+  bc_nodes = NULL;
+  assembler = NULL;
+  dist = NULL;
+}
 
-    int write_flag = (TACS_OUTPUT_CONNECTIVITY | TACS_OUTPUT_NODES |
-                      TACS_OUTPUT_DISPLACEMENTS);
-    TACSToFH5 *f5 =
-        new TACSToFH5(assembler, TACS_SCALAR_2D_ELEMENT, write_flag);
-    f5->incref();
-    f5->writeToFile(filename);
-    f5->decref();
+/*
+  Free the distance field
+*/
+TMROctDistanceField::~TMROctDistanceField() {
+  filter->decref();
+  if (forest) {
+    forest->decref();
+  }
+  if (assembler) {
+    assembler->decref();
+  }
+  if (dist) {
+    dist->decref();
+  }
+  if (refine) {
+    delete[] refine;
+  }
+  if (node_elems) {
+    delete[] node_elems;
+  }
+  if (node_pts) {
+    delete[] node_pts;
+  }
+  if (bc_nodes) {
+    delete[] bc_nodes;
   }
-
-  // Deallocate objects
-  dist->decref();
-  assembler->decref();
-  forest->decref();
 }
 
-void TMRApproximateDistance(TMROctForest *filter, int index, double cutoff,
-                            double t, TACSBVec *rho, const char *filename,
-                            double *min_dist) {
-  int mpi_rank;
+/*
+  Create the refined forest, unless the node stamp of the filter and
+  the refinement computed from rho match those used to create the
+  current forest
+*/
+void TMROctDistanceField::createForest(TACSBVec *rho) {
   MPI_Comm comm = filter->getMPIComm();
-  MPI_Comm_rank(comm, &mpi_rank);
 
   // Ensure that the nodes exist and then get the mesh order
   filter->createNodes();
-  int order = filter->getMeshOrder();
+  const int order = filter->getMeshOrder();
+  const int len = order * order * order;
   const int *filter_conn;
-  int num_filter_elements = 0;
-  filter->getNodeConn(&filter_conn, &num_filter_elements);
+  int num_elems = 0;
+  filter->getNodeConn(&filter_conn, &num_elems);
 
-  // Get the block size
-  int bsize = rho->getBlockSize();
+  TMROctantArray *oct_array;
+  filter->getOctants(&oct_array);
+
+  // Refine the filter elements that contain the interface
+  const int bsize = rho->getBlockSize();
+  const int num_refine = get_num_refine(order);
+  int *new_refine = new int[num_elems];
+  TacsScalar *rho_values = new TacsScalar[bsize * len];
+  for (int i = 0; i < num_elems; i++) {
+    rho->getValues(len, &filter_conn[len * i], rho_values);
+    new_refine[i] = 0;
+    if (is_interface_element(bsize, index, cutoff, len, rho_values)) {
+      new_refine[i] = num_refine;
+    }
+  }
+  delete[] rho_values;
 
-  double *N = new double[order * order * order];
-  TacsScalar *rho_values = new TacsScalar[bsize * order * order * order];
-  TacsScalar *rho_local = new TacsScalar[bsize];
+  int changed = 1;
+  if (forest && filter->getNodeStamp() == filter_stamp &&
+      num_elems == num_filter_elements) {
+    changed = (memcmp(new_refine, refine, num_elems * sizeof(int)) != 0);
+  }
+  MPI_Allreduce(MPI_IN_PLACE, &changed, 1, MPI_INT, MPI_MAX, comm);
+  filter_octs = oct_array;
+  if (!changed) {
+    delete[] new_refine;
+    return;
+  }
 
-  // Distribute the design values
-  rho->beginDistributeValues();
-  rho->endDistributeValues();
+  // Free the data that depends on the refined forest
+  if (forest) {
+    forest->decref();
+  }
+  if (assembler) {
+    assembler->decref();
+    assembler = NULL;
+  }
+  if (dist) {
+    dist->decref();
+    dist = NULL;
+  }
+  if (refine) {
+    delete[] refine;
+  }
+  if (node_elems) {
+    delete[] node_elems;
+  }
+  if (node_pts) {
+    delete[] node_pts;
+  }
+  if (bc_nodes) {
+    delete[] bc_nodes;
+    bc_nodes = NULL;
+  }
+  num_bc_nodes = 0;
 
-  TMROctForest *forest = filter->duplicate();
-  forest->incref();
+  filter_stamp = filter->getNodeStamp();
+  num_filter_elements = num_elems;
+  refine = new_refine;
 
-  // Set the mesh order
+  // Refine the forest and balance it
+  forest = filter->duplicate();
+  forest->incref();
   forest->setMeshOrder(2);
+  forest->refine(refine);
+  forest->balance(0);
+  forest->createNodes();
 
-  // Set the number of refinements
-  int num_refine = 0;
-  if (order <= 3) {
-    num_refine = 1;
-  } else if (order <= 5) {
-    num_refine = 2;
-  } else {
-    num_refine = 3;
-  }
+  // Get the connectivity
+  const int *conn;
+  int num_elements = 0;
+  forest->getNodeConn(&conn, &num_elements);
+
+  // Get the array of the octants from the mesh
+  TMROctant *octs;
+  TMROctantArray *forest_octs;
+  forest->getOctants(&forest_octs);
+  forest_octs->getArray(&octs, NULL);
 
-  // Search for those filter elements that need to be refined...
-  int *refine = new int[num_filter_elements];
+  // Locate each of the element corners within the filter
+  node_elems = new int[8 * num_elements];
+  node_pts = new double[3 * 8 * num_elements];
+  for (int i = 0; i < num_elements; i++) {
+    TMROctant n = octs[i];
+    const int32_t hf = 1 << (TMR_MAX_LEVEL - octs[i].level);
 
-  // Flag those nodes which have low, high or intermediate values
-  int *low = new int[bsize];
-  int *high = new int[bsize];
-  int *intermediate = new int[bsize];
+    for (int kk = 0; kk < 2; kk++) {
+      for (int jj = 0; jj < 2; jj++) {
+        for (int ii = 0; ii < 2; ii++) {
+          const int corner = 8 * i + ii + 2 * jj + 4 * kk;
+          node_elems[corner] = -1;
 
-  for (int i = 0; i < num_filter_elements; i++) {
-    refine[i] = 0;
-    rho->getValues(order * order * order,
-                   &filter_conn[order * order * order * i], rho_values);
+          // Only locate the node if it is independent
+          if (conn[corner] >= 0) {
+            n.info = ii + 2 * jj + 4 * kk;
 
-    // Reset the flags
-    for (int kk = 0; kk < bsize; kk++) {
-      low[kk] = 0;
-      high[kk] = 0;
-      intermediate[kk] = 0;
-    }
+            // Find the enclosing element on the filter mesh
+            const double knots[] = {-1.0, 1.0};
+            TMROctant *filter_oct = filter->findEnclosing(2, knots, &n);
 
-    // Scan through all the local node values for the filter
-    if (index >= 0 && index < bsize) {
-      for (int j = 0; j < order * order * order; j++) {
-        if (rho_values[bsize * j + index] < cutoff) {
-          low[0] = 1;
-        } else if (rho_values[bsize * j + index] > 1.0 - cutoff) {
-          high[0] = 1;
-        } else {
-          intermediate[0] = 1;
-        }
-      }
-    } else {
-      for (int j = 0; j < order * order * order; j++) {
-        for (int kk = 0; kk < bsize; kk++) {
-          if (rho_values[bsize * j + kk] < cutoff) {
-            low[kk] = 1;
-          } else if (rho_values[bsize * j + kk] > 1.0 - cutoff) {
-            high[kk] = 1;
-          } else {
-            intermediate[kk] = 1;
+            if (filter_oct && filter_oct->tag >= 0 &&
+                filter_oct->tag < num_filter_elements) {
+              node_elems[corner] = filter_oct->tag;
+
+              // Get the size of the filter element
+              const int32_t h = 1 << (TMR_MAX_LEVEL - filter_oct->level);
+
+              double *pt = &node_pts[3 * corner];
+              pt[0] = -1.0 + 2.0 * (octs[i].x + hf * ii - filter_oct->x) / h;
+              pt[1] = -1.0 + 2.0 * (octs[i].y + hf * jj - filter_oct->y) / h;
+              pt[2] = -1.0 + 2.0 * (octs[i].z + hf * kk - filter_oct->z) / h;
+            }
           }
         }
       }
     }
+  }
+}
 
-    if (index >= 0 && index < bsize) {
-      if ((low[0] && high[0]) || intermediate[0]) {
-        refine[i] = num_refine;
-      }
-    } else {
-      for (int kk = 0; kk < bsize; kk++) {
-        if ((low[kk] && high[kk]) || intermediate[kk]) {
-          refine[i] = num_refine;
+/*
+  Find the sorted list of the nodes of the refined forest where the
+  interpolated design values are intermediate
+*/
+int TMROctDistanceField::computeBCNodes(TACSBVec *rho, int *bcs) {
+  const int order = filter->getMeshOrder();
+  const int len = order * order * order;
+  const int *filter_conn;
+  filter->getNodeConn(&filter_conn);
+
+  const int *conn;
+  int num_elements = 0;
+  forest->getNodeConn(&conn, &num_elements);
+
+  const int bsize = rho->getBlockSize();
+  double *N = new double[len];
+  TacsScalar *rho_values = new TacsScalar[bsize * len];
+  TacsScalar *rho_local = new TacsScalar[bsize];
+
+  int nbcs = 0;
+  for (int corner = 0; corner < 8 * num_elements; corner++) {
+    const int filter_elem = node_elems[corner];
+    if (conn[corner] >= 0 && filter_elem >= 0) {
+      rho->getValues(len, &filter_conn[len * filter_elem], rho_values);
+
+      // Evaluate the local values of rho based on the interpolation
+      filter->evalInterp(&node_pts[3 * corner], N);
+      memset(rho_local, 0, bsize * sizeof(TacsScalar));
+      for (int k = 0; k < len; k++) {
+        for (int kk = 0; kk < bsize; kk++) {
+          rho_local[kk] += rho_values[k * bsize + kk] * N[k];
         }
       }
+
+      if (is_intermediate(bsize, index, cutoff, rho_local)) {
+        bcs[nbcs] = conn[corner];
+        nbcs++;
+      }
     }
   }
 
-  delete[] low;
-  delete[] high;
-  delete[] intermediate;
+  delete[] N;
+  delete[] rho_values;
+  delete[] rho_local;
 
-  // Refine the forest and balance it
-  forest->refine(refine);
-  delete[] refine;
+  return sort_and_uniquify(nbcs, bcs);
+}
 
-  forest->balance(0);
+/*
+  Create the assembler with the given interface nodes and solve for
+  the distance. This takes ownership of the array of interface nodes.
+*/
+void TMROctDistanceField::solveDistance(int nbcs, int *bcs) {
+  int mpi_rank;
+  MPI_Comm comm = filter->getMPIComm();
+  MPI_Comm_rank(comm, &mpi_rank);
 
-  // Balance the forest and create the nodes
-  forest->createNodes();
+  if (assembler) {
+    assembler->decref();
+  }
+  if (dist) {
+    dist->decref();
+  }
+  if (bc_nodes) {
+    delete[] bc_nodes;
+  }
+  num_bc_nodes = nbcs;
+  bc_nodes = bcs;
 
   // Get the connectivity
   const int *conn;
@@ -557,7 +917,7 @@ void TMRApproximateDistance(TMROctForest *filter, int index, double cutoff,
   }
 
   // Create the associated TACSAssembler object
-  TACSAssembler *assembler =
+  assembler =
       new TACSAssembler(comm, 1, num_owned_nodes, num_elements, num_dep_nodes);
   assembler->incref();
 
@@ -572,99 +932,10 @@ void TMRApproximateDistance(TMROctForest *filter, int index, double cutoff,
   assembler->setElements(elements);
   delete[] elements;
 
-  // Filter octants
-  TMROctant *filter_octs;
-  TMROctantArray *filter_oct_array;
-  filter->getOctants(&filter_oct_array);
-  filter_oct_array->getArray(&filter_octs, NULL);
-
-  // Get the array of the octants from the mesh
-  TMROctant *octs;
-  TMROctantArray *oct_array;
-  forest->getOctants(&oct_array);
-  oct_array->getArray(&octs, NULL);
-
-  for (int i = 0; i < num_elements; i++) {
-    // Set the node location
-    TMROctant n = octs[i];
-    const int32_t hf = 1 << (TMR_MAX_LEVEL - octs[i].level);
-
-    for (int kk = 0; kk < 2; kk++) {
-      for (int jj = 0; jj < 2; jj++) {
-        for (int ii = 0; ii < 2; ii++) {
-          // Only execute the loop if the node is positive
-          int node = conn[8 * i + ii + 2 * jj + 4 * kk];
-          if (node >= 0) {
-            // Set the node location
-            n.info = ii + 2 * jj + 4 * kk;
-
-            // Find the enclosing element on the filter mesh
-            const double knots[] = {-1.0, 1.0};
-            TMROctant *filter_oct = filter->findEnclosing(2, knots, &n);
-
-            if (filter_oct) {
-              // Get the values of the density at the nodes
-              int filter_elem = filter_oct->tag;
-              if (filter_elem >= 0 && filter_elem < num_filter_elements) {
-                rho->getValues(
-                    order * order * order,
-                    &filter_conn[order * order * order * filter_elem],
-                    rho_values);
-
-                // Get the size of the filter element
-                const int32_t h = 1 << (TMR_MAX_LEVEL - filter_oct->level);
-
-                double pt[3];
-                pt[0] = -1.0 + 2.0 * (octs[i].x + hf * ii - filter_oct->x) / h;
-                pt[1] = -1.0 + 2.0 * (octs[i].y + hf * jj - filter_oct->y) / h;
-                pt[2] = -1.0 + 2.0 * (octs[i].z + hf * kk - filter_oct->z) / h;
-
-                // Compute the interpolation
-                filter->evalInterp(pt, N);
-
-                // Evaluate the local values of rho based on the interpolation
-                memset(rho_local, 0, bsize * sizeof(TacsScalar));
-                for (int k = 0; k < order * order * order; k++) {
-                  for (int nk = 0; nk < bsize; nk++) {
-                    rho_local[nk] += rho_values[k * bsize + nk] * N[k];
-                  }
-                }
-
-                // Check if this is an intermediate value of the design
-                // variables
-                if (index >= 0 && index < bsize) {
-                  if (rho_local[index] >= cutoff &&
-                      rho_local[index] <= 1.0 - cutoff) {
-                    int nbcs = 1;
-                    int vars = 0;
-                    TacsScalar value = 1.0;
-                    assembler->addBCs(1, &node, nbcs, &vars, &value);
-                  }
-                } else {
-                  // Loop over all the dimension
-                  for (int nk = 0; nk < bsize; nk++) {
-                    if (rho_local[nk] >= cutoff &&
-                        rho_local[nk] <= 1.0 - cutoff) {
-                      int nbcs = 1;
-                      int vars = 0;
-                      TacsScalar value = 1.0;
-                      assembler->addBCs(1, &node, nbcs, &vars, &value);
-                      break;
-                    }
-                  }
-                }
-              }
-            }
-          }
-        }
-      }
-    }
-  }
-
-  // Free the data
-  delete[] N;
-  delete[] rho_values;
-  delete[] rho_local;
+  // Set the unit values at the interface nodes
+  int vars = 0;
+  TacsScalar value = 1.0;
+  assembler->addBCs(num_bc_nodes, bc_nodes, 1, &vars, &value);
 
   assembler->initialize();
 
@@ -702,66 +973,91 @@ void TMRApproximateDistance(TMROctForest *filter, int index, double cutoff,
   assembler->setNodes(X);
   X->decref();
 
-  // Approximately solve the equations....
-  TACSParallelMat *mat = assembler->createMat();
-  int zero_guess = 1;
-  TacsScalar omega = 1.0;
-  int niters = 5;
-  int symm = 1;
-  TACSGaussSeidel *pc =
-      new TACSGaussSeidel(mat, zero_guess, omega, niters, symm);
-
-  // Allocate the GMRES object
-  int m = 20;
-  int nrestart = 4;
-  int isflexible = 1;
-  GMRES *gmres = new GMRES(mat, pc, m, nrestart, isflexible);
-  gmres->incref();
-  gmres->setTolerances(1e-12, 1e-30);
-
-  TACSBVec *rhs = assembler->createVec();
-  TACSBVec *dist = assembler->createVec();
-  rhs->incref();
+  dist = assembler->createVec();
   dist->incref();
+  solve_helmholtz(assembler, dist);
+}
 
-  // Assemble the matrix
-  assembler->assembleJacobian(1.0, 0.0, 0.0, NULL, mat);
-  pc->factor();
+/*
+  Write the distance on the refined forest to an f5 file
+*/
+void TMROctDistanceField::writeDistance(const char *filename) {
+  TACSBVec *vec = assembler->createVec();
+  vec->incref();
+  vec->copyValues(dist);
+  convert_to_distance(vec, t);
+  assembler->setVariables(vec);
+  vec->decref();
+
+  int write_flag = (TACS_OUTPUT_CONNECTIVITY | TACS_OUTPUT_NODES |
+                    TACS_OUTPUT_DISPLACEMENTS);
+  TACSToFH5 *f5 = new TACSToFH5(assembler, TACS_SCALAR_3D_ELEMENT, write_flag);
+  f5->incref();
+  f5->writeToFile(filename);
+  f5->decref();
+}
 
-  // Set boundary conditions for the right-hand-side (w(x) = 1 on boundary)
-  assembler->setBCs(rhs);
+/*
+  Compute the minimum distance within each filter element
 
-  // Set a monitor for the Helmholtz equation
-  gmres->setMonitor(new KSMPrintStdout("Helmholtz", mpi_rank, 10));
+  The design values are distributed here. The Helmholtz problem is
+  only solved when the interface nodes on the refined forest differ
+  from those used for the current solution.
+*/
+void TMROctDistanceField::computeDistance(TACSBVec *rho, double *min_dist,
+                                          const char *filename) {
+  MPI_Comm comm = filter->getMPIComm();
 
-  // Solve the discrete Helmholtz equation to obtain the approximate distance
-  // function
-  gmres->solve(rhs, dist);
+  // Distribute the design values
+  rho->beginDistributeValues();
+  rho->endDistributeValues();
 
-  // Deallocate the variable values
-  gmres->decref();
-  rhs->decref();
+  // Create or re-use the refined forest
+  createForest(rho);
 
-  dist->beginDistributeValues();
-  dist->endDistributeValues();
+  // Get the connectivity
+  const int *conn;
+  int num_elements = 0;
+  forest->getNodeConn(&conn, &num_elements);
+
+  // Find the interface nodes and solve if they have changed
+  int *bcs = new int[8 * num_elements];
+  int nbcs = computeBCNodes(rho, bcs);
+  int changed = 1;
+  if (assembler && nbcs == num_bc_nodes) {
+    changed = (nbcs > 0 && memcmp(bcs, bc_nodes, nbcs * sizeof(int)) != 0);
+  }
+  MPI_Allreduce(MPI_IN_PLACE, &changed, 1, MPI_INT, MPI_MAX, comm);
+  if (changed) {
+    solveDistance(nbcs, bcs);
+  } else {
+    delete[] bcs;
+  }
+
+  // Get the filter and forest octants
+  TMROctant *focts, *octs;
+  filter_octs->getArray(&focts, NULL);
+  TMROctantArray *oct_array;
+  forest->getOctants(&oct_array);
+  oct_array->getArray(&octs, NULL);
 
   // Extract the actual distance using the transformation
-  for (int i = 0, index = 0; i < num_filter_elements; i++) {
+  for (int i = 0, elem = 0; i < num_filter_elements; i++) {
     double max_val = -1e20;
 
-    while (index < num_elements && filter_octs[i].contains(&octs[index])) {
+    while (elem < num_elements && focts[i].contains(&octs[elem])) {
       for (int ii = 0; ii < 8; ii++) {
         // Only execute the loop if the node is positive
-        int node = conn[8 * index + ii];
+        int node = conn[8 * elem + ii];
         if (node >= 0) {
           TacsScalar value;
           dist->getValues(1, &node, &value);
-          if (value > max_val) {
-            max_val = value;
+          if (TacsRealPart(value) > max_val) {
+            max_val = TacsRealPart(value);
           }
         }
       }
-      index++;
+      elem++;
     }
 
     min_dist[i] = 1e20;
@@ -772,32 +1068,26 @@ void TMRApproximateDistance(TMROctForest *filter, int index, double cutoff,
 
   // Write out the result to an f5 file
   if (filename) {
-    // Convert to a distance
-    TacsScalar *dist_array;
-    int size = dist->getArray(&dist_array);
-    for (int i = 0; i < size; i++) {
-      if (dist_array[i] <= 0.0) {
-        dist_array[i] = 1e20;
-      } else if (dist_array[i] >= 1.0) {
-        dist_array[i] = 0.0;
-      } else {
-        dist_array[i] = -t * log(dist_array[i]);
-      }
-    }
-
-    assembler->setVariables(dist);
-
-    int write_flag = (TACS_OUTPUT_CONNECTIVITY | TACS_OUTPUT_NODES |
-                      TACS_OUTPUT_DISPLACEMENTS);
-    TACSToFH5 *f5 =
-        new TACSToFH5(assembler, TACS_SCALAR_3D_ELEMENT, write_flag);
-    f5->incref();
-    f5->writeToFile(filename);
-    f5->decref();
+    writeDistance(filename);
   }
+}
 
-  // Deallocate objects
-  dist->decref();
-  assembler->decref();
-  forest->decref();
+void TMRApproximateDistance(TMRQuadForest *filter, int index, double cutoff,
+                            double t, TACSBVec *rho, const char *filename,
+                            double *min_dist) {
+  TMRQuadDistanceField *field =
+      new TMRQuadDistanceField(filter, index, cutoff, t);
+  field->incref();
+  field->computeDistance(rho, min_dist, filename);
+  field->decref();
+}
+
+void TMRApproximateDistance(TMROctForest *filter, int index, double cutoff,
+                            double t, TACSBVec *rho, const char *filename,
+                            double *min_dist) {
+  TMROctDistanceField *field =
+      new TMROctDistanceField(filter, index, cutoff, t);
+  field->incref();
+  field->computeDistance(rho, min_dist, filename);
+  field->decref();
 }
@@ -17,7 +17,6 @@
   See the License for the specific language governing permissions and
   limitations under the License.
 */
-
 #ifndef TMR_APPROXIMATE_DISTANCE_H
 #define TMR_APPROXIMATE_DISTANCE_H
 
@@ -25,6 +24,110 @@
 #include "TMROctForest.h"
 #include "TMRQuadForest.h"
 
+/*
+  Compute an approximate distance to the interface of a density field
+
+  The interface is taken to be the nodes where the design values lie
+  within the interval [cutoff, 1 - cutoff]. The filter elements that
+  contain the interface are refined, and a Helmholtz problem with unit
+  values on the interface is solved on the refined mesh. The distance
+  is then recovered as d = -t*log(w) and the minimum distance within
+  each filter element is returned.
+
+  The refined forest and the locations of its nodes within the filter
+  are kept between calls. They are re-created when the node stamp of
+  the filter changes, since the filter has been refined, repartitioned
+  or re-meshed, or when the refinement pattern computed from rho
+  changes. The interface conditions are imposed when the assembler is
+  initialized, so the assembler and its matrix are re-created whenever
+  the interface nodes change. Only when the interface nodes are also
+  unchanged is the previous solution reused without a solve.
+*/
+class TMRQuadDistanceField : public TMREntity {
+ public:
+  TMRQuadDistanceField(TMRQuadForest *_filter, int _index, double _cutoff,
+                       double _t);
+  ~TMRQuadDistanceField();
+
+  // Compute the minimum distance within each element of the filter
+  void computeDistance(TACSBVec *rho, double *min_dist,
+                       const char *filename = NULL);
+
+ private:
+  void createForest(TACSBVec *rho);
+  int computeBCNodes(TACSBVec *rho, int *bcs);
+  void solveDistance(int nbcs, int *bcs);
+  void writeDistance(const char *filename);
+
+  // The filter and the density component used for the interface
+  TMRQuadForest *filter;
+  int index;
+  double cutoff, t;
+
+  // The node stamp of the filter, its quadrants and the refinement
+  // used to create the forest
+  int filter_stamp;
+  TMRQuadrantArray *filter_quads;
+  int num_filter_elements;
+  int *refine;
+
+  // The refined forest and the filter element/parametric point for
+  // each of its element corners
+  TMRQuadForest *forest;
+  int *node_elems;
+  double *node_pts;
+
+  // The interface nodes, assembler and distance solution
+  int num_bc_nodes;
+  int *bc_nodes;
+  TACSAssembler *assembler;
+  TACSBVec *dist;
+};
+
+class TMROctDistanceField : public TMREntity {
+ public:
+  TMROctDistanceField(TMROctForest *_filter, int _index, double _cutoff,
+                      double _t);
+  ~TMROctDistanceField();
+
+  // Compute the minimum distance within each element of the filter
+  void computeDistance(TACSBVec *rho, double *min_dist,
+                       const char *filename = NULL);
+
+ private:
+  void createForest(TACSBVec *rho);
+  int computeBCNodes(TACSBVec *rho, int *bcs);
+  void solveDistance(int nbcs, int *bcs);
+  void writeDistance(const char *filename);
+
+  // The filter and the density component used for the interface
+  TMROctForest *filter;
+  int index;
+  double cutoff, t;
+
+  // The node stamp of the filter, its octants and the refinement
+  // used to create the forest
+  int filter_stamp;
+  TMROctantArray *filter_octs;
+  int num_filter_elements;
+  int *refine;
+
+  // The refined forest and the filter element/parametric point for
+  // each of its element corners
+  TMROctForest *forest;
+  int *node_elems;
+  double *node_pts;
+
+  // The interface nodes, assembler and distance solution
+  int num_bc_nodes;
+  int *bc_nodes;
+  TACSAssembler *assembler;
+  TACSBVec *dist;
+};
+
+/*
+  Compute the approximate distance once using a temporary field
+*/
 void TMRApproximateDistance(TMRQuadForest *filter, int index, double cutoff,
                             double t, TACSBVec *rho, const char *filename,
                             double *min_dist);
@@ -0,0 +1,449 @@
+/*
+  This file is part of the package TMR for adaptive mesh refinement.
+
+  Copyright (C) 2015 Georgia Tech Research Corporation.
+  Additional copyright (C) 2015 Graeme Kennedy.
+  All rights reserved.
+
+  TMR is licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this software except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include "TMRBlockGMRES.h"
+
+#include <math.h>
+#include <string.h>
+
+/*
+  The length of the segments of the local arrays used when computing
+  the inner products and updates. Each segment of the vector being
+  orthogonalized stays in cache while it is combined with each of the
+  Krylov vectors.
+*/
+static const int TMR_BLOCK_GMRES_SEGMENT = 1024;
+
+/*
+  Create the solver
+
+  input:
+  comm:      the communicator for the vectors
+  mat:       the operator
+  pc:        the preconditioner
+  m:         the size of the Krylov subspace
+  nrestart:  the number of restarts
+*/
+TMRBlockGMRES::TMRBlockGMRES(MPI_Comm _comm, TACSMat *_mat, TACSPc *_pc,
+                             int _m, int _nrestart) {
+  comm = _comm;
+  mat = _mat;
+  mat->incref();
+  pc = _pc;
+  pc->incref();
+
+  m = (_m > 1 ? _m : 1);
+  nrestart = (_nrestart > 0 ? _nrestart : 0);
+  rtol = 1e-8;
+  atol = 1e-30;
+  monitor = NULL;
+  iter_count = 0;
+
+  // The Krylov subspace vectors are allocated when they are needed
+  max_rhs = 0;
+  W = NULL;
+
+  work = dynamic_cast<TACSBVec *>(mat->createVec());
+  work->incref();
+  work_pc = dynamic_cast<TACSBVec *>(mat->createVec());
+  work_pc->incref();
+}
+
+/*
+  Free the solver data
+*/
+TMRBlockGMRES::~TMRBlockGMRES() {
+  mat->decref();
+  pc->decref();
+  if (monitor) {
+    monitor->decref();
+  }
+  for (int s = 0; s < max_rhs; s++) {
+    for (int i = 0; i < m + 1; i++) {
+      W[s][i]->decref();
+    }
+    delete[] W[s];
+  }
+  if (W) {
+    delete[] W;
+  }
+  work->decref();
+  work_pc->decref();
+}
+
+/*
+  Set the operator and the preconditioner
+*/
+void TMRBlockGMRES::setOperators(TACSMat *_mat, TACSPc *_pc) {
+  _mat->incref();
+  _pc->incref();
+  mat->decref();
+  pc->decref();
+  mat = _mat;
+  pc = _pc;
+}
+
+/*
+  Set the relative and absolute tolerances
+*/
+void TMRBlockGMRES::setTolerances(double _rtol, double _atol) {
+  rtol = _rtol;
+  atol = _atol;
+}
+
+/*
+  Set the monitor. The largest residual across the active systems is
+  reported at each iteration.
+*/
+void TMRBlockGMRES::setMonitor(KSMPrint *_monitor) {
+  if (_monitor) {
+    _monitor->incref();
+  }
+  if (monitor) {
+    monitor->decref();
+  }
+  monitor = _monitor;
+}
+
+/*
+  Get the number of iterations taken in the last call to solve
+*/
+int TMRBlockGMRES::getIterCount() { return iter_count; }
+
+/*
+  Allocate the Krylov subspace vectors for the given number of
+  right-hand-sides. The vectors are retained between calls.
+*/
+void TMRBlockGMRES::allocateVecs(int nrhs) {
+  if (nrhs > max_rhs) {
+    TACSBVec ***temp = new TACSBVec **[nrhs];
+    for (int s = 0; s < max_rhs; s++) {
+      temp[s] = W[s];
+    }
+    for (int s = max_rhs; s < nrhs; s++) {
+      temp[s] = new TACSBVec *[m + 1];
+      for (int i = 0; i < m + 1; i++) {
+        temp[s][i] = dynamic_cast<TACSBVec *>(mat->createVec());
+        temp[s][i]->incref();
+      }
+    }
+    if (W) {
+      delete[] W;
+    }
+    W = temp;
+    max_rhs = nrhs;
+  }
+}
+
+/*
+  Compute the local contributions to the inner products h[j] =
+  vecs[j]^{T}*w for j = 0, ..., nvecs-1
+*/
+void TMRBlockGMRES::localDots(TACSBVec *w, int nvecs, TACSBVec **vecs,
+                              TacsScalar *h) {
+  TacsScalar *wa;
+  int size = w->getArray(&wa);
+  memset(h, 0, nvecs * sizeof(TacsScalar));
+
+  for (int k0 = 0; k0 < size; k0 += TMR_BLOCK_GMRES_SEGMENT) {
+    int k1 = k0 + TMR_BLOCK_GMRES_SEGMENT;
+    if (k1 > size) {
+      k1 = size;
+    }
+    for (int j = 0; j < nvecs; j++) {
+      TacsScalar *va;
+      vecs[j]->getArray(&va);
+      TacsScalar sum = 0.0;
+      for (int k = k0; k < k1; k++) {
+        sum += va[k] * wa[k];
+      }
+      h[j] += sum;
+    }
+  }
+}
+
+/*
+  Compute w = w - sum_{j} h[j]*vecs[j] in a single pass over w
+*/
+void TMRBlockGMRES::localSubtract(TACSBVec *w, int nvecs, TACSBVec **vecs,
+                                  const TacsScalar *h) {
+  TacsScalar *wa;
+  int size = w->getArray(&wa);
+
+  for (int k0 = 0; k0 < size; k0 += TMR_BLOCK_GMRES_SEGMENT) {
+    int k1 = k0 + TMR_BLOCK_GMRES_SEGMENT;
+    if (k1 > size) {
+      k1 = size;
+    }
+    for (int j = 0; j < nvecs; j++) {
+      TacsScalar *va;
+      vecs[j]->getArray(&va);
+      const TacsScalar hj = h[j];
+      for (int k = k0; k < k1; k++) {
+        wa[k] -= hj * va[k];
+      }
+    }
+  }
+}
+
+/*
+  Solve the systems of equations A*x[s] = b[s]
+
+  Each system is converged when its residual is below the absolute
+  tolerance or below the relative tolerance times its initial
+  residual.
+
+  input:
+  nrhs:        the number of right-hand-sides
+  b:           the right-hand-sides
+  zero_guess:  flag to indicate whether to use a zero initial guess
+
+  output:
+  x:           the solutions
+
+  returns:
+  zero if all of the systems converged, non-zero otherwise
+*/
+int TMRBlockGMRES::solve(int nrhs, TACSBVec **b, TACSBVec **x,
+                         int zero_guess) {
+  iter_count = 0;
+  if (nrhs <= 0) {
+    return 0;
+  }
+
+  allocateVecs(nrhs);
+
+  // The Hessenberg matrix, the rotated residual and the Givens
+  // rotations for each system
+  const int hsize = (m + 1) * m;
+  TacsScalar *H = new TacsScalar[nrhs * hsize];
+  TacsScalar *res = new TacsScalar[nrhs * (m + 1)];
+  TacsScalar *Qcos = new TacsScalar[nrhs * m];
+  TacsScalar *Qsin = new TacsScalar[nrhs * m];
+  TacsScalar *y = new TacsScalar[m];
+
+  // The initial residual norms and the state of each system
+  double *init_norm = new double[nrhs];
+  int *converged = new int[nrhs];
+  int *niters = new int[nrhs];
+  int *active = new int[nrhs];
+  memset(converged, 0, nrhs * sizeof(int));
+
+  // Buffer used for the combined reductions
+  TacsScalar *hbuf = new TacsScalar[nrhs * (m + 1)];
+
+  for (int count = 0; count < nrestart + 1; count++) {
+    // Collect the systems that are not converged
+    int nactive = 0;
+    for (int s = 0; s < nrhs; s++) {
+      niters[s] = 0;
+      if (!converged[s]) {
+        active[nactive] = s;
+        nactive++;
+      }
+    }
+    if (nactive == 0) {
+      break;
+    }
+
+    // Compute the initial residuals r = b - A*x
+    for (int a = 0; a < nactive; a++) {
+      int s = active[a];
+      if (count == 0 && zero_guess) {
+        x[s]->zeroEntries();
+        W[s][0]->copyValues(b[s]);
+      } else {
+        mat->mult(x[s], W[s][0]);
+        W[s][0]->axpby(1.0, -1.0, b[s]);
+      }
+      localDots(W[s][0], 1, &W[s][0], &hbuf[a]);
+    }
+    MPI_Allreduce(MPI_IN_PLACE, hbuf, nactive, TACS_MPI_TYPE, MPI_SUM, comm);
+
+    double max_res = 0.0;
+    int n = 0;
+    for (int a = 0; a < nactive; a++) {
+      int s = active[a];
+      double rnorm = sqrt(TacsRealPart(hbuf[a]));
+      if (count == 0) {
+        init_norm[s] = rnorm;
+      }
+      if (rnorm > max_res) {
+        max_res = rnorm;
+      }
+
+      if (rnorm <= atol || rnorm <= rtol * init_norm[s]) {
+        converged[s] = 1;
+      } else {
+        W[s][0]->scale(1.0 / rnorm);
+        res[(m + 1) * s] = rnorm;
+        active[n] = s;
+        n++;
+      }
+    }
+    nactive = n;
+
+    if (monitor && count == 0) {
+      monitor->printResidual(iter_count, max_res);
+    }
+
+    for (int i = 0; i < m && nactive > 0; i++) {
+      // Apply the preconditioner and the operator to the latest
+      // Krylov vector of each active system
+      for (int a = 0; a < nactive; a++) {
+        int s = active[a];
+        pc->applyFactor(W[s][i], work);
+        mat->mult(work, W[s][i + 1]);
+      }
+
+      // Orthogonalize against the previous vectors using classical
+      // Gram-Schmidt with one re-orthogonalization pass
+      for (int a = 0; a < nactive; a++) {
+        int s = active[a];
+        memset(&H[hsize * s + (m + 1) * i], 0, (i + 1) * sizeof(TacsScalar));
+      }
+      for (int pass = 0; pass < 2; pass++) {
+        for (int a = 0; a < nactive; a++) {
+          int s = active[a];
+          localDots(W[s][i + 1], i + 1, W[s], &hbuf[(i + 1) * a]);
+        }
+        MPI_Allreduce(MPI_IN_PLACE, hbuf, (i + 1) * nactive, TACS_MPI_TYPE,
+                      MPI_SUM, comm);
+        for (int a = 0; a < nactive; a++) {
+          int s = active[a];
+          TacsScalar *h = &H[hsize * s + (m + 1) * i];
+          localSubtract(W[s][i + 1], i + 1, W[s], &hbuf[(i + 1) * a]);
+          for (int j = 0; j < i + 1; j++) {
+            h[j] += hbuf[(i + 1) * a + j];
+          }
+        }
+      }
+
+      // Normalize the new vectors
+      for (int a = 0; a < nactive; a++) {
+        int s = active[a];
+        localDots(W[s][i + 1], 1, &W[s][i + 1], &hbuf[a]);
+      }
+      MPI_Allreduce(MPI_IN_PLACE, hbuf, nactive, TACS_MPI_TYPE, MPI_SUM,
+                    comm);
+
+      max_res = 0.0;
+      n = 0;
+      for (int a = 0; a < nactive; a++) {
+        int s = active[a];
+        TacsScalar *h = &H[hsize * s + (m + 1) * i];
+        TacsScalar *r = &res[(m + 1) * s];
+        TacsScalar *qc = &Qcos[m * s];
+        TacsScalar *qs = &Qsin[m * s];
+
+        h[i + 1] = sqrt(TacsRealPart(hbuf[a]));
+        if (TacsRealPart(h[i + 1]) != 0.0) {
+          W[s][i + 1]->scale(1.0 / h[i + 1]);
+        }
+
+        // Apply the previous Givens rotations to the new column
+        for (int k = 0; k < i; k++) {
+          TacsScalar h1 = h[k];
+          TacsScalar h2 = h[k + 1];
+          h[k] = h1 * qc[k] + h2 * qs[k];
+          h[k + 1] = -h1 * qs[k] + h2 * qc[k];
+        }
+
+        // Compute the new rotation that zeros the sub-diagonal
+        TacsScalar h1 = h[i];
+        TacsScalar h2 = h[i + 1];
+        TacsScalar sq = sqrt(h1 * h1 + h2 * h2);
+        qc[i] = h1 / sq;
+        qs[i] = h2 / sq;
+        h[i] = h1 * qc[i] + h2 * qs[i];
+        h[i + 1] = 0.0;
+
+        // Update the residual
+        r[i + 1] = -r[i] * qs[i];
+        r[i] = r[i] * qc[i];
+        niters[s] = i + 1;
+
+        double rnorm = fabs(TacsRealPart(r[i + 1]));
+        if (rnorm > max_res) {
+          max_res = rnorm;
+        }
+        if (rnorm <= atol || rnorm <= rtol * init_norm[s]) {
+          converged[s] = 1;
+        } else {
+          active[n] = s;
+          n++;
+        }
+      }
+      nactive = n;
+
+      iter_count++;
+      if (monitor) {
+        monitor->printResidual(iter_count, max_res);
+      }
+    }
+
+    // Update the solution for each system that was iterated
+    for (int s = 0; s < nrhs; s++) {
+      int nk = niters[s];
+      if (nk > 0) {
+        // Solve the upper triangular system H*y = res
+        const TacsScalar *Hs = &H[hsize * s];
+        const TacsScalar *r = &res[(m + 1) * s];
+        for (int i = nk - 1; i >= 0; i--) {
+          y[i] = r[i];
+          for (int j = i + 1; j < nk; j++) {
+            y[i] -= Hs[(m + 1) * j + i] * y[j];
+          }
+          y[i] = y[i] / Hs[(m + 1) * i + i];
+        }
+
+        // x = x + M^{-1}*W*y
+        work->zeroEntries();
+        for (int i = 0; i < nk; i++) {
+          y[i] = -y[i];
+        }
+        localSubtract(work, nk, W[s], y);
+        pc->applyFactor(work, work_pc);
+        x[s]->axpy(1.0, work_pc);
+      }
+    }
+  }
+
+  // Check whether all the systems converged
+  int fail = 0;
+  for (int s = 0; s < nrhs; s++) {
+    if (!converged[s]) {
+      fail = 1;
+    }
+  }
+
+  delete[] H;
+  delete[] res;
+  delete[] Qcos;
+  delete[] Qsin;
+  delete[] y;
+  delete[] init_norm;
+  delete[] converged;
+  delete[] niters;
+  delete[] active;
+  delete[] hbuf;
+
+  return fail;
+}
@@ -0,0 +1,99 @@
+/*
+  This file is part of the package TMR for adaptive mesh refinement.
+
+  Copyright (C) 2015 Georgia Tech Research Corporation.
+  Additional copyright (C) 2015 Graeme Kennedy.
+  All rights reserved.
+
+  TMR is licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this software except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef TMR_BLOCK_GMRES_H
+#define TMR_BLOCK_GMRES_H
+
+#include "KSM.h"
+#include "TACSBVec.h"
+
+/*
+  A right-preconditioned GMRES solver for several right-hand-sides
+  that share the same operator and preconditioner.
+
+  The iterations for all of the systems proceed in lockstep. At each
+  iteration, the preconditioner and operator are applied to the new
+  Krylov vector of each active system in turn. The orthogonalization
+  uses classical Gram-Schmidt with one re-orthogonalization pass.
+  The inner products for all of the active systems are computed
+  locally in a single pass over each vector and combined in a single
+  reduction, so each iteration requires three reductions regardless
+  of the number of systems or the size of the Krylov subspace.
+  Systems that have converged are removed from the active set.
+
+  The Krylov subspace is stored for each system, so the memory
+  required is (m + 1) vectors per right-hand-side.
+*/
+class TMRBlockGMRES : public TACSObject {
+ public:
+  TMRBlockGMRES(MPI_Comm _comm, TACSMat *_mat, TACSPc *_pc, int _m,
+                int _nrestart);
+  ~TMRBlockGMRES();
+
+  // Set the operators, the tolerances and the monitor
+  // -------------------------------------------------
+  void setOperators(TACSMat *_mat, TACSPc *_pc);
+  void setTolerances(double _rtol, double _atol);
+  void setMonitor(KSMPrint *_monitor);
+
+  // Get the number of iterations taken in the last solve
+  // ----------------------------------------------------
+  int getIterCount();
+
+  // Solve the systems A*x[i] = b[i] for i = 0, ..., nrhs-1
+  // ------------------------------------------------------
+  int solve(int nrhs, TACSBVec **b, TACSBVec **x, int zero_guess = 1);
+
+ private:
+  // Allocate the Krylov subspace vectors for the given number of systems
+  void allocateVecs(int nrhs);
+
+  // Compute the inner products of a vector with a set of vectors
+  static void localDots(TACSBVec *w, int nvecs, TACSBVec **vecs,
+                        TacsScalar *h);
+
+  // Compute w = w - sum_{j} h[j]*vecs[j]
+  static void localSubtract(TACSBVec *w, int nvecs, TACSBVec **vecs,
+                            const TacsScalar *h);
+
+  // The communicator, operator and preconditioner
+  MPI_Comm comm;
+  TACSMat *mat;
+  TACSPc *pc;
+
+  // The size of the subspace and the number of restarts
+  int m, nrestart;
+  double rtol, atol;
+
+  // The monitor (may be NULL)
+  KSMPrint *monitor;
+
+  // The number of iterations in the last solve
+  int iter_count;
+
+  // The Krylov subspace vectors for each system
+  int max_rhs;
+  TACSBVec ***W;
+
+  // Work vectors used to apply the preconditioner
+  TACSBVec *work, *work_pc;
+};
+
+#endif  // TMR_BLOCK_GMRES_H
@@ -20,6 +20,8 @@
 
 #include "TMRConformFilter.h"
 
+#include "TMRTrace.h"
+
 TMRConformFilter::TMRConformFilter(int _nlevels, TACSAssembler *_assembler[],
                                    TMROctForest *_filter[]) {
   initialize(_nlevels, _assembler, _filter, NULL);
@@ -152,6 +154,13 @@ TMROctForest *TMRConformFilter::getFilterOctForest() {
   Set the design variables for each level
 */
 void TMRConformFilter::setDesignVars(TACSBVec *xvec) {
+  TMR_TRACE_SCOPE("TMRConformFilter::setDesignVars");
+
+  // Skip the update if the design variables have not changed
+  if (!checkDesignVarsChanged(xvec, x[0])) {
+    return;
+  }
+
   // Copy the values to the local design variable vector
   x[0]->copyValues(xvec);
 
@@ -171,6 +180,8 @@ void TMRConformFilter::setDesignVars(TACSBVec *xvec) {
   Add values to the output TACSBVec
 */
 void TMRConformFilter::addValues(TACSBVec *vec) {
+  TMR_TRACE_SCOPE("TMRConformFilter::addValues");
+
   vec->beginSetValues(TACS_ADD_VALUES);
   vec->endSetValues(TACS_ADD_VALUES);
 }
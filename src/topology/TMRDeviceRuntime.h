@@ -0,0 +1,67 @@
+/*
+  This file is part of the package TMR for adaptive mesh refinement.
+
+  Copyright (C) 2015 Georgia Tech Research Corporation.
+  Additional copyright (C) 2015 Graeme Kennedy.
+  All rights reserved.
+
+  TMR is licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this software except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef TMR_DEVICE_RUNTIME_H
+#define TMR_DEVICE_RUNTIME_H
+
+/*
+  The runtime for the GPU kernels. The HIP runtime mirrors the subset
+  of the CUDA runtime used in TMR, so the kernels are written with the
+  CUDA names and compiled with either nvcc or hipcc.
+*/
+#include <stdio.h>
+
+#ifdef TMR_HAS_HIP
+#include <hip/hip_runtime.h>
+#define cudaError_t hipError_t
+#define cudaSuccess hipSuccess
+#define cudaGetErrorString hipGetErrorString
+#define cudaGetDeviceCount hipGetDeviceCount
+#define cudaMalloc hipMalloc
+#define cudaFree hipFree
+#define cudaMemcpy hipMemcpy
+#define cudaMemcpyHostToDevice hipMemcpyHostToDevice
+#define cudaMemcpyDeviceToHost hipMemcpyDeviceToHost
+#define cudaMemcpyDeviceToDevice hipMemcpyDeviceToDevice
+#else
+#include <cuda_runtime.h>
+#endif  // TMR_HAS_HIP
+
+// The number of threads in each block
+static const int TMR_DEVICE_BLOCK_SIZE = 256;
+
+/*
+  Check the return code from the runtime and print any errors
+*/
+static inline void TMRDeviceCheck(cudaError_t err, const char *call) {
+  if (err != cudaSuccess) {
+    fprintf(stderr, "TMR device error: %s failed with %s\n", call,
+            cudaGetErrorString(err));
+  }
+}
+
+/*
+  Get the number of blocks required for n threads
+*/
+static inline int TMRDeviceNumBlocks(int n) {
+  return (n + TMR_DEVICE_BLOCK_SIZE - 1) / TMR_DEVICE_BLOCK_SIZE;
+}
+
+#endif  // TMR_DEVICE_RUNTIME_H
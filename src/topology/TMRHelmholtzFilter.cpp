@@ -20,8 +20,10 @@
 
 #include "TMRHelmholtzFilter.h"
 
+#include "TMRHelmholtzMatFree.h"
 #include "TMRHelmholtzModel.h"
 #include "TMRMatrixCreator.h"
+#include "TMRTrace.h"
 #include "TMR_RefinementTools.h"
 #include "TMR_TACSCreator.h"
 
@@ -104,6 +106,23 @@ void TMRHelmholtzFilter::initialize_helmholtz(double helmholtz_radius) {
   }
   helmholtz_mg->incref();
 
+  // For high-order filter meshes, apply the operator within the
+  // Krylov method without the assembled matrix. The multigrid
+  // preconditioner still uses the assembled matrices.
+  helmholtz_mat = NULL;
+  int mesh_order = 2;
+  if (oct_filter) {
+    mesh_order = oct_filter[0]->getMeshOrder();
+  } else {
+    mesh_order = quad_filter[0]->getMeshOrder();
+  }
+  if (mesh_order >= 3 && mesh_order <= TMRHelmholtzMatFree::MAX_ORDER) {
+    int dim = (oct_filter ? 3 : 2);
+    helmholtz_mat = new TMRHelmholtzMatFree(
+        helmholtz_assembler[0], helmholtz_radius, mesh_order, dim);
+    helmholtz_mat->incref();
+  }
+
   // Get the rank
   int mpi_rank;
   MPI_Comm_rank(getMPIComm(), &mpi_rank);
@@ -114,25 +133,57 @@ void TMRHelmholtzFilter::initialize_helmholtz(double helmholtz_radius) {
   int is_flexible = 0;
 
   // Create the GMRES object
-  helmholtz_ksm = new GMRES(helmholtz_mg->getMat(0), helmholtz_mg, gmres_iters,
-                            nrestart, is_flexible);
+  TACSMat *helmholtz_op = helmholtz_mg->getMat(0);
+  if (helmholtz_mat) {
+    helmholtz_op = helmholtz_mat;
+  }
+  helmholtz_ksm =
+      new GMRES(helmholtz_op, helmholtz_mg, gmres_iters, nrestart, is_flexible);
   helmholtz_ksm->incref();
   helmholtz_ksm->setMonitor(new KSMPrintStdout("Filter GMRES", mpi_rank, 10));
   helmholtz_ksm->setTolerances(1e-12, 1e-30);
 
-  // Create the multigrid solver and factor it
+  // Create the multigrid solver and factor it. The operator does not
+  // depend on the design variables, so this factorization is used for
+  // all subsequent applications of the filter.
   double alpha = 1.0, beta = 0.0, gamma = 0.0;
   helmholtz_mg->assembleJacobian(alpha, beta, gamma, NULL);
   helmholtz_mg->factor();
 
+  // Allocate the solutions from the previous application of the
+  // filter and its transpose for each design variable component. These
+  // are used as the starting points for the next solutions.
+  num_guess_vecs = assembler[0]->getDesignVarsPerNode();
+  helmholtz_guess = new TACSBVec *[num_guess_vecs];
+  helmholtz_guess_trans = new TACSBVec *[num_guess_vecs];
+  for (int k = 0; k < num_guess_vecs; k++) {
+    helmholtz_guess[k] = helmholtz_assembler[0]->createVec();
+    helmholtz_guess[k]->incref();
+    helmholtz_guess_trans[k] = helmholtz_assembler[0]->createVec();
+    helmholtz_guess_trans[k]->incref();
+  }
+
   // Create a temporary vector
   temp = assembler[0]->createDesignVec();
   temp->incref();
+
+  // Create the vector that stores the last design variables
+  xlast = assembler[0]->createDesignVec();
+  xlast->incref();
 }
 
 TMRHelmholtzFilter::~TMRHelmholtzFilter() {
   helmholtz_mg->decref();
   helmholtz_ksm->decref();
+  if (helmholtz_mat) {
+    helmholtz_mat->decref();
+  }
+  for (int k = 0; k < num_guess_vecs; k++) {
+    helmholtz_guess[k]->decref();
+    helmholtz_guess_trans[k]->decref();
+  }
+  delete[] helmholtz_guess;
+  delete[] helmholtz_guess_trans;
   helmholtz_vec->decref();
   helmholtz_rhs->decref();
   helmholtz_psi->decref();
@@ -142,6 +193,7 @@ TMRHelmholtzFilter::~TMRHelmholtzFilter() {
   }
   delete[] helmholtz_assembler;
   temp->decref();
+  xlast->decref();
 }
 
 /*
@@ -150,6 +202,8 @@ TMRHelmholtzFilter::~TMRHelmholtzFilter() {
   Here the input/output vector are the same
 */
 void TMRHelmholtzFilter::applyFilter(TACSBVec *xvars) {
+  TMR_TRACE_SCOPE("TMRHelmholtzFilter::applyFilter");
+
   // Get the number of design variables per node
   const int vars_per_node = assembler[0]->getDesignVarsPerNode();
 
@@ -228,8 +282,11 @@ void TMRHelmholtzFilter::applyFilter(TACSBVec *xvars) {
     helmholtz_rhs->beginSetValues(TACS_ADD_VALUES);
     helmholtz_rhs->endSetValues(TACS_ADD_VALUES);
 
-    // Solve for the filtered values of the design variables
-    helmholtz_ksm->solve(helmholtz_rhs, helmholtz_psi);
+    // Solve for the filtered values of the design variables starting
+    // from the solution of the previous application of the filter
+    helmholtz_psi->copyValues(helmholtz_guess[k]);
+    helmholtz_ksm->solve(helmholtz_rhs, helmholtz_psi, 0);
+    helmholtz_guess[k]->copyValues(helmholtz_psi);
     helmholtz_assembler[0]->reorderVec(helmholtz_psi);
     helmholtz_assembler[0]->setVariables(helmholtz_psi);
 
@@ -255,6 +312,8 @@ void TMRHelmholtzFilter::applyFilter(TACSBVec *xvars) {
   Compute the sensitivity w.r.t the Helmholtz filter
 */
 void TMRHelmholtzFilter::applyTranspose(TACSBVec *input, TACSBVec *output) {
+  TMR_TRACE_SCOPE("TMRHelmholtzFilter::applyTranspose");
+
   output->zeroEntries();
 
   // Get the number of design variables per node
@@ -288,8 +347,11 @@ void TMRHelmholtzFilter::applyTranspose(TACSBVec *input, TACSBVec *output) {
       hrhs[i] = xarr[vars_per_node * i + k];
     }
 
-    // Solve for the filtered values of the design variables
-    helmholtz_ksm->solve(helmholtz_rhs, helmholtz_psi);
+    // Solve for the filtered values of the design variables starting
+    // from the solution of the previous application of the transpose
+    helmholtz_psi->copyValues(helmholtz_guess_trans[k]);
+    helmholtz_ksm->solve(helmholtz_rhs, helmholtz_psi, 0);
+    helmholtz_guess_trans[k]->copyValues(helmholtz_psi);
     helmholtz_assembler[0]->reorderVec(helmholtz_psi);
 
     // Distribute the values from the solution
@@ -361,6 +423,14 @@ void TMRHelmholtzFilter::applyTranspose(TACSBVec *input, TACSBVec *output) {
   Set the design variables for each level
 */
 void TMRHelmholtzFilter::setDesignVars(TACSBVec *xvec) {
+  TMR_TRACE_SCOPE("TMRHelmholtzFilter::setDesignVars");
+
+  // Skip the filter if the design variables have not changed
+  if (!checkDesignVarsChanged(xvec, xlast)) {
+    return;
+  }
+  xlast->copyValues(xvec);
+
   // Copy the values to the local design variable vector
   x[0]->copyValues(xvec);
 
@@ -379,6 +449,8 @@ void TMRHelmholtzFilter::setDesignVars(TACSBVec *xvec) {
   Add values to the output TACSBVec
 */
 void TMRHelmholtzFilter::addValues(TACSBVec *vec) {
+  TMR_TRACE_SCOPE("TMRHelmholtzFilter::addValues");
+
   vec->beginSetValues(TACS_ADD_VALUES);
   vec->endSetValues(TACS_ADD_VALUES);
 
@@ -24,6 +24,7 @@
 #include "TACSAssembler.h"
 #include "TACSMg.h"
 #include "TMRConformFilter.h"
+#include "TMRHelmholtzMatFree.h"
 
 /*
   Create a Helmholtz filter object
@@ -56,8 +57,18 @@ class TMRHelmholtzFilter : public TMRConformFilter {
   TACSBVec *helmholtz_rhs, *helmholtz_psi;
   TACSBVec *helmholtz_vec;
 
+  // The matrix-free operator for high-order meshes (may be NULL)
+  TMRHelmholtzMatFree *helmholtz_mat;
+
+  // The previous solutions for each design variable component
+  int num_guess_vecs;
+  TACSBVec **helmholtz_guess, **helmholtz_guess_trans;
+
   // Temporary vector
   TACSBVec *temp;
+
+  // The design variables from the last call to setDesignVars
+  TACSBVec *xlast;
 };
 
 #endif  // TMR_HELMHOLTZ_FILTER_H
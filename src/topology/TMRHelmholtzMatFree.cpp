@@ -0,0 +1,487 @@
+/*
+  This file is part of the package TMR for adaptive mesh refinement.
+
+  Copyright (C) 2015 Georgia Tech Research Corporation.
+  Additional copyright (C) 2015 Graeme Kennedy.
+  All rights reserved.
+
+  TMR is licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this software except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include "TMRHelmholtzMatFree.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+/*
+  Compute the Gauss quadrature points and weights on the interval
+  [-1, 1] using Newton's method applied to the Legendre polynomial
+*/
+static void TMRGetGaussQuadrature(int n, double pts[], double wts[]) {
+  for (int i = 0; i < n; i++) {
+    double x = cos(M_PI * (i + 0.75) / (n + 0.5));
+    double dp = 1.0;
+    for (int iter = 0; iter < 100; iter++) {
+      // Evaluate P_{n}(x) and P_{n-1}(x) using the recurrence
+      double p0 = 1.0, p1 = x;
+      for (int k = 2; k <= n; k++) {
+        double p2 = ((2 * k - 1) * x * p1 - (k - 1) * p0) / k;
+        p0 = p1;
+        p1 = p2;
+      }
+      dp = n * (x * p1 - p0) / (x * x - 1.0);
+      double dx = p1 / dp;
+      x -= dx;
+      if (fabs(dx) < 1e-15) {
+        break;
+      }
+    }
+    pts[n - 1 - i] = x;
+    wts[n - 1 - i] = 2.0 / ((1.0 - x * x) * dp * dp);
+  }
+}
+
+/*
+  Evaluate the 1D Bernstein basis functions of the given order and
+  their derivatives w.r.t. the parameter on the interval [-1, 1]. For
+  order 2, this is the linear Lagrange basis.
+*/
+static void TMRGetBernsteinBasis(int order, double xi, double N[],
+                                 double Nd[]) {
+  const double t = 0.5 * (1.0 + xi);
+
+  // Compute the basis functions of one degree lower than the
+  // final degree, then the final basis and its derivative
+  double b[TMRHelmholtzMatFree::MAX_ORDER];
+  b[0] = 1.0;
+  for (int m = 1; m < order - 1; m++) {
+    b[m] = t * b[m - 1];
+    for (int j = m - 1; j > 0; j--) {
+      b[j] = t * b[j - 1] + (1.0 - t) * b[j];
+    }
+    b[0] = (1.0 - t) * b[0];
+  }
+
+  const int m = order - 1;
+  for (int j = 0; j < order; j++) {
+    double left = (j > 0 ? b[j - 1] : 0.0);
+    double right = (j < m ? b[j] : 0.0);
+    N[j] = t * left + (1.0 - t) * right;
+    Nd[j] = 0.5 * m * (left - right);
+  }
+}
+
+/*
+  Create the matrix-free operator
+
+  input:
+  assembler:  the TACSAssembler object for the filter mesh
+  r:          the Helmholtz filter radius
+  order:      the order of the mesh
+  dim:        the dimension of the problem (2 or 3)
+*/
+TMRHelmholtzMatFree::TMRHelmholtzMatFree(TACSAssembler *_assembler,
+                                         double _r, int _order, int _dim) {
+  assembler = _assembler;
+  assembler->incref();
+  r = _r;
+  order = _order;
+  dim = _dim;
+
+  if (order < 2 || order > MAX_ORDER) {
+    fprintf(stderr,
+            "TMRHelmholtzMatFree Error: Order %d not supported, using %d\n",
+            order, (order < 2 ? 2 : MAX_ORDER));
+    order = (order < 2 ? 2 : MAX_ORDER);
+  }
+
+  nodes_per_elem = order * order;
+  if (dim == 3) {
+    nodes_per_elem *= order;
+  }
+  quad_per_elem = nodes_per_elem;
+
+  // Evaluate the 1D basis at the quadrature points
+  double pts[MAX_ORDER];
+  TMRGetGaussQuadrature(order, pts, wts);
+  for (int q = 0; q < order; q++) {
+    TMRGetBernsteinBasis(order, pts[q], &N[order * q], &Nd[order * q]);
+  }
+
+  geo = NULL;
+  computeGeometry();
+}
+
+/*
+  Free the operator
+*/
+TMRHelmholtzMatFree::~TMRHelmholtzMatFree() {
+  assembler->decref();
+  if (geo) {
+    delete[] geo;
+  }
+}
+
+/*
+  Compute the geometric factors at each quadrature point in each
+  element. In 3D, this stores the values
+
+  w*detJ, r^2*w*detJ*(J^{-1}*J^{-T})
+
+  where only the upper triangular part of the symmetric matrix is
+  stored, so there are 7 values per point in 3D and 4 values per
+  point in 2D.
+*/
+void TMRHelmholtzMatFree::computeGeometry() {
+  const int num_elements = assembler->getNumElements();
+  const int nvals = (dim == 3 ? 7 : 4);
+  geo = new TacsScalar[nvals * quad_per_elem * num_elements];
+
+  TacsScalar *Xpts = new TacsScalar[3 * nodes_per_elem];
+  for (int elem = 0; elem < num_elements; elem++) {
+    int len;
+    const int *nodes;
+    assembler->getElement(elem, &len, &nodes);
+    if (len != nodes_per_elem) {
+      fprintf(stderr,
+              "TMRHelmholtzMatFree Error: Element %d has %d nodes, "
+              "expected %d\n",
+              elem, len, nodes_per_elem);
+    }
+    assembler->getElement(elem, Xpts);
+
+    TacsScalar *g = &geo[nvals * quad_per_elem * elem];
+    if (dim == 3) {
+      for (int qz = 0; qz < order; qz++) {
+        for (int qy = 0; qy < order; qy++) {
+          for (int qx = 0; qx < order; qx++, g += nvals) {
+            // Compute the derivative of the nodal locations
+            TacsScalar Xd[9];
+            memset(Xd, 0, 9 * sizeof(TacsScalar));
+            for (int k = 0; k < order; k++) {
+              for (int j = 0; j < order; j++) {
+                for (int i = 0; i < order; i++) {
+                  const int n = i + order * (j + order * k);
+                  double d[3];
+                  d[0] = Nd[order * qx + i] * N[order * qy + j] *
+                         N[order * qz + k];
+                  d[1] = N[order * qx + i] * Nd[order * qy + j] *
+                         N[order * qz + k];
+                  d[2] = N[order * qx + i] * N[order * qy + j] *
+                         Nd[order * qz + k];
+                  for (int a = 0; a < 3; a++) {
+                    for (int b = 0; b < 3; b++) {
+                      Xd[3 * a + b] += Xpts[3 * n + a] * d[b];
+                    }
+                  }
+                }
+              }
+            }
+
+            // Compute the inverse of the Jacobian transformation
+            TacsScalar detJ =
+                Xd[0] * (Xd[4] * Xd[8] - Xd[5] * Xd[7]) -
+                Xd[1] * (Xd[3] * Xd[8] - Xd[5] * Xd[6]) +
+                Xd[2] * (Xd[3] * Xd[7] - Xd[4] * Xd[6]);
+            TacsScalar J[9];
+            J[0] = (Xd[4] * Xd[8] - Xd[5] * Xd[7]) / detJ;
+            J[1] = (Xd[2] * Xd[7] - Xd[1] * Xd[8]) / detJ;
+            J[2] = (Xd[1] * Xd[5] - Xd[2] * Xd[4]) / detJ;
+            J[3] = (Xd[5] * Xd[6] - Xd[3] * Xd[8]) / detJ;
+            J[4] = (Xd[0] * Xd[8] - Xd[2] * Xd[6]) / detJ;
+            J[5] = (Xd[2] * Xd[3] - Xd[0] * Xd[5]) / detJ;
+            J[6] = (Xd[3] * Xd[7] - Xd[4] * Xd[6]) / detJ;
+            J[7] = (Xd[1] * Xd[6] - Xd[0] * Xd[7]) / detJ;
+            J[8] = (Xd[0] * Xd[4] - Xd[1] * Xd[3]) / detJ;
+
+            TacsScalar h = wts[qx] * wts[qy] * wts[qz] * detJ;
+            TacsScalar s = r * r * h;
+            g[0] = h;
+            g[1] = s * (J[0] * J[0] + J[1] * J[1] + J[2] * J[2]);
+            g[2] = s * (J[0] * J[3] + J[1] * J[4] + J[2] * J[5]);
+            g[3] = s * (J[0] * J[6] + J[1] * J[7] + J[2] * J[8]);
+            g[4] = s * (J[3] * J[3] + J[4] * J[4] + J[5] * J[5]);
+            g[5] = s * (J[3] * J[6] + J[4] * J[7] + J[5] * J[8]);
+            g[6] = s * (J[6] * J[6] + J[7] * J[7] + J[8] * J[8]);
+          }
+        }
+      }
+    } else {
+      for (int qy = 0; qy < order; qy++) {
+        for (int qx = 0; qx < order; qx++, g += nvals) {
+          TacsScalar Xd[4];
+          memset(Xd, 0, 4 * sizeof(TacsScalar));
+          for (int j = 0; j < order; j++) {
+            for (int i = 0; i < order; i++) {
+              const int n = i + order * j;
+              double d[2];
+              d[0] = Nd[order * qx + i] * N[order * qy + j];
+              d[1] = N[order * qx + i] * Nd[order * qy + j];
+              for (int a = 0; a < 2; a++) {
+                for (int b = 0; b < 2; b++) {
+                  Xd[2 * a + b] += Xpts[3 * n + a] * d[b];
+                }
+              }
+            }
+          }
+
+          TacsScalar detJ = Xd[0] * Xd[3] - Xd[1] * Xd[2];
+          TacsScalar J[4];
+          J[0] = Xd[3] / detJ;
+          J[1] = -Xd[1] / detJ;
+          J[2] = -Xd[2] / detJ;
+          J[3] = Xd[0] / detJ;
+
+          TacsScalar h = wts[qx] * wts[qy] * detJ;
+          TacsScalar s = r * r * h;
+          g[0] = h;
+          g[1] = s * (J[0] * J[0] + J[1] * J[1]);
+          g[2] = s * (J[0] * J[2] + J[1] * J[3]);
+          g[3] = s * (J[2] * J[2] + J[3] * J[3]);
+        }
+      }
+    }
+  }
+
+  delete[] Xpts;
+}
+
+/*
+  Create a vector compatible with the operator
+*/
+TACSVec *TMRHelmholtzMatFree::createVec() { return assembler->createVec(); }
+
+/*
+  Compute y = K*x by looping over the elements
+*/
+void TMRHelmholtzMatFree::mult(TACSVec *tx, TACSVec *ty) {
+  TACSBVec *x = dynamic_cast<TACSBVec *>(tx);
+  TACSBVec *y = dynamic_cast<TACSBVec *>(ty);
+  if (!x || !y) {
+    fprintf(stderr, "TMRHelmholtzMatFree Error: Incompatible vector types\n");
+    return;
+  }
+
+  // Distribute the values to the ghost nodes
+  x->beginDistributeValues();
+  x->endDistributeValues();
+
+  y->zeroEntries();
+
+  const int num_elements = assembler->getNumElements();
+  const int nvals = (dim == 3 ? 7 : 4);
+
+  TacsScalar u[MAX_ORDER * MAX_ORDER * MAX_ORDER];
+  TacsScalar v[MAX_ORDER * MAX_ORDER * MAX_ORDER];
+  for (int elem = 0; elem < num_elements; elem++) {
+    int len;
+    const int *nodes;
+    assembler->getElement(elem, &len, &nodes);
+    x->getValues(len, nodes, u);
+
+    const TacsScalar *g = &geo[nvals * quad_per_elem * elem];
+    if (dim == 3) {
+      multElement3D(g, u, v);
+    } else {
+      multElement2D(g, u, v);
+    }
+
+    y->setValues(len, nodes, v, TACS_ADD_VALUES);
+  }
+
+  y->beginSetValues(TACS_ADD_VALUES);
+  y->endSetValues(TACS_ADD_VALUES);
+}
+
+/*
+  The operator is symmetric
+*/
+void TMRHelmholtzMatFree::multTranspose(TACSVec *x, TACSVec *y) { mult(x, y); }
+
+/*
+  Compute the element product in 2D using sum factorization
+*/
+void TMRHelmholtzMatFree::multElement2D(const TacsScalar *G,
+                                        const TacsScalar *u, TacsScalar *v) {
+  const int p = order;
+  TacsScalar a0[MAX_ORDER * MAX_ORDER], a1[MAX_ORDER * MAX_ORDER];
+  TacsScalar c0[MAX_ORDER * MAX_ORDER], c1[MAX_ORDER * MAX_ORDER];
+  TacsScalar c2[MAX_ORDER * MAX_ORDER];
+
+  // Interpolate in the x-direction: a[j][qx]
+  for (int j = 0; j < p; j++) {
+    for (int qx = 0; qx < p; qx++) {
+      TacsScalar s0 = 0.0, s1 = 0.0;
+      for (int i = 0; i < p; i++) {
+        s0 += N[p * qx + i] * u[i + p * j];
+        s1 += Nd[p * qx + i] * u[i + p * j];
+      }
+      a0[qx + p * j] = s0;
+      a1[qx + p * j] = s1;
+    }
+  }
+
+  // Interpolate in the y-direction and apply the geometric factors
+  for (int qy = 0; qy < p; qy++) {
+    for (int qx = 0; qx < p; qx++) {
+      TacsScalar U = 0.0, U0 = 0.0, U1 = 0.0;
+      for (int j = 0; j < p; j++) {
+        U += N[p * qy + j] * a0[qx + p * j];
+        U0 += N[p * qy + j] * a1[qx + p * j];
+        U1 += Nd[p * qy + j] * a0[qx + p * j];
+      }
+
+      const int q = qx + p * qy;
+      const TacsScalar *g = &G[4 * q];
+      c0[q] = g[0] * U;
+      c1[q] = g[1] * U0 + g[2] * U1;
+      c2[q] = g[2] * U0 + g[3] * U1;
+    }
+  }
+
+  // Apply the transpose in the y-direction: a[j][qx]
+  for (int j = 0; j < p; j++) {
+    for (int qx = 0; qx < p; qx++) {
+      TacsScalar s0 = 0.0, s1 = 0.0;
+      for (int qy = 0; qy < p; qy++) {
+        const int q = qx + p * qy;
+        s0 += N[p * qy + j] * c0[q] + Nd[p * qy + j] * c2[q];
+        s1 += N[p * qy + j] * c1[q];
+      }
+      a0[qx + p * j] = s0;
+      a1[qx + p * j] = s1;
+    }
+  }
+
+  // Apply the transpose in the x-direction
+  for (int j = 0; j < p; j++) {
+    for (int i = 0; i < p; i++) {
+      TacsScalar s = 0.0;
+      for (int qx = 0; qx < p; qx++) {
+        s += N[p * qx + i] * a0[qx + p * j] + Nd[p * qx + i] * a1[qx + p * j];
+      }
+      v[i + p * j] = s;
+    }
+  }
+}
+
+/*
+  Compute the element product in 3D using sum factorization
+*/
+void TMRHelmholtzMatFree::multElement3D(const TacsScalar *G,
+                                        const TacsScalar *u, TacsScalar *v) {
+  const int p = order;
+  const int p2 = order * order;
+  const int size = MAX_ORDER * MAX_ORDER * MAX_ORDER;
+  TacsScalar a0[size], a1[size], b0[size], b1[size], b2[size];
+  TacsScalar c0[size], c1[size], c2[size], c3[size];
+
+  // Interpolate in the x-direction: a[k][j][qx]
+  for (int kj = 0; kj < p2; kj++) {
+    for (int qx = 0; qx < p; qx++) {
+      TacsScalar s0 = 0.0, s1 = 0.0;
+      for (int i = 0; i < p; i++) {
+        s0 += N[p * qx + i] * u[i + p * kj];
+        s1 += Nd[p * qx + i] * u[i + p * kj];
+      }
+      a0[qx + p * kj] = s0;
+      a1[qx + p * kj] = s1;
+    }
+  }
+
+  // Interpolate in the y-direction: b[k][qy][qx]
+  for (int k = 0; k < p; k++) {
+    for (int qy = 0; qy < p; qy++) {
+      for (int qx = 0; qx < p; qx++) {
+        TacsScalar s0 = 0.0, s1 = 0.0, s2 = 0.0;
+        for (int j = 0; j < p; j++) {
+          const int a = qx + p * (j + p * k);
+          s0 += N[p * qy + j] * a0[a];
+          s1 += N[p * qy + j] * a1[a];
+          s2 += Nd[p * qy + j] * a0[a];
+        }
+        const int b = qx + p * (qy + p * k);
+        b0[b] = s0;
+        b1[b] = s1;
+        b2[b] = s2;
+      }
+    }
+  }
+
+  // Interpolate in the z-direction and apply the geometric factors
+  for (int qz = 0; qz < p; qz++) {
+    for (int qyx = 0; qyx < p2; qyx++) {
+      TacsScalar U = 0.0, U0 = 0.0, U1 = 0.0, U2 = 0.0;
+      for (int k = 0; k < p; k++) {
+        const int b = qyx + p2 * k;
+        U += N[p * qz + k] * b0[b];
+        U0 += N[p * qz + k] * b1[b];
+        U1 += N[p * qz + k] * b2[b];
+        U2 += Nd[p * qz + k] * b0[b];
+      }
+
+      const int q = qyx + p2 * qz;
+      const TacsScalar *g = &G[7 * q];
+      c0[q] = g[0] * U;
+      c1[q] = g[1] * U0 + g[2] * U1 + g[3] * U2;
+      c2[q] = g[2] * U0 + g[4] * U1 + g[5] * U2;
+      c3[q] = g[3] * U0 + g[5] * U1 + g[6] * U2;
+    }
+  }
+
+  // Apply the transpose in the z-direction: b[k][qy][qx]
+  for (int k = 0; k < p; k++) {
+    for (int qyx = 0; qyx < p2; qyx++) {
+      TacsScalar s0 = 0.0, s1 = 0.0, s2 = 0.0;
+      for (int qz = 0; qz < p; qz++) {
+        const int q = qyx + p2 * qz;
+        s0 += N[p * qz + k] * c0[q] + Nd[p * qz + k] * c3[q];
+        s1 += N[p * qz + k] * c1[q];
+        s2 += N[p * qz + k] * c2[q];
+      }
+      const int b = qyx + p2 * k;
+      b0[b] = s0;
+      b1[b] = s1;
+      b2[b] = s2;
+    }
+  }
+
+  // Apply the transpose in the y-direction: a[k][j][qx]
+  for (int k = 0; k < p; k++) {
+    for (int j = 0; j < p; j++) {
+      for (int qx = 0; qx < p; qx++) {
+        TacsScalar s0 = 0.0, s1 = 0.0;
+        for (int qy = 0; qy < p; qy++) {
+          const int b = qx + p * (qy + p * k);
+          s0 += N[p * qy + j] * b0[b] + Nd[p * qy + j] * b2[b];
+          s1 += N[p * qy + j] * b1[b];
+        }
+        const int a = qx + p * (j + p * k);
+        a0[a] = s0;
+        a1[a] = s1;
+      }
+    }
+  }
+
+  // Apply the transpose in the x-direction
+  for (int kj = 0; kj < p2; kj++) {
+    for (int i = 0; i < p; i++) {
+      TacsScalar s = 0.0;
+      for (int qx = 0; qx < p; qx++) {
+        s += N[p * qx + i] * a0[qx + p * kj] + Nd[p * qx + i] * a1[qx + p * kj];
+      }
+      v[i + p * kj] = s;
+    }
+  }
+}
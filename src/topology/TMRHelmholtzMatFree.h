@@ -0,0 +1,89 @@
+/*
+  This file is part of the package TMR for adaptive mesh refinement.
+
+  Copyright (C) 2015 Georgia Tech Research Corporation.
+  Additional copyright (C) 2015 Graeme Kennedy.
+  All rights reserved.
+
+  TMR is licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this software except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef TMR_HELMHOLTZ_MAT_FREE_H
+#define TMR_HELMHOLTZ_MAT_FREE_H
+
+#include "TACSAssembler.h"
+
+/*
+  A matrix-free implementation of the Helmholtz filter operator
+
+  This computes the action of the matrix assembled by the
+  TMRQuadHelmholtzModel and TMRHexaHelmholtzModel element models
+
+  K = int_{Omega} (N^{T}*N + r^2*dN^{T}*dN) dOmega
+
+  with the tensor-product basis used by the TMRQuadTACSMatrixCreator
+  and TMROctTACSMatrixCreator classes (the linear Lagrange basis for
+  second-order meshes and the Bernstein basis for higher-order
+  meshes) and a tensor-product Gauss quadrature scheme with the same
+  number of points as the mesh order in each direction.
+
+  The geometric factors at the quadrature points are computed once,
+  and the interpolation to the quadrature points and its transpose
+  are computed with sum factorization, so the cost of the product
+  scales with order^(d+1) per element rather than order^(2d).
+*/
+class TMRHelmholtzMatFree : public TACSMat {
+ public:
+  TMRHelmholtzMatFree(TACSAssembler *_assembler, double _r, int _order,
+                      int _dim);
+  ~TMRHelmholtzMatFree();
+
+  // Create a vector compatible with the operator
+  TACSVec *createVec();
+
+  // Compute the product of the operator with a vector
+  void mult(TACSVec *x, TACSVec *y);
+  void multTranspose(TACSVec *x, TACSVec *y);
+
+  // The maximum order that is supported
+  static const int MAX_ORDER = 6;
+
+ private:
+  // Compute the geometric factors at the quadrature points
+  void computeGeometry();
+
+  // Compute the element product for the 2D and 3D cases
+  void multElement2D(const TacsScalar *G, const TacsScalar *u, TacsScalar *v);
+  void multElement3D(const TacsScalar *G, const TacsScalar *u, TacsScalar *v);
+
+  // The assembler object that defines the mesh
+  TACSAssembler *assembler;
+
+  // The filter radius, mesh order and dimension
+  double r;
+  int order, dim;
+
+  // The number of nodes and quadrature points per element
+  int nodes_per_elem, quad_per_elem;
+
+  // The 1D basis functions and their derivatives at the Gauss points
+  double N[MAX_ORDER * MAX_ORDER], Nd[MAX_ORDER * MAX_ORDER];
+
+  // The 1D quadrature weights
+  double wts[MAX_ORDER];
+
+  // The geometric factors at the quadrature points for all elements
+  TacsScalar *geo;
+};
+
+#endif  // TMR_HELMHOLTZ_MAT_FREE_H
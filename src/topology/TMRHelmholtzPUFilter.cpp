@@ -24,6 +24,7 @@
 #include "TMRHelmholtzModel.h"
 #include "TMRMatrixCreator.h"
 #include "TMRMatrixFilterModel.h"
+#include "TMRTrace.h"
 #include "TMR_TACSCreator.h"
 
 /*
@@ -347,6 +348,7 @@ TMRHelmholtzPUFilter::TMRHelmholtzPUFilter(int _N, int _nlevels,
   t1 = t2 = NULL;
   y1 = y2 = NULL;
   B = NULL;
+  horner = NULL;
   Dinv = NULL;
   Tinv = NULL;
   y1 = y2 = NULL;
@@ -364,6 +366,7 @@ TMRHelmholtzPUFilter::TMRHelmholtzPUFilter(int _N, int _nlevels,
   t1 = t2 = NULL;
   y1 = y2 = NULL;
   B = NULL;
+  horner = NULL;
   Dinv = NULL;
   Tinv = NULL;
   y1 = y2 = NULL;
@@ -386,6 +389,9 @@ TMRHelmholtzPUFilter::~TMRHelmholtzPUFilter() {
   if (B) {
     B->decref();
   }
+  if (horner) {
+    horner->decref();
+  }
   if (Dinv) {
     Dinv->decref();
   }
@@ -525,64 +531,117 @@ void TMRHelmholtzPUFilter::initialize() {
   nodeMap->getOwnerRange(&owner_range);
   MPI_Comm_rank(nodeMap->getMPIComm(), &mpi_rank);
 
+  // Sort the rows into interior and boundary nodes and count up the
+  // number of stencil points for each type of node
+  int num_interior = 0, num_boundary = 0;
+  int *is_boundary = new int[n];
+  int *interior_ptr = new int[n + 1];
+  int *boundary_ptr = new int[n + 1];
+  interior_ptr[0] = boundary_ptr[0] = 0;
+
+  TacsScalar *boundary_normals = new TacsScalar[3 * n];
   for (int i = 0; i < n; i++) {
     // Count up the number of columns in the row
-    int num_acols = rowp[i + 1] - rowp[i];
-
-    int ib = -1;
-    int num_bcols = 0;
+    int num_indices = rowp[i + 1] - rowp[i];
     if (i >= n - nc) {
-      ib = i - (n - nc);
-      num_bcols = browp[ib + 1] - browp[ib];
+      int ib = i - (n - nc);
+      num_indices += browp[ib + 1] - browp[ib];
     }
 
-    // Allocate space to store the indices
-    int num_indices = num_acols + num_bcols;
-    int *indices = new int[num_indices];
-    TacsScalar *X = new TacsScalar[3 * num_indices];
-    double *alpha = new double[num_indices];
-    memset(alpha, 0, num_indices * sizeof(double));
+    // Get the normal at the diagonal entry
+    int index = i + owner_range[mpi_rank];
+    TacsScalar *normal = &boundary_normals[3 * num_boundary];
+    normals->getValues(1, &index, normal);
+
+    if (normal[0] == 0.0 && normal[1] == 0.0 && normal[2] == 0.0) {
+      is_boundary[i] = 0;
+      interior_ptr[num_interior + 1] = interior_ptr[num_interior] + num_indices;
+      num_interior++;
+    } else {
+      TacsScalar invnorm =
+          1.0 / sqrt(normal[0] * normal[0] + normal[1] * normal[1] +
+                     normal[2] * normal[2]);
+      normal[0] *= invnorm;
+      normal[1] *= invnorm;
+      normal[2] *= invnorm;
+
+      is_boundary[i] = 1;
+      boundary_ptr[num_boundary + 1] = boundary_ptr[num_boundary] + num_indices;
+      num_boundary++;
+    }
+  }
 
-    int diagonal_index = -1;
+  // Allocate space for the packed stencils
+  int interior_size = interior_ptr[num_interior];
+  int boundary_size = boundary_ptr[num_boundary];
+  int *interior_diag = new int[num_interior];
+  int *boundary_diag = new int[num_boundary];
+  int *interior_indices = new int[interior_size];
+  int *boundary_indices = new int[boundary_size];
+
+  // Add the indices for each row to the packed interior or boundary
+  // stencil arrays
+  for (int i = 0, ii = 0, bi = 0; i < n; i++) {
+    int *indices = NULL;
+    int *diagonal_index = NULL;
+    if (is_boundary[i]) {
+      indices = &boundary_indices[boundary_ptr[bi]];
+      diagonal_index = &boundary_diag[bi];
+      bi++;
+    } else {
+      indices = &interior_indices[interior_ptr[ii]];
+      diagonal_index = &interior_diag[ii];
+      ii++;
+    }
 
     // Add contributions from the local part of A
     int j = 0;
     for (int jp = rowp[i]; jp < rowp[i + 1]; jp++, j++) {
       indices[j] = cols[jp] + owner_range[mpi_rank];
       if (cols[jp] == i) {
-        diagonal_index = j;
+        *diagonal_index = j;
       }
     }
 
     // Add contributions from the external part
-    if (ib >= 0) {
+    if (i >= n - nc) {
+      int ib = i - (n - nc);
       for (int jp = browp[ib]; jp < browp[ib + 1]; jp++, j++) {
         indices[j] = col_vars[bcols[jp]];
       }
     }
+  }
 
-    // Get the node locations from the node vector
-    Xpts->getValues(num_indices, indices, X);
-
-    // Get the normal
-    TacsScalar normal[3];
-    normals->getValues(1, &indices[diagonal_index], normal);
-
-    // Find the stencil
-    if (normal[0] == 0.0 && normal[1] == 0.0 && normal[2] == 0.0) {
-      getInteriorStencil(diagonal_index, num_indices, X, alpha);
+  // Get the node locations for all the stencils at once
+  TacsScalar *interior_X = new TacsScalar[3 * interior_size];
+  TacsScalar *boundary_X = new TacsScalar[3 * boundary_size];
+  Xpts->getValues(interior_size, interior_indices, interior_X);
+  Xpts->getValues(boundary_size, boundary_indices, boundary_X);
+  delete[] interior_indices;
+  delete[] boundary_indices;
+
+  // Find the stencils
+  double *interior_alpha = new double[interior_size];
+  double *boundary_alpha = new double[boundary_size];
+  memset(interior_alpha, 0, interior_size * sizeof(double));
+  memset(boundary_alpha, 0, boundary_size * sizeof(double));
+  getInteriorStencils(num_interior, interior_ptr, interior_diag, interior_X,
+                      interior_alpha);
+  getBoundaryStencils(num_boundary, boundary_ptr, boundary_diag,
+                      boundary_normals, boundary_X, boundary_alpha);
+
+  // Set the weights into the matrix
+  for (int i = 0, ii = 0, bi = 0; i < n; i++) {
+    const double *alpha = NULL;
+    if (is_boundary[i]) {
+      alpha = &boundary_alpha[boundary_ptr[bi]];
+      bi++;
     } else {
-      TacsScalar invnorm =
-          1.0 / sqrt(normal[0] * normal[0] + normal[1] * normal[1] +
-                     normal[2] * normal[2]);
-      normal[0] *= invnorm;
-      normal[1] *= invnorm;
-      normal[2] *= invnorm;
-      getBoundaryStencil(diagonal_index, normal, num_indices, X, alpha);
+      alpha = &interior_alpha[interior_ptr[ii]];
+      ii++;
     }
 
-    // Make the call-back to evaluate the weights
-    j = 0;
+    int j = 0;
     for (int jp = rowp[i]; jp < rowp[i + 1]; jp++, j++) {
       if (cols[jp] == i) {
         Dvals[i] = alpha[j];
@@ -599,7 +658,8 @@ void TMRHelmholtzPUFilter::initialize() {
     }
 
     // Add contributions from the external part
-    if (ib >= 0) {
+    if (i >= n - nc) {
+      int ib = i - (n - nc);
       for (int jp = browp[ib]; jp < browp[ib + 1]; jp++, j++) {
         Bvals[jp] = alpha[j];
         if (Bvals[jp] < 0.0) {
@@ -607,13 +667,20 @@ void TMRHelmholtzPUFilter::initialize() {
         }
       }
     }
-
-    // Free the allocated space
-    delete[] indices;
-    delete[] X;
-    delete[] alpha;
   }
 
+  // Free the allocated space
+  delete[] is_boundary;
+  delete[] interior_ptr;
+  delete[] boundary_ptr;
+  delete[] boundary_normals;
+  delete[] interior_diag;
+  delete[] boundary_diag;
+  delete[] interior_X;
+  delete[] boundary_X;
+  delete[] interior_alpha;
+  delete[] boundary_alpha;
+
   // Free the node locations
   Xpts->decref();
   normals->decref();
@@ -637,6 +704,10 @@ void TMRHelmholtzPUFilter::initialize() {
   temp = assembler[0]->createDesignVec();
   temp->incref();
 
+  // Create the operator that applies the Horner recurrence
+  horner = new TMRHornerOperator(assembler[0]->getMPIComm(), B);
+  horner->incref();
+
   // Create the inverse of the diagonal matrix
   TacsScalar *D;
   int size = Dinv->getArray(&D);
@@ -667,6 +738,51 @@ void TMRHelmholtzPUFilter::initialize() {
     T++;
     ty++;
   }
+
+  // Keep the diagonal matrices on the device (if any)
+  horner->setDeviceVec(Dinv);
+  horner->setDeviceVec(Tinv);
+}
+
+/*
+  Compute the stencils for a set of interior nodes.
+
+  The stencil for node k consists of the points
+  Xpts[3*ptr[k]:3*ptr[k+1]] and the weights are stored in
+  alpha[ptr[k]:ptr[k+1]]. This default implementation computes the
+  stencils one node at a time.
+*/
+int TMRHelmholtzPUFilter::getInteriorStencils(int num_nodes, const int ptr[],
+                                              const int diagonal_index[],
+                                              const TacsScalar Xpts[],
+                                              double alpha[]) {
+  int fail = 0;
+  for (int k = 0; k < num_nodes; k++) {
+    if (getInteriorStencil(diagonal_index[k], ptr[k + 1] - ptr[k],
+                           &Xpts[3 * ptr[k]], &alpha[ptr[k]])) {
+      fail = 1;
+    }
+  }
+  return fail;
+}
+
+/*
+  Compute the stencils for a set of boundary nodes with the unit
+  normals n[3*k:3*(k+1)]
+*/
+int TMRHelmholtzPUFilter::getBoundaryStencils(int num_nodes, const int ptr[],
+                                              const int diagonal_index[],
+                                              const TacsScalar n[],
+                                              const TacsScalar Xpts[],
+                                              double alpha[]) {
+  int fail = 0;
+  for (int k = 0; k < num_nodes; k++) {
+    if (getBoundaryStencil(diagonal_index[k], &n[3 * k], ptr[k + 1] - ptr[k],
+                           &Xpts[3 * ptr[k]], &alpha[ptr[k]])) {
+      fail = 1;
+    }
+  }
+  return fail;
 }
 
 /*
@@ -679,47 +795,22 @@ void TMRHelmholtzPUFilter::initialize() {
   .   out = t1 + D^{-1}*B*out
 */
 void TMRHelmholtzPUFilter::applyFilter(TACSBVec *in, TACSBVec *out) {
-  // Compute t1 = D^{-1}*in
-  kronecker(Dinv, in, t1);
-
-  // Set out = D^{-1}*in
-  out->copyValues(t1);
-
-  // Apply Horner's method
-  for (int n = 0; n < N; n++) {
-    // Compute out = D^{-1}*B*out
-    B->mult(out, t2);
-    kronecker(Dinv, t2, out);
+  TMR_TRACE_SCOPE("TMRHelmholtzPUFilter::applyFilter");
 
-    // Compute out = t1 + D^{-1}*B*out
-    out->axpy(1.0, t1);
-  }
-
-  // Multiply by Tinv
-  kronecker(Tinv, out);
+  // Compute t1 = D^{-1}*in and out = t1, apply Horner's method:
+  // out = t1 + D^{-1}*B*out and multiply by Tinv
+  horner->applyFilter(N, Dinv, NULL, Dinv, Tinv, in, t1, t2, out);
 }
 
 /*
   Compute the transpose of the filter operation
 */
 void TMRHelmholtzPUFilter::applyTranspose(TACSBVec *in, TACSBVec *out) {
-  kronecker(Tinv, in, t1);
-
-  // Copy the values from t1 to the out vector
-  out->copyValues(t1);
+  TMR_TRACE_SCOPE("TMRHelmholtzPUFilter::applyTranspose");
 
-  // Apply Horner's method
-  for (int n = 0; n < N; n++) {
-    // Compute B^{T}*D^{-1}*out
-    kronecker(Dinv, out, t2);
-    B->multTranspose(t2, out);
-
-    // Compute out = t1 + B^{T}*D^{-1}*out
-    out->axpy(1.0, t1);
-  }
-
-  // Multiply by Dinv
-  kronecker(Dinv, out);
+  // Compute t1 = Tinv*in and out = t1, apply Horner's method:
+  // out = t1 + B^{T}*D^{-1}*out and multiply by Dinv
+  horner->applyFilterTranspose(N, Tinv, Dinv, Dinv, in, t1, t2, out);
 }
 
 /*
@@ -758,6 +849,13 @@ void TMRHelmholtzPUFilter::kronecker(TACSBVec *c, TACSBVec *x, TACSBVec *y) {
   Set the design variables for each level
 */
 void TMRHelmholtzPUFilter::setDesignVars(TACSBVec *xvec) {
+  TMR_TRACE_SCOPE("TMRHelmholtzPUFilter::setDesignVars");
+
+  // Skip the filter if the design variables have not changed
+  if (!checkDesignVarsChanged(xvec, xraw)) {
+    return;
+  }
+
   xraw->copyValues(xvec);
   const int vpn = assembler[0]->getDesignVarsPerNode();
 
@@ -819,6 +917,8 @@ void TMRHelmholtzPUFilter::getDesignVars(TACSBVec *xvec) {
   Add values to the output TACSBVec
 */
 void TMRHelmholtzPUFilter::addValues(TACSBVec *vec) {
+  TMR_TRACE_SCOPE("TMRHelmholtzPUFilter::addValues");
+
   vec->beginSetValues(TACS_ADD_VALUES);
   vec->endSetValues(TACS_ADD_VALUES);
 
@@ -22,6 +22,7 @@
 #define TMR_HELMHOLTZ_PARTITION_UNITY_FILTER_H
 
 #include "TMRConformFilter.h"
+#include "TMRHornerOperator.h"
 
 /*
   Create a partition of unity filter
@@ -43,6 +44,19 @@ class TMRHelmholtzPUFilter : public TMRConformFilter {
                                  int npts, const TacsScalar Xpts[],
                                  double alpha[]) = 0;
 
+  // Compute the stencils for a set of interior nodes. The points for
+  // node k are stored in Xpts[3*ptr[k]:3*ptr[k+1]], and by default
+  // getInteriorStencil() is called for each node.
+  virtual int getInteriorStencils(int num_nodes, const int ptr[],
+                                  const int diagonal_index[],
+                                  const TacsScalar Xpts[], double alpha[]);
+
+  // Compute the stencils for a set of boundary nodes with normals n
+  virtual int getBoundaryStencils(int num_nodes, const int ptr[],
+                                  const int diagonal_index[],
+                                  const TacsScalar n[],
+                                  const TacsScalar Xpts[], double alpha[]);
+
   // Set the design variable values (including all local values)
   void setDesignVars(TACSBVec *x);
 
@@ -65,6 +79,9 @@ class TMRHelmholtzPUFilter : public TMRConformFilter {
   // The non-negative matrix M
   TACSMat *B;
 
+  // The operator that applies the Horner recurrence with B
+  TMRHornerOperator *horner;
+
   // The number of terms to include in the approximate inverse
   int N;
 
@@ -99,6 +116,8 @@ class TMRCallbackHelmholtzPUFilter : public TMRHelmholtzPUFilter {
     self = NULL;
     getinteriorstencil = NULL;
     getboundarystencil = NULL;
+    getinteriorstencils = NULL;
+    getboundarystencils = NULL;
   }
   TMRCallbackHelmholtzPUFilter(int _N, int _nlevels,
                                TACSAssembler *_assembler[],
@@ -107,6 +126,8 @@ class TMRCallbackHelmholtzPUFilter : public TMRHelmholtzPUFilter {
     self = NULL;
     getinteriorstencil = NULL;
     getboundarystencil = NULL;
+    getinteriorstencils = NULL;
+    getboundarystencils = NULL;
   }
   ~TMRCallbackHelmholtzPUFilter() {}
 
@@ -120,6 +141,16 @@ class TMRCallbackHelmholtzPUFilter : public TMRHelmholtzPUFilter {
                                          const TacsScalar *, double *)) {
     getboundarystencil = func;
   }
+  void setGetInteriorStencils(int (*func)(void *, int, const int *,
+                                          const int *, const TacsScalar *,
+                                          double *)) {
+    getinteriorstencils = func;
+  }
+  void setGetBoundaryStencils(int (*func)(void *, int, const int *,
+                                          const int *, const TacsScalar *,
+                                          const TacsScalar *, double *)) {
+    getboundarystencils = func;
+  }
 
   // Compute the stencil at an interior node
   int getInteriorStencil(int diagonal_index, int npts, const TacsScalar Xpts[],
@@ -139,11 +170,39 @@ class TMRCallbackHelmholtzPUFilter : public TMRHelmholtzPUFilter {
     return 1;
   }
 
+  // Compute the stencils for all interior nodes in a single call
+  int getInteriorStencils(int num_nodes, const int ptr[],
+                          const int diagonal_index[], const TacsScalar Xpts[],
+                          double alpha[]) {
+    if (self && getinteriorstencils) {
+      return getinteriorstencils(self, num_nodes, ptr, diagonal_index, Xpts,
+                                 alpha);
+    }
+    return TMRHelmholtzPUFilter::getInteriorStencils(
+        num_nodes, ptr, diagonal_index, Xpts, alpha);
+  }
+
+  // Compute the stencils for all boundary nodes in a single call
+  int getBoundaryStencils(int num_nodes, const int ptr[],
+                          const int diagonal_index[], const TacsScalar n[],
+                          const TacsScalar Xpts[], double alpha[]) {
+    if (self && getboundarystencils) {
+      return getboundarystencils(self, num_nodes, ptr, diagonal_index, n, Xpts,
+                                 alpha);
+    }
+    return TMRHelmholtzPUFilter::getBoundaryStencils(
+        num_nodes, ptr, diagonal_index, n, Xpts, alpha);
+  }
+
  private:
   void *self;
   int (*getinteriorstencil)(void *, int, int, const TacsScalar *, double *);
   int (*getboundarystencil)(void *, int, const TacsScalar *, int,
                             const TacsScalar *, double *);
+  int (*getinteriorstencils)(void *, int, const int *, const int *,
+                             const TacsScalar *, double *);
+  int (*getboundarystencils)(void *, int, const int *, const int *,
+                             const TacsScalar *, const TacsScalar *, double *);
 };
 
 #endif  // TMR_HELMHOLTZ_PARTITION_UNITY_FILTER_H
@@ -0,0 +1,382 @@
+/*
+  This file is part of the package TMR for adaptive mesh refinement.
+
+  Copyright (C) 2015 Georgia Tech Research Corporation.
+  Additional copyright (C) 2015 Graeme Kennedy.
+  All rights reserved.
+
+  TMR is licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this software except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include <string.h>
+
+#include "TMRDeviceRuntime.h"
+#include "TMRHornerDevice.h"
+
+/*
+  Allocate an array on the device and copy the host values to it
+*/
+template <typename T>
+static T *TMRDeviceCopy(const T *h, int size) {
+  T *d = NULL;
+  TMRDeviceCheck(cudaMalloc((void **)&d, (size > 0 ? size : 1) * sizeof(T)),
+                 "cudaMalloc");
+  if (h && size > 0) {
+    TMRDeviceCheck(cudaMemcpy(d, h, size * sizeof(T), cudaMemcpyHostToDevice),
+                   "cudaMemcpy");
+  }
+  return d;
+}
+
+/*
+  Compute the transpose of a matrix in compressed sparse row format
+  with nrows rows and ncols columns
+*/
+static void TMRTransposeCSR(int nrows, int ncols, const int *rowp,
+                            const int *cols, const double *vals, int *trowp,
+                            int *tcols, double *tvals) {
+  memset(trowp, 0, (ncols + 1) * sizeof(int));
+  for (int jp = 0; jp < rowp[nrows]; jp++) {
+    trowp[cols[jp] + 1]++;
+  }
+  for (int j = 0; j < ncols; j++) {
+    trowp[j + 1] += trowp[j];
+  }
+  for (int i = 0; i < nrows; i++) {
+    for (int jp = rowp[i]; jp < rowp[i + 1]; jp++) {
+      int k = trowp[cols[jp]];
+      tcols[k] = i;
+      tvals[k] = vals[jp];
+      trowp[cols[jp]]++;
+    }
+  }
+  for (int j = ncols; j > 0; j--) {
+    trowp[j] = trowp[j - 1];
+  }
+  trowp[0] = 0;
+}
+
+/*
+  Compute y = D*x, or y = x if D is not defined
+*/
+__global__ void TMRDeviceScaleKernel(int n, const double *d, const double *x,
+                                     double *y) {
+  int i = blockIdx.x * blockDim.x + threadIdx.x;
+  if (i < n) {
+    y[i] = (d ? d[i] * x[i] : x[i]);
+  }
+}
+
+/*
+  Compute y += x
+*/
+__global__ void TMRDeviceAddKernel(int n, const double *x, double *y) {
+  int i = blockIdx.x * blockDim.x + threadIdx.x;
+  if (i < n) {
+    y[i] += x[i];
+  }
+}
+
+/*
+  Compute y = A*x, or y += A*x if add is true, with one thread per row
+*/
+__global__ void TMRDeviceMultKernel(int n, const int *rowp, const int *cols,
+                                    const double *vals, const double *x,
+                                    double *y, int add) {
+  int i = blockIdx.x * blockDim.x + threadIdx.x;
+  if (i < n) {
+    double val = 0.0;
+    for (int jp = rowp[i]; jp < rowp[i + 1]; jp++) {
+      val += vals[jp] * x[cols[jp]];
+    }
+    y[i] = (add ? y[i] + val : val);
+  }
+}
+
+/*
+  Compute o = t + dpost*y and x = dpre*o for the rows [start, end)
+*/
+__global__ void TMRDeviceUpdateKernel(int start, int end, const double *dpre,
+                                      const double *dpost, const double *t,
+                                      const double *y, double *o, double *x) {
+  int i = start + blockIdx.x * blockDim.x + threadIdx.x;
+  if (i < end) {
+    double val = t[i] + (dpost ? dpost[i] * y[i] : y[i]);
+    o[i] = val;
+    x[i] = (dpre ? dpre[i] * val : val);
+  }
+}
+
+/*
+  Copy the matrix to the device
+
+  input:
+  nrows:      the number of local rows
+  ncoupling:  the number of coupling rows (the last rows)
+  next:       the number of external columns
+  arowp:      the pointer into the rows of the local part
+  acols:      the column indices of the local part
+  avals:      the values of the local part
+  browp:      the pointer into the coupling rows of the external part
+  bcols:      the external column indices
+  bvals:      the values of the external part
+*/
+TMRHornerDevice::TMRHornerDevice(int _nrows, int _ncoupling, int _next,
+                                 const int *arowp, const int *acols,
+                                 const double *avals, const int *browp,
+                                 const int *bcols, const double *bvals) {
+  nrows = _nrows;
+  ncoupling = _ncoupling;
+  next = _next;
+
+  // Form the transposes on the host so that the transpose products
+  // are computed one row at a time without atomic operations
+  int anz = arowp[nrows];
+  int bnz = browp[ncoupling];
+  int *trowp = new int[(nrows > next ? nrows : next) + 1];
+  int *tcols = new int[(anz > bnz ? anz : bnz) + 1];
+  double *tvals = new double[(anz > bnz ? anz : bnz) + 1];
+
+  a_rowp = TMRDeviceCopy(arowp, nrows + 1);
+  a_cols = TMRDeviceCopy(acols, anz);
+  a_vals = TMRDeviceCopy(avals, anz);
+  TMRTransposeCSR(nrows, nrows, arowp, acols, avals, trowp, tcols, tvals);
+  at_rowp = TMRDeviceCopy(trowp, nrows + 1);
+  at_cols = TMRDeviceCopy(tcols, anz);
+  at_vals = TMRDeviceCopy(tvals, anz);
+
+  b_rowp = TMRDeviceCopy(browp, ncoupling + 1);
+  b_cols = TMRDeviceCopy(bcols, bnz);
+  b_vals = TMRDeviceCopy(bvals, bnz);
+  TMRTransposeCSR(ncoupling, next, browp, bcols, bvals, trowp, tcols, tvals);
+  bt_rowp = TMRDeviceCopy(trowp, next + 1);
+  bt_cols = TMRDeviceCopy(tcols, bnz);
+  bt_vals = TMRDeviceCopy(tvals, bnz);
+
+  delete[] trowp;
+  delete[] tcols;
+  delete[] tvals;
+
+  for (int k = 0; k < MAX_DIAGONALS; k++) {
+    diag[k] = NULL;
+  }
+  for (int k = 0; k < 5; k++) {
+    vecs[k] = TMRDeviceCopy((const double *)NULL, nrows);
+  }
+  x_ext = TMRDeviceCopy((const double *)NULL, next);
+  stage = TMRDeviceCopy((const double *)NULL, nrows);
+}
+
+/*
+  Free the device memory
+*/
+TMRHornerDevice::~TMRHornerDevice() {
+  cudaFree(a_rowp);
+  cudaFree(a_cols);
+  cudaFree(a_vals);
+  cudaFree(at_rowp);
+  cudaFree(at_cols);
+  cudaFree(at_vals);
+  cudaFree(b_rowp);
+  cudaFree(b_cols);
+  cudaFree(b_vals);
+  cudaFree(bt_rowp);
+  cudaFree(bt_cols);
+  cudaFree(bt_vals);
+  for (int k = 0; k < MAX_DIAGONALS; k++) {
+    if (diag[k]) {
+      cudaFree(diag[k]);
+    }
+  }
+  for (int k = 0; k < 5; k++) {
+    cudaFree(vecs[k]);
+  }
+  cudaFree(x_ext);
+  cudaFree(stage);
+}
+
+/*
+  Check whether a device is available on this processor
+*/
+int TMRHornerDevice::isAvailable() {
+  int count = 0;
+  if (cudaGetDeviceCount(&count) != cudaSuccess) {
+    return 0;
+  }
+  return (count > 0);
+}
+
+/*
+  Copy the values of the diagonal matrix to the given slot
+*/
+void TMRHornerDevice::setDiagonal(int slot, const double *d) {
+  if (slot < 0 || slot >= MAX_DIAGONALS) {
+    fprintf(stderr, "TMRHornerDevice: Diagonal slot %d out of range\n", slot);
+    return;
+  }
+  if (!diag[slot]) {
+    diag[slot] = TMRDeviceCopy(d, nrows);
+  } else if (nrows > 0) {
+    TMRDeviceCheck(cudaMemcpy(diag[slot], d, nrows * sizeof(double),
+                              cudaMemcpyHostToDevice),
+                   "cudaMemcpy");
+  }
+}
+
+/*
+  Copy the rows [start, end) of the vector from the host
+*/
+void TMRHornerDevice::copyToDevice(VecType vec, int start, int end,
+                                   const double *h) {
+  if (end > start) {
+    TMRDeviceCheck(cudaMemcpy(&vecs[vec][start], h,
+                              (end - start) * sizeof(double),
+                              cudaMemcpyHostToDevice),
+                   "cudaMemcpy");
+  }
+}
+
+/*
+  Add the host values to the rows [start, end) of the vector
+*/
+void TMRHornerDevice::addToDevice(VecType vec, int start, int end,
+                                  const double *h) {
+  int n = end - start;
+  if (n > 0) {
+    TMRDeviceCheck(
+        cudaMemcpy(stage, h, n * sizeof(double), cudaMemcpyHostToDevice),
+        "cudaMemcpy");
+    TMRDeviceAddKernel<<<TMRDeviceNumBlocks(n), TMR_DEVICE_BLOCK_SIZE>>>(
+        n, stage, &vecs[vec][start]);
+  }
+}
+
+/*
+  Copy the rows [start, end) of the vector to the host
+*/
+void TMRHornerDevice::copyToHost(VecType vec, int start, int end,
+                                 double *h) {
+  if (end > start) {
+    TMRDeviceCheck(cudaMemcpy(h, &vecs[vec][start],
+                              (end - start) * sizeof(double),
+                              cudaMemcpyDeviceToHost),
+                   "cudaMemcpy");
+  }
+}
+
+/*
+  Copy the external values from the host
+*/
+void TMRHornerDevice::copyExtToDevice(const double *h) {
+  if (next > 0) {
+    TMRDeviceCheck(
+        cudaMemcpy(x_ext, h, next * sizeof(double), cudaMemcpyHostToDevice),
+        "cudaMemcpy");
+  }
+}
+
+/*
+  Copy the external values to the host
+*/
+void TMRHornerDevice::copyExtToHost(double *h) {
+  if (next > 0) {
+    TMRDeviceCheck(
+        cudaMemcpy(h, x_ext, next * sizeof(double), cudaMemcpyDeviceToHost),
+        "cudaMemcpy");
+  }
+}
+
+/*
+  Compute dst = D*src where D is the diagonal matrix in the given slot
+*/
+void TMRHornerDevice::scale(VecType dst, int slot, VecType src) {
+  if (nrows > 0) {
+    const double *d = (slot >= 0 ? diag[slot] : NULL);
+    TMRDeviceScaleKernel<<<TMRDeviceNumBlocks(nrows),
+                           TMR_DEVICE_BLOCK_SIZE>>>(nrows, d, vecs[src],
+                                                    vecs[dst]);
+  }
+}
+
+/*
+  Compute y = Aloc*x
+*/
+void TMRHornerDevice::multLocal() {
+  if (nrows > 0) {
+    TMRDeviceMultKernel<<<TMRDeviceNumBlocks(nrows),
+                          TMR_DEVICE_BLOCK_SIZE>>>(
+        nrows, a_rowp, a_cols, a_vals, vecs[X_VEC], vecs[Y_VEC], 0);
+  }
+}
+
+/*
+  Add the contributions from the external columns to the coupling rows
+*/
+void TMRHornerDevice::addExternal() {
+  if (ncoupling > 0) {
+    TMRDeviceMultKernel<<<TMRDeviceNumBlocks(ncoupling),
+                          TMR_DEVICE_BLOCK_SIZE>>>(
+        ncoupling, b_rowp, b_cols, b_vals, x_ext,
+        &vecs[Y_VEC][nrows - ncoupling], 1);
+  }
+}
+
+/*
+  Update the rows [start, end) after the matrix product
+*/
+void TMRHornerDevice::updateRows(int start, int end, int pre, int post) {
+  if (end > start) {
+    const double *dpre = (pre >= 0 ? diag[pre] : NULL);
+    const double *dpost = (post >= 0 ? diag[post] : NULL);
+    TMRDeviceUpdateKernel<<<TMRDeviceNumBlocks(end - start),
+                            TMR_DEVICE_BLOCK_SIZE>>>(
+        start, end, dpre, dpost, vecs[T_VEC], vecs[Y_VEC], vecs[OUT_VEC],
+        vecs[X_VEC]);
+  }
+}
+
+/*
+  Compute out = Aloc^{T}*x
+*/
+void TMRHornerDevice::multLocalTranspose() {
+  if (nrows > 0) {
+    TMRDeviceMultKernel<<<TMRDeviceNumBlocks(nrows),
+                          TMR_DEVICE_BLOCK_SIZE>>>(
+        nrows, at_rowp, at_cols, at_vals, vecs[X_VEC], vecs[OUT_VEC], 0);
+  }
+}
+
+/*
+  Compute x_ext = Bext^{T}*x for the coupling rows
+*/
+void TMRHornerDevice::multExternalTranspose() {
+  if (next > 0) {
+    TMRDeviceMultKernel<<<TMRDeviceNumBlocks(next),
+                          TMR_DEVICE_BLOCK_SIZE>>>(
+        next, bt_rowp, bt_cols, bt_vals, &vecs[X_VEC][nrows - ncoupling],
+        x_ext, 0);
+  }
+}
+
+/*
+  Add the constant term and compute the input for the next product
+*/
+void TMRHornerDevice::addConstant(int pre) {
+  if (nrows > 0) {
+    const double *dpre = (pre >= 0 ? diag[pre] : NULL);
+    TMRDeviceUpdateKernel<<<TMRDeviceNumBlocks(nrows),
+                            TMR_DEVICE_BLOCK_SIZE>>>(
+        0, nrows, dpre, NULL, vecs[T_VEC], vecs[OUT_VEC], vecs[OUT_VEC],
+        vecs[X_VEC]);
+  }
+}
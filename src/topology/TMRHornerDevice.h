@@ -0,0 +1,113 @@
+/*
+  This file is part of the package TMR for adaptive mesh refinement.
+
+  Copyright (C) 2015 Georgia Tech Research Corporation.
+  Additional copyright (C) 2015 Graeme Kennedy.
+  All rights reserved.
+
+  TMR is licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this software except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef TMR_HORNER_DEVICE_H
+#define TMR_HORNER_DEVICE_H
+
+/*
+  The device kernels are only compiled when TMR is built with
+  -DTMR_HAS_CUDA or -DTMR_HAS_HIP, and are only used for real-valued
+  matrices.
+*/
+#if (defined(TMR_HAS_CUDA) || defined(TMR_HAS_HIP)) && \
+    !defined(TACS_USE_COMPLEX)
+#define TMR_HORNER_USE_DEVICE
+#endif
+
+/*
+  The storage for the Horner recurrence on a GPU
+
+  This class holds device copies of the local and external parts of a
+  matrix with a block size of one, in compressed sparse row format
+  together with their transposes, a fixed number of diagonal matrices
+  stored as vectors and the vectors used in the recurrence. All of the
+  operations are queued on a single stream, so they execute in the
+  order that they are called. The transfers to and from the host are
+  synchronous.
+
+  The class only exposes the individual steps of the recurrence. The
+  ghost exchange between processors is performed on the host by
+  TMRHornerOperator, which copies only the values that are exchanged
+  between the host and the device at each step.
+*/
+class TMRHornerDevice {
+ public:
+  // The vectors used in the recurrence
+  enum VecType { IN_VEC, T_VEC, OUT_VEC, X_VEC, Y_VEC };
+
+  // The number of diagonal matrices stored on the device
+  static const int MAX_DIAGONALS = 8;
+
+  TMRHornerDevice(int _nrows, int _ncoupling, int _next, const int *arowp,
+                  const int *acols, const double *avals, const int *browp,
+                  const int *bcols, const double *bvals);
+  ~TMRHornerDevice();
+
+  // Check whether a device is available on this processor
+  static int isAvailable();
+
+  // Copy the values of a diagonal matrix to the device
+  void setDiagonal(int slot, const double *d);
+
+  // Copy, add or retrieve the rows [start, end) of a vector
+  void copyToDevice(VecType vec, int start, int end, const double *h);
+  void addToDevice(VecType vec, int start, int end, const double *h);
+  void copyToHost(VecType vec, int start, int end, double *h);
+
+  // Copy the external values to or from the device
+  void copyExtToDevice(const double *h);
+  void copyExtToHost(double *h);
+
+  // Compute dst = D*src, where a negative slot indicates D = I
+  void scale(VecType dst, int slot, VecType src);
+
+  // Compute y = Aloc*x and add y[coupling] += Bext*x_ext
+  void multLocal();
+  void addExternal();
+
+  // Update the rows [start, end): out = t + Dpost*y and x = Dpre*out
+  void updateRows(int start, int end, int pre, int post);
+
+  // Compute out = Aloc^{T}*x and x_ext = Bext^{T}*x[coupling]
+  void multLocalTranspose();
+  void multExternalTranspose();
+
+  // Add the constant term: out += t and x = Dpre*out
+  void addConstant(int pre);
+
+ private:
+  // The dimensions of the matrix
+  int nrows, ncoupling, next;
+
+  // The local and external parts of the matrix and their transposes
+  int *a_rowp, *a_cols, *at_rowp, *at_cols;
+  int *b_rowp, *b_cols, *bt_rowp, *bt_cols;
+  double *a_vals, *at_vals, *b_vals, *bt_vals;
+
+  // The diagonal matrices
+  double *diag[MAX_DIAGONALS];
+
+  // The vectors in the recurrence, the external values and a buffer
+  // for the values added from the host
+  double *vecs[5];
+  double *x_ext, *stage;
+};
+
+#endif  // TMR_HORNER_DEVICE_H
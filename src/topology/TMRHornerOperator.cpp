@@ -0,0 +1,578 @@
+/*
+  This file is part of the package TMR for adaptive mesh refinement.
+
+  Copyright (C) 2015 Georgia Tech Research Corporation.
+  Additional copyright (C) 2015 Graeme Kennedy.
+  All rights reserved.
+
+  TMR is licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this software except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include "TMRHornerOperator.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/*
+  Compute y = c o x where the entries of c are the diagonal of a
+  matrix stored as a vector, or y = x if c is not defined
+*/
+static void TMRScaleVec(TACSBVec *c, TACSBVec *x, TACSBVec *y) {
+  if (!c) {
+    if (x != y) {
+      y->copyValues(x);
+    }
+    return;
+  }
+  TacsScalar *cvals, *xvals, *yvals;
+  int size = c->getArray(&cvals);
+  x->getArray(&xvals);
+  y->getArray(&yvals);
+  for (int i = 0; i < size; i++) {
+    yvals[i] = cvals[i] * xvals[i];
+  }
+}
+
+/*
+  Create the operator for the given matrix
+
+  input:
+  comm:   the communicator for the matrix
+  mat:    the matrix
+*/
+TMRHornerOperator::TMRHornerOperator(MPI_Comm comm, TACSMat *_mat) {
+  mat = _mat;
+  mat->incref();
+
+  use_fused = 0;
+  use_overlap = 0;
+  Aloc = NULL;
+  Bext = NULL;
+  nrows = ncoupling = next = 0;
+  ext_dist = NULL;
+  ctx = NULL;
+  x_ext = NULL;
+  y = NULL;
+  device = NULL;
+  num_device_vecs = 0;
+
+  // The fused recurrence requires direct access to the local and
+  // external parts of the matrix
+  TACSParallelMat *pmat = dynamic_cast<TACSParallelMat *>(mat);
+  if (!pmat) {
+    return;
+  }
+
+  int bsize;
+  pmat->getRowMap(&bsize, &nrows, &ncoupling);
+  if (bsize != 1) {
+    return;
+  }
+
+  use_fused = 1;
+  pmat->getBCSRMat(&Aloc, &Bext);
+  Aloc->incref();
+  Bext->incref();
+
+  int bs, nb;
+  const int *browp, *bcols;
+  TacsScalar *bvals;
+  Bext->getArrays(&bs, &nb, &next, &browp, &bcols, &bvals);
+
+  pmat->getExtColMap(&ext_dist);
+  ext_dist->incref();
+  ctx = ext_dist->createCtx(1);
+  ctx->incref();
+
+  x_ext = new TacsScalar[next > 0 ? next : 1];
+  y = new TacsScalar[nrows > 0 ? nrows : 1];
+
+  // Check whether the ghost values required by the other processors
+  // are all associated with the coupling rows. This is the case when
+  // the non-zero pattern of the matrix is symmetric.
+  for (int i = 0; i < nrows; i++) {
+    y[i] = (i >= nrows - ncoupling ? 1.0 : 0.0);
+  }
+  ext_dist->beginForward(ctx, y, x_ext);
+  ext_dist->endForward(ctx, y, x_ext);
+
+  int overlap = 1;
+  for (int i = 0; i < next; i++) {
+    if (TacsRealPart(x_ext[i]) != 1.0) {
+      overlap = 0;
+      break;
+    }
+  }
+  MPI_Allreduce(&overlap, &use_overlap, 1, MPI_INT, MPI_MIN, comm);
+
+#ifdef TMR_HORNER_USE_DEVICE
+  // Copy the matrix to the device. The device kernels have not yet
+  // been validated on hardware, so the device is only used when it is
+  // requested by setting the TMR_USE_DEVICE environment variable.
+  const char *use_device = getenv("TMR_USE_DEVICE");
+  if (use_device && atoi(use_device) && TMRHornerDevice::isAvailable()) {
+    const int *arowp, *acols;
+    TacsScalar *avals;
+    Aloc->getArrays(&bs, &nb, &nb, &arowp, &acols, &avals);
+    device = new TMRHornerDevice(nrows, ncoupling, next, arowp, acols, avals,
+                                 browp, bcols, bvals);
+  }
+#endif  // TMR_HORNER_USE_DEVICE
+}
+
+/*
+  Free the operator
+*/
+TMRHornerOperator::~TMRHornerOperator() {
+  mat->decref();
+  if (Aloc) {
+    Aloc->decref();
+  }
+  if (Bext) {
+    Bext->decref();
+  }
+  if (ctx) {
+    ctx->decref();
+  }
+  if (ext_dist) {
+    ext_dist->decref();
+  }
+  if (x_ext) {
+    delete[] x_ext;
+  }
+  if (y) {
+    delete[] y;
+  }
+#ifdef TMR_HORNER_USE_DEVICE
+  if (device) {
+    delete device;
+  }
+#endif  // TMR_HORNER_USE_DEVICE
+  for (int i = 0; i < num_device_vecs; i++) {
+    device_vecs[i]->decref();
+  }
+}
+
+/*
+  Keep a copy of the diagonal matrix on the device
+
+  The values are copied when this function is called, so it must be
+  called again if the values of the vector are modified. This has no
+  effect when the recurrence is not applied on the device.
+
+  input:
+  vec:    the diagonal matrix stored as a vector
+*/
+void TMRHornerOperator::setDeviceVec(TACSBVec *vec) {
+#ifdef TMR_HORNER_USE_DEVICE
+  if (!device || !vec) {
+    return;
+  }
+
+  int slot = 0;
+  while (slot < num_device_vecs && device_vecs[slot] != vec) {
+    slot++;
+  }
+  if (slot == num_device_vecs) {
+    if (num_device_vecs >= MAX_DEVICE_VECS) {
+      fprintf(stderr,
+              "TMRHornerOperator Warning: Cannot keep more than %d "
+              "vectors on the device\n",
+              MAX_DEVICE_VECS);
+      return;
+    }
+    vec->incref();
+    device_vecs[num_device_vecs] = vec;
+    num_device_vecs++;
+  }
+
+  TacsScalar *vals;
+  vec->getArray(&vals);
+  device->setDiagonal(slot, vals);
+#endif  // TMR_HORNER_USE_DEVICE
+}
+
+/*
+  Get the slot on the device that contains the values of the diagonal
+  matrix. If the vector does not remain on the device, its values are
+  copied to the temporary slot. A negative slot is returned when the
+  vector is not defined.
+*/
+int TMRHornerOperator::getDeviceSlot(TACSBVec *vec, int temp_slot) {
+  if (!vec) {
+    return -1;
+  }
+  for (int i = 0; i < num_device_vecs; i++) {
+    if (device_vecs[i] == vec) {
+      return i;
+    }
+  }
+#ifdef TMR_HORNER_USE_DEVICE
+  TacsScalar *vals;
+  vec->getArray(&vals);
+  device->setDiagonal(temp_slot, vals);
+#endif  // TMR_HORNER_USE_DEVICE
+  return temp_slot;
+}
+
+/*
+  Update the rows [start, end) after the matrix product y has been
+  computed. This computes
+
+  o = t + dpost*y
+
+  and, if dpre is defined, the input for the next product x = dpre*o.
+*/
+void TMRHornerOperator::updateRows(int start, int end,
+                                   const TacsScalar *dpre,
+                                   const TacsScalar *dpost,
+                                   const TacsScalar *t, const TacsScalar *y,
+                                   TacsScalar *o, TacsScalar *x) {
+  if (dpost) {
+    for (int i = start; i < end; i++) {
+      o[i] = t[i] + dpost[i] * y[i];
+    }
+  } else {
+    for (int i = start; i < end; i++) {
+      o[i] = t[i] + y[i];
+    }
+  }
+  if (dpre) {
+    for (int i = start; i < end; i++) {
+      x[i] = dpre[i] * o[i];
+    }
+  }
+}
+
+/*
+  Apply the forward recurrence
+
+  for n in range(N):
+  .   out = t1 + Dpost*A*(Dpre*out)
+
+  input:
+  N:      the number of terms
+  Dpre:   the diagonal scaling applied before the product (may be NULL)
+  Dpost:  the diagonal scaling applied after the product (may be NULL)
+  t1:     the constant term in the recurrence
+  t2:     a temporary vector
+
+  input/output:
+  out:    the initial value on input and the result on output
+*/
+void TMRHornerOperator::apply(int N, TACSBVec *Dpre, TACSBVec *Dpost,
+                              TACSBVec *t1, TACSBVec *t2, TACSBVec *out) {
+  if (!use_fused) {
+    for (int n = 0; n < N; n++) {
+      if (Dpre) {
+        TMRScaleVec(Dpre, out, t2);
+        mat->mult(t2, out);
+      } else {
+        mat->mult(out, t2);
+        out->copyValues(t2);
+      }
+      if (Dpost) {
+        TMRScaleVec(Dpost, out, out);
+      }
+      out->axpy(1.0, t1);
+    }
+    return;
+  }
+
+  TacsScalar *o, *t;
+  out->getArray(&o);
+  t1->getArray(&t);
+
+  TacsScalar *dpre = NULL, *dpost = NULL;
+  if (Dpost) {
+    Dpost->getArray(&dpost);
+  }
+
+  // Set the input to the matrix product
+  TacsScalar *x = o;
+  if (Dpre) {
+    Dpre->getArray(&dpre);
+    t2->getArray(&x);
+    for (int i = 0; i < nrows; i++) {
+      x[i] = dpre[i] * o[i];
+    }
+  }
+
+  int bs, nb, nc;
+  const int *browp, *bcols;
+  TacsScalar *bvals;
+  Bext->getArrays(&bs, &nb, &nc, &browp, &bcols, &bvals);
+
+  // The first coupling row
+  const int np = nrows - ncoupling;
+
+  if (N > 0) {
+    ext_dist->beginForward(ctx, x, x_ext);
+  }
+  for (int n = 0; n < N; n++) {
+    // Compute the product with the local part while the ghost
+    // values are exchanged
+    Aloc->mult(x, y);
+    ext_dist->endForward(ctx, x, x_ext);
+
+    // Add the contributions from the external columns
+    for (int ib = 0; ib < ncoupling; ib++) {
+      TacsScalar val = 0.0;
+      for (int jp = browp[ib]; jp < browp[ib + 1]; jp++) {
+        val += bvals[jp] * x_ext[bcols[jp]];
+      }
+      y[np + ib] += val;
+    }
+
+    // Update the coupling rows first, so that the exchange for the
+    // next step can proceed while the remaining rows are updated
+    updateRows(np, nrows, dpre, dpost, t, y, o, x);
+    if (use_overlap && n < N - 1) {
+      ext_dist->beginForward(ctx, x, x_ext);
+    }
+    updateRows(0, np, dpre, dpost, t, y, o, x);
+    if (!use_overlap && n < N - 1) {
+      ext_dist->beginForward(ctx, x, x_ext);
+    }
+  }
+}
+
+/*
+  Apply the transpose recurrence
+
+  for n in range(N):
+  .   out = t1 + A^{T}*(Dpre*out)
+
+  input:
+  N:      the number of terms
+  Dpre:   the diagonal scaling applied before the product (may be NULL)
+  t1:     the constant term in the recurrence
+  t2:     a temporary vector
+
+  input/output:
+  out:    the initial value on input and the result on output
+*/
+void TMRHornerOperator::applyTranspose(int N, TACSBVec *Dpre, TACSBVec *t1,
+                                       TACSBVec *t2, TACSBVec *out) {
+  if (!use_fused) {
+    for (int n = 0; n < N; n++) {
+      if (Dpre) {
+        TMRScaleVec(Dpre, out, t2);
+      } else {
+        t2->copyValues(out);
+      }
+      mat->multTranspose(t2, out);
+      out->axpy(1.0, t1);
+    }
+    return;
+  }
+
+  TacsScalar *o, *t, *x;
+  out->getArray(&o);
+  t1->getArray(&t);
+  t2->getArray(&x);
+
+  TacsScalar *dpre = NULL;
+  if (Dpre) {
+    Dpre->getArray(&dpre);
+    for (int i = 0; i < nrows; i++) {
+      x[i] = dpre[i] * o[i];
+    }
+  } else {
+    memcpy(x, o, nrows * sizeof(TacsScalar));
+  }
+
+  int bs, nb, nc;
+  const int *browp, *bcols;
+  TacsScalar *bvals;
+  Bext->getArrays(&bs, &nb, &nc, &browp, &bcols, &bvals);
+
+  // The first coupling row
+  const int np = nrows - ncoupling;
+
+  for (int n = 0; n < N; n++) {
+    // Compute the contributions to the external rows first and send
+    // them while the product with the local part is computed
+    memset(x_ext, 0, next * sizeof(TacsScalar));
+    for (int ib = 0; ib < ncoupling; ib++) {
+      TacsScalar xi = x[np + ib];
+      for (int jp = browp[ib]; jp < browp[ib + 1]; jp++) {
+        x_ext[bcols[jp]] += bvals[jp] * xi;
+      }
+    }
+    ext_dist->beginReverse(ctx, x_ext, o, TACS_ADD_VALUES);
+    Aloc->multTranspose(x, o);
+    ext_dist->endReverse(ctx, x_ext, o, TACS_ADD_VALUES);
+
+    // Add the constant term and compute the input for the next step
+    // in the same pass
+    if (dpre) {
+      for (int i = 0; i < nrows; i++) {
+        o[i] += t[i];
+        x[i] = dpre[i] * o[i];
+      }
+    } else {
+      for (int i = 0; i < nrows; i++) {
+        o[i] += t[i];
+        x[i] = o[i];
+      }
+    }
+  }
+}
+
+/*
+  Apply the filter with the forward recurrence
+
+  t1 = Cin*in
+  out = t1
+  for n in range(N):
+  .   out = t1 + Dpost*A*(Dpre*out)
+  out = Cout*out
+
+  When the recurrence is applied on the device, the values of t1 are
+  not set on exit.
+
+  input:
+  N:      the number of terms
+  Cin:    the diagonal scaling of the input (may be NULL)
+  Dpre:   the diagonal scaling applied before the product (may be NULL)
+  Dpost:  the diagonal scaling applied after the product (may be NULL)
+  Cout:   the diagonal scaling of the output (may be NULL)
+  in:     the input vector
+  t1:     a temporary vector
+  t2:     a temporary vector
+
+  output:
+  out:    the filtered vector
+*/
+void TMRHornerOperator::applyFilter(int N, TACSBVec *Cin, TACSBVec *Dpre,
+                                    TACSBVec *Dpost, TACSBVec *Cout,
+                                    TACSBVec *in, TACSBVec *t1, TACSBVec *t2,
+                                    TACSBVec *out) {
+#ifdef TMR_HORNER_USE_DEVICE
+  if (device) {
+    TacsScalar *h_in, *h_out, *h_x;
+    in->getArray(&h_in);
+    out->getArray(&h_out);
+    t2->getArray(&h_x);
+
+    int cin = getDeviceSlot(Cin, MAX_DEVICE_VECS);
+    int pre = getDeviceSlot(Dpre, MAX_DEVICE_VECS + 1);
+    int post = getDeviceSlot(Dpost, MAX_DEVICE_VECS + 2);
+    int cout = getDeviceSlot(Cout, MAX_DEVICE_VECS + 3);
+
+    device->copyToDevice(TMRHornerDevice::IN_VEC, 0, nrows, h_in);
+    device->scale(TMRHornerDevice::T_VEC, cin, TMRHornerDevice::IN_VEC);
+    device->scale(TMRHornerDevice::OUT_VEC, -1, TMRHornerDevice::T_VEC);
+    device->scale(TMRHornerDevice::X_VEC, pre, TMRHornerDevice::OUT_VEC);
+
+    // Only the coupling rows are sent to the other processors when
+    // the exchange can be overlapped
+    const int start = (use_overlap ? nrows - ncoupling : 0);
+
+    for (int n = 0; n < N; n++) {
+      // Copy the values that are sent to the host, and exchange them
+      // while the product with the local part is computed
+      device->copyToHost(TMRHornerDevice::X_VEC, start, nrows, &h_x[start]);
+      device->multLocal();
+      ext_dist->beginForward(ctx, h_x, x_ext);
+      ext_dist->endForward(ctx, h_x, x_ext);
+      device->copyExtToDevice(x_ext);
+      device->addExternal();
+      device->updateRows(0, nrows, pre, post);
+    }
+
+    device->scale(TMRHornerDevice::OUT_VEC, cout, TMRHornerDevice::OUT_VEC);
+    device->copyToHost(TMRHornerDevice::OUT_VEC, 0, nrows, h_out);
+    return;
+  }
+#endif  // TMR_HORNER_USE_DEVICE
+
+  TMRScaleVec(Cin, in, t1);
+  out->copyValues(t1);
+  apply(N, Dpre, Dpost, t1, t2, out);
+  TMRScaleVec(Cout, out, out);
+}
+
+/*
+  Apply the filter with the transpose recurrence
+
+  t1 = Cin*in
+  out = t1
+  for n in range(N):
+  .   out = t1 + A^{T}*(Dpre*out)
+  out = Cout*out
+
+  When the recurrence is applied on the device, the values of t1 are
+  not set on exit.
+
+  input:
+  N:      the number of terms
+  Cin:    the diagonal scaling of the input (may be NULL)
+  Dpre:   the diagonal scaling applied before the product (may be NULL)
+  Cout:   the diagonal scaling of the output (may be NULL)
+  in:     the input vector
+  t1:     a temporary vector
+  t2:     a temporary vector
+
+  output:
+  out:    the filtered vector
+*/
+void TMRHornerOperator::applyFilterTranspose(int N, TACSBVec *Cin,
+                                             TACSBVec *Dpre, TACSBVec *Cout,
+                                             TACSBVec *in, TACSBVec *t1,
+                                             TACSBVec *t2, TACSBVec *out) {
+#ifdef TMR_HORNER_USE_DEVICE
+  if (device) {
+    TacsScalar *h_in, *h_out, *h_x;
+    in->getArray(&h_in);
+    out->getArray(&h_out);
+    t2->getArray(&h_x);
+
+    int cin = getDeviceSlot(Cin, MAX_DEVICE_VECS);
+    int pre = getDeviceSlot(Dpre, MAX_DEVICE_VECS + 1);
+    int cout = getDeviceSlot(Cout, MAX_DEVICE_VECS + 3);
+
+    device->copyToDevice(TMRHornerDevice::IN_VEC, 0, nrows, h_in);
+    device->scale(TMRHornerDevice::T_VEC, cin, TMRHornerDevice::IN_VEC);
+    device->scale(TMRHornerDevice::OUT_VEC, -1, TMRHornerDevice::T_VEC);
+    device->scale(TMRHornerDevice::X_VEC, pre, TMRHornerDevice::OUT_VEC);
+
+    // Only the coupling rows receive values from the other processors
+    // when the exchange can be overlapped
+    const int start = (use_overlap ? nrows - ncoupling : 0);
+
+    for (int n = 0; n < N; n++) {
+      // Compute the contributions to the external rows and send them
+      // while the product with the local part is computed
+      device->multExternalTranspose();
+      device->copyExtToHost(x_ext);
+      device->multLocalTranspose();
+      memset(&h_x[start], 0, (nrows - start) * sizeof(TacsScalar));
+      ext_dist->beginReverse(ctx, x_ext, h_x, TACS_ADD_VALUES);
+      ext_dist->endReverse(ctx, x_ext, h_x, TACS_ADD_VALUES);
+      device->addToDevice(TMRHornerDevice::OUT_VEC, start, nrows, &h_x[start]);
+      device->addConstant(pre);
+    }
+
+    device->scale(TMRHornerDevice::OUT_VEC, cout, TMRHornerDevice::OUT_VEC);
+    device->copyToHost(TMRHornerDevice::OUT_VEC, 0, nrows, h_out);
+    return;
+  }
+#endif  // TMR_HORNER_USE_DEVICE
+
+  TMRScaleVec(Cin, in, t1);
+  out->copyValues(t1);
+  applyTranspose(N, Dpre, t1, t2, out);
+  TMRScaleVec(Cout, out, out);
+}
@@ -0,0 +1,129 @@
+/*
+  This file is part of the package TMR for adaptive mesh refinement.
+
+  Copyright (C) 2015 Georgia Tech Research Corporation.
+  Additional copyright (C) 2015 Graeme Kennedy.
+  All rights reserved.
+
+  TMR is licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this software except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef TMR_HORNER_OPERATOR_H
+#define TMR_HORNER_OPERATOR_H
+
+#include "TACSBVec.h"
+#include "TACSParallelMat.h"
+#include "TMRHornerDevice.h"
+
+/*
+  Apply the Horner recurrences used by the matrix-based filters
+
+  The forward recurrence computes
+
+  for n in range(N):
+  .   out = t1 + Dpost*A*(Dpre*out)
+
+  and the transpose recurrence computes
+
+  for n in range(N):
+  .   out = t1 + A^{T}*(Dpre*out)
+
+  where Dpre and Dpost are optional diagonal matrices stored as
+  vectors. When the matrix is a TACSParallelMat with a block size of
+  one, the scaling and the update are applied in the same pass over
+  the rows that adds the contribution from the external columns, and
+  the ghost exchange is overlapped with the product with the local
+  part of the matrix. In addition, when the ghost values that other
+  processors require are all associated with the coupling rows (the
+  rows that reference external columns), the exchange for the next
+  step is started as soon as the coupling rows are updated and
+  proceeds while the remaining rows are updated. Otherwise, the
+  recurrence is applied with the TACSMat interface.
+
+  The applyFilter() and applyFilterTranspose() functions apply the
+  complete filter, including the diagonal scaling of the input and
+  the output. When TMR is built with -DTMR_HAS_CUDA or -DTMR_HAS_HIP,
+  a device is available and the TMR_USE_DEVICE environment variable
+  is set to 1, the fused recurrence is applied on the device. The
+  device path is experimental: the kernels have not been validated on
+  hardware, so it is not used by default. The matrix is copied to the
+  device when the operator is created, and the diagonal matrices
+  passed to setDeviceVec() remain on the device. The input vector is
+  copied to the device and the result is copied back once for each
+  application. At each step, only the values exchanged with the other
+  processors are copied between the host and the device, and the
+  exchange proceeds while the device computes the product with the
+  local part of the matrix.
+*/
+class TMRHornerOperator : public TACSObject {
+ public:
+  TMRHornerOperator(MPI_Comm _comm, TACSMat *_mat);
+  ~TMRHornerOperator();
+
+  // Apply the forward recurrence
+  void apply(int N, TACSBVec *Dpre, TACSBVec *Dpost, TACSBVec *t1,
+             TACSBVec *t2, TACSBVec *out);
+
+  // Apply the transpose recurrence
+  void applyTranspose(int N, TACSBVec *Dpre, TACSBVec *t1, TACSBVec *t2,
+                      TACSBVec *out);
+
+  // Apply the filter out = Cout*H*(Cin*in) with the forward recurrence
+  void applyFilter(int N, TACSBVec *Cin, TACSBVec *Dpre, TACSBVec *Dpost,
+                   TACSBVec *Cout, TACSBVec *in, TACSBVec *t1, TACSBVec *t2,
+                   TACSBVec *out);
+
+  // Apply the filter out = Cout*H*(Cin*in) with the transpose recurrence
+  void applyFilterTranspose(int N, TACSBVec *Cin, TACSBVec *Dpre,
+                            TACSBVec *Cout, TACSBVec *in, TACSBVec *t1,
+                            TACSBVec *t2, TACSBVec *out);
+
+  // Keep a copy of the diagonal matrix on the device (if any)
+  void setDeviceVec(TACSBVec *vec);
+
+ private:
+  // Update the rows [start, end) after the matrix product
+  static void updateRows(int start, int end, const TacsScalar *dpre,
+                         const TacsScalar *dpost, const TacsScalar *t,
+                         const TacsScalar *y, TacsScalar *o, TacsScalar *x);
+
+  // The matrix
+  TACSMat *mat;
+
+  // Flags indicating whether to use the fused and overlapped paths
+  int use_fused, use_overlap;
+
+  // The local and external parts of the parallel matrix
+  BCSRMat *Aloc, *Bext;
+  int nrows, ncoupling, next;
+
+  // The distribution object for the external column values
+  TACSBVecDistribute *ext_dist;
+  TACSBVecDistCtx *ctx;
+
+  // Storage for the external values and the matrix product
+  TacsScalar *x_ext, *y;
+
+  // Get the device slot for the diagonal matrix, copying its values
+  // to the given temporary slot if it does not remain on the device
+  int getDeviceSlot(TACSBVec *vec, int temp_slot);
+
+  // The matrix on the device and the diagonal matrices that remain
+  // on the device
+  static const int MAX_DEVICE_VECS = TMRHornerDevice::MAX_DIAGONALS - 4;
+  TMRHornerDevice *device;
+  int num_device_vecs;
+  TACSBVec *device_vecs[MAX_DEVICE_VECS];
+};
+
+#endif  // TMR_HORNER_OPERATOR_H
@@ -20,6 +20,8 @@
 
 #include "TMRLagrangeFilter.h"
 
+#include "TMRTrace.h"
+
 TMRLagrangeFilter::TMRLagrangeFilter(int _nlevels, TACSAssembler *_assembler[],
                                      TMROctForest *_filter[]) {
   initialize(_nlevels, _assembler, _filter, NULL);
@@ -150,6 +152,13 @@ TMROctForest *TMRLagrangeFilter::getFilterOctForest() {
   Set the design variables for each level
 */
 void TMRLagrangeFilter::setDesignVars(TACSBVec *xvec) {
+  TMR_TRACE_SCOPE("TMRLagrangeFilter::setDesignVars");
+
+  // Skip the update if the design variables have not changed
+  if (!checkDesignVarsChanged(xvec, x[0])) {
+    return;
+  }
+
   // Copy the values to the local design variable vector
   x[0]->copyValues(xvec);
   assembler[0]->setDesignVars(x[0]);
@@ -165,6 +174,8 @@ void TMRLagrangeFilter::setDesignVars(TACSBVec *xvec) {
   Add values to the output TACSBVec
 */
 void TMRLagrangeFilter::addValues(TACSBVec *vec) {
+  TMR_TRACE_SCOPE("TMRLagrangeFilter::addValues");
+
   vec->beginSetValues(TACS_ADD_VALUES);
   vec->endSetValues(TACS_ADD_VALUES);
 }
@@ -55,7 +55,15 @@ class TMRLagrangeFilter : public TMRTopoFilter {
   // Write the STL file
   void writeSTLFile(int k, double cutoff, const char *filename) {
     if (oct_filter) {
-      TMR_GenerateBinFile(filename, oct_filter[0], x[0], k, cutoff);
+      TMR_WriteSTLFile(filename, oct_filter[0], x[0], k, cutoff);
+    }
+  }
+  void beginWriteSTLFile(int k, double cutoff, const char *filename,
+                         TMRSTLFileRequest **request) {
+    *request = NULL;
+    if (oct_filter) {
+      TMR_BeginWriteSTLFile(filename, oct_filter[0], x[0], k, cutoff,
+                            request);
     }
   }
 
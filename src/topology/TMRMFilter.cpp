@@ -0,0 +1,622 @@
+/*
+  This file is part of the package TMR for adaptive mesh refinement.
+
+  Copyright (C) 2015 Georgia Tech Research Corporation.
+  Additional copyright (C) 2015 Graeme Kennedy.
+  All rights reserved.
+
+  TMR is licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this software except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include "TMRMFilter.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "TMRRadixSort.h"
+#include "tacslapack.h"
+
+// The weight applied to the interpolation constraints in the
+// non-negative least-squares problem
+static const double TMR_MFILTER_CONSTRAINT_WEIGHT = 1e4;
+
+// The tolerance on the normalized coordinates used to identify
+// stencils with the same geometry
+static const double TMR_MFILTER_STENCIL_TOL = 1e-8;
+
+// The chunk size used when computing the stencils in parallel
+static const int TMR_MFILTER_CHUNK_SIZE = 16;
+
+/*
+  Work arrays for the non-negative least-squares problem. Each thread
+  allocates its own workspace.
+*/
+class TMRMFilterWork {
+ public:
+  TMRMFilterWork(int max_npts) {
+    int ncols = (max_npts > 1 ? max_npts - 1 : 1);
+    int mrows = 9 + ncols;
+    lwork = 4 * (mrows + ncols) + 64;
+
+    C = new double[mrows * ncols];
+    Cp = new double[mrows * ncols];
+    d = new double[mrows];
+    rhs = new double[mrows];
+    res = new double[mrows];
+    s = new double[ncols];
+    g = new double[ncols];
+    z = new double[ncols];
+    wp = new double[ncols];
+    work = new double[lwork];
+    passive = new int[ncols];
+  }
+  ~TMRMFilterWork() {
+    delete[] C;
+    delete[] Cp;
+    delete[] d;
+    delete[] rhs;
+    delete[] res;
+    delete[] s;
+    delete[] g;
+    delete[] z;
+    delete[] wp;
+    delete[] work;
+    delete[] passive;
+  }
+
+  int lwork;
+  double *C, *Cp, *d, *rhs, *res;
+  double *s, *g, *z, *wp, *work;
+  int *passive;
+};
+
+/*
+  Compute the local coordinates of the stencil points relative to the
+  diagonal point, normalized by the largest distance from the diagonal.
+
+  For interior stencils, the local coordinates are the first dim
+  coordinates of the points. For boundary stencils, the points are
+  projected onto the line (dim = 2) or plane (dim = 3) tangent to the
+  boundary with the unit normal n.
+
+  returns: the normalization factor delta
+*/
+static double computeLocalCoords(int dim, int npts, int diag,
+                                 const TacsScalar n[], const TacsScalar X[],
+                                 double Xt[]) {
+  const TacsScalar *X0 = &X[3 * diag];
+
+  int sdim = dim;
+  double t1[3] = {0.0, 0.0, 0.0}, t2[3] = {0.0, 0.0, 0.0};
+  if (n) {
+    sdim = dim - 1;
+    if (dim == 2) {
+      t1[0] = TacsRealPart(n[1]);
+      t1[1] = -TacsRealPart(n[0]);
+    } else {
+      // Pick the coordinate direction least aligned with the normal
+      double nr[3];
+      nr[0] = TacsRealPart(n[0]);
+      nr[1] = TacsRealPart(n[1]);
+      nr[2] = TacsRealPart(n[2]);
+      int index = 0;
+      if (fabs(nr[1]) < fabs(nr[index])) {
+        index = 1;
+      }
+      if (fabs(nr[2]) < fabs(nr[index])) {
+        index = 2;
+      }
+      double e[3] = {0.0, 0.0, 0.0};
+      e[index] = 1.0;
+
+      // Compute the in-plane directions t2 = e x n and t1 = n x t2
+      t2[0] = e[1] * nr[2] - e[2] * nr[1];
+      t2[1] = e[2] * nr[0] - e[0] * nr[2];
+      t2[2] = e[0] * nr[1] - e[1] * nr[0];
+      double inv = 1.0 / sqrt(t2[0] * t2[0] + t2[1] * t2[1] + t2[2] * t2[2]);
+      t2[0] *= inv;
+      t2[1] *= inv;
+      t2[2] *= inv;
+
+      t1[0] = nr[1] * t2[2] - nr[2] * t2[1];
+      t1[1] = nr[2] * t2[0] - nr[0] * t2[2];
+      t1[2] = nr[0] * t2[1] - nr[1] * t2[0];
+    }
+  }
+
+  double delta = 0.0;
+  for (int i = 0; i < npts; i++) {
+    double d[3];
+    d[0] = TacsRealPart(X[3 * i] - X0[0]);
+    d[1] = TacsRealPart(X[3 * i + 1] - X0[1]);
+    d[2] = TacsRealPart(X[3 * i + 2] - X0[2]);
+
+    if (n) {
+      Xt[sdim * i] = t1[0] * d[0] + t1[1] * d[1] + t1[2] * d[2];
+      if (sdim == 2) {
+        Xt[sdim * i + 1] = t2[0] * d[0] + t2[1] * d[1] + t2[2] * d[2];
+      }
+    } else {
+      for (int j = 0; j < sdim; j++) {
+        Xt[sdim * i + j] = d[j];
+      }
+    }
+
+    double dist = 0.0;
+    for (int j = 0; j < sdim; j++) {
+      dist += Xt[sdim * i + j] * Xt[sdim * i + j];
+    }
+    if (dist > delta) {
+      delta = dist;
+    }
+  }
+
+  delta = sqrt(delta);
+  if (delta > 0.0) {
+    double inv = 1.0 / delta;
+    for (int i = 0; i < sdim * npts; i++) {
+      Xt[i] *= inv;
+    }
+  }
+
+  return delta;
+}
+
+/*
+  Quantize a normalized coordinate for comparing stencils
+*/
+static inline int64_t quantizeCoord(double x) {
+  return (int64_t)floor(x / TMR_MFILTER_STENCIL_TOL + 0.5);
+}
+
+/*
+  Mix a value into a 64-bit hash
+*/
+static inline uint64_t mixHash(uint64_t h, uint64_t v) {
+  v *= 0xff51afd7ed558ccdULL;
+  v ^= v >> 33;
+  h ^= v + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+  return h;
+}
+
+/*
+  Compute the sort key for a stencil from its size, diagonal index
+  and quantized normalized coordinates
+*/
+static void computeStencilKey(int sdim, int npts, int diag, double delta,
+                              const double Xt[], TMRSortKey *key) {
+  uint64_t hi = 0xcbf29ce484222325ULL, lo = 0x84222325cbf29ce4ULL;
+  hi = mixHash(hi, npts);
+  lo = mixHash(lo, diag);
+  hi = mixHash(hi, delta > 0.0);
+  for (int i = 0; i < sdim * npts; i++) {
+    uint64_t q = quantizeCoord(Xt[i]);
+    hi = mixHash(hi, q);
+    lo = mixHash(lo, q ^ (uint64_t)i);
+  }
+  key->hi = hi;
+  key->lo = lo;
+}
+
+/*
+  Check whether two stencils have the same normalized geometry
+*/
+static int isSameStencil(int sdim, int npts1, int diag1, double delta1,
+                         const double Xt1[], int npts2, int diag2,
+                         double delta2, const double Xt2[]) {
+  if (npts1 != npts2 || diag1 != diag2 ||
+      (delta1 > 0.0) != (delta2 > 0.0)) {
+    return 0;
+  }
+  for (int i = 0; i < sdim * npts1; i++) {
+    if (quantizeCoord(Xt1[i]) != quantizeCoord(Xt2[i])) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/*
+  Compute the normalized weights for a stencil.
+
+  The weights w >= 0 are the solution of
+
+  min  0.5*||w||^2
+  s.t. A*w = b
+
+  where the rows of A are the first and second order Taylor series
+  terms of the normalized local coordinates and b contains the
+  coefficients r^2 of the Helmholtz operator. The problem is solved as
+  the non-negative least-squares problem
+
+  min ||[M*A; I]*w - [M*b; 0]||^2  s.t. w >= 0
+
+  with a large weight M on the constraints, using the active set
+  method of Lawson and Hanson. The weight of the diagonal point is
+  set to zero.
+
+  returns: non-zero on failure
+*/
+static int computeStencilWeights(int sdim, int npts, int diag,
+                                 const double Xt[], double r2,
+                                 TMRMFilterWork *work, double w[]) {
+  memset(w, 0, npts * sizeof(double));
+
+  int ncols = npts - 1;
+  if (ncols <= 0) {
+    return 0;
+  }
+
+  // The number of interpolation constraints
+  int neq = 2;
+  if (sdim == 2) {
+    neq = 5;
+  } else if (sdim == 3) {
+    neq = 9;
+  }
+  int mrows = neq + ncols;
+
+  // Form the weighted least-squares matrix C and right-hand side d
+  const double M = TMR_MFILTER_CONSTRAINT_WEIGHT;
+  double *C = work->C;
+  double *d = work->d;
+  memset(C, 0, mrows * ncols * sizeof(double));
+  memset(d, 0, mrows * sizeof(double));
+  for (int j = 0; j < sdim; j++) {
+    d[sdim + j] = M * r2;
+  }
+
+  for (int i = 0, col = 0; i < npts; i++) {
+    if (i == diag) {
+      continue;
+    }
+    double *c = &C[mrows * col];
+    const double *x = &Xt[sdim * i];
+    if (sdim == 1) {
+      c[0] = M * x[0];
+      c[1] = 0.5 * M * x[0] * x[0];
+    } else if (sdim == 2) {
+      c[0] = M * x[0];
+      c[1] = M * x[1];
+      c[2] = 0.5 * M * x[0] * x[0];
+      c[3] = 0.5 * M * x[1] * x[1];
+      c[4] = M * x[0] * x[1];
+    } else {
+      c[0] = M * x[0];
+      c[1] = M * x[1];
+      c[2] = M * x[2];
+      c[3] = 0.5 * M * x[0] * x[0];
+      c[4] = 0.5 * M * x[1] * x[1];
+      c[5] = 0.5 * M * x[2] * x[2];
+      c[6] = M * x[1] * x[2];
+      c[7] = M * x[0] * x[2];
+      c[8] = M * x[0] * x[1];
+    }
+    c[neq + col] = 1.0;
+    col++;
+  }
+
+  // The current non-negative solution and the passive set
+  double *wp = work->wp;
+  int *passive = work->passive;
+  memset(wp, 0, ncols * sizeof(double));
+  memset(passive, 0, ncols * sizeof(int));
+
+  double gtol = -1.0;
+  int max_iters = 3 * ncols;
+  for (int iter = 0; iter < max_iters; iter++) {
+    // Compute the residual res = d - C*wp and gradient g = C^T*res
+    double *res = work->res;
+    memcpy(res, d, mrows * sizeof(double));
+    for (int j = 0; j < ncols; j++) {
+      if (wp[j] != 0.0) {
+        for (int i = 0; i < mrows; i++) {
+          res[i] -= C[mrows * j + i] * wp[j];
+        }
+      }
+    }
+
+    double gmax = 0.0;
+    for (int j = 0; j < ncols; j++) {
+      work->g[j] = 0.0;
+      for (int i = 0; i < mrows; i++) {
+        work->g[j] += C[mrows * j + i] * res[i];
+      }
+      if (fabs(work->g[j]) > gmax) {
+        gmax = fabs(work->g[j]);
+      }
+    }
+    if (gtol < 0.0) {
+      gtol = 1e-12 * gmax;
+    }
+
+    // Find the active variable with the largest gradient
+    int t = -1;
+    double gt = gtol;
+    for (int j = 0; j < ncols; j++) {
+      if (!passive[j] && work->g[j] > gt) {
+        gt = work->g[j];
+        t = j;
+      }
+    }
+    if (t < 0) {
+      break;
+    }
+    passive[t] = 1;
+
+    for (int inner = 0; inner < max_iters; inner++) {
+      // Solve the unconstrained problem over the passive set
+      int np = 0;
+      for (int j = 0; j < ncols; j++) {
+        if (passive[j]) {
+          memcpy(&work->Cp[mrows * np], &C[mrows * j], mrows * sizeof(double));
+          np++;
+        }
+      }
+      if (np == 0) {
+        break;
+      }
+      memcpy(work->rhs, d, mrows * sizeof(double));
+
+      int nrhs = 1, rank, info;
+      double rcond = -1.0;
+      LAPACKdgelss(&mrows, &np, &nrhs, work->Cp, &mrows, work->rhs, &mrows,
+                   work->s, &rcond, &rank, work->work, &work->lwork, &info);
+      if (info != 0) {
+        return 1;
+      }
+
+      int feasible = 1;
+      for (int j = 0, k = 0; j < ncols; j++) {
+        work->z[j] = 0.0;
+        if (passive[j]) {
+          work->z[j] = work->rhs[k];
+          k++;
+          if (work->z[j] <= 0.0) {
+            feasible = 0;
+          }
+        }
+      }
+
+      if (feasible) {
+        memcpy(wp, work->z, ncols * sizeof(double));
+        break;
+      }
+
+      // Take the largest step towards z that remains feasible and
+      // drop the variables that reach zero from the passive set
+      double alpha = 1.0;
+      for (int j = 0; j < ncols; j++) {
+        if (passive[j] && work->z[j] <= 0.0) {
+          double a = wp[j] / (wp[j] - work->z[j]);
+          if (a < alpha) {
+            alpha = a;
+          }
+        }
+      }
+      for (int j = 0; j < ncols; j++) {
+        if (passive[j]) {
+          wp[j] += alpha * (work->z[j] - wp[j]);
+          if (wp[j] <= 1e-14) {
+            wp[j] = 0.0;
+            passive[j] = 0;
+          }
+        }
+      }
+    }
+  }
+
+  // Set the weights for all points other than the diagonal
+  for (int i = 0, col = 0; i < npts; i++) {
+    if (i != diag) {
+      w[i] = wp[col];
+      col++;
+    }
+  }
+
+  return 0;
+}
+
+/*
+  Create the M-filter
+*/
+TMRMFilter::TMRMFilter(int _N, int _nlevels, TACSAssembler *_assembler[],
+                       TMROctForest *_filter[], double _r)
+    : TMRHelmholtzPUFilter(_N, _nlevels, _assembler, _filter) {
+  r = _r;
+  dim = 3;
+}
+
+TMRMFilter::TMRMFilter(int _N, int _nlevels, TACSAssembler *_assembler[],
+                       TMRQuadForest *_filter[], double _r)
+    : TMRHelmholtzPUFilter(_N, _nlevels, _assembler, _filter) {
+  r = _r;
+  dim = 2;
+}
+
+/*
+  Compute the stencil at a single interior node
+*/
+int TMRMFilter::getInteriorStencil(int diagonal_index, int npts,
+                                   const TacsScalar Xpts[], double alpha[]) {
+  int ptr[2] = {0, npts};
+  return computeStencils(1, ptr, &diagonal_index, NULL, Xpts, alpha);
+}
+
+/*
+  Compute the stencil at a single boundary node
+*/
+int TMRMFilter::getBoundaryStencil(int diagonal_index, const TacsScalar n[],
+                                   int npts, const TacsScalar Xpts[],
+                                   double alpha[]) {
+  int ptr[2] = {0, npts};
+  return computeStencils(1, ptr, &diagonal_index, n, Xpts, alpha);
+}
+
+/*
+  Compute the stencils for all the interior nodes
+*/
+int TMRMFilter::getInteriorStencils(int num_nodes, const int ptr[],
+                                    const int diagonal_index[],
+                                    const TacsScalar Xpts[], double alpha[]) {
+  return computeStencils(num_nodes, ptr, diagonal_index, NULL, Xpts, alpha);
+}
+
+/*
+  Compute the stencils for all the boundary nodes
+*/
+int TMRMFilter::getBoundaryStencils(int num_nodes, const int ptr[],
+                                    const int diagonal_index[],
+                                    const TacsScalar n[],
+                                    const TacsScalar Xpts[], double alpha[]) {
+  return computeStencils(num_nodes, ptr, diagonal_index, n, Xpts, alpha);
+}
+
+/*
+  Compute the stencil weights for a set of nodes.
+
+  The local coordinates of each stencil are first computed and
+  normalized. Stencils with the same normalized geometry are grouped
+  by sorting a hash of the quantized coordinates, and the weights are
+  computed once for each group. The weights for each node are then
+  scaled by the size of its stencil.
+*/
+int TMRMFilter::computeStencils(int num_nodes, const int ptr[],
+                                const int diagonal_index[],
+                                const TacsScalar n[], const TacsScalar Xpts[],
+                                double alpha[]) {
+  if (num_nodes <= 0) {
+    return 0;
+  }
+
+  // The dimension of the local stencil coordinates
+  int sdim = (n ? dim - 1 : dim);
+  int size = ptr[num_nodes];
+
+  int max_npts = 0;
+  for (int k = 0; k < num_nodes; k++) {
+    if (ptr[k + 1] - ptr[k] > max_npts) {
+      max_npts = ptr[k + 1] - ptr[k];
+    }
+  }
+
+  // Compute the normalized local coordinates and key for each stencil
+  double *Xt = new double[sdim * size];
+  double *delta = new double[num_nodes];
+  TMRSortKey *keys = new TMRSortKey[2 * num_nodes];
+
+#ifdef TMR_HAS_OPENMP
+#pragma omp parallel for schedule(dynamic, 64)
+#endif  // TMR_HAS_OPENMP
+  for (int k = 0; k < num_nodes; k++) {
+    int npts = ptr[k + 1] - ptr[k];
+    double *xt = &Xt[sdim * ptr[k]];
+    delta[k] = computeLocalCoords(dim, npts, diagonal_index[k],
+                                  (n ? &n[3 * k] : NULL), &Xpts[3 * ptr[k]],
+                                  xt);
+    computeStencilKey(sdim, npts, diagonal_index[k], delta[k], xt, &keys[k]);
+    keys[k].index = k;
+  }
+
+  TMRSortKey *sorted = TMRRadixSortKeys(num_nodes, keys, &keys[num_nodes]);
+
+  // Find the stencil that will be computed for each node. Stencils
+  // with the same key are checked against the first stencil with that
+  // key in case of a hash collision.
+  int *rep = new int[num_nodes];
+  int *unique = new int[num_nodes];
+  int num_unique = 0;
+  for (int i = 0; i < num_nodes;) {
+    int first = sorted[i].index;
+    rep[first] = first;
+    unique[num_unique] = first;
+    num_unique++;
+
+    int j = i + 1;
+    for (; j < num_nodes && sorted[j].hi == sorted[i].hi &&
+           sorted[j].lo == sorted[i].lo;
+         j++) {
+      int k = sorted[j].index;
+      if (isSameStencil(sdim, ptr[first + 1] - ptr[first],
+                        diagonal_index[first], delta[first],
+                        &Xt[sdim * ptr[first]], ptr[k + 1] - ptr[k],
+                        diagonal_index[k], delta[k], &Xt[sdim * ptr[k]])) {
+        rep[k] = first;
+      } else {
+        rep[k] = k;
+        unique[num_unique] = k;
+        num_unique++;
+      }
+    }
+    i = j;
+  }
+  delete[] keys;
+
+  // Compute the normalized weights for each unique stencil
+  double *w = new double[size];
+  double r2 = r * r;
+  int nfail = 0;
+
+#ifdef TMR_HAS_OPENMP
+#pragma omp parallel reduction(+ : nfail)
+#endif  // TMR_HAS_OPENMP
+  {
+    TMRMFilterWork work(max_npts);
+
+#ifdef TMR_HAS_OPENMP
+#pragma omp for schedule(dynamic, TMR_MFILTER_CHUNK_SIZE)
+#endif  // TMR_HAS_OPENMP
+    for (int i = 0; i < num_unique; i++) {
+      int k = unique[i];
+      int npts = ptr[k + 1] - ptr[k];
+      if (delta[k] > 0.0) {
+        nfail += computeStencilWeights(sdim, npts, diagonal_index[k],
+                                       &Xt[sdim * ptr[k]], r2, &work,
+                                       &w[ptr[k]]);
+      } else {
+        memset(&w[ptr[k]], 0, npts * sizeof(double));
+      }
+    }
+  }
+
+  // Scale the weights by the size of each stencil
+#ifdef TMR_HAS_OPENMP
+#pragma omp parallel for
+#endif  // TMR_HAS_OPENMP
+  for (int k = 0; k < num_nodes; k++) {
+    int npts = ptr[k + 1] - ptr[k];
+    int diag = diagonal_index[k];
+    const double *wk = &w[ptr[rep[k]]];
+    double *ak = &alpha[ptr[k]];
+
+    double scale = 0.0;
+    if (delta[k] > 0.0) {
+      scale = 1.0 / (delta[k] * delta[k]);
+    }
+
+    double sum = 0.0;
+    for (int j = 0; j < npts; j++) {
+      ak[j] = scale * wk[j];
+      sum += ak[j];
+    }
+    ak[diag] = 1.0 + sum;
+  }
+
+  delete[] Xt;
+  delete[] delta;
+  delete[] rep;
+  delete[] unique;
+  delete[] w;
+
+  return (nfail > 0);
+}
@@ -0,0 +1,76 @@
+/*
+  This file is part of the package TMR for adaptive mesh refinement.
+
+  Copyright (C) 2015 Georgia Tech Research Corporation.
+  Additional copyright (C) 2015 Graeme Kennedy.
+  All rights reserved.
+
+  TMR is licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this software except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef TMR_M_FILTER_H
+#define TMR_M_FILTER_H
+
+#include "TMRHelmholtzPUFilter.h"
+
+/*
+  The M-filter: A Helmholtz partition of unity filter with
+  non-negative weights that approximate the Helmholtz PDE-based filter
+  with radius r.
+
+  The weights at each node are the minimum-norm, non-negative weights
+  that reproduce the first and second derivatives of the filter
+  stencil. The constrained least-squares problem is solved with a
+  non-negative least-squares method using the points of the stencil
+  normalized by the stencil size. Boundary stencils are projected onto
+  the plane (or line) tangent to the boundary.
+
+  Stencils with the same normalized geometry, such as those in
+  uniform regions of the mesh, are only computed once. The remaining
+  stencils are computed in parallel when TMR is built with OpenMP.
+*/
+class TMRMFilter : public TMRHelmholtzPUFilter {
+ public:
+  TMRMFilter(int _N, int _nlevels, TACSAssembler *_assembler[],
+             TMROctForest *_filter[], double _r);
+  TMRMFilter(int _N, int _nlevels, TACSAssembler *_assembler[],
+             TMRQuadForest *_filter[], double _r);
+
+  // Compute the stencil at an interior or boundary node
+  int getInteriorStencil(int diagonal_index, int npts, const TacsScalar Xpts[],
+                         double alpha[]);
+  int getBoundaryStencil(int diagonal_index, const TacsScalar n[], int npts,
+                         const TacsScalar Xpts[], double alpha[]);
+
+  // Compute the stencils for all interior or boundary nodes
+  int getInteriorStencils(int num_nodes, const int ptr[],
+                          const int diagonal_index[], const TacsScalar Xpts[],
+                          double alpha[]);
+  int getBoundaryStencils(int num_nodes, const int ptr[],
+                          const int diagonal_index[], const TacsScalar n[],
+                          const TacsScalar Xpts[], double alpha[]);
+
+ private:
+  // Compute the stencils with or without the boundary normals
+  int computeStencils(int num_nodes, const int ptr[],
+                      const int diagonal_index[], const TacsScalar n[],
+                      const TacsScalar Xpts[], double alpha[]);
+
+  // The filter radius
+  double r;
+
+  // The spatial dimension of the filter (2 or 3)
+  int dim;
+};
+
+#endif  // TMR_M_FILTER_H
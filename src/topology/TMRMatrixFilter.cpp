@@ -22,6 +22,7 @@
 
 #include "TMRMatrixCreator.h"
 #include "TMRMatrixFilterModel.h"
+#include "TMRTrace.h"
 #include "TMR_TACSCreator.h"
 
 /*
@@ -103,12 +104,20 @@ void TMRMatrixFilter::initialize_matrix(double _r, int _N,
   temp = assembler[0]->createDesignVec();
   temp->incref();
 
+  // Create the vector that stores the last design variables
+  xlast = assembler[0]->createDesignVec();
+  xlast->incref();
+
   // Assemble the mass matrix
   matrix_assembler->assembleJacobian(1.0, 0.0, 0.0, t2, M);
 
   // Free this version of TACS - it's not required anymore!
   matrix_assembler->decref();
 
+  // Create the operator that applies the Horner recurrence
+  horner = new TMRHornerOperator(assembler[0]->getMPIComm(), M);
+  horner->incref();
+
   // Set the number of terms in the M filter
   N = _N;
 
@@ -163,6 +172,11 @@ void TMRMatrixFilter::initialize_matrix(double _r, int _N,
     T++;
     ty++;
   }
+
+  // Keep the diagonal matrices on the device (if any)
+  horner->setDeviceVec(Ainv);
+  horner->setDeviceVec(B);
+  horner->setDeviceVec(Tinv);
 }
 
 /*
@@ -172,11 +186,13 @@ TMRMatrixFilter::~TMRMatrixFilter() {
   t1->decref();
   t2->decref();
   M->decref();
+  horner->decref();
   Ainv->decref();
   B->decref();
   y1->decref();
   y2->decref();
   temp->decref();
+  xlast->decref();
 }
 
 /*
@@ -189,49 +205,22 @@ TMRMatrixFilter::~TMRMatrixFilter() {
   .   out += t1 + B*M*out
 */
 void TMRMatrixFilter::applyFilter(TACSBVec *in, TACSBVec *out) {
-  // Compute t1 = Ainv*in
-  t1->copyValues(in);
-  kronecker(Ainv, t1);
-
-  // Set out = Ainv*in
-  out->copyValues(t1);
+  TMR_TRACE_SCOPE("TMRMatrixFilter::applyFilter");
 
-  // Apply Horner's method
-  for (int n = 0; n < N; n++) {
-    // Compute t2 = B*M*out
-    M->mult(out, t2);
-    kronecker(B, t2, out);
-
-    // Compute out = t1 + B*M*out
-    out->axpy(1.0, t1);
-  }
-
-  // Multiply by Tinv
-  kronecker(Tinv, out);
+  // Compute t1 = Ainv*in and out = t1, apply Horner's method:
+  // out = t1 + B*M*out and multiply by Tinv
+  horner->applyFilter(N, Ainv, NULL, B, Tinv, in, t1, t2, out);
 }
 
 /*
   Compute the transpose of the filter operation
 */
 void TMRMatrixFilter::applyTranspose(TACSBVec *in, TACSBVec *out) {
-  t1->copyValues(in);
-  kronecker(Tinv, t1);
-
-  // Copy the values from t1 to the out vector
-  out->copyValues(t1);
+  TMR_TRACE_SCOPE("TMRMatrixFilter::applyTranspose");
 
-  // Apply Horner's method
-  for (int n = 0; n < N; n++) {
-    // Compute M*B*out
-    kronecker(B, out, t2);
-    M->mult(t2, out);
-
-    // Compute out = t1 + M*B*out
-    out->axpy(1.0, t1);
-  }
-
-  // Multiply by Ainv
-  kronecker(Ainv, out);
+  // Compute t1 = Tinv*in and out = t1, apply Horner's method:
+  // out = t1 + M*B*out and multiply by Ainv
+  horner->applyFilter(N, Tinv, B, NULL, Ainv, in, t1, t2, out);
 }
 
 /*
@@ -270,6 +259,14 @@ void TMRMatrixFilter::kronecker(TACSBVec *c, TACSBVec *x, TACSBVec *y) {
   Set the design variables for each level
 */
 void TMRMatrixFilter::setDesignVars(TACSBVec *xvec) {
+  TMR_TRACE_SCOPE("TMRMatrixFilter::setDesignVars");
+
+  // Skip the filter if the design variables have not changed
+  if (!checkDesignVarsChanged(xvec, xlast)) {
+    return;
+  }
+  xlast->copyValues(xvec);
+
   const int vpn = assembler[0]->getDesignVarsPerNode();
 
   if (vpn == 1) {
@@ -323,6 +320,8 @@ void TMRMatrixFilter::setDesignVars(TACSBVec *xvec) {
   Add values to the output TACSBVec
 */
 void TMRMatrixFilter::addValues(TACSBVec *vec) {
+  TMR_TRACE_SCOPE("TMRMatrixFilter::addValues");
+
   vec->beginSetValues(TACS_ADD_VALUES);
   vec->endSetValues(TACS_ADD_VALUES);
 
@@ -22,6 +22,7 @@
 #define TMR_MATRIX_FILTER_H
 
 #include "TMRConformFilter.h"
+#include "TMRHornerOperator.h"
 
 /*
   The following class creates and stores approximate M-filters for
@@ -93,6 +94,9 @@ class TMRMatrixFilter : public TMRConformFilter {
   // The non-negative matrix M
   TACSMat *M;
 
+  // The operator that applies the Horner recurrence with M
+  TMRHornerOperator *horner;
+
   // The number of terms to include in the approximate inverse
   int N;
 
@@ -111,6 +115,9 @@ class TMRMatrixFilter : public TMRConformFilter {
   // Temporary design variable vector
   TACSBVec *temp;
 
+  // The design variables from the last call to setDesignVars
+  TACSBVec *xlast;
+
   // Compute the Kronecker product
   void kronecker(TACSBVec *c, TACSBVec *x, TACSBVec *y = NULL);
 };
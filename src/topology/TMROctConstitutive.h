@@ -29,8 +29,8 @@
 #include "TACSMaterialProperties.h"
 #include "TACSSolidConstitutive.h"
 #include "TMROctForest.h"
-
-enum TMRTopoPenaltyType { TMR_RAMP_PENALTY, TMR_SIMP_PENALTY };
+#include "TMRTopoPenalty.h"
+#include "TMRWeightPool.h"
 
 /*
   The TMRStiffnessProperties class
@@ -63,6 +63,9 @@ class TMRStiffnessProperties : public TMREntity {
   int use_project;    // Flag to indicate if projection should be used (0, 1)
 
   TACSMaterialProperties **getMaterialProperties() { return props; }
+
+  // Get the parameters for the penalization of the stiffness
+  void getStiffnessPenalty(TMRStiffnessPenalty *pen);
 };
 
 /*
@@ -75,6 +78,7 @@ class TMRStiffnessProperties : public TMREntity {
 class TMROctConstitutive : public TACSSolidConstitutive {
  public:
   TMROctConstitutive(TMRStiffnessProperties *_props, TMROctForest *_forest);
+  TMROctConstitutive(TMRStiffnessProperties *_props, TMRWeightPool *_pool);
   ~TMROctConstitutive();
 
   // Return the stiffness properties
@@ -190,16 +194,64 @@ class TMROctConstitutive : public TACSSolidConstitutive {
   // Extra info about the constitutive class
   const char *getObjectName();
 
+  // Get the stiffness of each material, packed as in TMRTopoPenalty.h
+  void getMaterialStiffness(TacsScalar C[]);
+
+  // Evaluate the design shape functions at a table of points. The block
+  // functions that use the table require an object created with a forest.
+  void evalShapeFunctionTable(int npts, const double pts[], double N[]);
+
+  // Interpolate the densities at the points of a block of elements
+  void packDensities(int nelems, const int elems[], int npts, const double N[],
+                     TacsScalar rho[]);
+
+  // Evaluate the stiffness and the stress from the packed densities. The
+  // block functions only write to their output arrays, so they may be
+  // called concurrently for different blocks.
+  void evalTangentStiffnessBlock(int n, const TacsScalar rho[],
+                                 TacsScalar C[]);
+  void evalStressBlock(int n, const TacsScalar rho[], const TacsScalar e[],
+                       TacsScalar s[]);
+
+  // Add the derivative of the stress for a block of elements
+  void addStressDVSensBlock(int nelems, int npts, const double N[],
+                            const TacsScalar rho[], const TacsScalar scale[],
+                            const TacsScalar e[], const TacsScalar psi[],
+                            TacsScalar dfdx[]);
+
  private:
+  // Set the properties and allocate the design variables
+  void initialize(TMRStiffnessProperties *_props, int num_elements);
+
   // The stiffness properties
   TMRStiffnessProperties *props;
+
+  // The design node connectivity from either the forest or the pool of
+  // filter weights. Only one of these is non-NULL.
   TMROctForest *forest;
+  TMRWeightPool *pool;
 
   // Information about the design variable values
   int nmats, nvars;
-  TacsScalar *x;           // All the design variable values
-  double *N;               // Space for the shape functions
-  TacsScalar *temp_array;  // Temporary array
+  int len;                    // The number of design nodes per element
+  TacsScalar *x;              // All the design variable values
+  double *Nwork;              // Space for the shape functions
+  TacsScalar *temp_array;     // Temporary array
+  TacsScalar *density_array;  // Material densities and their derivatives
+
+  // Evaluate the shape functions, using the cache when possible
+  const double *evalShapeFunctions(int elemIndex, const double pt[]);
+
+  // Interpolate the density of each material and add the transpose
+  void interpDensities(int elemIndex, const double N[], TacsScalar rho[]);
+  void addInterpDensitiesTranspose(const double N[], const TacsScalar drho[],
+                                   TacsScalar dfdx[]);
+
+  // The shape functions at previously evaluated quadrature points
+  static const int MAX_CACHED_POINTS = 128;
+  int num_cached_pts, last_cached_pt;
+  double *cached_pts;  // The cached parametric points
+  double *cached_N;    // The shape functions at each cached point
 };
 
 #endif  // TMR_OCTANT_STIFFNESS_H
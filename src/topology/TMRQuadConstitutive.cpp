@@ -27,28 +27,67 @@
 TMRQuadConstitutive::TMRQuadConstitutive(TMRStiffnessProperties *_props,
                                          TMRQuadForest *_forest)
     : TACSPlaneStressConstitutive(NULL) {
+  forest = _forest;
+  forest->incref();
+  pool = NULL;
+
+  // Get the connectivity information
+  int num_elements;
+  const int order = forest->getMeshOrder();
+  forest->getNodeConn(NULL, &num_elements);
+  len = order * order;
+
+  initialize(_props, num_elements);
+}
+
+/*
+  Create the stiffness object based on the pool of filter weights
+
+  The design variables of each element are the design nodes in the
+  pool and the density is the weighted sum of the nodal values. The
+  weights are looked up by element index, so a single object may be
+  shared by all of the elements created from the pool.
+*/
+TMRQuadConstitutive::TMRQuadConstitutive(TMRStiffnessProperties *_props,
+                                         TMRWeightPool *_pool)
+    : TACSPlaneStressConstitutive(NULL) {
+  forest = NULL;
+  pool = _pool;
+  pool->incref();
+
+  // Each element has the same number of design nodes
+  len = pool->getNumWeights();
+
+  initialize(_props, pool->getNumElements());
+}
+
+/*
+  Allocate the design variables and the temporary arrays for the given
+  number of elements
+*/
+void TMRQuadConstitutive::initialize(TMRStiffnessProperties *_props,
+                                     int num_elements) {
   // Record the density, Poisson ratio, D and the shear modulus
   props = _props;
   props->incref();
 
-  forest = _forest;
-  forest->incref();
-
   nmats = props->nmats;
   nvars = 1;
   if (nmats >= 2) {
     nvars += nmats;
   }
-
-  // Get the connectivity information
-  int num_elements;
-  const int order = forest->getMeshOrder();
-  forest->getNodeConn(NULL, &num_elements);
-  int nconn = order * order * num_elements;
+  int nconn = len * num_elements;
 
   // Allocate space for the shape functions
-  N = new double[order * order];
+  Nwork = new double[len];
+
+  // Allocate space for the cached shape functions
+  num_cached_pts = 0;
+  last_cached_pt = 0;
+  cached_pts = new double[2 * MAX_CACHED_POINTS];
+  cached_N = new double[len * MAX_CACHED_POINTS];
   temp_array = new TacsScalar[2 * nmats];
+  density_array = new TacsScalar[2 * nmats];
 
   // Initialize the design vector
   x = new TacsScalar[nvars * nconn];
@@ -72,10 +111,120 @@ TMRQuadConstitutive::TMRQuadConstitutive(TMRStiffnessProperties *_props,
 */
 TMRQuadConstitutive::~TMRQuadConstitutive() {
   props->decref();
-  forest->decref();
+  if (forest) {
+    forest->decref();
+  }
+  if (pool) {
+    pool->decref();
+  }
   delete[] x;
-  delete[] N;
+  delete[] Nwork;
+  delete[] cached_pts;
+  delete[] cached_N;
   delete[] temp_array;
+  delete[] density_array;
+}
+
+/*
+  Evaluate the shape functions for the design variables at the given
+  parametric point
+
+  The same quadrature points are used for every element, so the shape
+  functions are cached for each distinct point. The points are usually
+  visited in the same sequence within each element, so the search
+  starts from the point after the last one that was found. Points that
+  do not fit in the cache are evaluated directly.
+
+  Objects created from a pool of filter weights return the weights of
+  the element, since the density is constant within each element.
+*/
+const double *TMRQuadConstitutive::evalShapeFunctions(int elemIndex,
+                                                      const double pt[]) {
+  // The weights from the pool do not depend on the point
+  if (pool) {
+    const double *weights;
+    pool->getElementWeights(elemIndex, NULL, &weights);
+    return weights;
+  }
+
+  // Search the cached points starting with the next expected point
+  for (int k = 0; k < num_cached_pts; k++) {
+    int index = last_cached_pt + 1 + k;
+    if (index >= num_cached_pts) {
+      index -= num_cached_pts;
+    }
+    const double *p = &cached_pts[2 * index];
+    if (pt[0] == p[0] && pt[1] == p[1]) {
+      last_cached_pt = index;
+      return &cached_N[len * index];
+    }
+  }
+
+  // Add the point to the cache if there is space
+  if (num_cached_pts < MAX_CACHED_POINTS) {
+    int index = num_cached_pts;
+    cached_pts[2 * index + 0] = pt[0];
+    cached_pts[2 * index + 1] = pt[1];
+    forest->evalInterp(pt, &cached_N[len * index]);
+    num_cached_pts++;
+    last_cached_pt = index;
+    return &cached_N[len * index];
+  }
+
+  forest->evalInterp(pt, Nwork);
+  return Nwork;
+}
+
+/*
+  Interpolate the design densities for each material at a point
+
+  The densities are the product of the matrix of nodal design
+  variables for the element with the shape functions N. The design
+  variables for each node are stored contiguously, so the product is
+  computed with a single pass over the nodes.
+*/
+void TMRQuadConstitutive::interpDensities(int elemIndex, const double N[],
+                                          TacsScalar rho[]) {
+  const TacsScalar *xptr = &x[nvars * len * elemIndex];
+
+  if (nvars == 1) {
+    TacsScalar r = 0.0;
+    for (int i = 0; i < len; i++) {
+      r += N[i] * xptr[i];
+    }
+    rho[0] = r;
+  } else {
+    for (int j = 0; j < nmats; j++) {
+      rho[j] = 0.0;
+    }
+    for (int i = 0; i < len; i++, xptr += nvars) {
+      for (int j = 0; j < nmats; j++) {
+        rho[j] += N[i] * xptr[j + 1];
+      }
+    }
+  }
+}
+
+/*
+  Add the transpose of the density interpolation to the derivative
+
+  Given the derivatives drho of a function with respect to the
+  density of each material, add the derivative with respect to the
+  nodal design variables to dfdx.
+*/
+void TMRQuadConstitutive::addInterpDensitiesTranspose(
+    const double N[], const TacsScalar drho[], TacsScalar dfdx[]) {
+  if (nvars == 1) {
+    for (int i = 0; i < len; i++) {
+      dfdx[i] += N[i] * drho[0];
+    }
+  } else {
+    for (int i = 0; i < len; i++, dfdx += nvars) {
+      for (int j = 0; j < nmats; j++) {
+        dfdx[j + 1] += N[i] * drho[j];
+      }
+    }
+  }
 }
 
 /*
@@ -83,12 +232,14 @@ TMRQuadConstitutive::~TMRQuadConstitutive() {
 */
 int TMRQuadConstitutive::getDesignVarNums(int elemIndex, int dvLen,
                                           int dvNums[]) {
-  const int order = forest->getMeshOrder();
-  const int len = order * order;
   if (dvNums) {
     const int *conn;
-    forest->getNodeConn(&conn);
-    conn = &conn[len * elemIndex];
+    if (pool) {
+      pool->getElementWeights(elemIndex, &conn, NULL);
+    } else {
+      forest->getNodeConn(&conn);
+      conn = &conn[len * elemIndex];
+    }
     for (int i = 0; (i < len && i < dvLen); i++) {
       dvNums[i] = conn[i];
     }
@@ -102,9 +253,6 @@ int TMRQuadConstitutive::getDesignVarNums(int elemIndex, int dvLen,
 */
 int TMRQuadConstitutive::setDesignVars(int elemIndex, int dvLen,
                                        const TacsScalar dvs[]) {
-  const int order = forest->getMeshOrder();
-  const int len = order * order;
-
   TacsScalar *xptr = &x[nvars * len * elemIndex];
   for (int i = 0; i < nvars * len; i++) {
     xptr[i] = dvs[i];
@@ -121,9 +269,6 @@ int TMRQuadConstitutive::setDesignVars(int elemIndex, int dvLen,
 */
 int TMRQuadConstitutive::getDesignVars(int elemIndex, int dvLen,
                                        TacsScalar dvs[]) {
-  const int order = forest->getMeshOrder();
-  const int len = order * order;
-
   const TacsScalar *xptr = &x[nvars * len * elemIndex];
   for (int i = 0; i < nvars * len; i++) {
     dvs[i] = xptr[i];
@@ -137,9 +282,6 @@ int TMRQuadConstitutive::getDesignVars(int elemIndex, int dvLen,
 */
 int TMRQuadConstitutive::getDesignVarRange(int elemIndex, int dvLen,
                                            TacsScalar lb[], TacsScalar ub[]) {
-  const int order = forest->getMeshOrder();
-  const int len = order * order;
-
   double lower = 0.0;
   if (props->penalty_type == TMR_SIMP_PENALTY) {
     lower = 1e-3;
@@ -166,33 +308,17 @@ int TMRQuadConstitutive::getDesignVarRange(int elemIndex, int dvLen,
 */
 TacsScalar TMRQuadConstitutive::evalDensity(int elemIndex, const double pt[],
                                             const TacsScalar X[]) {
-  const int order = forest->getMeshOrder();
-  const int len = order * order;
-
   // Evaluate the shape functions
-  forest->evalInterp(pt, N);
+  const double *N = evalShapeFunctions(elemIndex, pt);
 
-  // Get the design variable values
-  const TacsScalar *xptr = &x[nvars * len * elemIndex];
+  // Interpolate the density of each material
+  TacsScalar *rho = &density_array[0];
+  interpDensities(elemIndex, N, rho);
 
   // Evaluate the density
   TacsScalar density = 0.0;
-  if (nvars == 1) {
-    TacsScalar rho = 0.0;
-    for (int i = 0; i < len; i++) {
-      rho += N[i] * xptr[i];
-    }
-
-    density = rho * props->props[0]->getDensity();
-  } else {
-    for (int j = 0; j < nmats; j++) {
-      TacsScalar rho = 0.0;
-      for (int i = 0; i < len; i++) {
-        rho += N[i] * xptr[nvars * i + j + 1];
-      }
-
-      density += rho * props->props[j]->getDensity();
-    }
+  for (int j = 0; j < nmats; j++) {
+    density += rho[j] * props->props[j]->getDensity();
   }
 
   return density;
@@ -204,29 +330,15 @@ void TMRQuadConstitutive::addDensityDVSens(int elemIndex,
                                            const double pt[],
                                            const TacsScalar X[], int dvLen,
                                            TacsScalar dfdx[]) {
-  const int order = forest->getMeshOrder();
-  const int len = order * order;
-
   // Evaluate the shape functions
-  forest->evalInterp(pt, N);
+  const double *N = evalShapeFunctions(elemIndex, pt);
 
   // Add the derivative of the density
-  if (nvars == 1) {
-    TacsScalar density = props->props[0]->getDensity();
-    TacsScalar factor = density * scale;
-
-    for (int i = 0; i < len; i++) {
-      dfdx[i] += factor * N[i];
-    }
-  } else {
-    for (int j = 0; j < nmats; j++) {
-      TacsScalar density = props->props[j]->getDensity();
-      TacsScalar factor = density * scale;
-      for (int i = 0; i < len; i++) {
-        dfdx[nvars * i + j + 1] += factor * N[i];
-      }
-    }
+  TacsScalar *drho = &density_array[nmats];
+  for (int j = 0; j < nmats; j++) {
+    drho[j] = scale * props->props[j]->getDensity();
   }
+  addInterpDensitiesTranspose(N, drho, dfdx);
 }
 
 /*
@@ -236,14 +348,12 @@ void TMRQuadConstitutive::addDensityDVSens(int elemIndex,
 TacsScalar TMRQuadConstitutive::evalMassMatrixDensity(int elemIndex,
                                                       const double pt[],
                                                       const TacsScalar X[]) {
-  const int order = forest->getMeshOrder();
-  const int len = order * order;
   const double q = props->mass_penalty_value;
   const double beta = props->beta;
   const double xoffset = props->xoffset;
 
   // Evaluate the shape functions
-  forest->evalInterp(pt, N);
+  const double *N = evalShapeFunctions(elemIndex, pt);
 
   // Get the design variable values
   const TacsScalar *xptr = &x[nvars * len * elemIndex];
@@ -288,14 +398,12 @@ TacsScalar TMRQuadConstitutive::evalMassMatrixDensity(int elemIndex,
 void TMRQuadConstitutive::addMassMatrixDensityDVSens(
     int elemIndex, const TacsScalar scale, const double pt[],
     const TacsScalar X[], int dvLen, TacsScalar dfdx[]) {
-  const int order = forest->getMeshOrder();
-  const int len = order * order;
   const double q = props->mass_penalty_value;
   const double beta = props->beta;
   const double xoffset = props->xoffset;
 
   // Evaluate the shape functions
-  forest->evalInterp(pt, N);
+  const double *N = evalShapeFunctions(elemIndex, pt);
 
   // Add the derivative of the density
   if (nvars == 1) {
@@ -359,11 +467,8 @@ void TMRQuadConstitutive::addMassMatrixDensityDVSens(
 TacsScalar TMRQuadConstitutive::evalSpecificHeat(int elemIndex,
                                                  const double pt[],
                                                  const TacsScalar X[]) {
-  const int order = forest->getMeshOrder();
-  const int len = order * order;
-
   // Evaluate the shape functions
-  forest->evalInterp(pt, N);
+  const double *N = evalShapeFunctions(elemIndex, pt);
 
   // Get the design variable values
   const TacsScalar *xptr = &x[nvars * len * elemIndex];
@@ -399,11 +504,8 @@ void TMRQuadConstitutive::addSpecificHeatDVSens(int elemIndex,
                                                 const double pt[],
                                                 const TacsScalar X[], int dvLen,
                                                 TacsScalar dfdx[]) {
-  const int order = forest->getMeshOrder();
-  const int len = order * order;
-
   // Evaluate the shape functions
-  forest->evalInterp(pt, N);
+  const double *N = evalShapeFunctions(elemIndex, pt);
 
   // Add the derivative of the density
   if (nvars == 1) {
@@ -440,8 +542,6 @@ void TMRQuadConstitutive::evalStress(int elemIndex, const double pt[],
 void TMRQuadConstitutive::evalTangentStiffness(int elemIndex, const double pt[],
                                                const TacsScalar X[],
                                                TacsScalar C[]) {
-  const int order = forest->getMeshOrder();
-  const int len = order * order;
   const double q = props->stiffness_penalty_value;
   const double k0 = props->stiffness_offset;
   const double beta = props->beta;
@@ -450,23 +550,15 @@ void TMRQuadConstitutive::evalTangentStiffness(int elemIndex, const double pt[],
   memset(C, 0, 6 * sizeof(TacsScalar));
 
   // Evaluate the shape functions
-  forest->evalInterp(pt, N);
+  const double *N = evalShapeFunctions(elemIndex, pt);
 
-  // Get the design variable values
-  const TacsScalar *xptr = &x[nvars * len * elemIndex];
+  // Interpolate the density of each material
+  TacsScalar *rho_mats = &density_array[0];
+  interpDensities(elemIndex, N, rho_mats);
 
   // Add the derivative of the density
   for (int j = 0; j < nmats; j++) {
-    TacsScalar rho = 0.0;
-    if (nvars == 1) {
-      for (int i = 0; i < len; i++) {
-        rho += N[i] * xptr[i];
-      }
-    } else {
-      for (int i = 0; i < len; i++) {
-        rho += N[i] * xptr[nvars * i + j + 1];
-      }
-    }
+    TacsScalar rho = rho_mats[j];
 
     // Use projection
     if (props->use_project) {
@@ -502,30 +594,21 @@ void TMRQuadConstitutive::addStressDVSens(int elemIndex, TacsScalar scale,
                                           const TacsScalar e[],
                                           const TacsScalar psi[], int dvLen,
                                           TacsScalar dfdx[]) {
-  const int order = forest->getMeshOrder();
-  const int len = order * order;
   const double q = props->stiffness_penalty_value;
   const double beta = props->beta;
   const double xoffset = props->xoffset;
 
   // Evaluate the shape functions
-  forest->evalInterp(pt, N);
+  const double *N = evalShapeFunctions(elemIndex, pt);
 
-  // Get the design variable values
-  const TacsScalar *xptr = &x[nvars * len * elemIndex];
+  // Interpolate the density of each material
+  TacsScalar *rho_mats = &density_array[0];
+  TacsScalar *drho = &density_array[nmats];
+  interpDensities(elemIndex, N, rho_mats);
 
   // Add the derivative of the density
   for (int j = 0; j < nmats; j++) {
-    TacsScalar rho = 0.0;
-    if (nvars == 1) {
-      for (int i = 0; i < len; i++) {
-        rho += N[i] * xptr[i];
-      }
-    } else {
-      for (int i = 0; i < len; i++) {
-        rho += N[i] * xptr[nvars * i + j + 1];
-      }
-    }
+    TacsScalar rho = rho_mats[j];
 
     // The derivative of the penalty value w.r.t. the density
     TacsScalar dpenalty = 0.0;
@@ -573,16 +656,11 @@ void TMRQuadConstitutive::addStressDVSens(int elemIndex, TacsScalar scale,
     TacsScalar product =
         scale * dpenalty * (s[0] * psi[0] + s[1] * psi[1] + s[2] * psi[2]);
 
-    if (nvars == 1) {
-      for (int i = 0; i < len; i++) {
-        dfdx[i] += N[i] * product;
-      }
-    } else {
-      for (int i = 0; i < len; i++) {
-        dfdx[nvars * i + j + 1] += N[i] * product;
-      }
-    }
+    drho[j] = product;
   }
+
+  // Add the contributions to each of the design variables
+  addInterpDensitiesTranspose(N, drho, dfdx);
 }
 
 /*
@@ -592,8 +670,6 @@ void TMRQuadConstitutive::evalGeometricTangentStiffness(int elemIndex,
                                                         const double pt[],
                                                         const TacsScalar X[],
                                                         TacsScalar C[]) {
-  const int order = forest->getMeshOrder();
-  const int len = order * order;
   const double q = props->stiffness_penalty_value + 1.0;
   const double beta = props->beta;
   const double xoffset = props->xoffset;
@@ -601,23 +677,15 @@ void TMRQuadConstitutive::evalGeometricTangentStiffness(int elemIndex,
   memset(C, 0, 6 * sizeof(TacsScalar));
 
   // Evaluate the shape functions
-  forest->evalInterp(pt, N);
+  const double *N = evalShapeFunctions(elemIndex, pt);
 
-  // Get the design variable values
-  const TacsScalar *xptr = &x[nvars * len * elemIndex];
+  // Interpolate the density of each material
+  TacsScalar *rho_mats = &density_array[0];
+  interpDensities(elemIndex, N, rho_mats);
 
   // Add the derivative of the density
   for (int j = 0; j < nmats; j++) {
-    TacsScalar rho = 0.0;
-    if (nvars == 1) {
-      for (int i = 0; i < len; i++) {
-        rho += N[i] * xptr[i];
-      }
-    } else {
-      for (int i = 0; i < len; i++) {
-        rho += N[i] * xptr[nvars * i + j + 1];
-      }
-    }
+    TacsScalar rho = rho_mats[j];
 
     // Use projection
     if (props->use_project) {
@@ -651,30 +719,21 @@ void TMRQuadConstitutive::addGeometricTangentStressDVSens(
     int elemIndex, TacsScalar scale, const double pt[], const TacsScalar X[],
     const TacsScalar e[], const TacsScalar psi[], int dvLen,
     TacsScalar dfdx[]) {
-  const int order = forest->getMeshOrder();
-  const int len = order * order;
   const double q = props->stiffness_penalty_value + 1.0;
   const double beta = props->beta;
   const double xoffset = props->xoffset;
 
   // Evaluate the shape functions
-  forest->evalInterp(pt, N);
+  const double *N = evalShapeFunctions(elemIndex, pt);
 
-  // Get the design variable values
-  const TacsScalar *xptr = &x[nvars * len * elemIndex];
+  // Interpolate the density of each material
+  TacsScalar *rho_mats = &density_array[0];
+  TacsScalar *drho = &density_array[nmats];
+  interpDensities(elemIndex, N, rho_mats);
 
   // Add the derivative of the density
   for (int j = 0; j < nmats; j++) {
-    TacsScalar rho = 0.0;
-    if (nvars == 1) {
-      for (int i = 0; i < len; i++) {
-        rho += N[i] * xptr[i];
-      }
-    } else {
-      for (int i = 0; i < len; i++) {
-        rho += N[i] * xptr[nvars * i + j + 1];
-      }
-    }
+    TacsScalar rho = rho_mats[j];
 
     TacsScalar dpenalty = 0.0;
 
@@ -721,27 +780,19 @@ void TMRQuadConstitutive::addGeometricTangentStressDVSens(
     TacsScalar product =
         scale * dpenalty * (s[0] * psi[0] + s[1] * psi[1] + s[2] * psi[2]);
 
-    if (nvars == 1) {
-      for (int i = 0; i < len; i++) {
-        dfdx[i] += N[i] * product;
-      }
-    } else {
-      for (int i = 0; i < len; i++) {
-        dfdx[nvars * i + j + 1] += N[i] * product;
-      }
-    }
+    drho[j] = product;
   }
+
+  // Add the contributions to each of the design variables
+  addInterpDensitiesTranspose(N, drho, dfdx);
 }
 
 // Evaluate the thermal strain
 void TMRQuadConstitutive::evalThermalStrain(int elemIndex, const double pt[],
                                             const TacsScalar X[],
                                             TacsScalar theta, TacsScalar e[]) {
-  const int order = forest->getMeshOrder();
-  const int len = order * order;
-
   // Evaluate the shape functions
-  forest->evalInterp(pt, N);
+  const double *N = evalShapeFunctions(elemIndex, pt);
 
   // Get the design variable values
   const TacsScalar *xptr = &x[nvars * len * elemIndex];
@@ -773,44 +824,21 @@ void TMRQuadConstitutive::evalThermalStrain(int elemIndex, const double pt[],
 void TMRQuadConstitutive::addThermalStrainDVSens(
     int elemIndex, const double pt[], const TacsScalar X[], TacsScalar theta,
     const TacsScalar psi[], int dvLen, TacsScalar dfdx[]) {
-  const int order = forest->getMeshOrder();
-  const int len = order * order;
-
   // Evaluate the shape functions
-  forest->evalInterp(pt, N);
+  const double *N = evalShapeFunctions(elemIndex, pt);
 
-  // Get the design variable values
-  const TacsScalar *xptr = &x[nvars * len * elemIndex];
-
-  // Add the derivative of the density
+  // Add the derivative of the thermal strain
+  TacsScalar *drho = &density_array[nmats];
   for (int j = 0; j < nmats; j++) {
-    TacsScalar rho = 0.0;
-    if (nvars == 1) {
-      for (int i = 0; i < len; i++) {
-        rho += N[i] * xptr[i];
-      }
-    } else {
-      for (int i = 0; i < len; i++) {
-        rho += N[i] * xptr[nvars * i + j + 1];
-      }
-    }
-
     TacsScalar et[3];
     props->props[j]->evalThermalStrain2D(et);
 
     TacsScalar product =
         theta * (et[0] * psi[0] + et[1] * psi[1] + et[2] * psi[2]);
 
-    if (nvars == 1) {
-      for (int i = 0; i < len; i++) {
-        dfdx[i] += product * N[i];
-      }
-    } else {
-      for (int i = 0; i < len; i++) {
-        dfdx[nvars * i + j + 1] += product * N[i];
-      }
-    }
+    drho[j] = product;
   }
+  addInterpDensitiesTranspose(N, drho, dfdx);
 }
 
 // Evaluate the heat flux, given the thermal gradient
@@ -828,8 +856,6 @@ void TMRQuadConstitutive::evalHeatFlux(int elemIndex, const double pt[],
 void TMRQuadConstitutive::evalTangentHeatFlux(int elemIndex, const double pt[],
                                               const TacsScalar X[],
                                               TacsScalar C[]) {
-  const int order = forest->getMeshOrder();
-  const int len = order * order;
   const double qcond = props->conduction_penalty_value;
   const double beta = props->beta;
   const double xoffset = props->xoffset;
@@ -837,23 +863,15 @@ void TMRQuadConstitutive::evalTangentHeatFlux(int elemIndex, const double pt[],
   memset(C, 0, 3 * sizeof(TacsScalar));
 
   // Evaluate the shape functions
-  forest->evalInterp(pt, N);
+  const double *N = evalShapeFunctions(elemIndex, pt);
 
-  // Get the design variable values
-  const TacsScalar *xptr = &x[nvars * len * elemIndex];
+  // Interpolate the density of each material
+  TacsScalar *rho_mats = &density_array[0];
+  interpDensities(elemIndex, N, rho_mats);
 
   // Add the derivative of the density
   for (int j = 0; j < nmats; j++) {
-    TacsScalar rho = 0.0;
-    if (nvars == 1) {
-      for (int i = 0; i < len; i++) {
-        rho += N[i] * xptr[i];
-      }
-    } else {
-      for (int i = 0; i < len; i++) {
-        rho += N[i] * xptr[nvars * i + j + 1];
-      }
-    }
+    TacsScalar rho = rho_mats[j];
 
     // Use projection
     if (props->use_project) {
@@ -886,30 +904,21 @@ void TMRQuadConstitutive::addHeatFluxDVSens(int elemIndex, TacsScalar scale,
                                             const TacsScalar grad[],
                                             const TacsScalar psi[], int dvLen,
                                             TacsScalar dfdx[]) {
-  const int order = forest->getMeshOrder();
-  const int len = order * order;
   const double qcond = props->conduction_penalty_value;
   const double beta = props->beta;
   const double xoffset = props->xoffset;
 
   // Evaluate the shape functions
-  forest->evalInterp(pt, N);
+  const double *N = evalShapeFunctions(elemIndex, pt);
 
-  // Get the design variable values
-  const TacsScalar *xptr = &x[nvars * len * elemIndex];
+  // Interpolate the density of each material
+  TacsScalar *rho_mats = &density_array[0];
+  TacsScalar *drho = &density_array[nmats];
+  interpDensities(elemIndex, N, rho_mats);
 
   // Add the derivative of the density
   for (int j = 0; j < nmats; j++) {
-    TacsScalar rho = 0.0;
-    if (nvars == 1) {
-      for (int i = 0; i < len; i++) {
-        rho += N[i] * xptr[i];
-      }
-    } else {
-      for (int i = 0; i < len; i++) {
-        rho += N[i] * xptr[nvars * i + j + 1];
-      }
-    }
+    TacsScalar rho = rho_mats[j];
 
     // The derivative of the penalty value w.r.t. the density
     TacsScalar dpenalty = 0.0;
@@ -955,30 +964,23 @@ void TMRQuadConstitutive::addHeatFluxDVSens(int elemIndex, TacsScalar scale,
     TacsScalar product =
         scale * dpenalty * (flux[0] * psi[0] + flux[1] * psi[1]);
 
-    if (nvars == 1) {
-      for (int i = 0; i < len; i++) {
-        dfdx[i] += N[i] * product;
-      }
-    } else {
-      for (int i = 0; i < len; i++) {
-        dfdx[nvars * i + j + 1] += N[i] * product;
-      }
-    }
+    drho[j] = product;
   }
+
+  // Add the contributions to each of the design variables
+  addInterpDensitiesTranspose(N, drho, dfdx);
 }
 
 // Evaluate the failure criteria
 TacsScalar TMRQuadConstitutive::evalFailure(int elemIndex, const double pt[],
                                             const TacsScalar X[],
                                             const TacsScalar e[]) {
-  const int order = forest->getMeshOrder();
-  const int len = order * order;
   const double eps = props->stress_relax_value;
   const double beta = props->beta;
   const double xoffset = props->xoffset;
 
   // Evaluate the shape functions
-  forest->evalInterp(pt, N);
+  const double *N = evalShapeFunctions(elemIndex, pt);
 
   // Get the design variable values
   const TacsScalar *xptr = &x[nvars * len * elemIndex];
@@ -1059,14 +1061,12 @@ void TMRQuadConstitutive::addFailureDVSens(int elemIndex, TacsScalar scale,
                                            const TacsScalar X[],
                                            const TacsScalar e[], int dvLen,
                                            TacsScalar dfdx[]) {
-  const int order = forest->getMeshOrder();
-  const int len = order * order;
   const double eps = props->stress_relax_value;
   const double beta = props->beta;
   const double xoffset = props->xoffset;
 
   // Evaluate the shape functions
-  forest->evalInterp(pt, N);
+  const double *N = evalShapeFunctions(elemIndex, pt);
 
   // Get the design variable values
   const TacsScalar *xptr = &x[nvars * len * elemIndex];
@@ -1177,14 +1177,12 @@ TacsScalar TMRQuadConstitutive::evalFailureStrainSens(int elemIndex,
                                                       const TacsScalar X[],
                                                       const TacsScalar e[],
                                                       TacsScalar dfde[]) {
-  const int order = forest->getMeshOrder();
-  const int len = order * order;
   const double eps = props->stress_relax_value;
   const double beta = props->beta;
   const double xoffset = props->xoffset;
 
   // Evaluate the shape functions
-  forest->evalInterp(pt, N);
+  const double *N = evalShapeFunctions(elemIndex, pt);
 
   // Get the design variable values
   const TacsScalar *xptr = &x[nvars * len * elemIndex];
@@ -1298,13 +1296,11 @@ TacsScalar TMRQuadConstitutive::evalDesignFieldValue(int elemIndex,
                                                      const TacsScalar X[],
                                                      int index) {
   if (index >= 0 && index < nvars) {
-    const int order = forest->getMeshOrder();
-    const int len = order * order;
     const double beta = props->beta;
     const double xoffset = props->xoffset;
 
     // Evaluate the shape functions
-    forest->evalInterp(pt, N);
+    const double *N = evalShapeFunctions(elemIndex, pt);
 
     // Get the design variable values
     const TacsScalar *xptr = &x[nvars * len * elemIndex];
@@ -1327,3 +1323,132 @@ TacsScalar TMRQuadConstitutive::evalDesignFieldValue(int elemIndex,
 const char *TMRQuadConstitutive::getObjectName() {
   return "TMRQuadConstitutive";
 }
+
+/*
+  Get the stiffness of each material
+
+  output:
+  C:      the upper triangle of the stiffness of each material, stored
+  .       row by row with 6 entries for each material
+*/
+void TMRQuadConstitutive::getMaterialStiffness(TacsScalar C[]) {
+  for (int j = 0; j < nmats; j++) {
+    props->props[j]->evalTangentStiffness2D(&C[6 * j]);
+  }
+}
+
+/*
+  Evaluate the shape functions for the design variables at a table of
+  parametric points
+
+  input:
+  npts:   the number of points
+  pts:    the parametric points (2 coordinates for each point)
+
+  output:
+  N:      the shape functions (len = order^2 values for each point)
+*/
+void TMRQuadConstitutive::evalShapeFunctionTable(int npts, const double pts[],
+                                                 double N[]) {
+  if (pool) {
+    fprintf(stderr, "TMRQuadConstitutive: Block functions require a forest\n");
+    return;
+  }
+  for (int p = 0; p < npts; p++) {
+    forest->evalInterp(&pts[2 * p], &N[len * p]);
+  }
+}
+
+/*
+  Interpolate the densities at the points of a block of elements
+
+  The densities are packed element by element, so that the density of
+  material j at point p of element k is rho[nmats*(npts*k + p) + j].
+
+  input:
+  nelems: the number of elements in the block
+  elems:  the element indices
+  npts:   the number of points in each element
+  N:      the table of shape functions from evalShapeFunctionTable()
+
+  output:
+  rho:    the packed densities
+*/
+void TMRQuadConstitutive::packDensities(int nelems, const int elems[], int npts,
+                                        const double N[], TacsScalar rho[]) {
+  if (pool) {
+    fprintf(stderr, "TMRQuadConstitutive: Block functions require a forest\n");
+    return;
+  }
+  for (int k = 0; k < nelems; k++) {
+    TMRInterpDensities(nvars, nmats, len, npts, N,
+                       &x[nvars * len * elems[k]], &rho[nmats * npts * k]);
+  }
+}
+
+/*
+  Evaluate the penalized tangent stiffness at n points from the packed
+  densities. The material stiffness is stored in a local array, so
+  that blocks may be evaluated concurrently. The result is the same
+  as evalTangentStiffness() at each point, with 6 entries for each point.
+*/
+void TMRQuadConstitutive::evalTangentStiffnessBlock(int n,
+                                                    const TacsScalar rho[],
+                                                    TacsScalar C[]) {
+  TMRStiffnessPenalty pen;
+  props->getStiffnessPenalty(&pen);
+  TacsScalar *Cmats = new TacsScalar[6 * nmats];
+  getMaterialStiffness(Cmats);
+  TMREvalPenalizedStiffness(pen, 3, nmats, Cmats, n, rho, C);
+  delete[] Cmats;
+}
+
+/*
+  Evaluate the stress at n points from the packed densities and the
+  strain at each point
+*/
+void TMRQuadConstitutive::evalStressBlock(int n, const TacsScalar rho[],
+                                          const TacsScalar e[],
+                                          TacsScalar s[]) {
+  TMRStiffnessPenalty pen;
+  props->getStiffnessPenalty(&pen);
+  TacsScalar *Cmats = new TacsScalar[6 * nmats];
+  getMaterialStiffness(Cmats);
+  TMREvalPenalizedStress(pen, 3, nmats, Cmats, n, rho, e, s);
+  delete[] Cmats;
+}
+
+/*
+  Add the derivative of the product of the stress with psi, times the
+  scale at each point, for a block of elements
+
+  This is equivalent to calling addStressDVSens() at each point of
+  each element. The strain, psi and scale are packed in the same order
+  as the densities. The derivatives for each element are added to
+  dfdx[nvars*len*k:nvars*len*(k+1)].
+*/
+void TMRQuadConstitutive::addStressDVSensBlock(
+    int nelems, int npts, const double N[], const TacsScalar rho[],
+    const TacsScalar scale[], const TacsScalar e[], const TacsScalar psi[],
+    TacsScalar dfdx[]) {
+  if (pool) {
+    fprintf(stderr, "TMRQuadConstitutive: Block functions require a forest\n");
+    return;
+  }
+  TMRStiffnessPenalty pen;
+  props->getStiffnessPenalty(&pen);
+  TacsScalar *Cmats = new TacsScalar[6 * nmats];
+  getMaterialStiffness(Cmats);
+
+  TacsScalar *drho = new TacsScalar[nmats * npts];
+  for (int k = 0; k < nelems; k++) {
+    const int offset = npts * k;
+    TMREvalPenalizedStressSens(pen, 3, nmats, Cmats, npts, &rho[nmats * offset],
+                               &scale[offset], &e[3 * offset], &psi[3 * offset],
+                               drho);
+    TMRAddInterpDensitiesTranspose(nvars, nmats, len, npts, N, drho,
+                                   &dfdx[nvars * len * k]);
+  }
+  delete[] Cmats;
+  delete[] drho;
+}
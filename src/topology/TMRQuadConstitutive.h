@@ -41,6 +41,7 @@
 class TMRQuadConstitutive : public TACSPlaneStressConstitutive {
  public:
   TMRQuadConstitutive(TMRStiffnessProperties *_props, TMRQuadForest *_forest);
+  TMRQuadConstitutive(TMRStiffnessProperties *_props, TMRWeightPool *_pool);
   ~TMRQuadConstitutive();
 
   // Get the number of design variables at each "design node"
@@ -153,16 +154,64 @@ class TMRQuadConstitutive : public TACSPlaneStressConstitutive {
   // Extra info about the constitutive class
   const char *getObjectName();
 
+  // Get the stiffness of each material, packed as in TMRTopoPenalty.h
+  void getMaterialStiffness(TacsScalar C[]);
+
+  // Evaluate the design shape functions at a table of points. The block
+  // functions that use the table require an object created with a forest.
+  void evalShapeFunctionTable(int npts, const double pts[], double N[]);
+
+  // Interpolate the densities at the points of a block of elements
+  void packDensities(int nelems, const int elems[], int npts, const double N[],
+                     TacsScalar rho[]);
+
+  // Evaluate the stiffness and the stress from the packed densities. The
+  // block functions only write to their output arrays, so they may be
+  // called concurrently for different blocks.
+  void evalTangentStiffnessBlock(int n, const TacsScalar rho[],
+                                 TacsScalar C[]);
+  void evalStressBlock(int n, const TacsScalar rho[], const TacsScalar e[],
+                       TacsScalar s[]);
+
+  // Add the derivative of the stress for a block of elements
+  void addStressDVSensBlock(int nelems, int npts, const double N[],
+                            const TacsScalar rho[], const TacsScalar scale[],
+                            const TacsScalar e[], const TacsScalar psi[],
+                            TacsScalar dfdx[]);
+
  private:
+  // Set the properties and allocate the design variables
+  void initialize(TMRStiffnessProperties *_props, int num_elements);
+
   // The stiffness properties
   TMRStiffnessProperties *props;
+
+  // The design node connectivity from either the forest or the pool of
+  // filter weights. Only one of these is non-NULL.
   TMRQuadForest *forest;
+  TMRWeightPool *pool;
 
   // Information about the design variable values
   int nmats, nvars;
-  TacsScalar *x;           // All the design variable values
-  double *N;               // Space for the shape functions
-  TacsScalar *temp_array;  // Temporary array
+  int len;                    // The number of design nodes per element
+  TacsScalar *x;              // All the design variable values
+  double *Nwork;              // Space for the shape functions
+  TacsScalar *temp_array;     // Temporary array
+  TacsScalar *density_array;  // Material densities and their derivatives
+
+  // Evaluate the shape functions, using the cache when possible
+  const double *evalShapeFunctions(int elemIndex, const double pt[]);
+
+  // Interpolate the density of each material and add the transpose
+  void interpDensities(int elemIndex, const double N[], TacsScalar rho[]);
+  void addInterpDensitiesTranspose(const double N[], const TacsScalar drho[],
+                                   TacsScalar dfdx[]);
+
+  // The shape functions at previously evaluated quadrature points
+  static const int MAX_CACHED_POINTS = 128;
+  int num_cached_pts, last_cached_pt;
+  double *cached_pts;  // The cached parametric points
+  double *cached_N;    // The shape functions at each cached point
 };
 
 #endif  // TMR_QUADRANT_STIFFNESS_H
@@ -25,12 +25,15 @@
 #include "TMRBase.h"
 #include "TMROctForest.h"
 #include "TMRQuadForest.h"
+#include "TMR_STLTools.h"
 
 /*
   Abstract base class for the filter problem
 */
 class TMRTopoFilter : public TMREntity {
  public:
+  TMRTopoFilter() { design_vars_set = 0; }
+
   // Get the TACSAssembler instance (on the finest mesh level)
   virtual TACSAssembler *getAssembler() = 0;
 
@@ -54,6 +57,14 @@ class TMRTopoFilter : public TMREntity {
   // Write the STL file
   virtual void writeSTLFile(int k, double cutoff, const char *filename) {}
 
+  // Begin writing the STL file. The write is completed by passing the
+  // request (if not NULL) to TMR_EndWriteSTLFile.
+  virtual void beginWriteSTLFile(int k, double cutoff, const char *filename,
+                                 TMRSTLFileRequest **request) {
+    *request = NULL;
+    writeSTLFile(k, cutoff, filename);
+  }
+
   // Apply filter/filter transpose to some vector that has same size as design
   // variable
   virtual void applyFilter(TACSBVec *in, TACSBVec *out) {
@@ -64,6 +75,39 @@ class TMRTopoFilter : public TMREntity {
     fprintf(stderr,
             "TMR Filter Error: applyTranspose() method is not implemented!\n");
   }
+
+ protected:
+  /*
+    Check whether the design variables differ from the values stored
+    in xlast when the design variables were last set. This is used to
+    skip the filter and the updates on each level when the same design
+    variables are set again, for instance during a line search.
+  */
+  int checkDesignVarsChanged(TACSBVec *xvec, TACSBVec *xlast) {
+    int changed = !design_vars_set;
+    if (!changed) {
+      TacsScalar *xv, *xl;
+      int size = xvec->getArray(&xv);
+      xlast->getArray(&xl);
+      for (int i = 0; i < size; i++) {
+        if (xv[i] != xl[i]) {
+          changed = 1;
+          break;
+        }
+      }
+    }
+
+    int any_changed = 0;
+    MPI_Allreduce(&changed, &any_changed, 1, MPI_INT, MPI_MAX,
+                  getAssembler()->getMPIComm());
+    design_vars_set = 1;
+
+    return any_changed;
+  }
+
+ private:
+  // Flag to indicate whether the design variables have been set
+  int design_vars_set;
 };
 
 #endif  // TMR_TOPO_FILTER_H
@@ -0,0 +1,264 @@
+/*
+  This file is part of the package TMR for adaptive mesh refinement.
+
+  Copyright (C) 2015 Georgia Tech Research Corporation.
+  Additional copyright (C) 2015 Graeme Kennedy.
+  All rights reserved.
+
+  TMR is licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this software except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef TMR_TOPO_PENALTY_H
+#define TMR_TOPO_PENALTY_H
+
+#include <math.h>
+#include <stddef.h>
+
+/*
+  The following file defines the penalization of the stiffness used in
+  topology optimization, for a single point and for a block of points.
+
+  The functions do not depend on TACS, so the same code is compiled
+  for the host and, when TMR is built with CUDA or HIP, for the device.
+  The block functions operate on packed arrays:
+
+  rho[nmats*k + j]:       the density of material j at point k
+  Cmats[ncomp*j + i]:     the stiffness of material j, where
+  .                       ncomp = nstrain*(nstrain + 1)/2 and the
+  .                       upper triangle is stored row by row
+  C[ncomp*k + i]:         the stiffness at point k
+  e[nstrain*k + i]:       the strain at point k
+  s[nstrain*k + i]:       the stress at point k
+
+  The interpolation functions use a table of the shape functions
+  N[len*p + i] at npts quadrature points. The design variables for an
+  element are stored node by node, with nvars values for each of the
+  len nodes, as in the constitutive classes.
+*/
+#if defined(__CUDACC__) || defined(__HIPCC__)
+#define TMR_HOST_DEVICE __host__ __device__
+#else
+#define TMR_HOST_DEVICE
+#endif
+
+enum TMRTopoPenaltyType { TMR_RAMP_PENALTY, TMR_SIMP_PENALTY };
+
+/*
+  The parameters for the penalization of the stiffness
+*/
+class TMRStiffnessPenalty {
+ public:
+  int penalty_type;  // The TMRTopoPenaltyType
+  int use_project;   // Flag to indicate if projection should be used
+  double q;          // The penalty value
+  double k0;         // The stiffness offset
+  double beta;       // The parameter for the logistics function
+  double xoffset;    // The offset in the logistics function
+};
+
+/*
+  Evaluate the stiffness penalty for the density of a material and,
+  if dpenalty is not NULL, its derivative with respect to the density
+*/
+template <class ScalarType>
+TMR_HOST_DEVICE inline ScalarType TMREvalStiffnessPenalty(
+    const TMRStiffnessPenalty &pen, ScalarType rho, ScalarType *dpenalty) {
+  const double q = pen.q;
+
+  // Apply the projection
+  ScalarType rho_exp = 0.0;
+  if (pen.use_project) {
+    rho_exp = exp(-pen.beta * (rho - pen.xoffset));
+    rho = 1.0 / (1.0 + rho_exp);
+  }
+
+  ScalarType penalty = 0.0;
+  if (pen.penalty_type == TMR_SIMP_PENALTY) {
+    penalty = pow(rho, q) + pen.k0;
+  } else {
+    penalty = rho / (1.0 + q * (1.0 - rho)) + pen.k0;
+  }
+
+  if (dpenalty) {
+    ScalarType d = 1.0;
+    if (pen.penalty_type == TMR_SIMP_PENALTY) {
+      if (q > 1.0) {
+        d = q * pow(rho, q - 1.0);
+      }
+    } else {
+      d = (q + 1.0) / ((1.0 + q * (1.0 - rho)) * (1.0 + q * (1.0 - rho)));
+    }
+    if (pen.use_project) {
+      d *= pen.beta * rho_exp * rho * rho;
+    }
+    *dpenalty = d;
+  }
+
+  return penalty;
+}
+
+/*
+  Compute s = C*e for a symmetric matrix with the upper triangle stored
+  row by row
+*/
+template <class ScalarType>
+TMR_HOST_DEVICE inline void TMRMultSymmetric(int nstrain, const ScalarType C[],
+                                             const ScalarType e[],
+                                             ScalarType s[]) {
+  for (int i = 0; i < nstrain; i++) {
+    s[i] = 0.0;
+  }
+  for (int i = 0; i < nstrain; i++) {
+    s[i] += C[0] * e[i];
+    for (int j = i + 1; j < nstrain; j++) {
+      s[i] += C[j - i] * e[j];
+      s[j] += C[j - i] * e[i];
+    }
+    C += nstrain - i;
+  }
+}
+
+/*
+  Evaluate the penalized stiffness at n points
+*/
+template <class ScalarType>
+inline void TMREvalPenalizedStiffness(const TMRStiffnessPenalty &pen,
+                                      int nstrain, int nmats,
+                                      const ScalarType Cmats[], int n,
+                                      const ScalarType rho[], ScalarType C[]) {
+  const int ncomp = nstrain * (nstrain + 1) / 2;
+  for (int k = 0; k < ncomp * n; k++) {
+    C[k] = 0.0;
+  }
+  for (int j = 0; j < nmats; j++) {
+    const ScalarType *Cj = &Cmats[ncomp * j];
+    for (int k = 0; k < n; k++) {
+      ScalarType penalty =
+          TMREvalStiffnessPenalty(pen, rho[nmats * k + j], (ScalarType *)NULL);
+      ScalarType *Ck = &C[ncomp * k];
+      for (int i = 0; i < ncomp; i++) {
+        Ck[i] += penalty * Cj[i];
+      }
+    }
+  }
+}
+
+/*
+  Evaluate the stress at n points
+*/
+template <class ScalarType>
+inline void TMREvalPenalizedStress(const TMRStiffnessPenalty &pen,
+                                   int nstrain, int nmats,
+                                   const ScalarType Cmats[], int n,
+                                   const ScalarType rho[], const ScalarType e[],
+                                   ScalarType s[]) {
+  const int ncomp = nstrain * (nstrain + 1) / 2;
+  for (int k = 0; k < nstrain * n; k++) {
+    s[k] = 0.0;
+  }
+  for (int j = 0; j < nmats; j++) {
+    const ScalarType *Cj = &Cmats[ncomp * j];
+    for (int k = 0; k < n; k++) {
+      ScalarType penalty =
+          TMREvalStiffnessPenalty(pen, rho[nmats * k + j], (ScalarType *)NULL);
+      ScalarType sj[6];
+      TMRMultSymmetric(nstrain, Cj, &e[nstrain * k], sj);
+      for (int i = 0; i < nstrain; i++) {
+        s[nstrain * k + i] += penalty * sj[i];
+      }
+    }
+  }
+}
+
+/*
+  Evaluate the derivative of scale[k]*psi[k]^{T}*s[k] with respect to
+  the density of each material at n points
+*/
+template <class ScalarType>
+inline void TMREvalPenalizedStressSens(
+    const TMRStiffnessPenalty &pen, int nstrain, int nmats,
+    const ScalarType Cmats[], int n, const ScalarType rho[],
+    const ScalarType scale[], const ScalarType e[], const ScalarType psi[],
+    ScalarType drho[]) {
+  const int ncomp = nstrain * (nstrain + 1) / 2;
+  for (int j = 0; j < nmats; j++) {
+    const ScalarType *Cj = &Cmats[ncomp * j];
+    for (int k = 0; k < n; k++) {
+      ScalarType dpenalty;
+      TMREvalStiffnessPenalty(pen, rho[nmats * k + j], &dpenalty);
+      ScalarType sj[6];
+      TMRMultSymmetric(nstrain, Cj, &e[nstrain * k], sj);
+      ScalarType product = 0.0;
+      for (int i = 0; i < nstrain; i++) {
+        product += sj[i] * psi[nstrain * k + i];
+      }
+      drho[nmats * k + j] = scale[k] * dpenalty * product;
+    }
+  }
+}
+
+/*
+  Interpolate the density of each material at the npts points of an
+  element
+*/
+template <class ScalarType>
+TMR_HOST_DEVICE inline void TMRInterpDensities(int nvars, int nmats, int len,
+                                               int npts, const double N[],
+                                               const ScalarType x[],
+                                               ScalarType rho[]) {
+  for (int p = 0; p < npts; p++, N += len, rho += nmats) {
+    if (nvars == 1) {
+      ScalarType r = 0.0;
+      for (int i = 0; i < len; i++) {
+        r += N[i] * x[i];
+      }
+      rho[0] = r;
+    } else {
+      for (int j = 0; j < nmats; j++) {
+        rho[j] = 0.0;
+      }
+      const ScalarType *xptr = x;
+      for (int i = 0; i < len; i++, xptr += nvars) {
+        for (int j = 0; j < nmats; j++) {
+          rho[j] += N[i] * xptr[j + 1];
+        }
+      }
+    }
+  }
+}
+
+/*
+  Add the transpose of the interpolation at the npts points of an
+  element to the derivative with respect to the design variables
+*/
+template <class ScalarType>
+TMR_HOST_DEVICE inline void TMRAddInterpDensitiesTranspose(
+    int nvars, int nmats, int len, int npts, const double N[],
+    const ScalarType drho[], ScalarType dfdx[]) {
+  for (int p = 0; p < npts; p++, N += len, drho += nmats) {
+    if (nvars == 1) {
+      for (int i = 0; i < len; i++) {
+        dfdx[i] += N[i] * drho[0];
+      }
+    } else {
+      ScalarType *dptr = dfdx;
+      for (int i = 0; i < len; i++, dptr += nvars) {
+        for (int j = 0; j < nmats; j++) {
+          dptr[j + 1] += N[i] * drho[j];
+        }
+      }
+    }
+  }
+}
+
+#endif  // TMR_TOPO_PENALTY_H
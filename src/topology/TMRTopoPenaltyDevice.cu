@@ -0,0 +1,199 @@
+/*
+  This file is part of the package TMR for adaptive mesh refinement.
+
+  Copyright (C) 2015 Georgia Tech Research Corporation.
+  Additional copyright (C) 2015 Graeme Kennedy.
+  All rights reserved.
+
+  TMR is licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this software except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include "TMRDeviceRuntime.h"
+#include "TMRTopoPenaltyDevice.h"
+
+/*
+  The kernels use one thread for each point, or one thread for each
+  node of an element for the transpose of the interpolation, so that
+  no atomic operations are required. The per-point operations are the
+  same inline functions that are used on the host.
+*/
+__global__ void TMRInterpDensitiesKernel(int nvars, int nmats, int len,
+                                         int npts, int nelems, const double *N,
+                                         const double *x, double *rho) {
+  int k = blockIdx.x * blockDim.x + threadIdx.x;
+  if (k < nelems * npts) {
+    int elem = k / npts, p = k % npts;
+    TMRInterpDensities(nvars, nmats, len, 1, &N[len * p],
+                       &x[nvars * len * elem], &rho[nmats * k]);
+  }
+}
+
+__global__ void TMRAddInterpDensitiesTransposeKernel(
+    int nvars, int nmats, int len, int npts, int nelems, const double *N,
+    const double *drho, double *dfdx) {
+  int k = blockIdx.x * blockDim.x + threadIdx.x;
+  if (k < nelems * len) {
+    int elem = k / len, i = k % len;
+    const double *d = &drho[nmats * npts * elem];
+    double *df = &dfdx[nvars * k];
+    for (int p = 0; p < npts; p++, d += nmats) {
+      double Ni = N[len * p + i];
+      if (nvars == 1) {
+        df[0] += Ni * d[0];
+      } else {
+        for (int j = 0; j < nmats; j++) {
+          df[j + 1] += Ni * d[j];
+        }
+      }
+    }
+  }
+}
+
+__global__ void TMRPenalizedStiffnessKernel(TMRStiffnessPenalty pen,
+                                            int nstrain, int nmats,
+                                            const double *Cmats, int n,
+                                            const double *rho, double *C) {
+  int k = blockIdx.x * blockDim.x + threadIdx.x;
+  if (k < n) {
+    const int ncomp = nstrain * (nstrain + 1) / 2;
+    double *Ck = &C[ncomp * k];
+    for (int i = 0; i < ncomp; i++) {
+      Ck[i] = 0.0;
+    }
+    for (int j = 0; j < nmats; j++) {
+      double penalty =
+          TMREvalStiffnessPenalty(pen, rho[nmats * k + j], (double *)NULL);
+      const double *Cj = &Cmats[ncomp * j];
+      for (int i = 0; i < ncomp; i++) {
+        Ck[i] += penalty * Cj[i];
+      }
+    }
+  }
+}
+
+__global__ void TMRPenalizedStressKernel(TMRStiffnessPenalty pen, int nstrain,
+                                         int nmats, const double *Cmats, int n,
+                                         const double *rho, const double *e,
+                                         double *s) {
+  int k = blockIdx.x * blockDim.x + threadIdx.x;
+  if (k < n) {
+    const int ncomp = nstrain * (nstrain + 1) / 2;
+    double *sk = &s[nstrain * k];
+    for (int i = 0; i < nstrain; i++) {
+      sk[i] = 0.0;
+    }
+    for (int j = 0; j < nmats; j++) {
+      double penalty =
+          TMREvalStiffnessPenalty(pen, rho[nmats * k + j], (double *)NULL);
+      double sj[6];
+      TMRMultSymmetric(nstrain, &Cmats[ncomp * j], &e[nstrain * k], sj);
+      for (int i = 0; i < nstrain; i++) {
+        sk[i] += penalty * sj[i];
+      }
+    }
+  }
+}
+
+__global__ void TMRPenalizedStressSensKernel(
+    TMRStiffnessPenalty pen, int nstrain, int nmats, const double *Cmats,
+    int n, const double *rho, const double *scale, const double *e,
+    const double *psi, double *drho) {
+  int k = blockIdx.x * blockDim.x + threadIdx.x;
+  if (k < n) {
+    const int ncomp = nstrain * (nstrain + 1) / 2;
+    for (int j = 0; j < nmats; j++) {
+      double dpenalty;
+      TMREvalStiffnessPenalty(pen, rho[nmats * k + j], &dpenalty);
+      double sj[6];
+      TMRMultSymmetric(nstrain, &Cmats[ncomp * j], &e[nstrain * k], sj);
+      double product = 0.0;
+      for (int i = 0; i < nstrain; i++) {
+        product += sj[i] * psi[nstrain * k + i];
+      }
+      drho[nmats * k + j] = scale[k] * dpenalty * product;
+    }
+  }
+}
+
+/*
+  Interpolate the densities at the npts points of each element
+*/
+void TMRDeviceInterpDensities(int nvars, int nmats, int len, int npts,
+                              int nelems, const double *N, const double *x,
+                              double *rho) {
+  int n = nelems * npts;
+  if (n > 0) {
+    TMRInterpDensitiesKernel<<<TMRDeviceNumBlocks(n),
+                               TMR_DEVICE_BLOCK_SIZE>>>(
+        nvars, nmats, len, npts, nelems, N, x, rho);
+  }
+}
+
+/*
+  Add the transpose of the interpolation to the design variables
+*/
+void TMRDeviceAddInterpDensitiesTranspose(int nvars, int nmats, int len,
+                                          int npts, int nelems,
+                                          const double *N, const double *drho,
+                                          double *dfdx) {
+  int n = nelems * len;
+  if (n > 0) {
+    TMRAddInterpDensitiesTransposeKernel<<<TMRDeviceNumBlocks(n),
+                                           TMR_DEVICE_BLOCK_SIZE>>>(
+        nvars, nmats, len, npts, nelems, N, drho, dfdx);
+  }
+}
+
+/*
+  Evaluate the penalized stiffness at n points
+*/
+void TMRDeviceEvalPenalizedStiffness(const TMRStiffnessPenalty &pen,
+                                     int nstrain, int nmats,
+                                     const double *Cmats, int n,
+                                     const double *rho, double *C) {
+  if (n > 0) {
+    TMRPenalizedStiffnessKernel<<<TMRDeviceNumBlocks(n),
+                                  TMR_DEVICE_BLOCK_SIZE>>>(
+        pen, nstrain, nmats, Cmats, n, rho, C);
+  }
+}
+
+/*
+  Evaluate the stress at n points
+*/
+void TMRDeviceEvalPenalizedStress(const TMRStiffnessPenalty &pen, int nstrain,
+                                  int nmats, const double *Cmats, int n,
+                                  const double *rho, const double *e,
+                                  double *s) {
+  if (n > 0) {
+    TMRPenalizedStressKernel<<<TMRDeviceNumBlocks(n),
+                               TMR_DEVICE_BLOCK_SIZE>>>(
+        pen, nstrain, nmats, Cmats, n, rho, e, s);
+  }
+}
+
+/*
+  Evaluate the derivative of scale*psi^{T}*s w.r.t. the densities
+*/
+void TMRDeviceEvalPenalizedStressSens(const TMRStiffnessPenalty &pen,
+                                      int nstrain, int nmats,
+                                      const double *Cmats, int n,
+                                      const double *rho, const double *scale,
+                                      const double *e, const double *psi,
+                                      double *drho) {
+  if (n > 0) {
+    TMRPenalizedStressSensKernel<<<TMRDeviceNumBlocks(n),
+                                   TMR_DEVICE_BLOCK_SIZE>>>(
+        pen, nstrain, nmats, Cmats, n, rho, scale, e, psi, drho);
+  }
+}
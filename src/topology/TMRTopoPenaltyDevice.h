@@ -0,0 +1,74 @@
+/*
+  This file is part of the package TMR for adaptive mesh refinement.
+
+  Copyright (C) 2015 Georgia Tech Research Corporation.
+  Additional copyright (C) 2015 Graeme Kennedy.
+  All rights reserved.
+
+  TMR is licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this software except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef TMR_TOPO_PENALTY_DEVICE_H
+#define TMR_TOPO_PENALTY_DEVICE_H
+
+#include "TMRTopoPenalty.h"
+
+/*
+  The GPU versions of the block evaluation of the penalized stiffness
+
+  These functions are only available when TMR is built with
+  -DTMR_HAS_CUDA or -DTMR_HAS_HIP. All of the arrays are device
+  pointers with the same layout as the host functions in
+  TMRTopoPenalty.h, and the values are real. The material stiffness
+  and the penalty parameters for a constitutive object are obtained
+  with getMaterialStiffness() and getStiffnessPenalty(). The design
+  variables for a block of nelems elements are packed element by
+  element, with nvars*len values for each element, and the densities
+  at the npts points of each element are packed element by element.
+
+  The kernels are queued on the default stream, so the results are
+  available after the next synchronous copy to the host.
+*/
+
+// Interpolate the densities at the npts points of each element
+void TMRDeviceInterpDensities(int nvars, int nmats, int len, int npts,
+                              int nelems, const double *N, const double *x,
+                              double *rho);
+
+// Add the transpose of the interpolation to the design variables
+void TMRDeviceAddInterpDensitiesTranspose(int nvars, int nmats, int len,
+                                          int npts, int nelems,
+                                          const double *N, const double *drho,
+                                          double *dfdx);
+
+// Evaluate the penalized stiffness at n points
+void TMRDeviceEvalPenalizedStiffness(const TMRStiffnessPenalty &pen,
+                                     int nstrain, int nmats,
+                                     const double *Cmats, int n,
+                                     const double *rho, double *C);
+
+// Evaluate the stress at n points
+void TMRDeviceEvalPenalizedStress(const TMRStiffnessPenalty &pen, int nstrain,
+                                  int nmats, const double *Cmats, int n,
+                                  const double *rho, const double *e,
+                                  double *s);
+
+// Evaluate the derivative of scale*psi^{T}*s w.r.t. the densities
+void TMRDeviceEvalPenalizedStressSens(const TMRStiffnessPenalty &pen,
+                                      int nstrain, int nmats,
+                                      const double *Cmats, int n,
+                                      const double *rho, const double *scale,
+                                      const double *e, const double *psi,
+                                      double *drho);
+
+#endif  // TMR_TOPO_PENALTY_DEVICE_H
@@ -22,6 +22,7 @@
 
 #include "TACSFunction.h"
 #include "TACSToFH5.h"
+#include "TMRTrace.h"
 #include "TMR_TACSCreator.h"
 
 /*
@@ -153,6 +154,34 @@ int ParOptBVecWrap::getArray(ParOptScalar **array) {
   return size;
 }
 
+/*
+  A monitor that counts the Krylov iterations and passes the
+  residuals on to another monitor
+*/
+class TMRIterCountPrint : public KSMPrint {
+ public:
+  TMRIterCountPrint(KSMPrint *_monitor) {
+    monitor = _monitor;
+    monitor->incref();
+    iter_count = 0;
+  }
+  ~TMRIterCountPrint() { monitor->decref(); }
+
+  void printResidual(int iter, TacsScalar res) {
+    if (iter > 0) {
+      iter_count++;
+    }
+    monitor->printResidual(iter, res);
+  }
+  void print(const char *cstr) { monitor->print(cstr); }
+
+  // The number of iterations since the last reset
+  int iter_count;
+
+ private:
+  KSMPrint *monitor;
+};
+
 /*
   Create the topology optimization problem
 */
@@ -200,11 +229,42 @@ TMRTopoProblem::TMRTopoProblem(TMRTopoFilter *_filter, TACSMg *_mg,
     double atol = 1e-30;
     ksm = new GMRES(mg->getMat(0), mg, gmres_iters, nrestart, is_flexible);
     ksm->incref();
-    ksm->setMonitor(new KSMPrintStdout("GMRES", mpi_rank, 10));
+    ksm_monitor =
+        new TMRIterCountPrint(new KSMPrintStdout("GMRES", mpi_rank, 10));
+    ksm_monitor->incref();
+    ksm->setMonitor(ksm_monitor);
     ksm->setTolerances(rtol, atol);
+
+    block_ksm = new TMRBlockGMRES(assembler->getMPIComm(), mg->getMat(0), mg,
+                                  gmres_iters, nrestart);
+    block_ksm->incref();
+    block_ksm->setMonitor(new KSMPrintStdout("BlockGMRES", mpi_rank, 10));
+    block_ksm->setTolerances(rtol, atol);
   } else {
     ksm = NULL;
-  }
+    ksm_monitor = NULL;
+    block_ksm = NULL;
+  }
+
+  // The multiple right-hand-side solver is not used by default
+  use_block_solver = 0;
+  num_adjoint_vecs = 0;
+  adjoint_rhs = NULL;
+  adjoint_vecs = NULL;
+  use_multi_adjoint = 0;
+
+  // By default, solutions and factorizations are not reused
+  reuse_solutions = 0;
+  is_symmetric = -1;
+  mg_transpose = 0;
+
+  // The multigrid factorization is not lagged by default
+  lag_freq = 0;
+  lag_count = 0;
+  lag_iter_ratio = 2.0;
+  lag_ref_iters = 0;
+  lag_last_iters = 0;
+  lag_mat = NULL;
 
   // Set the iteration count
   iter_count = 0;
@@ -237,6 +297,7 @@ TMRTopoProblem::TMRTopoProblem(TMRTopoFilter *_filter, TACSMg *_mg,
 
   // Set up the buckling constraint data
   buck = NULL;
+  eig_monitor = NULL;
   buck_eig_tol = 1e-8;
   num_buck_eigvals = 5;
   buck_ks_sum = NULL;
@@ -253,6 +314,17 @@ TMRTopoProblem::TMRTopoProblem(TMRTopoFilter *_filter, TACSMg *_mg,
   f5_eigen_element_type = TACS_ELEMENT_NONE;
   f5_eigen_write_flag = 0;
 
+  // The STL output is written synchronously by default
+  async_output = 0;
+  stl_requests = NULL;
+
+  // Set up the timers for each phase
+  profile_output = 0;
+  profile_depth = 0;
+  profile_mark = 0.0;
+  profile_iter_mark = 0;
+  resetProfile();
+
   // Callback function information
   output_callback_ptr = NULL;
   writeOutputCallback = NULL;
@@ -280,12 +352,20 @@ TMRTopoProblem::TMRTopoProblem(TMRTopoFilter *_filter, TACSMg *_mg,
   proj_deriv = NULL;
   x_h = NULL;
   s_temp = NULL;
+  comp_grad = NULL;
+  comp_grad_valid = 0;
 }
 
 /*
   Free the data stored in the object
 */
 TMRTopoProblem::~TMRTopoProblem() {
+  // Complete any outstanding output
+  completeSTLOutput();
+  if (stl_requests) {
+    delete[] stl_requests;
+  }
+
   if (prefix) {
     delete[] prefix;
   }
@@ -308,6 +388,23 @@ TMRTopoProblem::~TMRTopoProblem() {
   if (ksm) {
     ksm->decref();
   }
+  if (ksm_monitor) {
+    ksm_monitor->decref();
+  }
+  if (block_ksm) {
+    block_ksm->decref();
+  }
+  for (int i = 0; i < num_adjoint_vecs; i++) {
+    adjoint_rhs[i]->decref();
+    adjoint_vecs[i]->decref();
+  }
+  if (adjoint_rhs) {
+    delete[] adjoint_rhs;
+    delete[] adjoint_vecs;
+  }
+  if (lag_mat) {
+    lag_mat->decref();
+  }
 
   dfdu->decref();
   adjoint->decref();
@@ -365,6 +462,16 @@ TMRTopoProblem::~TMRTopoProblem() {
   if (freq) {
     freq->decref();
   }
+  if (buck) {
+    for (int i = 0; i < num_load_cases; i++) {
+      buck[i]->decref();
+    }
+    delete[] buck;
+    delete[] buck_ks_sum;
+  }
+  if (eig_monitor) {
+    eig_monitor->decref();
+  }
 
   // Free the array of KS weights
   if (obj_funcs) {
@@ -380,6 +487,7 @@ TMRTopoProblem::~TMRTopoProblem() {
     proj_deriv->decref();
     x_h->decref();
     s_temp->decref();
+    comp_grad->decref();
   }
 }
 
@@ -432,6 +540,182 @@ void TMRTopoProblem::setF5EigenOutputFlags(int freq, ElementType elem_type,
   f5_eigen_write_flag = flag;
 }
 
+/*
+  Set whether to write the STL output asynchronously.
+
+  When set, the triangles are extracted when writeOutput is called,
+  but the file writes are completed in the background and only waited
+  on at the next call to writeOutput (or when the problem is
+  destroyed). The f5 output and the output callback are always
+  completed before writeOutput returns since they require the state of
+  the assembler.
+*/
+void TMRTopoProblem::setAsyncOutput(int flag) {
+  async_output = flag;
+  if (!async_output) {
+    completeSTLOutput();
+  }
+}
+
+/*
+  Complete the STL files that are still being written
+*/
+void TMRTopoProblem::completeSTLOutput() {
+  if (stl_requests) {
+    for (int k = 0; k < design_vars_per_node; k++) {
+      if (stl_requests[k]) {
+        TMR_EndWriteSTLFile(stl_requests[k]);
+        stl_requests[k] = NULL;
+      }
+    }
+  }
+}
+
+/*
+  Get the number of Krylov iterations counted by the monitor. This
+  count is only reset at the beginning of each analysis, so the
+  profile uses the change in the count over each phase.
+*/
+static int TMR_GetMonitorIters(TMRIterCountPrint *monitor) {
+  return (monitor ? monitor->iter_count : 0);
+}
+
+/*
+  Start timing a phase. The phase that is currently running (if any)
+  is paused until this phase is stopped.
+*/
+void TMRTopoProblem::startPhase(TMRTopoProfilePhase phase) {
+  double t = MPI_Wtime();
+  int iters = TMR_GetMonitorIters(ksm_monitor);
+  if (profile_depth > 0 && profile_depth <= MAX_PROFILE_DEPTH) {
+    TMRTopoProfilePhase parent = profile_stack[profile_depth - 1];
+    profile_time[parent] += t - profile_mark;
+    profile_iters[parent] += iters - profile_iter_mark;
+  }
+  if (profile_depth < MAX_PROFILE_DEPTH) {
+    profile_stack[profile_depth] = phase;
+    profile_start[profile_depth] = t;
+  }
+  profile_depth++;
+  profile_count[phase]++;
+  profile_mark = t;
+  profile_iter_mark = iters;
+}
+
+/*
+  Stop timing a phase and resume the phase that called it. Krylov
+  iterations that are not counted by the monitor (from the block
+  solver) are added by the caller.
+*/
+void TMRTopoProblem::stopPhase(TMRTopoProfilePhase phase, int krylov_iters) {
+  double t = MPI_Wtime();
+  int iters = TMR_GetMonitorIters(ksm_monitor);
+  profile_time[phase] += t - profile_mark;
+  profile_iters[phase] += iters - profile_iter_mark + krylov_iters;
+  if (profile_depth > 0) {
+    profile_depth--;
+    if (profile_depth < MAX_PROFILE_DEPTH) {
+      TMR_TRACE_EVENT(getProfilePhaseName(phase), profile_start[profile_depth],
+                      t);
+    }
+  }
+  profile_mark = t;
+  profile_iter_mark = iters;
+}
+
+/*
+  Set whether to write the profile to the prefix directory each time
+  the output is written
+*/
+void TMRTopoProblem::setProfileOutput(int flag) { profile_output = flag; }
+
+/*
+  Get the name of a phase
+*/
+const char *TMRTopoProblem::getProfilePhaseName(int phase) {
+  static const char *names[] = {
+      "filter",        "assemble",      "factor",
+      "krylov solve",  "eigen solve",   "adjoint solve",
+      "functions",     "sensitivities", "output"};
+  if (phase >= 0 && phase < TMR_PROFILE_NUM_PHASES) {
+    return names[phase];
+  }
+  return NULL;
+}
+
+/*
+  Get the number of calls, the number of Krylov iterations and the
+  minimum, maximum and average time over all processors for a phase.
+
+  This is a collective call.
+*/
+void TMRTopoProblem::getProfilePhase(int phase, int *count, int *krylov_iters,
+                                     double *tmin, double *tmax,
+                                     double *tavg) {
+  MPI_Comm comm = assembler->getMPIComm();
+  int mpi_size;
+  MPI_Comm_size(comm, &mpi_size);
+
+  double t = 0.0;
+  int c = 0, iters = 0;
+  if (phase >= 0 && phase < TMR_PROFILE_NUM_PHASES) {
+    t = profile_time[phase];
+    c = profile_count[phase];
+    iters = profile_iters[phase];
+  }
+
+  double tsum = 0.0;
+  MPI_Allreduce(&t, tmin, 1, MPI_DOUBLE, MPI_MIN, comm);
+  MPI_Allreduce(&t, tmax, 1, MPI_DOUBLE, MPI_MAX, comm);
+  MPI_Allreduce(&t, &tsum, 1, MPI_DOUBLE, MPI_SUM, comm);
+  *tavg = tsum / mpi_size;
+  *count = c;
+  *krylov_iters = iters;
+}
+
+/*
+  Print the profile on the root processor (the file pointer is only
+  used on the root). This is a collective call.
+*/
+void TMRTopoProblem::printProfile(FILE *fp) {
+  int mpi_rank;
+  MPI_Comm_rank(assembler->getMPIComm(), &mpi_rank);
+  int root_print = (mpi_rank == 0 && fp);
+
+  if (root_print) {
+    fprintf(fp, "%-16s %8s %10s %12s %12s %12s\n", "phase", "calls",
+            "krylov", "min time", "max time", "avg time");
+  }
+
+  double total = 0.0;
+  for (int k = 0; k < TMR_PROFILE_NUM_PHASES; k++) {
+    int count, iters;
+    double tmin, tmax, tavg;
+    getProfilePhase(k, &count, &iters, &tmin, &tmax, &tavg);
+    total += tmax;
+    if (root_print) {
+      fprintf(fp, "%-16s %8d %10d %12.4e %12.4e %12.4e\n",
+              getProfilePhaseName(k), count, iters, tmin, tmax, tavg);
+    }
+  }
+
+  if (root_print) {
+    fprintf(fp, "%-16s %8s %10s %12s %12.4e\n", "total", "", "", "", total);
+    fflush(fp);
+  }
+}
+
+/*
+  Reset the time, calls and iterations for all phases
+*/
+void TMRTopoProblem::resetProfile() {
+  for (int k = 0; k < TMR_PROFILE_NUM_PHASES; k++) {
+    profile_time[k] = 0.0;
+    profile_count[k] = 0;
+    profile_iters[k] = 0;
+  }
+}
+
 /*
   Set the directory prefix to use for this load case
 */
@@ -521,6 +805,215 @@ void TMRTopoProblem::setLoadCases(TACSBVec **_forces, int _num_load_cases) {
 */
 int TMRTopoProblem::getNumLoadCases() { return num_load_cases; }
 
+/*
+  Set the flag to solve the load cases and adjoint equations together
+
+  When the flag is set, the linear systems for all load cases are
+  solved together with the same multigrid preconditioner using the
+  multiple right-hand-side GMRES solver, and the adjoint equations for
+  the objective and constraints are solved together in the same way.
+  This requires storage for the Krylov subspace for each system.
+*/
+void TMRTopoProblem::setUseBlockSolver(int flag) { use_block_solver = flag; }
+
+/*
+  Set the flag to evaluate the constraint adjoints together
+
+  When the flag is set, the adjoint right-hand-sides for all of the
+  constraint functions of a load case are computed in a single pass
+  over the elements, the adjoint equations are stored and solved
+  together, and the contributions from addDVSens and
+  addAdjointResProducts for all of the functions are accumulated in
+  a single pass over the elements. This requires storage for the
+  right-hand-side and adjoint of each constraint function.
+*/
+void TMRTopoProblem::setUseMultiAdjoint(int flag) { use_multi_adjoint = flag; }
+
+/*
+  Set the flag to reuse solutions and factorizations
+
+  When the flag is set, the solutions to the load cases and the
+  adjoint equations from the previous evaluation are used as the
+  initial guesses for the Krylov solver. In addition, the symmetry of
+  the Jacobian is checked once. If the Jacobian is symmetric, the
+  forward factorization is reused for the adjoint equations instead
+  of assembling and factoring the transpose.
+*/
+void TMRTopoProblem::setReuseSolutions(int flag) { reuse_solutions = flag; }
+
+/*
+  Lag the factorization of the multigrid hierarchy
+
+  The multigrid hierarchy is re-assembled and factored every freq
+  evaluations, or when the number of Krylov iterations for the load
+  cases exceeds iter_ratio times the number of iterations directly
+  after the last factorization. In between, the Jacobian on the finest
+  level is assembled into a separate matrix that is used as the
+  operator, with the previous multigrid hierarchy as the
+  preconditioner. The factorization is not lagged when frequency or
+  buckling constraints are used, since these assemble the hierarchy
+  themselves.
+
+  input:
+  freq:        the maximum number of evaluations between factorizations
+  iter_ratio:  the growth in the iteration count that triggers a
+               factorization
+*/
+void TMRTopoProblem::setLaggedPreconditioner(int freq, double iter_ratio) {
+  lag_freq = freq;
+  lag_iter_ratio = iter_ratio;
+  lag_count = 0;
+}
+
+/*
+  Allocate (at least) n stored adjoint right-hand-side and solution
+  vectors. The vectors are zero when they are allocated.
+*/
+void TMRTopoProblem::allocateAdjointVecs(int n) {
+  if (n > num_adjoint_vecs) {
+    TACSBVec **rhs = new TACSBVec *[n];
+    TACSBVec **sol = new TACSBVec *[n];
+    for (int i = 0; i < num_adjoint_vecs; i++) {
+      rhs[i] = adjoint_rhs[i];
+      sol[i] = adjoint_vecs[i];
+    }
+    for (int i = num_adjoint_vecs; i < n; i++) {
+      rhs[i] = assembler->createVec();
+      rhs[i]->incref();
+      sol[i] = assembler->createVec();
+      sol[i]->incref();
+    }
+    if (adjoint_rhs) {
+      delete[] adjoint_rhs;
+      delete[] adjoint_vecs;
+    }
+    adjoint_rhs = rhs;
+    adjoint_vecs = sol;
+    num_adjoint_vecs = n;
+  }
+}
+
+/*
+  Check whether the Jacobian on the finest level is symmetric
+
+  The products v^{T}*K*u and u^{T}*K*v are compared for random vectors
+  with zero entries at the boundary conditions. The adjoint
+  right-hand-sides are zero at the boundary conditions, so only the
+  remaining rows and columns of the Jacobian affect the adjoint.
+*/
+int TMRTopoProblem::checkJacobianSymmetry() {
+  TACSMat *mat = mg->getMat(0);
+  TACSBVec *u = assembler->createVec();
+  TACSBVec *v = assembler->createVec();
+  TACSBVec *w = assembler->createVec();
+  u->incref();
+  v->incref();
+  w->incref();
+
+  u->setRand(-1.0, 1.0);
+  v->setRand(-1.0, 1.0);
+  assembler->applyBCs(u);
+  assembler->applyBCs(v);
+
+  mat->mult(u, w);
+  TacsScalar vKu = v->dot(w);
+  double Ku_norm = w->norm();
+  mat->mult(v, w);
+  TacsScalar uKv = u->dot(w);
+  double Kv_norm = w->norm();
+
+  double tol = 1e-10 * (u->norm() * Kv_norm + v->norm() * Ku_norm);
+  int symm = (fabs(TacsRealPart(vKu - uKv)) <= tol);
+
+  u->decref();
+  v->decref();
+  w->decref();
+
+  return symm;
+}
+
+/*
+  Assemble the Jacobian for the load cases and factor the multigrid
+  hierarchy, unless the lagged factorization can be used
+*/
+void TMRTopoProblem::assembleForwardJacobian() {
+  double alpha = 1.0, beta = 0.0, gamma = 0.0;
+
+  // Decide whether the multigrid factorization can be lagged
+  int lagged = 0;
+  if (lag_freq > 1 && !freq && !buck && !mg_transpose && lag_count > 0 &&
+      lag_count < lag_freq &&
+      lag_last_iters <= lag_iter_ratio * lag_ref_iters) {
+    lagged = 1;
+  }
+
+  if (lagged) {
+    if (!lag_mat) {
+      lag_mat = assembler->createMat();
+      lag_mat->incref();
+    }
+    startPhase(TMR_PROFILE_ASSEMBLE);
+    assembler->assembleJacobian(alpha, beta, gamma, NULL, lag_mat);
+    stopPhase(TMR_PROFILE_ASSEMBLE);
+    ksm->setOperators(lag_mat, mg);
+    block_ksm->setOperators(lag_mat, mg);
+    lag_count++;
+  } else {
+    startPhase(TMR_PROFILE_ASSEMBLE);
+    mg->assembleJacobian(alpha, beta, gamma, NULL);
+    stopPhase(TMR_PROFILE_ASSEMBLE);
+    startPhase(TMR_PROFILE_FACTOR);
+    mg->factor();
+    stopPhase(TMR_PROFILE_FACTOR);
+    ksm->setOperators(mg->getMat(0), mg);
+    block_ksm->setOperators(mg->getMat(0), mg);
+    mg_transpose = 0;
+    lag_count = 1;
+    lag_ref_iters = -1;
+
+    // Check the symmetry of the problem once
+    if (reuse_solutions && is_symmetric < 0) {
+      is_symmetric = checkJacobianSymmetry();
+    }
+  }
+}
+
+/*
+  Assemble the Jacobian for the adjoint equations and factor the
+  multigrid hierarchy. When reusing solutions, the factorization is
+  kept if the problem is symmetric or the transpose has already been
+  factored for the current design.
+*/
+void TMRTopoProblem::assembleAdjointJacobian() {
+  if (reuse_solutions && (is_symmetric == 1 || mg_transpose)) {
+    return;
+  }
+
+  double alpha = 1.0, beta = 0.0, gamma = 0.0;
+  startPhase(TMR_PROFILE_ASSEMBLE);
+  mg->assembleJacobian(alpha, beta, gamma, NULL, TACS_MAT_TRANSPOSE);
+  stopPhase(TMR_PROFILE_ASSEMBLE);
+  startPhase(TMR_PROFILE_FACTOR);
+  mg->factor();
+  stopPhase(TMR_PROFILE_FACTOR);
+  ksm->setOperators(mg->getMat(0), mg);
+  block_ksm->setOperators(mg->getMat(0), mg);
+  mg_transpose = 1;
+}
+
+/*
+  Get and reset the number of Krylov iterations
+*/
+int TMRTopoProblem::getKrylovIterCount() {
+  int count = ksm_monitor->iter_count;
+  if (use_block_solver) {
+    count += block_ksm->getIterCount();
+  }
+  return count;
+}
+
+void TMRTopoProblem::resetKrylovIterCount() { ksm_monitor->iter_count = 0; }
+
 /*
   Set the constraint functions for each of the specified load cases
 */
@@ -602,8 +1095,27 @@ void TMRTopoProblem::addLinearConstraints(ParOptVec **vecs, TacsScalar *offset,
   }
 }
 
+/*
+  Create the monitor used by the eigenvalue solvers
+*/
+void TMRTopoProblem::createEigenMonitor() {
+  if (!eig_monitor) {
+    int mpi_rank;
+    MPI_Comm_rank(assembler->getMPIComm(), &mpi_rank);
+    eig_monitor = new KSMPrintStdout("KSM", mpi_rank, 1);
+    eig_monitor->incref();
+  }
+}
+
 /*
   Add a natural frequency constraint
+
+  When the Jacobi-Davidson method is used, the eigenvectors converged
+  for the previous design are used as the starting subspace for the
+  next design. The number of recycled eigenvectors is set by
+  num_recycle. A negative value recycles all of the num_eigvals
+  converged eigenvectors and a value of zero starts each solve from
+  scratch.
 */
 void TMRTopoProblem::addFrequencyConstraint(
     double sigma, int num_eigvals, TacsScalar ks_weight, TacsScalar offset,
@@ -628,6 +1140,11 @@ void TMRTopoProblem::addFrequencyConstraint(
       // Get preconditioner from Mg
       TACSPc *pc = mg;
 
+      // Recycle all of the converged eigenvectors by default
+      if (num_recycle < 0) {
+        num_recycle = num_eigvals;
+      }
+
       freq = new TACSFrequencyAnalysis(assembler, sigma, mmat, kmat, pcmat, pc,
                                        max_subspace_size, fgmres_size,
                                        num_eigvals, eigtol, eig_rtol, eig_atol,
@@ -640,6 +1157,7 @@ void TMRTopoProblem::addFrequencyConstraint(
     }
     freq->incref();
   }
+  createEigenMonitor();
 
   // Set a parameters that control how the natural frequency
   // constraint is implemented
@@ -682,6 +1200,7 @@ void TMRTopoProblem::addBucklingConstraint(double sigma, int num_eigvals,
       buck[i]->incref();
     }
   }
+  createEigenMonitor();
 
   // Set a parameters that control how the natural frequency
   // constraint is implemented
@@ -957,8 +1476,13 @@ void TMRTopoProblem::setDesignVars(ParOptVec *pxvec) {
 
   if (wrap) {
     // Set the design variable values
+    startPhase(TMR_PROFILE_FILTER);
     filter->setDesignVars(wrap->vec);
+    stopPhase(TMR_PROFILE_FILTER);
   }
+
+  // The stored compliance derivative no longer matches the design
+  comp_grad_valid = 0;
 }
 
 /*
@@ -966,10 +1490,15 @@ void TMRTopoProblem::setDesignVars(ParOptVec *pxvec) {
 */
 int TMRTopoProblem::evalObjCon(ParOptVec *pxvec, ParOptScalar *fobj,
                                ParOptScalar *cons) {
+  TMR_TRACE_SCOPE("TMRTopoProblem::evalObjCon");
+
   // Get the rank of comm
   int mpi_rank;
   MPI_Comm_rank(assembler->getMPIComm(), &mpi_rank);
 
+  // Time the evaluation that is not part of another phase
+  startPhase(TMR_PROFILE_FUNCTIONS);
+
   // Set the design variable values on all mesh levels
   setDesignVars(pxvec);
 
@@ -996,14 +1525,39 @@ int TMRTopoProblem::evalObjCon(ParOptVec *pxvec, ParOptScalar *fobj,
     assembler->zeroVariables();
 
     // Assemble the Jacobian on each level
-    double alpha = 1.0, beta = 0.0, gamma = 0.0;
-    mg->assembleJacobian(alpha, beta, gamma, NULL);
-    mg->factor();
+    assembleForwardJacobian();
+    resetKrylovIterCount();
+
+    // Use the previous solutions as the initial guess, if requested
+    int zero_guess = !reuse_solutions;
+
+    if (use_block_solver) {
+      // Solve the systems K(x)*u = forces for all load cases together
+      TACSBVec **rhs = new TACSBVec *[num_load_cases];
+      TACSBVec **sol = new TACSBVec *[num_load_cases];
+      int nrhs = 0;
+      for (int i = 0; i < num_load_cases; i++) {
+        if (forces[i]) {
+          rhs[nrhs] = forces[i];
+          sol[nrhs] = vars[i];
+          nrhs++;
+        }
+      }
+      startPhase(TMR_PROFILE_SOLVE);
+      block_ksm->solve(nrhs, rhs, sol, zero_guess);
+      stopPhase(TMR_PROFILE_SOLVE, block_ksm->getIterCount());
+      delete[] rhs;
+      delete[] sol;
+    }
 
     for (int i = 0; i < num_load_cases; i++) {
       if (forces[i]) {
         // Solve the system: K(x)*u = forces
-        ksm->solve(forces[i], vars[i]);
+        if (!use_block_solver) {
+          startPhase(TMR_PROFILE_SOLVE);
+          ksm->solve(forces[i], vars[i], zero_guess);
+          stopPhase(TMR_PROFILE_SOLVE);
+        }
         assembler->setBCs(vars[i]);
 
         // Set the variables into TACSAssembler
@@ -1064,6 +1618,13 @@ int TMRTopoProblem::evalObjCon(ParOptVec *pxvec, ParOptScalar *fobj,
         }
       }
     }
+
+    // Record the number of iterations used to decide when to factor
+    // the multigrid hierarchy
+    lag_last_iters = getKrylovIterCount();
+    if (lag_ref_iters < 0) {
+      lag_ref_iters = lag_last_iters;
+    }
   }
 
   // Compute the natural frequency constraint, if any
@@ -1080,7 +1641,9 @@ int TMRTopoProblem::evalObjCon(ParOptVec *pxvec, ParOptScalar *fobj,
       // Set the error counter to zero
       err_count = 0;
       // Solve the eigenvalue problem
-      freq->solve(new KSMPrintStdout("KSM", mpi_rank, 1));
+      startPhase(TMR_PROFILE_EIGEN);
+      freq->solve(eig_monitor);
+      stopPhase(TMR_PROFILE_EIGEN);
 
       // Extract the first k eigenvalues
       for (int k = 0; k < num_freq_eigvals; k++) {
@@ -1106,7 +1669,7 @@ int TMRTopoProblem::evalObjCon(ParOptVec *pxvec, ParOptScalar *fobj,
       // reset the buckling computation
       if (err_count > 0) {
         double sigma = shift * smallest_eigval;
-        shift += 0.5 * (1.0 - shift) + shift;
+        shift += 0.5 * (1.0 - shift);
         freq->setSigma(sigma);
       }
     }
@@ -1151,7 +1714,9 @@ int TMRTopoProblem::evalObjCon(ParOptVec *pxvec, ParOptScalar *fobj,
 
           // Solve the eigenvalue problem
           TACSBVec *u0 = NULL;  // TODO: Is this right? do we need a u0? --Aaron
-          buck[i]->solve(forces[i], u0, new KSMPrintStdout("KSM", mpi_rank, 1));
+          startPhase(TMR_PROFILE_EIGEN);
+          buck[i]->solve(forces[i], u0, eig_monitor);
+          stopPhase(TMR_PROFILE_EIGEN);
 
           // Extract the first k eigenvalues
           for (int k = 0; k < num_buck_eigvals; k++) {
@@ -1173,7 +1738,7 @@ int TMRTopoProblem::evalObjCon(ParOptVec *pxvec, ParOptScalar *fobj,
           // reset the buckling computation
           if (err_count > 0) {
             double sigma = shift * smallest_eigval;
-            shift += 0.5 * (1.0 - shift) + shift;
+            shift += 0.5 * (1.0 - shift);
             buck[i]->setSigma(sigma);
           }
         }
@@ -1207,6 +1772,8 @@ int TMRTopoProblem::evalObjCon(ParOptVec *pxvec, ParOptScalar *fobj,
                        num_callback_constraints, &cons[count]);
   }
 
+  stopPhase(TMR_PROFILE_FUNCTIONS);
+
   return 0;
 }
 
@@ -1215,9 +1782,14 @@ int TMRTopoProblem::evalObjCon(ParOptVec *pxvec, ParOptScalar *fobj,
 */
 int TMRTopoProblem::evalObjConGradient(ParOptVec *xvec, ParOptVec *gvec,
                                        ParOptVec **Acvec) {
+  TMR_TRACE_SCOPE("TMRTopoProblem::evalObjConGradient");
+
   int mpi_rank;
   MPI_Comm_rank(assembler->getMPIComm(), &mpi_rank);
 
+  // Time the sensitivity evaluation that is not part of another phase
+  startPhase(TMR_PROFILE_SENS);
+
   // Evaluate the derivative of the weighted compliance with
   // respect to the design variables
   ParOptBVecWrap *wrap = dynamic_cast<ParOptBVecWrap *>(gvec);
@@ -1244,7 +1816,58 @@ int TMRTopoProblem::evalObjConGradient(ParOptVec *xvec, ParOptVec *gvec,
     // Evaluate the gradient of the objective. If no objective functions are
     // set, the weighted sum of the compliance is used. Otherwise the weighted
     // sum of the objective functions from each load case are used
-    if (obj_funcs && mg) {
+    if (obj_funcs && mg && (use_block_solver || reuse_solutions)) {
+      // Compute the right-hand-sides for the adjoint equations. The
+      // first num_load_cases stored vectors are used for the objective.
+      allocateAdjointVecs(num_load_cases);
+      TACSBVec **rhs = new TACSBVec *[num_load_cases];
+      TACSBVec **sol = new TACSBVec *[num_load_cases];
+      double alpha = 1.0, beta = 0.0, gamma = 0.0;
+      int nrhs = 0;
+      for (int i = 0; i < num_load_cases; i++) {
+        if (!dynamic_cast<TACSStructuralMass *>(obj_funcs[i])) {
+          assembler->setVariables(vars[i]);
+          adjoint_rhs[i]->zeroEntries();
+          assembler->addSVSens(alpha, beta, gamma, 1, &obj_funcs[i],
+                               &adjoint_rhs[i]);
+          assembler->applyBCs(adjoint_rhs[i]);
+          rhs[nrhs] = adjoint_rhs[i];
+          sol[nrhs] = adjoint_vecs[i];
+          nrhs++;
+        }
+      }
+
+      // Assemble the transpose of the Jacobian matrix once and solve
+      // the adjoint equations. The Jacobian of the linear problem does
+      // not depend on the state variables, so it is the same for all
+      // load cases.
+      if (nrhs > 0) {
+        int zero_guess = !reuse_solutions;
+        assembleAdjointJacobian();
+        if (use_block_solver) {
+          startPhase(TMR_PROFILE_ADJOINT);
+          block_ksm->solve(nrhs, rhs, sol, zero_guess);
+          stopPhase(TMR_PROFILE_ADJOINT, block_ksm->getIterCount());
+        } else {
+          for (int k = 0; k < nrhs; k++) {
+            startPhase(TMR_PROFILE_ADJOINT);
+            ksm->solve(rhs[k], sol[k], zero_guess);
+            stopPhase(TMR_PROFILE_ADJOINT);
+          }
+        }
+      }
+      delete[] rhs;
+      delete[] sol;
+
+      for (int i = 0; i < num_load_cases; i++) {
+        assembler->setVariables(vars[i]);
+        assembler->addDVSens(obj_weights[i], 1, &obj_funcs[i], &g);
+        if (!dynamic_cast<TACSStructuralMass *>(obj_funcs[i])) {
+          assembler->addAdjointResProducts(-obj_weights[i], 1,
+                                           &adjoint_vecs[i], &g);
+        }
+      }
+    } else if (obj_funcs && mg) {
       for (int i = 0; i < num_load_cases; i++) {
         assembler->setVariables(vars[i]);
 
@@ -1257,8 +1880,7 @@ int TMRTopoProblem::evalObjConGradient(ParOptVec *xvec, ParOptVec *gvec,
         if (use_adjoint) {
           // Assemble the transpose of the Jacobian matrix
           double alpha = 1.0, beta = 0.0, gamma = 0.0;
-          mg->assembleJacobian(alpha, beta, gamma, NULL, TACS_MAT_TRANSPOSE);
-          mg->factor();
+          assembleAdjointJacobian();
 
           // Compute the right-hand-side
           dfdu->zeroEntries();
@@ -1266,13 +1888,28 @@ int TMRTopoProblem::evalObjConGradient(ParOptVec *xvec, ParOptVec *gvec,
           assembler->applyBCs(dfdu);
 
           // Solve the system of adjoint equations
+          startPhase(TMR_PROFILE_ADJOINT);
           ksm->solve(dfdu, adjoint);
+          stopPhase(TMR_PROFILE_ADJOINT);
           assembler->addDVSens(obj_weights[i], 1, &obj_funcs[i], &g);
           assembler->addAdjointResProducts(-obj_weights[i], 1, &adjoint, &g);
         } else {
           assembler->addDVSens(obj_weights[i], 1, &obj_funcs[i], &g);
         }
       }
+    } else if (use_qn_correction_comp_obj) {
+      // For the compliance objective, keep a copy of the derivative so
+      // that it can be re-used by the quasi-Newton correction
+      ParOptBVecWrap *comp_grad_wrap =
+          dynamic_cast<ParOptBVecWrap *>(comp_grad);
+      TACSBVec *cg = comp_grad_wrap->vec;
+      cg->zeroEntries();
+      for (int i = 0; i < num_load_cases; i++) {
+        assembler->setVariables(vars[i]);
+        assembler->addAdjointResProducts(-obj_weights[i], 1, &vars[i], &cg);
+      }
+      g->axpy(1.0, cg);
+      comp_grad_valid = 1;
     } else {  // For compliance objective
       for (int i = 0; i < num_load_cases; i++) {
         assembler->setVariables(vars[i]);
@@ -1281,7 +1918,9 @@ int TMRTopoProblem::evalObjConGradient(ParOptVec *xvec, ParOptVec *gvec,
     }
 
     double gnorm = g->norm();
+    startPhase(TMR_PROFILE_FILTER);
     filter->addValues(g);  // Apply filter transpose to the gradient
+    stopPhase(TMR_PROFILE_FILTER);
     double fgnorm = g->norm();
     if (mpi_rank == 0) {
       printf("[TMRTopoProblem]unfiltered objective gradient norm: %20.10e\n",
@@ -1290,6 +1929,7 @@ int TMRTopoProblem::evalObjConGradient(ParOptVec *xvec, ParOptVec *gvec,
              fgnorm);
     }
   } else {
+    stopPhase(TMR_PROFILE_SENS);
     return 1;
   }
 
@@ -1301,52 +1941,188 @@ int TMRTopoProblem::evalObjConGradient(ParOptVec *xvec, ParOptVec *gvec,
     Acvec[count]->copyValues(Alinear[i]);
   }
 
+  // Solve the adjoint equations for all of the constraints together.
+  // The stored vectors after the first num_load_cases are used for the
+  // constraints in order.
+  int use_stored_adjoints =
+      ((use_block_solver || reuse_solutions || use_multi_adjoint) && mg);
+  if (use_stored_adjoints) {
+    int ncon = 0, max_funcs = 0;
+    for (int i = 0; i < num_load_cases; i++) {
+      ncon += load_case_info[i].num_funcs;
+      if (load_case_info[i].num_funcs > max_funcs) {
+        max_funcs = load_case_info[i].num_funcs;
+      }
+    }
+    allocateAdjointVecs(num_load_cases + ncon);
+    TACSBVec **rhs = new TACSBVec *[ncon];
+    TACSBVec **sol = new TACSBVec *[ncon];
+    TACSFunction **adj_funcs = new TACSFunction *[max_funcs];
+
+    int nrhs = 0;
+    for (int i = 0, k = count, index = num_load_cases; i < num_load_cases;
+         i++) {
+      assembler->setVariables(vars[i]);
+
+      // Collect the functions that require an adjoint for this load
+      // case and compute their right-hand-sides in a single pass
+      int nadj = 0;
+      int num_funcs = load_case_info[i].num_funcs;
+      for (int j = 0; j < num_funcs; j++, index++) {
+        TACSFunction *func = load_case_info[i].funcs[j];
+        wrap = dynamic_cast<ParOptBVecWrap *>(Acvec[k + j]);
+        if (wrap && !dynamic_cast<TACSStructuralMass *>(func)) {
+          adj_funcs[nadj] = func;
+          adjoint_rhs[index]->zeroEntries();
+          rhs[nrhs + nadj] = adjoint_rhs[index];
+          sol[nrhs + nadj] = adjoint_vecs[index];
+          nadj++;
+        }
+      }
+      if (nadj > 0) {
+        double alpha = 1.0, beta = 0.0, gamma = 0.0;
+        assembler->addSVSens(alpha, beta, gamma, nadj, adj_funcs, &rhs[nrhs]);
+        for (int j = 0; j < nadj; j++) {
+          assembler->applyBCs(rhs[nrhs + j]);
+        }
+        nrhs += nadj;
+      }
+      k += num_funcs;
+      if (freq && i == 0) {
+        k++;
+      }
+      if (buck) {
+        k++;
+      }
+    }
+    delete[] adj_funcs;
+
+    if (nrhs > 0) {
+      int zero_guess = !reuse_solutions;
+      if (reuse_solutions) {
+        assembleAdjointJacobian();
+      }
+      if (use_block_solver) {
+        startPhase(TMR_PROFILE_ADJOINT);
+        block_ksm->solve(nrhs, rhs, sol, zero_guess);
+        stopPhase(TMR_PROFILE_ADJOINT, block_ksm->getIterCount());
+      } else {
+        for (int k = 0; k < nrhs; k++) {
+          startPhase(TMR_PROFILE_ADJOINT);
+          ksm->solve(rhs[k], sol[k], zero_guess);
+          stopPhase(TMR_PROFILE_ADJOINT);
+        }
+      }
+    }
+    delete[] rhs;
+    delete[] sol;
+  }
+
   // Compute the derivative of the constraint functions
-  for (int i = 0; i < num_load_cases; i++) {
+  for (int i = 0, adjoint_index = num_load_cases; i < num_load_cases; i++) {
     assembler->setVariables(vars[i]);
 
     // Get the number of functions for each load case
     int num_funcs = load_case_info[i].num_funcs;
 
-    for (int j = 0; j < num_funcs; j++) {
-      TACSFunction *func = load_case_info[i].funcs[j];
-      TacsScalar scale = load_case_info[i].scale[j];
-
-      // Try to unwrap the vector
-      wrap = dynamic_cast<ParOptBVecWrap *>(Acvec[count + j]);
+    if (use_stored_adjoints) {
+      // Accumulate the contributions from all of the functions for
+      // this load case using the adjoints computed above with a single
+      // pass over the elements for each contribution. The derivatives
+      // are scaled afterwards since each function has its own scale.
+      TACSFunction **dv_funcs = new TACSFunction *[num_funcs];
+      TACSBVec **dv_vecs = new TACSBVec *[num_funcs];
+      TACSBVec **adj_vecs = new TACSBVec *[num_funcs];
+      TACSBVec **adj_dv_vecs = new TACSBVec *[num_funcs];
+
+      int nfuncs = 0, nadj = 0;
+      for (int j = 0; j < num_funcs; j++) {
+        TACSFunction *func = load_case_info[i].funcs[j];
+        wrap = dynamic_cast<ParOptBVecWrap *>(Acvec[count + j]);
+        if (wrap) {
+          TACSBVec *A = wrap->vec;
+          A->zeroEntries();
+          dv_funcs[nfuncs] = func;
+          dv_vecs[nfuncs] = A;
+          nfuncs++;
+
+          // The structural mass does not require an adjoint
+          if (!dynamic_cast<TACSStructuralMass *>(func)) {
+            adj_vecs[nadj] = adjoint_vecs[adjoint_index + j];
+            adj_dv_vecs[nadj] = A;
+            nadj++;
+          }
+        }
+      }
 
-      if (wrap) {
-        TACSBVec *A = wrap->vec;
-        A->zeroEntries();
+      if (nfuncs > 0) {
+        assembler->addDVSens(1.0, nfuncs, dv_funcs, dv_vecs);
+      }
+      if (nadj > 0) {
+        assembler->addAdjointResProducts(-1.0, nadj, adj_vecs, adj_dv_vecs);
+      }
 
-        // If the function is the structural mass, then do not
-        // use the adjoint, otherwise assume that we should use the
-        // adjoint method to compute the gradient.
-        int use_adjoint = 1;
-        if (dynamic_cast<TACSStructuralMass *>(func)) {
-          use_adjoint = 0;
+      for (int j = 0; j < num_funcs; j++) {
+        wrap = dynamic_cast<ParOptBVecWrap *>(Acvec[count + j]);
+        if (wrap) {
+          TACSBVec *A = wrap->vec;
+          A->scale(load_case_info[i].scale[j]);
+          startPhase(TMR_PROFILE_FILTER);
+          filter->addValues(A);
+          stopPhase(TMR_PROFILE_FILTER);
         }
-        if (use_adjoint) {
-          // Evaluate the right-hand-side
-          dfdu->zeroEntries();
-          double alpha = 1.0, beta = 0.0, gamma = 0.0;
-          assembler->addSVSens(alpha, beta, gamma, 1, &func, &dfdu);
-          assembler->applyBCs(dfdu);
+      }
 
-          // Solve the system of equations
-          ksm->solve(dfdu, adjoint);
+      delete[] dv_funcs;
+      delete[] dv_vecs;
+      delete[] adj_vecs;
+      delete[] adj_dv_vecs;
+    } else {
+      for (int j = 0; j < num_funcs; j++) {
+        TACSFunction *func = load_case_info[i].funcs[j];
+        TacsScalar scale = load_case_info[i].scale[j];
+
+        // Try to unwrap the vector
+        wrap = dynamic_cast<ParOptBVecWrap *>(Acvec[count + j]);
+
+        if (wrap) {
+          TACSBVec *A = wrap->vec;
+          A->zeroEntries();
+
+          // If the function is the structural mass, then do not
+          // use the adjoint, otherwise assume that we should use the
+          // adjoint method to compute the gradient.
+          int use_adjoint = 1;
+          if (dynamic_cast<TACSStructuralMass *>(func)) {
+            use_adjoint = 0;
+          }
+          if (use_adjoint) {
+            // Evaluate the right-hand-side
+            dfdu->zeroEntries();
+            double alpha = 1.0, beta = 0.0, gamma = 0.0;
+            assembler->addSVSens(alpha, beta, gamma, 1, &func, &dfdu);
+            assembler->applyBCs(dfdu);
+
+            // Solve the system of equations
+            startPhase(TMR_PROFILE_ADJOINT);
+            ksm->solve(dfdu, adjoint);
+            stopPhase(TMR_PROFILE_ADJOINT);
+
+            // Compute the total derivative using the adjoint
+            assembler->addDVSens(scale, 1, &func, &A);
+            assembler->addAdjointResProducts(-scale, 1, &adjoint, &A);
+          } else {
+            assembler->addDVSens(scale, 1, &func, &A);
+          }
 
-          // Compute the total derivative using the adjoint
-          assembler->addDVSens(scale, 1, &func, &A);
-          assembler->addAdjointResProducts(-scale, 1, &adjoint, &A);
-        } else {
-          assembler->addDVSens(scale, 1, &func, &A);
+          startPhase(TMR_PROFILE_FILTER);
+          filter->addValues(A);
+          stopPhase(TMR_PROFILE_FILTER);
         }
-
-        filter->addValues(A);
       }
     }
     count += num_funcs;
+    adjoint_index += num_funcs;
 
     if (freq && i == 0) {
       // Try to unwrap the vector
@@ -1406,7 +2182,9 @@ int TMRTopoProblem::evalObjConGradient(ParOptVec *xvec, ParOptVec *gvec,
         // Free the data
         temp->decref();
 
+        startPhase(TMR_PROFILE_FILTER);
         filter->addValues(A);
+        stopPhase(TMR_PROFILE_FILTER);
       }
 
       count++;
@@ -1455,7 +2233,9 @@ int TMRTopoProblem::evalObjConGradient(ParOptVec *xvec, ParOptVec *gvec,
         // Free the data
         temp->decref();
 
+        startPhase(TMR_PROFILE_FILTER);
         filter->addValues(A);
+        stopPhase(TMR_PROFILE_FILTER);
       }
       count++;
     }
@@ -1477,7 +2257,9 @@ int TMRTopoProblem::evalObjConGradient(ParOptVec *xvec, ParOptVec *gvec,
 
     for (int i = 0; i < num_callback_constraints; i++) {
       double vi_norm = vecs[i]->norm();
+      startPhase(TMR_PROFILE_FILTER);
       filter->addValues(vecs[i]);
+      stopPhase(TMR_PROFILE_FILTER);
       double fvi_norm = vecs[i]->norm();
       if (mpi_rank == 0) {
         printf("[TMRTopoProblem]unfiltered constraint gradient norm: %20.10e\n",
@@ -1489,6 +2271,8 @@ int TMRTopoProblem::evalObjConGradient(ParOptVec *xvec, ParOptVec *gvec,
     delete[] vecs;
   }
 
+  stopPhase(TMR_PROFILE_SENS);
+
   return 0;
 }
 
@@ -1507,6 +2291,9 @@ void TMRTopoProblem::useQnCorrectionComplianceObj() {
   x_h->incref();
   s_temp = createDesignVec();
   s_temp->incref();
+  comp_grad = createDesignVec();
+  comp_grad->incref();
+  comp_grad_valid = 0;
   return;
 }
 
@@ -1543,25 +2330,21 @@ void TMRTopoProblem::computeQuasiNewtonUpdateCorrection(
     ymod ~ P*s = (H + N)*s ~ y + N*s
   */
   if (use_qn_correction_comp_obj) {
-    // Zero out the vector that stores projected derivative
-    proj_deriv->zeroEntries();
     ParOptBVecWrap *proj_deriv_wrap =
         dynamic_cast<ParOptBVecWrap *>(proj_deriv);
+    if (!proj_deriv_wrap) {
+      return;
+    }
 
-    //[Test] Update design variable back to x and solve the system again
-    // setDesignVars(x);
-    // for ( int i = 0; i < num_load_cases; i++ ){
-    //   if (forces[i]){
-    //     ksm->solve(forces[i], vars[i]);
-    //     assembler->setBCs(vars[i]);
-    //     assembler->setVariables(vars[i]);
-    //   }
-    // }
-
-    // Compute first derivative at x
-    if (proj_deriv_wrap) {
+    // Compute first derivative at x. This is the compliance derivative
+    // stored by the last gradient evaluation, which used the states
+    // vars[i] at x. Only recompute it if the design has changed since.
+    if (comp_grad_valid) {
+      proj_deriv->copyValues(comp_grad);
+    } else {
+      setDesignVars(x);
+      proj_deriv->zeroEntries();
       for (int i = 0; i < num_load_cases; i++) {
-        // assembler->setVariables(vars[i]);
         assembler->addAdjointResProducts(-obj_weights[i], 1, &vars[i],
                                          &proj_deriv_wrap->vec);
       }
@@ -1575,13 +2358,10 @@ void TMRTopoProblem::computeQuasiNewtonUpdateCorrection(
     x_h->axpy(dh_Kmat_2nd_deriv, s);
     setDesignVars(x_h);
 
-    // Compute first derivative at x + h*s
-    if (proj_deriv_wrap) {
-      for (int i = 0; i < num_load_cases; i++) {
-        // assembler->setVariables(vars[i]);
-        assembler->addAdjointResProducts(obj_weights[i], 1, &vars[i],
-                                         &proj_deriv_wrap->vec);
-      }
+    // Compute first derivative at x + h*s with the same states
+    for (int i = 0; i < num_load_cases; i++) {
+      assembler->addAdjointResProducts(obj_weights[i], 1, &vars[i],
+                                       &proj_deriv_wrap->vec);
     }
 
     double dgx = proj_deriv->norm();
@@ -1595,8 +2375,6 @@ void TMRTopoProblem::computeQuasiNewtonUpdateCorrection(
 
     // Apply filter transpose to projected derivative
     filter->addValues(proj_deriv_wrap->vec);
-    // filter->applyTranspose(proj_deriv_wrap->vec, proj_deriv_wrap->vec);  //
-    // Same as addValues()
 
     double xval = x->norm();
     double sval = s->norm();
@@ -1609,7 +2387,7 @@ void TMRTopoProblem::computeQuasiNewtonUpdateCorrection(
       printf("Qn correction: norm of yupdate = %.5e\n", yup);
     }
 
-    // Test if y^Ts > 0
+    // Test if y^Ts > 0 for the update
     s_temp->copyValues(s);
     ParOptBVecWrap *s_temp_wrap = dynamic_cast<ParOptBVecWrap *>(s_temp);
     filter->applyTranspose(s_temp_wrap->vec, s_temp_wrap->vec);
@@ -1714,24 +2492,41 @@ void TMRTopoProblem::addSparseInnerProduct(double alpha, ParOptVec *x,
 */
 void TMRTopoProblem::writeOutput(int iter, ParOptVec *xvec) {
   ParOptBVecWrap *wrap = dynamic_cast<ParOptBVecWrap *>(xvec);
+  startPhase(TMR_PROFILE_OUTPUT);
+
   if (wrap && writeOutputCallback) {
     writeOutputCallback(output_callback_ptr, prefix, iter,
                         filter->getFilterOctForest(),
                         filter->getFilterQuadForest(), wrap->vec);
   }
 
+  // Complete the STL files from the previous call
+  completeSTLOutput();
+
   // Print out the binary STL file for later visualization
   if (prefix) {
-    // Write out the file at a cut off of 0.25
+    // Write out the file at a cut off of 0.5
     char filename[strlen(prefix) + 100];
 
+    if (async_output && !stl_requests) {
+      stl_requests = new TMRSTLFileRequest *[design_vars_per_node];
+      for (int k = 0; k < design_vars_per_node; k++) {
+        stl_requests[k] = NULL;
+      }
+    }
+
     for (int k = 0; k < design_vars_per_node; k++) {
       double cutoff = 0.5;
-      snprintf(filename, sizeof(filename),
-               "%s/levelset05_var%d_binary%04d.bstl", prefix, k, iter_count);
+      snprintf(filename, sizeof(filename), "%s/levelset05_var%d_%04d.stl",
+               prefix, k, iter_count);
 
-      // Write the STL file
-      filter->writeSTLFile(k, cutoff, filename);
+      // Write the STL file, or start writing it and complete the
+      // write at the next output
+      if (async_output) {
+        filter->beginWriteSTLFile(k, cutoff, filename, &stl_requests[k]);
+      } else {
+        filter->writeSTLFile(k, cutoff, filename);
+      }
     }
   }
 
@@ -1785,6 +2580,32 @@ void TMRTopoProblem::writeOutput(int iter, ParOptVec *xvec) {
     }
   }
 
+  stopPhase(TMR_PROFILE_OUTPUT);
+
+  // Write the accumulated profile for all iterations so far
+  if (prefix && profile_output) {
+    int mpi_rank;
+    MPI_Comm_rank(assembler->getMPIComm(), &mpi_rank);
+
+    char filename[strlen(prefix) + 100];
+    snprintf(filename, sizeof(filename), "%s/profile.dat", prefix);
+
+    FILE *fp = NULL;
+    if (mpi_rank == 0) {
+      fp = fopen(filename, "a");
+      if (fp) {
+        fprintf(fp, "iteration %d\n", iter_count);
+      } else {
+        fprintf(stderr, "TMRTopoProblem: Could not open file %s\n",
+                filename);
+      }
+    }
+    printProfile(fp);
+    if (fp) {
+      fclose(fp);
+    }
+  }
+
   // Update the iteration count
   iter_count++;
 }
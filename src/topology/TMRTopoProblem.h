@@ -27,6 +27,7 @@
 #include "TACSKSFailure.h"
 #include "TACSMg.h"
 #include "TACSStructuralMass.h"
+#include "TMRBlockGMRES.h"
 #include "TMROctForest.h"
 #include "TMRQuadForest.h"
 #include "TMRTopoFilter.h"
@@ -57,6 +58,27 @@ class ParOptBVecWrap : public ParOptVec {
   TACSBVec *vec;
 };
 
+// A monitor that counts the Krylov iterations
+class TMRIterCountPrint;
+
+/*
+  The phases of an optimization iteration that are timed by
+  TMRTopoProblem. The time recorded for each phase excludes the time
+  spent in any other phase that it calls.
+*/
+enum TMRTopoProfilePhase {
+  TMR_PROFILE_FILTER = 0,
+  TMR_PROFILE_ASSEMBLE,
+  TMR_PROFILE_FACTOR,
+  TMR_PROFILE_SOLVE,
+  TMR_PROFILE_EIGEN,
+  TMR_PROFILE_ADJOINT,
+  TMR_PROFILE_FUNCTIONS,
+  TMR_PROFILE_SENS,
+  TMR_PROFILE_OUTPUT,
+  TMR_PROFILE_NUM_PHASES
+};
+
 /*
   The implementation of the ParOptProblem class
 */
@@ -74,11 +96,31 @@ class TMRTopoProblem : public ParOptProblem {
   void setLoadCases(TACSBVec **_forces, int _num_load_cases);
   int getNumLoadCases();
 
+  // Solve the load cases and the adjoint equations together using a
+  // multiple right-hand-side solver (off by default)
+  // -----------------------------------------------------------------
+  void setUseBlockSolver(int flag);
+
+  // Solve the adjoint equations for all the functions of a load case
+  // together and evaluate their sensitivities in a single pass
+  // ----------------------------------------------------------------
+  void setUseMultiAdjoint(int flag);
+
+  // Reuse the solutions and factorizations between evaluations and
+  // lag the multigrid factorization (both off by default)
+  // --------------------------------------------------------------
+  void setReuseSolutions(int flag);
+  void setLaggedPreconditioner(int freq, double iter_ratio = 2.0);
+
   // Set the output frequency, element type and flags for f5 files
   // -------------------------------------------------------------
   void setF5OutputFlags(int freq, ElementType elem_type, int flag);
   void setF5EigenOutputFlags(int freq, ElementType elem_type, int flag);
 
+  // Complete the STL output in the background (off by default)
+  // -----------------------------------------------------------
+  void setAsyncOutput(int flag);
+
   // Add constraints associated with one of the load cases
   // -----------------------------------------------------
   void addConstraints(int _load_case, TACSFunction **_funcs,
@@ -90,7 +132,7 @@ class TMRTopoProblem : public ParOptProblem {
                               TacsScalar scale, int max_subspace_size,
                               double eigtol, int use_jd = 0,
                               int fgmres_size = 5, double eig_rtol = 1e-12,
-                              double eig_atol = 1e-30, int num_recycle = 0,
+                              double eig_atol = 1e-30, int num_recycle = -1,
                               JDRecycleType recycle_type = JD_NUM_RECYCLE);
   void addBucklingConstraint(double sigma, int num_eigvals,
                              TacsScalar ks_weight, TacsScalar offset,
@@ -212,6 +254,16 @@ class TMRTopoProblem : public ParOptProblem {
   // ---------------------
   void writeOutput(int iter, ParOptVec *x);
 
+  // Get, print and reset the time spent in each phase. Writing the
+  // profile to the prefix directory with the output is off by default
+  // ------------------------------------------------------------------
+  void setProfileOutput(int flag);
+  static const char *getProfilePhaseName(int phase);
+  void getProfilePhase(int phase, int *count, int *krylov_iters,
+                       double *tmin, double *tmax, double *tavg);
+  void printProfile(FILE *fp);
+  void resetProfile();
+
   void setOutputCallback(void *data,
                          void (*func)(void *, const char *, int, TMROctForest *,
                                       TMRQuadForest *, TACSBVec *)) {
@@ -246,6 +298,28 @@ class TMRTopoProblem : public ParOptProblem {
   // Set the design variables across all multigrid levels
   void setDesignVars(ParOptVec *xvec);
 
+  // Allocate the stored adjoint right-hand-sides and solutions
+  void allocateAdjointVecs(int n);
+
+  // Assemble the Jacobian for the load cases and adjoint equations
+  void assembleForwardJacobian();
+  void assembleAdjointJacobian();
+  int checkJacobianSymmetry();
+
+  // Create the monitor for the eigenvalue solvers
+  void createEigenMonitor();
+
+  // Complete any STL files that are still being written
+  void completeSTLOutput();
+
+  // Start and stop the timer for a phase
+  void startPhase(TMRTopoProfilePhase phase);
+  void stopPhase(TMRTopoProfilePhase phase, int krylov_iters = 0);
+
+  // Get the number of Krylov iterations since the last reset
+  int getKrylovIterCount();
+  void resetKrylovIterCount();
+
   // Store the prefix
   char *prefix;
 
@@ -285,6 +359,9 @@ class TMRTopoProblem : public ParOptProblem {
   TacsScalar buck_ks_weight;
   TacsScalar buck_offset, buck_scale;
 
+  // The monitor for the eigenvalue solvers
+  KSMPrint *eig_monitor;
+
   // The derivative of f(x,u) w.r.t. u and the adjoint variables
   TACSBVec *dfdu, *adjoint;
 
@@ -313,6 +390,34 @@ class TMRTopoProblem : public ParOptProblem {
   TACSKsm *ksm;
   TACSMg *mg;
 
+  // The multiple right-hand-side solver
+  int use_block_solver;
+  TMRBlockGMRES *block_ksm;
+  TMRIterCountPrint *ksm_monitor;
+
+  // The stored adjoint right-hand-sides and solutions. The first
+  // num_load_cases entries are for the objective and the remaining
+  // entries are for the constraint functions.
+  int num_adjoint_vecs;
+  TACSBVec **adjoint_rhs, **adjoint_vecs;
+
+  // Evaluate the constraint adjoints and sensitivities together
+  int use_multi_adjoint;
+
+  // Reuse the previous solutions as initial guesses and reuse the
+  // forward factorization for the adjoint of symmetric problems
+  int reuse_solutions;
+  int is_symmetric;
+  int mg_transpose;
+
+  // Data for the lagged multigrid factorization. When the factorization
+  // is lagged, the Jacobian is assembled into lag_mat and the Krylov
+  // solvers use the multigrid hierarchy from a previous design.
+  int lag_freq, lag_count;
+  double lag_iter_ratio;
+  int lag_ref_iters, lag_last_iters;
+  TACSMat *lag_mat;
+
   // The initial design variable values
   ParOptVec *xinit;
   ParOptVec *xlb, *xub;
@@ -322,6 +427,25 @@ class TMRTopoProblem : public ParOptProblem {
   ElementType f5_element_type, f5_eigen_element_type;
   int f5_write_flag, f5_eigen_write_flag;
 
+  // The STL files that are still being written when the output is
+  // asynchronous. These are completed at the next call to writeOutput.
+  int async_output;
+  TMRSTLFileRequest **stl_requests;
+
+  // The time, number of calls and Krylov iterations for each phase.
+  // The phases that are currently running are kept on a stack so that
+  // the time for a phase excludes the time for the phases it calls.
+  static const int MAX_PROFILE_DEPTH = 8;
+  int profile_output;
+  double profile_time[TMR_PROFILE_NUM_PHASES];
+  int profile_count[TMR_PROFILE_NUM_PHASES];
+  int profile_iters[TMR_PROFILE_NUM_PHASES];
+  int profile_depth;
+  TMRTopoProfilePhase profile_stack[MAX_PROFILE_DEPTH];
+  double profile_start[MAX_PROFILE_DEPTH];
+  double profile_mark;
+  int profile_iter_mark;
+
   // flag for quasi-Newton update correction
   int use_qn_correction_comp_obj;
 
@@ -330,6 +454,12 @@ class TMRTopoProblem : public ParOptProblem {
 
   // Vectors used by quasi-Newton update correction
   ParOptVec *proj_deriv, *x_h, *s_temp;
+
+  // The derivative of the weighted compliance with respect to the
+  // filtered design variables from the last gradient evaluation. This
+  // is only valid until the design variables are changed.
+  ParOptVec *comp_grad;
+  int comp_grad_valid;
 };
 
 #endif  // TMR_TOPO_PROBLEM_H
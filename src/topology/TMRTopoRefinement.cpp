@@ -0,0 +1,247 @@
+/*
+  This file is part of the package TMR for adaptive mesh refinement.
+
+  Copyright (C) 2015 Georgia Tech Research Corporation.
+  Additional copyright (C) 2015 Graeme Kennedy.
+  All rights reserved.
+
+  TMR is licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this software except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include "TMRTopoRefinement.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/*
+  Compute the range of the design values of one component over the
+  nodes of an element
+*/
+static void compute_value_range(TACSBVec *x, int len, const int *elem_conn,
+                                int index, TacsScalar *values, double *vmin,
+                                double *vmax) {
+  const int bsize = x->getBlockSize();
+  x->getValues(len, elem_conn, values);
+
+  *vmin = TacsRealPart(values[index]);
+  *vmax = *vmin;
+  for (int j = 1; j < len; j++) {
+    double value = TacsRealPart(values[bsize * j + index]);
+    if (value < *vmin) {
+      *vmin = value;
+    }
+    if (value > *vmax) {
+      *vmax = value;
+    }
+  }
+}
+
+/*
+  Apply the density-based criteria to the range of element values
+*/
+static int density_refine(double vmin, double vmax, double lower,
+                          double upper, int reverse) {
+  if (reverse) {
+    if (vmin >= upper) {
+      return -1;
+    } else if (vmin <= lower) {
+      return 1;
+    }
+  } else {
+    if (vmax >= upper) {
+      return 1;
+    } else if (vmax <= lower) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+/*
+  Apply the target-based criteria to an element away from the interface
+*/
+static int target_refine(double vmin, double vmax, int interior_refine,
+                         int reverse, double cutoff) {
+  if (reverse) {
+    if (vmin >= 1.0 - cutoff) {
+      return -1;
+    } else if (vmin <= cutoff) {
+      return interior_refine;
+    }
+  } else {
+    if (vmax >= 1.0 - cutoff) {
+      return interior_refine;
+    } else if (vmax <= cutoff) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+/*
+  Check that the design vector component is valid
+*/
+static int check_index(TACSBVec *x, int index, const char *name) {
+  if (index < 0 || index >= x->getBlockSize()) {
+    fprintf(stderr, "%s Error: Design component %d out of range [0,%d)\n",
+            name, index, x->getBlockSize());
+    return 0;
+  }
+  return 1;
+}
+
+/*
+  Compute the density-based refinement for the quadrilateral mesh
+*/
+void TMRDensityBasedRefine(TMRQuadForest *filter, TACSBVec *x, int index,
+                           double lower, double upper, int reverse,
+                           int refine[]) {
+  filter->createNodes();
+  const int order = filter->getMeshOrder();
+  const int len = order * order;
+  const int *conn;
+  int num_elements = 0;
+  filter->getNodeConn(&conn, &num_elements);
+  memset(refine, 0, num_elements * sizeof(int));
+  if (!check_index(x, index, "TMRDensityBasedRefine")) {
+    return;
+  }
+
+  // Distribute the design values
+  x->beginDistributeValues();
+  x->endDistributeValues();
+
+  TacsScalar *values = new TacsScalar[x->getBlockSize() * len];
+  for (int i = 0; i < num_elements; i++) {
+    double vmin, vmax;
+    compute_value_range(x, len, &conn[len * i], index, values, &vmin, &vmax);
+    refine[i] = density_refine(vmin, vmax, lower, upper, reverse);
+  }
+  delete[] values;
+}
+
+/*
+  Compute the density-based refinement for the hexahedral mesh
+*/
+void TMRDensityBasedRefine(TMROctForest *filter, TACSBVec *x, int index,
+                           double lower, double upper, int reverse,
+                           int refine[]) {
+  filter->createNodes();
+  const int order = filter->getMeshOrder();
+  const int len = order * order * order;
+  const int *conn;
+  int num_elements = 0;
+  filter->getNodeConn(&conn, &num_elements);
+  memset(refine, 0, num_elements * sizeof(int));
+  if (!check_index(x, index, "TMRDensityBasedRefine")) {
+    return;
+  }
+
+  // Distribute the design values
+  x->beginDistributeValues();
+  x->endDistributeValues();
+
+  TacsScalar *values = new TacsScalar[x->getBlockSize() * len];
+  for (int i = 0; i < num_elements; i++) {
+    double vmin, vmax;
+    compute_value_range(x, len, &conn[len * i], index, values, &vmin, &vmax);
+    refine[i] = density_refine(vmin, vmax, lower, upper, reverse);
+  }
+  delete[] values;
+}
+
+/*
+  Compute the target-based refinement for the quadrilateral mesh
+*/
+void TMRTargetRefine(TMRQuadForest *filter, TACSBVec *x, const double dist[],
+                     double refine_distance, int interface_lev,
+                     int interior_lev, int interior_index, int reverse,
+                     double cutoff, int refine[]) {
+  filter->createNodes();
+  const int order = filter->getMeshOrder();
+  const int len = order * order;
+  const int *conn;
+  int num_elements = 0;
+  filter->getNodeConn(&conn, &num_elements);
+  memset(refine, 0, num_elements * sizeof(int));
+  if (!check_index(x, interior_index, "TMRTargetRefine")) {
+    return;
+  }
+
+  // Get the quadrants for the element levels
+  TMRQuadrantArray *quad_array;
+  TMRQuadrant *quads;
+  filter->getQuadrants(&quad_array);
+  quad_array->getArray(&quads, NULL);
+
+  // Distribute the design values
+  x->beginDistributeValues();
+  x->endDistributeValues();
+
+  TacsScalar *values = new TacsScalar[x->getBlockSize() * len];
+  for (int i = 0; i < num_elements; i++) {
+    if (dist[i] <= refine_distance) {
+      refine[i] = interface_lev - quads[i].level;
+    } else {
+      double vmin, vmax;
+      compute_value_range(x, len, &conn[len * i], interior_index, values,
+                          &vmin, &vmax);
+      refine[i] = target_refine(vmin, vmax, interior_lev - quads[i].level,
+                                reverse, cutoff);
+    }
+  }
+  delete[] values;
+}
+
+/*
+  Compute the target-based refinement for the hexahedral mesh
+*/
+void TMRTargetRefine(TMROctForest *filter, TACSBVec *x, const double dist[],
+                     double refine_distance, int interface_lev,
+                     int interior_lev, int interior_index, int reverse,
+                     double cutoff, int refine[]) {
+  filter->createNodes();
+  const int order = filter->getMeshOrder();
+  const int len = order * order * order;
+  const int *conn;
+  int num_elements = 0;
+  filter->getNodeConn(&conn, &num_elements);
+  memset(refine, 0, num_elements * sizeof(int));
+  if (!check_index(x, interior_index, "TMRTargetRefine")) {
+    return;
+  }
+
+  // Get the octants for the element levels
+  TMROctantArray *oct_array;
+  TMROctant *octs;
+  filter->getOctants(&oct_array);
+  oct_array->getArray(&octs, NULL);
+
+  // Distribute the design values
+  x->beginDistributeValues();
+  x->endDistributeValues();
+
+  TacsScalar *values = new TacsScalar[x->getBlockSize() * len];
+  for (int i = 0; i < num_elements; i++) {
+    if (dist[i] <= refine_distance) {
+      refine[i] = interface_lev - octs[i].level;
+    } else {
+      double vmin, vmax;
+      compute_value_range(x, len, &conn[len * i], interior_index, values,
+                          &vmin, &vmax);
+      refine[i] = target_refine(vmin, vmax, interior_lev - octs[i].level,
+                                reverse, cutoff);
+    }
+  }
+  delete[] values;
+}
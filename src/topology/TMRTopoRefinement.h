@@ -0,0 +1,65 @@
+/*
+  This file is part of the package TMR for adaptive mesh refinement.
+
+  Copyright (C) 2015 Georgia Tech Research Corporation.
+  Additional copyright (C) 2015 Graeme Kennedy.
+  All rights reserved.
+
+  TMR is licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this software except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef TMR_TOPO_REFINEMENT_H
+#define TMR_TOPO_REFINEMENT_H
+
+#include "TACSAssembler.h"
+#include "TMROctForest.h"
+#include "TMRQuadForest.h"
+
+/*
+  Compute the refinement array for a density-based refinement criteria
+
+  The design vector x is defined on the nodes of the filter, whose
+  elements match the elements of the analysis forest. The component
+  index of the design values at the nodes of each filter element is
+  compared against the lower and upper bounds. Elements with a maximum
+  value above upper are refined, while elements with a maximum value
+  below lower are coarsened. When reverse is set, the minimum value is
+  used and the refinement and coarsening are swapped.
+*/
+void TMRDensityBasedRefine(TMRQuadForest *filter, TACSBVec *x, int index,
+                           double lower, double upper, int reverse,
+                           int refine[]);
+void TMRDensityBasedRefine(TMROctForest *filter, TACSBVec *x, int index,
+                           double lower, double upper, int reverse,
+                           int refine[]);
+
+/*
+  Compute the refinement array for a target-based refinement criteria
+
+  Elements within refine_distance of the interface (as given by the
+  element distances dist) are set to the interface level. The
+  remaining elements with design values of the interior component
+  beyond 1 - cutoff are set to the interior level, and the elements
+  with values below cutoff are coarsened. When reverse is set, low
+  design values are treated as the interior.
+*/
+void TMRTargetRefine(TMRQuadForest *filter, TACSBVec *x, const double dist[],
+                     double refine_distance, int interface_lev,
+                     int interior_lev, int interior_index, int reverse,
+                     double cutoff, int refine[]);
+void TMRTargetRefine(TMROctForest *filter, TACSBVec *x, const double dist[],
+                     double refine_distance, int interface_lev,
+                     int interior_lev, int interior_index, int reverse,
+                     double cutoff, int refine[]);
+
+#endif  // TMR_TOPO_REFINEMENT_H
@@ -0,0 +1,180 @@
+/*
+  This file is part of the package TMR for adaptive mesh refinement.
+
+  Copyright (C) 2015 Georgia Tech Research Corporation.
+  Additional copyright (C) 2015 Graeme Kennedy.
+  All rights reserved.
+
+  TMR is licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this software except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#include "TMRWeightPool.h"
+
+#include <string.h>
+
+#include "TMRHashFunction.h"
+
+/*
+  Compute a hash value from the bits of the weight values
+*/
+static uint32_t hashWeights(int n, const double *wvals) {
+  uint32_t hash = 0;
+  for (int i = 0; i < n; i++) {
+    uint32_t bits[2];
+    memcpy(bits, &wvals[i], sizeof(bits));
+    hash = TMRIntegerTripletHash(hash, bits[0], bits[1]);
+  }
+  return hash;
+}
+
+/*
+  Create the pool for the given number of weights per element and
+  number of elements
+*/
+TMRWeightPool::TMRWeightPool(int _nweights, int _num_elems) {
+  nweights = _nweights;
+  num_elems = _num_elems;
+  elem_index = new int[nweights * num_elems];
+  elem_pattern = new int[num_elems];
+  memset(elem_pattern, -1, num_elems * sizeof(int));
+
+  num_patterns = 0;
+  max_patterns = 64;
+  patterns = new double[nweights * max_patterns];
+
+  table_size = 2 * max_patterns;
+  table = new int[table_size];
+  memset(table, -1, table_size * sizeof(int));
+}
+
+/*
+  Free the pool
+*/
+TMRWeightPool::~TMRWeightPool() {
+  delete[] elem_index;
+  delete[] elem_pattern;
+  delete[] patterns;
+  delete[] table;
+}
+
+/*
+  Add a pattern of weight values if it does not already exist and
+  return its index
+*/
+int TMRWeightPool::addPattern(const double *wvals) {
+  // Search the hash table for an existing pattern
+  uint32_t mask = table_size - 1;
+  uint32_t slot = hashWeights(nweights, wvals) & mask;
+  while (table[slot] >= 0) {
+    const double *p = &patterns[nweights * table[slot]];
+    if (memcmp(p, wvals, nweights * sizeof(double)) == 0) {
+      return table[slot];
+    }
+    slot = (slot + 1) & mask;
+  }
+
+  // Add the new pattern
+  if (num_patterns >= max_patterns) {
+    max_patterns = 2 * max_patterns;
+    double *tmp = new double[nweights * max_patterns];
+    memcpy(tmp, patterns, nweights * num_patterns * sizeof(double));
+    delete[] patterns;
+    patterns = tmp;
+  }
+  memcpy(&patterns[nweights * num_patterns], wvals, nweights * sizeof(double));
+  table[slot] = num_patterns;
+  num_patterns++;
+
+  // Keep the table at most half full
+  if (2 * num_patterns > table_size) {
+    delete[] table;
+    table_size = 2 * table_size;
+    table = new int[table_size];
+    memset(table, -1, table_size * sizeof(int));
+
+    mask = table_size - 1;
+    for (int i = 0; i < num_patterns; i++) {
+      slot = hashWeights(nweights, &patterns[nweights * i]) & mask;
+      while (table[slot] >= 0) {
+        slot = (slot + 1) & mask;
+      }
+      table[slot] = i;
+    }
+  }
+
+  return num_patterns - 1;
+}
+
+/*
+  Set the weights for the given element
+
+  input:
+  elem:     the element index
+  weights:  the nweights indices and weights for the element
+
+  returns:  the pattern index for the element
+*/
+int TMRWeightPool::setElementWeights(int elem, const TMRIndexWeight *weights) {
+  double wvals[256];
+  double *w = wvals;
+  if (nweights > 256) {
+    w = new double[nweights];
+  }
+
+  int *index = &elem_index[nweights * elem];
+  for (int i = 0; i < nweights; i++) {
+    index[i] = weights[i].index;
+    w[i] = weights[i].weight;
+  }
+  elem_pattern[elem] = addPattern(w);
+
+  if (w != wvals) {
+    delete[] w;
+  }
+  return elem_pattern[elem];
+}
+
+/*
+  Get the design node indices and the weight pattern for an element
+
+  input:
+  elem:     the element index
+
+  output:
+  index:    the design node indices
+  weights:  the weight values shared by the elements with this pattern
+
+  returns:  the number of weights
+*/
+int TMRWeightPool::getElementWeights(int elem, const int **index,
+                                     const double **weights) {
+  if (index) {
+    *index = &elem_index[nweights * elem];
+  }
+  if (weights) {
+    *weights = &patterns[nweights * elem_pattern[elem]];
+  }
+  return nweights;
+}
+
+/*
+  Copy the indices and weights of an element into an array
+*/
+void TMRWeightPool::getElementWeights(int elem, TMRIndexWeight *weights) {
+  const int *index = &elem_index[nweights * elem];
+  const double *wvals = &patterns[nweights * elem_pattern[elem]];
+  for (int i = 0; i < nweights; i++) {
+    weights[i].index = index[i];
+    weights[i].weight = wvals[i];
+  }
+}
@@ -0,0 +1,91 @@
+/*
+  This file is part of the package TMR for adaptive mesh refinement.
+
+  Copyright (C) 2015 Georgia Tech Research Corporation.
+  Additional copyright (C) 2015 Graeme Kennedy.
+  All rights reserved.
+
+  TMR is licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this software except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+*/
+
+#ifndef TMR_WEIGHT_POOL_H
+#define TMR_WEIGHT_POOL_H
+
+#include "TMRBase.h"
+
+/*
+  A pool of the filter weights used by the elements in a topology
+  optimization problem.
+
+  The weights for each element are split into the indices of the
+  design nodes and the values of the weights. Elements that have the
+  same relative position within their enclosing filter element have
+  the same weight values, so each distinct set of values is stored
+  only once and each element stores its indices and the index of its
+  weight pattern. Patterns are matched exactly, so two elements share
+  a pattern only if their weights are bitwise identical.
+
+  The constitutive objects created with a pool look up the design node
+  indices and the weights by element index, so a single constitutive
+  and element object may be shared by all of the elements.
+*/
+class TMRWeightPool : public TMREntity {
+ public:
+  TMRWeightPool(int _nweights, int _num_elems);
+  ~TMRWeightPool();
+
+  // Set the weights of an element and return its pattern index
+  int setElementWeights(int elem, const TMRIndexWeight *weights);
+
+  // Get the weights of an element
+  int getElementWeights(int elem, const int **index, const double **weights);
+  void getElementWeights(int elem, TMRIndexWeight *weights);
+
+  // Get the pattern index of an element and the number of patterns
+  int getElementPattern(int elem) { return elem_pattern[elem]; }
+  int getNumPatterns() { return num_patterns; }
+  int getNumWeights() { return nweights; }
+  int getNumElements() { return num_elems; }
+
+  // Get the tables of indices, element patterns and weight patterns
+  void getElementTables(const int **index, const int **pattern) {
+    if (index) {
+      *index = elem_index;
+    }
+    if (pattern) {
+      *pattern = elem_pattern;
+    }
+  }
+  const double *getPatterns() { return patterns; }
+
+ private:
+  // Add a pattern to the hash table, returning the pattern index
+  int addPattern(const double *wvals);
+
+  // The number of weights per element and the number of elements
+  int nweights, num_elems;
+
+  // The design node indices and pattern index for each element
+  int *elem_index;
+  int *elem_pattern;
+
+  // The distinct weight patterns
+  int num_patterns, max_patterns;
+  double *patterns;
+
+  // Open-addressed hash table of the pattern indices
+  int table_size;
+  int *table;
+};
+
+#endif  // TMR_WEIGHT_POOL_H
@@ -33,14 +33,14 @@ static int compare_integers(const void *a, const void *b) {
 TMROctTACSTopoCreator::TMROctTACSTopoCreator(TMRBoundaryConditions *_bcs,
                                              int _design_vars_per_node,
                                              TMROctForest *_filter) {
-  int mpi_rank;
-  MPI_Comm comm = filter->getMPIComm();
-  MPI_Comm_rank(comm, &mpi_rank);
-
   // Create the nodes within the filter
   _filter->createNodes();
 
   initialize(_bcs, _design_vars_per_node, _filter);
+
+  // Set the filter indices and the weights to NULL
+  filter_indices = NULL;
+  weight_pool = NULL;
 }
 
 /*
@@ -50,6 +50,9 @@ TMROctTACSTopoCreator::~TMROctTACSTopoCreator() {
   if (filter_indices) {
     filter_indices->decref();
   }
+  if (weight_pool) {
+    weight_pool->decref();
+  }
 }
 
 void TMROctTACSTopoCreator::computeWeights(const int mesh_order,
@@ -119,6 +122,13 @@ void TMROctTACSTopoCreator::computeWeights(const int mesh_order,
   // Sort and sum the array of weights - there are only 8 nodes
   // per filter point at most
   nweights = TMRIndexWeight::uniqueSort(weights, nweights);
+
+  // Pad the weights with zeros, so that the unused entries do not
+  // contain the weights from a previous point
+  for (; nweights < order * order * order; nweights++) {
+    weights[nweights].index = weights[0].index;
+    weights[nweights].weight = 0.0;
+  }
 }
 
 /*
@@ -343,6 +353,9 @@ void TMROctTACSTopoCreator::createElements(int order, TMROctForest *forest,
 
   // Set up the external filter indices for this filter.  The indices
   // objects steals the array for the external nodes.
+  if (filter_indices) {
+    filter_indices->decref();
+  }
   filter_indices = new TACSBVecIndices(&ext_node_nums, num_ext_nodes);
   filter_indices->incref();
   filter_indices->setUpInverse();
@@ -359,15 +372,46 @@ void TMROctTACSTopoCreator::createElements(int order, TMROctForest *forest,
     weights[i].index = node;
   }
 
-  // Loop over the octants
-  octants->getArray(&octs, &num_octs);
+  // Store the weights in the pool. The pattern of weight values is
+  // shared between elements with the same relative position within
+  // the filter.
+  if (weight_pool) {
+    weight_pool->decref();
+  }
+  weight_pool = new TMRWeightPool(nweights, num_octs);
+  weight_pool->incref();
   for (int i = 0; i < num_octs; i++) {
-    // Allocate the stiffness object
-    elements[i] =
-        createElement(order, &octs[i], nweights, &weights[nweights * i]);
+    weight_pool->setElementWeights(i, &weights[nweights * i]);
   }
-
   delete[] weights;
+
+  // Get the array of octants
+  octants->getArray(&octs, &num_octs);
+
+  // Create all of the elements at once if this creator shares the
+  // element objects
+  if (createPooledElements(order, num_octs, octs, weight_pool, elements)) {
+    return;
+  }
+
+  // Allocate the stiffness objects, in parallel if createElement() is
+  // thread safe
+#ifdef TMR_HAS_OPENMP
+#pragma omp parallel if (thread_safe_elements)
+#endif  // TMR_HAS_OPENMP
+  {
+    TMRIndexWeight *elem_weights = new TMRIndexWeight[nweights];
+
+#ifdef TMR_HAS_OPENMP
+#pragma omp for schedule(dynamic, 64)
+#endif  // TMR_HAS_OPENMP
+    for (int i = 0; i < num_octs; i++) {
+      weight_pool->getElementWeights(i, elem_weights);
+      elements[i] = createElement(order, &octs[i], nweights, elem_weights);
+    }
+
+    delete[] elem_weights;
+  }
 }
 
 /*
@@ -377,15 +421,12 @@ TMRQuadTACSTopoCreator::TMRQuadTACSTopoCreator(TMRBoundaryConditions *_bcs,
                                                int _design_vars_per_node,
                                                TMRQuadForest *_filter)
     : TMRQuadTACSCreator(_bcs, _design_vars_per_node, _filter) {
-  int mpi_rank;
-  MPI_Comm comm = filter->getMPIComm();
-  MPI_Comm_rank(comm, &mpi_rank);
-
   // Create the nodes within the filter
   filter->createNodes();
 
-  // Set the filter indices to NULL
+  // Set the filter indices and the weights to NULL
   filter_indices = NULL;
+  weight_pool = NULL;
 }
 
 /*
@@ -395,6 +436,9 @@ TMRQuadTACSTopoCreator::~TMRQuadTACSTopoCreator() {
   if (filter_indices) {
     filter_indices->decref();
   }
+  if (weight_pool) {
+    weight_pool->decref();
+  }
 }
 
 /*
@@ -461,6 +505,13 @@ void TMRQuadTACSTopoCreator::computeWeights(
     // Sort and sum the array of weights - there are only 8 nodes
     // per filter point at most
     nweights = TMRIndexWeight::uniqueSort(weights, nweights);
+
+    // Pad the weights with zeros, so that the unused entries do not
+    // contain the weights from a previous point
+    for (; nweights < order * order; nweights++) {
+      weights[nweights].index = weights[0].index;
+      weights[nweights].weight = 0.0;
+    }
   }
 }
 
@@ -681,6 +732,9 @@ void TMRQuadTACSTopoCreator::createElements(int order, TMRQuadForest *forest,
 
   // Set up the external filter indices for this filter.  The indices
   // objects steals the array for the external nodes.
+  if (filter_indices) {
+    filter_indices->decref();
+  }
   filter_indices = new TACSBVecIndices(&ext_node_nums, num_ext_nodes);
   filter_indices->incref();
   filter_indices->setUpInverse();
@@ -697,15 +751,46 @@ void TMRQuadTACSTopoCreator::createElements(int order, TMRQuadForest *forest,
     weights[i].index = node;
   }
 
-  // Loop over the octants
-  quadrants->getArray(&quads, &num_quads);
+  // Store the weights in the pool. The pattern of weight values is
+  // shared between elements with the same relative position within
+  // the filter.
+  if (weight_pool) {
+    weight_pool->decref();
+  }
+  weight_pool = new TMRWeightPool(nweights, num_quads);
+  weight_pool->incref();
   for (int i = 0; i < num_quads; i++) {
-    // Allocate the stiffness object
-    elements[i] =
-        createElement(order, &quads[i], nweights, &weights[nweights * i]);
+    weight_pool->setElementWeights(i, &weights[nweights * i]);
   }
-  // Free the weights
   delete[] weights;
+
+  // Get the array of quadrants
+  quadrants->getArray(&quads, &num_quads);
+
+  // Create all of the elements at once if this creator shares the
+  // element objects
+  if (createPooledElements(order, num_quads, quads, weight_pool, elements)) {
+    return;
+  }
+
+  // Allocate the stiffness objects, in parallel if createElement() is
+  // thread safe
+#ifdef TMR_HAS_OPENMP
+#pragma omp parallel if (thread_safe_elements)
+#endif  // TMR_HAS_OPENMP
+  {
+    TMRIndexWeight *elem_weights = new TMRIndexWeight[nweights];
+
+#ifdef TMR_HAS_OPENMP
+#pragma omp for schedule(dynamic, 64)
+#endif  // TMR_HAS_OPENMP
+    for (int i = 0; i < num_quads; i++) {
+      weight_pool->getElementWeights(i, elem_weights);
+      elements[i] = createElement(order, &quads[i], nweights, elem_weights);
+    }
+
+    delete[] elem_weights;
+  }
 }
 
 /*
@@ -769,8 +854,13 @@ void TMROctConformTACSTopoCreator::createElements(int order,
 
   // Loop over the octants
   octants->getArray(&octs, &num_octs);
+
+  // Allocate the stiffness objects, in parallel if createElement() is
+  // thread safe
+#ifdef TMR_HAS_OPENMP
+#pragma omp parallel for schedule(dynamic, 64) if (thread_safe_elements)
+#endif  // TMR_HAS_OPENMP
   for (int i = 0; i < num_octs; i++) {
-    // Allocate the stiffness object
     elements[i] =
         createElement(order, &octs[i], nweights, &conn[nweights * i], filter);
   }
@@ -837,8 +927,13 @@ void TMRQuadConformTACSTopoCreator::createElements(int order,
 
   // Loop over the octants
   quadrants->getArray(&quads, &num_quads);
+
+  // Allocate the stiffness objects, in parallel if createElement() is
+  // thread safe
+#ifdef TMR_HAS_OPENMP
+#pragma omp parallel for schedule(dynamic, 64) if (thread_safe_elements)
+#endif  // TMR_HAS_OPENMP
   for (int i = 0; i < num_quads; i++) {
-    // Allocate the stiffness object
     elements[i] =
         createElement(order, &quads[i], nweights, &conn[nweights * i], filter);
   }
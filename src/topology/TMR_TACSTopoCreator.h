@@ -22,6 +22,7 @@
 #define TMR_TACS_TOPO_CREATOR_H
 
 #include "TACSAssembler.h"
+#include "TMRWeightPool.h"
 #include "TMR_TACSCreator.h"
 
 /*
@@ -44,6 +45,18 @@ class TMROctTACSTopoCreator : public TMROctTACSCreator {
   virtual TACSElement *createElement(int order, TMROctant *oct, int nweights,
                                      TMRIndexWeight *weights) = 0;
 
+  // Create all of the elements from the pool of filter weights. This
+  // returns a non-zero value if the elements were created, otherwise
+  // createElement() is called for each element.
+  virtual int createPooledElements(int order, int num_elements, TMROctant *octs,
+                                   TMRWeightPool *pool,
+                                   TACSElement **elements) {
+    return 0;
+  }
+
+  // Get the filter weights from the last call to createElements()
+  TMRWeightPool *getWeightPool() { return weight_pool; }
+
  private:
   // Compute the weights for a given point
   void computeWeights(const int mesh_order, const double *knots,
@@ -54,6 +67,9 @@ class TMROctTACSTopoCreator : public TMROctTACSCreator {
   // local design variable numbers and the global design variable
   // numbers.
   TACSBVecIndices *filter_indices;
+
+  // The filter weights for each element
+  TMRWeightPool *weight_pool;
 };
 
 /*
@@ -74,6 +90,18 @@ class TMRQuadTACSTopoCreator : public TMRQuadTACSCreator {
   virtual TACSElement *createElement(int order, TMRQuadrant *oct, int nweights,
                                      TMRIndexWeight *weights) = 0;
 
+  // Create all of the elements from the pool of filter weights. This
+  // returns a non-zero value if the elements were created, otherwise
+  // createElement() is called for each element.
+  virtual int createPooledElements(int order, int num_elements,
+                                   TMRQuadrant *quads, TMRWeightPool *pool,
+                                   TACSElement **elements) {
+    return 0;
+  }
+
+  // Get the filter weights from the last call to createElements()
+  TMRWeightPool *getWeightPool() { return weight_pool; }
+
  private:
   // Compute the weights for a given point
   void computeWeights(const int mesh_order, const double *knots,
@@ -84,6 +112,9 @@ class TMRQuadTACSTopoCreator : public TMRQuadTACSCreator {
   // local design variable numbers and the global design variable
   // numbers.
   TACSBVecIndices *filter_indices;
+
+  // The filter weights for each element
+  TMRWeightPool *weight_pool;
 };
 
 /*
@@ -1,4 +1,7 @@
 import os
+import shutil
+import tempfile
+import numpy as np
 from egads4py import egads
 from mpi4py import MPI
 from tmr import TMR
@@ -102,3 +105,239 @@ class EgadsTest(unittest.TestCase):
         forest.balance(1)
 
         return
+
+
+def create_block_geometry():
+    """Create the two stacked blocks with cylindrical cutouts"""
+    ctx = egads.context()
+
+    # Set the dimensions/parameters
+    h1 = 10.0
+    h2 = 15.0
+    Lx = 100.0
+    Ly = 100.0
+    r1 = 15.0
+    r2 = 25.0
+    cx1 = 35.0
+    cy1 = 35.0
+
+    parts = []
+
+    # Create the lower box and its cutouts
+    B1 = ctx.makeSolidBody(egads.BOX, rdata=[[0, 0, 0], [Lx, Ly, h1]])
+    C12 = ctx.makeSolidBody(egads.CYLINDER, rdata=[[cx1, cy1, 0], [cx1, cy1, h1], r2])
+    C11 = ctx.makeSolidBody(egads.CYLINDER, rdata=[[cx1, cy1, 0], [cx1, cy1, h1], r1])
+    parts.append(C12.solidBoolean(C11, egads.SUBTRACTION))
+    parts.append(B1.solidBoolean(C12, egads.SUBTRACTION))
+
+    # Create the upper box and its cutout
+    B2 = ctx.makeSolidBody(egads.BOX, rdata=[[0, 0, h1], [Lx, Ly, h2]])
+    C21 = ctx.makeSolidBody(
+        egads.CYLINDER, rdata=[[cx1, cy1, h1], [cx1, cy1, h1 + h2], r2]
+    )
+    parts.append(B2.solidBoolean(C21, egads.SUBTRACTION))
+
+    geos = []
+    for p in parts:
+        geos.append(TMR.ConvertEGADSModel(p))
+
+    verts = []
+    edges = []
+    faces = []
+    vols = []
+    for geo in geos:
+        verts.extend(geo.getVertices())
+        edges.extend(geo.getEdges())
+        faces.extend(geo.getFaces())
+        vols.extend(geo.getVolumes())
+
+    TMR.setMatchingFaces(geos)
+
+    # Keep the contexts alive with the model
+    return TMR.Model(verts, edges, faces, vols), ctx
+
+
+class DistributedMeshTest(unittest.TestCase):
+    N_PROCS = 2
+
+    def test_counts(self):
+        comm = MPI.COMM_WORLD
+        htarget = 4.0
+
+        # Mesh the geometry on each processor independently
+        geo, ctx = create_block_geometry()
+        mesh = TMR.Mesh(MPI.COMM_SELF, geo)
+        opts = TMR.MeshOptions()
+        opts.write_mesh_quality_histogram = 0
+        mesh.mesh(htarget, opts)
+        X_serial = mesh.getMeshPoints()
+        nhex_serial = mesh.getHexConnectivity().shape[0]
+        self.assertGreater(nhex_serial, 0)
+
+        # Mesh the geometry again in the distributed mode
+        geo, ctx = create_block_geometry()
+        mesh = TMR.Mesh(comm, geo)
+        opts = TMR.MeshOptions()
+        opts.write_mesh_quality_histogram = 0
+        opts.distribute_mesh = True
+        mesh.mesh(htarget, opts)
+
+        # Check the ownership range against the serial node count
+        node_range = mesh.getNodeRange()
+        self.assertIsNotNone(node_range)
+        self.assertEqual(node_range[0], 0)
+        self.assertEqual(node_range[-1], X_serial.shape[0])
+        self.assertTrue(np.all(node_range[1:] >= node_range[:-1]))
+
+        # The owned nodes are followed by the ghost nodes, which must be
+        # owned by other processors
+        X = mesh.getMeshPoints()
+        ghosts = mesh.getGhostNodes()
+        lo = node_range[comm.rank]
+        hi = node_range[comm.rank + 1]
+        nowned = hi - lo
+        self.assertEqual(X.shape[0], nowned + ghosts.shape[0])
+        if ghosts.shape[0] > 0:
+            self.assertTrue(np.all(ghosts < node_range[-1]))
+            self.assertFalse(np.any((ghosts >= lo) & (ghosts < hi)))
+
+        # Each element is stored on exactly one processor
+        hexes = mesh.getHexConnectivity()
+        self.assertEqual(comm.allreduce(hexes.shape[0]), nhex_serial)
+        if hexes.shape[0] > 0:
+            self.assertTrue(np.all(hexes >= 0))
+            self.assertTrue(np.all(hexes < X.shape[0]))
+
+        # The owned nodes are the serial nodes in a different order
+        xsum = comm.allreduce(np.sum(X[:nowned], axis=0))
+        self.assertTrue(np.allclose(xsum, np.sum(X_serial, axis=0)))
+        return
+
+    def test_write(self):
+        comm = MPI.COMM_WORLD
+        htarget = 8.0
+
+        geo, ctx = create_block_geometry()
+        mesh = TMR.Mesh(comm, geo)
+        opts = TMR.MeshOptions()
+        opts.write_mesh_quality_histogram = 0
+        opts.distribute_mesh = True
+        mesh.mesh(htarget, opts)
+        nnodes = mesh.getNodeRange()[-1]
+        nhex = comm.allreduce(mesh.getHexConnectivity().shape[0])
+
+        # Each processor creates the model of its local part of the mesh
+        model = mesh.createModelFromMesh()
+        self.assertEqual(len(model.getVertices()), mesh.getMeshPoints().shape[0])
+        self.assertEqual(comm.allreduce(len(model.getVolumes())), nhex)
+
+        # The pieces from each processor are written to the same file
+        tmpdir = None
+        if comm.rank == 0:
+            tmpdir = tempfile.mkdtemp()
+        tmpdir = comm.bcast(tmpdir, root=0)
+        bdf_file = os.path.join(tmpdir, "blocks.bdf")
+        vtk_file = os.path.join(tmpdir, "blocks.vtk")
+        mesh.writeToBDF(bdf_file, "hex")
+        mesh.writeToVTK(vtk_file, "hex")
+        mesh.writeToVTU(os.path.join(tmpdir, "blocks.vtu"), "hex")
+        comm.Barrier()
+
+        if comm.rank == 0:
+            with open(bdf_file, "r") as fp:
+                lines = fp.readlines()
+            grids = [int(line[8:24]) for line in lines if line.startswith("GRID*")]
+            elems = [int(line[8:16]) for line in lines if line.startswith("CHEXA")]
+            self.assertEqual(sorted(grids), list(range(1, nnodes + 1)))
+            self.assertEqual(sorted(elems), list(range(1, nhex + 1)))
+            self.assertEqual(lines[-1], "ENDDATA\n")
+
+            with open(vtk_file, "r") as fp:
+                text = fp.read()
+            self.assertIn("POINTS %d float" % nnodes, text)
+            self.assertIn("CELLS %d %d" % (nhex, 9 * nhex), text)
+
+            self.assertTrue(os.path.isfile(os.path.join(tmpdir, "blocks.pvtu")))
+            for rank in range(comm.size):
+                piece = os.path.join(tmpdir, "blocks_%d.vtu" % rank)
+                self.assertTrue(os.path.isfile(piece))
+            shutil.rmtree(tmpdir)
+        return
+
+
+class DistributedMeshTest4(DistributedMeshTest):
+    N_PROCS = 4
+
+
+class NameIndexTest(unittest.TestCase):
+    def test_rename(self):
+        comm = MPI.COMM_SELF
+
+        # Create the topology from the mesh of the blocks
+        geo, ctx = create_block_geometry()
+        mesh = TMR.Mesh(comm, geo)
+        opts = TMR.MeshOptions()
+        opts.write_mesh_quality_histogram = 0
+        mesh.mesh(8.0, opts)
+        model = mesh.createModelFromMesh()
+        topo = TMR.Topology(comm, model)
+
+        forest = TMR.OctForest(comm)
+        forest.setTopology(topo)
+        forest.createTrees(1)
+        forest.createNodes()
+
+        # All the nodes lie within one of the named volumes
+        for i in range(len(model.getVolumes())):
+            topo.getVolume(i).setName("solid")
+        conn = forest.getMeshConn()
+        nodes = forest.getNodesWithName("solid")
+        self.assertTrue(np.array_equal(nodes, np.unique(conn)))
+
+        # Rename a face after the index has been created
+        face = topo.getFace(0)
+        face.setName("side")
+        nodes = forest.getNodesWithName("side")
+        nocts = len(forest.getOctsWithName("side"))
+        self.assertGreater(len(nodes), 0)
+        self.assertGreater(nocts, 0)
+
+        face.setName("top")
+        self.assertEqual(len(forest.getNodesWithName("side")), 0)
+        self.assertEqual(len(forest.getOctsWithName("side")), 0)
+        self.assertTrue(np.array_equal(forest.getNodesWithName("top"), nodes))
+        self.assertEqual(len(forest.getOctsWithName("top")), nocts)
+        return
+
+
+class MeshCacheTest(unittest.TestCase):
+    def mesh_blocks(self, htarget, cache_file=None):
+        geo, ctx = create_block_geometry()
+        mesh = TMR.Mesh(MPI.COMM_SELF, geo)
+        opts = TMR.MeshOptions()
+        opts.write_mesh_quality_histogram = 0
+        mesh.mesh(htarget, opts, cache_file=cache_file)
+        return mesh.getMeshPoints(), mesh.getHexConnectivity()
+
+    def test_cache(self):
+        with tempfile.TemporaryDirectory() as tmpdir:
+            cache_file = os.path.join(tmpdir, "blocks.cache")
+
+            # Write the cache and check that it gives the same mesh
+            X0, hex0 = self.mesh_blocks(8.0)
+            X1, hex1 = self.mesh_blocks(8.0, cache_file)
+            self.assertTrue(os.path.isfile(cache_file))
+            self.assertTrue(np.allclose(X0, X1))
+            self.assertTrue(np.array_equal(hex0, hex1))
+
+            # Re-use the meshes stored in the cache
+            X2, hex2 = self.mesh_blocks(8.0, cache_file)
+            self.assertTrue(np.allclose(X0, X2))
+            self.assertTrue(np.array_equal(hex0, hex2))
+
+            # A new spacing must not re-use the cached meshes
+            X3, hex3 = self.mesh_blocks(6.0)
+            X4, hex4 = self.mesh_blocks(6.0, cache_file)
+            self.assertTrue(np.allclose(X3, X4))
+            self.assertTrue(np.array_equal(hex3, hex4))
+        return
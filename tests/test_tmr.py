@@ -1,5 +1,9 @@
+import os
+import shutil
+import tempfile
 import numpy as np
 from mpi4py import MPI
+from tacs import TACS, constitutive, elements
 from tmr import TMR
 import unittest
 
@@ -334,3 +338,514 @@ class BsplineTest(unittest.TestCase):
         mesh.mesh(hval)
 
         return
+
+
+class ForestArrayViewTest(unittest.TestCase):
+    def create_forest(self):
+        # Create a forest of a single octree without a topology
+        forest = TMR.OctForest(MPI.COMM_WORLD)
+        forest.setConnectivity(np.arange(8, dtype=np.intc).reshape(1, 8))
+        forest.createTrees(2)
+        forest.createNodes()
+        return forest
+
+    def test_copy(self):
+        forest = self.create_forest()
+
+        # The arrays are writeable copies by default
+        conn = forest.getMeshConn()
+        X = forest.getPoints()
+        self.assertTrue(conn.flags.writeable)
+        self.assertTrue(X.flags.writeable)
+        X[:] += 1.0
+        self.assertFalse(np.allclose(X, forest.getPoints()))
+
+        # The forest can be modified while copies exist
+        forest.refine()
+        forest.balance(1)
+        forest.createNodes()
+        self.assertEqual(conn.shape[1], 8)
+        return
+
+    def test_view(self):
+        forest = self.create_forest()
+
+        # The views are read-only and share the data of the forest
+        conn = forest.getMeshConn(copy=False)
+        self.assertFalse(conn.flags.writeable)
+        self.assertTrue(np.array_equal(conn, forest.getMeshConn()))
+        with self.assertRaises(ValueError):
+            conn[0, 0] = -1
+
+        # The forest cannot be modified while a view, or an array derived
+        # from a view, exists
+        first = conn[0]
+        del conn
+        with self.assertRaises(BufferError):
+            forest.refine()
+        del first
+
+        # Once the views are deleted the forest can be modified
+        forest.refine()
+        forest.balance(1)
+        forest.createNodes()
+        self.assertGreater(forest.getMeshConn().shape[0], 0)
+        return
+
+
+def set_owned_values(forest, func, vec):
+    """Set the values of func at the nodes owned by this processor"""
+    comm = MPI.COMM_WORLD
+    node_range = forest.getNodeRange()
+    X = forest.getPoints()
+    nodes = forest.getNodeNumbers()
+    owned = (nodes >= node_range[comm.rank]) & (nodes < node_range[comm.rank + 1])
+    array = vec.getArray()
+    array[nodes[owned] - node_range[comm.rank]] = func(X[owned])
+    return
+
+
+class InterpolationTest(unittest.TestCase):
+    def test_coarsen(self):
+        comm = MPI.COMM_WORLD
+
+        def func(X):
+            return X[:, 0] + 2.0 * X[:, 1] - X[:, 2] + X[:, 0] * X[:, 1] * X[:, 2]
+
+        # Create a uniform third-order forest and coarsen it by one level,
+        # so that many fine nodes coincide with the coarse nodes
+        fine = TMR.OctForest(comm)
+        fine.setConnectivity(np.arange(8, dtype=np.intc).reshape(1, 8))
+        fine.createTrees(2)
+        fine.repartition()
+        fine.setMeshOrder(3, TMR.GAUSS_LOBATTO_POINTS)
+        fine.createNodes()
+
+        coarse = fine.coarsen()
+        coarse.setMeshOrder(3, TMR.GAUSS_LOBATTO_POINTS)
+        coarse.createNodes()
+
+        maps = []
+        for forest in [coarse, fine]:
+            node_range = forest.getNodeRange()
+            n = node_range[comm.rank + 1] - node_range[comm.rank]
+            maps.append(TACS.NodeMap(comm, n))
+        coarse_map, fine_map = maps
+
+        interp = TACS.VecInterp(coarse_map, fine_map, 1)
+        fine.createInterpolation(coarse, interp)
+        interp.initialize()
+
+        # The interpolation reproduces a trilinear field exactly, so
+        # dropping the zero weights must not change the result
+        coarse_vec = TACS.Vec(coarse_map, 1)
+        fine_vec = TACS.Vec(fine_map, 1)
+        set_owned_values(coarse, func, coarse_vec)
+        interp.mult(coarse_vec, fine_vec)
+
+        expected = TACS.Vec(fine_map, 1)
+        set_owned_values(fine, func, expected)
+        self.assertTrue(np.allclose(fine_vec.getArray(), expected.getArray()))
+        return
+
+
+class OctForestHierarchyTest(unittest.TestCase):
+    N_PROCS = 2
+
+    def test_interpolation(self):
+        comm = MPI.COMM_WORLD
+
+        def func(X):
+            return np.sin(X[:, 0]) * np.cos(2.0 * X[:, 1]) + np.exp(X[:, 2])
+
+        # Create four levels from a refined third-order forest: the order is
+        # reduced once, then the forest is coarsened twice
+        forest = create_refined_forest()
+        forest.setMeshOrder(3, TMR.GAUSS_LOBATTO_POINTS)
+        hierarchy = TMR.OctForestHierarchy(forest, 4, 2, 1, True)
+        forests = hierarchy.getForests()
+        self.assertEqual(hierarchy.getNumLevels(), 4)
+        self.assertEqual([f.getMeshOrder() for f in forests], [3, 2, 2, 2])
+
+        maps = []
+        for f in forests:
+            node_range = f.getNodeRange()
+            n = node_range[comm.rank + 1] - node_range[comm.rank]
+            maps.append(TACS.NodeMap(comm, n))
+
+        # Create the interpolation for all levels together and level by level
+        batched = []
+        single = []
+        for i in range(3):
+            batched.append(TACS.VecInterp(maps[i + 1], maps[i], 1))
+            single.append(TACS.VecInterp(maps[i + 1], maps[i], 1))
+            forests[i].createInterpolation(forests[i + 1], single[i])
+        hierarchy.createInterpolation(batched)
+
+        # The operators give the same result on every level
+        for i in range(3):
+            batched[i].initialize()
+            single[i].initialize()
+            coarse_vec = TACS.Vec(maps[i + 1], 1)
+            set_owned_values(forests[i + 1], func, coarse_vec)
+            vecs = [TACS.Vec(maps[i], 1), TACS.Vec(maps[i], 1)]
+            batched[i].mult(coarse_vec, vecs[0])
+            single[i].mult(coarse_vec, vecs[1])
+            self.assertTrue(np.allclose(vecs[0].getArray(), vecs[1].getArray()))
+        return
+
+
+def gather_octants(forest):
+    """Gather the sorted list of octants on all processors"""
+    octs = [(o.block, o.x, o.y, o.z, o.level) for o in forest.getOctants()]
+    octs = MPI.COMM_WORLD.allgather(octs)
+    return sorted([o for proc in octs for o in proc])
+
+
+def create_refined_forest():
+    """Create a two-block octree forest with a local refinement"""
+    conn = np.array(
+        [[0, 1, 3, 4, 6, 7, 9, 10], [8, 11, 2, 5, 7, 10, 1, 4]], dtype=np.intc
+    )
+    forest = TMR.OctForest(MPI.COMM_WORLD)
+    forest.setConnectivity(conn)
+    forest.createTrees(2)
+    forest.repartition()
+
+    # Refine every third element by up to two levels
+    refine = np.zeros(len(forest.getOctants()), dtype=np.intc)
+    refine[::3] = 2
+    refine[1::3] = 1
+    forest.refine(refine)
+    forest.balance(1)
+    return forest
+
+
+class RefineAndBalanceTest(unittest.TestCase):
+    def test_refine(self):
+        for btype in [0, 1]:
+            forest = create_refined_forest()
+            fused = forest.duplicate()
+
+            refine = np.zeros(len(forest.getOctants()), dtype=np.intc)
+            refine[::5] = 1
+            refine[1::7] = -1
+
+            # The fused operation gives the same mesh as refine and balance
+            forest.refine(refine, max_lev=4)
+            forest.balance(btype)
+            fused.refineAndBalance(refine, max_lev=4, btype=btype)
+            self.assertEqual(gather_octants(fused), gather_octants(forest))
+        return
+
+    def test_levels(self):
+        forest = create_refined_forest()
+        fused = forest.duplicate()
+
+        # Set the target levels directly
+        levels = np.array([o.level for o in forest.getOctants()], dtype=np.intc)
+        levels[::4] += 1
+        forest.refine(levels - np.array([o.level for o in forest.getOctants()]))
+        forest.balance(0)
+        fused.refineAndBalance(levels=levels)
+        self.assertEqual(gather_octants(fused), gather_octants(forest))
+        return
+
+
+class IncrementalNodesTest(unittest.TestCase):
+    def test_nodes(self):
+        forest = create_refined_forest()
+        forest.setMeshOrder(3, TMR.GAUSS_LOBATTO_POINTS)
+        forest.setUseIncrementalNodes(1)
+        forest.createNodes()
+
+        for i in range(3):
+            refine = np.zeros(len(forest.getOctants()), dtype=np.intc)
+            refine[i::5] = 1
+            refine[i + 1 :: 7] = -1
+            forest.refine(refine, max_lev=4)
+            forest.balance(1)
+            if i == 1:
+                forest.repartition()
+            forest.createNodes()
+
+            # The nodes match those created from scratch for the same mesh
+            fresh = forest.duplicate()
+            fresh.setUseIncrementalNodes(0)
+            fresh.createNodes()
+            self.assertTrue(np.array_equal(forest.getNodeRange(), fresh.getNodeRange()))
+            self.assertTrue(np.array_equal(forest.getMeshConn(), fresh.getMeshConn()))
+            for a, b in zip(forest.getDepNodeConn(), fresh.getDepNodeConn()):
+                self.assertTrue(np.array_equal(a, b))
+            self.assertTrue(np.allclose(forest.getPoints(), fresh.getPoints()))
+        return
+
+
+class CoarsenTest(unittest.TestCase):
+    def test_nlevels(self):
+        forest = TMR.OctForest(MPI.COMM_WORLD)
+        conn = np.array(
+            [[0, 1, 3, 4, 6, 7, 9, 10], [8, 11, 2, 5, 7, 10, 1, 4]], dtype=np.intc
+        )
+        forest.setConnectivity(conn)
+        forest.createTrees(3)
+        forest.repartition()
+
+        # Coarsening two levels at once matches two single-level steps
+        coarse = forest.coarsen(2)
+        octs = gather_octants(coarse)
+        self.assertEqual(octs, gather_octants(forest.coarsen().coarsen()))
+        self.assertEqual(len(octs), 2 * 8)
+        self.assertTrue(all(o[4] == 1 for o in octs))
+        return
+
+    def test_budget(self):
+        comm = MPI.COMM_WORLD
+        forest = create_refined_forest()
+        nelems = comm.allreduce(len(forest.getOctants()))
+
+        # A budget that is already met leaves the forest unchanged
+        coarse = forest.coarsenToBudget(nelems)
+        self.assertEqual(gather_octants(coarse), gather_octants(forest))
+
+        # The budget bounds the number of elements before balancing
+        for budget in [nelems // 2, nelems // 4]:
+            coarse = forest.coarsenToBudget(budget)
+            self.assertLessEqual(comm.allreduce(len(coarse.getOctants())), budget)
+
+            indicator = np.random.uniform(size=len(forest.getOctants()))
+            coarse = forest.coarsenToBudget(budget, indicator)
+            self.assertLessEqual(comm.allreduce(len(coarse.getOctants())), budget)
+        return
+
+
+def octant_values(forest):
+    """Evaluate a value that identifies each local octant"""
+    return np.array(
+        [
+            10.0 * o.block + o.level + (o.x + 2.0 * o.y + 3.0 * o.z) / (1 << 30)
+            for o in forest.getOctants()
+        ]
+    )
+
+
+class ForestFieldTest(unittest.TestCase):
+    def test_repartition(self):
+        forest = create_refined_forest()
+        field = TMR.ForestField(forest, 2)
+        values = np.zeros((len(forest.getOctants()), 2))
+        values[:, 0] = octant_values(forest)
+        values[:, 1] = 1.0
+        field.setValues(values)
+
+        # The values move with the octants to the new owners
+        forest.repartition()
+        values = field.getValues()
+        self.assertEqual(values.shape, (len(forest.getOctants()), 2))
+        self.assertTrue(np.allclose(values[:, 0], octant_values(forest)))
+        self.assertTrue(np.allclose(values[:, 1], 1.0))
+        return
+
+    def test_refine(self):
+        comm = MPI.COMM_WORLD
+        forest = create_refined_forest()
+        avg = TMR.ForestField(forest, 1, TMR.FIELD_AVERAGE)
+        total = TMR.ForestField(forest, 1, TMR.FIELD_SUM)
+        vmax = TMR.ForestField(forest, 1, TMR.FIELD_MAX)
+        values = octant_values(forest)
+        avg.setValues(np.ones(len(values)))
+        total.setValues(values)
+        vmax.setValues(values)
+        sum0 = comm.allreduce(np.sum(values))
+        max0 = comm.allreduce(np.max(values), op=MPI.MAX)
+
+        # Refine and balance the forest in place
+        refine = np.zeros(len(forest.getOctants()), dtype=np.intc)
+        refine[::2] = 1
+        forest.refine(refine)
+        forest.balance(1)
+        forest.repartition()
+
+        # The values follow the refined forest and are then transferred to
+        # a coarsened forest
+        for new_forest in [forest, forest.coarsen()]:
+            for field in [avg, total, vmax]:
+                field.setForest(new_forest)
+            nelems = len(new_forest.getOctants())
+            self.assertEqual(avg.getValues().shape, (nelems, 1))
+            self.assertTrue(np.allclose(avg.getValues(), 1.0))
+
+            # The sum conserves the total and the maximum is unchanged
+            sum1 = comm.allreduce(np.sum(total.getValues()))
+            max1 = comm.allreduce(np.max(vmax.getValues()), op=MPI.MAX)
+            self.assertTrue(np.isclose(sum1, sum0))
+            self.assertEqual(max1, max0)
+        return
+
+
+class OctantFileTest(unittest.TestCase):
+    def test_read_write(self):
+        comm = MPI.COMM_WORLD
+        tmpdir = None
+        if comm.rank == 0:
+            tmpdir = tempfile.mkdtemp()
+        tmpdir = comm.bcast(tmpdir, root=0)
+        fname = os.path.join(tmpdir, "octants.bin")
+        junk = os.path.join(tmpdir, "junk.bin")
+        missing = os.path.join(tmpdir, "missing.bin")
+
+        forest = create_refined_forest()
+        octs = gather_octants(forest)
+        self.assertEqual(forest.writeOctantsToFile(fname), 0)
+
+        # A file with the wrong header or no file is rejected and the
+        # forest is unchanged
+        if comm.rank == 0:
+            np.array([2, len(octs), 0, 0], dtype=np.intc).tofile(junk)
+        comm.barrier()
+        self.assertNotEqual(forest.readOctantsFromFile(junk), 0)
+        self.assertNotEqual(forest.readOctantsFromFile(missing), 0)
+        self.assertEqual(gather_octants(forest), octs)
+
+        # The octants are read back on the same blocks
+        new_forest = TMR.OctForest(comm)
+        new_forest.setConnectivity(
+            np.array(
+                [[0, 1, 3, 4, 6, 7, 9, 10], [8, 11, 2, 5, 7, 10, 1, 4]], dtype=np.intc
+            )
+        )
+        self.assertEqual(new_forest.readOctantsFromFile(fname), 0)
+        self.assertEqual(gather_octants(new_forest), octs)
+
+        comm.barrier()
+        if comm.rank == 0:
+            shutil.rmtree(tmpdir)
+        return
+
+
+def expand_symmetric(C):
+    """Expand the upper triangle of a 6x6 matrix stored row by row"""
+    D = np.zeros((6, 6), dtype=C.dtype)
+    D[np.triu_indices(6)] = C
+    return D + np.triu(D, 1).T
+
+
+class BlockStiffnessTest(unittest.TestCase):
+    def test_block(self):
+        q = 5.0
+        k0 = 1e-6
+        forest = create_refined_forest()
+        forest.setMeshOrder(2)
+        forest.createNodes()
+
+        mat = constitutive.MaterialProperties(rho=2600.0, E=70e9, nu=0.3, ys=100e6)
+        props = TMR.StiffnessProperties(mat, q=q, k0=k0)
+        con = TMR.OctConstitutive(props, forest)
+        C0 = con.getMaterialStiffness()
+        D = expand_symmetric(C0[0])
+
+        def penalty(rho):
+            return rho / (1.0 + q * (1.0 - rho)) + k0
+
+        def dpenalty(rho):
+            return (q + 1.0) / (1.0 + q * (1.0 - rho)) ** 2
+
+        # The stiffness and the stress at a block of densities
+        np.random.seed(0)
+        rho = np.linspace(0.0, 1.0, 7).reshape(-1, 1)
+        strain = np.random.uniform(-1.0, 1.0, size=(7, 6))
+        C = con.evalTangentStiffnessBlock(rho)
+        self.assertTrue(np.allclose(C, penalty(rho) * C0[0]))
+        stress = con.evalStressBlock(rho, strain)
+        self.assertTrue(np.allclose(stress, penalty(rho) * strain.dot(D)))
+
+        # The densities interpolated from the initial design variables
+        pts = np.random.uniform(-1.0, 1.0, size=(5, 3))
+        N = con.evalShapeFunctionTable(pts)
+        self.assertTrue(np.allclose(N.sum(axis=1), 1.0))
+        elems = np.arange(min(2, len(forest.getOctants())), dtype=np.intc)
+        rho = con.packDensities(elems, N)
+        self.assertTrue(np.allclose(rho, 0.95))
+
+        # The derivative w.r.t. the design variables of each element
+        nelems = len(elems)
+        scale = np.random.uniform(size=(nelems, 5))
+        strain = np.random.uniform(-1.0, 1.0, size=(nelems, 5, 6))
+        psi = np.random.uniform(-1.0, 1.0, size=(nelems, 5, 6))
+        dfdx = np.zeros(nelems * N.shape[1], dtype=TACS.dtype)
+        con.addStressDVSensBlock(N, rho, scale, strain, psi, dfdx)
+
+        prod = np.einsum("kpi,ij,kpj->kp", strain, D, psi)
+        drho = scale * dpenalty(rho[:, :, 0]) * prod
+        expected = drho.dot(N).reshape(-1)
+        self.assertTrue(np.allclose(dfdx, expected))
+        return
+
+
+class WeightPoolTest(unittest.TestCase):
+    def test_pool(self):
+        comm = MPI.COMM_WORLD
+        mat = constitutive.MaterialProperties(rho=2600.0, E=70e9, nu=0.3, ys=100e6)
+        props = TMR.StiffnessProperties(mat)
+
+        class ElementCreator(TMR.OctTopoCreator):
+            def __init__(self, bcs, filt):
+                self.weights = []
+                con = constitutive.SolidConstitutive(mat)
+                model = elements.LinearElasticity3D(con)
+                basis = elements.LinearHexaBasis()
+                self.element = elements.Element3D(model, basis)
+
+            def createElement(self, order, octant, index, weights):
+                self.weights.append((list(index), list(weights)))
+                return self.element
+
+        class PoolCreator(TMR.OctTopoCreator):
+            def __init__(self, bcs, filt):
+                self.calls = 0
+
+            def createElements(self, order, octs, pool):
+                # Share a single element between all of the elements
+                self.calls += 1
+                self.num_octs = len(octs)
+                con = TMR.OctConstitutive(props, pool=pool)
+                model = elements.LinearElasticity3D(con)
+                elem = elements.Element3D(model, elements.LinearHexaBasis())
+                return [elem], np.zeros(len(octs), dtype=np.intc)
+
+        # The analysis forest is the filter refined by one level
+        filt = create_refined_forest()
+        filt.setMeshOrder(2)
+        forest = filt.duplicate()
+        forest.refine(np.ones(len(forest.getOctants()), dtype=np.intc))
+        forest.setMeshOrder(2)
+
+        bcs = TMR.BoundaryConditions()
+        creator = ElementCreator(bcs, filt)
+        creator.createTACS(forest)
+        pool_creator = PoolCreator(bcs, filt)
+        assembler = pool_creator.createTACS(forest)
+        self.assertIsNotNone(assembler)
+        self.assertEqual(pool_creator.calls, 1)
+
+        pool = pool_creator.getWeightPool()
+        nelems = pool_creator.num_octs
+        self.assertEqual(pool.getNumElements(), nelems)
+        self.assertEqual(len(creator.weights), nelems)
+
+        # Elements at the same position within a filter element share a
+        # pattern, so there are fewer patterns than elements
+        index = pool.getIndexTable()
+        patterns = pool.getPatterns()
+        elem_patterns = pool.getElementPatterns()
+        self.assertEqual(index.shape, (nelems, pool.getNumWeights()))
+        self.assertTrue(np.allclose(patterns.sum(axis=1), 1.0))
+        total = comm.allreduce(nelems)
+        num_patterns = comm.allreduce(pool.getNumPatterns())
+        self.assertLess(num_patterns, total)
+
+        # The pool gives the same weights as the per-element path
+        for i, (idx, wvals) in enumerate(creator.weights):
+            self.assertEqual(list(index[i]), idx)
+            self.assertTrue(np.array_equal(patterns[elem_patterns[i]], wvals))
+        return
@@ -24,6 +24,7 @@ cimport mpi4py.MPI as MPI
 
 # Import string stuff
 from libc.string cimport const_char
+from libc.stdio cimport FILE
 from libc.stdint cimport int32_t, int16_t
 
 # Import the python version information
@@ -72,21 +73,40 @@ cdef extern from "TMRBase.h":
         int index
         double weight
 
+    cdef cppclass TMRMemoryUsage(TMREntity):
+        int getNumEntries()
+        const char* getEntryName(int)
+        int isPeakEntry(int)
+        void getEntryBytes(int, double*, double*, double*, double*)
+        double getTotalArrayBytes()
+        void printSummary(MPI_Comm)
+
     cdef cppclass TMR_STLTriangle:
         TMRPoint p[3]
 
     void TMRInitialize()
     int TMRIsInitialized()
     void TMRFinalize()
+    int TMRGetThreadSafeElements()
+    void TMRSetThreadSafeElements(int)
 
     enum TMRInterpolationType:
         TMR_UNIFORM_POINTS
         TMR_GAUSS_LOBATTO_POINTS
         TMR_BERNSTEIN_POINTS
 
+    enum TMRNodeOrderingType:
+        TMR_NATURAL_NODE_ORDER
+        TMR_ELEMENT_NODE_ORDER
+        TMR_RCM_NODE_ORDER
+
 cdef extern from "TMRTopology.h":
+    enum TMRBlockOrderingType:
+        TMR_GRAPH_BLOCK_ORDER
+        TMR_HILBERT_BLOCK_ORDER
+
     cdef cppclass TMRTopology(TMREntity):
-        TMRTopology(MPI_Comm, TMRModel*)
+        TMRTopology(MPI_Comm, TMRModel*, TMRBlockOrderingType)
         void getVolume(int, TMRVolume**)
         void getFace(int, TMRFace**)
         void getEdge(int, TMREdge**)
@@ -244,6 +264,7 @@ cdef extern from "TMRFeatureSize.h":
         TMRElementFeatureSize()
         TMRElementFeatureSize(double)
         double getFeatureSize(TMRPoint)
+        void getFeatureSizes(int, const TMRPoint*, double*)
 
     cdef cppclass TMRLinearElementSize(TMRElementFeatureSize):
         TMRLinearElementSize(double, double,
@@ -256,9 +277,17 @@ cdef extern from "TMRFeatureSize.h":
     cdef cppclass TMRPointFeatureSize(TMRElementFeatureSize):
         TMRPointFeatureSize(int, TMRPoint*, double*, double, double, int)
 
+    cdef cppclass TMRDistributedPointFeatureSize(TMRElementFeatureSize):
+        TMRDistributedPointFeatureSize(MPI_Comm, int, TMRPoint*, double*,
+                                       double, double, int, int)
+        void evalFeatureSizes(int, const TMRPoint*, double*)
+        int getNumOwnedPoints()
+        void clearCache()
+
     cdef cppclass TMRPointLocator(TMREntity):
         TMRPointLocator(int, TMRPoint*)
         void locateClosest(int, TMRPoint, int*, int*, double*)
+        void locateClosest(int, int, const TMRPoint*, int*, int*, double*)
 
 cdef class PointLocator:
     cdef TMRPointLocator *ptr
@@ -288,19 +317,32 @@ cdef extern from "TMRMesh.h":
         TMR_UNSTRUCTURED
         TMR_TRIANGLE
 
+    enum TMRQuadRecombinationType:
+        TMR_OPTIMAL_MATCHING
+        TMR_PATCH_MATCHING
+        TMR_GREEDY_MATCHING
+
     cdef cppclass TMRMesh(TMREntity):
         TMRMesh(MPI_Comm, TMRModel*)
+        MPI_Comm getMPIComm()
         void mesh(TMRMeshOptions, double)
         void mesh(TMRMeshOptions, TMRElementFeatureSize*)
+        void mesh(TMRMeshOptions, double, const char*)
+        void mesh(TMRMeshOptions, TMRElementFeatureSize*, const char*)
         int getMeshPoints(TMRPoint**)
         int getQuadConnectivity(int*, const int**)
         int getTriConnectivity(int*, const int**)
         int getHexConnectivity(int*, const int**)
         int getTetConnectivity(int*, const int**)
+        int getNodeRange(const int**)
+        int getGhostNodes(const int**)
 
         TMRModel *createModelFromMesh()
         void writeToVTK(const char*, int)
+        void writeToVTU(const char*, int, int)
         void writeToBDF(const char*, int, TMRBoundaryConditions*)
+        int writeToBinary(const char*, int, TMRBoundaryConditions*)
+        TMRMemoryUsage* getMemoryUsage()
 
     cdef cppclass TMRMeshOptions:
         TMRMeshOptions()
@@ -310,7 +352,11 @@ cdef extern from "TMRMesh.h":
         int write_mesh_quality_histogram
         int num_smoothing_steps
         double frontal_quality_factor
+        TMRQuadRecombinationType recombination_type
+        int recombination_patch_size
+        double greedy_recombination_quality
         int reset_mesh_objects
+        int distribute_mesh
         int write_init_domain_triangle
         int write_triangularize_intermediate
         int write_pre_smooth_triangle
@@ -351,13 +397,20 @@ cdef extern from "TMRQuadForest.h":
         void setConnectivity(int, const int*, int)
         void setFullConnectivity(int, int, int, const int*, const int*)
         void repartition()
+        double repartition(const double*)
+        void setRepartitionTolerance(double)
+        int repartitionIfImbalanced(double, const double*)
+        void getRepartitionStats(double*, int*, double*)
         void createTrees(int)
         void createRandomTrees(int, int, int)
+        int writeQuadrantsToFile(const char*)
+        int readQuadrantsFromFile(const char*)
         void refine(int*, int, int)
         TMRQuadForest *duplicate()
         TMRQuadForest *coarsen()
         void balance(int)
         void createNodes()
+        void setUseIncrementalNodes(int)
         int getMeshOrder()
         TMRInterpolationType getInterpType()
         void setMeshOrder(int, TMRInterpolationType)
@@ -366,13 +419,17 @@ cdef extern from "TMRQuadForest.h":
         TMRQuadrantArray* getQuadsWithName(const char*)
         int getNodesWithName(const char*, int**)
         void createInterpolation(TMRQuadForest*, TACSBVecInterp*)
+        void transferNodalField(TMRQuadForest*, TACSBVec*, TACSBVec*)
         int getOwnedNodeRange(const int**)
         void getQuadrants(TMRQuadrantArray**)
         int getPoints(TMRPoint**)
+        int getNodeNumbers(const int**)
         int getLocalNodeNumber(int);
         int getExtPreOffset()
         void writeToVTK(const char*)
         void writeForestToVTK(const char*)
+        void writeForestToVTU(const char*, int)
+        TMRMemoryUsage* getMemoryUsage()
 
 cdef extern from "TMROctant.h":
     cdef cppclass TMROctant:
@@ -400,34 +457,78 @@ cdef extern from "TMROctant.h":
 
 cdef extern from "TMROctForest.h":
     cdef cppclass TMROctForest(TMREntity):
-        TMROctForest(MPI_Comm, int, TMRInterpolationType)
+        TMROctForest(MPI_Comm, int, TMRInterpolationType, int)
         MPI_Comm getMPIComm()
         void setTopology(TMRTopology*)
         TMRTopology* getTopology()
         void setConnectivity(int, const int*, int)
         void setFullConnectivity(int, int, int, const int*, const int*)
         void repartition(int)
+        double repartition(const double*)
+        void setRepartitionTolerance(double)
+        int repartitionIfImbalanced(double, const double*)
+        void getRepartitionStats(double*, int*, double*)
         void createTrees(int)
         void createRandomTrees(int, int, int)
+        int writeOctantsToFile(const char*)
+        int readOctantsFromFile(const char*)
         void refine(int*, int, int)
         TMROctForest *duplicate()
         TMROctForest *coarsen()
-        void balance(int)
+        TMROctForest *coarsen(int)
+        TMROctForest *coarsenToBudget(int, const double*)
+        void balance(int, int)
+        void refineAndBalance(const int*, int)
         void createNodes()
+        void setUseIncrementalNodes(int)
         int getMeshOrder()
         TMRInterpolationType getInterpType()
         void setMeshOrder(int, TMRInterpolationType)
         void getNodeConn(const int**, int*)
         int getDepNodeConn(const int**, const int**, const double**)
+        void computeElementNeighbors()
+        int getGhostOctants(TMROctantArray**, const int**)
+        int getElementNeighbors(const int**, const int**, const int**)
         TMROctantArray* getOctsWithName(const char*)
         int getNodesWithName(const char*, int**)
         void createInterpolation(TMROctForest*, TACSBVecInterp*)
+        void transferNodalField(TMROctForest*, TACSBVec*, TACSBVec*)
         int getOwnedNodeRange(const int**)
         void getOctants(TMROctantArray**)
         int getPoints(TMRPoint**)
+        int getNodeNumbers(const int**)
         int getExtPreOffset()
+        void setNodeOrdering(TMRNodeOrderingType)
+        void getNodeBandwidth(int*, int*)
         void writeToVTK(const char*)
         void writeForestToVTK(const char*)
+        void writeForestToVTU(const char*, int)
+        TMRMemoryUsage* getMemoryUsage()
+        void releaseTransientData(int)
+        void setReleaseFlags(int)
+        int getReleaseFlags()
+
+cdef extern from "TMRForestField.h":
+    enum TMRFieldTransferType:
+        TMR_FIELD_AVERAGE
+        TMR_FIELD_SUM
+        TMR_FIELD_MAX
+
+    cdef cppclass TMRForestField(TMREntity):
+        TMRForestField(TMROctForest*, int, TMRFieldTransferType)
+        TMROctForest* getForest()
+        int getNumComponents()
+        int getValues(double**)
+        void zeroValues()
+        void update()
+        void setForest(TMROctForest*)
+
+cdef extern from "TMROctForestHierarchy.h":
+    cdef cppclass TMROctForestHierarchy(TMREntity):
+        TMROctForestHierarchy(TMROctForest*, int, int, int, int)
+        int getNumLevels()
+        TMROctForest* getForest(int)
+        void createInterpolation(TACSBVecInterp**)
 
 cdef extern from "TMRBoundaryConditions.h":
     cdef cppclass TMRBoundaryConditions(TMREntity):
@@ -440,16 +541,26 @@ cdef extern from "TMR_TACSCreator.h":
     cdef cppclass TMRQuadTACSCreator(TMREntity):
         TMRQuadTACSCreator(TMRBoundaryConditions*, int, TMRQuadForest*)
         TMRQuadForest* getFilter()
+        void setThreadSafeElements(int)
+        int getThreadSafeElements()
 
     cdef cppclass TMROctTACSCreator(TMREntity):
         TMROctTACSCreator(TMRBoundaryConditions*, int, TMROctForest*)
         TMROctForest* getFilter()
+        void setThreadSafeElements(int)
+        int getThreadSafeElements()
 
 cdef extern from "TMROpenCascade.h":
     cdef void TMR_SewModelIGES(char *, const char *, int, double, bool)
     cdef void TMR_SewModelSTEP(char *, const char *, int, double, bool)
     cdef TMRModel* TMR_LoadModelFromIGESFile(const char*, const char*, int)
     cdef TMRModel* TMR_LoadModelFromSTEPFile(const char*, const char*, int)
+    cdef TMRModel* TMR_LoadModelFromIGESFile(MPI_Comm, const char*,
+                                             const char*, int, int, double,
+                                             const char*)
+    cdef TMRModel* TMR_LoadModelFromSTEPFile(MPI_Comm, const char*,
+                                             const char*, int, int, double,
+                                             const char*)
 
 cdef extern from "TMREgads.h" namespace "TMR_EgadsInterface":
     cdef TMRModel* TMR_ConvertEGADSModel"TMR_EgadsInterface::TMR_ConvertEGADSModel"(ego, int)
@@ -457,7 +568,8 @@ cdef extern from "TMREgads.h" namespace "TMR_EgadsInterface":
 
 cdef extern from "TMR_RefinementTools.h":
     void TMR_CreateTACSMg(int, TACSAssembler**,
-                          TMRQuadForest**, TACSMg**, double, int, int, int)
+                          TMRQuadForest**, TACSMg**, double, int, int, int,
+                          int, int)
     void TMR_ComputeInterpSolution(TMRQuadForest*, TACSAssembler*,
                                    TMRQuadForest*, TACSAssembler*,
                                    TACSBVec*, TACSBVec*)
@@ -472,7 +584,8 @@ cdef extern from "TMR_RefinementTools.h":
                                TACSBVec*, TACSBVec*, double*, double*, double*)
 
     void TMR_CreateTACSMg(int, TACSAssembler**,
-                          TMROctForest**, TACSMg**, double, int, int, int)
+                          TMROctForest**, TACSMg**, double, int, int, int,
+                          int, int)
     void TMR_ComputeInterpSolution(TMROctForest*, TACSAssembler*,
                                    TMROctForest*, TACSAssembler*,
                                    TACSBVec*, TACSBVec*)
@@ -486,6 +599,19 @@ cdef extern from "TMR_RefinementTools.h":
                                TMROctForest*, TACSAssembler*,
                                TACSBVec*, TACSBVec*, double*, double*)
 
+    int TMR_DecreasingThresholdRefine(MPI_Comm, const double*, int, double,
+                                      double, int*)
+    void TMR_FixedGrowthRefine(MPI_Comm, const double*, int, double, double,
+                               double, int*, double*, double*)
+
+cdef extern from "TMRWeightPool.h":
+    cdef cppclass TMRWeightPool(TMREntity):
+        int getNumPatterns()
+        int getNumWeights()
+        int getNumElements()
+        void getElementTables(const int**, const int**)
+        const double *getPatterns()
+
 cdef extern from "TMRCyCreator.h":
     ctypedef TACSElement* (*createquadelements)(void*, int, TMRQuadrant*)
     ctypedef TACSElement* (*createoctelements)(void*, int, TMROctant*)
@@ -499,6 +625,8 @@ cdef extern from "TMRCyCreator.h":
         void setSelfPointer(void*)
         void setCreateQuadElement(
             TACSElement* (*createquadelements)(void*, int, TMRQuadrant*))
+        void setCreateQuadElements(
+            int (*)(void*, int, int, TMRQuadrant*, TACSElement**))
         TACSAssembler *createTACS(TMRQuadForest*, OrderingType, int, const char**)
 
     cdef cppclass TMRCyOctCreator(TMROctTACSCreator):
@@ -506,6 +634,8 @@ cdef extern from "TMRCyCreator.h":
         void setSelfPointer(void*)
         void setCreateOctElement(
             TACSElement* (*createoctelements)(void*, int, TMROctant*))
+        void setCreateOctElements(
+            int (*)(void*, int, int, TMROctant*, TACSElement**))
         TACSAssembler *createTACS(TMROctForest*, OrderingType, int, const char**)
 
     cdef cppclass TMRCyTopoQuadCreator(TMRQuadTACSCreator):
@@ -514,7 +644,10 @@ cdef extern from "TMRCyCreator.h":
         void setCreateQuadTopoElement(
             TACSElement* (*createquadtopoelements)(
                 void*, int, TMRQuadrant*, int, TMRIndexWeight*))
-        TACSAssembler *createTACS(TMRQuadForest*, OrderingType)
+        void setCreateQuadTopoElements(
+            int (*)(void*, int, int, TMRQuadrant*, TMRWeightPool*, TACSElement**))
+        TMRWeightPool *getWeightPool()
+        TACSAssembler *createTACS(TMRQuadForest*, OrderingType) nogil
 
     cdef cppclass TMRCyTopoOctCreator(TMROctTACSCreator):
         TMRCyTopoOctCreator(TMRBoundaryConditions*, int, TMROctForest*)
@@ -522,7 +655,10 @@ cdef extern from "TMRCyCreator.h":
         void setCreateOctTopoElement(
             TACSElement* (*createocttopoelements)(
                 void*, int, TMROctant*, int, TMRIndexWeight*))
-        TACSAssembler *createTACS(TMROctForest*, OrderingType)
+        void setCreateOctTopoElements(
+            int (*)(void*, int, int, TMROctant*, TMRWeightPool*, TACSElement**))
+        TMRWeightPool *getWeightPool()
+        TACSAssembler *createTACS(TMROctForest*, OrderingType) nogil
 
     cdef cppclass TMRCyTopoQuadConformCreator(TMRQuadTACSCreator):
        TMRCyTopoQuadConformCreator(TMRBoundaryConditions*, int, TMRQuadForest*,
@@ -531,7 +667,10 @@ cdef extern from "TMRCyCreator.h":
        void setCreateQuadTopoElement(
           TACSElement* (*createquadtopoelements)(
              void*, int, TMRQuadrant*, int, const int*, TMRQuadForest*))
-       TACSAssembler *createTACS(TMRQuadForest*, OrderingType)
+       void setCreateQuadTopoElements(
+          int (*)(void*, int, int, TMRQuadrant*, int, const int*,
+                  TMRQuadForest*, TACSElement**))
+       TACSAssembler *createTACS(TMRQuadForest*, OrderingType) nogil
 
     cdef cppclass TMRCyTopoOctConformCreator(TMROctTACSCreator):
         TMRCyTopoOctConformCreator(TMRBoundaryConditions*, int, TMROctForest*,
@@ -540,7 +679,10 @@ cdef extern from "TMRCyCreator.h":
         void setCreateOctTopoElement(
             TACSElement* (*createocttopoelements)(
                 void*, int, TMROctant*, int, const int*, TMROctForest*))
-        TACSAssembler *createTACS(TMROctForest*, OrderingType)
+        void setCreateOctTopoElements(
+            int (*)(void*, int, int, TMROctant*, int, const int*,
+                    TMROctForest*, TACSElement**))
+        TACSAssembler *createTACS(TMROctForest*, OrderingType) nogil
 
 cdef extern from "TMRTopoFilter.h":
     cdef cppclass TMRTopoFilter(TMREntity):
@@ -608,16 +750,34 @@ cdef extern from "TMROctConstitutive.h":
 
     cdef cppclass TMROctConstitutive(TACSSolidConstitutive):
         TMROctConstitutive(TMRStiffnessProperties*, TMROctForest*)
+        TMROctConstitutive(TMRStiffnessProperties*, TMRWeightPool*)
+        TMRStiffnessProperties *getStiffnessProperties()
+        int getDesignVarsPerNode()
+        void getMaterialStiffness(TacsScalar*)
+        void evalShapeFunctionTable(int, const double*, double*)
+        void packDensities(int, const int*, int, const double*, TacsScalar*)
+        void evalTangentStiffnessBlock(int, const TacsScalar*, TacsScalar*)
+        void evalStressBlock(int, const TacsScalar*, const TacsScalar*,
+                             TacsScalar*)
+        void addStressDVSensBlock(int, int, const double*, const TacsScalar*,
+                                  const TacsScalar*, const TacsScalar*,
+                                  const TacsScalar*, TacsScalar*)
 
 cdef extern from "TMRQuadConstitutive.h":
     cdef cppclass TMRQuadConstitutive(TACSPlaneStressConstitutive):
         TMRQuadConstitutive(TMRStiffnessProperties*, TMRQuadForest*)
+        TMRQuadConstitutive(TMRStiffnessProperties*, TMRWeightPool*)
 
 cdef extern from "TMRHelmholtzPUFilter.h":
     ctypedef int (*getinteriorstencil)( void*, int, int,
                                         TacsScalar*, double* )
     ctypedef int (*getboundarystencil)( void*, int, TacsScalar*, int,
                                         TacsScalar*, double* )
+    ctypedef int (*getinteriorstencils)( void*, int, const int*, const int*,
+                                         const TacsScalar*, double* )
+    ctypedef int (*getboundarystencils)( void*, int, const int*, const int*,
+                                         const TacsScalar*, const TacsScalar*,
+                                         double* )
 
     cdef cppclass TMRCallbackHelmholtzPUFilter(TMRTopoFilter):
         TMRCallbackHelmholtzPUFilter(int, int, TACSAssembler**,
@@ -628,8 +788,19 @@ cdef extern from "TMRHelmholtzPUFilter.h":
         void setSelfPointer(void*)
         void setGetInteriorStencil(getinteriorstencil)
         void setGetBoundaryStencil(getboundarystencil)
+        void setGetInteriorStencils(getinteriorstencils)
+        void setGetBoundaryStencils(getboundarystencils)
+
+cdef extern from "TMRMFilter.h":
+    cdef cppclass TMRMFilter(TMRTopoFilter):
+        TMRMFilter(int, int, TACSAssembler**, TMROctForest**, double)
+        TMRMFilter(int, int, TACSAssembler**, TMRQuadForest**, double)
+        void initialize()
 
 cdef extern from "TMRTopoProblem.h":
+    enum:
+        TMR_PROFILE_NUM_PHASES"TMR_PROFILE_NUM_PHASES"
+
     ctypedef void (*writeoutputcallback)(void*, const char*, int,
                                          TMROctForest*, TMRQuadForest*,
                                          TACSBVec*)
@@ -652,6 +823,16 @@ cdef extern from "TMRTopoProblem.h":
         TMRTopoFilter* getTopoFilter()
         TACSMg* getMg()
         void setLoadCases(TACSBVec**, int)
+        void setUseBlockSolver(int)
+        void setUseMultiAdjoint(int)
+        void setAsyncOutput(int)
+        void setProfileOutput(int)
+        const char* getProfilePhaseName(int)
+        void getProfilePhase(int, int*, int*, double*, double*, double*)
+        void printProfile(FILE*)
+        void resetProfile()
+        void setReuseSolutions(int)
+        void setLaggedPreconditioner(int, double)
         int getNumLoadCases()
         void addConstraints(int, TACSFunction**,
                             const TacsScalar*, const TacsScalar*, int)
@@ -702,11 +883,36 @@ cdef extern from "TMRTopoProblem.h":
 cdef extern from "TMR_STLTools.h":
     int TMR_GenerateBinFile(const char*, TMROctForest*,
                             TACSBVec*, int, double)
+    int TMR_WriteSTLFile(const char*, TMROctForest*,
+                         TACSBVec*, int, double)
     int TMR_GenerateSTLTriangles(int, TMROctForest*, TACSBVec*,
                                  int, double, int*, TMR_STLTriangle**)
 
 cdef extern from "TMRApproximateDistance.h":
+    cdef cppclass TMRQuadDistanceField(TMREntity):
+        TMRQuadDistanceField(TMRQuadForest*, int, double, double)
+        void computeDistance(TACSBVec*, double*, const char*)
+
+    cdef cppclass TMROctDistanceField(TMREntity):
+        TMROctDistanceField(TMROctForest*, int, double, double)
+        void computeDistance(TACSBVec*, double*, const char*)
+
     void TMRApproximateDistance(TMRQuadForest*, int, double, double,
                                 TACSBVec*, const char*, double*)
     void TMRApproximateDistance(TMROctForest*, int, double, double,
                                 TACSBVec*, const char*, double*)
+
+cdef class DistanceField:
+    cdef TMRQuadDistanceField *quad_ptr
+    cdef TMROctDistanceField *oct_ptr
+    cdef object filtr
+
+cdef extern from "TMRTopoRefinement.h":
+    void TMRDensityBasedRefine(TMRQuadForest*, TACSBVec*, int, double,
+                               double, int, int*)
+    void TMRDensityBasedRefine(TMROctForest*, TACSBVec*, int, double,
+                               double, int, int*)
+    void TMRTargetRefine(TMRQuadForest*, TACSBVec*, const double*, double,
+                         int, int, int, int, double, int*)
+    void TMRTargetRefine(TMROctForest*, TACSBVec*, const double*, double,
+                         int, int, int, int, double, int*)
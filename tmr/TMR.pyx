@@ -31,6 +31,7 @@ import numpy as np
 # Import the string library
 from libcpp.string cimport string
 from libc.string cimport strcpy
+from libc.stdio cimport stdout
 
 cdef tmr_init():
     if not TMRIsInitialized():
@@ -46,6 +47,9 @@ tmr_init()
 import traceback
 from sys import exit
 
+# Track the views of the arrays held by the forests
+import weakref
+
 # Import the definition required for const strings
 from libc.string cimport const_char
 from libc.stdlib cimport malloc, free
@@ -81,11 +85,46 @@ STRUCTURED = TMR_STRUCTURED
 UNSTRUCTURED = TMR_UNSTRUCTURED
 TRIANGLE = TMR_TRIANGLE
 
+# Set the matching algorithms used to recombine triangles into quads
+OPTIMAL_MATCHING = TMR_OPTIMAL_MATCHING
+PATCH_MATCHING = TMR_PATCH_MATCHING
+GREEDY_MATCHING = TMR_GREEDY_MATCHING
+
 # Set the type of interpolation to use
 UNIFORM_POINTS = TMR_UNIFORM_POINTS
 GAUSS_LOBATTO_POINTS = TMR_GAUSS_LOBATTO_POINTS
 BERNSTEIN_POINTS = TMR_BERNSTEIN_POINTS
 
+# Set the order of the locally owned nodes
+NATURAL_NODE_ORDER = TMR_NATURAL_NODE_ORDER
+ELEMENT_NODE_ORDER = TMR_ELEMENT_NODE_ORDER
+RCM_NODE_ORDER = TMR_RCM_NODE_ORDER
+
+# Set the order of the blocks in the topology
+GRAPH_BLOCK_ORDER = TMR_GRAPH_BLOCK_ORDER
+HILBERT_BLOCK_ORDER = TMR_HILBERT_BLOCK_ORDER
+
+# The layout of the quadrants and octants in a numpy structured array
+quadrant_dtype = np.dtype([('face', np.int32), ('x', np.int32),
+                           ('y', np.int32), ('tag', np.int32),
+                           ('level', np.int16), ('info', np.int16)])
+octant_dtype = np.dtype([('block', np.int32), ('x', np.int32),
+                         ('y', np.int32), ('z', np.int32),
+                         ('tag', np.int32), ('level', np.int16),
+                         ('info', np.int16)])
+
+# Set the forest data that can be released (see TMROctForest.h)
+RELEASE_ADJACENT = 1
+RELEASE_NODE_NUMBERS = 2
+RELEASE_NAME_INDEX = 4
+RELEASE_INTERP_CACHE = 8
+RELEASE_ALL = 15
+
+# Set the rule used to transfer the values of a forest field
+FIELD_AVERAGE = TMR_FIELD_AVERAGE
+FIELD_SUM = TMR_FIELD_SUM
+FIELD_MAX = TMR_FIELD_MAX
+
 cdef class Vertex:
     """
     The vertex class is used to store both the point and to
@@ -2167,6 +2206,43 @@ cdef class MeshOptions:
         def __set__(self, value):
             self.ptr.frontal_quality_factor = value
 
+    property recombination_type:
+        """
+        Matching algorithm used to recombine triangles into quads. This can be
+        the optimal matching of the whole face, the patch matching which
+        matches spatial patches independently and then repairs the seams, or
+        the greedy matching which is the fastest but gives lower-quality quads.
+        """
+        def __get__(self):
+            return self.ptr.recombination_type
+        def __set__(self, TMRQuadRecombinationType value):
+            self.ptr.recombination_type = value
+
+    property recombination_patch_size:
+        """
+        Maximum number of triangles in each patch for the patch matching
+
+        Args:
+            value (int): Patch size
+        """
+        def __get__(self):
+            return self.ptr.recombination_patch_size
+        def __set__(self, value):
+            self.ptr.recombination_patch_size = value
+
+    property greedy_recombination_quality:
+        """
+        Minimum quality of the quads accepted by the greedy matching. The
+        remaining triangles are matched optimally with their neighbors.
+
+        Args:
+            value (float): Quad quality between 0 and 1
+        """
+        def __get__(self):
+            return self.ptr.greedy_recombination_quality
+        def __set__(self, value):
+            self.ptr.greedy_recombination_quality = value
+
     property triangularize_print_level:
         """
         Print level to provide more verbosity during the triangularization
@@ -2193,6 +2269,20 @@ cdef class MeshOptions:
         def __set__(self, value):
             self.ptr.reset_mesh_objects = value
 
+    property distribute_mesh:
+        """
+        Distribute the volume node locations and the assembled mesh across
+        the processors. Each processor then only stores the elements and
+        nodes that it owns, together with its ghost nodes.
+
+        Args:
+            value (bool): Whether or not to distribute the mesh
+        """
+        def __get__(self):
+            return self.ptr.distribute_mesh
+        def __set__(self, value):
+            self.ptr.distribute_mesh = value
+
     property write_mesh_quality_histogram:
         """
         Write out a histogram of the mesh quality in the final smoothed
@@ -2280,6 +2370,18 @@ cdef class ElementFeatureSize:
         pt.z = x[2]
         return self.ptr.getFeatureSize(pt)
 
+    def getFeatureSizes(self, np.ndarray[double, ndim=2, mode='c'] X):
+        """
+        Evaluate the feature size at each point in an (n, 3) array
+        """
+        if X.shape[1] != 3:
+            errmsg = 'getFeatureSizes expecting point (n,3) array'
+            raise ValueError(errmsg)
+        cdef int npts = X.shape[0]
+        cdef np.ndarray h = np.zeros(npts, dtype=np.double)
+        self.ptr.getFeatureSizes(npts, <TMRPoint*>X.data, <double*>h.data)
+        return h
+
 cdef class ConstElementSize(ElementFeatureSize):
     def __cinit__(self, double h):
         self.ptr = new TMRElementFeatureSize(h)
@@ -2344,6 +2446,55 @@ cdef class PointFeatureSize(ElementFeatureSize):
         free(pts)
         return
 
+cdef class DistributedPointFeatureSize(ElementFeatureSize):
+    cdef TMRDistributedPointFeatureSize *dptr
+    cdef MPI_Comm comm
+    def __cinit__(self, MPI.Comm comm,
+                  np.ndarray[double, ndim=2, mode='c'] X,
+                  np.ndarray[double, ndim=1, mode='c'] hvals,
+                  double hmin, double hmax, int num_sample_pts=16,
+                  int max_coarse_pts=65536):
+        cdef MPI_Comm c_comm = comm.ob_mpi
+        cdef int npts = 0
+        self.comm = c_comm
+        errmsg = None
+        if X.shape[0] != hvals.shape[0]:
+            errmsg = 'DistributedPointFeatureSize arrays must be same size'
+        elif X.shape[1] != 3:
+            errmsg = 'DistributedPointFeatureSize expecting point (n,3) array'
+        raise_on_all_ranks(c_comm, errmsg)
+
+        npts = hvals.shape[0]
+        self.dptr = new TMRDistributedPointFeatureSize(c_comm, npts,
+                                                       <TMRPoint*>X.data,
+                                                       <double*>hvals.data,
+                                                       hmin, hmax,
+                                                       num_sample_pts,
+                                                       max_coarse_pts)
+        self.ptr = self.dptr
+        self.ptr.incref()
+
+    def evalFeatureSizes(self, np.ndarray[double, ndim=2, mode='c'] X):
+        """
+        Evaluate the feature sizes at an (n, 3) array of points from the
+        full point cloud. This call is collective, but the number of
+        points may differ on each processor.
+        """
+        errmsg = None
+        if X.shape[1] != 3:
+            errmsg = 'evalFeatureSizes expecting point (n,3) array'
+        raise_on_all_ranks(self.comm, errmsg)
+        cdef int npts = X.shape[0]
+        cdef np.ndarray h = np.zeros(npts, dtype=np.double)
+        self.dptr.evalFeatureSizes(npts, <TMRPoint*>X.data, <double*>h.data)
+        return h
+
+    def getNumOwnedPoints(self):
+        return self.dptr.getNumOwnedPoints()
+
+    def clearCache(self):
+        self.dptr.clearCache()
+
 cdef class PointLocator:
     def __cinit__(self, np.ndarray[double, ndim=2, mode='c'] X):
         cdef int npts = 0
@@ -2380,6 +2531,135 @@ cdef class PointLocator:
                                <int*>index.data, <double*>dist.data)
         return num_found
 
+    def locateClosestPoints(self, np.ndarray[double, ndim=2, mode='c'] X,
+                            int K):
+        """
+        Find the K-closest points to each point in an (n, 3) array.
+        This returns the number of points found, and the (n, K) arrays
+        of indices and squared distances for each point.
+        """
+        if X.shape[1] != 3:
+            errmsg = 'PointLocator expecting point (n,3) array'
+            raise ValueError(errmsg)
+        cdef int npts = X.shape[0]
+        cdef np.ndarray num_found = np.zeros(npts, dtype=np.intc)
+        cdef np.ndarray index = np.zeros((npts, K), dtype=np.intc)
+        cdef np.ndarray dist = np.zeros((npts, K), dtype=np.double)
+        self.ptr.locateClosest(K, npts, <TMRPoint*>X.data,
+                               <int*>num_found.data, <int*>index.data,
+                               <double*>dist.data)
+        return num_found, index, dist
+
+cdef tmr_convert_memory_usage(TMRMemoryUsage *usage):
+    """
+    Convert a memory report to a dictionary and free the report.
+
+    Each entry maps the name of an array (or of a peak transient) to the
+    tuple (local, min, max, total, is_peak), where the bytes are across all
+    processors and is_peak is True for a peak transient. The peak entries
+    are not held by the object and are not part of the array total.
+    """
+    cdef double local = 0.0, min_bytes = 0.0, max_bytes = 0.0, total = 0.0
+    report = {}
+    usage.incref()
+    for i in range(usage.getNumEntries()):
+        usage.getEntryBytes(i, &local, &min_bytes, &max_bytes, &total)
+        name = tmr_convert_char_to_str(usage.getEntryName(i))
+        is_peak = usage.isPeakEntry(i) != 0
+        report[name] = (local, min_bytes, max_bytes, total, is_peak)
+    usage.decref()
+    return report
+
+# The live zero-copy views of the data held by each forest, keyed by
+# the address of the underlying TMRQuadForest or TMROctForest
+_forest_views = {}
+
+cdef class ForestArrayOwner:
+    """
+    The base object of a zero-copy view returned by a forest.
+
+    The object keeps the Python forest alive and is registered with the
+    views of the forest, so the forest can tell when a view (or an array
+    derived from it) still refers to its data.
+    """
+    cdef object owner
+    cdef object __weakref__
+    def __cinit__(self, object owner):
+        self.owner = owner
+
+cdef check_forest_views(MPI_Comm comm, const void *forest, int collective):
+    """
+    Raise a BufferError if zero-copy views of the data held by the forest
+    exist, since modifying the forest frees the data they refer to.
+
+    When collective is true, the check is made across all processors so
+    that every processor raises before entering a collective operation.
+    """
+    cdef int nviews = 0
+    key = <size_t>forest
+    views = _forest_views.get(key)
+    if views is not None:
+        nviews = len(views)
+        if nviews == 0:
+            del _forest_views[key]
+    if collective:
+        MPI_Allreduce(MPI_IN_PLACE, &nviews, 1, MPI_INT, MPI_MAX, comm)
+    if nviews > 0:
+        errmsg = ('Cannot modify the forest while views of its data exist. '
+                  'Delete the arrays obtained with copy=False first')
+        raise BufferError(errmsg)
+
+cdef raise_on_all_ranks(MPI_Comm comm, errmsg):
+    """
+    Raise a ValueError on all processors if errmsg is not None on any
+    processor. This is called before a collective operation so that no
+    processor is left waiting for the processors that raised.
+    """
+    cdef int fail = 0
+    if errmsg is not None:
+        fail = 1
+    MPI_Allreduce(MPI_IN_PLACE, &fail, 1, MPI_INT, MPI_MAX, comm)
+    if fail:
+        if errmsg is None:
+            errmsg = 'Invalid arguments on another processor'
+        raise ValueError(errmsg)
+
+cdef forest_array_view(object owner, const void *forest, int nptype,
+                       int dim1, int dim2, const void *data_ptr, copy):
+    """
+    Return an array of the data owned by a forest.
+
+    If copy is True, a writeable copy of the data is returned. Otherwise
+    the array is a read-only view of the data that holds a reference to
+    the owner, so that the forest is not freed while the view exists. The
+    view is registered with the forest, and the methods that modify the
+    forest raise a BufferError until it is deleted. When dim2 is positive
+    the array has the shape (dim1, dim2), otherwise it is one-dimensional.
+    """
+    cdef int nd = 1
+    cdef np.npy_intp shape[2]
+    cdef np.ndarray ndarray
+    shape[0] = <np.npy_intp>dim1
+    shape[1] = <np.npy_intp>dim2
+    if dim2 > 0:
+        nd = 2
+    if data_ptr == NULL or dim1 == 0:
+        return np.PyArray_ZEROS(nd, shape, nptype, 0)
+
+    ndarray = np.PyArray_SimpleNewFromData(nd, shape, nptype, <void*>data_ptr)
+    if copy:
+        return ndarray.copy()
+    np.PyArray_CLEARFLAGS(ndarray, np.NPY_ARRAY_WRITEABLE)
+
+    # Register the view with the forest
+    view_owner = ForestArrayOwner(owner)
+    key = <size_t>forest
+    if key not in _forest_views:
+        _forest_views[key] = weakref.WeakSet()
+    _forest_views[key].add(view_owner)
+    np.set_array_base(ndarray, view_owner)
+    return ndarray
+
 cdef class Mesh:
     """
     Mesh the geometry model. This class handles the meshing for surface objects
@@ -2400,30 +2680,41 @@ cdef class Mesh:
             self.ptr.decref()
 
     def mesh(self, double h=1.0, MeshOptions opts=None,
-             ElementFeatureSize fs=None):
+             ElementFeatureSize fs=None, cache_file=None):
         """
-        mesh(self, h=1.0, opts=None, fs=None)
+        mesh(self, h=1.0, opts=None, fs=None, cache_file=None)
 
         Mesh the model with the provided mesh spacing *h*, default meshing
         options :class:`~TMR.MeshOptions` opts if it is not provided or given
         :class:`~TMR.ElementFeatureSize` fs
 
+        When a cache file is provided, the edge and face meshes stored in
+        the file are re-used for the edges and faces whose geometry,
+        feature size and meshing options are unchanged, and the file is
+        updated with the new meshes.
+
         Args:
             h (float): Global mesh spacing parameter
             opts (MeshOptions): Meshing options class
             fs (ElementFeatureSize): ElementFeatureSize class specifying spacing
+            cache_file (str): Name of the mesh cache file
         """
         cdef TMRMeshOptions default
+        cdef string scache
+        cdef const char *cache_c = NULL
+        if cache_file is not None:
+            scache = tmr_convert_str_to_chars(cache_file)
+            cache_c = scache.c_str()
         if fs is not None:
             if opts is None:
-                self.ptr.mesh(default, fs.ptr)
+                self.ptr.mesh(default, fs.ptr, cache_c)
             else:
-                self.ptr.mesh(opts.ptr, fs.ptr)
+                self.ptr.mesh(opts.ptr, fs.ptr, cache_c)
         else:
             if opts is None:
-                self.ptr.mesh(default, h)
+                self.ptr.mesh(default, h, cache_c)
             else:
-                self.ptr.mesh(opts.ptr, h)
+                self.ptr.mesh(opts.ptr, h, cache_c)
 
     def getMeshPoints(self):
         """
@@ -2510,11 +2801,55 @@ cdef class Mesh:
             he[i,7] = hex[8*i+7]
         return he
 
+    def getNodeRange(self):
+        """
+        getNodeRange(self)
+
+        Retrieve the range of node numbers owned by each processor in a
+        distributed mesh. The nodes owned by processor k are the nodes
+        range[k] <= node < range[k+1].
+
+        Returns:
+            np.ndarray: Numpy array of the node ranges or None if the mesh
+            is not distributed
+        """
+        cdef const int *node_range = NULL
+        cdef int size = 0
+        self.ptr.getNodeRange(&node_range)
+        if node_range == NULL:
+            return None
+        MPI_Comm_size(self.ptr.getMPIComm(), &size)
+        r = np.zeros(size+1, dtype=np.intc)
+        for i in range(size+1):
+            r[i] = node_range[i]
+        return r
+
+    def getGhostNodes(self):
+        """
+        getGhostNodes(self)
+
+        Retrieve the global node numbers of the ghost nodes in a distributed
+        mesh. The ghost nodes follow the owned nodes in the local numbering
+        used by getMeshPoints() and the connectivity.
+
+        Returns:
+            np.ndarray: Numpy array of the ghost node numbers
+        """
+        cdef const int *ghosts = NULL
+        cdef int nghosts = 0
+        nghosts = self.ptr.getGhostNodes(&ghosts)
+        g = np.zeros(nghosts, dtype=np.intc)
+        for i in range(nghosts):
+            g[i] = ghosts[i]
+        return g
+
     def createModelFromMesh(self):
         """
         createModelFromMesh(self)
 
-        Create a geometry model based on the input mesh
+        Create a geometry model based on the input mesh. For a distributed
+        mesh, each processor creates the model of its local part of the mesh
+        from the owned and ghost nodes and the local elements.
 
         Returns:
             Model: The Model geometry representation of the underlying mesh
@@ -2549,6 +2884,45 @@ cdef class Mesh:
         else:
             self.ptr.writeToBDF(filename, flag, NULL)
 
+    def writeToBinary(self, fname, outtype=None, BoundaryConditions bcs=None):
+        """
+        writeToBinary(self, fname, outtype=None, bcs=None)
+
+        Write the nodes, connectivity and boundary condition nodes to a
+        compact binary file
+
+        Args:
+            fname (str): File name
+            outtype (str): Type of mesh to output i.e. quad or hex
+            bcs (BoundaryConditions): The boundary conditions to write
+
+        Returns:
+            int: Non-zero if the file could not be written
+        """
+        cdef string sfilename = tmr_convert_str_to_chars(fname)
+        cdef int flag = 3
+        if outtype == 'quad':
+            flag = 1
+        elif outtype == 'hex':
+            flag = 2
+        if bcs is not None:
+            return self.ptr.writeToBinary(sfilename.c_str(), flag, bcs.ptr)
+        return self.ptr.writeToBinary(sfilename.c_str(), flag, NULL)
+
+    def getMemoryUsage(self):
+        """
+        getMemoryUsage(self)
+
+        Report the memory held by the arrays of the mesh. This is a
+        collective call.
+
+        Returns:
+            dict: A map from each array name to the tuple of bytes
+            (local, min, max, total) across all processors and a flag that
+            is True for the peak transient entries
+        """
+        return tmr_convert_memory_usage(self.ptr.getMemoryUsage())
+
     def writeToVTK(self, fname, outtype=None):
         """
         writeToVTK(self, fname, outtype=None)
@@ -2572,6 +2946,28 @@ cdef class Mesh:
             flag = 2
         self.ptr.writeToVTK(filename, flag)
 
+    def writeToVTU(self, fname, outtype=None, compress=False):
+        """
+        writeToVTU(self, fname, outtype=None, compress=False)
+
+        Write both the quadrilateral and hexahedral mesh to a binary VTK
+        XML (.vtu) file. For a distributed mesh, each processor writes its
+        local part of the mesh to prefix_<rank>.vtu, where prefix is the file
+        name without the .vtu extension, and prefix.pvtu collects the pieces.
+
+        Args:
+            fname (str): File name
+            outtype (str): Type of mesh to output to VTK file i.e. quad or hex
+            compress (bool): Compress the data (if TMR is built with zlib)
+        """
+        cdef string sfilename = tmr_convert_str_to_chars(fname)
+        cdef int flag = 3
+        if outtype == 'quad':
+            flag = 1
+        elif outtype == 'hex':
+            flag = 2
+        self.ptr.writeToVTU(sfilename.c_str(), flag, compress)
+
 cdef class EdgeMesh:
     """
     This is the class that stores the node numbers along an edge
@@ -2733,16 +3129,21 @@ cdef class Topology:
         #. All volumes must contain 6 non-degenerate faces that are
            ordered in coordinate ordering as shown below. Furthermore, all
            volumes must be of type TFIVolume.
+
+    The blocks are ordered by their connectivity graph by default
+    (GRAPH_BLOCK_ORDER) or along a Hilbert curve through their centroids
+    (HILBERT_BLOCK_ORDER).
     """
     cdef TMRTopology *ptr
-    def __cinit__(self, MPI.Comm comm=None, Model m=None):
+    def __cinit__(self, MPI.Comm comm=None, Model m=None,
+                  TMRBlockOrderingType block_order=TMR_GRAPH_BLOCK_ORDER):
         cdef MPI_Comm c_comm = NULL
         cdef TMRModel *model = NULL
         self.ptr = NULL
         if comm is not None and m is not None:
             c_comm = comm.ob_mpi
             model = m.ptr
-            self.ptr = new TMRTopology(c_comm, model)
+            self.ptr = new TMRTopology(c_comm, model, block_order)
             self.ptr.incref()
 
     def __dealloc__(self):
@@ -2779,8 +3180,10 @@ cdef _init_Topology(TMRTopology *ptr):
 cdef class QuadrantArray:
     cdef TMRQuadrantArray *ptr
     cdef int self_owned
+    cdef object owner
     def __cinit__(self):
         self.ptr = NULL
+        self.owner = None
 
     def __dealloc__(self):
         if self.ptr and self.self_owned:
@@ -2837,10 +3240,42 @@ cdef class QuadrantArray:
         index = t - array
         return index
 
-cdef _init_QuadrantArray(TMRQuadrantArray *array, int self_owned):
+    def getArray(self, copy=False):
+        """
+        getArray(self, copy=False)
+
+        Get the quadrants as a numpy structured array with the fields of
+        quadrant_dtype. By default, the array shares the storage of the quadrant
+        array, so changes to its entries are reflected in the quadrants.
+        Set copy=True to obtain a copy.
+
+        Args:
+            copy (bool): Return a copy of the quadrants
+
+        Returns:
+            np.ndarray: The structured array of quadrants
+        """
+        cdef int size = 0
+        cdef TMRQuadrant *array = NULL
+        cdef np.npy_intp shape[1]
+        cdef np.ndarray data
+        self.ptr.getArray(&array, &size)
+        if array == NULL or size == 0:
+            return np.zeros(0, dtype=quadrant_dtype)
+        shape[0] = <np.npy_intp>(size*sizeof(TMRQuadrant))
+        data = np.PyArray_SimpleNewFromData(1, shape, np.NPY_UINT8,
+                                            <void*>array)
+        np.set_array_base(data, self)
+        if copy:
+            return data.view(quadrant_dtype).copy()
+        return data.view(quadrant_dtype)
+
+cdef _init_QuadrantArray(TMRQuadrantArray *array, int self_owned,
+                         object owner=None):
     arr = QuadrantArray()
     arr.ptr = array
     arr.self_owned = self_owned
+    arr.owner = owner
     return arr
 
 cdef class Quadrant:
@@ -2921,6 +3356,7 @@ cdef class QuadForest:
             order (int): The number of nodes along an edge
             interp (TMRInterpolationType): Type of interpolation to use
         """
+        check_forest_views(self.ptr.getMPIComm(), self.ptr, 0)
         self.ptr.setMeshOrder(order, interp)
 
     def getMeshOrder(self):
@@ -2970,15 +3406,96 @@ cdef class QuadForest:
             return _init_Topology(topo)
         return None
 
-    def repartition(self):
+    def repartition(self, np.ndarray[double, ndim=1, mode='c'] weights=None):
         """
-        repartition(self)
+        repartition(self, weights=None)
 
         Repartition the mesh across processors. This redistributes the elements
         so that there are an equal, or nearly equal, number of elements on each
-        processor.
+        processor. If weights are provided, the elements are distributed so
+        that the sum of the weights on each processor is nearly equal.
+
+        Args:
+            weights (np.ndarray): Non-negative cost of each local element
+
+        Returns:
+            float: The max processor weight divided by the average weight
+        """
+        cdef TMRQuadrantArray *array = NULL
+        cdef TMRQuadrant *quads = NULL
+        cdef int size = 0
+        check_forest_views(self.ptr.getMPIComm(), self.ptr, 1)
+        if weights is None:
+            self.ptr.repartition()
+            return 1.0
+        self.ptr.getQuadrants(&array)
+        if array != NULL:
+            array.getArray(&quads, &size)
+        errmsg = None
+        if weights.shape[0] != size:
+            errmsg = 'Weights length must equal the number of local quadrants'
+        raise_on_all_ranks(self.ptr.getMPIComm(), errmsg)
+        return self.ptr.repartition(<double*>weights.data)
+
+    def setRepartitionTolerance(self, double tol):
+        """
+        setRepartitionTolerance(self, tol)
+
+        Repartition the mesh automatically after balance() whenever the max
+        processor element count divided by the average exceeds the tolerance.
+        A tolerance of zero disables the automatic repartitioning.
+
+        Args:
+            tol (float): The imbalance tolerance
+        """
+        self.ptr.setRepartitionTolerance(tol)
+
+    def repartitionIfImbalanced(self, double tol,
+                                np.ndarray[double, ndim=1, mode='c'] weights=None):
+        """
+        repartitionIfImbalanced(self, tol, weights=None)
+
+        Repartition the mesh only if the max processor load divided by the
+        average load exceeds the tolerance. The load is the number of elements
+        or, if weights are provided, the sum of the weights on each processor.
+
+        Args:
+            tol (float): The imbalance tolerance
+            weights (np.ndarray): Non-negative cost of each local element
+
+        Returns:
+            bool: Whether the mesh was repartitioned
+        """
+        cdef TMRQuadrantArray *array = NULL
+        cdef TMRQuadrant *quads = NULL
+        cdef int size = 0
+        check_forest_views(self.ptr.getMPIComm(), self.ptr, 1)
+        if weights is None:
+            return self.ptr.repartitionIfImbalanced(tol, NULL) != 0
+        self.ptr.getQuadrants(&array)
+        if array != NULL:
+            array.getArray(&quads, &size)
+        errmsg = None
+        if weights.shape[0] != size:
+            errmsg = 'Weights length must equal the number of local quadrants'
+        raise_on_all_ranks(self.ptr.getMPIComm(), errmsg)
+        return self.ptr.repartitionIfImbalanced(tol, <double*>weights.data) != 0
+
+    def getRepartitionStats(self):
+        """
+        getRepartitionStats(self)
+
+        Get the outcome of the last imbalance check
+
+        Returns:
+            tuple: The imbalance before repartitioning, whether the mesh was
+            repartitioned and the bytes of elements moved between processors
         """
-        self.ptr.repartition()
+        cdef double imbalance = 0.0
+        cdef double bytes_moved = 0.0
+        cdef int repartitioned = 0
+        self.ptr.getRepartitionStats(&imbalance, &repartitioned, &bytes_moved)
+        return imbalance, repartitioned != 0, bytes_moved
 
     def createTrees(self, int depth=0):
         """
@@ -2990,6 +3507,7 @@ cdef class QuadForest:
         Args:
             depth (int): Level of refinement for all trees.
         """
+        check_forest_views(self.ptr.getMPIComm(), self.ptr, 1)
         self.ptr.createTrees(depth)
 
     def createRandomTrees(self, int nrand=10, int min_lev=0, int max_lev=8):
@@ -3004,10 +3522,44 @@ cdef class QuadForest:
             min_lev (int): Minimum quadrant refinement level
             max_lev (int): Maximum quadrant refinement level
         """
+        check_forest_views(self.ptr.getMPIComm(), self.ptr, 1)
         self.ptr.createRandomTrees(nrand, min_lev, max_lev)
 
-    def refine(self, np.ndarray[int, ndim=1, mode='c'] refine=None,
-               int min_lev=0, int max_lev=MAX_LEVEL):
+    def writeQuadrantsToFile(self, fname):
+        """
+        writeQuadrantsToFile(self, fname)
+
+        Write the quadrants to a binary file that can be read back on any
+        number of processors. The nodes are not stored.
+
+        Args:
+            fname (str): File name
+
+        Returns:
+            int: Non-zero if the file could not be written
+        """
+        cdef string sfilename = tmr_convert_str_to_chars(fname)
+        return self.ptr.writeQuadrantsToFile(sfilename.c_str())
+
+    def readQuadrantsFromFile(self, fname):
+        """
+        readQuadrantsFromFile(self, fname)
+
+        Read the quadrants from a binary file written with writeQuadrantsToFile.
+        The connectivity or topology must already be set. The nodes must
+        be created after the quadrants are read.
+
+        Args:
+            fname (str): File name
+
+        Returns:
+            int: Non-zero if the file could not be read
+        """
+        cdef string sfilename = tmr_convert_str_to_chars(fname)
+        check_forest_views(self.ptr.getMPIComm(), self.ptr, 1)
+        return self.ptr.readQuadrantsFromFile(sfilename.c_str())
+
+    def refine(self, refine=None, int min_lev=0, int max_lev=MAX_LEVEL):
         """
         refine(self, refine=None, min_level=0, max_level=MAX_LEVEL)
 
@@ -3019,8 +3571,21 @@ cdef class QuadForest:
             min_lev (int): Minimum quadrant refinement level
             max_lev (int): Maximum quadrant refinement level
         """
+        cdef int size = 0
+        cdef TMRQuadrantArray *array = NULL
+        cdef np.ndarray[int, ndim=1, mode='c'] ref
+        check_forest_views(self.ptr.getMPIComm(), self.ptr, 1)
         if refine is not None:
-            self.ptr.refine(<int*>refine.data, min_lev, max_lev)
+            ref = np.ascontiguousarray(refine, dtype=np.intc).reshape(-1)
+            self.ptr.getQuadrants(&array)
+            if array != NULL:
+                array.getArray(NULL, &size)
+            errmsg = None
+            if ref.shape[0] != size:
+                errmsg = 'Refinement array length %d does not match the %d quadrants'%(
+                    ref.shape[0], size)
+            raise_on_all_ranks(self.ptr.getMPIComm(), errmsg)
+            self.ptr.refine(<int*>ref.data, min_lev, max_lev)
         else:
             self.ptr.refine(NULL, min_lev, max_lev)
         return
@@ -3062,6 +3627,7 @@ cdef class QuadForest:
         Args:
             btype (int): Indicates whether or not to balance across octant corners
         """
+        check_forest_views(self.ptr.getMPIComm(), self.ptr, 1)
         self.ptr.balance(btype)
 
     def createNodes(self):
@@ -3072,6 +3638,19 @@ cdef class QuadForest:
         """
         self.ptr.createNodes()
 
+    def setUseIncrementalNodes(self, int flag):
+        """
+        setUseIncrementalNodes(self, flag)
+
+        Keep the local nodes and connectivity after each call to createNodes()
+        so that the next call reuses the connectivity of the elements that have
+        not changed. The global node numbers are always assigned again.
+
+        Args:
+            flag (bool): Whether to create the nodes incrementally
+        """
+        self.ptr.setUseIncrementalNodes(flag)
+
     def getQuadsWithName(self, aname):
         """
         getQuadsWithName(self, aname)
@@ -3130,14 +3709,22 @@ cdef class QuadForest:
         """
         cdef TMRQuadrantArray *array = NULL
         self.ptr.getQuadrants(&array)
-        return _init_QuadrantArray(array, 0)
+        return _init_QuadrantArray(array, 0, self)
 
-    def getPoints(self):
+    def getPoints(self, copy=True):
         """
-        getPoints(self)
+        getPoints(self, copy=True)
 
         Get the node locations for all locally owned nodes
 
+        By default, a writeable copy of the data is returned. Set
+        copy=False to obtain a read-only view of the data held by the
+        forest instead. While a view exists, the methods that modify
+        the forest raise a BufferError.
+
+        Args:
+            copy (bool): Return a copy of the node locations
+
         Returns:
             np.ndarray: An array of node locations
         """
@@ -3145,16 +3732,40 @@ cdef class QuadForest:
         cdef int npts = 0
         npts = self.ptr.getPoints(&X)
         if X != NULL:
-            Xp = np.zeros((npts, 3), dtype=np.double)
-            for i in range(npts):
-                Xp[i,0] = X[i].x
-                Xp[i,1] = X[i].y
-                Xp[i,2] = X[i].z
-            return Xp
+            return forest_array_view(self, self.ptr, np.NPY_DOUBLE, npts, 3,
+                                     <void*>X, copy)
         else:
             errmsg = 'TMRQuadForest: No node locations'
             raise RuntimeError(errmsg)
 
+    def getNodeNumbers(self, copy=True):
+        """
+        getNodeNumbers(self, copy=True)
+
+        Get the sorted global numbers of the nodes referenced on this
+        processor
+
+        By default, a writeable copy of the data is returned. Set
+        copy=False to obtain a read-only view of the data held by the
+        forest instead. While a view exists, the methods that modify
+        the forest raise a BufferError.
+
+        Args:
+            copy (bool): Return a copy of the node numbers
+
+        Returns:
+            np.ndarray: The global node numbers
+        """
+        cdef const int *nodes = NULL
+        cdef int nnodes = 0
+        nnodes = self.ptr.getNodeNumbers(&nodes)
+        if nodes != NULL:
+            return forest_array_view(self, self.ptr, np.NPY_INT, nnodes, 0,
+                                     <const void*>nodes, copy)
+        else:
+            errmsg = 'TMRQuadForest: No node numbers'
+            raise RuntimeError(errmsg)
+
     def getLocalNodeNumber(self, int node):
         return self.ptr.getLocalNodeNumber(node)
 
@@ -3182,53 +3793,70 @@ cdef class QuadForest:
             errmsg = 'TMRQuadForest: No node range'
             raise RuntimeError(errmsg)
 
-    def getMeshConn(self):
+    def getMeshConn(self, copy=True):
         """
-        getMeshConn(self)
+        getMeshConn(self, copy=True)
 
         Get the portion of the connectivity stored on this processor.
 
+        By default, a writeable copy of the data is returned. Set
+        copy=False to obtain a read-only view of the data held by the
+        forest instead. While a view exists, the methods that modify
+        the forest raise a BufferError.
+
+        Args:
+            copy (bool): Return a copy of the connectivity
+
         Returns:
             np.ndarray: The local part of the connectivity using global node numbers
         """
-        cdef const int *conn
-        cdef int nelems
+        cdef const int *conn = NULL
+        cdef int nelems = 0
         cdef int order = self.ptr.getMeshOrder()
         self.ptr.getNodeConn(&conn, &nelems)
         if conn != NULL:
-            quads = np.zeros((order*order*nelems), dtype=np.intc)
-            for i in range(order*order*nelems):
-                quads[i] = conn[i]
-            return quads.reshape((nelems, order*order))
+            return forest_array_view(self, self.ptr, np.NPY_INT, nelems,
+                                     order*order, <const void*>conn, copy)
         else:
             errmsg = 'TMRQuadForest: No mesh connectivity'
             raise RuntimeError(errmsg)
 
-    def getDepNodeConn(self):
+    def getDepNodeConn(self, copy=True):
         """
-        getDepNodeConn(self)
+        getDepNodeConn(self, copy=True)
 
         Return the dependent node connectivity, weights and number of dependent
         nodes from the quadtree object
 
+        By default, a writeable copy of the data is returned. Set
+        copy=False to obtain a read-only view of the data held by the
+        forest instead. While a view exists, the methods that modify
+        the forest raise a BufferError.
+
+        Args:
+            copy (bool): Return copies of the arrays
+
         Returns:
             ptr (np.ndarray), conn (np.ndarray), weight (np.ndarray):
             Array of dependent nodes, Array of connectivity of dependent nodes
             Array of weights associated with the dependent nodes
         """
         cdef int ndep = 0
+        cdef int size = 0
         cdef const int *_ptr = NULL
         cdef const int *_conn = NULL
         cdef const double *_weights = NULL
         ndep = self.ptr.getDepNodeConn(&_ptr, &_conn, &_weights)
-        ptr = np.zeros(ndep+1, dtype=np.intc)
-        conn = np.zeros(_ptr[ndep], dtype=np.intc)
-        weights = np.zeros(_ptr[ndep], dtype=np.double)
-        for i in range(ndep+1):
-            ptr[i] = _ptr[i]
-        for i in range(ptr[ndep]):
-            conn[i] = _conn[i]
-            weights[i] = _weights[i]
+        if _ptr == NULL:
+            return (np.zeros(1, dtype=np.intc), np.zeros(0, dtype=np.intc),
+                    np.zeros(0, dtype=np.double))
+        size = _ptr[ndep]
+        ptr = forest_array_view(self, self.ptr, np.NPY_INT, ndep+1, 0,
+                                <const void*>_ptr, copy)
+        conn = forest_array_view(self, self.ptr, np.NPY_INT, size, 0,
+                                 <const void*>_conn, copy)
+        weights = forest_array_view(self, self.ptr, np.NPY_DOUBLE, size, 0,
+                                    <const void*>_weights, copy)
         return ptr, conn, weights
 
     def writeToVTK(self, fname):
@@ -3253,6 +3881,34 @@ cdef class QuadForest:
             filename = sfilename.c_str()
         self.ptr.writeForestToVTK(filename)
 
+    def writeForestToVTU(self, prefix, compress=False):
+        """
+        writeForestToVTU(self, prefix, compress=False)
+
+        Write the forest to binary VTK XML files. Each processor writes
+        the file prefix_<rank>.vtu and the root writes prefix.pvtu.
+
+        Args:
+            prefix (str): File name prefix
+            compress (bool): Compress the data (if TMR is built with zlib)
+        """
+        cdef string sprefix = tmr_convert_str_to_chars(prefix)
+        self.ptr.writeForestToVTU(sprefix.c_str(), compress)
+
+    def getMemoryUsage(self):
+        """
+        getMemoryUsage(self)
+
+        Report the memory held by the arrays of the forest. This is a
+        collective call.
+
+        Returns:
+            dict: A map from each array name to the tuple of bytes
+            (local, min, max, total) across all processors and a flag that
+            is True for the peak transient entries
+        """
+        return tmr_convert_memory_usage(self.ptr.getMemoryUsage())
+
     def createInterpolation(self, QuadForest forest, VecInterp vec):
         """
         createInterpolation(self, forest, vec)
@@ -3269,6 +3925,26 @@ cdef class QuadForest:
             raise ValueError(errmsg)
         self.ptr.createInterpolation(forest.ptr, vec.ptr)
 
+    def transferNodalField(self, QuadForest forest, Vec old_vec, Vec new_vec):
+        """
+        transferNodalField(self, forest, old_vec, new_vec)
+
+        Transfer a nodal field from a forest that shares a common topology,
+        such as the forest before a refinement step. The values are
+        evaluated directly from the elements of the old forest without
+        creating an interpolation operator.
+
+        Args:
+            forest (QuadForest): The forest that the field is defined on
+            old_vec (Vec): The nodal field on the old forest
+            new_vec (Vec): The nodal field on this forest (set on output)
+        """
+        if self.ptr == forest.ptr:
+            errmsg = 'Cannot transfer between the same object'
+            raise ValueError(errmsg)
+        self.ptr.transferNodalField(forest.ptr, old_vec.getBVecPtr(),
+                                    new_vec.getBVecPtr())
+
 cdef _init_QuadForest(TMRQuadForest* ptr):
     forest = QuadForest()
     forest.ptr = ptr
@@ -3279,9 +3955,11 @@ cdef _init_QuadForest(TMRQuadForest* ptr):
 cdef class OctantArray:
     cdef TMROctantArray *ptr
     cdef int self_owned
+    cdef object owner
     def __cinit__(self):
         self.self_owned = 0
         self.ptr = NULL
+        self.owner = None
 
     def __dealloc__(self):
         if self.ptr and self.self_owned:
@@ -3340,10 +4018,42 @@ cdef class OctantArray:
         index = t - array
         return index
 
-cdef _init_OctantArray(TMROctantArray *array, int self_owned):
+    def getArray(self, copy=False):
+        """
+        getArray(self, copy=False)
+
+        Get the octants as a numpy structured array with the fields of
+        octant_dtype. By default, the array shares the storage of the octant
+        array, so changes to its entries are reflected in the octants.
+        Set copy=True to obtain a copy.
+
+        Args:
+            copy (bool): Return a copy of the octants
+
+        Returns:
+            np.ndarray: The structured array of octants
+        """
+        cdef int size = 0
+        cdef TMROctant *array = NULL
+        cdef np.npy_intp shape[1]
+        cdef np.ndarray data
+        self.ptr.getArray(&array, &size)
+        if array == NULL or size == 0:
+            return np.zeros(0, dtype=octant_dtype)
+        shape[0] = <np.npy_intp>(size*sizeof(TMROctant))
+        data = np.PyArray_SimpleNewFromData(1, shape, np.NPY_UINT8,
+                                            <void*>array)
+        np.set_array_base(data, self)
+        if copy:
+            return data.view(octant_dtype).copy()
+        return data.view(octant_dtype)
+
+cdef _init_OctantArray(TMROctantArray *array, int self_owned,
+                       object owner=None):
     arr = OctantArray()
     arr.ptr = array
     arr.self_owned = self_owned
+    arr.owner = owner
     return arr
 
 cdef class Octant:
@@ -3412,12 +4122,13 @@ cdef class OctForest:
     """
     cdef TMROctForest *ptr
     def __cinit__(self, MPI.Comm comm=None, int order=2,
-                  TMRInterpolationType interp=GAUSS_LOBATTO_POINTS):
+                  TMRInterpolationType interp=GAUSS_LOBATTO_POINTS,
+                  int release_flags=0):
         cdef MPI_Comm c_comm = NULL
         self.ptr = NULL
         if comm is not None:
             c_comm = comm.ob_mpi
-            self.ptr = new TMROctForest(c_comm, order, interp)
+            self.ptr = new TMROctForest(c_comm, order, interp, release_flags)
             self.ptr.incref()
 
     def __dealloc__(self):
@@ -3435,6 +4146,7 @@ cdef class OctForest:
             order (int): The number of nodes along an edge
             interp (TMRInterpolationType): Type of interpolation to use
         """
+        check_forest_views(self.ptr.getMPIComm(), self.ptr, 0)
         self.ptr.setMeshOrder(order, interp)
 
     def getMeshOrder(self):
@@ -3503,30 +4215,112 @@ cdef class OctForest:
         num_nodes = np.max(conn)+1
         self.ptr.setConnectivity(num_nodes, <int*>conn.data, num_blocks)
 
-    def repartition(self, int max_rank=-1):
+    def repartition(self, int max_rank=-1,
+                    np.ndarray[double, ndim=1, mode='c'] weights=None):
         """
-        repartition(self, max_rank=-1)
+        repartition(self, max_rank=-1, weights=None)
 
         Repartition the mesh across processors. This redistributes the elements
         so that there are an equal, or nearly equal, number of elements on each
-        processor.
+        processor. If weights are provided, the elements are distributed across
+        all processors so that the sum of the weights on each processor is
+        nearly equal.
 
         Args:
             max_rank (int): Number of processors to distribute the mesh across.
             If negative, the mesh is distributed across all processors
+            weights (np.ndarray): Non-negative cost of each local element
+
+        Returns:
+            float: The max processor weight divided by the average weight
         """
-        self.ptr.repartition(max_rank)
+        cdef TMROctantArray *array = NULL
+        cdef TMROctant *octs = NULL
+        cdef int size = 0
+        check_forest_views(self.ptr.getMPIComm(), self.ptr, 1)
+        if weights is None:
+            self.ptr.repartition(max_rank)
+            return 1.0
+        self.ptr.getOctants(&array)
+        if array != NULL:
+            array.getArray(&octs, &size)
+        errmsg = None
+        if weights.shape[0] != size:
+            errmsg = 'Weights length must equal the number of local octants'
+        raise_on_all_ranks(self.ptr.getMPIComm(), errmsg)
+        return self.ptr.repartition(<double*>weights.data)
 
-    def createTrees(self, int depth=0):
+    def setRepartitionTolerance(self, double tol):
         """
-        createTrees(self, depth=0)
+        setRepartitionTolerance(self, tol)
 
-        Create all the octrees in the mesh with the given level of refinement.
-        Be careful, the number of elements created scales with 8**depth!
+        Repartition the mesh automatically after balance() whenever the max
+        processor element count divided by the average exceeds the tolerance.
+        A tolerance of zero disables the automatic repartitioning.
 
         Args:
-            depth (int): Octree of refinement level depth for all trees.
+            tol (float): The imbalance tolerance
         """
+        self.ptr.setRepartitionTolerance(tol)
+
+    def repartitionIfImbalanced(self, double tol,
+                                np.ndarray[double, ndim=1, mode='c'] weights=None):
+        """
+        repartitionIfImbalanced(self, tol, weights=None)
+
+        Repartition the mesh only if the max processor load divided by the
+        average load exceeds the tolerance. The load is the number of elements
+        or, if weights are provided, the sum of the weights on each processor.
+
+        Args:
+            tol (float): The imbalance tolerance
+            weights (np.ndarray): Non-negative cost of each local element
+
+        Returns:
+            bool: Whether the mesh was repartitioned
+        """
+        cdef TMROctantArray *array = NULL
+        cdef TMROctant *octs = NULL
+        cdef int size = 0
+        check_forest_views(self.ptr.getMPIComm(), self.ptr, 1)
+        if weights is None:
+            return self.ptr.repartitionIfImbalanced(tol, NULL) != 0
+        self.ptr.getOctants(&array)
+        if array != NULL:
+            array.getArray(&octs, &size)
+        errmsg = None
+        if weights.shape[0] != size:
+            errmsg = 'Weights length must equal the number of local octants'
+        raise_on_all_ranks(self.ptr.getMPIComm(), errmsg)
+        return self.ptr.repartitionIfImbalanced(tol, <double*>weights.data) != 0
+
+    def getRepartitionStats(self):
+        """
+        getRepartitionStats(self)
+
+        Get the outcome of the last imbalance check
+
+        Returns:
+            tuple: The imbalance before repartitioning, whether the mesh was
+            repartitioned and the bytes of elements moved between processors
+        """
+        cdef double imbalance = 0.0
+        cdef double bytes_moved = 0.0
+        cdef int repartitioned = 0
+        self.ptr.getRepartitionStats(&imbalance, &repartitioned, &bytes_moved)
+        return imbalance, repartitioned != 0, bytes_moved
+
+    def createTrees(self, int depth=0):
+        """
+        createTrees(self, depth=0)
+
+        Create all the octrees in the mesh with the given level of refinement.
+        Be careful, the number of elements created scales with 8**depth!
+
+        Args:
+            depth (int): Octree of refinement level depth for all trees.
+        """
+        check_forest_views(self.ptr.getMPIComm(), self.ptr, 1)
         self.ptr.createTrees(depth)
 
     def createRandomTrees(self, int nrand=10, int min_lev=0, int max_lev=8):
@@ -3541,10 +4335,44 @@ cdef class OctForest:
             min_lev (int): Minimum octant refinement level
             max_lev (int): Maximum octant refinement level
         """
+        check_forest_views(self.ptr.getMPIComm(), self.ptr, 1)
         self.ptr.createRandomTrees(nrand, min_lev, max_lev)
 
-    def refine(self, np.ndarray[int, ndim=1, mode='c'] refine=None,
-               int min_lev=0, int max_lev=MAX_LEVEL):
+    def writeOctantsToFile(self, fname):
+        """
+        writeOctantsToFile(self, fname)
+
+        Write the octants to a binary file that can be read back on any
+        number of processors. The nodes are not stored.
+
+        Args:
+            fname (str): File name
+
+        Returns:
+            int: Non-zero if the file could not be written
+        """
+        cdef string sfilename = tmr_convert_str_to_chars(fname)
+        return self.ptr.writeOctantsToFile(sfilename.c_str())
+
+    def readOctantsFromFile(self, fname):
+        """
+        readOctantsFromFile(self, fname)
+
+        Read the octants from a binary file written with writeOctantsToFile.
+        The connectivity or topology must already be set. The nodes must
+        be created after the octants are read.
+
+        Args:
+            fname (str): File name
+
+        Returns:
+            int: Non-zero if the file could not be read
+        """
+        cdef string sfilename = tmr_convert_str_to_chars(fname)
+        check_forest_views(self.ptr.getMPIComm(), self.ptr, 1)
+        return self.ptr.readOctantsFromFile(sfilename.c_str())
+
+    def refine(self, refine=None, int min_lev=0, int max_lev=MAX_LEVEL):
         """
         refine(self, refine=None, min_level=0, max_level=MAX_LEVEL)
 
@@ -3556,12 +4384,81 @@ cdef class OctForest:
             min_lev (int): Minimum octant refinement level
             max_lev (int): Maximum octant refinement level
         """
+        cdef int size = 0
+        cdef TMROctantArray *array = NULL
+        cdef np.ndarray[int, ndim=1, mode='c'] ref
+        check_forest_views(self.ptr.getMPIComm(), self.ptr, 1)
         if refine is not None:
-            self.ptr.refine(<int*>refine.data, min_lev, max_lev)
+            ref = np.ascontiguousarray(refine, dtype=np.intc).reshape(-1)
+            self.ptr.getOctants(&array)
+            if array != NULL:
+                array.getArray(NULL, &size)
+            errmsg = None
+            if ref.shape[0] != size:
+                errmsg = 'Refinement array length %d does not match the %d octants'%(
+                    ref.shape[0], size)
+            raise_on_all_ranks(self.ptr.getMPIComm(), errmsg)
+            self.ptr.refine(<int*>ref.data, min_lev, max_lev)
         else:
             self.ptr.refine(NULL, min_lev, max_lev)
         return
 
+    def refineAndBalance(self, refine=None, int min_lev=0, int max_lev=MAX_LEVEL,
+                         int btype=0, levels=None):
+        """
+        refineAndBalance(self, refine=None, min_lev=0, max_lev=MAX_LEVEL, btype=0, levels=None)
+
+        Refine the elements in the mesh and balance the result in a single
+        operation. This produces the same mesh as refine() followed by
+        balance(), but requires less memory and a single exchange between
+        neighboring processors.
+
+        Args:
+            refine (np.ndarray): Array of integers indicating element refinement
+            min_lev (int): Minimum octant refinement level
+            max_lev (int): Maximum octant refinement level
+            btype (int): Indicates whether or not to balance across octant corners
+            levels (np.ndarray): Target level for each element (overrides refine)
+        """
+        cdef int i = 0
+        cdef int size = 0
+        cdef int lev = 0
+        cdef TMROctantArray *array = NULL
+        cdef TMROctant *octs = NULL
+        cdef np.ndarray[int, ndim=1, mode='c'] ref
+        cdef np.ndarray[int, ndim=1, mode='c'] target
+        check_forest_views(self.ptr.getMPIComm(), self.ptr, 1)
+        self.ptr.getOctants(&array)
+        if array != NULL:
+            array.getArray(&octs, &size)
+        errmsg = None
+        if levels is not None:
+            target = np.ascontiguousarray(levels, dtype=np.intc).reshape(-1)
+            if target.shape[0] != size:
+                errmsg = 'Target level array length %d does not match the %d octants'%(
+                    target.shape[0], size)
+        else:
+            if refine is not None:
+                ref = np.ascontiguousarray(refine, dtype=np.intc).reshape(-1)
+            else:
+                ref = np.ones(size, dtype=np.intc)
+            if ref.shape[0] != size:
+                errmsg = 'Refinement array length %d does not match the %d octants'%(
+                    ref.shape[0], size)
+            else:
+                # Compute the target levels in the same manner as refine()
+                target = np.zeros(size, dtype=np.intc)
+                for i in range(size):
+                    lev = octs[i].level
+                    if ref[i] > 0 and lev < max_lev:
+                        lev = min(lev + ref[i], max_lev)
+                    elif ref[i] < 0 and lev > min_lev:
+                        lev = max(lev + ref[i], min_lev)
+                    target[i] = lev
+        raise_on_all_ranks(self.ptr.getMPIComm(), errmsg)
+        self.ptr.refineAndBalance(<int*>target.data, btype)
+        return
+
     def duplicate(self):
         """
         duplicate(self)
@@ -3576,30 +4473,74 @@ cdef class OctForest:
         dup = self.ptr.duplicate()
         return _init_OctForest(dup)
 
-    def coarsen(self):
+    def coarsen(self, int nlevels=1):
         """
-        coarsen(self)
+        coarsen(self, nlevels=1)
 
         Create a new forest object by coarsening all the elements within the
-        mesh by one level, if possible. Does not create new nodes.
+        mesh by one level, if possible. Does not create new nodes. When more
+        than one level is specified, the complete families of elements are
+        coarsened by up to nlevels in a single pass.
+
+        Args:
+            nlevels (int): The number of levels to coarsen
 
         Returns:
             OctForest: The coarsened OctForest
         """
         cdef TMROctForest *dup = NULL
-        dup = self.ptr.coarsen()
+        if nlevels == 1:
+            dup = self.ptr.coarsen()
+        else:
+            dup = self.ptr.coarsen(nlevels)
         return _init_OctForest(dup)
 
-    def balance(self, int btype):
+    def coarsenToBudget(self, int max_elements, indicator=None):
         """
-        balance(self, btype)
+        coarsenToBudget(self, max_elements, indicator=None)
+
+        Create a new forest object with at most max_elements elements (before
+        balancing) by coarsening the least important families of elements
+        first. Does not create new nodes.
+
+        Args:
+            max_elements (int): The maximum number of elements
+            indicator (np.ndarray): Optional importance of each element
+
+        Returns:
+            OctForest: The coarsened OctForest
+        """
+        cdef int size = 0
+        cdef TMROctantArray *array = NULL
+        cdef TMROctForest *dup = NULL
+        cdef np.ndarray[double, ndim=1, mode='c'] ind
+        if indicator is not None:
+            ind = np.ascontiguousarray(indicator, dtype=np.double).reshape(-1)
+            self.ptr.getOctants(&array)
+            if array != NULL:
+                array.getArray(NULL, &size)
+            errmsg = None
+            if ind.shape[0] != size:
+                errmsg = 'Indicator array length %d does not match the %d octants'%(
+                    ind.shape[0], size)
+            raise_on_all_ranks(self.ptr.getMPIComm(), errmsg)
+            dup = self.ptr.coarsenToBudget(max_elements, <double*>ind.data)
+        else:
+            dup = self.ptr.coarsenToBudget(max_elements, NULL)
+        return _init_OctForest(dup)
+
+    def balance(self, int btype, int sparse=0):
+        """
+        balance(self, btype, sparse=0)
 
         Balance all the elements in the mesh to achieve a 2-to-1 balance
 
         Args:
             btype (int): Indicates whether or not to balance across octant corners
+            sparse (int): Use a single sparse exchange between neighboring processors
         """
-        self.ptr.balance(btype)
+        check_forest_views(self.ptr.getMPIComm(), self.ptr, 1)
+        self.ptr.balance(btype, sparse)
 
     def createNodes(self):
         """
@@ -3609,6 +4550,19 @@ cdef class OctForest:
         """
         self.ptr.createNodes()
 
+    def setUseIncrementalNodes(self, int flag):
+        """
+        setUseIncrementalNodes(self, flag)
+
+        Keep the local nodes and connectivity after each call to createNodes()
+        so that the next call reuses the connectivity of the elements that have
+        not changed. The global node numbers are always assigned again.
+
+        Args:
+            flag (bool): Whether to create the nodes incrementally
+        """
+        self.ptr.setUseIncrementalNodes(flag)
+
     def getOctsWithName(self, aname):
         """
         getOctsWithName(self, aname)
@@ -3667,26 +4621,54 @@ cdef class OctForest:
         """
         cdef TMROctantArray *array = NULL
         self.ptr.getOctants(&array)
-        return _init_OctantArray(array, 0)
+        return _init_OctantArray(array, 0, self)
 
-    def getPoints(self):
+    def getPoints(self, copy=True):
         """
-        getPoints(self)
+        getPoints(self, copy=True)
 
         Get the node locations for all locally owned nodes
 
+        By default, a writeable copy of the data is returned. Set
+        copy=False to obtain a read-only view of the data held by the
+        forest instead. While a view exists, the methods that modify
+        the forest raise a BufferError.
+
+        Args:
+            copy (bool): Return a copy of the node locations
+
         Returns:
             np.ndarray: An array of node locations
         """
         cdef TMRPoint *X = NULL
         cdef int npts = 0
         npts = self.ptr.getPoints(&X)
-        Xp = np.zeros((npts, 3), dtype=np.double)
-        for i in range(npts):
-            Xp[i,0] = X[i].x
-            Xp[i,1] = X[i].y
-            Xp[i,2] = X[i].z
-        return Xp
+        return forest_array_view(self, self.ptr, np.NPY_DOUBLE, npts, 3,
+                                 <void*>X, copy)
+
+    def getNodeNumbers(self, copy=True):
+        """
+        getNodeNumbers(self, copy=True)
+
+        Get the sorted global numbers of the nodes referenced on this
+        processor
+
+        By default, a writeable copy of the data is returned. Set
+        copy=False to obtain a read-only view of the data held by the
+        forest instead. While a view exists, the methods that modify
+        the forest raise a BufferError.
+
+        Args:
+            copy (bool): Return a copy of the node numbers
+
+        Returns:
+            np.ndarray: The global node numbers
+        """
+        cdef const int *nodes = NULL
+        cdef int nnodes = 0
+        nnodes = self.ptr.getNodeNumbers(&nodes)
+        return forest_array_view(self, self.ptr, np.NPY_INT, nnodes, 0,
+                                 <const void*>nodes, copy)
 
     def getNodeRange(self):
         """
@@ -3705,54 +4687,172 @@ cdef class OctForest:
             r[i] = node_range[i]
         return r
 
-    def getMeshConn(self):
+    def getMeshConn(self, copy=True):
         """
-        getMeshConn(self)
+        getMeshConn(self, copy=True)
 
         Get the portion of the connectivity stored on this processor.
 
+        By default, a writeable copy of the data is returned. Set
+        copy=False to obtain a read-only view of the data held by the
+        forest instead. While a view exists, the methods that modify
+        the forest raise a BufferError.
+
+        Args:
+            copy (bool): Return a copy of the connectivity
+
         Returns:
             np.ndarray: The local part of the connectivity using global node numbers
         """
-        cdef const int *conn
-        cdef int nelems
+        cdef const int *conn = NULL
+        cdef int nelems = 0
         cdef int order = self.ptr.getMeshOrder()
         self.ptr.getNodeConn(&conn, &nelems)
-        octs = np.zeros((order*order*order*nelems), dtype=np.intc)
-        for i in range(order*order*order*nelems):
-            octs[i] = conn[i]
-        return octs.reshape((nelems, order*order*order))
+        return forest_array_view(self, self.ptr, np.NPY_INT, nelems,
+                                 order*order*order, <const void*>conn, copy)
 
-    def getDepNodeConn(self):
+    def getDepNodeConn(self, copy=True):
         """
-        getDepNodeConn(self)
+        getDepNodeConn(self, copy=True)
 
         Return the dependent node connectivity, weights and number of dependent
         nodes from the octree object
 
+        By default, a writeable copy of the data is returned. Set
+        copy=False to obtain a read-only view of the data held by the
+        forest instead. While a view exists, the methods that modify
+        the forest raise a BufferError.
+
+        Args:
+            copy (bool): Return copies of the arrays
+
         Returns:
             ptr (np.ndarray), conn (np.ndarray), weight (np.ndarray):
             Array of dependent nodes, Array of connectivity of dependent nodes
             Array of weights associated with the dependent nodes
         """
         cdef int ndep = 0
+        cdef int size = 0
         cdef const int *_ptr = NULL
         cdef const int *_conn = NULL
         cdef const double *_weights = NULL
         ndep = self.ptr.getDepNodeConn(&_ptr, &_conn, &_weights)
-        ptr = np.zeros(ndep+1, dtype=np.intc)
-        conn = np.zeros(_ptr[ndep], dtype=np.intc)
-        weights = np.zeros(_ptr[ndep], dtype=np.double)
-        for i in range(ndep+1):
-            ptr[i] = _ptr[i]
-        for i in range(ptr[ndep]):
-            conn[i] = _conn[i]
-            weights[i] = _weights[i]
+        if _ptr == NULL:
+            return (np.zeros(1, dtype=np.intc), np.zeros(0, dtype=np.intc),
+                    np.zeros(0, dtype=np.double))
+        size = _ptr[ndep]
+        ptr = forest_array_view(self, self.ptr, np.NPY_INT, ndep+1, 0,
+                                <const void*>_ptr, copy)
+        conn = forest_array_view(self, self.ptr, np.NPY_INT, size, 0,
+                                 <const void*>_conn, copy)
+        weights = forest_array_view(self, self.ptr, np.NPY_DOUBLE, size, 0,
+                                    <const void*>_weights, copy)
         return ptr, conn, weights
 
+    def computeElementNeighbors(self):
+        """
+        computeElementNeighbors(self)
+
+        Compute the ghost layer and the face, edge and corner neighbors of
+        each locally owned octant. The data is freed when the octants of the
+        forest are modified.
+        """
+        check_forest_views(self.ptr.getMPIComm(), self.ptr, 1)
+        self.ptr.computeElementNeighbors()
+
+    def getGhostOctants(self, copy=False):
+        """
+        getGhostOctants(self, copy=False)
+
+        Get the ghost octants owned by other processors that are adjacent to
+        the locally owned octants and their global element numbers
+
+        Args:
+            copy (bool): Return a copy of the element numbers
+
+        Returns:
+            OctantArray, elems (np.ndarray): The ghost octants and their
+            global element numbers
+        """
+        cdef int nghosts = 0
+        cdef TMROctantArray *array = NULL
+        cdef const int *_elems = NULL
+        nghosts = self.ptr.getGhostOctants(&array, &_elems)
+        if array == NULL:
+            return None, np.zeros(0, dtype=np.intc)
+        if _elems == NULL:
+            return _init_OctantArray(array, 0, self), np.zeros(0, dtype=np.intc)
+        elems = forest_array_view(self, self.ptr, np.NPY_INT, nghosts, 0,
+                                  <const void*>_elems, copy)
+        return _init_OctantArray(array, 0, self), elems
+
+    def getElementNeighbors(self, copy=False):
+        """
+        getElementNeighbors(self, copy=False)
+
+        Get the neighbors of each locally owned octant in a compressed row
+        format. Neighbor indices less than the number of local octants refer
+        to local octants, while the remaining indices refer to the ghost
+        octants offset by the number of local octants.
+
+        Args:
+            copy (bool): Return copies of the arrays
+
+        Returns:
+            ptr (np.ndarray), conn (np.ndarray), types (np.ndarray):
+            Pointer into the neighbor array, the neighbor indices and
+            the neighbor types (0: face, 1: edge, 2: corner)
+        """
+        cdef int nelems = 0
+        cdef int size = 0
+        cdef const int *_ptr = NULL
+        cdef const int *_conn = NULL
+        cdef const int *_types = NULL
+        nelems = self.ptr.getElementNeighbors(&_ptr, &_conn, &_types)
+        if _ptr == NULL:
+            return (np.zeros(1, dtype=np.intc), np.zeros(0, dtype=np.intc),
+                    np.zeros(0, dtype=np.intc))
+        size = _ptr[nelems]
+        ptr = forest_array_view(self, self.ptr, np.NPY_INT, nelems+1, 0,
+                                <const void*>_ptr, copy)
+        conn = forest_array_view(self, self.ptr, np.NPY_INT, size, 0,
+                                 <const void*>_conn, copy)
+        types = forest_array_view(self, self.ptr, np.NPY_INT, size, 0,
+                                  <const void*>_types, copy)
+        return ptr, conn, types
+
     def getExtPreOffset(self):
         return self.ptr.getExtPreOffset()
 
+    def setNodeOrdering(self, TMRNodeOrderingType order_type):
+        """
+        setNodeOrdering(self, order_type)
+
+        Set the order of the locally owned nodes. The setting is copied to
+        the forests created from this forest and takes effect when the nodes
+        are next created.
+
+        Args:
+            order_type: NATURAL_NODE_ORDER, ELEMENT_NODE_ORDER or
+                RCM_NODE_ORDER
+        """
+        self.ptr.setNodeOrdering(order_type)
+
+    def getNodeBandwidth(self):
+        """
+        getNodeBandwidth(self)
+
+        Get the maximum bandwidth of the owned node numbers within the
+        elements from the last call to createNodes()
+
+        Returns:
+            tuple: The bandwidth in the natural order and in the selected order
+        """
+        cdef int natural = 0
+        cdef int ordered = 0
+        self.ptr.getNodeBandwidth(&natural, &ordered)
+        return natural, ordered
+
     def writeToVTK(self, fname):
         """
         writeToVTK(self, fname)
@@ -3775,6 +4875,68 @@ cdef class OctForest:
             filename = sfilename.c_str()
         self.ptr.writeForestToVTK(filename)
 
+    def writeForestToVTU(self, prefix, compress=False):
+        """
+        writeForestToVTU(self, prefix, compress=False)
+
+        Write the forest to binary VTK XML files. Each processor writes
+        the file prefix_<rank>.vtu and the root writes prefix.pvtu.
+
+        Args:
+            prefix (str): File name prefix
+            compress (bool): Compress the data (if TMR is built with zlib)
+        """
+        cdef string sprefix = tmr_convert_str_to_chars(prefix)
+        self.ptr.writeForestToVTU(sprefix.c_str(), compress)
+
+    def getMemoryUsage(self):
+        """
+        getMemoryUsage(self)
+
+        Report the memory held by the arrays of the forest. This is a
+        collective call.
+
+        Returns:
+            dict: A map from each array name to the tuple of bytes
+            (local, min, max, total) across all processors and a flag that
+            is True for the peak transient entries
+        """
+        return tmr_convert_memory_usage(self.ptr.getMemoryUsage())
+
+    def releaseTransientData(self, int flags=RELEASE_ALL):
+        """
+        releaseTransientData(self, flags=RELEASE_ALL)
+
+        Release the data that is re-created when it is next required,
+        such as the adjacent octants and the sorted node numbers.
+
+        Args:
+            flags (int): The RELEASE_* flags for the data to release
+        """
+        check_forest_views(self.ptr.getMPIComm(), self.ptr, 0)
+        self.ptr.releaseTransientData(flags)
+
+    def compact(self):
+        """
+        compact(self)
+
+        Release all the data that can be re-created on demand
+        """
+        check_forest_views(self.ptr.getMPIComm(), self.ptr, 0)
+        self.ptr.releaseTransientData(RELEASE_ALL)
+
+    def setReleaseFlags(self, int flags):
+        """
+        setReleaseFlags(self, flags)
+
+        Set the data released once a TACS Assembler is created for this
+        forest. The flags are copied to the forests created from this one.
+
+        Args:
+            flags (int): The RELEASE_* flags for the data to release
+        """
+        self.ptr.setReleaseFlags(flags)
+
     def createInterpolation(self, OctForest forest, VecInterp vec):
         """
         createInterpolation(self, forest, vec)
@@ -3791,6 +4953,26 @@ cdef class OctForest:
             raise ValueError(errmsg)
         self.ptr.createInterpolation(forest.ptr, vec.ptr)
 
+    def transferNodalField(self, OctForest forest, Vec old_vec, Vec new_vec):
+        """
+        transferNodalField(self, forest, old_vec, new_vec)
+
+        Transfer a nodal field from a forest that shares a common topology,
+        such as the forest before a refinement step. The values are
+        evaluated directly from the elements of the old forest without
+        creating an interpolation operator.
+
+        Args:
+            forest (OctForest): The forest that the field is defined on
+            old_vec (Vec): The nodal field on the old forest
+            new_vec (Vec): The nodal field on this forest (set on output)
+        """
+        if self.ptr == forest.ptr:
+            errmsg = 'Cannot transfer between the same object'
+            raise ValueError(errmsg)
+        self.ptr.transferNodalField(forest.ptr, old_vec.getBVecPtr(),
+                                    new_vec.getBVecPtr())
+
 cdef _init_OctForest(TMROctForest* ptr):
     forest = OctForest()
     forest.ptr = ptr
@@ -3798,6 +4980,200 @@ cdef _init_OctForest(TMROctForest* ptr):
         forest.ptr.incref()
     return forest
 
+cdef class ForestField:
+    """
+    A field with a fixed number of values for each element of an OctForest.
+    The values follow the forest when it is repartitioned, refined, balanced
+    or coarsened, and are transferred from the overlapping elements using the
+    transfer rule (FIELD_AVERAGE, FIELD_SUM or FIELD_MAX).
+    """
+    cdef TMRForestField *ptr
+    def __cinit__(self, OctForest forest, int num_components=1,
+                  TMRFieldTransferType transfer_type=TMR_FIELD_AVERAGE):
+        if num_components < 1:
+            raise ValueError('Number of components must be positive')
+        self.ptr = new TMRForestField(forest.ptr, num_components,
+                                      transfer_type)
+        self.ptr.incref()
+
+    def __dealloc__(self):
+        if self.ptr:
+            self.ptr.decref()
+
+    def getForest(self):
+        """
+        getForest(self)
+
+        Get the forest that the values correspond to
+
+        Returns:
+            OctForest: The forest of the field
+        """
+        return _init_OctForest(self.ptr.getForest())
+
+    def getValues(self):
+        """
+        getValues(self)
+
+        Get a copy of the values for the local elements, in the order of the
+        local octants. This is collective if the forest has changed since the
+        values were last transferred.
+
+        Returns:
+            np.ndarray: The (number of local elements, components) values
+        """
+        cdef int i = 0
+        cdef int size = 0
+        cdef int ncomp = self.ptr.getNumComponents()
+        cdef double *values = NULL
+        size = self.ptr.getValues(&values)
+        array = np.zeros(size*ncomp, dtype=np.double)
+        for i in range(size*ncomp):
+            array[i] = values[i]
+        return array.reshape(size, ncomp)
+
+    def setValues(self, values):
+        """
+        setValues(self, values)
+
+        Set the values for the local elements, in the order of the local
+        octants. This is collective if the forest has changed since the values
+        were last transferred.
+
+        Args:
+            values (np.ndarray): The (number of local elements, components) values
+        """
+        cdef int i = 0
+        cdef int size = 0
+        cdef int ncomp = self.ptr.getNumComponents()
+        cdef double *ptr = NULL
+        cdef np.ndarray[double, ndim=1, mode='c'] vals
+        size = self.ptr.getValues(&ptr)
+        vals = np.ascontiguousarray(values, dtype=np.double).reshape(-1)
+        if vals.shape[0] != size*ncomp:
+            errmsg = 'Value array length %d does not match %d elements of %d components'%(
+                vals.shape[0], size, ncomp)
+            raise ValueError(errmsg)
+        for i in range(size*ncomp):
+            ptr[i] = vals[i]
+
+    def zeroValues(self):
+        """
+        zeroValues(self)
+
+        Set the values for the local elements to zero
+        """
+        self.ptr.zeroValues()
+
+    def update(self):
+        """
+        update(self)
+
+        Transfer the values to the current elements of the forest. This is
+        collective if the forest has changed since the values were last
+        transferred.
+        """
+        self.ptr.update()
+
+    def setForest(self, OctForest forest):
+        """
+        setForest(self, forest)
+
+        Transfer the values to the elements of another forest that covers the
+        same domain, such as the forest returned by coarsen(). This is
+        collective.
+
+        Args:
+            forest (OctForest): The new forest
+        """
+        self.ptr.setForest(forest.ptr)
+
+cdef class OctForestHierarchy:
+    """
+    A hierarchy of OctForests for multigrid, created from the finest forest in
+    a single pass. Each coarser level either reduces the mesh order of the
+    previous level, until min_order is reached, or coarsens and balances it.
+    The levels share the topology and the cached node locations of the finest
+    forest.
+    """
+    cdef TMROctForestHierarchy *ptr
+    def __cinit__(self, OctForest forest, int num_levels, int min_order=2,
+                  int balance_corner=0, repartition=False):
+        cdef int repart = 0
+        if repartition:
+            repart = 1
+        self.ptr = new TMROctForestHierarchy(forest.ptr, num_levels, min_order,
+                                             balance_corner, repart)
+        self.ptr.incref()
+
+    def __dealloc__(self):
+        if self.ptr:
+            self.ptr.decref()
+
+    def getNumLevels(self):
+        """
+        getNumLevels(self)
+
+        Get the number of levels in the hierarchy
+
+        Returns:
+            int: The number of levels
+        """
+        return self.ptr.getNumLevels()
+
+    def getForest(self, int level):
+        """
+        getForest(self, level)
+
+        Get the forest on a level of the hierarchy (level 0 is the finest)
+
+        Args:
+            level (int): The level
+
+        Returns:
+            OctForest: The forest on the level
+        """
+        if level < 0 or level >= self.ptr.getNumLevels():
+            raise IndexError('Level %d out of range'%(level))
+        return _init_OctForest(self.ptr.getForest(level))
+
+    def getForests(self):
+        """
+        getForests(self)
+
+        Get the forests on all levels, ordered from finest to coarsest
+
+        Returns:
+            list: The OctForest on each level
+        """
+        return [self.getForest(i) for i in range(self.ptr.getNumLevels())]
+
+    def createInterpolation(self, list interps):
+        """
+        createInterpolation(self, interps)
+
+        Create the interpolation from each level to the next finer level. The
+        operator interps[i] interpolates from level i+1 to level i. The
+        interpolation for all the levels is computed together, so the node
+        exchanges between processors for each level overlap. This is
+        collective.
+
+        Args:
+            interps (list): The num_levels-1 VecInterp objects
+        """
+        cdef int nlevels = self.ptr.getNumLevels()
+        cdef TACSBVecInterp **vec = NULL
+        if len(interps) != nlevels-1:
+            errmsg = 'Expected %d interpolation objects'%(nlevels-1)
+            raise ValueError(errmsg)
+        if nlevels < 2:
+            return
+        vec = <TACSBVecInterp**>malloc((nlevels-1)*sizeof(TACSBVecInterp*))
+        for i in range(nlevels-1):
+            vec[i] = (<VecInterp>interps[i]).ptr
+        self.ptr.createInterpolation(vec)
+        free(vec)
+
 def sewModel(file, units="M", int print_level=0, sew_options={}):
     """
     Load in a STEP/IGES file, apply a sewing operation with OpenCASCADE,
@@ -3829,29 +5205,58 @@ def sewModel(file, units="M", int print_level=0, sew_options={}):
         print("model file extension not supported")
     return
 
-def LoadModel(fname, units="M", int print_lev=0):
+def LoadModel(fname, units="M", int print_lev=0, MPI.Comm comm=None,
+              sew=False, double sew_tol=1e-6, cache_dir=None):
     """
-    LoadModel(fname, print_lev=0)
+    LoadModel(fname, print_lev=0, comm=None, sew=False, sew_tol=1e-6,
+              cache_dir=None)
 
     Load and initialize a Model class based on information within a STEP, IGES or
     EGADS file. The file type is determined based on the extension.
 
+    When a communicator is provided, STEP and IGES files are translated
+    (and optionally sewn) on the root processor only and the translated
+    model is broadcast to all processors. When cache_dir is also given,
+    the translated model is stored in that directory and re-used on
+    subsequent loads of the same file with the same options.
+
     Args:
         fname (str): Name of the geometry file
         units (str): Units to use when reading in geometry file (IGES/STEP)
         print_lev (int): Print level for operation
+        comm (MPI.Comm): Communicator for a root-only load (IGES/STEP)
+        sew (bool): Sew the model on the root processor (IGES/STEP)
+        sew_tol (float): Tolerance for the sewing operation
+        cache_dir (str): Directory for the translated model cache
 
     Returns:
         Model: An instance of a Model class
     """
     cdef string sfilename = tmr_convert_str_to_chars(fname)
     cdef string sunits = tmr_convert_str_to_chars(units)
+    cdef string scache
     cdef const char *units_c = sunits.c_str()
     cdef const char *filename = NULL
+    cdef const char *cache_c = NULL
+    cdef MPI_Comm c_comm
+    cdef int sew_model = 0
     cdef TMRModel *model = NULL
     if fname is not None:
         filename = sfilename.c_str()
-    if fname.lower().endswith(('step', 'stp')):
+    if cache_dir is not None:
+        scache = tmr_convert_str_to_chars(cache_dir)
+        cache_c = scache.c_str()
+    if sew:
+        sew_model = 1
+    if comm is not None and fname.lower().endswith(('step', 'stp')):
+        c_comm = comm.ob_mpi
+        model = TMR_LoadModelFromSTEPFile(c_comm, filename, units_c, print_lev,
+                                          sew_model, sew_tol, cache_c)
+    elif comm is not None and fname.lower().endswith(('igs', 'iges')):
+        c_comm = comm.ob_mpi
+        model = TMR_LoadModelFromIGESFile(c_comm, filename, units_c, print_lev,
+                                          sew_model, sew_tol, cache_c)
+    elif fname.lower().endswith(('step', 'stp')):
         model = TMR_LoadModelFromSTEPFile(filename, units_c, print_lev)
     elif fname.lower().endswith(('igs', 'iges')):
         model = TMR_LoadModelFromIGESFile(filename, units_c, print_lev)
@@ -3947,6 +5352,55 @@ cdef class BoundaryConditions:
             self.ptr.addBoundaryCondition(name, 0, NULL, NULL)
         return
 
+cdef element_array_view(int nelems, size_t elem_size, void *array, dtype):
+    """
+    Return a read-only structured numpy view of the quadrants or octants
+    passed to a batched createElements() callback. The view is only valid
+    for the duration of the callback and must be copied to be stored.
+    """
+    cdef np.npy_intp shape[1]
+    cdef np.ndarray data
+    if array == NULL or nelems == 0:
+        return np.zeros(0, dtype=dtype)
+    shape[0] = <np.npy_intp>(nelems*elem_size)
+    data = np.PyArray_SimpleNewFromData(1, shape, np.NPY_UINT8, array)
+    np.PyArray_CLEARFLAGS(data, np.NPY_ARRAY_WRITEABLE)
+    return data.view(dtype)
+
+cdef int set_element_table(object result, int num_elements,
+                           TACSElement **elements) except -1:
+    """
+    Set the elements from the (elems, index) tuple returned by a batched
+    createElements() callback, where element i is elems[index[i]]
+    """
+    cdef int i = 0
+    cdef int k = 0
+    cdef int nelems = 0
+    cdef int *idx = NULL
+    cdef np.ndarray index
+    cdef TACSElement **table = NULL
+    elems, index_list = result
+    index = np.ascontiguousarray(index_list, dtype=np.intc)
+    if index.ndim != 1 or index.shape[0] != num_elements:
+        errmsg = 'createElements must return an index for each element'
+        raise ValueError(errmsg)
+
+    nelems = len(elems)
+    table = <TACSElement**>malloc((nelems+1)*sizeof(TACSElement*))
+    for k in range(nelems):
+        table[k] = NULL
+        if elems[k] is not None:
+            table[k] = (<Element>elems[k]).ptr
+
+    idx = <int*>index.data
+    for i in range(num_elements):
+        k = idx[i]
+        if k >= 0 and k < nelems and table[k] != NULL:
+            table[k].incref()
+            elements[i] = table[k]
+    free(table)
+    return 0
+
 cdef TACSElement* _createQuadElement(void *_self, int order,
                                      TMRQuadrant *quad):
     cdef TACSElement *elem = NULL
@@ -3964,6 +5418,19 @@ cdef TACSElement* _createQuadElement(void *_self, int order,
         return elem
     return NULL
 
+cdef int _createQuadElements(void *_self, int order, int num_elements,
+                             TMRQuadrant *array, TACSElement **elements):
+    try:
+        quads = element_array_view(num_elements, sizeof(TMRQuadrant),
+                                   <void*>array, quadrant_dtype)
+        result = (<object>_self).createElements(order, quads)
+        set_element_table(result, num_elements, elements)
+    except:
+        tb = traceback.format_exc()
+        print(tb)
+        return 1
+    return 0
+
 cdef class QuadCreator:
     """
     Generates a QuadForest object
@@ -3975,6 +5442,15 @@ cdef class QuadCreator:
 
     This function takes the order of the mesh and a TMR.Quadrant and returns a
     TACS.Element object that will be placed into an Assembler object.
+
+    For large meshes, implement the batched member function instead:
+
+    createElements(self, order, quads)
+
+    This function is called once with a read-only structured array of all the
+    quadrants with the fields of TMR.quadrant_dtype. It returns a tuple
+    (elems, index) where elems is a list of TACS.Element objects and index is
+    an integer array so that element i is elems[index[i]].
     """
     cdef TMRCyQuadCreator *ptr
     def __cinit__(self, BoundaryConditions bcs, int design_vars_per_node=1,
@@ -3983,6 +5459,8 @@ cdef class QuadCreator:
         self.ptr.incref()
         self.ptr.setSelfPointer(<void*>self)
         self.ptr.setCreateQuadElement(_createQuadElement)
+        if hasattr(self, 'createElements'):
+            self.ptr.setCreateQuadElements(_createQuadElements)
         return
 
     def __dealloc__(self):
@@ -4049,6 +5527,19 @@ cdef TACSElement* _createOctElement(void *_self, int order,
         return elem
     return NULL
 
+cdef int _createOctElements(void *_self, int order, int num_elements,
+                            TMROctant *array, TACSElement **elements):
+    try:
+        octs = element_array_view(num_elements, sizeof(TMROctant),
+                                  <void*>array, octant_dtype)
+        result = (<object>_self).createElements(order, octs)
+        set_element_table(result, num_elements, elements)
+    except:
+        tb = traceback.format_exc()
+        print(tb)
+        return 1
+    return 0
+
 cdef class OctCreator:
     """
     Generates a OctCreator object
@@ -4060,6 +5551,15 @@ cdef class OctCreator:
 
     This function takes the order of the mesh and a TMR.Octant and returns a
     TACS.Element object that will be placed into an Assembler object.
+
+    For large meshes, implement the batched member function instead:
+
+    createElements(self, order, octs)
+
+    This function is called once with a read-only structured array of all the
+    octants with the fields of TMR.octant_dtype. It returns a tuple
+    (elems, index) where elems is a list of TACS.Element objects and index is
+    an integer array so that element i is elems[index[i]].
     """
     cdef TMRCyOctCreator *ptr
     def __cinit__(self, BoundaryConditions bcs,
@@ -4069,6 +5569,8 @@ cdef class OctCreator:
         self.ptr.incref()
         self.ptr.setSelfPointer(<void*>self)
         self.ptr.setCreateOctElement(_createOctElement)
+        if hasattr(self, 'createElements'):
+            self.ptr.setCreateOctElements(_createOctElements)
         return
 
     def __dealloc__(self):
@@ -4119,10 +5621,102 @@ cdef class OctCreator:
         return None
 
 
+cdef class WeightPool:
+    """
+    The filter weights for the elements created by a QuadTopoCreator or an
+    OctTopoCreator
+
+    Each element stores the indices of its design nodes and the index of its
+    weight pattern. Each distinct pattern of weight values is stored once.
+    The arrays returned by this class are read-only views of the pool.
+    """
+    cdef TMRWeightPool *ptr
+    def __cinit__(self):
+        self.ptr = NULL
+
+    def __dealloc__(self):
+        if self.ptr:
+            self.ptr.decref()
+
+    def getNumPatterns(self):
+        """Return the number of distinct weight patterns"""
+        return self.ptr.getNumPatterns()
+
+    def getNumWeights(self):
+        """Return the number of weights for each element"""
+        return self.ptr.getNumWeights()
+
+    def getNumElements(self):
+        """Return the number of elements"""
+        return self.ptr.getNumElements()
+
+    def getIndexTable(self):
+        """
+        getIndexTable(self)
+
+        Get the local design node indices of each element
+
+        Returns:
+            np.ndarray: The (number of elements, number of weights) indices
+        """
+        cdef const int *index = NULL
+        self.ptr.getElementTables(&index, NULL)
+        return self._view(np.NPY_INT, self.ptr.getNumElements(),
+                          self.ptr.getNumWeights(), <const void*>index)
+
+    def getElementPatterns(self):
+        """
+        getElementPatterns(self)
+
+        Get the index of the weight pattern of each element
+
+        Returns:
+            np.ndarray: The pattern index of each element
+        """
+        cdef const int *pattern = NULL
+        self.ptr.getElementTables(NULL, &pattern)
+        return self._view(np.NPY_INT, self.ptr.getNumElements(), 0,
+                          <const void*>pattern)
+
+    def getPatterns(self):
+        """
+        getPatterns(self)
+
+        Get the distinct patterns of weight values
+
+        Returns:
+            np.ndarray: The (number of patterns, number of weights) weights
+        """
+        return self._view(np.NPY_DOUBLE, self.ptr.getNumPatterns(),
+                          self.ptr.getNumWeights(),
+                          <const void*>self.ptr.getPatterns())
+
+    cdef _view(self, int nptype, int dim1, int dim2, const void *data_ptr):
+        cdef int nd = 1
+        cdef np.npy_intp shape[2]
+        cdef np.ndarray ndarray
+        shape[0] = <np.npy_intp>dim1
+        shape[1] = <np.npy_intp>dim2
+        if dim2 > 0:
+            nd = 2
+        if data_ptr == NULL or dim1 == 0:
+            return np.PyArray_ZEROS(nd, shape, nptype, 0)
+        ndarray = np.PyArray_SimpleNewFromData(nd, shape, nptype,
+                                               <void*>data_ptr)
+        np.PyArray_CLEARFLAGS(ndarray, np.NPY_ARRAY_WRITEABLE)
+        np.set_array_base(ndarray, self)
+        return ndarray
+
+cdef _init_WeightPool(TMRWeightPool *ptr):
+    pool = WeightPool()
+    pool.ptr = ptr
+    pool.ptr.incref()
+    return pool
+
 cdef TACSElement* _createQuadTopoElement(void *_self, int order,
                                          TMRQuadrant *quad,
                                          int nweights,
-                                         TMRIndexWeight *weights):
+                                         TMRIndexWeight *weights) with gil:
     cdef TACSElement *elem = NULL
     q = Quadrant()
     q.quad.x = quad.x
@@ -4143,7 +5737,35 @@ cdef TACSElement* _createQuadTopoElement(void *_self, int order,
         return elem
     return NULL
 
+cdef int _createQuadTopoElements(void *_self, int order, int num_elements,
+                                 TMRQuadrant *array, TMRWeightPool *pool,
+                                 TACSElement **elements) with gil:
+    try:
+        quads = element_array_view(num_elements, sizeof(TMRQuadrant),
+                                   <void*>array, quadrant_dtype)
+        result = (<object>_self).createElements(order, quads,
+                                                _init_WeightPool(pool))
+        set_element_table(result, num_elements, elements)
+    except:
+        tb = traceback.format_exc()
+        print(tb)
+        return 1
+    return 0
+
 cdef class QuadTopoCreator:
+    """
+    Create the elements for topology optimization with a filter
+
+    Inherit from this class and implement createElement(self, order, quad,
+    index, weights), which is called for each element with the local design
+    node numbers index and the filter weights of the element, or the batched
+    createElements(self, order, quads, pool), which is called once with all of
+    the quadrants and the WeightPool of the filter weights. The batched
+    function returns a tuple (elems, index) where element i is
+    elems[index[i]]. A QuadConstitutive created with the pool looks up the
+    weights by element index, so a single element may be shared by all of
+    the elements.
+    """
     cdef TMRCyTopoQuadCreator *ptr
     def __cinit__(self, BoundaryConditions bcs, QuadForest filt,
                   int design_vars_per_node=1, *args, **kwargs):
@@ -4151,6 +5773,8 @@ cdef class QuadTopoCreator:
         self.ptr.incref()
         self.ptr.setSelfPointer(<void*>self)
         self.ptr.setCreateQuadTopoElement(_createQuadTopoElement)
+        if hasattr(self, 'createElements'):
+            self.ptr.setCreateQuadTopoElements(_createQuadTopoElements)
         return
 
     def __dealloc__(self):
@@ -4160,18 +5784,53 @@ cdef class QuadTopoCreator:
     def createTACS(self, QuadForest forest,
                    OrderingType ordering=TACS.NATURAL_ORDER):
         cdef TACSAssembler *assembler = NULL
-        assembler = self.ptr.createTACS(forest.ptr, ordering)
+        if self.ptr.getThreadSafeElements():
+            with nogil:
+                assembler = self.ptr.createTACS(forest.ptr, ordering)
+        else:
+            assembler = self.ptr.createTACS(forest.ptr, ordering)
         return _init_Assembler(assembler)
 
+    def setThreadSafeElements(self, int flag):
+        """
+        Indicate whether createElement() may be called concurrently
+
+        When TMR is built with OpenMP and the flag is set, the elements are
+        created in a parallel loop. The GIL is released within createTACS()
+        and acquired again for each call to createElement(), so the python
+        calls themselves are still made one at a time.
+
+        This only applies to the creation of the elements. The elements and
+        the TMR constitutive objects keep scratch space as members, so they
+        must not be evaluated by several threads at once. See
+        TMR.setThreadSafeElements() for the element evaluations in the error
+        estimates.
+        """
+        self.ptr.setThreadSafeElements(flag)
+        return
+
+    def getThreadSafeElements(self):
+        """Return whether the elements are created concurrently"""
+        return self.ptr.getThreadSafeElements()
+
     def getFilter(self):
         cdef TMRQuadForest *filtr = self.ptr.getFilter()
         return _init_QuadForest(filtr)
 
+    def getWeightPool(self):
+        """
+        Get the WeightPool of filter weights from the last call to createTACS()
+        """
+        cdef TMRWeightPool *pool = self.ptr.getWeightPool()
+        if pool:
+            return _init_WeightPool(pool)
+        return None
+
 cdef TACSElement* _createQuadConformTopoElement(void *_self, int order,
                                                 TMRQuadrant *quad,
                                                 int nweights,
                                                 const int *index,
-                                                TMRQuadForest *filtr):
+                                                TMRQuadForest *filtr) with gil:
     cdef TACSElement *elem = NULL
     q = Quadrant()
     q.quad.x = quad.x
@@ -4192,7 +5851,36 @@ cdef TACSElement* _createQuadConformTopoElement(void *_self, int order,
         return elem
     return NULL
 
+cdef int _createQuadConformTopoElements(void *_self, int order,
+                                        int num_elements, TMRQuadrant *array,
+                                        int nweights, const int *conn,
+                                        TMRQuadForest *filtr,
+                                        TACSElement **elements) with gil:
+    try:
+        quads = element_array_view(num_elements, sizeof(TMRQuadrant),
+                                   <void*>array, quadrant_dtype)
+        qf = _init_QuadForest(filtr)
+        index = forest_array_view(qf, filtr, np.NPY_INT, num_elements,
+                                  nweights, <const void*>conn, False)
+        result = (<object>_self).createElements(order, quads, index, qf)
+        set_element_table(result, num_elements, elements)
+    except:
+        tb = traceback.format_exc()
+        print(tb)
+        return 1
+    return 0
+
 cdef class QuadConformTopoCreator:
+    """
+    Create the elements for topology optimization on a conforming filter
+
+    Inherit from this class and implement createElement(self, order, quad,
+    index, filtr), which is called for each element with the filter node
+    numbers index, or the batched createElements(self, order, quads, index,
+    filtr), which is called once with all of the quadrants and an array of
+    the filter node numbers for each element. The batched function returns a
+    tuple (elems, index) where element i is elems[index[i]].
+    """
     cdef TMRCyTopoQuadConformCreator *ptr
     def __cinit__(self, BoundaryConditions bcs, QuadForest forest,
                   int design_vars_per_node=1,
@@ -4203,6 +5891,8 @@ cdef class QuadConformTopoCreator:
         self.ptr.incref()
         self.ptr.setSelfPointer(<void*>self)
         self.ptr.setCreateQuadTopoElement(_createQuadConformTopoElement)
+        if hasattr(self, 'createElements'):
+            self.ptr.setCreateQuadTopoElements(_createQuadConformTopoElements)
         return
 
     def __dealloc__(self):
@@ -4212,9 +5902,35 @@ cdef class QuadConformTopoCreator:
     def createTACS(self, QuadForest forest,
                    OrderingType ordering=TACS.NATURAL_ORDER):
         cdef TACSAssembler *assembler = NULL
-        assembler = self.ptr.createTACS(forest.ptr, ordering)
+        if self.ptr.getThreadSafeElements():
+            with nogil:
+                assembler = self.ptr.createTACS(forest.ptr, ordering)
+        else:
+            assembler = self.ptr.createTACS(forest.ptr, ordering)
         return _init_Assembler(assembler)
 
+    def setThreadSafeElements(self, int flag):
+        """
+        Indicate whether createElement() may be called concurrently
+
+        When TMR is built with OpenMP and the flag is set, the elements are
+        created in a parallel loop. The GIL is released within createTACS()
+        and acquired again for each call to createElement(), so the python
+        calls themselves are still made one at a time.
+
+        This only applies to the creation of the elements. The elements and
+        the TMR constitutive objects keep scratch space as members, so they
+        must not be evaluated by several threads at once. See
+        TMR.setThreadSafeElements() for the element evaluations in the error
+        estimates.
+        """
+        self.ptr.setThreadSafeElements(flag)
+        return
+
+    def getThreadSafeElements(self):
+        """Return whether the elements are created concurrently"""
+        return self.ptr.getThreadSafeElements()
+
     def getFilter(self):
         cdef TMRQuadForest *filtr = self.ptr.getFilter()
         return _init_QuadForest(filtr)
@@ -4222,7 +5938,7 @@ cdef class QuadConformTopoCreator:
 cdef TACSElement* _createOctTopoElement(void *_self, int order,
                                         TMROctant *octant,
                                         int nweights,
-                                        TMRIndexWeight *weights):
+                                        TMRIndexWeight *weights) with gil:
     cdef TACSElement *elem = NULL
     oct = Octant()
     oct.octant.x = octant.x
@@ -4244,7 +5960,35 @@ cdef TACSElement* _createOctTopoElement(void *_self, int order,
         return elem
     return NULL
 
+cdef int _createOctTopoElements(void *_self, int order, int num_elements,
+                                TMROctant *array, TMRWeightPool *pool,
+                                TACSElement **elements) with gil:
+    try:
+        octs = element_array_view(num_elements, sizeof(TMROctant),
+                                  <void*>array, octant_dtype)
+        result = (<object>_self).createElements(order, octs,
+                                                _init_WeightPool(pool))
+        set_element_table(result, num_elements, elements)
+    except:
+        tb = traceback.format_exc()
+        print(tb)
+        return 1
+    return 0
+
 cdef class OctTopoCreator:
+    """
+    Create the elements for topology optimization with a filter
+
+    Inherit from this class and implement createElement(self, order, oct,
+    index, weights), which is called for each element with the local design
+    node numbers index and the filter weights of the element, or the batched
+    createElements(self, order, octs, pool), which is called once with all of
+    the octants and the WeightPool of the filter weights. The batched
+    function returns a tuple (elems, index) where element i is
+    elems[index[i]]. An OctConstitutive created with the pool looks up the
+    weights by element index, so a single element may be shared by all of
+    the elements.
+    """
     cdef TMRCyTopoOctCreator *ptr
     def __cinit__(self, BoundaryConditions bcs, OctForest filt,
                   int design_vars_per_node=1, *args, **kwargs):
@@ -4253,6 +5997,8 @@ cdef class OctTopoCreator:
         self.ptr.incref()
         self.ptr.setSelfPointer(<void*>self)
         self.ptr.setCreateOctTopoElement(_createOctTopoElement)
+        if hasattr(self, 'createElements'):
+            self.ptr.setCreateOctTopoElements(_createOctTopoElements)
         return
 
     def __dealloc__(self):
@@ -4262,18 +6008,53 @@ cdef class OctTopoCreator:
     def createTACS(self, OctForest forest,
                    OrderingType ordering=TACS.NATURAL_ORDER):
         cdef TACSAssembler *assembler = NULL
-        assembler = self.ptr.createTACS(forest.ptr, ordering)
+        if self.ptr.getThreadSafeElements():
+            with nogil:
+                assembler = self.ptr.createTACS(forest.ptr, ordering)
+        else:
+            assembler = self.ptr.createTACS(forest.ptr, ordering)
         return _init_Assembler(assembler)
 
+    def setThreadSafeElements(self, int flag):
+        """
+        Indicate whether createElement() may be called concurrently
+
+        When TMR is built with OpenMP and the flag is set, the elements are
+        created in a parallel loop. The GIL is released within createTACS()
+        and acquired again for each call to createElement(), so the python
+        calls themselves are still made one at a time.
+
+        This only applies to the creation of the elements. The elements and
+        the TMR constitutive objects keep scratch space as members, so they
+        must not be evaluated by several threads at once. See
+        TMR.setThreadSafeElements() for the element evaluations in the error
+        estimates.
+        """
+        self.ptr.setThreadSafeElements(flag)
+        return
+
+    def getThreadSafeElements(self):
+        """Return whether the elements are created concurrently"""
+        return self.ptr.getThreadSafeElements()
+
     def getFilter(self):
         cdef TMROctForest *filtr = self.ptr.getFilter()
         return _init_OctForest(filtr)
 
+    def getWeightPool(self):
+        """
+        Get the WeightPool of filter weights from the last call to createTACS()
+        """
+        cdef TMRWeightPool *pool = self.ptr.getWeightPool()
+        if pool:
+            return _init_WeightPool(pool)
+        return None
+
 cdef TACSElement* _createOctConformTopoElement( void *_self, int order,
                                                 TMROctant *octant,
                                                 int nweights,
                                                 const int *index,
-                                                TMROctForest *filtr):
+                                                TMROctForest *filtr) with gil:
     cdef TACSElement *elem = NULL
     Oct = Octant()
     Oct.octant.x = octant.x
@@ -4295,7 +6076,36 @@ cdef TACSElement* _createOctConformTopoElement( void *_self, int order,
         return elem
     return NULL
 
+cdef int _createOctConformTopoElements(void *_self, int order,
+                                       int num_elements, TMROctant *array,
+                                       int nweights, const int *conn,
+                                       TMROctForest *filtr,
+                                       TACSElement **elements) with gil:
+    try:
+        octs = element_array_view(num_elements, sizeof(TMROctant),
+                                  <void*>array, octant_dtype)
+        of = _init_OctForest(filtr)
+        index = forest_array_view(of, filtr, np.NPY_INT, num_elements,
+                                  nweights, <const void*>conn, False)
+        result = (<object>_self).createElements(order, octs, index, of)
+        set_element_table(result, num_elements, elements)
+    except:
+        tb = traceback.format_exc()
+        print(tb)
+        return 1
+    return 0
+
 cdef class OctConformTopoCreator:
+    """
+    Create the elements for topology optimization on a conforming filter
+
+    Inherit from this class and implement createElement(self, order, oct,
+    index, filtr), which is called for each element with the filter node
+    numbers index, or the batched createElements(self, order, octs, index,
+    filtr), which is called once with all of the octants and an array of
+    the filter node numbers for each element. The batched function returns a
+    tuple (elems, index) where element i is elems[index[i]].
+    """
     cdef TMRCyTopoOctConformCreator *ptr
     def __cinit__(self, BoundaryConditions bcs, OctForest forest,
                   int design_vars_per_node=1,
@@ -4307,6 +6117,8 @@ cdef class OctConformTopoCreator:
         self.ptr.incref()
         self.ptr.setSelfPointer(<void*>self)
         self.ptr.setCreateOctTopoElement(_createOctConformTopoElement)
+        if hasattr(self, 'createElements'):
+            self.ptr.setCreateOctTopoElements(_createOctConformTopoElements)
         return
 
     def __dealloc__(self):
@@ -4316,9 +6128,35 @@ cdef class OctConformTopoCreator:
     def createTACS(self, OctForest forest,
                    OrderingType ordering=TACS.NATURAL_ORDER):
         cdef TACSAssembler *assembler = NULL
-        assembler = self.ptr.createTACS(forest.ptr, ordering)
+        if self.ptr.getThreadSafeElements():
+            with nogil:
+                assembler = self.ptr.createTACS(forest.ptr, ordering)
+        else:
+            assembler = self.ptr.createTACS(forest.ptr, ordering)
         return _init_Assembler(assembler)
 
+    def setThreadSafeElements(self, int flag):
+        """
+        Indicate whether createElement() may be called concurrently
+
+        When TMR is built with OpenMP and the flag is set, the elements are
+        created in a parallel loop. The GIL is released within createTACS()
+        and acquired again for each call to createElement(), so the python
+        calls themselves are still made one at a time.
+
+        This only applies to the creation of the elements. The elements and
+        the TMR constitutive objects keep scratch space as members, so they
+        must not be evaluated by several threads at once. See
+        TMR.setThreadSafeElements() for the element evaluations in the error
+        estimates.
+        """
+        self.ptr.setThreadSafeElements(flag)
+        return
+
+    def getThreadSafeElements(self):
+        """Return whether the elements are created concurrently"""
+        return self.ptr.getThreadSafeElements()
+
     def getFilter(self):
         cdef TMROctForest *filtr = self.ptr.getFilter()
         return _init_OctForest(filtr)
@@ -4326,7 +6164,26 @@ cdef class OctConformTopoCreator:
 def createMg(list assemblers, list forests, double omega=1.0,
              use_galerkin=False,
              use_coarse_direct_solve=True,
-             use_chebyshev_smoother=False):
+             use_chebyshev_smoother=False,
+             int coarse_solve_procs=0,
+             use_mixed_precision=False):
+    """
+    Create the multigrid object for the hierarchy of assemblers and forests.
+
+    When use_coarse_direct_solve is True and coarse_solve_procs is non-zero,
+    the coarsest level is gathered onto coarse_solve_procs processors (or one
+    processor per shared-memory node when coarse_solve_procs < 0) and factored
+    there as a dense matrix. Coarse problems with more than 4096 unknowns, and
+    all coarse problems in complex builds of TACS, use the parallel direct
+    solve instead.
+
+    When use_mixed_precision is True, the levels are smoothed with a Chebyshev
+    smoother that stores the level matrices and is applied in single precision.
+    The single precision copies are stored in addition to the double precision
+    matrices, so the matrix storage on the smoothed levels grows by about half.
+    In complex builds of TACS, the double precision Chebyshev smoother is used
+    instead.
+    """
     cdef int nlevels = 0
     cdef TACSAssembler **assm = NULL
     cdef TMRQuadForest **qforest = NULL
@@ -4336,12 +6193,15 @@ def createMg(list assemblers, list forests, double omega=1.0,
     cdef int use_galerkn = 0
     cdef int coarse_direct = 0
     cdef int use_cheb = 0
+    cdef int use_mixed = 0
     if use_galerkin:
         use_galerkn = 1
     if use_coarse_direct_solve:
         coarse_direct = 1
     if use_chebyshev_smoother:
         use_cheb = 1
+    if use_mixed_precision:
+        use_mixed = 1
 
     if len(assemblers) != len(forests):
         errstr = 'Number of Assembler and Forest objects must be equal'
@@ -4361,7 +6221,8 @@ def createMg(list assemblers, list forests, double omega=1.0,
             assm[i] = (<Assembler>assemblers[i]).ptr
             qforest[i] = (<QuadForest>forests[i]).ptr
         TMR_CreateTACSMg(nlevels, assm, qforest, &mg, omega,
-                         use_galerkn, coarse_direct, use_cheb)
+                         use_galerkn, coarse_direct, use_cheb,
+                         coarse_solve_procs, use_mixed)
         free(qforest)
     else:
         oforest = <TMROctForest**>malloc(nlevels*sizeof(TMROctForest*))
@@ -4369,13 +6230,39 @@ def createMg(list assemblers, list forests, double omega=1.0,
             assm[i] = (<Assembler>assemblers[i]).ptr
             oforest[i] = (<OctForest>forests[i]).ptr
         TMR_CreateTACSMg(nlevels, assm, oforest, &mg, omega,
-                         use_galerkn, coarse_direct, use_cheb)
+                         use_galerkn, coarse_direct, use_cheb,
+                         coarse_solve_procs, use_mixed)
         free(oforest)
     free(assm)
     if mg != NULL:
         return _init_Mg(mg)
     return None
 
+def setThreadSafeElements(int flag):
+    """
+    setThreadSafeElements(flag)
+
+    Set whether the elements may be evaluated by several threads at once
+
+    When TMR is built with OpenMP, the element loops in strainEnergyError()
+    and adjointError() call the energy and residual functions of the
+    elements. The TACS elements and the TMR constitutive objects keep
+    scratch space as members, so these loops run on a single thread unless
+    this flag is set. Only set the flag when every element and constitutive
+    object in the analysis can be evaluated concurrently.
+
+    Parameters
+    -----------
+    flag: bool
+      Whether the element evaluations may be threaded
+    """
+    TMRSetThreadSafeElements(flag)
+    return
+
+def getThreadSafeElements():
+    """Return whether the element evaluations may be threaded"""
+    return TMRGetThreadSafeElements()
+
 def strainEnergyError(forest, Assembler coarse,
                       forest_refined, Assembler refined):
     """
@@ -4509,6 +6396,88 @@ def adjointError(forest, Assembler coarse,
                                       &adj_corr)
     return err_est, adj_corr, elem_error, node_error
 
+def decreasingThresholdRefine(MPI.Comm comm, errors, double error_tol,
+                              double threshold):
+    """
+    decreasingThresholdRefine(comm, errors, error_tol, threshold)
+
+    Refine the elements with a ratio of the error to the equidistributed
+    target error, error_tol/N, above the threshold
+
+    Parameters
+    -----------
+    comm: MPI.Comm
+      The communicator for the distributed element errors
+    errors: array of double
+      The element errors on this processor
+    error_tol: double
+      The target error in the output
+    threshold: double
+      The threshold ratio for refinement
+
+    Returns
+    -------
+    refine: array of int
+      The refinement indicator for each local element
+
+    nrefine: int
+      The total number of refined elements
+    """
+    cdef MPI_Comm c_comm = comm.ob_mpi
+    cdef np.ndarray err = np.ascontiguousarray(errors, dtype=np.double)
+    cdef int nelems = err.shape[0]
+    cdef np.ndarray refine = np.zeros(nelems, dtype=np.intc)
+    cdef int nrefine = 0
+    nrefine = TMR_DecreasingThresholdRefine(c_comm, <double*>err.data,
+                                            nelems, error_tol, threshold,
+                                            <int*>refine.data)
+    return refine, nrefine
+
+def fixedGrowthRefine(MPI.Comm comm, errors, double error_tol,
+                      double refine_factor, double coarsen_factor):
+    """
+    fixedGrowthRefine(comm, errors, error_tol, refine_factor, coarsen_factor)
+
+    Refine the fraction refine_factor of the elements with the largest
+    ratios of the error to the equidistributed target error above one,
+    and coarsen the fraction coarsen_factor with the smallest ratios
+    below one
+
+    Parameters
+    -----------
+    comm: MPI.Comm
+      The communicator for the distributed element errors
+    errors: array of double
+      The element errors on this processor
+    error_tol: double
+      The target error in the output
+    refine_factor: double
+      The fraction of elements to refine
+    coarsen_factor: double
+      The fraction of elements to coarsen
+
+    Returns
+    -------
+    refine: array of int
+      The refinement indicator for each local element
+
+    refine_threshold: double
+      The smallest refined error ratio, -1 if no elements are refined
+
+    coarsen_threshold: double
+      The largest coarsened error ratio, -1 if no elements are coarsened
+    """
+    cdef MPI_Comm c_comm = comm.ob_mpi
+    cdef np.ndarray err = np.ascontiguousarray(errors, dtype=np.double)
+    cdef int nelems = err.shape[0]
+    cdef np.ndarray refine = np.zeros(nelems, dtype=np.intc)
+    cdef double refine_threshold = -1.0
+    cdef double coarsen_threshold = -1.0
+    TMR_FixedGrowthRefine(c_comm, <double*>err.data, nelems, error_tol,
+                          refine_factor, coarsen_factor, <int*>refine.data,
+                          &refine_threshold, &coarsen_threshold)
+    return refine, refine_threshold, coarsen_threshold
+
 def computeInterpSolution(forest, Assembler coarse,
                           forest_refined, Assembler refined,
                           Vec uvec=None, Vec uvec_refined=None):
@@ -4639,6 +6608,29 @@ def writeSTLToBin(fname, OctForest forest,
     TMR_GenerateBinFile(filename, forest.ptr, x.getBVecPtr(), index, cutoff)
     return
 
+def writeSTLFile(fname, OctForest forest,
+                 Vec x, int index=0, double cutoff=0.5):
+    """
+    writeSTLFile(fname, forest, x, index=0, cutoff=0.5)
+
+    Write a triangularization of the levelset of the design field x on
+    the forest, generated using the marching cubes algorithm, directly
+    to a binary STL file. This is a collective call.
+
+    Args:
+        fname (str): The file name of file
+        forest (OctForest): The octree forest
+        x (Vec): The design vector
+        index (int): Offset in the design vector (for multimaterial problems)
+        cutoff (double): Level-set cutoff value
+    """
+    cdef string sfilename = tmr_convert_str_to_chars(fname)
+    cdef const char *filename = NULL
+    if fname is not None:
+        filename = sfilename.c_str()
+    TMR_WriteSTLFile(filename, forest.ptr, x.getBVecPtr(), index, cutoff)
+    return
+
 def getSTLTriangles(OctForest forest, Vec x, int offset=0,
                     double cutoff=0.5, int root=0):
     cdef int ntris = 0
@@ -4953,15 +6945,49 @@ cdef inplace_array_1d(int nptype, int dim1, void *data_ptr):
     ndarray = np.PyArray_SimpleNewFromData(size, shape,
                                            nptype, data_ptr)
 
-    return ndarray
+    return ndarray
+
+cdef int _getinteriorstencil(void *_self, int diag, int npts,
+                             const TacsScalar *X, double *alphas ):
+    cdef int fail = 0
+    try:
+        _X = inplace_array_1d(np.NPY_DOUBLE, 3*npts, <void*>X)
+        _alphas = inplace_array_1d(np.NPY_DOUBLE, npts, <void*>alphas)
+        (<object>_self).getInteriorStencil(diag, _X, _alphas)
+    except:
+        tb = traceback.format_exc()
+        print(tb)
+        exit(0)
+
+    return fail
+
+cdef int _getboundarystencil(void *_self, int diag,
+                             const TacsScalar *n, int npts,
+                             const TacsScalar *X, double *alphas ):
+    cdef int fail = 0
+    try:
+        _n = np.array([n[0], n[1], n[2]])
+        _X = inplace_array_1d(np.NPY_DOUBLE, 3*npts, <void*>X)
+        _alphas = inplace_array_1d(np.NPY_DOUBLE, npts, <void*>alphas)
+        (<object>_self).getBoundaryStencil(diag, _n, _X, _alphas)
+    except:
+        tb = traceback.format_exc()
+        print(tb)
+        exit(0)
+
+    return fail
 
-cdef int _getinteriorstencil(void *_self, int diag, int npts,
-                             const TacsScalar *X, double *alphas ):
+cdef int _getinteriorstencils(void *_self, int num_nodes, const int *ptr,
+                              const int *diag, const TacsScalar *X,
+                              double *alphas ):
     cdef int fail = 0
     try:
-        _X = inplace_array_1d(np.NPY_DOUBLE, 3*npts, <void*>X)
-        _alphas = inplace_array_1d(np.NPY_DOUBLE, npts, <void*>alphas)
-        (<object>_self).getInteriorStencil(diag, _X, _alphas)
+        _ptr = inplace_array_1d(np.NPY_INT, num_nodes+1, <void*>ptr)
+        _diag = inplace_array_1d(np.NPY_INT, num_nodes, <void*>diag)
+        _X = inplace_array_1d(np.NPY_DOUBLE, 3*ptr[num_nodes], <void*>X)
+        _alphas = inplace_array_1d(np.NPY_DOUBLE, ptr[num_nodes],
+                                   <void*>alphas)
+        (<object>_self).getInteriorStencils(_ptr, _diag, _X, _alphas)
     except:
         tb = traceback.format_exc()
         print(tb)
@@ -4969,15 +6995,18 @@ cdef int _getinteriorstencil(void *_self, int diag, int npts,
 
     return fail
 
-cdef int _getboundarystencil(void *_self, int diag,
-                             const TacsScalar *n, int npts,
-                             const TacsScalar *X, double *alphas ):
+cdef int _getboundarystencils(void *_self, int num_nodes, const int *ptr,
+                              const int *diag, const TacsScalar *n,
+                              const TacsScalar *X, double *alphas ):
     cdef int fail = 0
     try:
-        _n = np.array([n[0], n[1], n[2]])
-        _X = inplace_array_1d(np.NPY_DOUBLE, 3*npts, <void*>X)
-        _alphas = inplace_array_1d(np.NPY_DOUBLE, npts, <void*>alphas)
-        (<object>_self).getBoundaryStencil(diag, _n, _X, _alphas)
+        _ptr = inplace_array_1d(np.NPY_INT, num_nodes+1, <void*>ptr)
+        _diag = inplace_array_1d(np.NPY_INT, num_nodes, <void*>diag)
+        _n = inplace_array_1d(np.NPY_DOUBLE, 3*num_nodes, <void*>n)
+        _X = inplace_array_1d(np.NPY_DOUBLE, 3*ptr[num_nodes], <void*>X)
+        _alphas = inplace_array_1d(np.NPY_DOUBLE, ptr[num_nodes],
+                                   <void*>alphas)
+        (<object>_self).getBoundaryStencils(_ptr, _diag, _n, _X, _alphas)
     except:
         tb = traceback.format_exc()
         print(tb)
@@ -5035,12 +7064,77 @@ cdef class HelmholtzPUFilter(TopoFilter):
         self.hptr.setGetInteriorStencil(_getinteriorstencil)
         self.hptr.setGetBoundaryStencil(_getboundarystencil)
 
+        # Compute all the stencils in one call if the bulk versions
+        # of the stencil computations are defined
+        if hasattr(self, 'getInteriorStencils'):
+            self.hptr.setGetInteriorStencils(_getinteriorstencils)
+        if hasattr(self, 'getBoundaryStencils'):
+            self.hptr.setGetBoundaryStencils(_getboundarystencils)
+
         return
 
     def initialize(self):
         self.hptr.initialize()
         return
 
+cdef class MFilter(TopoFilter):
+    cdef TMRMFilter *mptr
+    def __cinit__(self, double r, int N, list assemblers, list filters):
+        """
+        Create an M-filter: A Helmholtz partition of unity filter with
+        non-negative weights that approximates the Helmholtz PDE-based
+        filter with radius r. The stencil weights are computed in C++
+        when the filter is created.
+
+        Args:
+            r (float): Filter radius
+            N (int): Number of terms in the approximate Neumann inverse
+            assemblers (list): List of TACS.Assembler objects
+            filters (list): List of TMR.QuadForest or TMR.OctForest objects
+        """
+        cdef int nlevels = 0
+        cdef int isqforest = 0
+        cdef TACSAssembler **assemb = NULL
+        cdef TMROctForest **ofiltr = NULL
+        cdef TMRQuadForest **qfiltr = NULL
+
+        if len(assemblers) != len(filters):
+            errmsg = 'MFilter must have equal number of objects in lists'
+            raise ValueError(errmsg)
+
+        nlevels = len(assemblers)
+        for i in range(nlevels):
+            if isinstance(filters[i], QuadForest):
+                isqforest = 1
+            elif isinstance(filters[i], OctForest):
+                isqforest = 0
+
+        assemb = <TACSAssembler**>malloc(nlevels*sizeof(TACSAssembler*))
+        if isqforest:
+            qfiltr = <TMRQuadForest**>malloc(nlevels*sizeof(TMRQuadForest*))
+            for i in range(nlevels):
+                qfiltr[i] = (<QuadForest>filters[i]).ptr
+                assemb[i] = (<Assembler>assemblers[i]).ptr
+            self.mptr = new TMRMFilter(N, nlevels, assemb, qfiltr, r)
+            self.ptr = self.mptr
+            self.ptr.incref()
+            free(qfiltr)
+        else:
+            ofiltr = <TMROctForest**>malloc(nlevels*sizeof(TMROctForest*))
+            for i in range(nlevels):
+                ofiltr[i] = (<OctForest>filters[i]).ptr
+                assemb[i] = (<Assembler>assemblers[i]).ptr
+            self.mptr = new TMRMFilter(N, nlevels, assemb, ofiltr, r)
+            self.ptr = self.mptr
+            self.ptr.incref()
+            free(ofiltr)
+
+        free(assemb)
+
+        # Compute the filter weights
+        self.mptr.initialize()
+        return
+
 cdef class StiffnessProperties:
     cdef TMRStiffnessProperties *ptr
     def __cinit__(self, props, **kwargs):
@@ -5202,24 +7296,194 @@ cdef class StiffnessProperties:
                 self.ptr.use_project = 0
 
 cdef class OctConstitutive(SolidConstitutive):
-    def __cinit__(self, StiffnessProperties props=None, OctForest forest=None):
+    cdef TMROctConstitutive *tptr
+    cdef TMROctForest *forest
+    def __cinit__(self, StiffnessProperties props=None, OctForest forest=None,
+                  WeightPool pool=None):
         self.cptr = NULL
+        self.tptr = NULL
+        self.forest = NULL
         if props is not None and forest is not None:
-            self.cptr = new TMROctConstitutive(props.ptr, forest.ptr)
+            self.tptr = new TMROctConstitutive(props.ptr, forest.ptr)
+            self.cptr = self.tptr
+            self.cptr.incref()
+            self.forest = forest.ptr
+        elif props is not None and pool is not None:
+            self.tptr = new TMROctConstitutive(props.ptr, pool.ptr)
+            self.cptr = self.tptr
             self.cptr.incref()
         else:
-            errmsg = 'OctConstitutive: Must provide StiffnessProperties and OctForest'
+            errmsg = ('OctConstitutive: Must provide StiffnessProperties and '
+                      'OctForest or WeightPool')
             raise ValueError(errmsg)
         self.ptr = self.cptr
 
+    cdef check_block_forest(self):
+        if self.forest == NULL:
+            errmsg = 'OctConstitutive: Block functions require an OctForest'
+            raise ValueError(errmsg)
+
+    def getMaterialStiffness(self):
+        """
+        getMaterialStiffness(self)
+
+        Get the stiffness of each material. The upper triangle of each
+        stiffness matrix is stored row by row.
+
+        Returns:
+            np.ndarray: The (number of materials, 21) stiffness values
+        """
+        cdef int nmats = self.tptr.getStiffnessProperties().nmats
+        cdef np.ndarray C = np.zeros((nmats, 21), dtype=TACS.dtype)
+        self.tptr.getMaterialStiffness(<TacsScalar*>C.data)
+        return C
+
+    def evalShapeFunctionTable(self, pts):
+        """
+        evalShapeFunctionTable(self, pts)
+
+        Evaluate the shape functions for the design variables at a table of
+        parametric points
+
+        Args:
+            pts (np.ndarray): The (number of points, 3) parametric points
+
+        Returns:
+            np.ndarray: The (number of points, order**3) shape functions
+        """
+        self.check_block_forest()
+        cdef int order = self.forest.getMeshOrder()
+        cdef np.ndarray[double, ndim=2, mode='c'] P
+        P = np.ascontiguousarray(pts, dtype=np.double).reshape(-1, 3)
+        cdef int npts = P.shape[0]
+        cdef np.ndarray N = np.zeros((npts, order**3), dtype=np.double)
+        self.tptr.evalShapeFunctionTable(npts, <double*>P.data,
+                                         <double*>N.data)
+        return N
+
+    def packDensities(self, elems, N):
+        """
+        packDensities(self, elems, N)
+
+        Interpolate the densities at the points of a block of elements
+
+        Args:
+            elems (np.ndarray): The local element indices
+            N (np.ndarray): The table from evalShapeFunctionTable()
+
+        Returns:
+            np.ndarray: The (elements, points, materials) densities
+        """
+        self.check_block_forest()
+        cdef int nmats = self.tptr.getStiffnessProperties().nmats
+        cdef int order = self.forest.getMeshOrder()
+        cdef np.ndarray[int, ndim=1, mode='c'] e
+        cdef np.ndarray[double, ndim=2, mode='c'] Nt
+        e = np.ascontiguousarray(elems, dtype=np.intc).reshape(-1)
+        Nt = np.ascontiguousarray(N, dtype=np.double).reshape(-1, order**3)
+        cdef int nelems = e.shape[0]
+        cdef int npts = Nt.shape[0]
+        cdef np.ndarray rho = np.zeros((nelems, npts, nmats), dtype=TACS.dtype)
+        self.tptr.packDensities(nelems, <int*>e.data, npts, <double*>Nt.data,
+                                <TacsScalar*>rho.data)
+        return rho
+
+    def evalTangentStiffnessBlock(self, rho):
+        """
+        evalTangentStiffnessBlock(self, rho)
+
+        Evaluate the penalized stiffness at a block of points
+
+        Args:
+            rho (np.ndarray): The densities of each material at each point
+
+        Returns:
+            np.ndarray: The (number of points, 21) stiffness values
+        """
+        cdef int nmats = self.tptr.getStiffnessProperties().nmats
+        cdef np.ndarray r = np.ascontiguousarray(rho, dtype=TACS.dtype).reshape(-1)
+        cdef int n = r.shape[0]//nmats
+        cdef np.ndarray C = np.zeros((n, 21), dtype=TACS.dtype)
+        self.tptr.evalTangentStiffnessBlock(n, <TacsScalar*>r.data,
+                                            <TacsScalar*>C.data)
+        return C
+
+    def evalStressBlock(self, rho, strain):
+        """
+        evalStressBlock(self, rho, strain)
+
+        Evaluate the stress at a block of points
+
+        Args:
+            rho (np.ndarray): The densities of each material at each point
+            strain (np.ndarray): The (number of points, 6) strain values
+
+        Returns:
+            np.ndarray: The (number of points, 6) stress values
+        """
+        cdef int nmats = self.tptr.getStiffnessProperties().nmats
+        cdef np.ndarray r = np.ascontiguousarray(rho, dtype=TACS.dtype).reshape(-1)
+        cdef np.ndarray e = np.ascontiguousarray(strain, dtype=TACS.dtype).reshape(-1)
+        cdef int n = r.shape[0]//nmats
+        if e.shape[0] != 6*n:
+            raise ValueError('Strain array does not match %d points'%(n))
+        cdef np.ndarray s = np.zeros((n, 6), dtype=TACS.dtype)
+        self.tptr.evalStressBlock(n, <TacsScalar*>r.data, <TacsScalar*>e.data,
+                                  <TacsScalar*>s.data)
+        return s
+
+    def addStressDVSensBlock(self, N, rho, scale, strain, psi, dfdx):
+        """
+        addStressDVSensBlock(self, N, rho, scale, strain, psi, dfdx)
+
+        Add the derivative of scale*psi^{T}*stress at each point of a block
+        of elements to the design variables of each element
+
+        Args:
+            N (np.ndarray): The table from evalShapeFunctionTable()
+            rho (np.ndarray): The densities from packDensities()
+            scale (np.ndarray): The (elements, points) scale factors
+            strain (np.ndarray): The (elements, points, 6) strain values
+            psi (np.ndarray): The (elements, points, 6) adjoint values
+            dfdx (np.ndarray): The design variable derivatives of each element
+        """
+        self.check_block_forest()
+        cdef int nmats = self.tptr.getStiffnessProperties().nmats
+        cdef int order = self.forest.getMeshOrder()
+        cdef np.ndarray[double, ndim=2, mode='c'] Nt
+        Nt = np.ascontiguousarray(N, dtype=np.double).reshape(-1, order**3)
+        cdef int npts = Nt.shape[0]
+        cdef np.ndarray r = np.ascontiguousarray(rho, dtype=TACS.dtype).reshape(-1)
+        cdef np.ndarray sc = np.ascontiguousarray(scale, dtype=TACS.dtype).reshape(-1)
+        cdef np.ndarray e = np.ascontiguousarray(strain, dtype=TACS.dtype).reshape(-1)
+        cdef np.ndarray p = np.ascontiguousarray(psi, dtype=TACS.dtype).reshape(-1)
+        cdef int nelems = r.shape[0]//(nmats*npts)
+        if (sc.shape[0] != nelems*npts or e.shape[0] != 6*nelems*npts or
+            p.shape[0] != 6*nelems*npts):
+            raise ValueError('Arrays do not match %d elements'%(nelems))
+        cdef int size = nelems*self.tptr.getDesignVarsPerNode()*order**3
+        if (not isinstance(dfdx, np.ndarray) or dfdx.dtype != TACS.dtype or
+            not dfdx.flags['C_CONTIGUOUS'] or dfdx.size != size):
+            raise ValueError('dfdx must be a contiguous array of length %d'%(size))
+        cdef np.ndarray d = dfdx
+        self.tptr.addStressDVSensBlock(nelems, npts, <double*>Nt.data,
+                                       <TacsScalar*>r.data, <TacsScalar*>sc.data,
+                                       <TacsScalar*>e.data, <TacsScalar*>p.data,
+                                       <TacsScalar*>d.data)
+
 cdef class QuadConstitutive(PlaneStressConstitutive):
-    def __cinit__(self, StiffnessProperties props=None, QuadForest forest=None):
+    def __cinit__(self, StiffnessProperties props=None, QuadForest forest=None,
+                  WeightPool pool=None):
         self.cptr = NULL
         if props is not None and forest is not None:
             self.cptr = new TMRQuadConstitutive(props.ptr, forest.ptr)
             self.cptr.incref()
+        elif props is not None and pool is not None:
+            self.cptr = new TMRQuadConstitutive(props.ptr, pool.ptr)
+            self.cptr.incref()
         else:
-            errmsg = 'QuadConstitutive: Must provide StiffnessProperties and QuadForest'
+            errmsg = ('QuadConstitutive: Must provide StiffnessProperties and '
+                      'QuadForest or WeightPool')
             raise ValueError(errmsg)
         self.ptr = self.cptr
 
@@ -5242,6 +7506,80 @@ def convertPVecToVec(PVec pvec):
         raise ValueError(errmsg)
     return _init_Vec(new_vec.vec)
 
+cdef class DistanceField:
+    """
+    An approximate distance to the interface of a density field
+
+    The refined forest used to approximate the distance is kept between
+    calls to computeDistance and is only re-created when the interface
+    elements of the filter change. When the interface nodes are also
+    unchanged, the previous solution is re-used.
+
+    Args:
+        filtr (QuadForest or OctForest): The filter forest
+        index (int): The design variable component index (< 0 for all)
+        cutoff (float): Cutoff to indicate the interface
+        t (float): The length scale of the Helmholtz approximation
+    """
+    def __cinit__(self, filtr, int index=0, double cutoff=0.15,
+                  double t=1.0):
+        self.quad_ptr = NULL
+        self.oct_ptr = NULL
+        self.filtr = filtr
+        if isinstance(filtr, QuadForest):
+            self.quad_ptr = new TMRQuadDistanceField((<QuadForest>filtr).ptr,
+                                                     index, cutoff, t)
+            self.quad_ptr.incref()
+        elif isinstance(filtr, OctForest):
+            self.oct_ptr = new TMROctDistanceField((<OctForest>filtr).ptr,
+                                                   index, cutoff, t)
+            self.oct_ptr.incref()
+        else:
+            errmsg = 'DistanceField expects a QuadForest or OctForest'
+            raise ValueError(errmsg)
+
+    def __dealloc__(self):
+        if self.quad_ptr:
+            self.quad_ptr.decref()
+        if self.oct_ptr:
+            self.oct_ptr.decref()
+
+    def computeDistance(self, Vec x, filename=None):
+        """
+        computeDistance(self, x, filename=None)
+
+        Compute the minimum distance within each filter element
+
+        Args:
+            x (Vec): The design vector defined on the filter nodes
+            filename (str): Optional f5 file for the distance
+
+        Returns:
+            np.ndarray: The distance for each filter element
+        """
+        cdef int size = 0
+        cdef TMRQuadrantArray *quad_array = NULL
+        cdef TMROctantArray *oct_array = NULL
+        cdef string sfilename = tmr_convert_str_to_chars(filename)
+        cdef const char *fname = NULL
+        cdef np.ndarray dist
+
+        if filename is not None:
+            fname = sfilename.c_str()
+        if self.oct_ptr != NULL:
+            (<OctForest>self.filtr).ptr.getOctants(&oct_array)
+            oct_array.getArray(NULL, &size)
+            dist = np.zeros(size, dtype=np.double)
+            self.oct_ptr.computeDistance(x.getBVecPtr(), <double*>dist.data,
+                                         fname)
+        else:
+            (<QuadForest>self.filtr).ptr.getQuadrants(&quad_array)
+            quad_array.getArray(NULL, &size)
+            dist = np.zeros(size, dtype=np.double)
+            self.quad_ptr.computeDistance(x.getBVecPtr(), <double*>dist.data,
+                                          fname)
+        return dist
+
 def ApproximateDistance(filtr, Vec x, int index=0,
                         double cutoff=0.15, double t=1.0,
                         filename=None):
@@ -5277,6 +7615,113 @@ def ApproximateDistance(filtr, Vec x, int index=0,
         return dist
     return None
 
+def computeDensityRefinement(filtr, Vec x, int index=0, double lower=0.05,
+                             double upper=0.5, reverse=False):
+    """
+    computeDensityRefinement(filtr, x, index=0, lower=0.05, upper=0.5,
+                             reverse=False)
+
+    Compute the refinement array for a density-based criteria. Elements
+    whose design values exceed upper are refined, and elements whose
+    values are below lower are coarsened (or the reverse).
+
+    Args:
+        filtr (QuadForest or OctForest): The filter defining the design nodes
+        x (Vec): The design vector
+        index (int): The design variable component
+        lower (float): The lower limit used for coarsening
+        upper (float): The upper limit used for refinement
+        reverse (bool): Reverse the refinement scheme
+
+    Returns:
+        np.ndarray: The refinement for each element
+    """
+    cdef int size = 0
+    cdef int _reverse = 0
+    cdef TMRQuadrantArray *quad_array = NULL
+    cdef TMROctantArray *oct_array = NULL
+    cdef np.ndarray refine
+    if reverse:
+        _reverse = 1
+    if isinstance(filtr, OctForest):
+        (<OctForest>filtr).ptr.getOctants(&oct_array)
+        oct_array.getArray(NULL, &size)
+        refine = np.zeros(size, dtype=np.intc)
+        TMRDensityBasedRefine((<OctForest>filtr).ptr, x.getBVecPtr(), index,
+                              lower, upper, _reverse, <int*>refine.data)
+        return refine
+    elif isinstance(filtr, QuadForest):
+        (<QuadForest>filtr).ptr.getQuadrants(&quad_array)
+        quad_array.getArray(NULL, &size)
+        refine = np.zeros(size, dtype=np.intc)
+        TMRDensityBasedRefine((<QuadForest>filtr).ptr, x.getBVecPtr(), index,
+                              lower, upper, _reverse, <int*>refine.data)
+        return refine
+    return None
+
+def computeTargetRefinement(filtr, Vec x, dist, double refine_distance,
+                            int interface_lev=2, int interior_lev=1,
+                            int interior_index=0, reverse=False,
+                            double cutoff=0.15):
+    """
+    computeTargetRefinement(filtr, x, dist, refine_distance, interface_lev=2,
+                            interior_lev=1, interior_index=0, reverse=False,
+                            cutoff=0.15)
+
+    Compute the refinement array for a target-based criteria. Elements
+    within refine_distance of the interface are set to interface_lev,
+    interior elements are set to interior_lev and the remaining elements
+    are coarsened.
+
+    Args:
+        filtr (QuadForest or OctForest): The filter defining the design nodes
+        x (Vec): The design vector
+        dist (np.ndarray): The distance from each element to the interface
+        refine_distance (float): Refine all elements within this distance
+        interface_lev (int): Target level at the interface
+        interior_lev (int): Target level in the interior
+        interior_index (int): The design variable component for the interior
+        reverse (bool): Reverse the refinement scheme
+        cutoff (float): Cutoff to indicate the interior
+
+    Returns:
+        np.ndarray: The refinement for each element
+    """
+    cdef int size = 0
+    cdef int _reverse = 0
+    cdef TMRQuadrantArray *quad_array = NULL
+    cdef TMROctantArray *oct_array = NULL
+    cdef np.ndarray refine
+    cdef np.ndarray[double, ndim=1, mode='c'] _dist
+    if reverse:
+        _reverse = 1
+    if isinstance(filtr, OctForest):
+        (<OctForest>filtr).ptr.getOctants(&oct_array)
+        oct_array.getArray(NULL, &size)
+    elif isinstance(filtr, QuadForest):
+        (<QuadForest>filtr).ptr.getQuadrants(&quad_array)
+        quad_array.getArray(NULL, &size)
+    else:
+        return None
+
+    _dist = np.ascontiguousarray(dist, dtype=np.double).reshape(-1)
+    if _dist.shape[0] != size:
+        errmsg = 'Distance array length %d does not match the %d elements'%(
+            _dist.shape[0], size)
+        raise ValueError(errmsg)
+    refine = np.zeros(size, dtype=np.intc)
+    if oct_array != NULL:
+        TMRTargetRefine((<OctForest>filtr).ptr, x.getBVecPtr(),
+                        <double*>_dist.data, refine_distance, interface_lev,
+                        interior_lev, interior_index, _reverse, cutoff,
+                        <int*>refine.data)
+    else:
+        TMRTargetRefine((<QuadForest>filtr).ptr, x.getBVecPtr(),
+                        <double*>_dist.data, refine_distance, interface_lev,
+                        interior_lev, interior_index, _reverse, cutoff,
+                        <int*>refine.data)
+    return refine
+
 cdef void writeOutputCallback(void *func, const char *prefix, int iter,
                               TMROctForest *octforest, TMRQuadForest *quadforest,
                               TACSBVec *x):
@@ -5672,10 +8117,15 @@ cdef class TopoProblem(ProblemBase):
                                int use_jd=0, int fgmres_size=5,
                                double eig_rtol=1e-12,
                                double eig_atol=1e-30,
-                               int num_recycle=0,
+                               int num_recycle=-1,
                                JDRecycleType recycle_type=JD_NUM_RECYCLE):
         """
         Add buckling/natural frequency constraints
+
+        With the Jacobi-Davidson method (use_jd=1), num_recycle
+        converged eigenvectors from the previous design are used as
+        the starting subspace. A negative value recycles all of them
+        and zero disables recycling.
         """
         prob = _dynamicTopoProblem(self.ptr)
         if prob == NULL:
@@ -5870,6 +8320,183 @@ cdef class TopoProblem(ProblemBase):
         prob.setPrefix(prefix.c_str())
         return
 
+    def setUseBlockSolver(self, int flag=1):
+        """
+        setUseBlockSolver(self, flag=1)
+
+        Solve the linear systems for all load cases, and the adjoint
+        equations, together with a multiple right-hand-side GMRES solver
+        that shares the multigrid preconditioner. This requires storage
+        for the Krylov subspace of each system.
+
+        Args:
+            flag (int): Flag to indicate whether to use the block solver
+        """
+        cdef TMRTopoProblem *prob = NULL
+        prob = _dynamicTopoProblem(self.ptr)
+        if prob == NULL:
+            errmsg = 'Expected TMRTopoProblem got other type'
+            raise ValueError(errmsg)
+        prob.setUseBlockSolver(flag)
+        return
+
+    def setUseMultiAdjoint(self, int flag=1):
+        """
+        setUseMultiAdjoint(self, flag=1)
+
+        Compute the adjoint right-hand-sides for all the constraint
+        functions of a load case together, solve the adjoint equations
+        together and accumulate their sensitivities in a single pass
+        over the elements. This requires storage for the adjoint of
+        each constraint function.
+
+        Args:
+            flag (int): Flag to indicate whether to use the multi-adjoint path
+        """
+        cdef TMRTopoProblem *prob = NULL
+        prob = _dynamicTopoProblem(self.ptr)
+        if prob == NULL:
+            errmsg = 'Expected TMRTopoProblem got other type'
+            raise ValueError(errmsg)
+        prob.setUseMultiAdjoint(flag)
+        return
+
+    def setAsyncOutput(self, int flag=1):
+        """
+        setAsyncOutput(self, flag=1)
+
+        Complete the STL output files in the background. The files
+        written at one iteration are completed at the next call to
+        writeOutput, so the optimizer does not wait on the file
+        system. The f5 output is still written synchronously.
+
+        Args:
+            flag (int): Flag to indicate whether to use asynchronous output
+        """
+        cdef TMRTopoProblem *prob = NULL
+        prob = _dynamicTopoProblem(self.ptr)
+        if prob == NULL:
+            errmsg = 'Expected TMRTopoProblem got other type'
+            raise ValueError(errmsg)
+        prob.setAsyncOutput(flag)
+        return
+
+    def setProfileOutput(self, int flag=1):
+        """
+        setProfileOutput(self, flag=1)
+
+        Append the time spent in each phase of the optimization to the
+        file profile.dat in the prefix directory each time the output
+        is written.
+
+        Args:
+            flag (int): Flag to indicate whether to write the profile
+        """
+        cdef TMRTopoProblem *prob = NULL
+        prob = _dynamicTopoProblem(self.ptr)
+        if prob == NULL:
+            errmsg = 'Expected TMRTopoProblem got other type'
+            raise ValueError(errmsg)
+        prob.setProfileOutput(flag)
+        return
+
+    def getProfile(self):
+        """
+        getProfile(self)
+
+        Get the number of calls, the number of Krylov iterations and the
+        minimum, maximum and average time over all processors for each
+        phase of the optimization. This is a collective call.
+
+        Returns:
+            dict: The (calls, krylov_iters, tmin, tmax, tavg) tuple for each phase
+        """
+        cdef TMRTopoProblem *prob = NULL
+        cdef int count = 0
+        cdef int iters = 0
+        cdef double tmin = 0.0
+        cdef double tmax = 0.0
+        cdef double tavg = 0.0
+        prob = _dynamicTopoProblem(self.ptr)
+        if prob == NULL:
+            errmsg = 'Expected TMRTopoProblem got other type'
+            raise ValueError(errmsg)
+        profile = {}
+        for k in range(TMR_PROFILE_NUM_PHASES):
+            prob.getProfilePhase(k, &count, &iters, &tmin, &tmax, &tavg)
+            name = tmr_convert_char_to_str(prob.getProfilePhaseName(k))
+            profile[name] = (count, iters, tmin, tmax, tavg)
+        return profile
+
+    def printProfile(self):
+        """
+        printProfile(self)
+
+        Print the time spent in each phase of the optimization on the
+        root processor. This is a collective call.
+        """
+        cdef TMRTopoProblem *prob = NULL
+        prob = _dynamicTopoProblem(self.ptr)
+        if prob == NULL:
+            errmsg = 'Expected TMRTopoProblem got other type'
+            raise ValueError(errmsg)
+        prob.printProfile(stdout)
+        return
+
+    def resetProfile(self):
+        """
+        resetProfile(self)
+
+        Reset the time, calls and Krylov iterations for all phases
+        """
+        cdef TMRTopoProblem *prob = NULL
+        prob = _dynamicTopoProblem(self.ptr)
+        if prob == NULL:
+            errmsg = 'Expected TMRTopoProblem got other type'
+            raise ValueError(errmsg)
+        prob.resetProfile()
+        return
+
+    def setReuseSolutions(self, int flag=1):
+        """
+        setReuseSolutions(self, flag=1)
+
+        Use the solutions and adjoints from the previous evaluation as
+        initial guesses, and reuse the forward factorization for the
+        adjoint equations when the Jacobian is symmetric.
+
+        Args:
+            flag (int): Flag to indicate whether to reuse the solutions
+        """
+        cdef TMRTopoProblem *prob = NULL
+        prob = _dynamicTopoProblem(self.ptr)
+        if prob == NULL:
+            errmsg = 'Expected TMRTopoProblem got other type'
+            raise ValueError(errmsg)
+        prob.setReuseSolutions(flag)
+        return
+
+    def setLaggedPreconditioner(self, int freq, double iter_ratio=2.0):
+        """
+        setLaggedPreconditioner(self, freq, iter_ratio=2.0)
+
+        Factor the multigrid hierarchy at most every freq evaluations,
+        or when the number of Krylov iterations grows by more than
+        iter_ratio since the last factorization.
+
+        Args:
+            freq (int): Maximum number of evaluations between factorizations
+            iter_ratio (float): Growth in the iteration count that triggers
+                a factorization
+        """
+        cdef TMRTopoProblem *prob = NULL
+        prob = _dynamicTopoProblem(self.ptr)
+        if prob == NULL:
+            errmsg = 'Expected TMRTopoProblem got other type'
+            raise ValueError(errmsg)
+        prob.setLaggedPreconditioner(freq, iter_ratio)
+        return
+
     def setIterationCounter(self, int count):
         """
         setIterationCounter(self, count)
@@ -24,6 +24,23 @@
 #include "TMR_TACSCreator.h"
 #include "TMR_TACSTopoCreator.h"
 
+/*
+  Check that all the elements were created by a batched callback
+*/
+inline void TMR_CyCheckElements(const char *name, int num_elements,
+                                TACSElement **elements) {
+  int count = 0;
+  for (int i = 0; i < num_elements; i++) {
+    if (!elements[i]) {
+      count++;
+    }
+  }
+  if (count > 0) {
+    fprintf(stderr, "%s error: %d of %d elements not created\n", name, count,
+            num_elements);
+  }
+}
+
 /*
   This is a light-weight wrapper for creating elements in python
 */
@@ -31,13 +48,23 @@ class TMRCyQuadCreator : public TMRQuadTACSCreator {
  public:
   TMRCyQuadCreator(TMRBoundaryConditions *_bcs, int _design_vars_per_node = 1,
                    TMRQuadForest *_filter = NULL)
-      : TMRQuadTACSCreator(_bcs, _design_vars_per_node, _filter) {}
+      : TMRQuadTACSCreator(_bcs, _design_vars_per_node, _filter) {
+    self = NULL;
+    createquadelement = NULL;
+    createquadelements = NULL;
+  }
 
   void setSelfPointer(void *_self) { self = _self; }
   void setCreateQuadElement(TACSElement *(*func)(void *, int, TMRQuadrant *)) {
     createquadelement = func;
   }
 
+  // Set the callback that creates all of the elements in a single call
+  void setCreateQuadElements(int (*func)(void *, int, int, TMRQuadrant *,
+                                         TACSElement **)) {
+    createquadelements = func;
+  }
+
   void createElements(int order, TMRQuadForest *forest, int num_elements,
                       TACSElement **elements) {
     // Get the array of quadrants
@@ -49,6 +76,12 @@ class TMRCyQuadCreator : public TMRQuadTACSCreator {
 
     // Set the element types into the matrix
     memset(elements, 0, num_elements * sizeof(TACSElement *));
+    if (createquadelements) {
+      createquadelements(self, order, num_elements, array, elements);
+      TMR_CyCheckElements("TMRCyQuadCreator", num_elements, elements);
+      return;
+    }
+
     for (int i = 0; i < num_elements; i++) {
       TACSElement *elem = createquadelement(self, order, &array[i]);
       if (!elem) {
@@ -62,6 +95,7 @@ class TMRCyQuadCreator : public TMRQuadTACSCreator {
  private:
   void *self;
   TACSElement *(*createquadelement)(void *, int, TMRQuadrant *);
+  int (*createquadelements)(void *, int, int, TMRQuadrant *, TACSElement **);
 };
 
 /*
@@ -71,13 +105,23 @@ class TMRCyOctCreator : public TMROctTACSCreator {
  public:
   TMRCyOctCreator(TMRBoundaryConditions *_bcs, int _design_vars_per_node = 1,
                   TMROctForest *_filter = NULL)
-      : TMROctTACSCreator(_bcs, _design_vars_per_node, _filter) {}
+      : TMROctTACSCreator(_bcs, _design_vars_per_node, _filter) {
+    self = NULL;
+    createoctelement = NULL;
+    createoctelements = NULL;
+  }
 
   void setSelfPointer(void *_self) { self = _self; }
   void setCreateOctElement(TACSElement *(*func)(void *, int, TMROctant *)) {
     createoctelement = func;
   }
 
+  // Set the callback that creates all of the elements in a single call
+  void setCreateOctElements(int (*func)(void *, int, int, TMROctant *,
+                                        TACSElement **)) {
+    createoctelements = func;
+  }
+
   void createElements(int order, TMROctForest *forest, int num_elements,
                       TACSElement **elements) {
     // Get the array of octants
@@ -89,6 +133,12 @@ class TMRCyOctCreator : public TMROctTACSCreator {
 
     // Set the element types into the matrix
     memset(elements, 0, num_elements * sizeof(TACSElement *));
+    if (createoctelements) {
+      createoctelements(self, order, num_elements, array, elements);
+      TMR_CyCheckElements("TMRCyOctCreator", num_elements, elements);
+      return;
+    }
+
     for (int i = 0; i < num_elements; i++) {
       TACSElement *elem = createoctelement(self, order, &array[i]);
       if (!elem) {
@@ -102,6 +152,7 @@ class TMRCyOctCreator : public TMROctTACSCreator {
  private:
   void *self;
   TACSElement *(*createoctelement)(void *, int, TMROctant *);
+  int (*createoctelements)(void *, int, int, TMROctant *, TACSElement **);
 };
 
 /*
@@ -111,7 +162,11 @@ class TMRCyTopoQuadCreator : public TMRQuadTACSTopoCreator {
  public:
   TMRCyTopoQuadCreator(TMRBoundaryConditions *_bcs, int _design_vars_per_node,
                        TMRQuadForest *_filter)
-      : TMRQuadTACSTopoCreator(_bcs, _design_vars_per_node, _filter) {}
+      : TMRQuadTACSTopoCreator(_bcs, _design_vars_per_node, _filter) {
+    self = NULL;
+    createquadtopoelement = NULL;
+    createquadtopoelements = NULL;
+  }
 
   void setSelfPointer(void *_self) { self = _self; }
   void setCreateQuadTopoElement(TACSElement *(*func)(void *, int, TMRQuadrant *,
@@ -119,6 +174,24 @@ class TMRCyTopoQuadCreator : public TMRQuadTACSTopoCreator {
     createquadtopoelement = func;
   }
 
+  // Set the callback that creates all of the elements from the pool
+  void setCreateQuadTopoElements(int (*func)(void *, int, int, TMRQuadrant *,
+                                             TMRWeightPool *, TACSElement **)) {
+    createquadtopoelements = func;
+  }
+
+  // Create all of the elements in a single call if the callback is set
+  int createPooledElements(int order, int num_elements, TMRQuadrant *quads,
+                           TMRWeightPool *pool, TACSElement **elements) {
+    if (!createquadtopoelements) {
+      return 0;
+    }
+    memset(elements, 0, num_elements * sizeof(TACSElement *));
+    createquadtopoelements(self, order, num_elements, quads, pool, elements);
+    TMR_CyCheckElements("TMRCyTopoQuadCreator", num_elements, elements);
+    return 1;
+  }
+
   // Create the element
   TACSElement *createElement(int order, TMRQuadrant *quad, int nweights,
                              TMRIndexWeight *weights) {
@@ -131,6 +204,8 @@ class TMRCyTopoQuadCreator : public TMRQuadTACSTopoCreator {
   void *self;  // Pointer to the python-level object
   TACSElement *(*createquadtopoelement)(void *, int, TMRQuadrant *,
                                         int nweights, TMRIndexWeight *weights);
+  int (*createquadtopoelements)(void *, int, int, TMRQuadrant *,
+                                TMRWeightPool *, TACSElement **);
 };
 
 /*
@@ -140,7 +215,11 @@ class TMRCyTopoOctCreator : public TMROctTACSTopoCreator {
  public:
   TMRCyTopoOctCreator(TMRBoundaryConditions *_bcs, int _design_vars_per_node,
                       TMROctForest *_filter)
-      : TMROctTACSTopoCreator(_bcs, _design_vars_per_node, _filter) {}
+      : TMROctTACSTopoCreator(_bcs, _design_vars_per_node, _filter) {
+    self = NULL;
+    createocttopoelement = NULL;
+    createocttopoelements = NULL;
+  }
 
   void setSelfPointer(void *_self) { self = _self; }
   void setCreateOctTopoElement(TACSElement *(*func)(void *, int, TMROctant *,
@@ -148,6 +227,24 @@ class TMRCyTopoOctCreator : public TMROctTACSTopoCreator {
     createocttopoelement = func;
   }
 
+  // Set the callback that creates all of the elements from the pool
+  void setCreateOctTopoElements(int (*func)(void *, int, int, TMROctant *,
+                                            TMRWeightPool *, TACSElement **)) {
+    createocttopoelements = func;
+  }
+
+  // Create all of the elements in a single call if the callback is set
+  int createPooledElements(int order, int num_elements, TMROctant *octs,
+                           TMRWeightPool *pool, TACSElement **elements) {
+    if (!createocttopoelements) {
+      return 0;
+    }
+    memset(elements, 0, num_elements * sizeof(TACSElement *));
+    createocttopoelements(self, order, num_elements, octs, pool, elements);
+    TMR_CyCheckElements("TMRCyTopoOctCreator", num_elements, elements);
+    return 1;
+  }
+
   // Create the element
   TACSElement *createElement(int order, TMROctant *oct, int nweights,
                              TMRIndexWeight *weights) {
@@ -160,6 +257,8 @@ class TMRCyTopoOctCreator : public TMROctTACSTopoCreator {
   void *self;  // Pointer to the python-level object
   TACSElement *(*createocttopoelement)(void *, int, TMROctant *, int nweights,
                                        TMRIndexWeight *weights);
+  int (*createocttopoelements)(void *, int, int, TMROctant *, TMRWeightPool *,
+                               TACSElement **);
 };
 
 /*
@@ -172,7 +271,11 @@ class TMRCyTopoQuadConformCreator : public TMRQuadConformTACSTopoCreator {
       TMRQuadForest *_forest, int order = -1,
       TMRInterpolationType interp_type = TMR_UNIFORM_POINTS)
       : TMRQuadConformTACSTopoCreator(_bcs, _design_vars_per_node, _forest,
-                                      order, interp_type) {}
+                                      order, interp_type) {
+    self = NULL;
+    createquadtopoelement = NULL;
+    createquadtopoelements = NULL;
+  }
 
   void setSelfPointer(void *_self) { self = _self; }
   void setCreateQuadTopoElement(TACSElement *(*func)(void *, int, TMRQuadrant *,
@@ -181,6 +284,41 @@ class TMRCyTopoQuadConformCreator : public TMRQuadConformTACSTopoCreator {
     createquadtopoelement = func;
   }
 
+  // Set the callback that creates all of the elements in a single call
+  void setCreateQuadTopoElements(int (*func)(void *, int, int, TMRQuadrant *,
+                                             int, const int *, TMRQuadForest *,
+                                             TACSElement **)) {
+    createquadtopoelements = func;
+  }
+
+  // Create the elements, using the batched callback if it is set
+  void createElements(int order, TMRQuadForest *forest, int num_elements,
+                      TACSElement **elements) {
+    if (!createquadtopoelements) {
+      TMRQuadConformTACSTopoCreator::createElements(order, forest, num_elements,
+                                                    elements);
+      return;
+    }
+
+    // Get the array of elements from the forest
+    int size;
+    TMRQuadrant *array;
+    TMRQuadrantArray *quadrants;
+    forest->getQuadrants(&quadrants);
+    quadrants->getArray(&array, &size);
+
+    // Get the connectivity of the filter
+    const int filter_order = filter->getMeshOrder();
+    const int nweights = filter_order * filter_order;
+    const int *conn;
+    filter->getNodeConn(&conn);
+
+    memset(elements, 0, num_elements * sizeof(TACSElement *));
+    createquadtopoelements(self, order, num_elements, array, nweights, conn,
+                           filter, elements);
+    TMR_CyCheckElements("TMRCyTopoQuadConformCreator", num_elements, elements);
+  }
+
   // Create the element
   TACSElement *createElement(int order, TMRQuadrant *quad, int nweights,
                              const int *index, TMRQuadForest *fltr) {
@@ -194,6 +332,8 @@ class TMRCyTopoQuadConformCreator : public TMRQuadConformTACSTopoCreator {
   TACSElement *(*createquadtopoelement)(void *, int, TMRQuadrant *,
                                         int nweights, const int *index,
                                         TMRQuadForest *);
+  int (*createquadtopoelements)(void *, int, int, TMRQuadrant *, int,
+                                const int *, TMRQuadForest *, TACSElement **);
 };
 
 /*
@@ -206,7 +346,11 @@ class TMRCyTopoOctConformCreator : public TMROctConformTACSTopoCreator {
       TMROctForest *_forest, int order = -1,
       TMRInterpolationType interp_type = TMR_UNIFORM_POINTS)
       : TMROctConformTACSTopoCreator(_bcs, _design_vars_per_node, _forest,
-                                     order, interp_type) {}
+                                     order, interp_type) {
+    self = NULL;
+    createocttopoelement = NULL;
+    createocttopoelements = NULL;
+  }
 
   void setSelfPointer(void *_self) { self = _self; }
   void setCreateOctTopoElement(TACSElement *(*func)(void *, int, TMROctant *,
@@ -215,6 +359,41 @@ class TMRCyTopoOctConformCreator : public TMROctConformTACSTopoCreator {
     createocttopoelement = func;
   }
 
+  // Set the callback that creates all of the elements in a single call
+  void setCreateOctTopoElements(int (*func)(void *, int, int, TMROctant *, int,
+                                            const int *, TMROctForest *,
+                                            TACSElement **)) {
+    createocttopoelements = func;
+  }
+
+  // Create the elements, using the batched callback if it is set
+  void createElements(int order, TMROctForest *forest, int num_elements,
+                      TACSElement **elements) {
+    if (!createocttopoelements) {
+      TMROctConformTACSTopoCreator::createElements(order, forest, num_elements,
+                                                   elements);
+      return;
+    }
+
+    // Get the array of elements from the forest
+    int size;
+    TMROctant *array;
+    TMROctantArray *octants;
+    forest->getOctants(&octants);
+    octants->getArray(&array, &size);
+
+    // Get the connectivity of the filter
+    const int filter_order = filter->getMeshOrder();
+    const int nweights = filter_order * filter_order * filter_order;
+    const int *conn;
+    filter->getNodeConn(&conn);
+
+    memset(elements, 0, num_elements * sizeof(TACSElement *));
+    createocttopoelements(self, order, num_elements, array, nweights, conn,
+                          filter, elements);
+    TMR_CyCheckElements("TMRCyTopoOctConformCreator", num_elements, elements);
+  }
+
   // Create the element
   TACSElement *createElement(int order, TMROctant *oct, int nweights,
                              const int *index, TMROctForest *fltr) {
@@ -227,6 +406,8 @@ class TMRCyTopoOctConformCreator : public TMROctConformTACSTopoCreator {
   void *self;  // Pointer to the python-level object
   TACSElement *(*createocttopoelement)(void *, int, TMROctant *, int nweights,
                                        const int *index, TMROctForest *);
+  int (*createocttopoelements)(void *, int, int, TMROctant *, int, const int *,
+                               TMROctForest *, TACSElement **);
 };
 
 #endif  // TMR_CY_CREATOR_H
@@ -24,6 +24,7 @@ def createTopoProblem(
     ordering=TACS.MULTICOLOR_ORDER,
     use_galerkin=False,
     scale_coordinate_factor=1.0,
+    use_mixed_precision=False,
 ):
     """
     Create a topology optimization problem instance and a hierarchy of meshes.
@@ -49,12 +50,13 @@ def createTopoProblem(
         forest (TMROctForest or TMRQuadForest): Forest type
         repartition (bool): Repartition the mesh
         design_vars_per_node (int): number of design variables for each node
-        r0 (float): Helmholtz/matrix filter radius
+        r0 (float): Helmholtz/matrix/M-filter radius
         N (int): Matrix filter approximation parameter
         lowest_order (int): Lowest order mesh to create
         ordering: TACS Assembler ordering type
         use_galerkin: Use Galerkin projection to obtain coarse grid operators
         scale_coordinate_factor (float): Scale all coordinates by this factor
+        use_mixed_precision (bool): Smooth the multigrid levels in single precision
 
     Returns:
         problem (TopoProblem): The allocated topology optimization problem
@@ -107,7 +109,12 @@ def createTopoProblem(
             assembler.setNodes(X)
 
     # Create the multigrid object
-    mg = TMR.createMg(assemblers, forests, use_galerkin=use_galerkin)
+    mg = TMR.createMg(
+        assemblers,
+        forests,
+        use_galerkin=use_galerkin,
+        use_mixed_precision=use_mixed_precision,
+    )
 
     # Create the TMRTopoFilter object
     filter_obj = None
@@ -122,6 +129,8 @@ def createTopoProblem(
             filter_obj = TMR.ConformFilter(assemblers, filters)
         elif filter_type == "helmholtz":
             filter_obj = TMR.HelmholtzFilter(r0, assemblers, filters)
+        elif filter_type == "mfilter":
+            filter_obj = TMR.MFilter(r0, N, assemblers, filters)
 
     problem = TMR.TopoProblem(filter_obj, mg)
 
@@ -292,17 +301,9 @@ def interpolateDesignVec(orig_filter, orig_vec, new_filter, new_vec):
     if orig_x.getVarsPerNode() != new_x.getVarsPerNode():
         raise ValueError("Number of variables per node must be consistent")
 
-    orig_map = orig_x.getNodeMap()
-    new_map = new_x.getNodeMap()
-    vars_per_node = orig_x.getVarsPerNode()
-
-    # Create the interpolation class
-    interp = TACS.VecInterp(orig_map, new_map, vars_per_node)
-    new_filter.createInterpolation(orig_filter, interp)
-    interp.initialize()
-
-    # Perform the interpolation
-    interp.mult(orig_x, new_x)
+    # Evaluate the design variables on the new forest directly from
+    # the elements of the original forest
+    new_filter.transferNodalField(orig_filter, orig_x, new_x)
 
     return
 
@@ -403,6 +404,7 @@ def densityBasedRefine(
     reverse=False,
     min_lev=0,
     max_lev=TMR.MAX_LEVEL,
+    fltr=None,
 ):
     """
     Apply a density-based refinement criteria.
@@ -423,8 +425,20 @@ def densityBasedRefine(
         reverse (bool): Reverse the refinement scheme
         min_lev (int): Minimum refinement level
         max_lev (int): Maximum refinement level
+        fltr (QuadForest or OctForest): Optional filter defining the design nodes,
+            used to evaluate the criteria in C++ from the design vector
     """
 
+    # Compute the refinement directly from the design vector
+    if fltr is not None:
+        x = assembler.createDesignVec()
+        assembler.getDesignVars(x)
+        refine = TMR.computeDensityRefinement(
+            fltr, x, index=index, lower=lower, upper=upper, reverse=reverse
+        )
+        forest.refine(refine, min_lev=min_lev, max_lev=max_lev)
+        return
+
     # Create refinement array
     num_elems = assembler.getNumElements()
     refine = np.zeros(num_elems, dtype=np.int32)
@@ -469,6 +483,7 @@ def approxDistanceRefine(
     filename=None,
     min_lev=0,
     max_lev=TMR.MAX_LEVEL,
+    dist_field=None,
 ):
     """
     Apply a distance-based refinement criteria.
@@ -498,6 +513,7 @@ def approxDistanceRefine(
         cutoff (float): Cutoff to indicate structural interface
         min_lev (int): Minimum refinement level
         max_lev (int): Maximum refinement level
+        dist_field (DistanceField): Re-usable distance field for fltr (optional)
     """
 
     # Set up and solve for an approximate level set function
@@ -505,25 +521,24 @@ def approxDistanceRefine(
     assembler.getDesignVars(x)
 
     # Approximate the distance to the boundary
-    dist = TMR.ApproximateDistance(
-        fltr,
-        x,
-        index=index,
-        cutoff=cutoff,
-        t=tfactor * domain_length,
-        filename=filename,
-    )
+    if dist_field is not None:
+        dist = dist_field.computeDistance(x, filename=filename)
+    else:
+        dist = TMR.ApproximateDistance(
+            fltr,
+            x,
+            index=index,
+            cutoff=cutoff,
+            t=tfactor * domain_length,
+            filename=filename,
+        )
 
     # Create refinement array
     num_elems = assembler.getNumElements()
     refine = np.zeros(num_elems, dtype=np.int32)
 
-    for i in range(num_elems):
-        # Apply the refinement criteria
-        if dist[i] <= refine_distance:
-            refine[i] = 1
-        else:
-            refine[i] = -1
+    # Apply the refinement criteria
+    refine[:] = np.where(np.asarray(dist)[:num_elems] <= refine_distance, 1, -1)
 
     # Refine the forest
     forest.refine(refine, min_lev=min_lev, max_lev=max_lev)
@@ -547,6 +562,7 @@ def targetRefine(
     filename=None,
     min_lev=0,
     max_lev=TMR.MAX_LEVEL,
+    dist_field=None,
 ):
     """
     Apply a target-based refinement strategy.
@@ -576,6 +592,7 @@ def targetRefine(
         filename (str): File name for the approximate distance calculation
         min_lev (int): Minimum refinement level
         max_lev (int): Maximum refinement level
+        dist_field (DistanceField): Re-usable distance field for fltr (optional)
     """
 
     # Set up and solve for an approximate level set function
@@ -583,58 +600,31 @@ def targetRefine(
     assembler.getDesignVars(x)
 
     # Approximate the distance to the boundary
-    dist = TMR.ApproximateDistance(
+    if dist_field is not None:
+        dist = dist_field.computeDistance(x, filename=filename)
+    else:
+        dist = TMR.ApproximateDistance(
+            fltr,
+            x,
+            index=interface_index,
+            cutoff=cutoff,
+            t=tfactor * domain_length,
+            filename=filename,
+        )
+
+    # Compute the refinement from the distance and the interior values
+    refine = TMR.computeTargetRefinement(
         fltr,
         x,
-        index=interface_index,
+        dist,
+        refine_distance,
+        interface_lev=interface_lev,
+        interior_lev=interior_lev,
+        interior_index=interior_index,
+        reverse=reverse,
         cutoff=cutoff,
-        t=tfactor * domain_length,
-        filename=filename,
     )
 
-    # Create refinement array
-    num_elems = assembler.getNumElements()
-    refine = np.zeros(num_elems, dtype=np.int32)
-
-    # Compute the levels
-    if isinstance(forest, TMR.OctForest):
-        octants = forest.getOctants()
-        lev = np.zeros(len(octants))
-        for i, oc in enumerate(octants):
-            lev[i] = oc.level
-    elif isinstance(forest, TMR.QuadForest):
-        quads = forest.getQuadrants()
-        lev = np.zeros(len(quads))
-        for i, quad in enumerate(quads):
-            lev[i] = quad.level
-
-    # Get the elements from the Assembler object
-    elems = assembler.getElements()
-
-    for i in range(num_elems):
-        # Apply the refinement criteria
-        if dist[i] <= refine_distance:
-            refine[i] = interface_lev - lev[i]
-        else:
-            # Now check whether this is in the interior or exterior of
-            # the domain
-            dvs_per_node = elems[i].getDesignVarsPerNode()
-            dvs = elems[i].getDesignVars(i)
-
-            # Apply the refinement criteria
-            if reverse:
-                value = np.min(dvs[interior_index::dvs_per_node])
-                if value >= 1.0 - cutoff:
-                    refine[i] = -1
-                elif value <= cutoff:
-                    refine[i] = interior_lev - lev[i]
-            else:
-                value = np.max(dvs[interior_index::dvs_per_node])
-                if value >= 1.0 - cutoff:
-                    refine[i] = interior_lev - lev[i]
-                elif value <= cutoff:
-                    refine[i] = -1
-
     # Refine the forest
     forest.refine(refine, min_lev=min_lev, max_lev=max_lev)
 
@@ -797,7 +787,9 @@ class Mfilter(TMR.HelmholtzPUFilter):
             dim (int): Spatial dimension of the problem
             r (float): Filter radius
 
-        Note: You must call initialize() on the filter before use.
+        Note: You must call initialize() on the filter before use. The
+        TMR.MFilter class computes the same weights in C++ and is
+        considerably faster.
         """
         self.r = r
         self.dim = dim
@@ -889,6 +881,31 @@ class Mfilter(TMR.HelmholtzPUFilter):
 
         return
 
+    def getInteriorStencils(self, ptr, diag, X, alpha):
+        """
+        Get the weights for all interior stencil points in one call. The
+        points for node k are X[3*ptr[k]:3*ptr[k+1]] and the weights are
+        stored in alpha[ptr[k]:ptr[k+1]].
+        """
+        for k in range(len(diag)):
+            self.getInteriorStencil(
+                diag[k], X[3 * ptr[k] : 3 * ptr[k + 1]], alpha[ptr[k] : ptr[k + 1]]
+            )
+
+        return
+
+    def getBoundaryStencils(self, ptr, diag, normals, X, alpha):
+        """Get the weights for all the stencil points on the domain boundary"""
+        for k in range(len(diag)):
+            self.getBoundaryStencil(
+                diag[k],
+                normals[3 * k : 3 * (k + 1)],
+                X[3 * ptr[k] : 3 * ptr[k + 1]],
+                alpha[ptr[k] : ptr[k + 1]],
+            )
+
+        return
+
 
 def setSurfaceBounds(
     problem, comm, forest, names, face_lb=0.99, face_ub=1.0, constrain_octs=True
@@ -197,10 +197,18 @@ class pyApproximationSpace(BaseUI):
         num_max_levels : int
             Maximum number of levels the forest is allowed to refine the elements
         """
-        self.forest.refine(
-            refine_indicator, min_lev=num_min_levels, max_lev=num_max_levels
-        )
-        self.forest.balance(1)
+        if isinstance(self.forest, TMR.OctForest):
+            self.forest.refineAndBalance(
+                refine_indicator,
+                min_lev=num_min_levels,
+                max_lev=num_max_levels,
+                btype=1,
+            )
+        else:
+            self.forest.refine(
+                refine_indicator, min_lev=num_min_levels, max_lev=num_max_levels
+            )
+            self.forest.balance(1)
         self.forest.repartition()
         self.forest.createNodes()
         self.refine_iter += 1
@@ -745,36 +753,25 @@ class pyTACSAdapt(BaseUI):
         element_errors : np.ndarray (1D, float) [num_elements]
             The error in the output associated with each element in the mesh
         """
-        # get the total number of elements
-        nelems = len(element_errors)
-        elem_counts = self.comm.allgather(nelems)
-        nelems_tot = sum(elem_counts)
-
         # choose elements based on an equidistributed target error
-        target_error = self.error_tol / nelems_tot
-        error_ratio = element_errors / target_error
         refine_threshold = max(
             1.0, 2.0 ** (self.num_decrease_iters - self.coarse.refine_iter)
         )
+        adapt_indicator, nref = TMR.decreasingThresholdRefine(
+            self.comm, element_errors, self.error_tol, refine_threshold
+        )
 
         # record the refinement threshold:error_ratio pair for this iteration
-        error_ratio_tot = np.zeros(nelems_tot)
-        self.comm.Allgatherv(error_ratio, [error_ratio_tot, elem_counts])
         self.adaptation_history["threshold"][
             f"refine_{self.coarse.refine_iter}"
         ] = refine_threshold
         self.adaptation_history["element_errors"][
             f"adapt_iter_{self.coarse.refine_iter}"
-        ] = error_ratio_tot
-
-        # get the refinement indicator array
-        adapt_indicator = np.array(error_ratio >= refine_threshold, dtype=int)
-        nref = np.count_nonzero(adapt_indicator)
-        nref = self.comm.allreduce(nref, op=MPI.SUM)
+        ] = self._gatherErrorRatios(element_errors)
 
         # adapt the coarse-space model
         self.coarse.applyRefinement(
-            adapt_indicator.astype(np.intc),
+            adapt_indicator,
             num_min_levels=self.num_min_ref_levels,
             num_max_levels=self.num_max_ref_levels,
         )
@@ -790,69 +787,35 @@ class pyTACSAdapt(BaseUI):
         element_errors : np.ndarray (1D, float) [num_elements]
             The error in the output associated with each element in the mesh
         """
-        # get the elem counts
-        nelems = len(element_errors)
-        elem_counts = self.comm.allgather(nelems)
-        nelems_tot = sum(elem_counts)
-        nrefine = int(self.growth_refine_factor * nelems_tot)
-        ncoarse = int(self.growth_coarsen_factor * nelems_tot)
-
-        # gather all the element errors on each proc
-        element_errors_tot = np.empty(nelems_tot)
-        self.comm.Allgatherv(element_errors, [element_errors_tot, elem_counts])
-
-        # compute the error ratio for all elements
-        target_error = self.error_tol / nelems_tot
-        error_ratio_tot = element_errors_tot / target_error
-
-        # sort all the element error ratios in descending order
-        sorted_inds = np.flip(np.argsort(error_ratio_tot))
-
-        # create the adaptation indicator array
-        adapt_indicator_tot = np.zeros(nelems_tot, dtype=int)
-        refine_inds = None
-        coarse_inds = None
-        if nrefine > 0:
-            refine_inds = sorted_inds[:nrefine]
-            adapt_indicator_tot[refine_inds] = np.where(
-                error_ratio_tot[refine_inds] >= 1.0, 1, adapt_indicator_tot[refine_inds]
-            )
-        if ncoarse > 0:
-            coarse_inds = sorted_inds[-ncoarse:]
-            adapt_indicator_tot[coarse_inds] = np.where(
-                error_ratio_tot[coarse_inds] < 1.0, -1, adapt_indicator_tot[coarse_inds]
-            )
+        # select the elements with the largest/smallest error ratios
+        (
+            adapt_indicator,
+            refine_threshold,
+            coarsen_threshold,
+        ) = TMR.fixedGrowthRefine(
+            self.comm,
+            element_errors,
+            self.error_tol,
+            self.growth_refine_factor,
+            self.growth_coarsen_factor,
+        )
 
         # update the adaptation history
-        if refine_inds is not None:
-            ind = 0
-            while error_ratio_tot[refine_inds[ind]] >= 1.0:
-                self.adaptation_history["threshold"][
-                    f"refine_{self.coarse.refine_iter}"
-                ] = error_ratio_tot[refine_inds[ind]]
-                ind += 1
-                if ind >= nrefine:
-                    break
-        if coarse_inds is not None:
-            ind = ncoarse - 1
-            while error_ratio_tot[coarse_inds[ind]] < 1.0:
-                self.adaptation_history["threshold"][
-                    f"coarsen_{self.coarse.refine_iter}"
-                ] = error_ratio_tot[coarse_inds[ind]]
-                ind -= 1
-                if ind <= 0:
-                    break
+        if refine_threshold >= 0.0:
+            self.adaptation_history["threshold"][
+                f"refine_{self.coarse.refine_iter}"
+            ] = refine_threshold
+        if coarsen_threshold >= 0.0:
+            self.adaptation_history["threshold"][
+                f"coarsen_{self.coarse.refine_iter}"
+            ] = coarsen_threshold
         self.adaptation_history["element_errors"][
             f"adapt_iter_{self.coarse.refine_iter}"
-        ] = error_ratio_tot
-
-        # scatter the adaptation indicator to each proc
-        adapt_indicator = np.empty(nelems, dtype=int)
-        self.comm.Scatterv([adapt_indicator_tot, elem_counts], adapt_indicator, root=0)
+        ] = self._gatherErrorRatios(element_errors)
 
         # adapt the coarse-space model
         self.coarse.applyRefinement(
-            adapt_indicator.astype(np.intc),
+            adapt_indicator,
             num_min_levels=self.num_min_ref_levels,
             num_max_levels=self.num_max_ref_levels,
         )
@@ -953,6 +916,21 @@ class pyTACSAdapt(BaseUI):
                         ] = self.growth_coarsen_factor
         return
 
+    def _gatherErrorRatios(self, element_errors):
+        """
+        Helper function to gather the element error ratios on the root proc
+        for the adaptation history, returns None on the other procs
+        """
+        elem_counts = self.comm.allgather(len(element_errors))
+        nelems_tot = sum(elem_counts)
+        target_error = self.error_tol / nelems_tot
+        error_ratio = np.ascontiguousarray(element_errors / target_error)
+        error_ratio_tot = None
+        if self.comm.rank == 0:
+            error_ratio_tot = np.empty(nelems_tot)
+        self.comm.Gatherv(error_ratio, [error_ratio_tot, elem_counts], root=0)
+        return error_ratio_tot
+
     def _selectModel(self, model_type):
         """
         Helper function to check and select the appropriate model option